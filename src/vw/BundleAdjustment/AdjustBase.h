@@ -28,6 +28,7 @@
 #define __VW_BUNDLEADJUSTMENT_ADJUST_BASE_H__
 
 #include <vw/BundleAdjustment/ModelBase.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
 #include <boost/foreach.hpp>
 
 namespace vw {
@@ -101,6 +102,20 @@ namespace ba {
   };
 
 
+  /// Computes the robust weights sqrt(cost(norm)) / norm of n residual
+  /// norms, which scale each residual so that its squared norm is its
+  /// robust cost.  The loop makes no calls the compiler can't inline,
+  /// so it vectorizes for the cost functions above that don't take a
+  /// log.  Zero norms get a weight of zero.
+  template <class RobustCostT>
+  inline void robust_weights( RobustCostT cost, double const* norms,
+                              double* weights, size_t n ) {
+    for ( size_t k = 0; k < n; k++ ) {
+      double norm = norms[k] > 0 ? norms[k] : 1.0;
+      weights[k] = norms[k] > 0 ? sqrt(cost(norm)) / norm : 0.0;
+    }
+  }
+
   // CHOLEKSY MATH FUNCTIONS
   //--------------------------------------------------------
   // DEVELOPER NOTE TO SELF:
@@ -226,6 +241,7 @@ namespace ba {
 
   protected:
     boost::shared_ptr<ControlNetwork> m_control_net;
+    CompactControlNetwork m_network; // What the adjusters iterate over
     BundleAdjustModelT & m_model;
     RobustCostT m_robust_cost_func;
 
@@ -239,6 +255,7 @@ namespace ba {
 
     bool m_use_camera_constraint;
     bool m_use_gcp_constraint;
+    uint32 m_num_threads;
 
   public:
     // Constructor
@@ -252,18 +269,20 @@ namespace ba {
 
       m_iterations = 0;
       m_control_net = m_model.control_network();
+      m_network.assign( *m_control_net );
 
       m_lambda = 1e-3;
       m_control = 0;
       m_nu = 2;
       g_tol = 1e-10;
       d_tol = 1e-10;
+      m_num_threads = 0;
 
       // Useful declarations
       unsigned num_cam_params = BundleAdjustModelT::camera_params_n;
       unsigned num_pt_params = BundleAdjustModelT::point_params_n;
       unsigned num_cameras = m_model.num_cameras();
-      unsigned num_ground_control_points = m_control_net->num_ground_control_points();
+      unsigned num_ground_control_points = m_network.num_ground_control_points();
       unsigned num_observations = 2*m_model.num_pixel_observations();
 
       if (m_use_camera_constraint)
@@ -273,32 +292,19 @@ namespace ba {
 
       // Compute the initial error
       Vector<double> epsilon(num_observations);   // Error vector
-      int idx = 0;
-      int i = 0;
-      for (ControlNetwork::const_iterator cpoint = m_control_net->begin();
-           cpoint != m_control_net->end(); ++cpoint ) {
-        for (ControlPoint::const_iterator cmeasure = cpoint->begin();
-             cmeasure != cpoint->end(); ++cmeasure ) {
-          int camera_idx = cmeasure->image_id();
-
-          // Apply robust cost function weighting and populate error
-          // vector
-          Vector2 unweighted_error;
-          try {
-            unweighted_error = cmeasure->dominant() -
-              m_model.cam_pixel(i, camera_idx,m_model.cam_params(camera_idx),
-                      m_model.point_params(i));
-          } catch (const camera::PointToPixelErr& e) {
-            vw_out(WarningMessage,"ba") << "Unable to calculate starting error for point";
-          }
-          double mag = norm_2(unweighted_error);
-          double weight = sqrt(m_robust_cost_func(mag))/mag;
-          subvector(epsilon,2*idx,2) = unweighted_error * weight;
-
-          ++idx;
-        }
-        i++;
-      }
+      std::vector<camera_vector> cameras( num_cameras );
+      std::vector<point_vector>  points( m_model.num_points() );
+      for (unsigned j = 0; j < num_cameras; ++j)
+        cameras[j] = m_model.cam_params(j);
+      for (unsigned i = 0; i < points.size(); ++i)
+        points[i] = m_model.point_params(i);
+      std::vector<double> residuals;
+      size_t failed = weighted_residuals( cameras, points, residuals );
+      if ( failed )
+        vw_out(WarningMessage,"ba") << "Unable to calculate starting error for "
+                                    << failed << " measures.\n";
+      for (size_t k = 0; k < residuals.size(); ++k)
+        epsilon[k] = residuals[k];
 
       // Add rows epsilon for a priori position/pose constraints ...
       if (m_use_camera_constraint)
@@ -309,12 +315,12 @@ namespace ba {
 
       // .. and the position of the 3D points to epsilon ...
       if (m_use_gcp_constraint) {
-        idx = 2*m_model.num_pixel_observations();
+        int idx = 2*m_model.num_pixel_observations();
         if ( m_use_camera_constraint )
           idx += num_cameras*num_cam_params;
 
         for (unsigned i = 0; i < m_model.num_points(); ++i )
-          if ( (*m_control_net)[i].type() == ControlPoint::GroundControlPoint ) {
+          if ( m_network.is_ground_control_point(i) ) {
             subvector( epsilon, idx, num_pt_params) =
               m_model.point_target(i)-m_model.point_params(i);
             idx += num_pt_params;
@@ -325,6 +331,57 @@ namespace ba {
     // Access to inner templates
     typedef BundleAdjustModelT model_type;
     typedef RobustCostT cost_type;
+    typedef Vector<double, BundleAdjustModelT::camera_params_n> camera_vector;
+    typedef Vector<double, BundleAdjustModelT::point_params_n>  point_vector;
+
+    /// Fills residuals with the robust weighted residuals of every
+    /// measure, two per measure in the order of the network, for the
+    /// given camera and point parameters.  The measures of each camera
+    /// are projected with one call to the model's cam_pixels(), and
+    /// their robust weights computed together.  Measures that do not
+    /// project have zero residuals, and their number is returned.
+    size_t weighted_residuals( std::vector<camera_vector> const& cameras,
+                               std::vector<point_vector> const& points,
+                               std::vector<double>& residuals ) {
+      residuals.assign( 2*m_network.num_measures(), 0.0 );
+      std::vector<size_t> point_ids;
+      std::vector<point_vector> camera_points;
+      std::vector<Vector2> pixels;
+      std::vector<uint8> valid;
+      std::vector<double> norms, weights;
+      size_t failed = 0;
+      for (size_t j = 0; j < m_network.num_cameras(); ++j) {
+        const size_t begin = m_network.camera_begin(j), n = m_network.camera_size(j);
+        if ( n == 0 )
+          continue;
+        point_ids.resize( n );
+        camera_points.resize( n );
+        for (size_t k = 0; k < n; ++k) {
+          point_ids[k] = m_network.measure_point( m_network.camera_measure(begin+k) );
+          camera_points[k] = points[point_ids[k]];
+        }
+        m_model.cam_pixels( j, cameras[j], point_ids, camera_points, pixels, valid );
+
+        norms.resize( n );
+        weights.resize( n );
+        for (size_t k = 0; k < n; ++k) {
+          if ( valid[k] )
+            pixels[k] = m_network.measure_dominant( m_network.camera_measure(begin+k) ) - pixels[k];
+          else {
+            pixels[k] = Vector2();
+            failed++;
+          }
+          norms[k] = norm_2( pixels[k] );
+        }
+        robust_weights( m_robust_cost_func, &norms[0], &weights[0], n );
+        for (size_t k = 0; k < n; ++k) {
+          const size_t m = m_network.camera_measure(begin+k);
+          residuals[2*m]   = pixels[k][0] * weights[k];
+          residuals[2*m+1] = pixels[k][1] * weights[k];
+        }
+      }
+      return failed;
+    }
 
     // Operational Controls
     double lambda() const { return m_lambda; }
@@ -334,6 +391,11 @@ namespace ba {
     bool camera_constraint() const { return m_use_camera_constraint; }
     bool gcp_constraint() const { return m_use_gcp_constraint; }
 
+    // Threads used by the sparse adjusters to build the reduced
+    // camera system, or zero for the default number.
+    uint32 num_threads() const { return m_num_threads; }
+    void set_num_threads(uint32 num_threads) { m_num_threads = num_threads; }
+
     // Additional Information
     int iterations() const { return m_iterations; }
     RobustCostT costfunction() const { return m_robust_cost_func; }
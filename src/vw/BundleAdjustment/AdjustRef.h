@@ -128,7 +128,7 @@ namespace ba {
         this->m_model.num_points()*num_pt_params;
 
       unsigned num_cameras = this->m_model.num_cameras();
-      unsigned num_ground_control_points = this->m_control_net->num_ground_control_points();
+      unsigned num_ground_control_points = this->m_network.num_ground_control_points();
       unsigned num_observations = 2*this->m_model.num_pixel_observations();
       if (this->m_use_camera_constraint)
         num_observations += num_cameras*num_cam_params;
@@ -143,10 +143,10 @@ namespace ba {
       // --- SETUP STEP ----
       // Add rows to J and error for the imaged pixel observations
       int idx = 0;
-      for (unsigned i = 0; i < this->m_control_net->size(); ++i) {       // Iterate over control points
-        for (unsigned m = 0; m < (*(this->m_control_net))[i].size();
+      for (unsigned i = 0; i < this->m_network.num_points(); ++i) {       // Iterate over control points
+        for (size_t m = this->m_network.point_begin(i); m < this->m_network.point_end(i);
              ++m) {  // Iterate over control measures
-          int camera_idx = (*(this->m_control_net))[i][m].image_id();
+          int camera_idx = this->m_network.measure_camera(m);
 
           Matrix<double> J_a = this->m_model.cam_jacobian(i,camera_idx,
                                                         this->m_model.cam_params(camera_idx),
@@ -162,7 +162,7 @@ namespace ba {
           // Apply robust cost function weighting and populate the error vector
           Vector2 unweighted_error;
           try {
-            unweighted_error = (*(this->m_control_net))[i][m].dominant() -
+            unweighted_error = this->m_network.measure_dominant(m) -
               this->m_model.cam_pixel(i, camera_idx,
                             this->m_model.cam_params(camera_idx),
                             this->m_model.point_params(i));
@@ -173,7 +173,7 @@ namespace ba {
 
           // Fill in the entries of the sigma matrix with the uncertainty of the observations.
           Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (*(this->m_control_net))[i][m].sigma();
+          Vector2 pixel_sigma = this->m_network.measure_sigma(m);
 
           inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
           inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
@@ -217,7 +217,7 @@ namespace ba {
       if ( this->m_use_gcp_constraint ) {
         idx = 0;
         for (unsigned i=0; i < this->m_model.num_points(); ++i) {
-          if ((*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint) {
+          if (this->m_network.is_ground_control_point(i)) {
             Matrix<double> id(num_pt_params,num_pt_params);
             id.set_identity();
             submatrix(J,2*this->m_model.num_pixel_observations() +
@@ -291,29 +291,20 @@ namespace ba {
 
       // --- EVALUATE POTENTIAL UPDATE STEP ---
       Vector<double> new_error(num_observations);                  // Error vector
-      idx = 0;
-      for (unsigned i = 0; i < this->m_control_net->size(); ++i) {
-        for (unsigned m = 0; m < (*this->m_control_net)[i].size(); ++m) {
-          int camera_idx = (*this->m_control_net)[i][m].image_id();
-
-          Vector<double> cam_delta = subvector(delta, num_cam_params*camera_idx, num_cam_params);
-          Vector<double> pt_delta = subvector(delta, num_cam_params*num_cameras + num_pt_params*i,
-                                              num_pt_params);
-
-          // Apply robust cost function weighting and populate the error vector
-          Vector2 unweighted_error;
-          try {
-            unweighted_error = (*this->m_control_net)[i][m].dominant() -
-              this->m_model.cam_pixel(i, camera_idx,
-                            this->m_model.cam_params(camera_idx)-cam_delta,
-                            this->m_model.point_params(i)-pt_delta);
-          } catch (const camera::PointToPixelErr& e) {}
-          double mag = norm_2(unweighted_error);
-          double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-          subvector(new_error,2*idx,2) = unweighted_error * weight;
-
-          ++idx;
-        }
+      {
+        std::vector<typename AdjustRef::camera_vector> new_cams( num_cameras );
+        std::vector<typename AdjustRef::point_vector>  new_points( num_points );
+        for (unsigned j = 0; j < num_cameras; ++j)
+          new_cams[j] = this->m_model.cam_params(j) -
+            subvector(delta, num_cam_params*j, num_cam_params);
+        for (unsigned i = 0; i < num_points; ++i)
+          new_points[i] = this->m_model.point_params(i) -
+            subvector(delta, num_cam_params*num_cameras + num_pt_params*i, num_pt_params);
+
+        std::vector<double> residuals;
+        this->weighted_residuals( new_cams, new_points, residuals );
+        for (size_t k = 0; k < residuals.size(); ++k)
+          new_error[k] = residuals[k];
       }
 
       // Add rows to J and error for a priori position/pose constraints...
@@ -330,7 +321,7 @@ namespace ba {
       if (this->m_use_gcp_constraint) {
         idx = 0;
         for (unsigned i=0; i < this->m_model.num_points(); ++i) {
-          if ((*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint) {
+          if (this->m_network.is_ground_control_point(i)) {
             Vector<double> pt_delta = subvector(delta, num_cam_params*num_cameras + num_pt_params*i,
                                                 num_pt_params);
             subvector(new_error,
@@ -125,7 +125,7 @@ namespace ba {
       unsigned num_model_parameters = this->m_model.num_cameras()*num_cam_params + this->m_model.num_points()*num_pt_params;
 
       unsigned num_cameras = this->m_model.num_cameras();
-      unsigned num_ground_control_points = this->m_control_net->num_ground_control_points();
+      unsigned num_ground_control_points = this->m_network.num_ground_control_points();
 
       // Need to keep pixel obs separate from 'initials' for robust code
       // unsigned num_pixel_observations = 2*this->m_model.num_pixel_observations();
@@ -159,10 +159,10 @@ namespace ba {
 
       int idx = 0;
       // Iterate over control points
-      for (unsigned i = 0; i < this->m_control_net->size(); ++i) {
+      for (unsigned i = 0; i < this->m_network.num_points(); ++i) {
         // Iterate over control measures
-        for (unsigned m = 0; m < (*(this->m_control_net))[i].size(); ++m) {
-          int camera_idx = (*(this->m_control_net))[i][m].image_id();
+        for (size_t m = this->m_network.point_begin(i); m < this->m_network.point_end(i); ++m) {
+          int camera_idx = this->m_network.measure_camera(m);
 
           Matrix<double> J_a = this->m_model.cam_jacobian(i,camera_idx,
                                                         this->m_model.cam_params(camera_idx),
@@ -174,14 +174,14 @@ namespace ba {
           // Apply robust cost function weighting and populate the error vector
           Vector2 unweighted_error;
           try {
-            unweighted_error = (*(this->m_control_net))[i][m].dominant() -
+            unweighted_error = this->m_network.measure_dominant(m) -
               this->m_model.cam_pixel(i, camera_idx,
                             this->m_model.cam_params(camera_idx),
                             this->m_model.point_params(i));
           } catch (const camera::PointToPixelErr& e) {}
           // Fill in the entries of the sigma matrix with the uncertainty of the observations.
           Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (*(this->m_control_net))[i][m].sigma();
+          Vector2 pixel_sigma = this->m_network.measure_sigma(m);
           inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
           inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
           submatrix(sigma, 2*idx, 2*idx, 2, 2) = inverse_cov;
@@ -253,7 +253,7 @@ namespace ba {
       if (this->m_use_gcp_constraint) {
         idx = 0;
         for (unsigned i=0; i < this->m_model.num_points(); ++i) {
-          if ((*(this->m_control_net))[i].type() == ControlPoint::GroundControlPoint) {
+          if (this->m_network.is_ground_control_point(i)) {
             Matrix<double> id(num_pt_params,num_pt_params);
             id.set_identity();
 
@@ -326,10 +326,10 @@ namespace ba {
 
       idx = 0;
       // Iterate over control points
-      for (unsigned i = 0; i < this->m_control_net->size(); ++i) {
+      for (unsigned i = 0; i < this->m_network.num_points(); ++i) {
         // Iterate over control measures
-        for (unsigned m = 0; m < (*(this->m_control_net))[i].size(); ++m) {
-          int camera_idx = (*(this->m_control_net))[i][m].image_id();
+        for (size_t m = this->m_network.point_begin(i); m < this->m_network.point_end(i); ++m) {
+          int camera_idx = this->m_network.measure_camera(m);
 
           Vector<double> cam_delta = subvector(delta, num_cam_params*camera_idx, num_cam_params);
 
@@ -338,7 +338,7 @@ namespace ba {
           // Apply robust cost function weighting and populate the error vector
           Vector2 unweighted_error;
           try {
-            unweighted_error = (*(this->m_control_net))[i][m].dominant() -
+            unweighted_error = this->m_network.measure_dominant(m) -
               this->m_model.cam_pixel(i, camera_idx,
                             this->m_model.cam_params(camera_idx)-cam_delta,
                             this-> m_model.point_params(i)-pt_delta);
@@ -370,7 +370,7 @@ namespace ba {
       if (this->m_use_gcp_constraint) {
         idx = 0;
         for (unsigned i=0; i < this->m_model.num_points(); ++i) {
-          if ((*(this->m_control_net))[i].type() == ControlPoint::GroundControlPoint) {
+          if (this->m_network.is_ground_control_point(i)) {
             Vector<double> pt_delta = subvector(delta, num_cam_params*num_cameras + num_pt_params*i, num_pt_params);
 
             Vector<double> unweighted_error = this->m_model.point_target(i)-(this->m_model.point_params(i) - pt_delta);
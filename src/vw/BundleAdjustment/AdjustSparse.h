@@ -28,6 +28,8 @@
 #include <vw/Core/Debugging.h>
 #include <vw/BundleAdjustment/AdjustBase.h>
 #include <vw/BundleAdjustment/CameraRelation.h>
+#include <vw/BundleAdjustment/CameraSystemSolver.h>
+#include <vw/BundleAdjustment/SchurComplement.h>
 
 // Boost
 #include <boost/numeric/ublas/matrix_sparse.hpp>
@@ -65,6 +67,7 @@ namespace ba {
     std::vector<size_t> m_ideal_ordering;
     Vector<size_t> m_ideal_skyline;
     bool m_found_ideal_ordering;
+    boost::shared_ptr<CameraSystemSolver> m_camera_solver;
     CameraRelationNetwork<JFeature> m_crn;
     typedef CameraNode<JFeature>::iterator crn_iter;
 
@@ -93,6 +96,13 @@ namespace ba {
 
     math::MatrixSparseSkyline<double> S() const { return m_S; }
 
+    /// Solve the reduced camera system with solver rather than the
+    /// skyline LDL^T decomposition.  An empty pointer restores the
+    /// skyline solver, which is the default.  A matrix free solver
+    /// never forms S, so S() keeps the last S that was formed.
+    void set_camera_solver( boost::shared_ptr<CameraSystemSolver> solver ) { m_camera_solver = solver; }
+    boost::shared_ptr<CameraSystemSolver> camera_solver() const { return m_camera_solver; }
+
     // Covariance Calculator
     // ___________________________________________________________
     // This routine inverts a sparse matrix S, and prints the individual
@@ -212,7 +222,7 @@ namespace ba {
       // Points (GCPs), not for 3D tie points.
       if (this->m_use_gcp_constraint)
         for ( size_t i = 0; i < V.size(); ++i )
-          if ((*this->m_control_net)[i].type() == ControlPoint::GroundControlPoint) {
+          if (this->m_network.is_ground_control_point(i)) {
             matrix_point_point inverse_cov;
             inverse_cov = this->m_model.point_inverse_covariance(i);
             V[i] += inverse_cov;
@@ -272,114 +282,81 @@ namespace ba {
           epsilon_a[j];
       }
 
-      // Compute V inverse
-      for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-        Matrix<double> V_temp = V[i];
-        chol_inverse( V_temp );
-        V_inverse[i] = transpose(V_temp)*V_temp;
-      }
+      // Compute V inverse, then Y, and finish constructing e.
+      schur_invert_points( V, V_inverse, this->m_num_threads );
+      schur_compute_y( m_crn, V_inverse, epsilon_b, e, num_cam_params, this->m_num_threads );
+      time.reset();
 
-      // Compute Y and finish constructing e.
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute the blocks of Y
-          (**fiter).m_y = (**fiter).m_w * V_inverse[(**fiter).m_point_id];
-          // Flatten the block structure to compute 'e'
-          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
-            * epsilon_b[ (**fiter).m_point_id ];
+      // --- SOLVE A'S UPDATE STEP WITHOUT FORMING S ----------------------
+      Vector<double> delta_a;
+      if ( m_camera_solver && m_camera_solver->matrix_free() ) {
+        time.reset(new Timer("Solve Delta A with " + m_camera_solver->name(), DebugMessage, "ba"));
+        try {
+          delta_a = m_camera_solver->solve( SchurOperator( m_crn, U, this->m_model.num_points(),
+                                                           this->m_num_threads ), e );
+        } catch ( const MathErr& err ) {
+          vw_out(WarningMessage,"ba") << "Camera system solver failed, using skyline: "
+                                      << err.what() << "\n";
         }
+        time.reset();
       }
 
-      time.reset();
-
       // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
-      time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
-
-      // The S matrix is a m x m block matrix with blocks that are
-      // camera_params_n x camera_params_n in size.  It has a sparse
-      // skyline structure, which makes it more efficient to solve
-      // through L*D*L^T decomposition and forward/back substitution
-      // below.
-      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
-                                          this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
-
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
-
-          // Augmenting Diagonal
-          S_jj += U[j];
+      if ( delta_a.size() == 0 ) {
+        time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
+
+        // The S matrix is a m x m block matrix with blocks that are
+        // camera_params_n x camera_params_n in size.  It has a sparse
+        // skyline structure, which makes it more efficient to solve
+        // through L*D*L^T decomposition and forward/back substitution
+        // below.
+        math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
+                                            this->m_model.num_cameras()*num_cam_params);
+        SparseBlockRows S_blocks;
+        schur_build_blocks( m_crn, U, S_blocks, this->m_num_threads );
+        schur_load_skyline( S_blocks, S );
+
+        m_S = S; // S is modified in sparse solve. Keeping a copy.
+        time.reset();
 
-          // Loading into sparse matrix
-          size_t offset = j * num_cam_params;
-          for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
-            for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
-            }
+        // Solve with the camera system solver if one was given, falling
+        // back to the skyline solver if it fails.
+        if ( m_camera_solver && !m_camera_solver->matrix_free() ) {
+          time.reset(new Timer("Solve Delta A with " + m_camera_solver->name(), DebugMessage, "ba"));
+          try {
+            delta_a = m_camera_solver->solve( S_blocks, e );
+          } catch ( const MathErr& err ) {
+            vw_out(WarningMessage,"ba") << "Camera system solver failed, using skyline: "
+                                        << err.what() << "\n";
           }
+          time.reset();
         }
 
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
-
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
-          }
+        if ( delta_a.size() == 0 ) {
+          // Computing ideal ordering
+          if (!m_found_ideal_ordering) {
+            time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
+            m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
+            math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
+            m_ideal_skyline = solve_for_skyline(mod_S);
 
-          // Loading into sparse matrix
-          // - if it seems we are loading in oddly, it's because the sparse
-          //   matrix is row major.
-          if ( found ) {
-            submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
+            m_found_ideal_ordering = true;
+            time.reset();
           }
-        }
-      }
-
-      m_S = S; // S is modified in sparse solve. Keeping a copy.
-      time.reset();
 
-      // Computing ideal ordering
-      if (!m_found_ideal_ordering) {
-        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
-        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
-        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
-        m_ideal_skyline = solve_for_skyline(mod_S);
+          time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
 
-        m_found_ideal_ordering = true;
-        time.reset();
+          // Compute the LDL^T decomposition and solve using sparse methods.
+          math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
+          delta_a = sparse_solve( modified_S,
+                                  reorganize(e, m_ideal_ordering),
+                                  m_ideal_skyline );
+          delta_a = reorganize(delta_a, modified_S.inverse());
+          time.reset();
+        }
       }
-
-      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
-
-      // Compute the LDL^T decomposition and solve using sparse methods.
-      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
-      Vector<double> delta_a = sparse_solve( modified_S,
-                                             reorganize(e, m_ideal_ordering),
-                                             m_ideal_skyline );
-      delta_a = reorganize(delta_a, modified_S.inverse());
       BOOST_FOREACH( double& e, delta_a )
         if ( std::isnan( e ) ) e = 0;
-      time.reset();
 
       // --- SOLVE B'S UPDATE STEP ---------------------------------
 
@@ -426,32 +403,22 @@ namespace ba {
       // -------------------------------
       time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
       double new_error_total = 0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute error vector
-          vector_camera new_a = this->m_model.cam_params(j) +
+      {
+        std::vector<vector_camera> new_a( this->m_model.num_cameras() );
+        std::vector<vector_point>  new_b( this->m_model.num_points() );
+        for ( size_t j = 0; j < new_a.size(); j++ )
+          new_a[j] = this->m_model.cam_params(j) +
             subvector( delta_a, num_cam_params*j, num_cam_params );
-          vector_point new_b = this->m_model.point_params((**fiter).m_point_id) +
-            subvector( delta_b, num_pt_params*(**fiter).m_point_id, num_pt_params );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = (**fiter).m_location -
-              this->m_model.cam_pixel((**fiter).m_point_id,j,new_a,new_b);
-          } catch (const camera::PointToPixelErr& e) {}
-          double mag = norm_2( error );
-          double weight = sqrt( this->m_robust_cost_func(mag)) / mag;
-          error *= weight;
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-
-          new_error_total += .5 * transpose(error) *
-            inverse_cov * error;
+        for ( size_t i = 0; i < new_b.size(); i++ )
+          new_b[i] = this->m_model.point_params(i) +
+            subvector( delta_b, num_pt_params*i, num_pt_params );
+
+        std::vector<double> residuals;
+        this->weighted_residuals( new_a, new_b, residuals );
+        for ( size_t m = 0; m < this->m_network.num_measures(); m++ ) {
+          Vector2 pixel_sigma = this->m_network.measure_sigma(m);
+          new_error_total += .5 * ( residuals[2*m]*residuals[2*m] / (pixel_sigma(0)*pixel_sigma(0)) +
+                                    residuals[2*m+1]*residuals[2*m+1] / (pixel_sigma(1)*pixel_sigma(1)) );
         }
       }
 
@@ -471,8 +438,7 @@ namespace ba {
       // GCP Error
       if ( this->m_use_gcp_constraint )
         for ( size_t i = 0; i < V.size(); ++i )
-          if ( (*this->m_control_net)[i].type() ==
-               ControlPoint::GroundControlPoint) {
+          if (this->m_network.is_ground_control_point(i)) {
 
             vector_point new_b = this->m_model.point_params(i) +
               subvector( delta_b, num_pt_params*i, num_pt_params );
@@ -0,0 +1,272 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BlockCholesky.cc
+///
+
+#include <vw/BundleAdjustment/BlockCholesky.h>
+#include <vw/Core/Exception.h>
+
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+namespace vw {
+namespace ba {
+
+std::vector<std::vector<size_t> > BlockSparseCholesky::pattern_of( SparseBlockRows const& rows ) {
+  std::vector<std::vector<size_t> > pattern( rows.size() );
+  for ( size_t j = 0; j < rows.size(); j++ ) {
+    for ( size_t b = 0; b < rows[j].size(); b++ ) {
+      size_t k = rows[j][b].first;
+      VW_ASSERT( k >= j && k < rows.size(),
+                 ArgumentErr() << "BlockSparseCholesky: Block (" << j << "," << k
+                               << ") is not in the upper triangle." );
+      if ( k > j )
+        pattern[j].push_back( k );
+    }
+    std::sort( pattern[j].begin(), pattern[j].end() );
+    pattern[j].erase( std::unique( pattern[j].begin(), pattern[j].end() ), pattern[j].end() );
+  }
+  return pattern;
+}
+
+void BlockSparseCholesky::analyze( SparseBlockRows const& rows ) {
+  const size_t n = rows.size();
+  m_factored = false;
+  m_pattern = pattern_of( rows );
+
+  m_block_size = 0;
+  for ( size_t j = 0; j < n && m_block_size == 0; j++ )
+    if ( !rows[j].empty() )
+      m_block_size = rows[j][0].second.rows();
+
+  // Minimum degree ordering, eliminating the graph of the blocks one
+  // vertex at a time.  The neighbors of a vertex when it is
+  // eliminated are the rows of its column in the factor, and they
+  // become a clique.
+  std::vector<std::set<size_t> > adjacent( n );
+  for ( size_t j = 0; j < n; j++ )
+    for ( size_t b = 0; b < m_pattern[j].size(); b++ ) {
+      adjacent[j].insert( m_pattern[j][b] );
+      adjacent[m_pattern[j][b]].insert( j );
+    }
+
+  typedef std::set<std::pair<size_t, size_t> > DegreeQueue;
+  DegreeQueue queue;
+  for ( size_t j = 0; j < n; j++ )
+    queue.insert( std::make_pair( adjacent[j].size(), j ) );
+
+  m_order.resize( n );
+  m_position.resize( n );
+  std::vector<std::vector<size_t> > structure( n );
+  for ( size_t step = 0; step < n; step++ ) {
+    const size_t v = queue.begin()->second;
+    queue.erase( queue.begin() );
+    m_order[step] = v;
+    m_position[v] = step;
+
+    std::set<size_t> const& neighbors = adjacent[v];
+    structure[v].assign( neighbors.begin(), neighbors.end() );
+    for ( std::set<size_t>::const_iterator u = neighbors.begin(); u != neighbors.end(); ++u ) {
+      queue.erase( std::make_pair( adjacent[*u].size(), *u ) );
+      adjacent[*u].erase( v );
+      for ( std::set<size_t>::const_iterator w = neighbors.begin(); w != neighbors.end(); ++w )
+        if ( *w != *u )
+          adjacent[*u].insert( *w );
+      queue.insert( std::make_pair( adjacent[*u].size(), *u ) );
+    }
+    adjacent[v].clear();
+  }
+
+  m_rows.assign( n, std::vector<size_t>() );
+  for ( size_t c = 0; c < n; c++ ) {
+    std::vector<size_t> const& s = structure[m_order[c]];
+    for ( size_t r = 0; r < s.size(); r++ )
+      m_rows[c].push_back( m_position[s[r]] );
+    std::sort( m_rows[c].begin(), m_rows[c].end() );
+  }
+  m_diagonal.assign( n, std::vector<double>() );
+  m_values.assign( n, std::vector<double>() );
+}
+
+double* BlockSparseCholesky::find_block( size_t row, size_t col ) {
+  std::vector<size_t> const& rows = m_rows[col];
+  std::vector<size_t>::const_iterator it = std::lower_bound( rows.begin(), rows.end(), row );
+  VW_ASSERT( it != rows.end() && *it == row,
+             LogicErr() << "BlockSparseCholesky: Block (" << row << "," << col
+                        << ") is missing from the factor." );
+  return &m_values[col][(it - rows.begin())*m_block_size*m_block_size];
+}
+
+size_t BlockSparseCholesky::factor_blocks() const {
+  size_t count = 0;
+  for ( size_t c = 0; c < m_rows.size(); c++ )
+    count += m_rows[c].size();
+  return count;
+}
+
+void BlockSparseCholesky::factor( SparseBlockRows const& rows ) {
+  if ( m_order.size() != rows.size() || pattern_of( rows ) != m_pattern )
+    analyze( rows );
+  m_factored = false;
+
+  const size_t n  = m_order.size();
+  const size_t bs = m_block_size;
+  const size_t bb = bs*bs;
+  for ( size_t c = 0; c < n; c++ ) {
+    m_diagonal[c].assign( bb, 0.0 );
+    m_values[c].assign( m_rows[c].size()*bb, 0.0 );
+  }
+
+  // Load the lower triangle in elimination order.
+  for ( size_t j = 0; j < n; j++ ) {
+    for ( size_t b = 0; b < rows[j].size(); b++ ) {
+      size_t k = rows[j][b].first;
+      Matrix<double> const& block = rows[j][b].second;
+      VW_ASSERT( block.rows() == bs && block.cols() == bs,
+                 ArgumentErr() << "BlockSparseCholesky: Block (" << j << "," << k
+                               << ") is not " << bs << "x" << bs << "." );
+      size_t pj = m_position[j], pk = m_position[k];
+      if ( k == j ) {
+        double* d = &m_diagonal[pj][0];
+        for ( size_t r = 0; r < bs; r++ )
+          for ( size_t s = 0; s <= r; s++ )
+            d[r*bs+s] += block(s,r);
+      } else if ( pj > pk ) {
+        double* l = find_block( pj, pk );
+        for ( size_t r = 0; r < bs; r++ )
+          for ( size_t s = 0; s < bs; s++ )
+            l[r*bs+s] += block(r,s);
+      } else {
+        double* l = find_block( pk, pj );
+        for ( size_t r = 0; r < bs; r++ )
+          for ( size_t s = 0; s < bs; s++ )
+            l[r*bs+s] += block(s,r);
+      }
+    }
+  }
+
+  // Right looking factorization, one block column at a time.
+  for ( size_t c = 0; c < n; c++ ) {
+    double* d = &m_diagonal[c][0];
+    for ( size_t s = 0; s < bs; s++ ) {
+      double sum = d[s*bs+s];
+      for ( size_t t = 0; t < s; t++ )
+        sum -= d[s*bs+t]*d[s*bs+t];
+      if ( !(sum > 0) )
+        vw_throw( MathErr() << "BlockSparseCholesky: Matrix is not positive definite." );
+      d[s*bs+s] = std::sqrt( sum );
+      for ( size_t r = s+1; r < bs; r++ ) {
+        double value = d[r*bs+s];
+        for ( size_t t = 0; t < s; t++ )
+          value -= d[r*bs+t]*d[s*bs+t];
+        d[r*bs+s] = value / d[s*bs+s];
+      }
+    }
+
+    // L_rc = A_rc * L_cc^-T, solving each row against L_cc.
+    const size_t m = m_rows[c].size();
+    for ( size_t a = 0; a < m; a++ ) {
+      double* l = &m_values[c][a*bb];
+      for ( size_t r = 0; r < bs; r++ )
+        for ( size_t s = 0; s < bs; s++ ) {
+          double value = l[r*bs+s];
+          for ( size_t t = 0; t < s; t++ )
+            value -= l[r*bs+t]*d[s*bs+t];
+          l[r*bs+s] = value / d[s*bs+s];
+        }
+    }
+
+    // Subtract L_ac * L_bc^T from the rest of the matrix.
+    for ( size_t a = 0; a < m; a++ ) {
+      const double* la = &m_values[c][a*bb];
+      for ( size_t b = 0; b <= a; b++ ) {
+        const double* lb = &m_values[c][b*bb];
+        double* target = ( a == b ) ? &m_diagonal[m_rows[c][a]][0]
+                                    : find_block( m_rows[c][a], m_rows[c][b] );
+        for ( size_t r = 0; r < bs; r++ )
+          for ( size_t s = 0; s < bs; s++ ) {
+            double sum = 0;
+            for ( size_t t = 0; t < bs; t++ )
+              sum += la[r*bs+t]*lb[s*bs+t];
+            target[r*bs+s] -= sum;
+          }
+      }
+    }
+  }
+  m_factored = true;
+}
+
+Vector<double> BlockSparseCholesky::solve( Vector<double> const& b ) const {
+  VW_ASSERT( m_factored, LogicErr() << "BlockSparseCholesky: Solve called before a successful factor()." );
+  const size_t n  = m_order.size();
+  const size_t bs = m_block_size;
+  const size_t bb = bs*bs;
+  VW_ASSERT( b.size() == n*bs, ArgumentErr() << "BlockSparseCholesky: Expected a vector of size "
+                                             << n*bs << ", not " << b.size() << "." );
+
+  std::vector<double> y( n*bs );
+  for ( size_t c = 0; c < n; c++ )
+    for ( size_t s = 0; s < bs; s++ )
+      y[c*bs+s] = b[m_order[c]*bs+s];
+
+  // Solve L z = y
+  for ( size_t c = 0; c < n; c++ ) {
+    const double* d = &m_diagonal[c][0];
+    double* yc = &y[c*bs];
+    for ( size_t s = 0; s < bs; s++ ) {
+      for ( size_t t = 0; t < s; t++ )
+        yc[s] -= d[s*bs+t]*yc[t];
+      yc[s] /= d[s*bs+s];
+    }
+    for ( size_t a = 0; a < m_rows[c].size(); a++ ) {
+      const double* l = &m_values[c][a*bb];
+      double* yr = &y[m_rows[c][a]*bs];
+      for ( size_t r = 0; r < bs; r++ )
+        for ( size_t s = 0; s < bs; s++ )
+          yr[r] -= l[r*bs+s]*yc[s];
+    }
+  }
+
+  // Solve L^T x = z
+  for ( size_t c = n; c-- > 0; ) {
+    const double* d = &m_diagonal[c][0];
+    double* yc = &y[c*bs];
+    for ( size_t a = 0; a < m_rows[c].size(); a++ ) {
+      const double* l = &m_values[c][a*bb];
+      const double* yr = &y[m_rows[c][a]*bs];
+      for ( size_t r = 0; r < bs; r++ )
+        for ( size_t s = 0; s < bs; s++ )
+          yc[s] -= l[r*bs+s]*yr[r];
+    }
+    for ( size_t s = bs; s-- > 0; ) {
+      for ( size_t t = s+1; t < bs; t++ )
+        yc[s] -= d[t*bs+s]*yc[t];
+      yc[s] /= d[s*bs+s];
+    }
+  }
+
+  Vector<double> x( n*bs );
+  for ( size_t c = 0; c < n; c++ )
+    for ( size_t s = 0; s < bs; s++ )
+      x[m_order[c]*bs+s] = y[c*bs+s];
+  return x;
+}
+
+}} // namespace vw::ba
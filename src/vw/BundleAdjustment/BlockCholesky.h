@@ -0,0 +1,100 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BlockCholesky.h
+///
+/// Cholesky factorization of sparse symmetric positive definite
+/// matrices made of dense square blocks, such as the reduced camera
+/// system of bundle adjustment, where each block couples two cameras.
+///
+/// The block columns are ordered by minimum degree on the graph of
+/// the blocks, which keeps the fill-in of loosely connected networks
+/// far below what an envelope (skyline) ordering allows.  The blocks
+/// themselves are kept dense, so the factorization is made of dense
+/// block products rather than operations on single entries.
+///
+#ifndef __VW_BUNDLEADJUSTMENT_BLOCK_CHOLESKY_H__
+#define __VW_BUNDLEADJUSTMENT_BLOCK_CHOLESKY_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+#include <utility>
+#include <vector>
+
+namespace vw {
+namespace ba {
+
+  /// A sparse symmetric block matrix given by the upper triangle of
+  /// its block rows: rows[j] holds pairs (k, block) for k >= j, where
+  /// block is the square block in block row j and block column k.
+  /// Blocks may come in any order, and blocks that are not given are
+  /// zero.  Only the upper triangle of the diagonal blocks is used.
+  typedef std::vector<std::vector<std::pair<size_t, Matrix<double> > > > SparseBlockRows;
+
+  class BlockSparseCholesky {
+  public:
+    BlockSparseCholesky() : m_block_size(0), m_factored(false) {}
+
+    /// Order the block columns and find the structure of the factor
+    /// of matrices with the pattern of rows.  This only needs doing
+    /// again when the pattern changes, which factor() notices.
+    void analyze( SparseBlockRows const& rows );
+
+    /// Factor the matrix, throwing a MathErr if it is not positive
+    /// definite.
+    void factor( SparseBlockRows const& rows );
+
+    /// Solve A x = b with the last factorization.
+    Vector<double> solve( Vector<double> const& b ) const;
+
+    bool factored() const { return m_factored; }
+    size_t num_blocks() const { return m_order.size(); }
+    size_t block_size() const { return m_block_size; }
+
+    /// The elimination order: the original index of each block column.
+    std::vector<size_t> const& ordering() const { return m_order; }
+
+    /// The number of nonzero blocks below the diagonal of the factor.
+    size_t factor_blocks() const;
+
+  private:
+    /// The pattern of the analyzed matrix: for each block row, the
+    /// sorted block columns above the diagonal.
+    std::vector<std::vector<size_t> > m_pattern;
+
+    size_t m_block_size;
+    bool   m_factored;
+    std::vector<size_t> m_order;    ///< Position -> original block
+    std::vector<size_t> m_position; ///< Original block -> position
+
+    // The factor L, by block column in elimination order.  The blocks
+    // are stored row major.  m_diagonal[c] holds the lower triangular
+    // diagonal block of column c, and m_values[c] the blocks at the
+    // positions m_rows[c], which are sorted and all greater than c.
+    std::vector<std::vector<double> > m_diagonal;
+    std::vector<std::vector<size_t> > m_rows;
+    std::vector<std::vector<double> > m_values;
+
+    static std::vector<std::vector<size_t> > pattern_of( SparseBlockRows const& rows );
+    double* find_block( size_t row, size_t col );
+  };
+
+}} // namespace vw::ba
+
+#endif//__VW_BUNDLEADJUSTMENT_BLOCK_CHOLESKY_H__
@@ -19,12 +19,253 @@
 /// \file CameraRelation.cc
 ///
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/BundleAdjustment/CameraRelation.h>
 #include <boost/foreach.hpp>
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <limits>
 
 namespace vw {
 namespace ba {
 
+  namespace {
+
+    /// Runs one function, keeping the first error thrown by any task.
+    class RelationTask : public Task {
+      boost::function<void()> m_func;
+      Mutex& m_mutex;
+      std::exception_ptr& m_error;
+    public:
+      RelationTask( boost::function<void()> const& func, Mutex& mutex, std::exception_ptr& error )
+        : m_func(func), m_mutex(mutex), m_error(error) {}
+      virtual void operator()() {
+        try {
+          m_func();
+        } catch ( ... ) {
+          Mutex::Lock lock( m_mutex );
+          if ( !m_error )
+            m_error = std::current_exception();
+        }
+      }
+    };
+
+    uint32 resolve_threads( uint32 num_threads ) {
+      return num_threads ? num_threads : vw_settings().default_num_threads();
+    }
+
+    /// Runs the functions on num_threads threads and rethrows the
+    /// first error.
+    void run_tasks( std::vector<boost::function<void()> > const& funcs, uint32 num_threads ) {
+      if ( num_threads <= 1 || funcs.size() < 2 ) {
+        for ( size_t i = 0; i < funcs.size(); i++ )
+          funcs[i]();
+        return;
+      }
+      Mutex mutex;
+      std::exception_ptr error;
+      {
+        FifoWorkQueue queue( num_threads );
+        for ( size_t i = 0; i < funcs.size(); i++ )
+          queue.add_task( boost::shared_ptr<Task>( new RelationTask( funcs[i], mutex, error ) ) );
+        queue.join_all();
+      }
+      if ( error )
+        std::rethrow_exception( error );
+    }
+
+    /// The number of ranges to split work into: about four per thread.
+    size_t num_ranges( size_t size, uint32 num_threads ) {
+      if ( num_threads <= 1 || size < 2 )
+        return 1;
+      return std::min( size, size_t(4) * num_threads );
+    }
+
+    /// Calls func(begin, end) over [0, size) split into num_ranges().
+    void for_ranges( size_t size, uint32 num_threads,
+                     boost::function<void(size_t, size_t)> const& func ) {
+      const size_t count = num_ranges( size, num_threads );
+      std::vector<boost::function<void()> > funcs;
+      for ( size_t r = 0; r < count; r++ )
+        funcs.push_back( boost::bind( func, size * r / count, size * (r+1) / count ) );
+      run_tasks( funcs, num_threads );
+    }
+
+    /// For the m features of a point seen by cameras, next[k] is the
+    /// next feature after k seen by the same camera, or m.
+    void same_camera_next( uint32 const* cameras, size_t m, std::vector<size_t>& next ) {
+      next.assign( m, m );
+      for ( size_t k = 0; k < m; k++ )
+        for ( size_t h = k+1; h < m; h++ )
+          if ( cameras[h] == cameras[k] ) {
+            next[k] = h;
+            break;
+          }
+    }
+
+    /// Whether feature g is the one feature f connects to in g's
+    /// camera: the last of the other features in that camera, as
+    /// FeatureBase::build_map() picks.
+    inline bool is_partner( std::vector<size_t> const& next, size_t g, size_t f ) {
+      const size_t m = next.size();
+      if ( g == f )
+        return false;
+      return next[g] == m || ( next[g] == f && next[f] == m );
+    }
+  }
+
+  // Camera Relation Graph
+
+  /// A range of points, and the number of features and links its
+  /// points give each camera. Once those are summed over all bands,
+  /// the counts become where the band writes each camera's next entry,
+  /// so the bands fill their parts of the arrays independently.
+  struct CameraRelationGraph::Band {
+    size_t point_begin, point_end;
+    std::vector<size_t> camera_count, link_count;
+    std::vector<size_t> next; // Scratch for same_camera_next
+  };
+
+  void CameraRelationGraph::clear() {
+    m_point_offsets.assign( 1, 0 );
+    m_feature_camera.clear();
+    m_feature_point.clear();
+    m_camera_offsets.assign( 1, 0 );
+    m_camera_features.clear();
+    m_link_offsets.assign( 1, 0 );
+    m_links.clear();
+  }
+
+  void CameraRelationGraph::count_band( ControlNetwork const* cnet, Band* band ) {
+    for ( size_t i = band->point_begin; i < band->point_end; i++ ) {
+      ControlPoint const& cpoint = (*cnet)[i];
+      const size_t begin = m_point_offsets[i], m = cpoint.size();
+      for ( size_t k = 0; k < m; k++ ) {
+        const size_t camera = cpoint[k].image_id();
+        VW_ASSERT( camera < std::numeric_limits<uint32>::max(),
+                   ArgumentErr() << "CameraRelationGraph: Image id " << camera << " is out of range." );
+        m_feature_camera[begin+k] = uint32( camera );
+        m_feature_point [begin+k] = uint32( i );
+        if ( camera >= band->camera_count.size() ) {
+          band->camera_count.resize( camera+1, 0 );
+          band->link_count.resize( camera+1, 0 );
+        }
+        band->camera_count[camera]++;
+      }
+      same_camera_next( &m_feature_camera[begin], m, band->next );
+      for ( size_t f = 0; f < m; f++ )
+        for ( size_t g = 0; g < m; g++ )
+          if ( is_partner( band->next, g, f ) )
+            band->link_count[m_feature_camera[begin+f]]++;
+    }
+  }
+
+  void CameraRelationGraph::fill_band( Band* band ) {
+    for ( size_t i = band->point_begin; i < band->point_end; i++ ) {
+      const size_t begin = m_point_offsets[i], m = m_point_offsets[i+1] - begin;
+      uint32 const* cameras = &m_feature_camera[begin];
+      same_camera_next( cameras, m, band->next );
+      for ( size_t f = 0; f < m; f++ ) {
+        m_camera_features[band->camera_count[cameras[f]]++] = uint32( begin+f );
+        for ( size_t g = 0; g < m; g++ )
+          if ( is_partner( band->next, g, f ) ) {
+            Link& link = m_links[band->link_count[cameras[f]]++];
+            link.camera  = cameras[g];
+            link.feature = uint32( begin+f );
+            link.other   = uint32( begin+g );
+          }
+      }
+    }
+  }
+
+  // The bands leave each camera's links in feature order. A counting
+  // sort by the other camera keeps that order among the links to the
+  // same camera, and costs one pass rather than a comparison sort.
+  void CameraRelationGraph::sort_links( size_t begin, size_t end ) {
+    std::vector<size_t> position( num_cameras() + 1, 0 );
+    std::vector<Link> sorted;
+    for ( size_t j = begin; j < end; j++ ) {
+      const size_t first = m_link_offsets[j], last = m_link_offsets[j+1];
+      if ( last - first < 2 )
+        continue;
+      uint32 low = m_links[first].camera, high = low;
+      for ( size_t l = first; l < last; l++ ) {
+        low  = std::min( low,  m_links[l].camera );
+        high = std::max( high, m_links[l].camera );
+      }
+      std::fill( position.begin() + low, position.begin() + high + 2, 0 );
+      for ( size_t l = first; l < last; l++ )
+        position[m_links[l].camera + 1]++;
+      for ( uint32 k = low; k <= high; k++ )
+        position[k+1] += position[k];
+      sorted.resize( last - first );
+      for ( size_t l = first; l < last; l++ )
+        sorted[position[m_links[l].camera]++] = m_links[l];
+      std::copy( sorted.begin(), sorted.end(), m_links.begin() + first );
+    }
+  }
+
+  void CameraRelationGraph::build( ControlNetwork const& cnet, uint32 num_threads ) {
+    clear();
+    num_threads = resolve_threads( num_threads );
+
+    m_point_offsets.resize( cnet.size() + 1 );
+    for ( size_t i = 0; i < cnet.size(); i++ )
+      m_point_offsets[i+1] = m_point_offsets[i] + cnet[i].size();
+    const size_t num_features = m_point_offsets.back();
+    VW_ASSERT( num_features < std::numeric_limits<uint32>::max(),
+               ArgumentErr() << "CameraRelationGraph: Too many measures." );
+    m_feature_camera.resize( num_features );
+    m_feature_point.resize( num_features );
+
+    // Count each camera's features and links in each band of points.
+    std::vector<Band> bands( num_ranges( cnet.size(), num_threads ) );
+    std::vector<boost::function<void()> > funcs;
+    for ( size_t b = 0; b < bands.size(); b++ ) {
+      bands[b].point_begin = cnet.size() * b / bands.size();
+      bands[b].point_end   = cnet.size() * (b+1) / bands.size();
+      funcs.push_back( boost::bind( &CameraRelationGraph::count_band, this, &cnet, &bands[b] ) );
+    }
+    run_tasks( funcs, num_threads );
+
+    // Sum the counts into the offsets of the cameras, and of each
+    // band within them.
+    size_t num_cameras = 0;
+    for ( size_t b = 0; b < bands.size(); b++ )
+      num_cameras = std::max( num_cameras, bands[b].camera_count.size() );
+    m_camera_offsets.resize( num_cameras + 1 );
+    m_link_offsets.resize( num_cameras + 1 );
+    for ( size_t b = 0; b < bands.size(); b++ ) {
+      bands[b].camera_count.resize( num_cameras, 0 );
+      bands[b].link_count.resize( num_cameras, 0 );
+    }
+    for ( size_t j = 0; j < num_cameras; j++ ) {
+      size_t features = m_camera_offsets[j], links = m_link_offsets[j];
+      for ( size_t b = 0; b < bands.size(); b++ ) {
+        std::swap( features, bands[b].camera_count[j] );
+        std::swap( links,    bands[b].link_count[j] );
+        features += bands[b].camera_count[j];
+        links    += bands[b].link_count[j];
+      }
+      m_camera_offsets[j+1] = features;
+      m_link_offsets[j+1]   = links;
+    }
+
+    m_camera_features.resize( num_features );
+    m_links.resize( m_link_offsets.back() );
+    funcs.clear();
+    for ( size_t b = 0; b < bands.size(); b++ )
+      funcs.push_back( boost::bind( &CameraRelationGraph::fill_band, this, &bands[b] ) );
+    run_tasks( funcs, num_threads );
+
+    for_ranges( num_cameras, num_threads, boost::bind( &CameraRelationGraph::sort_links, this, _1, _2 ) );
+  }
+
   // Implementations for specific features
   ControlMeasure
   IPFeature::control_measure() const {
@@ -57,6 +298,8 @@ namespace ba {
   // Camera Relation Network
   template <class FeatureT>
   void CameraRelationNetwork<FeatureT>::add_node( cnode const& node ) {
+    m_graph.clear();
+    m_features.clear();
     m_nodes.push_back( node );
   }
 
@@ -89,45 +332,61 @@ namespace ba {
     }   // end iterating through cameras
   }
 
+  // Creates the features of points [begin, end) and doubly links the
+  // features of each point together.
   template <class FeatureT>
-  void CameraRelationNetwork<FeatureT>::read_controlnetwork( ControlNetwork const& cnet ) {
-    typedef boost::shared_ptr<FeatureT> f_ptr;
-    typedef boost::weak_ptr<FeatureT>   w_ptr;
-    m_nodes.clear();
-
-    for ( size_t point_id = 0; point_id < cnet.size(); point_id++ ) {
-      std::vector<f_ptr> features_added;
-      // Building up features to be added and linking to camera nodes
-      BOOST_FOREACH( ControlMeasure const& cm, cnet[point_id] ) {
-        // Seeing if a camera node exists for this measure
-        if ( cm.image_id() >= this->size() ) {
-          for ( size_t i = this->size(); i <= cm.image_id(); i++ ) {
-            this->add_node( CameraNode<FeatureT>( i, "" ) );
-          }
-        }
+  void CameraRelationNetwork<FeatureT>::make_features( ControlNetwork const* cnet,
+                                                       size_t begin, size_t end ) {
+    typedef boost::weak_ptr<FeatureT> w_ptr;
+    for ( size_t i = begin; i < end; i++ ) {
+      const size_t first = m_graph.point_begin( i ), last = m_graph.point_end( i );
+      for ( size_t f = first; f < last; f++ )
+        m_features[f] = f_ptr( new FeatureT( (*cnet)[i][f - first], i ) );
+      for ( size_t f = first; f < last; f++ )
+        for ( size_t g = first; g < last; g++ )
+          if ( g != f )
+            m_features[f]->connection( w_ptr( m_features[g] ), false );
+    }
+  }
 
-        // Appending to list
-        features_added.push_back( f_ptr( new FeatureT(cm, point_id) ) );
-
-        // Attaching to camera node
-        (*this)[cm.image_id()].relations.push_back( features_added.back() );
-      } // End loop through ControlMeasures
-
-      // Doubly Linking features together
-      typedef typename std::vector<f_ptr>::iterator fvi_ptr;
-      for ( fvi_ptr first = features_added.begin();
-            first < features_added.end() - 1; first++ ) {
-        for ( fvi_ptr second = first + 1;
-              second < features_added.end(); second++ ) {
-          (*first)->connection( w_ptr( *second ), false );
-          (*second)->connection( w_ptr( *first ), false );
-        }
+  // Fills the relations and maps of cameras [begin, end) and the maps
+  // of their features. The links come ordered by camera, and each
+  // feature has one link to a camera, so every insert goes at the end
+  // of its map.
+  template <class FeatureT>
+  void CameraRelationNetwork<FeatureT>::link_cameras( size_t begin, size_t end ) {
+    for ( size_t j = begin; j < end; j++ ) {
+      for ( size_t k = m_graph.camera_begin( j ); k < m_graph.camera_end( j ); k++ )
+        m_nodes[j].relations.push_back( m_features[m_graph.camera_feature( k )] );
+      m_nodes[j].map.clear();
+      for ( size_t l = m_graph.link_begin( j ); l < m_graph.link_end( j ); l++ ) {
+        CameraRelationGraph::Link const& link = m_graph.link( l );
+        std::map<size_t, boost::weak_ptr<FeatureT> >& feature_map = m_features[link.feature]->m_map;
+        feature_map.insert( feature_map.end(), std::make_pair( size_t( link.camera ),
+                                                               boost::weak_ptr<FeatureT>( m_features[link.other] ) ) );
+        m_nodes[j].map.insert( m_nodes[j].map.end(),
+                               std::make_pair( size_t( link.camera ), m_features[link.feature] ) );
       }
+    }
+  }
 
-    } // end for through control points
-
-    // setting up maps
-    this->build_map();
+  template <class FeatureT>
+  void CameraRelationNetwork<FeatureT>::read_controlnetwork( ControlNetwork const& cnet,
+                                                             uint32 num_threads ) {
+    num_threads = resolve_threads( num_threads );
+    m_nodes.clear();
+    m_graph.build( cnet, num_threads );
+    for ( size_t j = 0; j < m_graph.num_cameras(); j++ )
+      m_nodes.push_back( cnode( j, "" ) );
+    m_features.assign( m_graph.num_features(), f_ptr() );
+
+    // Each feature is changed only by the range holding its point, and
+    // then by the range holding its camera, so the ranges run in
+    // parallel.
+    for_ranges( m_graph.num_points(), num_threads,
+                boost::bind( &CameraRelationNetwork::make_features, this, &cnet, _1, _2 ) );
+    for_ranges( m_graph.num_cameras(), num_threads,
+                boost::bind( &CameraRelationNetwork::link_cameras, this, _1, _2 ) );
   }
 
   template <class FeatureT>
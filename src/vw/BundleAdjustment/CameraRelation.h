@@ -30,6 +30,11 @@
 /// are also easier to understand at first glance. A control network can
 /// be created from a camera relations network and the opposite is also
 /// true.
+///
+/// Reading a control network first builds a CameraRelationGraph, a
+/// compact copy of the links kept in flat arrays, on several threads.
+/// The features and camera nodes are then filled in from it, and it
+/// stays available for walking the links without chasing pointers.
 
 #ifndef __VW_BUNDLEADJUSTMENT_CAMERA_RELATIONS_H__
 #define __VW_BUNDLEADJUSTMENT_CAMERA_RELATIONS_H__
@@ -39,6 +44,7 @@
 #include <vw/InterestPoint/InterestData.h>
 #include <boost/foreach.hpp>
 #include <map>
+#include <vector>
 
 namespace vw {
 namespace ba {
@@ -168,6 +174,71 @@ namespace ba {
 
   std::ostream& operator<<( std::ostream& os, JFeature const& feat );
 
+  /// The links of a control network in compressed sparse rows. Each
+  /// measure is a feature, numbered in point order, so the features of
+  /// point i are [point_begin(i), point_end(i)) and all of them are
+  /// connected to each other. Each camera lists its features, and its
+  /// links: for each of its features and each other camera seen by
+  /// that feature's point, the feature there it connects to. These
+  /// are the contents of CameraNode::relations, CameraNode::map and
+  /// FeatureBase::m_map.
+  class CameraRelationGraph {
+  public:
+    /// A feature of one camera and the feature of another camera it
+    /// connects to.
+    struct Link {
+      uint32 camera;  ///< The other camera
+      uint32 feature; ///< The feature in this camera
+      uint32 other;   ///< The feature in the other camera
+    };
+
+    CameraRelationGraph() { clear(); }
+
+    /// Build from a control network, splitting the points and then the
+    /// cameras among num_threads threads. Zero means the default
+    /// number of threads.
+    void build( ControlNetwork const& cnet, uint32 num_threads = 0 );
+    void clear();
+
+    size_t num_points  () const { return m_point_offsets.size() - 1; }
+    size_t num_features() const { return m_feature_camera.size(); }
+    size_t num_cameras () const { return m_camera_offsets.size() - 1; }
+
+    /// The features of point i, one for each of its measures in order.
+    size_t point_begin( size_t i ) const { return m_point_offsets[i]; }
+    size_t point_end  ( size_t i ) const { return m_point_offsets[i+1]; }
+
+    uint32 feature_camera( size_t f ) const { return m_feature_camera[f]; }
+    uint32 feature_point ( size_t f ) const { return m_feature_point[f]; }
+
+    /// The features of camera j, in point order, are camera_feature(k)
+    /// for k in [camera_begin(j), camera_end(j)).
+    size_t camera_begin( size_t j ) const { return m_camera_offsets[j]; }
+    size_t camera_end  ( size_t j ) const { return m_camera_offsets[j+1]; }
+    uint32 camera_feature( size_t k ) const { return m_camera_features[k]; }
+
+    /// The links of camera j, ordered by the other camera and then by
+    /// feature, are link(l) for l in [link_begin(j), link_end(j)).
+    size_t link_begin( size_t j ) const { return m_link_offsets[j]; }
+    size_t link_end  ( size_t j ) const { return m_link_offsets[j+1]; }
+    Link const& link( size_t l ) const { return m_links[l]; }
+
+  private:
+    struct Band;
+
+    std::vector<size_t> m_point_offsets;  ///< num_points()+1 entries
+    std::vector<uint32> m_feature_camera;
+    std::vector<uint32> m_feature_point;
+    std::vector<size_t> m_camera_offsets; ///< num_cameras()+1 entries
+    std::vector<uint32> m_camera_features;
+    std::vector<size_t> m_link_offsets;   ///< num_cameras()+1 entries
+    std::vector<Link>   m_links;
+
+    void count_band( ControlNetwork const* cnet, Band* band );
+    void fill_band ( Band* band );
+    void sort_links( size_t begin, size_t end );
+  };
+
   // Camera Relation Class
   template <class FeatureT>
   struct CameraNode {
@@ -197,7 +268,13 @@ namespace ba {
   template <class FeatureT>
   class CameraRelationNetwork {
     typedef CameraNode<FeatureT> cnode;
+    typedef boost::shared_ptr<FeatureT> f_ptr;
     std::vector<cnode> m_nodes; // One for each image/camera instance.
+    CameraRelationGraph m_graph;
+    std::vector<f_ptr>  m_features; // By the feature numbers of m_graph
+
+    void make_features( ControlNetwork const* cnet, size_t begin, size_t end );
+    void link_cameras( size_t begin, size_t end );
 
   public:
 
@@ -214,10 +291,18 @@ namespace ba {
     const_iterator begin() const { return m_nodes.begin(); }
     const_iterator end  () const { return m_nodes.end();   }
 
+    /// The links of the last control network read, on which the nodes
+    /// were built. It is empty if the nodes were added by hand, and is
+    /// not updated if they are changed afterwards.
+    CameraRelationGraph const& graph() const { return m_graph; }
+
+    /// The feature graph() numbers f.
+    f_ptr const& feature( size_t f ) const { return m_features[f]; }
+
     // Complex functions
     void add_node( cnode const& node );
     void build_map();
-    void read_controlnetwork ( ControlNetwork const& cnet );
+    void read_controlnetwork ( ControlNetwork const& cnet, uint32 num_threads = 0 );
     bool write_controlnetwork( ControlNetwork      & cnet ) const;
   };
 
@@ -0,0 +1,85 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CameraSystemSolver.h
+///
+/// Linear solvers for the reduced camera system S * delta_a = e of
+/// the sparse bundle adjusters.  Without one, AdjustSparse and
+/// AdjustRobustSparse solve with an LDL^T decomposition of S in
+/// skyline form.
+///
+#ifndef __VW_BUNDLEADJUSTMENT_CAMERA_SYSTEM_SOLVER_H__
+#define __VW_BUNDLEADJUSTMENT_CAMERA_SYSTEM_SOLVER_H__
+
+#include <vw/Core/Exception.h>
+#include <vw/BundleAdjustment/BlockCholesky.h>
+
+#include <string>
+
+namespace vw {
+namespace ba {
+
+  class SchurOperator;
+
+  /// Interface for solving the reduced camera system.  A solver is
+  /// called once per iteration with a system of the same pattern, so
+  /// it may keep whatever it learned about the pattern.  Solvers throw
+  /// a MathErr when they cannot solve a system, and the adjuster then
+  /// falls back to the skyline solver for that iteration.
+  class CameraSystemSolver {
+  public:
+    virtual ~CameraSystemSolver() {}
+    virtual std::string name() const = 0;
+
+    /// Whether the solver only needs products with S.  Matrix free
+    /// solvers are given a SchurOperator, and S is never formed.
+    virtual bool matrix_free() const { return false; }
+
+    /// Solve S x = e, with S given by the blocks of each camera.
+    virtual Vector<double> solve( SparseBlockRows const& /*S*/, Vector<double> const& /*e*/ ) {
+      vw_throw( NoImplErr() << name() << " solver needs the camera system as an operator." );
+      return Vector<double>();
+    }
+
+    /// Solve S x = e, with S given as an operator.
+    virtual Vector<double> solve( SchurOperator const& /*S*/, Vector<double> const& /*e*/ ) {
+      vw_throw( NoImplErr() << name() << " solver needs the blocks of the camera system." );
+      return Vector<double>();
+    }
+  };
+
+  /// Solves with a BlockSparseCholesky, ordered by minimum degree on
+  /// the camera graph.  The ordering is kept from one call to the next
+  /// while the pattern stays the same.
+  class BlockCholeskySolver : public CameraSystemSolver {
+    BlockSparseCholesky m_cholesky;
+  public:
+    virtual std::string name() const { return "block cholesky"; }
+
+    using CameraSystemSolver::solve;
+    virtual Vector<double> solve( SparseBlockRows const& S, Vector<double> const& e ) {
+      m_cholesky.factor( S );
+      return m_cholesky.solve( e );
+    }
+
+    BlockSparseCholesky const& cholesky() const { return m_cholesky; }
+  };
+
+}} // namespace vw::ba
+
+#endif//__VW_BUNDLEADJUSTMENT_CAMERA_SYSTEM_SOLVER_H__
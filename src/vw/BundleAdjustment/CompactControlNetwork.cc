@@ -0,0 +1,216 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CompactControlNetwork.cc
+///
+
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
+#include <vw/Core/Exception.h>
+
+#include <fstream>
+#include <limits>
+
+namespace vw {
+namespace ba {
+
+uint32 StringTable::intern( std::string const& str ) {
+  std::map<std::string, uint32>::const_iterator it = m_index.find( str );
+  if ( it != m_index.end() )
+    return it->second;
+  uint32 index = uint32( m_strings.size() );
+  m_strings.push_back( str );
+  m_index.insert( std::make_pair( str, index ) );
+  return index;
+}
+
+void CompactControlNetwork::clear() {
+  m_type = ControlNetwork::ImageToImage;
+  m_num_cameras = 0;
+  m_strings.clear();
+  m_point_offsets.assign( 1, 0 );
+  m_point_position.clear();
+  m_point_sigma.clear();
+  m_point_type.clear();
+  m_point_ignore.clear();
+  m_point_id.clear();
+  m_measure_dominant.clear();
+  m_measure_sigma.clear();
+  m_measure_camera.clear();
+  m_measure_point.clear();
+  m_measure_ignore.clear();
+  m_measure_serial.clear();
+  m_camera_offsets.assign( 1, 0 );
+  m_camera_measures.clear();
+}
+
+void CompactControlNetwork::add_point( ControlPoint const& cpoint ) {
+  Vector3 position = cpoint.position(), sigma = cpoint.sigma();
+  for ( size_t k = 0; k < 3; k++ ) {
+    m_point_position.push_back( position[k] );
+    m_point_sigma.push_back( sigma[k] );
+  }
+  m_point_type.push_back( uint8( cpoint.type() ) );
+  m_point_ignore.push_back( cpoint.ignore() );
+  m_point_id.push_back( m_strings.intern( cpoint.id() ) );
+}
+
+void CompactControlNetwork::add_measure( ControlMeasure const& cmeasure, uint32 point ) {
+  VW_ASSERT( cmeasure.image_id() < std::numeric_limits<uint32>::max(),
+             ArgumentErr() << "CompactControlNetwork: Image id " << cmeasure.image_id()
+                           << " is out of range." );
+  Vector2 dominant = cmeasure.dominant(), sigma = cmeasure.sigma();
+  m_measure_dominant.push_back( dominant[0] );
+  m_measure_dominant.push_back( dominant[1] );
+  m_measure_sigma.push_back( float( sigma[0] ) );
+  m_measure_sigma.push_back( float( sigma[1] ) );
+  m_measure_camera.push_back( uint32( cmeasure.image_id() ) );
+  m_measure_point.push_back( point );
+  m_measure_ignore.push_back( cmeasure.ignore() );
+  m_measure_serial.push_back( m_strings.intern( cmeasure.serial() ) );
+  if ( cmeasure.image_id() >= m_num_cameras )
+    m_num_cameras = cmeasure.image_id() + 1;
+}
+
+// Builds the camera index by counting sort of the measures, which
+// leaves the measures of each camera in point order.
+void CompactControlNetwork::finish() {
+  m_camera_offsets.assign( m_num_cameras + 1, 0 );
+  for ( size_t m = 0; m < m_measure_camera.size(); m++ )
+    m_camera_offsets[m_measure_camera[m] + 1]++;
+  for ( size_t j = 0; j < m_num_cameras; j++ )
+    m_camera_offsets[j+1] += m_camera_offsets[j];
+
+  m_camera_measures.resize( m_measure_camera.size() );
+  std::vector<size_t> next( m_camera_offsets.begin(), m_camera_offsets.end() - 1 );
+  for ( size_t m = 0; m < m_measure_camera.size(); m++ )
+    m_camera_measures[next[m_measure_camera[m]]++] = uint32( m );
+}
+
+void CompactControlNetwork::assign( ControlNetwork const& cnet ) {
+  clear();
+  m_type = cnet.type();
+
+  size_t count = 0;
+  for ( size_t i = 0; i < cnet.size(); i++ )
+    count += cnet[i].size();
+  VW_ASSERT( count < std::numeric_limits<uint32>::max(),
+             ArgumentErr() << "CompactControlNetwork: Too many measures." );
+
+  m_point_offsets.reserve( cnet.size() + 1 );
+  m_point_position.reserve( 3*cnet.size() );
+  m_point_sigma.reserve( 3*cnet.size() );
+  m_point_type.reserve( cnet.size() );
+  m_point_ignore.reserve( cnet.size() );
+  m_point_id.reserve( cnet.size() );
+  m_measure_dominant.reserve( 2*count );
+  m_measure_sigma.reserve( 2*count );
+  m_measure_camera.reserve( count );
+  m_measure_point.reserve( count );
+  m_measure_ignore.reserve( count );
+  m_measure_serial.reserve( count );
+
+  for ( size_t i = 0; i < cnet.size(); i++ ) {
+    add_point( cnet[i] );
+    for ( ControlPoint::const_iterator cm = cnet[i].begin(); cm != cnet[i].end(); ++cm )
+      add_measure( *cm, uint32( i ) );
+    m_point_offsets.push_back( m_measure_point.size() );
+  }
+  finish();
+}
+
+// Follows the layout of ControlNetwork::write_binary.  Only one
+// ControlMeasure is ever alive, so the file is never held twice.
+void CompactControlNetwork::read_binary( std::string const& filename ) {
+  std::ifstream f( filename.c_str(), std::ifstream::binary );
+  if ( !f.is_open() )
+    vw_throw( IOErr() << "Failed to open \"" << filename << "\" as a Control Network." );
+
+  clear();
+  std::string header;
+  for ( int s = 0; s < 6; s++ )
+    std::getline( f, header, '\0' );
+  f.read( (char*)&m_type, sizeof(m_type) );
+  int num_points = 0;
+  f.read( (char*)&num_points, sizeof(num_points) );
+  if ( !f || num_points < 0 )
+    vw_throw( IOErr() << "Failed to read the header of \"" << filename << "\"." );
+
+  m_point_offsets.reserve( num_points + 1 );
+  ControlPoint cpoint;
+  ControlMeasure cmeasure;
+  for ( int i = 0; i < num_points; i++ ) {
+    std::string id;
+    bool ignore;
+    Vector3 position, sigma;
+    ControlPoint::ControlPointType type;
+    int num_measures = 0;
+    std::getline( f, id, '\0' );
+    f.read( (char*)&ignore, sizeof(ignore) );
+    for ( size_t k = 0; k < 3; k++ )
+      f.read( (char*)&position[k], sizeof(position[k]) );
+    for ( size_t k = 0; k < 3; k++ )
+      f.read( (char*)&sigma[k], sizeof(sigma[k]) );
+    f.read( (char*)&type, sizeof(type) );
+    f.read( (char*)&num_measures, sizeof(num_measures) );
+
+    cpoint.set_id( id );
+    cpoint.set_ignore( ignore );
+    cpoint.set_position( position );
+    cpoint.set_sigma( sigma );
+    cpoint.set_type( type );
+    add_point( cpoint );
+
+    for ( int m = 0; m < num_measures; m++ ) {
+      cmeasure.read_binary( f );
+      add_measure( cmeasure, uint32( i ) );
+    }
+    if ( !f )
+      vw_throw( IOErr() << "Unexpected end of \"" << filename << "\" in point " << i << "." );
+    m_point_offsets.push_back( m_measure_point.size() );
+  }
+  finish();
+}
+
+size_t CompactControlNetwork::num_ground_control_points() const {
+  if ( m_type != ControlNetwork::ImageToGround )
+    return 0;
+  size_t count = 0;
+  for ( size_t i = 0; i < m_point_type.size(); i++ )
+    if ( m_point_type[i] == ControlPoint::GroundControlPoint )
+      count++;
+  return count;
+}
+
+size_t CompactControlNetwork::memory_usage() const {
+  return m_point_offsets.capacity()    * sizeof(size_t) +
+         m_point_position.capacity()   * sizeof(double) +
+         m_point_sigma.capacity()      * sizeof(double) +
+         m_point_type.capacity()       * sizeof(uint8)  +
+         m_point_ignore.capacity()     * sizeof(uint8)  +
+         m_point_id.capacity()         * sizeof(uint32) +
+         m_measure_dominant.capacity() * sizeof(double) +
+         m_measure_sigma.capacity()    * sizeof(float)  +
+         m_measure_camera.capacity()   * sizeof(uint32) +
+         m_measure_point.capacity()    * sizeof(uint32) +
+         m_measure_ignore.capacity()   * sizeof(uint8)  +
+         m_measure_serial.capacity()   * sizeof(uint32) +
+         m_camera_offsets.capacity()   * sizeof(size_t) +
+         m_camera_measures.capacity()  * sizeof(uint32);
+}
+
+}} // namespace vw::ba
@@ -19,31 +19,94 @@
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/InterestPoint/Matcher.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/DisjointSet.h>
 
 using namespace vw;
 using namespace vw::ba;
 
 #include <boost/filesystem/fstream.hpp>
+#include <boost/unordered_map.hpp>
 
-namespace fs = boost::filesystem;
-
-struct ContainsEqualIP {
-  ip::InterestPoint& m_compare;
-  ContainsEqualIP( ip::InterestPoint& comp ) : m_compare(comp) {}
+#include <algorithm>
+#include <exception>
 
-  bool operator()( boost::shared_ptr<IPFeature> in ) {
-    if (  m_compare.x == in->m_ip.x &&
-          m_compare.y == in->m_ip.y )
-      return true;
-    return false;
-  }
-};
+namespace fs = boost::filesystem;
 
 // Utility for checking that the point is BA safe
 void safe_measurement( ip::InterestPoint& ip ) {
   if ( ip.scale <= 0 ) ip.scale = 10;
 }
 
+namespace {
+
+  // Reads one match file, keeping the first error of any file.
+  class MatchLoadTask : public Task {
+    std::string m_match_file;
+    std::vector<ip::InterestPoint> &m_ip1, &m_ip2;
+    Mutex& m_mutex;
+    std::exception_ptr& m_error;
+  public:
+    MatchLoadTask( std::string const& match_file,
+                   std::vector<ip::InterestPoint>& ip1, std::vector<ip::InterestPoint>& ip2,
+                   Mutex& mutex, std::exception_ptr& error )
+      : m_match_file(match_file), m_ip1(ip1), m_ip2(ip2), m_mutex(mutex), m_error(error) {}
+    virtual void operator()() {
+      try {
+        vw_out(DebugMessage,"ba") << "Loading: " << m_match_file << std::endl;
+        ip::read_binary_match_file( m_match_file, m_ip1, m_ip2 );
+
+        // Remove descriptors from interest points and correct scale
+        std::for_each( m_ip1.begin(), m_ip1.end(), ip::remove_descriptor );
+        std::for_each( m_ip2.begin(), m_ip2.end(), ip::remove_descriptor );
+        std::for_each( m_ip1.begin(), m_ip1.end(), safe_measurement );
+        std::for_each( m_ip2.begin(), m_ip2.end(), safe_measurement );
+      } catch ( ... ) {
+        Mutex::Lock lock( m_mutex );
+        if ( !m_error )
+          m_error = std::current_exception();
+      }
+    }
+  };
+
+  // An interest point of one image, which becomes a measure.
+  struct TrackFeature {
+    uint32 camera;
+    float x, y, scale;
+  };
+
+  struct TrackFeatureCameraLess {
+    std::vector<TrackFeature> const& m_features;
+    TrackFeatureCameraLess( std::vector<TrackFeature> const& features ) : m_features(features) {}
+    bool operator()( size_t a, size_t b ) const {
+      return m_features[a].camera < m_features[b].camera;
+    }
+  };
+
+  // Returns the feature at the location of ip in the image, adding
+  // it if it is new.  Features are equal when their locations are.
+  size_t find_feature( ip::InterestPoint const& ip, size_t camera,
+                       std::vector<boost::unordered_map<std::pair<float,float>, size_t> >& location_index,
+                       std::vector<TrackFeature>& features,
+                       math::DisjointSet<size_t>& tracks,
+                       std::vector<math::DisjointSet<size_t>::Elem>& feature_elems ) {
+    std::pair<boost::unordered_map<std::pair<float,float>, size_t>::iterator, bool> result =
+      location_index[camera].insert( std::make_pair( std::make_pair( ip.x, ip.y ), features.size() ) );
+    if ( result.second ) {
+      TrackFeature feature;
+      feature.camera = uint32( camera );
+      feature.x      = ip.x;
+      feature.y      = ip.y;
+      feature.scale  = ip.scale;
+      feature_elems.push_back( tracks.insert( features.size() ) );
+      features.push_back( feature );
+    }
+    return result.first->second;
+  }
+
+} // anonymous namespace
+
 double vw::ba::triangulate_control_point( ControlPoint& cp,
                                           std::vector<boost::shared_ptr<camera::CameraModel> >
                                           const& camera_models,
@@ -136,13 +199,12 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
   // We can't guarantee that image_files is sorted, so we make a
   // std::map to give ourselves a sorted list and access to a binary search.
   std::map<std::string,size_t> image_prefix_map;
+  if ( image_files.empty() )
+    vw_throw( ArgumentErr() << "build_control_network: No images were given." );
   size_t count = 0;
-  ba::CameraRelationNetwork<ba::IPFeature> crn;
   BOOST_FOREACH( std::string const& file, image_files ) {
     fs::path file_path(file);
     image_prefix_map[file_path.replace_extension().string()] = count;
-    crn.add_node( ba::CameraNode<ba::IPFeature>( count,
-                                                 file_path.stem().string() ) );
     cnet.add_image_name(file);
     count++;
   }
@@ -186,67 +248,64 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
     }
   }
 
-  // Loop through the match files...
+  // Loading the match files in parallel ...
+  std::vector<std::vector<ip::InterestPoint> > ip1_vec( match_files_vec.size() ),
+                                               ip2_vec( match_files_vec.size() );
+  {
+    Mutex mutex;
+    std::exception_ptr error;
+    {
+      FifoWorkQueue queue( vw_settings().default_num_threads() );
+      for (size_t file_iter = 0; file_iter < match_files_vec.size(); file_iter++)
+        queue.add_task( boost::shared_ptr<Task>(
+          new MatchLoadTask( match_files_vec[file_iter], ip1_vec[file_iter],
+                             ip2_vec[file_iter], mutex, error ) ) );
+      queue.join_all();
+    }
+    if ( error )
+      std::rethrow_exception( error );
+  }
+
+  // ... and merging them in order, so the network does not depend on
+  // which file finished loading first.  Each distinct interest point
+  // of an image is a feature, found through a hash of its location,
+  // and the features of a match are joined into one track.
+  typedef math::DisjointSet<size_t> TrackSet;
+  typedef boost::unordered_map<std::pair<float,float>, size_t> LocationIndex;
+  TrackSet tracks;
+  std::vector<TrackSet::Elem> feature_elems;
+  std::vector<TrackFeature> features;
+  std::vector<LocationIndex> location_index( image_files.size() );
+
   size_t num_load_rejected = 0, num_loaded = 0;
+  vw_out() << "Building the control network.\n";
+  TerminalProgressCallback progress("ba", "Building: ");
+  progress.report_progress(0);
   for (size_t file_iter = 0; file_iter < match_files_vec.size(); file_iter++){
-    std::string match_file = match_files_vec[file_iter];
-    size_t index1 = index1_vec[file_iter];
-    size_t index2 = index2_vec[file_iter];
-
-    // Actually read in the file as it seems we've found something correct
     std::vector<ip::InterestPoint> ip1, ip2;
-    vw_out(DebugMessage,"ba") << "Loading: " << match_file << std::endl;
-    ip::read_binary_match_file( match_file, ip1, ip2 );
+    ip1.swap( ip1_vec[file_iter] );
+    ip2.swap( ip2_vec[file_iter] );
     if ( ip1.size() < min_matches ) {
-      vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
+      vw_out(DebugMessage,"ba") << "\t" << match_files_vec[file_iter] << "    "
                                 << ip1.size() << " matches. [rejected]\n";
       num_load_rejected += ip1.size();
       continue;
     }
-    vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
+    vw_out(DebugMessage,"ba") << "\t" << match_files_vec[file_iter] << "    "
                               << ip1.size() << " matches.\n";
     num_loaded += ip1.size();
 
-    // Remove descriptors from interest points and correct scale
-    std::for_each( ip1.begin(), ip1.end(), ip::remove_descriptor );
-    std::for_each( ip2.begin(), ip2.end(), ip::remove_descriptor );
-    std::for_each( ip1.begin(), ip1.end(), safe_measurement );
-    std::for_each( ip2.begin(), ip2.end(), safe_measurement );
-
-    typedef boost::shared_ptr< ba::IPFeature > f_ptr;
-    typedef std::list< f_ptr >::iterator f_itr;
-
-    // Checking to see if features already exist, adding if they
-    // don't, then linking them.
-    vw_out() << "Building the control network for " << match_file <<".\n";
-    TerminalProgressCallback progress("ba", "Building: ");
-    progress.report_progress(0);
-    double inc_prog = 1.0/double(ip1.size());
-    for ( size_t k = 0; k < ip1.size(); k++ ) { // Loop through all existing IP
-      // Check if either IP is already in the lists
-      f_itr ipfeature1 = std::find_if( crn[index1].begin(),
-                                       crn[index1].end(),
-                                       ContainsEqualIP( ip1[k] ) );
-      f_itr ipfeature2 = std::find_if( crn[index2].begin(),
-                                       crn[index2].end(),
-                                       ContainsEqualIP( ip2[k] ) );
-      // If the IP are new, add them to the list
-      if ( ipfeature1 == crn[index1].end() ) {
-        crn[index1].relations.push_front( f_ptr( new ba::IPFeature( ip1[k], index1 ) ) );
-        ipfeature1 = crn[index1].begin();
-      }
-      if ( ipfeature2 == crn[index2].end() ) {
-        crn[index2].relations.push_front( f_ptr( new ba::IPFeature( ip2[k], index2 ) ) );
-        ipfeature2 = crn[index2].begin();
-      }
-
-      // Doubly linking
-      (*ipfeature1)->connection( *ipfeature2, false );
-      (*ipfeature2)->connection( *ipfeature1, false );
-      progress.report_incremental_progress(inc_prog );
-    } // End loop through ip1
-    progress.report_finished();
+    for ( size_t k = 0; k < ip1.size(); k++ ) {
+      size_t feature1 = find_feature( ip1[k], index1_vec[file_iter], location_index,
+                                      features, tracks, feature_elems );
+      size_t feature2 = find_feature( ip2[k], index2_vec[file_iter], location_index,
+                                      features, tracks, feature_elems );
+      tracks.combine( tracks.find( feature_elems[feature1] ),
+                      tracks.find( feature_elems[feature2] ) );
+    }
+    progress.report_progress( double(file_iter+1) / double(match_files_vec.size()) );
   } // End loop through match files
+  progress.report_finished();
 
   if ( num_load_rejected != 0 ) {
     vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
@@ -256,8 +315,51 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
     vw_out(WarningMessage,"ba") << "\tLoaded " << num_loaded << " matches.\n";
   }
 
-  // Building control network
-  bool success = crn.write_controlnetwork( cnet );
+  // Building control network, one control point per track.  Tracks
+  // are numbered in the order of their first feature.
+  boost::unordered_map<TrackSet::Set, size_t> track_index;
+  std::vector<std::vector<size_t> > track_features;
+  for ( size_t f = 0; f < features.size(); f++ ) {
+    TrackSet::Set root = tracks.find( feature_elems[f] );
+    boost::unordered_map<TrackSet::Set, size_t>::iterator it = track_index.find( root );
+    if ( it == track_index.end() ) {
+      it = track_index.insert( std::make_pair( root, track_features.size() ) ).first;
+      track_features.push_back( std::vector<size_t>() );
+    }
+    track_features[it->second].push_back( f );
+  }
+
+  // Tracks that see an image twice are 'spiral' errors, and are
+  // dropped.
+  int spiral_error_count = 0;
+  for ( size_t t = 0; t < track_features.size(); t++ ) {
+    std::vector<size_t>& track = track_features[t];
+    std::sort( track.begin(), track.end(), TrackFeatureCameraLess( features ) );
+    bool spiral = false;
+    for ( size_t m = 1; m < track.size(); m++ )
+      if ( features[track[m]].camera == features[track[m-1]].camera )
+        spiral = true;
+    if ( spiral ) {
+      spiral_error_count++;
+      continue;
+    }
+
+    ControlPoint cpoint( ControlPoint::TiePoint );
+    for ( size_t m = 0; m < track.size(); m++ ) {
+      TrackFeature const& feature = features[track[m]];
+      cpoint.add_measure( ControlMeasure( feature.x, feature.y, feature.scale,
+                                          feature.scale, feature.camera ) );
+    }
+    cnet.add_control_point( cpoint );
+  }
+  if ( spiral_error_count != 0 )
+    vw_out(WarningMessage,"ba") << "\t" << spiral_error_count
+                                << " control points removed due to spiral errors.\n";
+
+  bool success = cnet.size() != 0;
+  if ( !success )
+    vw_out(WarningMessage,"ba")
+      << "Failed to load any points, control network is empty.";
 
   // Triangulating Positions
   if (triangulate_control_points){
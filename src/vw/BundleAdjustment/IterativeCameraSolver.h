@@ -0,0 +1,99 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file IterativeCameraSolver.h
+///
+/// A matrix free solver of the reduced camera system, for networks
+/// too large to factor.
+///
+#ifndef __VW_BUNDLEADJUSTMENT_ITERATIVE_CAMERA_SOLVER_H__
+#define __VW_BUNDLEADJUSTMENT_ITERATIVE_CAMERA_SOLVER_H__
+
+#include <vw/Math/ConjugateGradient.h>
+#include <vw/BundleAdjustment/CameraSystemSolver.h>
+#include <vw/BundleAdjustment/SchurComplement.h>
+
+namespace vw {
+namespace ba {
+
+  /// Solves the camera system by conjugate gradients on products with
+  /// a SchurOperator, preconditioned by the inverses of the diagonal
+  /// blocks of S.  S is never formed, so memory grows with the number
+  /// of measures rather than with the fill-in of S.
+  ///
+  /// The steps are inexact, truncated Newton steps.  CG stops once the
+  /// residual is below eta * |e|, where the forcing term
+  /// eta = min(max_forcing, |e| / |e_0|) tightens as the gradient e
+  /// shrinks from the first call, or when Nash's rule finds that the
+  /// quadratic model has stopped improving.
+  class PCGCameraSolver : public CameraSystemSolver {
+    int    m_max_iterations;
+    double m_max_forcing, m_model_tolerance;
+    double m_initial_norm;
+    int    m_last_iterations;
+
+    class BlockJacobi {
+      std::vector<Matrix<double> > const& m_inverses;
+    public:
+      BlockJacobi( std::vector<Matrix<double> > const& inverses ) : m_inverses( inverses ) {}
+      void operator()( Vector<double> const& r, Vector<double>& z ) const {
+        const size_t nc = m_inverses.empty() ? 0 : m_inverses[0].rows();
+        for ( size_t j = 0; j < m_inverses.size(); j++ )
+          subvector( z, j*nc, nc ) = m_inverses[j] * subvector( r, j*nc, nc );
+      }
+    };
+
+  public:
+    PCGCameraSolver( int max_iterations = 500, double max_forcing = 0.1,
+                     double model_tolerance = 0.1 )
+      : m_max_iterations( max_iterations ), m_max_forcing( max_forcing ),
+        m_model_tolerance( model_tolerance ), m_initial_norm( 0 ), m_last_iterations( 0 ) {}
+
+    virtual std::string name() const { return "pcg"; }
+    virtual bool matrix_free() const { return true; }
+
+    using CameraSystemSolver::solve;
+    virtual Vector<double> solve( SchurOperator const& S, Vector<double> const& e ) {
+      std::vector<Matrix<double> > inverses;
+      S.diagonal_blocks( inverses );
+      for ( size_t j = 0; j < inverses.size(); j++ ) {
+        if ( chol_inverse( inverses[j] ) == 0 )
+          vw_throw( MathErr() << "PCGCameraSolver: Diagonal block " << j
+                              << " is not positive definite." );
+        inverses[j] = transpose( inverses[j] ) * inverses[j];
+      }
+
+      const double norm = norm_2( e );
+      if ( m_initial_norm == 0 )
+        m_initial_norm = norm;
+      const double forcing = m_initial_norm > 0 ? std::min( m_max_forcing, norm / m_initial_norm ) : m_max_forcing;
+
+      Vector<double> x;
+      m_last_iterations = math::preconditioned_conjugate_gradient( S, BlockJacobi( inverses ), e, x,
+                                                                   forcing, m_max_iterations,
+                                                                   m_model_tolerance );
+      return x;
+    }
+
+    /// The number of CG iterations of the last solve.
+    int last_iterations() const { return m_last_iterations; }
+  };
+
+}} // namespace vw::ba
+
+#endif//__VW_BUNDLEADJUSTMENT_ITERATIVE_CAMERA_SOLVER_H__
@@ -26,6 +26,7 @@
 
 // Standard
 #include <string>
+#include <vector>
 
 // Vision Workbench
 #include <vw/Math/Matrix.h>
@@ -64,6 +65,42 @@ namespace ba {
       return impl().cam_pixel(i,j,cam_j,point_i);
     }
 
+    /// Project the points point_ids, with parameters points, into
+    /// camera j.  valid[k] is zero where point k does not project, and
+    /// pixels[k] is then left as zero.  Models whose cameras can
+    /// project many points at once, for example with
+    /// camera::CameraModel::points_to_pixels(), hide this to do so.
+    void cam_pixels ( size_t j, Vector<double,camera_params_n> const& cam_j,
+                      std::vector<size_t> const& point_ids,
+                      std::vector<Vector<double,point_params_n> > const& points,
+                      std::vector<Vector2>& pixels, std::vector<uint8>& valid ) {
+      pixels.assign( point_ids.size(), Vector2() );
+      valid.assign( point_ids.size(), 0 );
+      for ( size_t k = 0; k < point_ids.size(); k++ ) {
+        try {
+          pixels[k] = impl().cam_pixel( point_ids[k], j, cam_j, points[k] );
+          valid[k] = 1;
+        } catch (const camera::PointToPixelErr& e) {}
+      }
+    }
+
+    /// Models which can work out their jacobians exactly, for example
+    /// with camera::PinholeModel::point_to_pixel_jacobian(), hide these
+    /// to fill in J and return true.  Otherwise cam_jacobian() and
+    /// point_jacobian() fall back to finite differences.
+    bool analytic_cam_jacobian ( size_t /*i*/, size_t /*j*/,
+                                 Vector<double, CameraParamsN> const& /*cam_j*/,
+                                 Vector<double, PointParamsN>  const& /*point_i*/,
+                                 Matrix<double, 2, CameraParamsN>   & /*J*/ ) {
+      return false;
+    }
+    bool analytic_point_jacobian ( size_t /*i*/, size_t /*j*/,
+                                   Vector<double, CameraParamsN> const& /*cam_j*/,
+                                   Vector<double, PointParamsN>  const& /*point_i*/,
+                                   Matrix<double, 2, PointParamsN>    & /*J*/ ) {
+      return false;
+    }
+
     // Approximate the jacobian for small variations in the cam_j
     // parameters (camera parameters).
     inline Matrix<double, 2, CameraParamsN> cam_jacobian ( size_t i, size_t j,
@@ -73,6 +110,13 @@ namespace ba {
       // Jacobian is #outputs x #params
       Matrix<double, 2, CameraParamsN> J;
 
+      try {
+        if (impl().analytic_cam_jacobian(i,j,cam_j,point_i,J))
+          return J;
+      } catch (const camera::PointToPixelErr& e) {
+        return Matrix<double, 2, CameraParamsN>();
+      }
+
       Vector2 h0;
       try {
         // Get nominal function value
@@ -113,6 +157,13 @@ namespace ba {
       // Jacobian is #outputs x #params
       Matrix<double, 2, PointParamsN> J;
 
+      try {
+        if (impl().analytic_point_jacobian(i,j,cam_j,point_i,J))
+          return J;
+      } catch (const camera::PointToPixelErr& e) {
+        return Matrix<double, 2, PointParamsN>();
+      }
+
       Vector2 h0;
       try {
         // Get nominal function value
@@ -0,0 +1,346 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SchurComplement.h
+///
+/// The steps of the sparse bundle adjusters which reduce the normal
+/// equations to the camera system S * delta_a = e, run on a thread
+/// pool.  The points are split into ranges for inverting the V
+/// blocks, and the cameras into ranges for the Y blocks, e and S.
+/// Every block of S belongs to the row of one camera, so the ranges
+/// never write the same block and the results match a serial pass.
+/// The blocks of S are kept as SparseBlockRows, from which they are
+/// loaded into a skyline matrix or handed to a CameraSystemSolver.
+///
+#ifndef __VW_BUNDLEADJUSTMENT_SCHUR_COMPLEMENT_H__
+#define __VW_BUNDLEADJUSTMENT_SCHUR_COMPLEMENT_H__
+
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/BundleAdjustment/AdjustBase.h>
+#include <vw/BundleAdjustment/BlockCholesky.h>
+#include <vw/BundleAdjustment/CameraRelation.h>
+
+#include <exception>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+
+namespace vw {
+namespace ba {
+
+  namespace detail {
+
+    /// Runs a function over one range of indices, keeping the first
+    /// error thrown by any range.
+    class SchurRangeTask : public Task {
+      boost::function<void(size_t, size_t)> m_func;
+      size_t m_begin, m_end;
+      Mutex& m_mutex;
+      std::exception_ptr& m_error;
+    public:
+      SchurRangeTask( boost::function<void(size_t, size_t)> const& func, size_t begin, size_t end,
+                      Mutex& mutex, std::exception_ptr& error )
+        : m_func(func), m_begin(begin), m_end(end), m_mutex(mutex), m_error(error) {}
+      virtual void operator()() {
+        try {
+          m_func( m_begin, m_end );
+        } catch ( ... ) {
+          Mutex::Lock lock( m_mutex );
+          if ( !m_error )
+            m_error = std::current_exception();
+        }
+      }
+    };
+
+    /// Calls func(begin, end) over [0, size) split into about four
+    /// ranges per thread, and rethrows the first error.
+    inline void schur_for_ranges( size_t size, uint32 num_threads,
+                                  boost::function<void(size_t, size_t)> const& func ) {
+      if ( num_threads == 0 )
+        num_threads = vw_settings().default_num_threads();
+      if ( num_threads <= 1 || size < 2 ) {
+        func( 0, size );
+        return;
+      }
+      const size_t range = std::max( size_t(1), size / (4*num_threads) );
+      Mutex mutex;
+      std::exception_ptr error;
+      {
+        FifoWorkQueue queue( num_threads );
+        for ( size_t begin = 0; begin < size; begin += range )
+          queue.add_task( boost::shared_ptr<Task>(
+            new SchurRangeTask( func, begin, std::min( begin + range, size ), mutex, error ) ) );
+        queue.join_all();
+      }
+      if ( error )
+        std::rethrow_exception( error );
+    }
+
+    template <class MatrixPointT>
+    void schur_invert_points( std::vector<MatrixPointT> const* V,
+                              std::vector<MatrixPointT>* V_inverse,
+                              size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        Matrix<double> V_temp = (*V)[i];
+        chol_inverse( V_temp );
+        (*V_inverse)[i] = transpose(V_temp)*V_temp;
+      }
+    }
+
+    template <class VectorPointT, class MatrixPointT>
+    void schur_compute_y( CameraRelationNetwork<JFeature>* crn,
+                          std::vector<MatrixPointT> const* V_inverse,
+                          std::vector<VectorPointT> const* epsilon_b,
+                          Vector<double>* e, size_t num_cam_params,
+                          size_t begin, size_t end ) {
+      typedef CameraNode<JFeature>::iterator crn_iter;
+      for ( size_t j = begin; j < end; j++ ) {
+        for ( crn_iter fiter = (*crn)[j].begin();
+              fiter != (*crn)[j].end(); fiter++ ) {
+          size_t i = (**fiter).m_point_id;
+          // Compute the blocks of Y
+          (**fiter).m_y = (**fiter).m_w * (*V_inverse)[i];
+          // Flatten the block structure to compute 'e'
+          subvector(*e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
+            * (*epsilon_b)[i];
+        }
+      }
+    }
+
+    /// Computes the blocks of S in the rows of cameras [begin, end):
+    /// the diagonal, then the off diagonal blocks S_jk for k > j.
+    template <class MatrixCameraT>
+    void schur_build_rows( CameraRelationNetwork<JFeature>* crn,
+                           std::vector<MatrixCameraT> const* U,
+                           SparseBlockRows* blocks,
+                           size_t begin, size_t end ) {
+      typedef CameraNode<JFeature>::iterator crn_iter;
+      typedef boost::shared_ptr<JFeature> f_ptr;
+      typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
+      for ( size_t j = begin; j < end; j++ ) {
+        SparseBlockRows::value_type& row = (*blocks)[j];
+        row.clear();
+
+        // Filling in diagonal, across all features seen by the camera
+        MatrixCameraT S_jj;
+        for ( crn_iter fiter = (*crn)[j].begin();
+              fiter != (*crn)[j].end(); fiter++ )
+          S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
+        S_jj += (*U)[j];
+        row.push_back( std::make_pair( j, Matrix<double>( S_jj ) ) );
+
+        // Filling in off diagonal.  The links of camera j are ordered
+        // by the cameras they connect to, so only the cameras actually
+        // connected to j are visited.  The graph holds them in flat
+        // arrays; a network built by hand only has its maps.
+        CameraRelationGraph const& graph = crn->graph();
+        if ( graph.num_cameras() == crn->size() && graph.num_features() > 0 ) {
+          size_t l = graph.link_begin( j );
+          while ( l < graph.link_end( j ) && graph.link( l ).camera <= j )
+            l++;
+          while ( l < graph.link_end( j ) ) {
+            const size_t k = graph.link( l ).camera;
+            MatrixCameraT S_jk;
+            for ( ; l < graph.link_end( j ) && graph.link( l ).camera == k; l++ )
+              S_jk -= crn->feature( graph.link( l ).feature )->m_y *
+                transpose( crn->feature( graph.link( l ).other )->m_w );
+            row.push_back( std::make_pair( k, Matrix<double>( S_jk ) ) );
+          }
+          continue;
+        }
+        std::multimap< size_t, f_ptr >& links = (*crn)[j].map;
+        mm_iterator f_j_iter = links.upper_bound( j );
+        while ( f_j_iter != links.end() ) {
+          const size_t k = f_j_iter->first;
+          MatrixCameraT S_jk;
+          for ( ; f_j_iter != links.end() && f_j_iter->first == k; f_j_iter++ ) {
+            boost::weak_ptr<JFeature> f_k = f_j_iter->second->m_map.find( k )->second;
+            S_jk -= f_j_iter->second->m_y * transpose( f_k.lock()->m_w );
+          }
+          row.push_back( std::make_pair( k, Matrix<double>( S_jk ) ) );
+        }
+      }
+    }
+
+  } // namespace detail
+
+  /// V_inverse[i] = V[i]^-1 for every point.
+  template <class MatrixPointT>
+  void schur_invert_points( std::vector<MatrixPointT> const& V,
+                            std::vector<MatrixPointT>& V_inverse,
+                            uint32 num_threads = 0 ) {
+    detail::schur_for_ranges( V.size(), num_threads,
+                              boost::bind( &detail::schur_invert_points<MatrixPointT>,
+                                           &V, &V_inverse, _1, _2 ) );
+  }
+
+  /// Sets Y_ij = W_ij * V_i^-1 in every feature, and subtracts
+  /// Y_ij * epsilon_b_i from the block of e of camera j.
+  template <class VectorPointT, class MatrixPointT>
+  void schur_compute_y( CameraRelationNetwork<JFeature>& crn,
+                        std::vector<MatrixPointT> const& V_inverse,
+                        std::vector<VectorPointT> const& epsilon_b,
+                        Vector<double>& e, size_t num_cam_params,
+                        uint32 num_threads = 0 ) {
+    detail::schur_for_ranges( crn.size(), num_threads,
+                              boost::bind( &detail::schur_compute_y<VectorPointT, MatrixPointT>,
+                                           &crn, &V_inverse, &epsilon_b, &e, num_cam_params,
+                                           _1, _2 ) );
+  }
+
+  /// Computes the blocks of the reduced camera system S from U and
+  /// the W and Y blocks of the features: rows[j] gets the diagonal
+  /// block S_jj first, then S_jk for each camera k > j linked to j.
+  template <class MatrixCameraT>
+  void schur_build_blocks( CameraRelationNetwork<JFeature>& crn,
+                           std::vector<MatrixCameraT> const& U,
+                           SparseBlockRows& rows, uint32 num_threads = 0 ) {
+    rows.assign( crn.size(), SparseBlockRows::value_type() );
+    detail::schur_for_ranges( crn.size(), num_threads,
+                              boost::bind( &detail::schur_build_rows<MatrixCameraT>,
+                                           &crn, &U, &rows, _1, _2 ) );
+  }
+
+  /// Loads the blocks of S into the lower triangle of a skyline
+  /// matrix, such as a math::MatrixSparseSkyline<double>.
+  template <class SkylineT>
+  void schur_load_skyline( SparseBlockRows const& rows, SkylineT& S ) {
+    for ( size_t j = 0; j < rows.size(); j++ ) {
+      // Loading the diagonal, transposed
+      Matrix<double> const& S_jj = rows[j][0].second;
+      const size_t num_cam_params = S_jj.rows();
+      size_t offset = j * num_cam_params;
+      for ( size_t aa = 0; aa < num_cam_params; aa++ )
+        for ( size_t bb = aa; bb < num_cam_params; bb++ )
+          S( offset+bb, offset+aa ) = S_jj(aa,bb);
+
+      // - if it seems we are loading in oddly, it's because the sparse
+      //   matrix is row major.
+      for ( size_t b = 1; b < rows[j].size(); b++ )
+        submatrix( S, rows[j][b].first*num_cam_params, j*num_cam_params,
+                   num_cam_params, num_cam_params ) = transpose(rows[j][b].second);
+    }
+  }
+
+  /// Products with the reduced camera system S = U - W V^-1 W^T,
+  /// from U and the W and Y blocks of the features, without forming
+  /// S.  It needs no memory beyond the features, so it grows with the
+  /// number of measures rather than with the links between cameras.
+  class SchurOperator {
+    CameraRelationNetwork<JFeature>* m_crn;
+    std::vector<Matrix<double> > m_U;
+    size_t m_num_points;
+    uint32 m_num_threads;
+
+    // y_j = U_j x_j - sum Y_ij t_i over the cameras [begin, end)
+    void apply_rows( Vector<double> const* x, std::vector<double> const* t, size_t point_params,
+                     Vector<double>* y, size_t begin, size_t end ) const {
+      typedef CameraNode<JFeature>::iterator crn_iter;
+      const size_t nc = block_size();
+      for ( size_t j = begin; j < end; j++ ) {
+        for ( size_t r = 0; r < nc; r++ ) {
+          double sum = 0;
+          for ( size_t c = 0; c < nc; c++ )
+            sum += m_U[j](r,c) * (*x)[j*nc+c];
+          (*y)[j*nc+r] = sum;
+        }
+        for ( crn_iter fiter = (*m_crn)[j].begin();
+              fiter != (*m_crn)[j].end(); fiter++ ) {
+          Matrix<double> const& Y = (**fiter).m_y;
+          const double* t_i = &(*t)[(**fiter).m_point_id*point_params];
+          for ( size_t r = 0; r < nc; r++ ) {
+            double sum = 0;
+            for ( size_t p = 0; p < point_params; p++ )
+              sum += Y(r,p) * t_i[p];
+            (*y)[j*nc+r] -= sum;
+          }
+        }
+      }
+    }
+
+    void diagonal_rows( std::vector<Matrix<double> >* blocks, size_t begin, size_t end ) const {
+      typedef CameraNode<JFeature>::iterator crn_iter;
+      for ( size_t j = begin; j < end; j++ ) {
+        Matrix<double> S_jj = m_U[j];
+        for ( crn_iter fiter = (*m_crn)[j].begin();
+              fiter != (*m_crn)[j].end(); fiter++ )
+          S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
+        (*blocks)[j] = S_jj;
+      }
+    }
+
+  public:
+    template <class MatrixCameraT>
+    SchurOperator( CameraRelationNetwork<JFeature>& crn, std::vector<MatrixCameraT> const& U,
+                   size_t num_points, uint32 num_threads = 0 )
+      : m_crn( &crn ), m_U( U.begin(), U.end() ), m_num_points( num_points ),
+        m_num_threads( num_threads ) {}
+
+    size_t num_cameras() const { return m_U.size(); }
+    size_t block_size() const { return m_U.empty() ? 0 : m_U[0].rows(); }
+
+    /// y = S x.  The products with W^T are gathered by point first,
+    /// then the cameras are done in parallel.
+    void operator()( Vector<double> const& x, Vector<double>& y ) const {
+      typedef CameraNode<JFeature>::iterator crn_iter;
+      const size_t nc = block_size();
+      VW_ASSERT( x.size() == num_cameras()*nc,
+                 ArgumentErr() << "SchurOperator: Expected a vector of size "
+                               << num_cameras()*nc << ", not " << x.size() << "." );
+      if ( y.size() != x.size() )
+        y = Vector<double>( x.size() );
+
+      // t_i = sum W_ij^T x_j
+      size_t point_params = 0;
+      std::vector<double> t;
+      for ( size_t j = 0; j < num_cameras(); j++ ) {
+        for ( crn_iter fiter = (*m_crn)[j].begin();
+              fiter != (*m_crn)[j].end(); fiter++ ) {
+          Matrix<double> const& W = (**fiter).m_w;
+          if ( t.empty() ) {
+            point_params = W.cols();
+            t.resize( m_num_points*point_params, 0.0 );
+          }
+          double* t_i = &t[(**fiter).m_point_id*point_params];
+          for ( size_t p = 0; p < point_params; p++ )
+            for ( size_t c = 0; c < nc; c++ )
+              t_i[p] += W(c,p) * x[j*nc+c];
+        }
+      }
+
+      detail::schur_for_ranges( num_cameras(), m_num_threads,
+                                boost::bind( &SchurOperator::apply_rows, this, &x, &t,
+                                             point_params, &y, _1, _2 ) );
+    }
+
+    /// The diagonal blocks S_jj of each camera.
+    void diagonal_blocks( std::vector<Matrix<double> >& blocks ) const {
+      blocks.resize( num_cameras() );
+      detail::schur_for_ranges( num_cameras(), m_num_threads,
+                                boost::bind( &SchurOperator::diagonal_rows, this, &blocks, _1, _2 ) );
+    }
+  };
+
+}} // namespace vw::ba
+
+#endif//__VW_BUNDLEADJUSTMENT_SCHUR_COMPLEMENT_H__
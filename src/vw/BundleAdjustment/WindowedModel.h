@@ -0,0 +1,241 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file WindowedModel.h
+///
+/// Incremental bundle adjustment, for networks that grow one image at
+/// a time.  Rather than adjusting the whole network after each new
+/// image, only a window of cameras is adjusted, along with the points
+/// they see.  The cost of a step then depends on the size of the
+/// window and not on the size of the network.
+///
+/// The other cameras that see those points are anchors.  They stay in
+/// the problem, so their measures still constrain the points, but they
+/// are held near their current values by a stiff prior.
+///
+#ifndef __VW_BUNDLEADJUSTMENT_WINDOWED_MODEL_H__
+#define __VW_BUNDLEADJUSTMENT_WINDOWED_MODEL_H__
+
+#include <vw/BundleAdjustment/ModelBase.h>
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace vw {
+namespace ba {
+
+  /// The cameras within depth steps of the seed cameras in the graph
+  /// where two cameras are adjacent if they see a common point,
+  /// nearest first, stopping at max_cameras.  With a depth of one and
+  /// the newest image as the seed, this is the neighborhood a new
+  /// image disturbs.
+  inline std::vector<size_t> camera_neighborhood( CompactControlNetwork const& network,
+                                                  std::vector<size_t> const& seeds,
+                                                  size_t depth, size_t max_cameras ) {
+    std::vector<size_t> result;
+    std::vector<uint8> visited( network.num_cameras(), 0 );
+    for ( size_t s = 0; s < seeds.size() && result.size() < max_cameras; s++ )
+      if ( seeds[s] < visited.size() && !visited[seeds[s]] ) {
+        visited[seeds[s]] = 1;
+        result.push_back( seeds[s] );
+      }
+
+    size_t begin = 0;
+    for ( size_t level = 0; level < depth && result.size() < max_cameras; level++ ) {
+      const size_t end = result.size();
+      for ( size_t c = begin; c < end && result.size() < max_cameras; c++ ) {
+        const size_t j = result[c];
+        for ( size_t k = network.camera_begin(j); k < network.camera_end(j); k++ ) {
+          const size_t i = network.measure_point( network.camera_measure(k) );
+          for ( size_t m = network.point_begin(i); m < network.point_end(i); m++ ) {
+            const size_t other = network.measure_camera(m);
+            if ( !visited[other] && result.size() < max_cameras ) {
+              visited[other] = 1;
+              result.push_back( other );
+            }
+          }
+        }
+      }
+      begin = end;
+    }
+    return result;
+  }
+
+  /// A bundle adjustment model made of a window of the cameras of
+  /// another model, the points they see, and the anchor cameras that
+  /// also see those points.  Parameters are read from and written to
+  /// the underlying model, so running any adjuster on a
+  /// WindowedModel refines that window of the full model in place.
+  ///
+  /// The anchors' targets are their parameters when the window is
+  /// made, and their inverse covariances are those of the full model
+  /// times anchor_weight.  This is a fixed prior standing in for the
+  /// rest of the network, not an exact marginalization of it.  The
+  /// adjuster must use the camera constraint for the anchors to hold.
+  template <class ModelT>
+  class WindowedModel : public ModelBase<WindowedModel<ModelT>,
+                                         ModelT::camera_params_n, ModelT::point_params_n> {
+  public:
+    typedef Vector<double, ModelT::camera_params_n> camera_vector;
+    typedef Vector<double, ModelT::point_params_n>  point_vector;
+    typedef Matrix<double, ModelT::camera_params_n, ModelT::camera_params_n> camera_matrix;
+    typedef Matrix<double, ModelT::point_params_n, ModelT::point_params_n>   point_matrix;
+
+    /// network must be the compact form of model's control network.
+    /// Building the window only touches the measures of the window
+    /// cameras and of the points they see.
+    WindowedModel( ModelT& model, CompactControlNetwork const& network,
+                   std::vector<size_t> const& window, double anchor_weight = 1e6 )
+      : m_model( model ), m_anchor_weight( anchor_weight ), m_num_measures( 0 ) {
+
+      std::set<size_t> window_set;
+      for ( size_t c = 0; c < window.size(); c++ ) {
+        VW_ASSERT( window[c] < network.num_cameras(),
+                   ArgumentErr() << "WindowedModel: Camera " << window[c]
+                                 << " is not in the network." );
+        if ( window_set.insert( window[c] ).second )
+          m_cameras.push_back( window[c] );
+      }
+      m_num_window = m_cameras.size();
+
+      // The points seen by the window, in network order.
+      std::set<size_t> point_set;
+      for ( size_t c = 0; c < m_num_window; c++ )
+        for ( size_t k = network.camera_begin( m_cameras[c] );
+              k < network.camera_end( m_cameras[c] ); k++ )
+          point_set.insert( network.measure_point( network.camera_measure(k) ) );
+      m_points.assign( point_set.begin(), point_set.end() );
+
+      // The anchors, numbered after the window.
+      std::map<size_t, size_t> local_camera;
+      for ( size_t c = 0; c < m_num_window; c++ )
+        local_camera[m_cameras[c]] = c;
+      for ( size_t p = 0; p < m_points.size(); p++ )
+        for ( size_t m = network.point_begin( m_points[p] ); m < network.point_end( m_points[p] ); m++ )
+          if ( local_camera.insert( std::make_pair( size_t( network.measure_camera(m) ),
+                                                    m_cameras.size() ) ).second )
+            m_cameras.push_back( network.measure_camera(m) );
+      for ( size_t c = m_num_window; c < m_cameras.size(); c++ )
+        m_anchor_targets.push_back( m_model.cam_params( m_cameras[c] ) );
+
+      m_network.reset( new ControlNetwork( "Window", network.type() ) );
+      for ( size_t p = 0; p < m_points.size(); p++ ) {
+        const size_t i = m_points[p];
+        ControlPoint cpoint( network.point_type(i) );
+        cpoint.set_position( network.point_position(i) );
+        cpoint.set_sigma( network.point_sigma(i) );
+        for ( size_t m = network.point_begin(i); m < network.point_end(i); m++ ) {
+          Vector2 location = network.measure_dominant(m), sigma = network.measure_sigma(m);
+          cpoint.add_measure( ControlMeasure( location[0], location[1], sigma[0], sigma[1],
+                                              local_camera[network.measure_camera(m)] ) );
+        }
+        m_network->add_control_point( cpoint );
+        m_num_measures += cpoint.size();
+      }
+    }
+
+    /// The number of window cameras.  Cameras [0, num_window_cameras())
+    /// are the window, and the rest are anchors.
+    size_t num_window_cameras() const { return m_num_window; }
+
+    /// The index in the full model of window camera or point j.
+    size_t model_camera( size_t j ) const { return m_cameras[j]; }
+    size_t model_point ( size_t i ) const { return m_points[i]; }
+
+    size_t num_cameras() const { return m_cameras.size(); }
+    size_t num_points () const { return m_points.size(); }
+    size_t num_pixel_observations() const { return m_num_measures; }
+
+    Vector2 cam_pixel( size_t i, size_t j, camera_vector const& cam_j,
+                       point_vector const& point_i ) {
+      return m_model.cam_pixel( m_points[i], m_cameras[j], cam_j, point_i );
+    }
+    bool analytic_cam_jacobian( size_t i, size_t j, camera_vector const& cam_j,
+                                point_vector const& point_i,
+                                Matrix<double, 2, ModelT::camera_params_n>& J ) {
+      return m_model.analytic_cam_jacobian( m_points[i], m_cameras[j], cam_j, point_i, J );
+    }
+    bool analytic_point_jacobian( size_t i, size_t j, camera_vector const& cam_j,
+                                  point_vector const& point_i,
+                                  Matrix<double, 2, ModelT::point_params_n>& J ) {
+      return m_model.analytic_point_jacobian( m_points[i], m_cameras[j], cam_j, point_i, J );
+    }
+
+    camera_vector cam_params( size_t j ) const { return m_model.cam_params( m_cameras[j] ); }
+    point_vector point_params( size_t i ) const { return m_model.point_params( m_points[i] ); }
+    void set_cam_params( size_t j, camera_vector const& cam_j ) {
+      m_model.set_cam_params( m_cameras[j], cam_j );
+    }
+    void set_point_params( size_t i, point_vector const& point_i ) {
+      m_model.set_point_params( m_points[i], point_i );
+    }
+
+    camera_vector cam_target( size_t j ) const {
+      if ( j >= m_num_window )
+        return m_anchor_targets[j - m_num_window];
+      return m_model.cam_target( m_cameras[j] );
+    }
+    point_vector point_target( size_t i ) const { return m_model.point_target( m_points[i] ); }
+
+    camera_matrix cam_inverse_covariance( size_t j ) const {
+      camera_matrix result = m_model.cam_inverse_covariance( m_cameras[j] );
+      if ( j >= m_num_window )
+        result *= m_anchor_weight;
+      return result;
+    }
+    point_matrix point_inverse_covariance( size_t i ) const {
+      return m_model.point_inverse_covariance( m_points[i] );
+    }
+
+    boost::shared_ptr<ControlNetwork> control_network() { return m_network; }
+
+  private:
+    ModelT& m_model;
+    double m_anchor_weight;
+    size_t m_num_measures;
+    size_t m_num_window;
+    std::vector<size_t> m_cameras, m_points;
+    std::vector<camera_vector> m_anchor_targets;
+    boost::shared_ptr<ControlNetwork> m_network;
+  };
+
+  /// Adjusts a window of model's cameras with AdjusterT, which is one
+  /// of the adjusters such as AdjustSparse, until the error or the
+  /// gradient falls below tolerance.  Returns the number of iterations.
+  template <template <class, class> class AdjusterT, class ModelT, class RobustCostT>
+  int adjust_window( ModelT& model, CompactControlNetwork const& network,
+                     std::vector<size_t> const& window, RobustCostT const& cost,
+                     int max_iterations = 20, double tolerance = 1e-10,
+                     double anchor_weight = 1e6 ) {
+    WindowedModel<ModelT> windowed( model, network, window, anchor_weight );
+    AdjusterT<WindowedModel<ModelT>, RobustCostT> adjuster( windowed, cost, true, true );
+    double abs_tol = 1e10, rel_tol = 1e10;
+    int iterations = 0;
+    while ( iterations < max_iterations && abs_tol > tolerance && rel_tol > tolerance ) {
+      adjuster.update( abs_tol, rel_tol );
+      iterations++;
+    }
+    return iterations;
+  }
+
+}} // namespace vw::ba
+
+#endif//__VW_BUNDLEADJUSTMENT_WINDOWED_MODEL_H__
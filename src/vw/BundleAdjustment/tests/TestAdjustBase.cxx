@@ -0,0 +1,132 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/BundleAdjustment/AdjustBase.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::ba;
+
+namespace {
+
+  // Cameras are 2D offsets, so a point projects to point + camera.
+  // Points with a negative x are behind every camera.
+  struct OffsetModel : public ModelBase<OffsetModel, 2, 2> {
+    boost::shared_ptr<ControlNetwork> m_network;
+    std::vector<Vector2> m_cameras, m_points;
+
+    OffsetModel() : m_network( new ControlNetwork( "Offsets" ) ),
+                    m_cameras( 3 ), m_points( 4 ) {
+      for ( size_t j = 0; j < 3; j++ )
+        m_cameras[j] = Vector2( j, 0 );
+      for ( size_t i = 0; i < 4; i++ ) {
+        m_points[i] = Vector2( i == 3 ? -1.0 : double(i), 1 );
+        ControlPoint cpoint;
+        for ( size_t j = 0; j < 3; j++ )
+          cpoint.add_measure( ControlMeasure( i + 1.5*j + 0.3, 1 + 0.25*i, 1, 1, j ) );
+        m_network->add_control_point( cpoint );
+      }
+    }
+
+    Vector2 cam_pixel( size_t /*i*/, size_t /*j*/, Vector2 const& cam, Vector2 const& point ) {
+      if ( point[0] < 0 )
+        vw_throw( camera::PointToPixelErr() << "Behind the camera." );
+      return cam + point;
+    }
+    size_t num_cameras() const { return m_cameras.size(); }
+    size_t num_points() const { return m_points.size(); }
+    size_t num_pixel_observations() const { return 12; }
+    Vector2 cam_params( size_t j ) const { return m_cameras[j]; }
+    Vector2 point_params( size_t i ) const { return m_points[i]; }
+    Vector2 cam_target( size_t j ) const { return m_cameras[j]; }
+    Vector2 point_target( size_t i ) const { return m_points[i]; }
+    boost::shared_ptr<ControlNetwork> control_network() { return m_network; }
+  };
+
+  template <class CostT>
+  void expect_weights( CostT cost ) {
+    double norms[5] = { 0.0, 0.1, 1.0, 2.5, 40.0 };
+    double weights[5];
+    robust_weights( cost, norms, weights, 5 );
+    EXPECT_EQ( 0.0, weights[0] );
+    for ( size_t k = 1; k < 5; k++ )
+      EXPECT_NEAR( sqrt( cost( norms[k] ) ) / norms[k], weights[k], 1e-12 );
+  }
+}
+
+TEST( AdjustBase, RobustWeights ) {
+  expect_weights( L2Error() );
+  expect_weights( L1Error() );
+  expect_weights( HuberError( 1.5 ) );
+  expect_weights( PseudoHuberError( 1.5 ) );
+  expect_weights( CauchyError( 2 ) );
+}
+
+TEST( AdjustBase, CamPixels ) {
+  OffsetModel model;
+  std::vector<size_t> ids;
+  std::vector<Vector2> points, pixels;
+  std::vector<uint8> valid;
+  for ( size_t i = 0; i < 4; i++ ) {
+    ids.push_back( i );
+    points.push_back( model.point_params(i) );
+  }
+  model.cam_pixels( 1, model.cam_params(1), ids, points, pixels, valid );
+  ASSERT_EQ( 4u, pixels.size() );
+  for ( size_t i = 0; i < 3; i++ ) {
+    EXPECT_EQ( 1, valid[i] );
+    EXPECT_VECTOR_DOUBLE_EQ( Vector2( i + 1, 1 ), pixels[i] );
+  }
+  EXPECT_EQ( 0, valid[3] );
+}
+
+TEST( AdjustBase, WeightedResiduals ) {
+  OffsetModel model;
+  HuberError cost( 0.6 );
+  AdjustBase<OffsetModel, HuberError> adjust( model, cost, false, false );
+
+  std::vector<Vector2> cameras( 3 ), points( 4 );
+  for ( size_t j = 0; j < 3; j++ )
+    cameras[j] = model.cam_params(j);
+  for ( size_t i = 0; i < 4; i++ )
+    points[i] = model.point_params(i);
+
+  std::vector<double> residuals;
+  EXPECT_EQ( 3u, adjust.weighted_residuals( cameras, points, residuals ) );
+  ASSERT_EQ( 24u, residuals.size() );
+
+  // Residuals come in the order of the network, point by point.
+  size_t m = 0;
+  for ( size_t i = 0; i < 4; i++ ) {
+    for ( size_t j = 0; j < 3; j++, m++ ) {
+      if ( i == 3 ) {
+        EXPECT_EQ( 0.0, residuals[2*m] );
+        EXPECT_EQ( 0.0, residuals[2*m+1] );
+        continue;
+      }
+      Vector2 error = (*model.m_network)[i][j].dominant() - model.cam_pixel( i, j, cameras[j], points[i] );
+      double mag = norm_2( error );
+      double weight = sqrt( cost( mag ) ) / mag;
+      EXPECT_NEAR( error[0] * weight, residuals[2*m],   1e-12 );
+      EXPECT_NEAR( error[1] * weight, residuals[2*m+1], 1e-12 );
+    }
+  }
+}
@@ -0,0 +1,159 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/BundleAdjustment/BlockCholesky.h>
+#include <vw/BundleAdjustment/CameraSystemSolver.h>
+#include <vw/Math/LinearAlgebra.h>
+
+#include <test/Helpers.h>
+
+#include <algorithm>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::ba;
+
+namespace {
+
+  // A diagonally dominant, so positive definite, matrix with random
+  // blocks where links[j] says which blocks k > j of row j are set.
+  void make_system( std::vector<std::vector<size_t> > const& links, size_t block_size,
+                    SparseBlockRows& rows, Matrix<double>& dense ) {
+    boost::random::mt19937 gen( 5 );
+    boost::random::uniform_real_distribution<double> dist( -1, 1 );
+    const size_t n = links.size(), bs = block_size;
+    dense.set_size( n*bs, n*bs );
+    dense.set_zero();
+    rows.assign( n, SparseBlockRows::value_type() );
+    for ( size_t j = 0; j < n; j++ )
+      for ( size_t b = 0; b < links[j].size(); b++ ) {
+        size_t k = links[j][b];
+        Matrix<double> block( bs, bs );
+        for ( size_t r = 0; r < bs; r++ )
+          for ( size_t c = 0; c < bs; c++ )
+            block(r,c) = dist( gen );
+        rows[j].push_back( std::make_pair( k, block ) );
+        submatrix( dense, j*bs, k*bs, bs, bs ) = block;
+        submatrix( dense, k*bs, j*bs, bs, bs ) = transpose( block );
+      }
+    for ( size_t j = 0; j < n; j++ ) {
+      Matrix<double> block( bs, bs );
+      for ( size_t r = 0; r < bs; r++ ) {
+        double sum = 0;
+        for ( size_t c = 0; c < n*bs; c++ )
+          sum += fabs( dense( j*bs+r, c ) );
+        for ( size_t c = r+1; c < bs; c++ )
+          block(r,c) = block(c,r) = 0.1*dist( gen );
+        block(r,r) = sum + 1 + bs;
+      }
+      // The diagonal block goes in the middle of the row, and only its
+      // upper triangle should be read.
+      submatrix( dense, j*bs, j*bs, bs, bs ) = block;
+      for ( size_t r = 1; r < bs; r++ )
+        block(r,0) = 1e6;
+      rows[j].insert( rows[j].begin() + rows[j].size()/2, std::make_pair( j, block ) );
+    }
+  }
+
+}
+
+TEST( BlockSparseCholesky, MatchesDenseSolve ) {
+  // Cameras on a ring, each also linked to a few further along.
+  const size_t n = 40, bs = 6;
+  std::vector<std::vector<size_t> > links( n );
+  for ( size_t j = 0; j < n; j++ ) {
+    if ( j + 1 < n ) links[j].push_back( j+1 );
+    if ( j + 7 < n ) links[j].push_back( j+7 );
+    if ( j % 5 == 0 && j + 20 < n ) links[j].push_back( j+20 );
+  }
+  links[0].push_back( n-1 );
+
+  SparseBlockRows rows;
+  Matrix<double> dense;
+  make_system( links, bs, rows, dense );
+  Vector<double> b( n*bs );
+  for ( size_t i = 0; i < b.size(); i++ )
+    b[i] = double( i % 11 ) - 5;
+
+  BlockSparseCholesky cholesky;
+  cholesky.factor( rows );
+  ASSERT_TRUE( cholesky.factored() );
+  EXPECT_EQ( n, cholesky.num_blocks() );
+  EXPECT_EQ( bs, cholesky.block_size() );
+  Vector<double> x = cholesky.solve( b );
+  Vector<double> expected = math::solve( dense, b );
+  EXPECT_VECTOR_NEAR( expected, x, 1e-10 );
+
+  // The same pattern reuses the ordering.
+  std::vector<size_t> ordering = cholesky.ordering();
+  BlockCholeskySolver solver;
+  x = solver.solve( rows, 2*b );
+  EXPECT_VECTOR_NEAR( 2*expected, x, 1e-10 );
+  x = solver.solve( rows, b );
+  EXPECT_VECTOR_NEAR( expected, x, 1e-10 );
+  EXPECT_TRUE( ordering == solver.cholesky().ordering() );
+
+  // A different pattern is analyzed again.
+  links[3].push_back( 30 );
+  make_system( links, bs, rows, dense );
+  x = solver.solve( rows, b );
+  EXPECT_VECTOR_NEAR( math::solve( dense, b ), x, 1e-10 );
+}
+
+TEST( BlockSparseCholesky, Ordering ) {
+  // One camera linked to all the others fills in everything when it
+  // is eliminated first, and nothing when it is eliminated last.
+  const size_t n = 30;
+  std::vector<std::vector<size_t> > links( n );
+  for ( size_t k = 1; k < n; k++ )
+    links[0].push_back( k );
+  SparseBlockRows rows;
+  Matrix<double> dense;
+  make_system( links, 2, rows, dense );
+
+  BlockSparseCholesky cholesky;
+  cholesky.factor( rows );
+  EXPECT_EQ( n-1, cholesky.factor_blocks() );
+  std::vector<size_t> const& ordering = cholesky.ordering();
+  EXPECT_GE( std::find( ordering.begin(), ordering.end(), 0u ) - ordering.begin(), int(n)-2 );
+
+  Vector<double> b( 2*n );
+  b[0] = 1;
+  EXPECT_VECTOR_NEAR( math::solve( dense, b ), cholesky.solve( b ), 1e-12 );
+}
+
+TEST( BlockSparseCholesky, NotPositiveDefinite ) {
+  SparseBlockRows rows( 2 );
+  Matrix<double> one( 2, 2 );
+  one.set_identity();
+  rows[0].push_back( std::make_pair( size_t(0), one ) );
+  rows[0].push_back( std::make_pair( size_t(1), 2*one ) );
+  rows[1].push_back( std::make_pair( size_t(1), one ) );
+
+  BlockSparseCholesky cholesky;
+  EXPECT_THROW( cholesky.factor( rows ), MathErr );
+  EXPECT_FALSE( cholesky.factored() );
+  EXPECT_THROW( cholesky.solve( Vector<double>( 4 ) ), LogicErr );
+
+  rows[1].push_back( std::make_pair( size_t(0), one ) );
+  EXPECT_THROW( cholesky.factor( rows ), ArgumentErr );
+}
@@ -141,3 +141,81 @@ TEST_F( CircleTest, JFeature ) {
 }
 
 
+
+namespace {
+  typedef std::vector<std::pair<size_t, JFeature*> > MapListing;
+
+  std::vector<MapListing> list_maps( CameraRelationNetwork<JFeature>& crn ) {
+    std::vector<MapListing> maps;
+    for ( size_t j = 0; j < crn.size(); j++ ) {
+      MapListing listing;
+      typedef std::multimap<size_t, boost::shared_ptr<JFeature> >::const_iterator mm_iter;
+      for ( mm_iter it = crn[j].map.begin(); it != crn[j].map.end(); it++ )
+        listing.push_back( std::make_pair( it->first, it->second.get() ) );
+      for ( CameraNode<JFeature>::iterator f = crn[j].begin(); f != crn[j].end(); f++ ) {
+        typedef std::map<size_t, boost::weak_ptr<JFeature> >::const_iterator m_iter;
+        for ( m_iter it = (*f)->m_map.begin(); it != (*f)->m_map.end(); it++ )
+          listing.push_back( std::make_pair( it->first, it->second.lock().get() ) );
+      }
+      maps.push_back( listing );
+    }
+    return maps;
+  }
+}
+
+TEST( CameraRelation, GraphMatchesMaps ) {
+  // Points seen by up to six of ten cameras, some twice by one camera.
+  ControlNetwork cnet( "Random" );
+  srand( 4 );
+  for ( uint32 i = 0; i < 300; i++ ) {
+    ControlPoint cpoint;
+    const uint32 m = 1 + rand() % 6;
+    for ( uint32 k = 0; k < m; k++ )
+      cpoint.add_measure( ControlMeasure( i, k, 1, 1, rand() % 10 ) );
+    cnet.add_control_point( cpoint );
+  }
+
+  CameraRelationNetwork<JFeature> serial;
+  serial.read_controlnetwork( cnet, 1 );
+  CameraRelationGraph const& graph = serial.graph();
+  ASSERT_EQ( cnet.size(), graph.num_points() );
+  EXPECT_EQ( serial.size(), graph.num_cameras() );
+  for ( size_t i = 0; i < cnet.size(); i++ ) {
+    ASSERT_EQ( cnet[i].size(), graph.point_end( i ) - graph.point_begin( i ) );
+    for ( size_t k = 0; k < cnet[i].size(); k++ ) {
+      size_t f = graph.point_begin( i ) + k;
+      EXPECT_EQ( cnet[i][k].image_id(), graph.feature_camera( f ) );
+      EXPECT_EQ( i, graph.feature_point( f ) );
+      EXPECT_EQ( i, serial.feature( f )->m_point_id );
+    }
+  }
+
+  // The maps filled from the graph are those build_map() makes from
+  // the connections, and do not depend on the number of threads.
+  std::vector<MapListing> from_graph = list_maps( serial );
+  serial.build_map();
+  std::vector<MapListing> from_connections = list_maps( serial );
+  ASSERT_EQ( from_connections.size(), from_graph.size() );
+  for ( size_t j = 0; j < from_graph.size(); j++ )
+    EXPECT_TRUE( from_connections[j] == from_graph[j] ) << "Camera " << j;
+
+  CameraRelationNetwork<JFeature> parallel;
+  parallel.read_controlnetwork( cnet, 4 );
+  ASSERT_EQ( serial.size(), parallel.size() );
+  for ( size_t j = 0; j < serial.size(); j++ ) {
+    ASSERT_EQ( graph.link_end( j ) - graph.link_begin( j ),
+               parallel.graph().link_end( j ) - parallel.graph().link_begin( j ) );
+    for ( size_t l = graph.link_begin( j ); l < graph.link_end( j ); l++ ) {
+      CameraRelationGraph::Link const& a = graph.link( l );
+      CameraRelationGraph::Link const& b = parallel.graph().link( l );
+      EXPECT_EQ( a.camera,  b.camera );
+      EXPECT_EQ( a.feature, b.feature );
+      EXPECT_EQ( a.other,   b.other );
+    }
+    EXPECT_EQ( serial[j].relations.size(), parallel[j].relations.size() );
+  }
+
+  // A network built by hand has no graph.
+  serial.add_node( CameraNode<JFeature>( 10, "" ) );
+  EXPECT_EQ( 0u, serial.graph().num_features() );
+}
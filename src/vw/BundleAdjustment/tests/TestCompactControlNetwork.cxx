@@ -0,0 +1,110 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/BundleAdjustment/CompactControlNetwork.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::ba;
+using namespace vw::test;
+
+namespace {
+  // Point i is seen by cameras 0 .. i, and point 2 is a GCP.
+  ControlNetwork make_network() {
+    ControlNetwork cnet( "TestCNET", ControlNetwork::ImageToGround );
+    for ( uint32 i = 0; i < 4; i++ ) {
+      ControlPoint cpoint( i == 2 ? ControlPoint::GroundControlPoint : ControlPoint::TiePoint );
+      cpoint.set_position( Vector3( i, 2*i, 3*i ) );
+      cpoint.set_sigma( Vector3( 1, 1, 2 ) );
+      for ( uint32 j = 0; j < i+1; j++ ) {
+        ControlMeasure cm( 10*i + j, 20*i, 1, 2, j );
+        cm.set_serial( j % 2 ? "odd" : "even" );
+        cpoint.add_measure( cm );
+      }
+      cnet.add_control_point( cpoint );
+    }
+    return cnet;
+  }
+
+  void expect_same( ControlNetwork const& cnet, CompactControlNetwork const& compact ) {
+    ASSERT_EQ( cnet.size(), compact.num_points() );
+    EXPECT_EQ( cnet.type(), compact.type() );
+    EXPECT_EQ( cnet.num_ground_control_points(), compact.num_ground_control_points() );
+    size_t m = 0;
+    for ( size_t i = 0; i < cnet.size(); i++ ) {
+      EXPECT_VECTOR_DOUBLE_EQ( cnet[i].position(), compact.point_position(i) );
+      EXPECT_VECTOR_DOUBLE_EQ( cnet[i].sigma(), compact.point_sigma(i) );
+      EXPECT_EQ( cnet[i].type(), compact.point_type(i) );
+      ASSERT_EQ( cnet[i].size(), compact.point_size(i) );
+      EXPECT_EQ( m, compact.point_begin(i) );
+      for ( size_t k = 0; k < cnet[i].size(); k++, m++ ) {
+        EXPECT_VECTOR_DOUBLE_EQ( cnet[i][k].dominant(), compact.measure_dominant(m) );
+        EXPECT_VECTOR_DOUBLE_EQ( cnet[i][k].sigma(), compact.measure_sigma(m) );
+        EXPECT_EQ( cnet[i][k].image_id(), compact.measure_camera(m) );
+        EXPECT_EQ( cnet[i][k].serial(), compact.measure_serial(m) );
+        EXPECT_EQ( i, compact.measure_point(m) );
+      }
+    }
+    EXPECT_EQ( m, compact.num_measures() );
+  }
+}
+
+TEST( CompactControlNetwork, FromControlNetwork ) {
+  ControlNetwork cnet = make_network();
+  CompactControlNetwork compact( cnet );
+  expect_same( cnet, compact );
+
+  EXPECT_EQ( 10u, compact.num_measures() );
+  EXPECT_EQ( 4u, compact.num_cameras() );
+  EXPECT_TRUE( compact.is_ground_control_point(2) );
+  EXPECT_FALSE( compact.is_ground_control_point(1) );
+
+  // Only the point id "" and the two serials are stored.
+  EXPECT_EQ( 3u, compact.strings().size() );
+  EXPECT_GT( compact.memory_usage(), 0u );
+}
+
+TEST( CompactControlNetwork, CameraIndex ) {
+  CompactControlNetwork compact( make_network() );
+
+  // Camera j sees points j .. 3, in point order.
+  for ( size_t j = 0; j < compact.num_cameras(); j++ ) {
+    ASSERT_EQ( 4 - j, compact.camera_size(j) );
+    for ( size_t k = compact.camera_begin(j); k < compact.camera_end(j); k++ ) {
+      size_t m = compact.camera_measure(k);
+      EXPECT_EQ( j, compact.measure_camera(m) );
+      EXPECT_EQ( j + k - compact.camera_begin(j), compact.measure_point(m) );
+    }
+  }
+}
+
+TEST( CompactControlNetwork, ReadBinary ) {
+  UnlinkName file( "compact.cnet" );
+  ControlNetwork cnet = make_network();
+  cnet.write_binary( file );
+
+  CompactControlNetwork compact;
+  compact.read_binary( file );
+  expect_same( cnet, compact );
+  EXPECT_EQ( 4u, compact.num_cameras() );
+
+  EXPECT_THROW( compact.read_binary( "does_not_exist.cnet" ), IOErr );
+}
@@ -94,3 +94,49 @@ TEST( GCPLoad, LoadingGCP ) {
   EXPECT_EQ(27, cnet.size());
 }
 
+
+TEST( ControlNetworkLoad, BuildFromMatches ) {
+  UnlinkName ab("ab.match"), bc("bc.match"), ac("ac.match");
+  std::vector<std::string> image_files;
+  image_files.push_back("a.tif");
+  image_files.push_back("b.tif");
+  image_files.push_back("c.tif");
+  std::map< std::pair<int, int>, std::string> match_files;
+  match_files[std::make_pair(0,1)] = ab;
+  match_files[std::make_pair(1,2)] = bc;
+  match_files[std::make_pair(0,2)] = ac;
+
+  std::vector<ip::InterestPoint> ip1, ip2;
+  // a(1,1) b(2,2) c(3,3) make one track, as do a(5,5) b(6,6) c(9,9)
+  ip1.push_back( ip::InterestPoint(1,1) ); ip2.push_back( ip::InterestPoint(2,2) );
+  ip1.push_back( ip::InterestPoint(5,5) ); ip2.push_back( ip::InterestPoint(6,6) );
+  ip1.push_back( ip::InterestPoint(7,7) ); ip2.push_back( ip::InterestPoint(8,8) );
+  ip::write_binary_match_file( ab, ip1, ip2 );
+  ip1.clear(); ip2.clear();
+  ip1.push_back( ip::InterestPoint(2,2) ); ip2.push_back( ip::InterestPoint(3,3) );
+  ip1.push_back( ip::InterestPoint(6,6) ); ip2.push_back( ip::InterestPoint(9,9) );
+  ip::write_binary_match_file( bc, ip1, ip2 );
+  ip1.clear(); ip2.clear();
+  ip1.push_back( ip::InterestPoint(1,1) ); ip2.push_back( ip::InterestPoint(3,3) );
+  // a(8,8) joins the second track, which then sees image a twice.
+  ip1.push_back( ip::InterestPoint(8,8) ); ip2.push_back( ip::InterestPoint(9,9) );
+  ip::write_binary_match_file( ac, ip1, ip2 );
+
+  ControlNetwork cnet("matches");
+  std::vector<boost::shared_ptr<camera::CameraModel> > cameras;
+  EXPECT_TRUE( build_control_network( false, cnet, cameras, image_files,
+                                      match_files, 1, 0, 0 ) );
+  ASSERT_EQ( 2u, cnet.size() );
+
+  // Tracks come in the order of their first feature, with their
+  // measures sorted by image.
+  ASSERT_EQ( 3u, cnet[0].size() );
+  for ( size_t m = 0; m < 3; m++ ) {
+    EXPECT_EQ( m, cnet[0][m].image_id() );
+    EXPECT_VECTOR_DOUBLE_EQ( Vector2(m+1,m+1), cnet[0][m].position() );
+  }
+  ASSERT_EQ( 2u, cnet[1].size() );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(7,7), cnet[1][0].position() );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2(8,8), cnet[1][1].position() );
+  EXPECT_EQ( 1u, cnet[1][1].image_id() );
+}
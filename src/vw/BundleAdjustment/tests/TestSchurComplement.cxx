@@ -0,0 +1,147 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/BundleAdjustment/ControlNetwork.h>
+#include <vw/BundleAdjustment/IterativeCameraSolver.h>
+#include <vw/BundleAdjustment/SchurComplement.h>
+
+#include <test/Helpers.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::ba;
+
+typedef Matrix<double,6,6> MatrixCam;
+typedef Matrix<double,3,3> MatrixPt;
+
+// Normal equations of random Jacobians on a network where each point
+// is seen by a few cameras along a strip.
+class SchurTest : public ::testing::Test {
+protected:
+  enum { num_cameras = 12, num_points = 150 };
+
+  CameraRelationNetwork<JFeature> crn;
+  std::vector<MatrixCam> U;
+  std::vector<MatrixPt>  V, V_inverse;
+  std::vector<Vector<double,3> > epsilon_b;
+  Vector<double> e;
+
+  virtual void SetUp() {
+    ControlNetwork cnet( "SchurTest" );
+    for ( size_t i = 0; i < num_points; i++ ) {
+      ControlPoint cpoint;
+      size_t first = i % (num_cameras - 3);
+      for ( size_t j = first; j < first + 2 + i % 3; j++ )
+        cpoint.add_measure( ControlMeasure( i, j, 1, 1, j ) );
+      cnet.add_control_point( cpoint );
+    }
+    crn.read_controlnetwork( cnet );
+    ASSERT_EQ( size_t(num_cameras), crn.size() );
+
+    boost::random::mt19937 gen( 3 );
+    boost::random::uniform_real_distribution<double> dist( -1, 1 );
+    U.assign( crn.size(), MatrixCam() );
+    V.assign( num_points, MatrixPt() );
+    V_inverse.resize( num_points );
+    epsilon_b.assign( num_points, Vector<double,3>() );
+    for ( size_t j = 0; j < crn.size(); j++ ) {
+      for ( CameraNode<JFeature>::iterator fiter = crn[j].begin(); fiter != crn[j].end(); fiter++ ) {
+        Matrix<double,2,6> A;
+        Matrix<double,2,3> B;
+        for ( size_t r = 0; r < 2; r++ ) {
+          for ( size_t c = 0; c < 6; c++ ) A(r,c) = dist( gen );
+          for ( size_t c = 0; c < 3; c++ ) B(r,c) = dist( gen );
+        }
+        size_t i = (**fiter).m_point_id;
+        U[j] += transpose(A) * A;
+        V[i] += transpose(B) * B;
+        (**fiter).m_w = transpose(A) * B;
+        epsilon_b[i] += Vector<double,3>( dist( gen ), dist( gen ), dist( gen ) );
+      }
+    }
+    for ( size_t j = 0; j < U.size(); j++ )
+      U[j] += 0.1 * identity_matrix<6>();
+    for ( size_t i = 0; i < V.size(); i++ )
+      V[i] += 0.1 * identity_matrix<3>();
+
+    e = Vector<double>( 6*crn.size() );
+    for ( size_t k = 0; k < e.size(); k++ )
+      e[k] = dist( gen );
+    schur_invert_points( V, V_inverse );
+    schur_compute_y( crn, V_inverse, epsilon_b, e, 6 );
+  }
+
+  Matrix<double> dense_system( SparseBlockRows const& rows ) {
+    Matrix<double> S( 6*rows.size(), 6*rows.size() );
+    for ( size_t j = 0; j < rows.size(); j++ )
+      for ( size_t b = 0; b < rows[j].size(); b++ ) {
+        size_t k = rows[j][b].first;
+        submatrix( S, 6*j, 6*k, 6, 6 ) = rows[j][b].second;
+        if ( k != j )
+          submatrix( S, 6*k, 6*j, 6, 6 ) = transpose( rows[j][b].second );
+      }
+    return S;
+  }
+};
+
+TEST_F( SchurTest, OperatorMatchesBlocks ) {
+  SparseBlockRows rows;
+  schur_build_blocks( crn, U, rows, 4 );
+  Matrix<double> S = dense_system( rows );
+
+  // Each point links the cameras that see it, and no others.
+  EXPECT_EQ( 2u, rows[0].size() );
+  EXPECT_EQ( 1u, rows.back().size() );
+
+  SchurOperator op( crn, U, num_points, 4 );
+  EXPECT_EQ( crn.size(), op.num_cameras() );
+  EXPECT_EQ( 6u, op.block_size() );
+  Vector<double> y;
+  op( e, y );
+  EXPECT_VECTOR_NEAR( S * e, y, 1e-10 );
+
+  std::vector<Matrix<double> > diagonal;
+  op.diagonal_blocks( diagonal );
+  ASSERT_EQ( rows.size(), diagonal.size() );
+  for ( size_t j = 0; j < rows.size(); j++ )
+    EXPECT_MATRIX_NEAR( rows[j][0].second, diagonal[j], 1e-10 );
+}
+
+TEST_F( SchurTest, PCGMatchesCholesky ) {
+  SparseBlockRows rows;
+  schur_build_blocks( crn, U, rows );
+  BlockCholeskySolver cholesky;
+  Vector<double> expected = cholesky.solve( rows, e );
+
+  PCGCameraSolver exact( 1000, 1e-12, 0 );
+  EXPECT_TRUE( exact.matrix_free() );
+  Vector<double> x = exact.solve( SchurOperator( crn, U, num_points ), e );
+  EXPECT_VECTOR_NEAR( expected, x, 1e-8 );
+  EXPECT_GT( exact.last_iterations(), 0 );
+  EXPECT_THROW( exact.solve( rows, e ), NoImplErr );
+
+  // Truncated steps are cheaper, and still point downhill.
+  PCGCameraSolver truncated;
+  x = truncated.solve( SchurOperator( crn, U, num_points ), e );
+  EXPECT_LT( truncated.last_iterations(), exact.last_iterations() );
+  EXPECT_GT( dot_prod( x, e ), 0 );
+}
@@ -0,0 +1,131 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/BundleAdjustment/AdjustRef.h>
+#include <vw/BundleAdjustment/WindowedModel.h>
+
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::ba;
+
+namespace {
+
+  // A strip of six cameras that are 2D offsets, so a point projects
+  // to point + camera.  Point p is seen by cameras p/2 and p/2 + 1.
+  struct StripModel : public ModelBase<StripModel, 2, 2> {
+    boost::shared_ptr<ControlNetwork> m_network;
+    std::vector<Vector2> m_cameras, m_points, m_true_cameras;
+
+    StripModel() : m_network( new ControlNetwork( "Strip" ) ) {
+      for ( size_t j = 0; j < 6; j++ )
+        m_true_cameras.push_back( Vector2( 3.0*j, 0.5*j ) );
+      for ( size_t p = 0; p < 12; p++ ) {
+        m_points.push_back( Vector2( 1.5*p, (p % 3) + 1.0 ) );
+        ControlPoint cpoint;
+        for ( size_t j = p/2; j <= p/2 + 1 && j < 6; j++ ) {
+          // A little noise, since measures that fit exactly give the
+          // robust weights of the reference adjuster a 0/0.
+          Vector2 pixel = m_points[p] + m_true_cameras[j] + Vector2( 1e-4*(p%5), -1e-4*(j%3) );
+          cpoint.add_measure( ControlMeasure( pixel[0], pixel[1], 1, 1, j ) );
+        }
+        m_network->add_control_point( cpoint );
+      }
+      m_cameras = m_true_cameras;
+    }
+
+    Vector2 cam_pixel( size_t, size_t, Vector2 const& cam, Vector2 const& point ) {
+      return cam + point;
+    }
+    size_t num_cameras() const { return m_cameras.size(); }
+    size_t num_points() const { return m_points.size(); }
+    size_t num_pixel_observations() const { return 22; }
+    Vector2 cam_params( size_t j ) const { return m_cameras[j]; }
+    Vector2 point_params( size_t i ) const { return m_points[i]; }
+    void set_cam_params( size_t j, Vector2 const& cam ) { m_cameras[j] = cam; }
+    void set_point_params( size_t i, Vector2 const& point ) { m_points[i] = point; }
+    Vector2 cam_target( size_t j ) const { return m_cameras[j]; }
+    Vector2 point_target( size_t i ) const { return m_points[i]; }
+    Matrix2x2 cam_inverse_covariance( size_t ) const { return 1e-6 * math::identity_matrix<2>(); }
+    Matrix2x2 point_inverse_covariance( size_t ) const { return math::identity_matrix<2>(); }
+    boost::shared_ptr<ControlNetwork> control_network() { return m_network; }
+  };
+}
+
+TEST( WindowedModel, Neighborhood ) {
+  StripModel model;
+  CompactControlNetwork network( *model.control_network() );
+  std::vector<size_t> seeds( 1, 5 );
+
+  std::vector<size_t> near = camera_neighborhood( network, seeds, 1, 10 );
+  ASSERT_EQ( 2u, near.size() );
+  EXPECT_EQ( 5u, near[0] );
+  EXPECT_EQ( 4u, near[1] );
+
+  std::vector<size_t> far = camera_neighborhood( network, seeds, 10, 10 );
+  ASSERT_EQ( 6u, far.size() );
+  EXPECT_EQ( 0u, far[5] );
+  EXPECT_EQ( 3u, camera_neighborhood( network, seeds, 10, 3 ).size() );
+}
+
+TEST( WindowedModel, Window ) {
+  StripModel model;
+  CompactControlNetwork network( *model.control_network() );
+  WindowedModel<StripModel> window( model, network, std::vector<size_t>( 1, 5 ) );
+
+  // Camera 5 sees points 8 to 11, which camera 4 also sees.
+  EXPECT_EQ( 1u, window.num_window_cameras() );
+  ASSERT_EQ( 2u, window.num_cameras() );
+  EXPECT_EQ( 5u, window.model_camera(0) );
+  EXPECT_EQ( 4u, window.model_camera(1) );
+  ASSERT_EQ( 4u, window.num_points() );
+  EXPECT_EQ( 8u, window.model_point(0) );
+  EXPECT_EQ( 6u, window.num_pixel_observations() );
+  EXPECT_EQ( 4u, window.control_network()->size() );
+
+  // Anchors are held by a stiffer prior.
+  EXPECT_NEAR( 1e-6, window.cam_inverse_covariance(0)(0,0), 1e-12 );
+  EXPECT_NEAR( 1.0,  window.cam_inverse_covariance(1)(0,0), 1e-9 );
+
+  // Parameters are shared with the full model.
+  window.set_cam_params( 1, Vector2( 7, 7 ) );
+  EXPECT_VECTOR_DOUBLE_EQ( Vector2( 7, 7 ), model.cam_params(4) );
+  EXPECT_VECTOR_DOUBLE_EQ( model.point_params(9), window.point_params(1) );
+}
+
+TEST( WindowedModel, AdjustNewCamera ) {
+  StripModel model;
+  CompactControlNetwork network( *model.control_network() );
+
+  // The newest camera arrives with a poor position.
+  model.set_cam_params( 5, model.m_true_cameras[5] + Vector2( 0.3, -0.2 ) );
+  std::vector<Vector2> cameras = model.m_cameras, points = model.m_points;
+
+  std::vector<size_t> window = camera_neighborhood( network, std::vector<size_t>( 1, 5 ), 0, 1 );
+  int iterations = adjust_window<AdjustRef>( model, network, window, L2Error(), 50, 1e-16 );
+  EXPECT_GT( iterations, 0 );
+
+  EXPECT_LT( norm_2( model.cam_params(5) - model.m_true_cameras[5] ), 1e-3 );
+  EXPECT_LT( norm_2( model.cam_params(4) - cameras[4] ), 1e-4 );
+  for ( size_t j = 0; j < 4; j++ )
+    EXPECT_VECTOR_DOUBLE_EQ( cameras[j], model.cam_params(j) );
+  for ( size_t i = 0; i < 8; i++ )
+    EXPECT_VECTOR_DOUBLE_EQ( points[i], model.point_params(i) );
+}
@@ -18,6 +18,7 @@
 
 #include <vw/Core/Log.h>
 #include <vw/Camera/CAHVModel.h>
+#include <vw/Camera/CAHVORModel.h>
 #include <vw/Camera/CAHVOREModel.h>
 #include <fstream>
 #include <boost/foreach.hpp>
@@ -164,72 +165,135 @@ void CAHVOREModel::write(std::string const& filename) {
   }
 }
 
-vw::Vector3 CAHVOREModel::pixel_to_vector(vw::Vector2 const& pix) const {
-  // Based on JPL's cmod_cahvore_2d_to_3d
-  Vector3 result;
-
-  // Calculate initial terms
-  Vector3 w3 = cross_prod(V - pix[1]*A,
-                          H - pix[0]*A);
-  Vector3 rp = (1/dot_prod(A,cross_prod(V,H))) * w3;
-
-  double zetap = dot_prod(rp,O);
-  Vector3 lambdap3 = rp - zetap*O;
-  double lambdap = norm_2(lambdap3);
-  double chip = lambdap / zetap;
-
-  if (chip < 1e-8) {
-    // Approximations for small angles
-    result = O;
-  } else {
-    // Full calculations
-
-    // Calculate chi using Newton's Method
-    double chi = chip;
-    double dchi = 1;
-    for (int32 n = 0;; ++n) {
-      // Checking exit conditions
-      if (n > 100)
-        vw_throw( PixelToRayErr() << "CAHVOREModel: Did not converge.\n" );
-      if (fabs(dchi) < 1e-8)
-        break;
-
-      // Compute terms from the current value of chi
-      double chi2 = chi * chi;
-      double chi3 = chi * chi2;
-      double chi4 = chi * chi3;
-      double chi5 = chi * chi4;
-
-      // Update chi
-      double deriv = (1 + R[0]) + 3*R[1]*chi2 + 5*R[2]*chi4;
-      dchi = ((1 + R[0])*chi + R[1]*chi3 + R[2]*chi5 - chip) / deriv;
-      chi -= dchi;
-    }
+namespace {
+
+  // Tolerance and step limit for solving for chi in pixel_to_vector()
+  const double CAHVORE_CHI_TOL       = 1e-8;
+  const int    CAHVORE_CHI_MAX_STEPS = 100;
+
+  // The part of pixel_to_vector() before solving for chi.  Returns
+  // the part lambdap3 of the ray perpendicular to O and the starting
+  // value chip of chi.
+  void cahvore_distorted_ray(CAHVOREModel const& cam, Vector2 const& pix, double scale,
+                             Vector3& lambdap3, double& chip) {
+    // Calculate initial terms
+    Vector3 w3 = cross_prod(cam.V - pix[1]*cam.A,
+                            cam.H - pix[0]*cam.A);
+    Vector3 rp = scale * w3;
+
+    double zetap = dot_prod(rp,cam.O);
+    lambdap3 = rp - zetap*cam.O;
+    double lambdap = norm_2(lambdap3);
+    chip = lambdap / zetap;
+  }
 
+  // The part of pixel_to_vector() after solving for chi.
+  Vector3 cahvore_undistorted_ray(CAHVOREModel const& cam, Vector3 const& lambdap3, double chi) {
     // Compute the incoming ray's angle
     double linchi, theta;
-    linchi = P * chi;
-    if (P < -1e-15)
-      theta = asin(linchi) / P;
-    else if (P > 1e-15)
-      theta = atan(linchi) / P;
+    linchi = cam.P * chi;
+    if (cam.P < -1e-15)
+      theta = asin(linchi) / cam.P;
+    else if (cam.P > 1e-15)
+      theta = atan(linchi) / cam.P;
     else
       theta = chi;
 
-    double theta2 = theta*theta;
-    double mu = E[2];
-    mu = E[1] + theta2*mu;
-    mu = E[0] + theta2*mu;
-
-    result = sin(theta)*normalize(lambdap3) + cos(theta)*O;
+    return sin(theta)*normalize(lambdap3) + cos(theta)*cam.O;
   }
 
-  return result;
+} // end anonymous namespace
+
+vw::Vector3 CAHVOREModel::pixel_to_vector(vw::Vector2 const& pix) const {
+  // Based on JPL's cmod_cahvore_2d_to_3d
+  Vector3 lambdap3;
+  double  chip;
+  cahvore_distorted_ray(*this, pix, 1/dot_prod(A,cross_prod(V,H)), lambdap3, chip);
+
+  // Approximations for small angles
+  if (chip < 1e-8)
+    return O;
+
+  // Full calculations
+
+  // Calculate chi using Newton's Method
+  const double k1 = 1 + R[0];
+  double chi = chip;
+  int status;
+  solve_cahvor_distortion(1, &k1, &R[1], &R[2], &chip, &chi,
+                          CAHVORE_CHI_TOL, CAHVORE_CHI_MAX_STEPS, false, &status);
+  if (status != CahvorDistortionConverged)
+    vw_throw( PixelToRayErr() << "CAHVOREModel: Did not converge.\n" );
+
+  return cahvore_undistorted_ray(*this, lambdap3, chi);
 }
 
 Vector3 CAHVOREModel::camera_center(Vector2 const& pix ) const { return C; }
 
+void CAHVOREModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                  std::vector<Vector3>      & centers,
+                                  std::vector<Vector3>      & directions) const {
+  const size_t num = pixels.size();
+  centers.assign(num, C);
+  directions.resize(num);
+  if (num == 0)
+    return;
+
+  // Same steps as pixel_to_vector(), with chi for all of the pixels
+  // found in one call.
+  const double scale = 1/dot_prod(A,cross_prod(V,H));
+  std::vector<Vector3> lambdap3(num);
+  std::vector<double>  k1(num, 1 + R[0]), k3(num, R[1]), k5(num, R[2]), chip(num), chi(num);
+  std::vector<int>     status(num);
+  for (size_t i = 0; i < num; ++i) {
+    cahvore_distorted_ray(*this, pixels[i], scale, lambdap3[i], chip[i]);
+    chi[i] = chip[i];
+  }
+
+  solve_cahvor_distortion(num, &k1[0], &k3[0], &k5[0], &chip[0], &chi[0],
+                          CAHVORE_CHI_TOL, CAHVORE_CHI_MAX_STEPS, false, &status[0]);
+
+  for (size_t i = 0; i < num; ++i) {
+    if (chip[i] < 1e-8) {
+      directions[i] = O; // Approximations for small angles
+      continue;
+    }
+    if (status[i] != CahvorDistortionConverged)
+      vw_throw( PixelToRayErr() << "CAHVOREModel: Did not converge.\n" );
+    directions[i] = cahvore_undistorted_ray(*this, lambdap3[i], chi[i]);
+  }
+}
+
 Vector2 CAHVOREModel::point_to_pixel(vw::Vector3 const& point) const {
+  double theta_offset = 0;
+  return solve_point_to_pixel(point, theta_offset);
+}
+
+void CAHVOREModel::points_to_pixels(std::vector<Vector3> const& points,
+                                    std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+  double theta_offset = 0;
+  for (size_t i = 0; i < points.size(); ++i) {
+    bool warm = (theta_offset != 0);
+    try {
+      pixels[i] = solve_point_to_pixel(points[i], theta_offset);
+      continue;
+    } catch (const PointToPixelErr& /*e*/) {}
+
+    // Try again from the usual starting point, then give up
+    pixels[i]    = invalid_pixel();
+    theta_offset = 0;
+    if (!warm)
+      continue;
+    try {
+      pixels[i] = solve_point_to_pixel(points[i], theta_offset);
+    } catch (const PointToPixelErr& /*e*/) {
+      theta_offset = 0;
+    }
+  }
+}
+
+Vector2 CAHVOREModel::solve_point_to_pixel(vw::Vector3 const& point, double& theta_offset) const {
   // Base on JPL's cmod_cahvore_3d_to_2d_general
 
   // Calculate initial terms
@@ -239,7 +303,8 @@ Vector2 CAHVOREModel::point_to_pixel(vw::Vector3 const& point) const {
   double lambda = norm_2(lambda3);
 
   // Calculate theta using Newton's Method
-  double theta = atan2(lambda, zeta);
+  double theta0 = atan2(lambda, zeta);
+  double theta  = theta0 + theta_offset;
   double dtheta = 1;
   for (int32 n = 0;;++n) {
 
@@ -266,6 +331,7 @@ Vector2 CAHVOREModel::point_to_pixel(vw::Vector3 const& point) const {
               ) / upsilon;
     theta -= dtheta;
   }
+  theta_offset = theta - theta0;
 
   // Check the value of theta
   if ((theta * fabs(P)) > M_PI/2)
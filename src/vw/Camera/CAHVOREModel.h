@@ -71,6 +71,18 @@ namespace camera {
     virtual Vector3 pixel_to_vector(Vector2 const& pix) const;
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const;
 
+    /// Batch versions of pixel_to_vector() and point_to_pixel().  The
+    /// distortion equations of all of the pixels are solved together
+    /// with solve_cahvor_distortion().  The Newton iterations for each
+    /// point reuse the distortion found for the previous one, so pass
+    /// neighbors next to each other.  Points which do not project get
+    /// invalid_pixel().
+    virtual void pixels_to_rays  (std::vector<Vector2> const& pixels,
+                                  std::vector<Vector3>      & centers,
+                                  std::vector<Vector3>      & directions) const;
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>      & pixels) const;
+
     /// Write CAHVORE model to file.
     void write(std::string const& filename);
 
@@ -87,6 +99,10 @@ namespace camera {
     double    P; // We don't have T as it is redundant information
   private:
     bool check_line( std::istream& istream, char letter );
+
+    /// As point_to_pixel(), starting Newton's method from the usual
+    /// guess for theta plus the given offset, which is updated the same way.
+    Vector2 solve_point_to_pixel(Vector3 const& point, double& theta_offset) const;
   };
 
   // Function to "map" the CAHVORE parameters into CAHV:
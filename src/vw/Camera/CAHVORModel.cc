@@ -16,12 +16,17 @@
 // __END_LICENSE__
 
 
+#include <vw/config.h>
 #include <vw/Core/Log.h>
 #include <vw/Camera/CAHVORModel.h>
 #include <vw/Camera/CAHVModel.h>
 #include <fstream>
 #include <boost/foreach.hpp>
 
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  #include <emmintrin.h>
+#endif
+
 using namespace vw;
 using namespace camera;
 
@@ -294,59 +299,163 @@ Vector3 CAHVORModel::pixel_to_vector(Vector2 const& pix,
 
 
 // pixel_to_vector (no returned partial matrix)
-Vector3 CAHVORModel::pixel_to_vector(Vector2 const& pix) const {
-  // Based on JPL_CMOD_CAHVOR_2D_TO_3D
+void camera::solve_cahvor_distortion(size_t num, double const* a, double const* b,
+                                     double const* c, double const* d, double* x,
+                                     double tol, int max_steps, bool check_derivative,
+                                     int* status) {
+  size_t i = 0;
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  // Two equations at a time.  A lane that has stopped keeps going
+  // through the arithmetic but its x is no longer updated.
+  const __m128d zero     = _mm_setzero_pd();
+  const __m128d three    = _mm_set1_pd(3.0);
+  const __m128d five     = _mm_set1_pd(5.0);
+  const __m128d tol_v    = _mm_set1_pd(tol);
+  const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+  const __m128d all_ones = _mm_cmpeq_pd(zero, zero);
+  for (; i + 2 <= num; i += 2) {
+    __m128d a_v = _mm_loadu_pd(a+i), b_v = _mm_loadu_pd(b+i);
+    __m128d c_v = _mm_loadu_pd(c+i), d_v = _mm_loadu_pd(d+i);
+    __m128d x_v = _mm_loadu_pd(x+i);
+    __m128d active = all_ones, negative = zero, converged = zero;
+    for (int step = 0; step < max_steps && _mm_movemask_pd(active); ++step) {
+      // Same operations in the same order as the scalar loop below
+      __m128d x2    = _mm_mul_pd(x_v, x_v);
+      __m128d poly  = _mm_sub_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(c_v, x2), b_v),
+                                                                  x2), a_v), x_v), d_v);
+      __m128d deriv = _mm_add_pd(_mm_mul_pd(_mm_add_pd(_mm_mul_pd(_mm_mul_pd(five, c_v), x2),
+                                                       _mm_mul_pd(three, b_v)), x2), a_v);
+      if (check_derivative) {
+        __m128d bad = _mm_and_pd(active, _mm_cmple_pd(deriv, zero));
+        negative = _mm_or_pd(negative, bad);
+        active   = _mm_andnot_pd(bad, active);
+      }
+      __m128d dx = _mm_div_pd(poly, deriv);
+      x_v = _mm_sub_pd(x_v, _mm_and_pd(active, dx));
+      __m128d done = _mm_and_pd(active, _mm_cmplt_pd(_mm_and_pd(dx, abs_mask), tol_v));
+      converged = _mm_or_pd(converged, done);
+      active    = _mm_andnot_pd(done, active);
+    }
+    _mm_storeu_pd(x+i, x_v);
+    int converged_bits = _mm_movemask_pd(converged), negative_bits = _mm_movemask_pd(negative);
+    for (int k = 0; k < 2; k++) {
+      if      ((converged_bits >> k) & 1) status[i+k] = CahvorDistortionConverged;
+      else if ((negative_bits  >> k) & 1) status[i+k] = CahvorDistortionNegative;
+      else                                status[i+k] = CahvorDistortionMaxSteps;
+    }
+  }
+#endif
+
+  for (; i < num; ++i) {
+    double u = x[i];
+    status[i] = CahvorDistortionMaxSteps;
+    for (int step = 0; step < max_steps; ++step) {
+      double u_2   = u*u;
+      double poly  =  ((c[i]*u_2  +  b[i])*u_2 + a[i])*u - d[i];
+      double deriv = (5*c[i]*u_2 + 3*b[i])*u_2 + a[i];
+      if (check_derivative && deriv <= 0) {
+        status[i] = CahvorDistortionNegative;
+        break;
+      }
+      double du = poly/deriv;
+      u -= du;
+      if (fabs(du) < tol) {
+        status[i] = CahvorDistortionConverged;
+        break;
+      }
+    }
+    x[i] = u;
+  }
+}
 
-  // Calculate the projection ray assuming normal vector directions,
-  // neglecting distortion.
-  Vector3 rr = normalize(cross_prod(V - pix.y() * A,
-                                    H - pix.x() * A));
+namespace {
 
-  // Check and optionally correct for vector directions.
-  if (dot_prod(cross_prod(V,H), A) < 0)
-    rr = -1.0 * rr;
+  void log_cahvor_distortion_status(int status) {
+    if (status == CahvorDistortionNegative)
+      vw_out(InfoMessage, "camera") << "CAHVORModel.pixel_to_vector(): Distortion is too negative\n";
+    else if (status == CahvorDistortionMaxSteps)
+      vw_out(InfoMessage, "camera") << "CAHVORModel.pixel_to_vector(): Too many iterations ("
+                                    << VW_CAHVOR_MAXITER << ")\n";
+  }
 
-  // Remove the radial lens distortion.  Preliminary values of
-  // omega, lambda, and tau are computed from the rr vector
-  // including distortion, in order to obtain the coefficients of
-  // the equation k5*u^5 + k3*u^3 + k1*u = 1, which is solved for u
-  // by means of Newton's method.  This value is used to compute the
-  // corrected rr.
-  double omega = dot_prod(rr, O);
-  Vector3 lambda = rr - omega * O;
-  const double tau = dot_prod(lambda, lambda) / (omega*omega);
+  // The part of pixel_to_vector() before the distortion is removed.
+  // Returns the ray rr and its part lambda perpendicular to O, and the
+  // coefficients and the starting point for the distortion equation.
+  void cahvor_distorted_ray(CAHVORModel const& cam, Vector2 const& pix, bool flip,
+                            Vector3& rr, Vector3& lambda, double& k3, double& k5, double& u) {
+    // Calculate the projection ray assuming normal vector directions,
+    // neglecting distortion.
+    rr = normalize(cross_prod(cam.V - pix.y() * cam.A,
+                              cam.H - pix.x() * cam.A));
+    if (flip)
+      rr = -1.0 * rr;
+
+    // Remove the radial lens distortion.  Preliminary values of
+    // omega, lambda, and tau are computed from the rr vector
+    // including distortion, in order to obtain the coefficients of
+    // the equation k5*u^5 + k3*u^3 + k1*u = 1, which is solved for u
+    // by means of Newton's method.  This value is used to compute the
+    // corrected rr.
+    double omega = dot_prod(rr, cam.O);
+    lambda = rr - omega * cam.O;
+    const double tau = dot_prod(lambda, lambda) / (omega*omega);
+
+    k3 = cam.R(1) * tau;      //  rho1*tau
+    k5 = cam.R(2) * tau*tau;  //  rho2*tau^2
+    u  = 1.0 - (cam.R(0) + k3 + k5); // initial approximation for iterations
+  }
 
-  const double k1 = 1 + R(0);        //  1 + rho0
-  const double k3 = R(1) * tau;      //  rho1*tau
-  const double k5 = R(2) * tau*tau;  //  rho2*tau^2
+} // end anonymous namespace
 
-  double u = 1.0 - (R(0) + k3 + k5); // initial approximation for iterations
+// pixel_to_vector (no returned partial matrix)
+Vector3 CAHVORModel::pixel_to_vector(Vector2 const& pix) const {
+  // Based on JPL_CMOD_CAHVOR_2D_TO_3D
 
-  double du, poly, deriv;
-  for (int32 i=0;; i++) {
-    if (i >= VW_CAHVOR_MAXITER) {
-      vw_out(InfoMessage, "camera") << "CAHVORModel.pixel_to_vector(): Too many iterations (" << i << ")\n";
-      break;
-    }
+  // Check and optionally correct for vector directions.
+  const bool flip = dot_prod(cross_prod(V,H), A) < 0;
 
-    double u_2 = u*u;
-    poly  =  ((k5*u_2  +  k3)*u_2 + k1)*u - 1;
-    deriv = (5*k5*u_2 + 3*k3)*u_2 + k1;
+  Vector3 rr, lambda;
+  double  k3, k5, u;
+  cahvor_distorted_ray(*this, pix, flip, rr, lambda, k3, k5, u);
 
-    if (deriv <= 0) {
-      vw_out(InfoMessage, "camera") << "CAHVORModel.pixel_to_vector(): Distortion is too negative\n";
-      break;
-    } else {
-      du = poly/deriv;
-      u -= du;
-      if (fabs(du) < VW_CAHVOR_CONV)
-        break;
-    }
-  }
+  const double k1 = 1 + R(0);  //  1 + rho0
+  const double one = 1.0;
+  int status;
+  solve_cahvor_distortion(1, &k1, &k3, &k5, &one, &u,
+                          VW_CAHVOR_CONV, VW_CAHVOR_MAXITER, true, &status);
+  log_cahvor_distortion_status(status);
 
   return normalize(rr - (1 - u)*lambda);
 }
 
+void CAHVORModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>      & centers,
+                                 std::vector<Vector3>      & directions) const {
+  const size_t num = pixels.size();
+  centers.assign(num, C);
+  directions.resize(num);
+  if (num == 0)
+    return;
+
+  // Same steps as pixel_to_vector(), with the distortion of all the
+  // pixels removed in one call.
+  const bool flip = dot_prod(cross_prod(V,H), A) < 0;
+  std::vector<Vector3> lambdas(num);
+  std::vector<double>  k1(num, 1 + R(0)), k3(num), k5(num), ones(num, 1.0), u(num);
+  std::vector<int>     status(num);
+  for (size_t i = 0; i < num; ++i)
+    cahvor_distorted_ray(*this, pixels[i], flip, directions[i], lambdas[i], k3[i], k5[i], u[i]);
+
+  solve_cahvor_distortion(num, &k1[0], &k3[0], &k5[0], &ones[0], &u[0],
+                          VW_CAHVOR_CONV, VW_CAHVOR_MAXITER, true, &status[0]);
+
+  for (size_t i = 0; i < num; ++i) {
+    log_cahvor_distortion_status(status[i]);
+    directions[i] = normalize(directions[i] - (1 - u[i])*lambdas[i]);
+  }
+}
+
 Vector3 CAHVORModel::camera_center( Vector2 const& pix ) const { return C; }
 
 // vector_to_pixel with partial_derivatives
@@ -30,6 +30,7 @@
 #include <vw/Camera/CameraModel.h>
 
 #include <string>
+#include <vector>
 
 namespace vw {
 namespace camera {
@@ -65,6 +66,12 @@ namespace camera {
     virtual Vector3 pixel_to_vector(Vector2 const& pix) const;
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const;
 
+    /// Batch version of pixel_to_vector().  The distortion of all of
+    /// the pixels is removed together with solve_cahvor_distortion().
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>      & centers,
+                                std::vector<Vector3>      & directions) const;
+
     // Overloaded versions also return partial derviatives in a Matrix.
     Vector2 point_to_pixel(Vector3 const& point, Matrix<double> &partial_derivatives) const;
     Vector3 pixel_to_vector(Vector2 const& pix, Matrix<double> &partial_derivatives) const;
@@ -87,6 +94,27 @@ namespace camera {
     Vector3   R;
   };
 
+  /// Result of solve_cahvor_distortion() for one equation.
+  enum CahvorDistortionStatus {
+    CahvorDistortionConverged = 0,
+    CahvorDistortionNegative  = 1, ///< The derivative was not positive, stopped early.
+    CahvorDistortionMaxSteps  = 2  ///< Used all of the steps without converging.
+  };
+
+  /// Solve the radial distortion equations of the CAHVOR and CAHVORE
+  /// models, a*x + b*x^3 + c*x^5 = d, for num equations at once.
+  /// Newton's method starts from the values in x, which are replaced
+  /// with the solutions.  Each equation stops once a step is smaller
+  /// than tol or after max_steps steps, and when check_derivative is
+  /// set, before any step where the derivative is not positive.
+  /// Equations are solved in lockstep two at a time with SSE2 when it
+  /// is enabled.  Each lane does the same arithmetic as the scalar
+  /// code, so the results are identical.
+  void solve_cahvor_distortion(size_t num, double const* a, double const* b,
+                               double const* c, double const* d, double* x,
+                               double tol, int max_steps, bool check_derivative,
+                               int* status);
+
   /// Function to "map" the CAHVOR parameters into CAHV parameters:
   /// requires dimensions of input image and output image (usually the
   /// same) You must supply the dimensions of the CAHVOR image that
@@ -0,0 +1,139 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Camera/CameraCache.h>
+#include <vw/Camera/CameraModel.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Camera/CAHVModel.h>
+#include <vw/Camera/CAHVORModel.h>
+#include <vw/Camera/CAHVOREModel.h>
+
+#include <cstring>
+#include <fstream>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/iostreams/stream.hpp>
+
+namespace io = boost::iostreams;
+
+using namespace vw;
+using namespace vw::camera;
+using vw::camera::detail::write_binary;
+using vw::camera::detail::read_binary;
+
+namespace {
+  // The last character is the format version.
+  const char CAMERA_CACHE_MAGIC[8] = {'V','W','C','A','M','C','1','\0'};
+
+  // Guard against reading a file from a machine of the other byte order.
+  const uint32 CAMERA_CACHE_BYTE_ORDER = 0x01020304;
+}
+
+void camera::write_camera_cache(std::string const& filename, CameraModel const& camera) {
+  std::ofstream f(filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!f.is_open())
+    vw_throw( IOErr() << "write_camera_cache: Could not open file: " << filename );
+
+  f.write(CAMERA_CACHE_MAGIC, sizeof(CAMERA_CACHE_MAGIC));
+  write_binary(f, CAMERA_CACHE_BYTE_ORDER);
+
+  if (PinholeModel const* pinhole = dynamic_cast<PinholeModel const*>(&camera)) {
+    write_binary(f, std::string("Pinhole"));
+    pinhole->write_binary(f);
+  } else if (CAHVOREModel const* cahvore = dynamic_cast<CAHVOREModel const*>(&camera)) {
+    write_binary(f, std::string("CAHVORE"));
+    write_binary(f, cahvore->C);  write_binary(f, cahvore->A);
+    write_binary(f, cahvore->H);  write_binary(f, cahvore->V);
+    write_binary(f, cahvore->O);  write_binary(f, cahvore->R);
+    write_binary(f, cahvore->E);  write_binary(f, cahvore->P);
+  } else if (CAHVORModel const* cahvor = dynamic_cast<CAHVORModel const*>(&camera)) {
+    write_binary(f, std::string("CAHVOR"));
+    write_binary(f, cahvor->C);  write_binary(f, cahvor->A);
+    write_binary(f, cahvor->H);  write_binary(f, cahvor->V);
+    write_binary(f, cahvor->O);  write_binary(f, cahvor->R);
+  } else if (CAHVModel const* cahv = dynamic_cast<CAHVModel const*>(&camera)) {
+    write_binary(f, std::string("CAHV"));
+    write_binary(f, cahv->C);  write_binary(f, cahv->A);
+    write_binary(f, cahv->H);  write_binary(f, cahv->V);
+  } else {
+    vw_throw( NoImplErr() << "write_camera_cache: Cameras of type " << camera.type()
+                          << " cannot be cached." );
+  }
+
+  if (!f)
+    vw_throw( IOErr() << "write_camera_cache: Failed writing: " << filename );
+}
+
+bool camera::is_camera_cache(std::string const& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary | std::ios::in);
+  char magic[sizeof(CAMERA_CACHE_MAGIC)];
+  return f.read(magic, sizeof(magic)) &&
+         std::memcmp(magic, CAMERA_CACHE_MAGIC, sizeof(magic)) == 0;
+}
+
+boost::shared_ptr<CameraModel> camera::read_camera_cache(std::string const& filename) {
+  io::mapped_file_source file;
+  try {
+    file.open(filename);
+  } catch (const std::exception& e) {
+    vw_throw( IOErr() << "read_camera_cache: Could not open file: " << filename );
+  }
+  io::stream<io::array_source> is(file.data(), file.size());
+
+  char   magic[sizeof(CAMERA_CACHE_MAGIC)];
+  uint32 byte_order = 0;
+  if (!is.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, CAMERA_CACHE_MAGIC, sizeof(magic)) != 0)
+    vw_throw( IOErr() << "read_camera_cache: \"" << filename << "\" is not a camera cache." );
+  read_binary(is, byte_order);
+  if (byte_order != CAMERA_CACHE_BYTE_ORDER)
+    vw_throw( IOErr() << "read_camera_cache: \"" << filename
+                      << "\" was written on a machine of different byte order." );
+
+  std::string type;
+  read_binary(is, type);
+  if (type == "Pinhole") {
+    boost::shared_ptr<PinholeModel> pinhole(new PinholeModel);
+    pinhole->read_binary(is);
+    return pinhole;
+  }
+  if (type == "CAHVORE") {
+    boost::shared_ptr<CAHVOREModel> cahvore(new CAHVOREModel);
+    read_binary(is, cahvore->C);  read_binary(is, cahvore->A);
+    read_binary(is, cahvore->H);  read_binary(is, cahvore->V);
+    read_binary(is, cahvore->O);  read_binary(is, cahvore->R);
+    read_binary(is, cahvore->E);  read_binary(is, cahvore->P);
+    return cahvore;
+  }
+  if (type == "CAHVOR") {
+    boost::shared_ptr<CAHVORModel> cahvor(new CAHVORModel);
+    read_binary(is, cahvor->C);  read_binary(is, cahvor->A);
+    read_binary(is, cahvor->H);  read_binary(is, cahvor->V);
+    read_binary(is, cahvor->O);  read_binary(is, cahvor->R);
+    return cahvor;
+  }
+  if (type == "CAHV") {
+    boost::shared_ptr<CAHVModel> cahv(new CAHVModel);
+    read_binary(is, cahv->C);  read_binary(is, cahv->A);
+    read_binary(is, cahv->H);  read_binary(is, cahv->V);
+    return cahv;
+  }
+  vw_throw( IOErr() << "read_camera_cache: Unknown camera type \"" << type
+                    << "\" in: " << filename );
+  return boost::shared_ptr<CameraModel>();
+}
@@ -0,0 +1,129 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file CameraCache.h
+///
+/// A compact binary file for camera models, for processes which load
+/// the same cameras many times.  It holds the parameters at full
+/// precision along with precomputed state such as the distortion
+/// lookup grids of a PinholeModel, and is read through a memory map.
+/// The text formats remain the interchange format; a cache file is
+/// specific to the machine and Vision Workbench version that wrote it.
+///
+#ifndef __VW_CAMERA_CAMERACACHE_H__
+#define __VW_CAMERA_CAMERACACHE_H__
+
+#include <vw/Core/Exception.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+namespace camera {
+
+  class CameraModel;
+
+  /// Write a camera to a cache file.  PinholeModel (with any distortion
+  /// grids), CAHVModel, CAHVORModel and CAHVOREModel are supported.
+  void write_camera_cache(std::string const& filename, CameraModel const& camera);
+
+  /// Load a camera written by write_camera_cache().
+  boost::shared_ptr<CameraModel> read_camera_cache(std::string const& filename);
+
+  /// Return true if the file starts like a camera cache file.
+  bool is_camera_cache(std::string const& filename);
+
+  namespace detail {
+
+    // Raw reads and writes of the values in a cache file.
+
+    template <class T>
+    inline void write_binary(std::ostream& os, T const& value) {
+      os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    template <class T>
+    inline void read_binary(std::istream& is, T& value) {
+      if (!is.read(reinterpret_cast<char*>(&value), sizeof(T)))
+        vw_throw( IOErr() << "Unexpected end of camera cache data.\n" );
+    }
+
+    template <class ElemT, size_t SizeN>
+    inline void write_binary(std::ostream& os, Vector<ElemT,SizeN> const& v) {
+      for (size_t i = 0; i < SizeN; i++)
+        write_binary(os, v[i]);
+    }
+    template <class ElemT, size_t SizeN>
+    inline void read_binary(std::istream& is, Vector<ElemT,SizeN>& v) {
+      for (size_t i = 0; i < SizeN; i++)
+        read_binary(is, v[i]);
+    }
+
+    template <class ElemT, size_t RowsN, size_t ColsN>
+    inline void write_binary(std::ostream& os, Matrix<ElemT,RowsN,ColsN> const& m) {
+      for (size_t r = 0; r < RowsN; r++)
+        for (size_t c = 0; c < ColsN; c++)
+          write_binary(os, m(r,c));
+    }
+    template <class ElemT, size_t RowsN, size_t ColsN>
+    inline void read_binary(std::istream& is, Matrix<ElemT,RowsN,ColsN>& m) {
+      for (size_t r = 0; r < RowsN; r++)
+        for (size_t c = 0; c < ColsN; c++)
+          read_binary(is, m(r,c));
+    }
+
+    inline void write_binary(std::ostream& os, std::string const& s) {
+      write_binary(os, uint64(s.size()));
+      os.write(s.data(), s.size());
+    }
+    inline void read_binary(std::istream& is, std::string& s) {
+      uint64 size;
+      read_binary(is, size);
+      if (size > (uint64(1) << 30))
+        vw_throw( IOErr() << "Bad string in camera cache data.\n" );
+      s.resize(size);
+      if (size > 0 && !is.read(&s[0], size))
+        vw_throw( IOErr() << "Unexpected end of camera cache data.\n" );
+    }
+
+    /// Vectors of plain values are written in one block.
+    template <class T>
+    inline void write_binary(std::ostream& os, std::vector<T> const& v) {
+      write_binary(os, uint64(v.size()));
+      if (!v.empty())
+        os.write(reinterpret_cast<const char*>(&v[0]), sizeof(T)*v.size());
+    }
+    template <class T>
+    inline void read_binary(std::istream& is, std::vector<T>& v) {
+      uint64 size;
+      read_binary(is, size);
+      if (size > (uint64(1) << 34) / sizeof(T))
+        vw_throw( IOErr() << "Bad array in camera cache data.\n" );
+      v.resize(size);
+      if (size > 0 && !is.read(reinterpret_cast<char*>(&v[0]), sizeof(T)*size))
+        vw_throw( IOErr() << "Unexpected end of camera cache data.\n" );
+    }
+
+  } // end namespace detail
+
+}} // namespace vw::camera
+
+#endif // __VW_CAMERA_CAMERACACHE_H__
@@ -45,6 +45,34 @@ CameraModel::camera_pose(Vector2 const& pix) const {
   return Quaternion<double>();
 }
 
+void CameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                 std::vector<Vector3>      & centers,
+                                 std::vector<Vector3>      & directions) const {
+  centers.resize(pixels.size());
+  directions.resize(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    try {
+      directions[i] = pixel_to_vector(pixels[i]);
+      centers   [i] = camera_center  (pixels[i]);
+    } catch (const PixelToRayErr& /*e*/) {
+      centers   [i] = Vector3();
+      directions[i] = Vector3();
+    }
+  }
+}
+
+void CameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                   std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    try {
+      pixels[i] = point_to_pixel(points[i]);
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = invalid_pixel();
+    }
+  }
+}
+
 AdjustedCameraModel::AdjustedCameraModel(boost::shared_ptr<CameraModel> camera_model,
                                          Vector3 const& translation, Quat const& rotation,
                                          Vector2 const& pixel_offset, double scale) :
@@ -124,6 +152,37 @@ Quat AdjustedCameraModel::camera_pose(Vector2 const& pix) const {
   return m_rotation*m_camera->camera_pose(m_scale*pix + m_pixel_offset);
 }
 
+void AdjustedCameraModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                         std::vector<Vector3>      & centers,
+                                         std::vector<Vector3>      & directions) const {
+  std::vector<Vector2> camera_pixels(pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i)
+    camera_pixels[i] = m_scale*pixels[i] + m_pixel_offset;
+  m_camera->pixels_to_rays(camera_pixels, centers, directions);
+
+  // Apply the same adjustments as pixel_to_vector() and camera_center()
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    if (directions[i] == Vector3())
+      continue; // No ray for this pixel
+    directions[i] = m_rotation.rotate(directions[i]);
+    centers   [i] = m_rotation.rotate(centers[i] - m_rotation_center) + m_rotation_center + m_translation;
+  }
+}
+
+void AdjustedCameraModel::points_to_pixels(std::vector<Vector3> const& points,
+                                           std::vector<Vector2>      & pixels) const {
+  std::vector<Vector3> camera_points(points.size());
+  for (size_t i = 0; i < points.size(); ++i)
+    camera_points[i] = this->adjusted_point(points[i]);
+  m_camera->points_to_pixels(camera_points, pixels);
+
+  // Apply the same adjustment as point_to_pixel()
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    if (pixels[i] != invalid_pixel())
+      pixels[i] = (pixels[i] - m_pixel_offset)/m_scale;
+  }
+}
+
 // Modify the adjustments by applying on top of them a scale*rotation + translation
 // transform with the origin at the center of the planet (such as output
 // by pc_align's forward or inverse computed alignment transform). 
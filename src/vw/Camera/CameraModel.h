@@ -25,6 +25,7 @@
 #define __VW_CAMERA_CAMERAMODEL_H__
 
 #include <fstream>
+#include <vector>
 #include <vw/Core/Exception.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
@@ -88,6 +89,28 @@ namespace camera {
     /// - Generally the input pixel is only used for linescan cameras.
     virtual Vector3 camera_center(Vector2 const& pix) const = 0;
 
+    /// Batch version of camera_center() and pixel_to_vector(), for
+    /// callers such as stereo triangulation which need the rays for a
+    /// whole row of pixels.  The default implementation calls the
+    /// single pixel methods; camera models which can share work
+    /// between pixels should override it.
+    /// - A pixel for which the ray cannot be computed (the single
+    ///   pixel methods throw a PixelToRayErr) gets a zero direction.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>      & centers,
+                                std::vector<Vector3>      & directions) const;
+
+    /// Batch version of point_to_pixel(), for callers such as
+    /// mapprojection which project a whole tile of ground points.  The
+    /// default implementation calls point_to_pixel() for each point;
+    /// camera models whose projection is iterative can do better by
+    /// starting each point from the solution of the previous one, so
+    /// neighboring points should be passed next to each other.
+    /// - A point which cannot be projected (point_to_pixel() throws a
+    ///   PointToPixelErr) gets invalid_pixel().
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>      & pixels) const;
+
     /// Subclasses must define a method that return the camera type as a string.
     virtual std::string type() const = 0;
 
@@ -184,6 +207,11 @@ namespace camera {
     virtual Vector3 pixel_to_vector(Vector2 const&) const;
     virtual Vector3 camera_center  (Vector2 const&) const;
     virtual Quat    camera_pose    (Vector2 const&) const;
+    virtual void    pixels_to_rays (std::vector<Vector2> const& pixels,
+                                    std::vector<Vector3>      & centers,
+                                    std::vector<Vector3>      & directions) const;
+    virtual void    points_to_pixels(std::vector<Vector3> const& points,
+                                     std::vector<Vector2>      & pixels) const;
 
     Vector3 adjusted_point(Vector3 const& point) const;
     
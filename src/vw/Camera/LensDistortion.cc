@@ -18,8 +18,13 @@
 
 #include <vw/Camera/LensDistortion.h>
 #include <vw/Camera/PinholeModel.h>
+#include <vw/Camera/CameraCache.h>
 #include <vw/Math/LevenbergMarquardt.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using namespace vw;
 using namespace camera;
 
@@ -215,6 +220,54 @@ LensDistortion::distorted_coordinates(const camera::PinholeModel& cam, Vector2 c
   return solution;
 }
 
+void
+LensDistortion::distortion_jacobian(const camera::PinholeModel& cam, Vector2 const& p,
+                                    Matrix2x2         & d_location,
+                                    Matrix<double,2,4>& d_intrinsics,
+                                    Matrix<double>    & d_params) const {
+  // Steps relative to the size of each quantity
+  for (int i = 0; i < 2; i++) {
+    double h = 1e-6*std::max(std::abs(p[i]), 1.0);
+    Vector2 p1 = p, p2 = p;
+    p1[i] += h;
+    p2[i] -= h;
+    select_col(d_location, i) = (distorted_coordinates(cam, p1) -
+                                 distorted_coordinates(cam, p2)) / (2*h);
+  }
+
+  Vector<double,4> intrinsics;
+  subvector(intrinsics, 0, 2) = cam.focal_length();
+  subvector(intrinsics, 2, 2) = cam.point_offset();
+  PinholeModel cam_copy(cam);
+  for (int i = 0; i < 4; i++) {
+    double h = 1e-6*std::max(std::abs(intrinsics[i]), 1.0);
+    Vector2 dist[2];
+    for (int k = 0; k < 2; k++) {
+      Vector<double,4> moved = intrinsics;
+      moved[i] += (k == 0) ? h : -h;
+      cam_copy.set_focal_length(subvector(moved, 0, 2), false);
+      cam_copy.set_point_offset(subvector(moved, 2, 2));
+      dist[k] = distorted_coordinates(cam_copy, p);
+    }
+    select_col(d_intrinsics, i) = (dist[0] - dist[1]) / (2*h);
+  }
+
+  Vector<double> params = distortion_parameters();
+  d_params.set_size(2, params.size());
+  boost::shared_ptr<LensDistortion> lens = copy();
+  for (size_t i = 0; i < params.size(); i++) {
+    double h = 1e-6*std::max(std::abs(params[i]), 1e-3);
+    Vector2 dist[2];
+    for (int k = 0; k < 2; k++) {
+      Vector<double> moved = params;
+      moved[i] += (k == 0) ? h : -h;
+      lens->set_distortion_parameters(moved);
+      dist[k] = lens->distorted_coordinates(cam, p);
+    }
+    select_col(d_params, i) = (dist[0] - dist[1]) / (2*h);
+  }
+}
+
 
 std::ostream& camera::operator<<(std::ostream & os,
                                  const camera::LensDistortion& ld) {
@@ -242,6 +295,16 @@ void NullLensDistortion::read(std::istream & is) {
 
 void NullLensDistortion::scale(double scale) { }
 
+void
+NullLensDistortion::distortion_jacobian(const camera::PinholeModel& /*cam*/, Vector2 const& /*p*/,
+                                        Matrix2x2         & d_location,
+                                        Matrix<double,2,4>& d_intrinsics,
+                                        Matrix<double>    & d_params) const {
+  d_location.set_identity();
+  d_intrinsics.set_zero();
+  d_params.set_size(2, 0);
+}
+
 // ======== TsaiLensDistortion ========
 
 TsaiLensDistortion::TsaiLensDistortion(){
@@ -316,6 +379,56 @@ TsaiLensDistortion::distorted_coordinates(const camera::PinholeModel& cam, Vecto
   return result;
 }
 
+void
+TsaiLensDistortion::distortion_jacobian(const camera::PinholeModel& cam, Vector2 const& p,
+                                        Matrix2x2         & d_location,
+                                        Matrix<double,2,4>& d_intrinsics,
+                                        Matrix<double>    & d_params) const {
+  // Written out from the commonly seen form in distorted_coordinates():
+  //   u' = u + fu * ( x*(k1*r2 + k2*r4) + 2*p1*x*y + p2*(r2 + 2x^2) )
+  //   v' = v + fv * ( y*(k1*r2 + k2*r4) + 2*p2*x*y + p1*(r2 + 2y^2) )
+  // with x = (u-cu)/fu, y = (v-cv)/fv.
+  Vector2 focal  = cam.focal_length();
+  Vector2 offset = cam.point_offset();
+  double k1 = m_distortion[0], k2 = m_distortion[1];
+  double p1 = m_distortion[2], p2 = m_distortion[3];
+
+  double x  = (p[0] - offset[0]) / focal[0];
+  double y  = (p[1] - offset[1]) / focal[1];
+  double r2 = x*x + y*y;
+  double radial  = k1*r2 + k2*r2*r2;
+  double d_radial = 2*(k1 + 2*k2*r2); // d(radial)/dx = d_radial*x
+
+  // Derivatives of the normalized correction g = (gx, gy) in x and y
+  double gx   = x*radial + 2*p1*x*y + p2*(r2 + 2*x*x);
+  double gy   = y*radial + 2*p2*x*y + p1*(r2 + 2*y*y);
+  double gx_x = radial + d_radial*x*x + 2*p1*y + 6*p2*x;
+  double gx_y = d_radial*x*y + 2*p1*x + 2*p2*y;
+  double gy_x = d_radial*x*y + 2*p2*y + 2*p1*x;
+  double gy_y = radial + d_radial*y*y + 2*p2*x + 6*p1*y;
+
+  d_location(0,0) = 1 + gx_x;
+  d_location(0,1) = gx_y * focal[0]/focal[1];
+  d_location(1,0) = gy_x * focal[1]/focal[0];
+  d_location(1,1) = 1 + gy_y;
+
+  // x changes by -x/fu with fu and by -1/fu with cu, and likewise for y.
+  d_intrinsics(0,0) = gx - gx_x*x;
+  d_intrinsics(1,0) = -gy_x*x * focal[1]/focal[0];
+  d_intrinsics(0,1) = -gx_y*y * focal[0]/focal[1];
+  d_intrinsics(1,1) = gy - gy_y*y;
+  d_intrinsics(0,2) = -gx_x;
+  d_intrinsics(1,2) = -gy_x * focal[1]/focal[0];
+  d_intrinsics(0,3) = -gx_y * focal[0]/focal[1];
+  d_intrinsics(1,3) = -gy_y;
+
+  d_params.set_size(2, num_distortion_params);
+  d_params(0,0) = focal[0]*x*r2;            d_params(1,0) = focal[1]*y*r2;
+  d_params(0,1) = focal[0]*x*r2*r2;         d_params(1,1) = focal[1]*y*r2*r2;
+  d_params(0,2) = focal[0]*2*x*y;           d_params(1,2) = focal[1]*(r2 + 2*y*y);
+  d_params(0,3) = focal[0]*(r2 + 2*x*x);    d_params(1,3) = focal[1]*2*x*y;
+}
+
 void TsaiLensDistortion::write(std::ostream & os) const {
   for (size_t p = 0; p < m_distortion_param_names.size(); p++) 
     os << m_distortion_param_names[p] << " = " << m_distortion[p] << "\n";
@@ -398,6 +511,50 @@ BrownConradyDistortion::undistorted_coordinates(const camera::PinholeModel& cam,
   return intermediate+offset;
 }
 
+void
+BrownConradyDistortion::distortion_jacobian(const camera::PinholeModel& cam, Vector2 const& p,
+                                            Matrix2x2         & d_location,
+                                            Matrix<double,2,4>& d_intrinsics,
+                                            Matrix<double>    & d_params) const {
+  // The distorted location d solves U(d, offset, params) = p, so its
+  // derivatives are -inverse(dU/dd) times those of U.
+  Vector2 dist   = distorted_coordinates(cam, p);
+  Vector2 offset = cam.point_offset();
+  Vector2 i      = dist - m_principal_point - offset;
+  double r2 = norm_2_sqr(i);
+  double radial    = 1 + m_radial_distortion[0]*r2 + m_radial_distortion[1]*r2*r2
+                       + m_radial_distortion[2]*r2*r2*r2;
+  double tangental = m_centering_distortion[0]*r2 + m_centering_distortion[1]*r2*r2;
+  double d_radial    = 2*(m_radial_distortion[0] + 2*m_radial_distortion[1]*r2
+                          + 3*m_radial_distortion[2]*r2*r2);
+  double d_tangental = 2*(m_centering_distortion[0] + 2*m_centering_distortion[1]*r2);
+  Vector2 t_dir(-sin(m_centering_angle), cos(m_centering_angle));
+
+  // dU/di, which is also dU/dd
+  Matrix2x2 dU_di;
+  for (int r = 0; r < 2; r++)
+    for (int c = 0; c < 2; c++)
+      dU_di(r,c) = (r == c ? radial : 0) + i[r]*d_radial*i[c] + t_dir[r]*d_tangental*i[c];
+  Matrix2x2 inv_dU = inverse(dU_di);
+
+  d_location = inv_dU;
+
+  // U depends on the point offset through i and directly.
+  Matrix2x2 dU_doffset = identity_matrix<2>() - dU_di;
+  d_intrinsics.set_zero();
+  submatrix(d_intrinsics, 0, 2, 2, 2) = -inv_dU * dU_doffset;
+
+  Matrix<double,2,num_distortion_params> dU_dparams;
+  submatrix(dU_dparams, 0, 0, 2, 2) = -dU_di;
+  select_col(dU_dparams, 2) = i*r2;
+  select_col(dU_dparams, 3) = i*r2*r2;
+  select_col(dU_dparams, 4) = i*r2*r2*r2;
+  select_col(dU_dparams, 5) = t_dir*r2;
+  select_col(dU_dparams, 6) = t_dir*r2*r2;
+  select_col(dU_dparams, 7) = tangental*Vector2(-cos(m_centering_angle), -sin(m_centering_angle));
+  d_params = -inv_dU * dU_dparams;
+}
+
 void BrownConradyDistortion::write(std::ostream& os) const {
   int p = 0;
   os << m_distortion_param_names[p] << "  = " << m_principal_point[0]      << "\n"; p++;
@@ -1323,3 +1480,160 @@ void RPCLensDistortion5::scale( double scale ) {
   m_distortion *= scale;
   m_undistortion *= scale;
 }
+
+
+// ======== DistortionLookupGrid ========
+
+namespace {
+
+  // Evaluate one direction of the distortion model exactly. Returns
+  // false if the solver did not converge.
+  bool exact_distortion(camera::PinholeModel const& cam, camera::LensDistortion const& distortion,
+                        camera::DistortionLookupGrid::Direction direction,
+                        Vector2 const& p, Vector2& result) {
+    try {
+      if (direction == camera::DistortionLookupGrid::Distort)
+        result = distortion.distorted_coordinates(cam, p);
+      else
+        result = distortion.undistorted_coordinates(cam, p);
+    } catch (const vw::Exception&) {
+      return false;
+    }
+    return std::isfinite(result[0]) && std::isfinite(result[1]);
+  }
+
+  // Catmull-Rom weights for the four nodes around a fractional position t.
+  inline void catmull_rom_weights(double t, double w[4]) {
+    double t2 = t*t, t3 = t2*t;
+    w[0] = 0.5*(-t3 + 2*t2 - t);
+    w[1] = 0.5*(3*t3 - 5*t2 + 2);
+    w[2] = 0.5*(-3*t3 + 4*t2 + t);
+    w[3] = 0.5*(t3 - t2);
+  }
+
+} // end anonymous namespace
+
+DistortionLookupGrid::DistortionLookupGrid(PinholeModel const& cam, LensDistortion const& distortion,
+                                           Direction direction, BBox2 const& domain,
+                                           double spacing, double tolerance)
+  : m_spacing(spacing), m_cols(0), m_rows(0), m_max_error(0) {
+
+  VW_ASSERT( spacing > 0,
+             ArgumentErr() << "DistortionLookupGrid: The node spacing must be positive.\n" );
+  VW_ASSERT( !domain.empty(),
+             ArgumentErr() << "DistortionLookupGrid: The domain is empty.\n" );
+
+  // Pad the domain by one node on each side so every cell inside the
+  // domain has the full neighborhood that bicubic interpolation needs.
+  m_origin = domain.min() - Vector2(spacing, spacing);
+  m_cols   = int32(ceil(domain.width () / spacing)) + 3;
+  m_rows   = int32(ceil(domain.height() / spacing)) + 3;
+
+  m_nodes.resize(size_t(m_cols) * m_rows);
+  std::vector<uint8> node_valid(m_nodes.size(), 0);
+  for (int32 r = 0; r < m_rows; r++) {
+    for (int32 c = 0; c < m_cols; c++) {
+      Vector2 p = m_origin + Vector2(c, r) * spacing;
+      node_valid[r*m_cols + c] = exact_distortion(cam, distortion, direction, p,
+                                                  m_nodes[r*m_cols + c]);
+    }
+  }
+
+  // Check each cell against the model at its center and at its quarter
+  // points. The interpolation error is symmetric about the center, so
+  // the center alone would underestimate it.
+  const double check_x[5] = { 0.5, 0.25, 0.75, 0.25, 0.75 };
+  const double check_y[5] = { 0.5, 0.25, 0.25, 0.75, 0.75 };
+  m_cell_valid.assign(size_t(m_cols-1) * (m_rows-1), 0);
+  for (int32 r = 1; r < m_rows-2; r++) {
+    for (int32 c = 1; c < m_cols-2; c++) {
+      bool neighbors_valid = true;
+      for (int32 j = r-1; j <= r+2 && neighbors_valid; j++)
+        for (int32 i = c-1; i <= c+2; i++)
+          neighbors_valid = neighbors_valid && node_valid[j*m_cols + i];
+      if (!neighbors_valid)
+        continue;
+
+      double cell_error = 0;
+      for (int32 k = 0; k < 5 && cell_error <= tolerance; k++) {
+        Vector2 exact;
+        if (!exact_distortion(cam, distortion, direction,
+                              m_origin + (Vector2(c, r) + Vector2(check_x[k], check_y[k])) * spacing,
+                              exact)) {
+          cell_error = std::numeric_limits<double>::infinity();
+          break;
+        }
+        double error = norm_2(interpolate(c, r, check_x[k], check_y[k]) - exact);
+        if (!(error <= cell_error)) // Also catches NaN
+          cell_error = (error == error) ? error : std::numeric_limits<double>::infinity();
+      }
+      if (!(cell_error <= tolerance))
+        continue;
+
+      m_cell_valid[r*(m_cols-1) + c] = 1;
+      m_max_error = std::max(m_max_error, cell_error);
+    }
+  }
+}
+
+double DistortionLookupGrid::coverage() const {
+  if (m_cell_valid.empty())
+    return 0;
+  return double(std::count(m_cell_valid.begin(), m_cell_valid.end(), 1)) / m_cell_valid.size();
+}
+
+bool DistortionLookupGrid::lookup(Vector2 const& p, Vector2& result) const {
+  if (m_nodes.empty())
+    return false;
+
+  double x = (p[0] - m_origin[0]) / m_spacing;
+  double y = (p[1] - m_origin[1]) / m_spacing;
+  if (!(x >= 0 && y >= 0 && x < m_cols-1 && y < m_rows-1)) // Also rejects NaN
+    return false;
+
+  int32 c = int32(x), r = int32(y);
+  if (!m_cell_valid[r*(m_cols-1) + c])
+    return false;
+
+  result = interpolate(c, r, x - c, y - r);
+  return true;
+}
+
+void DistortionLookupGrid::write_binary(std::ostream& os) const {
+  detail::write_binary(os, m_origin);
+  detail::write_binary(os, m_spacing);
+  detail::write_binary(os, m_cols);
+  detail::write_binary(os, m_rows);
+  detail::write_binary(os, m_max_error);
+  detail::write_binary(os, m_nodes);
+  detail::write_binary(os, m_cell_valid);
+}
+
+void DistortionLookupGrid::read_binary(std::istream& is) {
+  detail::read_binary(is, m_origin);
+  detail::read_binary(is, m_spacing);
+  detail::read_binary(is, m_cols);
+  detail::read_binary(is, m_rows);
+  detail::read_binary(is, m_max_error);
+  detail::read_binary(is, m_nodes);
+  detail::read_binary(is, m_cell_valid);
+  if (m_cols < 0 || m_rows < 0 ||
+      m_nodes.size() != size_t(m_cols)*size_t(m_rows) ||
+      m_cell_valid.size() != size_t(std::max(m_cols-1, 0))*size_t(std::max(m_rows-1, 0)))
+    vw_throw( IOErr() << "DistortionLookupGrid: Bad grid in camera cache data.\n" );
+}
+
+Vector2 DistortionLookupGrid::interpolate(int32 col, int32 row, double fx, double fy) const {
+  double wx[4], wy[4];
+  catmull_rom_weights(fx, wx);
+  catmull_rom_weights(fy, wy);
+
+  Vector2 result;
+  for (int32 j = 0; j < 4; j++) {
+    Vector2 row_sum;
+    for (int32 i = 0; i < 4; i++)
+      row_sum += wx[i] * node(col-1+i, row-1+j);
+    result += wy[j] * row_sum;
+  }
+  return result;
+}
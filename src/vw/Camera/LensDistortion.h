@@ -24,9 +24,12 @@
 #define __VW_CAMERA_LENSDISTORTION_H__
 
 #include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/Math/BBox.h>
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 #include <boost/smart_ptr/shared_ptr.hpp>
 
 namespace vw {
@@ -64,6 +67,20 @@ namespace camera {
     
     /// Return true if the undistorted_coordinates() implementation does not use a solver.
     virtual bool has_fast_undistort() const {return false;}
+
+    /// Return true if distortion_jacobian() is worked out analytically
+    /// rather than by finite differences.
+    virtual bool has_analytic_jacobian() const {return false;}
+
+    /// The derivatives of distorted_coordinates() at the undistorted
+    /// location p, with respect to p, to the focal length and point
+    /// offset of the camera (in the order fu, fv, cu, cv), and to the
+    /// parameters in the order of distortion_parameters().  The default
+    /// implementation uses central differences.
+    virtual void distortion_jacobian(const PinholeModel& cam, Vector2 const& p,
+                                     Matrix2x2         & d_location,
+                                     Matrix<double,2,4>& d_intrinsics,
+                                     Matrix<double>    & d_params) const;
     
     /// Write all the distortion parameters to the stream
     virtual void write(std::ostream & os) const = 0;
@@ -110,6 +127,12 @@ namespace camera {
     virtual bool has_fast_distort  () const {return true;}
     virtual bool has_fast_undistort() const {return true;}
 
+    virtual bool has_analytic_jacobian() const {return true;}
+    virtual void distortion_jacobian(const PinholeModel& cam, Vector2 const& p,
+                                     Matrix2x2         & d_location,
+                                     Matrix<double,2,4>& d_intrinsics,
+                                     Matrix<double>    & d_params) const;
+
     virtual boost::shared_ptr<LensDistortion> copy() const;
     virtual void write(std::ostream& os) const;
     virtual void read (std::istream& os);
@@ -153,6 +176,12 @@ namespace camera {
     virtual Vector2 distorted_coordinates(const PinholeModel& cam, Vector2 const& p) const;
     
     virtual bool has_fast_distort  () const {return true;}
+
+    virtual bool has_analytic_jacobian() const {return true;}
+    virtual void distortion_jacobian(const PinholeModel& cam, Vector2 const& p,
+                                     Matrix2x2         & d_location,
+                                     Matrix<double,2,4>& d_intrinsics,
+                                     Matrix<double>    & d_params) const;
     
     virtual void write(std::ostream& os) const;
     virtual void read (std::istream& os);
@@ -194,6 +223,14 @@ namespace camera {
     virtual Vector2 undistorted_coordinates(const PinholeModel&, Vector2 const&) const;
 
     virtual bool has_fast_undistort() const {return true;}
+
+    /// Solves for the distorted location, then differentiates through
+    /// the closed form undistortion.
+    virtual bool has_analytic_jacobian() const {return true;}
+    virtual void distortion_jacobian(const PinholeModel& cam, Vector2 const& p,
+                                     Matrix2x2         & d_location,
+                                     Matrix<double,2,4>& d_intrinsics,
+                                     Matrix<double>    & d_params) const;
     
     virtual void write(std::ostream& os) const;
     virtual void read (std::istream& os);
@@ -441,7 +478,62 @@ namespace camera {
     bool can_undistort() const { return m_can_undistort; }
   };
 
-  
+
+  /// A lookup table for one direction of a lens distortion model.
+  ///
+  /// The exact model is sampled on a regular grid of nodes covering a
+  /// domain.  Lookups between the nodes use bicubic (Catmull-Rom)
+  /// interpolation.  This is meant for models where that direction
+  /// needs a solver.  When the grid is built, each cell is checked
+  /// against the exact model at its center and its four quarter
+  /// points.  A cell fails the check if
+  /// its error exceeds the tolerance, a node it needs could not be
+  /// solved, or it lacks a full 4x4 node neighborhood, as the cells on
+  /// the rim of the grid do.  lookup() returns false for points in
+  /// failed cells and for points outside the grid, so the caller can
+  /// fall back to the exact model there.
+  class DistortionLookupGrid {
+  public:
+    enum Direction { Distort, Undistort };
+
+    DistortionLookupGrid() : m_spacing(0), m_cols(0), m_rows(0), m_max_error(0) {}
+
+    /// Sample the model over domain with nodes spacing apart.  The
+    /// domain and spacing are in the units of the model's inputs.  The
+    /// tolerance is in the units of its outputs.
+    DistortionLookupGrid(PinholeModel const& cam, LensDistortion const& distortion,
+                         Direction direction, BBox2 const& domain,
+                         double spacing, double tolerance);
+
+    bool   empty    () const { return m_nodes.empty(); }
+    double spacing  () const { return m_spacing;   }
+
+    /// The largest error seen at the check points of the cells that passed.
+    double max_error() const { return m_max_error; }
+
+    /// The fraction of the cells that passed the tolerance check.
+    double coverage () const;
+
+    /// Interpolate the model at p.  Returns false if p is not covered by
+    /// a cell that passed the tolerance check.
+    bool lookup(Vector2 const& p, Vector2& result) const;
+
+    /// Save and restore the grid in the raw format of CameraCache.h.
+    void write_binary(std::ostream& os) const;
+    void read_binary (std::istream& is);
+
+  private:
+    Vector2 interpolate(int32 col, int32 row, double fx, double fy) const;
+    Vector2 const& node(int32 col, int32 row) const { return m_nodes[row*m_cols + col]; }
+
+    Vector2              m_origin;
+    double               m_spacing;
+    int32                m_cols, m_rows;      ///< Node counts
+    std::vector<Vector2> m_nodes;
+    std::vector<uint8>   m_cell_valid;        ///< (m_cols-1) x (m_rows-1) cells
+    double               m_max_error;
+  };
+
 }} // namespace vw::camera
 
 #endif // __VW_CAMERA_LENSDISTORTION_H__
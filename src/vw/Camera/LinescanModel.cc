@@ -17,6 +17,8 @@
 
 #include <vw/Camera/LinescanModel.h>
 #include <vw/Camera/CameraSolve.h>
+#include <algorithm>
+#include <cmath>
 
 namespace vw {
 namespace camera {
@@ -28,13 +30,18 @@ Vector2 LinescanModel::point_to_pixel(Vector3 const& point) const {
 
 Vector2 LinescanModel::point_to_pixel(Vector3 const& point, double starty) const {
 
+  Vector2 start = m_image_size / 2.0; // Use the center as the initial guess
+  if (starty >= 0) // If the user provided a line number guess..
+    start[1] = starty;
+  return solve_point_to_pixel(point, start);
+}
+
+Vector2 LinescanModel::solve_point_to_pixel(Vector3 const& point, Vector2 const& start) const {
+
   // Use the generic solver to find the pixel 
   // - This method will be slower but works for more complicated geometries
   CameraGenericLMA model( this, point );
   int status;
-  Vector2 start = m_image_size / 2.0; // Use the center as the initial guess
-  if (starty >= 0) // If the user provided a line number guess..
-    start[1] = starty;
 
   // Solver constants
   const double ABS_TOL = 1e-16;
@@ -50,6 +57,158 @@ Vector2 LinescanModel::point_to_pixel(Vector3 const& point, double starty) const
   return solution;
 }
 
+void LinescanModel::line_plane(double line, Vector3& center, Vector3& normal,
+                               Vector3& first_ray, Vector3& last_ray) const {
+  Vector2 first_pix(0, line), last_pix(samples_per_line() - 1, line);
+  first_ray = pixel_to_vector(first_pix);
+  last_ray  = pixel_to_vector(last_pix);
+  center    = camera_center(first_pix);
+  normal    = normalize(cross_prod(first_ray, last_ray));
+}
+
+namespace {
+  // An entry in the table of line planes used by points_to_pixels().
+  struct LinePlane {
+    double  line;
+    Vector3 center, normal;
+  };
+}
+
+void LinescanModel::points_to_pixels(std::vector<Vector3> const& points,
+                                     std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+  if (points.empty())
+    return;
+
+  // Record the plane of every LINE_BLOCK_SIZE'th line. The signed
+  // distance from a point to these planes changes sign once, between
+  // the two entries that bracket the line that sees the point.
+  std::vector<LinePlane> table;
+  const double last_line = number_of_lines() - 1;
+  Vector3 first_ray, last_ray;
+  try {
+    for (double line = 0; ; line = std::min(line + LINE_BLOCK_SIZE, last_line)) {
+      LinePlane plane;
+      plane.line = line;
+      line_plane(line, plane.center, plane.normal, first_ray, last_ray);
+      table.push_back(plane);
+      if (line >= last_line)
+        break;
+    }
+  } catch (const vw::Exception& /*e*/) {
+    table.clear();
+  }
+  if (table.size() < 2) {
+    CameraModel::points_to_pixels(points, pixels);
+    return;
+  }
+
+  // Secant steps stop once the line is known this well; the final
+  // solver takes it the rest of the way.
+  const double LINE_TOL       = 1e-3;
+  const int    MAX_ITERATIONS = 50;
+
+  double prev_line = -1;
+  for (size_t i = 0; i < points.size(); ++i) {
+    Vector3 const& point = points[i];
+
+    // Bracket the line with the table
+    double f_lo = dot_prod(point - table.front().center, table.front().normal);
+    double f_hi = dot_prod(point - table.back ().center, table.back ().normal);
+    bool   found = false;
+    Vector2 start;
+    if (f_lo * f_hi <= 0) {
+      try {
+        size_t lo = 0, hi = table.size() - 1;
+        while (hi - lo > 1) {
+          size_t mid = (lo + hi) / 2;
+          double f = dot_prod(point - table[mid].center, table[mid].normal);
+          if ((f < 0) == (f_lo < 0)) { lo = mid; f_lo = f; }
+          else                       { hi = mid; f_hi = f; }
+        }
+
+        // Refine it with Illinois secant steps, starting from the line
+        // of the previous point when that is inside the bracket.
+        double a = table[lo].line, b = table[hi].line, fa = f_lo, fb = f_hi;
+        double line = (prev_line > a && prev_line < b) ? prev_line
+                                                       : a - fa*(b - a)/(fb - fa);
+        if (!(fa != fb))
+          line = a;
+        Vector3 center, normal;
+        int side = 0;
+        for (int iter = 0; iter < MAX_ITERATIONS; iter++) {
+          line_plane(line, center, normal, first_ray, last_ray);
+          double f = dot_prod(point - center, normal);
+          if (f == 0)
+            break;
+          if ((f < 0) == (fa < 0)) {
+            a = line; fa = f;
+            if (side == -1) fb /= 2;
+            side = -1;
+          } else {
+            b = line; fb = f;
+            if (side == 1) fa /= 2;
+            side = 1;
+          }
+          double next = a - fa*(b - a)/(fb - fa);
+          bool   done = (std::abs(next - line) < LINE_TOL) || (b - a < LINE_TOL);
+          line = next;
+          if (done)
+            break;
+        }
+
+        // Place the point along the line by its angle from the first ray.
+        Vector3 dir   = normalize(point - center);
+        double  span  = atan2(norm_2(cross_prod(first_ray, last_ray)), dot_prod(first_ray, last_ray));
+        double  angle = atan2(dot_prod(cross_prod(first_ray, dir), normal), dot_prod(first_ray, dir));
+        start = Vector2((samples_per_line() - 1) * angle / span, line);
+        found = true;
+      } catch (const vw::Exception& /*e*/) {
+        found = false; // A line did not produce rays
+      }
+    }
+
+    try {
+      if (found)
+        pixels[i] = solve_point_to_pixel(point, start);
+      else
+        pixels[i] = point_to_pixel(point, prev_line);
+      prev_line = pixels[i][1];
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = invalid_pixel();
+    }
+  }
+}
+
+
+Vector3 LinescanModel::camera_center(Vector2 const& pix) const {
+  Vector3 result;
+  if (m_line_cache && m_line_cache->center(pix.y(), result))
+    return result;
+  return get_camera_center_at_time(get_time_at_line(pix.y()));
+}
+
+Quat LinescanModel::camera_pose(Vector2 const& pix) const {
+  Quat result;
+  if (m_line_cache && m_line_cache->pose(pix.y(), result))
+    return result;
+  return get_camera_pose_at_time(get_time_at_line(pix.y()));
+}
+
+Vector3 LinescanModel::camera_velocity(Vector2 const& pix) const {
+  Vector3 result;
+  if (m_line_cache && m_line_cache->velocity(pix.y(), result))
+    return result;
+  return get_camera_velocity_at_time(get_time_at_line(pix.y()));
+}
+
+void LinescanModel::build_line_cache(double line_stride) {
+  m_line_cache.reset(new LinescanLineCache(*this, line_stride));
+}
+
+void LinescanModel::clear_line_cache() {
+  m_line_cache.reset();
+}
 
 Vector3 LinescanModel::pixel_to_vector(Vector2 const& pixel) const {
   try {
@@ -78,6 +237,124 @@ Vector3 LinescanModel::pixel_to_vector(Vector2 const& pixel) const {
   }
 }
 
+void LinescanModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                   std::vector<Vector3>      & centers,
+                                   std::vector<Vector3>      & directions) const {
+  centers.resize(pixels.size());
+  directions.resize(pixels.size());
+
+  // Values which only depend on the line of the pixel
+  bool    have_line = false;
+  double  line = 0;
+  Quat    pose;
+  Vector3 cam_ctr, cam_vel;
+
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    Vector2 const& pixel = pixels[i];
+    try {
+      if (!have_line || (pixel.y() != line)) {
+        have_line = false;
+        pose    = camera_pose  (pixel);
+        cam_ctr = camera_center(pixel);
+        if (m_correct_velocity_aberration)
+          cam_vel = camera_velocity(pixel);
+        line      = pixel.y();
+        have_line = true;
+      }
+
+      // Same steps as pixel_to_vector()
+      Vector3 output_vector = pose.rotate(get_local_pixel_vector(pixel));
+      if (!m_correct_atmospheric_refraction)
+        output_vector = apply_atmospheric_refraction_correction(cam_ctr, m_mean_earth_radius,
+                                                                m_mean_surface_elevation, output_vector);
+      if (m_correct_velocity_aberration)
+        output_vector = apply_velocity_aberration_correction(cam_ctr, cam_vel,
+                                                             m_mean_earth_radius, output_vector);
+      centers   [i] = cam_ctr;
+      directions[i] = output_vector;
+    } catch(const vw::Exception& /*e*/) {
+      // pixel_to_vector() would have thrown a PixelToRayErr here
+      centers   [i] = Vector3();
+      directions[i] = Vector3();
+    }
+  }
+}
+
+LinescanLineCache::LinescanLineCache(LinescanModel const& model, double line_stride) :
+  m_line_stride(line_stride) {
+  VW_ASSERT(line_stride > 0, ArgumentErr() << "LinescanLineCache: The line stride must be positive.");
+
+  // Cover the image with one extra sample on each side.
+  const double last_line = model.number_of_lines() - 1;
+  size_t num_samples = size_t(std::ceil(last_line / line_stride)) + 3;
+  m_first_line = -line_stride;
+
+  m_centers.resize(num_samples);
+  m_poses.resize(num_samples);
+  for (size_t i = 0; i < num_samples; ++i) {
+    double time = model.get_time_at_line(m_first_line + i*line_stride);
+    m_centers[i] = model.get_camera_center_at_time(time);
+    m_poses  [i] = model.get_camera_pose_at_time  (time);
+
+    // Keep neighboring quaternions in the same hemisphere so that
+    // blending them takes the short way around.
+    if (i > 0) {
+      double dot = 0;
+      for (size_t k = 0; k < 4; ++k)
+        dot += m_poses[i][k]*m_poses[i-1][k];
+      if (dot < 0)
+        m_poses[i] = -m_poses[i];
+    }
+  }
+
+  // The velocity is only used for aberration correction and some
+  // models don't provide it.
+  try {
+    m_velocities.resize(num_samples);
+    for (size_t i = 0; i < num_samples; ++i)
+      m_velocities[i] = model.get_camera_velocity_at_time
+        (model.get_time_at_line(m_first_line + i*line_stride));
+  } catch (const vw::Exception& /*e*/) {
+    m_velocities.clear();
+  }
+}
+
+bool LinescanLineCache::locate(double line, size_t& index, double& fraction) const {
+  double position = (line - m_first_line) / m_line_stride;
+  if (!(position >= 0) || position > double(m_centers.size() - 1))
+    return false;
+  index = std::min(size_t(position), m_centers.size() - 2);
+  fraction = position - double(index);
+  return true;
+}
+
+bool LinescanLineCache::center(double line, Vector3& result) const {
+  size_t i;
+  double f;
+  if (!locate(line, i, f))
+    return false;
+  result = m_centers[i] + f*(m_centers[i+1] - m_centers[i]);
+  return true;
+}
+
+bool LinescanLineCache::velocity(double line, Vector3& result) const {
+  size_t i;
+  double f;
+  if (m_velocities.empty() || !locate(line, i, f))
+    return false;
+  result = m_velocities[i] + f*(m_velocities[i+1] - m_velocities[i]);
+  return true;
+}
+
+bool LinescanLineCache::pose(double line, Quat& result) const {
+  size_t i;
+  double f;
+  if (!locate(line, i, f))
+    return false;
+  result = normalize(m_poses[i]*(1.0 - f) + m_poses[i+1]*f);
+  return true;
+}
+
 /*
 std::ostream& operator<<( std::ostream& os, LinescanModel const& camera_model) {
   os << "\n-------------------- Linescan Camera Model -------------------\n\n";
@@ -89,4 +366,3 @@ std::ostream& operator<<( std::ostream& os, LinescanModel const& camera_model) {
 */
 
 }} // namespace vw::camera
-
@@ -28,9 +28,13 @@
 #include <vw/Math/LevenbergMarquardt.h>
 #include <vw/Camera/CameraModel.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace vw {
 namespace camera {
 
+  class LinescanLineCache;
+
   /// This is a generic line scan camera model that can be derived
   /// from to help implement specific cameras.  Some parts (velocity
   /// and atmospheric correction) currently only work for Earth.
@@ -81,14 +85,26 @@ namespace camera {
     virtual Vector3 pixel_to_vector(Vector2 const& pix) const;
 
     /// Gives the camera position in world coordinates.
-    virtual Vector3 camera_center(Vector2 const& pix) const {
-      return get_camera_center_at_time(get_time_at_line(pix.y()));
-    }
+    virtual Vector3 camera_center(Vector2 const& pix) const;
 
     /// Gives a pose vector which represents the rotation from camera to world units
-    virtual Quat camera_pose(Vector2 const& pix) const {
-      return get_camera_pose_at_time(get_time_at_line(pix.y()));
-    }
+    virtual Quat camera_pose(Vector2 const& pix) const;
+
+    /// Batch version of pixel_to_vector() and camera_center().  The
+    /// pose and position are only looked up again when the line
+    /// changes, so a row of pixels shares one lookup.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>      & centers,
+                                std::vector<Vector3>      & directions) const;
+
+    /// Batch version of point_to_pixel().  The line seeing each point
+    /// is found in one dimension first: a table of the planes swept by
+    /// every LINE_BLOCK_SIZE'th line brackets it, and secant steps on
+    /// the distance from the point to the plane of a line refine it,
+    /// starting from the line found for the previous point.  The pixel
+    /// is then polished with the same solver point_to_pixel() uses.
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>      & pixels) const;
 
     // -- These are new functions --
 
@@ -99,9 +115,17 @@ namespace camera {
     int number_of_lines () const { return m_image_size[1]; }
     
     /// Gives the camera velocity in world coordinates.
-    Vector3 camera_velocity(vw::Vector2 const& pix) const {
-      return get_camera_velocity_at_time(get_time_at_line(pix.y()));
-    }
+    Vector3 camera_velocity(vw::Vector2 const& pix) const;
+
+    /// Sample the camera center, velocity and pose every line_stride
+    /// lines, so that camera_center(), camera_velocity() and
+    /// camera_pose() interpolate between the samples instead of
+    /// evaluating the get_*_at_time() functions.  Lines more than one
+    /// stride outside the image are still evaluated directly.  Rebuild
+    /// or clear the cache after changing the model.
+    void build_line_cache(double line_stride = 1.0);
+    void clear_line_cache();
+    bool has_line_cache() const { return m_line_cache.get() != 0; }
     
     // New functions for Linescan derived classes.
     // - Most of these deal with the fact that the camera is moving while
@@ -127,6 +151,9 @@ namespace camera {
     //   linescan cameras may be able to use more specific implementation.
     virtual Vector2 point_to_pixel(vw::Vector3 const& point, double starty) const;
 
+    /// Lines between the entries of the plane table used by points_to_pixels().
+    static const int LINE_BLOCK_SIZE = 64;
+
   protected:
 
     /// Image size in pixels: [num lines, num samples]
@@ -142,12 +169,48 @@ namespace camera {
     /// Set this flag to enable atmospheric refraction correction.
     bool m_correct_atmospheric_refraction;
 
+    /// Optional samples of the camera motion, see build_line_cache().
+    boost::shared_ptr<const LinescanLineCache> m_line_cache;
+
   protected:
 
     /// Returns the radius of the Earth under the current camera position.
     double get_earth_radius() const;
 
+    /// Solve for the pixel observing a point, starting from the given pixel.
+    Vector2 solve_point_to_pixel(Vector3 const& point, Vector2 const& start) const;
+
+    /// The plane swept by the rays of a line, as the camera center and
+    /// the unit normal.  Also returns the rays of the first and last
+    /// sample of the line.
+    void line_plane(double line, Vector3& center, Vector3& normal,
+                    Vector3& first_ray, Vector3& last_ray) const;
+
   }; // End class LinescanModel
+
+  /// Camera center, velocity and pose of a LinescanModel sampled at
+  /// evenly spaced lines.  The center and velocity are interpolated
+  /// linearly between samples, and the pose with a normalized linear
+  /// blend of the two neighboring quaternions.
+  class LinescanLineCache {
+  public:
+    LinescanLineCache(LinescanModel const& model, double line_stride);
+
+    double line_stride() const { return m_line_stride; }
+
+    /// Each returns false if the line is outside the sampled range.
+    bool center  (double line, Vector3& result) const;
+    bool velocity(double line, Vector3& result) const;
+    bool pose    (double line, Quat   & result) const;
+
+  private:
+    /// Find the sample before a line and the fraction of the way to the next one.
+    bool locate(double line, size_t& index, double& fraction) const;
+
+    double               m_first_line, m_line_stride;
+    std::vector<Vector3> m_centers, m_velocities;
+    std::vector<Quat>    m_poses;
+  };
   
 /*
   /// Output stream method for printing a summary of the linear
@@ -20,6 +20,8 @@
 #include <vw/Camera/CameraSolve.h>
 #include <vw/Camera/OpticalBarModel.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <boost/filesystem/convenience.hpp>
 
@@ -70,7 +72,9 @@ double OpticalBarModel::pixel_to_time_delta(Vector2 const& pix) const {
 
 Vector3 OpticalBarModel::get_velocity(vw::Vector2 const& pixel) const {
 
-  // TODO: For speed, store the pose*velocity vector.
+  if (m_scan_table)
+    return m_scan_table->velocity();
+
   // Convert the velocity from sensor coords to GCC coords
   Matrix3x3 pose = camera_pose(pixel).rotation_matrix();
 
@@ -82,6 +86,10 @@ Vector3 OpticalBarModel::get_velocity(vw::Vector2 const& pixel) const {
 }
 
 Vector3 OpticalBarModel::camera_center(Vector2 const& pix) const {
+  OpticalBarColumn column;
+  if (m_scan_table && m_scan_table->column(pix[0], column))
+    return column.center;
+
   // We model with a constant velocity.
   double dt = pixel_to_time_delta(pix);
 
@@ -90,58 +98,80 @@ Vector3 OpticalBarModel::camera_center(Vector2 const& pix) const {
 
 
 Quat OpticalBarModel::camera_pose(Vector2 const& pix) const {
+  if (m_scan_table)
+    return m_scan_table->pose();
+
   // Camera pose is treated as constant for the duration of a scan.
   return axis_angle_to_quaternion(m_initial_orientation);
 }
 
-Vector3 OpticalBarModel::pixel_to_vector_uncorrected(Vector2 const& pixel) const {
- 
-  Vector2 sensor_plane_pos = pixel_to_sensor_plane(pixel);
-  Vector3 cam_center       = camera_center(pixel);
-  Quat    cam_pose         = camera_pose  (pixel);
+OpticalBarColumn OpticalBarModel::scan_column(double col, Vector3 const& velocity) const {
+  OpticalBarColumn result;
+  if (m_scan_table && m_scan_table->column(col, result))
+    return result;
+  return compute_scan_column(col, velocity);
+}
+
+OpticalBarColumn OpticalBarModel::compute_scan_column(double col, Vector3 const& velocity) const {
+
+  OpticalBarColumn result;
+  result.center = m_initial_position + pixel_to_time_delta(Vector2(col, 0))*velocity;
 
   // This is the horizontal angle away from the center point (from straight out of the camera)
-  double alpha = sensor_to_alpha(sensor_plane_pos);
+  double alpha = sensor_to_alpha(pixel_to_sensor_plane(Vector2(col, 0)));
+  result.sin_alpha = sin(alpha);
+  result.cos_alpha = cos(alpha);
 
   // Distance from the camera center to the ground.
-  double H = norm_2(cam_center) - (m_mean_surface_elevation + m_mean_earth_radius);
+  double H = norm_2(result.center) - (m_mean_surface_elevation + m_mean_earth_radius);
 
   // Distortion caused by compensation for the satellite's forward motion during the image.
   // - The film was actually translated underneath the lens to compensate for the motion.
-  double image_motion_compensation = ((m_focal_length * m_speed) / (H*m_scan_rate_radians))
-                                      * sin(alpha) * m_motion_compensation;
+  result.motion_compensation = ((m_focal_length * m_speed) / (H*m_scan_rate_radians))
+                               * result.sin_alpha * m_motion_compensation;
   if (!m_scan_left_to_right) // Sync alpha with motion compensation.
-    image_motion_compensation *= -1.0;
+    result.motion_compensation *= -1.0;
 
+  return result;
+}
+
+Vector3 OpticalBarModel::column_ray(OpticalBarColumn const& column, double row,
+                                    Quat const& cam_pose) const {
+
+  double sensor_row = (row - m_center_loc_pixels[1]) * m_pixel_size;
 
   // This vector is ESD format, consistent with the linescan model.
-  Vector3 r(m_focal_length * sin(alpha),
-            sensor_plane_pos[1] + image_motion_compensation,
-            m_focal_length * cos(alpha));
+  Vector3 r(m_focal_length * column.sin_alpha,
+            sensor_row + column.motion_compensation,
+            m_focal_length * column.cos_alpha);
   r = normalize(r);
 
   // r is the ray vector in the local camera system
 
   // Convert the ray vector into GCC coordinates.
-  Vector3 result = cam_pose.rotate(r);
+  return cam_pose.rotate(r);
+}
 
-  return result;
+Vector3 OpticalBarModel::correct_ray(Vector3 const& ray, Vector3 const& cam_ctr,
+                                     Vector3 const& velocity) const {
+  Vector3 output_vector = ray;
+  if (!m_correct_atmospheric_refraction) 
+    output_vector = apply_atmospheric_refraction_correction(cam_ctr, m_mean_earth_radius,
+                                                            m_mean_surface_elevation, output_vector);
+
+  if (!m_correct_velocity_aberration) 
+    return output_vector;
+  else
+    return apply_velocity_aberration_correction(cam_ctr, velocity,
+                                                m_mean_earth_radius, output_vector);
 }
 
 Vector3 OpticalBarModel::pixel_to_vector(Vector2 const& pixel) const {
   try {
-    Vector3 output_vector = pixel_to_vector_uncorrected(pixel);
-
-    Vector3 cam_ctr = camera_center(pixel);
-    if (!m_correct_atmospheric_refraction) 
-      output_vector = apply_atmospheric_refraction_correction(cam_ctr, m_mean_earth_radius,
-                                                              m_mean_surface_elevation, output_vector);
-
-    if (!m_correct_velocity_aberration) 
-      return output_vector;
-    else
-      return apply_velocity_aberration_correction(cam_ctr, get_velocity(pixel),
-                                                  m_mean_earth_radius, output_vector);
+    Vector3          velocity = get_velocity(pixel);
+    OpticalBarColumn column   = scan_column(pixel[0], velocity);
+    Vector3 output_vector = column_ray(column, pixel[1], camera_pose(pixel));
+    return correct_ray(output_vector, column.center, velocity);
 
   } catch(const vw::Exception &e) {
     // Repackage any of our exceptions thrown below this point as a 
@@ -150,13 +180,81 @@ Vector3 OpticalBarModel::pixel_to_vector(Vector2 const& pixel) const {
   }
 }
 
+void OpticalBarModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                     std::vector<Vector3>      & centers,
+                                     std::vector<Vector3>      & directions) const {
+  centers.resize(pixels.size());
+  directions.resize(pixels.size());
+
+  // The pose and velocity are constant over the scan
+  Quat    cam_pose = camera_pose (Vector2());
+  Vector3 velocity = get_velocity(Vector2());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    try {
+      // Same steps as pixel_to_vector()
+      OpticalBarColumn column = scan_column(pixels[i][0], velocity);
+      centers[i] = column.center;
+      Vector3 output_vector = column_ray(column, pixels[i][1], cam_pose);
+      directions[i] = correct_ray(output_vector, centers[i], velocity);
+    } catch(const vw::Exception &e) {
+      vw_throw(vw::camera::PixelToRayErr() << e.what());
+    }
+  }
+}
+
+Vector2 OpticalBarModel::pixel_guess(Vector3 const& point) const {
+  return pixel_guess(point, camera_pose(Vector2()).rotation_matrix(), get_velocity(Vector2()));
+}
+
+Vector2 OpticalBarModel::pixel_guess(Vector3 const& point, Matrix3x3 const& cam_rotation,
+                                     Vector3 const& velocity) const {
+
+  // In the camera frame, the ray through a pixel points along
+  //  (f sin(alpha), row offset + motion compensation, f cos(alpha)),
+  //  so the direction to the point gives alpha and the row directly.
+  //  The camera center moves during the scan, so find the column
+  //  again from where the camera is when it is seen.  The camera moves
+  //  little compared to its height, so each pass shrinks the error by
+  //  a factor of fifty or more.
+  const int NUM_PASSES = 3;
+  Matrix3x3 world_to_camera = transpose(cam_rotation);
+  double  col = m_center_loc_pixels[0];
+  Vector3 dir;
+  for (int pass = 0; pass < NUM_PASSES; ++pass) {
+    Vector3 center = m_initial_position + pixel_to_time_delta(Vector2(col, 0))*velocity;
+    dir = world_to_camera*(point - center);
+    col = m_center_loc_pixels[0] + atan2(dir[0], dir[2]) * m_focal_length / m_pixel_size;
+  }
+
+  OpticalBarColumn column = scan_column(col, velocity);
+  dir = world_to_camera*(point - column.center);
+  double sensor_row = m_focal_length * dir[1] / sqrt(dir[0]*dir[0] + dir[2]*dir[2])
+                      - column.motion_compensation;
+  return Vector2(col, m_center_loc_pixels[1] + sensor_row / m_pixel_size);
+}
+
 Vector2 OpticalBarModel::point_to_pixel(Vector3 const& point) const {
+  return guess_and_solve_point_to_pixel(point, pixel_guess(point));
+}
+
+Vector2 OpticalBarModel::guess_and_solve_point_to_pixel(Vector3 const& point,
+                                                        Vector2 const& guess) const {
+  // The guess is not finite for a point at the camera center.
+  if (std::isfinite(guess[0]) && std::isfinite(guess[1])) {
+    try {
+      return solve_point_to_pixel(point, guess);
+    } catch (const PointToPixelErr& /*e*/) {}
+  }
+  Vector2 start = m_image_size / 2.0; // Use the center as the initial guess
+  return solve_point_to_pixel(point, start);
+}
+
+Vector2 OpticalBarModel::solve_point_to_pixel(Vector3 const& point, Vector2 const& start) const {
 
   // Use the generic solver to find the pixel 
   // - This method will be slower but works for more complicated geometries
   CameraGenericLMA model( this, point );
   int status;
-  Vector2 start = m_image_size / 2.0; // Use the center as the initial guess
 
   // Solver constants
   const double ABS_TOL = 1e-16;
@@ -172,9 +270,38 @@ Vector2 OpticalBarModel::point_to_pixel(Vector3 const& point) const {
   return solution;
 }
 
+void OpticalBarModel::points_to_pixels(std::vector<Vector3> const& points,
+                                       std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+
+  // The pose and velocity are constant over the scan
+  Matrix3x3 cam_rotation = camera_pose(Vector2()).rotation_matrix();
+  Vector3   velocity     = get_velocity(Vector2());
+  for (size_t i = 0; i < points.size(); ++i) {
+    try {
+      pixels[i] = guess_and_solve_point_to_pixel(points[i],
+                                                 pixel_guess(points[i], cam_rotation, velocity));
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = invalid_pixel();
+    }
+  }
+}
+
+void OpticalBarModel::build_scan_table() {
+  // Compute the new table directly, not from the old one.
+  m_scan_table.reset();
+  m_scan_table.reset(new OpticalBarScanTable(*this));
+}
+
+void OpticalBarModel::clear_scan_table() {
+  m_scan_table.reset();
+}
+
 void OpticalBarModel::apply_transform(vw::Matrix3x3 const & rotation,
                                       vw::Vector3   const & translation,
                                       double                scale) {
+  clear_scan_table();
+
   // Extract current parameters
   vw::Vector3 position = this->camera_center();
   vw::Quat    pose     = this->camera_pose();
@@ -192,6 +319,8 @@ void OpticalBarModel::apply_transform(vw::Matrix3x3 const & rotation,
 
 void OpticalBarModel::read(std::string const& filename) {
 
+  clear_scan_table();
+
   // Open the input file
   std::ifstream cam_file;
   cam_file.open(filename.c_str());
@@ -380,6 +509,38 @@ void OpticalBarModel::write(std::string const& filename) const {
 
 
 
+OpticalBarScanTable::OpticalBarScanTable(OpticalBarModel const& model) :
+  m_first_col(-1) {
+  VW_ASSERT(!model.m_scan_table, LogicErr() << "OpticalBarScanTable: The model already has a table.");
+
+  m_pose     = model.camera_pose(Vector2());
+  m_rotation = m_pose.rotation_matrix();
+  m_velocity = model.get_velocity(Vector2());
+
+  // Cover the image with one extra column on each side.
+  m_columns.resize(model.m_image_size[0] + 2);
+  for (size_t i = 0; i < m_columns.size(); ++i)
+    m_columns[i] = model.compute_scan_column(m_first_col + double(i), m_velocity);
+}
+
+bool OpticalBarScanTable::column(double col, OpticalBarColumn& result) const {
+  double position = col - m_first_col;
+  if (!(position >= 0) || position > double(m_columns.size() - 1))
+    return false;
+  size_t i = std::min(size_t(position), m_columns.size() - 2);
+  double f = position - double(i);
+
+  OpticalBarColumn const& a = m_columns[i];
+  OpticalBarColumn const& b = m_columns[i+1];
+  result.center              = a.center    + f*(b.center    - a.center);
+  result.sin_alpha           = a.sin_alpha + f*(b.sin_alpha - a.sin_alpha);
+  result.cos_alpha           = a.cos_alpha + f*(b.cos_alpha - a.cos_alpha);
+  result.motion_compensation = a.motion_compensation
+                               + f*(b.motion_compensation - a.motion_compensation);
+  return true;
+}
+
+
 std::ostream& operator<<( std::ostream& os, OpticalBarModel const& camera_model) {
   os << "\n------------------------ Optical Bar Model -----------------------\n\n";
   os << " Image size:             " << camera_model.m_image_size             << "\n";
@@ -28,9 +28,21 @@
 #include <vw/Math/LevenbergMarquardt.h>
 #include <vw/Camera/CameraModel.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace vw {
 namespace camera {
 
+  class OpticalBarScanTable;
+
+  /// The scan geometry at one column of an OpticalBarModel: everything
+  /// about the camera and its rays that depends on the column alone.
+  struct OpticalBarColumn {
+    vw::Vector3 center;               ///< Camera center in world coordinates
+    double      sin_alpha, cos_alpha; ///< Scan angle away from the optical center
+    double      motion_compensation;  ///< Film shift along the column in meters
+  };
+
   // A camera model to approximate the type of optical bar cameras
   // that were used in the Corona and Hexagon satellites.
   
@@ -135,8 +147,31 @@ namespace camera {
     /// Gives a pose vector which represents the rotation from camera to world units
     virtual vw::Quat camera_pose(vw::Vector2 const& pix) const;
 
+    /// Batch versions of pixel_to_vector() and point_to_pixel().  The
+    /// pose and velocity are only computed once, and the solver for
+    /// each point starts from pixel_guess().
+    virtual void pixels_to_rays  (std::vector<vw::Vector2> const& pixels,
+                                  std::vector<vw::Vector3>      & centers,
+                                  std::vector<vw::Vector3>      & directions) const;
+    virtual void points_to_pixels(std::vector<vw::Vector3> const& points,
+                                  std::vector<vw::Vector2>      & pixels) const;
+
     // -- These are new functions --
 
+    /// The pixel seeing a point, found without iterating from the scan
+    /// geometry.  It leaves out the ray corrections, which move it by a
+    /// few pixels at most, so point_to_pixel() starts its solver here.
+    vw::Vector2 pixel_guess(vw::Vector3 const& point) const;
+
+    /// Compute the scan geometry of every column once, so that the
+    /// projection functions interpolate it instead of computing it for
+    /// each pixel.  This matters for the wide scans of KH-4 and KH-9
+    /// images.  read() and apply_transform() clear the table; rebuild or
+    /// clear it after changing the model with any other setter.
+    void build_scan_table();
+    void clear_scan_table();
+    bool has_scan_table() const { return m_scan_table.get() != 0; }
+
     // These return the initial center/pose at time=0.
     vw::Vector3 camera_center() const {return m_initial_position;}
     vw::Quat    camera_pose  () const {return camera_pose(vw::Vector2(0,0));} // Constant
@@ -183,6 +218,7 @@ namespace camera {
     void   set_motion_compensation(double mc_factor) { m_motion_compensation = mc_factor;}
 
     friend std::ostream& operator<<(std::ostream&, OpticalBarModel const&);
+    friend class OpticalBarScanTable;
 
   private:
 
@@ -195,8 +231,32 @@ namespace camera {
     /// Get position on the (flattened) sensor (film) plane in meters.
     vw::Vector2 pixel_to_sensor_plane(vw::Vector2 const& pixel) const;
 
-    /// Does not incluce velocity aberration and atmospheric correction.
-    vw::Vector3 pixel_to_vector_uncorrected(vw::Vector2 const& pixel) const;
+    /// The scan geometry at a column, from the scan table if there is
+    /// one.  velocity is the result of get_velocity().
+    OpticalBarColumn scan_column(double col, vw::Vector3 const& velocity) const;
+
+    /// The scan geometry at a column, always computed directly.
+    OpticalBarColumn compute_scan_column(double col, vw::Vector3 const& velocity) const;
+
+    /// The ray through a row of a column, in world coordinates.  Does
+    /// not include velocity aberration and atmospheric correction.
+    vw::Vector3 column_ray(OpticalBarColumn const& column, double row,
+                           vw::Quat const& cam_pose) const;
+
+    /// Apply the enabled ray corrections to a ray from column_ray().
+    vw::Vector3 correct_ray(vw::Vector3 const& ray, vw::Vector3 const& cam_center,
+                            vw::Vector3 const& velocity) const;
+
+    /// Solve for the pixel observing a point, starting from the given pixel.
+    vw::Vector2 solve_point_to_pixel(vw::Vector3 const& point, vw::Vector2 const& start) const;
+
+    /// pixel_guess() with the pose rotation and the velocity given.
+    vw::Vector2 pixel_guess(vw::Vector3 const& point, vw::Matrix3x3 const& cam_rotation,
+                            vw::Vector3 const& velocity) const;
+
+    /// Solve for the pixel observing a point from pixel_guess(), and
+    /// again from the image center if that fails.
+    vw::Vector2 guess_and_solve_point_to_pixel(vw::Vector3 const& point, vw::Vector2 const& guess) const;
 
     /// Returns the velocity in the GCC frame, not the sensor frame.
     vw::Vector3 get_velocity(vw::Vector2 const& pixel) const;
@@ -256,6 +316,9 @@ namespace camera {
     /// Set this flag to enable atmospheric refraction correction.
     bool m_correct_atmospheric_refraction;
 
+    /// Optional scan geometry of every column, see build_scan_table().
+    boost::shared_ptr<const OpticalBarScanTable> m_scan_table;
+
   protected:
 
     /// Returns the radius of the Earth under the current camera position.
@@ -263,6 +326,32 @@ namespace camera {
 
   }; // End class OpticalBarModel
 
+  /// The scan geometry of an OpticalBarModel at every column, with one
+  /// extra column on each side of the image, along with the pose and
+  /// velocity which are constant over a scan.  The geometry is
+  /// interpolated linearly between columns.  The camera center moves
+  /// linearly along the scan, so only the scan angle terms and the
+  /// motion compensation are approximated, well below a thousandth of
+  /// a pixel.
+  class OpticalBarScanTable {
+  public:
+    explicit OpticalBarScanTable(OpticalBarModel const& model);
+
+    vw::Quat    const& pose    () const { return m_pose;     }
+    vw::Matrix3x3 const& rotation() const { return m_rotation; }
+    vw::Vector3 const& velocity() const { return m_velocity; }
+
+    /// Returns false if the column is outside the table.
+    bool column(double col, OpticalBarColumn& result) const;
+
+  private:
+    double                        m_first_col;
+    std::vector<OpticalBarColumn> m_columns;
+    vw::Quat                      m_pose;
+    vw::Matrix3x3                 m_rotation;
+    vw::Vector3                   m_velocity;
+  };
+
 
   /// Output stream method.
   std::ostream& operator<<( std::ostream& os, OpticalBarModel const& camera_model);
@@ -23,6 +23,7 @@
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Camera/LensDistortion.h>
 #include <vw/Camera/CameraUtilities.h>
+#include <vw/Camera/CameraCache.h>
 
 #if defined(VW_HAVE_PKG_LAPACK)
 #include <vw/Math/LinearAlgebra.h>
@@ -72,7 +73,9 @@ PinholeModel::PinholeModel(PinholeModel const& other) :
     m_w_direction  (other.m_w_direction),
     m_pixel_pitch  (other.m_pixel_pitch),
     m_do_point_to_pixel_check(other.m_do_point_to_pixel_check),
-    m_inv_camera_transform(other.m_inv_camera_transform) {
+    m_inv_camera_transform(other.m_inv_camera_transform),
+    m_distort_grid  (other.m_distort_grid),
+    m_undistort_grid(other.m_undistort_grid) {
 }
 
 PinholeModel::PinholeModel(Vector3 camera_center, Matrix<double,3,3> rotation,
@@ -121,6 +124,7 @@ void PinholeModel::read(std::string const& filename) {
   cam_file.open(filename.c_str());
   if (cam_file.fail())
     vw_throw( IOErr() << "PinholeModel::read_file: Could not open file: " << filename );
+  clear_distortion_grids();
 
   // Check for version number on the first line
   int file_version = 1; // The default version written before the 2016 changes
@@ -319,6 +323,72 @@ bool PinholeModel::construct_lens_distortion(std::string const& config_line,
     return false;
 }
 
+void PinholeModel::write_binary(std::ostream& os) const {
+  using detail::write_binary;
+  write_binary(os, m_camera_center);
+  write_binary(os, m_rotation);
+  write_binary(os, m_fu);  write_binary(os, m_fv);
+  write_binary(os, m_cu);  write_binary(os, m_cv);
+  write_binary(os, m_u_direction);
+  write_binary(os, m_v_direction);
+  write_binary(os, m_w_direction);
+  write_binary(os, m_pixel_pitch);
+  write_binary(os, uint8(m_do_point_to_pixel_check));
+
+  // The lens writes itself as text, which is small next to the grids.
+  std::ostringstream lens;
+  lens << std::setprecision(17) << *m_distortion;
+  write_binary(os, m_distortion->name());
+  write_binary(os, lens.str());
+
+  write_binary(os, uint8(m_distort_grid   ? 1 : 0));
+  if (m_distort_grid)
+    m_distort_grid->write_binary(os);
+  write_binary(os, uint8(m_undistort_grid ? 1 : 0));
+  if (m_undistort_grid)
+    m_undistort_grid->write_binary(os);
+}
+
+void PinholeModel::read_binary(std::istream& is) {
+  using detail::read_binary;
+  uint8 check;
+  read_binary(is, m_camera_center);
+  read_binary(is, m_rotation);
+  read_binary(is, m_fu);  read_binary(is, m_fv);
+  read_binary(is, m_cu);  read_binary(is, m_cv);
+  read_binary(is, m_u_direction);
+  read_binary(is, m_v_direction);
+  read_binary(is, m_w_direction);
+  read_binary(is, m_pixel_pitch);
+  read_binary(is, check);
+  m_do_point_to_pixel_check = (check != 0);
+
+  std::string lens_name, lens_text;
+  read_binary(is, lens_name);
+  read_binary(is, lens_text);
+  if (!construct_lens_distortion(lens_name, 4))
+    vw_throw( IOErr() << "PinholeModel::read_binary(): Unknown lens distortion: "
+                      << lens_name << "\n" );
+  std::istringstream lens(lens_text);
+  m_distortion->read(lens);
+
+  clear_distortion_grids();
+  uint8 has_grid;
+  read_binary(is, has_grid);
+  if (has_grid) {
+    boost::shared_ptr<DistortionLookupGrid> grid(new DistortionLookupGrid);
+    grid->read_binary(is);
+    m_distort_grid = grid;
+  }
+  read_binary(is, has_grid);
+  if (has_grid) {
+    boost::shared_ptr<DistortionLookupGrid> grid(new DistortionLookupGrid);
+    grid->read_binary(is);
+    m_undistort_grid = grid;
+  }
+  rebuild_camera_matrix();
+}
+
 void PinholeModel::write(std::string const& filename) const {
 
   update_rpc_undistortion(*this);
@@ -375,12 +445,57 @@ Vector2 PinholeModel::point_to_pixel_no_check(Vector3 const& point) const {
   // Apply the lens distortion model
   // - Divide by pixel pitch to convert from metric units to pixels if the intrinsic
   //   values were not specified in pixel units (in that case m_pixel_pitch == 1.0)
-  Vector2 final_pixel = m_distortion->distorted_coordinates(*this, pixel)/m_pixel_pitch;
+  Vector2 final_pixel = distorted_coordinates(pixel)/m_pixel_pitch;
 
   return final_pixel;
 }
 
 
+void PinholeModel::point_to_pixel_jacobian(Vector3 const& point,
+                                           Matrix<double,2,3>& d_point,
+                                           Matrix<double,2,6>& d_pose,
+                                           Matrix<double,2,4>& d_intrinsics,
+                                           Matrix<double>    & d_distortion) const {
+
+  // The point in camera coordinates.  A rotation w of the camera
+  // changes it by M*cross(d, w), to first order.
+  Matrix<double,3,3> M = submatrix(m_extrinsics,0,0,3,3);
+  Vector3 d = point - m_camera_center;
+  Vector3 q = M*d;
+  if (q[2] == 0)
+    vw_throw( PointToPixelErr() << "PinholeModel::point_to_pixel_jacobian: "
+                                << "Point is in the camera plane.\n" );
+  Matrix<double,3,3> d_cross;
+  d_cross(0,1) = -d[2];  d_cross(0,2) =  d[1];
+  d_cross(1,0) =  d[2];  d_cross(1,2) = -d[0];
+  d_cross(2,0) = -d[1];  d_cross(2,1) =  d[0];
+
+  // The undistorted location, in focal length units
+  Vector2 undist(m_fu*q[0]/q[2] + m_cu, m_fv*q[1]/q[2] + m_cv);
+  Matrix<double,2,3> dundist_dq;
+  dundist_dq(0,0) = m_fu/q[2];  dundist_dq(0,2) = -m_fu*q[0]/(q[2]*q[2]);
+  dundist_dq(1,1) = m_fv/q[2];  dundist_dq(1,2) = -m_fv*q[1]/(q[2]*q[2]);
+
+  Matrix2x2          dlens_dundist;
+  Matrix<double,2,4> dlens_dintrinsics;
+  m_distortion->distortion_jacobian(*this, undist, dlens_dundist,
+                                    dlens_dintrinsics, d_distortion);
+
+  Matrix<double,2,3> dpix_dq = dlens_dundist*dundist_dq/m_pixel_pitch;
+  d_point = dpix_dq*M;
+  submatrix(d_pose,0,0,2,3) = -d_point;
+  submatrix(d_pose,0,3,2,3) = dpix_dq*M*d_cross;
+
+  Matrix<double,2,4> dundist_dintrinsics;
+  dundist_dintrinsics(0,0) = q[0]/q[2];
+  dundist_dintrinsics(1,1) = q[1]/q[2];
+  dundist_dintrinsics(0,2) = 1;
+  dundist_dintrinsics(1,3) = 1;
+  d_intrinsics = (dlens_dundist*dundist_dintrinsics + dlens_dintrinsics)/m_pixel_pitch;
+  d_distortion /= m_pixel_pitch;
+}
+
+
 Vector2 PinholeModel::point_to_pixel(Vector3 const& point) const {
 
   // Get the pixel using the no check version, then perform the check.
@@ -430,7 +545,7 @@ bool PinholeModel::projection_valid(Vector3 const& point) const {
 
 Vector3 PinholeModel::pixel_to_vector (Vector2 const& pix) const {
   // Apply the inverse lens distortion model
-  Vector2 undistorted_pix = m_distortion->undistorted_coordinates(*this, pix*m_pixel_pitch);
+  Vector2 undistorted_pix = undistorted_coordinates(pix*m_pixel_pitch);
 
   // Compute the direction of the ray emanating from the camera center.
   Vector3 p(0,0,1);
@@ -442,6 +557,45 @@ Vector3 PinholeModel::camera_center(Vector2 const& /*pix*/ ) const {
   return m_camera_center;
 };
 
+void PinholeModel::pixels_to_rays(std::vector<Vector2> const& pixels,
+                                  std::vector<Vector3>      & centers,
+                                  std::vector<Vector3>      & directions) const {
+  centers.assign(pixels.size(), m_camera_center);
+  directions.resize(pixels.size());
+
+  // Same computation as pixel_to_vector()
+  Vector3 p(0,0,1);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    subvector(p,0,2) = undistorted_coordinates(pixels[i]*m_pixel_pitch);
+    directions[i] = normalize( m_inv_camera_transform * p);
+  }
+}
+
+void PinholeModel::points_to_pixels(std::vector<Vector3> const& points,
+                                    std::vector<Vector2>      & pixels) const {
+  pixels.resize(points.size());
+
+  // Same computation and check as point_to_pixel()
+  const double ERROR_THRESHOLD = 0.01;
+  Vector3 p(0,0,1);
+  for (size_t i = 0; i < points.size(); ++i) {
+    try {
+      pixels[i] = point_to_pixel_no_check(points[i]);
+      if (!m_do_point_to_pixel_check)
+        continue;
+
+      subvector(p,0,2) = undistorted_coordinates(pixels[i]*m_pixel_pitch);
+      Vector3 pixel_vector = normalize( m_inv_camera_transform * p);
+      Vector3 phys_vector  = normalize(points[i] - m_camera_center);
+      double  diff         = norm_2(pixel_vector - phys_vector);
+      if (diff >= ERROR_THRESHOLD || diff != diff)
+        pixels[i] = invalid_pixel();
+    } catch (const PointToPixelErr& /*e*/) {
+      pixels[i] = invalid_pixel();
+    }
+  }
+}
+
 void PinholeModel::set_camera_center(Vector3 const& position) {
   m_camera_center = position; 
   rebuild_camera_matrix();
@@ -483,6 +637,7 @@ const LensDistortion* PinholeModel::lens_distortion() const { return m_distortio
 
 void PinholeModel::set_lens_distortion(LensDistortion const* distortion) {
   m_distortion = distortion->copy();
+  clear_distortion_grids();
 }
 
 void PinholeModel::intrinsic_parameters(double& f_u, double& f_v,
@@ -493,21 +648,27 @@ void PinholeModel::intrinsic_parameters(double& f_u, double& f_v,
 void PinholeModel::set_intrinsic_parameters(double f_u, double f_v,
                                             double c_u, double c_v) {
   m_fu = f_u;  m_fv = f_v;  m_cu = c_u;  m_cv = c_v;
+  clear_distortion_grids();
   rebuild_camera_matrix();
 }
 
 Vector2 PinholeModel::focal_length() const { return Vector2(m_fu,m_fv); }
 void PinholeModel::set_focal_length(Vector2 const& f, bool rebuild ) {
   m_fu = f[0]; m_fv = f[1];
+  clear_distortion_grids();
   if (rebuild) rebuild_camera_matrix();
 }
 Vector2 PinholeModel::point_offset() const { return Vector2(m_cu,m_cv); }
 void PinholeModel::set_point_offset(Vector2 const& c, bool rebuild ) {
   m_cu = c[0]; m_cv = c[1];
+  clear_distortion_grids();
   if (rebuild) rebuild_camera_matrix();
 }
 double PinholeModel::pixel_pitch() const { return m_pixel_pitch; }
-void PinholeModel::set_pixel_pitch( double pitch ) { m_pixel_pitch = pitch; }
+void PinholeModel::set_pixel_pitch( double pitch ) {
+  m_pixel_pitch = pitch;
+  clear_distortion_grids();
+}
 
 
 void PinholeModel::set_camera_matrix( Matrix<double,3,4> const& p ) {
@@ -544,6 +705,7 @@ void PinholeModel::set_camera_matrix( Matrix<double,3,4> const& p ) {
   m_fv = R(1,1);
   m_cu = R(0,2);
   m_cv = R(1,2);
+  clear_distortion_grids();
 
   if ( fabs(R(0,1)) >= 1.2 )
     vw_out(WarningMessage,"camera") << "Significant skew not modelled by pinhole camera\n";
@@ -631,6 +793,67 @@ void PinholeModel::apply_transform(vw::Matrix3x3 const & rotation,
   this->set_camera_pose  (pose);
 }
 
+void PinholeModel::build_distortion_grids(Vector2i const& image_size, double spacing,
+                                          double tolerance) {
+  VW_ASSERT( image_size[0] > 0 && image_size[1] > 0,
+             ArgumentErr() << "PinholeModel::build_distortion_grids: Invalid image size.\n" );
+  clear_distortion_grids();
+
+  // The distortion model works in the units of the focal length, so
+  // scale the grid and the tolerance by the pixel pitch.
+  BBox2  distorted_domain(Vector2(0,0), Vector2(image_size) * m_pixel_pitch);
+  double grid_spacing   = spacing   * m_pixel_pitch;
+  double grid_tolerance = tolerance * m_pixel_pitch;
+
+  if (!m_distortion->has_fast_undistort())
+    m_undistort_grid.reset(new DistortionLookupGrid(*this, *m_distortion,
+                                                    DistortionLookupGrid::Undistort,
+                                                    distorted_domain, grid_spacing,
+                                                    grid_tolerance));
+
+  if (!m_distortion->has_fast_distort()) {
+    // The grid must cover the undistorted footprint of the image, so
+    // undistort the image border to find it.
+    BBox2 undistorted_domain;
+    Vector2 corner = distorted_domain.max();
+    int32 steps = int32(ceil(std::max(corner[0], corner[1]) / grid_spacing));
+    for (int32 k = 0; k <= steps; k++) {
+      double t = double(k) / steps;
+      Vector2 border[4] = { Vector2(t*corner[0], 0),         Vector2(t*corner[0], corner[1]),
+                            Vector2(0,         t*corner[1]), Vector2(corner[0], t*corner[1]) };
+      for (int32 b = 0; b < 4; b++) {
+        try {
+          undistorted_domain.grow(m_distortion->undistorted_coordinates(*this, border[b]));
+        } catch (const vw::Exception&) {} // The grid falls back to the solver there
+      }
+    }
+    if (!undistorted_domain.empty())
+      m_distort_grid.reset(new DistortionLookupGrid(*this, *m_distortion,
+                                                    DistortionLookupGrid::Distort,
+                                                    undistorted_domain, grid_spacing,
+                                                    grid_tolerance));
+  }
+}
+
+void PinholeModel::clear_distortion_grids() {
+  m_distort_grid.reset();
+  m_undistort_grid.reset();
+}
+
+Vector2 PinholeModel::distorted_coordinates(Vector2 const& p) const {
+  Vector2 result;
+  if (m_distort_grid && m_distort_grid->lookup(p, result))
+    return result;
+  return m_distortion->distorted_coordinates(*this, p);
+}
+
+Vector2 PinholeModel::undistorted_coordinates(Vector2 const& p) const {
+  Vector2 result;
+  if (m_undistort_grid && m_undistort_grid->lookup(p, result))
+    return result;
+  return m_distortion->undistorted_coordinates(*this, p);
+}
+
 // Scaling the camera is easy, just update the pixel pitch to account for the new image size.
 // This is not applying a scale transform to the camera, that is done in apply_transform().  
 PinholeModel scale_camera(PinholeModel const& camera_model, double scale) {
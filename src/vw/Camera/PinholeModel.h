@@ -33,6 +33,7 @@ namespace vw {
 namespace camera {
 
   class LensDistortion;
+  class DistortionLookupGrid;
 
   /// This is a simple "generic" pinhole camera model.
   ///
@@ -118,6 +119,10 @@ namespace camera {
     /// Cached values for pixel_to_vector
     Matrix<double,3,3> m_inv_camera_transform;
 
+    /// Optional lookup grids standing in for the lens distortion
+    /// directions that need a solver. See build_distortion_grids().
+    boost::shared_ptr<const DistortionLookupGrid> m_distort_grid, m_undistort_grid;
+
   public:
     //------------------------------------------------------------------
     // Constructors / Destructors
@@ -201,6 +206,12 @@ namespace camera {
     void read (std::string const& filename);
     void write(std::string const& filename) const;
 
+    /// Save and restore the camera, including any distortion grids, in
+    /// the raw format of CameraCache.h.  Use write_camera_cache() and
+    /// read_camera_cache() for files.
+    void write_binary(std::ostream& os) const;
+    void read_binary (std::istream& is);
+
     //------------------------------------------------------------------
     // Methods
     //------------------------------------------------------------------
@@ -219,6 +230,20 @@ namespace camera {
     /// As point_to_pixel, but ignoring any lens distortion.
     Vector2 point_to_pixel_no_distortion(Vector3 const& point) const;
 
+    /// The derivatives of point_to_pixel_no_check() at this point,
+    /// with respect to the point, to the camera pose, to the intrinsics
+    /// (fu, fv, cu, cv) and to the lens distortion parameters.  The
+    /// pose columns are the camera center followed by a small rotation
+    /// vector w, which turns the camera in world coordinates as
+    /// axis_angle_to_matrix(w)*R.  Lens models without an analytic
+    /// LensDistortion::distortion_jacobian() fall back to finite
+    /// differences for their part.
+    void point_to_pixel_jacobian(Vector3 const& point,
+                                 Matrix<double,2,3>& d_point,
+                                 Matrix<double,2,6>& d_pose,
+                                 Matrix<double,2,4>& d_intrinsics,
+                                 Matrix<double>    & d_distortion) const;
+
     // Is a valid projection of point is possible?
     // This is equal to: Is the point in front of the camera (z > 0)
     // after extinsic transformation?
@@ -232,6 +257,17 @@ namespace camera {
     virtual Vector3 camera_center(Vector2 const& /*pix*/ = Vector2() ) const;
     void set_camera_center(Vector3 const& position);
 
+    // Batch version of pixel_to_vector() and camera_center(), the
+    // camera center is shared by all of the rays.
+    virtual void pixels_to_rays(std::vector<Vector2> const& pixels,
+                                std::vector<Vector3>      & centers,
+                                std::vector<Vector3>      & directions) const;
+
+    // Batch version of point_to_pixel().  Points which fail the
+    // point_to_pixel check get invalid_pixel() without throwing.
+    virtual void points_to_pixels(std::vector<Vector3> const& points,
+                                  std::vector<Vector2>      & pixels) const;
+
     // Pose is a rotation which moves a vector in camera coordinates
     // into world coordinates.
     // - The pinhole camera position does not vary by pixel so the input pixel is ignored.
@@ -287,7 +323,24 @@ namespace camera {
                          vw::Vector3   const & translation,
                          double                scale);
 
+    /// Replace the solver in the lens distortion model with lookup grids.
+    /// - A grid is only built for a direction the model implements with a
+    ///   solver, i.e. has_fast_distort() or has_fast_undistort() is false.
+    /// - The grids cover an image of image_size pixels, with nodes
+    ///   spacing pixels apart. Cells whose interpolation error exceeds
+    ///   tolerance pixels, and points off the grid, use the solver.
+    /// - Changing the intrinsics or the lens distortion clears the grids.
+    ///   Changing the pose does not.
+    void build_distortion_grids(Vector2i const& image_size, double spacing = 8,
+                                double tolerance = 1e-3);
+    void clear_distortion_grids();
+    bool has_distortion_grids() const { return m_distort_grid || m_undistort_grid; }
+
   private:
+    /// Apply the lens distortion, using a lookup grid when there is one.
+    Vector2 distorted_coordinates  (Vector2 const& p) const;
+    Vector2 undistorted_coordinates(Vector2 const& p) const;
+
     /// This must be called whenever camera parameters are modified.
     void rebuild_camera_matrix();
     
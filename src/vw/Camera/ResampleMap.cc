@@ -0,0 +1,172 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Camera/ResampleMap.h>
+#include <vw/Camera/CameraModel.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Camera/LensDistortion.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+  const char RESAMPLE_MAP_MAGIC[8] = {'V','W','R','M','A','P','1','\0'};
+}
+
+namespace vw {
+namespace camera {
+
+ResampleMap::ResampleMap(ImageView<Vector2f> const& positions, bool fixed_point)
+  : m_positions(positions) {
+  set_fixed_point(fixed_point);
+}
+
+void ResampleMap::set_fixed_point(bool fixed_point) {
+  m_fixed.clear();
+  if (!fixed_point)
+    return;
+
+  m_fixed.resize(size_t(cols())*size_t(rows()));
+  size_t k = 0;
+  for (int32 row = 0; row < rows(); ++row) {
+    for (int32 col = 0; col < cols(); ++col, ++k) {
+      Vector2f const& pos = m_positions(col, row);
+      FixedPointSample& s = m_fixed[k];
+      if (!is_valid(pos)) {
+        // Far enough out that a resampling view never finds it in its
+        // buffered source region.
+        s.x = s.y = -(1 << 30);
+        s.wx = s.wy = 0;
+        continue;
+      }
+      // Round the weights first so a weight of exactly one moves on to
+      // the next pixel rather than overflowing.
+      int32 fx = int32(std::floor(double(pos[0]) * FIXED_POINT_SCALE + 0.5));
+      int32 fy = int32(std::floor(double(pos[1]) * FIXED_POINT_SCALE + 0.5));
+      s.x  = fx >> FIXED_POINT_BITS;
+      s.y  = fy >> FIXED_POINT_BITS;
+      s.wx = uint16(fx & (FIXED_POINT_SCALE - 1));
+      s.wy = uint16(fy & (FIXED_POINT_SCALE - 1));
+    }
+  }
+}
+
+BBox2i ResampleMap::source_bbox(BBox2i const& bbox) const {
+  BBox2i result;
+  for (int32 row = bbox.min().y(); row < bbox.max().y(); ++row) {
+    for (int32 col = bbox.min().x(); col < bbox.max().x(); ++col) {
+      Vector2f const& pos = m_positions(col, row);
+      if (!is_valid(pos))
+        continue;
+      Vector2i corner(int32(std::floor(pos[0])), int32(std::floor(pos[1])));
+      result.grow(corner);
+      result.grow(corner + Vector2i(1, 1));
+    }
+  }
+  return result;
+}
+
+void ResampleMap::write(std::string const& filename) const {
+  std::ofstream f(filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!f.is_open())
+    vw_throw(IOErr() << "ResampleMap::write: Could not open file: " << filename);
+
+  int32 header[3] = { cols(), rows(), has_fixed_point() ? 1 : 0 };
+  f.write(RESAMPLE_MAP_MAGIC, sizeof(RESAMPLE_MAP_MAGIC));
+  f.write(reinterpret_cast<const char*>(header), sizeof(header));
+  for (int32 row = 0; row < rows() && cols() > 0; ++row)
+    f.write(reinterpret_cast<const char*>(&m_positions(0, row)[0]),
+            sizeof(float)*2*cols());
+  if (!f)
+    vw_throw(IOErr() << "ResampleMap::write: Failed writing: " << filename);
+}
+
+void ResampleMap::read(std::string const& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary | std::ios::in);
+  if (!f.is_open())
+    vw_throw(IOErr() << "ResampleMap::read: Could not open file: " << filename);
+
+  char  magic[8];
+  int32 header[3];
+  if (!f.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, RESAMPLE_MAP_MAGIC, sizeof(magic)) != 0)
+    vw_throw(IOErr() << "ResampleMap::read: \"" << filename << "\" is not a resample map.");
+  if (!f.read(reinterpret_cast<char*>(header), sizeof(header)) ||
+      header[0] < 0 || header[1] < 0)
+    vw_throw(IOErr() << "ResampleMap::read: Bad header in: " << filename);
+
+  ImageView<Vector2f> positions(header[0], header[1]);
+  for (int32 row = 0; row < positions.rows() && positions.cols() > 0; ++row)
+    if (!f.read(reinterpret_cast<char*>(&positions(0, row)[0]), sizeof(float)*2*positions.cols()))
+      vw_throw(IOErr() << "ResampleMap::read: Unexpected end of file in: " << filename);
+
+  m_positions = positions;
+  set_fixed_point(header[2] != 0);
+}
+
+
+ResampleMap camera_resample_map(CameraModel const& src_camera,
+                                CameraModel const& dst_camera,
+                                BBox2i const& dst_bbox,
+                                bool fixed_point) {
+  ImageView<Vector2f> positions(dst_bbox.width(), dst_bbox.height());
+
+  // Do one row at a time with the batch camera calls.
+  std::vector<Vector2> pixels(dst_bbox.width()), src_pixels;
+  std::vector<Vector3> centers, directions, points(dst_bbox.width());
+  for (int32 row = 0; row < dst_bbox.height(); ++row) {
+    for (int32 col = 0; col < dst_bbox.width(); ++col)
+      pixels[col] = Vector2(col, row) + dst_bbox.min();
+    dst_camera.pixels_to_rays(pixels, centers, directions);
+    for (int32 col = 0; col < dst_bbox.width(); ++col)
+      points[col] = centers[col] + directions[col];
+    src_camera.points_to_pixels(points, src_pixels);
+
+    for (int32 col = 0; col < dst_bbox.width(); ++col) {
+      if (directions[col] == Vector3() || src_pixels[col] == CameraModel::invalid_pixel())
+        positions(col, row) = ResampleMap::invalid_position();
+      else
+        positions(col, row) = src_pixels[col];
+    }
+  }
+  return ResampleMap(positions, fixed_point);
+}
+
+ResampleMap undistortion_map(PinholeModel const& camera,
+                             Vector2i const& size,
+                             Vector2 const& offset,
+                             bool fixed_point) {
+  const LensDistortion* lens = camera.lens_distortion();
+  const double pitch = camera.pixel_pitch();
+
+  ImageView<Vector2f> positions(size[0], size[1]);
+  for (int32 row = 0; row < size[1]; ++row) {
+    for (int32 col = 0; col < size[0]; ++col) {
+      Vector2 lens_loc = (Vector2(col, row) + offset) * pitch;
+      try {
+        positions(col, row) = lens->distorted_coordinates(camera, lens_loc) / pitch;
+      } catch (const Exception&) {
+        positions(col, row) = ResampleMap::invalid_position();
+      }
+    }
+  }
+  return ResampleMap(positions, fixed_point);
+}
+
+}} // namespace vw::camera
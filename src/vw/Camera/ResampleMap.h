@@ -0,0 +1,287 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ResampleMap.h
+///
+/// A precomputed map of source pixel positions that can be used to
+/// warp many images taken with the same camera, such as removing the
+/// lens distortion from every frame of an image sequence.
+///
+#ifndef __VW_CAMERA_RESAMPLEMAP_H__
+#define __VW_CAMERA_RESAMPLEMAP_H__
+
+#include <string>
+#include <vector>
+
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Manipulation.h>
+
+namespace vw {
+namespace camera {
+
+  class CameraModel;
+  class PinholeModel;
+
+  /// Stores, for every pixel of an output image, the position in the
+  /// source image which should be sampled to produce it.  The
+  /// expensive camera math is done once when the map is built.  The
+  /// map can then be written to disk and applied to any number of
+  /// images with resample_map().
+  ///
+  /// The map can also keep each position in fixed point form: the
+  /// integer top-left pixel of the bilinear footprint plus the two
+  /// fractional weights in units of 1/FIXED_POINT_SCALE.  Bilinear
+  /// resampling then skips the floor and weight computation per pixel.
+  ///
+  /// Positions which could not be computed hold invalid_position() and
+  /// resample to the edge extension value.
+  class ResampleMap {
+  public:
+    static const int32 FIXED_POINT_BITS  = 14;
+    static const int32 FIXED_POINT_SCALE = 1 << FIXED_POINT_BITS;
+
+    struct FixedPointSample {
+      int32  x, y;
+      uint16 wx, wy;
+    };
+
+    ResampleMap() {}
+
+    /// Wrap a precomputed image of source positions.
+    explicit ResampleMap(ImageView<Vector2f> const& positions, bool fixed_point = false);
+
+    int32 cols() const { return m_positions.cols(); }
+    int32 rows() const { return m_positions.rows(); }
+
+    /// The source position for output pixel (col, row).
+    Vector2f const& operator()(int32 col, int32 row) const { return m_positions(col, row); }
+
+    ImageView<Vector2f> const& positions() const { return m_positions; }
+
+    /// Compute (or drop) the fixed point form of the positions.
+    void set_fixed_point(bool fixed_point);
+    bool has_fixed_point() const { return !m_fixed.empty(); }
+
+    /// The fixed point sample for output pixel (col, row).  Only valid
+    /// when has_fixed_point() is true.
+    FixedPointSample const& fixed_point(int32 col, int32 row) const {
+      return m_fixed[size_t(row)*size_t(cols()) + size_t(col)];
+    }
+
+    /// The bounding box of the source pixels needed to resample the
+    /// output pixels in bbox, not counting invalid positions.  The box
+    /// is empty if no position in bbox is valid.
+    BBox2i source_bbox(BBox2i const& bbox) const;
+
+    /// Save to or load from a binary file.  The fixed point form is not
+    /// stored but is recomputed on load if it was present when saved.
+    void write(std::string const& filename) const;
+    void read (std::string const& filename);
+
+    static Vector2f invalid_position() { return Vector2f(-1e8, -1e8); }
+    static bool is_valid(Vector2f const& pos) {
+      return pos[0] > -1e7 && pos[0] < 1e7 && pos[1] > -1e7 && pos[1] < 1e7;
+    }
+
+  private:
+    ImageView<Vector2f>           m_positions;
+    std::vector<FixedPointSample> m_fixed;
+  };
+
+  /// Build a map which warps images taken with src_camera into the
+  /// view of dst_camera, covering the dst_camera pixels in dst_bbox.
+  /// Like CameraTransform, this requires both cameras to share the
+  /// same camera center.
+  ResampleMap camera_resample_map(CameraModel const& src_camera,
+                                  CameraModel const& dst_camera,
+                                  BBox2i const& dst_bbox,
+                                  bool fixed_point = false);
+
+  /// Build a map which removes the lens distortion of a pinhole
+  /// camera.  Output pixel (col, row) is at (col, row) + offset in the
+  /// undistorted image plane, in pixel units.
+  ResampleMap undistortion_map(PinholeModel const& camera,
+                               Vector2i const& size,
+                               Vector2 const& offset = Vector2(),
+                               bool fixed_point = false);
+
+
+  /// An image view which applies a ResampleMap to an image.  Each tile
+  /// rasterizes only the source region its positions fall in, so the
+  /// source may be a lazy or disk-backed view.
+  template <class ImageT, class EdgeT, class InterpT>
+  class ResampleMapView : public ImageViewBase<ResampleMapView<ImageT, EdgeT, InterpT> > {
+    typedef typename ImageT::pixel_type PixelT;
+    typedef InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT> interp_type;
+
+    ImageT      m_image;
+    ResampleMap m_map;
+    EdgeT       m_edge;
+    InterpT     m_interp;
+
+  public:
+    typedef PixelT pixel_type;
+    typedef PixelT result_type;
+    typedef ProceduralPixelAccessor<ResampleMapView> pixel_accessor;
+
+    ResampleMapView(ImageT const& image, ResampleMap const& map,
+                    EdgeT const& edge, InterpT const& interp)
+      : m_image(image), m_map(map), m_edge(edge), m_interp(interp) {}
+
+    inline int32 cols  () const { return m_map.cols(); }
+    inline int32 rows  () const { return m_map.rows(); }
+    inline int32 planes() const { return m_image.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+    inline result_type operator()(int32 i, int32 j, int32 p = 0) const {
+      Vector2f const& pos = m_map(i, j);
+      return interpolate(m_image, m_interp, m_edge)(pos[0], pos[1], p);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      ImageView<pixel_type> tile(bbox.width(), bbox.height(), planes());
+      interp_type full = interpolate(m_image, m_interp, m_edge);
+
+      // Rasterize just the part of the source this tile reads from.
+      // Positions outside of it, which can only be in the edge
+      // extension, go through the lazy view.
+      BBox2i src_bbox = m_map.source_bbox(bbox);
+      if (!src_bbox.empty()) {
+        src_bbox.expand(InterpT::pixel_buffer + 1);
+        src_bbox.crop(BBox2i(-(InterpT::pixel_buffer + 1), -(InterpT::pixel_buffer + 1),
+                             m_image.cols() + 2*(InterpT::pixel_buffer + 1),
+                             m_image.rows() + 2*(InterpT::pixel_buffer + 1)));
+      }
+      ImageView<pixel_type> src;
+      BBox2i inner(0, 0, 0, 0);
+      if (!src_bbox.empty()) {
+        src = crop(edge_extend(m_image, m_edge), src_bbox);
+        inner = src_bbox;
+        inner.contract(InterpT::pixel_buffer);
+      } else {
+        src_bbox = inner;
+      }
+      fill_tile(tile, bbox, full, src, src_bbox, inner, m_interp);
+
+      return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    template <class DestT>
+    inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+
+  private:
+    // The general case interpolates the buffered source with InterpT.
+    template <class InterpArgT>
+    void fill_tile(ImageView<pixel_type>& tile, BBox2i const& bbox, interp_type const& full,
+                   ImageView<pixel_type> const& src, BBox2i const& src_bbox,
+                   BBox2i const& inner, InterpArgT const& /*interp*/) const {
+      fill_tile_general(tile, bbox, full, src, src_bbox, inner);
+    }
+
+    void fill_tile_general(ImageView<pixel_type>& tile, BBox2i const& bbox, interp_type const& full,
+                           ImageView<pixel_type> const& src, BBox2i const& src_bbox,
+                           BBox2i const& inner) const {
+      typedef typename InterpT::template Interpolator<ImageView<pixel_type> >::type interp_func_type;
+      interp_func_type interp_func = m_interp.interpolator(src);
+      for (int32 p = 0; p < planes(); ++p) {
+        for (int32 row = bbox.min().y(); row < bbox.max().y(); ++row) {
+          for (int32 col = bbox.min().x(); col < bbox.max().x(); ++col) {
+            Vector2f const& pos = m_map(col, row);
+            pixel_type& out = tile(col - bbox.min().x(), row - bbox.min().y(), p);
+            if (pos[0] >= inner.min().x() && pos[0] < inner.max().x() - 1 &&
+                pos[1] >= inner.min().y() && pos[1] < inner.max().y() - 1)
+              out = interp_func(src, pos[0] - src_bbox.min().x(), pos[1] - src_bbox.min().y(), p);
+            else
+              out = full(pos[0], pos[1], p);
+          }
+        }
+      }
+    }
+
+    // Bilinear resampling uses the fixed point form when it is present.
+    void fill_tile(ImageView<pixel_type>& tile, BBox2i const& bbox, interp_type const& full,
+                   ImageView<pixel_type> const& src, BBox2i const& src_bbox,
+                   BBox2i const& inner, BilinearInterpolation const& /*interp*/) const {
+      if (!m_map.has_fixed_point()) {
+        fill_tile_general(tile, bbox, full, src, src_bbox, inner);
+        return;
+      }
+
+      typedef typename CompoundChannelType<pixel_type>::type channel_type;
+      typedef typename CompoundChannelCast<pixel_type, double>::type sum_type;
+      const double scale = 1.0 / ResampleMap::FIXED_POINT_SCALE;
+      for (int32 p = 0; p < planes(); ++p) {
+        for (int32 row = bbox.min().y(); row < bbox.max().y(); ++row) {
+          for (int32 col = bbox.min().x(); col < bbox.max().x(); ++col) {
+            ResampleMap::FixedPointSample const& s = m_map.fixed_point(col, row);
+            pixel_type& out = tile(col - bbox.min().x(), row - bbox.min().y(), p);
+            if (s.x < inner.min().x() || s.x + 1 >= inner.max().x() ||
+                s.y < inner.min().y() || s.y + 1 >= inner.max().y()) {
+              Vector2f const& pos = m_map(col, row);
+              out = full(pos[0], pos[1], p);
+              continue;
+            }
+            const double wx = s.wx * scale, wy = s.wy * scale;
+            typename ImageView<pixel_type>::pixel_accessor acc
+              = src.origin().advance(s.x - src_bbox.min().x(), s.y - src_bbox.min().y(), p);
+            sum_type result = (*acc) * (1 - wx);
+            acc.next_col();
+            result += (*acc) * wx;
+            result *= (1 - wy);
+            acc.advance(-1, 1);
+            sum_type bottom = (*acc) * (1 - wx);
+            acc.next_col();
+            bottom += (*acc) * wx;
+            result += bottom * wy;
+            out = channel_cast_round_if_int<channel_type>(result);
+          }
+        }
+      }
+    }
+  };
+
+  /// Resample an image through a ResampleMap, explicitly specifying
+  /// the edge extension and interpolation modes.
+  template <class ImageT, class EdgeT, class InterpT>
+  inline ResampleMapView<ImageT, EdgeT, InterpT>
+  resample_map(ImageViewBase<ImageT> const& image, ResampleMap const& map,
+               EdgeT const& edge_func, InterpT const& interp_func) {
+    return ResampleMapView<ImageT, EdgeT, InterpT>(image.impl(), map, edge_func, interp_func);
+  }
+
+  /// Resample an image through a ResampleMap using zero (black)
+  /// edge extension and bilinear interpolation.
+  template <class ImageT>
+  inline ResampleMapView<ImageT, ZeroEdgeExtension, BilinearInterpolation>
+  resample_map(ImageViewBase<ImageT> const& image, ResampleMap const& map) {
+    return ResampleMapView<ImageT, ZeroEdgeExtension, BilinearInterpolation>
+      (image.impl(), map, ZeroEdgeExtension(), BilinearInterpolation());
+  }
+
+}} // namespace vw::camera
+
+#endif // __VW_CAMERA_RESAMPLEMAP_H__
@@ -48,6 +48,40 @@ TEST( CAHVOREModel, ForwardReverse ) {
   }
 }
 
+TEST( CAHVOREModel, Batch ) {
+  CAHVOREModel cahvore(Vector3(0.606185,-0.043367,-0.234891),
+                       Vector3(0.712013,0.037316,0.701174),
+                       Vector3(353.341,474.873,350.82),
+                       Vector3(44.0102,16.904,683.916),
+                       Vector3(0.712953,0.038186,0.700171),
+                       Vector3(3e-06,-0.013032,-0.00754),
+                       Vector3(0.000942,0.00228,0.001613),
+                       3, 0.37 );
+
+  // Rows of neighboring pixels, then a jump back across the image
+  std::vector<Vector2> pixels;
+  for ( uint32 j = 100; j < 901; j += 200 )
+    for ( uint32 i = 100; i < 901; i += 25 )
+      pixels.push_back( Vector2(i, j) );
+  pixels.push_back( Vector2(512, 512) );
+  pixels.push_back( Vector2(0, 0) );
+
+  std::vector<Vector3> centers, directions, points;
+  cahvore.pixels_to_rays( pixels, centers, directions );
+  ASSERT_EQ( pixels.size(), directions.size() );
+  for ( size_t i = 0; i < pixels.size(); ++i ) {
+    EXPECT_VECTOR_NEAR( cahvore.C, centers[i], 1e-12 );
+    EXPECT_VECTOR_EQ( cahvore.pixel_to_vector(pixels[i]), directions[i] );
+    points.push_back( cahvore.C + 30*directions[i] );
+  }
+
+  std::vector<Vector2> result;
+  cahvore.points_to_pixels( points, result );
+  ASSERT_EQ( points.size(), result.size() );
+  for ( size_t i = 0; i < points.size(); ++i )
+    EXPECT_VECTOR_NEAR( cahvore.point_to_pixel(points[i]), result[i], 1e-6 );
+}
+
 TEST( CAHVOREModel, StringWriteRead ) {
   CAHVOREModel cahvore(Vector3(0.606185,-0.043367,-0.234891),
                        Vector3(0.712013,0.037316,0.701174),
@@ -177,3 +177,58 @@ TEST( CAHVORModel, ForwardReverse) {
     }
   }
 }
+
+TEST( CAHVORModel, PixelsToRays ) {
+  CAHVORModel cahvor(Vector3(0.491222,-0.0717236,-1.24143),
+                     Vector3(0.921657,-0.230518,0.312107),
+                     Vector3(757.076,1071.6,160.227),
+                     Vector3(91.7479,-27.7504,1319.48),
+                     Vector3(0.920759,-0.206185,0.331197),
+                     Vector3(0.00096,-0.002183,0.018547));
+
+  // An odd count, so the batch has a leftover pixel
+  std::vector<Vector2> pixels;
+  for ( uint32 i = 0; i < 37; i++ )
+    pixels.push_back( Vector2(29.5*i, 1000 - 27.25*i) );
+
+  std::vector<Vector3> centers, directions;
+  cahvor.pixels_to_rays( pixels, centers, directions );
+  ASSERT_EQ( pixels.size(), directions.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_EQ( cahvor.C, centers[i] );
+    EXPECT_VECTOR_EQ( cahvor.pixel_to_vector(pixels[i]), directions[i] );
+  }
+}
+
+TEST( CAHVORModel, SolveDistortion ) {
+  // Equations with every outcome, solved together and one at a time.
+  const size_t num = 7;
+  double a[num] = { 1.0,  1.0,   1.01, 2.0, -1.0,  1.0, 1.0 };
+  double b[num] = { 0.0, -0.01,  0.02, 0.5,  0.0, -3.0, 0.1 };
+  double c[num] = { 0.0,  0.001, 0.003,0.1,  0.0,  1.0, 0.0 };
+  double d[num] = { 1.0,  0.5,   0.8,  3.0,  1.0,  1.0, 2.0 };
+  double start[num] = { 0.5, 0.4, 0.7, 1.0, 1.0, 1.0, 1.0 };
+
+  std::vector<double> x(start, start + num);
+  std::vector<int>    status(num);
+  solve_cahvor_distortion(num, a, b, c, d, &x[0], 1e-10, 20, true, &status[0]);
+  for (size_t i = 0; i < num; i++) {
+    double single = start[i];
+    int    single_status;
+    solve_cahvor_distortion(1, a+i, b+i, c+i, d+i, &single, 1e-10, 20, true, &single_status);
+    EXPECT_EQ( single_status, status[i] );
+    EXPECT_EQ( single, x[i] );
+    if (status[i] == CahvorDistortionConverged) {
+      double x2 = x[i]*x[i];
+      EXPECT_NEAR( d[i], ((c[i]*x2 + b[i])*x2 + a[i])*x[i], 1e-9 );
+    }
+  }
+  EXPECT_EQ( CahvorDistortionConverged, status[0] );
+  EXPECT_EQ( CahvorDistortionNegative,  status[4] );
+  EXPECT_EQ( CahvorDistortionNegative,  status[5] );
+
+  // Running out of steps
+  x.assign(start, start + num);
+  solve_cahvor_distortion(num, a, b, c, d, &x[0], 1e-10, 1, false, &status[0]);
+  EXPECT_EQ( CahvorDistortionMaxSteps, status[3] );
+}
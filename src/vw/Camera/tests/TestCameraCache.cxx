@@ -0,0 +1,93 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestCameraCache.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Math/EulerAngles.h>
+#include <vw/Camera/CameraCache.h>
+#include <vw/Camera/LensDistortion.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Camera/CAHVOREModel.h>
+#include <vw/Camera/CAHVModel.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::camera;
+using namespace vw::test;
+
+TEST( CameraCache, Pinhole ) {
+  BrownConradyDistortion lens(Vector2(-0.6,-0.2),
+                              Vector3(.1336185e-8, -0.5226175e-12, 0),
+                              Vector2(.5495819e-9, 0), 0.201);
+  PinholeModel camera(Vector3(1,2,3), math::euler_to_rotation_matrix(0.1,0.2,0.3,"xyz"),
+                      500.25,501.5, 499.125,502.75, &lens);
+  camera.build_distortion_grids(Vector2i(1000,1000));
+
+  UnlinkName file("camera.vwcam");
+  write_camera_cache(file, camera);
+  EXPECT_TRUE(is_camera_cache(file));
+  boost::shared_ptr<CameraModel> loaded = read_camera_cache(file);
+  PinholeModel* pinhole = dynamic_cast<PinholeModel*>(loaded.get());
+  ASSERT_TRUE(pinhole != NULL);
+
+  EXPECT_VECTOR_EQ(camera.camera_center(), pinhole->camera_center());
+  EXPECT_VECTOR_EQ(camera.focal_length(),  pinhole->focal_length());
+  EXPECT_VECTOR_EQ(camera.point_offset(),  pinhole->point_offset());
+  EXPECT_MATRIX_EQ(camera.get_rotation_matrix(), pinhole->get_rotation_matrix());
+  EXPECT_EQ(lens.name(), pinhole->lens_distortion()->name());
+  EXPECT_VECTOR_EQ(lens.distortion_parameters(),
+                   pinhole->lens_distortion()->distortion_parameters());
+  EXPECT_TRUE(pinhole->has_distortion_grids());
+
+  // The grids come back too, so the results match exactly.
+  for (int i = 0; i <= 10; i++) {
+    Vector2 pix(100*i + 0.5, 1000 - 97*i);
+    EXPECT_VECTOR_EQ(camera.pixel_to_vector(pix), pinhole->pixel_to_vector(pix));
+    Vector3 point = camera.camera_center() + 10*camera.pixel_to_vector(pix);
+    EXPECT_VECTOR_EQ(camera.point_to_pixel(point), pinhole->point_to_pixel(point));
+  }
+}
+
+TEST( CameraCache, CAHV ) {
+  CAHVOREModel cahvore(Vector3(0.2,0.3,0.4), Vector3(0,0,1), Vector3(1000,0,500),
+                       Vector3(0,1000,500), Vector3(0.001,0,1), Vector3(0,0.1,0.01),
+                       Vector3(0.0001,0.00002,0), 0.5);
+  CAHVModel cahv(Vector3(1,2,3), Vector3(0,0,1), Vector3(500,0,320), Vector3(0,500,240));
+
+  UnlinkName file("cahv.vwcam");
+  write_camera_cache(file, cahvore);
+  boost::shared_ptr<CameraModel> loaded = read_camera_cache(file);
+  CAHVOREModel* cahvore2 = dynamic_cast<CAHVOREModel*>(loaded.get());
+  ASSERT_TRUE(cahvore2 != NULL);
+  EXPECT_VECTOR_EQ(cahvore.E, cahvore2->E);
+  EXPECT_EQ(cahvore.P, cahvore2->P);
+
+  write_camera_cache(file, cahv);
+  loaded = read_camera_cache(file);
+  CAHVModel* cahv2 = dynamic_cast<CAHVModel*>(loaded.get());
+  ASSERT_TRUE(cahv2 != NULL);
+  EXPECT_VECTOR_EQ(cahv.C, cahv2->C);
+  EXPECT_VECTOR_EQ(cahv.V, cahv2->V);
+
+  // Text files are not cache files.
+  UnlinkName text("cahv.txt");
+  cahv.write(text);
+  EXPECT_FALSE(is_camera_cache(text));
+  EXPECT_THROW(read_camera_cache(text), IOErr);
+  EXPECT_THROW(read_camera_cache("no_such_camera.vwcam"), IOErr);
+}
@@ -113,3 +113,135 @@ TEST( LinearPushbroom, PixelToVector ) {
   */
 }
 
+
+namespace {
+
+  // A pushbroom camera in a straight orbit looking down at a sphere.
+  class SimpleLinescanModel : public LinescanModel {
+  public:
+    SimpleLinescanModel(Vector3 const& position, Vector3 const& velocity, Quat const& pose,
+                        double time_per_line, Vector2i const& image_size, double focal_length)
+      : LinescanModel(image_size, true, true), m_position_func(position, velocity),
+        m_velocity_func(velocity, Vector3()), m_pose_func(pose),
+        m_time_func(0, time_per_line), m_focal_length(focal_length) {}
+    virtual ~SimpleLinescanModel() {}
+
+    virtual Vector3 get_camera_center_at_time  (double time) const { return m_position_func(time); }
+    virtual Vector3 get_camera_velocity_at_time(double time) const { return m_velocity_func(time); }
+    virtual Quat    get_camera_pose_at_time    (double time) const { return m_pose_func(time);     }
+    virtual double  get_time_at_line           (double line) const { return m_time_func(line);     }
+
+    virtual Vector3 get_local_pixel_vector(Vector2 const& pix) const {
+      return normalize(Vector3(pix.x() - samples_per_line()/2.0, 0, m_focal_length));
+    }
+
+  private:
+    LinearPositionInterpolation m_position_func, m_velocity_func;
+    ConstantPoseInterpolation   m_pose_func;
+    LinearTimeInterpolation     m_time_func;
+    double                      m_focal_length;
+  };
+
+} // end anonymous namespace
+
+TEST( LinescanModel, PointsToPixels ) {
+  // Camera +Y is the flight direction (world +Y) and +Z looks down (world -X).
+  Matrix3x3 rotation;
+  rotation(0,2) = -1;
+  rotation(1,1) =  1;
+  rotation(2,0) =  1;
+  const double radius = 6371000.0, height = 500000.0;
+  SimpleLinescanModel cam(Vector3(radius + height, 0, 0), Vector3(0, 7000, 0), Quat(rotation),
+                          1e-4, Vector2i(1000, 2000), 700000.0);
+
+  // Points seen at known pixels, spread over the image in an irregular order.
+  std::vector<Vector2> truth;
+  std::vector<Vector3> points;
+  for (int i = 0; i < 60; ++i) {
+    Vector2 pix(17.3 + (i*379) % 960, 5.7 + (i*733) % 1990);
+    truth.push_back(pix);
+    points.push_back(cam.camera_center(pix) + (height + 13.0*i)*cam.pixel_to_vector(pix));
+  }
+  // Add a run of neighbours along a row, which reuse the previous line.
+  for (int i = 0; i < 20; ++i) {
+    Vector2 pix(100.5 + 40*i, 1234.25 + 0.1*i);
+    truth.push_back(pix);
+    points.push_back(cam.camera_center(pix) + height*cam.pixel_to_vector(pix));
+  }
+
+  std::vector<Vector2> pixels;
+  cam.points_to_pixels(points, pixels);
+  ASSERT_EQ(points.size(), pixels.size());
+  for (size_t i = 0; i < points.size(); ++i) {
+    EXPECT_VECTOR_NEAR(truth[i], pixels[i], 1e-4);
+    EXPECT_VECTOR_NEAR(cam.point_to_pixel(points[i]), pixels[i], 1e-4);
+  }
+
+  // A point before the first line is not bracketed by the table, so
+  // it must get the same answer as the per-point solver.
+  std::vector<Vector3> outside(1, Vector3(radius, -5000, 100));
+  cam.points_to_pixels(outside, pixels);
+  ASSERT_EQ(1u, pixels.size());
+  Vector2 expected;
+  try {
+    expected = cam.point_to_pixel(outside[0]);
+  } catch (const PointToPixelErr&) {
+    expected = camera::CameraModel::invalid_pixel();
+  }
+  EXPECT_VECTOR_NEAR(expected, pixels[0], 1e-4);
+}
+
+namespace {
+
+  // The same camera, slowly rolling about the flight direction.
+  class RollingLinescanModel : public SimpleLinescanModel {
+  public:
+    RollingLinescanModel(Vector3 const& position, Vector3 const& velocity, Quat const& pose,
+                         double time_per_line, Vector2i const& image_size, double focal_length)
+      : SimpleLinescanModel(position, velocity, pose, time_per_line, image_size, focal_length),
+        m_pose(pose) {}
+
+    virtual Quat get_camera_pose_at_time(double time) const {
+      return Quat(Vector3(0, 1, 0), 0.05*time) * m_pose;
+    }
+  private:
+    Quat m_pose;
+  };
+
+} // end anonymous namespace
+
+TEST( LinescanModel, LineCache ) {
+  Matrix3x3 rotation;
+  rotation(0,2) = -1;
+  rotation(1,1) =  1;
+  rotation(2,0) =  1;
+  const double radius = 6371000.0, height = 500000.0;
+  RollingLinescanModel exact(Vector3(radius + height, 0, 0), Vector3(0, 7000, 0), Quat(rotation),
+                             1e-2, Vector2i(1000, 2000), 700000.0);
+  RollingLinescanModel cached(exact);
+  EXPECT_FALSE(cached.has_line_cache());
+  cached.build_line_cache(16);
+  EXPECT_TRUE(cached.has_line_cache());
+
+  // The camera rolls 0.008 radians between samples, far faster than a
+  // real satellite, so the interpolated rays are still good to 1e-8.
+  for (int i = 0; i <= 20; ++i) {
+    Vector2 pix(50*i + 0.5, -10 + 101.3*i); // Includes lines just outside the image
+    SCOPED_TRACE(pix);
+    EXPECT_VECTOR_NEAR(exact.camera_center  (pix), cached.camera_center  (pix), 1e-6);
+    EXPECT_VECTOR_NEAR(exact.camera_velocity(pix), cached.camera_velocity(pix), 1e-9);
+    EXPECT_VECTOR_NEAR(exact.pixel_to_vector(pix), cached.pixel_to_vector(pix), 1e-8);
+    Vector3 point = exact.camera_center(pix) + height*exact.pixel_to_vector(pix);
+    EXPECT_VECTOR_NEAR(pix, cached.point_to_pixel(point), 1e-2);
+  }
+
+  // Far outside the sampled lines the model is evaluated directly.
+  Vector2 far_pix(500, 10000);
+  EXPECT_VECTOR_EQ(exact.camera_center(far_pix), cached.camera_center(far_pix));
+  Quat exact_pose = exact.camera_pose(far_pix), cached_pose = cached.camera_pose(far_pix);
+  for (size_t k = 0; k < 4; ++k)
+    EXPECT_EQ(exact_pose[k], cached_pose[k]);
+
+  cached.clear_line_cache();
+  EXPECT_FALSE(cached.has_line_cache());
+}
@@ -113,6 +113,43 @@ TEST(OpticalBarModel, CreateCamera) {
     }
   }
 
+  // The batch calls must agree with the single pixel calls
+  std::vector<Vector2> pixels, batch_pixels;
+  std::vector<Vector3> centers, directions, points;
+  for ( size_t i = 0; i < 3000; i += 300 ) {
+    for ( size_t j = 0; j < 2400; j += 300 )
+      pixels.push_back(Vector2(i + 0.5, j + 0.25));
+  }
+  cam1->pixels_to_rays(pixels, centers, directions);
+  ASSERT_EQ(pixels.size(), directions.size());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    EXPECT_VECTOR_NEAR(cam1->camera_center  (pixels[i]), centers   [i], 1e-6);
+    EXPECT_VECTOR_NEAR(cam1->pixel_to_vector(pixels[i]), directions[i], 1e-12);
+    points.push_back(centers[i] + 2e4*directions[i]);
+  }
+  cam1->points_to_pixels(points, batch_pixels);
+  ASSERT_EQ(pixels.size(), batch_pixels.size());
+  for (size_t i = 0; i < pixels.size(); ++i)
+    EXPECT_VECTOR_NEAR(pixels[i], batch_pixels[i], 1e-2 /*pixels*/);
+
+  // The iteration-free guess leaves out only the ray corrections
+  for (size_t i = 0; i < pixels.size(); ++i)
+    EXPECT_VECTOR_NEAR(pixels[i], raw_ptr->pixel_guess(points[i]), 5.0 /*pixels*/);
+
+  // Interpolating the scan table must not move the rays
+  raw_ptr->build_scan_table();
+  ASSERT_TRUE(raw_ptr->has_scan_table());
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    EXPECT_VECTOR_NEAR(centers   [i], cam1->camera_center  (pixels[i]), 1e-6);
+    EXPECT_VECTOR_NEAR(directions[i], cam1->pixel_to_vector(pixels[i]), 1e-10);
+    EXPECT_VECTOR_NEAR(pixels[i], cam1->point_to_pixel(points[i]), 1e-2 /*pixels*/);
+  }
+  cam1->points_to_pixels(points, batch_pixels);
+  for (size_t i = 0; i < pixels.size(); ++i)
+    EXPECT_VECTOR_NEAR(pixels[i], batch_pixels[i], 1e-2 /*pixels*/);
+  raw_ptr->clear_scan_table();
+  EXPECT_FALSE(raw_ptr->has_scan_table());
+
   
   /*
   Vector3   gcc2(-2470746.042265798, 5537165.6573024355, 2515786.8430585163);
@@ -112,6 +112,199 @@ TEST( PinholeModel, TsaiDistortion ) {
 #endif
 }
 
+TEST( PinholeModel, PixelsToRays ) {
+  double distortion_arr[] = {-0.2805362343788147, 0.1062035113573074,
+                             -0.0001422458299202845, 0.00116333004552871};
+  Vector<double> distortion_vec(sizeof(distortion_arr)/sizeof(double), distortion_arr);
+  TsaiLensDistortion lens(distortion_vec);
+  PinholeModel pinhole( Vector3(1,2,3),
+                        math::euler_to_rotation_matrix(0.1,0.2,0.3,"xyz"),
+                        500,500,
+                        500,500,
+                        &lens);
+
+  std::vector<Vector2> pixels;
+  for (int i = 0; i < 10; i++)
+    pixels.push_back(Vector2(100*i+0.5, 37*i));
+  std::vector<Vector3> centers, directions;
+  pinhole.pixels_to_rays(pixels, centers, directions);
+
+  // The batch version must match the single pixel methods exactly
+  ASSERT_EQ(pixels.size(), centers.size());
+  ASSERT_EQ(pixels.size(), directions.size());
+  for (size_t i = 0; i < pixels.size(); i++) {
+    EXPECT_VECTOR_EQ(pinhole.camera_center(pixels[i]),   centers[i]);
+    EXPECT_VECTOR_EQ(pinhole.pixel_to_vector(pixels[i]), directions[i]);
+  }
+}
+
+TEST( PinholeModel, PointsToPixels ) {
+  double distortion_arr[] = {-0.2805362343788147, 0.1062035113573074,
+                             -0.0001422458299202845, 0.00116333004552871};
+  Vector<double> distortion_vec(sizeof(distortion_arr)/sizeof(double), distortion_arr);
+  TsaiLensDistortion lens(distortion_vec);
+  PinholeModel pinhole( Vector3(1,2,3),
+                        math::euler_to_rotation_matrix(0.1,0.2,0.3,"xyz"),
+                        500,500,
+                        500,500,
+                        &lens);
+
+  std::vector<Vector3> points;
+  for (int i = 0; i < 10; i++)
+    points.push_back(pinhole.camera_center() + 10*pinhole.pixel_to_vector(Vector2(100*i+0.5, 37*i)));
+  // Behind the camera, this fails the point_to_pixel check
+  points.push_back(pinhole.camera_center() - 10*pinhole.pixel_to_vector(Vector2(300, 300)));
+
+  std::vector<Vector2> pixels;
+  pinhole.points_to_pixels(points, pixels);
+  ASSERT_EQ(points.size(), pixels.size());
+  for (size_t i = 0; i < points.size(); i++) {
+    try {
+      EXPECT_VECTOR_EQ(pinhole.point_to_pixel(points[i]), pixels[i]);
+    } catch (const PointToPixelErr&) {
+      EXPECT_VECTOR_EQ(PinholeModel::invalid_pixel(), pixels[i]);
+    }
+  }
+  EXPECT_VECTOR_EQ(PinholeModel::invalid_pixel(), pixels.back());
+}
+
+TEST( PinholeModel, DistortionGrids ) {
+  // Tsai undistorts with a solver, BrownConrady distorts with one.
+  double distortion_arr[] = {-0.2805362343788147, 0.1062035113573074,
+                             -0.0001422458299202845, 0.00116333004552871};
+  Vector<double> distortion_vec(sizeof(distortion_arr)/sizeof(double), distortion_arr);
+  TsaiLensDistortion tsai(distortion_vec);
+  BrownConradyDistortion brown(Vector2(-0.6,-0.2),
+                               Vector3(.1336185e-8, -0.5226175e-12, 0),
+                               Vector2(.5495819e-9, 0), 0.201);
+  LensDistortion const* lenses[] = { &tsai, &brown };
+
+  for (int k = 0; k < 2; k++) {
+    PinholeModel exact( Vector3(1,2,3),
+                        math::euler_to_rotation_matrix(0.1,0.2,0.3,"xyz"),
+                        500,500, 500,500, lenses[k] );
+    PinholeModel gridded(exact);
+    gridded.build_distortion_grids(Vector2i(1000,1000), 8, 1e-3);
+    EXPECT_TRUE(gridded.has_distortion_grids());
+
+    // Pixels inside the image, including the border, agree with the
+    // solver. Stay off the principal axis, where the Tsai model is
+    // discontinuous.
+    for (int i = 0; i <= 10; i++) {
+      Vector2 pix(100*i + 0.5, 1000 - 97*i);
+      SCOPED_TRACE(lenses[k]->name());
+      Vector3 dir = exact.pixel_to_vector(pix);
+      EXPECT_VECTOR_NEAR(dir, gridded.pixel_to_vector(pix), 1e-5);
+      Vector3 point = exact.camera_center() + 10*dir;
+      EXPECT_VECTOR_NEAR(pix, gridded.point_to_pixel(point), 5e-3);
+    }
+
+    // Points far off the grid fall back to the solver.
+    Vector2 far_pix(-5000, 3000);
+    try {
+      Vector3 dir = exact.pixel_to_vector(far_pix);
+      EXPECT_VECTOR_EQ(dir, gridded.pixel_to_vector(far_pix));
+    } catch (const vw::Exception&) {
+      EXPECT_THROW(gridded.pixel_to_vector(far_pix), vw::Exception);
+    }
+
+    // Changing the intrinsics drops the grids, changing the pose does not.
+    gridded.set_camera_center(Vector3(4,5,6));
+    EXPECT_TRUE(gridded.has_distortion_grids());
+    gridded.set_focal_length(Vector2(510,510));
+    EXPECT_FALSE(gridded.has_distortion_grids());
+  }
+}
+
+TEST( PinholeModel, AnalyticJacobian ) {
+  double tsai_arr[] = {-0.2805362343788147, 0.1062035113573074,
+                       -0.0001422458299202845, 0.00116333004552871};
+  TsaiLensDistortion tsai(Vector<double>(4, tsai_arr));
+  BrownConradyDistortion brown(Vector2(-0.6,-0.2),
+                               Vector3(.1336185e-8, -0.5226175e-12, 0),
+                               Vector2(.5495819e-9, 0), 0.201);
+  double adjustable_arr[] = {-0.25, 0.08, 0.001, -0.002, 0};
+  AdjustableTsaiLensDistortion adjustable(Vector<double>(5, adjustable_arr));
+  NullLensDistortion null_lens;
+  LensDistortion const* lenses[] = { &null_lens, &tsai, &brown, &adjustable };
+  EXPECT_TRUE (tsai.has_analytic_jacobian());
+  EXPECT_TRUE (brown.has_analytic_jacobian());
+  EXPECT_FALSE(adjustable.has_analytic_jacobian());
+
+  for (int k = 0; k < 4; k++) {
+    SCOPED_TRACE(lenses[k]->name());
+    Matrix3x3 rot = math::euler_to_rotation_matrix(0.1,0.2,0.3,"xyz");
+    PinholeModel cam(Vector3(1,2,3), rot, 250,255, 245,252.5, lenses[k], 0.5);
+    Vector3 point = cam.camera_center() + 10*cam.pixel_to_vector(Vector2(311.5, 708.25));
+
+    Matrix<double,2,3> d_point;
+    Matrix<double,2,6> d_pose;
+    Matrix<double,2,4> d_intrinsics;
+    Matrix<double>     d_distortion;
+    cam.point_to_pixel_jacobian(point, d_point, d_pose, d_intrinsics, d_distortion);
+    ASSERT_EQ(lenses[k]->num_dist_params(), int(d_distortion.cols()));
+
+    // Compare with central differences of the projection
+    const double h = 1e-5;
+    for (int i = 0; i < 3; i++) {
+      Vector3 step;
+      step[i] = h;
+      Vector2 diff = (cam.point_to_pixel_no_check(point + step) -
+                      cam.point_to_pixel_no_check(point - step)) / (2*h);
+      EXPECT_VECTOR_NEAR(diff, select_col(d_point, i), 1e-4);
+
+      PinholeModel moved1(cam), moved2(cam);
+      moved1.set_camera_center(cam.camera_center() + step);
+      moved2.set_camera_center(cam.camera_center() - step);
+      diff = (moved1.point_to_pixel_no_check(point) -
+              moved2.point_to_pixel_no_check(point)) / (2*h);
+      EXPECT_VECTOR_NEAR(diff, select_col(d_pose, i), 1e-4);
+
+      moved1 = cam;
+      moved2 = cam;
+      moved1.set_camera_pose(Matrix3x3(math::axis_angle_to_matrix( step) * rot));
+      moved2.set_camera_pose(Matrix3x3(math::axis_angle_to_matrix(-step) * rot));
+      diff = (moved1.point_to_pixel_no_check(point) -
+              moved2.point_to_pixel_no_check(point)) / (2*h);
+      EXPECT_VECTOR_NEAR(diff, select_col(d_pose, i+3), 1e-3);
+    }
+
+    for (int i = 0; i < 4; i++) {
+      Vector4 intrinsics(250, 255, 245, 252.5), step;
+      step[i] = 1e-3;
+      Vector4 i1 = intrinsics + step, i2 = intrinsics - step;
+      PinholeModel moved1(cam.camera_center(), rot, i1[0], i1[1], i1[2], i1[3], lenses[k], 0.5);
+      PinholeModel moved2(cam.camera_center(), rot, i2[0], i2[1], i2[2], i2[3], lenses[k], 0.5);
+      Vector2 diff = (moved1.point_to_pixel_no_check(point) -
+                      moved2.point_to_pixel_no_check(point)) / (2e-3);
+      EXPECT_VECTOR_NEAR(diff, select_col(d_intrinsics, i), 1e-4);
+    }
+
+    Vector<double> params = lenses[k]->distortion_parameters();
+    for (size_t i = 0; i < params.size(); i++) {
+      // Some parameters multiply high powers of the radius, so keep
+      // the pixel change small too.
+      double col_norm = norm_2(select_col(d_distortion, i));
+      double step = 1e-6*std::max(std::abs(params[i]), 1e-3);
+      if (col_norm > 0)
+        step = std::min(step, 1e-3/col_norm);
+      boost::shared_ptr<LensDistortion> lens1 = lenses[k]->copy(), lens2 = lenses[k]->copy();
+      Vector<double> p1 = params, p2 = params;
+      p1[i] += step;
+      p2[i] -= step;
+      lens1->set_distortion_parameters(p1);
+      lens2->set_distortion_parameters(p2);
+      PinholeModel moved1(cam), moved2(cam);
+      moved1.set_lens_distortion(lens1.get());
+      moved2.set_lens_distortion(lens2.get());
+      Vector2 diff = (moved1.point_to_pixel_no_check(point) -
+                      moved2.point_to_pixel_no_check(point)) / (2*step);
+      EXPECT_NEAR(0, norm_2(diff - select_col(d_distortion, i)),
+                  1e-4*std::max(norm_2(diff), 1.0));
+    }
+  }
+}
+
 TEST( PinholeModel, ScalePinhole ) {
   Matrix<double,3,3> rot = vw::math::euler_to_quaternion(1.15, 0.0, -1.57, "xyz").rotation_matrix();
   double distortion_arr[] = {-0.2796604335308075, 0.1031486615538597,
@@ -0,0 +1,153 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestResampleMap.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Math/EulerAngles.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Camera/LensDistortion.h>
+#include <vw/Camera/PinholeModel.h>
+#include <vw/Camera/ResampleMap.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::camera;
+using namespace vw::test;
+
+namespace {
+
+  PinholeModel distorted_camera(TsaiLensDistortion const& lens) {
+    return PinholeModel(Vector3(1,2,3),
+                        math::euler_to_rotation_matrix(0.1,0.2,0.3,"xyz"),
+                        60, 60, 40, 30, &lens);
+  }
+
+  ImageView<float> test_image() {
+    ImageView<float> image(80, 60);
+    for (int32 row = 0; row < image.rows(); ++row)
+      for (int32 col = 0; col < image.cols(); ++col)
+        image(col, row) = float((col*7 + row*13) % 31) + 0.25f*col;
+    return image;
+  }
+
+  TsaiLensDistortion test_lens() {
+    // No tangential terms, Tsai distortion special cases the center lines.
+    Vector4 distortion(-0.28, 0.10, 0, 0);
+    return TsaiLensDistortion(distortion);
+  }
+
+}
+
+TEST( ResampleMap, MatchesDirectUndistortion ) {
+  TsaiLensDistortion lens = test_lens();
+  PinholeModel camera = distorted_camera(lens);
+  ImageView<float> image = test_image();
+
+  Vector2 offset(-5.5, -4.25);
+  ResampleMap map = undistortion_map(camera, Vector2i(90, 70), offset);
+  ASSERT_EQ(90, map.cols());
+  ASSERT_EQ(70, map.rows());
+
+  // What undistort_image computes for each output pixel
+  ImageView<float> expected(90, 70), expected_cubic(90, 70);
+  for (int32 row = 0; row < 70; ++row) {
+    for (int32 col = 0; col < 90; ++col) {
+      Vector2 pix = lens.distorted_coordinates(camera, Vector2(col, row) + offset);
+      expected(col, row) = interpolate(image, BilinearInterpolation(),
+                                       ValueEdgeExtension<float>(-1))(pix[0], pix[1]);
+      expected_cubic(col, row) = interpolate(image, BicubicInterpolation(),
+                                             ValueEdgeExtension<float>(-1))(pix[0], pix[1]);
+    }
+  }
+
+  ImageView<float> result = resample_map(image, map, ValueEdgeExtension<float>(-1),
+                                         BilinearInterpolation());
+  ImageView<float> result_cubic = resample_map(image, map, ValueEdgeExtension<float>(-1),
+                                               BicubicInterpolation());
+  map.set_fixed_point(true);
+  ASSERT_TRUE(map.has_fixed_point());
+  ImageView<float> result_fixed = resample_map(image, map, ValueEdgeExtension<float>(-1),
+                                               BilinearInterpolation());
+
+  // The map stores float positions, so allow for their rounding.
+  for (int32 row = 0; row < 70; ++row) {
+    for (int32 col = 0; col < 90; ++col) {
+      EXPECT_NEAR(expected      (col, row), result      (col, row), 1e-3);
+      EXPECT_NEAR(expected_cubic(col, row), result_cubic(col, row), 1e-3);
+      EXPECT_NEAR(expected      (col, row), result_fixed(col, row), 5e-3);
+    }
+  }
+}
+
+TEST( ResampleMap, CameraToCamera ) {
+  TsaiLensDistortion lens = test_lens();
+  PinholeModel camera = distorted_camera(lens);
+  PinholeModel linear = strip_lens_distortion(camera);
+
+  BBox2i bbox(-40, -30, 160, 120);
+  ResampleMap map    = camera_resample_map(camera, linear, bbox);
+  ResampleMap direct = undistortion_map(camera, bbox.size(), bbox.min());
+  for (int32 row = 0; row < map.rows(); ++row)
+    for (int32 col = 0; col < map.cols(); ++col)
+      EXPECT_VECTOR_NEAR(direct(col, row), map(col, row), 1e-3);
+
+  // Masked pixels which sample only the edge extension come out invalid.
+  ImageView<PixelMask<float> > masked = pixel_cast<PixelMask<float> >(test_image());
+  PixelMask<float> nodata;
+  ImageView<PixelMask<float> > result
+    = resample_map(masked, map, ValueEdgeExtension<PixelMask<float> >(nodata),
+                   BilinearInterpolation());
+  EXPECT_TRUE (is_valid(result(80, 60)));
+  EXPECT_FALSE(is_valid(result(0, 0)));
+}
+
+TEST( ResampleMap, WriteRead ) {
+  ImageView<Vector2f> positions(7, 5);
+  for (int32 row = 0; row < positions.rows(); ++row)
+    for (int32 col = 0; col < positions.cols(); ++col)
+      positions(col, row) = Vector2f(col + 0.3f*row, row - 0.75f);
+  positions(3, 2) = ResampleMap::invalid_position();
+  ResampleMap map(positions, true);
+
+  UnlinkName file("resample.map");
+  map.write(file);
+  ResampleMap loaded;
+  loaded.read(file);
+
+  ASSERT_EQ(map.cols(), loaded.cols());
+  ASSERT_EQ(map.rows(), loaded.rows());
+  EXPECT_TRUE(loaded.has_fixed_point());
+  for (int32 row = 0; row < map.rows(); ++row) {
+    for (int32 col = 0; col < map.cols(); ++col) {
+      EXPECT_VECTOR_EQ(map(col, row), loaded(col, row));
+      EXPECT_EQ(map.fixed_point(col, row).x,  loaded.fixed_point(col, row).x);
+      EXPECT_EQ(map.fixed_point(col, row).wx, loaded.fixed_point(col, row).wx);
+    }
+  }
+  EXPECT_FALSE(ResampleMap::is_valid(loaded(3, 2)));
+
+  // Position (1, 0) is (1, -0.75), so its bilinear footprint starts at
+  // (1, -1) with a quarter of the weight on the lower row.
+  EXPECT_EQ(1,  map.fixed_point(1, 0).x);
+  EXPECT_EQ(-1, map.fixed_point(1, 0).y);
+  EXPECT_EQ(0,  map.fixed_point(1, 0).wx);
+  EXPECT_EQ(ResampleMap::FIXED_POINT_SCALE/4, map.fixed_point(1, 0).wy);
+
+  EXPECT_THROW(loaded.read("no_such_resample.map"), IOErr);
+}
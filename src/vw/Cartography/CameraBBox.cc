@@ -52,6 +52,26 @@ cartography::geospatial_intersect(cartography::GeoReference const& georef,
   return projected_point;
 }
 
+bool
+cartography::detail::ray_ellipsoid_lengths( double semi_major_axis, double semi_minor_axis,
+                                            Vector3 const& camera_ctr, Vector3 const& camera_vec,
+                                            double& near_len, double& far_len ) {
+  // Scale z so the ellipsoid becomes a sphere, then solve the quadratic.
+  double ratio = semi_major_axis / semi_minor_axis;
+  Vector3 c(camera_ctr[0], camera_ctr[1], camera_ctr[2]*ratio);
+  Vector3 v(camera_vec[0], camera_vec[1], camera_vec[2]*ratio);
+  double qa = dot_prod(v, v);
+  double qb = 2.0*dot_prod(c, v);
+  double qc = dot_prod(c, c) - semi_major_axis*semi_major_axis;
+  double disc = qb*qb - 4.0*qa*qc;
+  if (qa <= 0 || disc < 0)
+    return false;
+  double root = std::sqrt(disc);
+  near_len = (-qb - root)/(2.0*qa);
+  far_len  = (-qb + root)/(2.0*qa);
+  return true;
+}
+
 namespace vw { namespace cartography { namespace detail {
 
   /// A class to help identify the extent of an image when
@@ -128,6 +148,55 @@ namespace vw { namespace cartography { namespace detail {
   
 }}}
   
+cartography::detail::DemRayBounds::DemRayBounds(Datum const& datum, BBox2 const& lonlat_box,
+                                                double min_height, double max_height)
+  : m_enabled(true), m_datum(datum), m_lonlat_box(lonlat_box),
+    m_min_height(min_height), m_max_height(max_height) {}
+
+bool cartography::detail::DemRayBounds::may_intersect(Vector3 const& camera_ctr,
+                                                      Vector3 const& camera_vec) const {
+  if (!m_enabled)
+    return true;
+
+  // A camera below the top of the terrain can see it in any direction.
+  if (m_datum.cartesian_to_geodetic(camera_ctr)[2] <= m_max_height)
+    return true;
+
+  // The ray must reach the highest shell to hit the DEM at all.
+  Vector3 high = datum_intersection(m_datum.semi_major_axis() + m_max_height,
+                                    m_datum.semi_minor_axis() + m_max_height,
+                                    camera_ctr, camera_vec);
+  if (high == Vector3())
+    return false;
+
+  // A ray which grazes the highest shell without reaching the lowest
+  // one has no simple bound, so let it through.
+  Vector3 low = datum_intersection(m_datum.semi_major_axis() + m_min_height,
+                                   m_datum.semi_minor_axis() + m_min_height,
+                                   camera_ctr, camera_vec);
+  if (low == Vector3())
+    return true;
+
+  // Between the two shells the ray is short next to the planet, so
+  // its path in lon-lat is nearly straight.  It misses the DEM if both
+  // ends are off the same side of the DEM's box.
+  Vector2 center = m_lonlat_box.center();
+  Vector2 ends[2];
+  ends[0] = subvector(m_datum.cartesian_to_geodetic(high), 0, 2);
+  ends[1] = subvector(m_datum.cartesian_to_geodetic(low),  0, 2);
+  for (int i = 0; i < 2; i++) {
+    while (ends[i][0] - center[0] >  180) ends[i][0] -= 360;
+    while (ends[i][0] - center[0] < -180) ends[i][0] += 360;
+  }
+  for (int d = 0; d < 2; d++) {
+    if (ends[0][d] < m_lonlat_box.min()[d] && ends[1][d] < m_lonlat_box.min()[d])
+      return false;
+    if (ends[0][d] > m_lonlat_box.max()[d] && ends[1][d] > m_lonlat_box.max()[d])
+      return false;
+  }
+  return true;
+}
+
 BBox2 cartography::camera_bbox( cartography::GeoReference const& georef,
                                 boost::shared_ptr<camera::CameraModel> camera_model,
                                 int32 cols, int32 rows, float &scale,
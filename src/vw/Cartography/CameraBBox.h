@@ -29,9 +29,11 @@
 #include <vw/Image/Interpolation.h>
 #include <vw/Math/LevenbergMarquardt.h>
 #include <vw/Math/BresenhamLine.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Camera/CameraModel.h>
 #include <vw/Cartography/PointImageManipulation.h>
 #include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/DEMHeightBounds.h>
 
 
 #include <boost/shared_ptr.hpp>
@@ -53,6 +55,15 @@ namespace cartography {
                                 Vector3 const& camera_ctr, Vector3 const& camera_vec,
                                 bool& has_intersection );
 
+  namespace detail {
+    // Find the distances along a ray, in units of camera_vec, where it
+    // enters and leaves an ellipsoid centered at the origin.  Returns
+    // false if it misses.
+    bool ray_ellipsoid_lengths( double semi_major_axis, double semi_minor_axis,
+                                Vector3 const& camera_ctr, Vector3 const& camera_vec,
+                                double& near_len, double& far_len );
+  }
+
 
   // Define an LMA model to solve for a DEM intersecting a ray. The
   // variable of optimization is position on the ray. The cost
@@ -237,6 +248,166 @@ namespace cartography {
     return Vector3();
   }
 
+  namespace detail {
+
+    /// Find the first stretch of the ray, between len0 and len1, where
+    /// it passes from above the DEM to below it.  Stretches whose height
+    /// range does not overlap the DEM heights under them are skipped
+    /// whole, and the rest are halved until they span only a few DEM
+    /// pixels, which are then sampled at about one point per pixel.
+    /// On success len_above and len_below bracket the crossing.
+    template <class DEMImageT>
+    bool bracket_dem_crossing( RayDEMIntersectionLMA<DEMImageT> const& model,
+                               GeoReference const& georef,
+                               DEMHeightBounds<DEMImageT> const& bounds,
+                               Vector3 const& camera_ctr, Vector3 const& camera_vec,
+                               double len0, double len1,
+                               double & len_above, double & len_below ) {
+
+      const int32  LEAF_PIXELS = 2*DEMHeightBounds<DEMImageT>::CELL_SIZE;
+      const int    MAX_DEPTH   = 40;
+      const double vec_norm    = norm_2(camera_vec);
+      const double radius      = georef.datum().semi_minor_axis();
+
+      std::vector<Vector3> stack; // len0, len1, depth
+      stack.push_back(Vector3(len0, len1, 0));
+      while (!stack.empty()) {
+        Vector3 item = stack.back();
+        stack.pop_back();
+        double a = item[0], b = item[1];
+        int depth = int(item[2]);
+
+        Vector3 llh_a = georef.datum().cartesian_to_geodetic(camera_ctr + a*camera_vec);
+        Vector3 llh_b = georef.datum().cartesian_to_geodetic(camera_ctr + b*camera_vec);
+        Vector2 pix_a = georef.lonlat_to_pixel(subvector(llh_a, 0, 2));
+        Vector2 pix_b = georef.lonlat_to_pixel(subvector(llh_b, 0, 2));
+
+        // The DEM pixels under this stretch.  A straight ray bows away
+        // from both the ground track and the height of its ends, by
+        // about length^2/(8 radius), so pad generously.
+        BBox2 pix_box;
+        pix_box.grow(pix_a);
+        pix_box.grow(pix_b);
+        double span = std::max(pix_box.width(), pix_box.height());
+        pix_box.expand(2 + 0.1*span);
+        BBox2i box(Vector2i(int32(floor(pix_box.min().x())), int32(floor(pix_box.min().y()))),
+                   Vector2i(int32(ceil (pix_box.max().x())), int32(ceil (pix_box.max().y()))));
+
+        double ray_len   = (b - a)*vec_norm;
+        double ray_min_h = std::min(llh_a[2], llh_b[2]) - ray_len*ray_len/(8*radius) - 1.0;
+        double dem_min_h, dem_max_h;
+        if (!bounds.height_range(box, dem_min_h, dem_max_h) || ray_min_h > dem_max_h)
+          continue; // No terrain this high under this stretch
+
+        if (span > LEAF_PIXELS && depth < MAX_DEPTH) {
+          double mid = 0.5*(a + b);
+          stack.push_back(Vector3(mid, b, depth+1)); // The far half is searched last
+          stack.push_back(Vector3(a, mid, depth+1));
+          continue;
+        }
+
+        // Sample the stretch.  A value of big_val() means no DEM there.
+        int num = std::max(2, int(ceil(span)) + 1);
+        double prev_len = a, prev_val = model(Vector<double,1>(a))[0];
+        for (int i = 1; i <= num; i++) {
+          double len = a + (b - a)*i/num;
+          double val = model(Vector<double,1>(len))[0];
+          bool prev_ok = std::abs(prev_val) < model.big_val()/10.0;
+          bool ok      = std::abs(val)      < model.big_val()/10.0;
+          if (prev_ok && ok && prev_val <= 0 && val >= 0) {
+            len_above = prev_len;
+            len_below = len;
+            return true;
+          }
+          prev_len = len;
+          prev_val = val;
+        }
+      }
+      return false;
+    }
+
+  } // end namespace detail
+
+  /// A version of camera_pixel_to_dem_xyz() which uses the height
+  /// bounds of the DEM to skip the parts of the ray that cannot meet
+  /// it, and returns the first place where the ray goes below the DEM
+  /// surface, which is the one the camera sees.  The search is limited
+  /// to where the ray is between the lowest and highest DEM heights.
+  template <class DEMImageT>
+  Vector3 camera_pixel_to_dem_xyz(Vector3 const& camera_ctr, Vector3 const& camera_vec,
+                                  ImageViewBase<DEMImageT> const& dem_image,
+                                  GeoReference const& georef,
+                                  DEMHeightBounds<DEMImageT> const& bounds,
+                                  bool treat_nodata_as_zero,
+                                  bool & has_intersection,
+                                  double height_error_tol = 1e-1, // error in DEM height
+                                  int num_max_iter        = 100
+                                  ){
+    has_intersection = false;
+    try {
+      double min_h, max_h;
+      if (!bounds.height_range(min_h, max_h))
+        return Vector3();
+      // A little slack for the offset ellipsoids only approximating
+      // constant height.
+      min_h -= 1.0 + 1e-3*std::abs(min_h);
+      max_h += 1.0 + 1e-3*std::abs(max_h);
+
+      const double a = georef.datum().semi_major_axis();
+      const double b = georef.datum().semi_minor_axis();
+      double top_near, top_far, bottom_near, bottom_far;
+      if (!detail::ray_ellipsoid_lengths(a + max_h, b + max_h, camera_ctr, camera_vec,
+                                         top_near, top_far) || top_far <= 0)
+        return Vector3();
+      double len0 = std::max(top_near, 0.0);
+      double len1 = top_far;
+      if (detail::ray_ellipsoid_lengths(a + min_h, b + min_h, camera_ctr, camera_vec,
+                                        bottom_near, bottom_far) && bottom_near > len0)
+        len1 = bottom_near;
+
+      RayDEMIntersectionLMA<DEMImageT> model(dem_image, georef, camera_ctr,
+                                             camera_vec, treat_nodata_as_zero);
+      double len_above, len_below;
+      if (!detail::bracket_dem_crossing(model, georef, bounds, camera_ctr, camera_vec,
+                                        len0, len1, len_above, len_below))
+        return Vector3();
+
+      // Refine with regula falsi, halving the weight of an end which
+      // is kept twice in a row (the Illinois variant) so it cannot
+      // stall.  A point with no DEM counts as above it.
+      double f_above = model(Vector<double,1>(len_above))[0];
+      double f_below = model(Vector<double,1>(len_below))[0];
+      double len = len_above, val = f_above;
+      int side = 0;
+      for (int i = 0; i < num_max_iter; i++) {
+        if (std::abs(val) <= 0.5*height_error_tol)
+          break;
+        len = (f_below - f_above != 0) ?
+          (len_above*f_below - len_below*f_above)/(f_below - f_above) : 0.5*(len_above + len_below);
+        val = model(Vector<double,1>(len))[0];
+        if (std::abs(val) >= model.big_val()/10.0 || val < 0) {
+          if (std::abs(val) >= model.big_val()/10.0)
+            val = -std::abs(f_above);
+          len_above = len; f_above = val;
+          if (side == -1) f_below *= 0.5;
+          side = -1;
+        } else {
+          len_below = len; f_below = val;
+          if (side == 1) f_above *= 0.5;
+          side = 1;
+        }
+      }
+      if (std::abs(model(Vector<double,1>(len))[0]) > height_error_tol)
+        return Vector3();
+
+      has_intersection = true;
+      return camera_ctr + len*camera_vec;
+    }catch(...){
+      has_intersection = false;
+    }
+    return Vector3();
+  }
+
   namespace detail {
 
     // TODO: This should be done by default!
@@ -254,19 +425,98 @@ namespace cartography {
       }
     }
 
+    /// Bounds the region where a ray can hit a DEM, so that rays
+    /// which pass far from it can be rejected without the iterative
+    /// intersection, which is slowest exactly when there is no hit.
+    /// The region is the DEM's lon-lat box between two shells around
+    /// the datum at the DEM's lowest and highest heights.  A default
+    /// constructed object lets every ray through.
+    class DemRayBounds {
+    public:
+      DemRayBounds() : m_enabled(false) {}
+      DemRayBounds(Datum const& datum, BBox2 const& lonlat_box,
+                   double min_height, double max_height);
+
+      /// False only if the ray cannot hit the DEM.
+      bool may_intersect(Vector3 const& camera_ctr, Vector3 const& camera_vec) const;
+
+    private:
+      bool   m_enabled;
+      Datum  m_datum;
+      BBox2  m_lonlat_box;
+      double m_min_height, m_max_height;
+    };
+
+    template <class PixelT>
+    typename boost::enable_if< IsScalar<PixelT>, double >::type
+    inline dem_pixel_height( PixelT const& val ) { return val; }
+
+    template <class PixelT>
+    typename boost::enable_if< IsCompound<PixelT>, double >::type
+    inline dem_pixel_height( PixelT const& val ) { return val[0]; }
+
+    /// Build the DemRayBounds of a DEM.  The height range comes from a
+    /// subsampled scan of the DEM, so it is padded generously.
+    template <class DEMImageT>
+    DemRayBounds dem_ray_bounds(ImageViewBase<DEMImageT> const& dem,
+                                GeoReference const& georef) {
+      const int32 MAX_SAMPLES = 256; // per dimension
+      int32 cols = dem.impl().cols(), rows = dem.impl().rows();
+      if (cols <= 0 || rows <= 0)
+        return DemRayBounds();
+
+      int32 col_step = std::max(1, cols / MAX_SAMPLES);
+      int32 row_step = std::max(1, rows / MAX_SAMPLES);
+      double min_height = std::numeric_limits<double>::max();
+      double max_height = -std::numeric_limits<double>::max();
+      for (int32 row = 0; row < rows + row_step; row += row_step) {
+        for (int32 col = 0; col < cols + col_step; col += col_step) {
+          typename DEMImageT::pixel_type val
+            = dem.impl()(std::min(col, cols-1), std::min(row, rows-1));
+          if (!is_valid(val))
+            continue;
+          double height = dem_pixel_height(val);
+          min_height = std::min(min_height, height);
+          max_height = std::max(max_height, height);
+        }
+      }
+      if (min_height > max_height)
+        return DemRayBounds();
+
+      double pad = 0.25*(max_height - min_height) + 100.0;
+      try {
+        // A couple of pixels of margin for the interpolation at the edges
+        BBox2 lonlat_box = georef.pixel_to_lonlat_bbox(BBox2i(-2, -2, cols+4, rows+4));
+        return DemRayBounds(georef.datum(), lonlat_box, min_height - pad, max_height + pad);
+      } catch(...) {
+        return DemRayBounds();
+      }
+    }
+
+    /// A camera pixel and where it meets the DEM, if it does.
+    struct CameraDEMSample {
+      Vector2 pixel;
+      Vector2 point; ///< In the target projection
+      Vector3 xyz;
+      bool    valid;
+      CameraDEMSample() : valid(false) {}
+    };
+
     /// Class to accumulate some information about a series of DEM intersections
     template <class DEMImageT>
     class CameraDEMBBoxHelper {
       GeoReference m_dem_georef, m_target_georef;
       boost::shared_ptr<camera::CameraModel> m_camera;
       DEMImageT    m_dem;
-      Vector2      m_last_intersect;
+      Vector2      m_last_intersect, m_last_pixel;
       std::vector<Vector3> *m_coords;
+      DemRayBounds m_bounds;
+      boost::shared_ptr<DEMHeightBounds<DEMImageT> > m_height_bounds;
 
     public:
       bool   m_last_valid, m_center_on_zero;
       BBox2  box;   ///< Bounding box containing all intersections so far.
-      double scale; ///< Closest distance between two sequential intersections, in projected coords.
+      double scale; ///< Smallest ground distance per image pixel between two sequential intersections, in projected coords.
       std::vector<Vector2> cam_pixels; // Collect sampled pixels here
       
       /// Constructor initializes class with DEM, camera model, etc.
@@ -283,8 +533,12 @@ namespace cartography {
           scale( std::numeric_limits<double>::max() ) {
         if (m_coords)
           m_coords->clear();
+        m_height_bounds.reset(new DEMHeightBounds<DEMImageT>(dem));
       }
 
+      /// Reject rays outside of these bounds before intersecting them.
+      void set_ray_bounds(DemRayBounds const& bounds) { m_bounds = bounds; }
+
       // This is a function we don't want exposed outside the logic of this file,
       // as we make too many particular choices.
       static bool camera_pixel_to_dem_point(Vector2 const& pixel,
@@ -294,7 +548,9 @@ namespace cartography {
                                             boost::shared_ptr<camera::CameraModel> camera,
                                             bool center_on_zero,
                                             Vector2 & point, // output
-                                            Vector3 & xyz){
+                                            Vector3 & xyz,
+                                            DemRayBounds const& bounds = DemRayBounds(),
+                                            DEMHeightBounds<DEMImageT> const* height_bounds = 0){
 
         // This is a very fragile function, and at many steps something can fail.
         try {
@@ -309,15 +565,24 @@ namespace cartography {
           Vector3 xyz_guess       = Vector3();
           Vector3 camera_ctr = camera->camera_center(pixel);  // Get ray from this pixel
           Vector3 camera_vec = camera->pixel_to_vector(pixel);
+          if (!bounds.may_intersect(camera_ctr, camera_vec))
+            return false;
           
           // Use iterative solver call to compute an intersection of the pixel with the DEM	
-          xyz = camera_pixel_to_dem_xyz(camera_ctr, camera_vec,
-                                        dem, dem_georef,
-                                        treat_nodata_as_zero,
-                                        has_intersection,
-                                        height_error_tol, max_abs_tol, max_rel_tol,
-                                        num_max_iter, xyz_guess
-                                       );
+          if (height_bounds)
+            xyz = camera_pixel_to_dem_xyz(camera_ctr, camera_vec,
+                                          dem, dem_georef, *height_bounds,
+                                          treat_nodata_as_zero,
+                                          has_intersection,
+                                          height_error_tol, num_max_iter);
+          else
+            xyz = camera_pixel_to_dem_xyz(camera_ctr, camera_vec,
+                                          dem, dem_georef,
+                                          treat_nodata_as_zero,
+                                          has_intersection,
+                                          height_error_tol, max_abs_tol, max_rel_tol,
+                                          num_max_iter, xyz_guess
+                                         );
           // Quit if we did not find an intersection
           if (!has_intersection)
             return false;
@@ -334,18 +599,30 @@ namespace cartography {
         }
       }
       
+      /// Intersect this pixel with the DEM.  This does not change the
+      /// helper, so it may be called from several threads at once.
+      CameraDEMSample sample( Vector2 const& pixel ) const {
+        CameraDEMSample result;
+        result.pixel = pixel;
+        result.valid = camera_pixel_to_dem_point(pixel, m_dem, m_dem_georef,
+                                                 m_target_georef,
+                                                 m_camera, m_center_on_zero,
+                                                 result.point, // output
+                                                 result.xyz, m_bounds,
+                                                 m_height_bounds.get());
+        return result;
+      }
+
       /// Intersect this pixel with the DEM and record some information about the intersection
       void operator() ( Vector2 const& pixel ) {
+        add(sample(pixel));
+      }
+
+      /// Record a sample.  Samples along a line must be added in order.
+      void add( CameraDEMSample const& s ) {
 
-        Vector2 point;
-        Vector3 xyz;
-        bool has_intersection = camera_pixel_to_dem_point(pixel, m_dem, m_dem_georef,
-                                                          m_target_georef,
-                                                          m_camera, m_center_on_zero,  
-                                                          point, // output
-                                                          xyz);
         // Quit if we did not find an intersection
-        if ( !has_intersection ) {
+        if ( !s.valid ) {
           m_last_valid = false;
           return;
         }
@@ -353,23 +630,195 @@ namespace cartography {
         if ( m_last_valid ) {
           // If the call before this successfully intersected, compute
           // distance from last intersection.
-          double current_scale = norm_2( point - m_last_intersect );
+          double pixel_dist    = norm_2( s.pixel - m_last_pixel );
+          double current_scale = norm_2( s.point - m_last_intersect ) / std::max(pixel_dist, 1.0);
           if ( current_scale < scale ) // Record this distance if less than last distance
             scale = current_scale;
         }
         
-        m_last_intersect = point; // Record this intersection
+        m_last_intersect = s.point; // Record this intersection
+        m_last_pixel     = s.pixel;
         
         if (m_coords)
-          m_coords->push_back(xyz);
+          m_coords->push_back(s.xyz);
         
-        box.grow( point ); // Expand a bounding box of all points intersected so far
+        box.grow( s.point ); // Expand a bounding box of all points intersected so far
         m_last_valid = true; // Record intersection success
-        cam_pixels.push_back(pixel);
+        cam_pixels.push_back(s.pixel);
         
       }
     }; // End class CameraDEMBBoxHelper
 
+    /// Intersects a range of pixels with the DEM.
+    template <class DEMImageT>
+    class CameraDEMSampleTask : public Task {
+      CameraDEMBBoxHelper<DEMImageT> const& m_helper;
+      std::vector<Vector2>          const& m_pixels;
+      std::vector<CameraDEMSample>       & m_samples;
+      size_t m_begin, m_end;
+    public:
+      CameraDEMSampleTask(CameraDEMBBoxHelper<DEMImageT> const& helper,
+                          std::vector<Vector2> const& pixels,
+                          std::vector<CameraDEMSample> & samples,
+                          size_t begin, size_t end)
+        : m_helper(helper), m_pixels(pixels), m_samples(samples),
+          m_begin(begin), m_end(end) {}
+
+      virtual void operator()() {
+        for (size_t i = m_begin; i < m_end; i++)
+          m_samples[i] = m_helper.sample(m_pixels[i]);
+      }
+    };
+
+    /// Intersect all of the pixels with the DEM, using the thread pool.
+    template <class DEMImageT>
+    void sample_pixels(CameraDEMBBoxHelper<DEMImageT> const& helper,
+                       std::vector<Vector2> const& pixels,
+                       std::vector<CameraDEMSample> & samples) {
+      const size_t CHUNK = 16;
+      samples.clear();
+      samples.resize(pixels.size());
+      FifoWorkQueue queue;
+      for (size_t begin = 0; begin < pixels.size(); begin += CHUNK) {
+        size_t end = std::min(begin + CHUNK, pixels.size());
+        queue.add_task(boost::shared_ptr<Task>
+                       (new CameraDEMSampleTask<DEMImageT>(helper, pixels, samples, begin, end)));
+      }
+      queue.join_all();
+    }
+
+    /// Decide whether the stretch of line between two samples needs
+    /// more samples, given the sample at its middle.  It does if the
+    /// middle does not lie close to the straight line between the
+    /// ends on the ground, or if the DEM is hit at some of the three
+    /// samples but not all of them.
+    inline bool needs_refinement(CameraDEMSample const& a, CameraDEMSample const& mid,
+                                 CameraDEMSample const& b) {
+      const double TOLERANCE = 0.02; // fraction of the ground distance between the ends
+      if (!a.valid || !mid.valid || !b.valid)
+        return a.valid || mid.valid || b.valid;
+      return norm_2(mid.point - 0.5*(a.point + b.point)) > TOLERANCE*norm_2(b.point - a.point);
+    }
+
+    /// Samples one stretch of a line between two already sampled
+    /// pixels, halving it wherever needs_refinement() says so, but
+    /// never closer than min_step pixels.  The new samples come out in
+    /// order along the line, not including the two ends.
+    template <class DEMImageT>
+    class CameraDEMRefineTask : public Task {
+      CameraDEMBBoxHelper<DEMImageT> const& m_helper;
+      std::vector<Vector2>          const& m_line;
+      size_t          m_begin, m_end;
+      CameraDEMSample m_first, m_last;
+      size_t          m_min_step;
+      std::vector<CameraDEMSample> & m_samples;
+
+      void refine(size_t i, size_t j, CameraDEMSample const& si, CameraDEMSample const& sj) {
+        if (j - i <= m_min_step)
+          return;
+        size_t mid = (i + j)/2;
+        CameraDEMSample smid = m_helper.sample(m_line[mid]);
+        bool split = needs_refinement(si, smid, sj);
+        if (split)
+          refine(i, mid, si, smid);
+        m_samples.push_back(smid);
+        if (split)
+          refine(mid, j, smid, sj);
+      }
+
+    public:
+      CameraDEMRefineTask(CameraDEMBBoxHelper<DEMImageT> const& helper,
+                          std::vector<Vector2> const& line,
+                          size_t begin, size_t end,
+                          CameraDEMSample const& first, CameraDEMSample const& last,
+                          size_t min_step, std::vector<CameraDEMSample> & samples)
+        : m_helper(helper), m_line(line), m_begin(begin), m_end(end),
+          m_first(first), m_last(last), m_min_step(min_step), m_samples(samples) {}
+
+      virtual void operator()() {
+        m_samples.clear();
+        refine(m_begin, m_end, m_first, m_last);
+      }
+    };
+
+    /// Trace lines of image pixels to the DEM.  Each line is sampled
+    /// coarsely at first, and then only the stretches where the ground
+    /// points diverge from a straight line are sampled down to
+    /// min_step pixels.  Both passes use the thread pool.  The samples
+    /// of each line come back in order along it and always include its
+    /// two ends.
+    template <class DEMImageT>
+    void trace_lines(CameraDEMBBoxHelper<DEMImageT> const& helper,
+                     std::vector<std::vector<Vector2> > const& lines,
+                     size_t min_step,
+                     std::vector<std::vector<CameraDEMSample> > & traced) {
+      const size_t NUM_COARSE = 64; // about this many stretches per line to start with
+      min_step = std::max(min_step, size_t(1));
+
+      // Pick the coarse samples of all the lines and intersect them together.
+      std::vector<std::vector<size_t> > coarse(lines.size());
+      std::vector<Vector2> coarse_pixels;
+      for (size_t l = 0; l < lines.size(); l++) {
+        size_t n = lines[l].size();
+        if (n == 0)
+          continue;
+        size_t step = min_step;
+        while (n - 1 > NUM_COARSE*step)
+          step *= 2;
+        for (size_t i = 0; i < n - 1; i += step)
+          coarse[l].push_back(i);
+        coarse[l].push_back(n - 1);
+        for (size_t k = 0; k < coarse[l].size(); k++)
+          coarse_pixels.push_back(lines[l][coarse[l][k]]);
+      }
+      std::vector<CameraDEMSample> coarse_samples;
+      sample_pixels(helper, coarse_pixels, coarse_samples);
+
+      // Refine each stretch between coarse samples.
+      size_t num_stretches = 0;
+      for (size_t l = 0; l < lines.size(); l++)
+        if (!coarse[l].empty())
+          num_stretches += coarse[l].size() - 1;
+      std::vector<std::vector<CameraDEMSample> > refined(num_stretches);
+      {
+        FifoWorkQueue queue;
+        size_t c = 0, r = 0;
+        for (size_t l = 0; l < lines.size(); l++) {
+          for (size_t k = 0; k + 1 < coarse[l].size(); k++, c++, r++)
+            queue.add_task(boost::shared_ptr<Task>
+                           (new CameraDEMRefineTask<DEMImageT>(helper, lines[l],
+                                                               coarse[l][k], coarse[l][k+1],
+                                                               coarse_samples[c], coarse_samples[c+1],
+                                                               min_step, refined[r])));
+          if (!coarse[l].empty())
+            c++;
+        }
+        queue.join_all();
+      }
+
+      // Stitch the samples of each line back together in order.
+      traced.clear();
+      traced.resize(lines.size());
+      size_t c = 0, r = 0;
+      for (size_t l = 0; l < lines.size(); l++) {
+        for (size_t k = 0; k < coarse[l].size(); k++, c++) {
+          traced[l].push_back(coarse_samples[c]);
+          if (k + 1 < coarse[l].size()) {
+            traced[l].insert(traced[l].end(), refined[r].begin(), refined[r].end());
+            r++;
+          }
+        }
+      }
+    }
+
+    /// The pixels on a Bresenham line, not including the end point.
+    inline std::vector<Vector2> bresenham_pixels(math::BresenhamLine line) {
+      std::vector<Vector2> pixels;
+      for ( ; line.is_good(); ++line)
+        pixels.push_back(*line);
+      return pixels;
+    }
+
     // Collect valid pixel coordinates on the perimeter of the DEM,
     // and also inside using an X pattern. Some of these points may be duplicated. 
     template <class DEMImageT>
@@ -525,39 +974,39 @@ namespace cartography {
     // Construct helper class with DEM and camera information.
     detail::CameraDEMBBoxHelper<DEMImageT> functor( dem, dem_georef, target_georef,
                                                     camera_model, center_on_zero, coords );
+    functor.set_ray_bounds(detail::dem_ray_bounds(dem, dem_georef));
 
     // Running the edges. Note: The last valid point on a
     // BresenhamLine is the last point before the endpoint.
-
+    std::vector<std::vector<Vector2> > lines;
     // Left to right across the top side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(0,0,cols,0), image_step, functor );
-    
+    lines.push_back(detail::bresenham_pixels(math::BresenhamLine(0,0,cols,0)));
     // Top to bottom down the right side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(cols-1,0,cols-1,rows), image_step, functor );
-
+    lines.push_back(detail::bresenham_pixels(math::BresenhamLine(cols-1,0,cols-1,rows)));
     // Right to left across the bottom side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(cols-1,rows-1,0,rows-1), image_step, functor );
-
+    lines.push_back(detail::bresenham_pixels(math::BresenhamLine(cols-1,rows-1,0,rows-1)));
     // Bottom to top up the left side
-    functor.m_last_valid = false;
-    bresenham_apply( math::BresenhamLine(0,rows-1,0,0), image_step, functor );
-
+    lines.push_back(detail::bresenham_pixels(math::BresenhamLine(0,rows-1,0,0)));
     if (!quick) {
       // Do the x pattern
-      functor.m_last_valid = false;
-      bresenham_apply( math::BresenhamLine(0,0,cols-1,rows-1), image_step, functor );
+      lines.push_back(detail::bresenham_pixels(math::BresenhamLine(0,0,cols-1,rows-1)));
+      lines.push_back(detail::bresenham_pixels(math::BresenhamLine(0,rows-1,cols-1,0)));
+    }
 
+    // The image_step spacing is only used where the ground points
+    // along a line do not follow a straight path.
+    std::vector<std::vector<detail::CameraDEMSample> > traced;
+    detail::trace_lines(functor, lines, image_step, traced);
+    for (size_t l = 0; l < traced.size(); l++) {
       functor.m_last_valid = false;
-      bresenham_apply( math::BresenhamLine(0,rows-1,cols-1,0), image_step, functor );
-      functor.m_last_valid = false;
+      for (size_t k = 0; k < traced[l].size(); k++)
+        functor.add(traced[l][k]);
     }
+    functor.m_last_valid = false;
     
     // Estimate the smallest distance between adjacent points on the bounding box edges
     // We in fact want the average distance, so we will re-estimate that below.
-    mean_gsd = functor.scale/double(image_step);
+    mean_gsd = functor.scale;
 
     // The bounding box collected so far. 
     BBox2 cam_bbox = functor.box;
@@ -578,10 +1027,12 @@ namespace cartography {
       std::vector<Vector2> dem_pixels;
       detail::sample_points_on_dem(dem, dem_step, dem_pixels);
         
-      // Project the sampled points into the camera
+      // Find the ground point at each sampled DEM pixel
+      std::vector<Vector3> dem_xyz;
+      std::vector<Vector2> dem_points;
       for (size_t it = 0; it < dem_pixels.size(); it++) {
 
-        Vector2 lonlat, point, dem_pix, cam_pix;
+        Vector2 lonlat, point, dem_pix;
         double  height;
         Vector3 llh, xyz;
 
@@ -602,22 +1053,8 @@ namespace cartography {
           if (xyz == Vector3() || xyz != xyz) // watch for invalid values
             continue;
 
-          cam_pix = camera_model->point_to_pixel(xyz);
-          if (cam_pix != cam_pix)
-            continue; // watch for nan
-	
-          if (cam_pix[0] >= 0 && cam_pix[0] <= cols-1 &&
-              cam_pix[1] >= 0 && cam_pix[1] <= rows-1 ) {
-
-            // Finally a good point we can accept
-            cam_bbox.grow(point);
-            //vw_out() << "cam_pix: " << cam_pix << std::endl;
-            //vw_out() << "point: " << point << std::endl;
-            //vw_out() << "llh: " << llh << std::endl;
-
-            // Add to cam_pixels from this different way of sampling
-            cam_pixels.push_back(cam_pix);
-          }
+          dem_xyz.push_back(xyz);
+          dem_points.push_back(point);
         }
         catch(...) {
           // It is possible to hit exceptions in here from coordinate transformation and such which
@@ -627,12 +1064,46 @@ namespace cartography {
           continue;
         }  
       } // End loop through points on the DEM
+
+      // Project the sampled points into the camera all at once
+      std::vector<Vector2> dem_cam_pixels;
+      try {
+        camera_model->points_to_pixels(dem_xyz, dem_cam_pixels);
+      } catch(...) {
+        // Skip the points the camera model can't handle, one at a time
+        dem_cam_pixels.resize(dem_xyz.size());
+        for (size_t it = 0; it < dem_xyz.size(); it++) {
+          try {
+            dem_cam_pixels[it] = camera_model->point_to_pixel(dem_xyz[it]);
+          } catch(...) {
+            dem_cam_pixels[it] = camera::CameraModel::invalid_pixel();
+          }
+        }
+      }
+
+      for (size_t it = 0; it < dem_cam_pixels.size(); it++) {
+        Vector2 const& cam_pix = dem_cam_pixels[it];
+        if (cam_pix != cam_pix)
+          continue; // watch for nan
+	
+        if (cam_pix[0] >= 0 && cam_pix[0] <= cols-1 &&
+            cam_pix[1] >= 0 && cam_pix[1] <= rows-1 ) {
+
+          // Finally a good point we can accept
+          cam_bbox.grow(dem_points[it]);
+
+          // Add to cam_pixels from this different way of sampling
+          cam_pixels.push_back(cam_pix);
+        }
+      }
       
       //vw_out() << "Expanded bbox with DEM to image: " << cam_bbox << std::endl;
     } // End if (!quick)
 
-    // Now estimate the gsd, in point units, by projecting onto the ground neighboring points
-    std::vector<double> gsd;
+    // Now estimate the gsd, in point units, by projecting onto the ground neighboring points.
+    // Each group is a sampled pixel followed by its neighbors in the image.
+    std::vector<Vector2> gsd_pixels;
+    std::vector<size_t>  group_begin;
     BBox2i image_box(0, 0, cols, rows);
     for (size_t it = 0; it < cam_pixels.size(); it++) {
 
@@ -640,16 +1111,8 @@ namespace cartography {
       if (!image_box.contains(ctr_pix))
         continue;
 
-      Vector2 ctr_point;
-      Vector3 xyz;
-      bool has_intersection = functor.camera_pixel_to_dem_point(ctr_pix, dem, dem_georef,
-                                                                target_georef,  
-                                                                camera_model, center_on_zero,  
-                                                                ctr_point, // output
-                                                                xyz
-                                                               );
-      if ( !has_intersection )
-        continue; 
+      group_begin.push_back(gsd_pixels.size());
+      gsd_pixels.push_back(ctr_pix);
       
       // Four neighboring pixels
       for (int j = 0; j < 4; j++) {
@@ -658,20 +1121,23 @@ namespace cartography {
         if (j == 1) off_pix += Vector2i(0, 1);
         if (j == 2) off_pix += Vector2i(-1, 0);
         if (j == 3) off_pix += Vector2i(0, -1);
-        if (!image_box.contains(off_pix))
-          continue;
-        
-        Vector2 off_point;
-        bool has_intersection = functor.camera_pixel_to_dem_point(off_pix, dem, dem_georef,
-                                                                  target_georef,  
-                                                                  camera_model, center_on_zero,  
-                                                                  off_point, // output
-                                                                  xyz
-                                                                 );
-        if ( !has_intersection )
-          continue; 
-
-        gsd.push_back(norm_2(ctr_point-off_point));
+        if (image_box.contains(off_pix))
+          gsd_pixels.push_back(off_pix);
+      }
+    }
+    group_begin.push_back(gsd_pixels.size());
+
+    std::vector<detail::CameraDEMSample> gsd_samples;
+    detail::sample_pixels(functor, gsd_pixels, gsd_samples);
+
+    std::vector<double> gsd;
+    for (size_t g = 0; g + 1 < group_begin.size(); g++) {
+      detail::CameraDEMSample const& ctr = gsd_samples[group_begin[g]];
+      if ( !ctr.valid )
+        continue; 
+      for (size_t k = group_begin[g] + 1; k < group_begin[g+1]; k++) {
+        if ( gsd_samples[k].valid )
+          gsd.push_back(norm_2(ctr.point - gsd_samples[k].point));
       }
     }
 
@@ -32,12 +32,23 @@
  ****************************************************************************/
 
 #include <vw/Cartography/Chipper.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/Condition.h>
 
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
 #include <iostream>
 #include <limits>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 
 /**
 The objective is to split the region into non-overlapping blocks, each
@@ -387,6 +398,499 @@ void Chipper::emit(ChipRefList& wide, PointId widemin, PointId widemax,
   //m_out_buffers.push_back(buf);
 }
 
+
+//---------------------------------------------------------------------------
+// StreamingChipper
+
+// A descriptor for a point file, closed with the last reference to it.
+class PointFile
+{
+public:
+    explicit PointFile(int fd) : m_fd(fd)
+    {}
+    ~PointFile()
+    {
+        ::close(m_fd);
+    }
+    int fd() const
+    {
+        return m_fd;
+    }
+
+    // Read or write count points starting at point index first.
+    void read(boost::uint64_t first, size_t count, Vector3* points) const
+    {
+        char* data = reinterpret_cast<char*>(points);
+        size_t size = count*sizeof(Vector3), done = 0;
+        while (done < size)
+        {
+            ssize_t n = ::pread(m_fd, data + done, size - done,
+                                first*sizeof(Vector3) + done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                vw_throw(IOErr() << "StreamingChipper: read failed: "
+                                 << (n < 0 ? ::strerror(errno) : "unexpected end of file"));
+            done += n;
+        }
+    }
+    void write(boost::uint64_t first, size_t count, Vector3 const* points) const
+    {
+        char const* data = reinterpret_cast<char const*>(points);
+        size_t size = count*sizeof(Vector3), done = 0;
+        while (done < size)
+        {
+            ssize_t n = ::pwrite(m_fd, data + done, size - done,
+                                 first*sizeof(Vector3) + done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                vw_throw(IOErr() << "StreamingChipper: write failed: " << ::strerror(errno));
+            done += n;
+        }
+    }
+
+private:
+    int m_fd;
+    PointFile(const PointFile&); // not implemented
+    PointFile& operator=(const PointFile&); // not implemented
+};
+
+namespace
+{
+
+// Points are streamed through buffers of this many.
+const size_t STREAM_POINTS = 65536;
+
+// Bins in each histogram pass of StreamingChipper::findSplit().
+const size_t SPLIT_BINS = 4096;
+
+boost::shared_ptr<PointFile> scratchFile(std::string const& dir)
+{
+    std::string templ = dir + "/vwchipXXXXXX";
+    std::vector<char> path(templ.begin(), templ.end());
+    path.push_back('\0');
+    int fd = ::mkstemp(&path[0]);
+    if (fd == -1)
+        vw_throw(IOErr() << "StreamingChipper: failed to create scratch file from template "
+                         << templ << ": " << ::strerror(errno));
+    // The space is given back when the node is done, or however the
+    // process exits.
+    ::unlink(&path[0]);
+    return boost::shared_ptr<PointFile>(new PointFile(fd));
+}
+
+// Appends points to a file through a buffer.
+class PointWriter
+{
+public:
+    explicit PointWriter(boost::shared_ptr<PointFile> file) :
+        m_file(file), m_count(0)
+    {
+        m_buf.reserve(STREAM_POINTS);
+    }
+    void push_back(Vector3 const& pt)
+    {
+        m_buf.push_back(pt);
+        m_bounds.grow(subvector(pt, 0, 2));
+        if (m_buf.size() == STREAM_POINTS)
+            flush();
+    }
+    void flush()
+    {
+        if (m_buf.empty())
+            return;
+        m_file->write(m_count, m_buf.size(), &m_buf[0]);
+        m_count += m_buf.size();
+        m_buf.clear();
+    }
+    BBox2 const& bounds() const
+    {
+        return m_bounds;
+    }
+
+private:
+    boost::shared_ptr<PointFile> m_file;
+    std::vector<Vector3> m_buf;
+    boost::uint64_t m_count;
+    BBox2 m_bounds;
+};
+
+struct AxisLess
+{
+    int axis;
+    explicit AxisLess(int axis) : axis(axis)
+    {}
+    bool operator()(Vector3 const& a, Vector3 const& b) const
+    {
+        return a[axis] < b[axis];
+    }
+};
+
+// Split on x when the points are at least as wide in x as in y.
+int widerAxis(BBox2 const& bounds)
+{
+    return (bounds.width() >= bounds.height()) ? 0 : 1;
+}
+
+} // anonymous namespace
+
+
+// The nodes waiting to be split, shared by the workers.  Depth first,
+// so few scratch files are open at once.
+struct StreamingChipper::Queue
+{
+    Mutex mutex;
+    Condition cond;
+    std::vector<Node> nodes;
+    int active;
+    std::exception_ptr error;
+
+    Queue() : active(0)
+    {}
+};
+
+class StreamingChipper::Worker
+{
+public:
+    Worker(StreamingChipper& chipper, Queue& queue, size_t capacity) :
+        m_chipper(chipper), m_queue(queue), m_capacity(capacity)
+    {}
+
+    void operator()()
+    {
+        std::vector<Node> children;
+        while (true)
+        {
+            Node node;
+            {
+                Mutex::Lock lock(m_queue.mutex);
+                while (m_queue.nodes.empty() && m_queue.active > 0 && !m_queue.error)
+                    m_queue.cond.wait(lock);
+                if (m_queue.nodes.empty() || m_queue.error)
+                    return;
+                node = m_queue.nodes.back();
+                m_queue.nodes.pop_back();
+                m_queue.active++;
+            }
+
+            children.clear();
+            try
+            {
+                m_chipper.process(node, m_capacity, children);
+            }
+            catch (...)
+            {
+                Mutex::Lock lock(m_queue.mutex);
+                if (!m_queue.error)
+                    m_queue.error = std::current_exception();
+            }
+            node = Node(); // Release the parent's scratch file
+
+            Mutex::Lock lock(m_queue.mutex);
+            m_queue.active--;
+            m_queue.nodes.insert(m_queue.nodes.end(), children.begin(), children.end());
+            m_queue.cond.notify_all();
+        }
+    }
+
+private:
+    StreamingChipper& m_chipper;
+    Queue& m_queue;
+    size_t m_capacity;
+};
+
+
+StreamingChipper::StreamingChipper(std::string const& pointFile, int blockSize,
+                                   std::string const& chipFile,
+                                   size_t memoryLimit, int numThreads,
+                                   std::string const& scratchDir) :
+    m_chipFile(chipFile),
+    m_scratchDir(scratchDir.empty() ? vw_settings().tmp_directory() : scratchDir),
+    m_numMaxPtsInChip(point_count_t(blockSize)*blockSize)
+{
+    VW_ASSERT(blockSize > 0,
+              ArgumentErr() << "StreamingChipper: The block size must be positive.\n");
+    if (numThreads <= 0)
+        numThreads = std::max(int(vw_settings().default_num_threads()), 1);
+
+    int fd = ::open(pointFile.c_str(), O_RDONLY);
+    if (fd == -1)
+        vw_throw(IOErr() << "StreamingChipper: Could not open file: " << pointFile);
+    Node root;
+    root.file.reset(new PointFile(fd));
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size % sizeof(Vector3) != 0)
+        vw_throw(IOErr() << "StreamingChipper: \"" << pointFile << "\" is not a point file.");
+    point_count_t total = info.st_size / sizeof(Vector3);
+
+    fd = ::open(chipFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        vw_throw(IOErr() << "StreamingChipper: Could not open file: " << chipFile);
+    m_chipOut.reset(new PointFile(fd));
+    if (total == 0)
+    {
+        m_chipOut.reset();
+        return;
+    }
+
+    partition(total);
+    m_chips.resize(m_partitions.size() - 1);
+    root.pleft = 0;
+    root.pright = m_partitions.size() - 1;
+
+    // One pass for the extent of the whole cloud.
+    std::vector<Vector3> buf(std::min<point_count_t>(STREAM_POINTS, total));
+    for (point_count_t start = 0; start < total; start += buf.size())
+    {
+        size_t n = std::min<point_count_t>(buf.size(), total - start);
+        root.file->read(start, n, &buf[0]);
+        for (size_t i = 0; i < n; ++i)
+            root.bounds.grow(subvector(buf[i], 0, 2));
+    }
+
+    // Each worker holds at most one in-memory node and three stream
+    // buffers, and never less than one chip.
+    size_t capacity = memoryLimit / numThreads / sizeof(Vector3);
+    capacity = (capacity > 3*STREAM_POINTS) ? capacity - 3*STREAM_POINTS : 0;
+    capacity = std::max<size_t>(capacity, m_numMaxPtsInChip);
+
+    Queue queue;
+    queue.nodes.push_back(root);
+    root = Node();
+    std::vector<boost::shared_ptr<Thread> > threads;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        boost::shared_ptr<Worker> worker(new Worker(*this, queue, capacity));
+        threads.push_back(boost::shared_ptr<Thread>(new Thread(worker)));
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i]->join();
+    m_chipOut.reset();
+    if (queue.error)
+        std::rethrow_exception(queue.error);
+}
+
+
+// The same cumulate and round as Chipper::partition().
+void StreamingChipper::partition(point_count_t size)
+{
+    size_t num_partitions = size / m_numMaxPtsInChip;
+    if (size % m_numMaxPtsInChip)
+        num_partitions++;
+
+    double total(0.0);
+    double partition_size = static_cast<double>(size) / num_partitions;
+    m_partitions.push_back(0);
+    for (size_t i = 0; i < num_partitions; ++i)
+    {
+        total += partition_size;
+        m_partitions.push_back(static_cast<PointId>(llround(total)));
+    }
+}
+
+
+void StreamingChipper::process(Node const& node, size_t capacity,
+                               std::vector<Node>& children)
+{
+    point_count_t size = m_partitions[node.pright] - m_partitions[node.pleft];
+    if (size <= capacity)
+    {
+        PointBuffer points(size);
+        node.file->read(0, size, &points[0]);
+        chipInMemory(points.begin(), node.pleft, node.pright);
+        return;
+    }
+
+    // Split in the wider direction at the partition in the middle, like
+    // Chipper::split().
+    int axis = widerAxis(node.bounds);
+    PointId pcenter = (node.pleft + node.pright) / 2;
+    point_count_t want = m_partitions[pcenter] - m_partitions[node.pleft];
+    double value;
+    point_count_t ties;
+    findSplit(node, axis, want, capacity, value, ties);
+
+    Node left, right;
+    left.file = scratchFile(m_scratchDir);
+    right.file = scratchFile(m_scratchDir);
+    PointWriter lwriter(left.file), rwriter(right.file);
+    std::vector<Vector3> buf(STREAM_POINTS);
+    for (point_count_t start = 0; start < size; start += buf.size())
+    {
+        size_t n = std::min<point_count_t>(buf.size(), size - start);
+        node.file->read(start, n, &buf[0]);
+        for (size_t i = 0; i < n; ++i)
+        {
+            double c = buf[i][axis];
+            if (c < value || (c == value && ties > 0))
+            {
+                if (c == value)
+                    ties--;
+                lwriter.push_back(buf[i]);
+            }
+            else
+                rwriter.push_back(buf[i]);
+        }
+    }
+    lwriter.flush();
+    rwriter.flush();
+
+    left.pleft = node.pleft;
+    left.pright = pcenter;
+    left.bounds = lwriter.bounds();
+    right.pleft = pcenter;
+    right.pright = node.pright;
+    right.bounds = rwriter.bounds();
+    children.push_back(right);
+    children.push_back(left);
+}
+
+
+// Find the split value so that the points below it, and the first
+// ties of those equal to it, are the want smallest on the axis.
+void StreamingChipper::findSplit(Node const& node, int axis, point_count_t want,
+                                 size_t capacity, double& value, point_count_t& ties)
+{
+    point_count_t size = m_partitions[node.pright] - m_partitions[node.pleft];
+    std::vector<Vector3> buf(STREAM_POINTS);
+
+    // The range [lo,hi) holds the split, or [lo,hi] at the top end, and
+    // below points lie under lo.  Bin membership is decided only by
+    // comparing with edge(), so that a bin narrows to exactly its points.
+    double lo = node.bounds.min()[axis], hi = node.bounds.max()[axis];
+    bool closed = true;
+    point_count_t below = 0;
+    std::vector<point_count_t> counts(SPLIT_BINS);
+    std::vector<double> bin_min(SPLIT_BINS), bin_max(SPLIT_BINS);
+    while (true)
+    {
+        const double width = (hi - lo) / SPLIT_BINS;
+        #define EDGE(b) (((b) == SPLIT_BINS) ? hi : lo + double(b)*width)
+        std::fill(counts.begin(), counts.end(), 0);
+        std::fill(bin_min.begin(), bin_min.end(), std::numeric_limits<double>::max());
+        std::fill(bin_max.begin(), bin_max.end(), -std::numeric_limits<double>::max());
+        for (point_count_t start = 0; start < size; start += buf.size())
+        {
+            size_t n = std::min<point_count_t>(buf.size(), size - start);
+            node.file->read(start, n, &buf[0]);
+            for (size_t i = 0; i < n; ++i)
+            {
+                double c = buf[i][axis];
+                if (c < lo || c > hi || (c == hi && !closed))
+                    continue;
+                size_t b = (width > 0) ? size_t(std::max(0.0, std::min((c - lo) / width,
+                                                                       double(SPLIT_BINS - 1))))
+                                       : 0;
+                while (b > 0 && c < EDGE(b))
+                    b--;
+                while (b + 1 < SPLIT_BINS && c >= EDGE(b + 1))
+                    b++;
+                counts[b]++;
+                bin_min[b] = std::min(bin_min[b], c);
+                bin_max[b] = std::max(bin_max[b], c);
+            }
+        }
+
+        // The bin holding the want'th point
+        size_t b = 0;
+        while (b + 1 < SPLIT_BINS && below + counts[b] <= want)
+            below += counts[b++];
+        point_count_t k = want - below;
+
+        if (bin_min[b] == bin_max[b])
+        {
+            // All equal, so no need to look closer.
+            value = bin_min[b];
+            ties = k;
+            return;
+        }
+        if (counts[b] <= capacity)
+        {
+            // Few enough to find the exact value in memory.
+            std::vector<double> values;
+            values.reserve(counts[b]);
+            for (point_count_t start = 0; start < size; start += buf.size())
+            {
+                size_t n = std::min<point_count_t>(buf.size(), size - start);
+                node.file->read(start, n, &buf[0]);
+                for (size_t i = 0; i < n; ++i)
+                {
+                    double c = buf[i][axis];
+                    if (c >= bin_min[b] && c <= bin_max[b])
+                        values.push_back(c);
+                }
+            }
+            std::nth_element(values.begin(), values.begin() + k, values.end());
+            value = values[k];
+            ties = k;
+            for (size_t i = 0; i < values.size(); ++i)
+                if (values[i] < value)
+                    ties--;
+            return;
+        }
+
+        double new_lo = EDGE(b), new_hi = EDGE(b + 1);
+        closed = closed && (b + 1 == SPLIT_BINS);
+        lo = new_lo;
+        hi = new_hi;
+        #undef EDGE
+    }
+}
+
+
+void StreamingChipper::chipInMemory(PointBuffer::iterator begin,
+                                    PointId pleft, PointId pright)
+{
+    point_count_t size = m_partitions[pright] - m_partitions[pleft];
+    BBox2 bounds;
+    for (PointBuffer::iterator it = begin; it != begin + size; ++it)
+        bounds.grow(subvector(*it, 0, 2));
+
+    if (pright - pleft == 1)
+    {
+        Chip& chip = m_chips[pleft];
+        chip.offset = m_partitions[pleft];
+        chip.count = size;
+        chip.bounds = bounds;
+        m_chipOut->write(chip.offset, size, &*begin);
+        return;
+    }
+
+    int axis = widerAxis(bounds);
+    PointId pcenter = (pleft + pright) / 2;
+    point_count_t want = m_partitions[pcenter] - m_partitions[pleft];
+    std::nth_element(begin, begin + want, begin + size, AxisLess(axis));
+    chipInMemory(begin, pleft, pcenter);
+    chipInMemory(begin + want, pcenter, pright);
+}
+
+
+void StreamingChipper::readChip(size_t i, PointBuffer& points) const
+{
+    VW_ASSERT(i < m_chips.size(),
+              ArgumentErr() << "StreamingChipper: No chip " << i << ".\n");
+    int fd = ::open(m_chipFile.c_str(), O_RDONLY);
+    if (fd == -1)
+        vw_throw(IOErr() << "StreamingChipper: Could not open file: " << m_chipFile);
+    PointFile file(fd);
+    points.resize(m_chips[i].count);
+    if (!points.empty())
+        file.read(m_chips[i].offset, points.size(), &points[0]);
+}
+
+
+void StreamingChipper::writePointFile(std::string const& filename,
+                                      PointBuffer const& points)
+{
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        vw_throw(IOErr() << "StreamingChipper: Could not open file: " << filename);
+    PointFile file(fd);
+    if (!points.empty())
+        file.write(0, points.size(), &points[0]);
+}
+
   
 } // namespace filters
 } // namespace pdal
@@ -43,9 +43,14 @@
  ****************************************************************************/
 
 #include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Cartography/GeoReference.h>
 
+#include <string>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
 
 /**
 The objective is to split the region into non-overlapping blocks, each
@@ -181,6 +186,77 @@ private:
     Chipper(const Chipper&); // not implemented
 };
 
+class PointFile;
+
+/// The same partitioning as Chipper, for a point file too large for
+/// memory.  The input is a flat file of native (x,y,z) doubles, and
+/// each chip of at most blockSize*blockSize points is written to its
+/// place in chipFile, in the same order Chipper would fill blocks.
+///
+/// A node of the split tree which fits in memory is chipped there by
+/// median splitting.  A larger one is split on its wider axis without
+/// loading it: one pass histograms that coordinate, narrowing to the
+/// bin holding the split until that bin fits in memory, and a second
+/// pass streams the two halves into unlinked scratch files.  The
+/// halves are independent, so they are chipped in parallel on
+/// numThreads threads, each using at most its share of memoryLimit.
+class StreamingChipper
+{
+public:
+    struct Chip
+    {
+        boost::uint64_t offset; ///< First point of the chip in the chip file
+        point_count_t count;
+        vw::BBox2 bounds;       ///< Extent of the points in x and y
+    };
+
+    /// numThreads = 0 means vw_settings().default_num_threads(), and an
+    /// empty scratchDir means vw_settings().tmp_directory().
+    StreamingChipper(std::string const& pointFile, int blockSize,
+                     std::string const& chipFile,
+                     size_t memoryLimit = size_t(512) << 20,
+                     int numThreads = 0,
+                     std::string const& scratchDir = "");
+
+    size_t numChips() const
+        { return m_chips.size(); }
+    Chip const& chip(size_t i) const
+        { return m_chips[i]; }
+
+    /// Read the points of one chip back from the chip file.
+    void readChip(size_t i, PointBuffer& points) const;
+
+    /// Write points as a point file this class can read.
+    static void writePointFile(std::string const& filename,
+                               PointBuffer const& points);
+
+private:
+    struct Node
+    {
+        boost::shared_ptr<PointFile> file;
+        PointId pleft, pright;
+        vw::BBox2 bounds;
+    };
+    class Worker;
+    struct Queue;
+
+    void partition(point_count_t size);
+    void process(Node const& node, size_t capacity, std::vector<Node>& children);
+    void chipInMemory(PointBuffer::iterator begin, PointId pleft, PointId pright);
+    void findSplit(Node const& node, int axis, point_count_t want,
+                   size_t capacity, double& value, point_count_t& ties);
+
+    std::string m_chipFile;
+    std::string m_scratchDir;
+    boost::shared_ptr<PointFile> m_chipOut;
+    point_count_t m_numMaxPtsInChip;
+    std::vector<PointId> m_partitions;
+    std::vector<Chip> m_chips;
+
+    StreamingChipper& operator=(const StreamingChipper&); // not implemented
+    StreamingChipper(const StreamingChipper&); // not implemented
+};
+
 } // namespace filters
 } // namespace pdal
 
@@ -0,0 +1,240 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DEMHeightBounds.h
+///
+/// A min/max height pyramid over a DEM, for skipping the parts of a
+/// ray which are far from the terrain.
+///
+#ifndef __VW_CARTOGRAPHY_DEMHEIGHTBOUNDS_H__
+#define __VW_CARTOGRAPHY_DEMHEIGHTBOUNDS_H__
+
+#include <limits>
+#include <vector>
+
+#include <vw/Core/Thread.h>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility/enable_if.hpp>
+
+namespace vw {
+namespace cartography {
+
+  /// Stores the lowest and highest height of a DEM over square blocks
+  /// of pixels.  The blocks are CELL_SIZE pixels on a side at the
+  /// finest level and double at each coarser level, up to a whole
+  /// tile, so that each tile holds a small quadtree.  A tile is
+  /// scanned the first time a query touches it, so building the object
+  /// is cheap even for a large DEM on disk.  Queries may come from
+  /// several threads at once.
+  ///
+  /// Each block also covers the row and column of pixels just past it,
+  /// so the range bounds any bilinear interpolation of the DEM inside
+  /// the block.  With treat_nodata_as_zero, invalid pixels and the area
+  /// outside the DEM count as height zero, otherwise they are ignored.
+  template <class DEMImageT>
+  class DEMHeightBounds : private boost::noncopyable {
+  public:
+    static const int32 CELL_SIZE = 4;
+
+    DEMHeightBounds(ImageViewBase<DEMImageT> const& dem,
+                    bool treat_nodata_as_zero = false, int32 tile_size = 256)
+      : m_dem(dem.impl()), m_nodata_as_zero(treat_nodata_as_zero) {
+      VW_ASSERT(tile_size >= CELL_SIZE && (tile_size % CELL_SIZE) == 0,
+                ArgumentErr() << "DEMHeightBounds: The tile size must be a multiple of "
+                              << CELL_SIZE << ".");
+      m_tile_size = tile_size;
+      m_num_levels = 1;
+      while ((CELL_SIZE << (m_num_levels-1)) < tile_size)
+        m_num_levels++;
+      m_tile_cols = (m_dem.cols() + tile_size - 1) / tile_size;
+      m_tile_rows = (m_dem.rows() + tile_size - 1) / tile_size;
+      m_tiles.resize(size_t(m_tile_cols)*size_t(m_tile_rows));
+    }
+
+    int32 cols() const { return m_dem.cols(); }
+    int32 rows() const { return m_dem.rows(); }
+
+    /// The range of heights over the pixels in box, possibly widened to
+    /// that of the blocks around it.  Returns false if there are none.
+    bool height_range(BBox2i const& box, double& min_height, double& max_height) const {
+      min_height =  std::numeric_limits<double>::max();
+      max_height = -std::numeric_limits<double>::max();
+      if (box.empty())
+        return false;
+
+      BBox2i dem_box(0, 0, cols(), rows());
+      if (m_nodata_as_zero && !dem_box.contains(box)) {
+        min_height = std::min(min_height, 0.0);
+        max_height = std::max(max_height, 0.0);
+      }
+      BBox2i clipped = box;
+      clipped.crop(dem_box);
+      if (clipped.empty())
+        return min_height <= max_height;
+
+      // Use the finest level where the box spans no more than about
+      // two blocks each way.
+      int32 size  = std::max(clipped.width(), clipped.height());
+      int32 level = 0;
+      while (level + 1 < m_num_levels && (CELL_SIZE << level) < (size+1)/2)
+        level++;
+      const int32 cell = CELL_SIZE << level;
+
+      int32 tx0 = clipped.min().x() / m_tile_size, tx1 = (clipped.max().x()-1) / m_tile_size;
+      int32 ty0 = clipped.min().y() / m_tile_size, ty1 = (clipped.max().y()-1) / m_tile_size;
+      for (int32 ty = ty0; ty <= ty1; ty++) {
+        for (int32 tx = tx0; tx <= tx1; tx++) {
+          boost::shared_ptr<const Tile> tile = get_tile(tx, ty);
+          Level const& lev = tile->levels[level];
+          int32 ox = tx*m_tile_size, oy = ty*m_tile_size;
+          int32 cx0 = std::max(clipped.min().x() - ox, 0) / cell;
+          int32 cy0 = std::max(clipped.min().y() - oy, 0) / cell;
+          int32 cx1 = std::min((clipped.max().x() - 1 - ox) / cell, lev.cols - 1);
+          int32 cy1 = std::min((clipped.max().y() - 1 - oy) / cell, lev.rows - 1);
+          for (int32 cy = cy0; cy <= cy1; cy++) {
+            for (int32 cx = cx0; cx <= cx1; cx++) {
+              size_t k = size_t(cy)*lev.cols + cx;
+              min_height = std::min(min_height, double(lev.min_height[k]));
+              max_height = std::max(max_height, double(lev.max_height[k]));
+            }
+          }
+        }
+      }
+      return min_height <= max_height;
+    }
+
+    /// The range of heights over the whole DEM.
+    bool height_range(double& min_height, double& max_height) const {
+      return height_range(BBox2i(0, 0, cols(), rows()), min_height, max_height);
+    }
+
+  private:
+    struct Level {
+      int32 cols, rows;
+      std::vector<float> min_height, max_height;
+    };
+    struct Tile {
+      std::vector<Level> levels;
+    };
+
+    DEMImageT m_dem;
+    bool      m_nodata_as_zero;
+    int32     m_tile_size, m_num_levels, m_tile_cols, m_tile_rows;
+    mutable std::vector<boost::shared_ptr<const Tile> > m_tiles;
+    mutable Mutex m_mutex;
+
+    template <class PixelT>
+    static typename boost::enable_if< IsScalar<PixelT>, double >::type
+    height( PixelT const& val ) { return val; }
+
+    template <class PixelT>
+    static typename boost::enable_if< IsCompound<PixelT>, double >::type
+    height( PixelT const& val ) { return val[0]; }
+
+    boost::shared_ptr<const Tile> get_tile(int32 tx, int32 ty) const {
+      size_t k = size_t(ty)*m_tile_cols + tx;
+      {
+        Mutex::Lock lock(m_mutex);
+        if (m_tiles[k])
+          return m_tiles[k];
+      }
+      // Build outside of the lock.  Two threads may both build the same
+      // tile, which is harmless.
+      boost::shared_ptr<const Tile> tile = build_tile(tx, ty);
+      Mutex::Lock lock(m_mutex);
+      if (!m_tiles[k])
+        m_tiles[k] = tile;
+      return m_tiles[k];
+    }
+
+    boost::shared_ptr<const Tile> build_tile(int32 tx, int32 ty) const {
+      typedef typename DEMImageT::pixel_type pixel_type;
+      const float EMPTY_MIN =  std::numeric_limits<float>::max();
+      const float EMPTY_MAX = -std::numeric_limits<float>::max();
+
+      // One extra row and column for the interpolation footprint
+      BBox2i tile_box(tx*m_tile_size, ty*m_tile_size, m_tile_size + 1, m_tile_size + 1);
+      tile_box.crop(BBox2i(0, 0, cols(), rows()));
+      ImageView<pixel_type> pixels = crop(m_dem, tile_box);
+
+      boost::shared_ptr<Tile> tile(new Tile);
+      tile->levels.resize(m_num_levels);
+
+      Level& base = tile->levels[0];
+      base.cols = std::max((pixels.cols() - 1 + CELL_SIZE - 1) / CELL_SIZE, 1);
+      base.rows = std::max((pixels.rows() - 1 + CELL_SIZE - 1) / CELL_SIZE, 1);
+      base.min_height.assign(size_t(base.cols)*base.rows, EMPTY_MIN);
+      base.max_height.assign(size_t(base.cols)*base.rows, EMPTY_MAX);
+      for (int32 row = 0; row < pixels.rows(); row++) {
+        for (int32 col = 0; col < pixels.cols(); col++) {
+          double h;
+          if (is_valid(pixels(col, row)))
+            h = height(pixels(col, row));
+          else if (m_nodata_as_zero)
+            h = 0;
+          else
+            continue;
+          // The pixel belongs to its own block and, on a block border,
+          // to the blocks before it.
+          int32 cx1 = col / CELL_SIZE, cy1 = row / CELL_SIZE;
+          int32 cx0 = (col % CELL_SIZE == 0 && col > 0) ? cx1 - 1 : cx1;
+          int32 cy0 = (row % CELL_SIZE == 0 && row > 0) ? cy1 - 1 : cy1;
+          cx0 = std::min(cx0, base.cols - 1);  cx1 = std::min(cx1, base.cols - 1);
+          cy0 = std::min(cy0, base.rows - 1);  cy1 = std::min(cy1, base.rows - 1);
+          for (int32 cy = cy0; cy <= cy1; cy++) {
+            for (int32 cx = cx0; cx <= cx1; cx++) {
+              size_t k = size_t(cy)*base.cols + cx;
+              base.min_height[k] = std::min(base.min_height[k], float(h));
+              base.max_height[k] = std::max(base.max_height[k], float(h));
+            }
+          }
+        }
+      }
+
+      for (int32 l = 1; l < m_num_levels; l++) {
+        Level const& fine = tile->levels[l-1];
+        Level& coarse = tile->levels[l];
+        coarse.cols = (fine.cols + 1) / 2;
+        coarse.rows = (fine.rows + 1) / 2;
+        coarse.min_height.assign(size_t(coarse.cols)*coarse.rows, EMPTY_MIN);
+        coarse.max_height.assign(size_t(coarse.cols)*coarse.rows, EMPTY_MAX);
+        for (int32 row = 0; row < fine.rows; row++) {
+          for (int32 col = 0; col < fine.cols; col++) {
+            size_t f = size_t(row)*fine.cols + col;
+            size_t c = size_t(row/2)*coarse.cols + col/2;
+            coarse.min_height[c] = std::min(coarse.min_height[c], fine.min_height[f]);
+            coarse.max_height[c] = std::max(coarse.max_height[c], fine.max_height[f]);
+          }
+        }
+      }
+      return tile;
+    }
+  };
+
+  template <class DEMImageT>
+  const int32 DEMHeightBounds<DEMImageT>::CELL_SIZE;
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_DEMHEIGHTBOUNDS_H__
@@ -298,6 +298,56 @@ vw::Vector3 vw::cartography::Datum::geodetic_to_cartesian( vw::Vector3 const& ll
                   (radius*(1-e2)+llh.z()) * slat );
 }
 
+void vw::cartography::Datum::geodetic_to_cartesian( std::vector<vw::Vector3> const& llh,
+                                                    std::vector<vw::Vector3>& xyz ) const {
+  const double a  = m_semi_major_axis;
+  const double b  = m_semi_minor_axis;
+  const double e2 = (a*a - b*b) / (a*a);
+  const double deg_to_rad = M_PI/180;
+
+  xyz.resize( llh.size() );
+  for ( size_t i = 0; i < llh.size(); i++ ) {
+    const double lon = llh[i][0], lat = std::max( -90.0, std::min( 90.0, llh[i][1] ) ), h = llh[i][2];
+    const double rlon = (lon + m_meridian_offset) * deg_to_rad;
+    const double rlat = lat * deg_to_rad;
+    const double slat = sin( rlat ), clat = cos( rlat );
+    const double slon = sin( rlon ), clon = cos( rlon );
+    const double radius = a / sqrt(1.0-e2*slat*slat);
+    xyz[i] = Vector3( (radius+h) * clat * clon,
+                      (radius+h) * clat * slon,
+                      (radius*(1-e2)+h) * slat );
+  }
+}
+
+namespace {
+  // Longitude in degrees with the half angle formula, whose accuracy
+  // doesn't depend on the quadrant.
+  inline double geodetic_longitude( vw::Vector3 const& xyz, double xy_dist ) {
+    if ( xy_dist + xyz[0] > ( M_SQRT2 - 1 ) * xyz[1] ) {
+      // Longitude is between -135 and 135
+      return 360.0 * atan2( xyz[1], xy_dist + xyz[0] ) / M_PI;
+    } else if ( xy_dist + xyz[1] < ( M_SQRT2 + 1 ) * xyz[0] ) {
+      // Longitude is between -225 and 45
+      return - 90.0 + 360.0 * atan2( xyz[0], xy_dist - xyz[1] ) / M_PI;
+    }
+    // Longitude is between -45 and 225
+    return 90.0 - 360.0 * atan2( xyz[0], xy_dist + xyz[1] ) / M_PI;
+  }
+
+  // Latitude in radians and height from the solution u of Vermeille's quartic.
+  inline void vermeille_lat_height( vw::Vector3 const& xyz, double xy_dist, double u,
+                                    double e2, double e4, double q, double& lat, double& height ) {
+    double v   = sqrt( u * u + e4 * q );
+    double u_v = u + v;
+    double w   = e2 * ( u_v - q ) / ( 2 * v );
+    double k   = u_v / ( w + sqrt( w * w + u_v ) );
+    double D   = k * xy_dist / ( k + e2 );
+    double dist_2 = D * D + xyz[2] * xyz[2];
+    height = ( k + e2 - 1 ) * sqrt( dist_2 ) / k;
+    lat    = 2 * atan2( xyz[2], sqrt( dist_2 ) + D );
+  }
+}
+
 // This algorithm is a non-iterative algorithm from "An analytical
 // method to transform geocentric into geodetic coordinates" by Hugues
 // Vermeille, Journal of Geodesy 2011.
@@ -324,8 +374,11 @@ vw::Vector3 vw::cartography::Datum::cartesian_to_geodetic( vw::Vector3 const& xy
     // outside the evolute
     double right_inside_pow = sqrt(e4 * p * q);
     double sqrt_evolute = sqrt( evolute );
-    u = r + 0.5 * pow(sqrt_evolute + right_inside_pow, 2.0/3.0)
-          + 0.5 * pow(sqrt_evolute - right_inside_pow, 2.0/3.0);
+    // Squares of real cube roots, as the second term can be negative
+    // close to the center.
+    double c1 = cbrt( sqrt_evolute + right_inside_pow );
+    double c2 = cbrt( sqrt_evolute - right_inside_pow );
+    u = r + 0.5 * c1 * c1 + 0.5 * c2 * c2;
   } else if ( fabs(xyz[2]) < std::numeric_limits<double>::epsilon() ) {
     // On the equator plane
     llh[1] = 0;
@@ -346,33 +399,52 @@ vw::Vector3 vw::cartography::Datum::cartesian_to_geodetic( vw::Vector3 const& xy
           + 2*r*r * pow(inside_pow,-2.0/3.0);
   }
 
-  if (!std::isnan(u) ) {
-    double v   = sqrt( u * u + e4 * q );
-    double u_v = u + v;
-    double w   = e2 * ( u_v - q ) / ( 2 * v );
-    double k   = u_v / ( w + sqrt( w * w + u_v ) );
-    double D   = k * xy_dist / ( k + e2 );
-    double dist_2 = D * D + xyz[2] * xyz[2];
-    llh[2] = ( k + e2 - 1 ) * sqrt( dist_2 ) / k;
-    llh[1] = 2 * atan2( xyz[2], sqrt( dist_2 ) + D );
-  }
+  if (!std::isnan(u) )
+    vermeille_lat_height( xyz, xy_dist, u, e2, e4, q, llh[1], llh[2] );
 
-  if ( xy_dist + xyz[0] > ( sqrt(2) - 1 ) * xyz[1] ) {
-    // Longitude is between -135 and 135
-    llh[0] = 360.0 * atan2( xyz[1], xy_dist + xyz[0] ) / M_PI;
-  } else if ( xy_dist + xyz[1] < ( sqrt(2) + 1 ) * xyz[0] ) {
-    // Longitude is between -225 and 45
-    llh[0] = - 90.0 + 360.0 * atan2( xyz[0], xy_dist - xyz[1] ) / M_PI;
-  } else {
-    // Longitude is between -45 and 225
-    llh[0] = 90.0 - 360.0 * atan2( xyz[0], xy_dist + xyz[1] ) / M_PI;
-  }
-  llh[0] -= m_meridian_offset;
+  llh[0]  = geodetic_longitude( xyz, xy_dist ) - m_meridian_offset;
   llh[1] *= 180.0 / M_PI;
 
   return llh;
 }
 
+void vw::cartography::Datum::cartesian_to_geodetic( std::vector<vw::Vector3> const& xyz,
+                                                    std::vector<vw::Vector3>& llh ) const {
+  const double a2 = m_semi_major_axis * m_semi_major_axis;
+  const double b2 = m_semi_minor_axis * m_semi_minor_axis;
+  const double e2 = 1 - b2 / a2;
+  const double e4 = e2 * e2;
+  const double inv_a2 = 1.0 / a2;
+
+  llh.resize( xyz.size() );
+  for ( size_t i = 0; i < xyz.size(); i++ ) {
+    const Vector3 point = xyz[i];
+    double xy_dist_2 = point[0] * point[0] + point[1] * point[1];
+    double p  = xy_dist_2 * inv_a2;
+    double q  = ( 1 - e2 ) * point[2] * point[2] * inv_a2;
+    double r  = ( p + q - e4 ) / 6.0;
+    double evolute = 8 * r * r * r + e4 * p * q;
+
+    // Everything but a small region about the center is outside the
+    // evolute.  The rest takes the general path.
+    if ( !( evolute > 0 ) ) {
+      llh[i] = cartesian_to_geodetic( point );
+      continue;
+    }
+
+    double right_inside_pow = sqrt( e4 * p * q );
+    double sqrt_evolute = sqrt( evolute );
+    double c1 = cbrt( sqrt_evolute + right_inside_pow );
+    double c2 = cbrt( sqrt_evolute - right_inside_pow );
+    double u  = r + 0.5 * c1 * c1 + 0.5 * c2 * c2;
+
+    double xy_dist = sqrt( xy_dist_2 ), lat, height;
+    vermeille_lat_height( point, xy_dist, u, e2, e4, q, lat, height );
+    llh[i] = Vector3( geodetic_longitude( point, xy_dist ) - m_meridian_offset,
+                      lat * ( 180.0 / M_PI ), height );
+  }
+}
+
 std::ostream& vw::cartography::operator<<( std::ostream& os, vw::cartography::Datum const& datum ) {
   std::ostringstream oss; // To use custom precision
   oss.precision(17);
@@ -22,6 +22,7 @@
 #include <string>
 #include <ostream>
 #include <cmath>
+#include <vector>
 
 #include <vw/Math/Vector.h>
 #include <vw/Math/Matrix.h>
@@ -126,6 +127,10 @@ namespace cartography {
     /// Return cartesian (ECEF) coordinates of geodetic coordinates p [Lon, Lat, Height]
     Vector3 geodetic_to_cartesian( Vector3 const& llh ) const;
 
+    /// geodetic_to_cartesian() for an array of points, which may be
+    /// converted in place.
+    void geodetic_to_cartesian( std::vector<Vector3> const& llh, std::vector<Vector3>& xyz ) const;
+
     /// Return the rotation matrix for converting between ECEF and NED
     /// vectors. If v is a Cartesian (ECEF) vector, the inverse of
     /// this matrix times v will find v's components in the North,
@@ -134,7 +139,13 @@ namespace cartography {
     /// matrix times v will be its expression in ECEF.
     Matrix3x3 lonlat_to_ned_matrix(Vector2 const& lonlat) const;
 
+    /// Return geodetic coordinates [Lon, Lat, Height] of cartesian
+    /// (ECEF) coordinates, with the closed form method of Vermeille.
     Vector3 cartesian_to_geodetic( Vector3 const& xyz ) const;
+
+    /// cartesian_to_geodetic() for an array of points, which may be
+    /// converted in place.
+    void cartesian_to_geodetic( std::vector<Vector3> const& xyz, std::vector<Vector3>& llh ) const;
   };
 
   std::ostream& operator<<(std::ostream& os, const Datum& datum);
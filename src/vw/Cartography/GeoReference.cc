@@ -34,6 +34,10 @@
 // Boost
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
+#include <boost/static_assert.hpp>
+
+#include <atomic>
+#include <deque>
 
 // Proj.4
 #include <proj_api.h>
@@ -67,9 +71,22 @@ namespace cartography {
     // No image with a SPOT5 suffix can ever have georeference.
     if (vw::has_spot5_extension(filename)) return false;
 
+    // Georeferences are parsed once per version of a local file.
+    static FileMetadataCache<std::pair<bool, GeoReference> > cache;
+    FileStamp stamp;
+    bool cacheable = file_stamp( filename, stamp );
+    std::pair<bool, GeoReference> cached;
+    if ( cacheable && cache.get( stamp, cached ) ) {
+      if ( cached.first )
+        georef = cached.second;
+      return cached.first;
+    }
+
     boost::shared_ptr<DiskImageResource> r(DiskImageResourcePtr( filename ));
     bool result = read_georeference( georef, *r );
-    
+
+    if ( cacheable )
+      cache.put( stamp, std::make_pair( result, georef ) );
     return result;
   }
   
@@ -903,6 +920,61 @@ double GeoReference::test_pixel_reprojection_error(Vector2 const& pixel) {
     return Vector2(projected.u, projected.v);
   }
 
+  // The batch conversions hand Proj.4 the coordinates in place, as
+  // interleaved x,y pairs.
+  BOOST_STATIC_ASSERT(sizeof(Vector2) == 2*sizeof(double));
+
+  void GeoReference::points_to_lonlats(std::vector<Vector2> const& points,
+                                       std::vector<Vector2>& lon_lats) const {
+    lon_lats = points;
+    if ( m_is_projected && !lon_lats.empty() ) {
+      int status = pj_transform(m_proj_context.proj_ptr(), m_proj_context.latlong_ptr(),
+                                boost::numeric_cast<long>(lon_lats.size()), 2,
+                                &lon_lats[0][0], &lon_lats[0][1], NULL);
+      if (status != 0)
+        vw_throw(ProjectionErr() << "Bad projection in GeoReference.cc. Proj.4 error: "
+                                 << pj_strerrno(status) << ".\n");
+      for (size_t i = 0; i < lon_lats.size(); i++) {
+        // Points which failed are marked rather than reported.
+        if (lon_lats[i][0] == HUGE_VAL)
+          vw_throw(ProjectionErr() << "Bad projection in GeoReference.cc.\nPoint "
+                                   << i << " of the batch failed.\n");
+        lon_lats[i] *= RAD_TO_DEG;
+      }
+    }
+
+    // Get the longitude into the correct range for this georeference.    
+    for (size_t i = 0; i < lon_lats.size(); i++)
+      lon_lats[i][0] = math::normalize_longitude(lon_lats[i][0], m_center_lon_zero);
+  }
+
+  void GeoReference::lonlats_to_points(std::vector<Vector2> const& lon_lats,
+                                       std::vector<Vector2>& points) const {
+    points = lon_lats;
+    for (size_t i = 0; i < points.size(); i++)
+      points[i][0] = math::normalize_longitude(points[i][0], m_center_lon_zero);
+    if ( !m_is_projected || points.empty() )
+      return;
+
+    // Convert to radians and clamp the latitude, as in lonlat_to_point().
+    static const double BOUND = 1.5707963267948966 - (1e-10) - std::numeric_limits<double>::epsilon();
+    for (size_t i = 0; i < points.size(); i++) {
+      points[i] *= DEG_TO_RAD;
+      points[i][1] = std::max(-BOUND, std::min(BOUND, points[i][1]));
+    }
+
+    int status = pj_transform(m_proj_context.latlong_ptr(), m_proj_context.proj_ptr(),
+                              boost::numeric_cast<long>(points.size()), 2,
+                              &points[0][0], &points[0][1], NULL);
+    if (status != 0)
+      vw_throw(ProjectionErr() << "Bad projection in GeoReference.cc. Proj.4 error: "
+                               << pj_strerrno(status) << ".\n");
+    for (size_t i = 0; i < points.size(); i++)
+      if (points[i][0] == HUGE_VAL)
+        vw_throw(ProjectionErr() << "Bad projection in GeoReference.cc.\nPoint "
+                                 << i << " of the batch failed.\n");
+  }
+
   /// Convert lon/lat/alt to projected x/y/alt 
   Vector3 GeoReference::geodetic_to_point(Vector3 llh) const {
 
@@ -941,47 +1013,77 @@ double GeoReference::test_pixel_reprojection_error(Vector2 const& pixel) {
   }
 
 
-  ProjContext::ProjContext(std::string const& proj4_str ) : m_proj4_str(proj4_str) {
-    m_proj_ctx_ptr.reset(pj_ctx_alloc(),pj_ctx_free);
-    int num;
-    char** proj_strings = split_proj4_string(m_proj4_str, num);
-    m_proj_ptr.reset(pj_init_ctx( m_proj_ctx_ptr.get(),
-                                  num, proj_strings ),
-                     pj_free);
+  // The Proj.4 objects built by one thread for one ProjContext.  The
+  // members are released in reverse order, so the projections go
+  // before the context they were made in.
+  struct ProjContext::ThreadProj {
+    uint64                  id;
+    boost::shared_ptr<void> ctx_ptr, proj_ptr, latlong_ptr;
+  };
 
-    VW_ASSERT( !pj_ctx_get_errno(m_proj_ctx_ptr.get()),
-               InputErr() << "Proj.4 failed to initialize on string: " << m_proj4_str << "\n\tError was: " 
-                          << pj_strerrno(pj_ctx_get_errno(m_proj_ctx_ptr.get())) );
+  namespace {
+    // Most processes use a handful of projections at a time.  Past
+    // this many the least recently used objects of a thread are freed.
+    const size_t MAX_THREAD_PROJS = 16;
 
-    for ( int i = 0; i < num; i++ )
-      delete [] proj_strings[i];
-    delete [] proj_strings;
+    std::atomic<uint64> s_next_proj_id(1);
   }
 
-  ProjContext::ProjContext( ProjContext const& other ) : m_proj4_str(other.m_proj4_str) {
-    m_proj_ctx_ptr.reset(pj_ctx_alloc(),pj_ctx_free);
-    if ( m_proj4_str.empty() )
-      return; // They've made a copy of an uninitialized
-              // projcontext. Not an error .. since they can
-              // initialize later.
+  ProjContext::ProjContext(std::string const& proj4_str )
+    : m_proj4_str(proj4_str), m_id(s_next_proj_id++) {
+    // Build the objects for this thread now, to catch a bad string
+    // where it is set rather than where it is first used.
+    thread_proj();
+  }
 
+  ProjContext::ThreadProj const& ProjContext::thread_proj() const {
+    VW_ASSERT( !m_proj4_str.empty(),
+               ArgumentErr() << "ProjContext: Projection not initialized." );
+
+    // Most recently used first
+    thread_local std::deque<ThreadProj> thread_projs;
+    for (size_t i = 0; i < thread_projs.size(); i++) {
+      if (thread_projs[i].id != m_id)
+        continue;
+      if (i > 0) {
+        ThreadProj found = thread_projs[i];
+        thread_projs.erase(thread_projs.begin() + i);
+        thread_projs.push_front(found);
+      }
+      return thread_projs.front();
+    }
+
+    ThreadProj tp;
+    tp.id = m_id;
+    tp.ctx_ptr.reset(pj_ctx_alloc(), pj_ctx_free);
     int num;
     char** proj_strings = split_proj4_string(m_proj4_str, num);
-    m_proj_ptr.reset(pj_init_ctx( m_proj_ctx_ptr.get(),
-                                  num, proj_strings ),
-                     pj_free);
-
-    VW_ASSERT( !pj_ctx_get_errno(m_proj_ctx_ptr.get()),
-               InputErr() << "Proj.4 failed to initialize on string: " << m_proj4_str << "\n\tError was: " 
-                          << pj_strerrno(pj_ctx_get_errno(m_proj_ctx_ptr.get())) );
-
+    tp.proj_ptr.reset(pj_init_ctx( tp.ctx_ptr.get(), num, proj_strings ), pj_free);
     for ( int i = 0; i < num; i++ )
       delete [] proj_strings[i];
     delete [] proj_strings;
+
+    VW_ASSERT( tp.proj_ptr && !pj_ctx_get_errno(tp.ctx_ptr.get()),
+               InputErr() << "Proj.4 failed to initialize on string: " << m_proj4_str << "\n\tError was: " 
+                          << pj_strerrno(pj_ctx_get_errno(tp.ctx_ptr.get())) );
+    tp.latlong_ptr.reset(pj_latlong_from_proj(tp.proj_ptr.get()), pj_free);
+
+    thread_projs.push_front(tp);
+    if (thread_projs.size() > MAX_THREAD_PROJS)
+      thread_projs.pop_back();
+    return thread_projs.front();
+  }
+
+  void* ProjContext::proj_ptr() const {
+    return thread_proj().proj_ptr.get();
+  }
+
+  void* ProjContext::latlong_ptr() const {
+    return thread_proj().latlong_ptr.get();
   }
 
   int ProjContext::error_no() const {
-    return pj_ctx_get_errno(m_proj_ctx_ptr.get());
+    return pj_ctx_get_errno(thread_proj().ctx_ptr.get());
   }
 
 //************** End functions for class ProjContext ******************
@@ -43,29 +43,41 @@ namespace cartography {
 
   // Here is some machinery to keep track of an initialized proj.4
   // projection context using a smart pointer.
+  //
+  /// A Proj.4 context and projection are not safe to use from two
+  /// threads at once, so ProjContext holds only the projection string
+  /// and each thread that uses it lazily builds its own context and
+  /// projection objects, kept in a small per-thread cache.  No lock is
+  /// taken when projecting.  A ProjContext never changes once built;
+  /// assigning a new one (as GeoReference does when its projection
+  /// changes) gives it a new id, so the old per-thread objects are
+  /// simply no longer found and are recycled by the cache.
   class ProjContext {
-    boost::shared_ptr<void> m_proj_ctx_ptr;
-    boost::shared_ptr<void> m_proj_ptr;
-    std::string             m_proj4_str;
+    std::string m_proj4_str;
+    uint64      m_id; ///< Key of this projection in the per-thread caches
 
     /// 
-    char** split_proj4_string(std::string const& proj4_str, int &num_strings);
+    static char** split_proj4_string(std::string const& proj4_str, int &num_strings);
+
+    struct ThreadProj;
+    ThreadProj const& thread_proj() const;
 
   public:
 
-    ProjContext() : m_proj4_str("") {};
+    ProjContext() : m_proj4_str(""), m_id(0) {};
     ProjContext(std::string const& proj4_str);
-    ProjContext(ProjContext const& other );
 
-    inline void* proj_ptr() const {
-      VW_ASSERT( !m_proj4_str.empty(),
-                 ArgumentErr() << "ProjContext: Projection not initialized." );
-      return m_proj_ptr.get();
-    }
+    /// The projection for the calling thread.
+    void* proj_ptr() const;
+
+    /// The geographic (lon/lat in radians) system on the same datum,
+    /// as the other end of pj_transform() calls.
+    void* latlong_ptr() const;
     
     /// Return true if the proj4 string has been loaded.
     bool is_initialized() const {return(!m_proj4_str.empty());}
 
+    /// The error state of the calling thread's Proj.4 context.
     int error_no() const;
   };
 
@@ -304,6 +316,13 @@ namespace cartography {
     /// the location in the projected coordinate system.
     Vector2 lonlat_to_point(Vector2 lon_lat) const;
 
+    /// Batch versions of point_to_lonlat() and lonlat_to_point(), which
+    /// pass the whole array to Proj.4 in one call.  As with the single
+    /// point versions, an exception is thrown if any point fails.  The
+    /// input and output may be the same vector.
+    void points_to_lonlats(std::vector<Vector2> const& points,   std::vector<Vector2>& lon_lats) const;
+    void lonlats_to_points(std::vector<Vector2> const& lon_lats, std::vector<Vector2>& points  ) const;
+
     /// Convert lon/lat/alt to projected x/y/alt 
     Vector3 geodetic_to_point(Vector3 llh) const;
 
@@ -32,6 +32,8 @@ GdalWriteOptions::GdalWriteOptions() {
   raster_tile_size = Vector2i(vw_settings().default_tile_size(),
                               vw_settings().default_tile_size());
   num_threads = vw_settings().default_num_threads();
+  cog = false;
+  resume = false;
 }
 
 GdalWriteOptionsDescription::GdalWriteOptionsDescription( GdalWriteOptions& opt ) {
@@ -46,10 +48,43 @@ GdalWriteOptionsDescription::GdalWriteOptionsDescription( GdalWriteOptions& opt
     ("no-bigtiff",   "Tell GDAL to not create bigtiffs.")  // gets stored in vm.count("no-bigtiff")
     ("tif-compress", po::value(&opt.tif_compress)->default_value("LZW"),
         "TIFF Compression method. [None, LZW, Deflate, Packbits]")
+    ("cog",          po::bool_switch(&opt.cog)->default_value(false),
+        "Write a Cloud-Optimized GeoTIFF with internal overviews.")
+    ("resume",       po::bool_switch(&opt.resume)->default_value(false),
+        "Finish an interrupted write of the output, keeping the tiles it had written.")
+    ("tile-stats",   po::value(&opt.tile_stats)->default_value(""),
+        "Write the time, cache misses and bytes of each output tile to <prefix>.csv and <prefix>-heatmap.tif.")
     ("version,v",    "Display the version of software.")
     ("help,h",       "Display this help message.");
 }
 
+GeoReference block_georef( GeoReference const& georef, Vector2i const& block_size ) {
+  // A PixelAsArea transform maps the corners of pixels, so the blocks
+  // share their top left corners with their first pixels.  A
+  // PixelAsPoint one maps centers, which are half a block in.
+  Matrix3x3 scale = math::identity_matrix<3>();
+  scale(0,0) = block_size.x();
+  scale(1,1) = block_size.y();
+  if ( georef.pixel_interpretation() == GeoReference::PixelAsPoint ) {
+    scale(0,2) = 0.5 * (block_size.x() - 1);
+    scale(1,2) = 0.5 * (block_size.y() - 1);
+  }
+  GeoReference output = georef;
+  output.set_transform( georef.transform() * scale );
+  return output;
+}
+
+void write_block_write_stats( std::string const& prefix, BlockWriteStats const& stats,
+                              bool has_georef, GeoReference const& georef ) {
+  stats.write_csv( prefix + ".csv" );
+  ImageView<float> heatmap = stats.heatmap();
+  DiskImageResourceGDAL rsrc( prefix + "-heatmap.tif", heatmap.format() );
+  rsrc.set_nodata_write( BlockWriteStats::heatmap_nodata() );
+  if ( has_georef )
+    write_georeference( rsrc, block_georef( georef, stats.block_size() ) );
+  write_image( rsrc, heatmap );
+}
+
 GeoReference crop( GeoReference const& input,
                    double upper_left_x, double upper_left_y,
                    double /*width*/, double /*height*/ ) {
@@ -118,6 +153,147 @@ double get_image_meters_per_pixel(int width, int height, GeoReference const& geo
   return (d1 + d2) / 2.0;
 }
 
+boost::shared_ptr<DiskImageResourceMosaic>
+georeferenced_mosaic( std::vector<std::string> const& filenames, GeoReference& georef,
+                      size_t max_open ) {
+  VW_ASSERT( !filenames.empty(), ArgumentErr() << "georeferenced_mosaic: No files given." );
+
+  GeoReference first;
+  ImageFormat  format;
+  bool   has_nodata = false;
+  double nodata     = 0;
+  std::vector<BBox2i> footprints;
+  BBox2i extent;
+  for ( size_t i = 0; i < filenames.size(); ++i ) {
+    boost::shared_ptr<DiskImageResource> rsrc( DiskImageResourcePtr( filenames[i] ) );
+    GeoReference file_georef;
+    if ( !read_georeference( file_georef, *rsrc ) )
+      vw_throw( ArgumentErr() << "georeferenced_mosaic: " << filenames[i] << " has no georeference." );
+
+    if ( i == 0 ) {
+      first  = file_georef;
+      format = rsrc->format();
+      has_nodata = rsrc->has_nodata_read();
+      if ( has_nodata )
+        nodata = rsrc->nodata_read();
+    } else {
+      Matrix3x3 const& a = first.transform();
+      Matrix3x3 const& b = file_georef.transform();
+      if ( file_georef.overall_proj4_str() != first.overall_proj4_str() ||
+           fabs( a(0,0) - b(0,0) ) > 1e-6 * fabs( a(0,0) ) ||
+           fabs( a(1,1) - b(1,1) ) > 1e-6 * fabs( a(1,1) ) ||
+           a(0,1) != b(0,1) || a(1,0) != b(1,0) )
+        vw_throw( ArgumentErr() << "georeferenced_mosaic: " << filenames[i]
+                  << " does not have the projection and pixel size of " << filenames[0] << "." );
+    }
+
+    // Where this file's top left pixel falls on the first file's grid.
+    Vector2 offset = first.point_to_pixel( file_georef.pixel_to_point( Vector2(0,0) ) );
+    Vector2i corner( int32( floor( offset.x() + 0.5 ) ), int32( floor( offset.y() + 0.5 ) ) );
+    if ( norm_2( offset - Vector2( corner ) ) > 0.01 )
+      vw_throw( ArgumentErr() << "georeferenced_mosaic: " << filenames[i]
+                << " is not aligned with the pixel grid of " << filenames[0] << "." );
+
+    BBox2i footprint( corner.x(), corner.y(), rsrc->cols(), rsrc->rows() );
+    footprints.push_back( footprint );
+    extent.grow( footprint );
+  }
+
+  boost::shared_ptr<DiskImageResourceMosaic> mosaic( new DiskImageResourceMosaic( format, max_open ) );
+  if ( has_nodata )
+    mosaic->set_nodata_read( nodata );
+  for ( size_t i = 0; i < filenames.size(); ++i )
+    mosaic->add( filenames[i], footprints[i] - extent.min() );
+
+  georef = crop( first, extent.min().x(), extent.min().y() );
+  return mosaic;
+}
+
+boost::shared_ptr<const GeoReferenceQuery::Entry>
+GeoReferenceQuery::lookup( std::string const& image_path ) {
+  {
+    Mutex::ReadLock lock( m_mutex );
+    std::map<std::string, boost::shared_ptr<const Entry> >::const_iterator it = m_cache.find( image_path );
+    if ( it != m_cache.end() )
+      return it->second;
+  }
+
+  // Read the file outside the lock so other queries are not held up.  If
+  // two threads read the same file at once, the first one stored wins.
+  boost::shared_ptr<Entry> entry( new Entry );
+  boost::shared_ptr<DiskImageResource> rsrc( DiskImageResourcePtr( image_path ) );
+  if ( !read_georeference( entry->georef, *rsrc ) )
+    vw_throw( ArgumentErr() << "GeoReferenceQuery: " << image_path << " has no georeference." );
+  entry->size = Vector2i( rsrc->cols(), rsrc->rows() );
+
+  Mutex::Lock lock( m_mutex );
+  return m_cache.insert( std::make_pair( image_path, boost::shared_ptr<const Entry>( entry ) ) ).first->second;
+}
+
+GeoReference GeoReferenceQuery::georef( std::string const& image_path ) {
+  return lookup( image_path )->georef;
+}
+
+Vector2i GeoReferenceQuery::image_size( std::string const& image_path ) {
+  return lookup( image_path )->size;
+}
+
+BBox2 GeoReferenceQuery::bounds( std::string const& image_path, CoordType type ) {
+  boost::shared_ptr<const Entry> entry = lookup( image_path );
+  BBox2i pixel_box( Vector2i(0,0), entry->size );
+  switch ( type ) {
+    case LONLAT:    return entry->georef.pixel_to_lonlat_bbox( pixel_box );
+    case PROJECTED: return entry->georef.pixel_to_point_bbox( pixel_box );
+    case PIXEL:     return BBox2( pixel_box );
+  }
+  vw_throw( ArgumentErr() << "GeoReferenceQuery: Unknown coordinate type " << type << "." );
+  return BBox2();
+}
+
+void GeoReferenceQuery::convert( std::string const& image_path, CoordType from, CoordType to,
+                                 std::vector<Vector2> const& input, std::vector<Vector2>& output ) {
+  convert( lookup( image_path )->georef, from, to, input, output );
+}
+
+void GeoReferenceQuery::convert( GeoReference const& georef, CoordType from, CoordType to,
+                                 std::vector<Vector2> const& input, std::vector<Vector2>& output ) {
+  VW_ASSERT( from >= LONLAT && from <= PIXEL && to >= LONLAT && to <= PIXEL,
+             ArgumentErr() << "GeoReferenceQuery: Unknown coordinate type." );
+  if ( from == to ) {
+    output = input;
+    return;
+  }
+
+  // Every conversion passes through projected coordinates.  Pixels are
+  // an affine step done point by point; lon/lat go to Proj.4 as a batch.
+  if ( from == PIXEL ) {
+    output.resize( input.size() );
+    for ( size_t i = 0; i < input.size(); i++ )
+      output[i] = georef.pixel_to_point( input[i] );
+  } else if ( from == LONLAT ) {
+    georef.lonlats_to_points( input, output );
+  } else {
+    output = input;
+  }
+
+  if ( to == PIXEL ) {
+    for ( size_t i = 0; i < output.size(); i++ )
+      output[i] = georef.point_to_pixel( output[i] );
+  } else if ( to == LONLAT ) {
+    georef.points_to_lonlats( output, output );
+  }
+}
+
+size_t GeoReferenceQuery::size() const {
+  Mutex::ReadLock lock( m_mutex );
+  return m_cache.size();
+}
+
+void GeoReferenceQuery::clear() {
+  Mutex::Lock lock( m_mutex );
+  m_cache.clear();
+}
+
 }} // vw::cartography
 
 #undef CHECK_PROJ_ERROR
@@ -21,12 +21,15 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/TileSizeTuner.h>
 #include <vw/Cartography/Datum.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/Core/Exception.h>
+#include <vw/Core/Thread.h>
 
 #include <boost/program_options.hpp>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <vw/FileIO/DiskImageResourceMosaic.h>
 
 #include <vw/Cartography/GeoReference.h>
 
@@ -58,10 +61,84 @@ namespace cartography {
   /// Estimates meters per pixel for an image.
   double get_image_meters_per_pixel(int width, int height, GeoReference const& georef);
 
+  /// Lay out georeferenced images that share a projection and pixel grid
+  /// as one DiskImageResourceMosaic, in place of writing a VRT.
+  /// - Each file is opened once here, to read its georeference and size,
+  ///   and then closed; the mosaic reopens files as reads need them.
+  /// - Later files are drawn over earlier ones.
+  /// - georef is set to the georeference of the mosaic.
+  /// - The format and nodata value come from the first file.
+  boost::shared_ptr<DiskImageResourceMosaic>
+  georeferenced_mosaic( std::vector<std::string> const& filenames, GeoReference& georef,
+                        size_t max_open = 64 );
+
+  /// Answers coordinate queries about georeferenced image files for a
+  /// long-running caller, such as a service or a batch run of georef_query.
+  /// - Each file's georeference and size are read once, on first use, and
+  ///   kept until clear() is called.
+  /// - Conversions take whole lists of points, and the projection step goes
+  ///   to Proj.4 in one call per list (see GeoReference::points_to_lonlats()).
+  /// - Safe to use from several threads at once.
+  class GeoReferenceQuery {
+  public:
+    /// Coordinate systems of the query points.  The values match the
+    /// --output-format codes of georef_query.
+    enum CoordType { LONLAT = 0, PROJECTED = 1, PIXEL = 2 };
+
+    /// The georeference of an image file.  Throws ArgumentErr if the file
+    /// has none.
+    GeoReference georef( std::string const& image_path );
+
+    /// The size of an image file, in pixels.
+    Vector2i image_size( std::string const& image_path );
+
+    /// The bounds of the whole image, in the given coordinates.
+    BBox2 bounds( std::string const& image_path, CoordType type );
+
+    /// Converts points between coordinate systems of an image file.  The
+    /// input and output may be the same vector.
+    void convert( std::string const& image_path, CoordType from, CoordType to,
+                  std::vector<Vector2> const& input, std::vector<Vector2>& output );
+
+    /// Converts points between coordinate systems of one georeference.
+    static void convert( GeoReference const& georef, CoordType from, CoordType to,
+                         std::vector<Vector2> const& input, std::vector<Vector2>& output );
+
+    /// The number of files read so far.
+    size_t size() const;
+
+    /// Forgets every file read so far.
+    void clear();
+
+  private:
+    struct Entry {
+      GeoReference georef;
+      Vector2i     size;
+    };
+
+    boost::shared_ptr<const Entry> lookup( std::string const& image_path );
+
+    mutable Mutex m_mutex;
+    std::map<std::string, boost::shared_ptr<const Entry> > m_cache;
+  };
+
   /// Standard options for multi-threaded GDAL (tif) image writing.
   /// - num_threads sets the number of parallel block-writing threads when calling one
   ///   of the block write functions in this file.  By default it is set to
   ///   vw_settings().default_num_threads().
+  /// - cog makes the block write functions produce a Cloud-Optimized
+  ///   GeoTIFF, with its overviews built from the tiles as they are written.
+  /// - resume makes the block write functions finish an interrupted write
+  ///   of the same image, keeping the tiles its journal records.  Other
+  ///   than COGs, they journal the tiles in "<output>.vwjournal" as they
+  ///   write them, and remove the journal once the output is complete.
+  /// - tile_stats, if set, is the prefix of the files to which the block
+  ///   write functions write what each tile cost to compute and write (see
+  ///   write_block_write_stats()), for finding the expensive regions of
+  ///   an image and tuning the tile size.
+  /// - raster_tile_size, if left at the default tile size while the
+  ///   auto_tile_size setting is on, is tuned for each image the block
+  ///   write functions write (see tune_tile_size()).
   // TODO: This is the wrong place, as it has nothing to do with cartography.
   // Move to DiskImageResourceGDAL.h.
   // This will be an immense change. 
@@ -70,10 +147,23 @@ namespace cartography {
     Vector2i     raster_tile_size;
     int32        num_threads;  
     std::string  tif_compress;
+    bool         cog;
+    bool         resume;
+    std::string  tile_stats;
 
     GdalWriteOptions();
   };
 
+  /// The georeference of an image with one pixel per block_size block of
+  /// an image with the given georeference.
+  GeoReference block_georef( GeoReference const& georef, Vector2i const& block_size );
+
+  /// Writes the stats of a block_write_image() call to <prefix>.csv and
+  /// as a heatmap, <prefix>-heatmap.tif, with one pixel per tile (see
+  /// BlockWriteStats::heatmap()), georeferenced if has_georef is set.
+  void write_block_write_stats( std::string const& prefix, BlockWriteStats const& stats,
+                                bool has_georef, GeoReference const& georef );
+
   /// An object to let Program Options know about our GdalWriteOptions
   struct GdalWriteOptionsDescription : public boost::program_options::options_description {
     GdalWriteOptionsDescription( GdalWriteOptions& opt);
@@ -89,8 +179,11 @@ namespace cartography {
   build_gdal_rsrc( const std::string &filename,
                    ImageViewBase<ImageT> const& image,
                    GdalWriteOptions const& opt ) {
+    DiskImageResourceGDAL::Options options = opt.gdal_options;
+    if (opt.cog)
+      options["COG"] = "YES";
     return new DiskImageResourceGDAL(filename, image.impl().format(),
-                                         opt.raster_tile_size, opt.gdal_options);
+                                         opt.raster_tile_size, options);
   }
 
   /// Multi-threaded block write image with, if available, nodata, georef, and
@@ -196,8 +289,25 @@ namespace cartography {
                               ProgressCallback const& progress_callback,
                               std::map<std::string, std::string> const& keywords) {
 
-    boost::scoped_ptr<DiskImageResourceGDAL>
-      rsrc( build_gdal_rsrc( filename, image, opt ) );
+    // A COG only takes its layout once complete, so it cannot be resumed.
+    std::string journal_file = block_write_journal_file( filename );
+    bool resume = opt.resume && !opt.cog && boost::filesystem::exists( filename )
+                  && boost::filesystem::exists( journal_file );
+
+    boost::scoped_ptr<DiskImageResourceGDAL> rsrc;
+    if (resume) {
+      rsrc.reset( new DiskImageResourceGDAL( filename ) );
+      rsrc->reopen_for_write();
+    } else if (vw_settings().auto_tile_size() &&
+               opt.raster_tile_size == Vector2i(vw_settings().default_tile_size(),
+                                                vw_settings().default_tile_size())) {
+      // The tile size was left at its default, so tune it for this image.
+      GdalWriteOptions tuned_opt = opt;
+      tuned_opt.raster_tile_size = tune_tile_size( image, opt.num_threads );
+      rsrc.reset( build_gdal_rsrc( filename, image, tuned_opt ) );
+    } else {
+      rsrc.reset( build_gdal_rsrc( filename, image, opt ) );
+    }
 
     if (has_nodata)
       rsrc->set_nodata_write(nodata);
@@ -209,7 +319,22 @@ namespace cartography {
     if (has_georef)
       cartography::write_georeference(*rsrc, georef);
 
-    block_write_image( *rsrc, image.impl(), progress_callback , opt.num_threads);
+    BlockWriteStats stats;
+    if (opt.cog) {
+      if (opt.tile_stats.empty())
+        block_write_image( *rsrc, image.impl(), progress_callback , opt.num_threads);
+      else
+        block_write_image( *rsrc, image.impl(), stats, progress_callback, opt.num_threads );
+    } else {
+      BlockWriteJournal journal( journal_file, Vector2i( image.impl().cols(), image.impl().rows() ),
+                                 rsrc->block_write_size(), resume );
+      block_write_image( *rsrc, image.impl(), journal, progress_callback, opt.num_threads,
+                         boost::shared_ptr<CancelToken>(), opt.tile_stats.empty() ? 0 : &stats );
+      rsrc->flush();
+      journal.remove();
+    }
+    if (!opt.tile_stats.empty())
+      write_block_write_stats( opt.tile_stats, stats, has_georef, georef );
   }
 
   // Block write image without georef and nodata.
@@ -72,15 +72,40 @@ namespace cartography {
       ss_dst << "+proj=longlat " << dst_datum;
       m_dst_datum_proj = ProjContext( ss_dst.str() );
     }
+    // With the same projection, pixels map through the two pixel
+    // transforms alone.  If neither is projective, fold them into one
+    // affine transform each way.
+    Matrix3x3 src_transform = m_src_georef.transform();
+    Matrix3x3 dst_transform = m_dst_georef.transform();
+    m_is_affine = m_skip_map_projection &&
+                  src_transform(2,0) == 0 && src_transform(2,1) == 0 &&
+                  dst_transform(2,0) == 0 && dst_transform(2,1) == 0;
+    if (m_is_affine) {
+      m_forward_affine = affine_from_samples(m_src_georef, m_dst_georef);
+      m_reverse_affine = affine_from_samples(m_dst_georef, m_src_georef);
+    }
+
     // Because GeoTransform is typically very slow, we default to a tolerance
-    // of 0.1 pixels to allow ourselves to be approximated.
-    set_tolerance( 0.1 );
+    // of 0.1 pixels to allow ourselves to be approximated.  The affine case
+    // is cheaper to compute exactly.
+    set_tolerance( m_is_affine ? 0.0 : 0.1 );
   }
 
   GeoTransform::GeoTransform(GeoTransform const& other) {
     *this = other;
   }
 
+  Matrix3x3 GeoTransform::affine_from_samples(GeoReference const& from, GeoReference const& to) {
+    Vector2 origin = to.point_to_pixel(from.pixel_to_point(Vector2(0,0)));
+    Vector2 dx     = to.point_to_pixel(from.pixel_to_point(Vector2(1,0))) - origin;
+    Vector2 dy     = to.point_to_pixel(from.pixel_to_point(Vector2(0,1))) - origin;
+    Matrix3x3 m;
+    m(0,0) = dx[0];  m(0,1) = dy[0];  m(0,2) = origin[0];
+    m(1,0) = dx[1];  m(1,1) = dy[1];  m(1,2) = origin[1];
+    m(2,2) = 1;
+    return m;
+  }
+
   GeoTransform& GeoTransform::operator=(GeoTransform const& other) {
     m_src_georef            = other.m_src_georef;
     m_dst_georef            = other.m_dst_georef;
@@ -88,11 +113,19 @@ namespace cartography {
     m_dst_datum_proj        = other.m_dst_datum_proj;
     m_skip_map_projection   = other.m_skip_map_projection;
     m_skip_datum_conversion = other.m_skip_datum_conversion;
+    m_is_affine             = other.m_is_affine;
+    m_forward_affine        = other.m_forward_affine;
+    m_reverse_affine        = other.m_reverse_affine;
+    m_src_bbox              = other.m_src_bbox;
+    m_dst_bbox              = other.m_dst_bbox;
+    set_tolerance( other.tolerance() );
     return *this;
   }
 
 
   Vector2 GeoTransform::reverse(Vector2 const& v) const {
+    if (m_is_affine)
+      return apply_affine(m_reverse_affine, v);
     if (m_skip_map_projection)
       return m_src_georef.point_to_pixel(m_dst_georef.pixel_to_point(v));
     Vector2 dst_lonlat = m_dst_georef.pixel_to_lonlat(v);
@@ -103,7 +136,56 @@ namespace cartography {
   }
 
 
+  void GeoTransform::forward_points(std::vector<Vector2> const& pixels,
+                                    std::vector<Vector2>& result) const {
+    if (m_is_affine) {
+      result.resize(pixels.size());
+      for (size_t i = 0; i < pixels.size(); i++)
+        result[i] = apply_affine(m_forward_affine, pixels[i]);
+      return;
+    }
+
+    // The same steps as pixel_to_pixel(), each over the whole batch.
+    std::vector<Vector2> points(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+      points[i] = m_src_georef.pixel_to_point(pixels[i]);
+    if (!m_skip_map_projection) {
+      m_src_georef.points_to_lonlats(points, points);
+      lonlats_to_lonlats(points, points, true);
+      m_dst_georef.lonlats_to_points(points, points);
+    }
+    result.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+      result[i] = m_dst_georef.point_to_pixel(points[i]);
+  }
+
+  void GeoTransform::reverse_points(std::vector<Vector2> const& pixels,
+                                    std::vector<Vector2>& result) const {
+    if (m_is_affine) {
+      result.resize(pixels.size());
+      for (size_t i = 0; i < pixels.size(); i++)
+        result[i] = apply_affine(m_reverse_affine, pixels[i]);
+      return;
+    }
+
+    // The same steps as reverse(), each over the whole batch.
+    std::vector<Vector2> points(pixels.size());
+    for (size_t i = 0; i < pixels.size(); i++)
+      points[i] = m_dst_georef.pixel_to_point(pixels[i]);
+    if (!m_skip_map_projection) {
+      m_dst_georef.points_to_lonlats(points, points);
+      lonlats_to_lonlats(points, points, false);
+      m_src_georef.lonlats_to_points(points, points);
+    }
+    result.resize(points.size());
+    for (size_t i = 0; i < points.size(); i++)
+      result[i] = m_src_georef.point_to_pixel(points[i]);
+  }
+
+
   Vector2 GeoTransform::pixel_to_pixel(Vector2 const& v) const {
+    if (m_is_affine)
+      return apply_affine(m_forward_affine, v);
     if (m_skip_map_projection)
       return m_dst_georef.point_to_pixel(m_src_georef.pixel_to_point(v));
     Vector2 src_lonlat = m_src_georef.pixel_to_lonlat(v);
@@ -114,9 +196,21 @@ namespace cartography {
   }
 
 
+  // An affine transform maps the box to a parallelogram, bounded by its corners.
+  BBox2i GeoTransform::affine_bbox( Matrix3x3 const& m, BBox2i const& bbox ) {
+    BBox2 r;
+    r.grow( apply_affine(m, Vector2(bbox.min().x(),   bbox.min().y()  )) );
+    r.grow( apply_affine(m, Vector2(bbox.max().x()-1, bbox.min().y()  )) );
+    r.grow( apply_affine(m, Vector2(bbox.min().x(),   bbox.max().y()-1)) );
+    r.grow( apply_affine(m, Vector2(bbox.max().x()-1, bbox.max().y()-1)) );
+    return grow_bbox_to_int(r);
+  }
+
   BBox2i GeoTransform::forward_bbox( BBox2i const& bbox ) const {
 
     if (bbox.empty()) return BBox2();
+    if (m_is_affine)
+      return affine_bbox(m_forward_affine, bbox);
 
     std::vector<vw::Vector2> points;
     gen_bd_and_diag_pts(bbox, points);
@@ -133,6 +227,8 @@ namespace cartography {
 
   BBox2i GeoTransform::reverse_bbox( BBox2i const& bbox ) const {
     if (bbox.empty()) return BBox2();
+    if (m_is_affine)
+      return affine_bbox(m_reverse_affine, bbox);
 
     std::vector<vw::Vector2> points;
     gen_bd_and_diag_pts(bbox, points);
@@ -159,6 +255,17 @@ namespace cartography {
   }
 
 
+  void GeoTransform::points_to_points( std::vector<Vector2> const& points,
+                                      std::vector<Vector2>& result ) const {
+    result = points;
+    if (m_skip_map_projection)
+      return;
+    m_src_georef.points_to_lonlats(result, result);
+    lonlats_to_lonlats(result, result, true);
+    m_dst_georef.lonlats_to_points(result, result);
+  }
+
+
   Vector2 GeoTransform::pixel_to_point( Vector2 const& v ) const {
     Vector2 src_point = m_src_georef.pixel_to_point(v);
     if (m_skip_map_projection)
@@ -189,8 +296,6 @@ namespace cartography {
     double lat = lonlat[1] * DEG_TO_RAD;
     double alt = 0;
 
-    Mutex::WriteLock write_lock(m_mutex);
-
     if(forward) // src to dst
       pj_transform(m_src_datum_proj.proj_ptr(), m_dst_datum_proj.proj_ptr(), 1, 0, &lon, &lat, &alt);
     else // dst to src
@@ -209,8 +314,6 @@ namespace cartography {
     double lat = lonlatalt[1] * DEG_TO_RAD;
     double alt = lonlatalt[2];
 
-    Mutex::WriteLock write_lock(m_mutex);
-
     if(forward) // src to dst
       pj_transform(m_src_datum_proj.proj_ptr(), m_dst_datum_proj.proj_ptr(), 1, 0, &lon, &lat, &alt);
     else // dst to src
@@ -222,6 +325,66 @@ namespace cartography {
   }
 
 
+  void GeoTransform::lonlats_to_lonlats(std::vector<Vector2> const& lonlats,
+                                        std::vector<Vector2>& result, bool forward) const {
+    result = lonlats;
+    if (m_skip_datum_conversion || result.empty())
+      return;
+
+    // Proj.4 converts the interleaved lon,lat pairs in place.
+    for (size_t i = 0; i < result.size(); i++)
+      result[i] *= DEG_TO_RAD;
+
+    int status;
+    if(forward) // src to dst
+      status = pj_transform(m_src_datum_proj.proj_ptr(), m_dst_datum_proj.proj_ptr(),
+                            long(result.size()), 2, &result[0][0], &result[0][1], NULL);
+    else // dst to src
+      status = pj_transform(m_dst_datum_proj.proj_ptr(), m_src_datum_proj.proj_ptr(),
+                            long(result.size()), 2, &result[0][0], &result[0][1], NULL);
+    if (status != 0)
+      vw_throw(ProjectionErr() << "Bad projection in GeoTransform.cc. Proj.4 error: "
+                               << pj_strerrno(status));
+
+    for (size_t i = 0; i < result.size(); i++) {
+      if (result[i][0] == HUGE_VAL)
+        vw_throw(ProjectionErr() << "Bad projection in GeoTransform.cc. Datum conversion failed.");
+      result[i] *= RAD_TO_DEG;
+    }
+  }
+
+
+  void GeoTransform::lonlatalts_to_lonlatalts(std::vector<Vector3> const& lonlatalts,
+                                              std::vector<Vector3>& result, bool forward) const {
+    result = lonlatalts;
+    if (m_skip_datum_conversion || result.empty())
+      return;
+
+    for (size_t i = 0; i < result.size(); i++) {
+      result[i][0] *= DEG_TO_RAD;
+      result[i][1] *= DEG_TO_RAD;
+    }
+
+    int status;
+    if(forward) // src to dst
+      status = pj_transform(m_src_datum_proj.proj_ptr(), m_dst_datum_proj.proj_ptr(),
+                            long(result.size()), 3, &result[0][0], &result[0][1], &result[0][2]);
+    else // dst to src
+      status = pj_transform(m_dst_datum_proj.proj_ptr(), m_src_datum_proj.proj_ptr(),
+                            long(result.size()), 3, &result[0][0], &result[0][1], &result[0][2]);
+    if (status != 0)
+      vw_throw(ProjectionErr() << "Bad projection in GeoTransform.cc. Proj.4 error: "
+                               << pj_strerrno(status));
+
+    for (size_t i = 0; i < result.size(); i++) {
+      if (result[i][0] == HUGE_VAL)
+        vw_throw(ProjectionErr() << "Bad projection in GeoTransform.cc. Datum conversion failed.");
+      result[i][0] *= RAD_TO_DEG;
+      result[i][1] *= RAD_TO_DEG;
+    }
+  }
+
+
   bool GeoTransform::check_bbox_wraparound() const {
 
     // Check if we are converting between georefs with different lon centers.
@@ -404,19 +567,10 @@ namespace cartography {
 
     GeoTransform gtx(src_georef, dst_georef);
 
-    // Iterate over the image, transforming the first two coordinates
-    // in the Vector one at a time.  The third coordinate is taken to
-    // be the altitude value, and this value is not touched.
-    for (int32 j=0; j < point_image.rows(); ++j) {
-      for (int32 i=0; i < point_image.cols(); ++i) {
-        if (point_image(i,j) != Vector3()) {
-          Vector2 in(point_image(i,j)[0], point_image(i,j)[1]);
-          Vector2 out = gtx.forward(in);
-          point_image(i,j).x() = out[0];
-          point_image(i,j).y() = out[1];
-        }
-      }
-    }
+    // Transform the first two coordinates of each row of the image in
+    // one batch.  The third coordinate is taken to be the altitude
+    // value, and this value is not touched.
+    ReprojectPointView<ImageView<Vector3> >::reproject_point_rows(point_image, gtx);
   }
 }} // namespace vw::cartography
 
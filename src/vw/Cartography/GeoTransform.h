@@ -21,9 +21,12 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include <vw/Core/Thread.h>
 #include <vw/Math/Vector.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/Transform.h>
 #include <vw/Cartography/GeoReference.h>
 
@@ -50,12 +53,21 @@ namespace cartography {
                   m_dst_datum_proj;
     bool          m_skip_map_projection;
     bool          m_skip_datum_conversion;
-    mutable Mutex m_mutex; // Used to control access to the ProjContext objects
+    bool          m_is_affine;
+    Matrix3x3     m_forward_affine, m_reverse_affine; // Pixel to pixel, when m_is_affine
+
+    static Vector2 apply_affine(Matrix3x3 const& m, Vector2 const& v) {
+      return Vector2(m(0,0)*v[0] + m(0,1)*v[1] + m(0,2),
+                     m(1,0)*v[0] + m(1,1)*v[1] + m(1,2));
+    }
+
+    static Matrix3x3 affine_from_samples(GeoReference const& from, GeoReference const& to);
+    static BBox2i    affine_bbox(Matrix3x3 const& m, BBox2i const& bbox);
 
   public:
   
     /// Default constructor, does not generate a usable object.
-    GeoTransform() {}
+    GeoTransform() : m_is_affine(false) {}
 
     GeoTransform(GeoTransform const& other);
 
@@ -80,6 +92,14 @@ namespace cartography {
     /// pixel from an image in the source georeference frame.
     Vector2 reverse(Vector2 const& v) const;
 
+    /// forward() for a batch of pixels.  The input and output may be the
+    /// same vector.
+    void forward_points(std::vector<Vector2> const& pixels, std::vector<Vector2>& result) const;
+
+    /// reverse() for a batch of pixels, with one Proj.4 call per stage.
+    /// TransformView uses this to rasterize a row at a time.
+    void reverse_points(std::vector<Vector2> const& pixels, std::vector<Vector2>& result) const;
+
     /// Convert a pixel bounding box in the source image to
     ///  a pixel bounding box in the destination image.
     /// - This function handles the case where the image crosses the poles.
@@ -98,6 +118,10 @@ namespace cartography {
     /// Convert a point in the source to a point (projected coords) in the destination.
     Vector2 point_to_point( Vector2 const& v ) const;
 
+    /// point_to_point() for a batch of points.  The input and output may
+    /// be the same vector.
+    void points_to_points( std::vector<Vector2> const& points, std::vector<Vector2>& result ) const;
+
     /// Convert a pixel in the source to a point (projected coords) in the destination.
     Vector2 pixel_to_point( Vector2 const& v ) const;
 
@@ -112,6 +136,21 @@ namespace cartography {
     /// - The parameter 'forward' specifies whether we convert forward (true) or reverse (false).
     Vector3 lonlatalt_to_lonlatalt(Vector3 const& lonlatalt, bool forward=true) const;
 
+    /// lonlat_to_lonlat() for a batch of points.  The input and output
+    /// may be the same vector.
+    void lonlats_to_lonlats(std::vector<Vector2> const& lonlats, std::vector<Vector2>& result,
+                            bool forward=true) const;
+
+    /// lonlatalt_to_lonlatalt() for a batch of points.  The input and
+    /// output may be the same vector.
+    void lonlatalts_to_lonlatalts(std::vector<Vector3> const& lonlatalts, std::vector<Vector3>& result,
+                                  bool forward=true) const;
+
+    /// True if the two georeferences share a projection and affine
+    /// pixel transforms, so that pixel_to_pixel() and reverse() reduce
+    /// to a 2D affine transform.  No approximation is used then.
+    bool is_affine() const { return m_is_affine; }
+
     /// Returns true if bounding box conversions wrap around the output
     ///  georeference, creating a very large bounding box.
     bool check_bbox_wraparound() const;
@@ -138,6 +177,12 @@ namespace cartography {
   /// Format a GeoTransform to a text stream (for debugging)
   std::ostream& operator<<(std::ostream& os, const GeoTransform& trans);
 
+} // namespace cartography
+
+  template <> struct HasBatchReverse<cartography::GeoTransform> : public true_type {};
+
+namespace cartography {
+
 
   // ---------------------------------------------------------------------------
   // Image View Functions
@@ -231,11 +276,115 @@ namespace cartography {
   }
 
 
+  /// As above, with the tolerance in pixels of the approximation used
+  /// while rasterizing.  Each tile evaluates the exact reverse transform
+  /// on a grid, refined where bilinear interpolation of the grid is off
+  /// by more than the tolerance, and interpolates in between (see
+  /// AdaptiveApproximateTransform).  A tolerance of zero computes every
+  /// pixel exactly.  The other variants use GeoTransform's default of
+  /// 0.1 pixel, or exact evaluation when the transform is affine.
+  template <class ImageT, class EdgeT, class InterpT>
+  TransformView<InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT>, GeoTransform>
+  inline geo_transform( ImageViewBase<ImageT> const& v,
+                    GeoReference const& src_georef,
+                    GeoReference const& dst_georef,
+                    int32 width,
+                    int32 height,
+                    EdgeT const& edge_func,
+                    InterpT const& interp_func,
+                    double tolerance ) {
+    GeoTransform geotx(src_georef, dst_georef);
+    if (!geotx.is_affine())
+      geotx.set_tolerance(tolerance);
+    return TransformView<InterpolationView<EdgeExtensionView<ImageT, EdgeT>, InterpT>, GeoTransform>
+      (interpolate(v, interp_func, edge_func), geotx, width, height);
+  }
+
+
   // ---------------------------------------------------------------------------
   // Miscellaneous Functions
   // ---------------------------------------------------------------------------
 
 
+  /// A lazy version of reproject_point_image() below, for images larger
+  /// than memory.  Each call to rasterize() converts its block a row at a
+  /// time with the batch conversions.  Proj.4 objects are per thread
+  /// (see ProjContext), so it is safe to write it with
+  /// block_write_image() or wrap it in block_rasterize() to process it
+  /// in parallel tiles.
+  template <class ImageT>
+  class ReprojectPointView : public ImageViewBase<ReprojectPointView<ImageT> > {
+    ImageT       m_image;
+    GeoTransform m_transform;
+
+  public:
+    typedef Vector3 pixel_type;
+    typedef Vector3 result_type;
+    typedef ProceduralPixelAccessor<ReprojectPointView> pixel_accessor;
+
+    ReprojectPointView( ImageT const& image, GeoReference const& src_georef,
+                        GeoReference const& dst_georef )
+      : m_image(image), m_transform(src_georef, dst_georef) {}
+
+    ReprojectPointView( ImageT const& image, GeoTransform const& transform )
+      : m_image(image), m_transform(transform) {}
+
+    inline int32 cols  () const { return m_image.cols(); }
+    inline int32 rows  () const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+    /// Converts a single pixel.  Rasterize instead where speed matters.
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      Vector3 point = m_image(i,j,p);
+      if (point != Vector3())
+        subvector(point, 0, 2) = m_transform.forward(subvector(point, 0, 2));
+      return point;
+    }
+
+    typedef ReprojectPointView<typename ImageT::prerasterize_type> prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      return prerasterize_type( m_image.prerasterize(bbox), m_transform );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      ImageView<Vector3> points = crop(m_image, bbox);
+      reproject_point_rows(points, m_transform);
+      vw::rasterize(points, dest, BBox2i(0, 0, bbox.width(), bbox.height()));
+    }
+
+    /// Reproject the points of an image in place, a row at a time.
+    /// Zero pixels are left alone.
+    static void reproject_point_rows( ImageView<Vector3> const& points, GeoTransform const& transform ) {
+      std::vector<Vector2> row;
+      for (int32 j = 0; j < points.rows(); ++j) {
+        row.clear();
+        for (int32 i = 0; i < points.cols(); ++i)
+          if (points(i,j) != Vector3())
+            row.push_back(subvector(points(i,j), 0, 2));
+        transform.forward_points(row, row);
+        size_t k = 0;
+        for (int32 i = 0; i < points.cols(); ++i)
+          if (points(i,j) != Vector3()) {
+            points(i,j).x() = row[k][0];
+            points(i,j).y() = row[k][1];
+            ++k;
+          }
+      }
+    }
+  };
+
+  /// Returns a lazy view of a point image reprojected as by
+  /// reproject_point_image().
+  template <class ImageT>
+  inline ReprojectPointView<ImageT>
+  reproject_point_view( ImageViewBase<ImageT> const& point_image,
+                        GeoReference const& src_georef,
+                        GeoReference const& dst_georef ) {
+    return ReprojectPointView<ImageT>(point_image.impl(), src_georef, dst_georef);
+  }
+
   /// Reproject an image whose pixels contain 3D points (usually in
   /// some spherical coordinate system).  Important note: it is
   /// assumed here that the 3D points already have the affine
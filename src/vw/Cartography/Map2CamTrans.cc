@@ -22,20 +22,157 @@
 #include <vw/Image/MaskViews.h>
 #include <vw/Camera/CameraModel.h>
 
+#include <limits>
+
 namespace vw { namespace cartography {
 
+  namespace {
+
+    /// Intersects camera rays with a DEM held in memory, for forward
+    /// map projection.  Rays are followed with the secant method, which
+    /// needs only a couple of steps from a neighboring ray's length.
+    class DEMRayCaster {
+      typedef InterpolationView<EdgeExtensionView<ImageView<PixelMask<float> >, ConstantEdgeExtension>,
+                                BilinearInterpolation> interp_type;
+      interp_type         m_dem;
+      GeoReference const& m_georef;
+      Vector2             m_origin;
+      double              m_subsample;
+      int32               m_cols, m_rows;
+      double              m_mid_height;
+
+    public:
+      /// dem holds every subsample'th pixel of the DEM with the given
+      /// georeference, starting at origin.
+      DEMRayCaster( ImageView<PixelMask<float> > const& dem, GeoReference const& georef,
+                    Vector2 const& origin, int32 subsample, double mid_height )
+        : m_dem(interpolate(dem, BilinearInterpolation(), ConstantEdgeExtension())),
+          m_georef(georef), m_origin(origin), m_subsample(subsample),
+          m_cols(dem.cols()), m_rows(dem.rows()), m_mid_height(mid_height) {}
+
+      /// The height of xyz over the DEM.  Returns false off the DEM.
+      bool height_diff( Vector3 const& xyz, double& diff ) const {
+        Vector3 llh = m_georef.datum().cartesian_to_geodetic(xyz);
+        Vector2 pix = (m_georef.lonlat_to_pixel(subvector(llh, 0, 2)) - m_origin) / m_subsample;
+        if (!(pix[0] >= 0 && pix[0] <= m_cols - 1 && pix[1] >= 0 && pix[1] <= m_rows - 1))
+          return false;
+        PixelMask<float> h = m_dem(pix[0], pix[1]);
+        if (!is_valid(h))
+          return false;
+        diff = llh[2] - h.child();
+        return true;
+      }
+
+      /// Find the distance along the unit ray to the DEM, starting from
+      /// len if it is positive, else from the ellipsoid at the middle
+      /// height of the DEM.
+      bool cast( Vector3 const& ctr, Vector3 const& vec, double& len ) const {
+        if (len <= 0 && !ellipsoid_length(ctr, vec, len))
+          return false;
+
+        const double TOL = 1e-3; // Meters of height
+        double l0 = len, f0;
+        if (!height_diff(ctr + l0*vec, f0))
+          return false;
+        double l1 = l0 + std::max(1.0, std::abs(f0)), f1;
+        if (!height_diff(ctr + l1*vec, f1))
+          return false;
+        for (int iter = 0; iter < 20 && std::abs(f1) > TOL; iter++) {
+          if (f1 == f0)
+            return false;
+          double l2 = l1 - f1*(l1 - l0)/(f1 - f0);
+          l0 = l1;  f0 = f1;  l1 = l2;
+          if (l1 <= 0 || !height_diff(ctr + l1*vec, f1))
+            return false;
+        }
+        len = l1;
+        return std::abs(f1) <= TOL;
+      }
+
+    private:
+      // Scaling z by a/b turns the ellipsoid into a sphere, which keeps
+      // the lengths along the ray.
+      bool ellipsoid_length( Vector3 const& ctr, Vector3 const& vec, double& len ) const {
+        double a = m_georef.datum().semi_major_axis() + m_mid_height;
+        double b = m_georef.datum().semi_minor_axis() + m_mid_height;
+        Vector3 c(ctr[0], ctr[1], ctr[2]*a/b), v(vec[0], vec[1], vec[2]*a/b);
+        double qa = dot_prod(v, v), qb = 2*dot_prod(c, v), qc = dot_prod(c, c) - a*a;
+        double disc = qb*qb - 4*qa*qc;
+        if (disc < 0)
+          return false;
+        len = (-qb - std::sqrt(disc))/(2*qa);
+        if (len <= 0)
+          len = (-qb + std::sqrt(disc))/(2*qa);
+        return len > 0;
+      }
+    };
+
+    /// Draw one triangle of camera pixel positions into a map tile,
+    /// where it is nearer the camera than what is there already.
+    /// Vertices are in tile pixel coordinates.
+    void splat_triangle( Vector2 const* map_pix, Vector2 const* cam_pix, double const* depth,
+                         ImageView<Vector2>& cache, ImageView<double>& zbuf ) {
+      double area = (map_pix[1][0] - map_pix[0][0])*(map_pix[2][1] - map_pix[0][1])
+                  - (map_pix[2][0] - map_pix[0][0])*(map_pix[1][1] - map_pix[0][1]);
+      if (area == 0 || !(std::abs(area) < 1e12))
+        return;
+      BBox2 tri;
+      for (int k = 0; k < 3; k++)
+        tri.grow(map_pix[k]);
+      int32 x0 = std::max(int32(std::ceil (tri.min()[0])), 0);
+      int32 y0 = std::max(int32(std::ceil (tri.min()[1])), 0);
+      int32 x1 = std::min(int32(std::floor(tri.max()[0])), cache.cols() - 1);
+      int32 y1 = std::min(int32(std::floor(tri.max()[1])), cache.rows() - 1);
+
+      // A little slack so pixels on a shared edge are not missed.
+      const double EPS = -1e-9;
+      for (int32 y = y0; y <= y1; y++) {
+        for (int32 x = x0; x <= x1; x++) {
+          double w[3];
+          for (int k = 0; k < 3; k++) {
+            Vector2 const& p = map_pix[(k+1)%3];
+            Vector2 const& q = map_pix[(k+2)%3];
+            w[k] = ((q[0] - p[0])*(y - p[1]) - (x - p[0])*(q[1] - p[1])) / area;
+          }
+          if (w[0] < EPS || w[1] < EPS || w[2] < EPS)
+            continue;
+          double z = w[0]*depth[0] + w[1]*depth[1] + w[2]*depth[2];
+          if (z >= zbuf(x, y))
+            continue;
+          zbuf (x, y) = z;
+          cache(x, y) = w[0]*cam_pix[0] + w[1]*cam_pix[1] + w[2]*cam_pix[2];
+        }
+      }
+    }
+
+  } // end anonymous namespace
+
+  bool prefers_forward_projection(camera::CameraModel const* cam) {
+    std::string type = cam->type();
+    if (type == "Adjusted")
+      return prefers_forward_projection
+        (static_cast<camera::AdjustedCameraModel const*>(cam)->unadjusted_model().get());
+    return boost::starts_with(type, "Linescan") || type == "OpticalBar";
+  }
+
   Map2CamTrans::Map2CamTrans( vw::camera::CameraModel const* cam,
                               GeoReference const& image_georef,
                               GeoReference const& dem_georef,
                               std::string const& dem_file,
                               vw::Vector2i const& image_size,
                               bool call_from_mapproject,
-                              bool nearest_neighbor):
+                              bool nearest_neighbor,
+                              MapProjectionMode mode):
     m_cam(cam), m_image_georef(image_georef), m_dem_georef(dem_georef),
     m_dem(dem_file), m_image_size(image_size),
     m_call_from_mapproject(call_from_mapproject), 
     m_nearest_neighbor(nearest_neighbor), m_has_nodata(false),
-    m_nodata(std::numeric_limits<double>::quiet_NaN()){
+    m_nodata(std::numeric_limits<double>::quiet_NaN()), m_dem_subsample(1){
+
+    if (mode == MAPPROJECT_AUTO)
+      m_forward = prefers_forward_projection(cam);
+    else
+      m_forward = (mode == MAPPROJECT_FORWARD);
 
     boost::shared_ptr<vw::DiskImageResource>
       dem_rsrc( vw::DiskImageResourcePtr(dem_file) );
@@ -59,6 +196,22 @@ namespace vw { namespace cartography {
       else             return m_invalid_pix;
     }
 
+    Vector3 xyz;
+    if (!ground_point(p, xyz))
+      return m_invalid_pix;
+
+    Vector2 pt;
+    try{
+      pt = m_cam->point_to_pixel(xyz);
+    }catch(...){ // If a point failed to project
+      return m_invalid_pix;
+    }
+
+    return check_pixel(pt);
+  }
+
+  bool Map2CamTrans::ground_point(vw::Vector2 const& p, vw::Vector3& xyz) const {
+
     int b = BicubicInterpolation::pixel_buffer;
     if (m_nearest_neighbor)
       b = NearestPixelInterpolation::pixel_buffer;
@@ -68,42 +221,59 @@ namespace vw { namespace cartography {
         (dem_pix[1] < b - 1) || (dem_pix[1] >= m_dem.rows() - b)
         ){
       // No DEM data
-      return m_invalid_pix;
+      return false;
     }
 
-    Vector2 sdem_pix = dem_pix - m_dem_cache_box.min(); // since we cropped the DEM
+    // Since we cropped and maybe subsampled the DEM
+    Vector2 sdem_pix = (dem_pix - m_dem_cache_box.min()) / m_dem_subsample;
     if (m_dem_cache_box.empty() ||
         (sdem_pix[0] < b - 1) || (sdem_pix[0] >= m_cropped_dem.cols() - b) ||
         (sdem_pix[1] < b - 1) || (sdem_pix[1] >= m_cropped_dem.rows() - b)
         ){
-      // Cache miss. Will not happen often.
+      // Cache miss. Will not happen often, but cache a little around
+      // the point so that its neighbors do not miss too.
+      const int32 CACHE_MISS_MARGIN = 16;
       BBox2i box;
       box.min() = floor(p) - Vector2(1, 1);
       box.max() = ceil(p)  + Vector2(1, 1);
+      box.expand(CACHE_MISS_MARGIN);
       cache_dem(box);
-      return reverse(p);
+      sdem_pix = (dem_pix - m_dem_cache_box.min()) / m_dem_subsample;
+      if ((sdem_pix[0] < b - 1) || (sdem_pix[0] >= m_cropped_dem.cols() - b) ||
+          (sdem_pix[1] < b - 1) || (sdem_pix[1] >= m_cropped_dem.rows() - b))
+        return false;
     }
 
-    PixelMask<float> h = m_interp_dem(sdem_pix[0], sdem_pix[1]);
+    PixelMask<float> h = cached_height(sdem_pix);
     if (!is_valid(h))
-      return m_invalid_pix;
+      return false;
 
-    Vector3 xyz = m_dem_georef.datum().geodetic_to_cartesian
+    xyz = m_dem_georef.datum().geodetic_to_cartesian
       (Vector3(lonlat[0], lonlat[1], h.child()));
-    Vector2 pt;
-    try{
-      pt = m_cam->point_to_pixel(xyz);
-      if ( m_call_from_mapproject &&
-           (pt[0] < b - 1 || pt[0] >= m_image_size[0] - b ||
-            pt[1] < b - 1 || pt[1] >= m_image_size[1] - b)
-           ){
-        // Won't be able to interpolate into image in transform(...)
-        return m_invalid_pix;
-      }
-    }catch(...){ // If a point failed to project
+    return true;
+  }
+
+  // ground_point() has checked that the interpolation stays inside the
+  // buffer, so there is no need for an edge extension.
+  PixelMask<float> Map2CamTrans::cached_height(vw::Vector2 const& pix) const {
+    if (m_nearest_neighbor)
+      return NearestPixelInterpolation::interpolator(m_cropped_dem)(m_cropped_dem, pix[0], pix[1], 0);
+    return BicubicInterpolation::interpolator(m_cropped_dem)(m_cropped_dem, pix[0], pix[1], 0);
+  }
+
+  vw::Vector2 Map2CamTrans::check_pixel(vw::Vector2 const& pt) const {
+    if (pt == m_invalid_pix)
+      return m_invalid_pix;
+    int b = BicubicInterpolation::pixel_buffer;
+    if (m_nearest_neighbor)
+      b = NearestPixelInterpolation::pixel_buffer;
+    if ( m_call_from_mapproject &&
+         (pt[0] < b - 1 || pt[0] >= m_image_size[0] - b ||
+          pt[1] < b - 1 || pt[1] >= m_image_size[1] - b)
+         ){
+      // Won't be able to interpolate into image in transform(...)
       return m_invalid_pix;
     }
-
     return pt;
   }
 
@@ -117,31 +287,228 @@ namespace vw { namespace cartography {
     dbox.grow( m_dem_georef.lonlat_to_pixel(m_image_georef.pixel_to_lonlat( Vector2(bbox.min().x(),   bbox.max().y()-1) ) )); // Bottom left
     dbox.grow( m_dem_georef.lonlat_to_pixel(m_image_georef.pixel_to_lonlat( Vector2(bbox.max().x()-1, bbox.max().y()-1) ) )); // Bottom right
 
+    // Where the DEM is several times finer than the output, read every
+    // few DEM pixels only, so that the buffer matches the output
+    // resolution.
+    m_dem_subsample = 1;
+    if (bbox.width() > 1 && bbox.height() > 1)
+      m_dem_subsample = std::max(1, int32(std::min(dbox.width()  / (bbox.width()  - 1),
+                                                    dbox.height() / (bbox.height() - 1))));
+
     // A lot of care is needed here when going from real box to int
     // box, and if in doubt, better expand more rather than less.
     dbox.expand(1);
     m_dem_cache_box = grow_bbox_to_int(dbox);
-    if (m_nearest_neighbor)
-      m_dem_cache_box.expand(NearestPixelInterpolation::pixel_buffer); // for interp
-    else
-      m_dem_cache_box.expand(BicubicInterpolation::pixel_buffer); // for interp
+    int32 halo = m_nearest_neighbor ? NearestPixelInterpolation::pixel_buffer
+                                    : BicubicInterpolation::pixel_buffer;
+    m_dem_cache_box.expand(halo*m_dem_subsample); // for interp
     m_dem_cache_box.crop(bounding_box(m_dem));
 
-    // Read the dem in memory for speed in the region of the expanded bounding box.
-    m_cropped_dem = crop(m_dem, m_dem_cache_box);
+    // Read the DEM region into memory once, masked, for all the lookups
+    // in the tile.
+    if (m_has_nodata)
+      m_cropped_dem = subsample(create_mask(crop(m_dem, m_dem_cache_box), m_nodata),
+                                m_dem_subsample);
+    else // Don't need to handle nodata
+      m_cropped_dem = subsample(pixel_cast< PixelMask<float> >(crop(m_dem, m_dem_cache_box)),
+                                m_dem_subsample);
+  } // End function cache_dem
 
-    if (m_has_nodata){
-      m_masked_dem = create_mask(m_cropped_dem, m_nodata);
-    }else{ // Don't need to handle nodata
-      m_masked_dem = pixel_cast< PixelMask<float> >(m_cropped_dem);
+  void Map2CamTrans::project_points(std::vector<Vector3> const& points,
+                                    std::vector<Vector2>& pixels) const {
+    try{
+      m_cam->points_to_pixels(points, pixels);
+    }catch(...){ // Some other error, go point by point
+      pixels.resize(points.size());
+      for (size_t i = 0; i < points.size(); ++i) {
+        try{
+          pixels[i] = m_cam->point_to_pixel(points[i]);
+        }catch(...){ // If a point failed to project
+          pixels[i] = m_invalid_pix;
+        }
+      }
     }
-    // Set up interpolation interface to the data we loaded into memory
-    if (m_nearest_neighbor)
-      m_interp_dem = interpolate(m_masked_dem, NearestPixelInterpolation(), ZeroEdgeExtension());
-    else
-      m_interp_dem = interpolate(m_masked_dem, BicubicInterpolation(), ZeroEdgeExtension());
+  }
 
-  } // End function cache_dem
+  // Find the ground point under each pixel, then project them into
+  // the camera in one call. Going through the pixels in row order lets
+  // cameras reuse the solution for one point as the guess for the next.
+  void Map2CamTrans::reverse_cache(vw::BBox2i const& box) const {
+    std::vector<Vector3> points;
+    std::vector<Vector2> pixels;
+    std::vector<size_t>  cache_index;
+    points.reserve(size_t(box.width()) * box.height());
+    cache_index.reserve(points.capacity());
+    for( int32 y=box.min().y(); y<box.max().y(); ++y ){
+      for( int32 x=box.min().x(); x<box.max().x(); ++x ){
+        int32 col = x - box.min().x(), row = y - box.min().y();
+        m_cache(col, row) = m_invalid_pix;
+        Vector3 xyz;
+        if (!ground_point( Vector2(x,y), xyz ))
+          continue;
+        points.push_back(xyz);
+        cache_index.push_back(size_t(row) * box.width() + col);
+      }
+    }
+    project_points(points, pixels);
+    for (size_t i = 0; i < points.size(); ++i)
+      m_cache(int32(cache_index[i] % box.width()), int32(cache_index[i] / box.width()))
+        = check_pixel(pixels[i]);
+  }
+
+  // Cast a grid of camera pixels covering the tile to the DEM and
+  // splat it into the tile.  Only a sparse grid of tile pixels goes
+  // through point_to_pixel(), to find the camera pixels to cast.
+  void Map2CamTrans::forward_cache(vw::BBox2i const& box) const {
+    const int32 width = box.width(), height = box.height();
+    const double INF = std::numeric_limits<double>::max();
+    fill(m_cache, m_invalid_pix);
+
+    // Our own reference to the DEM around the tile, as ground_point()
+    // may recache it.
+    ImageView<PixelMask<float> > dem = m_cropped_dem;
+    Vector2 dem_origin = m_dem_cache_box.min();
+    int32   dem_subsample = m_dem_subsample;
+    double min_h = INF, max_h = -INF;
+    for (int32 row = 0; row < dem.rows(); ++row) {
+      for (int32 col = 0; col < dem.cols(); ++col) {
+        if (!is_valid(dem(col, row)))
+          continue;
+        min_h = std::min(min_h, double(dem(col, row).child()));
+        max_h = std::max(max_h, double(dem(col, row).child()));
+      }
+    }
+    if (min_h > max_h)
+      return; // No DEM here
+
+    // The camera pixels which see the tile
+    const int32 SAMPLE_STEP = 16;
+    std::vector<Vector3> points;
+    std::vector<Vector2> pixels;
+    for (int32 y = 0; y < height + SAMPLE_STEP - 1; y += SAMPLE_STEP) {
+      for (int32 x = 0; x < width + SAMPLE_STEP - 1; x += SAMPLE_STEP) {
+        Vector3 xyz;
+        if (ground_point(Vector2(std::min(x, width-1), std::min(y, height-1)) + box.min(), xyz))
+          points.push_back(xyz);
+      }
+    }
+    project_points(points, pixels);
+    BBox2 cam_box;
+    for (size_t i = 0; i < pixels.size(); ++i)
+      if (pixels[i] != m_invalid_pix)
+        cam_box.grow(pixels[i]);
+    if (cam_box.empty())
+      return;
+    // Room for relief between the samples, and for interpolation.
+    cam_box.expand(2 + 0.1*std::max(cam_box.width(), cam_box.height()));
+    int b = m_nearest_neighbor ? NearestPixelInterpolation::pixel_buffer
+                               : BicubicInterpolation::pixel_buffer;
+    cam_box.crop(BBox2(-b - 1, -b - 1, m_image_size[0] + 2*b + 2, m_image_size[1] + 2*b + 2));
+    if (cam_box.empty())
+      return;
+
+    // About one camera sample per map pixel
+    double step = std::max(1.0, std::floor(std::sqrt(cam_box.width()*cam_box.height()
+                                                     / (double(width)*height))));
+    int32 ncols = int32(cam_box.width ()/step) + 2;
+    int32 nrows = int32(cam_box.height()/step) + 2;
+
+    // Cast each row of samples, starting each ray from its neighbor's length.
+    DEMRayCaster caster(dem, m_dem_georef, dem_origin, dem_subsample, 0.5*(min_h + max_h));
+    ImageView<Vector2> map_pix(ncols, nrows), cam_pix(ncols, nrows);
+    ImageView<double>  depth(ncols, nrows);
+    std::vector<Vector2> row_pixels(ncols);
+    std::vector<Vector3> centers, directions;
+    for (int32 j = 0; j < nrows; ++j) {
+      for (int32 i = 0; i < ncols; ++i)
+        row_pixels[i] = cam_box.min() + step*Vector2(i, j);
+      try {
+        m_cam->pixels_to_rays(row_pixels, centers, directions);
+      } catch(...) {
+        centers.assign(ncols, Vector3());
+        directions.assign(ncols, Vector3());
+      }
+      for (int32 i = 0; i < ncols; ++i) {
+        cam_pix(i, j) = row_pixels[i];
+        depth  (i, j) = -1;
+        if (directions[i] == Vector3())
+          continue;
+        double len = (i > 0 && depth(i-1, j) > 0) ? depth(i-1, j) :
+                     (j > 0 && depth(i, j-1) > 0) ? depth(i, j-1) : -1;
+        if (!caster.cast(centers[i], directions[i], len)) {
+          len = -1;
+          if (!caster.cast(centers[i], directions[i], len))
+            continue;
+        }
+        Vector3 llh = m_dem_georef.datum().cartesian_to_geodetic(centers[i] + len*directions[i]);
+        map_pix(i, j) = m_image_georef.lonlat_to_pixel(subvector(llh, 0, 2)) - box.min();
+        depth  (i, j) = len;
+      }
+    }
+
+    // Two triangles for each cell of samples
+    ImageView<double> zbuf(width, height);
+    fill(zbuf, INF);
+    const int32 tri[2][3][2] = { {{0,0},{1,0},{1,1}}, {{0,0},{1,1},{0,1}} };
+    for (int32 j = 0; j + 1 < nrows; ++j) {
+      for (int32 i = 0; i + 1 < ncols; ++i) {
+        for (int t = 0; t < 2; t++) {
+          Vector2 mp[3], cp[3];
+          double  z[3];
+          bool    valid = true;
+          for (int k = 0; k < 3 && valid; k++) {
+            int32 ii = i + tri[t][k][0], jj = j + tri[t][k][1];
+            mp[k] = map_pix(ii, jj);
+            cp[k] = cam_pix(ii, jj);
+            z [k] = depth  (ii, jj);
+            valid = z[k] > 0;
+          }
+          if (valid)
+            splat_triangle(mp, cp, z, m_cache, zbuf);
+        }
+      }
+    }
+
+    // Only where the DEM is valid, as in the reverse direction.  Fill
+    // one pixel gaps from their neighbors, and reverse project the rest.
+    std::vector<size_t> cache_index;
+    points.clear();
+    ImageView<Vector2> splatted = copy(m_cache);
+    for (int32 row = 0; row < height; ++row) {
+      for (int32 col = 0; col < width; ++col) {
+        Vector3 xyz;
+        if (!ground_point(Vector2(col, row) + box.min(), xyz)) {
+          m_cache(col, row) = m_invalid_pix;
+          continue;
+        }
+        if (zbuf(col, row) < INF) {
+          m_cache(col, row) = check_pixel(m_cache(col, row));
+          continue;
+        }
+        Vector2 sum;
+        int count = 0;
+        for (int32 dy = -1; dy <= 1; ++dy) {
+          for (int32 dx = -1; dx <= 1; ++dx) {
+            int32 c = col + dx, r = row + dy;
+            if (c < 0 || r < 0 || c >= width || r >= height || zbuf(c, r) == INF)
+              continue;
+            sum += splatted(c, r);
+            count++;
+          }
+        }
+        if (count >= 4) {
+          m_cache(col, row) = check_pixel(sum / count);
+          continue;
+        }
+        points.push_back(xyz);
+        cache_index.push_back(size_t(row) * width + col);
+      }
+    }
+    project_points(points, pixels);
+    for (size_t i = 0; i < points.size(); ++i)
+      m_cache(int32(cache_index[i] % width), int32(cache_index[i] / width))
+        = check_pixel(pixels[i]);
+  }
 
   // This function will be called whenever we start to apply the
   // transform in a tile. It computes and caches the point cloud at
@@ -152,25 +519,35 @@ namespace vw { namespace cartography {
     // Custom reverse_bbox() function which can handle invalid pixels.
     if (!m_cached_rv_box.empty()) return m_cached_rv_box;
 
-    cache_dem(bbox);
-
-    // Cache the reverse transform
-
     m_img_cache_box = BBox2i();
     BBox2i local_cache_box = bbox;
     if (m_nearest_neighbor)
       local_cache_box.expand(NearestPixelInterpolation::pixel_buffer); // for interpolation
     else
       local_cache_box.expand(BicubicInterpolation::pixel_buffer); // for interpolation
-    
+
+    // Cast rays a little past the tile so the triangles reach its edges.
+    const int32 SPLAT_MARGIN = 4;
+    BBox2i dem_box = bbox;
+    if (m_forward) {
+      dem_box = local_cache_box;
+      dem_box.expand(SPLAT_MARGIN);
+    }
+    cache_dem(dem_box);
+
+    // Cache the reverse transform
     m_cache.set_size(local_cache_box.width(), local_cache_box.height());
+    if (m_forward)
+      forward_cache(local_cache_box);
+    else
+      reverse_cache(local_cache_box);
+
     vw::BBox2 out_box;
-    for( int32 y=local_cache_box.min().y(); y<local_cache_box.max().y(); ++y ){
-      for( int32 x=local_cache_box.min().x(); x<local_cache_box.max().x(); ++x ){
-        Vector2 p = reverse( Vector2(x,y) );
-        m_cache(x - local_cache_box.min().x(), y - local_cache_box.min().y()) = p;
+    for (int32 row = 0; row < m_cache.rows(); ++row) {
+      for (int32 col = 0; col < m_cache.cols(); ++col) {
+        Vector2 const& p = m_cache(col, row);
         if (p == m_invalid_pix) continue;
-        if (bbox.contains(Vector2i(x, y))) out_box.grow( p );
+        if (bbox.contains(Vector2i(col, row) + local_cache_box.min())) out_box.grow( p );
       }
     }
     out_box = grow_bbox_to_int( out_box );
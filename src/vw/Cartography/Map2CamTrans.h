@@ -24,6 +24,8 @@
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReference.h>
 
+#include <vector>
+
 
 /// \file Map2CamTrans.h
 /// Given a pixel in a map-projected image, convert it to lonlat, then
@@ -44,6 +46,25 @@ namespace vw { namespace camera{
 
 namespace vw { namespace cartography {
 
+  /// How Map2CamTrans fills its cache of camera pixels for a tile.
+  enum MapProjectionMode {
+    /// FORWARD for cameras where point_to_pixel() is an iterative
+    /// solve (see prefers_forward_projection()), otherwise REVERSE.
+    MAPPROJECT_AUTO,
+    /// Project the DEM point under each map pixel into the camera.
+    MAPPROJECT_REVERSE,
+    /// Cast camera pixels to the DEM and splat the triangles between
+    /// them into the map tile, keeping the surface nearest the camera.
+    /// Small holes are filled from their neighbors, and any others
+    /// where the DEM is valid fall back to the reverse projection.
+    MAPPROJECT_FORWARD
+  };
+
+  /// True for cameras whose point_to_pixel() must solve for the image
+  /// line, such as linescan and optical bar cameras, for which the
+  /// forward direction is much cheaper.
+  bool prefers_forward_projection(camera::CameraModel const* cam);
+
   class Map2CamTrans : public TransformBase<Map2CamTrans> {
     camera::CameraModel const* m_cam;
     GeoReference         m_image_georef, m_dem_georef;
@@ -53,13 +74,13 @@ namespace vw { namespace cartography {
     bool                 m_has_nodata;
     double               m_nodata;
     Vector2              m_invalid_pix;
+    bool                 m_forward;
 
 
     // We will always be modifying these
     mutable BBox2i                             m_dem_cache_box;
-    mutable ImageView<float>                   m_cropped_dem;
-    mutable ImageViewRef< PixelMask<float> >   m_masked_dem;
-    mutable ImageViewRef< PixelMask<float> >   m_interp_dem;
+    mutable int32                              m_dem_subsample; // DEM pixels per m_cropped_dem pixel
+    mutable ImageView< PixelMask<float> >      m_cropped_dem;   // Masked, read once per tile
     mutable ImageView<Vector2>                 m_cache;
     mutable ImageViewRef< PixelMask<Vector2> > m_cache_interp_mask;
     mutable BBox2i                             m_img_cache_box;
@@ -72,7 +93,8 @@ namespace vw { namespace cartography {
                   std::string  const& dem_file,
                   Vector2i     const& image_size,
                   bool                call_from_mapproject,
-                  bool                nearest_neighbor = false); // Default is bicubic
+                  bool                nearest_neighbor = false, // Default is bicubic
+                  MapProjectionMode   mode = MAPPROJECT_REVERSE);
 
     /// Convert Map Projected Coordinate to camera coordinate
     Vector2 reverse(const Vector2 &p) const;
@@ -80,6 +102,21 @@ namespace vw { namespace cartography {
     // Not thread safe ... you must copy this object
     void       cache_dem   ( BBox2i const& bbox ) const;
     BBox2i reverse_bbox( BBox2i const& bbox ) const;
+
+  private:
+    /// Find the DEM point under a map projected pixel.  Returns false
+    /// where there is no valid DEM data.
+    bool    ground_point( Vector2 const& p, Vector3& xyz ) const;
+    /// Interpolate m_cropped_dem, at a position in its own pixels.
+    PixelMask<float> cached_height( Vector2 const& pix ) const;
+    /// Return m_invalid_pix for camera pixels that can't be interpolated.
+    Vector2 check_pixel ( Vector2 const& pt ) const;
+    /// Project points into the camera, m_invalid_pix where that fails.
+    void    project_points( std::vector<Vector3> const& points,
+                            std::vector<Vector2>& pixels ) const;
+    /// Fill m_cache for the map pixels of box, in either direction.
+    void    reverse_cache( BBox2i const& box ) const;
+    void    forward_cache( BBox2i const& box ) const;
   }; // End class Map2CamTrans
 
   //std::ostream& operator<<(std::ostream& os, const Map2CamTrans& trans);
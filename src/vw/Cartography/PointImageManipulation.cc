@@ -33,6 +33,28 @@ Vector3 cartography::CartesianToGeodetic::operator()( Vector3 const& v ) const {
   return m_datum.cartesian_to_geodetic(v);
 }
 
+void cartography::geodetic_to_cartesian_in_place( ImageView<Vector3>& image, Datum const& d ) {
+  std::vector<Vector3> row( image.cols() );
+  for ( int32 j = 0; j < image.rows(); ++j ) {
+    for ( int32 i = 0; i < image.cols(); ++i )
+      row[i] = image(i,j);
+    d.geodetic_to_cartesian( row, row );
+    for ( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = boost::math::isnan(image(i,j)[2]) ? Vector3() : row[i];
+  }
+}
+
+void cartography::cartesian_to_geodetic_in_place( ImageView<Vector3>& image, Datum const& d ) {
+  std::vector<Vector3> row( image.cols() );
+  for ( int32 j = 0; j < image.rows(); ++j ) {
+    for ( int32 i = 0; i < image.cols(); ++i )
+      row[i] = image(i,j);
+    d.cartesian_to_geodetic( row, row );
+    for ( int32 i = 0; i < image.cols(); ++i )
+      image(i,j) = image(i,j) == Vector3() ? Vector3(0,0,std::numeric_limits<double>::quiet_NaN()) : row[i];
+  }
+}
+
 Vector3 cartography::GeodeticToProjection::operator()( Vector3 const& v ) const {
   if ( boost::math::isnan(v[2]) )
     return v;
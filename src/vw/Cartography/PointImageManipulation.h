@@ -170,6 +170,16 @@ namespace cartography {
     return result_type(prj_image.impl(), ProjectionToGeodetic(r));
   }
 
+  /// Convert an image of lon/lat/alt to GCC x/y/z in place, a row at
+  /// a time with Datum's array conversion.  Unlike the views above, this
+  /// is not lazy.  Pixels with a NaN altitude become zero, as with
+  /// GeodeticToCartesian.
+  void geodetic_to_cartesian_in_place( ImageView<Vector3>& image, Datum const& d );
+
+  /// Convert an image of GCC x/y/z to lon/lat/alt in place, a row at a
+  /// time.  Zero pixels get a NaN altitude, as with CartesianToGeodetic.
+  void cartesian_to_geodetic_in_place( ImageView<Vector3>& image, Datum const& d );
+
   // Point is the intermediate projection step that is in units of the
   // projection not pixels. The only difference between projection and
   // point is an affine transform.
@@ -222,65 +222,158 @@ vw::Vector2 vw::cartography::ToastTransform::forward(vw::Vector2 const& point) c
 }
 
 
-// Back-projects a pixel location in the TOAST image space into a
-// pixel location in the projected source image space.
-vw::Vector2 vw::cartography::ToastTransform::reverse(vw::Vector2 const& point) const {
-  // There is a fundamental eight-fold symmetry to the TOAST
-  // projection which we exploit here.  We first determine which
-  // top-level triangle (i.e. which octant) the requested point lies
-  // within.  We then map that octant onto a unit triangle, call
-  // octant_point_to_lonlat to project onto the sphere, and then
-  // rework the resulting lat/lon back into the proper octant.
+// Finds the octant containing a pixel location in the TOAST image
+// space, and maps that octant onto the unit triangle.
+vw::int32 vw::cartography::ToastTransform::point_to_octant(vw::Vector2 const& point, double& ox, double& oy) const {
   double x = point.x()/(m_resolution-1);
   double y = 1.0-point.y()/(m_resolution-1);
   if( x < 0.5 ) {
     if( y < 0.5 ) {
       // Lower left: 0 to 90E
-      if( y < 0.5 - x ) {
-        Vector2 lonlat = octant_point_to_lonlat(2*x, 2*y);
-        return m_georef.lonlat_to_pixel(Vector2(90-lonlat.x(), -lonlat.y()));
-      }
-      else {
-        Vector2 lonlat = octant_point_to_lonlat(1-2*x, 1-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(lonlat.x(), lonlat.y()));
-      }
+      if( y < 0.5 - x ) { ox = 2*x;   oy = 2*y;   return 0; }
+      else              { ox = 1-2*x; oy = 1-2*y; return 1; }
     }
     else {
       // Upper left: 0 to 90W
-      if( y > 0.5 + x ) {
-        Vector2 lonlat = octant_point_to_lonlat(2*x, 2-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(-90+lonlat.x(), -lonlat.y()));
-      }
-      else {
-        Vector2 lonlat = octant_point_to_lonlat(1-2*x,2*y-1);
-        return m_georef.lonlat_to_pixel(Vector2(-lonlat.x(), lonlat.y()));
-      }
+      if( y > 0.5 + x ) { ox = 2*x;   oy = 2-2*y; return 2; }
+      else              { ox = 1-2*x; oy = 2*y-1; return 3; }
     }
   }
   else {
     // Lower right: 90E to 180
     if( y < 0.5 ) {
-      if( y < x - 0.5 ) {
-        Vector2 lonlat = octant_point_to_lonlat(2-2*x, 2*y);
-        return m_georef.lonlat_to_pixel(Vector2(90+lonlat.x(), -lonlat.y()));
-      }
-      else {
-        Vector2 lonlat = octant_point_to_lonlat(2*x-1, 1-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(180-lonlat.x(), lonlat.y()));
-      }
+      if( y < x - 0.5 ) { ox = 2-2*x; oy = 2*y;   return 4; }
+      else              { ox = 2*x-1; oy = 1-2*y; return 5; }
     }
     else {
       // Upper right: 90W to 180
-      if( y > 1.5 - x ) {
-        Vector2 lonlat = octant_point_to_lonlat(2-2*x, 2-2*y);
-        return m_georef.lonlat_to_pixel(Vector2(-90-lonlat.x(), -lonlat.y()));
-      }
-      else {
-        Vector2 lonlat = octant_point_to_lonlat(2*x-1, 2*y-1);
-        return m_georef.lonlat_to_pixel(Vector2(-180+lonlat.x(), lonlat.y()));
+      if( y > 1.5 - x ) { ox = 2-2*x; oy = 2-2*y; return 6; }
+      else              { ox = 2*x-1; oy = 2*y-1; return 7; }
+    }
+  }
+}
+
+
+// Reworks a lat/lon computed in the first octant back into the
+// octant found by point_to_octant().
+vw::Vector2 vw::cartography::ToastTransform::octant_to_lonlat(vw::int32 octant, vw::Vector2 const& lonlat) {
+  switch( octant ) {
+  case 0:  return Vector2(90-lonlat.x(), -lonlat.y());
+  case 1:  return Vector2(lonlat.x(), lonlat.y());
+  case 2:  return Vector2(-90+lonlat.x(), -lonlat.y());
+  case 3:  return Vector2(-lonlat.x(), lonlat.y());
+  case 4:  return Vector2(90+lonlat.x(), -lonlat.y());
+  case 5:  return Vector2(180-lonlat.x(), lonlat.y());
+  case 6:  return Vector2(-90-lonlat.x(), -lonlat.y());
+  default: return Vector2(-180+lonlat.x(), lonlat.y());
+  }
+}
+
+
+// Back-projects a pixel location in the TOAST image space into a
+// pixel location in the projected source image space.
+vw::Vector2 vw::cartography::ToastTransform::reverse(vw::Vector2 const& point) const {
+  // There is a fundamental eight-fold symmetry to the TOAST
+  // projection which we exploit here.  We first determine which
+  // top-level triangle (i.e. which octant) the requested point lies
+  // within.  We then map that octant onto a unit triangle, call
+  // octant_point_to_lonlat to project onto the sphere, and then
+  // rework the resulting lat/lon back into the proper octant.
+  double x, y;
+  int32 octant = point_to_octant(point, x, y);
+  return m_georef.lonlat_to_pixel(octant_to_lonlat(octant, octant_point_to_lonlat(x, y)));
+}
+
+
+namespace {
+
+  // The tesselation of octant_point_to_unitvec(), remembering the
+  // triangle at each level from the last point.  The next point only
+  // recomputes the levels below the first one where it takes a
+  // different branch, and the arithmetic is otherwise the same, so
+  // the results match octant_point_to_unitvec() exactly.
+  class OctantWalker {
+    vw::int32 m_levels, m_valid;
+    std::vector<vw::Vector3> m_c1, m_c2, m_c3; // Triangle entering each level
+    std::vector<vw::int32> m_branch;           // Branch taken at each level
+  public:
+    OctantWalker(vw::int32 resolution) : m_levels(0), m_valid(0) {
+      for( double epsilon = 1.0/resolution; epsilon < 1.0; epsilon *= 2 )
+        ++m_levels;
+      m_c1.resize(m_levels+1);
+      m_c2.resize(m_levels+1);
+      m_c3.resize(m_levels+1);
+      m_branch.resize(m_levels);
+      m_c1[0] = vw::Vector3(0,0,1);
+      m_c2[0] = vw::Vector3(1,0,0);
+      m_c3[0] = vw::Vector3(0,1,0);
+    }
+
+    vw::Vector3 point_to_unitvec(double x, double y) {
+      using vw::normalize;
+      bool same = true;
+      for( vw::int32 l = 0; l < m_levels; ++l ) {
+        vw::int32 branch;
+        if( x < 0.5 ) {
+          if( y < 0.5 ) {
+            if( y < 0.5 - x ) { x = 2*x;   y = 2*y;   branch = 0; }
+            else              { x = 1-2*x; y = 1-2*y; branch = 1; }
+          }
+          else                { x = 2*x;   y = 2*y-1; branch = 2; }
+        }
+        else                  { x = 2*x-1; y = 2*y;   branch = 3; }
+
+        if( same && l < m_valid && branch == m_branch[l] )
+          continue;
+        same = false;
+        m_branch[l] = branch;
+        vw::Vector3 const &c1 = m_c1[l], &c2 = m_c2[l], &c3 = m_c3[l];
+        switch( branch ) {
+        case 0:
+          m_c1[l+1] = c1;
+          m_c2[l+1] = normalize(c1 + c2);
+          m_c3[l+1] = normalize(c3 + c1);
+          break;
+        case 1:
+          m_c1[l+1] = normalize(c2 + c3);
+          m_c2[l+1] = normalize(c3 + c1);
+          m_c3[l+1] = normalize(c1 + c2);
+          break;
+        case 2:
+          m_c1[l+1] = normalize(c3 + c1);
+          m_c2[l+1] = normalize(c2 + c3);
+          m_c3[l+1] = c3;
+          break;
+        default:
+          m_c1[l+1] = normalize(c1 + c2);
+          m_c2[l+1] = c2;
+          m_c3[l+1] = normalize(c2 + c3);
+        }
       }
+      m_valid = m_levels;
+      vw::Vector3 const &c1 = m_c1[m_levels], &c2 = m_c2[m_levels], &c3 = m_c3[m_levels];
+      return normalize(c1 + x*(c2-c1) + y*(c3-c1));
     }
+  };
+
+} // namespace
+
+
+// Back-projects a batch of pixel locations.  Each octant keeps its
+// own walker, since a run of points may cross between octants, and
+// the lon/lats are handed to the georeference in one call.
+void vw::cartography::ToastTransform::reverse_points(std::vector<vw::Vector2> const& points,
+                                                     std::vector<vw::Vector2>& result) const {
+  std::vector<OctantWalker> walkers(8, OctantWalker(m_resolution));
+  std::vector<Vector2> lonlats(points.size());
+  for( size_t i = 0; i < points.size(); ++i ) {
+    double x, y;
+    int32 octant = point_to_octant(points[i], x, y);
+    lonlats[i] = octant_to_lonlat(octant, unitvec_to_lonlat(walkers[octant].point_to_unitvec(x, y)));
   }
+  m_georef.lonlats_to_points(lonlats, result);
+  for( size_t i = 0; i < result.size(); ++i )
+    result[i] = m_georef.point_to_pixel(result[i]);
 }
 
 
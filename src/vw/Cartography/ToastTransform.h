@@ -65,13 +65,15 @@
 //
 // The TOAST transform is not cheap, and we work around that by using
 // the lookup-table-based approximation capabilities of TransformView.
-// We could get back some precision, and possibly make things even
-// faster, by exploiting the fact that the first many iterations will
-// be identical for nearby points.  We typically compute the reverse
-// transform for a large number of nearby points at a time.  We could
-// either cache the stack used in the most recent calculation, or
-// directly expose a the ability to reverse-transform a block of
-// points at a time.
+// We also exploit the fact that the first many iterations are
+// identical for nearby points: reverse_points() transforms a block of
+// points at a time, keeping the stack of triangles from the previous
+// point in each octant, so that a point only repeats the iterations
+// below where its path leaves that of its neighbor.  TransformView
+// uses it for the exact points of its lookup grids and for whole rows
+// of pixels.
+
+#include <vector>
 
 #include <vw/Math/Vector.h>
 #include <vw/Math/BBox.h>
@@ -112,6 +114,14 @@ namespace cartography {
       return octant_unitvec_to_point(lonlat_to_unitvec(Vector2(lon,lat)));
     }
 
+    // Find the octant containing a point in TOAST pixel space, and the
+    // point's position in the unit right triangle of that octant.
+    int32 point_to_octant(Vector2 const& point, double& x, double& y) const;
+
+    // Move a lon/lat in octant 0 to the given octant, undoing the
+    // folding done by point_to_octant().
+    static Vector2 octant_to_lonlat(int32 octant, Vector2 const& lonlat);
+
   public:
     ToastTransform(GeoReference const& georef, int32 resolution)
       : m_georef(georef), m_resolution(resolution)
@@ -128,6 +138,11 @@ namespace cartography {
     virtual Vector2 forward( Vector2 const& point ) const;
     virtual Vector2 reverse( Vector2 const& point ) const;
 
+    /// Reverse transform a batch of points, giving the same results as
+    /// calling reverse() on each.  Runs of nearby points, such as the
+    /// pixels of a row, are much faster this way.
+    void reverse_points( std::vector<Vector2> const& points, std::vector<Vector2>& result ) const;
+
     virtual BBox2i forward_bbox( BBox2i const& bbox ) const;
 
     // We override reverse_bbox so it understands to check if the image crosses
@@ -155,6 +170,8 @@ namespace cartography {
 
 } // namespace vw::cartography
 
+  template <> struct HasBatchReverse<cartography::ToastTransform> : public true_type {};
+
   template <class ChildT>
   class SparseImageCheck<TransformView<ChildT, cartography::ToastTransform> > {
 
@@ -0,0 +1,116 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestChipper.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Cartography/Chipper.h>
+#include <test/Helpers.h>
+
+#include <algorithm>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::test;
+using namespace pdal::filters;
+
+namespace {
+
+  bool point_less(Vector3 const& a, Vector3 const& b) {
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+  }
+
+  // Every chip is full size or one less, lies within its bounds, and
+  // together the chips hold each input point once.
+  void check_chips(StreamingChipper const& chipper, PointBuffer points, int block_size) {
+    PointBuffer all, chip;
+    size_t max_size = size_t(block_size)*block_size;
+    for (size_t i = 0; i < chipper.numChips(); ++i) {
+      chipper.readChip(i, chip);
+      ASSERT_EQ(chipper.chip(i).count, chip.size());
+      EXPECT_LE(chip.size(), max_size);
+      EXPECT_GE(chip.size() + 1, chipper.chip(0).count);
+      BBox2 const& bounds = chipper.chip(i).bounds;
+      for (size_t j = 0; j < chip.size(); ++j) {
+        EXPECT_TRUE(chip[j].x() >= bounds.min().x() && chip[j].x() <= bounds.max().x());
+        EXPECT_TRUE(chip[j].y() >= bounds.min().y() && chip[j].y() <= bounds.max().y());
+      }
+      all.insert(all.end(), chip.begin(), chip.end());
+    }
+    ASSERT_EQ(points.size(), all.size());
+    std::sort(points.begin(), points.end(), point_less);
+    std::sort(all.begin(), all.end(), point_less);
+    for (size_t i = 0; i < all.size(); ++i)
+      EXPECT_VECTOR_EQ(points[i], all[i]);
+  }
+
+}
+
+TEST( StreamingChipper, MatchesInMemory ) {
+  boost::random::mt19937 gen(17);
+  boost::random::uniform_real_distribution<double> dist(-100, 100);
+  PointBuffer points(20000);
+  for (size_t i = 0; i < points.size(); ++i)
+    points[i] = Vector3(dist(gen), 0.5*dist(gen), dist(gen));
+
+  UnlinkName point_file("chipper_points.bin");
+  UnlinkName memory_file("chipper_memory.bin"), stream_file("chipper_stream.bin");
+  StreamingChipper::writePointFile(point_file, points);
+
+  // With no memory to spare every split but the last few is streamed.
+  const int block_size = 10;
+  StreamingChipper in_memory(point_file, block_size, memory_file, size_t(1) << 30, 1,
+                             TEST_OBJDIR);
+  StreamingChipper streamed (point_file, block_size, stream_file, 0, 4, TEST_OBJDIR);
+  ASSERT_EQ(200u, in_memory.numChips());
+  ASSERT_EQ(in_memory.numChips(), streamed.numChips());
+  check_chips(streamed, points, block_size);
+
+  // Without ties the two ways make the same chips.
+  PointBuffer a, b;
+  for (size_t i = 0; i < in_memory.numChips(); ++i) {
+    in_memory.readChip(i, a);
+    streamed.readChip(i, b);
+    ASSERT_EQ(a.size(), b.size());
+    std::sort(a.begin(), a.end(), point_less);
+    std::sort(b.begin(), b.end(), point_less);
+    for (size_t j = 0; j < a.size(); ++j)
+      EXPECT_VECTOR_EQ(a[j], b[j]);
+  }
+}
+
+TEST( StreamingChipper, Duplicates ) {
+  // Clusters of equal coordinates, larger than a chip, on both axes.
+  PointBuffer points;
+  for (int i = 0; i < 5000; ++i)
+    points.push_back(Vector3((i % 3) * 10.0, (i % 7 == 0) ? 1.0 : i * 1e-3, i));
+
+  UnlinkName point_file("chipper_dup_points.bin"), chip_file("chipper_dup_chips.bin");
+  StreamingChipper::writePointFile(point_file, points);
+  const int block_size = 8;
+  StreamingChipper chipper(point_file, block_size, chip_file, 0, 3, TEST_OBJDIR);
+  check_chips(chipper, points, block_size);
+
+  UnlinkName empty_file("chipper_empty.bin");
+  StreamingChipper::writePointFile(empty_file, PointBuffer());
+  StreamingChipper empty(empty_file, block_size, chip_file, 0, 1, TEST_OBJDIR);
+  EXPECT_EQ(0u, empty.numChips());
+
+  EXPECT_THROW(StreamingChipper(std::string("no_such_points.bin"), block_size, chip_file),
+               IOErr);
+}
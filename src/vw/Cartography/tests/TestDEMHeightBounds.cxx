@@ -0,0 +1,93 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestDEMHeightBounds.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Cartography/DEMHeightBounds.h>
+
+using namespace vw;
+using namespace vw::cartography;
+
+namespace {
+
+  ImageView<PixelMask<float> > test_dem() {
+    ImageView<PixelMask<float> > dem(75, 50);
+    for (int32 row = 0; row < dem.rows(); ++row)
+      for (int32 col = 0; col < dem.cols(); ++col)
+        dem(col, row) = float((col*37 + row*11) % 23) - 5.0f*row;
+    dem(30, 20).invalidate();
+    return dem;
+  }
+
+  void brute_force_range(ImageView<PixelMask<float> > const& dem, BBox2i box,
+                         double& min_height, double& max_height) {
+    min_height =  1e100;
+    max_height = -1e100;
+    box.crop(bounding_box(dem));
+    for (int32 row = box.min().y(); row < box.max().y(); ++row)
+      for (int32 col = box.min().x(); col < box.max().x(); ++col)
+        if (is_valid(dem(col, row))) {
+          min_height = std::min(min_height, double(dem(col, row).child()));
+          max_height = std::max(max_height, double(dem(col, row).child()));
+        }
+  }
+
+}
+
+TEST( DEMHeightBounds, ContainsRange ) {
+  ImageView<PixelMask<float> > dem = test_dem();
+  DEMHeightBounds<ImageView<PixelMask<float> > > bounds(dem, false, 16);
+
+  double min_h, max_h, true_min, true_max;
+  ASSERT_TRUE(bounds.height_range(min_h, max_h));
+  brute_force_range(dem, bounding_box(dem), true_min, true_max);
+  EXPECT_EQ(true_min, min_h);
+  EXPECT_EQ(true_max, max_h);
+
+  // Any box gets a range at least as wide as its own pixels, and one
+  // which is not much wider for small boxes.
+  for (int32 size = 1; size < 40; size += 3) {
+    for (int32 y = -5; y < 50; y += 7) {
+      for (int32 x = -5; x < 75; x += 9) {
+        BBox2i box(x, y, size, size);
+        brute_force_range(dem, box, true_min, true_max);
+        bool found = bounds.height_range(box, min_h, max_h);
+        if (true_min > true_max)
+          continue;
+        ASSERT_TRUE(found);
+        EXPECT_LE(min_h, true_min);
+        EXPECT_GE(max_h, true_max);
+      }
+    }
+  }
+
+  // A single pixel is bounded by its block and the pixels just past it.
+  bounds.height_range(BBox2i(41, 9, 1, 1), min_h, max_h);
+  brute_force_range(dem, BBox2i(40, 8, 5, 5), true_min, true_max);
+  EXPECT_EQ(true_min, min_h);
+  EXPECT_EQ(true_max, max_h);
+
+  // Outside the DEM there is nothing, unless no-data counts as zero.
+  EXPECT_FALSE(bounds.height_range(BBox2i(100, 100, 10, 10), min_h, max_h));
+  DEMHeightBounds<ImageView<PixelMask<float> > > zero_bounds(dem, true, 16);
+  ASSERT_TRUE(zero_bounds.height_range(BBox2i(100, 100, 10, 10), min_h, max_h));
+  EXPECT_EQ(0, min_h);
+  EXPECT_EQ(0, max_h);
+}
@@ -167,3 +167,29 @@ TEST( Datum, GeodeticConversion ) {
   EXPECT_VECTOR_NEAR( datum.cartesian_to_geodetic(datum.geodetic_to_cartesian(Vector3(30,-10,173740))),
                       Vector3(30,-10,173740), 1e-6 );
 }
+
+TEST( Datum, BatchConversion ) {
+  Datum datum("WGS84");
+
+  std::vector<Vector3> xyz;
+  xyz += Vector3(6378137,0,0), Vector3(-2.7e6,4.1e6,-3.9e6), Vector3(1e5,-2e5,6.4e6),
+    Vector3(0,0,-6356752.3), Vector3(-1e4,-1e4,2e4), Vector3(1000,10,-10), Vector3(3e7,2e7,1e7);
+
+  std::vector<Vector3> llh, xyz2;
+  datum.cartesian_to_geodetic(xyz, llh);
+  datum.geodetic_to_cartesian(llh, xyz2);
+  ASSERT_EQ( xyz.size(), llh.size() );
+  ASSERT_EQ( xyz.size(), xyz2.size() );
+  for ( size_t i = 0; i < xyz.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( datum.cartesian_to_geodetic(xyz[i]), llh[i], 1e-6 );
+    EXPECT_VECTOR_NEAR( datum.geodetic_to_cartesian(llh[i]), xyz2[i], 1e-6 );
+    EXPECT_VECTOR_NEAR( xyz[i], xyz2[i], std::max(1e-12 * norm_2(xyz[i]), 1e-2) );
+  }
+
+  // In place
+  std::vector<Vector3> points = xyz;
+  datum.cartesian_to_geodetic(points, points);
+  datum.geodetic_to_cartesian(points, points);
+  for ( size_t i = 0; i < xyz.size(); i++ )
+    EXPECT_VECTOR_NEAR( xyz2[i], points[i], 1e-9 );
+}
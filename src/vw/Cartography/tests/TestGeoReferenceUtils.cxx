@@ -118,6 +118,47 @@ TEST( GeoReferenceUtils, gdal_read_checks) {
   //EXPECT_TRUE(georef.proj4_str().find("+over") != std::string::npos);
 }
 
+TEST( GeoReferenceUtils, Query ) {
+  // Batch conversions must match the single point functions.
+  Matrix3x3 affine;
+  affine(0,0) = 100;
+  affine(1,1) = -100;
+  affine(2,2) = 1;
+  affine(0,2) = 3000;
+  affine(1,2) = -3500;
+  GeoReference georef( Datum("WGS84"), affine, GeoReference::PixelAsArea );
+  georef.set_equirectangular( 40, 40, 50, 0, 0 );
+
+  std::vector<Vector2> pixels, points, lon_lats, back;
+  for ( int i = 0; i < 20; i++ )
+    pixels.push_back( Vector2( 37.5*i, 1000 - 21.25*i ) );
+  GeoReferenceQuery::convert( georef, GeoReferenceQuery::PIXEL, GeoReferenceQuery::PROJECTED, pixels, points );
+  GeoReferenceQuery::convert( georef, GeoReferenceQuery::PIXEL, GeoReferenceQuery::LONLAT, pixels, lon_lats );
+  GeoReferenceQuery::convert( georef, GeoReferenceQuery::LONLAT, GeoReferenceQuery::PIXEL, lon_lats, back );
+  ASSERT_EQ( pixels.size(), lon_lats.size() );
+  ASSERT_EQ( pixels.size(), back.size() );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    EXPECT_VECTOR_NEAR( georef.pixel_to_point ( pixels[i] ), points  [i], 1e-9 );
+    EXPECT_VECTOR_NEAR( georef.pixel_to_lonlat( pixels[i] ), lon_lats[i], 1e-9 );
+    EXPECT_VECTOR_NEAR( pixels[i], back[i], 1e-6 );
+  }
+
+  // The file written by gdal_write_checks is read once and then reused.
+  GeoReferenceQuery query;
+  EXPECT_EQ( Vector2i(100,100), query.image_size("dem.tif") );
+  EXPECT_EQ( 1u, query.size() );
+  GeoReference file_georef;
+  ASSERT_TRUE( read_georeference( file_georef, "dem.tif" ) );
+  std::vector<Vector2> file_lon_lats;
+  query.convert( "dem.tif", GeoReferenceQuery::PIXEL, GeoReferenceQuery::LONLAT, pixels, file_lon_lats );
+  for ( size_t i = 0; i < pixels.size(); i++ )
+    EXPECT_VECTOR_NEAR( file_georef.pixel_to_lonlat( pixels[i] ), file_lon_lats[i], 1e-9 );
+  EXPECT_EQ( BBox2(0,0,100,100), query.bounds( "dem.tif", GeoReferenceQuery::PIXEL ) );
+  EXPECT_EQ( 1u, query.size() );
+  query.clear();
+  EXPECT_EQ( 0u, query.size() );
+}
+
 
 TEST( GeoReferenceUtils, haversine_distance) {
   // Simple check like what we use to compute image meters per pixel
@@ -23,6 +23,7 @@
 #include <vw/Cartography/GeoReference.h>
 #include <vw/Cartography/GeoTransform.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
+#include <vw/Image/BlockRasterize.h>
 
 using namespace vw;
 using namespace vw::cartography;
@@ -97,6 +98,39 @@ TEST( GeoTransform, BasicTransform ) {
   EXPECT_VECTOR_NEAR( rev, Vector2(25,25), 1e-16 );
 }
 
+TEST( GeoTransform, AffineFastPath ) {
+  Matrix3x3 affine;
+  affine(0,0) =  0.01;  affine(0,2) = 100.0;
+  affine(1,1) = -0.01;  affine(1,2) =  30.0;
+  affine(2,2) = 1;
+  GeoReference src_georef(Datum("WGS84"), affine, GeoReference::PixelAsArea);
+
+  // Half the resolution, shifted by a few pixels
+  affine(0,0) =  0.02;  affine(0,2) = 100.05;
+  affine(1,1) = -0.02;  affine(1,2) =  29.9;
+  GeoReference dst_georef(Datum("WGS84"), affine, GeoReference::PixelAsPoint);
+
+  GeoTransform geotx(src_georef, dst_georef);
+  ASSERT_TRUE( geotx.is_affine() );
+  EXPECT_EQ( 0.0, geotx.tolerance() );
+
+  std::vector<Vector2> pixels, batch;
+  for ( int i = -3; i < 40; i += 7 )
+    pixels.push_back( Vector2( i, 2*i - 5 ) );
+  geotx.reverse_points( pixels, batch );
+  for ( size_t i = 0; i < pixels.size(); i++ ) {
+    Vector2 pixel = pixels[i];
+    EXPECT_VECTOR_NEAR( dst_georef.lonlat_to_pixel(src_georef.pixel_to_lonlat(pixel)),
+                        geotx.forward(pixel), 1e-8 );
+    Vector2 expected = src_georef.lonlat_to_pixel(dst_georef.pixel_to_lonlat(pixel));
+    EXPECT_VECTOR_NEAR( expected, geotx.reverse(pixel), 1e-8 );
+    EXPECT_VECTOR_NEAR( expected, batch[i], 1e-8 );
+  }
+
+  // Pixel x maps to x/2 - 2.25 and y to y/2 - 4.75.
+  EXPECT_EQ( BBox2i(-3, -5, 51, 25), geotx.forward_bbox( BBox2i(0, 0, 100, 50) ) );
+}
+
 TEST( GeoTransform, UTMFarZone ) {
   // This tests for a bug where forward_bbox calls latlon_to_* for a latlon
   // that is invalid for a utm zone.
@@ -163,6 +197,47 @@ TEST( GeoTransform, StereographicSingularity ) {
   EXPECT_NEAR( 0, output.min()[1], 2 );
 }
 
+TEST( GeoTransform, ApproximateReprojection ) {
+  // UTM to polar stereographic is not affine, so it gets approximated.
+  GeoReference utm_georef, stereo_georef;
+  Matrix3x3 transform = math::identity_matrix<3>();
+  transform(0,0) = 100;  transform(1,1) = -100;
+  transform(0,2) = 4e5;  transform(1,2) = 1.2e6;
+  utm_georef.set_transform(transform);
+  utm_georef.set_UTM(33, true);
+
+  // Line the output up with the top left of the input.
+  stereo_georef.set_stereographic(90, 0, 1);
+  Vector2 corner = stereo_georef.lonlat_to_point(utm_georef.pixel_to_lonlat(Vector2(0,0)));
+  transform(0,2) = corner.x();  transform(1,2) = corner.y();
+  stereo_georef.set_transform(transform);
+
+  GeoTransform geotx(utm_georef, stereo_georef);
+  EXPECT_FALSE( geotx.is_affine() );
+  EXPECT_EQ( 0.1, geotx.tolerance() );
+  GeoTransform copy(geotx);
+  EXPECT_EQ( 0.1, copy.tolerance() );
+
+  ImageView<float> image(200, 200);
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x )
+      image(x,y) = float(x + 3*y);
+  ImageView<float> exact  = geo_transform( image, utm_georef, stereo_georef, 150, 150,
+                                           ZeroEdgeExtension(), BilinearInterpolation(), 0.0 );
+  ImageView<float> approx = geo_transform( image, utm_georef, stereo_georef, 150, 150,
+                                           ZeroEdgeExtension(), BilinearInterpolation(), 0.125 );
+
+  // The image changes by less than 4 per pixel, so away from the edge
+  // of the source the error stays within 4 times the tolerance.
+  for ( int32 y = 0; y < exact.rows(); ++y )
+    for ( int32 x = 0; x < exact.cols(); ++x ) {
+      Vector2 src = geotx.reverse( Vector2(x,y) );
+      if ( src.x() >= 1 && src.x() < image.cols()-2 && src.y() >= 1 && src.y() < image.rows()-2 ) {
+        EXPECT_NEAR( exact(x,y), approx(x,y), 0.5 );
+      }
+    }
+}
+
 TEST(GeoTransform, skipProjectionTest) {
 
   // Test GeoTransform functions when the skip_map_projection flag is set.
@@ -348,3 +423,31 @@ TEST(GeoTransform, sinusoidalTest) {
   EXPECT_NEAR(pixel2.max().x(), 924.0, eps);
   EXPECT_NEAR(pixel2.max().y(), 914.0, eps);  
 }
+
+TEST( GeoTransform, ReprojectPointView ) {
+  GeoReference ll_georef, utm_georef;
+  ll_georef.set_well_known_geogcs("WGS84");
+  utm_georef.set_well_known_geogcs("WGS84");
+  utm_georef.set_UTM(13, true);
+
+  ImageView<Vector3> points(40, 30);
+  for ( int32 j = 0; j < points.rows(); ++j )
+    for ( int32 i = 0; i < points.cols(); ++i )
+      points(i,j) = Vector3( -105 + 0.01*i, 40 + 0.01*j, 1500 + i );
+  points(3,4) = Vector3(); // Missing points stay missing
+
+  ImageView<Vector3> tiled = block_rasterize( reproject_point_view(points, ll_georef, utm_georef),
+                                              Vector2i(16,16), 4 );
+  ImageView<Vector3> expected = copy(points);
+  reproject_point_image(expected, ll_georef, utm_georef);
+
+  EXPECT_EQ( Vector3(), tiled(3,4) );
+  for ( int32 j = 0; j < points.rows(); ++j )
+    for ( int32 i = 0; i < points.cols(); ++i ) {
+      EXPECT_VECTOR_NEAR( expected(i,j), tiled(i,j), 1e-6 );
+      if ( points(i,j) != Vector3() ) {
+        EXPECT_VECTOR_NEAR( GeoTransform(ll_georef, utm_georef).forward(subvector(points(i,j),0,2)),
+                            subvector(tiled(i,j),0,2), 1e-6 );
+      }
+    }
+}
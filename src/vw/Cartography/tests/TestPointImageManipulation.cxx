@@ -82,3 +82,29 @@ TEST( PointImageManipulation, CartesianGeodetic ) {
   EXPECT_SEQ_NEAR( cartesian, result_moon,  1e-6 );
   EXPECT_SEQ_NEAR( cartesian, result_earth, 1e-6 );
 }
+
+TEST( PointImageManipulation, InPlace ) {
+  ImageView<Vector3> cartesian(3,2);
+  cartesian(0,0) = Vector3(1737892,80,5320);
+  cartesian(1,0) = Vector3(50,-190,-80);
+  cartesian(2,0) = Vector3(-2.7e6,4.1e6,-3.9e6);
+  cartesian(0,1) = Vector3(33e8, -1e5, 0);
+  cartesian(1,1) = Vector3(); // Invalid
+  cartesian(2,1) = Vector3(1e5,-2e5,6.4e6);
+
+  Datum earth("WGS84");
+  ImageView<Vector3> geodetic = copy(cartesian);
+  cartesian_to_geodetic_in_place(geodetic, earth);
+  ImageView<Vector3> expected = cartesian_to_geodetic(cartesian, earth);
+  for ( int32 j = 0; j < cartesian.rows(); ++j )
+    for ( int32 i = 0; i < cartesian.cols(); ++i ) {
+      if ( cartesian(i,j) == Vector3() ) {
+        EXPECT_TRUE( boost::math::isnan(geodetic(i,j).z()) );
+        continue;
+      }
+      EXPECT_VECTOR_NEAR( expected(i,j), geodetic(i,j), 1e-6 );
+    }
+
+  geodetic_to_cartesian_in_place(geodetic, earth);
+  EXPECT_SEQ_NEAR( cartesian, geodetic, 1e-6 );
+}
@@ -332,3 +332,24 @@ TEST_F( ToastTransformTest, StereographicBBox ) {
   BBox2i global(0,0,toast_resolution,toast_resolution);
   EXPECT_TRUE( global.contains(out_box) );
 }
+
+TEST_F( ToastTransformTest, BatchReverse ) {
+  // A row crossing several octants, a column through the north pole,
+  // and a scattering of points, each compared with reverse().
+  std::vector<Vector2> points;
+  for( int32 i = 0; i < toast_resolution; i += 3 )
+    points.push_back( Vector2(i, toast_resolution/3) );
+  for( int32 i = 0; i < toast_resolution; i += 5 )
+    points.push_back( Vector2(toast_resolution/2, i) );
+  for( int32 i = 0; i < 500; ++i )
+    points.push_back( Vector2((i*397) % toast_resolution, (i*211) % toast_resolution + 0.25) );
+
+  std::vector<Vector2> result;
+  txform.reverse_points( points, result );
+  ASSERT_EQ( points.size(), result.size() );
+  for( size_t i = 0; i < points.size(); ++i )
+    EXPECT_VECTOR_EQ( txform.reverse(points[i]), result[i] );
+
+  txform.reverse_points( std::vector<Vector2>(), result );
+  EXPECT_TRUE( result.empty() );
+}
@@ -0,0 +1,143 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/Exception.h>
+
+#include <new>
+
+namespace vw {
+
+  namespace {
+    // log2 of min_pooled_bytes, the first class size.
+    const size_t first_shift = 15;
+  }
+
+  size_t BufferPool::class_index( size_t bytes ) {
+    // Find the power of two at or below bytes, then the quarter step
+    // above it which holds bytes.
+    size_t shift = first_shift;
+    while ( shift < 8*sizeof(size_t)-1 && ( size_t(2) << shift ) <= bytes )
+      ++shift;
+    size_t base = size_t(1) << shift, quarter = base >> 2;
+    size_t steps = ( bytes - base + quarter - 1 ) / quarter; // 0 to 4
+    return ( shift - first_shift ) * 4 + steps;
+  }
+
+  size_t BufferPool::index_size( size_t index ) {
+    size_t base = size_t(1) << ( first_shift + index / 4 );
+    return base + ( index % 4 ) * ( base >> 2 );
+  }
+
+  size_t BufferPool::class_size( size_t bytes ) {
+    if ( bytes < min_pooled_bytes )
+      return bytes;
+    return index_size( class_index( bytes ) );
+  }
+
+  BufferPool::BufferPool( size_t max_cached_bytes, uint32 num_shards )
+    : m_num_shards( num_shards ? num_shards : 1 ), m_shards( new Shard[ num_shards ? num_shards : 1 ] ),
+      m_max_cached( max_cached_bytes ), m_cached( 0 ), m_hits( 0 ), m_misses( 0 ) {}
+
+  BufferPool::~BufferPool() {
+    clear();
+  }
+
+  void* BufferPool::take( Shard& shard, size_t index ) {
+    if ( index >= shard.lists.size() || shard.lists[index].empty() )
+      return 0;
+    void* ptr = shard.lists[index].back();
+    shard.lists[index].pop_back();
+    m_cached -= index_size( index );
+    return ptr;
+  }
+
+  void* BufferPool::allocate( size_t bytes ) {
+    if ( bytes < min_pooled_bytes )
+      return ::operator new( bytes ? bytes : 1, std::nothrow );
+
+    size_t index = class_index( bytes );
+    if ( m_cached > 0 ) {
+      size_t home = size_t( Thread::id() % m_num_shards );
+      void* ptr = 0;
+      {
+        Mutex::Lock lock( m_shards[home].mutex );
+        ptr = take( m_shards[home], index );
+      }
+      // Buffers are often released by another thread than the one that
+      // allocates them, e.g. when the Cache evicts a tile, so look in the
+      // other shards before giving up.  Busy ones are skipped.
+      for ( uint32 i = 1; !ptr && i < m_num_shards; ++i ) {
+        Shard& shard = m_shards[( home + i ) % m_num_shards];
+        if ( shard.mutex.try_lock() ) {
+          ptr = take( shard, index );
+          shard.mutex.unlock();
+        }
+      }
+      if ( ptr ) {
+        ++m_hits;
+        return ptr;
+      }
+    }
+    ++m_misses;
+    return ::operator new( index_size( index ), std::nothrow );
+  }
+
+  void BufferPool::release( void* ptr, size_t bytes ) {
+    if ( !ptr )
+      return;
+    if ( bytes < min_pooled_bytes ) {
+      ::operator delete( ptr );
+      return;
+    }
+
+    size_t index = class_index( bytes ), size = index_size( index );
+    if ( m_cached + size > m_max_cached ) {
+      ::operator delete( ptr );
+      return;
+    }
+    Shard& shard = m_shards[ Thread::id() % m_num_shards ];
+    Mutex::Lock lock( shard.mutex );
+    if ( shard.lists.size() <= index )
+      shard.lists.resize( index + 1 );
+    shard.lists[index].push_back( ptr );
+    m_cached += size;
+  }
+
+  void BufferPool::set_max_cached_bytes( size_t bytes ) {
+    m_max_cached = bytes;
+    trim( bytes );
+  }
+
+  void BufferPool::trim( size_t limit ) {
+    // Free the largest buffers first, they are the least likely to be
+    // asked for again.
+    for ( uint32 s = 0; s < m_num_shards && m_cached > limit; ++s ) {
+      Shard& shard = m_shards[s];
+      Mutex::Lock lock( shard.mutex );
+      for ( size_t index = shard.lists.size(); index > 0 && m_cached > limit; --index ) {
+        std::vector<void*>& list = shard.lists[index-1];
+        while ( !list.empty() && m_cached > limit ) {
+          ::operator delete( list.back() );
+          list.pop_back();
+          m_cached -= index_size( index-1 );
+        }
+      }
+    }
+  }
+
+} // namespace vw
@@ -0,0 +1,104 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+/// \file Core/BufferPool.h
+///
+/// Recycles large memory buffers, such as the pixel data of Cache
+/// tiles.  Block-wise processing allocates and frees buffers of the
+/// same few sizes over and over, and buffers this large come straight
+/// from the kernel on each malloc, so every new tile pays for fresh
+/// zeroed pages.  A BufferPool keeps released buffers on free lists,
+/// one per size class, and hands them out again.
+///
+/// Size classes are a quarter of a power of two apart, so a buffer is
+/// at most 25% larger than requested.  Buffers smaller than
+/// min_pooled_bytes are not worth pooling and use operator new.  The
+/// free lists are split into shards picked by thread, so threads
+/// which allocate and release tiles rarely contend; an empty shard
+/// borrows from the others before allocating.
+///
+#ifndef __VW_CORE_BUFFERPOOL_H__
+#define __VW_CORE_BUFFERPOOL_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace vw {
+
+  class BufferPool : private boost::noncopyable {
+  public:
+    /// Requests smaller than this are passed to operator new.
+    static const size_t min_pooled_bytes = 32*1024;
+
+    /// Keeps at most max_cached_bytes of released buffers.  Zero turns
+    /// pooling off.
+    explicit BufferPool( size_t max_cached_bytes, uint32 num_shards = 16 );
+
+    /// Frees the cached buffers.  Buffers still in use must not be
+    /// released afterwards.
+    ~BufferPool();
+
+    /// Returns a buffer of at least the given size, suitably aligned for
+    /// any type, or NULL if memory is exhausted.
+    void* allocate( size_t bytes );
+
+    /// Returns a buffer from allocate(), which must be given the same size.
+    void release( void* ptr, size_t bytes );
+
+    /// Frees the cached buffers down to the new limit.
+    void set_max_cached_bytes( size_t bytes );
+    size_t max_cached_bytes() const { return m_max_cached; }
+
+    /// Frees every cached buffer.
+    void clear() { trim( 0 ); }
+
+    /// Bytes held in the free lists.
+    size_t cached_bytes() const { return m_cached; }
+
+    /// Pooled requests served from the free lists, and those which were not.
+    uint64 hits  () const { return m_hits;   }
+    uint64 misses() const { return m_misses; }
+
+    /// The size actually allocated for a request of the given size.
+    static size_t class_size( size_t bytes );
+
+  private:
+    struct Shard {
+      Mutex mutex;
+      std::vector<std::vector<void*> > lists; ///< Indexed by size class
+    };
+
+    static size_t class_index( size_t bytes );
+    static size_t index_size ( size_t index );
+    void* take( Shard& shard, size_t index );
+    void trim( size_t limit );
+
+    uint32                    m_num_shards;
+    boost::scoped_array<Shard> m_shards;
+    std::atomic<size_t>       m_max_cached, m_cached;
+    std::atomic<uint64>       m_hits, m_misses;
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_BUFFERPOOL_H__
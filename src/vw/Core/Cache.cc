@@ -22,6 +22,209 @@
 ///
 #include <vw/Core/Cache.h>
 
+#include <algorithm>
+
+#include <boost/core/demangle.hpp>
+
+// Lets the MemoryGovernor ask the Cache to give memory back.
+class vw::Cache::GovernorAccount : public vw::MemoryGovernor::Account {
+  Cache& m_cache;
+public:
+  GovernorAccount( MemoryGovernor& governor, std::string const& name, Cache& cache )
+    : Account(governor, name), m_cache(cache) {}
+  ~GovernorAccount() { detach(); }
+protected:
+  void shrink() { m_cache.evict_to_limit(); }
+};
+
+vw::Cache::Shard& vw::Cache::next_shard() {
+  return *m_shards[m_next_shard++ % m_shards.size()];
+}
+
+vw::Cache::TypeCounters& vw::Cache::type_counters( std::type_info const& type ) {
+  Mutex::WriteLock lock(m_type_mutex);
+  boost::shared_ptr<TypeCounters>& counters = m_type_counters[type.name()];
+  if (!counters)
+    counters.reset(new TypeCounters(boost::core::demangle(type.name())));
+  return *counters;
+}
+
+void vw::Cache::set_num_shards( size_t num_shards ) {
+  if (num_shards < 1)
+    num_shards = 1;
+  for (size_t i = 0; i < m_shards.size(); ++i) {
+    RecursiveMutex::Lock shard_lock(m_shards[i]->mutex);
+    VW_ASSERT( !m_shards[i]->first_valid && !m_shards[i]->first_invalid,
+               LogicErr() << "Cache: cannot change the number of shards after lines have been inserted." );
+  }
+  m_shards.clear();
+  for (size_t i = 0; i < num_shards; ++i)
+    m_shards.push_back(boost::shared_ptr<Shard>(new Shard()));
+}
+
+// The GreedyDual credit a line earns by being loaded: its cost per byte.
+double vw::Cache::cost_credit( CacheLineBase const* line ) {
+  return double(line->m_cost) / double(line->m_size > 0 ? line->m_size : 1);
+}
+
+bool vw::Cache::lower_credit( CacheLineBase const* a, CacheLineBase const* b ) {
+  return a->m_credit < b->m_credit;
+}
+
+vw::Cache::EvictionPolicy vw::Cache::eviction_policy_from_string( std::string const& name ) {
+  if (name == "lru"  ) return LruEviction;
+  if (name == "clock") return ClockEviction;
+  if (name == "2q"   ) return TwoQueueEviction;
+  if (name == "cost" ) return CostEviction;
+  vw_throw( ArgumentErr() << "Cache: unknown eviction policy \"" << name
+                          << "\", expected lru, clock, 2q or cost." );
+  return LruEviction; // Never reached
+}
+
+bool vw::Cache::over_limit() const {
+  return m_size > m_max_size || (m_account && m_account->governor().over_budget());
+}
+
+void vw::Cache::evict_to_limit() {
+  // WARNING! YOU CAN NOT HOLD THE CACHE MUTEX AND THEN CALL
+  // INVALIDATE. That's a line -> cache -> line mutex hold. A deadlock!
+  // - Only try_invalidate() is used below, so lines which are currently
+  //   in use stay loaded and are evicted by later allocations.
+  std::vector<CacheLineBase*> spills;
+  for ( size_t i = 0; i < m_shards.size() && over_limit(); ++i ) {
+    {
+      RecursiveMutex::Lock shard_lock( m_shards[i]->mutex );
+      evict( *m_shards[i], 0, spills );
+    }
+    finish_spills( spills );
+  }
+}
+
+void vw::Cache::finish_spills( std::vector<CacheLineBase*>& spills ) {
+  // The compression and the write happen here, after the shard mutex is
+  // released, so only readers of these lines wait on the disk.
+  for ( size_t i = 0; i < spills.size(); ++i )
+    spills[i]->finish_spill();
+  spills.clear();
+}
+
+void vw::Cache::set_memory_governor( MemoryGovernor* governor, std::string const& name ) {
+  m_account.reset();
+  if ( governor ) {
+    m_account.reset( new GovernorAccount( *governor, name, *this ) );
+    m_account->charge( m_size );
+  }
+}
+
+vw::uint64 vw::Cache::evict( Shard& shard, CacheLineBase *keep, std::vector<CacheLineBase*>& spills ) {
+
+  uint64 local_evictions = 0;
+  switch ( eviction_policy() ) {
+  case ClockEviction:
+    local_evictions = evict_scan( shard, keep, spills, true, false, false );
+    break;
+  case TwoQueueEviction: {
+    // Free the lines which were never reused first, unless the reused lines
+    // have taken more than 3/4 of this shard's share of the budget.
+    size_t share = m_max_size / m_shards.size();
+    if ( shard.protected_size > share/4*3 )
+      local_evictions = evict_scan( shard, keep, spills, false, true, false );
+    else
+      local_evictions = evict_scan( shard, keep, spills, false, false, true );
+    local_evictions += evict_scan( shard, keep, spills, false, false, false );
+    break;
+  }
+  case CostEviction:
+    local_evictions = evict_by_cost( shard, keep, spills );
+    break;
+  default:
+    local_evictions = evict_scan( shard, keep, spills, false, false, false );
+  }
+  shard.evictions += local_evictions;
+  return local_evictions;
+}
+
+vw::uint64 vw::Cache::evict_scan( Shard& shard, CacheLineBase *keep, std::vector<CacheLineBase*>& spills,
+                                  bool second_chance, bool only_protected, bool only_unprotected ) {
+
+  uint64 local_evictions = 0;
+
+  // Start with the oldest CacheLine object. Lines which were loaded after the
+  // keep line (the current one) are never freed.
+  CacheLineBase* line = shard.last_valid;
+
+  while ( over_limit() && line && line != keep ) {
+
+    // Remember the next line to look at now, the current one may be moved.
+    CacheLineBase* prev = line->m_prev;
+
+    if ( (only_protected && !line->m_protected) || (only_unprotected && line->m_protected) ) {
+      // Not the kind of line we are looking for.
+    } else if ( second_chance && line->m_referenced ) {
+      // Used since we last came by, move it back to the front of the list.
+      line->m_referenced = false;
+      validate( line );
+    } else if ( line->try_invalidate( spills ) ) {
+      // Deallocate the line if nothing is using it, otherwise we
+      // switch to the one used a bit more recently.
+      local_evictions++;
+    }
+    line = prev;
+  }
+  return local_evictions;
+}
+
+vw::uint64 vw::Cache::evict_by_cost( Shard& shard, CacheLineBase *keep, std::vector<CacheLineBase*>& spills ) {
+
+  // Only this many of the oldest lines are candidates, so new lines
+  // always get some time in the cache.
+  const size_t WINDOW_SIZE = 8;
+
+  uint64 local_evictions = 0;
+  std::vector<CacheLineBase*> candidates;
+  while ( over_limit() ) {
+
+    // Gather the oldest lines, refreshing the credit of the ones that were hit.
+    candidates.clear();
+    for ( CacheLineBase* line = shard.last_valid;
+          line && line != keep && candidates.size() < WINDOW_SIZE; line = line->m_prev ) {
+      if ( line->m_referenced.exchange(false) )
+        line->m_credit = shard.cost_floor + cost_credit(line);
+      candidates.push_back(line);
+    }
+    std::sort( candidates.begin(), candidates.end(), lower_credit );
+
+    // Free the cheapest line that nobody is using.
+    bool evicted = false;
+    for ( size_t i = 0; i < candidates.size() && !evicted; ++i ) {
+      double credit = candidates[i]->m_credit;
+      if ( candidates[i]->try_invalidate( spills ) ) {
+        // Everything left in the cache is now worth at least this much.
+        shard.cost_floor = std::max( shard.cost_floor, credit );
+        local_evictions++;
+        evicted = true;
+      }
+    }
+    if ( !evicted )
+      break;
+  }
+  return local_evictions;
+}
+
+void vw::Cache::record_hit( CacheLineBase *line ) {
+  // Called with a shared lock on the line, so only atomics are touched here.
+  line->m_referenced = true;
+  if ( !line->m_protected && !line->m_protected.exchange(true) )
+    line->m_shard.protected_size += line->m_size;
+}
+
+void vw::Cache::record_cost( CacheLineBase *line, uint64 microseconds ) {
+  Shard& shard = line->m_shard;
+  RecursiveMutex::Lock shard_lock( shard.mutex );
+  line->m_cost   = microseconds;
+  line->m_credit = shard.cost_floor + cost_credit(line);
+}
+
 // Note that this function does not actually load the data,
 // it is up to the calling function to do that.
 void vw::Cache::allocate( size_t size, CacheLineBase* line ) {
@@ -35,45 +238,57 @@ void vw::Cache::allocate( size_t size, CacheLineBase* line ) {
   // WARNING! YOU CAN NOT HOLD THE CACHE MUTEX AND THEN CALL
   // INVALIDATE. That's a line -> cache -> line mutex hold. A deadlock!
 
-  // The lock below is recursive, so if a resource is locked by a
-  // thread, it can still be accessed by this thread, but not by others.
-  RecursiveMutex::Lock cache_lock( m_line_mgmt_mutex );
-
-  uint64 local_evictions = 0;
-
-  validate( line ); // Call here to insure that last_valid is not us!
-                    // This places the line at the beginning of the valid list.
-                    
-  m_size += size;   // Update the size after adding the new line
-  VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache allocated " << size
-                  << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; );
+  Shard& shard = line->m_shard;
+  std::vector<CacheLineBase*> spills;
+  {
+    // The lock below is recursive, so if a resource is locked by a
+    // thread, it can still be accessed by this thread, but not by others.
+    RecursiveMutex::Lock shard_lock( shard.mutex );
 
-  // Grab the oldest CacheLine object
-  CacheLineBase* local_last_valid = m_last_valid;
+    validate( line ); // Call here to insure that last_valid is not us!
+                      // This places the line at the beginning of the valid list.
 
-  while ( m_size > m_max_size ) {
+    shard.size += size; // Update the size after adding the new line
+    m_size     += size;
+    line->m_counters.resident += size;
+    shard.num_valid++;
+    if ( m_account )
+      m_account->charge( size );
 
-    if ( local_last_valid == line || !local_last_valid ) {
-      // De-allocated all lines except the current one which are not
-      // held up currently by other threads.
-      break;
+    // Reset the eviction policy state of the line.  A line that is loaded
+    // again soon after it was freed was freed too early, treat it as reused.
+    line->m_referenced = false;
+    if ( line->m_freed_at && shard.deallocations - line->m_freed_at <= shard.num_valid ) {
+      if ( !line->m_protected.exchange(true) )
+        shard.protected_size += line->m_size;
     }
+    line->m_credit = shard.cost_floor + cost_credit(line);
+    VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache allocated " << size
+                    << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; );
 
-    // Deallocate the oldest CacheLine object if nothing is using it.
-    bool invalidated = local_last_valid->try_invalidate();
-    if (invalidated) { // If we were able to clear it...
-      local_evictions++;
-      local_last_valid = m_last_valid;  // Update the local pointer to the new oldest CacheLine.
-    } else {
-      // If we can't deallocate current line,
-      // switch to the one used a bit more recently.
-      local_last_valid = local_last_valid->m_prev;
+    evict( shard, line, spills );
+  }
+  finish_spills( spills );
+
+  // If our own shard did not have enough to give up, take from the others.
+  // Only one shard mutex is held at a time so that there is no lock order
+  // between the shards.
+  if ( over_limit() && m_shards.size() > 1 ) {
+    size_t first = 0;
+    while ( m_shards[first].get() != &shard )
+      first++;
+    for ( size_t i = 1; i < m_shards.size() && over_limit(); ++i ) {
+      Shard& other = *m_shards[(first + i) % m_shards.size()];
+      {
+        RecursiveMutex::Lock other_lock( other.mutex );
+        evict( other, line, spills );
+      }
+      finish_spills( spills );
     }
   }
 
-  {
+  if ( m_size > m_max_size ) {
     Mutex::WriteLock cache_lock( m_stats_mutex );
-    m_evictions += local_evictions; // Update class evictions stat
     
     // Warn about exceeding the cache size. Note that the warning is
     // printed only if the size now is a multiple of the previous size
@@ -81,57 +296,145 @@ void vw::Cache::allocate( size_t size, CacheLineBase* line ) {
     // cache size is 1.5^n GB. This will limit the number of warnings
     // to a representative subset.
     double factor = 1.5;
-    if ( (m_size > m_max_size) && (m_size > factor*m_last_size)){
+    size_t local_size = m_size;
+    if ( (local_size > m_max_size) && (local_size > factor*m_last_size)){
       VW_OUT(WarningMessage, "cache")
         << "Cached a new object (" << size
         << " B) and now we are larger than the requested maximum cache size (" << round(m_max_size/1.0e6)
-        << " MB). Current size = " << round(m_size/1.0e6) << " MB.\n";
-      m_last_size = m_size;
+        << " MB). Current size = " << round(local_size/1.0e6) << " MB.\n";
+      m_last_size = local_size;
     }
     
   }
 }
 
 void vw::Cache::resize( size_t size ) {
-  // WARNING! YOU CAN NOT HOLD THE CACHE MUTEX AND THEN CALL
-  // INVALIDATE. That's a line -> cache -> line mutex hold. A deadlock!
-  size_t local_size, local_max_size;
-  CacheLineBase* local_last_valid;
-  { // Locally buffer variables that require Cache Mutex
-    RecursiveMutex::Lock cache_lock(m_line_mgmt_mutex);
-    m_max_size       = size;
-    local_size       = m_size;
-    local_max_size   = m_max_size;
-    local_last_valid = m_last_valid;
-  }
+  m_max_size = size;
+
   // Keep deallocating objects until we shrink under the new size limit
-  while ( local_size > local_max_size ) {
-    VW_ASSERT( local_last_valid, LogicErr() << "Cache is empty but has nonzero size!" );
-    // Deallocate the last invalid CacheLine object
-    m_last_valid->invalidate(); // Problem ( probably grabs a line's mutex too )
-    { // Update local buffer by grabbing cache buffer
-      RecursiveMutex::Lock cache_lock( m_line_mgmt_mutex );
-      local_size = m_size;
-      local_last_valid = m_last_valid;
-    }
-  }
+  evict_to_limit();
 }
 
 size_t vw::Cache::max_size() {
-  RecursiveMutex::Lock cache_lock(m_line_mgmt_mutex);
   return m_max_size;
 }
 
+size_t vw::Cache::size() {
+  return m_size;
+}
+
+vw::uint64 vw::Cache::hits() {
+  uint64 total = 0;
+  for (size_t i = 0; i < m_shards.size(); ++i)
+    total += m_shards[i]->hits;
+  return total;
+}
+
+vw::uint64 vw::Cache::misses() {
+  uint64 total = 0;
+  for (size_t i = 0; i < m_shards.size(); ++i)
+    total += m_shards[i]->misses;
+  return total;
+}
+
+vw::uint64& vw::Cache::thread_miss_count() {
+  static thread_local uint64 count = 0;
+  return count;
+}
+
+vw::uint64 vw::Cache::thread_misses() {
+  return thread_miss_count();
+}
+
+vw::uint64 vw::Cache::evictions() {
+  uint64 total = 0;
+  for (size_t i = 0; i < m_shards.size(); ++i)
+    total += m_shards[i]->evictions;
+  return total;
+}
+
+vw::uint64 vw::Cache::spill_hits() {
+  uint64 total = 0;
+  for (size_t i = 0; i < m_shards.size(); ++i)
+    total += m_shards[i]->spill_hits;
+  return total;
+}
+
+void vw::Cache::clear_stats() {
+  for (size_t i = 0; i < m_shards.size(); ++i)
+    m_shards[i]->hits = m_shards[i]->misses = m_shards[i]->evictions = m_shards[i]->spill_hits = 0;
+  Mutex::WriteLock lock(m_type_mutex);
+  std::map<std::string, boost::shared_ptr<TypeCounters> >::iterator it;
+  for (it = m_type_counters.begin(); it != m_type_counters.end(); ++it) {
+    TypeCounters& c = *it->second;
+    c.hits = c.misses = c.spill_hits = c.generations = c.generation_us = c.lock_wait_us = 0;
+  }
+}
+
+namespace {
+  bool more_resident( vw::Cache::GeneratorStats const& a, vw::Cache::GeneratorStats const& b ) {
+    return a.resident > b.resident;
+  }
+}
+
+vw::Cache::Snapshot vw::Cache::snapshot() {
+  Snapshot snap;
+  snap.size       = m_size;
+  snap.max_size   = m_max_size;
+  snap.hits       = hits();
+  snap.misses     = misses();
+  snap.evictions  = evictions();
+  snap.spill_hits = spill_hits();
+
+  Mutex::ReadLock lock(m_type_mutex);
+  std::map<std::string, boost::shared_ptr<TypeCounters> >::const_iterator it;
+  for (it = m_type_counters.begin(); it != m_type_counters.end(); ++it) {
+    TypeCounters const& c = *it->second;
+    GeneratorStats g;
+    g.name          = c.name;
+    g.lines         = c.lines;
+    g.resident      = c.resident;
+    g.hits          = c.hits;
+    g.misses        = c.misses;
+    g.spill_hits    = c.spill_hits;
+    g.generations   = c.generations;
+    g.generation_us = c.generation_us;
+    g.lock_wait_us  = c.lock_wait_us;
+    snap.generators.push_back(g);
+  }
+  std::sort(snap.generators.begin(), snap.generators.end(), more_resident);
+  return snap;
+}
+
+void vw::Cache::set_spill_file( boost::shared_ptr<CacheSpillFile> const& spill ) {
+  Mutex::WriteLock lock(m_spill_mutex);
+  m_spill = spill;
+}
+
+boost::shared_ptr<vw::CacheSpillFile> vw::Cache::spill_file() {
+  Mutex::ReadLock lock(m_spill_mutex);
+  return m_spill;
+}
+
 // Note that this call does not actually deallocate the data from the CacheLine object.
 // It is up to the originating call to do that.  This call only removes all reference in 
 // the Cache class to the CacheLine object.
 void vw::Cache::deallocate( size_t size, CacheLineBase *line ) {
-  RecursiveMutex::Lock cache_lock(m_line_mgmt_mutex);
+  Shard& shard = line->m_shard;
+  RecursiveMutex::Lock shard_lock(shard.mutex);
 
   // This call implies the need to call invalidate (move to top of invalid list)
   invalidate( line );
 
-  m_size -= size; // Remove the given size contribution.
+  shard.size -= size; // Remove the given size contribution.
+  m_size     -= size;
+  line->m_counters.resident -= size;
+  shard.num_valid--;
+  if ( m_account )
+    m_account->release( size );
+  line->m_freed_at = ++shard.deallocations;
+  if ( line->m_protected.exchange(false) )
+    shard.protected_size -= line->m_size;
   VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache deallocated " << size << " bytes (" << m_size << " / " << m_max_size << " used)" << "\n"; )
 }
 
@@ -139,16 +442,17 @@ void vw::Cache::deallocate( size_t size, CacheLineBase *line ) {
 // TODO: Could we use some sort of linked list class to handle this stuff?
 
 void vw::Cache::validate( CacheLineBase *line ) {
-  RecursiveMutex::Lock cache_lock(m_line_mgmt_mutex);
+  Shard& shard = line->m_shard;
+  RecursiveMutex::Lock shard_lock(shard.mutex);
   // If the input line is already most valid, done!
-  if( line == m_first_valid ) 
+  if( line == shard.first_valid ) 
     return;
   // This is the last line, we need to retreat the last valid pointer by one.
-  if( line == m_last_valid ) 
-    m_last_valid = line->m_prev;
+  if( line == shard.last_valid ) 
+    shard.last_valid = line->m_prev;
   // If this is the first in the invalid list, we need to advance the first invalid pointer by one.
-  if( line == m_first_invalid ) 
-    m_first_invalid = line->m_next;
+  if( line == shard.first_invalid ) 
+    shard.first_invalid = line->m_next;
   // Adjust the elements before and after the input element to restore the linked list
   //  with the current element removed. TODO: Make this a function?
   if( line->m_next ) 
@@ -156,42 +460,44 @@ void vw::Cache::validate( CacheLineBase *line ) {
   if( line->m_prev ) 
     line->m_prev->m_next = line->m_next;
   // Make whatever is now first valid come after the input line
-  line->m_next = m_first_valid;
+  line->m_next = shard.first_valid;
   line->m_prev = 0; // The new line is first, nothing before it!
   
   // Update first valid pointer to point to the new object
-  if( m_first_valid ) 
-    m_first_valid->m_prev = line;
-  m_first_valid = line;
+  if( shard.first_valid ) 
+    shard.first_valid->m_prev = line;
+  shard.first_valid = line;
   
   // Handle case where this is the first valid element to be validated
-  if( ! m_last_valid ) 
-    m_last_valid = line;
+  if( ! shard.last_valid ) 
+    shard.last_valid = line;
 }
 
 
 void vw::Cache::invalidate( CacheLineBase *line ) {
-  RecursiveMutex::Lock cache_lock(m_line_mgmt_mutex);
+  Shard& shard = line->m_shard;
+  RecursiveMutex::Lock shard_lock(shard.mutex);
   // Update first and last pointers if they point to the line
-  if( line == m_first_valid ) m_first_valid = line->m_next;
-  if( line == m_last_valid  ) m_last_valid  = line->m_prev;
+  if( line == shard.first_valid ) shard.first_valid = line->m_next;
+  if( line == shard.last_valid  ) shard.last_valid  = line->m_prev;
   // Extract the line from its current location in the linked list
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
   // Set the line to the first place in the list
-  line->m_next = m_first_invalid;
+  line->m_next = shard.first_invalid;
   line->m_prev = 0;
-  if( m_first_invalid ) m_first_invalid->m_prev = line;
-  m_first_invalid = line;
+  if( shard.first_invalid ) shard.first_invalid->m_prev = line;
+  shard.first_invalid = line;
 }
 
 
 void vw::Cache::remove( CacheLineBase *line ) {
-  RecursiveMutex::Lock cache_lock(m_line_mgmt_mutex);
+  Shard& shard = line->m_shard;
+  RecursiveMutex::Lock shard_lock(shard.mutex);
   // Update list pointers if they pointed to the line
-  if( line == m_first_valid   ) m_first_valid   = line->m_next;
-  if( line == m_last_valid    ) m_last_valid    = line->m_prev;
-  if( line == m_first_invalid ) m_first_invalid = line->m_next;
+  if( line == shard.first_valid   ) shard.first_valid   = line->m_next;
+  if( line == shard.last_valid    ) shard.last_valid    = line->m_prev;
+  if( line == shard.first_invalid ) shard.first_invalid = line->m_next;
   // Extract the line from its current location in the linked list
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
@@ -200,19 +506,20 @@ void vw::Cache::remove( CacheLineBase *line ) {
 
 
 void vw::Cache::deprioritize( CacheLineBase *line ) {
-  RecursiveMutex::Lock cache_lock(m_line_mgmt_mutex);
+  Shard& shard = line->m_shard;
+  RecursiveMutex::Lock shard_lock(shard.mutex);
   // Already the last item, done!
-  if( line == m_last_valid  ) return;
+  if( line == shard.last_valid  ) return;
   // Update the first valid pointer if needed
-  if( line == m_first_valid ) m_first_valid = line->m_next;
+  if( line == shard.first_valid ) shard.first_valid = line->m_next;
   // Extract the line from its current location in the linked list
   if( line->m_next ) line->m_next->m_prev = line->m_prev;
   if( line->m_prev ) line->m_prev->m_next = line->m_next;
   // Set the line to the last place in the list
-  line->m_prev = m_last_valid;
+  line->m_prev = shard.last_valid;
   line->m_next = 0;
-  m_last_valid->m_next = line;
-  m_last_valid = line;
+  shard.last_valid->m_next = line;
+  shard.last_valid = line;
 }
 
 
@@ -66,11 +66,18 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/CacheSpill.h>
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/Profiler.h>
 #include <vw/Core/FundamentalTypes.h>
 
 #include <typeinfo>
 #include <stddef.h>
 #include <string>
+#include <vector>
+#include <map>
+#include <atomic>
 
 #include <boost/smart_ptr/shared_ptr.hpp>
 
@@ -121,8 +128,34 @@ namespace vw {
     - The CacheLine class is where objects are created and destroyed (using smart pointers and the
       provided GeneratorT class))
 
-    - TODO: The Cache class should support different allocation strategies besides just deleting the 
-            oldest resource every time!
+    - The EvictionPolicy decides which valid line is freed when the Cache is over its size limit:
+      - LruEviction:       Free the line which was loaded longest ago.
+      - ClockEviction:     Like LRU, but a line which was hit since the sweep last passed it is
+                           moved back to the front of the list once (a "second chance").
+      - TwoQueueEviction:  Lines which have not been hit since they were loaded are freed before
+                           lines which have, so a single pass over lots of data does not flush the
+                           lines which are reused.  A line which is loaded again shortly after it
+                           was freed also counts as reused.
+      - CostEviction:      Each line has a credit equal to the time its generator took divided by
+                           its size, plus the credit of the last line freed (GreedyDual).  The
+                           line with the lowest credit among the oldest few is freed, so expensive
+                           lines stay loaded longer.
+
+    - The lists can optionally be split into several shards.  Each CacheLine is assigned to one
+      shard when it is created and each shard has its own lock and its own LRU lists, so threads
+      working on lines in different shards do not wait on each other.  The byte budget is shared
+      by all of the shards and is only enforced approximately: an allocation first evicts from
+      its own shard and then from the others, locking each one in turn.  With a single shard
+      (the default) the Cache behaves as one exact LRU list.
+
+    - A CacheSpillFile can be attached as a second tier.  When a line is evicted and its value
+      type has a CacheSpillTraits specialization, a compressed copy is written to the file, and
+      the next miss on that line reads the copy back instead of calling the generator.  The copy
+      is kept until the line is destroyed, so a line is only written to the file once.
+
+    - The loaded bytes can be counted against a MemoryGovernor shared with other subsystems.
+      The Cache then also evicts while the governor is over budget, and when another consumer
+      is waiting for memory.  The system cache uses vw_memory_governor().
     
     User interface:
     - Call insert() to add a new GeneratorT object (internally wrapped in a CacheLine object)
@@ -140,7 +173,8 @@ namespace vw {
     // ============= Cache public functions ========================================================
 
     /// Constructor
-    inline Cache( size_t max_size );
+    /// - The lines are split over num_shards independently locked LRU lists.
+    inline Cache( size_t max_size, size_t num_shards = 1 );
 
     /// Wrap a GeneraterT in a CacheLine in a Handle object and return it.
     /// - By creating the CacheLine object it is automatically registered with the Cache object.
@@ -150,12 +184,70 @@ namespace vw {
 
     void   resize( size_t size ); ///< Change the maximum size in bytes of the Cache.
     size_t max_size();            ///< Return the maximum permissible size in bytes.
+    size_t size();                ///< Return the currently loaded size in bytes.
+
+    /// Change the number of shards.  This can only be done before any lines are inserted.
+    void   set_num_shards( size_t num_shards );
+    size_t num_shards() const { return m_shards.size(); }
  
+    /// Strategies for choosing which line to free, see the class description.
+    enum EvictionPolicy { LruEviction, ClockEviction, TwoQueueEviction, CostEviction };
+
+    /// Parse "lru", "clock", "2q" or "cost" into an EvictionPolicy.
+    static EvictionPolicy eviction_policy_from_string( std::string const& name );
+
+    void           set_eviction_policy( EvictionPolicy policy ) { m_policy = policy; }
+    EvictionPolicy eviction_policy() const { return EvictionPolicy(int(m_policy)); }
+
     // Statistics functions to query and clear hit, miss, and eviction counts.
-    uint64 hits       () { Mutex::ReadLock  cache_lock(m_stats_mutex);  return m_hits;      }
-    uint64 misses     () { Mutex::ReadLock  cache_lock(m_stats_mutex);  return m_misses;    }
-    uint64 evictions  () { Mutex::ReadLock  cache_lock(m_stats_mutex);  return m_evictions; }
-    void   clear_stats() { Mutex::WriteLock cache_lock(m_stats_mutex);  m_hits=m_misses=m_evictions = 0; }
+    uint64 hits       ();
+    uint64 misses     ();
+    uint64 evictions  ();
+    void   clear_stats();
+
+    /// The misses counted on the calling thread, in every Cache, since the
+    /// thread started.  The difference across a piece of work gives its
+    /// misses, leaving out those of any threads it hands work to.
+    static uint64 thread_misses();
+
+    /// Attach a scratch file used to keep evicted lines, or detach it with an empty pointer.
+    /// - Lines already spilled keep their copies in the old file.
+    void set_spill_file( boost::shared_ptr<CacheSpillFile> const& spill );
+    boost::shared_ptr<CacheSpillFile> spill_file();
+
+    /// Number of misses which were served from the spill file instead of the generator.
+    uint64 spill_hits();
+
+    /// Count the loaded bytes against a MemoryGovernor, or stop with a null
+    /// pointer.  While the governor is over budget the Cache evicts lines
+    /// as if it were over its own maximum size.  Like set_num_shards(),
+    /// this should be called before the Cache is in use.
+    void set_memory_governor( MemoryGovernor* governor, std::string const& name = "cache" );
+
+    /// Counters for all of the lines created from one generator type, see snapshot().
+    struct GeneratorStats {
+      std::string name;          ///< Demangled type name of the generator
+      uint64 lines;              ///< Number of lines which currently exist
+      size_t resident;           ///< Bytes currently loaded
+      uint64 hits, misses, spill_hits;
+      uint64 generations;        ///< Number of calls to generate()
+      uint64 generation_us;      ///< Total time spent in generate()
+      uint64 lock_wait_us;       ///< Total time spent waiting for line locks in value()
+
+      double hit_rate() const { return hits+misses ? double(hits)/double(hits+misses) : 0; }
+      double mean_generation_ms() const { return generations ? generation_us/1000.0/generations : 0; }
+    };
+
+    /// A copy of the Cache counters taken at one point in time.
+    struct Snapshot {
+      size_t size, max_size;
+      uint64 hits, misses, evictions, spill_hits;
+      std::vector<GeneratorStats> generators; ///< Sorted by resident bytes, largest first
+    };
+
+    /// Collect the current counters.  The totals are not taken atomically with
+    /// respect to each other, so they may be slightly inconsistent under load.
+    Snapshot snapshot();
     
     /// Interface class for safe user access to CacheLine objects.
     template <class GeneratorT>
@@ -195,18 +287,93 @@ namespace vw {
   private:
 
 
+    /// One independently locked set of valid and invalid lists.
+    struct Shard {
+      CacheLineBase      *first_valid,
+                         *last_valid,
+                         *first_invalid;
+      size_t              size;  ///< Loaded size in bytes of the lines in this shard
+      size_t              num_valid;      ///< Number of loaded lines in this shard
+      std::atomic<size_t> protected_size; ///< Loaded size of the lines marked as reused (2Q)
+      uint64              deallocations;  ///< Count of lines freed, used to age freed lines (2Q)
+      double              cost_floor;     ///< Credit of the last line evicted (cost-aware)
+      RecursiveMutex      mutex; ///< Mutex for adjusting the CacheLineBase pointers above.
+      std::atomic<uint64> hits, misses, evictions, spill_hits; ///< Shard statistics
+      Shard() : first_valid(0), last_valid(0), first_invalid(0), size(0),
+                num_valid(0), protected_size(0), deallocations(0), cost_floor(0),
+                hits(0), misses(0), evictions(0), spill_hits(0) {}
+    };
+
+    /// The live counters behind GeneratorStats, shared by all lines of one type.
+    struct TypeCounters {
+      std::string         name;
+      std::atomic<uint64> lines, hits, misses, spill_hits, generations, generation_us, lock_wait_us;
+      std::atomic<size_t> resident;
+      TypeCounters( std::string const& name ) : name(name), lines(0), hits(0), misses(0),
+        spill_hits(0), generations(0), generation_us(0), lock_wait_us(0), resident(0) {}
+    };
+
     // Cache class private variables
-    CacheLineBase      *m_first_valid, 
-                       *m_last_valid, 
-                       *m_first_invalid;
-    size_t              m_size,     ///< Currently loaded size in bytes
-                        m_max_size; ///< Maximum permissible size in bytes
-    RecursiveMutex      m_line_mgmt_mutex; ///< Mutex for adjusting the CacheLineBase pointers above.
-    Mutex               m_stats_mutex;     ///< Seperate mutex for the statistics variables below.
-    volatile vw::uint64 m_hits, m_misses, m_evictions, ///< Cache statistics
-                        m_last_size; ///< Record the last size at which we printed a size warning to screen!
+    std::vector<boost::shared_ptr<Shard> > m_shards;
+    std::atomic<size_t> m_next_shard; ///< Round-robin counter used to assign new lines to shards.
+    std::atomic<size_t> m_size,       ///< Currently loaded size in bytes
+                        m_max_size;   ///< Maximum permissible size in bytes
+    std::atomic<int>    m_policy;     ///< The EvictionPolicy in use
+    Mutex               m_stats_mutex; ///< Mutex for the size warning variable below.
+    vw::uint64          m_last_size; ///< Record the last size at which we printed a size warning to screen!
+    boost::shared_ptr<CacheSpillFile> m_spill; ///< Optional second tier for evicted lines
+    Mutex               m_spill_mutex; ///< Mutex for m_spill
+    std::map<std::string, boost::shared_ptr<TypeCounters> > m_type_counters; ///< Keyed by mangled name
+    Mutex               m_type_mutex;  ///< Mutex for m_type_counters
+    class GovernorAccount;
+    boost::shared_ptr<GovernorAccount> m_account; ///< Optional, see set_memory_governor()
 
     // Cache class private functions
+
+    /// Pick the shard which a newly created line will belong to.
+    Shard& next_shard();
+
+    /// True if lines should be evicted, because either the Cache or the
+    /// MemoryGovernor is over its limit.
+    bool over_limit() const;
+
+    /// Evict from every shard until the Cache is no longer over_limit().
+    void evict_to_limit();
+
+    /// Find or create the counters for lines of the given generator type.
+    TypeCounters& type_counters( std::type_info const& type );
+
+    /// Evict lines in a shard (never the keep line), chosen by the eviction policy, until
+    /// the Cache is within its size limit.  The caller must hold the shard mutex.
+    /// - Lines whose values are to be spilled are added to spills, still locked, and must be
+    ///   passed to finish_spills() once the shard mutex is released.
+    /// - Returns the number of lines that were evicted.
+    uint64 evict( Shard& shard, CacheLineBase *keep, std::vector<CacheLineBase*>& spills );
+
+    /// Walk the valid list of a shard from the oldest line, evicting any line which the
+    /// policy allows.  With only_protected or only_unprotected set just those lines are freed.
+    uint64 evict_scan( Shard& shard, CacheLineBase *keep, std::vector<CacheLineBase*>& spills,
+                       bool second_chance, bool only_protected, bool only_unprotected );
+
+    /// Evict the lines with the lowest credit from the oldest few in the shard.
+    uint64 evict_by_cost( Shard& shard, CacheLineBase *keep, std::vector<CacheLineBase*>& spills );
+
+    /// Write the values of lines detached by evict() to the spill file and free them.
+    /// Must be called without holding any shard mutex.
+    static void finish_spills( std::vector<CacheLineBase*>& spills );
+
+    /// The cost per byte of a line, which is the credit it earns when loaded (cost-aware).
+    static double cost_credit( CacheLineBase const* line );
+    static bool   lower_credit( CacheLineBase const* a, CacheLineBase const* b );
+
+    /// Record a hit on a loaded line for the eviction policies.
+    void record_hit( CacheLineBase *line );
+
+    /// The counter behind thread_misses().
+    static uint64& thread_miss_count();
+
+    /// Record how long the generator of a line took (in microseconds).
+    void record_cost( CacheLineBase *line, uint64 microseconds );
     
     /// Call validate() on the line, increment m_size, and then clear up old CacheLine objects
     /// if we went over the size limit.
@@ -232,30 +399,52 @@ namespace vw {
     private:
       /// Reference to parent Cache object
       Cache& m_cache;
+      /// The shard of the parent Cache whose lists this line lives in
+      Shard& m_shard;
+      /// Statistics shared with the other lines of the same generator type
+      TypeCounters& m_counters;
       /// These are used to form an ordered linked list of CacheLine objects
       CacheLineBase *m_prev, *m_next; 
       /// Size in bytes of the CacheLine data object.
       const size_t m_size;
+      /// Eviction policy state, see Cache::evict()
+      std::atomic<bool>   m_referenced; ///< Hit since the CLOCK sweep last passed this line
+      std::atomic<bool>   m_protected;  ///< Reused while loaded (2Q)
+      uint64              m_freed_at;   ///< Shard deallocation count when last freed (2Q)
+      std::atomic<uint64> m_cost;       ///< Microseconds taken by the last generation
+      double              m_credit;     ///< GreedyDual credit, guarded by the shard mutex
       friend class Cache;
       
     protected:
       Cache& cache() const { return m_cache; }
+      Shard& shard() const { return m_shard; }
+      TypeCounters& counters() const { return m_counters; }
       
       inline void allocate    () { m_cache.allocate  (m_size, this); }
       inline void deallocate  () { m_cache.deallocate(m_size, this); }
       inline void validate    () { m_cache.validate    (this); }
       inline void remove      () { m_cache.remove      (this); }
       inline void deprioritize() { m_cache.deprioritize(this); }
+      inline void record_hit  () { m_cache.record_hit  (this); }
+      inline void record_cost (uint64 microseconds) { m_cache.record_cost(this, microseconds); }
       
     public:
-      CacheLineBase( Cache& cache, size_t size ) : m_cache(cache), 
-                                                   m_prev(0), m_next(0), 
-                                                   m_size(size) {}
-      virtual ~CacheLineBase() {}
+      CacheLineBase( Cache& cache, size_t size, std::type_info const& type )
+        : m_cache(cache), m_shard(cache.next_shard()), m_counters(cache.type_counters(type)),
+          m_prev(0), m_next(0), m_size(size), m_referenced(false),
+          m_protected(false), m_freed_at(0), m_cost(0), m_credit(0) { m_counters.lines++; }
+      virtual ~CacheLineBase() { m_counters.lines--; }
       
       virtual inline void   invalidate    ()       { m_cache.invalidate(this); }
-      virtual inline bool   try_invalidate()       { m_cache.invalidate(this); return true; }
       virtual inline size_t size          () const { return m_size; }
+
+      /// Non-blocking invalidate.  If the value is to be spilled, the line is only taken
+      /// out of the valid list and added to spills, still locked; finish_spill() writes
+      /// and frees the value later.
+      virtual inline bool try_invalidate( std::vector<CacheLineBase*>& /*spills*/ ) {
+        m_cache.invalidate(this); return true;
+      }
+      virtual inline void finish_spill() {}
     }; // End class CacheLineBase
     friend class CacheLineBase; // Make this a friend of the Cache class
 
@@ -268,11 +457,24 @@ namespace vw {
     template <class GeneratorT>
     class CacheLine : public CacheLineBase {
     
-      typedef typename boost::shared_ptr<typename core::detail::GenValue<GeneratorT>::type> value_type;
+      typedef typename core::detail::GenValue<GeneratorT>::type raw_value_type;
+      typedef typename boost::shared_ptr<raw_value_type> value_type;
+      typedef CacheSpillTraits<raw_value_type> spill_traits;
       GeneratorT m_generator;
       value_type m_value;
       Mutex      m_mutex; // Mutex for m_value and generation of this cache line
       uint64     m_generation_count;
+      boost::shared_ptr<CacheSpillFile> m_spill_file; ///< Set if a copy of m_value is on disk
+      CacheSpillFile::Record            m_spill_record;
+
+      /// Free m_value, first writing it to the spill file if asked to.  Needs the line mutex.
+      void drop_value( bool spill );
+
+      /// Write m_value to the spill file of the Cache if it can be and is not there already.
+      void spill_value();
+
+      /// Read m_value back from the spill file.  Returns false if there is no copy.
+      bool unspill_value();
 
     public:
       /// Constructor
@@ -285,8 +487,11 @@ namespace vw {
       /// - Maybe this function should have been called something else?
       virtual void invalidate();
 
-      /// Non-blocking version of invalidate.
-      virtual bool try_invalidate();
+      /// Non-blocking version of invalidate, see CacheLineBase::try_invalidate().
+      virtual bool try_invalidate( std::vector<CacheLineBase*>& spills );
+
+      /// Spill and free a value detached by try_invalidate(), and unlock the line.
+      virtual void finish_spill();
 
       /// Print some information about this object.
       std::string info();
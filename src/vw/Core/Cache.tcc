@@ -24,7 +24,8 @@
 
 template <class GeneratorT>
 Cache::CacheLine<GeneratorT>::CacheLine( Cache& cache, GeneratorT const& generator )
-  : CacheLineBase(cache,core::detail::pointerish(generator)->size()), m_generator(generator), m_generation_count(0)
+  : CacheLineBase(cache,core::detail::pointerish(generator)->size(), typeid(GeneratorT)),
+    m_generator(generator), m_generation_count(0)
 {
   VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache creating CacheLine " << info() << "\n"; )
   CacheLineBase::invalidate(); // Move to the start of the Cache class invalid list.
@@ -33,10 +34,61 @@ Cache::CacheLine<GeneratorT>::CacheLine( Cache& cache, GeneratorT const& generat
 template <class GeneratorT>
 Cache::CacheLine<GeneratorT>::~CacheLine() {
   VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache destroying CacheLine " << info() << "\n"; )
-  invalidate(); // Clean up the allocated data.
+  {
+    Mutex::WriteLock line_lock(m_mutex);
+    if (m_value.get() != NULL)
+      drop_value(false); // Clean up the allocated data, there is no point in spilling it now.
+  }
+  if (m_spill_file)
+    m_spill_file->drop(m_spill_record);
   remove();
 }
 
+template <class GeneratorT>
+void Cache::CacheLine<GeneratorT>::drop_value( bool spill ) {
+  if (spill)
+    spill_value();
+  CacheLineBase::deallocate(); // Calls invalidate internally which redirects to the parent Cache class
+  m_value.reset(); // After the base class function is done, delete the last shared pointer to the data.
+}
+
+template <class GeneratorT>
+void Cache::CacheLine<GeneratorT>::spill_value() {
+  if (!spill_traits::spillable || m_spill_file)
+    return; // Can't be spilled, or the copy on disk is still good.
+  boost::shared_ptr<CacheSpillFile> spill = cache().spill_file();
+  if (!spill)
+    return;
+  VW_PROFILE_ZONE("Cache::spill");
+  std::vector<uint8> buffer;
+  spill_traits::save(*m_value, buffer);
+  try {
+    if (spill->write(buffer.empty() ? 0 : &buffer[0], buffer.size(), m_spill_record))
+      m_spill_file = spill;
+  } catch (const IOErr& e) {
+    // The line can always be regenerated, so a failed spill only costs time.
+    VW_OUT(WarningMessage, "cache") << "Cache failed to spill CacheLine: " << e.what() << "\n";
+  }
+}
+
+template <class GeneratorT>
+bool Cache::CacheLine<GeneratorT>::unspill_value() {
+  if (!m_spill_file)
+    return false;
+  VW_PROFILE_ZONE("Cache::unspill");
+  try {
+    std::vector<uint8> buffer;
+    m_spill_file->read(m_spill_record, buffer);
+    m_value = spill_traits::load(buffer.empty() ? 0 : &buffer[0], buffer.size());
+  } catch (const IOErr& e) {
+    VW_OUT(WarningMessage, "cache") << "Cache failed to read spilled CacheLine: " << e.what() << "\n";
+    m_spill_file->drop(m_spill_record);
+    m_spill_file.reset();
+    m_value.reset();
+  }
+  return m_value.get() != NULL;
+}
+
 template <class GeneratorT>
 void Cache::CacheLine<GeneratorT>::invalidate() {
   VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache invalidating CacheLine " << info() << "\n"; );
@@ -44,12 +96,11 @@ void Cache::CacheLine<GeneratorT>::invalidate() {
   Mutex::WriteLock line_lock(m_mutex); // Grab a lock until the function exits.
   if (m_value.get() == NULL) return; // Not in memory, don't need to do anything.
 
-  CacheLineBase::deallocate(); // Calls invalidate internally which redirects to the parent Cache class
-  m_value.reset(); // After the base class function is done, delete the last shared pointer to the data.
+  drop_value(true);
 }
 
 template <class GeneratorT>
-bool Cache::CacheLine<GeneratorT>::try_invalidate() {
+bool Cache::CacheLine<GeneratorT>::try_invalidate( std::vector<CacheLineBase*>& spills ) {
   bool have_lock = m_mutex.try_lock();
   if ( !have_lock ) 
     return false;
@@ -59,13 +110,27 @@ bool Cache::CacheLine<GeneratorT>::try_invalidate() {
   }
 
   VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache invalidating CacheLine " << info() << "\n"; );
-  CacheLineBase::deallocate(); // Calls invalidate internally
-  m_value.reset();
+  if (!spill_traits::spillable || m_spill_file) {
+    drop_value(false); // Nothing to write, free it now.
+    m_mutex.unlock();
+    return true;
+  }
 
-  m_mutex.unlock();
+  // Our caller holds the shard mutex, so only take the line out of the
+  // lists here.  The line stays locked until finish_spill() has written
+  // the value, so nobody sees it half spilled.
+  CacheLineBase::deallocate();
+  spills.push_back(this);
   return true;
 }
 
+template <class GeneratorT>
+void Cache::CacheLine<GeneratorT>::finish_spill() {
+  spill_value();
+  m_value.reset();
+  m_mutex.unlock();
+}
+
 template <class GeneratorT>
 std::string Cache::CacheLine<GeneratorT>::info() {
   Mutex::ReadLock line_lock(m_mutex);
@@ -78,27 +143,44 @@ std::string Cache::CacheLine<GeneratorT>::info() {
 template <class GeneratorT>
 typename Cache::CacheLine<GeneratorT>::value_type const& Cache::CacheLine<GeneratorT>::value() {
 
+  uint64 wait_start = Stopwatch::microtime();
   m_mutex.lock_shared(); // Grab a shared lock
+  counters().lock_wait_us += Stopwatch::microtime() - wait_start;
   bool hit = (m_value.get() != NULL);
-  { // Grab a temporary mutex to update our cache statistics
-    { // TODO: This should be abstracted into a call
-      Mutex::WriteLock cache_lock( cache().m_stats_mutex );
-      if (hit)
-        cache().m_hits++;
-      else
-        cache().m_misses++;
-    }
+  if (hit) { // Update the statistics of our shard
+    shard().hits++;
+    counters().hits++;
+    CacheLineBase::record_hit();
+  } else {
+    shard().misses++;
+    counters().misses++;
+    thread_miss_count()++;
   }
   if( !hit ) { // Then we need to load the data into memory.
     VW_CACHE_DEBUG( VW_OUT(DebugMessage, "cache") << "Cache generating CacheLine " << info() << "\n"; );
     m_mutex.unlock_shared(); // Release shared
+    wait_start = Stopwatch::microtime();
     m_mutex.lock_upgrade();  // Get upgrade status
     m_mutex.unlock_upgrade_and_lock(); // Upgrade to exclusive access
+    counters().lock_wait_us += Stopwatch::microtime() - wait_start;
     CacheLineBase::allocate(); // Call validate internally
 
     //TODO: Why allocate and then generate?
-    m_generation_count++; // Update stats
-    m_value = core::detail::pointerish(m_generator)->generate();
+    if (unspill_value()) { // Reading a spilled copy is much cheaper than generating it again.
+      shard().spill_hits++;
+      counters().spill_hits++;
+    } else {
+      m_generation_count++; // Update stats
+      uint64 start_time = Stopwatch::microtime();
+      {
+        VW_PROFILE_ZONE("Cache::generate");
+        m_value = core::detail::pointerish(m_generator)->generate();
+      }
+      uint64 elapsed = Stopwatch::microtime() - start_time;
+      CacheLineBase::record_cost(elapsed);
+      counters().generations++;
+      counters().generation_us += elapsed;
+    }
     // Downgrade from exclusive access down to shared access
     m_mutex.unlock_and_lock_upgrade();
     m_mutex.unlock_upgrade_and_lock_shared();
@@ -193,10 +275,9 @@ bool Cache::Handle<GeneratorT>::attached() const {
 // ============= Start class Cache ========================================================
 
 
-Cache::Cache( size_t max_size ) :
-  m_first_valid(0), m_last_valid(0), m_first_invalid(0),
-  m_size(0), m_max_size(max_size),
-  m_hits(0), m_misses(0), m_evictions(0), m_last_size(0) {
+Cache::Cache( size_t max_size, size_t num_shards ) :
+  m_next_shard(0), m_size(0), m_max_size(max_size), m_policy(LruEviction), m_last_size(0) {
+  set_num_shards(num_shards);
 }
 
 
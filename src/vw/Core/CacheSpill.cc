@@ -0,0 +1,160 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/CacheSpill.cc
+///
+/// The scratch file used as the second tier of the Cache.
+///
+#include <vw/Core/CacheSpill.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/System.h>
+
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <unistd.h>
+
+#include <zlib.h>
+
+vw::CacheSpillFile::CacheSpillFile( size_t max_size, std::string const& directory )
+  : m_fd(-1), m_max_size(max_size), m_end(0), m_size(0), m_writes(0), m_reads(0), m_rejects(0) {
+  std::string dir = directory.empty() ? vw_settings().tmp_directory() : directory;
+  std::string templ = dir + "/vwcacheXXXXXX";
+  std::vector<char> path( templ.begin(), templ.end() );
+  path.push_back('\0');
+  m_fd = ::mkstemp( &path[0] );
+  if (m_fd == -1)
+    vw_throw( IOErr() << "CacheSpillFile: failed to create scratch file from template "
+                      << templ << ": " << ::strerror(errno) );
+  // Nobody else needs the name, and unlinking now means the space is
+  // reclaimed however the process exits.
+  ::unlink( &path[0] );
+}
+
+vw::CacheSpillFile::~CacheSpillFile() {
+  if (m_fd != -1)
+    ::close(m_fd);
+}
+
+bool vw::CacheSpillFile::reserve( size_t size, uint64& offset ) {
+  Mutex::Lock lock(m_mutex);
+  if (m_size + size > m_max_size)
+    return false;
+  for (std::map<uint64, size_t>::iterator it = m_holes.begin(); it != m_holes.end(); ++it) {
+    if (it->second < size)
+      continue;
+    offset = it->first;
+    if (it->second > size)
+      m_holes[it->first + size] = it->second - size;
+    m_holes.erase(it);
+    m_size += size;
+    return true;
+  }
+  offset = m_end;
+  m_end += size;
+  m_size += size;
+  return true;
+}
+
+bool vw::CacheSpillFile::write( uint8 const* data, size_t size, Record& record ) {
+  // Level 1 is the fastest zlib setting; tiles are rewritten far more often
+  // than the extra ratio of a higher level would pay for.
+  uLongf packed_size = ::compressBound( size );
+  std::vector<uint8> packed( packed_size );
+  uint8 const* blob = data;
+  record.raw_size    = size;
+  record.stored_size = size;
+  record.compressed  = false;
+  if (::compress2( &packed[0], &packed_size, data, size, 1 ) == Z_OK && packed_size < size) {
+    blob = &packed[0];
+    record.stored_size = packed_size;
+    record.compressed  = true;
+  }
+
+  if (!reserve( record.stored_size, record.offset )) {
+    m_rejects++;
+    return false;
+  }
+
+  size_t done = 0;
+  while (done < record.stored_size) {
+    ssize_t n = ::pwrite( m_fd, blob + done, record.stored_size - done, record.offset + done );
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0) {
+      drop( record );
+      vw_throw( IOErr() << "CacheSpillFile: write failed: " << ::strerror(errno) );
+    }
+    done += n;
+  }
+  m_writes++;
+  return true;
+}
+
+void vw::CacheSpillFile::read( Record const& record, std::vector<uint8>& buffer ) {
+  std::vector<uint8> packed;
+  std::vector<uint8>& dest = record.compressed ? packed : buffer;
+  dest.resize( record.stored_size );
+
+  size_t done = 0;
+  while (done < record.stored_size) {
+    ssize_t n = ::pread( m_fd, &dest[done], record.stored_size - done, record.offset + done );
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      vw_throw( IOErr() << "CacheSpillFile: read failed: " << ::strerror(errno) );
+    done += n;
+  }
+
+  if (record.compressed) {
+    buffer.resize( record.raw_size );
+    uLongf raw_size = record.raw_size;
+    if (::uncompress( &buffer[0], &raw_size, &packed[0], record.stored_size ) != Z_OK ||
+        raw_size != record.raw_size)
+      vw_throw( IOErr() << "CacheSpillFile: corrupt record at offset " << record.offset );
+  }
+  m_reads++;
+}
+
+void vw::CacheSpillFile::drop( Record const& record ) {
+  Mutex::Lock lock(m_mutex);
+  uint64 offset = record.offset;
+  size_t size   = record.stored_size;
+
+  // Merge with the neighbouring holes so the free list stays short.
+  std::map<uint64, size_t>::iterator next = m_holes.lower_bound(offset);
+  if (next != m_holes.begin()) {
+    std::map<uint64, size_t>::iterator prev = next;
+    --prev;
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size  += prev->second;
+      m_holes.erase(prev);
+    }
+  }
+  if (next != m_holes.end() && offset + size == next->first) {
+    size += next->second;
+    m_holes.erase(next);
+  }
+  if (offset + size == m_end)
+    m_end = offset; // Don't keep a hole at the end of the file
+  else
+    m_holes[offset] = size;
+  m_size -= record.stored_size;
+}
@@ -0,0 +1,106 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/CacheSpill.h
+///
+/// A scratch file which the Cache uses as a second tier.  When a line
+/// whose value can be serialized is evicted, a compressed copy of it
+/// is written here so that the next miss can read it back instead of
+/// calling the (potentially very expensive) generator again.
+///
+#ifndef __VW_CORE_CACHESPILL_H__
+#define __VW_CORE_CACHESPILL_H__
+
+#include <vw/Core/Thread.h>
+#include <vw/Core/FundamentalTypes.h>
+
+#include <map>
+#include <string>
+#include <vector>
+#include <atomic>
+
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+namespace vw {
+
+  /// Customize this for a value type to let the Cache spill it to disk.
+  /// - save() appends a self-describing copy of the value to buffer,
+  ///   load() rebuilds the value from the bytes written by save().
+  template <class T>
+  struct CacheSpillTraits {
+    static const bool spillable = false;
+    static void save( T const& /*value*/, std::vector<uint8>& /*buffer*/ ) {}
+    static boost::shared_ptr<T> load( uint8 const* /*data*/, size_t /*size*/ ) {
+      return boost::shared_ptr<T>();
+    }
+  };
+
+  /// An unlinked scratch file holding zlib-compressed blobs.
+  /// - The file is removed from the directory as soon as it is created,
+  ///   so the disk space is returned even if the process dies.
+  /// - Space freed by dropped records is reused first-fit.
+  /// - All functions are thread-safe.
+  class CacheSpillFile : private boost::noncopyable {
+  public:
+
+    /// The location of one blob in the file.
+    struct Record {
+      uint64 offset;      ///< Start of the blob in the file
+      size_t stored_size; ///< Bytes used in the file
+      size_t raw_size;    ///< Bytes before compression
+      bool   compressed;  ///< False if compression did not make the blob smaller
+      Record() : offset(0), stored_size(0), raw_size(0), compressed(false) {}
+    };
+
+    /// Create a scratch file in directory holding at most max_size bytes.
+    /// - An empty directory means vw_settings().tmp_directory().
+    CacheSpillFile( size_t max_size, std::string const& directory = "" );
+    ~CacheSpillFile();
+
+    /// Compress and store a blob.  Returns false if the file is full.
+    bool write( uint8 const* data, size_t size, Record& record );
+
+    /// Read a blob back into buffer, which is resized to record.raw_size.
+    void read( Record const& record, std::vector<uint8>& buffer );
+
+    /// Return the space used by a blob to the file.
+    void drop( Record const& record );
+
+    size_t max_size() const { return m_max_size; } ///< Maximum bytes stored.
+    size_t size    () const { return m_size;     } ///< Bytes currently stored.
+
+    uint64 writes  () const { return m_writes;   } ///< Number of blobs written.
+    uint64 reads   () const { return m_reads;    } ///< Number of blobs read back.
+    uint64 rejects () const { return m_rejects;  } ///< Number of writes that did not fit.
+
+  private:
+    /// Find room for size bytes, returning false if there is none.
+    bool reserve( size_t size, uint64& offset );
+
+    int    m_fd;
+    size_t m_max_size;
+    uint64 m_end;                      ///< Current length of the file
+    std::map<uint64, size_t> m_holes;  ///< Free extents: offset -> length
+    Mutex  m_mutex;                    ///< Guards m_end and m_holes
+    std::atomic<size_t> m_size;
+    std::atomic<uint64> m_writes, m_reads, m_rejects;
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_CACHESPILL_H__
@@ -16,6 +16,8 @@
 // __END_LICENSE__
 
 #include <vw/Core/ConfigParser.h>
+#include <vw/Core/Cache.h>
+#include <vw/Core/CpuFeatures.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Log.h>
@@ -107,14 +109,40 @@ void vw::parse_config(std::basic_istream<char>& stream,
     try {
       if (o.string_key == "general.default_num_threads")
         settings.set_default_num_threads(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.numa_aware")
+        settings.set_numa_aware(boost::lexical_cast<bool>(o.value[0]));
       else if (o.string_key == "general.system_cache_size")
         settings.set_system_cache_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.system_cache_shards")
+        settings.set_system_cache_shards(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.system_cache_policy") {
+        // Check the name before storing it.
+        Cache::eviction_policy_from_string(o.value[0]);
+        settings.set_system_cache_policy(o.value[0]);
+      }
+      else if (o.string_key == "general.system_cache_spill_size")
+        settings.set_system_cache_spill_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.buffer_pool_size")
+        settings.set_buffer_pool_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.memory_budget")
+        settings.set_memory_budget(boost::lexical_cast<size_t>(o.value[0]));
       else if (o.string_key == "general.default_tile_size")
         settings.set_default_tile_size(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.auto_tile_size")
+        settings.set_auto_tile_size(boost::lexical_cast<bool>(o.value[0]));
       else if (o.string_key == "general.write_pool_size")
         settings.set_write_pool_size(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.gdal_read_handles")
+        settings.set_gdal_read_handles(boost::lexical_cast<uint32>(o.value[0]));
       else if (o.string_key == "general.tmp_directory")
         settings.set_tmp_directory(o.value[0]);
+      else if (o.string_key == "general.simd_isa") {
+        // Check the name before storing it.
+        simd_isa_features(o.value[0]);
+        settings.set_simd_isa(o.value[0]);
+      }
+      else if (o.string_key == "general.async_log")
+        settings.set_async_log(boost::lexical_cast<bool>(o.value[0]));
       else if (o.string_key.compare(0, 8, "logfile ") == 0) {
         size_t sep = o.string_key.find_last_of('.');
         assert(sep != std::string::npos);
@@ -158,6 +186,9 @@ void vw::parse_config(std::basic_istream<char>& stream,
     } catch (const boost::bad_lexical_cast& /*e*/) {
       std::cerr << "Could not parse line in config file near "
                 << o.string_key << ". skipping." << std::endl;
+    } catch (const ArgumentErr& e) {
+      std::cerr << "Invalid value in config file near "
+                << o.string_key << ". skipping. (" << e.what() << ")" << std::endl;
     }
   }
 
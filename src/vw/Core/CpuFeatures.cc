@@ -0,0 +1,123 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/CpuFeatures.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+
+#include <atomic>
+
+namespace {
+
+  vw::uint32 detect_features() {
+    using namespace vw;
+    uint32 features = 0;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // This also checks that the OS saves the wide registers.
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))            features |= CPU_SSE2;
+    if (__builtin_cpu_supports("popcnt"))          features |= CPU_POPCNT;
+    if (__builtin_cpu_supports("avx2"))            features |= CPU_AVX2;
+    if (__builtin_cpu_supports("avx512f"))         features |= CPU_AVX512F;
+    if (__builtin_cpu_supports("avx512bw"))        features |= CPU_AVX512BW;
+    if (__builtin_cpu_supports("avx512vpopcntdq")) features |= CPU_AVX512VPOPCNTDQ;
+#elif defined(_M_X64)
+    features |= CPU_SSE2; // Part of the x86-64 baseline
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+    features |= CPU_NEON;
+#endif
+    return features;
+  }
+
+  // The features allowed by the settings, or UNKNOWN until they are
+  // first needed.  Setting simd_isa stores them here directly.
+  const vw::uint32 UNKNOWN      = 0xFFFFFFFFu;
+  const vw::uint32 ALL_FEATURES = 0x7FFFFFFFu;
+  std::atomic<vw::uint32> allowed_features(UNKNOWN);
+
+  struct IsaName {
+    const char* name;
+    vw::uint32  features;
+  };
+
+  const vw::uint32 SSE4_FEATURES   = vw::CPU_SSE2 | vw::CPU_POPCNT;
+  const vw::uint32 AVX2_FEATURES   = SSE4_FEATURES | vw::CPU_AVX2;
+  const vw::uint32 AVX512_FEATURES = AVX2_FEATURES | vw::CPU_AVX512F | vw::CPU_AVX512BW | vw::CPU_AVX512VPOPCNTDQ;
+
+  const IsaName ISA_NAMES[] = {
+    { "auto",   ALL_FEATURES    },
+    { "scalar", 0               },
+    { "sse2",   vw::CPU_SSE2    },
+    { "sse4",   SSE4_FEATURES   },
+    { "avx2",   AVX2_FEATURES   },
+    { "avx512", AVX512_FEATURES },
+    { "neon",   vw::CPU_NEON    }
+  };
+
+  const IsaName FEATURE_NAMES[] = {
+    { "sse2",            vw::CPU_SSE2            },
+    { "popcnt",          vw::CPU_POPCNT          },
+    { "avx2",            vw::CPU_AVX2            },
+    { "avx512f",         vw::CPU_AVX512F         },
+    { "avx512bw",        vw::CPU_AVX512BW        },
+    { "avx512vpopcntdq", vw::CPU_AVX512VPOPCNTDQ },
+    { "neon",            vw::CPU_NEON            }
+  };
+
+} // namespace
+
+vw::uint32 vw::cpu_detected_features() {
+  static const uint32 features = detect_features();
+  return features;
+}
+
+vw::uint32 vw::cpu_features() {
+  uint32 allowed = allowed_features.load(std::memory_order_relaxed);
+  if (allowed == UNKNOWN) {
+    // Keep the value if the setting changed in the meantime.
+    uint32 expected = UNKNOWN;
+    allowed = simd_isa_features( vw_settings().simd_isa() );
+    if (!allowed_features.compare_exchange_strong(expected, allowed))
+      allowed = expected;
+  }
+  return cpu_detected_features() & allowed;
+}
+
+vw::uint32 vw::simd_isa_features( std::string const& isa ) {
+  for (size_t i = 0; i < sizeof(ISA_NAMES)/sizeof(ISA_NAMES[0]); ++i)
+    if (isa == ISA_NAMES[i].name)
+      return ISA_NAMES[i].features;
+  vw_throw( ArgumentErr() << "Unknown SIMD instruction set \"" << isa
+            << "\", expected auto, scalar, sse2, sse4, avx2, avx512 or neon." );
+  return 0; // Never reached
+}
+
+std::string vw::cpu_feature_names( uint32 features ) {
+  std::string names;
+  for (size_t i = 0; i < sizeof(FEATURE_NAMES)/sizeof(FEATURE_NAMES[0]); ++i)
+    if (features & FEATURE_NAMES[i].features) {
+      if (!names.empty())
+        names += " ";
+      names += FEATURE_NAMES[i].name;
+    }
+  return names;
+}
+
+void vw::detail::set_allowed_cpu_features( uint32 features ) {
+  allowed_features.store(features);
+}
@@ -0,0 +1,120 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/CpuFeatures.h
+///
+/// Run time selection of SIMD kernels, so that one binary uses the
+/// widest instructions each machine has.  Kernels built for an
+/// instruction set beyond the compiler's baseline (with the GCC
+/// target attribute, for instance) are registered in a CpuDispatch
+/// along with the features they need, and the dispatcher picks the
+/// best one the CPU supports.
+///
+/// vw_settings().simd_isa() caps the features the dispatchers may
+/// use, so that results can be reproduced across machines or a slower
+/// kernel tested on a fast one.  It does not affect code compiled for
+/// the baseline, such as the SSE2 paths on x86-64.
+///
+#ifndef __VW_CORE_CPUFEATURES_H__
+#define __VW_CORE_CPUFEATURES_H__
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <vw/Core/FundamentalTypes.h>
+
+namespace vw {
+
+  /// CPU features that SIMD kernels may need, as bit flags.
+  enum CpuFeature {
+    CPU_SSE2            = 1 << 0,
+    CPU_POPCNT          = 1 << 1,
+    CPU_AVX2            = 1 << 2,
+    CPU_AVX512F         = 1 << 3,
+    CPU_AVX512BW        = 1 << 4,
+    CPU_AVX512VPOPCNTDQ = 1 << 5,
+    CPU_NEON            = 1 << 6
+  };
+
+  /// The features this CPU supports, whatever the settings say.
+  uint32 cpu_detected_features();
+
+  /// The features kernels may use: those detected, limited to the
+  /// instruction set named by vw_settings().simd_isa().  This is cheap
+  /// enough to call for each dispatch.
+  uint32 cpu_features();
+
+  /// Whether kernels may use all of the given features.
+  inline bool cpu_has( uint32 features ) { return (cpu_features() & features) == features; }
+
+  /// The features an instruction set name allows:
+  /// - "auto"   : everything the CPU has.
+  /// - "scalar" : nothing, only the portable kernels.
+  /// - "sse2", "sse4", "avx2", "avx512" : the x86 levels, each one
+  ///   including those before it.  "sse4" adds POPCNT.
+  /// - "neon"   : ARM NEON.
+  /// Throws ArgumentErr for any other name.
+  uint32 simd_isa_features( std::string const& isa );
+
+  /// The names of the features, for logging, such as "sse2 popcnt avx2".
+  std::string cpu_feature_names( uint32 features );
+
+  /// \cond INTERNAL
+  namespace detail {
+    /// Called when vw_settings().simd_isa() is set, with the
+    /// features it allows.
+    void set_allowed_cpu_features( uint32 features );
+  }
+  /// \endcond
+
+  /// A set of versions of one kernel, each needing some CPU features,
+  /// and a portable fallback.  Build one once, in a function static
+  /// for instance, and call select() to get the kernel to run:
+  ///
+  ///   CpuDispatch<Func> dispatch( &kernel_generic );
+  ///   dispatch.add( CPU_AVX2, &kernel_avx2 ).add( CPU_SSE2, &kernel_sse2 );
+  ///   dispatch.select()( ... );
+  template <class FuncT>
+  class CpuDispatch {
+    std::vector<std::pair<uint32, FuncT> > m_kernels;
+    FuncT m_fallback;
+  public:
+    explicit CpuDispatch( FuncT fallback ) : m_fallback(fallback) {}
+
+    /// Adds a kernel which needs all of the given features.  Add the
+    /// preferred kernels first.
+    CpuDispatch& add( uint32 features, FuncT kernel ) {
+      m_kernels.push_back( std::make_pair( features, kernel ) );
+      return *this;
+    }
+
+    /// The first kernel added whose features are all available, or
+    /// the fallback if there is none.
+    FuncT select( uint32 available ) const {
+      for ( size_t i = 0; i < m_kernels.size(); ++i )
+        if ( (available & m_kernels[i].first) == m_kernels[i].first )
+          return m_kernels[i].second;
+      return m_fallback;
+    }
+    FuncT select() const { return select( cpu_features() ); }
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_CPUFEATURES_H__
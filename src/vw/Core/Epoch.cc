@@ -0,0 +1,182 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <vw/Core/Epoch.h>
+#include <vw/Core/Thread.h>
+
+#include <atomic>
+#include <limits>
+#include <vector>
+
+// Each thread which holds a guard has a record with the epoch it was
+// pinned at, or 0.  epoch_retire() tags an object with the epoch at the
+// time, then moves the epoch on.  A reader pinned at a later epoch read
+// the epoch after the object was replaced, so it cannot have loaded it;
+// once no record is pinned at the tag or earlier the object is freed.
+//
+// The reader's store to its record and its loads of the shared pointer
+// are separated by a seq_cst fence, and the writer's replacement and scan
+// are seq_cst, so either the scan sees the reader pinned, or the reader
+// loads the replacement.
+
+namespace vw {
+namespace detail {
+
+  // Each record has a cache line of its own, since its owner writes to
+  // it on every read.
+  struct alignas(64) EpochRecord {
+    std::atomic<uint64> epoch;  ///< The epoch the thread is pinned at, or 0
+    uint32 depth;               ///< Nesting of guards, only used by the owner
+    std::atomic<bool> in_use;   ///< Whether a thread owns the record
+    EpochRecord *next;
+
+    EpochRecord() : epoch(0), depth(0), in_use(true), next(0) {}
+  };
+
+}} // namespace vw::detail
+
+namespace {
+
+  using vw::detail::EpochRecord;
+
+  // Starts at 1, since 0 marks a record which is not pinned.
+  std::atomic<vw::uint64> g_epoch(1);
+
+  // Every record made, newest first.  Records are reused by later
+  // threads but never freed, so a scan may walk the list at any time.
+  std::atomic<EpochRecord*> g_records(0);
+
+  thread_local EpochRecord *t_record = 0;
+
+  struct Retired {
+    void const* object;
+    void (*deleter)(void const*);
+    vw::uint64 epoch;
+  };
+
+  struct RetireList {
+    vw::Mutex mutex;
+    std::vector<Retired> objects;
+  };
+
+  // Construct on first use and never destroy, so that threads still
+  // running during static destruction may retire objects.
+  RetireList& retire_list() {
+    static RetireList* list = new RetireList();
+    return *list;
+  }
+
+  // Hands the thread's record back when the thread exits.
+  struct RecordReleaser {
+    EpochRecord *record;
+    RecordReleaser( EpochRecord *r ) : record(r) {}
+    ~RecordReleaser() {
+      t_record = 0;
+      record->in_use.store( false, std::memory_order_release );
+    }
+  };
+
+  EpochRecord* register_thread() {
+    EpochRecord *record = 0;
+    for ( EpochRecord *r = g_records.load( std::memory_order_acquire ); r && !record; r = r->next ) {
+      bool expected = false;
+      if ( !r->in_use.load( std::memory_order_relaxed ) &&
+           r->in_use.compare_exchange_strong( expected, true, std::memory_order_acquire ) )
+        record = r;
+    }
+    if ( !record ) {
+      record = new EpochRecord();
+      EpochRecord *head = g_records.load( std::memory_order_relaxed );
+      do {
+        record->next = head;
+      } while ( !g_records.compare_exchange_weak( head, record, std::memory_order_release,
+                                                  std::memory_order_relaxed ) );
+    }
+    static thread_local RecordReleaser releaser( record );
+    t_record = record;
+    return record;
+  }
+
+  // The oldest epoch any thread is pinned at, or the largest value if
+  // none is.
+  vw::uint64 oldest_pinned_epoch() {
+    vw::uint64 oldest = std::numeric_limits<vw::uint64>::max();
+    for ( EpochRecord *r = g_records.load( std::memory_order_acquire ); r; r = r->next ) {
+      vw::uint64 epoch = r->epoch.load( std::memory_order_seq_cst );
+      if ( epoch != 0 && epoch < oldest )
+        oldest = epoch;
+    }
+    return oldest;
+  }
+
+  // Take the objects which may be freed out of the list.  Call with the
+  // list mutex held, and free them after it is released.
+  void collect_reclaimable( RetireList& list, std::vector<Retired>& reclaimable ) {
+    vw::uint64 oldest = oldest_pinned_epoch();
+    size_t keep = 0;
+    for ( size_t i = 0; i < list.objects.size(); ++i ) {
+      if ( list.objects[i].epoch < oldest )
+        reclaimable.push_back( list.objects[i] );
+      else
+        list.objects[keep++] = list.objects[i];
+    }
+    list.objects.resize( keep );
+  }
+
+  void free_retired( std::vector<Retired> const& reclaimable ) {
+    for ( size_t i = 0; i < reclaimable.size(); ++i )
+      reclaimable[i].deleter( reclaimable[i].object );
+  }
+
+} // namespace
+
+vw::EpochGuard::EpochGuard() : m_record( t_record ? t_record : register_thread() ) {
+  if ( m_record->depth++ == 0 ) {
+    m_record->epoch.store( g_epoch.load( std::memory_order_seq_cst ), std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+  }
+}
+
+vw::EpochGuard::~EpochGuard() {
+  if ( --m_record->depth == 0 )
+    m_record->epoch.store( 0, std::memory_order_release );
+}
+
+void vw::epoch_retire( void const* object, void (*deleter)(void const*) ) {
+  Retired retired = { object, deleter, g_epoch.fetch_add( 1, std::memory_order_seq_cst ) };
+  RetireList& list = retire_list();
+  std::vector<Retired> reclaimable;
+  {
+    Mutex::Lock lock( list.mutex );
+    list.objects.push_back( retired );
+    collect_reclaimable( list, reclaimable );
+  }
+  free_retired( reclaimable );
+}
+
+size_t vw::epoch_reclaim() {
+  RetireList& list = retire_list();
+  std::vector<Retired> reclaimable;
+  size_t waiting;
+  {
+    Mutex::Lock lock( list.mutex );
+    collect_reclaimable( list, reclaimable );
+    waiting = list.objects.size();
+  }
+  free_retired( reclaimable );
+  return waiting;
+}
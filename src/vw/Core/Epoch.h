@@ -0,0 +1,79 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/Epoch.h
+///
+/// Epoch based reclamation, for data which is read without a lock
+/// through an atomic pointer and replaced, not changed, by writers.
+///
+/// A reader holds an EpochGuard while it uses what it loaded from the
+/// pointer.  A writer stores the replacement and passes the old object
+/// to epoch_retire(), which frees it once every guard that might have
+/// loaded it is gone.  Holding a guard takes no lock and writes only
+/// to memory of the calling thread; epoch_retire() never waits for
+/// readers, it leaves anything still in use to a later call.
+///
+///   EpochGuard guard;
+///   Data const* data = m_data.load( std::memory_order_acquire );
+///   ... read *data ...
+///
+///   Data const* old = m_data.exchange( next );  // Writers serialized by the caller
+///   epoch_retire( old );
+
+#ifndef __VW_CORE_EPOCH_H__
+#define __VW_CORE_EPOCH_H__
+
+#include <vw/Core/FundamentalTypes.h>
+
+#include <boost/noncopyable.hpp>
+
+namespace vw {
+
+  namespace detail {
+    struct EpochRecord;
+
+    template <class T>
+    void epoch_delete( void const* object ) { delete static_cast<T const*>( object ); }
+  }
+
+  /// While a guard lives, nothing retired after it was made is freed.
+  /// Guards may be nested on a thread.
+  class EpochGuard : private boost::noncopyable {
+    detail::EpochRecord *m_record;
+  public:
+    EpochGuard();
+    ~EpochGuard();
+  };
+
+  /// Free object with deleter once no guard can still be reading it.
+  /// The object must already be unreachable from the shared pointer.
+  void epoch_retire( void const* object, void (*deleter)(void const*) );
+
+  template <class T>
+  inline void epoch_retire( T const* object ) {
+    if ( object )
+      epoch_retire( object, &detail::epoch_delete<T> );
+  }
+
+  /// Free whatever retired objects no guard can still be reading.
+  /// - Returns the number of retired objects still waiting.
+  size_t epoch_reclaim();
+
+} // namespace vw
+
+#endif // __VW_CORE_EPOCH_H__
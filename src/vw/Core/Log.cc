@@ -24,7 +24,9 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <atomic>
 #include <ctime>
+#include <set>
 #include <vector>
 
 #include <boost/algorithm/string/case_conv.hpp>
@@ -51,6 +53,85 @@ current_posix_time_string()
 
 namespace {
   static vw::null_ostream g_null_ostream;
+
+  // Bumped whenever a rule set or the logs of a Log change, which
+  // invalidates the answers Log::is_enabled() has cached.
+  std::atomic<vw::uint64> g_log_generation(0);
+
+  // One thread's answers from Log::is_enabled(), by namespace and level.
+  struct LogDecisionCache {
+    const vw::Log* log;
+    vw::uint64     generation;
+    std::map<std::string, std::map<int, bool> > decisions;
+    LogDecisionCache() : log(NULL), generation(0) {}
+  };
+}
+
+void vw::LogRuleSet::rules_changed() {
+  ++g_log_generation;
+}
+
+// ---------------------------------------------------
+// AsyncLogWriter Methods
+// ---------------------------------------------------
+vw::AsyncLogWriter::AsyncLogWriter(size_t max_lines) : m_max_lines(max_lines), m_writing(false), m_stop(false) {
+  VW_ASSERT(max_lines > 0, ArgumentErr() << "AsyncLogWriter: The queue must hold at least one line.");
+  m_thread.reset(new Thread(Worker(this)));
+}
+
+vw::AsyncLogWriter::~AsyncLogWriter() {
+  {
+    Mutex::Lock lock(m_mutex);
+    m_stop = true;
+    m_queued.notify_all();
+  }
+  m_thread->join();
+}
+
+void vw::AsyncLogWriter::write(std::streambuf* out, const char* text, size_t size) {
+  Mutex::Lock lock(m_mutex);
+  while (m_lines.size() >= m_max_lines)
+    m_written.wait(lock);
+  m_lines.push_back(Line());
+  m_lines.back().out = out;
+  m_lines.back().text.assign(text, size);
+  m_queued.notify_one();
+}
+
+void vw::AsyncLogWriter::flush() {
+  Mutex::Lock lock(m_mutex);
+  while (!m_lines.empty() || m_writing)
+    m_written.wait(lock);
+}
+
+void vw::AsyncLogWriter::run() {
+  std::deque<Line> batch;
+  Mutex::Lock lock(m_mutex);
+  while (true) {
+    while (m_lines.empty() && !m_stop)
+      m_queued.wait(lock);
+    // The queue is drained before stopping.
+    if (m_lines.empty())
+      return;
+
+    batch.swap(m_lines);
+    m_writing = true;
+    lock.unlock();
+
+    // Each stream is synced once per batch rather than once per line.
+    std::set<std::streambuf*> written;
+    for (size_t i = 0; i < batch.size(); ++i) {
+      batch[i].out->sputn(batch[i].text.data(), boost::numeric_cast<std::streamsize>(batch[i].text.size()));
+      written.insert(batch[i].out);
+    }
+    for (std::set<std::streambuf*>::iterator it = written.begin(); it != written.end(); ++it)
+      (*it)->pubsync();
+    batch.clear();
+
+    lock.lock();
+    m_writing = false;
+    m_written.notify_all();
+  }
 }
 
 // ---------------------------------------------------
@@ -129,24 +210,39 @@ std::ostream& vw::Log::operator() (int log_level, std::string const& log_namespa
   }
 }
 
+vw::Log::Log() : m_console_log(new LogInstance(std::cout, false)) {
+  // A new Log may reuse the address of one the caches remember.
+  LogRuleSet::rules_changed();
+}
+
+vw::Log::~Log() {
+  // Write out what is queued while the streams are still alive.
+  flush();
+}
+
 void
 vw::Log::add(std::ostream &stream, LogRuleSet rule_set, bool prepend_infostamp) {
   Mutex::Lock lock(m_system_log_mutex);
   boost::shared_ptr<LogInstance> li(new LogInstance(stream, prepend_infostamp));
   li->rule_set() = rule_set;
+  li->set_writer(m_writer);
   m_logs.push_back(li);
+  LogRuleSet::rules_changed();
 }
 
 void
 vw::Log::add(boost::shared_ptr<LogInstance> log) {
   Mutex::Lock lock(m_system_log_mutex);
+  log->set_writer(m_writer);
   m_logs.push_back( log );
+  LogRuleSet::rules_changed();
 }
 
 void
 vw::Log::clear() {
   Mutex::Lock lock(m_system_log_mutex);
   m_logs.clear();
+  LogRuleSet::rules_changed();
 }
 
 vw::LogInstance&
@@ -160,10 +256,69 @@ vw::Log::set_console_stream(std::ostream& stream, LogRuleSet rule_set, bool prep
   Mutex::Lock lock(m_system_log_mutex);
   m_console_log = boost::shared_ptr<LogInstance>(new LogInstance(stream, prepend_infostamp) );
   m_console_log->rule_set() = rule_set;
+  m_console_log->set_writer(m_writer);
+  LogRuleSet::rules_changed();
+}
+
+void
+vw::Log::set_asynchronous(bool asynchronous) {
+  Mutex::Lock lock(m_system_log_mutex);
+  if (asynchronous == bool(m_writer))
+    return;
+  if (asynchronous)
+    m_writer.reset(new AsyncLogWriter());
+  else
+    m_writer.reset();
+
+  // Turning it off flushes the old writer as each instance lets go of
+  // it, and the last one stops its thread.
+  m_console_log->set_writer(m_writer);
+  for (size_t i = 0; i < m_logs.size(); ++i)
+    m_logs[i]->set_writer(m_writer);
+}
+
+bool
+vw::Log::asynchronous() {
+  Mutex::Lock lock(m_system_log_mutex);
+  return bool(m_writer);
+}
+
+void
+vw::Log::flush() {
+  boost::shared_ptr<AsyncLogWriter> writer;
+  {
+    Mutex::Lock lock(m_system_log_mutex);
+    writer = m_writer;
+  }
+  if (writer)
+    writer->flush();
 }
 
 bool vw::Log::is_enabled( int log_level,
                           std::string const& log_namespace ) {
+  static thread_local LogDecisionCache cache;
+
+  // Read the generation first, so that a change made while the rules
+  // are checked below discards the answer on the next call.
+  uint64 generation = g_log_generation.load();
+  if (cache.log != this || cache.generation != generation) {
+    cache.decisions.clear();
+    cache.log = this;
+    cache.generation = generation;
+  }
+
+  std::map<int, bool>& levels = cache.decisions[log_namespace];
+  std::map<int, bool>::const_iterator it = levels.find(log_level);
+  if (it != levels.end())
+    return it->second;
+
+  bool enabled = check_enabled(log_level, log_namespace);
+  levels[log_level] = enabled;
+  return enabled;
+}
+
+bool vw::Log::check_enabled( int log_level,
+                             std::string const& log_namespace ) {
   // Early exit option before iterating through m_logs
   if ( m_console_log->rule_set()(log_level, log_namespace) )
     return true;
@@ -179,7 +334,11 @@ vw::LogRuleSet::LogRuleSet( LogRuleSet const& copy_log) {
 }
 
 vw::LogRuleSet& vw::LogRuleSet::operator=( LogRuleSet const& copy_log) {
-  m_rules = copy_log.m_rules;
+  {
+    Mutex::Lock lock(m_mutex);
+    m_rules = copy_log.m_rules;
+  }
+  rules_changed();
   return *this;
 }
 
@@ -198,13 +357,19 @@ void vw::LogRuleSet::add_rule(int log_level, std::string const& log_namespace) {
       && *(log_namespace.end()-1) != '*')
     vw::vw_throw(vw::ArgumentErr() << "Illegal log rule: wildcards must be at the beginning or end of a rule");
 
-  Mutex::Lock lock(m_mutex);
-  m_rules.push_front(rule_type(log_level, boost::to_lower_copy(log_namespace)));
+  {
+    Mutex::Lock lock(m_mutex);
+    m_rules.push_front(rule_type(log_level, boost::to_lower_copy(log_namespace)));
+  }
+  rules_changed();
 }
 
 void vw::LogRuleSet::clear() {
-  Mutex::Lock lock(m_mutex);
-  m_rules.clear();
+  {
+    Mutex::Lock lock(m_mutex);
+    m_rules.clear();
+  }
+  rules_changed();
 }
 
 namespace {
@@ -30,19 +30,28 @@
 /// - A new line in the logfile starts every time a newline character
 ///   appears at the end of a string of characters, or when you
 ///   exlicitly add std::flush() to the stream of operators.
+///
+/// - With Log::set_asynchronous() (or "general.async_log" in ~/.vwrc)
+///   finished lines are handed to a background thread, which writes
+///   them out, so a thread which logs never waits on the console or a
+///   log file.  Call Log::flush() to wait for them, e.g. before
+///   abort().
 
 #ifndef __VW_CORE_LOG_H__
 #define __VW_CORE_LOG_H__
 
 #include <vw/Core/Features.h>
+#include <vw/Core/Condition.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/System.h>
 
 // Boost Headers
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/shared_ptr.hpp>
 
 // STD Headers
 #include <string>
+#include <deque>
 #include <list>
 #include <vector>
 #include <map>
@@ -190,6 +199,45 @@ namespace vw {
   typedef MultiOutputStream<char> multi_ostream;
 
 
+  /// Writes finished log lines to their streams on a background
+  /// thread.  The queue holds at most max_lines lines; a thread which
+  /// logs faster than the streams take them waits for room rather than
+  /// letting the queue grow without end.
+  class AsyncLogWriter : private boost::noncopyable {
+    struct Line {
+      std::streambuf* out;
+      std::string     text;
+    };
+    struct Worker {
+      AsyncLogWriter* m_writer;
+      Worker(AsyncLogWriter* writer) : m_writer(writer) {}
+      void operator()() { m_writer->run(); }
+    };
+
+    std::deque<Line> m_lines;
+    size_t    m_max_lines;
+    bool      m_writing, m_stop;
+    Mutex     m_mutex;
+    Condition m_queued;   ///< Notified when a line is queued or on stop
+    Condition m_written;  ///< Notified when a batch of lines is written
+    boost::shared_ptr<Thread> m_thread;
+
+    void run();
+
+  public:
+    AsyncLogWriter(size_t max_lines = 1 << 16);
+    /// Writes out the lines still queued before returning.
+    ~AsyncLogWriter();
+
+    /// Queues a line for out.  The stream must outlive the line, which
+    /// flush() ensures.
+    void write(std::streambuf* out, const char* text, size_t size);
+
+    /// Waits until every line queued so far has been written and the
+    /// streams synced.
+    void flush();
+  };
+
   // In order to create our own C++ streams compatible ostream object,
   // we must first define a subclass of basic_streambuf<>, which
   // handles stream output on a character by character basis.  This is
@@ -213,6 +261,7 @@ namespace vw {
     lookup_table_type m_buffers;
 
     std::basic_streambuf<CharT, traits>* m_out;
+    boost::shared_ptr<AsyncLogWriter> m_writer;
     Mutex m_mutex;
 
     // This method is called when a single character is fed to the
@@ -255,8 +304,12 @@ namespace vw {
     // You must call this with the lock already held!
     int locked_sync(buffer_type& buffer) {
       if(!buffer.empty() && m_out ) {
-        m_out->sputn(&buffer[0], boost::numeric_cast<std::streamsize>(buffer.size()));
-        m_out->pubsync();
+        if (m_writer)
+          m_writer->write(m_out, &buffer[0], buffer.size());
+        else {
+          m_out->sputn(&buffer[0], boost::numeric_cast<std::streamsize>(buffer.size()));
+          m_out->pubsync();
+        }
         buffer.clear();
       }
       return 0;
@@ -271,9 +324,30 @@ namespace vw {
 
   public:
     PerThreadBufferedStreamBuf() : m_buffers(), m_out(NULL) {}
-    ~PerThreadBufferedStreamBuf() { sync(); }
+    ~PerThreadBufferedStreamBuf() {
+      sync();
+      if (m_writer)
+        m_writer->flush();
+    }
+
+    // Lines already queued for the old stream are written before it
+    // is let go.
+    void init(std::basic_streambuf<CharT,traits>* out) {
+      Mutex::Lock lock(m_mutex);
+      if (m_writer)
+        m_writer->flush();
+      m_out = out;
+    }
 
-    void init(std::basic_streambuf<CharT,traits>* out) { m_out = out; }
+    /// Hand finished lines to writer, or write them on the logging
+    /// thread if it is null.  Lines queued on the old writer are
+    /// written first, so that none are reordered.
+    void set_writer(boost::shared_ptr<AsyncLogWriter> writer) {
+      Mutex::Lock lock(m_mutex);
+      if (m_writer)
+        m_writer->flush();
+      m_writer = writer;
+    }
   };
 
   // The order with which the base classes are initialized in
@@ -319,6 +393,10 @@ namespace vw {
       PerThreadBufferedStreamBufInit<CharT,traits>::buf()->init(out.rdbuf());
     }
 
+    void set_writer(boost::shared_ptr<AsyncLogWriter> writer) {
+      PerThreadBufferedStreamBufInit<CharT,traits>::buf()->set_writer(writer);
+    }
+
   };
 
   /// \endcond
@@ -360,6 +438,11 @@ namespace vw {
     // You can overload this method from a subclass to change the
     // behavior of the LogRuleSet.
     virtual bool operator() (int log_level, std::string const& log_namespace);
+
+    /// Log::is_enabled() remembers its answers on each thread until a
+    /// rule set or log changes.  A subclass whose operator() can change
+    /// its answer by other means must call this when it does.
+    static void rules_changed();
   };
 
 
@@ -397,6 +480,10 @@ namespace vw {
 
     /// Access the rule set for this log object.
     LogRuleSet& rule_set() { return m_rule_set; }
+
+    /// Hand finished lines to writer, or write them on the logging
+    /// thread if it is null.  The Log sets this.
+    void set_writer(boost::shared_ptr<AsyncLogWriter> writer) { m_log_stream.set_writer(writer); }
   };
 
 
@@ -435,13 +522,20 @@ namespace vw {
     // it can be safely de-allocated.
     std::map<vw::uint64, boost::shared_ptr<multi_ostream> > m_multi_ostreams;
 
+    // Set when logging is asynchronous; shared by every log instance.
+    boost::shared_ptr<AsyncLogWriter> m_writer;
+
+    // is_enabled() without the per-thread cache of its answers.
+    bool check_enabled( int log_level, std::string const& log_namespace );
+
   public:
 
     /// You should probably not create an instance of Log on your own
     /// using this constructor.  Instead, you can access a global
     /// instance of the log class using the static Log::system_log()
     /// method below.
-    Log() : m_console_log(new LogInstance(std::cout, false)) { }
+    Log();
+    ~Log();
 
     /// The call operator returns a subclass of the basic_ostream
     /// object, which is suitable for use with the C++ << operator.
@@ -469,13 +563,24 @@ namespace vw {
     /// a file, for example.
     void set_console_stream(std::ostream& stream, LogRuleSet rule_set = LogRuleSet(), bool prepend_infostamp = true);
 
-    /// A mostly non-locking check to determine if this Log object has any
+    /// A non-locking check to determine if this Log object has any
     /// stream that is open for a requested log level and namespace.
     ///
-    /// LogRuleSets still lock on access of their operator().
-    /// We're also using shared_ptr, which lock on access.
+    /// Each thread remembers the answers until a rule set or the set of
+    /// logs changes, so only the first check of a level and namespace
+    /// takes the LogRuleSet locks.
     bool is_enabled( int log_level = vw::InfoMessage,
                      std::string const& log_namespace="console" );
+
+    /// Write finished lines on a background thread rather than on the
+    /// thread which logs them.  Turning it off writes out the lines
+    /// still queued.
+    void set_asynchronous( bool asynchronous );
+    bool asynchronous();
+
+    /// Waits until every finished line logged so far has been written.
+    /// Does nothing if logging is not asynchronous.
+    void flush();
   };
 
   /// The vision workbench logging operator.  Use this to generate a
@@ -0,0 +1,151 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <vw/Core/MemoryGovernor.h>
+
+#include <algorithm>
+
+namespace {
+  // How long a blocked reserve() waits before asking the others to shrink
+  // again.  Cache lines which were in use may have been released since.
+  const unsigned long RESERVE_RETRY_MS = 50;
+}
+
+vw::MemoryGovernor::MemoryGovernor( size_t budget )
+  : m_budget(budget), m_used(0), m_waiting(0) {}
+
+void vw::MemoryGovernor::set_budget( size_t bytes ) {
+  m_budget = bytes;
+  Mutex::Lock lock(m_mutex);
+  m_released.notify_all();
+}
+
+std::vector<vw::MemoryGovernor::Usage> vw::MemoryGovernor::usage() {
+  Mutex::Lock lock(m_accounts_mutex);
+  std::vector<Usage> result;
+  for (size_t i = 0; i < m_accounts.size(); ++i) {
+    Usage u;
+    u.name = m_accounts[i]->name();
+    u.used = m_accounts[i]->used();
+    u.peak = m_accounts[i]->peak();
+    result.push_back(u);
+  }
+  return result;
+}
+
+bool vw::MemoryGovernor::fits( size_t bytes ) const {
+  size_t budget = m_budget;
+  return budget == 0 || m_used + bytes <= budget;
+}
+
+void vw::MemoryGovernor::shrink_others( Account const* requester ) {
+  // Accounts unregister under this mutex, so none of them can go away
+  // while it is shrinking.
+  Mutex::Lock lock(m_accounts_mutex);
+  for (size_t i = 0; i < m_accounts.size(); ++i)
+    if (m_accounts[i] != requester)
+      m_accounts[i]->shrink();
+}
+
+void vw::MemoryGovernor::notify_released() {
+  // Only take the mutex if somebody may be waiting.  A waiter adds itself
+  // to m_waiting before it checks whether its bytes fit.
+  if (m_waiting == 0)
+    return;
+  Mutex::Lock lock(m_mutex);
+  m_released.notify_all();
+}
+
+//----------------------------------------------------
+// MemoryGovernor::Account
+
+vw::MemoryGovernor::Account::Account( MemoryGovernor& governor, std::string const& name )
+  : m_governor(governor), m_name(name), m_used(0), m_peak(0) {
+  Mutex::Lock lock(m_governor.m_accounts_mutex);
+  m_governor.m_accounts.push_back(this);
+}
+
+vw::MemoryGovernor::Account::~Account() {
+  detach();
+  if (m_used)
+    release(m_used);
+}
+
+void vw::MemoryGovernor::Account::detach() {
+  Mutex::Lock lock(m_governor.m_accounts_mutex);
+  std::vector<Account*>& accounts = m_governor.m_accounts;
+  accounts.erase(std::remove(accounts.begin(), accounts.end(), this), accounts.end());
+}
+
+void vw::MemoryGovernor::Account::add( size_t bytes ) {
+  size_t now  = m_used += bytes;
+  m_governor.m_used += bytes;
+  size_t peak = m_peak;
+  while (now > peak && !m_peak.compare_exchange_weak(peak, now)) {}
+}
+
+void vw::MemoryGovernor::Account::charge( size_t bytes ) {
+  add(bytes);
+}
+
+void vw::MemoryGovernor::Account::release( size_t bytes ) {
+  m_used -= bytes;
+  m_governor.m_used -= bytes;
+  m_governor.notify_released();
+}
+
+bool vw::MemoryGovernor::Account::try_reserve( size_t bytes ) {
+  {
+    Mutex::Lock lock(m_governor.m_mutex);
+    if (m_governor.fits(bytes)) {
+      add(bytes);
+      return true;
+    }
+  }
+  // Count the request as waiting while the others shrink, so that they
+  // can see how much is missing.
+  m_governor.m_waiting += bytes;
+  m_governor.shrink_others(this);
+  m_governor.m_waiting -= bytes;
+  Mutex::Lock lock(m_governor.m_mutex);
+  if (m_governor.fits(bytes)) {
+    add(bytes);
+    return true;
+  }
+  return false;
+}
+
+void vw::MemoryGovernor::Account::reserve( size_t bytes ) {
+  if (try_reserve(bytes))
+    return;
+
+  // While we wait, over_budget() is true so the Cache keeps evicting.
+  m_governor.m_waiting += bytes;
+  while (true) {
+    {
+      Mutex::Lock lock(m_governor.m_mutex);
+      if (!m_governor.fits(bytes) && m_used != 0)
+        m_governor.m_released.timed_wait(lock, RESERVE_RETRY_MS);
+      if (m_governor.fits(bytes) || m_used == 0) {
+        m_governor.m_waiting -= bytes;
+        add(bytes);
+        return;
+      }
+    }
+    m_governor.shrink_others(this);
+  }
+}
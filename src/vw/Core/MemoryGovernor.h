@@ -0,0 +1,141 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/MemoryGovernor.h
+///
+/// A process wide memory budget.  The system cache, SGM and the block
+/// writers each allocate large amounts of memory on their own terms, so
+/// together they can easily exceed what the machine has.  Each of them
+/// opens an Account with the governor and counts the bytes it holds
+/// against one shared budget:
+///
+/// - reserve() blocks until the bytes fit.  This is meant for memory
+///   which will be released again soon, such as tiles waiting to be
+///   written.
+/// - try_reserve() returns false instead, so the caller can shrink its
+///   request, as SGM does by searching a smaller disparity range.
+/// - charge() always succeeds.  It is meant for consumers which can give
+///   memory back later, such as the Cache.
+///
+/// When a reservation does not fit, every other account is asked to
+/// shrink() first.  The Cache responds by evicting lines, and keeps
+/// evicting on its own allocations for as long as the governor is over
+/// budget.  A budget of zero means there is no limit, which is the
+/// default; see the memory_budget setting.
+///
+#ifndef __VW_CORE_MEMORYGOVERNOR_H__
+#define __VW_CORE_MEMORYGOVERNOR_H__
+
+#include <vw/Core/Condition.h>
+#include <vw/Core/Thread.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace vw {
+
+  class MemoryGovernor : private boost::noncopyable {
+  public:
+
+    /// The bytes held by one consumer.  Whatever is still held when the
+    /// account is destroyed is released.
+    class Account : private boost::noncopyable {
+      MemoryGovernor&     m_governor;
+      std::string         m_name;
+      std::atomic<size_t> m_used, m_peak;
+
+      friend class MemoryGovernor;
+      void add( size_t bytes );
+
+    public:
+      Account( MemoryGovernor& governor, std::string const& name );
+      virtual ~Account();
+
+      /// Wait until the bytes fit in the budget.  An account which
+      /// holds nothing is always let through, so that a request larger
+      /// than the whole budget can still make progress.
+      void reserve( size_t bytes );
+
+      /// Reserve the bytes only if they fit in the budget.
+      bool try_reserve( size_t bytes );
+
+      /// Count the bytes even if that goes over the budget.
+      void charge( size_t bytes );
+
+      void release( size_t bytes );
+
+      std::string const& name() const { return m_name; }
+      size_t used() const { return m_used; }
+      size_t peak() const { return m_peak; }
+      MemoryGovernor& governor() const { return m_governor; }
+
+    protected:
+      /// Called when another account is waiting for memory.  Free what
+      /// can be freed without blocking, and don't reserve() from here.
+      /// The default does nothing.
+      virtual void shrink() {}
+
+      /// Stop receiving shrink() calls.  Subclasses which override
+      /// shrink() must call this first thing in their destructor.
+      void detach();
+    };
+
+    /// What one account holds, see usage().
+    struct Usage {
+      std::string name;
+      size_t      used, peak;
+    };
+
+    MemoryGovernor( size_t budget = 0 );
+
+    /// Set the budget in bytes, zero for no limit.
+    void   set_budget( size_t bytes );
+    size_t budget() const { return m_budget; }
+
+    /// Bytes held by all the accounts together.
+    size_t used() const { return m_used; }
+
+    /// True while the accounts hold, or are waiting for, more than the budget.
+    bool over_budget() const {
+      size_t budget = m_budget;
+      return budget != 0 && m_used + m_waiting > budget;
+    }
+
+    /// The usage of every account, in the order they were opened.
+    std::vector<Usage> usage();
+
+  private:
+    std::atomic<size_t> m_budget, m_used, m_waiting;
+    Mutex               m_mutex;    ///< Serializes the reservations
+    Condition           m_released; ///< Notified when memory is released or the budget grows
+    Mutex               m_accounts_mutex;
+    std::vector<Account*> m_accounts;
+
+    /// True if bytes more can be reserved, call with m_mutex held.
+    bool fits( size_t bytes ) const;
+
+    /// Ask every account except the given one to shrink.
+    void shrink_others( Account const* requester );
+
+    void notify_released();
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_MEMORYGOVERNOR_H__
@@ -0,0 +1,116 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Numa.h>
+#include <vw/Core/Log.h>
+
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace {
+  const char* NODE_DIR = "/sys/devices/system/node";
+}
+
+std::vector<int> vw::numa_parse_cpulist( std::string const& list ) {
+  std::vector<int> cpus;
+  std::istringstream in(list);
+  std::string range;
+  while (std::getline(in, range, ',')) {
+    if (range.empty() || range[0] < '0' || range[0] > '9')
+      continue;
+    size_t dash = range.find('-');
+    int first = atoi(range.c_str());
+    int last  = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+namespace {
+  std::string read_line( std::string const& path ) {
+    std::ifstream file(path.c_str());
+    std::string line;
+    if (file)
+      std::getline(file, line);
+    return line;
+  }
+
+  // The system ids of the nodes which have CPUs.  Memory-only nodes are left out.
+  std::vector<int> const& node_ids() {
+    static const std::vector<int> ids = vw::numa_parse_cpulist(read_line(std::string(NODE_DIR) + "/has_cpu"));
+    return ids;
+  }
+}
+
+std::vector<int> vw::numa_node_cpus( int node ) {
+  std::vector<int> const& ids = node_ids();
+  if (ids.empty()) // No NUMA information, every CPU is on node zero.
+    return std::vector<int>();
+  if (node < 0 || node >= int(ids.size()))
+    return std::vector<int>();
+  std::ostringstream path;
+  path << NODE_DIR << "/node" << ids[node] << "/cpulist";
+  return numa_parse_cpulist(read_line(path.str()));
+}
+
+int vw::numa_num_nodes() {
+  return node_ids().empty() ? 1 : int(node_ids().size());
+}
+
+int vw::numa_node_for_worker( int worker_id, int num_workers, int num_nodes ) {
+  if (num_workers < 1 || num_nodes < 2)
+    return 0;
+  return int( (long long)(worker_id % num_workers) * num_nodes / num_workers );
+}
+
+void vw::numa_workers_for_node( int node, int num_workers, int num_nodes, int& begin, int& end ) {
+  if (num_nodes < 2) {
+    begin = 0;
+    end   = num_workers;
+    return;
+  }
+  // The inverse of numa_node_for_worker(): the smallest id mapping to each node.
+  begin = int( ((long long)node * num_workers + num_nodes - 1) / num_nodes );
+  end   = int( ((long long)(node+1) * num_workers + num_nodes - 1) / num_nodes );
+}
+
+bool vw::numa_pin_current_thread( int node ) {
+#ifdef __linux__
+  std::vector<int> cpus = numa_node_cpus(node);
+  if (cpus.empty())
+    return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t i = 0; i < cpus.size(); ++i)
+    if (cpus[i] < CPU_SETSIZE)
+      CPU_SET(cpus[i], &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    VW_OUT(DebugMessage, "thread") << "Failed to pin thread to NUMA node " << node << "\n";
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
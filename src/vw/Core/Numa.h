@@ -0,0 +1,64 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/Numa.h
+///
+/// Helpers for running worker threads close to their memory on
+/// machines with several NUMA nodes.  When vw_settings().numa_aware()
+/// is set, WorkQueue workers pin themselves to the CPUs of one node,
+/// spreading the workers evenly over the nodes.  Since image tiles are
+/// allocated and filled by the worker which rasterizes them, the
+/// kernel's first-touch policy then places each tile's buffer on that
+/// worker's node.
+///
+/// Node discovery uses /sys/devices/system/node and pinning uses
+/// sched_setaffinity, so on other platforms there is a single node and
+/// pinning does nothing.
+///
+#ifndef __VW_CORE_NUMA_H__
+#define __VW_CORE_NUMA_H__
+
+#include <string>
+#include <vector>
+
+namespace vw {
+
+  /// Number of NUMA nodes with CPUs, at least one.
+  int numa_num_nodes();
+
+  /// The CPUs of a node, numbered from zero among the nodes which have CPUs.
+  /// Empty if the node does not exist or there is no NUMA information.
+  std::vector<int> numa_node_cpus( int node );
+
+  /// The node a worker slot belongs to.  Workers are split into
+  /// num_nodes contiguous ranges so that neighbouring ids share a node.
+  int numa_node_for_worker( int worker_id, int num_workers, int num_nodes );
+
+  /// The range [begin, end) of worker ids which belong to a node.
+  void numa_workers_for_node( int node, int num_workers, int num_nodes, int& begin, int& end );
+
+  /// Restrict the calling thread to the CPUs of a node.  Returns false
+  /// if that is not supported or not possible.
+  bool numa_pin_current_thread( int node );
+
+  /// Parse a Linux cpulist such as "0-3,8,10-11".
+  std::vector<int> numa_parse_cpulist( std::string const& list );
+
+} // namespace vw
+
+#endif // __VW_CORE_NUMA_H__
@@ -0,0 +1,171 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Profiler.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Thread.h>
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/smart_ptr/shared_ptr.hpp>
+
+std::atomic<bool> vw::Profiler::s_enabled(false);
+
+namespace {
+
+  // The events of one thread.  The buffers are kept after their thread
+  // exits so that its events are still written out.
+  struct ThreadBuffer {
+    vw::Mutex mutex; // Only contended while the buffers are being read
+    std::vector<vw::Profiler::Event> events;
+    size_t next;     // Where the next event goes
+    bool   wrapped;  // True once the oldest events are being overwritten
+    vw::uint32 thread;
+    ThreadBuffer( size_t size, vw::uint32 thread ) : events(size), next(0), wrapped(false), thread(thread) {}
+  };
+
+  vw::Mutex& registry_mutex() {
+    static vw::Mutex mutex;
+    return mutex;
+  }
+  std::vector<boost::shared_ptr<ThreadBuffer> >& registry() {
+    static std::vector<boost::shared_ptr<ThreadBuffer> > buffers;
+    return buffers;
+  }
+  size_t default_buffer_size = 64*1024; // Guarded by registry_mutex()
+
+  thread_local boost::shared_ptr<ThreadBuffer> local_buffer;
+
+  ThreadBuffer& this_thread_buffer() {
+    if (!local_buffer) {
+      vw::Mutex::Lock lock(registry_mutex());
+      local_buffer.reset(new ThreadBuffer(std::max(default_buffer_size, size_t(1)),
+                                          vw::uint32(registry().size())));
+      registry().push_back(local_buffer);
+    }
+    return *local_buffer;
+  }
+
+  // Order by start time, with enclosing zones before the zones they contain.
+  bool earlier( vw::Profiler::Event const& a, vw::Profiler::Event const& b ) {
+    if (a.start_us != b.start_us)
+      return a.start_us < b.start_us;
+    return a.end_us > b.end_us;
+  }
+
+  void write_json_string( std::ostream& os, const char* s ) {
+    os << '"';
+    for (; *s; ++s) {
+      if (*s == '"' || *s == '\\')
+        os << '\\';
+      os << *s;
+    }
+    os << '"';
+  }
+}
+
+void vw::Profiler::set_enabled( bool enabled ) {
+  s_enabled = enabled;
+}
+
+void vw::Profiler::set_buffer_size( size_t num_events ) {
+  Mutex::Lock lock(registry_mutex());
+  default_buffer_size = num_events;
+}
+
+size_t vw::Profiler::buffer_size() {
+  Mutex::Lock lock(registry_mutex());
+  return default_buffer_size;
+}
+
+void vw::Profiler::record( const char* name, uint64 start_us, uint64 end_us ) {
+  ThreadBuffer& buffer = this_thread_buffer();
+  Mutex::Lock lock(buffer.mutex);
+  Event& event   = buffer.events[buffer.next];
+  event.name     = name;
+  event.start_us = start_us;
+  event.end_us   = end_us;
+  event.thread   = buffer.thread;
+  if (++buffer.next == buffer.events.size()) {
+    buffer.next    = 0;
+    buffer.wrapped = true;
+  }
+}
+
+std::vector<vw::Profiler::Event> vw::Profiler::events() {
+  std::vector<boost::shared_ptr<ThreadBuffer> > buffers;
+  {
+    Mutex::Lock lock(registry_mutex());
+    buffers = registry();
+  }
+  std::vector<Event> result;
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    ThreadBuffer& buffer = *buffers[i];
+    Mutex::Lock lock(buffer.mutex);
+    if (buffer.wrapped)
+      result.insert(result.end(), buffer.events.begin() + buffer.next, buffer.events.end());
+    result.insert(result.end(), buffer.events.begin(), buffer.events.begin() + buffer.next);
+  }
+  std::stable_sort(result.begin(), result.end(), earlier);
+  return result;
+}
+
+void vw::Profiler::clear() {
+  Mutex::Lock lock(registry_mutex());
+  for (size_t i = 0; i < registry().size(); ++i) {
+    ThreadBuffer& buffer = *registry()[i];
+    Mutex::Lock buffer_lock(buffer.mutex);
+    buffer.next    = 0;
+    buffer.wrapped = false;
+  }
+}
+
+void vw::Profiler::write_chrome_trace( std::ostream& os ) {
+  std::vector<Event> all = events();
+  uint32 num_threads = 0;
+  {
+    Mutex::Lock lock(registry_mutex());
+    num_threads = uint32(registry().size());
+  }
+
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  const char* separator = "\n";
+  // Name the threads so the viewer labels each row.
+  for (uint32 t = 0; t < num_threads; ++t) {
+    os << separator << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+       << ",\"args\":{\"name\":\"thread " << t << "\"}}";
+    separator = ",\n";
+  }
+  for (size_t i = 0; i < all.size(); ++i) {
+    os << separator << "{\"name\":";
+    write_json_string(os, all[i].name);
+    os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << all[i].thread
+       << ",\"ts\":" << all[i].start_us
+       << ",\"dur\":" << (all[i].end_us - all[i].start_us) << "}";
+    separator = ",\n";
+  }
+  os << "\n]}\n";
+}
+
+void vw::Profiler::write_chrome_trace( std::string const& filename ) {
+  std::ofstream os(filename.c_str());
+  if (!os)
+    vw_throw( IOErr() << "Profiler: unable to open " << filename << " for writing." );
+  write_chrome_trace(os);
+}
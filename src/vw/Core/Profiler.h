@@ -0,0 +1,100 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/Profiler.h
+///
+/// A low overhead scoped profiler.  A ProfileZone (usually created with
+/// VW_PROFILE_ZONE) records when it was entered and left into a ring
+/// buffer owned by the calling thread, so recording never waits on
+/// other threads.  Zones nest naturally, and the buffers of all threads
+/// can be written out in the Chrome trace event format to be viewed in
+/// chrome://tracing or https://ui.perfetto.dev.
+///
+/// Recording is off until Profiler::set_enabled(true) is called.  While
+/// it is off a zone costs a single atomic load.
+///
+#ifndef __VW_CORE_PROFILER_H__
+#define __VW_CORE_PROFILER_H__
+
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/FundamentalTypes.h>
+
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace vw {
+
+  /// Global control of the per-thread event buffers.  All functions are thread-safe.
+  class Profiler {
+  public:
+    /// One completed zone.  Names must have static storage, e.g. string literals.
+    struct Event {
+      const char* name;
+      uint64      start_us, end_us; ///< From Stopwatch::microtime()
+      uint32      thread;           ///< Index of the thread, in order of first use
+    };
+
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void set_enabled( bool enabled );
+
+    /// Number of events kept per thread; once it is full the oldest are overwritten.
+    /// Only affects threads which have not recorded anything yet.
+    static void   set_buffer_size( size_t num_events );
+    static size_t buffer_size();
+
+    /// Add an event to the buffer of the calling thread.
+    static void record( const char* name, uint64 start_us, uint64 end_us );
+
+    /// Return a copy of the events of all threads, sorted by start time.
+    static std::vector<Event> events();
+
+    /// Throw away all recorded events.
+    static void clear();
+
+    /// Write all recorded events as Chrome trace event format JSON.
+    static void write_chrome_trace( std::ostream& os );
+    static void write_chrome_trace( std::string const& filename );
+
+  private:
+    static std::atomic<bool> s_enabled;
+  };
+
+  /// Records the time between its construction and destruction as one event.
+  class ProfileZone : private boost::noncopyable {
+    const char* m_name;
+    uint64      m_start_us; ///< Zero if the profiler was off when the zone was entered
+  public:
+    explicit ProfileZone( const char* name )
+      : m_name(name), m_start_us(Profiler::enabled() ? Stopwatch::microtime() : 0) {}
+    ~ProfileZone() {
+      if (m_start_us)
+        Profiler::record(m_name, m_start_us, Stopwatch::microtime());
+    }
+  };
+
+} // namespace vw
+
+#define VW_PROFILE_CONCAT_(a, b) a ## b
+#define VW_PROFILE_CONCAT(a, b)  VW_PROFILE_CONCAT_(a, b)
+
+/// Profile the rest of the enclosing scope under the given (string literal) name.
+#define VW_PROFILE_ZONE(name) ::vw::ProfileZone VW_PROFILE_CONCAT(vw_profile_zone_, __LINE__)(name)
+
+#endif // __VW_CORE_PROFILER_H__
@@ -28,7 +28,7 @@ const vw::ProgressCallback &vw::ProgressCallback::dummy_instance() {
 }
 
 // Deprecrated Progress Bar
-vw::TerminalProgressCallback::TerminalProgressCallback( MessageLevel level, std::string pre_progress_text, uint32_t precision) : m_level(level), m_namespace(".progress"), m_pre_progress_text(pre_progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))) {
+vw::TerminalProgressCallback::TerminalProgressCallback( MessageLevel level, std::string pre_progress_text, uint32_t precision) : m_level(level), m_namespace(".progress"), m_pre_progress_text(pre_progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))), m_reporter_running(false), m_reporter_stop(false) {
   boost::replace_all(m_pre_progress_text,"\t","        ");
   if ( m_level <  InfoMessage )
     vw_throw( ArgumentErr() << "TerminalProgressBar must be message level InfoMessage or higher." );
@@ -39,26 +39,75 @@ vw::TerminalProgressCallback::TerminalProgressCallback( MessageLevel level, std:
     m_bar_length -= m_precision + 1; // 1 for decimal point
 }
 
+namespace {
+  // How often the reporter thread redraws the bar.
+  const unsigned long g_report_interval_ms = 100;
+}
+
+void vw::TerminalProgressCallback::launch_reporter() const {
+  Mutex::Lock lock(m_mutex);
+  if (m_reporter_running)
+    return;
+  m_reporter_stop = false;
+  m_reporter.reset(new Thread(Reporter(this)));
+  m_reporter_running = true;
+}
+
+void vw::TerminalProgressCallback::stop_reporter() const {
+  boost::shared_ptr<Thread> reporter;
+  {
+    Mutex::Lock lock(m_mutex);
+    reporter.swap(m_reporter);
+    m_reporter_stop = true;
+    m_reporter_wake.notify_all();
+  }
+  if (!reporter)
+    return;
+  reporter->join();
+
+  // The last reports may have come after the reporter's last look.
+  Mutex::Lock lock(m_mutex);
+  draw_progress();
+  m_reporter_running = false;
+}
+
+void vw::TerminalProgressCallback::run_reporter() const {
+  Mutex::Lock lock(m_mutex);
+  while (!m_reporter_stop) {
+    draw_progress();
+    m_reporter_wake.timed_wait(lock, g_report_interval_ms);
+  }
+}
+
 void vw::TerminalProgressCallback::print_progress() const {
-  if (fabs(m_progress - m_last_reported_progress) > m_step) {
-    m_last_reported_progress = m_progress;
-    int pi = static_cast<int>(m_progress * double(m_bar_length));
+  Mutex::Lock lock(m_mutex);
+  draw_progress();
+}
+
+void vw::TerminalProgressCallback::draw_progress() const {
+  const double progress = m_progress;
+  if (fabs(progress - m_last_reported_progress) > m_step) {
+    m_last_reported_progress = progress;
+    int pi = static_cast<int>(progress * double(m_bar_length));
     std::ostringstream p;
     p << "\r" << m_pre_progress_text << "[";
     for( int i=0; i<pi; ++i ) p << "*";
     for( int i=m_bar_length; i>pi; --i ) p << ".";
-    p << "] " << std::setprecision(m_precision) << std::fixed << (m_progress*100.0) << "%";
+    p << "] " << std::setprecision(m_precision) << std::fixed << (progress*100.0) << "%";
     VW_OUT(m_level, m_namespace) << p.str() << std::flush;
   }
 }
 
 void vw::TerminalProgressCallback::report_aborted(std::string why) const {
+  stop_reporter();
   Mutex::Lock lock(m_mutex);
   VW_OUT(m_level, m_namespace) << " Aborted: " << why << std::endl;
 }
 
 void vw::TerminalProgressCallback::report_finished() const {
+  stop_reporter();
   Mutex::Lock lock(m_mutex);
+  m_progress = 1.0;
   uint32 cbar_length = m_max_characters - static_cast<uint32>(m_pre_progress_text.size()) -12;
   std::ostringstream p;
   for ( uint32 i = 0; i < cbar_length; i++ )
@@ -66,4 +115,3 @@ void vw::TerminalProgressCallback::report_finished() const {
   VW_OUT(m_level, m_namespace) << "\r" << m_pre_progress_text
                                << "[" << p.str() << "] Complete!\n";
 }
-
@@ -23,20 +23,26 @@
 #ifndef __VW_CORE_PROGRESSCALLBACK_H__
 #define __VW_CORE_PROGRESSCALLBACK_H__
 
+#include <atomic>
 #include <cmath>
 #include <string>
 
 #include <vw/Core/Log.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/Condition.h>
 #include <vw/Core/Features.h>
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/shared_ptr.hpp>
 
 
 namespace vw {
 
   /// The base class for progress monitoring.
+  ///
+  /// Progress and the abort flag are atomics, so workers on many threads
+  /// may report into one callback without taking a lock.
   class ProgressCallback {
   protected:
     // WARNING:  These may not be valid for some subclasses.  Always access these
@@ -45,16 +51,21 @@ namespace vw {
     // flaw.  The idea is that we often want to create a temporary progress callback
     // object to pass to a function performing some complex task, but that requires
     // that all the key functions be const.  This isn't pretty, but it works for now.
-    mutable bool m_abort_requested;
-    mutable double m_progress;
+    mutable std::atomic<bool>   m_abort_requested;
+    mutable std::atomic<double> m_progress;
     mutable Mutex m_mutex;
 
+    /// Adds to the progress and returns the new value.
+    double add_progress(double incremental_progress) const {
+      double current = m_progress.load();
+      while (!m_progress.compare_exchange_weak(current, current + incremental_progress)) {}
+      return current + incremental_progress;
+    }
+
   public:
     ProgressCallback() : m_abort_requested( false ), m_progress(0) {}
-    ProgressCallback( const ProgressCallback& copy ) {
-      m_progress = copy.progress();
-      m_abort_requested = copy.abort_requested();
-    }
+    ProgressCallback( const ProgressCallback& copy )
+      : m_abort_requested( copy.abort_requested() ), m_progress( copy.progress() ) {}
 
     // Reporting functions
     // Subclasses should reimplement where appropriate
@@ -62,18 +73,15 @@ namespace vw {
     // progress is from 0 (not done) to 1 (finished)
     //
     virtual void report_progress(double progress) const {
-      Mutex::Lock lock(m_mutex);
       m_progress = progress;
     }
 
     virtual void report_incremental_progress(double incremental_progress) const {
-      Mutex::Lock lock(m_mutex);
-      m_progress += incremental_progress;
+      add_progress(incremental_progress);
     }
 
     virtual void report_aborted(std::string /*why*/="") const {}
     virtual void report_finished() const {
-      Mutex::Lock lock(m_mutex);
       m_progress = 1.0;
     }
 
@@ -84,7 +92,6 @@ namespace vw {
 
     // Has an abort been requested?
     virtual bool abort_requested() const {
-      Mutex::Lock lock(m_mutex);
       return m_abort_requested;
     }
 
@@ -98,7 +105,6 @@ namespace vw {
 
     // Request abort
     virtual void request_abort() const {
-      Mutex::Lock lock(m_mutex);
       m_abort_requested = true;
     }
 
@@ -143,7 +149,18 @@ namespace vw {
 
 
   /// A progress monitor that prints a progress bar on STDOUT.
+  ///
+  /// Reports only update the progress.  The bar is drawn by a reporter
+  /// thread, started by the first report, which wakes a few times a
+  /// second; it is stopped, and the bar drawn one last time, when the
+  /// task finishes or aborts or the callback is destroyed.
   class TerminalProgressCallback : public ProgressCallback {
+    struct Reporter {
+      TerminalProgressCallback const* m_callback;
+      Reporter(TerminalProgressCallback const* callback) : m_callback(callback) {}
+      void operator()() { m_callback->run_reporter(); }
+    };
+
     MessageLevel m_level;
     std::string m_namespace;
     std::string m_pre_progress_text;
@@ -154,6 +171,12 @@ namespace vw {
     static const uint32 m_max_characters = 80;
     uint32 m_bar_length;
 
+    // The reporter thread; m_mutex guards it and the drawing.
+    mutable std::atomic<bool> m_reporter_running;
+    mutable bool m_reporter_stop;
+    mutable Condition m_reporter_wake;
+    mutable boost::shared_ptr<Thread> m_reporter;
+
     void calculate_bar_length() {
       VW_ASSERT( m_pre_progress_text.size()+8+m_precision < 80,
                  ArgumentErr() << "Pre-progress Text or Precision too big to allow progress bar to fit inside 80 char" );
@@ -162,11 +185,24 @@ namespace vw {
         m_bar_length -= m_precision + 1; // 1 for decimal point
     }
 
+    void start_reporter() const {
+      if (!m_reporter_running)
+        launch_reporter();
+    }
+    void launch_reporter() const;
+    void stop_reporter() const;
+    void run_reporter() const;
+
+    // Draws the bar if it moved by more than the precision shows.
+    // m_mutex must be held.
+    void draw_progress() const;
+
   public:
     TerminalProgressCallback( MessageLevel level = InfoMessage, std::string pre_progress_text = "", uint32_t precision = 0 ) VW_DEPRECATED;
 
     TerminalProgressCallback( std::string log_namespace, std::string progress_text, MessageLevel log_level = InfoMessage, uint32_t precision = 0) :
-      m_level(log_level), m_namespace(log_namespace), m_pre_progress_text(progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))) {
+      m_level(log_level), m_namespace(log_namespace), m_pre_progress_text(progress_text), m_last_reported_progress(-1), m_precision(precision), m_step(std::pow(10., -(int32_t(precision)+2))),
+      m_reporter_running(false), m_reporter_stop(false) {
 
       m_namespace += ".progress";
       boost::replace_all(m_pre_progress_text,"\t","        ");
@@ -177,15 +213,13 @@ namespace vw {
       calculate_bar_length();
     }
 
-    virtual ~TerminalProgressCallback() {}
+    virtual ~TerminalProgressCallback() { stop_reporter(); }
 
-    TerminalProgressCallback( const TerminalProgressCallback& copy ) : ProgressCallback(copy) {
-      m_level = copy.message_level();
-      m_namespace = copy.message_namespace();
-      m_pre_progress_text = copy.pre_progress_text();
-      m_progress = copy.progress();
-      m_abort_requested = copy.abort_requested();
-    }
+    /// The copy has its own reporter, started by its first report.
+    TerminalProgressCallback( const TerminalProgressCallback& copy ) : ProgressCallback(copy),
+      m_level(copy.message_level()), m_namespace(copy.message_namespace()), m_pre_progress_text(copy.pre_progress_text()),
+      m_last_reported_progress(-1), m_precision(copy.m_precision), m_step(copy.m_step), m_bar_length(copy.m_bar_length),
+      m_reporter_running(false), m_reporter_stop(false) {}
 
     void set_progress_text( std::string const& text ) {
       Mutex::Lock lock(m_mutex);
@@ -195,20 +229,19 @@ namespace vw {
     }
 
     virtual void report_progress(double progress) const {
-      Mutex::Lock lock(m_mutex);
       m_progress = progress;
-      print_progress();
+      start_reporter();
     }
 
     virtual void report_incremental_progress(double incremental_progress) const {
-      Mutex::Lock lock(m_mutex);
-      m_progress += incremental_progress;
-      print_progress();
+      add_progress(incremental_progress);
+      start_reporter();
     }
 
     virtual void report_aborted(std::string why="") const;
     virtual void report_finished() const;
 
+    /// Draws the bar now rather than at the reporter's next wake up.
     void print_progress() const;
 
     std::string pre_progress_text() const { return m_pre_progress_text; }
@@ -17,7 +17,11 @@
 
 #include <vw/config.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/BufferPool.h>
 #include <vw/Core/Cache.h>
+#include <vw/Core/CpuFeatures.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/MemoryGovernor.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/ConfigParser.h>
 
@@ -26,6 +30,14 @@
 #include <boost/version.hpp>
 #include <boost/thread/xtime.hpp>
 
+#ifdef __linux__
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #ifdef VW_HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -43,13 +55,125 @@ typedef struct stat struct_stat;
 
 namespace vw {
 
+// ---------------------------------------------------
+// RcWatcher
+// ---------------------------------------------------
+
+#ifdef __linux__
+
+// Watches the directory of the rc file with inotify, so that replacing
+// the file is seen as well as writing it, and sets changed whenever an
+// event names the file.  If the watch goes away (the directory was
+// removed) it clears watching, and the settings go back to polling.
+class Settings::RcWatcher : private boost::noncopyable {
+  int m_inotify;
+  int m_wake[2];
+  std::string m_name;
+  std::atomic<bool>& m_changed;
+  std::atomic<bool>& m_watching;
+  boost::shared_ptr<Thread> m_thread;
+
+  struct Worker {
+    RcWatcher* m_watcher;
+    Worker(RcWatcher* watcher) : m_watcher(watcher) {}
+    void operator()() { m_watcher->run(); }
+  };
+
+  void run() {
+    // Aligned for the inotify_event structs read into it.
+    union { inotify_event event; char bytes[4096]; } buffer;
+    struct pollfd fds[2];
+    fds[0].fd = m_inotify; fds[0].events = POLLIN;
+    fds[1].fd = m_wake[0]; fds[1].events = POLLIN;
+
+    for (;;) {
+      if (::poll(fds, 2, -1) < 0) {
+        if (errno == EINTR)
+          continue;
+        break;
+      }
+      if (fds[1].revents)
+        return;
+
+      ssize_t length = ::read(m_inotify, buffer.bytes, sizeof(buffer));
+      if (length < 0 && (errno == EINTR || errno == EAGAIN))
+        continue;
+      if (length <= 0)
+        break;
+
+      for (char* p = buffer.bytes; p < buffer.bytes + length; ) {
+        inotify_event const* event = reinterpret_cast<inotify_event const*>(p);
+        if ((event->mask & IN_IGNORED) != 0) {
+          m_watching = false;
+          m_changed = true;
+          return;
+        }
+        if ((event->mask & IN_Q_OVERFLOW) != 0 || (event->len > 0 && m_name == event->name))
+          m_changed = true;
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+    m_watching = false;
+    m_changed = true;
+  }
+
+public:
+  RcWatcher(std::string const& filename, std::atomic<bool>& changed, std::atomic<bool>& watching)
+    : m_inotify(-1), m_changed(changed), m_watching(watching) {
+    m_wake[0] = m_wake[1] = -1;
+
+    std::string directory = ".";
+    m_name = filename;
+    size_t slash = filename.rfind('/');
+    if (slash != std::string::npos) {
+      directory = slash == 0 ? std::string("/") : filename.substr(0, slash);
+      m_name = filename.substr(slash + 1);
+    }
+
+    const uint32_t events = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+    m_inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_inotify < 0 || ::inotify_add_watch(m_inotify, directory.c_str(), events) < 0 ||
+        ::pipe2(m_wake, O_CLOEXEC) != 0)
+      return;
+
+    m_watching = true;
+    m_thread.reset(new Thread(Worker(this)));
+  }
+
+  ~RcWatcher() {
+    if (m_thread) {
+      char stop = 0;
+      while (::write(m_wake[1], &stop, 1) < 0 && errno == EINTR) {}
+      m_thread->join();
+    }
+    if (m_inotify >= 0) ::close(m_inotify);
+    if (m_wake[0] >= 0) ::close(m_wake[0]);
+    if (m_wake[1] >= 0) ::close(m_wake[1]);
+  }
+
+  bool active() const { return bool(m_thread); }
+};
+
+#else
+
+// Without inotify the rc file is only polled.
+class Settings::RcWatcher {
+public:
+  RcWatcher(std::string const&, std::atomic<bool>&, std::atomic<bool>&) {}
+  bool active() const { return false; }
+};
+
+#endif
+
 // ---------------------------------------------------
 // Settings Methods
 // ---------------------------------------------------
 
-// Every m_rc_poll_period seconds, this method polls the
-// m_rc_filename to see if it exists and to see if it has been
-// recently modified.  If so, we reload the log ruleset from the file.
+// While the rc file is watched, this method re-reads it only when the
+// watcher has seen it change.  Otherwise, every m_rc_poll_period
+// seconds, it polls m_rc_filename to see if it exists and to see if it
+// has been recently modified, and starts watching it.  If so, we
+// reload the log ruleset from the file.
 void Settings::reload_config() {
 
 #ifdef VW_ENABLE_CONFIG_FILE
@@ -57,45 +181,63 @@ void Settings::reload_config() {
   // We CANNOT use the vw log infrastructure here, because it will
   // call reload_config and deadlock!
 
+  if (m_rc_watching.load(std::memory_order_acquire)) {
+    // Only the thread which clears the flag reads the file.
+    if (!m_rc_changed.exchange(false))
+      return;
+    RecursiveMutex::Lock lock(m_rc_file_mutex);
+    struct_stat statbuf;
+    if (m_rc_filename.empty() || stat(m_rc_filename.c_str(), &statbuf) != 0)
+      return;
+    // if it throws, let it bubble up.
+    parse_config_file(m_rc_filename.c_str(), *this);
+    return;
+  }
+
   boost::xtime xt;
 #if BOOST_VERSION >= 105000
   boost::xtime_get(&xt, boost::TIME_UTC_);
 #else
   boost::xtime_get(&xt, boost::TIME_UTC);
 #endif
-  bool needs_reloading = false;
 
   // Every five seconds, we attempt to open the log config file to see
-  // if there have been any changes.  The mutex locking for querying
-  // the time is handled separately from reading the file so that only
-  // one thread takes the performance hit of reading the rc file
-  // during any given reload.
-  {
-    RecursiveMutex::Lock time_lock(m_rc_time_mutex);
-    if (xt.sec - m_rc_last_polltime > m_rc_poll_period) {
-      m_rc_last_polltime = xt.sec;
-      needs_reloading = true;
-    }
-  }
+  // if there have been any changes.  Only the thread which moves the
+  // poll time forward reads the file, so that only one thread takes
+  // the performance hit of reading the rc file during any given
+  // reload.
+  long last_polltime = m_rc_last_polltime.load(std::memory_order_relaxed);
+  if (!(xt.sec - last_polltime > m_rc_poll_period.load(std::memory_order_relaxed)) ||
+      !m_rc_last_polltime.compare_exchange_strong(last_polltime, long(xt.sec)))
+    return;
 
-  if (needs_reloading) {
-    RecursiveMutex::Lock lock(m_rc_file_mutex);
+  RecursiveMutex::Lock lock(m_rc_file_mutex);
+  if (m_rc_filename.empty())
+    return;
 
-    // Check to see if the file has changed.  If so, re-read the settings.
-    struct_stat statbuf;
-    if (stat(m_rc_filename.c_str(), &statbuf) != 0)
-      return;
+  // Start watching before looking at the file, so that no change after
+  // this look is missed.
+  if (!m_rc_watching.load(std::memory_order_acquire)) {
+    m_rc_watcher.reset();
+    m_rc_watcher.reset(new RcWatcher(m_rc_filename, m_rc_changed, m_rc_watching));
+    if (!m_rc_watcher->active())
+      m_rc_watcher.reset();
+  }
+
+  // Check to see if the file has changed.  If so, re-read the settings.
+  struct_stat statbuf;
+  if (stat(m_rc_filename.c_str(), &statbuf) != 0)
+    return;
 #ifdef __APPLE__
-    time_t mtime = statbuf.st_mtimespec.tv_sec;
+  time_t mtime = statbuf.st_mtimespec.tv_sec;
 #else // Linux / Windows
-    time_t mtime = statbuf.st_mtime;
+  time_t mtime = statbuf.st_mtime;
 #endif
-    if (mtime > m_rc_last_modification) {
-      m_rc_last_modification = mtime;
+  if (mtime > m_rc_last_modification) {
+    m_rc_last_modification = mtime;
 
-      // if it throws, let it bubble up.
-      parse_config_file(m_rc_filename.c_str(), *this);
-    }
+    // if it throws, let it bubble up.
+    parse_config_file(m_rc_filename.c_str(), *this);
   }
 #endif
 }
@@ -104,8 +246,6 @@ void Settings::set_rc_filename(std::string filename, bool parse_now) {
 
   // limit the scope of the lock
   {
-    // we grab both locks in the same order that reload_config does.
-    RecursiveMutex::Lock time_lock(m_rc_time_mutex);
     RecursiveMutex::Lock file_lock(m_rc_file_mutex);
 
     if (filename.empty()) {
@@ -119,25 +259,26 @@ void Settings::set_rc_filename(std::string filename, bool parse_now) {
       m_rc_last_polltime = 0;
       m_rc_last_modification = 0;
     }
+
+    // Stop watching the old file.  The next poll watches the new one.
+    if (filename != m_rc_filename) {
+      m_rc_watcher.reset();
+      m_rc_watching = false;
+      m_rc_changed = false;
+    }
     m_rc_filename = filename;
   }
 
   // Okay, we might have changed the filename. Call reload_config() in order to
-  // re-read it. It will grab time_lock and file_lock, so we need to make sure
-  // we've released them before we re-read it (or we deadlock).
+  // re-read it. It will grab file_lock, so we need to make sure we've released
+  // it before we re-read it (or we deadlock).
   if (parse_now)
     reload_config();
 }
 
 void Settings::set_rc_poll_period(float period) {
-
-  // limit the scope of the lock
-  {
-    // we only need the time lock here
-    RecursiveMutex::Lock time_lock(m_rc_time_mutex);
-    m_rc_poll_period = period;
-    m_rc_last_polltime = 0;
-  }
+  m_rc_poll_period = period;
+  m_rc_last_polltime = 0;
   reload_config();
 }
 
@@ -171,37 +312,89 @@ namespace {
 }
 
 #define _VW_SET1(Name, Default)\
-  m_ ## Name(Default), m_ ## Name ## _override(false)
+  first->Name = Default; first->Name ## _override = false
 
 Settings::Settings()
-  : _VW_SET1(default_num_threads, VW_NUM_THREADS),
-    _VW_SET1(system_cache_size, size_t(VW_CACHE_SIZE) * 1024 * 1024),
-    _VW_SET1(write_pool_size, 21), // 21 threads is about 252MB of back data for RGB f32 1024x1024 blocks
-    _VW_SET1(default_tile_size, 256),
-    _VW_SET1(tmp_directory, default_tmp_dir()),
-    m_rc_poll_period(5.0f)
+  : m_snapshot(0),
+    m_rc_last_polltime(0),
+    m_rc_last_modification(0),
+    m_rc_poll_period(5.0f),
+    m_rc_watching(false),
+    m_rc_changed(false)
 {
+  Snapshot* first = new Snapshot();
+  first->version = 0;
+  _VW_SET1(default_num_threads, VW_NUM_THREADS);
+  _VW_SET1(numa_aware, false);
+  _VW_SET1(system_cache_size, size_t(VW_CACHE_SIZE) * 1024 * 1024);
+  _VW_SET1(system_cache_shards, 1);
+  _VW_SET1(system_cache_policy, "lru");
+  _VW_SET1(system_cache_spill_size, 0);
+  _VW_SET1(buffer_pool_size, size_t(128) * 1024 * 1024);
+  _VW_SET1(memory_budget, 0);
+  _VW_SET1(write_pool_size, 21); // 21 threads is about 252MB of back data for RGB f32 1024x1024 blocks
+  _VW_SET1(default_tile_size, 256);
+  _VW_SET1(auto_tile_size, false);
+  _VW_SET1(gdal_read_handles, 0);
+  _VW_SET1(tmp_directory, default_tmp_dir());
+  _VW_SET1(simd_isa, "auto");
+  _VW_SET1(async_log, false);
+  publish(first);
+
   set_rc_filename(default_vwrc(), false);
 }
 
+// The watcher writes to m_rc_changed and m_rc_watching, so it must stop
+// before they are destroyed.
+Settings::~Settings() {
+  {
+    RecursiveMutex::Lock lock(m_rc_file_mutex);
+    m_rc_watcher.reset();
+  }
+  delete m_snapshot.load();
+}
+
+void Settings::publish(Snapshot const* next) {
+  epoch_retire(m_snapshot.exchange(next));
+}
+
+// A read takes no lock: under an EpochGuard it loads the current
+// snapshot once, which never changes and is not freed until the guard
+// is gone.  A write publishes a changed copy of it.
 #define GETSET(Name, Type, Callback)           \
   Type Settings::Name() {                      \
-    if (!m_ ## Name ## _override)              \
+    EpochGuard guard;                          \
+    Snapshot const* snap = m_snapshot.load(std::memory_order_acquire); \
+    if (rc_may_have_changed(snap->Name ## _override)) { \
       reload_config();                         \
-    RecursiveMutex::Lock lock(m_settings_mutex);        \
-    return m_ ## Name;                         \
+      snap = m_snapshot.load(std::memory_order_acquire); \
+    }                                          \
+    return snap->Name;                         \
   }                                            \
   void Settings::set_ ## Name(const Type& x) { \
     RecursiveMutex::Lock lock(m_settings_mutex);        \
-    m_ ## Name ## _override = true;            \
-    m_ ## Name = x;                            \
+    Snapshot* next = new Snapshot(*m_snapshot.load()); \
+    next->version++;                           \
+    next->Name ## _override = true;            \
+    next->Name = x;                            \
+    publish(next);                             \
     Callback                                   \
   }
 
 GETSET(default_num_threads, uint32, ;);
+GETSET(numa_aware, bool, ;);
 GETSET(system_cache_size, size_t, vw_system_cache().resize(x););
+GETSET(system_cache_shards, uint32, ;);
+GETSET(system_cache_policy, std::string, vw_system_cache().set_eviction_policy(Cache::eviction_policy_from_string(x)););
+GETSET(system_cache_spill_size, size_t, ;);
+GETSET(buffer_pool_size, size_t, vw_buffer_pool().set_max_cached_bytes(x););
+GETSET(memory_budget, size_t, vw_memory_governor().set_budget(x););
 GETSET(write_pool_size, uint32, ;);
 GETSET(default_tile_size, uint32, ;);
+GETSET(auto_tile_size, bool, ;);
+GETSET(gdal_read_handles, uint32, ;);
 GETSET(tmp_directory, std::string, ;);
+GETSET(simd_isa, std::string, detail::set_allowed_cpu_features(simd_isa_features(x)););
+GETSET(async_log, bool, vw_log().set_asynchronous(x););
 
 } // namespace vw
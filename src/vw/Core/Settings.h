@@ -22,15 +22,25 @@
 /// Vision Workbench system-wide settings.  These can be twiddled
 /// programmatically by interacting with this object, or they can be
 /// set using the ~/.vwrc file in the user's home directory.  That
-/// file is reloaded on every call to access settings, so the user can
-/// modify the contents of that file in real time as the program is
-/// running.
+/// file is reloaded when it changes, so the user can modify the
+/// contents of that file in real time as the program is running.
+///
+/// The values are kept in an immutable snapshot which is replaced, not
+/// changed, when a setting is set, so reading a setting takes no lock.
+/// Replaced snapshots are freed through vw/Core/Epoch.h once no read
+/// can still be using them.
+/// On Linux the file is watched with inotify and reading a setting only
+/// checks a flag; elsewhere the file is polled as before.
 
 #ifndef __VW_CORE_SETTINGS_H__
 #define __VW_CORE_SETTINGS_H__
 
+#include <atomic>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Epoch.h>
 #include <vw/Core/System.h>
 #include <vw/Core/Thread.h>
 
@@ -48,11 +58,35 @@ namespace vw {
   /// instance of the system settings class.  You should _not_ need to
   /// create a settings object yourself!!!!
   class Settings : private boost::noncopyable {
+  public:
+
+    /// The values of all the settings at one moment.  A snapshot never
+    /// changes once published.
+    struct Snapshot {
+#define VW_SNAPSHOT_SETTING(Name, Type)\
+      Type Name; \
+      bool Name ## _override
+
+      uint64 version; ///< One more than that of the snapshot it replaced
+      VW_SNAPSHOT_SETTING(default_num_threads, uint32);
+      VW_SNAPSHOT_SETTING(numa_aware, bool);
+      VW_SNAPSHOT_SETTING(system_cache_size, size_t);
+      VW_SNAPSHOT_SETTING(system_cache_shards, uint32);
+      VW_SNAPSHOT_SETTING(system_cache_policy, std::string);
+      VW_SNAPSHOT_SETTING(system_cache_spill_size, size_t);
+      VW_SNAPSHOT_SETTING(buffer_pool_size, size_t);
+      VW_SNAPSHOT_SETTING(memory_budget, size_t);
+      VW_SNAPSHOT_SETTING(write_pool_size, uint32);
+      VW_SNAPSHOT_SETTING(default_tile_size, uint32);
+      VW_SNAPSHOT_SETTING(auto_tile_size, bool);
+      VW_SNAPSHOT_SETTING(gdal_read_handles, uint32);
+      VW_SNAPSHOT_SETTING(tmp_directory, std::string);
+      VW_SNAPSHOT_SETTING(simd_isa, std::string);
+      VW_SNAPSHOT_SETTING(async_log, bool);
+#undef VW_SNAPSHOT_SETTING
+    };
 
 #define VW_DECLARE_SETTING(Name, Type)\
-    private:\
-      Type m_ ## Name; \
-      bool m_ ## Name ## _override; \
     public: \
       Type Name(); \
       void set_ ## Name(const Type& x)
@@ -60,10 +94,36 @@ namespace vw {
     // The default number of threads used in block processing operations.
     VW_DECLARE_SETTING(default_num_threads, uint32);
 
+    // Pin WorkQueue worker threads to NUMA nodes, spreading them evenly, and
+    // hand tiles to workers by spatial locality. See vw/Core/Numa.h.
+    VW_DECLARE_SETTING(numa_aware, bool);
+
     // The current system cache size (in bytes). The system cache is shared by
     // all BlockRasterizeView<>'s, including DiskImageView<>'s.
     VW_DECLARE_SETTING(system_cache_size, size_t);
 
+    // The number of independently locked shards the system cache is split
+    // into. This is only read when the system cache is first used.
+    VW_DECLARE_SETTING(system_cache_shards, uint32);
+
+    // The eviction policy of the system cache: "lru", "clock", "2q" or "cost".
+    // See vw::Cache for a description of each one.
+    VW_DECLARE_SETTING(system_cache_policy, std::string);
+
+    // The size (in bytes) of a scratch file in tmp_directory which keeps
+    // compressed copies of image tiles evicted from the system cache, so they
+    // don't need to be generated again. Zero disables it. This is only read
+    // when the system cache is first used.
+    VW_DECLARE_SETTING(system_cache_spill_size, size_t);
+
+    // The most memory (in bytes) the buffer pool keeps in released tile
+    // buffers for reuse, see vw/Core/BufferPool.h. Zero disables pooling.
+    VW_DECLARE_SETTING(buffer_pool_size, size_t);
+
+    // The memory budget (in bytes) shared by the system cache, SGM and the
+    // block writers, see vw/Core/MemoryGovernor.h. Zero means no limit.
+    VW_DECLARE_SETTING(memory_budget, size_t);
+
     // Write cache is only used in block writing. This is the number of threads
     // that can be blocked on IO before the code stops creating more jobs (to
     // let the writes catch up).
@@ -72,20 +132,62 @@ namespace vw {
     // The default tile size (in pixels) used for block processing ops.
     VW_DECLARE_SETTING(default_tile_size, uint32);
 
+    // Choose the block size of block_rasterize(), block_cache() and the
+    // GDAL block writers by timing sample tiles wherever the caller does
+    // not set one, see vw/Image/TileSizeTuner.h.
+    VW_DECLARE_SETTING(auto_tile_size, bool);
+
+    // The number of read-only GDAL datasets each DiskImageResourceGDAL
+    // opened for reading may use to serve block reads concurrently. Zero
+    // serializes all reads through the global GDAL lock.
+    VW_DECLARE_SETTING(gdal_read_handles, uint32);
+
     // The directory used to store temporary files.
     VW_DECLARE_SETTING(tmp_directory, std::string);
 
+    // The widest instruction set SIMD kernels chosen at run time may use:
+    // "auto" for whatever the CPU has, or "scalar", "sse2", "sse4", "avx2",
+    // "avx512" or "neon" to reproduce results across machines. See
+    // vw/Core/CpuFeatures.h.
+    VW_DECLARE_SETTING(simd_isa, std::string);
+
+    // Write log lines on a background thread, so that threads which log
+    // never wait on the console or a log file. See vw/Core/Log.h.
+    VW_DECLARE_SETTING(async_log, bool);
+
 #undef VW_DECLARE_SETTING
 
+  private:
+    // The current snapshot.  It is only read under an EpochGuard, and
+    // a replaced one is passed to epoch_retire().
+    std::atomic<Snapshot const*> m_snapshot;
+    RecursiveMutex m_settings_mutex;
+
     // Member variables assoc. with periodically polling the log
     // configuration (logconf) file.
-    long m_rc_last_polltime;
+    std::atomic<long> m_rc_last_polltime;
     long m_rc_last_modification;
     std::string m_rc_filename;
-    float m_rc_poll_period;
-    RecursiveMutex m_rc_time_mutex;
+    std::atomic<float> m_rc_poll_period;
     RecursiveMutex m_rc_file_mutex;
-    RecursiveMutex m_settings_mutex;
+
+    // Watching the rc file instead of polling it.  The watcher is
+    // started by the first poll, and sets m_rc_changed whenever the
+    // file may have changed.
+    class RcWatcher;
+    boost::shared_ptr<RcWatcher> m_rc_watcher;
+    std::atomic<bool> m_rc_watching;
+    std::atomic<bool> m_rc_changed;
+
+    /// Whether a read of a setting should check the rc file first.
+    bool rc_may_have_changed( bool overridden ) const {
+      return m_rc_watching.load( std::memory_order_relaxed )
+        ? m_rc_changed.load( std::memory_order_relaxed ) : !overridden;
+    }
+
+    /// Make next the current snapshot, taking ownership of it.  Call
+    /// under m_settings_mutex.
+    void publish( Snapshot const* next );
 
   public:
 
@@ -94,13 +196,29 @@ namespace vw {
     /// instance of the settings class using the static
     /// vw_settings() method below.
     Settings();
+    ~Settings();
+
+    /// A copy of the current values of all the settings, read without
+    /// a lock.  This does not check the rc file for changes.
+    Snapshot snapshot() const {
+      EpochGuard guard;
+      return *m_snapshot.load( std::memory_order_acquire );
+    }
+
+    /// The version of the current snapshot, which changes whenever any
+    /// setting does.
+    uint64 version() const {
+      EpochGuard guard;
+      return m_snapshot.load( std::memory_order_acquire )->version;
+    }
 
     /// Change the rc filename (default: ~/.vwrc)
     void set_rc_filename(std::string filename, bool parse_now = true);
 
     /// Change the rc file poll period.  (default: 5 seconds)
     /// Note -- this sets the *minimum* poll time for the file.  The
-    /// actual file is only polled when a setting is requested.
+    /// actual file is only polled when a setting is requested.  It is
+    /// not polled at all while it is watched with inotify.
     void set_rc_poll_period(float period);
 
     // -----------------------------------------------------------------
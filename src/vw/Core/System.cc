@@ -17,8 +17,10 @@
 
 
 #include <vw/Core/System.h>
+#include <vw/Core/BufferPool.h>
 #include <vw/Core/Cache.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/MemoryGovernor.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/Stopwatch.h>
 #include <vw/Core/RunOnce.h>
@@ -29,11 +31,16 @@ namespace {
   vw::RunOnce stopwatch_set_once = VW_RUNONCE_INIT;
   vw::RunOnce system_cache_once  = VW_RUNONCE_INIT;
   vw::RunOnce log_once           = VW_RUNONCE_INIT;
+  vw::RunOnce governor_once      = VW_RUNONCE_INIT;
+  vw::RunOnce budget_once        = VW_RUNONCE_INIT;
+  vw::RunOnce buffer_pool_once   = VW_RUNONCE_INIT;
 
   vw::Settings     *settings_ptr      = 0;
   vw::StopwatchSet *stopwatch_set_ptr = 0;
   vw::Cache        *system_cache_ptr  = 0;
   vw::Log          *log_ptr           = 0;
+  vw::MemoryGovernor *governor_ptr    = 0;
+  vw::BufferPool   *buffer_pool_ptr   = 0;
 
   
   void init_settings() {
@@ -41,14 +48,35 @@ namespace {
   }
 
   void resize_cache() {
+    // No lines can have been inserted yet, this runs before the cache is first returned.
+    system_cache_ptr->set_num_shards(settings_ptr->system_cache_shards());
+    system_cache_ptr->set_eviction_policy(
+      vw::Cache::eviction_policy_from_string(settings_ptr->system_cache_policy()));
+    if (settings_ptr->system_cache_spill_size() > 0)
+      system_cache_ptr->set_spill_file(boost::shared_ptr<vw::CacheSpillFile>(
+        new vw::CacheSpillFile(settings_ptr->system_cache_spill_size(),
+                               settings_ptr->tmp_directory())));
     if (system_cache_ptr->max_size() == 0)
       system_cache_ptr->resize(settings_ptr->system_cache_size());
+    system_cache_ptr->set_memory_governor(&vw::vw_memory_governor(), "system cache");
   }
 
   void init_system_cache() {
     system_cache_ptr = new vw::Cache(0);
   }
 
+  void init_governor() {
+    governor_ptr = new vw::MemoryGovernor();
+  }
+
+  void set_budget() {
+    governor_ptr->set_budget(settings_ptr->memory_budget());
+  }
+
+  void init_buffer_pool() {
+    buffer_pool_ptr = new vw::BufferPool(settings_ptr->buffer_pool_size());
+  }
+
   void init_stopwatch_set() {
     stopwatch_set_ptr = new vw::StopwatchSet();
   }
@@ -72,6 +100,20 @@ vw::Cache &vw::vw_system_cache() {
   return *system_cache_ptr;
 }
 
+vw::MemoryGovernor &vw::vw_memory_governor() {
+  governor_once.run( init_governor );
+  settings_once.run( init_settings );
+  settings_ptr->reload_config();
+  budget_once.run( set_budget );
+  return *governor_ptr;
+}
+
+vw::BufferPool &vw::vw_buffer_pool() {
+  settings_once.run( init_settings );
+  buffer_pool_once.run( init_buffer_pool );
+  return *buffer_pool_ptr;
+}
+
 vw::StopwatchSet &vw::vw_stopwatch_set() {
   stopwatch_set_once.run( init_stopwatch_set );
   return *stopwatch_set_ptr;
@@ -24,8 +24,10 @@
 
 namespace vw {
 
+  class BufferPool;
   class Cache;
   class Log;
+  class MemoryGovernor;
   class Settings;
   class StopwatchSet;
 
@@ -38,6 +40,14 @@ namespace vw {
   //     vw_log().console_log() << "Some text\n";
   Log& vw_log();
 
+  // The memory budget shared by the system cache, SGM and the block writers.
+  MemoryGovernor& vw_memory_governor();
+
+  // Recycles the pixel buffers of the tiles generated for the system cache
+  // and other block-wise processing.  It is never destroyed, so buffers
+  // can be returned to it at any time.
+  BufferPool& vw_buffer_pool();
+
   // Global instance of Settings
   Settings& vw_settings();
 
@@ -0,0 +1,126 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Telemetry.h>
+#include <vw/Core/Condition.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/System.h>
+
+#include <iomanip>
+
+namespace {
+
+  const double MB = 1024.0 * 1024.0;
+
+  // Writes a snapshot to the log until asked to stop.
+  class TelemetryLogger {
+    double        m_period;
+    bool          m_stop;
+    vw::Mutex     m_mutex;
+    vw::Condition m_event;
+  public:
+    TelemetryLogger( double period ) : m_period(period), m_stop(false) {}
+
+    void stop() {
+      vw::Mutex::Lock lock(m_mutex);
+      m_stop = true;
+      m_event.notify_all();
+    }
+
+    void operator()() {
+      vw::Mutex::Lock lock(m_mutex);
+      while (!m_stop) {
+        m_event.timed_wait(lock, static_cast<unsigned long>(m_period * 1000));
+        if (m_stop)
+          break;
+        lock.unlock(); // Don't hold up stop() while logging
+        vw::log_telemetry();
+        lock.lock();
+      }
+    }
+  };
+
+  vw::Mutex telemetry_mutex; // Guards the two pointers below
+  boost::shared_ptr<TelemetryLogger> telemetry_logger;
+  boost::shared_ptr<vw::Thread>      telemetry_thread;
+}
+
+vw::TelemetrySnapshot vw::telemetry_snapshot() {
+  TelemetrySnapshot snapshot;
+  snapshot.cache  = vw_system_cache().snapshot();
+  snapshot.queues = WorkQueue::all_stats();
+  MemoryGovernor& governor = vw_memory_governor();
+  snapshot.memory_budget = governor.budget();
+  snapshot.memory_used   = governor.used();
+  snapshot.memory        = governor.usage();
+  return snapshot;
+}
+
+std::ostream& vw::operator<<( std::ostream& os, TelemetrySnapshot const& snapshot ) {
+  Cache::Snapshot const& cache = snapshot.cache;
+  std::ios::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(1);
+  os << "Cache: " << cache.size / MB << " / " << cache.max_size / MB << " MB, "
+     << cache.hits << " hits, " << cache.misses << " misses, "
+     << cache.evictions << " evictions, " << cache.spill_hits << " spill hits\n";
+  for (size_t i = 0; i < cache.generators.size(); ++i) {
+    Cache::GeneratorStats const& g = cache.generators[i];
+    os << "  " << std::setw(8) << g.resident / MB << " MB "
+       << std::setw(6) << g.lines << " lines, hit rate "
+       << std::setw(5) << 100.0 * g.hit_rate() << "%, "
+       << g.mean_generation_ms() << " ms/generate, "
+       << g.lock_wait_us / 1.0e6 << " s lock wait: " << g.name << "\n";
+  }
+  for (size_t i = 0; i < snapshot.queues.size(); ++i) {
+    WorkQueue::Stats const& q = snapshot.queues[i];
+    os << "WorkQueue " << (q.name.empty() ? std::string("(unnamed)") : q.name) << ": "
+       << q.active_threads << " / " << q.max_threads << " threads active, "
+       << q.queued << " queued, " << q.tasks_run << " run, " << q.tasks_cancelled << " cancelled, "
+       << q.busy_us / 1.0e6 << " s busy, " << q.idle_us / 1.0e6 << " s idle\n";
+  }
+  os << "Memory: " << snapshot.memory_used / MB << " MB held, budget ";
+  if (snapshot.memory_budget)
+    os << snapshot.memory_budget / MB << " MB\n";
+  else
+    os << "unlimited\n";
+  for (size_t i = 0; i < snapshot.memory.size(); ++i) {
+    MemoryGovernor::Usage const& u = snapshot.memory[i];
+    os << "  " << std::setw(8) << u.used / MB << " MB held, "
+       << std::setw(8) << u.peak / MB << " MB peak: " << u.name << "\n";
+  }
+  os.flags(flags);
+  return os;
+}
+
+void vw::log_telemetry() {
+  VW_OUT(InfoMessage, "telemetry") << telemetry_snapshot();
+}
+
+void vw::set_telemetry_period( double seconds ) {
+  Mutex::Lock lock(telemetry_mutex);
+  if (telemetry_logger) {
+    telemetry_logger->stop();
+    telemetry_thread->join();
+    telemetry_logger.reset();
+    telemetry_thread.reset();
+  }
+  if (seconds > 0) {
+    telemetry_logger.reset(new TelemetryLogger(seconds));
+    telemetry_thread.reset(new Thread(telemetry_logger));
+  }
+}
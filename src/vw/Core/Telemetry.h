@@ -0,0 +1,64 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Core/Telemetry.h
+///
+/// Snapshots of the system cache and thread pool counters.  These show
+/// which generator in a pipeline is thrashing the cache and whether the
+/// worker threads are kept busy.  A snapshot can be taken on demand, or
+/// written to the "telemetry" log namespace at InfoMessage level every
+/// few seconds; add a rule such as "20 = telemetry" to a logfile section
+/// of the vwrc to see it.
+///
+#ifndef __VW_CORE_TELEMETRY_H__
+#define __VW_CORE_TELEMETRY_H__
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <ostream>
+#include <vector>
+
+namespace vw {
+
+  /// The counters of the system cache, of every live WorkQueue and of the
+  /// accounts of the memory governor.
+  struct TelemetrySnapshot {
+    Cache::Snapshot               cache;
+    std::vector<WorkQueue::Stats> queues;
+    size_t                        memory_budget, memory_used;
+    std::vector<MemoryGovernor::Usage> memory;
+  };
+
+  /// Collect the current counters.
+  TelemetrySnapshot telemetry_snapshot();
+
+  /// Print a snapshot as a short human readable table.
+  std::ostream& operator<<( std::ostream& os, TelemetrySnapshot const& snapshot );
+
+  /// Write telemetry_snapshot() to the "telemetry" log namespace.
+  void log_telemetry();
+
+  /// Call log_telemetry() from a background thread every period seconds.
+  /// A period of zero or less stops the thread.
+  void set_telemetry_period( double seconds );
+
+} // namespace vw
+
+#endif // __VW_CORE_TELEMETRY_H__
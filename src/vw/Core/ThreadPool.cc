@@ -19,14 +19,39 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/ThreadPool.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/Numa.h>
 
 #include <ostream>
+#include <set>
 
 using namespace vw;
 
+namespace {
+  // Every WorkQueue registers itself here so that WorkQueue::all_stats() can find it.
+  Mutex& queue_registry_mutex() {
+    static Mutex mutex;
+    return mutex;
+  }
+  std::set<WorkQueue*>& queue_registry() {
+    static std::set<WorkQueue*> queues;
+    return queues;
+  }
+}
+
 //----------------------------------------------------
 // Task
 
+void CancelToken::throw_if_cancelled() const {
+  if (is_cancelled())
+    vw_throw( Aborted() << "Task was cancelled" );
+}
+
+void Task::set_priority(int priority) {
+  VW_ASSERT( priority >= PriorityLow && priority < NumPriorities,
+             ArgumentErr() << "Task: invalid priority " << priority );
+  m_priority = priority;
+}
 
 bool Task::is_finished() {
   Mutex::Lock lock(m_task_mutex);
@@ -55,19 +80,40 @@ WorkQueue::WorkerThread::WorkerThread(WorkQueue& queue, boost::shared_ptr<Task>
 
 
 void WorkQueue::WorkerThread::operator()() {
+  // Worker ids are reused for new threads, so each thread pins itself.
+  if (m_queue.m_numa_nodes > 1)
+    numa_pin_current_thread(numa_node_for_worker(m_thread_id, m_queue.m_max_workers,
+                                                 m_queue.m_numa_nodes));
   do {
     VW_OUT(DebugMessage, "thread") << "ThreadPool: running worker thread "
                                    << m_thread_id << "\n";
-    // Run the task and then signal that it is finished
-    (*m_task)();
+    // Run the task and then signal that it is finished.  A task which was
+    // cancelled while it sat in the queue is discarded instead.
+    m_queue.m_tasks_started++;
+    if (m_task->is_cancelled()) {
+      m_task->discard();
+      m_queue.m_tasks_cancelled++;
+    } else {
+      uint64 start_time = Stopwatch::microtime();
+      (*m_task)();
+      m_queue.m_busy_us += Stopwatch::microtime() - start_time;
+      m_queue.m_tasks_run++;
+    }
     m_task->signal_finished();
 
-    {
+    // Queues which support concurrent dispatch can hand out the next task
+    // without serializing all of the workers on m_queue_mutex.
+    if (m_queue.has_concurrent_dispatch())
+      m_task = m_queue.get_next_task_for_worker(m_thread_id);
+    else
+      m_task.reset();
+
+    if (!m_task) {
       // We lock m_queue_mutex to prevent WorkQueue::notify() from running
       // until we either sucessfully have grabbed the next task, or we have
       // completely terminated the worker.
       Mutex::Lock lock(m_queue.m_queue_mutex);
-      m_task = m_queue.get_next_task();
+      m_task = m_queue.get_next_task_for_worker(m_thread_id);
 
       if (!m_task) // No more tasks, notify parent queue that we are finished.
         m_queue.worker_thread_complete(m_thread_id);
@@ -91,12 +137,23 @@ void WorkQueue::worker_thread_complete(int worker_id) {
 }
 
 WorkQueue::WorkQueue(int num_threads )
-  : m_active_workers(0), m_max_workers(num_threads), m_should_die(false) {
+  : m_active_workers(0), m_max_workers(num_threads), m_should_die(false),
+    m_numa_nodes(vw_settings().numa_aware() ? numa_num_nodes() : 1),
+    m_created_us(Stopwatch::microtime()), m_tasks_added(0), m_tasks_started(0),
+    m_tasks_run(0), m_tasks_cancelled(0), m_busy_us(0) {
   m_running_threads.resize(num_threads);
   for (int i = 0; i < num_threads; ++i)
     m_available_thread_ids.push_back(i);
+  Mutex::Lock lock(queue_registry_mutex());
+  queue_registry().insert(this);
+}
+WorkQueue::~WorkQueue() {
+  {
+    Mutex::Lock lock(queue_registry_mutex());
+    queue_registry().erase(this);
+  }
+  this->join_all();
 }
-WorkQueue::~WorkQueue() { this->join_all(); }
 
 void WorkQueue::notify() {
   Mutex::Lock lock(m_queue_mutex);
@@ -151,6 +208,45 @@ void WorkQueue::kill_and_join() {
   this->join_all();
 }
 
+void WorkQueue::set_name(std::string const& name) {
+  Mutex::Lock lock(m_queue_mutex);
+  m_name = name;
+}
+
+std::string WorkQueue::name() {
+  Mutex::Lock lock(m_queue_mutex);
+  return m_name;
+}
+
+WorkQueue::Stats WorkQueue::stats() {
+  Stats s;
+  {
+    Mutex::Lock lock(m_queue_mutex);
+    s.name           = m_name;
+    s.max_threads    = m_max_workers;
+    s.active_threads = m_active_workers;
+  }
+  uint64 added   = m_tasks_added;
+  uint64 started = m_tasks_started;
+  s.queued    = added > started ? size_t(added - started) : 0;
+  s.tasks_run = m_tasks_run;
+  s.tasks_cancelled = m_tasks_cancelled;
+  s.busy_us   = m_busy_us;
+  uint64 capacity = uint64(s.max_threads) * (Stopwatch::microtime() - m_created_us);
+  s.idle_us   = capacity > s.busy_us ? capacity - s.busy_us : 0;
+  return s;
+}
+
+std::vector<WorkQueue::Stats> WorkQueue::all_stats() {
+  // stats() only touches members of the base class, so this is safe even
+  // for a queue whose subclass destructor is already running.
+  Mutex::Lock lock(queue_registry_mutex());
+  std::vector<Stats> result;
+  for (std::set<WorkQueue*>::iterator it = queue_registry().begin(); it != queue_registry().end(); ++it)
+    result.push_back((*it)->stats());
+  return result;
+}
+
 
 //----------------------------------------------------
 // FifoWorkQueue
@@ -166,8 +262,17 @@ size_t FifoWorkQueue::size() {
 void FifoWorkQueue::add_task(boost::shared_ptr<Task> task) {
   {
     Mutex::Lock lock(m_mutex);
-    m_queued_tasks.push_back(task);
+    // Insert behind the last task with at least the same priority.
+    std::list<boost::shared_ptr<Task> >::iterator pos = m_queued_tasks.end();
+    while (pos != m_queued_tasks.begin()) {
+      std::list<boost::shared_ptr<Task> >::iterator prev = pos;
+      if ((*--prev)->priority() >= task->priority())
+        break;
+      pos = prev;
+    }
+    m_queued_tasks.insert(pos, task);
   }
+  this->task_added();
   this->notify();
 }
 
@@ -199,6 +304,7 @@ void OrderedWorkQueue::add_task(boost::shared_ptr<Task> task, int index) {
     Mutex::Lock lock(m_mutex);
     m_queued_tasks[index] = task;
   }
+  this->task_added();
   this->notify();
 }
 
@@ -222,3 +328,105 @@ boost::shared_ptr<Task> OrderedWorkQueue::get_next_task() {
   m_next_index++;
   return task;
 }
+
+//----------------------------------------------------
+// WorkStealingWorkQueue
+
+WorkStealingWorkQueue::WorkStealingWorkQueue(int num_threads)
+  : WorkQueue(num_threads), m_num_queued(0), m_next_list(0) {
+  for (int p = 0; p < Task::NumPriorities; ++p)
+    m_num_queued_at[p] = 0;
+  if (num_threads < 1)
+    num_threads = 1;
+  m_task_lists.resize(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    m_task_lists[i].reset(new TaskList());
+    m_task_lists[i]->steal_seed = 2654435761u * uint32(i+1);
+  }
+}
+
+size_t WorkStealingWorkQueue::size() {
+  return m_num_queued;
+}
+
+// Add a task that is being tracked by a shared pointer.
+void WorkStealingWorkQueue::add_task(boost::shared_ptr<Task> task) {
+  add_task(task, int(m_next_list++ % m_task_lists.size()));
+}
+
+void WorkStealingWorkQueue::add_task(boost::shared_ptr<Task> task, int worker_id) {
+  TaskList& list = *m_task_lists[size_t(worker_id) % m_task_lists.size()];
+  {
+    Mutex::Lock lock(list.mutex);
+    list.tasks[task->priority()].push_back(task);
+    // Incremented before notify() is called so that a worker deciding
+    // whether to exit always sees this task.
+    m_num_queued_at[task->priority()]++;
+    m_num_queued++;
+  }
+  this->task_added();
+  this->notify();
+}
+
+boost::shared_ptr<Task> WorkStealingWorkQueue::pop_front(TaskList& list, int priority) {
+  Mutex::Lock lock(list.mutex);
+  std::deque<boost::shared_ptr<Task> >& tasks = list.tasks[priority];
+  if (tasks.empty())
+    return boost::shared_ptr<Task>();
+
+  boost::shared_ptr<Task> task = tasks.front();
+  tasks.pop_front();
+  m_num_queued_at[priority]--;
+  m_num_queued--;
+  return task;
+}
+
+boost::shared_ptr<Task> WorkStealingWorkQueue::steal(size_t first_list, int priority) {
+  const size_t num_lists = m_task_lists.size();
+  for (size_t i = 0; i < num_lists; ++i) {
+    if (m_num_queued_at[priority] == 0) // Nothing left anywhere, don't bother locking the rest.
+      break;
+    boost::shared_ptr<Task> task = pop_front(*m_task_lists[(first_list + i) % num_lists], priority);
+    if (task)
+      return task;
+  }
+  return boost::shared_ptr<Task>();
+}
+
+boost::shared_ptr<Task> WorkStealingWorkQueue::get_next_task() {
+  // Called when there is no particular worker, just walk the lists in turn.
+  if (m_num_queued == 0)
+    return boost::shared_ptr<Task>();
+  for (int p = Task::NumPriorities-1; p >= 0; --p) {
+    boost::shared_ptr<Task> task = steal(m_next_list % m_task_lists.size(), p);
+    if (task)
+      return task;
+  }
+  return boost::shared_ptr<Task>();
+}
+
+boost::shared_ptr<Task> WorkStealingWorkQueue::get_next_task_for_worker(int worker_id) {
+  if (m_num_queued == 0)
+    return boost::shared_ptr<Task>();
+
+  TaskList& own = *m_task_lists[worker_id % m_task_lists.size()];
+  for (int p = Task::NumPriorities-1; p >= 0; --p) {
+    if (m_num_queued_at[p] == 0)
+      continue;
+    boost::shared_ptr<Task> task = pop_front(own, p);
+    if (task)
+      return task;
+
+    // Our own list has nothing at this priority, start stealing at a
+    // random victim (xorshift32).
+    uint32 x = own.steal_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    own.steal_seed = x;
+    task = steal(x % m_task_lists.size(), p);
+    if (task)
+      return task;
+  }
+  return boost::shared_ptr<Task>();
+}
@@ -26,6 +26,9 @@
 
 #include <vector>
 #include <list>
+#include <string>
+#include <deque>
+#include <atomic>
 
 #include <vw/Core/Condition.h>
 #include <vw/Core/Settings.h>
@@ -40,6 +43,23 @@ namespace vw {
   // ----------------------       Task       ---------------------------
   // ----------------------  --------------  ---------------------------
 
+  /// A flag shared by a group of tasks so that all of them can be
+  /// cancelled at once, e.g. the tiles of a viewport which has moved.
+  /// Cancellation is cooperative: a WorkQueue will not start a cancelled
+  /// task, but a task which is already running only stops early if it
+  /// checks is_cancelled() itself.
+  class CancelToken {
+    std::atomic<bool> m_cancelled;
+  public:
+    CancelToken() : m_cancelled(false) {}
+
+    void cancel() { m_cancelled = true; }
+    bool is_cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+    /// Throw vw::Aborted if cancel() has been called.
+    void throw_if_cancelled() const;
+  };
+
   /// Keep track of whether task is finished. WorkQueue is responsible
   /// for calling "signal_finished" after task is finished
   /// - The thread pool classes only operate on things derived from the Task class.
@@ -47,14 +67,39 @@ namespace vw {
     Mutex         m_task_mutex;
     Condition     m_finished_event;
     volatile bool m_finished;
+    int           m_priority;
+    boost::shared_ptr<CancelToken> m_cancel_token;
 
   public:
-    Task() : m_finished(false) {}
+    /// Tasks with a higher priority are started before queued tasks
+    /// with a lower one, e.g. visible tiles ahead of prefetched ones.
+    enum Priority { PriorityLow = 0, PriorityNormal = 1, PriorityHigh = 2 };
+    static const int NumPriorities = 3;
+
+    Task() : m_finished(false), m_priority(PriorityNormal) {}
     virtual ~Task() {}
 
     /// Do the work!  All Task derived classes must implement this.
     virtual void operator()() = 0;
 
+    /// Called by the WorkQueue instead of operator() when the task was
+    /// cancelled before it started.  Tasks which other work waits on
+    /// can override this to release it.
+    virtual void discard() {}
+
+    /// The priority is read when the task is added to a queue, so it
+    /// must be set before that.
+    void set_priority(int priority);
+    int  priority() const { return m_priority; }
+
+    /// Share a cancellation token with this task.  Must be set before
+    /// the task is added to a queue.
+    void set_cancel_token(boost::shared_ptr<CancelToken> const& token) { m_cancel_token = token; }
+    boost::shared_ptr<CancelToken> const& cancel_token() const { return m_cancel_token; }
+
+    /// True if the task has a cancel token which has been cancelled.
+    bool is_cancelled() const { return m_cancel_token && m_cancel_token->is_cancelled(); }
+
     /// Thread-safe check of the is_finished variable
     bool is_finished();
 
@@ -97,6 +142,14 @@ namespace vw {
     std::list<int> m_available_thread_ids; 
     Condition      m_joined_event;
     bool           m_should_die;
+    int            m_numa_nodes;     ///< Nodes to spread the workers over, 1 if not NUMA aware.
+    std::string    m_name;           ///< Label used in stats(), guarded by m_queue_mutex.
+    uint64         m_created_us;     ///< Stopwatch::microtime() when the queue was created.
+    std::atomic<uint64> m_tasks_added,   ///< Count of task_added() calls
+                        m_tasks_started, ///< Tasks a worker has started running
+                        m_tasks_run,     ///< Tasks which have finished
+                        m_tasks_cancelled, ///< Tasks discarded without being run
+                        m_busy_us;       ///< Time summed over workers spent running tasks
 
     // This is called whenever a worker thread finishes its task. If
     // there are more tasks available, the worker is given more work.
@@ -126,6 +179,13 @@ namespace vw {
     /// available, return an empty shared pointer.
     virtual boost::shared_ptr<Task> get_next_task() = 0;
 
+    /// Return a shared pointer to the next task for the worker thread
+    /// with the given ID.  The default implementation ignores the ID and
+    /// calls get_next_task().
+    virtual boost::shared_ptr<Task> get_next_task_for_worker(int worker_id) {
+      return this->get_next_task();
+    }
+
     // Notify can be called by a child class that inherits from
     // WorkQueue.  A call to notify will cause the WorkQueue to
     // re-examine the list of tasks it has available for execution.
@@ -140,15 +200,52 @@ namespace vw {
     /// Return the number of currently active threads.
     int active_threads();
 
+    /// Return the number of NUMA nodes the workers are pinned to, 1 if they are not pinned.
+    int numa_nodes() const { return m_numa_nodes; }
+
     // Join all currently running threads and wait for the task pool
     // to be empty.
     void join_all();
     void kill_and_join();
+
+    /// Counters describing the load on a WorkQueue, see stats().
+    struct Stats {
+      std::string name;
+      int    max_threads, active_threads;
+      size_t queued;    ///< Tasks added but not yet started
+      uint64 tasks_run; ///< Tasks which have finished
+      uint64 tasks_cancelled; ///< Tasks discarded because they were cancelled before they started
+      uint64 busy_us;   ///< Time summed over workers spent running tasks
+      uint64 idle_us;   ///< Time summed over worker slots spent without a task
+    };
+
+    /// Set the label reported by stats(), e.g. "block_write rasterize".
+    void        set_name(std::string const& name);
+    std::string name();
+
+    /// Collect the current counters of this queue.  queued is only known
+    /// for queues which call task_added(), it is zero for the others.
+    Stats stats();
+
+    /// Return the stats of every WorkQueue which currently exists.
+    static std::vector<Stats> all_stats();
+
+  protected:
+
+    /// Subclasses call this once for each task they queue so that stats()
+    /// can report the queue depth.
+    void task_added() { m_tasks_added++; }
+
+    /// Return true if get_next_task_for_worker() is safe to call without
+    /// holding the queue mutex.  Worker threads of these queues only take
+    /// the queue mutex when they appear to have run out of work.
+    virtual bool has_concurrent_dispatch() const { return false; }
   };
 
 
 
-  /// A simple, first-in, first-out work queue.
+  /// A simple, first-in, first-out work queue.  Tasks with a higher
+  /// priority are moved ahead of queued tasks with a lower one.
   class FifoWorkQueue : public WorkQueue {
     std::list<boost::shared_ptr<Task> > m_queued_tasks;
     Mutex m_mutex;
@@ -168,7 +265,8 @@ namespace vw {
   /// A simple ordered work queue.  Tasks are each given an "index"
   /// and they are processed in order starting with the task at index
   /// 0.  The idle() method returns true unless the task with the next
-  /// expected index is present in the work queue.
+  /// expected index is present in the work queue.  The index alone
+  /// decides the order, task priorities are ignored.
   class OrderedWorkQueue : public WorkQueue {
     std::map<int, boost::shared_ptr<Task> > m_queued_tasks;
     int   m_next_index;
@@ -185,6 +283,56 @@ namespace vw {
     virtual boost::shared_ptr<Task> get_next_task();
   };
 
+
+  /// A work queue which keeps a separate task list for each worker
+  /// thread.  New tasks are spread over the lists in round-robin order,
+  /// and each worker takes tasks from the front of its own list,
+  /// stealing from a randomly chosen victim when its own list is empty.
+  /// Workers only contend with each other while stealing, so this can be
+  /// used in place of a FifoWorkQueue when there are many threads.
+  ///
+  /// Tasks are started roughly, but not strictly, in the order they were
+  /// added, so a task must never block waiting for a task that was added
+  /// after it.  Each list keeps one deque per priority, and a worker
+  /// steals a higher priority task before it runs a lower one of its own.
+  class WorkStealingWorkQueue : public WorkQueue {
+    struct TaskList {
+      Mutex  mutex;
+      std::deque<boost::shared_ptr<Task> > tasks[Task::NumPriorities];
+      uint32 steal_seed; ///< Only touched by the worker that owns this list.
+    };
+    std::vector<boost::shared_ptr<TaskList> > m_task_lists;
+    std::atomic<size_t> m_num_queued; ///< Total number of tasks in all lists.
+    std::atomic<size_t> m_num_queued_at[Task::NumPriorities]; ///< Tasks in all lists, per priority.
+    std::atomic<size_t> m_next_list;  ///< Round-robin counter used by add_task().
+
+    /// Pop the first task of a priority from one list.  Returns an empty pointer if there is none.
+    boost::shared_ptr<Task> pop_front(TaskList& list, int priority);
+
+    /// Visit every list once, starting at the given one, and return the
+    /// first task of the given priority found.
+    boost::shared_ptr<Task> steal(size_t first_list, int priority);
+
+  public:
+
+    WorkStealingWorkQueue(int num_threads = vw_settings().default_num_threads());
+
+    size_t size();
+
+    // Add a task that is being tracked by a shared pointer.
+    void add_task(boost::shared_ptr<Task> task);
+
+    /// Add a task to the list of the given worker, which will run it
+    /// unless it is stolen by an idle worker first.
+    void add_task(boost::shared_ptr<Task> task, int worker_id);
+
+    virtual boost::shared_ptr<Task> get_next_task();
+    virtual boost::shared_ptr<Task> get_next_task_for_worker(int worker_id);
+
+  protected:
+    virtual bool has_concurrent_dispatch() const { return true; }
+  };
+
 } // namespace vw
 
 #endif // __VW_CORE_THREADPOOL_H__
@@ -18,16 +18,26 @@
 
 /// \file vw/Core/ThreadQueue.h
 ///
+/// Queues for passing messages and data between threads.  ThreadQueue is
+/// unbounded and sleeps on a condition variable.  BoundedThreadQueue has
+/// the same interface but is a fixed size lock-free ring, which avoids
+/// contending on a mutex when many small items are passed around.
+///
 
 #ifndef __VW_CORE_QUEUE_H__
 #define __VW_CORE_QUEUE_H__
 
 #include <boost/bind.hpp>
 
+#include <boost/scoped_array.hpp>
+
+#include <atomic>
+#include <cstddef>
 #include <queue>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/Condition.h>
+#include <vw/Core/Stopwatch.h>
 
 namespace vw {
 
@@ -112,6 +122,164 @@ class ThreadQueue : private boost::noncopyable {
     }
 }; // End class ThreadQueue
 
+
+/// Waits in a retry loop, first spinning, then yielding and finally
+/// sleeping, so that a short wait stays cheap and a long one sleeps.
+class ThreadQueueBackoff {
+  uint32 m_count;
+public:
+  ThreadQueueBackoff() : m_count(0) {}
+
+  void pause() {
+    const uint32 SPIN_LIMIT = 64, YIELD_LIMIT = 128;
+    if (m_count < SPIN_LIMIT) {
+      for (volatile uint32 i = 0; i < (4u << (m_count/16)); ++i) {}
+    } else if (m_count < YIELD_LIMIT) {
+      Thread::yield();
+    } else {
+      Thread::sleep_ms(1);
+      return;
+    }
+    ++m_count;
+  }
+};
+
+/// A bounded multi-producer/multi-consumer queue with the interface of
+/// ThreadQueue.  It is a ring of cells, each with a sequence number
+/// telling whether it is ready to be written or read, so neither end
+/// ever takes a lock (D. Vyukov's bounded MPMC queue).
+/// - push() waits while the queue is full, try_push() fails instead.
+/// - The waiting functions spin, yield and then sleep for a millisecond
+///   at a time, see ThreadQueueBackoff, so a consumer which waits for a
+///   long time is woken up with up to that much delay.
+/// - size() and empty() are only approximate while other threads are
+///   pushing or popping.
+template<typename T>
+class BoundedThreadQueue : private boost::noncopyable {
+  private:
+    struct Cell {
+      std::atomic<size_t> sequence;
+      T                   data;
+    };
+    // Keep the two counters on separate cache lines so producers and
+    // consumers don't invalidate each other's.
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    boost::scoped_array<Cell> m_cells;
+    size_t                    m_mask;
+    char                      m_pad0[CACHE_LINE_SIZE];
+    std::atomic<size_t>       m_push_pos;
+    char                      m_pad1[CACHE_LINE_SIZE];
+    std::atomic<size_t>       m_pop_pos;
+    char                      m_pad2[CACHE_LINE_SIZE];
+
+  public:
+
+    /// The capacity is rounded up to a power of two.
+    BoundedThreadQueue(size_t capacity = 1024) : m_push_pos(0), m_pop_pos(0) {
+      size_t size = 2;
+      while (size < capacity)
+        size *= 2;
+      m_cells.reset(new Cell[size]);
+      m_mask = size - 1;
+      for (size_t i = 0; i < size; ++i)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /// Return the maximum number of objects the queue can hold.
+    size_t capacity() const { return m_mask + 1; }
+
+    /// Push an object on to the queue if there is room, return indicates success.
+    bool try_push(T const& data) {
+      size_t pos = m_push_pos.load(std::memory_order_relaxed);
+      Cell* cell;
+      while (true) {
+        cell = &m_cells[pos & m_mask];
+        size_t   sequence = cell->sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff    = ptrdiff_t(sequence) - ptrdiff_t(pos);
+        if (diff == 0) { // The cell is free, try to claim it.
+          if (m_push_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+            break;
+        } else if (diff < 0) { // The cell still holds an object from one lap ago.
+          return false;
+        } else { // Another producer got here first.
+          pos = m_push_pos.load(std::memory_order_relaxed);
+        }
+      }
+      cell->data = data;
+      cell->sequence.store(pos+1, std::memory_order_release);
+      return true;
+    }
+
+    /// Push an object on to the queue, waiting while it is full.
+    void push(T const& data) {
+      ThreadQueueBackoff backoff;
+      while (!try_push(data))
+        backoff.pause();
+    }
+
+    /// Returns true if the queue is empty.
+    bool empty() const { return size() == 0; }
+
+    /// Try to pop something off, return indicates success.
+    /// - Failure indicates that the queue is empty.
+    bool try_pop(T& data) {
+      size_t pos = m_pop_pos.load(std::memory_order_relaxed);
+      Cell* cell;
+      while (true) {
+        cell = &m_cells[pos & m_mask];
+        size_t   sequence = cell->sequence.load(std::memory_order_acquire);
+        ptrdiff_t diff    = ptrdiff_t(sequence) - ptrdiff_t(pos+1);
+        if (diff == 0) { // The cell is filled, try to claim it.
+          if (m_pop_pos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+            break;
+        } else if (diff < 0) { // Nothing written here yet.
+          return false;
+        } else { // Another consumer got here first.
+          pos = m_pop_pos.load(std::memory_order_relaxed);
+        }
+      }
+      data = cell->data;
+      cell->data = T(); // Don't keep the object alive until the cell is reused.
+      cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+      return true;
+    }
+
+    /// Returns the number of messages waiting in the queue.
+    size_t size() const {
+      size_t pop  = m_pop_pos.load(std::memory_order_acquire);
+      size_t push = m_push_pos.load(std::memory_order_acquire);
+      return push > pop ? push - pop : 0;
+    }
+
+    /// Wait forever until data is available, then get it.
+    void wait_pop(T& data) {
+      ThreadQueueBackoff backoff;
+      while (!try_pop(data))
+        backoff.pause();
+    }
+
+    /// Wait for data with a timeout (in ms).
+    bool timed_wait_pop(T& data, unsigned long duration) {
+      if (try_pop(data))
+        return true;
+      uint64 end_time = Stopwatch::microtime() + uint64(duration) * 1000;
+      ThreadQueueBackoff backoff;
+      while (Stopwatch::microtime() < end_time) {
+        backoff.pause();
+        if (try_pop(data))
+          return true;
+      }
+      return false;
+    }
+
+    /// Clear the contents of the queue.
+    void flush() {
+      T data;
+      while (try_pop(data)) {}
+    }
+}; // End class BoundedThreadQueue
+
 } // namespace vw
 
 
@@ -0,0 +1,95 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/Thread.h>
+
+using namespace vw;
+
+TEST(BufferPool, SizeClasses) {
+  EXPECT_EQ(100u, BufferPool::class_size(100));
+  EXPECT_EQ(32u*1024, BufferPool::class_size(32*1024));
+  EXPECT_EQ(40u*1024, BufferPool::class_size(32*1024+1));
+  EXPECT_EQ(64u*1024, BufferPool::class_size(57*1024));
+  // A 256x256 RGB float tile.
+  EXPECT_EQ(768u*1024, BufferPool::class_size(256*256*12));
+  EXPECT_EQ(1280u*1024, BufferPool::class_size(1025*1024));
+  for (size_t bytes = 32*1024; bytes < 8*1024*1024; bytes += 4093) {
+    size_t size = BufferPool::class_size(bytes);
+    EXPECT_GE(size, bytes);
+    EXPECT_LE(size, bytes + bytes/4);
+  }
+}
+
+TEST(BufferPool, Reuse) {
+  BufferPool pool(1024*1024);
+  void* a = pool.allocate(100*1024);
+  ASSERT_TRUE(a != NULL);
+  EXPECT_EQ(1u, pool.misses());
+  pool.release(a, 100*1024);
+  EXPECT_EQ(BufferPool::class_size(100*1024), pool.cached_bytes());
+
+  // Anything in the same size class gets the same buffer back.
+  void* b = pool.allocate(110*1024);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(1u, pool.hits());
+  EXPECT_EQ(0u, pool.cached_bytes());
+
+  // Small buffers are never kept.
+  void* c = pool.allocate(1000);
+  pool.release(c, 1000);
+  EXPECT_EQ(0u, pool.cached_bytes());
+  EXPECT_EQ(1u, pool.misses());
+
+  // Buffers beyond the limit are freed.
+  void* d = pool.allocate(900*1024);
+  pool.release(b, 110*1024);
+  pool.release(d, 900*1024);
+  EXPECT_EQ(BufferPool::class_size(110*1024), pool.cached_bytes());
+
+  pool.set_max_cached_bytes(0);
+  EXPECT_EQ(0u, pool.cached_bytes());
+  void* e = pool.allocate(100*1024);
+  pool.release(e, 100*1024);
+  EXPECT_EQ(0u, pool.cached_bytes());
+}
+
+namespace {
+  // Releases a buffer from another thread.
+  class ReleaseTask {
+    BufferPool& m_pool;
+    void*       m_ptr;
+  public:
+    ReleaseTask(BufferPool& pool, void* ptr) : m_pool(pool), m_ptr(ptr) {}
+    void operator()() { m_pool.release(m_ptr, 64*1024); }
+  };
+}
+
+TEST(BufferPool, OtherThread) {
+  // A buffer released on another thread's shard is still found.
+  BufferPool pool(1024*1024, 4);
+  void* a = pool.allocate(64*1024);
+  ReleaseTask task(pool, a);
+  Thread thread(task);
+  thread.join();
+  EXPECT_EQ(a, pool.allocate(64*1024));
+  EXPECT_EQ(1u, pool.hits());
+  pool.release(a, 64*1024);
+}
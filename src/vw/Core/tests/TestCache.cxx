@@ -312,3 +312,306 @@ TEST(Cache, StressTest) {
   // its time?
   EXPECT_NO_THROW( queue.join_all(); );
 }
+
+TEST(Cache, Sharded) {
+  typedef Cache::Handle<BlockGenerator> handle_t;
+
+  // Room for 3 blocks, spread over 4 shards
+  const int dimension = 16;
+  vw::Cache cache( 3*dimension*dimension, 4 );
+  ASSERT_EQ( 4u, cache.num_shards() );
+
+  std::vector<handle_t> handles;
+  for (uint8 i = 0; i < 10; ++i)
+    handles.push_back( cache.insert( BlockGenerator( dimension, i ) ) );
+  EXPECT_THROW( cache.set_num_shards(2), LogicErr );
+
+  // The byte budget is shared by all of the shards
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ( i, *handles[i] );
+    EXPECT_NO_THROW( handles[i].release() );
+    EXPECT_LE( cache.size(), cache.max_size() );
+    EXPECT_TRUE( handles[i].valid() );
+  }
+  int num_valid = 0;
+  for (int i = 0; i < 10; ++i)
+    num_valid += handles[i].valid();
+  EXPECT_EQ( 3, num_valid );
+
+  EXPECT_EQ( 0u,  cache.hits() );
+  EXPECT_EQ( 10u, cache.misses() );
+  EXPECT_EQ( 7u,  cache.evictions() );
+
+  EXPECT_EQ( 9, *handles[9] );
+  handles[9].release();
+  EXPECT_EQ( 1u, cache.hits() );
+
+  cache.resize( dimension*dimension );
+  EXPECT_LE( cache.size(), cache.max_size() );
+  cache.clear_stats();
+  EXPECT_EQ( 0u, cache.misses() );
+}
+
+TEST(Cache, ShardedStressTest) {
+  typedef Cache::Handle<ArrayDataGenerator> handle_t;
+  vw::Cache cache( 6*1024, 3 );
+
+  std::vector<handle_t> handles;
+  for ( size_t i = 0; i < 24; i++ ) {
+    handles.push_back( cache.insert( ArrayDataGenerator() ) );
+  }
+
+  FifoWorkQueue queue(12);
+  for ( size_t i = 0; i < 1000; i++ ) {
+    boost::shared_ptr<Task> task( new TestTask(handles) );
+    queue.add_task( task );
+  }
+  EXPECT_NO_THROW( queue.join_all(); );
+  EXPECT_EQ( 2000u, cache.hits() + cache.misses() );
+}
+
+TEST_F(CacheTest, ClockEviction) {
+  cache.set_eviction_policy( Cache::ClockEviction );
+
+  for (int i = 0; i < num_cache_blocks; ++i) {
+    EXPECT_EQ( i, *cache_handles[i] );
+    cache_handles[i].release();
+  }
+  // A hit on the oldest line gives it a second chance
+  EXPECT_EQ( 0, *cache_handles[0] );
+  cache_handles[0].release();
+
+  EXPECT_EQ( 3, *cache_handles[3] );
+  cache_handles[3].release();
+  EXPECT_TRUE ( cache_handles[0].valid() );
+  EXPECT_FALSE( cache_handles[1].valid() );
+  EXPECT_TRUE ( cache_handles[2].valid() );
+  EXPECT_TRUE ( cache_handles[3].valid() );
+}
+
+TEST_F(CacheTest, TwoQueueEviction) {
+  cache.set_eviction_policy( Cache::TwoQueueEviction );
+
+  // Line 0 is reused, the others are only read once
+  EXPECT_EQ( 0, *cache_handles[0] );
+  cache_handles[0].release();
+  EXPECT_EQ( 0, *cache_handles[0] );
+  cache_handles[0].release();
+
+  for (int i = 1; i < num_actual_blocks; ++i) {
+    EXPECT_EQ( i, *cache_handles[i] );
+    cache_handles[i].release();
+  }
+  EXPECT_TRUE( cache_handles[0].valid() );
+  EXPECT_TRUE( cache_handles[num_actual_blocks-1].valid() );
+}
+
+// A generator which takes a while to run
+class SlowGenerator : public BlockGenerator {
+  int m_delay_ms;
+public:
+  SlowGenerator(uint8 fill_value, int delay_ms) : BlockGenerator(16, fill_value), m_delay_ms(delay_ms) {}
+  boost::shared_ptr< value_type > generate() const {
+    Thread::sleep_ms(m_delay_ms);
+    return BlockGenerator::generate();
+  }
+};
+
+TEST(Cache, CostEviction) {
+  typedef Cache::Handle<SlowGenerator> handle_t;
+  vw::Cache cache( 2*16*16 );
+  cache.set_eviction_policy( Cache::CostEviction );
+
+  handle_t expensive = cache.insert( SlowGenerator(0, 50) );
+  handle_t cheap     = cache.insert( SlowGenerator(1, 0) );
+  handle_t next      = cache.insert( SlowGenerator(2, 0) );
+
+  EXPECT_EQ( 0, *expensive ); expensive.release();
+  EXPECT_EQ( 1, *cheap     ); cheap.release();
+  EXPECT_EQ( 2, *next      ); next.release();
+
+  // The expensive line is the oldest, but the cheap one goes first.
+  EXPECT_TRUE ( expensive.valid() );
+  EXPECT_FALSE( cheap.valid() );
+  EXPECT_TRUE ( next.valid() );
+}
+
+TEST(Cache, EvictionPolicyNames) {
+  EXPECT_EQ( Cache::LruEviction,      Cache::eviction_policy_from_string("lru"  ) );
+  EXPECT_EQ( Cache::ClockEviction,    Cache::eviction_policy_from_string("clock") );
+  EXPECT_EQ( Cache::TwoQueueEviction, Cache::eviction_policy_from_string("2q"   ) );
+  EXPECT_EQ( Cache::CostEviction,     Cache::eviction_policy_from_string("cost" ) );
+  EXPECT_THROW( Cache::eviction_policy_from_string("mru"), ArgumentErr );
+}
+
+TEST(CacheSpillFile, ReadWrite) {
+  CacheSpillFile spill( 1024*1024 );
+
+  std::vector<uint8> zeros( 10000, 0 ), noise( 10000 ), buffer;
+  uint32 seed = 1;
+  for (size_t i = 0; i < noise.size(); ++i) {
+    seed = seed * 1103515245 + 12345;
+    noise[i] = uint8(seed >> 16);
+  }
+
+  CacheSpillFile::Record a, b;
+  ASSERT_TRUE( spill.write( &zeros[0], zeros.size(), a ) );
+  ASSERT_TRUE( spill.write( &noise[0], noise.size(), b ) );
+  EXPECT_TRUE ( a.compressed );
+  EXPECT_LT   ( a.stored_size, zeros.size() );
+  EXPECT_EQ   ( a.stored_size + b.stored_size, spill.size() );
+
+  spill.read( b, buffer );
+  EXPECT_TRUE( buffer == noise );
+  spill.read( a, buffer );
+  EXPECT_TRUE( buffer == zeros );
+
+  // Freed space is reused.
+  spill.drop( a );
+  CacheSpillFile::Record c;
+  ASSERT_TRUE( spill.write( &zeros[0], zeros.size(), c ) );
+  EXPECT_EQ( a.offset, c.offset );
+
+  spill.drop( b );
+  spill.drop( c );
+  EXPECT_EQ( 0u, spill.size() );
+  EXPECT_EQ( 3u, spill.writes() );
+  EXPECT_EQ( 2u, spill.reads() );
+
+  // Blobs which don't fit are refused.
+  CacheSpillFile small( 100 );
+  EXPECT_FALSE( small.write( &noise[0], noise.size(), c ) );
+  EXPECT_EQ( 1u, small.rejects() );
+}
+
+// A value type which can be spilled, and a generator which counts its calls.
+struct SpillBlock {
+  std::vector<uint8> data;
+};
+
+namespace vw {
+  template <>
+  struct CacheSpillTraits<SpillBlock> {
+    static const bool spillable = true;
+    static void save( SpillBlock const& value, std::vector<uint8>& buffer ) {
+      buffer = value.data;
+    }
+    static boost::shared_ptr<SpillBlock> load( uint8 const* data, size_t size ) {
+      boost::shared_ptr<SpillBlock> block( new SpillBlock );
+      block->data.assign( data, data + size );
+      return block;
+    }
+  };
+}
+
+class SpillGenerator {
+  uint8 m_fill_value;
+  boost::shared_ptr<int> m_generated;
+public:
+  typedef SpillBlock value_type;
+  SpillGenerator( uint8 fill_value, boost::shared_ptr<int> generated )
+    : m_fill_value(fill_value), m_generated(generated) {}
+  size_t size() const { return 4096; }
+  boost::shared_ptr<value_type> generate() const {
+    (*m_generated)++;
+    boost::shared_ptr<value_type> block( new value_type );
+    block->data.assign( size(), m_fill_value );
+    return block;
+  }
+};
+
+TEST(Cache, SpillFile) {
+  typedef Cache::Handle<SpillGenerator> handle_t;
+  vw::Cache cache( 2*4096 );
+  boost::shared_ptr<CacheSpillFile> spill( new CacheSpillFile( 1024*1024 ) );
+  cache.set_spill_file( spill );
+
+  boost::shared_ptr<int> generated( new int(0) );
+  std::vector<handle_t> handles;
+  for (uint8 i = 0; i < 6; ++i)
+    handles.push_back( cache.insert( SpillGenerator( i, generated ) ) );
+
+  // Two passes over more lines than fit: each line is only generated once.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (uint8 i = 0; i < handles.size(); ++i) {
+      SpillBlock const& block = *handles[i];
+      EXPECT_EQ( 4096u, block.data.size() );
+      EXPECT_EQ( i, block.data[100] );
+      handles[i].release();
+    }
+  }
+  EXPECT_EQ( 6, *generated );
+  EXPECT_EQ( 6u, cache.spill_hits() );
+  EXPECT_EQ( 10u, cache.evictions() );
+  EXPECT_EQ( 6u, spill->writes() ); // Reloaded lines are not written again
+
+  // Destroying the lines frees their copies.
+  handles.clear();
+  EXPECT_EQ( 0u, spill->size() );
+}
+
+TEST_F(CacheTest, Snapshot) {
+  for (int i = 0; i < 5; ++i) {
+    *cache_handles[i];
+    cache_handles[i].release();
+  }
+  *cache_handles[4];
+  cache_handles[4].release();
+
+  Cache::Snapshot snap = cache.snapshot();
+  EXPECT_EQ( 1u, snap.hits );
+  EXPECT_EQ( 5u, snap.misses );
+  EXPECT_EQ( 2u, snap.evictions );
+  ASSERT_EQ( 1u, snap.generators.size() );
+
+  Cache::GeneratorStats const& g = snap.generators[0];
+  EXPECT_NE( std::string::npos, g.name.find("BlockGenerator") );
+  EXPECT_EQ( uint64(num_actual_blocks), g.lines );
+  EXPECT_EQ( size_t(num_cache_blocks*dimension*dimension), g.resident );
+  EXPECT_EQ( snap.size, g.resident );
+  EXPECT_EQ( 5u, g.generations );
+  EXPECT_NEAR( 1.0/6.0, g.hit_rate(), 1e-9 );
+
+  cache.clear_stats();
+  snap = cache.snapshot();
+  EXPECT_EQ( 0u, snap.generators[0].hits );
+  EXPECT_EQ( g.resident, snap.generators[0].resident );
+}
+
+TEST_F(CacheTest, MemoryGovernor) {
+  const size_t block_size = dimension*dimension;
+  MemoryGovernor governor(5*block_size);
+  cache.set_memory_governor(&governor, "test cache");
+  for (int i = 0; i < 3; ++i) {
+    *cache_handles[i];
+    cache_handles[i].release();
+  }
+  EXPECT_EQ( 3*block_size, governor.used() );
+
+  // The first request fits, for the second one the cache gives up two lines.
+  MemoryGovernor::Account other(governor, "other");
+  EXPECT_TRUE( other.try_reserve(2*block_size) );
+  EXPECT_EQ( 3*block_size, cache.size() );
+  EXPECT_TRUE( other.try_reserve(2*block_size) );
+  EXPECT_EQ( block_size, cache.size() );
+  EXPECT_TRUE( cache_handles[2].valid() );
+  EXPECT_EQ( 5*block_size, governor.used() );
+
+  // While the governor is full, loading a line evicts an older one even
+  // though the cache is below its own maximum.
+  *cache_handles[5];
+  cache_handles[5].release();
+  EXPECT_EQ( block_size, cache.size() );
+  EXPECT_FALSE( cache_handles[2].valid() );
+
+  std::vector<MemoryGovernor::Usage> usage = governor.usage();
+  ASSERT_EQ( 2u, usage.size() );
+  EXPECT_EQ( "test cache", usage[0].name );
+  EXPECT_EQ( block_size, usage[0].used );
+  EXPECT_EQ( 3*block_size, usage[0].peak );
+  EXPECT_EQ( 4*block_size, usage[1].used );
+
+  other.release(4*block_size);
+  cache.set_memory_governor(0);
+  EXPECT_EQ( 0u, governor.used() );
+}
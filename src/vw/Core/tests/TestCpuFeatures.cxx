@@ -0,0 +1,89 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <vw/Core/CpuFeatures.h>
+#include <vw/Core/ConfigParser.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <test/Helpers.h>
+
+#include <sstream>
+
+using namespace vw;
+
+namespace {
+  int kernel_generic() { return 0; }
+  int kernel_popcnt () { return 1; }
+  int kernel_avx2   () { return 2; }
+  typedef int (*KernelFunc)();
+}
+
+TEST(CpuFeatures, Dispatch) {
+  CpuDispatch<KernelFunc> dispatch( &kernel_generic );
+  dispatch.add( CPU_AVX2 | CPU_POPCNT, &kernel_avx2 ).add( CPU_POPCNT, &kernel_popcnt );
+
+  EXPECT_EQ( 0, dispatch.select( 0 )() );
+  EXPECT_EQ( 0, dispatch.select( CPU_AVX2 )() );
+  EXPECT_EQ( 1, dispatch.select( CPU_SSE2 | CPU_POPCNT )() );
+  EXPECT_EQ( 2, dispatch.select( CPU_SSE2 | CPU_POPCNT | CPU_AVX2 )() );
+}
+
+TEST(CpuFeatures, IsaNames) {
+  EXPECT_EQ( 0u, simd_isa_features( "scalar" ) );
+  EXPECT_EQ( uint32(CPU_SSE2), simd_isa_features( "sse2" ) );
+  EXPECT_EQ( uint32(CPU_SSE2 | CPU_POPCNT | CPU_AVX2), simd_isa_features( "avx2" ) );
+  EXPECT_TRUE( simd_isa_features( "avx512" ) & CPU_AVX512BW );
+  EXPECT_EQ( uint32(CPU_NEON), simd_isa_features( "neon" ) );
+  EXPECT_THROW( simd_isa_features( "mmx" ), ArgumentErr );
+
+  EXPECT_EQ( "sse2 popcnt avx2", cpu_feature_names( CPU_AVX2 | CPU_POPCNT | CPU_SSE2 ) );
+  EXPECT_EQ( "", cpu_feature_names( 0 ) );
+}
+
+TEST(CpuFeatures, Setting) {
+  const uint32 detected = cpu_detected_features();
+
+  vw_settings().set_simd_isa( "scalar" );
+  EXPECT_EQ( 0u, cpu_features() );
+  EXPECT_FALSE( cpu_has( CPU_SSE2 ) );
+  CpuDispatch<KernelFunc> dispatch( &kernel_generic );
+  dispatch.add( CPU_POPCNT, &kernel_popcnt );
+  EXPECT_EQ( 0, dispatch.select()() );
+
+  vw_settings().set_simd_isa( "sse4" );
+  EXPECT_EQ( detected & (CPU_SSE2 | CPU_POPCNT), cpu_features() );
+
+  vw_settings().set_simd_isa( "auto" );
+  EXPECT_EQ( detected, cpu_features() );
+  EXPECT_TRUE( cpu_has( 0 ) );
+}
+
+TEST(CpuFeatures, ConfigFile) {
+  Settings settings;
+  std::istringstream good( "[general]\nsimd_isa = sse2\n" );
+  parse_config( good, settings );
+  EXPECT_EQ( "sse2", settings.simd_isa() );
+
+  // An unknown name is reported and ignored.
+  std::istringstream bad( "[general]\nsimd_isa = mmx\n" );
+  parse_config( bad, settings );
+  EXPECT_EQ( "sse2", settings.simd_isa() );
+
+  vw_settings().set_simd_isa( "auto" );
+}
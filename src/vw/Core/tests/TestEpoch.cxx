@@ -0,0 +1,111 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/Core/Epoch.h>
+#include <vw/Core/Thread.h>
+
+#include <atomic>
+
+using namespace vw;
+
+// Counts the live objects, and poisons its value when freed.
+struct Tracked {
+  static std::atomic<int> live;
+  int value;
+  Tracked( int v ) : value(v) { ++live; }
+  ~Tracked() { value = -1; --live; }
+};
+std::atomic<int> Tracked::live(0);
+
+TEST( Epoch, RetireWithoutReaders ) {
+  epoch_reclaim();
+  const int live = Tracked::live;
+  epoch_retire( new Tracked(1) );
+  EXPECT_EQ( live, Tracked::live );
+  EXPECT_EQ( 0u, epoch_reclaim() );
+}
+
+TEST( Epoch, GuardDefersFree ) {
+  epoch_reclaim();
+  const int live = Tracked::live;
+  {
+    EpochGuard guard;
+    {
+      EpochGuard nested;
+      epoch_retire( new Tracked(2) );
+    }
+    EXPECT_EQ( live + 1, Tracked::live );
+    EXPECT_EQ( 1u, epoch_reclaim() );
+  }
+  // A guard made after the retire does not hold the object.
+  EpochGuard later;
+  EXPECT_EQ( 0u, epoch_reclaim() );
+  EXPECT_EQ( live, Tracked::live );
+}
+
+// Reads the shared object under a guard until told to stop, counting
+// the reads which see it change, as it would if it were freed and its
+// memory used again.
+class EpochReader {
+  std::atomic<Tracked const*> &m_shared;
+  std::atomic<bool> &m_stop;
+  std::atomic<int> &m_started, &m_bad_reads;
+public:
+  EpochReader( std::atomic<Tracked const*> &shared, std::atomic<bool> &stop,
+               std::atomic<int> &started, std::atomic<int> &bad_reads )
+    : m_shared(shared), m_stop(stop), m_started(started), m_bad_reads(bad_reads) {}
+  void operator()() {
+    ++m_started;
+    while ( !m_stop ) {
+      EpochGuard guard;
+      Tracked const* t = m_shared.load( std::memory_order_acquire );
+      int const volatile& value = t->value;
+      const int first = value;
+      for ( int i = 0; i < 100; ++i )
+        if ( value != first )
+          ++m_bad_reads;
+    }
+  }
+};
+
+TEST( Epoch, ConcurrentReplace ) {
+  epoch_reclaim();
+  const int live = Tracked::live;
+  std::atomic<Tracked const*> shared( new Tracked(0) );
+  std::atomic<bool> stop(false);
+  std::atomic<int> started(0), bad_reads(0);
+  {
+    std::vector<boost::shared_ptr<Thread> > readers;
+    for ( int i = 0; i < 4; ++i )
+      readers.push_back( boost::shared_ptr<Thread>
+                         ( new Thread( EpochReader( shared, stop, started, bad_reads ) ) ) );
+    while ( started < 4 )
+      Thread::yield();
+    for ( int i = 1; i <= 50000; ++i )
+      epoch_retire( shared.exchange( new Tracked(i) ) );
+    stop = true;
+    for ( size_t i = 0; i < readers.size(); ++i )
+      readers[i]->join();
+  }
+  EXPECT_EQ( 0, bad_reads );
+  EXPECT_EQ( 0u, epoch_reclaim() );
+  EXPECT_EQ( live + 1, Tracked::live );
+  delete shared.load();
+}
@@ -330,6 +330,44 @@ TEST(Log, HiresProgressCallback) {
   EXPECT_THROW(TerminalProgressCallback("monkey","monkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkeymonkey"), ArgumentErr );
 }
 
+struct TestProgressTask {
+  ProgressCallback const& m_progress;
+  int m_count;
+  double m_step;
+  TestProgressTask(ProgressCallback const& progress, int count, double step)
+    : m_progress(progress), m_count(count), m_step(step) {}
+  void operator()() {
+    for (int i = 0; i < m_count; ++i)
+      m_progress.report_incremental_progress(m_step);
+  }
+};
+
+TEST(Log, ProgressFromThreads) {
+  std::ostringstream sstr;
+
+  raii fix(boost::bind(&Log::set_console_stream, boost::ref(vw_log()), boost::ref(sstr),      LogRuleSet(),  false),
+           boost::bind(&Log::set_console_stream, boost::ref(vw_log()), boost::ref(std::cout), LogRuleSet(), false));
+
+  // Workers report into the second half through a sub-callback.
+  const int num_threads = 8, count = 1000;
+  TerminalProgressCallback pc( "test", "Threads: " );
+  pc.report_progress(0.5);
+  SubProgressCallback sub( pc, 0.5, 1.0 );
+  std::vector<boost::shared_ptr<Thread> > threads;
+  for (int i = 0; i < num_threads; ++i)
+    threads.push_back(boost::shared_ptr<Thread>(new Thread(TestProgressTask(sub, count, 1.0/(num_threads*count)))));
+  for (int i = 0; i < num_threads; ++i)
+    threads[i]->join();
+
+  // No increment is lost.
+  EXPECT_NEAR( 1.0, pc.progress(),  1e-9 );
+  EXPECT_NEAR( 1.0, sub.progress(), 1e-9 );
+
+  pc.report_finished();
+  const std::string &out = sstr.str();
+  EXPECT_TRUE(boost::iends_with(out, std::string("***] Complete!\n")));
+}
+
 TEST(Log, ProgressHide) {
 
   std::ostringstream sstr;
@@ -539,3 +577,60 @@ TEST(Log, LazyIsEnabled) {
            boost::bind(&Log::set_console_stream, boost::ref(vw_log()), boost::ref(std::cout), LogRuleSet(), false));
   VW_OUT() << "You should see me once\n";
 }
+
+TEST(Log, AsyncWriter) {
+  std::ostringstream stream;
+  {
+    LogInstance log(stream, false);
+    log.rule_set().add_rule(EveryMessage, "log test");
+    boost::shared_ptr<AsyncLogWriter> writer(new AsyncLogWriter(4));
+    log.set_writer(writer);
+
+    // More lines than the queue holds, so some wait for room.
+    for (int i = 0; i < 100; ++i)
+      log(InfoMessage, "log test") << "Line " << i << "\n";
+    writer->flush();
+
+    std::istringstream rd(stream.str());
+    std::string typ;
+    int id;
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_TRUE(bool(rd >> typ >> id));
+      EXPECT_EQ("Line", typ);
+      EXPECT_EQ(i, id);
+    }
+    EXPECT_FALSE(bool(rd >> typ));
+
+    // A line left queued is written when the log lets go of the writer.
+    log(InfoMessage, "log test") << "Last\n";
+  }
+  EXPECT_TRUE(boost::ends_with(stream.str(), "Line 99\nLast\n"));
+}
+
+TEST(Log, AsyncSystemLog) {
+  std::ostringstream sstr;
+
+  raii fix(boost::bind(&Log::set_console_stream, boost::ref(vw_log()), boost::ref(sstr),      LogRuleSet(),  false),
+           boost::bind(&Log::set_console_stream, boost::ref(vw_log()), boost::ref(std::cout), LogRuleSet(), false));
+
+  vw_log().set_asynchronous(true);
+  EXPECT_TRUE(vw_log().asynchronous());
+
+  // The answer of is_enabled() is cached, but follows the rules.
+  EXPECT_FALSE(vw_log().is_enabled(DebugMessage, "async test"));
+  vw_log().console_log().rule_set().add_rule(DebugMessage, "async test");
+  EXPECT_TRUE(vw_log().is_enabled(DebugMessage, "async test"));
+
+  VW_OUT(DebugMessage, "async test") << "\tTesting asynchronous system log\n";
+  VW_OUT(VerboseDebugMessage, "async test") << "\tYou should not see this message.\n";
+  vw_log().flush();
+  EXPECT_EQ("\tTesting asynchronous system log\n", sstr.str());
+
+  vw_log().set_asynchronous(false);
+  EXPECT_FALSE(vw_log().asynchronous());
+  vw_out(DebugMessage, "async test") << "\tTesting synchronous system log\n";
+  EXPECT_EQ("\tTesting asynchronous system log\n\tTesting synchronous system log\n", sstr.str());
+
+  vw_log().console_log().rule_set().clear();
+  EXPECT_FALSE(vw_log().is_enabled(DebugMessage, "async test"));
+}
@@ -0,0 +1,107 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/Thread.h>
+
+using namespace vw;
+
+namespace {
+  // Reserves bytes from another thread and records when that returned.
+  class ReserveTask {
+    MemoryGovernor::Account& m_account;
+    size_t                   m_bytes;
+    bool&                    m_done;
+  public:
+    ReserveTask(MemoryGovernor::Account& account, size_t bytes, bool& done)
+      : m_account(account), m_bytes(bytes), m_done(done) {}
+    void operator()() {
+      m_account.reserve(m_bytes);
+      m_done = true;
+    }
+  };
+}
+
+TEST(MemoryGovernor, Accounting) {
+  MemoryGovernor governor(100);
+  {
+    MemoryGovernor::Account a(governor, "a"), b(governor, "b");
+    EXPECT_TRUE ( a.try_reserve(60) );
+    EXPECT_FALSE( b.try_reserve(50) );
+    EXPECT_TRUE ( b.try_reserve(40) );
+    EXPECT_FALSE( governor.over_budget() );
+
+    // A charge is counted even if it does not fit.
+    b.charge(30);
+    EXPECT_EQ( 130u, governor.used() );
+    EXPECT_TRUE( governor.over_budget() );
+    b.release(30);
+    EXPECT_EQ( 70u, b.peak() );
+    EXPECT_EQ( 40u, b.used() );
+
+    // An account which holds nothing is never blocked.
+    MemoryGovernor::Account c(governor, "c");
+    c.reserve(500);
+    EXPECT_EQ( 600u, governor.used() );
+
+    std::vector<MemoryGovernor::Usage> usage = governor.usage();
+    ASSERT_EQ( 3u, usage.size() );
+    EXPECT_EQ( "a", usage[0].name );
+    EXPECT_EQ( 60u, usage[0].used );
+    EXPECT_EQ( "c", usage[2].name );
+  }
+  // Whatever was still held is released with the account.
+  EXPECT_EQ( 0u, governor.used() );
+  EXPECT_TRUE( governor.usage().empty() );
+
+  // No budget means no limit.
+  MemoryGovernor unlimited;
+  MemoryGovernor::Account d(unlimited, "d");
+  EXPECT_TRUE( d.try_reserve(size_t(1) << 40) );
+  EXPECT_FALSE( unlimited.over_budget() );
+}
+
+TEST(MemoryGovernor, BlockingReserve) {
+  MemoryGovernor governor(100);
+  MemoryGovernor::Account a(governor, "a"), b(governor, "b");
+  a.reserve(60);
+  b.reserve(30);
+
+  bool done = false;
+  Thread waiter((ReserveTask(b, 30, done)));
+  Thread::sleep_ms(100);
+  EXPECT_FALSE( done );
+  EXPECT_TRUE( governor.over_budget() );
+
+  a.release(60);
+  waiter.join();
+  EXPECT_TRUE( done );
+  EXPECT_EQ( 60u, b.used() );
+
+  // Raising the budget lets a waiter through as well.
+  done = false;
+  Thread waiter2((ReserveTask(b, 100, done)));
+  Thread::sleep_ms(100);
+  EXPECT_FALSE( done );
+  governor.set_budget(200);
+  waiter2.join();
+  EXPECT_TRUE( done );
+  EXPECT_EQ( 160u, governor.used() );
+}
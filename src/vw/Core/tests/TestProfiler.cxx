@@ -0,0 +1,100 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/Core/Profiler.h>
+#include <vw/Core/Thread.h>
+
+#include <sstream>
+
+using namespace vw;
+
+namespace {
+  class ZoneTask {
+  public:
+    void operator()() {
+      VW_PROFILE_ZONE("worker");
+      Thread::sleep_ms(2);
+    }
+  };
+
+  class BurstTask {
+  public:
+    void operator()() {
+      for (int i = 0; i < 10; ++i)
+        Profiler::record("burst", i+1, i+2);
+    }
+  };
+}
+
+TEST(Profiler, Zones) {
+  Profiler::clear();
+
+  { // Nothing is recorded while disabled
+    VW_PROFILE_ZONE("disabled");
+  }
+  EXPECT_TRUE( Profiler::events().empty() );
+
+  Profiler::set_enabled(true);
+  {
+    VW_PROFILE_ZONE("outer");
+    {
+      VW_PROFILE_ZONE("inner");
+      Thread::sleep_ms(2);
+    }
+    Thread worker((ZoneTask()));
+    worker.join();
+  }
+  Profiler::set_enabled(false);
+
+  std::vector<Profiler::Event> events = Profiler::events();
+  ASSERT_EQ( 3u, events.size() );
+  // Sorted by start time, so the outer zone comes first.
+  EXPECT_STREQ( "outer", events[0].name );
+  EXPECT_STREQ( "inner", events[1].name );
+  EXPECT_STREQ( "worker", events[2].name );
+  EXPECT_LE( events[0].start_us, events[1].start_us );
+  EXPECT_GE( events[0].end_us,   events[2].end_us   );
+  EXPECT_EQ( events[0].thread, events[1].thread );
+  EXPECT_NE( events[0].thread, events[2].thread );
+
+  std::ostringstream trace;
+  Profiler::write_chrome_trace(trace);
+  EXPECT_NE( std::string::npos, trace.str().find("\"name\":\"inner\",\"ph\":\"X\"") );
+  EXPECT_NE( std::string::npos, trace.str().find("\"traceEvents\":[") );
+
+  Profiler::clear();
+  EXPECT_TRUE( Profiler::events().empty() );
+}
+
+TEST(Profiler, RingBuffer) {
+  // Only threads which start recording afterwards get the new size.
+  size_t old_size = Profiler::buffer_size();
+  Profiler::set_buffer_size(4);
+
+  Profiler::clear();
+  Thread thread((BurstTask()));
+  thread.join();
+  Profiler::set_buffer_size(old_size);
+
+  // Only the newest events are kept.
+  std::vector<Profiler::Event> events = Profiler::events();
+  ASSERT_EQ( 4u, events.size() );
+  EXPECT_EQ( 7u,  events[0].start_us );
+  EXPECT_EQ( 10u, events[3].start_us );
+}
@@ -76,6 +76,52 @@ TEST(Settings, Override) {
   EXPECT_EQ( 223u, vw_settings().system_cache_size() );
 }
 
+TEST(Settings, Snapshot) {
+  Settings::Snapshot before = vw_settings().snapshot();
+  const uint64 version = vw_settings().version();
+  const uint32 threads = before.default_num_threads;
+
+  vw_settings().set_default_num_threads(threads + 3);
+  EXPECT_EQ( version + 1, vw_settings().version() );
+  EXPECT_EQ( threads + 3, vw_settings().snapshot().default_num_threads );
+  EXPECT_EQ( threads + 3, vw_settings().default_num_threads() );
+  EXPECT_TRUE( vw_settings().snapshot().default_num_threads_override );
+
+  // A copy of an older snapshot stays as it was.
+  EXPECT_EQ( version, before.version );
+  EXPECT_EQ( threads, before.default_num_threads );
+  EXPECT_EQ( before.default_tile_size, vw_settings().snapshot().default_tile_size );
+
+  // With no reads in progress, the replaced snapshot has been freed.
+  EXPECT_EQ( 0u, epoch_reclaim() );
+}
+
+#ifdef __linux__
+// A change to the rc file is seen without waiting for the poll period,
+// even within the same second as the last one.
+TEST(Settings, HAS_CONFIG_FILE(WatchVWrc)) {
+  UnlinkName file("test_watch_vwrc");
+  {
+    std::ofstream ostr(file.c_str());
+    ASSERT_TRUE(ostr.is_open()) << "Could not open test config file for writing";
+    ostr << "[general]\ndefault_tile_size = 128\n";
+  }
+  vw_settings().set_rc_filename(file);
+  EXPECT_EQ( 128u, vw_settings().default_tile_size() );
+
+  {
+    std::ofstream ostr(file.c_str());
+    ostr << "[general]\ndefault_tile_size = 512\n";
+  }
+  for (int i = 0; i < 500 && vw_settings().default_tile_size() != 512; i++)
+    Thread::sleep_ms(10);
+  EXPECT_EQ( 512u, vw_settings().default_tile_size() );
+
+  vw_settings().set_rc_filename("");
+  vw_settings().set_default_tile_size(256);
+}
+#endif
+
 TEST(SettingsDeathTest, OldVWrc) {
   ::testing::FLAGS_gtest_death_test_style = "threadsafe";
 
@@ -18,7 +18,9 @@
 
 #include <gtest/gtest_VW.h>
 
+#include <vw/Core/Exception.h>
 #include <vw/Core/ThreadPool.h>
+#include <vw/Core/Numa.h>
 
 #include <iostream>
 
@@ -223,3 +225,203 @@ TEST(ThreadPool, OrderedWorkQueue) {
 
   queue.join_all();
 }
+
+class CountingTask : public Task, private boost::noncopyable {
+  Mutex & m_mutex;
+  int   & m_count;
+public:
+  CountingTask(Mutex& mutex, int& count) : m_mutex(mutex), m_count(count) {}
+  void operator()() {
+    Mutex::Lock lock(m_mutex);
+    m_count++;
+  }
+};
+
+TEST(ThreadPool, WorkStealingWorkQueue) {
+  boost::shared_ptr<TestTask> task1 (new TestTask);
+  boost::shared_ptr<TestTask> task2 (new TestTask);
+  boost::shared_ptr<TestTask> task3 (new TestTask);
+
+  WorkStealingWorkQueue queue(2);
+  queue.add_task(task1);
+  queue.add_task(task2);
+  queue.add_task(task3);
+
+  Thread::sleep_ms(200);
+  EXPECT_EQ( 2, task1->value() + task2->value() + task3->value() );
+  EXPECT_EQ( 1u, queue.size() );
+
+  // Finishing one task lets the waiting one start, whichever list it is in.
+  task1->kill();
+  task2->kill();
+  Thread::sleep_ms(200);
+  EXPECT_EQ( 1, task3->value() );
+  EXPECT_EQ( 0u, queue.size() );
+  task3->kill();
+  queue.join_all();
+  EXPECT_EQ( 3, task1->value() );
+  EXPECT_EQ( 3, task2->value() );
+  EXPECT_EQ( 3, task3->value() );
+
+  // Lots of tiny tasks, every one of them must run exactly once.
+  Mutex mutex;
+  int   count = 0;
+  WorkStealingWorkQueue busy_queue(8);
+  for (int i = 0; i < 5000; ++i)
+    busy_queue.add_task(boost::shared_ptr<Task>(new CountingTask(mutex, count)));
+  busy_queue.join_all();
+  EXPECT_EQ( 5000, count );
+  EXPECT_EQ( 0u, busy_queue.size() );
+}
+
+TEST(ThreadPool, Stats) {
+  boost::shared_ptr<TestTask> task1 (new TestTask);
+  boost::shared_ptr<TestTask> task2 (new TestTask);
+
+  FifoWorkQueue queue(1);
+  queue.set_name("test queue");
+  queue.add_task(task1);
+  queue.add_task(task2);
+  Thread::sleep_ms(100);
+
+  WorkQueue::Stats stats = queue.stats();
+  EXPECT_EQ( "test queue", stats.name );
+  EXPECT_EQ( 1, stats.max_threads );
+  EXPECT_EQ( 1, stats.active_threads );
+  EXPECT_EQ( 1u, stats.queued );
+  EXPECT_EQ( 0u, stats.tasks_run );
+
+  // Every live queue is listed.
+  std::vector<WorkQueue::Stats> all = WorkQueue::all_stats();
+  bool found = false;
+  for (size_t i = 0; i < all.size(); ++i)
+    found = found || all[i].name == "test queue";
+  EXPECT_TRUE( found );
+
+  task1->kill();
+  task2->kill();
+  queue.join_all();
+  stats = queue.stats();
+  EXPECT_EQ( 0, stats.active_threads );
+  EXPECT_EQ( 0u, stats.queued );
+  EXPECT_EQ( 2u, stats.tasks_run );
+  EXPECT_GT( stats.busy_us, 0u );
+}
+
+TEST(ThreadPool, Numa) {
+  std::vector<int> cpus = numa_parse_cpulist("0-2,5,8-9\n");
+  ASSERT_EQ( 6u, cpus.size() );
+  EXPECT_EQ( 2, cpus[2] );
+  EXPECT_EQ( 5, cpus[3] );
+  EXPECT_EQ( 9, cpus[5] );
+
+  // Every worker belongs to exactly the node whose range contains it.
+  const int num_workers = 7, num_nodes = 3;
+  for (int node = 0; node < num_nodes; ++node) {
+    int begin, end;
+    numa_workers_for_node(node, num_workers, num_nodes, begin, end);
+    EXPECT_LT( begin, end );
+    for (int w = begin; w < end; ++w)
+      EXPECT_EQ( node, numa_node_for_worker(w, num_workers, num_nodes) );
+  }
+  EXPECT_EQ( 0, numa_node_for_worker(5, num_workers, 1) );
+  EXPECT_GE( numa_num_nodes(), 1 );
+
+  // Tasks given to a particular worker still all run when pinning is on.
+  bool numa_aware = vw_settings().numa_aware();
+  vw_settings().set_numa_aware(true);
+  Mutex mutex;
+  int   count = 0;
+  WorkStealingWorkQueue queue(4);
+  vw_settings().set_numa_aware(numa_aware);
+  EXPECT_EQ( numa_num_nodes(), queue.numa_nodes() );
+  for (int i = 0; i < 100; ++i)
+    queue.add_task(boost::shared_ptr<Task>(new CountingTask(mutex, count)), i % 2);
+  queue.join_all();
+  EXPECT_EQ( 100, count );
+}
+
+class RecordingTask : public Task, private boost::noncopyable {
+  Mutex            & m_mutex;
+  std::vector<int> & m_order;
+  int                m_id;
+public:
+  bool discarded;
+  RecordingTask(Mutex& mutex, std::vector<int>& order, int id, int priority)
+    : m_mutex(mutex), m_order(order), m_id(id), discarded(false) { set_priority(priority); }
+  void operator()() {
+    Mutex::Lock lock(m_mutex);
+    m_order.push_back(m_id);
+  }
+  void discard() { discarded = true; }
+};
+
+template <class QueueT>
+void check_priority_order() {
+  // Keep the only worker busy while the tasks are queued.
+  boost::shared_ptr<TestTask> blocker (new TestTask);
+  QueueT queue(1);
+  queue.add_task(blocker);
+  Thread::sleep_ms(100);
+
+  Mutex mutex;
+  std::vector<int> order;
+  const int priorities[] = { Task::PriorityLow, Task::PriorityNormal, Task::PriorityHigh,
+                             Task::PriorityLow, Task::PriorityHigh, Task::PriorityNormal };
+  for (int i = 0; i < 6; ++i)
+    queue.add_task(boost::shared_ptr<Task>(new RecordingTask(mutex, order, i, priorities[i])));
+  blocker->kill();
+  queue.join_all();
+
+  // Highest priority first, in the order they were added within a priority.
+  const int expected[] = { 2, 4, 1, 5, 0, 3 };
+  ASSERT_EQ( 6u, order.size() );
+  for (int i = 0; i < 6; ++i)
+    EXPECT_EQ( expected[i], order[i] );
+}
+
+TEST(ThreadPool, Priority) {
+  check_priority_order<FifoWorkQueue>();
+  check_priority_order<WorkStealingWorkQueue>();
+
+  boost::shared_ptr<TestTask> task (new TestTask);
+  EXPECT_EQ( Task::PriorityNormal, task->priority() );
+  EXPECT_THROW( task->set_priority(Task::NumPriorities), ArgumentErr );
+}
+
+TEST(ThreadPool, Cancel) {
+  boost::shared_ptr<TestTask> blocker (new TestTask);
+  FifoWorkQueue queue(1);
+  queue.add_task(blocker);
+  Thread::sleep_ms(100);
+
+  Mutex mutex;
+  std::vector<int> order;
+  boost::shared_ptr<CancelToken> token (new CancelToken);
+  std::vector<boost::shared_ptr<RecordingTask> > tasks;
+  for (int i = 0; i < 4; ++i) {
+    tasks.push_back(boost::shared_ptr<RecordingTask>(new RecordingTask(mutex, order, i, Task::PriorityNormal)));
+    if (i % 2 == 0)
+      tasks.back()->set_cancel_token(token);
+    queue.add_task(tasks.back());
+  }
+  token->cancel();
+  EXPECT_THROW( token->throw_if_cancelled(), Aborted );
+  blocker->kill();
+  queue.join_all();
+
+  // Only the tasks without the token ran, the others were discarded but
+  // still count as finished so that join() returns.
+  ASSERT_EQ( 2u, order.size() );
+  EXPECT_EQ( 1, order[0] );
+  EXPECT_EQ( 3, order[1] );
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ( i % 2 == 0, tasks[i]->discarded );
+    EXPECT_TRUE( tasks[i]->is_finished() );
+    tasks[i]->join();
+  }
+  WorkQueue::Stats stats = queue.stats();
+  EXPECT_EQ( 3u, stats.tasks_run );
+  EXPECT_EQ( 2u, stats.tasks_cancelled );
+  EXPECT_EQ( 0u, stats.queued );
+}
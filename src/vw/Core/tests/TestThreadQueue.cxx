@@ -37,11 +37,12 @@ TEST(ThreadQueue, Basic) {
   }
 }
 
+template <class QueueT>
 class PushTask {
-    ThreadQueue<uint32>& m_queue;
+    QueueT& m_queue;
     unsigned m_count, m_value;
   public:
-    PushTask(ThreadQueue<uint32>& q, uint32 count, uint32 value) : m_queue(q), m_count(count), m_value(value) {}
+    PushTask(QueueT& q, uint32 count, uint32 value) : m_queue(q), m_count(count), m_value(value) {}
     void operator()() {
       for (uint32 i = 0; i < m_count; ++i) {
         m_queue.push(m_value);
@@ -50,7 +51,7 @@ class PushTask {
 };
 
 TEST(ThreadQueue, Threaded) {
-  typedef boost::shared_ptr<PushTask>    TheTask;
+  typedef boost::shared_ptr<PushTask<ThreadQueue<uint32> > > TheTask;
   typedef boost::shared_ptr<vw::Thread>  TheThread;
 
   ThreadQueue<uint32> q;
@@ -59,7 +60,7 @@ TEST(ThreadQueue, Threaded) {
   std::vector<std::pair<TheTask, TheThread> > threads(20);
 
   for (size_t i = 0; i < threads.size(); ++i) {
-    TheTask task(new PushTask(q, 10, uint32(i)));
+    TheTask task(new PushTask<ThreadQueue<uint32> >(q, 10, uint32(i)));
     TheThread thread( new Thread(task) );
     threads[i] = std::make_pair(task, thread);
   }
@@ -84,3 +85,82 @@ TEST(ThreadQueue, Threaded) {
     EXPECT_EQ(10u, ret[i]);
   }
 }
+
+TEST(BoundedThreadQueue, Basic) {
+  BoundedThreadQueue<uint32> q(50);
+  EXPECT_EQ(64u, q.capacity());
+
+  ASSERT_TRUE(q.empty());
+  for (uint32 i = 0; i < 64; ++i)
+    EXPECT_TRUE(q.try_push(i));
+  EXPECT_FALSE(q.try_push(64));
+  EXPECT_EQ(64u, q.size());
+
+  uint32 pop;
+  for (uint32 i = 0; i < 64; ++i) {
+    ASSERT_FALSE(q.empty());
+    q.wait_pop(pop);
+    EXPECT_EQ(i, pop);
+  }
+  EXPECT_FALSE(q.try_pop(pop));
+  EXPECT_FALSE(q.timed_wait_pop(pop, 10));
+
+  q.push(7);
+  q.flush();
+  EXPECT_TRUE(q.empty());
+}
+
+class PopTask {
+    BoundedThreadQueue<uint32>& m_queue;
+    std::vector<uint32>         m_counts;
+  public:
+    PopTask(BoundedThreadQueue<uint32>& q, size_t num_values) : m_queue(q), m_counts(num_values) {}
+    void operator()() {
+      // A value past the end tells this consumer to stop.
+      uint32 value;
+      while (true) {
+        m_queue.wait_pop(value);
+        if (value >= m_counts.size())
+          return;
+        m_counts[value]++;
+      }
+    }
+    std::vector<uint32> const& counts() const { return m_counts; }
+};
+
+TEST(BoundedThreadQueue, Threaded) {
+  typedef boost::shared_ptr<vw::Thread> TheThread;
+
+  // Much smaller than the number of values, so producers block on a full queue.
+  BoundedThreadQueue<uint32> q(16);
+  const size_t num_producers = 8, num_consumers = 4, count = 2000;
+
+  std::vector<boost::shared_ptr<PopTask> > consumers;
+  std::vector<TheThread> consumer_threads;
+  for (size_t i = 0; i < num_consumers; ++i) {
+    consumers.push_back(boost::shared_ptr<PopTask>(new PopTask(q, num_producers)));
+    consumer_threads.push_back(TheThread(new Thread(consumers.back())));
+  }
+
+  std::vector<TheThread> producer_threads;
+  for (size_t i = 0; i < num_producers; ++i) {
+    boost::shared_ptr<PushTask<BoundedThreadQueue<uint32> > >
+      task(new PushTask<BoundedThreadQueue<uint32> >(q, count, uint32(i)));
+    producer_threads.push_back(TheThread(new Thread(task)));
+  }
+  for (size_t i = 0; i < num_producers; ++i)
+    producer_threads[i]->join();
+  for (size_t i = 0; i < num_consumers; ++i)
+    q.push(uint32(num_producers));
+  for (size_t i = 0; i < num_consumers; ++i)
+    consumer_threads[i]->join();
+
+  // Every value was popped exactly once.
+  EXPECT_TRUE(q.empty());
+  for (size_t v = 0; v < num_producers; ++v) {
+    uint32 total = 0;
+    for (size_t i = 0; i < num_consumers; ++i)
+      total += consumers[i]->counts()[v];
+    EXPECT_EQ(count, total);
+  }
+}
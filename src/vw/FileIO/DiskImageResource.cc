@@ -36,6 +36,7 @@
 #include <vw/FileIO/DiskImageResourcePDS.h>
 #include <vw/FileIO/DiskImageResourcePBM.h>
 #include <vw/FileIO/DiskImageResourceRaw.h>
+#include <vw/FileIO/DiskImageResourceMapped.h>
 
 #if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
 #include <vw/FileIO/DiskImageResourcePNG.h>
@@ -207,18 +208,27 @@ static void register_default_file_types_impl() {
   REGISTER(".exr", OpenEXR)
 #endif
 
-  // Filetypes that are always supported
-  REGISTER(".pbm", PBM)
-  REGISTER(".pgm", PBM)
-  REGISTER(".ppm", PBM)
-  REGISTER(".bil", Raw)
-  REGISTER(".bip", Raw)
-  REGISTER(".bsq", Raw)
+  // Filetypes that are always supported. These are memory-mapped when the
+  // file layout allows it, and otherwise handled by the PBM and Raw drivers.
+  REGISTER(".pbm", Mapped)
+  REGISTER(".pgm", Mapped)
+  REGISTER(".ppm", Mapped)
+  REGISTER(".bil", Mapped)
+  REGISTER(".bip", Mapped)
+  REGISTER(".bsq", Mapped)
 #undef REGISTER
 }
 
 vw::DiskImageResource* vw::DiskImageResource::open( std::string const& filename ) {
   register_default_file_types_internal();
+
+  // Only GDAL can read images straight out of object stores and off
+  // web servers, whatever their extension.
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+  if (vw::DiskImageResourceGDAL::is_remote( filename ))
+    return vw::DiskImageResourceGDAL::construct_open(filename);
+#endif
+
   std::string extension = boost::to_lower_copy(fs::path(filename).extension().string());
 
   if( open_map ) {
@@ -270,9 +280,44 @@ vw::DiskImageResource* vw::DiskImageResource::create( std::string const& filenam
   return 0; // never reached
 }
 
+bool vw::file_stamp( std::string const& filename, FileStamp& stamp ) {
+  boost::system::error_code ec;
+  fs::path path = fs::absolute( filename );
+  if ( !fs::is_regular_file( path, ec ) )
+    return false;
+  stamp.path  = path.string();
+  stamp.mtime = fs::last_write_time( path, ec );
+  stamp.size  = fs::file_size( path, ec );
+  return !ec;
+}
+
+vw::FileMetadataCache<vw::ImageMetadata>& vw::image_metadata_cache() {
+  static FileMetadataCache<ImageMetadata> cache;
+  return cache;
+}
+
+vw::ImageMetadata vw::image_metadata( std::string const& filename ) {
+  FileStamp stamp;
+  bool cacheable = file_stamp( filename, stamp );
+  ImageMetadata metadata;
+  if ( cacheable && image_metadata_cache().get( stamp, metadata ) )
+    return metadata;
+
+  boost::shared_ptr<DiskImageResource> rsrc( DiskImageResourcePtr( filename ) );
+  metadata.format          = rsrc->format();
+  metadata.block_read_size = rsrc->block_read_size();
+  metadata.has_nodata      = rsrc->has_nodata_read();
+  if ( metadata.has_nodata )
+    metadata.nodata = rsrc->nodata_read();
+  metadata.type = rsrc->type();
+
+  if ( cacheable )
+    image_metadata_cache().put( stamp, metadata );
+  return metadata;
+}
+
 vw::ImageFormat vw::image_format(const std::string& filename) {
-  boost::shared_ptr<vw::DiskImageResource> src(vw::DiskImageResourcePtr(filename));
-  return src->format();
+  return image_metadata( filename ).format;
 }
 
 // Return a smart pointer, this is easier to manage
@@ -282,8 +327,7 @@ boost::shared_ptr<vw::DiskImageResource> vw::DiskImageResourcePtr(std::string co
 
 
 vw::Vector2i vw::file_image_size( std::string const& input ) {
-  boost::shared_ptr<DiskImageResource> rsrc( DiskImageResourcePtr(input));
-  Vector2i size( rsrc->cols(), rsrc->rows() );
-  return size;
+  ImageFormat format = image_format( input );
+  return Vector2i( format.cols, format.rows );
 }
 
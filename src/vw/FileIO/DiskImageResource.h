@@ -23,6 +23,8 @@
 #ifndef __VW_FILEIO_DISKIMAGERESOURCE_H__
 #define __VW_FILEIO_DISKIMAGERESOURCE_H__
 
+#include <ctime>
+#include <map>
 #include <set>
 #include <string>
 #include <boost/type_traits.hpp>
@@ -32,10 +34,12 @@
 #include <vw/Core/Features.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Thread.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageIO.h>
 #include <vw/Image/Manipulation.h>
+#include <vw/FileIO/TileOccupancy.h>
 
 
 namespace vw {
@@ -117,11 +121,23 @@ namespace vw {
     // TODO: This has always been the default, but it probably shouldn't be.
     virtual void flush() {}
 
+    /// Whether the file stores no data at all for the bbox, such as for
+    /// the blocks missing from a sparse TIFF, found without reading any
+    /// pixels.  The default doesn't know and returns false.
+    virtual bool is_empty_region( BBox2i const& /*bbox*/ ) const { return false; }
+
+    /// Which tiles of the image hold data, once load_tile_occupancy()
+    /// has found out; until then this is empty, and every tile is
+    /// assumed to.
+    boost::shared_ptr<TileOccupancy const> tile_occupancy() const { return m_occupancy; }
+    void set_tile_occupancy( boost::shared_ptr<TileOccupancy const> const& occupancy ) { m_occupancy = occupancy; }
+
   protected:
     DiskImageResource( std::string const& filename ) : m_filename(filename), m_rescale(default_rescale) {}
     ImageFormat m_format;
     std::string m_filename;
     bool        m_rescale;
+    boost::shared_ptr<TileOccupancy const> m_occupancy;
     static bool default_rescale;
   };
 
@@ -200,13 +216,83 @@ namespace vw {
     }
   }
 
+  // *******************************************************************
+  // Cached file metadata
+  // *******************************************************************
+
+  /// Identifies one version of a local file.
+  struct FileStamp {
+    std::string path;  ///< Absolute path
+    std::time_t mtime;
+    uintmax_t   size;
+  };
+
+  /// Fills in the stamp of a local file, or returns false if filename
+  /// is not one (a URL, or a file which does not exist).
+  bool file_stamp( std::string const& filename, FileStamp& stamp );
+
+  /// A process-wide map from files to something learned by opening
+  /// them, which is forgotten once the file's modification time or
+  /// size changes.  Take the stamp before opening the file, so that a
+  /// file replaced in between is not cached under the new stamp.
+  template <class T>
+  class FileMetadataCache : private boost::noncopyable {
+    typedef std::pair<FileStamp, T> Entry;
+    std::map<std::string, Entry> m_entries;
+    Mutex m_mutex;
+
+  public:
+    bool get( FileStamp const& stamp, T& value ) {
+      Mutex::Lock lock(m_mutex);
+      typename std::map<std::string, Entry>::const_iterator i = m_entries.find(stamp.path);
+      if ( i == m_entries.end() || i->second.first.mtime != stamp.mtime ||
+           i->second.first.size != stamp.size )
+        return false;
+      value = i->second.second;
+      return true;
+    }
+
+    void put( FileStamp const& stamp, T const& value ) {
+      Mutex::Lock lock(m_mutex);
+      m_entries[stamp.path] = Entry(stamp, value);
+    }
+
+    void clear() {
+      Mutex::Lock lock(m_mutex);
+      m_entries.clear();
+    }
+
+    size_t size() {
+      Mutex::Lock lock(m_mutex);
+      return m_entries.size();
+    }
+  };
+
+  /// What image_metadata() keeps about an image file.
+  struct ImageMetadata {
+    ImageFormat format;
+    Vector2i    block_read_size;
+    bool        has_nodata;
+    double      nodata;
+    std::string type;  ///< DiskImageResource::type() of the driver which read it
+
+    ImageMetadata() : has_nodata(false), nodata(0) {}
+  };
+
+  /// The format, block size and nodata value of an image file.  Local
+  /// files are only opened the first time, and again whenever their
+  /// modification time or size changes.
+  ImageMetadata image_metadata( std::string const& filename );
+
+  /// The cache behind image_metadata(), e.g. to clear() it.
+  FileMetadataCache<ImageMetadata>& image_metadata_cache();
+
   // Get the no-data value if available.
   template<class T>
   bool read_nodata_val(std::string const& file, T & nodata_val){
-    boost::scoped_ptr<SrcImageResource>
-      rsrc(DiskImageResource::open(file));
-    if ( rsrc->has_nodata_read() ){
-      nodata_val = rsrc->nodata_read();
+    ImageMetadata metadata = image_metadata(file);
+    if ( metadata.has_nodata ){
+      nodata_val = metadata.nodata;
       return true;
     }
     return false;
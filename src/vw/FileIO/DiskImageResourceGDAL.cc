@@ -34,12 +34,17 @@
 
 #include <vw/Core/Exception.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/Condition.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 #include <vw/FileIO/GdalIO.h>
 
+#include <cstring>
 #include <list>
+#include <vector>
 #include <boost/algorithm/string/case_conv.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem/convenience.hpp>
 #include <boost/foreach.hpp>
 
@@ -66,6 +71,11 @@ namespace {
     if (x)
       ::GDALClose(x);
   }
+  // Same, for datasets that are released without the global lock held.
+  void GDALCloseLocked( GDALDatasetH x ) {
+    vw::Mutex::Lock lock(d::gdal());
+    GDALCloseNullOk(x);
+  }
 }
 
 namespace vw {
@@ -206,10 +216,127 @@ namespace vw {
     return bool(ret.first);
   }
 
+  namespace {
+    // URL schemes and the GDAL network file systems that serve them.
+    // The /vsicurl/ ones keep the scheme, the object stores replace it.
+    struct RemoteScheme { const char *prefix, *vsi; bool keep_prefix; };
+    const RemoteScheme remote_schemes[] = {
+      { "s3://",    "/vsis3/",   false },
+      { "gs://",    "/vsigs/",   false },
+      { "az://",    "/vsiaz/",   false },
+      { "http://",  "/vsicurl/", true  },
+      { "https://", "/vsicurl/", true  },
+    };
+    const size_t num_remote_schemes = sizeof(remote_schemes) / sizeof(remote_schemes[0]);
+  }
+
+  bool DiskImageResourceGDAL::is_remote(std::string const& filename) {
+    for (size_t i = 0; i < num_remote_schemes; ++i)
+      if (boost::starts_with(filename, remote_schemes[i].prefix) ||
+          boost::starts_with(filename, remote_schemes[i].vsi))
+        return true;
+    return false;
+  }
+
+  std::string DiskImageResourceGDAL::gdal_path(std::string const& filename) {
+    for (size_t i = 0; i < num_remote_schemes; ++i) {
+      RemoteScheme const& scheme = remote_schemes[i];
+      if (boost::starts_with(filename, scheme.prefix))
+        return scheme.vsi + (scheme.keep_prefix ? filename
+                                                : filename.substr(strlen(scheme.prefix)));
+    }
+    return filename;
+  }
+
+  /// A pool of read-only datasets on one file.  GDAL allows separate
+  /// datasets to be read from different threads at the same time, so
+  /// each dataset is handed to one reader at a time and the RasterIO
+  /// calls on it need not hold the global lock.
+  class DiskImageResourceGDAL::ReadHandlePool {
+    std::string m_filename;
+    uint32      m_max_handles, m_num_opened;
+    std::vector<boost::shared_ptr<GDALDataset> > m_free;
+    Mutex       m_mutex;
+    Condition   m_returned;
+
+  public:
+    ReadHandlePool(std::string const& filename, uint32 max_handles)
+      : m_filename(filename), m_max_handles(max_handles), m_num_opened(0) {}
+
+    uint32 max_handles() const { return m_max_handles; }
+
+    /// Take a free dataset, opening a new one if fewer than the maximum
+    /// exist and waiting for one to come back otherwise.
+    boost::shared_ptr<GDALDataset> acquire() {
+      Mutex::Lock lock(m_mutex);
+      while (m_free.empty() && m_num_opened >= m_max_handles)
+        m_returned.wait(lock);
+
+      if (!m_free.empty()) {
+        boost::shared_ptr<GDALDataset> dataset = m_free.back();
+        m_free.pop_back();
+        return dataset;
+      }
+
+      boost::shared_ptr<GDALDataset> dataset;
+      {
+        Mutex::Lock gdal_lock(d::gdal());
+        dataset.reset((GDALDataset*)GDALOpen(m_filename.c_str(), GA_ReadOnly), GDALCloseLocked);
+      }
+      if (!dataset)
+        vw_throw( IOErr() << "GDAL: Failed to reopen " << m_filename << " for reading." );
+      m_num_opened++;
+      return dataset;
+    }
+
+    void release(boost::shared_ptr<GDALDataset> const& dataset) {
+      Mutex::Lock lock(m_mutex);
+      m_free.push_back(dataset);
+      m_returned.notify_one();
+    }
+
+    /// Holds a pooled dataset for the duration of one read.
+    class Handle {
+      ReadHandlePool&                m_pool;
+      boost::shared_ptr<GDALDataset> m_dataset;
+    public:
+      Handle(ReadHandlePool& pool) : m_pool(pool), m_dataset(pool.acquire()) {}
+      ~Handle() { m_pool.release(m_dataset); }
+      GDALDataset* get() const { return m_dataset.get(); }
+    };
+  };
+
+  /// A tile converted to the file's pixel format, along with its COG
+  /// overview pixels, ready for write_encoded_block().
+  class DiskImageResourceGDAL::EncodedTile : public EncodedBlock {
+    boost::scoped_array<uint8> m_data;
+
+  public:
+    /// One overview level's worth of the tile, as doubles laid out
+    /// like an ImageBuffer of the file's format.
+    struct Level {
+      BBox2i              bbox;
+      std::vector<double> data;
+    };
+
+    ImageBuffer        buffer;
+    std::vector<Level> overviews;
+
+    EncodedTile(BBox2i const& bbox, ImageFormat format) : EncodedBlock(bbox) {
+      format.cols = bbox.width();
+      format.rows = bbox.height();
+      m_data.reset(new uint8[format.byte_size()]);
+      buffer = ImageBuffer(format, m_data.get());
+    }
+  };
+
+
   /// \endcond
 
   DiskImageResourceGDAL::~DiskImageResourceGDAL() {
     flush();
+    // The pooled datasets take the global lock as they close.
+    m_read_pool.reset();
     // Ensure that the read dataset gets destroyed while we're holding
     // the global lock.  (In the unlikely event that the user has
     // retained a reference to it, it's alredy their responsibility to
@@ -250,19 +377,41 @@ namespace vw {
     return val;
   }
 
+  // GDAL reports the blocks missing from sparse files, e.g. GeoTIFFs
+  // written with SPARSE_OK=TRUE, without reading them.
+  bool DiskImageResourceGDAL::is_empty_region( BBox2i const& bbox ) const {
+#if GDAL_VERSION_NUM >= 2020000
+    Mutex::Lock lock(d::gdal());
+    boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
+    for ( int b = 1; b <= dataset->GetRasterCount(); ++b ) {
+      int status = dataset->GetRasterBand(b)->GetDataCoverageStatus( bbox.min().x(), bbox.min().y(),
+                                                                     bbox.width(), bbox.height(),
+                                                                     GDAL_DATA_COVERAGE_STATUS_DATA );
+      if ( status != GDAL_DATA_COVERAGE_STATUS_EMPTY )
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+  }
+
   void DiskImageResourceGDAL::set_nodata_write( double v ) {
     Mutex::Lock lock(d::gdal());
     boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
     if (dataset->GetRasterBand(1)->SetNoDataValue( v ) != CE_None)
       vw_throw(IOErr() << "DiskImageResourceGDAL: Unable to set nodata value");
+    m_has_nodata_write = true;
+    m_nodata_write     = v;
   }
 
   /// Bind the resource to a file for reading.  Confirm that we can
   /// open the file and that it has a sane pixel format.
   void DiskImageResourceGDAL::open( std::string const& filename )
   {
+    m_read_pool.reset();
     Mutex::Lock lock(d::gdal());
-    m_read_dataset_ptr.reset((GDALDataset*)GDALOpen(filename.c_str(), GA_ReadOnly), GDALCloseNullOk);
+    m_read_dataset_ptr.reset((GDALDataset*)GDALOpen(gdal_path(filename).c_str(), GA_ReadOnly), GDALCloseNullOk);
 
     if( !m_read_dataset_ptr )
       vw_throw( ArgumentErr() << "GDAL: Failed to open " << filename << "." );
@@ -338,6 +487,14 @@ namespace vw {
     }
 
     m_blocksize = default_block_size();
+
+    // Remote reads spend their time waiting on the network, so always
+    // keep several requests in flight.
+    uint32 num_handles = vw_settings().gdal_read_handles();
+    if (is_remote(filename))
+      num_handles = std::max(num_handles, uint32(vw_settings().default_num_threads()));
+    if (num_handles > 0)
+      m_read_pool.reset(new ReadHandlePool(gdal_path(m_filename), num_handles));
   }
 
   /// Bind the resource to a file for writing.
@@ -352,6 +509,9 @@ namespace vw {
     VW_ASSERT((block_size[0] == -1 || block_size[1] == -1) || (block_size[0] % 16 == 0 && block_size[1] % 16 == 0),
               NoImplErr() << "DiskImageResourceGDAL: Cannot create " << filename << "\n\t"
               << "Block dimensions must be a multiple of 16.\n");
+    VW_ASSERT(!is_remote(filename),
+              NoImplErr() << "DiskImageResourceGDAL: Cannot create " << filename << "\n\t"
+              << "Remote images are read-only.\n");
 
     // Store away relevent information into the internal data
     // structure for this DiskImageResource
@@ -361,6 +521,35 @@ namespace vw {
 
     m_options = user_options;
 
+    // COG is our option, not GDAL's, so it never reaches the driver.
+    Options::iterator cog = m_options.find("COG");
+    m_cog = cog != m_options.end() && boost::to_upper_copy(cog->second) == "YES";
+    if (cog != m_options.end())
+      m_options.erase(cog);
+    if (m_cog) {
+      std::string extension = boost::to_lower_copy(fs::path(filename).extension().string());
+      VW_ASSERT(extension == ".tif" || extension == ".tiff",
+                NoImplErr() << "DiskImageResourceGDAL: Cannot create " << filename << "\n\t"
+                << "Cloud-Optimized output is only supported for GeoTIFF.\n");
+      // COG readers expect tiles; 512 is what GDAL's own COG driver uses.
+      if (m_blocksize[0] == -1 || m_blocksize[1] == -1)
+        m_blocksize = Vector2i(512,512);
+      m_cog_tmp_filename = filename + ".cog-tmp.tif";
+    }
+
+#if GDAL_VERSION_NUM >= 2010000
+    // Let the GTiff driver compress on several threads; the single
+    // write thread of block_write_image is otherwise the bottleneck.
+    std::string extension = boost::to_lower_copy(fs::path(filename).extension().string());
+    if ((extension == ".tif" || extension == ".tiff") &&
+        m_options.count("COMPRESS") && boost::to_upper_copy(m_options["COMPRESS"]) != "NONE" &&
+        !m_options.count("NUM_THREADS")) {
+      std::ostringstream num_threads;
+      num_threads << vw_settings().default_num_threads();
+      m_options["NUM_THREADS"] = num_threads.str();
+    }
+#endif
+
     if (m_options["PREDICTOR"].empty()){
       // Unless predictor was explicitly set, use predictor 3 for
       // compression of float/double, and predictor 2 for integers,
@@ -406,6 +595,44 @@ namespace vw {
     }
 
     GDALDriver *driver = ret.first;
+    char **options = write_options();
+
+    GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(m_format.channel_type);
+
+    // A COG is assembled in a temporary file and copied into place by flush().
+    std::string const& target = m_cog ? m_cog_tmp_filename : m_filename;
+    m_write_dataset_ptr.reset(
+        driver->Create( target.c_str(), cols(), rows(), num_bands, gdal_pix_fmt, options ),
+        GDALCloseNullOk);
+    CSLDestroy( options );
+
+    if (m_blocksize[0] == -1 || m_blocksize[1] == -1) {
+      m_blocksize = default_block_size();
+    }
+
+    if (m_cog && m_write_dataset_ptr) {
+      // Every overview pixel must come from a single tile, hence the
+      // block size bound on the decimation factor.
+      std::vector<int> factors;
+      for (int32 factor = 2; factor <= std::min(m_blocksize[0], m_blocksize[1]); factor *= 2) {
+        factors.push_back(factor);
+        if ((cols() + factor - 1) / factor <= m_blocksize[0] &&
+            (rows() + factor - 1) / factor <= m_blocksize[1])
+          break;
+      }
+      m_cog_levels = factors.size();
+      // "NONE" only allocates the overviews; write() fills them in.
+      if (!factors.empty() &&
+          GDALBuildOverviews( m_write_dataset_ptr.get(), "NONE", factors.size(), &factors[0],
+                              0, NULL, NULL, NULL ) != CE_None)
+        vw_throw( IOErr() << "DiskImageResourceGDAL: Failed to create overviews for "
+                  << m_filename << ": " << CPLGetLastErrorMsg() );
+    }
+  }
+
+  // The GDAL creation options for this resource, to be freed with
+  // CSLDestroy() by the caller.
+  char** DiskImageResourceGDAL::write_options() const {
     char **options = NULL;
 
     if( m_format.pixel_format == VW_PIXEL_GRAYA || m_format.pixel_format == VW_PIXEL_RGBA ) {
@@ -432,16 +659,7 @@ namespace vw {
     BOOST_FOREACH( Options::value_type const& i, m_options )
       options = CSLSetNameValue( options, i.first.c_str(), i.second.c_str() );
 
-    GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(m_format.channel_type);
-
-    m_write_dataset_ptr.reset(
-        driver->Create( m_filename.c_str(), cols(), rows(), num_bands, gdal_pix_fmt, options ),
-        GDALCloseNullOk);
-    CSLDestroy( options );
-
-    if (m_blocksize[0] == -1 || m_blocksize[1] == -1) {
-      m_blocksize = default_block_size();
-    }
+    return options;
   }
 
   Vector2i DiskImageResourceGDAL::default_block_size() {
@@ -480,74 +698,118 @@ namespace vw {
     boost::scoped_array<uint8> src_data(new uint8[src_fmt.byte_size()]);
     ImageBuffer src(src_fmt, src_data.get());
 
-    {
+    if (m_read_pool && !m_write_dataset_ptr) {
+      ReadHandlePool::Handle handle(*m_read_pool);
+      read_dataset(handle.get(), src, bbox);
+    } else {
       Mutex::Lock lock(d::gdal());
+      read_dataset(get_dataset_ptr().get(), src, bbox);
+    }
 
-      boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
-
-      if( m_palette.empty() ) {
-        for ( int32 p = 0; p < planes(); ++p ) {
-          for ( int32 c = 0; c < channels(); ++c ) {
-            // Only one of channels() or planes() will be nonzero.
-            GDALRasterBand  *band = dataset->GetRasterBand(c+p+1);
-            GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(channel_type());
-            CPLErr result =
-                band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
-                            (uint8*)src(0,0,p) + channel_size(src.format.channel_type)*c,
-                            src.format.cols, src.format.rows, gdal_pix_fmt, src.cstride, src.rstride );
-              if (result != CE_None) {
-                vw_out(WarningMessage, "fileio") << "RasterIO trouble: '"
-                    << CPLGetLastErrorMsg() << "'" << std::endl;
-              }
-          }
+    convert( dest, src, m_rescale );
+  }
+
+  // Read a region of the given dataset into src, which is in the
+  // resource's native format.  The caller must either hold the global
+  // lock or have exclusive use of the dataset.
+  void DiskImageResourceGDAL::read_dataset( GDALDataset* dataset, ImageBuffer const& src, BBox2i const& bbox ) const
+  {
+    if( m_palette.empty() ) {
+      for ( int32 p = 0; p < planes(); ++p ) {
+        for ( int32 c = 0; c < channels(); ++c ) {
+          // Only one of channels() or planes() will be nonzero.
+          GDALRasterBand  *band = dataset->GetRasterBand(c+p+1);
+          GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(channel_type());
+          CPLErr result =
+              band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
+                          (uint8*)src(0,0,p) + channel_size(src.format.channel_type)*c,
+                          src.format.cols, src.format.rows, gdal_pix_fmt, src.cstride, src.rstride );
+            if (result != CE_None) {
+              vw_out(WarningMessage, "fileio") << "RasterIO trouble: '"
+                  << CPLGetLastErrorMsg() << "'" << std::endl;
+            }
         }
       }
-      else { // palette conversion
-        GDALRasterBand  *band = dataset->GetRasterBand(1);
-        uint8 *index_data = new uint8[bbox.width() * bbox.height()];
-        CPLErr result =
-            band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
-                        index_data, bbox.width(), bbox.height(), GDT_Byte, 1, bbox.width() );
-        if (result != CE_None) {
-          vw_out(WarningMessage, "fileio") << "RasterIO trouble: '"
-              << CPLGetLastErrorMsg() << "'" << std::endl;
-        }
-        PixelRGBA<uint8> *rgba_data = (PixelRGBA<uint8>*) src.data;
-        for( int i=0; i<bbox.width()*bbox.height(); ++i )
-          rgba_data[i] = m_palette[index_data[i]];
-        delete [] index_data;
+    }
+    else { // palette conversion
+      GDALRasterBand  *band = dataset->GetRasterBand(1);
+      uint8 *index_data = new uint8[bbox.width() * bbox.height()];
+      CPLErr result =
+          band->RasterIO( GF_Read, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
+                      index_data, bbox.width(), bbox.height(), GDT_Byte, 1, bbox.width() );
+      if (result != CE_None) {
+        vw_out(WarningMessage, "fileio") << "RasterIO trouble: '"
+            << CPLGetLastErrorMsg() << "'" << std::endl;
       }
+      PixelRGBA<uint8> *rgba_data = (PixelRGBA<uint8>*) src.data;
+      for( int i=0; i<bbox.width()*bbox.height(); ++i )
+        rgba_data[i] = m_palette[index_data[i]];
+      delete [] index_data;
     }
-
-    convert( dest, src, m_rescale );
   }
 
 
   // Write the given buffer into the disk image.
   void DiskImageResourceGDAL::write( ImageBuffer const& src, BBox2i const& bbox )
   {
-    ImageFormat dst_fmt = m_format;
-    dst_fmt.cols = bbox.width();
-    dst_fmt.rows = bbox.height();
+    write_encoded_block( *encode_block( src, bbox ) );
+  }
 
-    boost::scoped_array<uint8> dst_data(new uint8[dst_fmt.byte_size()]);
-    ImageBuffer dst(dst_fmt, dst_data.get());
+  // Convert the buffer to the file's format, and average it down into
+  // the COG overview levels.  Touches no GDAL state, so block_write_image
+  // runs it on its rasterizing threads.
+  boost::shared_ptr<EncodedBlock>
+  DiskImageResourceGDAL::encode_block( ImageBuffer const& src, BBox2i const& bbox ) const
+  {
+    boost::shared_ptr<EncodedTile> tile( new EncodedTile( bbox, m_format ) );
+    convert( tile->buffer, src, m_rescale );
+    if (m_cog)
+      downsample_overviews( *tile );
+    return tile;
+  }
 
-    convert( dst, src, m_rescale );
+  void DiskImageResourceGDAL::write_encoded_block( EncodedBlock const& block )
+  {
+    EncodedTile const& tile = static_cast<EncodedTile const&>( block );
+    ImageBuffer const& dst  = tile.buffer;
+    BBox2i const&      bbox = tile.bbox();
 
-    {
-      Mutex::Lock lock(d::gdal());
+    Mutex::Lock lock(d::gdal());
 
-      GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(channel_type());
-      // We've already ensured that either planes==1 or channels==1.
-      for (uint32 p = 0; p < dst.format.planes; p++) {
-        for (uint32 c = 0; c < num_channels(dst.format.pixel_format); c++) {
-          GDALRasterBand *band = get_dataset_ptr()->GetRasterBand(c+p+1);
+    GDALDataType gdal_pix_fmt = vw_channel_id_to_gdal_pix_fmt::value(channel_type());
+    // We've already ensured that either planes==1 or channels==1.
+    for (uint32 p = 0; p < dst.format.planes; p++) {
+      for (uint32 c = 0; c < num_channels(dst.format.pixel_format); c++) {
+        GDALRasterBand *band = get_dataset_ptr()->GetRasterBand(c+p+1);
 
+        CPLErr result =
+            band->RasterIO( GF_Write, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
+                        (uint8*)dst(0,0,p) + channel_size(dst.format.channel_type)*c,
+                        dst.format.cols, dst.format.rows, gdal_pix_fmt, dst.cstride, dst.rstride );
+        if (result != CE_None) {
+          vw_out(WarningMessage, "fileio") << "RasterIO trouble: '"
+                                           << CPLGetLastErrorMsg() << "'" << std::endl;
+        }
+      }
+    }
+
+    int32 nch = num_channels(dst.format.pixel_format);
+    for (size_t k = 0; k < tile.overviews.size(); ++k) {
+      EncodedTile::Level const& level = tile.overviews[k];
+      int32 cols = level.bbox.width(), rows = level.bbox.height();
+      int32 x0   = level.bbox.min().x(), y0 = level.bbox.min().y();
+      for (uint32 p = 0; p < dst.format.planes; ++p) {
+        for (int32 ch = 0; ch < nch; ++ch) {
+          GDALRasterBand *band = get_dataset_ptr()->GetRasterBand(ch+p+1)->GetOverview(k);
+          if (!band || x0 >= band->GetXSize() || y0 >= band->GetYSize())
+            continue;
+          int32 w = std::min(cols, band->GetXSize() - x0);
+          int32 h = std::min(rows, band->GetYSize() - y0);
           CPLErr result =
-              band->RasterIO( GF_Write, bbox.min().x(), bbox.min().y(), bbox.width(), bbox.height(),
-                          (uint8*)dst(0,0,p) + channel_size(dst.format.channel_type)*c,
-                          dst.format.cols, dst.format.rows, gdal_pix_fmt, dst.cstride, dst.rstride );
+              band->RasterIO( GF_Write, x0, y0, w, h,
+                              const_cast<double*>(&level.data[size_t(p)*rows*cols*nch + ch]),
+                              w, h, GDT_Float64,
+                              nch*sizeof(double), cols*nch*sizeof(double) );
           if (result != CE_None) {
             vw_out(WarningMessage, "fileio") << "RasterIO trouble: '"
                                              << CPLGetLastErrorMsg() << "'" << std::endl;
@@ -557,6 +819,73 @@ namespace vw {
     }
   }
 
+  // Average a full-resolution tile down into each COG overview level
+  // in turn.
+  void DiskImageResourceGDAL::downsample_overviews( EncodedTile& tile ) const
+  {
+    ImageBuffer const& src = tile.buffer;
+    int32 nch    = num_channels(src.format.pixel_format);
+    int32 planes = src.format.planes;
+    int32 cols   = tile.bbox().width(), rows = tile.bbox().height();
+    int32 x0     = tile.bbox().min().x(), y0 = tile.bbox().min().y();
+
+    ImageFormat level_fmt = src.format;
+    level_fmt.channel_type = VW_CHANNEL_FLOAT64;
+    std::vector<double> level(level_fmt.byte_size() / sizeof(double));
+    convert( ImageBuffer(level_fmt, &level[0]), src );
+
+    tile.overviews.resize(m_cog_levels);
+    for (uint32 k = 0; k < m_cog_levels; ++k) {
+      // Tiles start on multiples of the block size, so x0 and y0 stay
+      // exact until the factor passes it.
+      int32 ncols = (cols + 1) / 2, nrows = (rows + 1) / 2;
+      x0 /= 2; y0 /= 2;
+      std::vector<double>& next = tile.overviews[k].data;
+      tile.overviews[k].bbox = BBox2i(x0, y0, ncols, nrows);
+      next.assign(size_t(ncols) * nrows * nch * planes, 0.0);
+
+      for (int32 p = 0; p < planes; ++p)
+        for (int32 r = 0; r < nrows; ++r)
+          for (int32 c = 0; c < ncols; ++c)
+            for (int32 ch = 0; ch < nch; ++ch) {
+              double sum = 0;
+              int32  count = 0;
+              for (int32 dr = 2*r; dr < std::min(2*r+2, rows); ++dr)
+                for (int32 dc = 2*c; dc < std::min(2*c+2, cols); ++dc) {
+                  double v = level[((size_t(p)*rows + dr)*cols + dc)*nch + ch];
+                  if (v != v || (m_has_nodata_write && v == m_nodata_write))
+                    continue;
+                  sum += v;
+                  ++count;
+                }
+              next[((size_t(p)*nrows + r)*ncols + c)*nch + ch] =
+                count ? sum / count : (m_has_nodata_write ? m_nodata_write : 0.0);
+            }
+
+      level = next;
+      cols = ncols; rows = nrows;
+    }
+  }
+
+  // Copy the temporary COG dataset, overviews included, into COG
+  // order at the real filename and remove the temporary file.
+  void DiskImageResourceGDAL::finish_cog_locked()
+  {
+    GDALDriver *driver = m_write_dataset_ptr->GetDriver();
+    char **options = write_options();
+    options = CSLSetNameValue( options, "COPY_SRC_OVERVIEWS", "YES" );
+    boost::shared_ptr<GDALDataset> cog(
+        driver->CreateCopy( m_filename.c_str(), m_write_dataset_ptr.get(), FALSE, options, NULL, NULL ),
+        GDALCloseNullOk);
+    CSLDestroy( options );
+    m_write_dataset_ptr.reset();
+    if (!cog)
+      vw_out(ErrorMessage, "fileio") << "DiskImageResourceGDAL: Failed to write " << m_filename
+                                     << ": '" << CPLGetLastErrorMsg() << "'" << std::endl;
+    cog.reset();
+    driver->Delete( m_cog_tmp_filename.c_str() );
+  }
+
   // Set the block size
   //
   // Be careful here -- you can set any block size here, but you
@@ -575,13 +904,45 @@ namespace vw {
     return m_blocksize;
   }
 
+  void DiskImageResourceGDAL::set_read_handles(uint32 num_handles) {
+    m_read_pool.reset();
+    if (num_handles > 0)
+      m_read_pool.reset(new ReadHandlePool(gdal_path(m_filename), num_handles));
+  }
+
+  uint32 DiskImageResourceGDAL::read_handles() const {
+    return m_read_pool ? m_read_pool->max_handles() : 0;
+  }
+
   void DiskImageResourceGDAL::flush() {
     if (m_write_dataset_ptr) {
       Mutex::Lock lock(d::gdal());
+      if (m_cog)
+        finish_cog_locked();
       m_write_dataset_ptr.reset();
     }
   }
 
+  void DiskImageResourceGDAL::sync() {
+    VW_ASSERT(has_sync(), NoImplErr() << "DiskImageResourceGDAL: Cannot sync " << m_filename << ".");
+    Mutex::Lock lock(d::gdal());
+    m_write_dataset_ptr->FlushCache();
+  }
+
+  void DiskImageResourceGDAL::reopen_for_write() {
+    VW_ASSERT(m_read_dataset_ptr,
+              LogicErr() << "DiskImageResourceGDAL: " << m_filename << " is not open for reading.");
+    VW_ASSERT(!is_remote(m_filename),
+              NoImplErr() << "DiskImageResourceGDAL: Cannot write to " << m_filename << "\n\t"
+              << "Remote images are read-only.\n");
+    m_read_pool.reset();
+    Mutex::Lock lock(d::gdal());
+    m_read_dataset_ptr.reset();
+    m_write_dataset_ptr.reset((GDALDataset*)GDALOpen(gdal_path(m_filename).c_str(), GA_Update), GDALCloseNullOk);
+    if (!m_write_dataset_ptr)
+      vw_throw( IOErr() << "GDAL: Failed to open " << m_filename << " for writing." );
+  }
+
   // Provide read access to the file's metadata
   char **DiskImageResourceGDAL::get_metadata() const {
     boost::shared_ptr<GDALDataset> dataset = get_dataset_ptr();
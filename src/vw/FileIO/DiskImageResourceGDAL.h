@@ -33,6 +33,56 @@
 ///                                   options );
 ///   write_image( resource, image );
 ///
+/// For compressed GeoTIFFs the NUM_THREADS option defaults to
+/// vw_settings().default_num_threads(), so the driver compresses tiles
+/// in parallel; block_write_image also converts each tile to the file's
+/// pixel format on its rasterizing threads (see encode_block()).
+///
+/// By default every GDAL call, block reads included, is serialized
+/// through the global GDAL lock.  A resource opened for reading can
+/// instead serve its block reads from a pool of private read-only
+/// datasets on the same file, so that the tiles requested by
+/// BlockRasterizeView from several threads are read in parallel:
+///
+///   DiskImageResourceGDAL resource( "big.tif" );
+///   resource.set_read_handles( vw_settings().default_num_threads() );
+///
+/// The pool size for newly opened resources comes from the
+/// gdal_read_handles setting ("general.gdal_read_handles" in ~/.vwrc).
+///
+/// Images in object stores or on web servers can be opened in place,
+/// without staging them to local disk, by giving a URL as the
+/// filename: s3://bucket/key.tif, gs://..., az://... or http(s)://...
+/// (see gdal_path()).  GDAL fetches the blocks with HTTP range
+/// requests and caches them, and such resources get at least
+/// default_num_threads() read handles so that blocks are fetched in
+/// parallel.  Tiled files, and COGs in particular, work best.
+/// Credentials come from the usual GDAL configuration options and
+/// environment variables (AWS_ACCESS_KEY_ID, AWS_S3_ENDPOINT, ...).
+/// Remote resources are read-only.
+///
+/// Passing the option COG=YES when creating a GeoTIFF writes a
+/// Cloud-Optimized GeoTIFF.  Each tile handed to write() is averaged
+/// down into every overview level as it arrives, so the pyramid is
+/// complete when the last full-resolution tile is written and the
+/// image is never read back.  The tiles go to a temporary file next
+/// to the output, which flush() copies into COG order (IFDs first,
+/// then overviews from smallest to largest, then the full-resolution
+/// tiles) and removes:
+///
+///   DiskImageResourceGDAL::Options options;
+///   options["COMPRESS"] = "DEFLATE";
+///   options["COG"] = "YES";
+///   DiskImageResourceGDAL resource( "out.tif", image.format(),
+///                                   Vector2i(512,512), options );
+///   block_write_image( resource, image );
+///
+/// A pixel of overview level k averages a 2^k x 2^k square of the
+/// full-resolution image, and it is only computed from a single tile,
+/// so levels stop once 2^k exceeds the block size or the overview
+/// fits in one block.  Nodata pixels, when a nodata value has been
+/// set, do not contribute to the averages.
+///
 #ifndef __VW_FILEIO_DISKIMAGERESOUCEGDAL_H__
 #define __VW_FILEIO_DISKIMAGERESOUCEGDAL_H__
 
@@ -63,14 +113,16 @@ namespace vw {
     typedef std::map<std::string,std::string> Options;
 
     DiskImageResourceGDAL( std::string const& filename )
-      : DiskImageResource( filename ) {
+      : DiskImageResource( filename ), m_cog(false), m_cog_levels(0),
+        m_has_nodata_write(false), m_nodata_write(0) {
       open( filename );
     }
 
     DiskImageResourceGDAL( std::string const& filename,
                            ImageFormat const& format,
                            Vector2i           block_size = Vector2i(-1,-1) )
-      : DiskImageResource( filename ) {
+      : DiskImageResource( filename ), m_cog(false), m_cog_levels(0),
+        m_has_nodata_write(false), m_nodata_write(0) {
       create( filename, format, block_size );
     }
 
@@ -78,7 +130,8 @@ namespace vw {
                            ImageFormat const& format,
                            Vector2i           block_size,
                            Options     const& options )
-      : DiskImageResource( filename ) {
+      : DiskImageResource( filename ), m_cog(false), m_cog_levels(0),
+        m_has_nodata_write(false), m_nodata_write(0) {
       create( filename, format, block_size, options );
     }
 
@@ -98,6 +151,10 @@ namespace vw {
     virtual bool has_block_write () const {return true;}
     virtual bool has_nodata_read () const;
     virtual bool has_nodata_write() const {return true;}
+    virtual bool has_encoded_write() const {return true;}
+
+    virtual boost::shared_ptr<EncodedBlock> encode_block( ImageBuffer const& src, BBox2i const& bbox ) const;
+    virtual void write_encoded_block( EncodedBlock const& block );
 
     virtual Vector2i block_write_size    () const;
     virtual void     set_block_write_size(const Vector2i&);
@@ -106,11 +163,48 @@ namespace vw {
     virtual void   set_nodata_write(double);
     virtual double nodata_read() const;
 
+    virtual bool is_empty_region( BBox2i const& bbox ) const;
+
     virtual void flush();
 
+    /// A file open for writing can sync() its blocks to disk, except a
+    /// COG, which only takes its final layout in flush().
+    virtual bool has_sync() const { return m_write_dataset_ptr && !m_cog; }
+    virtual void sync();
+
+    /// Reopen the file this resource was opened on for writing, to
+    /// update it in place, as when resuming an interrupted write.  The
+    /// format and block size are those of the file, as are its nodata
+    /// value and georeference unless they are written again.  Do not
+    /// call set_block_write_size() afterwards, as that recreates the file.
+    void reopen_for_write();
+
+    /// Serve block reads from up to \a num_handles read-only datasets on
+    /// this file, each opened on first use and used by one thread at a
+    /// time, instead of from the shared dataset under the global GDAL
+    /// lock.  Zero restores the serialized behavior.  Ignored while the
+    /// resource is open for writing.  Do not call this while reads are
+    /// in progress.
+    void   set_read_handles(uint32 num_handles);
+    uint32 read_handles() const;
+
+    /// True if this resource was created with COG=YES.
+    bool   is_cog() const { return m_cog; }
+    /// The number of overview levels a COG resource builds as it is written.
+    uint32 cog_overview_levels() const { return m_cog_levels; }
+
     // Ask GDAL if it's compiled with support for this file
     static bool gdal_has_support(std::string const& filename);
 
+    /// Is this the URL of a remote image, or a GDAL network path?
+    static bool is_remote(std::string const& filename);
+
+    /// The path to hand GDAL for a filename: object store and web URLs
+    /// become paths on GDAL's network file systems (s3://b/k becomes
+    /// /vsis3/b/k, http://h/p becomes /vsicurl/http://h/p), and
+    /// anything else is returned unchanged.
+    static std::string gdal_path(std::string const& filename);
+
     void open  ( std::string const& filename );
     void create( std::string const& filename,
                  ImageFormat const& format,
@@ -153,8 +247,15 @@ namespace vw {
     static Mutex &global_lock();
 
   private:
+    class ReadHandlePool;
+    class EncodedTile;
+
     void     initialize_write_resource_locked();
     Vector2i default_block_size();
+    void     read_dataset(GDALDataset* dataset, ImageBuffer const& src, BBox2i const& bbox) const;
+    char**   write_options() const;
+    void     downsample_overviews(EncodedTile& tile) const;
+    void     finish_cog_locked();
 
     std::string m_filename;
     boost::shared_ptr<GDALDataset> m_write_dataset_ptr;
@@ -162,6 +263,12 @@ namespace vw {
     Vector2i m_blocksize;
     Options  m_options;
     boost::shared_ptr<GDALDataset> m_read_dataset_ptr;
+    boost::shared_ptr<ReadHandlePool> m_read_pool;
+    bool        m_cog;
+    std::string m_cog_tmp_filename;
+    uint32      m_cog_levels;
+    bool        m_has_nodata_write;
+    double      m_nodata_write;
   };
 
   void UnloadGDAL();
@@ -33,6 +33,8 @@
 #pragma warning(disable:4996)
 #endif
 
+#include <map>
+
 #include <mfhdf.h>
 
 #ifndef H4_MAX_VAR_DIMS
@@ -45,6 +47,7 @@
 
 #include <vw/Core/Exception.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Thread.h>
 
 #include <vw/FileIO/DiskImageResourceHDF.h>
 
@@ -53,6 +56,13 @@
 // *******************************************************************
 
 namespace vw {
+  // The HDF4 library keeps global state, so only one thread may be in it
+  // at a time, whichever file it is reading.
+  static Mutex& hdf_lock() {
+    static Mutex lock;
+    return lock;
+  }
+
   static ChannelTypeEnum hdf_to_vw_type( ::int32 data_type ) {
     switch( data_type ) {
     case DFNT_CHAR8:
@@ -94,8 +104,14 @@ public:
   ::int32 sd_id;
   std::vector<SDSInfo> sds_info;
   std::vector<PlaneInfo> plane_info;
+  // The access IDs of the selected SDSs, kept open so that their chunk
+  // caches last from one read to the next.
+  std::map< ::int32, ::int32 > open_sds;
+  bool chunked;
+  Vector2i chunk_size;
+  ::int32 chunks_across;
 
-  DiskImageResourceInfoHDF( std::string const& filename, DiskImageResourceHDF& resource  ) : resource(resource), sd_id(FAIL) {
+  DiskImageResourceInfoHDF( std::string const& filename, DiskImageResourceHDF& resource  ) : resource(resource), sd_id(FAIL), chunked(false), chunks_across(0) {
 
     if( (sd_id = SDstart( filename.c_str(), DFACC_READ )) == FAIL )
       vw_throw( IOErr() << "Unable to open HDF file \"" << filename << "\"!" );
@@ -123,6 +139,12 @@ public:
       sds_info[i].dim_sizes.insert( sds_info[i].dim_sizes.begin(), dim_sizes, dim_sizes+sds_info[i].rank );
       sds_info[i].type = hdf_to_vw_type( data_type );
 
+      HDF_CHUNK_DEF chunk_def;
+      ::int32 chunk_flags;
+      if( SDgetchunkinfo( id, &chunk_def, &chunk_flags ) != FAIL && (chunk_flags & HDF_CHUNK) )
+        sds_info[i].chunk_sizes.insert( sds_info[i].chunk_sizes.begin(), chunk_def.chunk_lengths,
+                                        chunk_def.chunk_lengths+sds_info[i].rank );
+
       sds_info[i].coord = SDiscoordvar( id );
       if( sds_info[i].coord )
         VW_OUT(VerboseDebugMessage, "fileio") << "  DIM ";
@@ -160,9 +182,26 @@ public:
   }
 
   ~DiskImageResourceInfoHDF() {
+    close_sds();
     if( sd_id != FAIL ) SDend( sd_id );
   }
 
+  void close_sds() {
+    for( std::map< ::int32, ::int32 >::const_iterator i = open_sds.begin(); i != open_sds.end(); ++i )
+      SDendaccess( i->second );
+    open_sds.clear();
+  }
+
+  // The default is two rows of chunks, see DiskImageResourceHDF.h.
+  void set_chunk_cache_size( ::int32 chunks ) {
+    if( !chunked ) return;
+    if( chunks <= 0 )
+      chunks = 2 * chunks_across;
+    for( std::map< ::int32, ::int32 >::const_iterator i = open_sds.begin(); i != open_sds.end(); ++i )
+      if( SDsetchunkcache( i->second, chunks, 0 ) == FAIL )
+        vw_throw( IOErr() << "Unable to set the chunk cache in HDF file \"" << resource.filename() << "\"!" );
+  }
+
   vw::DiskImageResourceHDF::sds_iterator sds_begin() const {
     return sds_info.begin();
   }
@@ -224,7 +263,35 @@ public:
     new_format.planes = sds_planes.size();
     new_format.pixel_format = VW_PIXEL_SCALAR;
     plane_info = new_plane_info;
-    VW_OUT(VerboseDebugMessage, "fileio") << "Configured resource: " << new_format.cols << "x" << new_format.rows << "x" << new_format.planes << std::endl;
+
+    // Open the selected SDSs, and read in blocks of their chunks if they
+    // are all chunked the same way.
+    close_sds();
+    chunked = true;
+    for( unsigned plane=0; plane<plane_info.size(); ++plane ) {
+      ::int32 sds = plane_info[plane].sds;
+      if( open_sds.find( sds ) == open_sds.end() ) {
+        ::int32 sds_id = SDselect( sd_id, sds );
+        if( sds_id == FAIL ) vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
+        open_sds[sds] = sds_id;
+      }
+      std::vector<int32> const& chunks = sds_info[sds].chunk_sizes;
+      Vector2i plane_chunk;
+      if( !chunks.empty() )
+        plane_chunk = Vector2i( chunks[sds_info[sds].rank-1], chunks[sds_info[sds].rank-2] );
+      if( chunks.empty() || (plane > 0 && plane_chunk != chunk_size) )
+        chunked = false;
+      chunk_size = plane_chunk;
+    }
+    if( chunked ) {
+      chunks_across = (cols + chunk_size.x() - 1) / chunk_size.x();
+      set_chunk_cache_size( 0 );
+    }
+
+    VW_OUT(VerboseDebugMessage, "fileio") << "Configured resource: " << new_format.cols << "x" << new_format.rows << "x" << new_format.planes;
+    if( chunked )
+      VW_OUT(VerboseDebugMessage, "fileio") << " in " << chunk_size.x() << "x" << chunk_size.y() << " chunks";
+    VW_OUT(VerboseDebugMessage, "fileio") << std::endl;
     return new_format;
   }
 
@@ -248,9 +315,10 @@ public:
     return ImageFormat();
   }
 
-  void read( ImageBuffer &dstbuf, BBox2i const& bbox ) const {
-    boost::scoped_array<uint8> buffer( new uint8[ bbox.width() * bbox.height() * resource.planes() * channel_size( resource.channel_type() ) ] );
-    dstbuf.data = buffer.get();
+  // Reads the bbox into dstbuf, whose pixels are kept in buffer.
+  void read( ImageBuffer &dstbuf, BBox2i const& bbox, std::vector<uint8>& buffer ) const {
+    buffer.resize( size_t(bbox.width()) * bbox.height() * resource.planes() * channel_size( resource.channel_type() ) );
+    dstbuf.data = &buffer[0];
     dstbuf.format.cols = bbox.width();
     dstbuf.format.rows = bbox.height();
     dstbuf.format.planes = resource.planes();
@@ -261,9 +329,10 @@ public:
     dstbuf.pstride = dstbuf.rstride * bbox.height();
     // For each requested plane...
     for( uint32 p=0; p<uint32(dstbuf.format.planes); ++p ) {
-      // Select the SDS
-      ::int32 sds_id = SDselect( sd_id, plane_info[p].sds );
-      if( sds_id == FAIL ) vw_throw( IOErr() << "Unable to select SDS in HDF file \"" << resource.filename() << "\"!" );
+      // Find the SDS
+      std::map< ::int32, ::int32 >::const_iterator open = open_sds.find( plane_info[p].sds );
+      if( open == open_sds.end() ) vw_throw( IOErr() << "No SDS selected in HDF file \"" << resource.filename() << "\"!" );
+      ::int32 sds_id = open->second;
 
       if( sds_info[plane_info[p].sds].rank == 2 ) {
         ::int32 start[2] = { bbox.min().y(), bbox.min().x() };
@@ -278,8 +347,6 @@ public:
           vw_throw( IOErr() << "Unable to read data from HDF file \"" << resource.filename() << "\"!" );
       }
       else vw_throw( IOErr() << "Invalid SDS rank in HDF file \"" << resource.filename() << "\"!" );
-
-      SDendaccess( sds_id );
     }
   }
 
@@ -554,13 +621,19 @@ public:
 // *********************************************************************
 
 vw::DiskImageResourceHDF::DiskImageResourceHDF( std::string const& filename )
-  : DiskImageResource( filename ),
-    m_info( new DiskImageResourceInfoHDF( filename, *this ) )
-{}
+  : DiskImageResource( filename )
+{
+  Mutex::Lock lock( hdf_lock() );
+  m_info.reset( new DiskImageResourceInfoHDF( filename, *this ) );
+}
 
-vw::DiskImageResourceHDF::~DiskImageResourceHDF() {}
+vw::DiskImageResourceHDF::~DiskImageResourceHDF() {
+  Mutex::Lock lock( hdf_lock() );
+  m_info.reset();
+}
 
 void vw::DiskImageResourceHDF::open( std::string const& filename ) {
+  Mutex::Lock lock( hdf_lock() );
   boost::shared_ptr<DiskImageResourceInfoHDF> new_info( new DiskImageResourceInfoHDF( filename, *this ) );
   m_info = new_info;
 }
@@ -571,10 +644,28 @@ vw::DiskImageResource* vw::DiskImageResourceHDF::construct_open( std::string con
 
 void vw::DiskImageResourceHDF::read( ImageBuffer const& dstbuf, BBox2i const& bbox ) const {
   ImageBuffer srcbuf;
-  m_info->read( srcbuf, bbox );
+  std::vector<uint8> buffer;
+  {
+    Mutex::Lock lock( hdf_lock() );
+    m_info->read( srcbuf, bbox, buffer );
+  }
+  // Other threads may read while this one converts.
   convert( dstbuf, srcbuf, m_rescale );
 }
 
+bool vw::DiskImageResourceHDF::has_block_read() const {
+  return m_info->chunked;
+}
+
+vw::Vector2i vw::DiskImageResourceHDF::block_read_size() const {
+  return m_info->chunked ? m_info->chunk_size : Vector2i( cols(), rows() );
+}
+
+void vw::DiskImageResourceHDF::set_chunk_cache_size( int32 chunks ) {
+  Mutex::Lock lock( hdf_lock() );
+  m_info->set_chunk_cache_size( chunks );
+}
+
 vw::DiskImageResourceHDF::sds_iterator vw::DiskImageResourceHDF::sds_begin() const {
   return m_info->sds_begin();
 }
@@ -584,86 +675,107 @@ vw::DiskImageResourceHDF::sds_iterator vw::DiskImageResourceHDF::sds_end() const
 }
 
 void vw::DiskImageResourceHDF::select_sds_planes( std::vector<vw::DiskImageResourceHDF::SDSBand> const& sds_planes ) {
+  Mutex::Lock lock( hdf_lock() );
   m_format = m_info->select_sds_planes( sds_planes );
 }
 
 vw::DiskImageResourceHDF& vw::DiskImageResourceHDF::select_sds( std::string const& name ) {
+  Mutex::Lock lock( hdf_lock() );
   m_format = m_info->select_sds( name );
   return *this;
 }
 
 void vw::DiskImageResourceHDF::get_sds_fillvalue( std::string const& sds_name, float32& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_fillvalue( sds_name, result );
 }
 
 std::vector<vw::DiskImageResourceHDF::AttrInfo> vw::DiskImageResourceHDF::get_sds_attrs( std::string const& sds_name ) const {
+  Mutex::Lock lock( hdf_lock() );
   return m_info->get_sds_attrs( sds_name );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<int8>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, int8& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<uint8>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, uint8& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<int16>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, int16& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<uint16>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, uint16& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<int32>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, int32& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<uint32>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, uint32& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<float32>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, float32& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::vector<float64>& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, float64& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
 
 void vw::DiskImageResourceHDF::get_sds_attr( std::string const& sds_name, std::string const& attr_name, std::string& result ) const {
+  Mutex::Lock lock( hdf_lock() );
   m_info->get_sds_attr( sds_name, attr_name, result );
 }
@@ -67,9 +67,13 @@ namespace vw {
 
     virtual bool has_block_write () const {return false;}
     virtual bool has_nodata_write() const {return false;}
-    virtual bool has_block_read  () const {return false;}
     virtual bool has_nodata_read () const {return false;}
 
+    /// True if the selected SDSs are all chunked alike, in which case
+    /// the block read size is their chunk size.
+    virtual bool     has_block_read () const;
+    virtual Vector2i block_read_size() const;
+
     // The HDF-specific interface:
 
     struct SDSInfo {
@@ -79,6 +83,7 @@ namespace vw {
       std::vector<int32> dim_sizes;
       bool               coord;
       int32              n_attrs;
+      std::vector<int32> chunk_sizes; ///< Per dimension, or empty if not chunked
     };
 
     typedef std::vector<SDSInfo>::const_iterator sds_iterator;
@@ -101,6 +106,12 @@ namespace vw {
 
     DiskImageResourceHDF& select_sds( std::string const& name );
 
+    /// Sets the number of chunks of each selected SDS kept decompressed.
+    /// Selecting SDSs sets it to two rows of chunks, so that a row of
+    /// blocks straddling two rows of chunks decompresses each chunk
+    /// once; pass 0 to return to that.
+    void set_chunk_cache_size( int32 chunks );
+
     void get_sds_fillvalue( std::string const& sds_name, float32& result ) const;
 
     std::vector<AttrInfo> get_sds_attrs( std::string const& sds_name ) const;
@@ -159,6 +159,15 @@ public:
     advance(1);
   }
 
+  /* Reads the next line straight into dst, which must hold a whole
+   * line. Same warning as readline().
+   */
+  void readline(uint8 *dst) {
+    JSAMPROW row = dst;
+    jpeg_read_scanlines(&decompress_ctx, &row, 1);
+    current_line++;
+  }
+
   /* Advances the current point in the file "lines" number of lines.
    * Sets current_line accordingly.
    *
@@ -281,37 +290,16 @@ void DiskImageResourceJPEG::read( ImageBuffer const& dest, BBox2i const& bbox) c
     ctx->advance(start_row - ctx->current_line);
   }
 
-  // Now read.
-  boost::scoped_array<uint8> buf( new uint8[ctx->cstride * bbox.width() * bbox.height()] );
-
-  int32 offset = 0;
-  while ( ctx->decompress_ctx.output_scanline < end_row)
-  {
-    ctx->readline();
+  // When the destination already has the file's pixel layout the rows
+  // are decoded straight into it, and otherwise each decoded row is
+  // converted into place while it is still in cache.
+  const bool direct     = m_format.copy_convert( dest.format ) && dest.cstride == ctx->cstride;
+  const bool full_width = bbox.min().x() == 0 && bbox.width() == cols();
 
-    // Copy the data over into a contiguous buffer, which is what
-    // convert() expects when we call it below.  This extra copy of
-    // the data is undesirable, but probably not a huge performance
-    // hit compared to reading the data from disk.
-      std::memcpy(buf.get() + offset,
-                  ctx->scanline[0] + ctx->cstride * bbox.min().x(),
-                  bbox.width() * ctx->cstride);
-      offset += bbox.width() * ctx->cstride;
-
-    //for (int i = 0; i < ctx->scanline_size; i++)
-    //  buf[ctx->scanline_size * (ctx->decompress_ctx.output_scanline - start_row - 1) + i]
-    //    = (uint8)(((JSAMPARRAY)(ctx->scanline))[0][i]);
-  }
-
-  // Set up an image buffer around the tdata_t buf object that
-  // jpeg used to copy it's data.
+  // One decoded row of bbox, as convert() sees it.
   ImageBuffer src;
-  src.data = buf.get();
   src.format = m_format;
-
-  // The number of rows we're reading may be different, seeing as how we
-  // can read sequential lines.
-  src.format.rows = bbox.height();
+  src.format.rows = 1;
   src.format.cols = bbox.width();
 
   // This is part of the grayscale optimization that we remove due to
@@ -323,9 +311,23 @@ void DiskImageResourceJPEG::read( ImageBuffer const& dest, BBox2i const& bbox) c
 
   src.cstride = ctx->cstride;
   src.rstride = src.cstride * src.format.cols;
-  src.pstride = src.rstride * src.format.rows;
-  convert( dest, src, m_rescale );
+  src.pstride = src.rstride;
 
+  // Now read.
+  for ( int32 row = 0; ctx->decompress_ctx.output_scanline < end_row; ++row )
+  {
+    uint8 *dst_row = static_cast<uint8*>(dest.data) + row * dest.rstride;
+    if ( direct && full_width ) {
+      ctx->readline( dst_row );
+      continue;
+    }
+    ctx->readline();
+    src.data = ctx->scanline[0] + ctx->cstride * bbox.min().x();
+    if ( direct )
+      std::memcpy( dst_row, src.data, bbox.width() * ctx->cstride );
+    else
+      convert( dest.cropped( BBox2i( 0, row, bbox.width(), 1 ) ), src, m_rescale );
+  }
 }
 
 void DiskImageResourceJPEG::read_reset() const {
@@ -0,0 +1,159 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceMapped.cc
+///
+/// A read-only image resource that memory-maps uncompressed raster files.
+///
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/Math/BBox.h>
+#include <vw/FileIO/DiskImageResourceMapped.h>
+#include <vw/FileIO/DiskImageResourcePBM.h>
+#include <vw/FileIO/DiskImageResourceRaw.h>
+
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace fs = boost::filesystem;
+namespace io = boost::iostreams;
+
+namespace {
+
+  // The deleter for the pixel pointer: keeps the mapping alive for as
+  // long as any pointer into it (views, native_ptr() results) exists.
+  struct MappedFileHolder {
+    boost::shared_ptr<io::mapped_file> file;
+    void operator()( vw::uint8* ) { file.reset(); }
+  };
+
+  std::string lower_extension( std::string const& filename ) {
+    return boost::to_lower_copy( fs::path(filename).extension().string() );
+  }
+
+  bool is_raw_extension( std::string const& filename ) {
+    std::string ext = lower_extension( filename );
+    return ext == ".bil" || ext == ".bip" || ext == ".bsq";
+  }
+
+}
+
+namespace vw {
+
+DiskImageResourceMapped::DiskImageResourceMapped( std::string const& filename,
+                                                  ImageFormat const& format,
+                                                  size_t             data_offset,
+                                                  Vector2i const&    block_size )
+  : DiskImageResource( filename ), m_data_offset( data_offset ) {
+  m_format = format;
+  if ( m_format.cols < 1 || m_format.rows < 1 || m_format.planes < 1 )
+    vw_throw( ArgumentErr() << "DiskImageResourceMapped: Image in \"" << filename << "\" is size zero!" );
+
+  // Copy-on-write pages, so views of them can be written to safely.
+  io::mapped_file_params params( filename );
+  params.flags = io::mapped_file::priv;
+  boost::shared_ptr<io::mapped_file> file( new io::mapped_file() );
+  try {
+    file->open( params );
+  } catch ( std::exception const& e ) {
+    vw_throw( IOErr() << "DiskImageResourceMapped: Failed to map \"" << filename << "\": " << e.what() );
+  }
+
+  if ( file->size() < data_offset + m_format.byte_size() )
+    vw_throw( IOErr() << "DiskImageResourceMapped: \"" << filename << "\" is too short to hold a "
+                      << cols() << "x" << rows() << "x" << planes() << " image." );
+
+  MappedFileHolder holder;
+  holder.file = file;
+  m_pixels = boost::shared_array<uint8>( reinterpret_cast<uint8*>( file->data() ) + data_offset, holder );
+
+  // Reads are cheap at any size, so default to strips like DiskImageResourceRaw.
+  if ( block_size[0] > 0 && block_size[1] > 0 )
+    m_block_size = block_size;
+  else
+    m_block_size = Vector2i( cols(), std::min( rows(), 1024 ) );
+}
+
+void DiskImageResourceMapped::read( ImageBuffer const& dest, BBox2i const& bbox ) const {
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 &&
+             bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourceMapped: Requested read bbox " << bbox << " is out of bounds." );
+
+  ImageBuffer src( m_format, m_pixels.get() );
+  convert( dest, src.cropped( bbox ), m_rescale );
+}
+
+void DiskImageResourceMapped::write( ImageBuffer const& /*src*/, BBox2i const& /*bbox*/ ) {
+  vw_throw( NoImplErr() << "DiskImageResourceMapped: \"" << m_filename << "\" is mapped read-only." );
+}
+
+boost::shared_array<const uint8> DiskImageResourceMapped::native_ptr() const {
+  return boost::shared_array<const uint8>( m_pixels, m_pixels.get() );
+}
+
+DiskImageResourceMapped* DiskImageResourceMapped::try_open( std::string const& filename ) {
+  ImageFormat format;
+  size_t      data_offset = 0;
+  bool        rescale     = true;
+
+  if ( is_raw_extension( filename ) ) {
+    // DiskImageResourceRaw knows how to find the size of a SPOT5 image.
+    boost::scoped_ptr<DiskImageResource> raw( DiskImageResourceRaw::construct_open( filename ) );
+    format  = raw->format();
+    rescale = false;
+  } else {
+    // Only binary 8-bit graymaps and pixmaps are stored as-is.
+    DiskImageResourcePBM pbm( filename );
+    if ( ( pbm.magic() != "P5" && pbm.magic() != "P6" ) || pbm.max_value() != 255 )
+      return 0;
+    format      = pbm.format();
+    data_offset = size_t( pbm.data_position() );
+  }
+
+  DiskImageResourceMapped* rsrc = 0;
+  try {
+    rsrc = new DiskImageResourceMapped( filename, format, data_offset );
+  } catch ( IOErr const& e ) {
+    VW_OUT(DebugMessage, "fileio") << "Not memory-mapping " << filename << ": " << e.what() << "\n";
+    return 0;
+  }
+  if ( !rescale )
+    rsrc->set_rescale( false );
+  return rsrc;
+}
+
+DiskImageResource* DiskImageResourceMapped::construct_open( std::string const& filename ) {
+  DiskImageResource* rsrc = try_open( filename );
+  if ( rsrc )
+    return rsrc;
+  if ( is_raw_extension( filename ) )
+    return DiskImageResourceRaw::construct_open( filename );
+  return DiskImageResourcePBM::construct_open( filename );
+}
+
+DiskImageResource* DiskImageResourceMapped::construct_create( std::string const& filename,
+                                                              ImageFormat const& format ) {
+  if ( is_raw_extension( filename ) )
+    return DiskImageResourceRaw::construct_create( filename, format );
+  return DiskImageResourcePBM::construct_create( filename, format );
+}
+
+} // namespace vw
@@ -0,0 +1,156 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceMapped.h
+///
+/// A read-only image resource that memory-maps uncompressed raster files.
+///
+/// Files whose pixels are stored uncompressed and interleaved, row
+/// after row, at a fixed offset into the file (binary PGM and PPM,
+/// raw SPOT5 BIL dumps) do not need to be read through a stream at
+/// all.  DiskImageResourceMapped maps such a file into memory and
+/// serves block reads by converting straight out of the mapped pages.
+/// When the requested pixel type matches the file's layout, view()
+/// goes one step further and returns an ImageView that points at the
+/// mapped pages themselves:
+///
+///   boost::scoped_ptr<DiskImageResourceMapped> rsrc( DiskImageResourceMapped::try_open( "big.pgm" ) );
+///   if ( rsrc && rsrc->has_view<PixelGray<uint8> >() ) {
+///     ImageView<PixelGray<uint8> > image = rsrc->view<PixelGray<uint8> >(); // No copy
+///     ...
+///   }
+///
+/// The pages are mapped copy-on-write, so writing into such a view
+/// never modifies the file.
+///
+/// The resource is registered for .pgm, .ppm, .pbm, .bil, .bip and
+/// .bsq files.  Files it cannot map (ASCII or 16-bit Netpbm files,
+/// for example) are opened with DiskImageResourcePBM or
+/// DiskImageResourceRaw as before, and files are always created
+/// with those resources.
+#ifndef __VW_FILEIO_DISKIMAGERESOURCEMAPPED_H__
+#define __VW_FILEIO_DISKIMAGERESOURCEMAPPED_H__
+
+#include <string>
+#include <boost/shared_array.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypeInfo.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+namespace vw {
+
+  /// A read-only resource backed by a memory-mapped uncompressed file.
+  class DiskImageResourceMapped : public DiskImageResource {
+  public:
+
+    /// Maps a file that holds an image of the given format, stored
+    /// uncompressed and packed (planes of rows of pixels) starting
+    /// data_offset bytes into the file.
+    DiskImageResourceMapped( std::string const& filename,
+                             ImageFormat const& format,
+                             size_t             data_offset = 0,
+                             Vector2i const&    block_size  = Vector2i(-1,-1) );
+
+    virtual ~DiskImageResourceMapped() {}
+
+    /// Returns the type of disk image resource.
+    static std::string type_static() { return "Mapped"; }
+
+    /// Returns the type of disk image resource.
+    virtual std::string type() { return type_static(); }
+
+    /// Converts the requested region directly from the mapped pages.
+    virtual void read ( ImageBuffer const& dest, BBox2i const& bbox ) const;
+
+    /// Mapped resources are read-only; this always throws NoImplErr.
+    virtual void write( ImageBuffer const& src,  BBox2i const& bbox );
+
+    virtual void flush() {}
+
+    virtual bool has_block_write () const {return false;}
+    virtual bool has_nodata_write() const {return false;}
+    virtual bool has_block_read  () const {return true; }
+    virtual bool has_nodata_read () const {return false;}
+
+    /// Returns the preferred block size/alignment for partial reads.
+    virtual Vector2i block_read_size() const { return m_block_size; }
+
+    /// Returns the mapped pixels themselves rather than a copy.
+    virtual boost::shared_array<const uint8> native_ptr() const;
+
+    /// The offset of the pixel data from the start of the file.
+    size_t data_offset() const { return m_data_offset; }
+
+    /// True if view<PixelT>() can return the mapped pages without a copy.
+    template <class PixelT>
+    bool has_view() const;
+
+    /// Returns the whole image as an ImageView.  If has_view<PixelT>()
+    /// holds the view shares the mapped pages; otherwise the image is
+    /// read and converted into a newly allocated ImageView.
+    template <class PixelT>
+    ImageView<PixelT> view() const;
+
+    /// Maps a binary 8-bit PGM/PPM file or a SPOT5 raw image.  Returns
+    /// NULL if the file is of a kind that cannot be mapped.
+    static DiskImageResourceMapped* try_open( std::string const& filename );
+
+    /// Factory functions used by DiskImageResource.cc.  construct_open()
+    /// falls back to the PBM or Raw resource for files that cannot be
+    /// mapped, and construct_create() always uses them.
+    static DiskImageResource* construct_open  ( std::string const& filename );
+    static DiskImageResource* construct_create( std::string const& filename,
+                                                ImageFormat const& format );
+
+  private:
+    boost::shared_array<uint8> m_pixels; ///< Start of the pixel data; keeps the mapping alive
+    size_t   m_data_offset;
+    Vector2i m_block_size;
+  };
+
+
+  template <class PixelT>
+  bool DiskImageResourceMapped::has_view() const {
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    const int32 num_pixel_channels = PixelNumChannels<PixelT>::value;
+
+    if ( ChannelTypeID<channel_type>::value != m_format.channel_type ||
+         uint32(num_pixel_channels) != num_channels( m_format.pixel_format ) )
+      return false;
+    // Multi-channel pixels must match exactly, while single-channel data
+    // can be viewed as either scalars or gray pixels, one plane each.
+    if ( num_pixel_channels > 1 &&
+         ( PixelFormatID<PixelT>::value != m_format.pixel_format || m_format.planes != 1 ) )
+      return false;
+    return reinterpret_cast<size_t>( m_pixels.get() ) % boost::alignment_of<PixelT>::value == 0;
+  }
+
+  template <class PixelT>
+  ImageView<PixelT> DiskImageResourceMapped::view() const {
+    if ( !has_view<PixelT>() )
+      return ImageView<PixelT>( static_cast<SrcImageResource const&>( *this ) );
+
+    boost::shared_array<PixelT> pixels( m_pixels, reinterpret_cast<PixelT*>( m_pixels.get() ) );
+    return ImageView<PixelT>( pixels, cols(), rows(), planes() );
+  }
+
+} // namespace vw
+
+#endif // __VW_FILEIO_DISKIMAGERESOURCEMAPPED_H__
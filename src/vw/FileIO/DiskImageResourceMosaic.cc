@@ -0,0 +1,176 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceMosaic.cc
+///
+/// A read-only resource composed of many image files.
+///
+
+#include <vw/Core/Settings.h>
+#include <vw/FileIO/DiskImageResourceMosaic.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace vw {
+
+  boost::shared_ptr<DiskImageResource> DiskImageResourceMosaic::FileGenerator::generate() const {
+    boost::shared_ptr<DiskImageResource> rsrc( DiskImageResource::open( m_filename ) );
+    // Values pass through unchanged; DiskImageResourceMosaic::read() rescales once.
+    rsrc->set_rescale( false );
+    return rsrc;
+  }
+
+  DiskImageResourceMosaic::DiskImageResourceMosaic( ImageFormat const& format,
+                                                    size_t max_open,
+                                                    std::string const& name )
+    : DiskImageResource( name ), m_open_files( std::max( max_open, size_t(1) ) ),
+      m_block_size( vw_settings().default_tile_size(), vw_settings().default_tile_size() ),
+      m_has_nodata( false ), m_nodata( 0 ),
+      m_index_dirty( true ), m_cell_size( 1 ), m_grid_size( 0, 0 ) {
+    m_format = format;
+    m_format.cols = m_format.rows = 0;
+    VW_ASSERT( m_format.planes == 1 || m_format.pixel_format == VW_PIXEL_SCALAR,
+               ArgumentErr() << "DiskImageResourceMosaic: The format cannot have both multiple channels and multiple planes." );
+  }
+
+  void DiskImageResourceMosaic::add( std::string const& filename, BBox2i const& footprint ) {
+    VW_ASSERT( !footprint.empty() && footprint.min().x() >= 0 && footprint.min().y() >= 0,
+               ArgumentErr() << "DiskImageResourceMosaic: Invalid footprint " << footprint
+                             << " for " << filename );
+    File file;
+    file.filename  = filename;
+    file.footprint = footprint;
+    file.handle    = m_open_files.insert( FileGenerator( filename ) );
+    file.mutex.reset( new Mutex );
+    m_files.push_back( file );
+
+    m_format.cols = std::max( m_format.cols, uint32( footprint.max().x() ) );
+    m_format.rows = std::max( m_format.rows, uint32( footprint.max().y() ) );
+
+    Mutex::Lock lock( m_index_mutex );
+    m_index_dirty = true;
+  }
+
+  double DiskImageResourceMosaic::nodata_read() const {
+    VW_ASSERT( m_has_nodata, IOErr() << "DiskImageResourceMosaic: This mosaic does not have a nodata value." );
+    return m_nodata;
+  }
+
+  void DiskImageResourceMosaic::set_nodata_read( double value ) {
+    m_has_nodata = true;
+    m_nodata     = value;
+  }
+
+  size_t DiskImageResourceMosaic::num_open() const {
+    return m_open_files.size();
+  }
+
+  void DiskImageResourceMosaic::build_index_locked() const {
+    // Cells about the size of an average footprint keep both the number
+    // of cells a file lands in and the number of files per cell small.
+    double mean_side = 0;
+    for ( size_t i = 0; i < m_files.size(); ++i )
+      mean_side += 0.5 * ( m_files[i].footprint.width() + m_files[i].footprint.height() );
+    m_cell_size = std::max( int32( m_files.empty() ? 1 : mean_side / m_files.size() ), int32(1) );
+
+    m_grid_size = Vector2i( ( m_format.cols + m_cell_size - 1 ) / m_cell_size,
+                            ( m_format.rows + m_cell_size - 1 ) / m_cell_size );
+    m_grid.assign( size_t(m_grid_size.x()) * m_grid_size.y(), std::vector<uint32>() );
+    for ( size_t i = 0; i < m_files.size(); ++i ) {
+      BBox2i const& fp = m_files[i].footprint;
+      for ( int32 y = fp.min().y() / m_cell_size; y <= ( fp.max().y() - 1 ) / m_cell_size; ++y )
+        for ( int32 x = fp.min().x() / m_cell_size; x <= ( fp.max().x() - 1 ) / m_cell_size; ++x )
+          m_grid[ size_t(y) * m_grid_size.x() + x ].push_back( uint32(i) );
+    }
+    m_index_dirty = false;
+  }
+
+  std::vector<size_t> DiskImageResourceMosaic::intersecting( BBox2i const& bbox ) const {
+    std::vector<size_t> result;
+    BBox2i area = bbox;
+    area.crop( BBox2i( 0, 0, m_format.cols, m_format.rows ) );
+    if ( area.empty() )
+      return result;
+
+    Mutex::Lock lock( m_index_mutex );
+    if ( m_index_dirty )
+      build_index_locked();
+
+    for ( int32 y = area.min().y() / m_cell_size; y <= ( area.max().y() - 1 ) / m_cell_size; ++y )
+      for ( int32 x = area.min().x() / m_cell_size; x <= ( area.max().x() - 1 ) / m_cell_size; ++x ) {
+        std::vector<uint32> const& cell = m_grid[ size_t(y) * m_grid_size.x() + x ];
+        for ( size_t i = 0; i < cell.size(); ++i )
+          if ( m_files[cell[i]].footprint.intersects( area ) )
+            result.push_back( cell[i] );
+      }
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique( result.begin(), result.end() ), result.end() );
+    return result;
+  }
+
+  void DiskImageResourceMosaic::read( ImageBuffer const& dest, BBox2i const& bbox ) const {
+    VW_ASSERT( dest.format.cols == uint32(bbox.width()) && dest.format.rows == uint32(bbox.height()),
+               ArgumentErr() << "DiskImageResourceMosaic: Destination buffer does not match " << bbox );
+
+    // Assemble the region in the mosaic's own format, then convert once.
+    ImageFormat region_fmt = m_format;
+    region_fmt.cols = bbox.width();
+    region_fmt.rows = bbox.height();
+    boost::scoped_array<uint8> region_data( new uint8[region_fmt.byte_size()] );
+    ImageBuffer region( region_fmt, region_data.get() );
+
+    if ( m_has_nodata ) {
+      // Convert one pixel of nodata to the mosaic's format and repeat it.
+      ImageFormat pixel_fmt = region_fmt;
+      pixel_fmt.cols = pixel_fmt.rows = pixel_fmt.planes = 1;
+      pixel_fmt.channel_type = VW_CHANNEL_FLOAT64;
+      std::vector<double> nodata_in( num_channels( pixel_fmt.pixel_format ), m_nodata );
+      std::vector<uint8>  nodata_out( region.cstride );
+      ImageFormat out_fmt = pixel_fmt;
+      out_fmt.channel_type = region_fmt.channel_type;
+      convert( ImageBuffer( out_fmt, &nodata_out[0] ), ImageBuffer( pixel_fmt, &nodata_in[0] ), false );
+      for ( size_t i = 0; i < region_fmt.byte_size(); i += region.cstride )
+        std::memcpy( region_data.get() + i, &nodata_out[0], region.cstride );
+    } else {
+      std::memset( region_data.get(), 0, region_fmt.byte_size() );
+    }
+
+    std::vector<size_t> files = intersecting( bbox );
+    for ( size_t k = 0; k < files.size(); ++k ) {
+      File const& file = m_files[files[k]];
+      BBox2i overlap = file.footprint;
+      overlap.crop( bbox );
+
+      Mutex::Lock lock( *file.mutex );
+      boost::shared_ptr<DiskImageResource> rsrc = file.handle;
+      VW_ASSERT( rsrc->cols() == file.footprint.width() && rsrc->rows() == file.footprint.height(),
+                 IOErr() << "DiskImageResourceMosaic: " << file.filename << " is " << rsrc->cols()
+                         << "x" << rsrc->rows() << " but its footprint is " << file.footprint );
+      rsrc->read( region.cropped( overlap - bbox.min() ), overlap - file.footprint.min() );
+      file.handle.release();
+    }
+
+    convert( dest, region, m_rescale );
+  }
+
+  void DiskImageResourceMosaic::write( ImageBuffer const& /*src*/, BBox2i const& /*bbox*/ ) {
+    vw_throw( NoImplErr() << "DiskImageResourceMosaic: Mosaics are read-only." );
+  }
+
+} // namespace vw
@@ -0,0 +1,144 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DiskImageResourceMosaic.h
+///
+/// A read-only resource that presents many adjacent image files as
+/// one virtual raster, without writing a VRT or compositing them.
+///
+/// Each file is placed at a pixel footprint in the mosaic.  Nothing is
+/// opened up front: a read looks up the footprints which intersect it
+/// in a grid index and opens only those files, keeping at most
+/// max_open of them open at once and closing the least recently used
+/// ones beyond that.  Where footprints overlap, the file added last
+/// wins; pixels no file covers read as the nodata value, or zero.
+///
+///   DiskImageResourceMosaic mosaic( format );
+///   mosaic.add( "scene_00.tif", BBox2i(    0, 0, 5000, 5000) );
+///   mosaic.add( "scene_01.tif", BBox2i( 5000, 0, 5000, 5000) );
+///   ImageView<float> crop;
+///   read_image( crop, mosaic, BBox2i(4000,0,2000,2000) ); // Opens both files
+///
+/// cartography::georeferenced_mosaic() builds one from a set of
+/// georeferenced files on a common pixel grid.
+#ifndef __VW_FILEIO_DISKIMAGERESOURCEMOSAIC_H__
+#define __VW_FILEIO_DISKIMAGERESOURCEMOSAIC_H__
+
+#include <string>
+#include <vector>
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/Thread.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+namespace vw {
+
+  class DiskImageResourceMosaic : public DiskImageResource {
+  public:
+
+    /// An empty mosaic whose pixels are read in the given format.
+    /// The dimensions of the format are ignored; the mosaic covers the
+    /// footprints passed to add().
+    DiskImageResourceMosaic( ImageFormat const& format,
+                             size_t max_open = 64,
+                             std::string const& name = "mosaic" );
+
+    virtual ~DiskImageResourceMosaic() {}
+
+    /// Returns the type of disk image resource.
+    static std::string type_static() { return "Mosaic"; }
+
+    /// Returns the type of disk image resource.
+    virtual std::string type() { return type_static(); }
+
+    /// Place a file in the mosaic.  The file is not opened until a read
+    /// touches it, at which point its size must match the footprint.
+    /// Footprints must not extend to negative coordinates.
+    /// Not thread-safe with respect to read().
+    void add( std::string const& filename, BBox2i const& footprint );
+
+    /// Reads the files intersecting bbox, each converted without rescaling.
+    virtual void read ( ImageBuffer const& dest, BBox2i const& bbox ) const;
+
+    /// Mosaics are read-only; this always throws NoImplErr.
+    virtual void write( ImageBuffer const& src,  BBox2i const& bbox );
+
+    virtual void flush() {}
+
+    virtual bool has_block_write () const {return false;}
+    virtual bool has_nodata_write() const {return false;}
+    virtual bool has_block_read  () const {return true; }
+    virtual bool has_nodata_read () const {return m_has_nodata;}
+
+    virtual Vector2i block_read_size() const { return m_block_size; }
+    void set_block_read_size( Vector2i const& block_size ) { m_block_size = block_size; }
+
+    /// The value given to pixels which no file covers.
+    virtual double nodata_read() const;
+    void set_nodata_read( double value );
+
+    /// The placed files, in the order they were added.
+    size_t             num_files() const { return m_files.size(); }
+    std::string const& file     ( size_t i ) const { return m_files[i].filename; }
+    BBox2i const&      footprint( size_t i ) const { return m_files[i].footprint; }
+
+    /// The indices of the files whose footprints intersect bbox, in the
+    /// order they were added.
+    std::vector<size_t> intersecting( BBox2i const& bbox ) const;
+
+    /// How many of the files are open at the moment.
+    size_t num_open() const;
+
+  private:
+    /// Opens one of the files for the handle cache.
+    class FileGenerator {
+      std::string m_filename;
+    public:
+      typedef DiskImageResource value_type;
+      FileGenerator( std::string const& filename ) : m_filename(filename) {}
+      size_t size() const { return 1; }
+      boost::shared_ptr<DiskImageResource> generate() const;
+    };
+
+    struct File {
+      std::string                    filename;
+      BBox2i                         footprint;
+      Cache::Handle<FileGenerator>   handle;
+      boost::shared_ptr<Mutex>       mutex; ///< Serializes the reads of this file
+    };
+
+    void build_index_locked() const;
+
+    mutable Cache     m_open_files; ///< Sized in files, not bytes; outlives the handles
+    std::vector<File> m_files;
+    Vector2i          m_block_size;
+    bool              m_has_nodata;
+    double            m_nodata;
+
+    // A uniform grid over the mosaic, each cell listing the files which
+    // touch it.  Rebuilt on the first read after an add().
+    mutable Mutex                             m_index_mutex;
+    mutable bool                              m_index_dirty;
+    mutable int32                             m_cell_size;
+    mutable Vector2i                          m_grid_size;
+    mutable std::vector<std::vector<uint32> > m_grid;
+  };
+
+} // namespace vw
+
+#endif // __VW_FILEIO_DISKIMAGERESOURCEMOSAIC_H__
@@ -39,8 +39,10 @@
 #include <ImfArray.h>
 #include <ImfLineOrder.h>
 #include <ImfChannelList.h>
+#include <ImfThreading.h>
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/Statistics.h>
 #include <vw/FileIO/DiskImageResourceOpenEXR.h>
@@ -77,6 +79,36 @@ namespace {
 
   }
 
+  // The scanlines OpenEXR compresses together.  Reads and writes of
+  // whole chunks decompress each chunk once.
+  static int openexr_lines_per_chunk(Imf::Compression compression) {
+    switch (compression) {
+    case Imf::ZIP_COMPRESSION:
+    case Imf::PXR24_COMPRESSION: return 16;
+    case Imf::PIZ_COMPRESSION:
+    case Imf::B44_COMPRESSION:
+    case Imf::B44A_COMPRESSION:  return 32;
+    default:                     return 1;
+    }
+  }
+
+  // Size OpenEXR's codec thread pool to the default thread count.
+  static void set_openexr_thread_count() {
+    int threads = vw::vw_settings().default_num_threads();
+    if (Imf::globalThreadCount() != threads)
+      Imf::setGlobalThreadCount(threads);
+  }
+
+  // A block of up to one tile per thread across, so that one call to
+  // OpenEXR has work for its whole thread pool.
+  static vw::Vector2i openexr_block_size(vw::Vector2i const& tile_size, vw::int32 cols, bool tiled) {
+    int threads = vw::vw_settings().default_num_threads();
+    if (!tiled)
+      return vw::Vector2i(cols, tile_size.y() * threads);
+    int tiles_across = (cols + tile_size.x() - 1) / tile_size.x();
+    return vw::Vector2i(tile_size.x() * std::max(1, std::min(threads, tiles_across)), tile_size.y());
+  }
+
 }
 
 
@@ -89,12 +121,17 @@ vw::DiskImageResourceOpenEXR::~DiskImageResourceOpenEXR() {
     else
       delete reinterpret_cast<Imf::InputFile*>(m_input_file_ptr);
   }
+  close_output();
+}
+
+void vw::DiskImageResourceOpenEXR::close_output() {
   if (m_output_file_ptr) {
     if (m_tiled)
       delete reinterpret_cast<Imf::TiledOutputFile*>(m_output_file_ptr);
     else
       delete reinterpret_cast<Imf::OutputFile*>(m_output_file_ptr);
   }
+  m_output_file_ptr = 0;
 }
 
 vw::Vector2i vw::DiskImageResourceOpenEXR::block_read_size() const {
@@ -119,11 +156,14 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
     if (m_input_file_ptr)
       vw_throw( IOErr() << "Disk image resources do not yet support reuse." );
 
-    m_input_file_ptr = new Imf::InputFile(filename.c_str());
+    set_openexr_thread_count();
+    Imf::InputFile* input = new Imf::InputFile(filename.c_str());
+    m_input_file_ptr = input;
+    Imf::Header header = input->header();
 
     // Check to see if the file is tiled.  If it does, close the descriptor and reopen as a tiled file.
-    if (reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().hasTileDescription()) {
-      delete reinterpret_cast<Imf::InputFile*>(m_input_file_ptr);
+    if (header.hasTileDescription()) {
+      delete input;
       m_input_file_ptr = new Imf::TiledInputFile(filename.c_str());
       m_tiled = true;
     } else {
@@ -131,14 +171,14 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
     }
 
     // Find the width and height of the image
-    Imath::Box2i dw = reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().dataWindow();
+    Imath::Box2i dw = header.dataWindow();
     m_format.cols  = int(dw.max.x - dw.min.x + 1);
     m_format.rows  = int(dw.max.y - dw.min.y + 1);
 
     // Determine the number of image channels
-    Imf::ChannelList::ConstIterator iter = reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().channels().begin();
+    Imf::ChannelList::ConstIterator iter = header.channels().begin();
     int num_channels = 0;
-    while( iter != reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().channels().end() ) {
+    while( iter != header.channels().end() ) {
       num_channels++;
       iter++;
     }
@@ -150,11 +190,12 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
     m_format.channel_type = VW_CHANNEL_FLOAT32;
 
     if (m_tiled) {
-      Imf::TileDescription desc = reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->header().tileDescription();
-      m_block_size = Vector2i(desc.xSize, desc.ySize);
+      Imf::TileDescription desc = header.tileDescription();
+      m_tile_size = Vector2i(desc.xSize, desc.ySize);
     } else {
-      m_block_size = Vector2i(m_format.cols,m_openexr_rows_per_block);
+      m_tile_size = Vector2i(m_format.cols, openexr_lines_per_chunk(header.compression()));
     }
+    m_block_size = openexr_block_size(m_tile_size, m_format.cols, m_tiled);
   } catch (const Iex::ErrnoExc& e) { // Catches non existant files
     vw_throw( vw::ArgumentErr() << "DiskImageResourceOpenEXR: could not open " << filename << ":\n\t" << e.what() );
   } catch (const Iex::InputExc& e) { // Catches non open exr image
@@ -166,16 +207,11 @@ void vw::DiskImageResourceOpenEXR::open( std::string const& filename )
 
 
 void vw::DiskImageResourceOpenEXR::set_tiled_write(int32 tile_width, int32 tile_height, bool random_tile_order) {
-  m_tiled = true;
-  m_block_size = Vector2i(tile_width, tile_height);
-
   // Close and reopen the file
-  if (m_output_file_ptr) {
-    if (m_tiled)
-      delete reinterpret_cast<Imf::TiledOutputFile*>(m_output_file_ptr);
-    else
-      delete reinterpret_cast<Imf::OutputFile*>(m_output_file_ptr);
-  }
+  close_output();
+  m_tiled = true;
+  m_tile_size = Vector2i(tile_width, tile_height);
+  m_block_size = openexr_block_size(m_tile_size, m_format.cols, m_tiled);
 
   try {
     // Create the file header with the appropriate number of
@@ -186,7 +222,7 @@ void vw::DiskImageResourceOpenEXR::set_tiled_write(int32 tile_width, int32 tile_
       header.channels().insert (m_labels[nn].c_str(), Imf::Channel (Imf::FLOAT));
     }
 
-    header.setTileDescription(Imf::TileDescription (m_block_size[0], m_block_size[1], Imf::ONE_LEVEL));
+    header.setTileDescription(Imf::TileDescription (m_tile_size[0], m_tile_size[1], Imf::ONE_LEVEL));
 
     // Instruct the OpenEXR library to write tiles to the file in
     // whatever order they are given.  Otherwise, OpenEXR will buffer
@@ -209,16 +245,9 @@ void vw::DiskImageResourceOpenEXR::set_block_write_size(Vector2i const& block_si
 }
 
 void vw::DiskImageResourceOpenEXR::set_scanline_write(int32 scanlines_per_block) {
-  m_tiled = false;
-  m_block_size = Vector2i(m_format.cols,scanlines_per_block);
-
   // Close and reopen the file
-  if (m_output_file_ptr) {
-    if (m_tiled)
-      delete reinterpret_cast<Imf::TiledOutputFile*>(m_output_file_ptr);
-    else
-      delete reinterpret_cast<Imf::OutputFile*>(m_output_file_ptr);
-  }
+  close_output();
+  m_tiled = false;
 
   try {
     // Create the file header with the appropriate number of
@@ -230,7 +259,10 @@ void vw::DiskImageResourceOpenEXR::set_scanline_write(int32 scanlines_per_block)
     }
     header.lineOrder() = Imf::INCREASING_Y;
 
-    m_block_size = Vector2i(m_format.cols,m_openexr_rows_per_block);
+    // Whole compressed chunks, so that none is split between two writes.
+    int32 lines = openexr_lines_per_chunk(header.compression());
+    m_tile_size = Vector2i(m_format.cols, lines);
+    m_block_size = Vector2i(m_format.cols, (std::max(scanlines_per_block, lines) + lines - 1) / lines * lines);
     m_output_file_ptr = new Imf::OutputFile(m_filename.c_str(), header);
 
   } catch (const Iex::BaseExc& e) {
@@ -253,6 +285,7 @@ void vw::DiskImageResourceOpenEXR::create( std::string const& filename,
 
   // Open the EXR file and set up the header information
   m_labels.resize(m_format.planes);
+  set_openexr_thread_count();
 
   // By default, write out the image as a tiled image.
   this->set_tiled_write(vw_settings().default_tile_size(),vw_settings().default_tile_size());
@@ -311,8 +344,20 @@ void vw::DiskImageResourceOpenEXR::read( ImageBuffer const& dest, BBox2i const&
       }
     }
 
+    // Tiles and scanlines are read whole, so read the tiles or rows
+    // covering the bbox and copy out the part of them it covers.
+    BBox2i read_bbox = bbox;
+    if (m_tiled) {
+      read_bbox.min() = elem_prod(elem_quot(bbox.min(), m_tile_size), m_tile_size);
+      read_bbox.max() = elem_prod(elem_quot(bbox.max() + m_tile_size - Vector2i(1,1), m_tile_size), m_tile_size);
+      read_bbox.crop(BBox2i(0, 0, m_format.cols, m_format.rows));
+    } else {
+      read_bbox.min().x() = 0;
+      read_bbox.max().x() = m_format.cols;
+    }
+
     // Copy the pixels over into a ImageView object.
-    ImageView<float> src_image(width, height, m_format.planes);
+    ImageView<float> src_image(read_bbox.width(), read_bbox.height(), m_format.planes);
     ImageBuffer src = src_image.buffer();
     Imf::FrameBuffer frameBuffer;
     for ( size_t nn = 0; nn < m_format.planes; ++nn ) {
@@ -320,26 +365,26 @@ void vw::DiskImageResourceOpenEXR::read( ImageBuffer const& dest, BBox2i const&
       frameBuffer.insert(
           channel_names[nn].c_str(),
           Imf::Slice(Imf::FLOAT,
-                     base - (bbox.min().x()*src.cstride) - (bbox.min().y() * src.rstride),
+                     base - (read_bbox.min().x()*src.cstride) - (read_bbox.min().y() * src.rstride),
                      src.cstride, src.rstride, 1, 1, 0.0));
 
     }
     if (m_tiled) {
-      VW_ASSERT(bbox.min().x() % m_block_size[0] == 0 && bbox.min().y() % m_block_size[1] == 0,
-                ArgumentErr() << "DiskImageResourceOpenEXR: bbox corner must fall on tile boundary for read of tiled images.");
-
       reinterpret_cast<Imf::TiledInputFile*>(m_input_file_ptr)->setFrameBuffer (frameBuffer);
-      int first_tile_x = bbox.min().x() / m_block_size[0];
-      int first_tile_y = bbox.min().y() / m_block_size[1];
-      int last_tile_x = (bbox.max().x()-1) / m_block_size[0];
-      int last_tile_y = (bbox.max().y()-1) / m_block_size[1];
+      int first_tile_x = read_bbox.min().x() / m_tile_size[0];
+      int first_tile_y = read_bbox.min().y() / m_tile_size[1];
+      int last_tile_x = (read_bbox.max().x()-1) / m_tile_size[0];
+      int last_tile_y = (read_bbox.max().y()-1) / m_tile_size[1];
       reinterpret_cast<Imf::TiledInputFile*>(m_input_file_ptr)->readTiles(first_tile_x, last_tile_x, first_tile_y, last_tile_y);
     } else {
       reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->setFrameBuffer (frameBuffer);
       reinterpret_cast<Imf::InputFile*>(m_input_file_ptr)->readPixels (bbox.min().y(), std::min<int32>(bbox.min().y() + (height-1), m_format.rows));
     }
 
-    convert( dest, src_image.buffer(), m_rescale );
+    src.data = &src_image(bbox.min().x() - read_bbox.min().x(), bbox.min().y() - read_bbox.min().y());
+    src.format.cols = width;
+    src.format.rows = height;
+    convert( dest, src, m_rescale );
 
   } catch (const Iex::BaseExc& e) {
     vw_throw( vw::IOErr() << "Failed to open " << m_filename << " using the OpenEXR image reader.\n\t" << e.what() );
@@ -377,15 +422,16 @@ void vw::DiskImageResourceOpenEXR::write( ImageBuffer const& src, BBox2i const&
 
     // Write the data to disk.
     if (m_tiled) {
-      VW_ASSERT(bbox.min().x() % m_block_size[0] == 0 && bbox.min().y() % m_block_size[1] == 0,
+      VW_ASSERT(bbox.min().x() % m_tile_size[0] == 0 && bbox.min().y() % m_tile_size[1] == 0,
                 ArgumentErr() << "DiskImageResourceOpenEXR: bbox corner must fall on tile boundary for writing of tiled images.");
 
+      // OpenEXR compresses the tiles of one call in parallel.
       Imf::TiledOutputFile* out = reinterpret_cast<Imf::TiledOutputFile*>(m_output_file_ptr);
       out->setFrameBuffer (frameBuffer);
-      int first_tile_x = bbox.min().x() / m_block_size[0];
-      int first_tile_y = bbox.min().y() / m_block_size[1];
-      int last_tile_x = (bbox.max().x()-1) / m_block_size[0];
-      int last_tile_y = (bbox.max().y()-1) / m_block_size[1];
+      int first_tile_x = bbox.min().x() / m_tile_size[0];
+      int first_tile_y = bbox.min().y() / m_tile_size[1];
+      int last_tile_x = (bbox.max().x()-1) / m_tile_size[0];
+      int last_tile_y = (bbox.max().y()-1) / m_tile_size[1];
       out->writeTiles(first_tile_x, last_tile_x, first_tile_y, last_tile_y);
     } else {
       Imf::OutputFile* out = reinterpret_cast<Imf::OutputFile*>(m_output_file_ptr);
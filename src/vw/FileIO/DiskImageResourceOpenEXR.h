@@ -32,6 +32,10 @@ namespace vw {
   /// DiskImageResource implementation for the OpenEXR file format.
   /// - OpenEXR is a high dynamic range image file format developed by
   ///   Industrial Light and Magic (ILM).
+  /// - Files are written tiled, and read and written in blocks of as
+  ///   many tiles, or compressed scanline chunks, as there are threads,
+  ///   which OpenEXR's own thread pool then (de)compresses in parallel.
+  ///   The pool has vw_settings().default_num_threads() threads.
   class DiskImageResourceOpenEXR : public DiskImageResource {
   protected:
 
@@ -84,14 +88,17 @@ namespace vw {
     virtual bool has_block_read  () const {return true; }
     virtual bool has_nodata_read () const {return false;}
 
+    /// Multiples of the tile size, or whole rows for scanline files.
     virtual Vector2i block_read_size () const;
     virtual Vector2i block_write_size() const;
+    /// Sets the tile size.
     virtual void set_block_write_size(const Vector2i&);
 
   private:
-    const static int m_openexr_rows_per_block = 10;
+    void close_output();
 
     std::string m_filename;
+    Vector2i    m_tile_size;  ///< Scanline files: the width and the rows per compressed chunk
     Vector2i    m_block_size;
     std::vector<std::string> m_labels;
     void* m_input_file_ptr;
@@ -82,6 +82,15 @@ namespace vw {
     virtual bool has_block_read  () const {return false;}
     virtual bool has_nodata_read () const {return false;}
 
+    /// The magic number ("P1" through "P6") of a file opened for reading.
+    std::string const& magic() const { return m_magic; }
+
+    /// The maximum channel value of a file opened for reading.
+    int32 max_value() const { return m_max_value; }
+
+    /// The offset of the pixel data in a file opened for reading.
+    std::streampos data_position() const { return m_image_data_position; }
+
   private:
     std::streampos m_image_data_position;
     std::string m_magic;
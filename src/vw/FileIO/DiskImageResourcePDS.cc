@@ -25,6 +25,7 @@
 #endif
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
 #include <vw/FileIO/DiskImageResourcePDS.h>
 
 #include <vector>
@@ -35,6 +36,9 @@
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 using namespace boost;
 
 static bool cpu_is_big_endian() {
@@ -45,6 +49,54 @@ static bool cpu_is_big_endian() {
 #endif
 }
 
+namespace {
+
+  typedef std::map<std::string, std::string> PDSLabel;
+
+  // The parsed labels of the files opened so far.
+  vw::FileMetadataCache<PDSLabel>& pds_label_cache() {
+    static vw::FileMetadataCache<PDSLabel> cache;
+    return cache;
+  }
+
+  // Keeps the mapping alive for as long as a pointer into it exists.
+  struct MappedFileHolder {
+    boost::shared_ptr<boost::iostreams::mapped_file_source> file;
+    void operator()( const vw::uint8* ) { file.reset(); }
+  };
+
+  vw::int32 greatest_common_divisor( vw::int32 a, vw::int32 b ) {
+    while ( b ) { vw::int32 t = a % b; a = b; b = t; }
+    return a;
+  }
+
+}
+
+void vw::DiskImageResourcePDS::clear_label_cache() {
+  pds_label_cache().clear();
+}
+
+// The ^IMAGE tag of a detached label names its data file, sometimes in
+// a different case from the file itself, and relative to the label.
+std::string vw::DiskImageResourcePDS::find_data_file( std::string const& name ) const {
+  namespace fs = boost::filesystem;
+  fs::path dir = fs::path( DiskImageResource::m_filename ).parent_path();
+  std::vector<std::string> candidates;
+  candidates.push_back( (dir / name).string() );
+  candidates.push_back( (dir / boost::to_lower_copy( name )).string() );
+  candidates.push_back( (dir / boost::to_upper_copy( name )).string() );
+  candidates.push_back( name );
+  candidates.push_back( boost::to_lower_copy( name ) );
+  candidates.push_back( boost::to_upper_copy( name ) );
+  boost::system::error_code ec;
+  for ( size_t i = 0; i < candidates.size(); ++i )
+    if ( fs::is_regular_file( candidates[i], ec ) )
+      return candidates[i];
+  vw_throw( ArgumentErr() << "DiskImageResourcePDS: Failed to find the data file \"" << name
+                          << "\" of \"" << DiskImageResource::m_filename << "\"." );
+  return name;
+}
+
 void vw::DiskImageResourcePDS::treat_invalid_data_as_alpha() {
   // We currently only support this feature under very specific circumstances
   std::string format_str, sample_bits_str, valid_minimum_str;
@@ -87,32 +139,39 @@ vw::PixelFormatEnum vw::DiskImageResourcePDS::planes_to_pixel_format(int32 plane
 /// the file and that it has a sane pixel format.
 void vw::DiskImageResourcePDS::open( std::string const& filename ) {
 
-  FILE* input_file = fopen(filename.c_str(), "r");
-  if( !input_file )
-    vw_throw( vw::ArgumentErr() << "DiskImageResourcePDS: Failed to open \""
-              << filename << "\"." );
-
-  char c_line[2048];
-  int i = 0;
-
-  std::vector<std::string> header;
-
-  // Read the entire header section and place it into a vector of
-  // strings where each string is one line of the file.
-  const static int MAX_PDS_HEADER_SIZE = 1000;
-  while ( fgets(c_line, 2048, input_file) ) {
-    i++;
-    if ((c_line[0] == 'E' && c_line[1] == 'N' && c_line[2] == 'D' && c_line[3] != '_') ||
-        (i > MAX_PDS_HEADER_SIZE))
-      break;
-    header.push_back(std::string(c_line));
+  // Labels seen before are not read again.
+  FileStamp stamp;
+  bool cacheable = file_stamp( filename, stamp );
+  if ( !cacheable || !pds_label_cache().get( stamp, m_header_entries ) ) {
+    FILE* input_file = fopen(filename.c_str(), "r");
+    if( !input_file )
+      vw_throw( vw::ArgumentErr() << "DiskImageResourcePDS: Failed to open \""
+                << filename << "\"." );
+
+    char c_line[2048];
+    int i = 0;
+
+    std::vector<std::string> header;
+
+    // Read the entire header section and place it into a vector of
+    // strings where each string is one line of the file.
+    const static int MAX_PDS_HEADER_SIZE = 1000;
+    while ( fgets(c_line, 2048, input_file) ) {
+      i++;
+      if ((c_line[0] == 'E' && c_line[1] == 'N' && c_line[2] == 'D' && c_line[3] != '_') ||
+          (i > MAX_PDS_HEADER_SIZE))
+        break;
+      header.push_back(std::string(c_line));
+    }
+    fclose(input_file);
+
+    // The the data into an associative contain (std::map).  Key/value
+    // pairs are located by searching for strings seperated by the
+    // equals sign "=".
+    parse_pds_header(header);
+    if ( cacheable )
+      pds_label_cache().put( stamp, m_header_entries );
   }
-  fclose(input_file);
-
-  // The the data into an associative contain (std::map).  Key/value
-  // pairs are located by searching for strings seperated by the
-  // equals sign "=".
-  parse_pds_header(header);
 
   std::vector<std::string> keys;
   std::string value;
@@ -192,7 +251,7 @@ void vw::DiskImageResourcePDS::open( std::string const& filename ) {
     // filename that contains the image header.
     if (value[0] == '\"' && value[value.size()-1] == '\"') {
       VW_OUT(InfoMessage, "fileio") << "PDS header points to a seperate data file: " << value << ".\n";
-      m_pds_data_filename = value.substr(1,value.size()-2);
+      m_pds_data_filename = find_data_file( value.substr(1,value.size()-2) );
       m_image_data_offset = 0;
     } else {
       m_pds_data_filename = DiskImageResource::m_filename;
@@ -200,6 +259,7 @@ void vw::DiskImageResourcePDS::open( std::string const& filename ) {
       m_image_data_offset = record_size * (atol(value.c_str()) - 1);
     }
   } else {
+    m_pds_data_filename = DiskImageResource::m_filename;
     keys.clear();
     keys.push_back("LABEL_RECORDS");
     if( query( keys, value ) ) {
@@ -245,6 +305,34 @@ void vw::DiskImageResourcePDS::open( std::string const& filename ) {
   m_format.pixel_format = planes_to_pixel_format(m_format.planes);
   if (m_format.pixel_format != VW_PIXEL_SCALAR) m_format.planes = 1;
 
+  if ( m_format.channel_type != VW_CHANNEL_UINT8  && m_format.channel_type != VW_CHANNEL_INT8 &&
+       m_format.channel_type != VW_CHANNEL_UINT16 && m_format.channel_type != VW_CHANNEL_INT16 )
+    vw_throw( IOErr() << "DiskImageResourcePDS: Unsupported sample bits in \"" << filename << "\"." );
+  m_bytes_per_pixel = channel_size(m_format.channel_type) * num_channels(m_format.pixel_format);
+
+  // Blocks of whole rows, as many as fill a whole number of records
+  // where that is no more than twice the default tile size.
+  int32 row_bytes = m_format.cols * m_bytes_per_pixel;
+  int32 tile = vw_settings().default_tile_size();
+  int32 record_rows = record_size > 0 ? record_size / greatest_common_divisor( row_bytes, record_size ) : 1;
+  int32 block_rows = record_rows <= 2*tile ? (tile + record_rows - 1) / record_rows * record_rows : tile;
+  m_block_size = Vector2i( m_format.cols, std::min( block_rows, int32(m_format.rows) ) );
+
+  // Map the data file if it holds the whole image.  Otherwise, say for
+  // a truncated file, the rows are read as they are asked for.
+  try {
+    boost::shared_ptr<boost::iostreams::mapped_file_source> file
+      ( new boost::iostreams::mapped_file_source( m_pds_data_filename ) );
+    if ( file->size() >= m_image_data_offset + size_t(row_bytes) * m_format.rows * m_format.planes ) {
+      MappedFileHolder holder;
+      holder.file = file;
+      m_mapped_data = boost::shared_array<const uint8>
+        ( reinterpret_cast<const uint8*>( file->data() ) + m_image_data_offset, holder );
+    }
+  } catch ( std::exception const& e ) {
+    VW_OUT(DebugMessage, "fileio") << "Not memory-mapping " << m_pds_data_filename << ": " << e.what() << "\n";
+  }
+
   VW_OUT(DebugMessage, "fileio")
     << "Opening PDS Image\n"
     << "\tImage Dimensions: " << m_format.cols << "x" << m_format.rows << "x" << m_format.planes << "\n"
@@ -258,93 +346,93 @@ void vw::DiskImageResourcePDS::create( std::string const& /*filename*/,
   vw_throw( NoImplErr() << "The PDS driver does not yet support creation of PDS files." );
 }
 
-/// Read the disk image into the given buffer.
-void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox ) const
+// Read rows [first_row, first_row+num_rows) of every band in the file
+// into buffer, band after band.
+void vw::DiskImageResourcePDS::read_rows( int32 first_row, int32 num_rows, std::vector<uint8>& buffer ) const
 {
-  VW_ASSERT( bbox.width()==int(cols()) && bbox.height()==int(rows()),
-             NoImplErr() << "DiskImageResourcePDS does not support partial reads." );
-  VW_ASSERT( dest.format.cols==uint32(cols()) && dest.format.rows==uint32(rows()),
-             IOErr() << "Buffer has wrong dimensions in PDS read." );
-
-  // Re-open the file, and shift the file offset to the position of
-  // the first image byte (as indicated by the PDS header).  Some PDS
-  // files will have the actual data in a seperate file that is
-  // pointed to by the PDS image header, so we may actually be opening
-  // that file here instead of the original file that the user
-  // specified.
-  //
-  // NOTE: The filename encoded in the ^IMAGE tag seems to sometimes
-  // differ in case from the actual data file, so we try a few
-  // different combinations here.
   std::ifstream image_file(m_pds_data_filename.c_str(), std::ios::in | std::ios::binary);
-  if (image_file.bad()) {
-    image_file.open(boost::to_lower_copy(m_pds_data_filename).c_str(), std::ios::in | std::ios::binary);
-    if (image_file.bad()) {
-      image_file.open(boost::to_upper_copy(m_pds_data_filename).c_str(), std::ios::in | std::ios::binary);
-      if (image_file.bad()) {
-        vw_throw( vw::ArgumentErr() << "DiskImageResourcePDS: Failed to open \""
-                  << DiskImageResource::m_filename << "\"." );
-      }
-    }
-  }
-  image_file.seekg(m_image_data_offset, std::ios::beg);
-
-  // Grab the pixel data from the file.
-  unsigned total_pixels = (unsigned)( m_format.cols * m_format.rows * m_format.planes );
-  unsigned bytes_per_pixel = 1;
-  if ( m_format.channel_type == VW_CHANNEL_UINT16 ||
-       m_format.channel_type == VW_CHANNEL_INT16 ) {
-    bytes_per_pixel = 2;
-  }
-  else if ( ! ( m_format.channel_type == VW_CHANNEL_UINT8 ||
-                m_format.channel_type == VW_CHANNEL_INT8 ) ) {
-    vw_throw( IOErr() << "DiskImageResourcePDS: Unsupported channel type (" << m_format.channel_type << ")." );
+  if (!image_file.is_open())
+    vw_throw( vw::ArgumentErr() << "DiskImageResourcePDS: Failed to open \""
+              << m_pds_data_filename << "\"." );
+
+  size_t row_bytes = size_t(m_format.cols) * m_bytes_per_pixel;
+  int32 bands = m_format.planes;
+  if ( m_band_storage == BAND_SEQUENTIAL && m_format.pixel_format != VW_PIXEL_SCALAR )
+    bands = num_channels(m_format.pixel_format);
+  size_t band_row_bytes = row_bytes * m_format.planes / bands;
+
+  buffer.resize( band_row_bytes * num_rows * bands );
+  for ( int32 b = 0; b < bands; ++b ) {
+    image_file.seekg( m_image_data_offset + band_row_bytes * ( size_t(b) * m_format.rows + first_row ), std::ios::beg );
+    image_file.read( (char*)&buffer[band_row_bytes * num_rows * b], band_row_bytes * num_rows );
+    if (!image_file)
+      vw_throw(IOErr() << "DiskImageResourcePDS: an unrecoverable error occured while reading the image data.");
   }
-  bytes_per_pixel *= num_channels(m_format.pixel_format);
-  uint8* image_data = new uint8[total_pixels * bytes_per_pixel];
-  image_file.read((char*)image_data, bytes_per_pixel*total_pixels);
-
-  if (image_file.bad())
-    vw_throw(IOErr() << "DiskImageResourcePDS: an unrecoverable error occured while reading the image data.");
-
-  // Convert the endian-ness of the data if the architecture of the
-  // machine and the endianness of the file do not match.
-  if (m_format.channel_type == VW_CHANNEL_INT16 ||
-      m_format.channel_type == VW_CHANNEL_UINT16) {
-    if ((cpu_is_big_endian() && !m_file_is_msb_first) ||
-        (!cpu_is_big_endian() && m_file_is_msb_first) ) {
-      for ( unsigned i=0; i<total_pixels*bytes_per_pixel; i+=2 ) {
-        uint8 temp = image_data[i+1];
-        image_data[i+1] = image_data[i];
-        image_data[i] = temp;
-      }
-    }
+}
+
+/// Read the disk image into the given buffer.
+void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox ) const
+{
+  VW_ASSERT( bbox.min().x() >= 0 && bbox.min().y() >= 0 &&
+             bbox.max().x() <= cols() && bbox.max().y() <= rows(),
+             ArgumentErr() << "DiskImageResourcePDS: Requested read bbox " << bbox << " is out of bounds." );
+
+  // The rows holding the bbox, straight from the mapping if there is
+  // one.  Some PDS files will have the actual data in a seperate file
+  // that is pointed to by the PDS image header.
+  std::vector<uint8> rows_buffer;
+  const uint8* data = m_mapped_data.get();
+  BBox2i local = bbox;
+  ImageFormat local_format = m_format;
+  if ( !data ) {
+    read_rows( bbox.min().y(), bbox.height(), rows_buffer );
+    data = &rows_buffer[0];
+    local.min().y() = 0;
+    local.max().y() = bbox.height();
+    local_format.rows = bbox.height();
   }
 
-  // For band sequential images, we must copy the data over into
-  // interleaved format.
-  if ( m_band_storage == BAND_SEQUENTIAL && m_format.pixel_format != VW_PIXEL_SCALAR) {
-    uint8* intermediate_data = new uint8[total_pixels * bytes_per_pixel];
-    int n_channels = num_channels(m_format.pixel_format);
-    int n_pixels = m_format.cols * m_format.rows;
-    for (int n = 0; n < n_channels; ++n) {
-      for (int p = 0; p < n_pixels; ++p) {
-        intermediate_data[n_channels*p+n] = image_data[n_pixels*n+p];
+  bool swap = channel_size(m_format.channel_type) == 2 && cpu_is_big_endian() != m_file_is_msb_first;
+  bool band_sequential = m_band_storage == BAND_SEQUENTIAL && m_format.pixel_format != VW_PIXEL_SCALAR;
+
+  ImageBuffer src( local_format, const_cast<uint8*>(data) );
+  std::vector<uint8> pixels;
+  if ( !swap && !band_sequential ) {
+    src = src.cropped( local );
+  } else {
+    // Copy the bbox out, converting the endian-ness of the data if the
+    // architecture of the machine and the endianness of the file do
+    // not match, and interleaving the channels of band sequential
+    // images.
+    int32 n_channels = num_channels(m_format.pixel_format);
+    int32 sample_bytes = channel_size(m_format.channel_type);
+    ImageFormat format = m_format;
+    format.cols = bbox.width();
+    format.rows = bbox.height();
+    pixels.resize( format.byte_size() );
+    ImageBuffer copy( format, &pixels[0] );
+
+    // The step from one sample of a pixel to the next in the source.
+    ssize_t src_sstride = band_sequential ? ssize_t(sample_bytes) * local_format.cols * local_format.rows
+                                          : sample_bytes;
+    ssize_t src_cstride = band_sequential ? sample_bytes : src.cstride;
+    ssize_t src_rstride = band_sequential ? ssize_t(sample_bytes) * local_format.cols : src.rstride;
+    for ( int32 p = 0; p < format.planes; ++p ) {
+      for ( int32 y = 0; y < format.rows; ++y ) {
+        const uint8* src_row = data + p*src.pstride + (local.min().y()+y)*src_rstride + local.min().x()*src_cstride;
+        uint8* dst_row = (uint8*)copy.data + p*copy.pstride + y*copy.rstride;
+        for ( int32 x = 0; x < format.cols; ++x ) {
+          for ( int32 c = 0; c < n_channels; ++c ) {
+            const uint8* s = src_row + x*src_cstride + c*src_sstride;
+            uint8* d = dst_row + x*copy.cstride + c*sample_bytes;
+            if ( swap ) { d[0] = s[1]; d[1] = s[0]; }
+            else std::memcpy( d, s, sample_bytes );
+          }
+        }
       }
     }
-    // Swap over to the new image buffer
-    uint8* temporary_ptr = image_data;
-    image_data = intermediate_data;
-    delete[] temporary_ptr;
+    src = copy;
   }
-
-  // set up an image buffer around the PDS data.
-  ImageBuffer src;
-  src.data = image_data;
-  src.format = m_format;
-  src.cstride = bytes_per_pixel;
-  src.rstride = bytes_per_pixel * m_format.cols;
-  src.pstride = bytes_per_pixel * m_format.cols * m_format.rows;
   convert( dest, src, m_rescale );
 
   if ( m_invalid_as_alpha ) {
@@ -359,10 +447,10 @@ void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox
         int16 valid_minimum = atoi(valid_minimum_str.c_str());
         uint8* src_row = (uint8*)src.data;
         uint8* dst_row = (uint8*)dest.data;
-        for( uint32 y=0; y<m_format.rows; ++y ) {
+        for( int32 y=0; y<src.rows(); ++y ) {
           uint8* src_data = src_row;
           uint8* dst_data = dst_row;
-          for( uint32 x=0; x<m_format.cols; ++x ) {
+          for( int32 x=0; x<src.cols(); ++x ) {
             if( *((int16*)src_data) < valid_minimum ) {
               std::memset( dst_data, 0, dst_bpp );
             }
@@ -375,9 +463,6 @@ void vw::DiskImageResourcePDS::read( ImageBuffer const& dest, BBox2i const& bbox
       }
     }
   }
-
-  delete[] image_data;
-  image_file.close();
 }
 
 // Write the given buffer into the disk image.
@@ -21,6 +21,12 @@
 /// Provides support for some NASA mission data from the Planetary
 /// Data System (PDS).
 ///
+/// The labels are parsed once per file and kept, so that opening the
+/// same product again (mosaics open hundreds) only stats it.  The
+/// pixels are not read until they are asked for, and then only the
+/// rows asked for, straight from the memory-mapped data file when it
+/// holds them uncompressed in the machine's byte order.
+///
 #ifndef __VW_FILEIO_DISKIMAGERESOUCEPDS_H__
 #define __VW_FILEIO_DISKIMAGERESOUCEPDS_H__
 
@@ -28,6 +34,8 @@
 #include <string>
 #include <fstream>
 
+#include <boost/shared_array.hpp>
+
 #include <vw/FileIO/DiskImageResource.h>
 
 namespace vw {
@@ -38,7 +46,8 @@ namespace vw {
     DiskImageResourcePDS( std::string const& filename )
       : DiskImageResource( filename ),
         m_image_data_offset( 0 ),
-        m_invalid_as_alpha( false )
+        m_invalid_as_alpha( false ),
+        m_bytes_per_pixel( 0 )
     {
       m_pds_data_filename = ""; // For PDS images that have a seperate file with image data.
       open( filename );
@@ -134,17 +143,37 @@ namespace vw {
 
     virtual bool has_block_write()  const {return false;}
     virtual bool has_nodata_write() const {return false;}
-    virtual bool has_block_read()   const {return false;}
+    virtual bool has_block_read()   const {return true; }
     virtual bool has_nodata_read()  const {return false;}
 
+    /// Whole rows, as many as make up a whole number of records where
+    /// that is not too many.
+    virtual Vector2i block_read_size() const { return m_block_size; }
+
+    /// The file holding the pixels: the label's own file, or the one
+    /// a detached label points to.
+    std::string const& data_filename() const { return m_pds_data_filename; }
+
+    /// True if the pixels are read straight from the mapped data file.
+    bool is_mapped() const { return bool(m_mapped_data); }
+
+    /// Forget the labels parsed so far, e.g. after rewriting a label
+    /// in place within the same second.
+    static void clear_label_cache();
+
   private:
     void parse_pds_header(std::vector<std::string> const& header);
     PixelFormatEnum planes_to_pixel_format(int32 planes) const;
+    std::string find_data_file(std::string const& name) const;
+    void read_rows(int32 first_row, int32 num_rows, std::vector<uint8>& buffer) const;
     std::map<std::string, std::string> m_header_entries;
     int m_image_data_offset;
     bool m_invalid_as_alpha;
     bool m_file_is_msb_first;
     std::string m_pds_data_filename;
+    int32 m_bytes_per_pixel;          ///< Of all the channels of a pixel
+    Vector2i m_block_size;
+    boost::shared_array<const uint8> m_mapped_data; ///< The first pixel, if mapped
     enum { BAND_SEQUENTIAL, SAMPLE_INTERLEAVED, LINE_INTERLEAVED } m_band_storage;
   };
 
@@ -47,10 +47,12 @@ static void png_error_handler(png_structp /*png_ptr*/, png_const_charp error_msg
 // Default PNG file creation options, and related functions.
 namespace {
   static int default_compression_level = 6;  // 9 = Z_BEST_COMPRESSION; 6 does just about as well.
+  static int default_filters = DiskImageResourcePNG::Options::FILTERS_DEFAULT;
 }
 
 DiskImageResourcePNG::Options::Options() {
   compression_level = default_compression_level;
+  filters = default_filters;
   using_interlace = false;
   using_palette = false;
   using_palette_indices = false;
@@ -61,6 +63,10 @@ void DiskImageResourcePNG::set_default_compression_level( int level ) {
   default_compression_level = level;
 }
 
+void DiskImageResourcePNG::set_default_filters( int filters ) {
+  default_filters = filters;
+}
+
 
 /************************************************************************
  ********************** PNG CONTEXT STRUCTURES **************************
@@ -288,20 +294,22 @@ struct DiskImageResourcePNG::vw_png_read_context:
     scanline = boost::shared_array<uint8>(new uint8[cstride * cols]);
   }
 
-  void readline()
+  // Decodes the next line into dst, or into scanline if dst is NULL.
+  void readline(uint8 *dst = NULL)
   {
-    png_read_row(ctx.ptr, static_cast<png_bytep>(scanline.get()), NULL);
+    png_read_row(ctx.ptr, static_cast<png_bytep>(dst ? dst : scanline.get()), NULL);
     current_line++;
   }
 
-  void readall(boost::scoped_array<uint8> &dst)
+  // Decodes the whole image into dst, whose rows are rstride bytes apart.
+  void readall(uint8 *dst, ssize_t rstride)
   {
     if(current_line != 0)
       vw_throw(IOErr() << "DiskImageResourcePNG: cannot read entire file unless line marker set at beginning.");
 
     boost::scoped_array<png_bytep> row_pointers( new png_bytep[outer->m_format.rows] );
     for(size_t i=0; i < outer->m_format.rows; i++)
-      row_pointers[i] = static_cast<png_bytep>(dst.get()) + i * outer->m_format.cols * cstride;
+      row_pointers[i] = static_cast<png_bytep>(dst) + i * rstride;
     png_read_image(ctx.ptr, row_pointers.get());
     current_line = outer->m_format.rows;
   }
@@ -454,6 +462,8 @@ struct DiskImageResourcePNG::vw_png_write_context:
     }
 
     png_set_compression_level(ctx.ptr, options.compression_level);
+    if(options.filters != Options::FILTERS_DEFAULT)
+      png_set_filter(ctx.ptr, PNG_FILTER_TYPE_BASE, options.filters);
 
     // Set up the scanline for writing.
     cstride = (bit_depth / 8) * channels;
@@ -603,7 +613,12 @@ void DiskImageResourcePNG::read( ImageBuffer const& dest, BBox2i const& bbox ) c
   VW_ASSERT( int(dest.format.cols)==bbox.width() && int(dest.format.rows)==bbox.height(),
              ArgumentErr() << "DiskImageResourcePNG (read) Error: Destination buffer has wrong dimensions!" );
 
-  boost::scoped_array<uint8> buf( new uint8[ctx->cstride * bbox.width() * bbox.height()] );
+  // When the destination already has the file's pixel layout the rows
+  // are decoded straight into it, and otherwise each decoded row is
+  // converted into place while it is still in cache.
+  const bool direct     = m_format.copy_convert( dest.format ) && dest.cstride == ctx->cstride;
+  const bool full_width = bbox.min().x() == 0 && bbox.width() == cols();
+
   // Interlacing is causing problems when read line-by-line...I think it's
   // a bug in libpng.
   if( ctx->interlaced )
@@ -611,51 +626,50 @@ void DiskImageResourcePNG::read( ImageBuffer const& dest, BBox2i const& bbox ) c
     if( bbox.height() != rows() )
       vw_throw( NoImplErr() << "DiskImageResourcePNG: Reading interlaced files line-by-line is currently unsupported." );
 
-    ctx->readall(buf);
-  }
-  else
-  {
-    // FIXME: Normal operation. Make this what happens all the time when
-    // the libpng bug gets fixed. The bug in question causes the final
-    // parts of the expanded, interlaced image (the ones we care about) to
-    // seemingly 'lose' a row.
-
-    // If our start line is a spot before the current line, we need to reopen the file.
-    if(start_line < ctx->current_line)
-      read_reset();
-    if(start_line > ctx->current_line)
-      ctx->advance(start_line - ctx->current_line);
-
-    // Now read
-    int32 offset = 0;
-    while(ctx->current_line < end_line) {
-      ctx->readline();
-
-      // Copy the data over into a contiguous buffer, which is what
-      // convert() expects when we call it below. This extra copy of the
-      // data is undesirable, but probably not a huge performance hit
-      // compared to reading the data from disk.
-      std::memcpy(buf.get() + offset,
-                  ctx->scanline.get() + ctx->cstride * bbox.min().x(),
-                  bbox.width() * ctx->cstride);
-      offset += bbox.width() * ctx->cstride;
+    if ( direct && full_width ) {
+      ctx->readall( static_cast<uint8*>(dest.data), dest.rstride );
+      return;
     }
-
+    boost::scoped_array<uint8> buf( new uint8[m_format.byte_size()] );
+    ctx->readall( buf.get(), m_format.rstride() );
+    ImageBuffer src( m_format, buf.get() );
+    convert( dest, src.cropped( bbox ), m_rescale );
+    return;
   }
 
-  // Set up an image buffer for convert().
-  ImageBuffer src;
-  src.data = buf.get();
-  src.format = m_format;
-  // The number of rows we're reading may be different, seeing as how we
-  // can read sequential lines.
-  src.format.rows = bbox.height();
-  src.format.cols = bbox.width();
-
-  src.cstride = ctx->cstride;
-  src.rstride = src.cstride * src.format.cols;
-  src.pstride = src.rstride * src.format.rows;
-  convert(dest, src, m_rescale);
+  // FIXME: Normal operation. Make this what happens all the time when
+  // the libpng bug gets fixed. The bug in question causes the final
+  // parts of the expanded, interlaced image (the ones we care about) to
+  // seemingly 'lose' a row.
+
+  // If our start line is a spot before the current line, we need to reopen the file.
+  if(start_line < ctx->current_line) {
+    read_reset();
+    ctx = dynamic_cast<vw_png_read_context *>(m_ctx.get());
+  }
+  if(start_line > ctx->current_line)
+    ctx->advance(start_line - ctx->current_line);
+
+  // One decoded row of bbox, as convert() sees it.
+  ImageFormat row_format = m_format;
+  row_format.cols = bbox.width();
+  row_format.rows = 1;
+
+  // Now read
+  for ( int32 row = 0; ctx->current_line < end_line; ++row ) {
+    uint8 *dst_row = static_cast<uint8*>(dest.data) + row * dest.rstride;
+    if ( direct && full_width ) {
+      ctx->readline( dst_row );
+      continue;
+    }
+    ctx->readline();
+    uint8 *src_row = ctx->scanline.get() + ctx->cstride * bbox.min().x();
+    if ( direct )
+      std::memcpy( dst_row, src_row, bbox.width() * ctx->cstride );
+    else
+      convert( dest.cropped( BBox2i( 0, row, bbox.width(), 1 ) ),
+               ImageBuffer( row_format, src_row ), m_rescale );
+  }
 }
 
 void DiskImageResourcePNG::read_reset() const {
@@ -91,7 +91,13 @@ namespace vw {
     // Options that can be passed in while writing. The default is
     // generally 'good enough'.
     struct Options {
+      /// Masks of the row filters libpng may choose from, with the
+      /// values of its PNG_FILTER_* flags.  Fewer filters encode faster.
+      enum Filters { FILTERS_DEFAULT = 0, FILTER_NONE = 0x08, FILTER_SUB = 0x10, FILTER_UP = 0x20,
+                     FILTER_AVG = 0x40, FILTER_PAETH = 0x80, FILTERS_ALL = 0xf8 };
+
       int compression_level; // From 0 to 9
+      int filters; // Filters mask, or FILTERS_DEFAULT to leave it to libpng
       bool using_interlace; // Interlace output.
       bool using_palette; // Output as a palette.
       bool using_palette_indices; // For setting your own palette.
@@ -102,6 +108,7 @@ namespace vw {
     };
 
     static void set_default_compression_level(int level);
+    static void set_default_filters(int filters);
 
     // Convenience functions:
 
@@ -68,8 +68,8 @@ namespace vw {
 
   /// Find how many channels/bands are in a given image
   inline int get_num_channels(std::string filename){
-    boost::shared_ptr<vw::DiskImageResource> src(vw::DiskImageResourcePtr(filename));
-    return src->channels()*src->planes();
+    ImageFormat format = image_format(filename);
+    return num_channels(format.pixel_format)*format.planes;
   }
 
   template <int m, int n, class T>
@@ -28,6 +28,7 @@
 #include <vw/FileIO/TemporaryFile.h>
 #include <vw/Image/ImageResourceView.h>
 #include <vw/Image/BlockRasterize.h>
+#include <vw/Image/SparseImageCheck.h>
 #include <vw/Core/Cache.h>
 
 #include <boost/filesystem/operations.hpp>
@@ -106,9 +107,60 @@ namespace vw {
 
     std::string filename() const { return m_rsrc->filename(); }
 
+    /// The region of the file which rasterizing the bbox reads, in whole
+    /// blocks of the resource's block_read_size() when there is a cache.
+    BBox2i source_bbox( BBox2i const& bbox ) const { return m_impl.source_bbox( bbox ); }
+    SrcImageResource const* resource() const { return m_impl.child().resource(); }
+
+    /// Read blocks of the resource's block_read_size() into the cache ahead
+    /// of use, see BlockRasterizeView::prefetch().
+    void prefetch( BlockPrefetcher::Order order, int num_threads = 2, size_t lookahead = 0 ) {
+      m_impl.prefetch( order, num_threads, lookahead );
+    }
+    void prefetch( std::vector<BBox2i> const& regions, int num_threads = 2, size_t lookahead = 0 ) {
+      m_impl.prefetch( regions, num_threads, lookahead );
+    }
+    void stop_prefetch() { m_impl.stop_prefetch(); }
+    boost::shared_ptr<BlockPrefetcher> const& prefetcher() const { return m_impl.prefetcher(); }
+
+    /// Find which tiles of the file hold data, see vw::load_tile_occupancy(),
+    /// so that sparse_check() reports the empty ones.  The map belongs to
+    /// the resource, so copies of this view made before share it.
+    void load_tile_occupancy( bool use_sidecar = true ) { vw::load_tile_occupancy( *m_rsrc, use_sidecar ); }
+    /// The map of the tiles holding data, or NULL if it hasn't been loaded.
+    TileOccupancy const* tile_occupancy() const { return m_rsrc->tile_occupancy().get(); }
+
+  };
+
+
+  /// Once its tile occupancy is loaded, a DiskImageView reports the
+  /// tiles with no data as empty.
+  template <class PixelT>
+  class SparseImageCheck<DiskImageView<PixelT> > {
+    DiskImageView<PixelT> const& m_view;
+  public:
+    SparseImageCheck(DiskImageView<PixelT> const& view) : m_view(view) {}
+    bool operator() (BBox2i const& bbox) {
+      TileOccupancy const* occupancy = m_view.tile_occupancy();
+      if ( occupancy )
+        return occupancy->intersects( bbox );
+      return bbox.intersects( BBox2i( 0, 0, m_view.cols(), m_view.rows() ) );
+    }
   };
 
 
+  /// A DiskImageView is a source, named by its file.
+  template <class PixelT>
+  class SourceFootprint<DiskImageView<PixelT> > {
+    DiskImageView<PixelT> const& m_view;
+  public:
+    SourceFootprint(DiskImageView<PixelT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      footprint.add( m_view.resource(), m_view.filename(), Vector2i( m_view.cols(), m_view.rows() ),
+                     m_view.source_bbox( bbox ) );
+    }
+  };
+
   template <class PixelT>
     class DiskCacheHandle : private boost::noncopyable {
     DiskImageView<PixelT> m_disk_image_view;
@@ -60,12 +60,25 @@ namespace { // Anonymous namespace
   vw::RunOnce _gdal_init_once = VW_RUNONCE_INIT;
   vw::Mutex* _gdal_mutex;
 
+  // Set a GDAL configuration option unless the user already has,
+  // either through the environment or CPLSetConfigOption().
+  void set_default_config(const char* key, const char* value) {
+    if (!CPLGetConfigOption(key, NULL))
+      CPLSetConfigOption(key, value);
+  }
+
   // Note the kill_gdal() function later on.
   void init_gdal() {
     CPLPushErrorHandler(gdal_error_handler);
     // If we run out of handles, GDALs error out. If you have more than 400
     // open, you probably have a bug.
     CPLSetConfigOption("GDAL_MAX_DATASET_POOL_SIZE", "400");
+    // For remote images (see DiskImageResourceGDAL::gdal_path()): don't
+    // list the bucket on every open, keep connections alive across the
+    // range requests, and fetch adjacent blocks with one request.
+    set_default_config("GDAL_DISABLE_READDIR_ON_OPEN", "EMPTY_DIR");
+    set_default_config("GDAL_HTTP_MULTIPLEX", "YES");
+    set_default_config("GDAL_HTTP_MERGE_CONSECUTIVE_RANGES", "YES");
     GDALAllRegister();
     _gdal_mutex = new vw::Mutex();
   }
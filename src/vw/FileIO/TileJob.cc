@@ -0,0 +1,227 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/FileIO/TileJob.h>
+#include <vw/FileIO/DiskImageResourceMosaic.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = boost::filesystem;
+
+using namespace vw;
+
+namespace {
+
+  const char* PLAN_FILE = "tile_job.txt";
+
+  // Identifies this process among all those sharing the directory.
+  std::string process_name() {
+    char host[256];
+    if ( gethostname( host, sizeof(host) ) != 0 )
+      strcpy( host, "unknown" );
+    host[sizeof(host)-1] = 0;
+    std::ostringstream name;
+    name << host << "_" << getpid();
+    return name.str();
+  }
+
+} // namespace
+
+TileJob::TileJob( std::string const& directory )
+  : m_directory( directory ) {
+  read_plan();
+}
+
+TileJob::TileJob( std::string const& directory, Vector2i const& image_size, Vector2i const& part_size,
+                  std::string const& extension, int max_attempts )
+  : m_directory( directory ), m_extension( extension ),
+    m_image_size( image_size ), m_part_size( part_size ), m_max_attempts( max_attempts ) {
+  VW_ASSERT( image_size.x() > 0 && image_size.y() > 0 && part_size.x() > 0 && part_size.y() > 0,
+             ArgumentErr() << "TileJob: The image and part sizes must be positive." );
+  VW_ASSERT( max_attempts > 0, ArgumentErr() << "TileJob: max_attempts must be positive." );
+  m_table_size = Vector2i( (image_size.x() + part_size.x() - 1) / part_size.x(),
+                           (image_size.y() + part_size.y() - 1) / part_size.y() );
+
+  fs::create_directories( m_directory );
+  if ( !fs::exists( fs::path( m_directory ) / PLAN_FILE ) ) {
+    write_plan();
+    return;
+  }
+  TileJob existing( directory );
+  if ( existing.m_image_size != m_image_size || existing.m_part_size != m_part_size ||
+       existing.m_extension != m_extension )
+    vw_throw( ArgumentErr() << "TileJob: " << directory << " already holds a different job." );
+  if ( existing.m_max_attempts != m_max_attempts )
+    write_plan();
+}
+
+void TileJob::read_plan() {
+  std::string filename = ( fs::path( m_directory ) / PLAN_FILE ).string();
+  std::ifstream file( filename.c_str() );
+  if ( !file )
+    vw_throw( IOErr() << "TileJob: No job is planned in " << m_directory << "." );
+  std::string key;
+  bool valid = true;
+  valid &= bool( file >> key >> m_image_size[0] >> m_image_size[1] ) && key == "image_size";
+  valid &= bool( file >> key >> m_part_size[0]  >> m_part_size[1]  ) && key == "part_size";
+  valid &= bool( file >> key >> m_extension    ) && key == "extension";
+  valid &= bool( file >> key >> m_max_attempts ) && key == "max_attempts";
+  if ( !valid || m_part_size.x() <= 0 || m_part_size.y() <= 0 )
+    vw_throw( IOErr() << "TileJob: Malformed job plan " << filename << "." );
+  m_table_size = Vector2i( (m_image_size.x() + m_part_size.x() - 1) / m_part_size.x(),
+                           (m_image_size.y() + m_part_size.y() - 1) / m_part_size.y() );
+}
+
+void TileJob::write_plan() const {
+  // Written aside and renamed so that workers never read half a plan.
+  fs::path path = fs::path( m_directory ) / PLAN_FILE;
+  std::string temp = path.string() + "." + process_name();
+  {
+    std::ofstream file( temp.c_str() );
+    file << "image_size "   << m_image_size.x() << " " << m_image_size.y() << "\n"
+         << "part_size "    << m_part_size.x()  << " " << m_part_size.y()  << "\n"
+         << "extension "    << m_extension    << "\n"
+         << "max_attempts " << m_max_attempts << "\n";
+    if ( !file )
+      vw_throw( IOErr() << "TileJob: Could not write " << temp << "." );
+  }
+  fs::rename( temp, path );
+}
+
+BBox2i TileJob::part_bbox( size_t part ) const {
+  VW_ASSERT( part < num_parts(), ArgumentErr() << "TileJob: No part " << part << "." );
+  int32 i = int32( part % m_table_size.x() ), j = int32( part / m_table_size.x() );
+  BBox2i bbox( i*m_part_size.x(), j*m_part_size.y(), m_part_size.x(), m_part_size.y() );
+  bbox.crop( BBox2i( 0, 0, m_image_size.x(), m_image_size.y() ) );
+  return bbox;
+}
+
+std::string TileJob::part_name( size_t part ) const {
+  std::ostringstream name;
+  name << "part_" << std::setw(6) << std::setfill('0') << part;
+  return ( fs::path( m_directory ) / name.str() ).string();
+}
+
+std::string TileJob::part_file( size_t part ) const {
+  return part_name( part ) + m_extension;
+}
+
+std::string TileJob::temporary_part_file( size_t part ) const {
+  // The extension stays last, since it chooses the file format.
+  return part_name( part ) + ".tmp_" + process_name() + m_extension;
+}
+
+std::string TileJob::claim_file( size_t part ) const {
+  return part_name( part ) + ".claim";
+}
+
+std::string TileJob::failures_file( size_t part ) const {
+  return part_name( part ) + ".failures";
+}
+
+bool TileJob::done( size_t part ) const {
+  return fs::exists( part_file( part ) );
+}
+
+size_t TileJob::num_done() const {
+  size_t count = 0;
+  for ( size_t part = 0; part < num_parts(); ++part )
+    if ( done( part ) )
+      ++count;
+  return count;
+}
+
+int TileJob::failures( size_t part ) const {
+  std::ifstream file( failures_file( part ).c_str() );
+  int count = 0;
+  std::string line;
+  while ( std::getline( file, line ) )
+    ++count;
+  return count;
+}
+
+bool TileJob::claim( size_t& part, double claim_timeout ) {
+  for ( size_t i = 0; i < num_parts(); ++i ) {
+    if ( done( i ) || failed( i ) )
+      continue;
+    std::string claim = claim_file( i );
+    // Two processes finding the same stale claim may both take it over,
+    // which only costs writing the part twice.
+    boost::system::error_code error;
+    std::time_t modified = fs::last_write_time( claim, error );
+    if ( !error && std::difftime( std::time( 0 ), modified ) > claim_timeout ) {
+      VW_OUT(WarningMessage, "fileio") << "TileJob: Taking over the stale claim " << claim << "\n";
+      fs::remove( claim, error );
+    }
+    int fd = ::open( claim.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644 );
+    if ( fd < 0 ) {
+      if ( errno == EEXIST )
+        continue;
+      vw_throw( IOErr() << "TileJob: Could not create " << claim << ": " << strerror( errno ) );
+    }
+    std::string owner = process_name() + "\n";
+    ssize_t count = ::write( fd, owner.c_str(), owner.size() );
+    ::close( fd );
+    if ( count != ssize_t( owner.size() ) )
+      vw_throw( IOErr() << "TileJob: Could not write " << claim << "." );
+    // The part may have been finished since it was checked.
+    if ( done( i ) ) {
+      fs::remove( claim );
+      continue;
+    }
+    part = i;
+    return true;
+  }
+  return false;
+}
+
+void TileJob::release( size_t part, bool failed ) {
+  if ( failed ) {
+    std::ofstream file( failures_file( part ).c_str(), std::ios::app );
+    file << process_name() << "\n";
+  }
+  boost::system::error_code error;
+  fs::remove( claim_file( part ), error );
+}
+
+void TileJob::commit( size_t part, std::string const& written_file ) {
+  fs::rename( written_file, part_file( part ) );
+  boost::system::error_code error;
+  fs::remove( claim_file( part ), error );
+}
+
+boost::shared_ptr<DiskImageResourceMosaic> TileJob::mosaic() const {
+  size_t missing = num_parts() - num_done();
+  if ( missing )
+    vw_throw( IOErr() << "TileJob: " << missing << " of the " << num_parts() << " parts in "
+                      << m_directory << " are not done." );
+  boost::scoped_ptr<DiskImageResource> first( DiskImageResource::open( part_file( 0 ) ) );
+  boost::shared_ptr<DiskImageResourceMosaic> result( new DiskImageResourceMosaic( first->format(), 64, m_directory ) );
+  for ( size_t part = 0; part < num_parts(); ++part )
+    result->add( part_file( part ), part_bbox( part ) );
+  return result;
+}
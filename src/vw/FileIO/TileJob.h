@@ -0,0 +1,191 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file TileJob.h
+///
+/// Splits the writing of one large image between processes which share
+/// a file system, on one node or on many.  A coordinator plans the job
+/// in a directory, dividing the output into rectangular parts.  Each
+/// worker builds the same view, then claims parts one at a time and
+/// writes each one to a file of its own.  Once every part is written
+/// they are read back as one DiskImageResourceMosaic, to be written to
+/// the final output, a COG for instance.
+///
+///   // The coordinator
+///   TileJob job( "job", Vector2i(cols,rows), Vector2i(8192,8192) );
+///   // Each worker, on any node
+///   TileJob job( "job" );
+///   run_tile_job( job, view );
+///   // The coordinator, once the workers have exited
+///   DiskImageView<float> merged( job.mosaic() );
+///
+/// A worker claims a part by creating a claim file for it, which only
+/// one process can do.  A part which fails is released for another
+/// attempt, up to a limit.  A worker which dies leaves its claim behind,
+/// and other workers take the part over once the claim is older than
+/// their timeout, so the timeout must exceed the time one part takes.
+/// Parts are written under a temporary name and renamed when complete,
+/// so a part file is never partial, and a part done twice is harmless.
+///
+/// The parts are separate files because several processes cannot
+/// write to one GeoTIFF at once.  Make the part size a multiple of the
+/// tile size of the output so that no tile straddles two parts.
+///
+#ifndef __VW_FILEIO_TILEJOB_H__
+#define __VW_FILEIO_TILEJOB_H__
+
+#include <string>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/DiskImageResource.h>
+
+namespace vw {
+
+  class DiskImageResourceMosaic;
+
+  /// A job writing one image in parts, planned in a directory that all
+  /// of its processes can reach.
+  class TileJob {
+  public:
+    /// Opens the job planned in the directory.  Throws IOErr if there
+    /// is none.
+    explicit TileJob( std::string const& directory );
+
+    /// Plans a job writing an image of image_size pixels in parts of
+    /// part_size pixels, with files of the given extension.  A part is
+    /// attempted at most max_attempts times.  The directory is created
+    /// if need be.  If it already holds a plan, the plan must be the
+    /// same, and the parts already written are kept so that an
+    /// interrupted job can be resumed.
+    TileJob( std::string const& directory, Vector2i const& image_size, Vector2i const& part_size,
+             std::string const& extension = ".tif", int max_attempts = 3 );
+
+    std::string const& directory () const { return m_directory;  }
+    Vector2i    const& image_size() const { return m_image_size; }
+    Vector2i    const& part_size () const { return m_part_size;  }
+    std::string const& extension () const { return m_extension;  }
+    int                max_attempts() const { return m_max_attempts; }
+
+    /// The number of parts across and down, and in all.
+    Vector2i table_size() const { return m_table_size; }
+    size_t   num_parts () const { return size_t(m_table_size.x()) * m_table_size.y(); }
+
+    /// The pixels of a part, clipped to the image.  Parts are numbered
+    /// in row-major order.
+    BBox2i part_bbox( size_t part ) const;
+
+    /// The file a part is written to.
+    std::string part_file( size_t part ) const;
+
+    /// A name for this process to write a part under until it is
+    /// complete, unique to the host and process.
+    std::string temporary_part_file( size_t part ) const;
+
+    /// Whether a part has been written.
+    bool   done    ( size_t part ) const;
+    size_t num_done() const;
+
+    /// The number of failed attempts at a part, and whether that many
+    /// failures mean it is not attempted again.
+    int  failures( size_t part ) const;
+    bool failed  ( size_t part ) const { return failures( part ) >= m_max_attempts; }
+
+    /// Claims the first part which is not done, not failed and not
+    /// claimed by another process, returning false if there is none.
+    /// Claims older than claim_timeout seconds are taken over.
+    bool claim( size_t& part, double claim_timeout = 3600 );
+
+    /// Gives up a claimed part.  If the attempt failed it is recorded,
+    /// and the part is left for another attempt while any remain.
+    void release( size_t part, bool failed );
+
+    /// Marks a claimed part done, renaming the file it was written to
+    /// (normally temporary_part_file()) to part_file().
+    void commit( size_t part, std::string const& written_file );
+
+    /// The parts as one read-only resource, in the pixel format of the
+    /// part files.  Throws IOErr if any part is not done.
+    boost::shared_ptr<DiskImageResourceMosaic> mosaic() const;
+
+  private:
+    std::string part_name( size_t part ) const;
+    std::string claim_file( size_t part ) const;
+    std::string failures_file( size_t part ) const;
+    void read_plan();
+    void write_plan() const;
+
+    std::string m_directory, m_extension;
+    Vector2i    m_image_size, m_part_size, m_table_size;
+    int         m_max_attempts;
+  };
+
+  /// Writes the parts of the job from the image, until every part is
+  /// done, failed, or claimed by another worker.  Each part is written
+  /// with block_write_image() on num_threads threads, and in tiles of
+  /// the default tile size if the format is tiled.  A part which fails
+  /// is logged and released for another attempt; vw::Aborted is not
+  /// caught.  Returns the number of parts this call wrote.
+  template <class ImageT>
+  size_t run_tile_job( TileJob& job, ImageViewBase<ImageT> const& image,
+                       double claim_timeout = 3600, int num_threads = 0 ) {
+    VW_ASSERT( image.impl().cols() == job.image_size().x() && image.impl().rows() == job.image_size().y(),
+               ArgumentErr() << "run_tile_job: The image is " << image.impl().cols() << "x" << image.impl().rows()
+                             << " but the job writes " << job.image_size().x() << "x" << job.image_size().y() << "." );
+    size_t written = 0, part;
+    while ( job.claim( part, claim_timeout ) ) {
+      BBox2i bbox = job.part_bbox( part );
+      std::string file = job.temporary_part_file( part );
+      try {
+        ImageFormat format = image.format();
+        format.cols = bbox.width();
+        format.rows = bbox.height();
+        boost::scoped_ptr<DiskImageResource> resource( DiskImageResource::create( file, format ) );
+        if ( resource->has_block_write() )
+          resource->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                                    vw_settings().default_tile_size() ) );
+        block_write_image( *resource, crop( image.impl(), bbox ),
+                           ProgressCallback::dummy_instance(), num_threads );
+        resource->flush();
+      } catch ( const Aborted& ) {
+        boost::filesystem::remove( file );
+        job.release( part, false );
+        throw;
+      } catch ( const std::exception& e ) {
+        VW_OUT(ErrorMessage, "fileio") << "run_tile_job: Part " << part << " " << bbox
+                                       << " failed: " << e.what() << "\n";
+        boost::filesystem::remove( file );
+        job.release( part, true );
+        continue;
+      }
+      job.commit( part, file );
+      ++written;
+    }
+    return written;
+  }
+
+} // namespace vw
+
+#endif // __VW_FILEIO_TILEJOB_H__
@@ -0,0 +1,249 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/FileIO/TileOccupancy.h>
+#include <vw/FileIO/DiskImageResource.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+
+#include <boost/math/special_functions/fpclassify.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+using namespace vw;
+
+TileOccupancy::TileOccupancy( Vector2i const& image_size, Vector2i const& tile_size )
+  : m_image_size( image_size ), m_tile_size( tile_size ) {
+  VW_ASSERT( tile_size.x() > 0 && tile_size.y() > 0,
+             ArgumentErr() << "TileOccupancy: The tile size must be positive." );
+  m_table_size = Vector2i( (image_size.x() + tile_size.x() - 1) / tile_size.x(),
+                           (image_size.y() + tile_size.y() - 1) / tile_size.y() );
+  m_occupied.resize( size_t(m_table_size.x()) * m_table_size.y(), 1 );
+}
+
+BBox2i TileOccupancy::tile_bbox( int32 i, int32 j ) const {
+  BBox2i bbox( i*m_tile_size.x(), j*m_tile_size.y(), m_tile_size.x(), m_tile_size.y() );
+  bbox.crop( BBox2i( 0, 0, m_image_size.x(), m_image_size.y() ) );
+  return bbox;
+}
+
+bool TileOccupancy::intersects( BBox2i const& bbox ) const {
+  BBox2i clipped = bbox;
+  clipped.crop( BBox2i( 0, 0, m_image_size.x(), m_image_size.y() ) );
+  if ( clipped.empty() )
+    return false;
+  for ( int32 j = clipped.min().y() / m_tile_size.y(); j <= (clipped.max().y()-1) / m_tile_size.y(); ++j )
+    for ( int32 i = clipped.min().x() / m_tile_size.x(); i <= (clipped.max().x()-1) / m_tile_size.x(); ++i )
+      if ( occupied( i, j ) )
+        return true;
+  return false;
+}
+
+size_t TileOccupancy::num_occupied() const {
+  size_t count = 0;
+  for ( size_t i = 0; i < m_occupied.size(); ++i )
+    count += m_occupied[i];
+  return count;
+}
+
+void TileOccupancy::write( std::ostream& os ) const {
+  os << "image_size " << m_image_size.x() << " " << m_image_size.y() << "\n"
+     << "tile_size "  << m_tile_size.x()  << " " << m_tile_size.y()  << "\n";
+  for ( int32 j = 0; j < m_table_size.y(); ++j ) {
+    for ( int32 i = 0; i < m_table_size.x(); ++i )
+      os << ( occupied( i, j ) ? '1' : '0' );
+    os << "\n";
+  }
+}
+
+bool TileOccupancy::read( std::istream& is, TileOccupancy& occupancy ) {
+  std::string image_tag, tile_tag;
+  Vector2i image_size, tile_size;
+  if ( !(is >> image_tag >> image_size[0] >> image_size[1] >> tile_tag >> tile_size[0] >> tile_size[1]) ||
+       image_tag != "image_size" || tile_tag != "tile_size" ||
+       image_size.x() < 0 || image_size.y() < 0 || tile_size.x() <= 0 || tile_size.y() <= 0 )
+    return false;
+  TileOccupancy result( image_size, tile_size );
+  for ( int32 j = 0; j < result.table_size().y(); ++j ) {
+    std::string row;
+    if ( !(is >> row) || int32(row.size()) != result.table_size().x() )
+      return false;
+    for ( int32 i = 0; i < result.table_size().x(); ++i ) {
+      if ( row[i] != '0' && row[i] != '1' )
+        return false;
+      result.set_occupied( i, j, row[i] == '1' );
+    }
+  }
+  occupancy = result;
+  return true;
+}
+
+Vector2i vw::tile_occupancy_size( DiskImageResource const& resource ) {
+  Vector2i block = resource.block_read_size();
+  if ( block.x() < resource.cols() && block.y() < resource.rows() )
+    return block;
+  int32 size = vw_settings().default_tile_size();
+  return Vector2i( size, size );
+}
+
+namespace {
+
+  // Whether the last channel of the pixel format is an alpha or a
+  // validity flag, which is zero where there is no data.
+  bool has_alpha_channel( PixelFormatEnum format ) {
+    switch ( format ) {
+    case VW_PIXEL_GRAYA:
+    case VW_PIXEL_RGBA:
+    case VW_PIXEL_SCALAR_MASKED:
+    case VW_PIXEL_GRAY_MASKED:
+    case VW_PIXEL_GRAYA_MASKED:
+    case VW_PIXEL_RGB_MASKED:
+    case VW_PIXEL_RGBA_MASKED:
+    case VW_PIXEL_HSV_MASKED:
+    case VW_PIXEL_XYZ_MASKED:
+    case VW_PIXEL_LUV_MASKED:
+    case VW_PIXEL_LAB_MASKED:
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  bool is_nodata( double value, double nodata ) {
+    return value == nodata || ( boost::math::isnan( value ) && boost::math::isnan( nodata ) );
+  }
+
+  // Reads the bbox of the resource and checks whether any pixel holds
+  // data.  The pixels are read in the resource's own format, so that
+  // they are not rescaled, and then converted to double to compare.
+  bool region_has_data( DiskImageResource const& resource, BBox2i const& bbox,
+                        bool has_nodata, double nodata, bool has_alpha ) {
+    ImageFormat native = resource.format();
+    native.cols = bbox.width();
+    native.rows = bbox.height();
+    boost::scoped_array<uint8> native_data( new uint8[ native.byte_size() ] );
+    ImageBuffer native_buf( native, native_data.get() );
+    resource.read( native_buf, bbox );
+
+    ImageFormat wide = native;
+    wide.channel_type = VW_CHANNEL_FLOAT64;
+    boost::scoped_array<double> values( new double[ wide.byte_size() / sizeof(double) ] );
+    ImageBuffer wide_buf( wide, values.get() );
+    convert( wide_buf, native_buf, false );
+
+    const int32  channels = num_channels( wide.pixel_format );
+    const int32  colors   = has_alpha ? channels - 1 : channels;
+    const size_t pixels   = size_t(wide.cols) * wide.rows * wide.planes;
+    for ( size_t k = 0; k < pixels; ++k ) {
+      double const* pixel = values.get() + k*channels;
+      if ( has_alpha && pixel[channels-1] == 0 )
+        continue;
+      if ( !has_nodata )
+        return true;
+      for ( int32 c = 0; c < colors; ++c )
+        if ( !is_nodata( pixel[c], nodata ) )
+          return true;
+    }
+    return false;
+  }
+
+  // Identifies the file and the way its map is computed, so that a
+  // sidecar is only used for the file it was written for.
+  std::string tile_occupancy_key( DiskImageResource const& resource, FileStamp const& stamp ) {
+    std::ostringstream os;
+    os.precision(17);
+    Vector2i tile_size = tile_occupancy_size( resource );
+    os << "VWOCC 1\n"
+       << "source "      << stamp.path  << "\n"
+       << "source_size " << stamp.size  << "\n"
+       << "source_time " << stamp.mtime << "\n"
+       << "nodata "      << ( resource.has_nodata_read() ? 1 : 0 ) << " "
+                         << ( resource.has_nodata_read() ? resource.nodata_read() : 0.0 ) << "\n"
+       << "tile "        << tile_size.x() << " " << tile_size.y() << "\n";
+    return os.str();
+  }
+
+} // namespace
+
+boost::shared_ptr<TileOccupancy> vw::compute_tile_occupancy( DiskImageResource const& resource ) {
+  boost::shared_ptr<TileOccupancy> occupancy( new TileOccupancy( Vector2i( resource.cols(), resource.rows() ),
+                                                                 tile_occupancy_size( resource ) ) );
+  const bool   has_nodata = resource.has_nodata_read();
+  const double nodata     = has_nodata ? resource.nodata_read() : 0.0;
+  const bool   has_alpha  = has_alpha_channel( resource.pixel_format() );
+
+  for ( int32 j = 0; j < occupancy->table_size().y(); ++j )
+    for ( int32 i = 0; i < occupancy->table_size().x(); ++i ) {
+      BBox2i bbox = occupancy->tile_bbox( i, j );
+      if ( resource.is_empty_region( bbox ) )
+        occupancy->set_occupied( i, j, false );
+      else if ( has_nodata || has_alpha )
+        occupancy->set_occupied( i, j, region_has_data( resource, bbox, has_nodata, nodata, has_alpha ) );
+    }
+  VW_OUT(DebugMessage, "fileio") << "Tile occupancy of " << resource.filename() << ": "
+                                 << occupancy->num_occupied() << " of "
+                                 << occupancy->table_size().x() * occupancy->table_size().y()
+                                 << " tiles hold data.\n";
+  return occupancy;
+}
+
+std::string vw::tile_occupancy_sidecar_file( std::string const& image_file ) {
+  return image_file + ".vwocc";
+}
+
+boost::shared_ptr<TileOccupancy const> vw::load_tile_occupancy( DiskImageResource& resource, bool use_sidecar ) {
+  FileStamp stamp;
+  use_sidecar = use_sidecar && file_stamp( resource.filename(), stamp );
+  std::string sidecar = tile_occupancy_sidecar_file( resource.filename() );
+  std::string key;
+
+  if ( use_sidecar ) {
+    key = tile_occupancy_key( resource, stamp );
+    std::ifstream f( sidecar.c_str() );
+    if ( f ) {
+      std::string text( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+      boost::shared_ptr<TileOccupancy> occupancy( new TileOccupancy( Vector2i(0,0), Vector2i(1,1) ) );
+      if ( text.compare( 0, key.size(), key ) == 0 ) {
+        std::istringstream is( text.substr( key.size() ) );
+        if ( TileOccupancy::read( is, *occupancy ) &&
+             occupancy->image_size() == Vector2i( resource.cols(), resource.rows() ) ) {
+          resource.set_tile_occupancy( occupancy );
+          return occupancy;
+        }
+      }
+    }
+  }
+
+  boost::shared_ptr<TileOccupancy> occupancy = compute_tile_occupancy( resource );
+  resource.set_tile_occupancy( occupancy );
+
+  if ( use_sidecar ) {
+    // The sidecar only saves time, so failing to write it is not an error.
+    std::ofstream f( sidecar.c_str() );
+    if ( f ) {
+      f << key;
+      occupancy->write( f );
+    }
+    if ( !f )
+      VW_OUT(DebugMessage, "fileio") << "Could not write the tile occupancy sidecar " << sidecar << "\n";
+  }
+  return occupancy;
+}
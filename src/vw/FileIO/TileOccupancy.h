@@ -0,0 +1,98 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file TileOccupancy.h
+///
+/// Maps which tiles of an image file hold any data, so that views of
+/// the file can report the empty ones through SparseImageCheck and the
+/// work over them can be skipped.
+///
+#ifndef __VW_FILEIO_TILEOCCUPANCY_H__
+#define __VW_FILEIO_TILEOCCUPANCY_H__
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+
+namespace vw {
+
+  class DiskImageResource;
+
+  /// Which tiles of an image hold any data.  A tile is empty if the
+  /// file stores nothing for it, as for the blocks missing from a
+  /// sparse GeoTIFF, or if all of its pixels are nodata or transparent.
+  class TileOccupancy {
+  public:
+    /// A map of an image in tiles of the given size, all occupied.
+    TileOccupancy( Vector2i const& image_size, Vector2i const& tile_size );
+
+    Vector2i const& image_size() const { return m_image_size; }
+    Vector2i const& tile_size () const { return m_tile_size;  }
+    /// The number of tiles across and down.
+    Vector2i const& table_size() const { return m_table_size; }
+
+    /// The pixels of tile (i,j), clipped to the image.
+    BBox2i tile_bbox( int32 i, int32 j ) const;
+
+    bool occupied( int32 i, int32 j ) const { return m_occupied[ size_t(j)*m_table_size.x() + i ] != 0; }
+    void set_occupied( int32 i, int32 j, bool occupied ) { m_occupied[ size_t(j)*m_table_size.x() + i ] = occupied ? 1 : 0; }
+
+    /// Whether any occupied tile overlaps the bbox.
+    bool intersects( BBox2i const& bbox ) const;
+
+    size_t num_occupied() const;
+
+    /// Writes the map as text, a row of 0s and 1s per row of tiles.
+    void write( std::ostream& os ) const;
+    /// Reads a map written by write(), returning false if it is malformed.
+    static bool read( std::istream& is, TileOccupancy& occupancy );
+
+  private:
+    Vector2i m_image_size, m_tile_size, m_table_size;
+    std::vector<uint8> m_occupied;
+  };
+
+  /// The tile size used for the map of a resource: its blocks if it is
+  /// tiled, and otherwise the default tile size from the settings.
+  Vector2i tile_occupancy_size( DiskImageResource const& resource );
+
+  /// Finds which tiles of the resource hold data.  Tiles the resource
+  /// reports empty with DiskImageResource::is_empty_region() are not
+  /// read.  The others are read and checked against the nodata value
+  /// and the alpha channel, if there are any; without either, they are
+  /// all occupied.
+  boost::shared_ptr<TileOccupancy> compute_tile_occupancy( DiskImageResource const& resource );
+
+  /// The name of the sidecar file holding the tile map of an image file.
+  std::string tile_occupancy_sidecar_file( std::string const& image_file );
+
+  /// Gives the resource its tile map, and returns it.  With use_sidecar,
+  /// the map is read from the sidecar file if one was written for the
+  /// file as it is now, and otherwise computed and written there for
+  /// next time, if the directory allows.
+  boost::shared_ptr<TileOccupancy const> load_tile_occupancy( DiskImageResource& resource, bool use_sidecar = true );
+
+} // namespace vw
+
+#endif // __VW_FILEIO_TILEOCCUPANCY_H__
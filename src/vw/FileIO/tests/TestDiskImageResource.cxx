@@ -23,18 +23,24 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageIO.h>
 #include <vw/Image/PixelMath.h>
+#include <vw/Image/Algorithms.h>
 #include <vw/Image/PixelTypeInfo.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
 #include <vw/FileIO/DiskImageResourceJPEG.h>
+#include <vw/FileIO/DiskImageResourceMapped.h>
+#include <vw/FileIO/DiskImageResourceMosaic.h>
 #include <vw/FileIO/DiskImageResourceOpenEXR.h>
 #include <vw/FileIO/DiskImageResourcePBM.h>
 #include <vw/FileIO/DiskImageResourcePDS.h>
 #include <vw/FileIO/DiskImageResourcePNG.h>
 #include <vw/FileIO/DiskImageResourceRaw.h>
 #include <vw/FileIO/DiskImageResource_internal.h>
+#include <vw/FileIO/DiskImageUtils.h>
 
+#include <fstream>
 #include <ostream>
+#include <boost/lexical_cast.hpp>
 #include <string>
 #include <vector>
 
@@ -240,6 +246,37 @@ TEST_F( WriteReadImageRGBF32JPG, DISABLED_RGB_F32_JPG ) {}
 #if defined(VW_HAVE_PKG_OPENEXR) && VW_HAVE_PKG_OPENEXR==1
 typedef ReadImage<PixelRGB<float>, 3> ReadImageRGBF32EXR;
 TEST_F( ReadImageRGBF32EXR, RGB_F32_EXR ) {}
+
+TEST( DiskImageResource, OpenEXRTiles ) {
+  ImageView<float> image(300,200);
+  for (int r=0; r<image.rows(); ++r)
+    for (int c=0; c<image.cols(); ++c)
+      image(c,r) = float(c + 1000*r);
+
+  UnlinkName fn("tiles.exr");
+  {
+    DiskImageResourceOpenEXR rsrc(fn, image.format());
+    rsrc.set_block_write_size(Vector2i(64,32));
+    // Blocks are rows of whole tiles.
+    Vector2i block = rsrc.block_write_size();
+    EXPECT_EQ( 0, block.x() % 64 );
+    EXPECT_EQ( 32, block.y() );
+    block_write_image(rsrc, image);
+  }
+
+  DiskImageResourceOpenEXR rsrc(fn);
+  EXPECT_TRUE( rsrc.has_block_read() );
+  EXPECT_EQ( 0, rsrc.block_read_size().x() % 64 );
+  EXPECT_EQ( 32, rsrc.block_read_size().y() );
+
+  // A region which does not fall on the tiles.
+  BBox2i bbox(50,20,100,70);
+  ImageView<float> region(bbox.width(), bbox.height());
+  read_image(region, rsrc, bbox);
+  for (int r=0; r<region.rows(); ++r)
+    for (int c=0; c<region.cols(); ++c)
+      ASSERT_EQ( image(c+bbox.min().x(), r+bbox.min().y()), region(c,r) );
+}
 #endif
 
 TEST( DiskImageResource, TestPBM ) {
@@ -331,9 +368,190 @@ TEST( DiskImageResource, PBM_Case_Insentive ) {
   EXPECT_EQ( p3a(0,1).b(), p3b(0,1).b() );
 }
 
+TEST( DiskImageResource, Mapped ) {
+  const char
+    pr2[] = "P2 1 2 255 12 36",
+    pr5[] = "P5 2 2 255 \xC\x24\x30\x3C",
+    pr6[] = "P6 1 2 255 \x2A\x2B\x2C\x59\x58\x57";
+  WF(2, "pgm");
+  WF(5, "pgm");
+  WF(6, "ppm");
+
+  // ASCII files cannot be mapped and are still read by the PBM driver.
+  boost::scoped_ptr<DiskImageResource> r2( DiskImageResource::open( fn2 ) );
+  EXPECT_EQ( DiskImageResourcePBM::type_static(), r2->type() );
+  EXPECT_EQ( (DiskImageResourceMapped*)0, DiskImageResourceMapped::try_open( fn2 ) );
+
+  boost::scoped_ptr<DiskImageResource> r5( DiskImageResource::open( fn5 ) );
+  ASSERT_EQ( DiskImageResourceMapped::type_static(), r5->type() );
+  DiskImageResourceMapped& m5 = dynamic_cast<DiskImageResourceMapped&>( *r5 );
+  EXPECT_TRUE ( m5.has_block_read() );
+  EXPECT_FALSE( m5.has_block_write() );
+  EXPECT_TRUE ( m5.has_view<PixelGray<uint8> >() );
+  EXPECT_TRUE ( m5.has_view<uint8>() );
+  EXPECT_FALSE( m5.has_view<PixelRGB<uint8> >() );
+  EXPECT_FALSE( m5.has_view<float>() );
+
+  // The view and native_ptr() point at the same mapped pages.
+  ImageView<PixelGray<uint8> > v5 = m5.view<PixelGray<uint8> >();
+  ASSERT_EQ( 2, v5.cols() );
+  ASSERT_EQ( 2, v5.rows() );
+  EXPECT_EQ( 0x0C, v5(0,0).v() );
+  EXPECT_EQ( 0x24, v5(1,0).v() );
+  EXPECT_EQ( 0x30, v5(0,1).v() );
+  EXPECT_EQ( 0x3C, v5(1,1).v() );
+  EXPECT_EQ( (const uint8*)v5.data(), m5.native_ptr().get() );
+
+  // Writes go to private pages and never reach the file.
+  v5(0,0) = 99;
+  ImageView<PixelGray<uint8> > reread;
+  read_image( reread, DiskImageResourcePBM( fn5 ) );
+  EXPECT_EQ( 0x0C, reread(0,0).v() );
+
+  // Partial reads and mismatched pixel types convert from the mapping.
+  ImageView<PixelGray<uint8> > row;
+  read_image( row, m5, BBox2i(0,1,2,1) );
+  ASSERT_EQ( 2, row.cols() );
+  ASSERT_EQ( 1, row.rows() );
+  EXPECT_EQ( 0x30, row(0,0).v() );
+  EXPECT_EQ( 0x3C, row(1,0).v() );
+  ImageView<PixelRGB<uint8> > rgb5 = m5.view<PixelRGB<uint8> >();
+  EXPECT_EQ( 0x3C, rgb5(1,1).g() );
+  EXPECT_THROW( m5.write( v5.buffer(), BBox2i(0,0,2,2) ), NoImplErr );
+
+  boost::scoped_ptr<DiskImageResourceMapped> r6( DiskImageResourceMapped::try_open( fn6 ) );
+  ASSERT_TRUE( r6.get() );
+  EXPECT_TRUE( r6->has_view<PixelRGB<uint8> >() );
+  ImageView<PixelRGB<uint8> > v6 = r6->view<PixelRGB<uint8> >();
+  EXPECT_EQ( 44, v6(0,0).b() );
+  EXPECT_EQ( 89, v6(0,1).r() );
+}
+
 #undef WF
 
 
+TEST( DiskImageResource, Mosaic ) {
+  // Three by two tiles of 10x8, each filled with its index plus one.
+  std::vector<boost::shared_ptr<UnlinkName> > names;
+  ImageFormat format;
+  DiskImageResourceMosaic* mosaic = 0;
+  for ( int32 i = 0; i < 6; ++i ) {
+    names.push_back( boost::shared_ptr<UnlinkName>(
+        new UnlinkName( "mosaic_" + boost::lexical_cast<std::string>(i) + ".pgm" ) ) );
+    ImageView<PixelGray<uint8> > tile(10,8);
+    fill( tile, PixelGray<uint8>(i+1) );
+    write_image( *names.back(), tile );
+    if ( !mosaic )
+      mosaic = new DiskImageResourceMosaic( tile.format(), 2 );
+    mosaic->add( *names.back(), BBox2i( (i%3)*10, (i/3)*8, 10, 8 ) );
+  }
+  boost::scoped_ptr<DiskImageResourceMosaic> owner( mosaic );
+
+  EXPECT_EQ( 30, mosaic->cols() );
+  EXPECT_EQ( 16, mosaic->rows() );
+  EXPECT_EQ( 0u, mosaic->num_open() );
+
+  std::vector<size_t> hits = mosaic->intersecting( BBox2i(12,2,10,3) );
+  ASSERT_EQ( 2u, hits.size() );
+  EXPECT_EQ( 1u, hits[0] );
+  EXPECT_EQ( 2u, hits[1] );
+
+  // Never more than two files open, however many a read touches.
+  ImageView<PixelGray<uint8> > all;
+  read_image( all, *mosaic );
+  EXPECT_LE( mosaic->num_open(), 2u );
+  for ( int32 r = 0; r < 16; ++r )
+    for ( int32 c = 0; c < 30; ++c )
+      EXPECT_EQ( (r/8)*3 + c/10 + 1, all(c,r).v() );
+
+  // Overlaps go to the last file added, gaps to nodata.
+  mosaic->add( *names[5], BBox2i(5,4,10,8) );
+  mosaic->set_nodata_read( 200 );
+  ImageView<PixelGray<uint8> > part;
+  read_image( part, *mosaic, BBox2i(0,0,30,20) );
+  EXPECT_EQ( 6,   part(5,4).v() );
+  EXPECT_EQ( 6,   part(14,11).v() );
+  EXPECT_EQ( 2,   part(15,4).v() );
+  EXPECT_EQ( 1,   part(4,4).v() );
+  EXPECT_EQ( 200, part(0,17).v() );
+
+  EXPECT_THROW( mosaic->write( part.buffer(), BBox2i(0,0,30,20) ), NoImplErr );
+}
+
+// Reads bbox of fn into PixelT both through the resource and by
+// converting a full-image read, which must agree.
+template <class PixelT>
+void check_decode( std::string const& fn, BBox2i const& bbox ) {
+  boost::scoped_ptr<DiskImageResource> rsrc( DiskImageResource::open( fn ) );
+  ImageView<PixelRGB<uint8> > full;
+  read_image( full, fn );
+  ImageView<PixelRGB<uint8> > window = crop( full, bbox );
+  ImageView<PixelT> expected( bbox.width(), bbox.height() );
+  convert( expected.buffer(), window.buffer(), true );
+
+  ImageView<PixelT> actual( bbox.width(), bbox.height() );
+  rsrc->read( actual.buffer(), bbox );
+  EXPECT_SEQ_EQ( expected, actual );
+}
+
+template <class PixelT>
+void check_decode_paths( std::string const& fn ) {
+  // Full frame, full width rows and a window, in forward order.
+  check_decode<PixelT>( fn, BBox2i( 0, 0, 16, 12 ) );
+  check_decode<PixelT>( fn, BBox2i( 0, 2, 16, 3 ) );
+  check_decode<PixelT>( fn, BBox2i( 5, 6, 7, 4 ) );
+}
+
+TEST( DiskImageResource, DecodePaths ) {
+  ImageView<PixelRGB<uint8> > image( 16, 12 );
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      image(c,r) = PixelRGB<uint8>( 16*c, 20*r, 5*(c+r) );
+
+  std::vector<std::string> names;
+#if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
+  names.push_back( "decode_paths.png" );
+#endif
+#if defined(VW_HAVE_PKG_JPEG) && VW_HAVE_PKG_JPEG==1
+  names.push_back( "decode_paths.jpg" );
+#endif
+  for ( size_t i = 0; i < names.size(); ++i ) {
+    SCOPED_TRACE( names[i] );
+    UnlinkName fn( names[i] );
+    write_image( fn, image );
+    check_decode_paths<PixelRGB<uint8> >( fn );
+    check_decode_paths<PixelGray<float> >( fn );
+    check_decode_paths<PixelRGBA<uint16> >( fn );
+  }
+}
+
+TEST( DiskImageResource, MetadataCache ) {
+  UnlinkName fn("metadata_cache.pgm");
+  write_image( fn, ImageView<PixelGray<uint8> >(4,3) );
+
+  FileStamp stamp;
+  ASSERT_TRUE( file_stamp( fn, stamp ) );
+  EXPECT_FALSE( file_stamp( "s3://bucket/metadata_cache.pgm", stamp ) );
+
+  image_metadata_cache().clear();
+  ImageMetadata first = image_metadata( fn );
+  EXPECT_EQ( 4, first.format.cols );
+  EXPECT_EQ( 3, first.format.rows );
+  EXPECT_EQ( 1u, image_metadata_cache().size() );
+  EXPECT_VECTOR_EQ( Vector2i(4,3), file_image_size( fn ) );
+  EXPECT_EQ( 1, get_num_channels( fn ) );
+  EXPECT_EQ( 1u, image_metadata_cache().size() );
+
+  // A rewritten file is opened again.
+  write_image( fn, ImageView<PixelGray<uint8> >(6,5) );
+  ImageMetadata second = image_metadata( fn );
+  EXPECT_EQ( 6, second.format.cols );
+  EXPECT_EQ( 5, second.format.rows );
+
+  image_metadata_cache().clear();
+  EXPECT_EQ( 0u, image_metadata_cache().size() );
+}
+
 TEST( DiskImageResource, NonExistentFiles ) {
   boost::scoped_ptr<DiskImageResource> r;
 
@@ -435,8 +653,60 @@ TEST( DiskImageResource, PNGComments ) {
   }
 }
 
+TEST( DiskImageResource, PDSBlocks ) {
+  // A 6x5 16-bit big-endian image after a label padded to 19 records.
+  const int record_bytes = 12;
+  UnlinkName attached("attached.img");
+  {
+    std::ostringstream label;
+    label << "PDS_VERSION_ID = PDS3\nRECORD_BYTES = " << record_bytes << "\n"
+          << "^IMAGE = 20\nLINES = 5\nLINE_SAMPLES = 6\n"
+          << "SAMPLE_TYPE = MSB_INTEGER\nSAMPLE_BITS = 16\nEND\n";
+    std::string text = label.str();
+    text.resize( 19*record_bytes, ' ' );
+    std::ofstream file( attached.c_str(), std::ios::binary );
+    file << text;
+    for ( int i = 0; i < 30; ++i ) {
+      file.put( char( (i*100) >> 8 ) );
+      file.put( char( (i*100) & 0xff ) );
+    }
+  }
 
+  DiskImageResourcePDS rsrc( attached );
+  EXPECT_TRUE( rsrc.has_block_read() );
+  EXPECT_TRUE( rsrc.is_mapped() );
+  EXPECT_EQ( 6, rsrc.block_read_size().x() );
+  ImageView<int16> region(3,2);
+  read_image( region, rsrc, BBox2i(2,1,3,2) );
+  for ( int r = 0; r < 2; ++r )
+    for ( int c = 0; c < 3; ++c )
+      EXPECT_EQ( ((r+1)*6 + c+2)*100, region(c,r) );
+
+  // A detached label naming its data file in the wrong case, with the
+  // RGB bands stored one after another.
+  UnlinkName detached("detached.lbl"), data("detached_data.img");
+  {
+    std::ofstream label( detached.c_str() );
+    label << "RECORD_BYTES = 4\n^IMAGE = \"DETACHED_DATA.IMG\"\nLINES = 3\nLINE_SAMPLES = 4\n"
+          << "BANDS = 3\nBAND_STORAGE_TYPE = BAND_SEQUENTIAL\n"
+          << "SAMPLE_TYPE = UNSIGNED_INTEGER\nSAMPLE_BITS = 8\nEND\n";
+    std::ofstream file( data.c_str(), std::ios::binary );
+    for ( int b = 0; b < 3; ++b )
+      for ( int i = 0; i < 12; ++i )
+        file.put( char( 50*b + i ) );
+  }
+  DiskImageResourcePDS rgb( detached );
+  EXPECT_EQ( data, rgb.data_filename() );
+  ImageView<PixelRGB<uint8> > pixels(2,2);
+  read_image( pixels, rgb, BBox2i(1,1,2,2) );
+  for ( int r = 0; r < 2; ++r )
+    for ( int c = 0; c < 2; ++c ) {
+      int i = (r+1)*4 + c+1;
+      EXPECT_EQ( PixelRGB<uint8>( i, 50+i, 100+i ), pixels(c,r) );
+    }
 
-
-
-
+  // Opening it again takes the label from the cache.
+  DiskImageResourcePDS again( detached );
+  EXPECT_EQ( rgb.format().cols, again.format().cols );
+  EXPECT_EQ( rgb.format().pixel_format, again.format().pixel_format );
+}
@@ -19,7 +19,9 @@
 #include <gtest/gtest_VW.h>
 #include <vw/Image/ImageIO.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/BlockRasterize.h>
 #include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <vw/FileIO/DiskImageView.h>
 #include <test/Helpers.h>
 #include <vw/config.h>
 
@@ -29,6 +31,9 @@ using namespace vw::test;
 #if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
 
 #include <vw/FileIO/DiskImageResourceGDAL.h>
+#include <vw/Core/Thread.h>
+#include <boost/filesystem/operations.hpp>
+#include <gdal_priv.h>
 
 
 TEST( GDALFeatures, NoDataValue ) {
@@ -55,4 +60,99 @@ TEST( GDALFeatures, NoDataValue ) {
   EXPECT_EQ( -1, r_rsrc.nodata_read() );
 }
 
+TEST( GDALFeatures, ConcurrentReads ) {
+  UnlinkName tiled("concurrent.tif");
+
+  ImageView<uint16> image(128,96);
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      image(c,r) = uint16(r*image.cols() + c);
+
+  {
+    DiskImageResourceGDAL w_rsrc( tiled, image.format(), Vector2i(32,32) );
+    write_image( w_rsrc, image );
+  }
+
+  boost::shared_ptr<DiskImageResourceGDAL> r_rsrc( new DiskImageResourceGDAL( tiled ) );
+  EXPECT_EQ( 0u, r_rsrc->read_handles() );
+  r_rsrc->set_read_handles( 3 );
+  EXPECT_EQ( 3u, r_rsrc->read_handles() );
+
+  // No system cache, so every tile is read from the file by one of
+  // the block_rasterize threads.
+  DiskImageView<uint16> view( r_rsrc, 0 );
+  ImageView<uint16> result = block_rasterize( view, Vector2i(32,32), 6 );
+  ASSERT_EQ( image.cols(), result.cols() );
+  ASSERT_EQ( image.rows(), result.rows() );
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      EXPECT_EQ( image(c,r), result(c,r) );
+
+  r_rsrc->set_read_handles( 0 );
+  EXPECT_EQ( 0u, r_rsrc->read_handles() );
+  EXPECT_EQ( image(5,7), view(5,7) );
+}
+
+TEST( GDALFeatures, RemotePaths ) {
+  EXPECT_TRUE ( DiskImageResourceGDAL::is_remote( "s3://bucket/dir/image.tif" ) );
+  EXPECT_TRUE ( DiskImageResourceGDAL::is_remote( "https://example.com/image.tif" ) );
+  EXPECT_TRUE ( DiskImageResourceGDAL::is_remote( "/vsis3/bucket/image.tif" ) );
+  EXPECT_FALSE( DiskImageResourceGDAL::is_remote( "image.tif" ) );
+  EXPECT_FALSE( DiskImageResourceGDAL::is_remote( "/data/s3://image.tif" ) );
+
+  EXPECT_EQ( "/vsis3/bucket/dir/image.tif",
+             DiskImageResourceGDAL::gdal_path( "s3://bucket/dir/image.tif" ) );
+  EXPECT_EQ( "/vsigs/bucket/image.tif",
+             DiskImageResourceGDAL::gdal_path( "gs://bucket/image.tif" ) );
+  EXPECT_EQ( "/vsicurl/https://example.com/image.tif",
+             DiskImageResourceGDAL::gdal_path( "https://example.com/image.tif" ) );
+  EXPECT_EQ( "/data/image.tif", DiskImageResourceGDAL::gdal_path( "/data/image.tif" ) );
+
+  // Remote images are read-only.
+  ImageView<uint8> image(16,16);
+  EXPECT_THROW( DiskImageResourceGDAL( "s3://bucket/out.tif", image.format() ), NoImplErr );
+}
+
+TEST( GDALFeatures, CloudOptimized ) {
+  UnlinkName cog("cog.tif");
+
+  // Constant 2x2 squares, so the first overview is exact.
+  ImageView<uint8> image(1000,600);
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      image(c,r) = uint8(((c/2)*3 + r/2) % 251);
+
+  {
+    DiskImageResourceGDAL::Options options;
+    options["COG"] = "YES";
+    DiskImageResourceGDAL w_rsrc( cog, image.format(), Vector2i(128,128), options );
+    ASSERT_TRUE( w_rsrc.is_cog() );
+    // 1000/8 fits in a block.
+    EXPECT_EQ( 3u, w_rsrc.cog_overview_levels() );
+    block_write_image( w_rsrc, image, ProgressCallback::dummy_instance(), 4 );
+  }
+  EXPECT_FALSE( boost::filesystem::exists( cog + ".cog-tmp.tif" ) );
+
+  DiskImageResourceGDAL r_rsrc( cog );
+  ImageView<uint8> result;
+  read_image( result, r_rsrc );
+  ASSERT_EQ( image.cols(), result.cols() );
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      EXPECT_EQ( image(c,r), result(c,r) );
+
+  Mutex::Lock lock( DiskImageResourceGDAL::global_lock() );
+  GDALRasterBand* band = r_rsrc.get_dataset_ptr()->GetRasterBand(1);
+  ASSERT_EQ( 3, band->GetOverviewCount() );
+  GDALRasterBand* overview = band->GetOverview(0);
+  ASSERT_EQ( 500, overview->GetXSize() );
+  ASSERT_EQ( 300, overview->GetYSize() );
+  ImageView<uint8> level(500,300);
+  ASSERT_EQ( CE_None, overview->RasterIO( GF_Read, 0, 0, 500, 300, &level(0,0),
+                                          500, 300, GDT_Byte, 1, 500 ) );
+  for ( int32 r = 0; r < level.rows(); ++r )
+    for ( int32 c = 0; c < level.cols(); ++c )
+      EXPECT_EQ( image(2*c,2*r), level(c,r) );
+}
+
 #endif
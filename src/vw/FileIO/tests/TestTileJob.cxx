@@ -0,0 +1,123 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/config.h>
+#include <vw/FileIO/TileJob.h>
+#include <vw/FileIO/DiskImageResourceMosaic.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PerPixelViews.h>
+
+#include <fstream>
+
+#include <boost/filesystem/operations.hpp>
+
+using namespace vw;
+
+namespace fs = boost::filesystem;
+
+TEST( TileJob, Claims ) {
+  fs::remove_all( "tile_job" );
+  TileJob job( "tile_job", Vector2i(300,200), Vector2i(128,128), ".png", 2 );
+  ASSERT_EQ( 6u, job.num_parts() );
+  EXPECT_EQ( BBox2i(256,128,44,72), job.part_bbox(5) );
+  EXPECT_THROW( TileJob( "tile_job", Vector2i(300,200), Vector2i(64,64) ), ArgumentErr );
+
+  // Workers open the plan.
+  TileJob worker( "tile_job" );
+  EXPECT_EQ( Vector2i(300,200), worker.image_size() );
+  EXPECT_EQ( ".png", worker.extension() );
+  EXPECT_EQ( 2, worker.max_attempts() );
+
+  // Each part is claimed once.
+  size_t part;
+  for ( size_t i = 0; i < 6; ++i ) {
+    ASSERT_TRUE( worker.claim( part ) );
+    EXPECT_EQ( i, part );
+  }
+  EXPECT_FALSE( job.claim( part ) );
+
+  // A failed part is retried until it runs out of attempts.
+  worker.release( 1, true );
+  ASSERT_TRUE( job.claim( part ) );
+  EXPECT_EQ( 1u, part );
+  job.release( 1, true );
+  EXPECT_TRUE( job.failed( 1 ) );
+  EXPECT_FALSE( job.claim( part ) );
+
+  // A claim older than the timeout is taken over.
+  std::string claim = "tile_job/part_000003.claim";
+  ASSERT_TRUE( fs::exists( claim ) );
+  fs::last_write_time( claim, std::time(0) - 100 );
+  EXPECT_FALSE( job.claim( part, 1000 ) );
+  ASSERT_TRUE( job.claim( part, 10 ) );
+  EXPECT_EQ( 3u, part );
+
+  EXPECT_THROW( job.mosaic(), IOErr );
+  fs::remove_all( "tile_job" );
+  EXPECT_THROW( TileJob( "tile_job" ), IOErr );
+}
+
+#if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
+
+/// Fails on the first pixel it computes in one part of the image.
+struct FailOnce : ReturnFixedType<uint8> {
+  boost::shared_ptr<bool> failed;
+  FailOnce() : failed( new bool(false) ) {}
+  uint8 operator()( uint8 value ) const {
+    if ( value == 77 && !*failed ) {
+      *failed = true;
+      vw_throw( IOErr() << "FailOnce" );
+    }
+    return value;
+  }
+};
+
+TEST( TileJob, Write ) {
+  fs::remove_all( "tile_job" );
+  ImageView<uint8> image( 300, 200 );
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      image(c,r) = uint8( (c + 3*r) % 251 );
+
+  TileJob job( "tile_job", Vector2i(300,200), Vector2i(128,128), ".png" );
+  FailOnce func;
+  // Value 77 first appears in part 0, whose first attempt fails and
+  // is retried.
+  EXPECT_EQ( 6u, run_tile_job( job, per_pixel_view( image, func ), 3600, 1 ) );
+  EXPECT_TRUE( *func.failed );
+  EXPECT_EQ( 1, job.failures( 0 ) );
+  EXPECT_EQ( 6u, job.num_done() );
+  EXPECT_FALSE( fs::exists( "tile_job/part_000000.claim" ) );
+
+  // A later worker has nothing left to do.
+  TileJob worker( "tile_job" );
+  EXPECT_EQ( 0u, run_tile_job( worker, image ) );
+
+  DiskImageView<uint8> merged( job.mosaic() );
+  ASSERT_EQ( 300, merged.cols() );
+  ASSERT_EQ( 200, merged.rows() );
+  ImageView<uint8> result = merged;
+  EXPECT_SEQ_EQ( image, result );
+  fs::remove_all( "tile_job" );
+}
+
+#endif
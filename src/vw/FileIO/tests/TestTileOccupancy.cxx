@@ -0,0 +1,121 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/config.h>
+#include <vw/Core/Settings.h>
+#include <vw/FileIO/TileOccupancy.h>
+#include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/SparseImageCheck.h>
+
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/scoped_ptr.hpp>
+
+using namespace vw;
+using namespace vw::test;
+
+TEST( TileOccupancy, Map ) {
+  TileOccupancy occupancy( Vector2i(300,200), Vector2i(128,128) );
+  ASSERT_EQ( Vector2i(3,2), occupancy.table_size() );
+  EXPECT_EQ( 6u, occupancy.num_occupied() );
+  EXPECT_EQ( BBox2i(256,128,44,72), occupancy.tile_bbox(2,1) );
+
+  for ( int32 j = 0; j < 2; ++j )
+    for ( int32 i = 0; i < 3; ++i )
+      occupancy.set_occupied( i, j, false );
+  occupancy.set_occupied( 2, 1, true );
+  EXPECT_EQ( 1u, occupancy.num_occupied() );
+  EXPECT_FALSE( occupancy.intersects( BBox2i(0,0,256,200) ) );
+  EXPECT_TRUE ( occupancy.intersects( BBox2i(255,127,2,2) ) );
+  EXPECT_FALSE( occupancy.intersects( BBox2i(300,0,50,50) ) );
+
+  std::stringstream stream;
+  occupancy.write( stream );
+  TileOccupancy copy( Vector2i(0,0), Vector2i(1,1) );
+  ASSERT_TRUE( TileOccupancy::read( stream, copy ) );
+  EXPECT_EQ( occupancy.image_size(), copy.image_size() );
+  EXPECT_EQ( occupancy.tile_size(),  copy.tile_size()  );
+  EXPECT_TRUE ( copy.occupied(2,1) );
+  EXPECT_FALSE( copy.occupied(1,1) );
+
+  std::istringstream bad( "image_size 300 200\ntile_size 128 128\n001\n0x1\n" );
+  EXPECT_FALSE( TileOccupancy::read( bad, copy ) );
+}
+
+#if defined(VW_HAVE_PKG_PNG) && VW_HAVE_PKG_PNG==1
+TEST( TileOccupancy, DiskImage ) {
+  UnlinkName file( "occupancy.png" );
+  UnlinkName sidecar( "occupancy.png.vwocc" );
+  ASSERT_EQ( tile_occupancy_sidecar_file( file ), std::string( sidecar ) );
+
+  // A gray and alpha image, transparent but for two pixels, mapped in
+  // the default tile size as PNG files are not tiled.
+  vw_settings().set_default_tile_size( 128 );
+  ImageView<PixelGrayA<uint8> > image( 300, 200 );
+  image(10,10)   = PixelGrayA<uint8>( 0, 255 );
+  image(290,150) = PixelGrayA<uint8>( 0, 255 );
+  write_image( file, image );
+
+  {
+    DiskImageView<PixelGrayA<uint8> > view( file );
+    EXPECT_EQ( 0, view.tile_occupancy() );
+    EXPECT_TRUE( sparse_check( view, BBox2i(128,0,128,128) ) );
+
+    view.load_tile_occupancy();
+    ASSERT_TRUE( view.tile_occupancy() != 0 );
+    TileOccupancy const& occupancy = *view.tile_occupancy();
+    ASSERT_EQ( Vector2i(3,2), occupancy.table_size() );
+    EXPECT_EQ( 2u, occupancy.num_occupied() );
+    EXPECT_TRUE( occupancy.occupied(0,0) );
+    EXPECT_TRUE( occupancy.occupied(2,1) );
+
+    EXPECT_FALSE( sparse_check( view, BBox2i(128,0,128,128) ) );
+    EXPECT_FALSE( sparse_check( view, BBox2i(0,128,256,72) ) );
+    EXPECT_TRUE ( sparse_check( view, BBox2i(100,100,200,50) ) );
+  }
+  ASSERT_TRUE( boost::filesystem::exists( sidecar ) );
+
+  // A later load reads the map from the sidecar.  Mark every tile
+  // occupied there to tell it from a recomputed map.
+  std::string text;
+  {
+    std::ifstream f( sidecar.c_str() );
+    text.assign( (std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>() );
+  }
+  std::string rows = "100\n001\n";
+  ASSERT_EQ( rows, text.substr( text.size() - rows.size() ) );
+  text.replace( text.size() - rows.size(), rows.size(), "111\n111\n" );
+  {
+    std::ofstream f( sidecar.c_str() );
+    f << text;
+  }
+  {
+    boost::scoped_ptr<DiskImageResource> resource( DiskImageResource::open( file ) );
+    EXPECT_EQ( 6u, load_tile_occupancy( *resource )->num_occupied() );
+    EXPECT_EQ( 2u, load_tile_occupancy( *resource, false )->num_occupied() );
+  }
+}
+#endif
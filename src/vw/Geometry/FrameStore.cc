@@ -30,6 +30,13 @@ namespace vw {
 
     FrameHandle const FrameStore::NULL_HANDLE = FrameHandle(NULL);
 
+    namespace {
+      // The cache starts over rather than grow past this many pairs.
+      size_t const MAX_CACHED_TRANSFORMS = 4096;
+      // The size of a new cache table, a power of two.
+      size_t const MIN_CACHE_SLOTS = 16;
+    }
+
     FrameStore::~FrameStore() throw()
     {
       // delete all frames
@@ -37,6 +44,8 @@ namespace vw {
       for (first = m_root_nodes.begin(); first != last; ++first) {
         (*first)->recursive_delete();
       }
+      // No reader can be left, so the table is freed at once.
+      delete m_cache.load();
     }
 
     void
@@ -297,6 +306,7 @@ namespace vw {
       node->set_parent(parent.node);
 
       n.release();
+      tree_changed();
     }
 
     void
@@ -329,6 +339,7 @@ namespace vw {
           // we deleted only one node
         }
       }
+      tree_changed();
     }
 
     void
@@ -359,6 +370,7 @@ namespace vw {
       if (parent.node == 0) {
         m_root_nodes.push_back(frame.node);
       }
+      tree_changed();
     }
 
     bool
@@ -397,34 +409,127 @@ namespace vw {
     Frame::Transform
     FrameStore::get_transform_of(FrameHandle frame, FrameHandle source, Transform const& trans)
     {
-      RecursiveMutex::Lock lock(m_mutex);
-
       VW_ASSERT (frame.node != NULL && source.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
-      return vw::geometry::get_transform_of(frame.node, source.node, trans);
+      return cached_transform(frame.node, source.node) * trans;
     }
 
     Vector3
     FrameStore::get_position_of(FrameHandle frame, FrameHandle source, Vector3 const& trans)
     {
-      RecursiveMutex::Lock lock(m_mutex);
-
       VW_ASSERT (frame.node != NULL && source.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
-      return vw::geometry::get_transform(frame.node, source.node) * trans;
+      return cached_transform(frame.node, source.node) * trans;
     }
 
     Frame::Transform
     FrameStore::get_transform(FrameHandle frame, FrameHandle source)
     {
-      RecursiveMutex::Lock lock(m_mutex);
-
       VW_ASSERT (source.node != NULL,
                  vw::LogicErr() << "NULL handle not allowed as frame parameter.");
 
-      return vw::geometry::get_transform(frame.node, source.node);
+      return cached_transform(frame.node, source.node);
+    }
+
+    void
+    FrameStore::get_transforms(FrameHandle frame, FrameHandleVector const& sources, TransformVector& transforms)
+    {
+      transforms.clear();
+      transforms.reserve(sources.size());
+
+      FrameHandleVector::const_iterator first, last = sources.end();
+      for (first = sources.begin(); first != last; ++first) {
+        VW_ASSERT (first->node != NULL,
+                   vw::LogicErr() << "NULL handle not allowed as frame parameter.");
+        transforms.push_back(cached_transform(frame.node, first->node));
+      }
+    }
+
+    namespace {
+      // Mixes the two node addresses, whose low bits are always zero.
+      size_t cache_hash(FrameTreeNode const * frame, FrameTreeNode const * source) {
+        uint64 h = uint64(reinterpret_cast<size_t>(frame)) * 0x9E3779B97F4A7C15ULL
+                 ^ uint64(reinterpret_cast<size_t>(source));
+        h *= 0xBF58476D1CE4E5B9ULL;
+        return size_t(h ^ (h >> 31));
+      }
+    }
+
+    bool
+    FrameStore::TransformCache::find(Key const& key, Transform& transform) const
+    {
+      size_t const mask = slots.size() - 1;
+      for (size_t i = cache_hash(key.first, key.second) & mask; ; i = (i + 1) & mask) {
+        Slot const& slot = slots[i];
+        if (!slot.ready.load(std::memory_order_acquire))
+          return false;
+        if (slot.key == key) {
+          transform = slot.transform;
+          return true;
+        }
+      }
+    }
+
+    void
+    FrameStore::TransformCache::insert(Key const& key, Transform const& transform)
+    {
+      size_t const mask = slots.size() - 1;
+      size_t i = cache_hash(key.first, key.second) & mask;
+      while (slots[i].ready.load(std::memory_order_relaxed))
+        i = (i + 1) & mask;
+      slots[i].key       = key;
+      slots[i].transform = transform;
+      slots[i].ready.store(true, std::memory_order_release);
+      ++count;
+    }
+
+    Frame::Transform
+    FrameStore::cached_transform(FrameTreeNode const * frame, FrameTreeNode const * source) const
+    {
+      TransformCache::Key const key(frame, source);
+      Transform result;
+
+      // The table may be read without the lock: a slot does not change
+      // once it is ready, nodes are only compared by address, and a
+      // replaced table is not freed while the guard is held.
+      {
+        EpochGuard guard;
+        TransformCache const* cache = m_cache.load(std::memory_order_acquire);
+        if (cache && cache->find(key, result))
+          return result;
+      }
+
+      RecursiveMutex::Lock lock(m_mutex);
+
+      // Another thread may have added the pair meanwhile.
+      TransformCache* cache = m_cache.load(std::memory_order_relaxed);
+      if (cache && cache->find(key, result))
+        return result;
+
+      result = vw::geometry::get_transform(frame, source);
+
+      // Double the table before it is over half full, copying it once, or
+      // start over once it holds MAX_CACHED_TRANSFORMS pairs.
+      if (!cache || 2 * (cache->count + 1) > cache->slots.size()) {
+        TransformCache* next;
+        if (cache && cache->count < MAX_CACHED_TRANSFORMS) {
+          next = new TransformCache(2 * cache->slots.size());
+          for (size_t i = 0; i < cache->slots.size(); ++i) {
+            TransformCache::Slot const& slot = cache->slots[i];
+            if (slot.ready.load(std::memory_order_relaxed))
+              next->insert(slot.key, slot.transform);
+          }
+        } else {
+          next = new TransformCache(MIN_CACHE_SLOTS);
+        }
+        epoch_retire(m_cache.exchange(next));
+        cache = next;
+      }
+      cache->insert(key, result);
+
+      return result;
     }
 
     void
@@ -436,6 +541,7 @@ namespace vw {
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
       vw::geometry::set_transform(frame.node, wrt_frame.node, update);
+      tree_changed();
     }
 
     void
@@ -447,6 +553,7 @@ namespace vw {
                  vw::LogicErr() << "NULL handle not allowed as parameter.");
 
       vw::geometry::set_transform(frame.node, NULL, update);
+      tree_changed();
     }
 
     bool
@@ -459,6 +566,8 @@ namespace vw {
     bool
     FrameStore::merge_tree(FrameTreeNode * tree, FrameHandle start_frame)
     {
+      RecursiveMutex::Lock lock(m_mutex);
+
       VW_ASSERT (!is_member(tree),
                  vw::LogicErr() << "Merged tree must not yet be member of the FrameStore.");
 
@@ -468,6 +577,7 @@ namespace vw {
                    vw::LogicErr() << "Tree root node does not match start node.");
         vw::geometry::merge_frame_trees(tree, start_frame.node);
         tree->recursive_delete();
+        tree_changed();
         return true;
       }
 
@@ -477,12 +587,14 @@ namespace vw {
         if ((*first)->data().name() == tree->data().name()) {
           vw::geometry::merge_frame_trees(*first, tree);
           tree->recursive_delete();
+          tree_changed();
           return true;
         }
       }
 
       // just add the tree to the forest
       m_root_nodes.push_back(tree);
+      tree_changed();
       return false;
     }
 
@@ -511,6 +623,7 @@ namespace vw {
       for (first = frames.begin(); first != last; ++first, ++trans) {
         first->node->data().set_transform(*trans);
       }
+      tree_changed();
     }
 
     bool
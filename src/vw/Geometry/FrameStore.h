@@ -22,8 +22,13 @@
 
 #include <vw/Geometry/FrameHandle.h>
 #include <vw/Geometry/FrameTreeNode.h>
+#include <vw/Core/Epoch.h>
 #include <vw/Core/Thread.h>
 
+#include <atomic>
+#include <utility>
+#include <vector>
+
 
 namespace vw
 {
@@ -92,11 +97,20 @@ namespace geometry
 
     //! @}
 
+    //! Constructor
+    FrameStore() : m_version(0), m_cache(0) {}
+
     //! Destructor
     /** Deletes all frames owned by this FrameStore instance.
      */
     ~FrameStore() throw();
 
+    /**
+     * A stamp which changes whenever a frame is added, deleted,
+     * reparented or moved.
+     */
+    uint64 version() const { return m_version; }
+
     //! Get a copy of the frame tree.
     /**
      *
@@ -334,6 +348,14 @@ namespace geometry
        */
       void set_transform_rel(FrameHandle frame, Transform const& loc);
 
+      /**
+       * Return the transforms of each of sources expressed relative to frame.
+       * @param frame
+       * @param sources
+       * @param transforms
+       */
+      void get_transforms(FrameHandle frame, FrameHandleVector const& sources, TransformVector& transforms);
+
       void get_frame_transforms(FrameHandleVector const& handles, TransformVector& transforms) const;
       void set_frame_transforms(FrameHandleVector const& handles, TransformVector const& transforms);
 
@@ -350,10 +372,47 @@ namespace geometry
       /** Vector of FrameTreeNode pointers. */
       typedef std::vector<FrameTreeNode *> FrameTreeNodeVector;
 
+      /**
+       * The composite transforms computed since the tree last changed, in an
+       * open addressing table which readers probe without a lock. A slot is
+       * written once, with m_mutex held, before it is marked ready. The table
+       * is never more than half full, so a probe always ends.
+       */
+      struct TransformCache {
+        typedef std::pair<FrameTreeNode const*, FrameTreeNode const*> Key;
+        struct Slot {
+          std::atomic<bool> ready;
+          Key key;
+          Transform transform;
+          Slot() : ready(false) {}
+        };
+        std::vector<Slot> slots; ///< A power of two in size
+        size_t count;            ///< The ready slots, only used with m_mutex held
+
+        explicit TransformCache(size_t num_slots) : slots(num_slots), count(0) {}
+        /** Look up key, which is safe while the table is being added to. */
+        bool find(Key const& key, Transform& transform) const;
+        /** Add a key which is not in the table yet. Call with m_mutex held. */
+        void insert(Key const& key, Transform const& transform);
+      };
+
+      /** The transform of source relative to frame, from the cache if it is there. */
+      Transform cached_transform(FrameTreeNode const * frame, FrameTreeNode const * source) const;
+      /** Invalidates the cached transforms. Called with m_mutex held after every change. */
+      void tree_changed() {
+        ++m_version;
+        epoch_retire(m_cache.exchange(0));
+      }
+
       /** Mutex to ensure exclusive access to framestore operations. */
       mutable RecursiveMutex m_mutex;
       /** The vector of root nodes. */
       FrameTreeNodeVector m_root_nodes;
+      /** Stamp of the tree, see version(). */
+      std::atomic<uint64> m_version;
+      /** The cached transforms, or NULL. Only read under an EpochGuard or with m_mutex
+       *  held, and a replaced table is passed to epoch_retire(). */
+      mutable std::atomic<TransformCache*> m_cache;
     };
   }
 }
@@ -0,0 +1,328 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file PackedSpatialTree.h
+///
+/// A static R-tree over a fixed set of boxes, for overlap queries such
+/// as which of thousands of image footprints touch a region or each
+/// other.
+///
+/// Where SpatialTree inserts GeomPrimitive pointers one at a time and
+/// calls virtual functions on them, this tree is bulk loaded from the
+/// boxes alone with the Sort-Tile-Recursive algorithm of Leutenegger,
+/// Lopez and Edgington (1997).  The boxes and the nodes are kept in
+/// contiguous arrays, and queries return the indices of the boxes as
+/// they were given to build().
+///
+#ifndef __VW_GEOMETRY_PACKED_SPATIAL_TREE_H__
+#define __VW_GEOMETRY_PACKED_SPATIAL_TREE_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Geometry/SpatialTree.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace vw {
+namespace geometry {
+
+  template <size_t DimN>
+  class PackedSpatialTree {
+  public:
+    typedef BBox<double, DimN>   BBoxT;
+    typedef Vector<double, DimN> VectorT;
+
+    /// node_size is the number of children of each node.
+    explicit PackedSpatialTree( size_t node_size = 16 )
+      : m_node_size( std::max( node_size, size_t(2) ) ), m_num_leaves( 0 ) {}
+
+    /// Build the tree over boxes, replacing any earlier contents.
+    void build( std::vector<BBoxT> const& boxes );
+
+    /// Build the tree over the bounding boxes of prims, which must all
+    /// have DimN dimensions.  Query results index into prims.
+    void build( std::vector<GeomPrimitive*> const& prims );
+
+    size_t size() const { return m_ids.size(); }
+
+    /// The union of all the boxes.
+    BBoxT bounding_box() const { return m_nodes.empty() ? BBoxT() : m_nodes.back().box; }
+
+    /// Set result to the indices of the boxes that intersect box.
+    void intersects( BBoxT const& box, std::vector<size_t>& result ) const {
+      search( IntersectsBox( box ), result );
+    }
+
+    /// Set result to the indices of the boxes that contain point.
+    void contains( VectorT const& point, std::vector<size_t>& result ) const {
+      search( ContainsPoint( point ), result );
+    }
+
+    /// Set pairs to every pair of intersecting boxes, as (i, j) with i < j.
+    /// This is a sweep and prune along the first dimension, split across
+    /// num_threads threads, or the default number if num_threads is zero.
+    /// The order of the pairs does not depend on the number of threads.
+    void overlap_pairs( std::vector<std::pair<size_t, size_t> >& pairs, int num_threads = 0 ) const;
+
+  private:
+    struct Node {
+      BBoxT  box;
+      size_t begin, end; // Children in m_boxes for leaves, or else in m_nodes
+    };
+
+    struct IntersectsBox {
+      BBoxT const& m_box;
+      IntersectsBox( BBoxT const& box ) : m_box( box ) {}
+      bool operator()( BBoxT const& box ) const { return box.intersects( m_box ); }
+    };
+
+    struct ContainsPoint {
+      VectorT const& m_point;
+      ContainsPoint( VectorT const& point ) : m_point( point ) {}
+      bool operator()( BBoxT const& box ) const { return box.contains( m_point ); }
+    };
+
+    class SweepTask;
+
+    size_t m_node_size;
+    std::vector<BBoxT>  m_boxes;      // The boxes in tree order
+    std::vector<size_t> m_ids;        // The index given to build() of each box in tree order
+    std::vector<Node>   m_nodes;      // By level, leaves first and the root last
+    size_t              m_num_leaves;
+    std::vector<BBoxT>  m_sweep;      // The boxes in order of their minimum along the first dimension
+    std::vector<size_t> m_sweep_ids;
+
+    // Sort order into the Sort-Tile-Recursive order of the boxes with
+    // the given centers, starting with dimension dim.
+    void str_sort( std::vector<VectorT> const& centers, std::vector<size_t>::iterator begin,
+                   std::vector<size_t>::iterator end, size_t dim ) const;
+
+    template <class PredT>
+    void search( PredT const& pred, std::vector<size_t>& result ) const;
+  };
+
+  // ---------------------------------------------------------------------
+  // Building
+  // ---------------------------------------------------------------------
+
+  namespace detail {
+    template <size_t DimN>
+    struct CenterLess {
+      std::vector<Vector<double, DimN> > const& centers;
+      size_t dim;
+      CenterLess( std::vector<Vector<double, DimN> > const& centers, size_t dim )
+        : centers( centers ), dim( dim ) {}
+      bool operator()( size_t a, size_t b ) const { return centers[a][dim] < centers[b][dim]; }
+    };
+
+    template <size_t DimN>
+    struct MinLess {
+      std::vector<BBox<double, DimN> > const& boxes;
+      MinLess( std::vector<BBox<double, DimN> > const& boxes ) : boxes( boxes ) {}
+      bool operator()( size_t a, size_t b ) const { return boxes[a].min()[0] < boxes[b].min()[0]; }
+    };
+  }
+
+  // The entries are cut into slabs along dim, each of which is sorted
+  // along the next dimension, so that consecutive runs of m_node_size
+  // entries form compact tiles.
+  template <size_t DimN>
+  void PackedSpatialTree<DimN>::str_sort( std::vector<VectorT> const& centers,
+                                          std::vector<size_t>::iterator begin,
+                                          std::vector<size_t>::iterator end, size_t dim ) const {
+    std::stable_sort( begin, end, detail::CenterLess<DimN>( centers, dim ) );
+    const size_t count = end - begin;
+    if ( dim + 1 == DimN || count <= m_node_size )
+      return;
+    const size_t num_nodes = ( count + m_node_size - 1 ) / m_node_size;
+    const size_t num_slabs = size_t( std::ceil( std::pow( double( num_nodes ), 1.0 / double( DimN - dim ) ) ) );
+    const size_t slab_size = m_node_size * ( ( num_nodes + num_slabs - 1 ) / num_slabs );
+    for ( size_t s = 0; s < count; s += slab_size )
+      str_sort( centers, begin + s, begin + std::min( s + slab_size, count ), dim + 1 );
+  }
+
+  template <size_t DimN>
+  void PackedSpatialTree<DimN>::build( std::vector<BBoxT> const& boxes ) {
+    const size_t num_boxes = boxes.size();
+    m_nodes.clear();
+    m_num_leaves = 0;
+
+    std::vector<VectorT> centers( num_boxes );
+    m_ids.resize( num_boxes );
+    for ( size_t i = 0; i < num_boxes; ++i ) {
+      centers[i] = boxes[i].center();
+      m_ids[i] = i;
+    }
+    str_sort( centers, m_ids.begin(), m_ids.end(), 0 );
+    m_boxes.resize( num_boxes );
+    for ( size_t i = 0; i < num_boxes; ++i )
+      m_boxes[i] = boxes[m_ids[i]];
+
+    // Each level groups runs of the level below, which is in STR order,
+    // and is then put in STR order itself.  A node's children are found
+    // through begin and end, so reordering a level leaves the level
+    // below intact.
+    size_t level_begin = 0, level_end = num_boxes;
+    bool leaves = true;
+    while ( leaves || level_end - level_begin > 1 ) {
+      const size_t parents_begin = m_nodes.size();
+      for ( size_t c = level_begin; c < level_end; c += m_node_size ) {
+        Node node;
+        node.begin = c;
+        node.end   = std::min( c + m_node_size, level_end );
+        for ( size_t k = node.begin; k < node.end; ++k )
+          node.box.grow( leaves ? m_boxes[k] : m_nodes[k].box );
+        m_nodes.push_back( node );
+      }
+      if ( leaves )
+        m_num_leaves = m_nodes.size();
+      leaves = false;
+      level_begin = parents_begin;
+      level_end   = m_nodes.size();
+      if ( level_end - level_begin <= 1 )
+        break;
+
+      std::vector<VectorT> node_centers( level_end - level_begin );
+      std::vector<size_t>  order( node_centers.size() );
+      for ( size_t k = 0; k < order.size(); ++k ) {
+        node_centers[k] = m_nodes[level_begin + k].box.center();
+        order[k] = k;
+      }
+      str_sort( node_centers, order.begin(), order.end(), 0 );
+      std::vector<Node> level( m_nodes.begin() + level_begin, m_nodes.end() );
+      for ( size_t k = 0; k < order.size(); ++k )
+        m_nodes[level_begin + k] = level[order[k]];
+    }
+
+    // For overlap_pairs().
+    std::vector<size_t> order( num_boxes );
+    for ( size_t i = 0; i < num_boxes; ++i )
+      order[i] = i;
+    std::stable_sort( order.begin(), order.end(), detail::MinLess<DimN>( boxes ) );
+    m_sweep.resize( num_boxes );
+    m_sweep_ids = order;
+    for ( size_t i = 0; i < num_boxes; ++i )
+      m_sweep[i] = boxes[order[i]];
+  }
+
+  template <size_t DimN>
+  void PackedSpatialTree<DimN>::build( std::vector<GeomPrimitive*> const& prims ) {
+    std::vector<BBoxT> boxes( prims.size() );
+    for ( size_t i = 0; i < prims.size(); ++i ) {
+      BBoxN const& box = prims[i]->bounding_box();
+      if ( box.min().size() == 0 )
+        continue; // An empty box intersects nothing
+      VW_ASSERT( box.min().size() == DimN,
+                 ArgumentErr() << "PackedSpatialTree: Primitive " << i << " has "
+                               << box.min().size() << " dimensions, not " << DimN << "." );
+      boxes[i] = BBoxT( VectorT( box.min() ), VectorT( box.max() ) );
+    }
+    build( boxes );
+  }
+
+  // ---------------------------------------------------------------------
+  // Queries
+  // ---------------------------------------------------------------------
+
+  template <size_t DimN>
+  template <class PredT>
+  void PackedSpatialTree<DimN>::search( PredT const& pred, std::vector<size_t>& result ) const {
+    result.clear();
+    if ( m_nodes.empty() )
+      return;
+    std::vector<size_t> stack( 1, m_nodes.size() - 1 );
+    while ( !stack.empty() ) {
+      Node const& node = m_nodes[stack.back()];
+      const bool is_leaf = stack.back() < m_num_leaves;
+      stack.pop_back();
+      if ( !pred( node.box ) )
+        continue;
+      if ( is_leaf ) {
+        for ( size_t k = node.begin; k < node.end; ++k )
+          if ( pred( m_boxes[k] ) )
+            result.push_back( m_ids[k] );
+      } else {
+        for ( size_t k = node.begin; k < node.end; ++k )
+          stack.push_back( k );
+      }
+    }
+  }
+
+  // Finds the pairs whose first box is in [m_begin, m_end) of m_sweep.
+  template <size_t DimN>
+  class PackedSpatialTree<DimN>::SweepTask : public Task {
+    std::vector<BBoxT>  const& m_sweep;
+    std::vector<size_t> const& m_ids;
+    size_t m_begin, m_end;
+    std::vector<std::pair<size_t, size_t> >& m_pairs;
+  public:
+    SweepTask( std::vector<BBoxT> const& sweep, std::vector<size_t> const& ids,
+               size_t begin, size_t end, std::vector<std::pair<size_t, size_t> >& pairs )
+      : m_sweep( sweep ), m_ids( ids ), m_begin( begin ), m_end( end ), m_pairs( pairs ) {}
+
+    virtual void operator()() {
+      for ( size_t a = m_begin; a < m_end; ++a ) {
+        BBoxT const& box = m_sweep[a];
+        for ( size_t b = a + 1; b < m_sweep.size() && m_sweep[b].min()[0] < box.max()[0]; ++b )
+          if ( box.intersects( m_sweep[b] ) )
+            m_pairs.push_back( std::make_pair( std::min( m_ids[a], m_ids[b] ),
+                                               std::max( m_ids[a], m_ids[b] ) ) );
+      }
+    }
+  };
+
+  template <size_t DimN>
+  void PackedSpatialTree<DimN>::overlap_pairs( std::vector<std::pair<size_t, size_t> >& pairs,
+                                               int num_threads ) const {
+    pairs.clear();
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+
+    // Several runs per thread, since the runs with wide boxes take longer.
+    const size_t min_run = 256;
+    const size_t num_runs = std::min( size_t( 4*num_threads ), ( m_sweep.size() + min_run - 1 ) / min_run );
+    if ( num_threads == 1 || num_runs <= 1 ) {
+      SweepTask( m_sweep, m_sweep_ids, 0, m_sweep.size(), pairs )();
+      return;
+    }
+
+    std::vector<std::vector<std::pair<size_t, size_t> > > run_pairs( num_runs );
+    FifoWorkQueue queue( num_threads );
+    for ( size_t r = 0; r < num_runs; ++r )
+      queue.add_task( boost::shared_ptr<Task>(
+        new SweepTask( m_sweep, m_sweep_ids, r*m_sweep.size()/num_runs, (r+1)*m_sweep.size()/num_runs,
+                       run_pairs[r] ) ) );
+    queue.join_all();
+
+    size_t count = 0;
+    for ( size_t r = 0; r < num_runs; ++r )
+      count += run_pairs[r].size();
+    pairs.reserve( count );
+    for ( size_t r = 0; r < num_runs; ++r )
+      pairs.insert( pairs.end(), run_pairs[r].begin(), run_pairs[r].end() );
+  }
+
+}} // namespace vw::geometry
+
+#endif // __VW_GEOMETRY_PACKED_SPATIAL_TREE_H__
@@ -21,9 +21,13 @@
 #include <cassert>
 #include <cfloat>
 #include <cassert>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #include <map>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Geometry/cutPoly.h>
 #include <vw/Geometry/dPoly.h>
 
@@ -219,83 +223,180 @@ void dPoly::set_annoByType(const std::vector<anno> & annotations, int annoType){
   return;
 }
 
-void dPoly::clipPoly(// inputs
+namespace {
+
+  // The pieces of a run of polygons clipped to a box, and the polygon
+  // each piece came from.
+  struct ClippedPieces{
+    vector<double> xv, yv;
+    vector<int>    numVerts, source;
+  };
+
+  void clipPolyRange(// inputs
+                     const double * xv, const double * yv,
+                     const int * numVerts, const int * starts,
+                     const vector<char> & isPolyClosed, bool isPointCloud,
+                     int beginPoly, int endPoly,
                      double clip_xll, double clip_yll,
                      double clip_xur, double clip_yur,
-                     dPoly & clippedPoly // output
+                     // output
+                     ClippedPieces & pieces
                      ){
 
-  assert(this != &clippedPoly); // source and destination must be different
-
-  clippedPoly.reset();
-  clippedPoly.set_isPointCloud(m_isPointCloud);
-
-  const double * xv               = get_xv();
-  const double * yv               = get_yv();
-  const int    * numVerts         = get_numVerts();
-  int numPolys                    = get_numPolys();
-  const vector<char> isPolyClosed = get_isPolyClosed();
-  const vector<string> colors     = get_colors();
-  const vector<string> layers     = get_layers();
-
-  int start = 0;
-  for (int pIter = 0; pIter < numPolys; pIter++){
-
-    if (pIter > 0) start += numVerts[pIter - 1];
-
-    int  isClosed = isPolyClosed [pIter];
-    string color  = colors       [pIter];
-    string layer  = layers       [pIter];
-
     vector<double> cutXv, cutYv;
     vector<int> cutNumVerts;
-    cutXv.clear(); cutYv.clear(); cutNumVerts.clear();
-
-    if (m_isPointCloud){
-
-      // To cut a point cloud to a box all is needed is to select
-      // which points are in the box
-      for (int vIter = 0; vIter < numVerts[pIter]; vIter++){
-        double x = xv[start + vIter];
-        double y = yv[start + vIter];
-        if (x >= clip_xll && x <= clip_xur &&
-            y >= clip_yll && y <= clip_yur
-            ){
-          cutXv.push_back(x);
-          cutYv.push_back(y);
-        }
-      }
-      cutNumVerts.push_back( cutXv.size() );
 
-    }else if (isClosed){
+    for (int pIter = beginPoly; pIter < endPoly; pIter++){
+
+      int start = starts[pIter];
+      int numV  = numVerts[pIter];
+      cutXv.clear(); cutYv.clear(); cutNumVerts.clear();
+
+      if (isPointCloud){
+
+        // To cut a point cloud to a box all is needed is to select
+        // which points are in the box
+        for (int vIter = 0; vIter < numV; vIter++){
+          double x = xv[start + vIter];
+          double y = yv[start + vIter];
+          if (x >= clip_xll && x <= clip_xur &&
+              y >= clip_yll && y <= clip_yur
+              ){
+            cutXv.push_back(x);
+            cutYv.push_back(y);
+          }
+        }
+        cutNumVerts.push_back( cutXv.size() );
 
-      cutPoly(1, numVerts + pIter, xv + start, yv + start,
-              clip_xll, clip_yll, clip_xur, clip_yur,
-              cutXv, cutYv, cutNumVerts // outputs
-              );
+      }else{
 
-    }else{
+        // A polygon whose bounding box is outside the clip box has
+        // nothing left, and one whose box is inside is left as is.
+        double pxll = DBL_MAX, pyll = DBL_MAX, pxur = -DBL_MAX, pyur = -DBL_MAX;
+        for (int vIter = start; vIter < start + numV; vIter++){
+          pxll = min(pxll, xv[vIter]); pxur = max(pxur, xv[vIter]);
+          pyll = min(pyll, yv[vIter]); pyur = max(pyur, yv[vIter]);
+        }
+        if (numV == 0 || pxur < clip_xll || pxll > clip_xur ||
+            pyur < clip_yll || pyll > clip_yur) continue;
+
+        if (pxll > clip_xll && pxur < clip_xur &&
+            pyll > clip_yll && pyur < clip_yur){
+          pieces.xv.insert(pieces.xv.end(), xv + start, xv + start + numV);
+          pieces.yv.insert(pieces.yv.end(), yv + start, yv + start + numV);
+          pieces.numVerts.push_back(numV);
+          pieces.source.push_back(pIter);
+          continue;
+        }
 
-      cutPolyLine(numVerts[pIter], xv + start, yv + start,
+        if (isPolyClosed[pIter]){
+          cutPoly(1, numVerts + pIter, xv + start, yv + start,
                   clip_xll, clip_yll, clip_xur, clip_yur,
                   cutXv, cutYv, cutNumVerts // outputs
                   );
+        }else{
+          cutPolyLine(numV, xv + start, yv + start,
+                      clip_xll, clip_yll, clip_xur, clip_yur,
+                      cutXv, cutYv, cutNumVerts // outputs
+                      );
+        }
+      }
 
+      pieces.xv.insert(pieces.xv.end(), cutXv.begin(), cutXv.end());
+      pieces.yv.insert(pieces.yv.end(), cutYv.begin(), cutYv.end());
+      pieces.numVerts.insert(pieces.numVerts.end(), cutNumVerts.begin(), cutNumVerts.end());
+      pieces.source.insert(pieces.source.end(), cutNumVerts.size(), pIter);
     }
+  }
 
-    int cstart = 0;
-    for (int cIter = 0; cIter < (int)cutNumVerts.size(); cIter++){
+  class ClipPolyTask : public Task {
+    const double * m_xv, * m_yv;
+    const int    * m_numVerts, * m_starts;
+    const vector<char> & m_isPolyClosed;
+    bool   m_isPointCloud;
+    int    m_beginPoly, m_endPoly;
+    double m_xll, m_yll, m_xur, m_yur;
+    ClippedPieces & m_pieces;
+  public:
+    ClipPolyTask(const double * xv, const double * yv,
+                 const int * numVerts, const int * starts,
+                 const vector<char> & isPolyClosed, bool isPointCloud,
+                 int beginPoly, int endPoly,
+                 double xll, double yll, double xur, double yur,
+                 ClippedPieces & pieces):
+      m_xv(xv), m_yv(yv), m_numVerts(numVerts), m_starts(starts),
+      m_isPolyClosed(isPolyClosed), m_isPointCloud(isPointCloud),
+      m_beginPoly(beginPoly), m_endPoly(endPoly),
+      m_xll(xll), m_yll(yll), m_xur(xur), m_yur(yur), m_pieces(pieces){}
+
+    virtual void operator()(){
+      clipPolyRange(m_xv, m_yv, m_numVerts, m_starts, m_isPolyClosed, m_isPointCloud,
+                    m_beginPoly, m_endPoly, m_xll, m_yll, m_xur, m_yur, m_pieces);
+    }
+  };
 
-      if (cIter > 0) cstart += cutNumVerts[cIter - 1];
-      int cSize = cutNumVerts[cIter];
+}
+
+void dPoly::clipPoly(// inputs
+                     double clip_xll, double clip_yll,
+                     double clip_xur, double clip_yur,
+                     dPoly & clippedPoly, // output
+                     int num_threads
+                     ){
+
+  assert(this != &clippedPoly); // source and destination must be different
+
+  clippedPoly.reset();
+  clippedPoly.set_isPointCloud(m_isPointCloud);
+
+  const int * numVerts = get_numVerts();
+  int numPolys         = get_numPolys();
+
+  vector<int> starts(numPolys + 1, 0);
+  for (int pIter = 0; pIter < numPolys; pIter++)
+    starts[pIter + 1] = starts[pIter] + numVerts[pIter];
+
+  // Split the polygons into runs of about equal numbers of vertices.
+  // Small sets are not worth the threads.
+  const int minVertsPerRun = 1 << 16;
+  if (num_threads <= 0) num_threads = vw_settings().default_num_threads();
+  int numRuns = min(4*num_threads, m_totalNumVerts/minVertsPerRun);
+  if (num_threads == 1 || numRuns < 2) numRuns = 1;
+
+  vector<int> runBegin(numRuns + 1, numPolys);
+  runBegin[0] = 0;
+  for (int r = 1, pIter = 0; r < numRuns; r++){
+    double target = double(m_totalNumVerts) * r / numRuns;
+    while (pIter < numPolys && starts[pIter] < target) pIter++;
+    runBegin[r] = pIter;
+  }
+
+  vector<ClippedPieces> pieces(numRuns);
+  if (numRuns == 1){
+    clipPolyRange(get_xv(), get_yv(), numVerts, vecPtr(starts), m_isPolyClosed, m_isPointCloud,
+                  0, numPolys, clip_xll, clip_yll, clip_xur, clip_yur, pieces[0]);
+  }else{
+    FifoWorkQueue queue(num_threads);
+    for (int r = 0; r < numRuns; r++)
+      queue.add_task(boost::shared_ptr<Task>
+                     (new ClipPolyTask(get_xv(), get_yv(), numVerts, vecPtr(starts),
+                                       m_isPolyClosed, m_isPointCloud, runBegin[r], runBegin[r + 1],
+                                       clip_xll, clip_yll, clip_xur, clip_yur, pieces[r])));
+    queue.join_all();
+  }
+
+  for (int r = 0; r < numRuns; r++){
+    int cstart = 0;
+    for (int cIter = 0; cIter < (int)pieces[r].numVerts.size(); cIter++){
+      int cSize  = pieces[r].numVerts[cIter];
+      int source = pieces[r].source[cIter];
       clippedPoly.appendPolygon(cSize,
-                                vecPtr(cutXv) + cstart,
-                                vecPtr(cutYv) + cstart,
-                                isClosed, color, layer
+                                vecPtr(pieces[r].xv) + cstart,
+                                vecPtr(pieces[r].yv) + cstart,
+                                m_isPolyClosed[source], m_colors[source], m_layers[source]
                                 );
-
+      cstart += cSize;
     }
-
   }
 
   // Cutting inherits the annotations at the vertices of the uncut
@@ -1186,18 +1287,22 @@ void dPoly::writePoly(std::string filename, std::string defaultColor){
   return;
 }
 
-bool dPoly::getColorInCntFile(const std::string & line, std::string & color){
+namespace {
 
-  // Minor function. Out of the line: "#Color = #ff00" return the string "#ff00"
-  // and append "00" to it to make it a valid color.
+  bool getColorInCntFile(const std::string & line, std::string & color){
 
-  istringstream iss(line);
-  string equal, colorTag;
-  if ( ! (iss >> colorTag >> equal >> color)        ) return false;
-  if ( colorTag != "#Color" && colorTag != "#color" ) return false;
-  while (color[0] == '#' && color.size() < 7 ) color += "0";
+    // Minor function. Out of the line: "#Color = #ff00" return the string "#ff00"
+    // and append "00" to it to make it a valid color.
+
+    istringstream iss(line);
+    string equal, colorTag;
+    if ( ! (iss >> colorTag >> equal >> color)        ) return false;
+    if ( colorTag != "#Color" && colorTag != "#color" ) return false;
+    while (color[0] == '#' && color.size() < 7 ) color += "0";
+
+    return true;
+  }
 
-  return true;
 }
 
 bool dPoly::read_pol_or_cnt_format(std::string filename,
@@ -1208,87 +1313,230 @@ bool dPoly::read_pol_or_cnt_format(std::string filename,
 
   assert(type == "pol" || type == "cnt");
 
-  string color = "yellow";
-  string layer = "";
-
   reset();
   m_isPointCloud = isPointCloud;
 
-  ifstream fh(filename.c_str());
-  if( !fh ){
+  dPolyReader reader(filename, type);
+  if (!reader.isOpen()){
     cerr << "Could not open " << filename << endl;
     return false;
   }
 
+  vector<double> xv, yv;
+  bool isPolyClosed;
+  string color;
+  while (reader.readNext(xv, yv, isPolyClosed, color))
+    appendPolygon(xv.size(), vecPtr(xv), vecPtr(yv), isPolyClosed, color, "");
+
+  return !reader.hasError();
+}
+
+bool dPoly::write_pol_or_cnt_format(std::string filename, std::string type){
+
+  assert(type == "pol" || type == "cnt");
+
+  dPolyWriter writer(filename, type);
+  if (!writer.isOpen()){
+    cerr << "Error: Could not write to " << filename << endl;
+    return false;
+  }
+
+  int start = 0;
+  for (int pIter = 0; pIter < m_numPolys; pIter++){
+    writer.writePolygon(m_numVerts[pIter], vecPtr(m_xv) + start, vecPtr(m_yv) + start,
+                        m_isPolyClosed[pIter], m_colors[pIter]);
+    start += m_numVerts[pIter];
+  }
+
+  return true;
+}
+
+dPolyReader::dPolyReader(std::string filename, std::string type):
+  m_fh(filename.c_str()), m_type(type), m_color("yellow"),
+  m_isOpen(false), m_hasError(false){
+
+  assert(type == "pol" || type == "cnt");
+
+  if ( !m_fh ) return;
+  m_isOpen = true;
+
   // Bypass the lines starting with comments. Extract the color.
   while (1){
-    char c = fh.peek();
+    char c = m_fh.peek();
     if (c != '#' && c != '!') break;
     string line;
-    getline(fh, line);
+    getline(m_fh, line);
     string lColor;
-    if (getColorInCntFile(line, lColor)) color = lColor;
+    if (getColorInCntFile(line, lColor)) m_color = lColor;
   }
 
   // Parse the header for pol files.
   double tmp;
-  if (type == "pol" && !(fh >> tmp >> tmp >> tmp >> tmp) ) return false;
+  if (m_type == "pol" && !(m_fh >> tmp >> tmp >> tmp >> tmp) ) m_hasError = true;
+}
 
-  while (1){
+bool dPolyReader::readNext(std::vector<double> & xv, std::vector<double> & yv,
+                           bool & isPolyClosed, std::string & color){
+
+  xv.clear();
+  yv.clear();
+  if (!m_isOpen || m_hasError) return false;
+
+  int numVerts = 0;
+  double tmp;
 
-    int numVerts = 0;
+  while (1){
 
-    if (type == "pol"){
+    if (m_type == "pol"){
       // Extract the number of vertices for pol files
-     if (! (fh >> tmp >> numVerts) ) return true;  // no more vertices
-     if (! (fh >> tmp >> tmp) )      return false; // invalid format
-    }else{
-      // Extract the number of vertices and/or color for cnt file.
-      // Skip lines with comments.
-      string line;
-      if (!getline(fh, line)) return true;
-      string lColor; if (getColorInCntFile(line, lColor)) color = lColor;
-      if (!line.empty() && line[0] == '#') continue;
-      numVerts = int(atof(line.c_str()));
+      if (! (m_fh >> tmp >> numVerts) ) return false;                  // no more vertices
+      if (! (m_fh >> tmp >> tmp) ) { m_hasError = true; return false; } // invalid format
+      break;
     }
 
-    // Now that we know how many vertices to expect, try reading them
-    // from the file. Stop if we are unable to find the expected vertices.
-
-    m_numPolys++;
-    m_numVerts.push_back(numVerts);
-    m_totalNumVerts += numVerts;
-    m_colors.push_back(color);
-    m_layers.push_back(layer);
+    // Extract the number of vertices and/or color for cnt file.
+    // Skip blank lines and lines with comments.
+    string line;
+    if (!getline(m_fh, line)) return false;
+    string lColor; if (getColorInCntFile(line, lColor)) m_color = lColor;
+    if (line.find_first_not_of(" \t\r") == string::npos) continue;
+    if (line[0] == '#') continue;
+    numVerts = int(atof(line.c_str()));
+    break;
+  }
 
-    for (int s = 0; s < numVerts; s++){
-      double x, y;
-      if (! (fh >> x >> y) ) return false;
-      m_xv.push_back(x);
-      m_yv.push_back(y);
+  // Now that we know how many vertices to expect, try reading them
+  // from the file. Stop if we are unable to find the expected vertices.
+  for (int s = 0; s < numVerts; s++){
+    double x, y;
+    if (! (m_fh >> x >> y) ){
+      m_hasError = true;
+      xv.clear();
+      yv.clear();
+      return false;
     }
+    xv.push_back(x);
+    yv.push_back(y);
+  }
 
-    int l = m_totalNumVerts;
-    if (l > 0 && numVerts >= 2            &&
-        m_xv[l - 1] == m_xv[l - numVerts] &&
-        m_yv[l - 1] == m_yv[l - numVerts]
-	){
-	// Remove last repeated vertex
-	m_xv.pop_back();
-	m_yv.pop_back();
-	m_totalNumVerts--;
-        m_numVerts[m_numVerts.size() - 1]--;
-        m_isPolyClosed.push_back(true);
-    }else if (type == "pol"){
-      // pol files are always closed
-      m_isPolyClosed.push_back(true);
-    }else{
-      m_isPolyClosed.push_back(false);
-    }
+  color = m_color;
+  if (numVerts >= 2 && xv.back() == xv.front() && yv.back() == yv.front()){
+    // Remove last repeated vertex
+    xv.pop_back();
+    yv.pop_back();
+    isPolyClosed = true;
+  }else{
+    // pol files are always closed
+    isPolyClosed = (m_type == "pol");
+  }
+
+  return true;
+}
+
+dPolyWriter::dPolyWriter(std::string filename, std::string type):
+  m_out(filename.c_str()), m_type(type), m_numPolys(0),
+  m_xll(DBL_MAX), m_yll(DBL_MAX), m_xur(-DBL_MAX), m_yur(-DBL_MAX){
+
+  assert(type == "pol" || type == "cnt");
+
+  if (!m_out.is_open()) return;
+  m_out.precision(16);
+
+  // The pol header is the bounding box of all the vertices, which is
+  // only known at the end.  Reserve room for it, and fill it in then.
+  if (m_type == "pol") writeHeader();
+}
+
+void dPolyWriter::writeHeader(){
+  double xll = 0, yll = 0, xur = 0, yur = 0;
+  if (m_xll <= m_xur){
+    xll = m_xll; yll = m_yll; xur = m_xur; yur = m_yur;
+  }
+  char header[128];
+  snprintf(header, sizeof(header), "%24.16e %24.16e %24.16e %24.16e\n", xll, yll, xur, yur);
+  m_out << header;
+}
+
+void dPolyWriter::writePolygon(int numVerts, const double * xv, const double * yv,
+                               bool isPolyClosed, const std::string & color){
+
+  if (!m_out.is_open() || numVerts <= 0) return; // skip empty polygons
+
+  for (int v = 0; v < numVerts; v++){
+    m_xll = min(m_xll, xv[v]); m_xur = max(m_xur, xv[v]);
+    m_yll = min(m_yll, yv[v]); m_yur = max(m_yur, yv[v]);
+  }
+
+  if (m_type == "pol"){
+    // The index and size of the polygon, and two values that are not read.
+    // All pol polygons are closed.
+    m_out << m_numPolys << ' ' << numVerts << "\n0 0\n";
+  }else{
+    if (m_numPolys == 0 || color != m_color) m_out << "#Color = " << color << "\n";
+    m_color = color;
+    // Repeat the first vertex of a closed polygon
+    m_out << numVerts + (isPolyClosed ? 1 : 0) << "\n";
+  }
+
+  for (int v = 0; v < numVerts; v++)
+    m_out << xv[v] << ' ' << yv[v] << "\n";
+  if (m_type == "cnt" && isPolyClosed)
+    m_out << xv[0] << ' ' << yv[0] << "\n";
 
+  m_numPolys++;
+}
+
+void dPolyWriter::close(){
+  if (!m_out.is_open()) return;
+  if (m_type == "pol"){
+    m_out.seekp(0);
+    writeHeader();
+  }
+  m_out.close();
+}
+
+bool clipPolyFile(std::string inFile, std::string outFile, std::string type,
+                  double clip_xll, double clip_yll,
+                  double clip_xur, double clip_yur,
+                  int maxVerts, int num_threads){
+
+  dPolyReader reader(inFile, type);
+  if (!reader.isOpen()){
+    cerr << "Could not open " << inFile << endl;
+    return false;
+  }
+  dPolyWriter writer(outFile, type);
+  if (!writer.isOpen()){
+    cerr << "Error: Could not write to " << outFile << endl;
+    return false;
+  }
+
+  vector<double> xv, yv;
+  bool isPolyClosed;
+  string color;
+  bool more = true;
+  dPoly batch, clipped;
+  while (more){
+
+    batch.reset();
+    while (batch.get_totalNumVerts() < maxVerts &&
+           (more = reader.readNext(xv, yv, isPolyClosed, color)))
+      batch.appendPolygon(xv.size(), vecPtr(xv), vecPtr(yv), isPolyClosed, color, "");
+
+    batch.clipPoly(clip_xll, clip_yll, clip_xur, clip_yur, clipped, num_threads);
+
+    const int            * numVerts = clipped.get_numVerts();
+    const vector<char>   closed     = clipped.get_isPolyClosed();
+    const vector<string> colors     = clipped.get_colors();
+    int start = 0;
+    for (int pIter = 0; pIter < clipped.get_numPolys(); pIter++){
+      writer.writePolygon(numVerts[pIter], clipped.get_xv() + start, clipped.get_yv() + start,
+                          closed[pIter], colors[pIter]);
+      start += numVerts[pIter];
+    }
   }
 
-   return true;
+  return !reader.hasError();
 }
 
 void dPoly::set_pointCloud(const std::vector<dPoint> & P, std::string color,
@@ -20,6 +20,7 @@
 
 #include <vector>
 #include <map>
+#include <fstream>
 #include <vw/Geometry/baseUtils.h>
 #include <vw/Geometry/geomUtils.h>
 
@@ -46,6 +47,7 @@ public:
                 );
 
   void writePoly(std::string filename, std::string defaultColor = "yellow");
+  bool write_pol_or_cnt_format(std::string filename, std::string type);
   void bdBoxCenter(double & mx, double & my) const;
 
   void appendPolygon(int numVerts,
@@ -70,10 +72,13 @@ public:
 
   bool isXYRect();
 
+  // Clip to a box.  Large sets are clipped in runs of polygons on
+  // num_threads threads, or the default number if num_threads is 0.
   void clipPoly(// inputs
                 double clip_xll, double clip_yll,
                 double clip_xur, double clip_yur,
-                dPoly & clippedPoly // output
+                dPoly & clippedPoly, // output
+                int num_threads = 0
                 );
 
   void shift(double shift_x, double shift_y);
@@ -193,7 +198,6 @@ public:
 
 private:
 
-  bool getColorInCntFile(const std::string & line, std::string & color);
   void get_annoByType(std::vector<anno> & annotations, int annoType);
   void set_annoByType(const std::vector<anno> & annotations, int annoType);
 
@@ -214,6 +218,74 @@ private:
 
 };
 
+// Reads the polygons of a pol or cnt file one at a time, so that a
+// large file need not be held in a dPoly all at once.
+class dPolyReader{
+
+public:
+
+  // type is "pol" or "cnt"
+  dPolyReader(std::string filename, std::string type);
+
+  bool isOpen() const { return m_isOpen; }
+
+  // Read the next polygon.  Returns false at the end of the file, or
+  // if the file is malformed, in which case hasError() is true.
+  bool readNext(// outputs
+                std::vector<double> & xv, std::vector<double> & yv,
+                bool & isPolyClosed, std::string & color
+                );
+
+  bool hasError() const { return m_hasError; }
+
+private:
+
+  std::ifstream m_fh;
+  std::string   m_type;
+  std::string   m_color;
+  bool          m_isOpen;
+  bool          m_hasError;
+
+};
+
+// Writes polygons to a pol or cnt file one at a time.  The file is
+// complete once close() is called or the writer is destroyed.
+class dPolyWriter{
+
+public:
+
+  // type is "pol" or "cnt"
+  dPolyWriter(std::string filename, std::string type);
+  ~dPolyWriter(){ close(); }
+
+  bool isOpen() const { return m_out.is_open(); }
+
+  void writePolygon(int numVerts, const double * xv, const double * yv,
+                    bool isPolyClosed, const std::string & color);
+
+  void close();
+
+private:
+
+  void writeHeader();
+
+  std::ofstream m_out;
+  std::string   m_type;
+  std::string   m_color;
+  int           m_numPolys;
+  double        m_xll, m_yll, m_xur, m_yur; // For the pol header
+
+};
+
+// Clip the polygons in a pol or cnt file to a box, and write them to
+// another file of the same type.  At most about maxVerts vertices are
+// held in memory at once, and each batch is clipped on num_threads
+// threads.  Returns false if either file cannot be used.
+bool clipPolyFile(std::string inFile, std::string outFile, std::string type,
+                  double clip_xll, double clip_yll,
+                  double clip_xur, double clip_yur,
+                  int maxVerts = 1 << 20, int num_threads = 0);
+
 }}
 
 #endif // VW_GEOMETRY_DPOLY_H
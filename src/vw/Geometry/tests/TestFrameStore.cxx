@@ -0,0 +1,118 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+#include <gtest/gtest_VW.h>
+#include <vw/Geometry/FrameStore.h>
+#include <vw/Math/Vector.h>
+#include <test/Helpers.h>
+
+#include <sstream>
+
+using namespace vw;
+using namespace vw::geometry;
+
+namespace {
+  FrameStore::Transform translation(double x, double y, double z) {
+    return FrameStore::Transform(Vector3(x, y, z), math::identity_matrix<3>());
+  }
+}
+
+TEST(FrameStore, CachedTransforms) {
+  FrameStore store;
+  FrameHandle world = store.add("world", FrameStore::NULL_HANDLE, translation(0, 0, 0));
+  FrameHandle robot = store.add("robot", world, translation(1, 0, 0));
+  FrameHandle arm   = store.add("arm",   robot, translation(0, 2, 0));
+  FrameHandle cam   = store.add("cam",   world, translation(0, 0, 3));
+
+  EXPECT_VECTOR_NEAR( Vector3(1, 2, -3), store.get_transform(cam, arm).translation(), 1e-12 );
+  // The second query is answered from the cache.
+  EXPECT_VECTOR_NEAR( Vector3(1, 2, -3), store.get_transform(cam, arm).translation(), 1e-12 );
+
+  // Moving an ancestor invalidates the pair.
+  uint64 version = store.version();
+  store.set_transform_rel(robot, translation(5, 0, 0));
+  EXPECT_NE( version, store.version() );
+  EXPECT_VECTOR_NEAR( Vector3(5, 2, -3), store.get_transform(cam, arm).translation(), 1e-12 );
+  EXPECT_VECTOR_NEAR( Vector3(5, 2, -3), store.get_position_of(cam, arm, Vector3()), 1e-12 );
+
+  // So do reparenting and batch updates.
+  store.set_parent(arm, world);
+  EXPECT_VECTOR_NEAR( Vector3(0, 2, -3), store.get_transform(cam, arm).translation(), 1e-12 );
+  FrameStore::FrameHandleVector frames(1, cam);
+  FrameStore::TransformVector transforms(1, translation(0, 0, 1));
+  store.set_frame_transforms(frames, transforms);
+
+  FrameStore::FrameHandleVector sources;
+  sources.push_back(arm);
+  sources.push_back(robot);
+  store.get_transforms(cam, sources, transforms);
+  ASSERT_EQ( 2u, transforms.size() );
+  EXPECT_VECTOR_NEAR( Vector3(0, 2, -1), transforms[0].translation(), 1e-12 );
+  EXPECT_VECTOR_NEAR( Vector3(5, 0, -1), transforms[1].translation(), 1e-12 );
+}
+
+TEST(FrameStore, ManyCachedTransforms) {
+  // 6400 pairs, more than the cache keeps, so it grows and starts over.
+  FrameStore store;
+  FrameHandle world = store.add("world", FrameStore::NULL_HANDLE, translation(0, 0, 0));
+  std::vector<FrameHandle> frames;
+  for (int i = 0; i < 80; ++i) {
+    std::ostringstream name;
+    name << "frame" << i;
+    frames.push_back(store.add(name.str(), world, translation(i, 0, 0)));
+  }
+  for (int pass = 0; pass < 2; ++pass)
+    for (int i = 0; i < 80; ++i)
+      for (int j = 0; j < 80; ++j)
+        ASSERT_VECTOR_NEAR( Vector3(j - i, 0, 0),
+                            store.get_transform(frames[i], frames[j]).translation(), 1e-12 );
+}
+
+namespace {
+  struct FrameStoreReader {
+    FrameStore& m_store;
+    FrameHandle m_frame, m_source;
+    bool& m_ok;
+    FrameStoreReader(FrameStore& store, FrameHandle frame, FrameHandle source, bool& ok)
+      : m_store(store), m_frame(frame), m_source(source), m_ok(ok) {}
+    void operator()() {
+      for (int i = 0; i < 20000; ++i) {
+        // The writer keeps the translation on the line x == y.
+        Vector3 p = m_store.get_transform(m_frame, m_source).translation();
+        if (p[0] != p[1])
+          m_ok = false;
+      }
+    }
+  };
+}
+
+TEST(FrameStore, ConcurrentReaders) {
+  FrameStore store;
+  FrameHandle world = store.add("world", FrameStore::NULL_HANDLE, translation(0, 0, 0));
+  FrameHandle body  = store.add("body",  world, translation(0, 0, 0));
+
+  bool ok1 = true, ok2 = true;
+  Thread reader1(FrameStoreReader(store, world, body, ok1));
+  Thread reader2(FrameStoreReader(store, world, body, ok2));
+  for (int i = 0; i < 2000; ++i)
+    store.set_transform_rel(body, translation(i, i, 0));
+  reader1.join();
+  reader2.join();
+  EXPECT_TRUE( ok1 );
+  EXPECT_TRUE( ok2 );
+  EXPECT_VECTOR_NEAR( Vector3(1999, 1999, 0), store.get_transform(world, body).translation(), 1e-12 );
+}
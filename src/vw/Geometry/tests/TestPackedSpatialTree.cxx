@@ -0,0 +1,133 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Geometry/PackedSpatialTree.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::geometry;
+
+namespace {
+  // Footprint-like boxes scattered over a 1000 x 1000 area.
+  std::vector<BBox2> random_boxes( size_t count ) {
+    boost::random::mt19937 gen( 3 );
+    boost::random::uniform_real_distribution<double> corner( 0, 1000 ), size( 1, 40 );
+    std::vector<BBox2> boxes( count );
+    for ( size_t i = 0; i < count; ++i )
+      boxes[i] = BBox2( corner(gen), corner(gen), size(gen), size(gen) );
+    return boxes;
+  }
+
+  class BoxPrimitive : public BBoxN, public GeomPrimitive {
+  public:
+    BoxPrimitive( BBox2 const& box ) : BBoxN( Vector<double>( box.min() ), Vector<double>( box.max() ) ) {}
+    virtual const BBoxN &bounding_box() const { return *this; }
+  };
+}
+
+TEST( PackedSpatialTree, Queries ) {
+  std::vector<BBox2> boxes = random_boxes( 3000 );
+  PackedSpatialTree<2> tree( 8 );
+  tree.build( boxes );
+  EXPECT_EQ( boxes.size(), tree.size() );
+
+  BBox2 all;
+  for ( size_t i = 0; i < boxes.size(); ++i )
+    all.grow( boxes[i] );
+  EXPECT_VECTOR_DOUBLE_EQ( all.min(), tree.bounding_box().min() );
+  EXPECT_VECTOR_DOUBLE_EQ( all.max(), tree.bounding_box().max() );
+
+  std::vector<size_t> result, expected;
+  std::vector<BBox2> queries = random_boxes( 50 );
+  for ( size_t q = 0; q < queries.size(); ++q ) {
+    queries[q] *= 3;
+    expected.clear();
+    for ( size_t i = 0; i < boxes.size(); ++i )
+      if ( boxes[i].intersects( queries[q] ) )
+        expected.push_back( i );
+    tree.intersects( queries[q], result );
+    std::sort( result.begin(), result.end() );
+    EXPECT_EQ( expected, result );
+
+    Vector2 point = queries[q].center();
+    expected.clear();
+    for ( size_t i = 0; i < boxes.size(); ++i )
+      if ( boxes[i].contains( point ) )
+        expected.push_back( i );
+    tree.contains( point, result );
+    std::sort( result.begin(), result.end() );
+    EXPECT_EQ( expected, result );
+  }
+}
+
+TEST( PackedSpatialTree, OverlapPairs ) {
+  std::vector<BBox2> boxes = random_boxes( 2000 );
+  PackedSpatialTree<2> tree;
+  tree.build( boxes );
+
+  std::vector<std::pair<size_t, size_t> > expected, pairs1, pairs4;
+  for ( size_t i = 0; i < boxes.size(); ++i )
+    for ( size_t j = i + 1; j < boxes.size(); ++j )
+      if ( boxes[i].intersects( boxes[j] ) )
+        expected.push_back( std::make_pair( i, j ) );
+
+  tree.overlap_pairs( pairs1, 1 );
+  tree.overlap_pairs( pairs4, 4 );
+  EXPECT_EQ( pairs1, pairs4 );
+  std::sort( pairs1.begin(), pairs1.end() );
+  EXPECT_EQ( expected, pairs1 );
+}
+
+TEST( PackedSpatialTree, Primitives ) {
+  std::vector<BBox2> boxes = random_boxes( 100 );
+  std::vector<BoxPrimitive> storage( boxes.begin(), boxes.end() );
+  std::vector<GeomPrimitive*> prims;
+  for ( size_t i = 0; i < storage.size(); ++i )
+    prims.push_back( &storage[i] );
+
+  PackedSpatialTree<2> tree;
+  tree.build( prims );
+  std::vector<size_t> result;
+  tree.intersects( boxes[17], result );
+  EXPECT_TRUE( std::find( result.begin(), result.end(), 17u ) != result.end() );
+
+  PackedSpatialTree<3> wrong;
+  EXPECT_THROW( wrong.build( prims ), ArgumentErr );
+}
+
+TEST( PackedSpatialTree, Empty ) {
+  PackedSpatialTree<2> tree;
+  tree.build( std::vector<BBox2>() );
+  std::vector<size_t> result( 1, 5 );
+  tree.intersects( BBox2( 0, 0, 10, 10 ), result );
+  EXPECT_TRUE( result.empty() );
+  std::vector<std::pair<size_t, size_t> > pairs;
+  tree.overlap_pairs( pairs );
+  EXPECT_TRUE( pairs.empty() );
+
+  // A single box makes a root that is also a leaf.
+  tree.build( std::vector<BBox2>( 1, BBox2( 0, 0, 1, 1 ) ) );
+  tree.contains( Vector2( 0.5, 0.5 ), result );
+  ASSERT_EQ( 1u, result.size() );
+  EXPECT_EQ( 0u, result[0] );
+}
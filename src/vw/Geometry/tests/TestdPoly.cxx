@@ -0,0 +1,137 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Geometry/dPoly.h>
+#include <vw/Geometry/cutPoly.h>
+
+#include <cmath>
+
+using namespace vw;
+using namespace vw::geometry;
+using namespace vw::test;
+
+namespace {
+  // Star shaped polygons and polylines scattered over [0, 1000]^2.
+  dPoly make_polys(int numPolys, int numVerts) {
+    dPoly poly;
+    std::vector<double> xv(numVerts), yv(numVerts);
+    for (int p = 0; p < numPolys; p++) {
+      double cx = (p * 37) % 1000, cy = (p * 91) % 1000;
+      for (int v = 0; v < numVerts; v++) {
+        double angle = 2*M_PI*v/numVerts, radius = 10 + 5*((v + p) % 3);
+        xv[v] = cx + radius*cos(angle);
+        yv[v] = cy + radius*sin(angle);
+      }
+      poly.appendPolygon(numVerts, &xv[0], &yv[0], p % 4 != 0, p % 2 ? "red" : "green", "");
+    }
+    return poly;
+  }
+
+  void expect_same(dPoly const& a, dPoly const& b) {
+    ASSERT_EQ(a.get_numPolys(), b.get_numPolys());
+    ASSERT_EQ(a.get_totalNumVerts(), b.get_totalNumVerts());
+    for (int p = 0; p < a.get_numPolys(); p++)
+      EXPECT_EQ(a.get_numVerts()[p], b.get_numVerts()[p]);
+    for (int v = 0; v < a.get_totalNumVerts(); v++) {
+      EXPECT_NEAR(a.get_xv()[v], b.get_xv()[v], 1e-9);
+      EXPECT_NEAR(a.get_yv()[v], b.get_yv()[v], 1e-9);
+    }
+    EXPECT_EQ(a.get_isPolyClosed(), b.get_isPolyClosed());
+    EXPECT_EQ(a.get_colors(), b.get_colors());
+  }
+}
+
+TEST(dPoly, ClipPoly) {
+  dPoly poly = make_polys(12000, 24); // Enough vertices to be split into runs
+  const double xll = 200, yll = 150, xur = 700, yur = 820;
+
+  // Clip every polygon on its own with cutPoly.
+  dPoly expected;
+  std::vector<double> cutX, cutY;
+  std::vector<int> cutNumVerts;
+  int start = 0;
+  for (int p = 0; p < poly.get_numPolys(); p++) {
+    int numV = poly.get_numVerts()[p];
+    cutX.clear(); cutY.clear(); cutNumVerts.clear();
+    if (poly.get_isPolyClosed()[p])
+      cutPoly(1, &numV, poly.get_xv() + start, poly.get_yv() + start,
+              xll, yll, xur, yur, cutX, cutY, cutNumVerts);
+    else
+      cutPolyLine(numV, poly.get_xv() + start, poly.get_yv() + start,
+                  xll, yll, xur, yur, cutX, cutY, cutNumVerts);
+    for (size_t c = 0, cstart = 0; c < cutNumVerts.size(); cstart += cutNumVerts[c], c++)
+      expected.appendPolygon(cutNumVerts[c], &cutX[cstart], &cutY[cstart],
+                             poly.get_isPolyClosed()[p], poly.get_colors()[p], "");
+    start += numV;
+  }
+
+  dPoly clipped1, clipped4;
+  poly.clipPoly(xll, yll, xur, yur, clipped1, 1);
+  poly.clipPoly(xll, yll, xur, yur, clipped4, 4);
+  EXPECT_GT(clipped1.get_numPolys(), 0);
+  expect_same(expected, clipped1);
+  expect_same(expected, clipped4);
+}
+
+TEST(dPoly, ReadWriteStreaming) {
+  dPoly poly = make_polys(50, 7);
+
+  UnlinkName cnt("polys.cnt");
+  ASSERT_TRUE(poly.write_pol_or_cnt_format(cnt, "cnt"));
+  dPoly cnt_poly;
+  EXPECT_TRUE(cnt_poly.read_pol_or_cnt_format(cnt, "cnt"));
+  expect_same(poly, cnt_poly);
+
+  // pol files hold only closed polygons, and no colors.
+  UnlinkName pol("polys.pol");
+  ASSERT_TRUE(poly.write_pol_or_cnt_format(pol, "pol"));
+  dPolyReader reader(pol, "pol");
+  ASSERT_TRUE(reader.isOpen());
+  std::vector<double> xv, yv;
+  bool isPolyClosed;
+  std::string color;
+  int count = 0;
+  while (reader.readNext(xv, yv, isPolyClosed, color)) {
+    ASSERT_EQ(7u, xv.size());
+    EXPECT_TRUE(isPolyClosed);
+    EXPECT_NEAR(poly.get_xv()[7*count + 3], xv[3], 1e-9);
+    count++;
+  }
+  EXPECT_FALSE(reader.hasError());
+  EXPECT_EQ(50, count);
+
+  dPolyReader missing("does_not_exist.cnt", "cnt");
+  EXPECT_FALSE(missing.isOpen());
+  EXPECT_FALSE(missing.readNext(xv, yv, isPolyClosed, color));
+}
+
+TEST(dPoly, ClipPolyFile) {
+  dPoly poly = make_polys(300, 16);
+  UnlinkName in("clip_in.cnt"), out("clip_out.cnt");
+  ASSERT_TRUE(poly.write_pol_or_cnt_format(in, "cnt"));
+
+  // Small batches, so that the file is clipped in several pieces.
+  ASSERT_TRUE(clipPolyFile(in, out, "cnt", 100, 100, 600, 500, 500, 2));
+  dPoly expected, clipped;
+  poly.clipPoly(100, 100, 600, 500, expected);
+  ASSERT_TRUE(clipped.read_pol_or_cnt_format(out, "cnt"));
+  expect_same(expected, clipped);
+}
@@ -108,6 +108,25 @@ namespace hdr {
     return subvector(x,0,n);
   }
 
+  void CameraCurveFn::build_code_tables() {
+    boost::shared_ptr<CodeTables> uint8_tables ( new CodeTables(m_lookup_tables.size()) );
+    boost::shared_ptr<CodeTables> uint16_tables( new CodeTables(m_lookup_tables.size()) );
+    for (size_t c = 0; c < m_lookup_tables.size(); ++c) {
+      if (m_lookup_tables[c].size() == 0)
+        continue;
+      std::vector<double>& table8 = (*uint8_tables)[c];
+      table8.resize(size_t(ChannelRange<uint8>::max()) + 1);
+      for (size_t code = 0; code < table8.size(); ++code)
+        table8[code] = this->operator()(double(code) / double(ChannelRange<uint8>::max()), c);
+      std::vector<double>& table16 = (*uint16_tables)[c];
+      table16.resize(size_t(ChannelRange<uint16>::max()) + 1);
+      for (size_t code = 0; code < table16.size(); ++code)
+        table16[code] = this->operator()(double(code) / double(ChannelRange<uint16>::max()), c);
+    }
+    m_uint8_tables  = uint8_tables;
+    m_uint16_tables = uint16_tables;
+  }
+
   void write_curves(std::string const& curves_file,
                     CameraCurveFn const &curves) {
 
@@ -30,6 +30,9 @@
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
 
+#include <vector>
+#include <boost/shared_ptr.hpp>
+
 // Number of LDR intensity pairs to sample
 const int VW_HDR_DEFAULT_NUM_PIXEL_SAMPLES = 300;
 
@@ -206,9 +209,27 @@ namespace hdr {
     // value.
     std::vector<Vector<double> > m_lookup_tables;
 
+    // The luminance of every code value of an 8 or 16 bit channel, for
+    // each channel.  Copies of the function share them.
+    typedef std::vector<std::vector<double> > CodeTables;
+    boost::shared_ptr<const CodeTables> m_uint8_tables, m_uint16_tables;
+
+    // Fills in the code value tables from the lookup tables.
+    void build_code_tables();
+
+    // Integer channels hold code values, which are scaled to [0.0 1.0]
+    // by their channel range.  8 and 16 bit codes are looked up in the
+    // code value tables; others are evaluated directly.
+    double channel_luminance(uint8  code, size_t channel) const { return (*m_uint8_tables )[channel][code]; }
+    double channel_luminance(uint16 code, size_t channel) const { return (*m_uint16_tables)[channel][code]; }
+    template <class ChannelT>
+    double channel_luminance(ChannelT value, size_t channel) const {
+      return this->operator()(double(value) / double(ChannelRange<ChannelT>::max()), channel);
+    }
+
   public:
     CameraCurveFn(std::vector<Vector<double> > const& lookup_tables) :
-      m_lookup_tables(lookup_tables) {}
+      m_lookup_tables(lookup_tables) { build_code_tables(); }
 
     CameraCurveFn() {}
 
@@ -229,6 +250,10 @@ namespace hdr {
       return exp(val1 + (val2-val1) * frac);
     }
 
+    /// Returns the luminance of each channel of a pixel.  Floating
+    /// point channels are expected in the range [0.0 1.0], and integer
+    /// channels over their full range.  8 and 16 bit channels are
+    /// converted with a precomputed table of every code value.
     template <class PixelT>
     typename CompoundChannelCast<PixelT, double>::type operator() (PixelT pixel_val) const {
       typedef typename CompoundChannelCast<PixelT, double>::type pixel_type;
@@ -238,7 +263,7 @@ namespace hdr {
 
       pixel_type result;
       for (size_t c = 0; c < CompoundNumChannels<PixelT>::value; ++c) {
-        result[c] = this->operator()(double(pixel_val[c]), c);
+        result[c] = this->channel_luminance(pixel_val[c], c);
       }
       return result;
     }
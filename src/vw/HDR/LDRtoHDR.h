@@ -36,6 +36,8 @@
 #define __VW_HDR_LDRTOHDR_H__
 
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/HDR/CameraCurve.h>
 
 #include <vector>
@@ -60,6 +62,13 @@ namespace hdr {
     CameraCurveFn m_curves;
     std::vector<double> m_brightness_vals;
 
+    // The gray level of an LDR pixel, scaled to [0.0 1.0] if its
+    // channels are integers.
+    static PixelGray<double> gray_level( SrcPixelT const& pix ) {
+      typedef typename PixelChannelType<SrcPixelT>::type channel_type;
+      return PixelGray<double>(pix) / double(ChannelRange<channel_type>::max());
+    }
+
   public:
 
     HighDynamicRangeView( std::vector<ImageViewRef<SrcPixelT> > const& views,
@@ -92,7 +101,7 @@ namespace hdr {
         //        double weight = 2.0 * (-abs(0.5 - gray) + 0.5);
         //
         // Gaussian Weighting:
-        PixelGray<double> gray(m_views[c](i,j,p));  // Convert to grayscale
+        PixelGray<double> gray = gray_level(m_views[c](i,j,p));  // Convert to grayscale
         double weight = exp(-pow((gray-0.5),2)/(0.07));
 
         // The camera response function returns a relative luminance
@@ -144,15 +153,34 @@ namespace hdr {
     }
 
     /// \cond INTERNAL
-    typedef HighDynamicRangeView<SrcPixelT> prerasterize_type;
+    // Each LDR tile is read once, and the images are merged a whole tile
+    // at a time.  The weights and sums are accumulated in the same order
+    // as operator() uses, so the result is the same.
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> hdr_tile(bbox.width(), bbox.height());
+      ImageView<double> weight_sum(bbox.width(), bbox.height());
+      fill(hdr_tile, pixel_type());
+      fill(weight_sum, 0.0);
+
+      for ( unsigned c = 0; c < m_views.size(); ++c ) {
+        ImageView<SrcPixelT> src_tile = crop(m_views[c], bbox);
+        for ( int32 j = 0; j < bbox.height(); ++j ) {
+          for ( int32 i = 0; i < bbox.width(); ++i ) {
+            SrcPixelT const& src = src_tile(i,j);
+            PixelGray<double> gray = gray_level(src);
+            double weight = exp(-pow((gray-0.5),2)/(0.07));
+            hdr_tile(i,j) += weight * m_brightness_vals[c] * m_curves(src);
+            weight_sum(i,j) += weight;
+          }
+        }
+      }
 
-      // Rasterize each of the individual LDR images if necessary.
-      std::vector<ImageViewRef<SrcPixelT> > m_prerast_views(m_views.size());
-      for (unsigned i = 0; i < m_views.size(); ++i)
-        m_prerast_views[i] = m_views[i].prerasterize(bbox);
+      for ( int32 j = 0; j < bbox.height(); ++j )
+        for ( int32 i = 0; i < bbox.width(); ++i )
+          hdr_tile(i,j) = hdr_tile(i,j) / weight_sum(i,j);
 
-      return prerasterize_type( m_prerast_views, m_curves, m_brightness_vals );
+      return prerasterize_type( hdr_tile, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
     /// \endcond
@@ -22,7 +22,10 @@
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/Filter.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/BlockImageOperator.h>
 #include <vw/Core/Functors.h>
+#include <vw/Core/Thread.h>
 
 #include <vector>
 #include <iostream>
@@ -35,26 +38,26 @@ using namespace vw::hdr;
 // ********************************************************************
 const unsigned ASH_MAX_KERNEL = 10;
 
-ImageView<double> ashikhmin_world_adaptation_luminance(ImageView<double> L_w, double threshold) {
+// The widest blur reaches this far from each pixel.
+const int32 ASH_MARGIN = ASH_MAX_KERNEL;
+
+ImageView<double> ashikhmin_world_adaptation_luminance(ImageView<double> const& L_w, double threshold) {
   typedef ImageView<double> Map;
 
+  // Each blur is computed once and used both to pick the scale and as
+  // the output at that scale.
   std::vector<Map> L_w_blur(ASH_MAX_KERNEL * 2);
   std::vector<Map> V(ASH_MAX_KERNEL);
 
-  vw_out() << "Computing L_w_blur\n";
   for ( unsigned s = 1; s <= ASH_MAX_KERNEL * 2; ++s ) {
-    if ((s < ASH_MAX_KERNEL) || (s % 2 == 0)) {
-      vw_out() << "L_w_blur[" << (s) << "]\n";
+    if ((s < ASH_MAX_KERNEL) || (s % 2 == 0))
       L_w_blur[s-1] = gaussian_filter(L_w, 1.0, 1.0, s, s);
-    }
   }
 
-  vw_out() << "Computing Vs\n";
   for ( unsigned s = 1; s <= ASH_MAX_KERNEL; ++s ) {
     V[s-1] = abs((L_w_blur[s-1] - L_w_blur[2*s - 1]) / (L_w_blur[s-1] + 0.0001));
   }
 
-  vw_out() << "Computing L_wa\n";
   Map L_wa(L_w.cols(), L_w.rows());
   for ( int32 x = 0; x < L_wa.cols(); ++x ) {
     for ( int32 y = 0; y < L_wa.rows(); ++y ) {
@@ -77,8 +80,6 @@ public:
   AshikhminCompressiveFunctor(double L_wmin, double L_wmax, double L_dmax = 1.0) {
     C_L_wmin = C(L_wmin);
     k = L_dmax / (C(L_wmax) - C_L_wmin);
-    vw_out() << "C(L_wmin) = " << C_L_wmin << "\n";
-    vw_out() << "k = " << k << "\n";
   }
 
   double C(double L) const {
@@ -93,28 +94,75 @@ public:
   }
 };
 
-ImageView<PixelRGB<double> > vw::hdr::ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image, double threshold) {
-  ImageView<PixelGray<double> > gray = pixel_cast<PixelGray<double> >(hdr_image);
+namespace {
+  // Gathers the luminance range of an image for block_op.
+  class LuminanceRangeFunctor {
+    Mutex  m_mutex;
+    bool   m_any;
+    double m_min, m_max;
+  public:
+    LuminanceRangeFunctor() : m_any(false), m_min(0), m_max(0) {}
+
+    template <class PixelT>
+    void operator()( ImageView<PixelT> const& tile, BBox2i const& /*bbox*/ ) {
+      double tile_min = 0, tile_max = 0;
+      min_max_channel_values(pixel_cast<PixelGray<double> >(tile), tile_min, tile_max);
+      Mutex::Lock lock(m_mutex);
+      if (!m_any || tile_min < m_min) m_min = tile_min;
+      if (!m_any || tile_max > m_max) m_max = tile_max;
+      m_any = true;
+    }
+
+    double min() const { return m_min; }
+    double max() const { return m_max; }
+  };
+}
+
+void vw::hdr::luminance_range(ImageViewRef<PixelRGB<double> > const& hdr_image,
+                              double& L_wmin, double& L_wmax,
+                              int tile_size, int num_threads) {
+  LuminanceRangeFunctor functor;
+  block_op(hdr_image, functor, Vector2i(tile_size, tile_size), num_threads);
+  L_wmin = functor.min();
+  L_wmax = functor.max();
+}
+
+void vw::hdr::ashikhmin_tone_map_block(ImageViewRef<PixelRGB<double> > const& hdr_image,
+                                       BBox2i const& bbox, double threshold,
+                                       double L_wmin, double L_wmax,
+                                       ImageView<PixelRGB<double> >& out) {
+  // Read the tile with a margin wide enough for the largest blur.  The
+  // blurs extend the image's edge pixels, so the margin does too, and
+  // the result inside bbox is the same as for the whole image.
+  BBox2i expanded = bbox;
+  expanded.expand(ASH_MARGIN);
+  ImageView<PixelRGB<double> > color = crop(edge_extend(hdr_image, ConstantEdgeExtension()), expanded);
+  ImageView<PixelGray<double> > gray = pixel_cast<PixelGray<double> >(color);
   ImageView<double> L_w = channels_to_planes(gray);
-  //  write_image("lw.jpg", L_w);
-  ImageView<PixelRGB<double> > out_image = copy(hdr_image) / L_w;
 
   // Compute world adaptation luminance
   ImageView<double> L_wa = ashikhmin_world_adaptation_luminance(L_w, threshold);
-  //  write_image("lwa.jpg", L_wa);
 
+  // Compute display luminances, and recombine them into a color image
+  AshikhminCompressiveFunctor F(L_wmin, L_wmax);
+  out.set_size(bbox.width(), bbox.height());
+  for ( int32 y = 0; y < bbox.height(); ++y ) {
+    for ( int32 x = 0; x < bbox.width(); ++x ) {
+      double lw  = L_w (x + ASH_MARGIN, y + ASH_MARGIN);
+      double lwa = L_wa(x + ASH_MARGIN, y + ASH_MARGIN);
+      double L_d = F(lwa) * lw / lwa;
+      out(x,y) = (color(x + ASH_MARGIN, y + ASH_MARGIN) / lw) * L_d;
+    }
+  }
+}
+
+ImageView<PixelRGB<double> > vw::hdr::ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image, double threshold) {
   // Compute display luminances
-  vw_out() << "Computing L_wmin and L_wmax\n";
   double L_wmin, L_wmax;
-  min_max_channel_values(L_w, L_wmin, L_wmax);
-  vw_out() << "Computing F(L_wa)\n";
-  AshikhminCompressiveFunctor F(L_wmin, L_wmax);
-  ImageView<double> F_L_wa = per_pixel_filter(L_wa, F);
-  //  write_image("flwa.jpg", F_L_wa);
-  vw_out() << "Computing display luminances\n";
-  ImageView<double> L_d = F_L_wa * L_w / L_wa;
-  //  write_image("ld.jpg", L_d);
-
-  // Recombine luminance values into color image
-  return normalize(out_image * L_d);
+  luminance_range(hdr_image, L_wmin, L_wmax);
+
+  // Tone map the whole image as one block
+  ImageView<PixelRGB<double> > out_image;
+  ashikhmin_tone_map_block(hdr_image, bounding_box(hdr_image), threshold, L_wmin, L_wmax, out_image);
+  return normalize(out_image);
 }
@@ -28,6 +28,9 @@
 #define __VW_HDR_LOCALTONEMAP_H__
 
 #include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/Manipulation.h>
 
 namespace vw {
 namespace hdr {
@@ -35,6 +38,72 @@ namespace hdr {
   ImageView<PixelRGB<double> > ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image,
                                                   double threshold = 0.5);
 
+  /// Finds the smallest and largest luminance in an HDR image, reading
+  /// it in tiles of tile_size pixels on num_threads threads (0 for the
+  /// default).
+  void luminance_range(ImageViewRef<PixelRGB<double> > const& hdr_image,
+                       double& L_wmin, double& L_wmax,
+                       int tile_size = 256, int num_threads = 0);
+
+  /// Applies the Ashikhmin operator to the pixels of hdr_image in bbox,
+  /// before the final normalization.  L_wmin and L_wmax are the
+  /// luminance range of the whole image.
+  /// - The blurred luminance at each of the operator's scales is
+  ///   computed once for the tile and a margin around it, and shared
+  ///   by the scale selection and the output.  The result matches
+  ///   ashikhmin_tone_map() on the whole image.
+  void ashikhmin_tone_map_block(ImageViewRef<PixelRGB<double> > const& hdr_image,
+                                BBox2i const& bbox, double threshold,
+                                double L_wmin, double L_wmax,
+                                ImageView<PixelRGB<double> >& out);
+
+  /// A view of the Ashikhmin tone mapping of an image, computed a tile
+  /// at a time so that large images can be written in parallel blocks.
+  /// The output is not normalized, but is close to the [0,1] range.
+  class AshikhminToneMapView : public ImageViewBase<AshikhminToneMapView> {
+    ImageViewRef<PixelRGB<double> > m_image;
+    double m_threshold, m_L_wmin, m_L_wmax;
+  public:
+    typedef PixelRGB<double> pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<AshikhminToneMapView> pixel_accessor;
+
+    AshikhminToneMapView(ImageViewRef<PixelRGB<double> > const& image, double threshold,
+                         double L_wmin, double L_wmax)
+      : m_image(image), m_threshold(threshold), m_L_wmin(L_wmin), m_L_wmax(L_wmax) {}
+
+    inline int32 cols  () const { return m_image.cols(); }
+    inline int32 rows  () const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+    inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+      ImageView<pixel_type> out;
+      ashikhmin_tone_map_block(m_image, BBox2i(i, j, 1, 1), m_threshold, m_L_wmin, m_L_wmax, out);
+      return out(0,0);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> out;
+      ashikhmin_tone_map_block(m_image, bbox, m_threshold, m_L_wmin, m_L_wmax, out);
+      return prerasterize_type(out, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  /// Returns a view of the Ashikhmin tone mapping of hdr_image.  This
+  /// reads the image once to find its luminance range.
+  inline AshikhminToneMapView ashikhmin_tone_map_view(ImageViewRef<PixelRGB<double> > const& hdr_image,
+                                                      double threshold = 0.5, int num_threads = 0) {
+    double L_wmin, L_wmax;
+    luminance_range(hdr_image, L_wmin, L_wmax, 256, num_threads);
+    return AshikhminToneMapView(hdr_image, threshold, L_wmin, L_wmax);
+  }
+
 }} // namespace vw::HDR
 
 #endif  // __VW_HDR_LOCALTONEMAP_H__
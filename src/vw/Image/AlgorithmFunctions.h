@@ -23,6 +23,8 @@
 #ifndef __VW_IMAGE_ALGORITHM_FUNCTIONS_H__
 #define __VW_IMAGE_ALGORITHM_FUNCTIONS_H__
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/MaskViews.h>
 
@@ -62,6 +64,34 @@ namespace vw {
     return result;
   }
 
+  // *******************************************************************
+  // euclidean_distance_transform()
+  // *******************************************************************
+
+  /// Computes the exact Euclidean distance from each pixel to the
+  /// nearest pixel with zero value, assuming the borders of the image
+  /// are zero, like a Euclidean grassfire.
+  /// - If ignore_borders is set, borders are not treated as zero value,
+  ///   and an image with no zeros gets cols + rows everywhere.
+  /// - Uses the separable algorithm of Felzenszwalb and Huttenlocher:
+  ///   a pass down the columns, then a lower envelope of parabolas
+  ///   along each row.  Both passes run on num_threads threads (0 for
+  ///   the default).
+  /// - The whole image is held in memory; see distance_transform_view()
+  ///   for images larger than memory.
+  template <class SourceT, class OutputT>
+  void euclidean_distance_transform( ImageViewBase<SourceT> const& src, ImageView<OutputT>& dst,
+                                     bool ignore_borders=false, int num_threads=0 );
+
+  // Without destination given, return in a newly-created ImageView<float>
+  template <class SourceT>
+  ImageView<float> euclidean_distance_transform( ImageViewBase<SourceT> const& src,
+                                                 bool ignore_borders=false, int num_threads=0 ) {
+    ImageView<float> result;
+    euclidean_distance_transform( src, result, ignore_borders, num_threads );
+    return result;
+  }
+
   // *******************************************************************
   // centerline_weights()
   // *******************************************************************
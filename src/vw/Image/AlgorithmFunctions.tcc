@@ -203,6 +203,145 @@ namespace vw {
   }
 
 
+  // *******************************************************************
+  // euclidean_distance_transform()
+  // *******************************************************************
+
+  namespace detail {
+
+    // Distance down each column of [begin, end) to the nearest zero
+    // pixel in that column.  Rows are walked in order so the strip is
+    // read and written a row at a time.
+    template <class SourceT>
+    class DistanceColumnTask : public Task {
+      SourceT const&     m_src;
+      ImageView<float>&  m_dist;
+      int32              m_begin, m_end;
+      bool               m_ignore_borders;
+    public:
+      DistanceColumnTask( SourceT const& src, ImageView<float>& dist,
+                          int32 begin, int32 end, bool ignore_borders )
+        : m_src(src), m_dist(dist), m_begin(begin), m_end(end), m_ignore_borders(ignore_borders) {}
+
+      virtual void operator()() {
+        const int32 rows = m_dist.rows();
+        const typename SourceT::pixel_type zero = typename SourceT::pixel_type();
+        // Distances at least this large mean there is no zero in the column.
+        const float far = float( m_dist.cols() + rows );
+        const float edge = m_ignore_borders ? far : 1.0f;
+        for ( int32 r = 0; r < rows; ++r )
+          for ( int32 c = m_begin; c < m_end; ++c ) {
+            if ( m_src(c,r) == zero )
+              m_dist(c,r) = 0;
+            else
+              m_dist(c,r) = ( r == 0 ) ? edge : std::min( far, m_dist(c,r-1) + 1 );
+          }
+        for ( int32 c = m_begin; c < m_end; ++c )
+          m_dist(c,rows-1) = std::min( m_dist(c,rows-1), edge );
+        for ( int32 r = rows-2; r >= 0; --r )
+          for ( int32 c = m_begin; c < m_end; ++c )
+            m_dist(c,r) = std::min( m_dist(c,r), m_dist(c,r+1) + 1 );
+      }
+    };
+
+    // The lower envelope of the parabolas (x - q)^2 + column_dist(q)^2
+    // along each row of [begin, end).
+    template <class OutputT>
+    class DistanceRowTask : public Task {
+      ImageView<float> const& m_dist;
+      ImageView<OutputT>&     m_dst;
+      int32                   m_begin, m_end;
+      bool                    m_ignore_borders;
+    public:
+      DistanceRowTask( ImageView<float> const& dist, ImageView<OutputT>& dst,
+                       int32 begin, int32 end, bool ignore_borders )
+        : m_dist(dist), m_dst(dst), m_begin(begin), m_end(end), m_ignore_borders(ignore_borders) {}
+
+      virtual void operator()() {
+        const int32 cols = m_dist.cols();
+        std::vector<double> f( cols ), z( cols + 1 );
+        std::vector<int32>  v( cols );
+        for ( int32 r = m_begin; r < m_end; ++r ) {
+          for ( int32 q = 0; q < cols; ++q )
+            f[q] = double( m_dist(q,r) ) * double( m_dist(q,r) );
+
+          int32 k = 0;
+          v[0] = 0;
+          z[0] = -std::numeric_limits<double>::max();
+          z[1] =  std::numeric_limits<double>::max();
+          for ( int32 q = 1; q < cols; ++q ) {
+            // Where the parabola of q meets the lowest one so far.  The
+            // loop stops at k = 0 at the latest, since z[0] is -inf.
+            double s;
+            while ( true ) {
+              const int32 p = v[k];
+              s = ( ( f[q] + double(q)*q ) - ( f[p] + double(p)*p ) ) / ( 2.0*( q - p ) );
+              if ( s > z[k] )
+                break;
+              --k;
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k+1] = std::numeric_limits<double>::max();
+          }
+
+          k = 0;
+          for ( int32 q = 0; q < cols; ++q ) {
+            while ( z[k+1] < q )
+              ++k;
+            double d = double( q - v[k] ) * double( q - v[k] ) + f[v[k]];
+            if ( !m_ignore_borders ) {
+              const double edge = std::min( q + 1, cols - q );
+              d = std::min( d, edge * edge );
+            }
+            m_dst(q,r) = OutputT( std::sqrt( d ) );
+          }
+        }
+      }
+    };
+
+  } // namespace detail
+
+  template <class SourceT, class OutputT>
+  void euclidean_distance_transform( ImageViewBase<SourceT> const& src, ImageView<OutputT>& dst,
+                                     bool ignore_borders, int num_threads ) {
+    const int32 cols = src.impl().cols(), rows = src.impl().rows();
+    dst.set_size( cols, rows );
+    if ( cols == 0 || rows == 0 )
+      return;
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+
+    // Runs of columns, then of rows, large enough to amortize a task.
+    ImageView<float> dist( cols, rows );
+    typedef detail::DistanceColumnTask<SourceT> column_task;
+    typedef detail::DistanceRowTask<OutputT>    row_task;
+    const int32 column_runs = std::min( 4*num_threads, ( cols + 63 ) / 64 );
+    const int32 row_runs    = std::min( 4*num_threads, ( rows + 15 ) / 16 );
+    if ( num_threads == 1 ) {
+      column_task( src.impl(), dist, 0, cols, ignore_borders )();
+      row_task( dist, dst, 0, rows, ignore_borders )();
+      return;
+    }
+    {
+      FifoWorkQueue queue( num_threads );
+      for ( int32 i = 0; i < column_runs; ++i )
+        queue.add_task( boost::shared_ptr<Task>(
+          new column_task( src.impl(), dist, int32( int64(i)*cols/column_runs ),
+                           int32( int64(i+1)*cols/column_runs ), ignore_borders ) ) );
+      queue.join_all();
+    }
+    {
+      FifoWorkQueue queue( num_threads );
+      for ( int32 i = 0; i < row_runs; ++i )
+        queue.add_task( boost::shared_ptr<Task>(
+          new row_task( dist, dst, int32( int64(i)*rows/row_runs ),
+                        int32( int64(i+1)*rows/row_runs ), ignore_borders ) ) );
+      queue.join_all();
+    }
+  }
+
   // *******************************************************************
   // centerline_weights()
   // *******************************************************************
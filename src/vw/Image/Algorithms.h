@@ -339,6 +339,22 @@ namespace vw {
   }
 
 
+  /// Euclidean distance to the nearest zero pixel, computed a tile at
+  /// a time so that images larger than memory can be processed.
+  /// - Each tile is expanded by max_distance, so distances up to
+  ///   max_distance are exact and larger ones are clamped to it.
+  /// - Borders are treated as zero unless ignore_borders is set, as in
+  ///   euclidean_distance_transform().
+  template <class ImageT>
+  class DistanceTransformView;
+
+  template <class ImageT>
+  DistanceTransformView<ImageT>
+  distance_transform_view(ImageViewBase<ImageT> const& image, int max_distance,
+                          bool ignore_borders = false) {
+    return DistanceTransformView<ImageT>(image.impl(), max_distance, ignore_borders);
+  }
+
 } // namespace vw
 
 #include "Algorithms.tcc"
@@ -786,4 +786,64 @@ public:
 
 
 
+template <class ImageT>
+class DistanceTransformView: public ImageViewBase<DistanceTransformView<ImageT> >{
+
+  ImageT m_image;
+  int    m_max_distance;
+  bool   m_ignore_borders;
+public:
+  DistanceTransformView(ImageT const& image, int max_distance, bool ignore_borders):
+    m_image(image), m_max_distance(max_distance), m_ignore_borders(ignore_borders) {
+    VW_ASSERT(max_distance > 0, ArgumentErr() << "DistanceTransformView: max_distance must be positive.");
+  }
+
+  // Image View interface
+  typedef float      pixel_type;
+  typedef pixel_type result_type;
+  typedef ProceduralPixelAccessor<DistanceTransformView> pixel_accessor;
+
+  inline int32 cols  () const { return m_image.cols(); }
+  inline int32 rows  () const { return m_image.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+  inline pixel_type operator()( double i, double j, int32 p = 0 ) const {
+    vw_throw(NoImplErr() << "DistanceTransformView::operator()(...) is not implemented");
+    return pixel_type();
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+
+    // Any zero within max_distance of the tile is inside the expanded
+    // tile.  The image borders are applied afterwards, in image
+    // coordinates, since the expanded tile may not reach them.
+    BBox2i big_bbox = bbox;
+    big_bbox.expand(m_max_distance);
+    big_bbox.crop(bounding_box(m_image));
+    ImageView<typename ImageT::pixel_type> input_tile = crop(m_image, big_bbox);
+    ImageView<pixel_type> big_tile;
+    euclidean_distance_transform(input_tile, big_tile, true, 1);
+
+    ImageView<pixel_type> output_tile(bbox.width(), bbox.height());
+    for (int32 r = 0; r < bbox.height(); ++r) {
+      for (int32 c = 0; c < bbox.width(); ++c) {
+        const int32 x = bbox.min().x() + c, y = bbox.min().y() + r;
+        float d = big_tile(x - big_bbox.min().x(), y - big_bbox.min().y());
+        if (!m_ignore_borders)
+          d = std::min(d, float(std::min(std::min(x + 1, cols() - x), std::min(y + 1, rows() - y))));
+        output_tile(c,r) = std::min(d, float(m_max_distance));
+      }
+    }
+    return prerasterize_type(output_tile, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+  }
+
+  template <class DestT>
+  inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+    vw::rasterize(prerasterize(bbox), dest, bbox);
+  }
+}; // End class DistanceTransformView
+
 } // namespace vw
@@ -0,0 +1,115 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2009-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NGT platform is licensed under the Apache License, Version 2.0 (the
+//  "License"); you may not use this file except in compliance with the
+//  License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Image/AntiAliasing.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace vw {
+
+  namespace {
+
+    // The source pixels an output centered on c reads are those within
+    // half_width of c, exclusive.
+    double half_width( ResampleFilter filter, double stretch ) {
+      switch ( filter ) {
+      case AreaResampleFilter:    return 0.5 * stretch + 0.5;
+      case CubicResampleFilter:   return 2.0 * stretch;
+      case LanczosResampleFilter: return 3.0 * stretch;
+      }
+      vw_throw( ArgumentErr() << "PolyphaseFilterBank: Unknown filter " << int(filter) << "." );
+      return 0;
+    }
+
+    double sinc( double x ) {
+      if ( x == 0 )
+        return 1;
+      x *= M_PI;
+      return std::sin( x ) / x;
+    }
+
+    // The weight of the source pixel d from the output's center.
+    double filter_weight( ResampleFilter filter, double stretch, double d ) {
+      switch ( filter ) {
+      case AreaResampleFilter: {
+        const double lo = std::max( d - 0.5, -0.5 * stretch ),
+                     hi = std::min( d + 0.5,  0.5 * stretch );
+        return std::max( hi - lo, 0.0 );
+      }
+      case CubicResampleFilter: {
+        const double x = std::fabs( d / stretch );
+        if ( x < 1 ) return ( 1.5 * x - 2.5 ) * x * x + 1;
+        if ( x < 2 ) return ( ( -0.5 * x + 2.5 ) * x - 4 ) * x + 2;
+        return 0;
+      }
+      case LanczosResampleFilter: {
+        const double x = d / stretch;
+        return std::fabs( x ) < 3 ? sinc( x ) * sinc( x / 3 ) : 0;
+      }
+      }
+      return 0;
+    }
+  }
+
+  PolyphaseFilterBank::PolyphaseFilterBank( ResampleFilter filter, double scale, int32 begin, int32 end )
+    : m_taps(1) {
+    VW_ASSERT( scale > 0, ArgumentErr() << "PolyphaseFilterBank: The scale must be positive." );
+    VW_ASSERT( end >= begin, ArgumentErr() << "PolyphaseFilterBank: The range is reversed." );
+
+    // Reducing stretches the filter over the source to low-pass it.
+    const double stretch = std::max( 1.0, 1.0 / scale );
+    const double half = half_width( filter, stretch );
+    m_taps = std::max( 1, int32( std::ceil( 2 * half ) ) );
+
+    // Outputs whose centers fall at the same offset from their first
+    // source pixel share weights. The offsets repeat with the period
+    // of the scale's numerator, so the bank stays small.
+    std::map<int64, int32> phases;
+    m_first.resize( end - begin );
+    m_phase.resize( end - begin );
+    for ( int32 i = begin; i < end; i++ ) {
+      const double center = ( i + 0.5 ) / scale - 0.5;
+      const int32 first = int32( std::floor( center - half ) ) + 1;
+      const double offset = center - first;
+      const int64 key = int64( std::floor( offset * ( 1 << 20 ) + 0.5 ) );
+      m_first[i - begin] = first;
+
+      std::map<int64, int32>::const_iterator it = phases.find( key );
+      if ( it != phases.end() ) {
+        m_phase[i - begin] = it->second;
+        continue;
+      }
+      const int32 phase = int32( m_weights.size() / m_taps );
+      phases[key] = phase;
+      m_phase[i - begin] = phase;
+
+      std::vector<double> w( m_taps );
+      double sum = 0;
+      for ( int32 t = 0; t < m_taps; t++ ) {
+        w[t] = filter_weight( filter, stretch, t - offset );
+        sum += w[t];
+      }
+      for ( int32 t = 0; t < m_taps; t++ )
+        m_weights.push_back( sum != 0 ? float( w[t] / sum ) : 0.0f );
+    }
+  }
+
+} // namespace vw
@@ -22,8 +22,13 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Transform.h>
 #include <vw/Image/PerPixelAccessorViews.h>
+#include <vw/Image/Convolution.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/PixelMask.h>
 #include <boost/foreach.hpp>
 
+#include <vector>
+
 namespace vw {
 
   // Cache Tile Aware Raster View.
@@ -305,6 +310,257 @@ namespace vw {
                         int32(.5+(input.impl().rows()*factor)) );
   }
 
+  // Polyphase resampling. Each axis is resampled with a bank of
+  // precomputed filter weights, one set per phase, that is per distinct
+  // fractional position of an output pixel's center on the source
+  // grid. A reduction by a rational ratio p/q has at most p phases.
+  // When reducing, the filters are stretched by the reduction so they
+  // also low-pass the image.
+
+  /// The filters polyphase_resample() can use.
+  enum ResampleFilter {
+    AreaResampleFilter,   ///< The area of each source pixel under the output pixel
+    CubicResampleFilter,  ///< Keys' cubic convolution, a = -0.5
+    LanczosResampleFilter ///< Lanczos, three lobes
+  };
+
+  /// The weights for resampling one axis. Output pixel i is centered
+  /// on (i+0.5)/scale-0.5 in the source, so that a reduction by an
+  /// integer factor averages whole blocks of source pixels, as
+  /// resample_aa() and subsample() do.
+  class PolyphaseFilterBank {
+    int32 m_taps;
+    std::vector<int32> m_first, m_phase;
+    std::vector<float> m_weights;
+  public:
+    /// The weights for outputs begin to end-1 at the given scale.
+    PolyphaseFilterBank( ResampleFilter filter, double scale, int32 begin, int32 end );
+
+    /// The number of outputs.
+    int32 size() const { return int32(m_first.size()); }
+    /// The number of weights of each output, some possibly zero.
+    int32 taps() const { return m_taps; }
+    /// The number of different sets of weights.
+    int32 num_phases() const { return int32(m_weights.size() / m_taps); }
+
+    /// The source index of the first weight of output begin+i.
+    int32 first( int32 i ) const { return m_first[i]; }
+    /// The taps() weights of output begin+i, which sum to one.
+    float const* weights( int32 i ) const { return &m_weights[size_t(m_phase[i]) * m_taps]; }
+
+    /// The range of source indices the outputs read.
+    int32 source_begin() const { return m_first.empty() ? 0 : m_first.front(); }
+    int32 source_end  () const { return m_first.empty() ? 0 : m_first.back() + m_taps; }
+  };
+
+  namespace detail {
+
+    // Sums of weighted pixels for polyphase resampling, in double.
+    template <class PixelT>
+    struct PolyphaseSum {
+      typedef typename CompoundChannelCast<PixelT, double>::type value_type;
+      typedef typename PixelChannelType<PixelT>::type channel_type;
+      value_type value;
+      PolyphaseSum() : value() {}
+      void add( float w, PixelT const& p ) { value += double(w) * channel_cast<double>( p ); }
+      void add( float w, PolyphaseSum const& s ) { value += double(w) * s.value; }
+      PixelT result() const { return channel_cast_round_and_clamp_if_int<channel_type>( value ); }
+    };
+
+    // Masked pixels are summed by normalized convolution: the invalid
+    // pixels are left out and the sum divided by the weight of the
+    // rest. The result is invalid unless at least half the weight fell
+    // on valid pixels.
+    template <class ChildT>
+    struct PolyphaseSum<PixelMask<ChildT> > {
+      typedef typename CompoundChannelCast<ChildT, double>::type value_type;
+      typedef typename PixelChannelType<ChildT>::type channel_type;
+      value_type value;
+      double weight;
+      PolyphaseSum() : value(), weight(0) {}
+      void add( float w, PixelMask<ChildT> const& p ) {
+        if ( is_valid( p ) ) {
+          value  += double(w) * channel_cast<double>( p.child() );
+          weight += w;
+        }
+      }
+      void add( float w, PolyphaseSum const& s ) {
+        value  += double(w) * s.value;
+        weight += w * s.weight;
+      }
+      PixelMask<ChildT> result() const {
+        if ( weight < 0.5 )
+          return PixelMask<ChildT>();
+        value_type mean = value / weight;
+        return PixelMask<ChildT>( channel_cast_round_and_clamp_if_int<channel_type>( mean ) );
+      }
+    };
+  }
+
+  /// Resamples an image with separable polyphase filters, see
+  /// PolyphaseFilterBank. Each block is resampled down its columns and
+  /// then along its rows; images of uint8, uint16 or float channels
+  /// take the columns a whole row of channels at a time with
+  /// detail::accumulate_tap(), which is vectorized with VW_ENABLE_SSE.
+  /// Masked images are resampled by normalized convolution.
+  template <class ImageT, class EdgeT = vw::ConstantEdgeExtension>
+  class PolyphaseResampleView : public vw::ImageViewBase<PolyphaseResampleView<ImageT, EdgeT> > {
+    ImageT         m_image;
+    double         m_x_scale, m_y_scale;
+    vw::int32      m_cols, m_rows;
+    ResampleFilter m_filter;
+    EdgeT          m_edge;
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type result_type;
+    typedef vw::ProceduralPixelAccessor<PolyphaseResampleView<ImageT, EdgeT> > pixel_accessor;
+
+    PolyphaseResampleView( ImageT const& image, double x_scale, double y_scale,
+                           vw::int32 cols, vw::int32 rows, ResampleFilter filter, EdgeT const& edge = EdgeT() )
+      : m_image(image), m_x_scale(x_scale), m_y_scale(y_scale), m_cols(cols), m_rows(rows),
+        m_filter(filter), m_edge(edge) {
+      VW_ASSERT( x_scale > 0 && y_scale > 0, vw::ArgumentErr() << "PolyphaseResampleView: The scale must be positive." );
+    }
+
+    inline vw::int32 cols  () const { return m_cols; }
+    inline vw::int32 rows  () const { return m_rows; }
+    inline vw::int32 planes() const { return m_image.planes(); }
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    // Single pixels are resampled as a block of one.
+    inline result_type operator()( vw::int32 x, vw::int32 y, vw::int32 p=0 ) const {
+      vw::ImageView<pixel_type> pixel( 1, 1, planes() );
+      rasterize( pixel, vw::BBox2i( x, y, 1, 1 ) );
+      return pixel( 0, 0, p );
+    }
+
+    typedef vw::CropView<vw::ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( vw::BBox2i const& bbox ) const {
+      using namespace vw;
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), planes() );
+      rasterize( dest, bbox );
+      return prerasterize_type( dest, BBox2i( -bbox.min().x(), -bbox.min().y(), cols(), rows() ) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, vw::BBox2i const& bbox ) const {
+      using namespace vw;
+      if ( bbox.empty() )
+        return;
+      PolyphaseFilterBank x_bank( m_filter, m_x_scale, bbox.min().x(), bbox.max().x() );
+      PolyphaseFilterBank y_bank( m_filter, m_y_scale, bbox.min().y(), bbox.max().y() );
+      BBox2i src_bbox( x_bank.source_begin(), y_bank.source_begin(),
+                       x_bank.source_end() - x_bank.source_begin(),
+                       y_bank.source_end() - y_bank.source_begin() );
+      ImageView<pixel_type> src = edge_extend( m_image, src_bbox, m_edge );
+      ImageView<pixel_type> output( bbox.width(), bbox.height(), src.planes() );
+      resample( src, x_bank, y_bank, output, typename detail::IsFlatConvolvable<pixel_type, float>::type() );
+      output.rasterize( dest, BBox2i( 0, 0, output.cols(), output.rows() ) );
+    }
+
+  private:
+    // Any pixel type, a pixel at a time in double.
+    static void resample( vw::ImageView<pixel_type> const& src, PolyphaseFilterBank const& x_bank,
+                          PolyphaseFilterBank const& y_bank, vw::ImageView<pixel_type>& output,
+                          boost::mpl::false_ ) {
+      typedef detail::PolyphaseSum<pixel_type> sum_type;
+      const vw::int32 src_cols = src.cols(), x0 = x_bank.source_begin(), y0 = y_bank.source_begin();
+      std::vector<sum_type> work( size_t(src_cols) * output.rows() );
+      for ( vw::int32 p = 0; p < src.planes(); p++ ) {
+        for ( vw::int32 j = 0; j < output.rows(); j++ ) {
+          sum_type* row = &work[size_t(j) * src_cols];
+          std::fill( row, row + src_cols, sum_type() );
+          float const* w = y_bank.weights( j );
+          for ( vw::int32 t = 0; t < y_bank.taps(); t++ ) {
+            if ( w[t] == 0 )
+              continue;
+            const vw::int32 y = y_bank.first( j ) - y0 + t;
+            for ( vw::int32 x = 0; x < src_cols; x++ )
+              row[x].add( w[t], src( x, y, p ) );
+          }
+        }
+        for ( vw::int32 j = 0; j < output.rows(); j++ ) {
+          sum_type const* row = &work[size_t(j) * src_cols];
+          for ( vw::int32 i = 0; i < output.cols(); i++ ) {
+            float const* w = x_bank.weights( i );
+            sum_type const* s = row + ( x_bank.first( i ) - x0 );
+            sum_type sum;
+            for ( vw::int32 t = 0; t < x_bank.taps(); t++ )
+              sum.add( w[t], s[t] );
+            output( i, j, p ) = sum.result();
+          }
+        }
+      }
+    }
+
+    // Flat pixels, a row of channels at a time in float.
+    static void resample( vw::ImageView<pixel_type> const& src, PolyphaseFilterBank const& x_bank,
+                          PolyphaseFilterBank const& y_bank, vw::ImageView<pixel_type>& output,
+                          boost::mpl::true_ ) {
+      typedef typename PixelChannelType<pixel_type>::type channel_type;
+      const vw::int32 nch = PixelNumChannels<pixel_type>::value;
+      const size_t row_size = size_t(src.cols()) * nch;
+      const vw::int32 x0 = x_bank.source_begin(), y0 = y_bank.source_begin();
+      std::vector<float> work( row_size * output.rows() );
+      for ( vw::int32 p = 0; p < src.planes(); p++ ) {
+        channel_type const* src_data = reinterpret_cast<channel_type const*>( &src( 0, 0, p ) );
+        for ( vw::int32 j = 0; j < output.rows(); j++ ) {
+          float* row = &work[j * row_size];
+          std::fill( row, row + row_size, 0.0f );
+          float const* w = y_bank.weights( j );
+          for ( vw::int32 t = 0; t < y_bank.taps(); t++ )
+            if ( w[t] != 0 )
+              detail::accumulate_tap( row, src_data + size_t( y_bank.first( j ) - y0 + t ) * row_size, w[t], row_size );
+        }
+        channel_type* out_data = reinterpret_cast<channel_type*>( &output( 0, 0, p ) );
+        for ( vw::int32 j = 0; j < output.rows(); j++ ) {
+          float const* row = &work[j * row_size];
+          channel_type* out = out_data + size_t(j) * output.cols() * nch;
+          for ( vw::int32 i = 0; i < output.cols(); i++ ) {
+            float const* w = x_bank.weights( i );
+            float const* s = row + size_t( x_bank.first( i ) - x0 ) * nch;
+            for ( vw::int32 c = 0; c < nch; c++ ) {
+              float sum = 0;
+              for ( vw::int32 t = 0; t < x_bank.taps(); t++ )
+                sum += w[t] * s[t*nch + c];
+              out[i*nch + c] = channel_cast_round_and_clamp_if_int<channel_type>( sum );
+            }
+          }
+        }
+      }
+    }
+  };
+
+  /// Resamples an image to cols x rows at the given scales with a
+  /// polyphase filter, extending its edges with edge.
+  template <class ImageT, class EdgeT>
+  inline PolyphaseResampleView<ImageT, EdgeT>
+  polyphase_resample( vw::ImageViewBase<ImageT> const& image, double x_scale, double y_scale,
+                      vw::int32 cols, vw::int32 rows, ResampleFilter filter, EdgeT const& edge ) {
+    return PolyphaseResampleView<ImageT, EdgeT>( image.impl(), x_scale, y_scale, cols, rows, filter, edge );
+  }
+
+  /// Resamples an image by the given scales with a polyphase filter.
+  /// A scale below one reduces the image, and the filter is widened to
+  /// avoid aliasing.
+  template <class ImageT>
+  inline PolyphaseResampleView<ImageT>
+  polyphase_resample( vw::ImageViewBase<ImageT> const& image, double x_scale, double y_scale,
+                      ResampleFilter filter = LanczosResampleFilter ) {
+    return PolyphaseResampleView<ImageT>( image.impl(), x_scale, y_scale,
+                                          vw::int32( .5 + image.impl().cols() * x_scale ),
+                                          vw::int32( .5 + image.impl().rows() * y_scale ), filter );
+  }
+
+  /// Resamples an image by the same scale along both axes.
+  template <class ImageT>
+  inline PolyphaseResampleView<ImageT>
+  polyphase_resample( vw::ImageViewBase<ImageT> const& image, double scale,
+                      ResampleFilter filter = LanczosResampleFilter ) {
+    return polyphase_resample( image, scale, scale, filter );
+  }
+
 }
 
 #endif//__VW_IMAGE_ANTIALIASING_H__
@@ -464,6 +464,97 @@ public:
   }
 };
 
+LabelEquivalence::LabelEquivalence( uint32 size ) : m_parent( std::max( size, uint32(1) ) ) {
+  for ( uint32 i = 0; i < m_parent.size(); i++ )
+    m_parent[i] = i;
+}
+
+uint32 LabelEquivalence::add() {
+  m_parent.push_back( m_parent.size() );
+  return m_parent.size() - 1;
+}
+
+uint32 LabelEquivalence::find( uint32 label ) {
+  // Path halving
+  while ( m_parent[label] != label ) {
+    m_parent[label] = m_parent[m_parent[label]];
+    label = m_parent[label];
+  }
+  return label;
+}
+
+void LabelEquivalence::merge( uint32 a, uint32 b ) {
+  a = find( a );
+  b = find( b );
+  if ( a < b )
+    m_parent[b] = a;
+  else if ( b < a )
+    m_parent[a] = b;
+}
+
+uint32 LabelEquivalence::compact( std::vector<uint32>& numbering ) {
+  numbering.resize( m_parent.size() );
+  numbering[0] = 0;
+  uint32 count = 0;
+  // Roots are the smallest label of their set, so they come first.
+  for ( uint32 i = 1; i < m_parent.size(); i++ ) {
+    const uint32 root = find( i );
+    numbering[i] = ( root == i ) ? ++count : numbering[root];
+  }
+  return count;
+}
+
+namespace {
+  // The label of pixel (x,y) across all tiles.
+  inline uint32 global_label( ImageView<uint32> const& labels, int32 x, int32 y,
+                              int32 tile_size, int32 tiles_x,
+                              std::vector<uint32> const& offsets ) {
+    const uint32 label = labels(x,y);
+    return label ? label + offsets[(y/tile_size)*tiles_x + x/tile_size] : 0;
+  }
+}
+
+void merge_tile_borders( ImageView<uint32> const& labels, int32 tile_size,
+                         std::vector<uint32> const& offsets,
+                         LabelEquivalence& equivalence ) {
+  const int32 tiles_x = ( labels.cols() + tile_size - 1 ) / tile_size;
+
+  // A pixel on the left edge of a tile and its three neighbors to the left.
+  for ( int32 x = tile_size; x < labels.cols(); x += tile_size )
+    for ( int32 y = 0; y < labels.rows(); y++ ) {
+      const uint32 label = global_label( labels, x, y, tile_size, tiles_x, offsets );
+      if ( !label )
+        continue;
+      for ( int32 ny = std::max( y-1, 0 ); ny <= std::min( y+1, labels.rows()-1 ); ny++ ) {
+        const uint32 other = global_label( labels, x-1, ny, tile_size, tiles_x, offsets );
+        if ( other )
+          equivalence.merge( label, other );
+      }
+    }
+
+  // A pixel on the top edge of a tile and its three neighbors above.
+  for ( int32 y = tile_size; y < labels.rows(); y += tile_size )
+    for ( int32 x = 0; x < labels.cols(); x++ ) {
+      const uint32 label = global_label( labels, x, y, tile_size, tiles_x, offsets );
+      if ( !label )
+        continue;
+      for ( int32 nx = std::max( x-1, 0 ); nx <= std::min( x+1, labels.cols()-1 ); nx++ ) {
+        const uint32 other = global_label( labels, nx, y-1, tile_size, tiles_x, offsets );
+        if ( other )
+          equivalence.merge( label, other );
+      }
+    }
+}
+
+void RelabelTileTask::operator()() {
+  for ( int32 r = m_bbox.min().y(); r < m_bbox.max().y(); r++ )
+    for ( int32 c = m_bbox.min().x(); c < m_bbox.max().x(); c++ ) {
+      uint32& label = m_labels(c,r);
+      if ( label )
+        label = m_numbering[label + m_offset];
+    }
+}
+
 } // end namespace blob
 
 void BlobIndexThreaded::consolidate( Vector2i const& image_size,
@@ -368,9 +368,172 @@ namespace blob {
       vw_out(VerboseDebugMessage,"inpaint") << "Task " << m_id << ": finished, " << sw.elapsed_seconds() << "s\n";
     }
   };
+
+  // Tiled Labeling
+  /////////////////////////////////////
+
+  /// Disjoint sets of blob labels.  Label 0 is the background and is
+  /// never merged.  The root of each set is its smallest label, so the
+  /// sets found do not depend on the order of the merges.
+  class LabelEquivalence {
+    std::vector<uint32> m_parent;
+  public:
+    /// Starts with labels 0 .. size-1, each in its own set.
+    LabelEquivalence( uint32 size = 1 );
+
+    /// Adds a label in a set of its own, and returns it.
+    uint32 add();
+    uint32 find ( uint32 label );
+    void   merge( uint32 a, uint32 b );
+    uint32 size () const { return m_parent.size(); }
+
+    /// Numbers the sets 1 .. n in order of their smallest label, and
+    /// sets numbering[label] to the number of the label's set, with
+    /// numbering[0] = 0.  Returns n.
+    uint32 compact( std::vector<uint32>& numbering );
+  };
+
+  /// Labels the 8-connected blobs of valid pixels inside one tile,
+  /// writing labels 1 .. count local to the tile into the tile's part
+  /// of the label image.
+  template <class SourceT>
+  class LabelTileTask : public Task, private boost::noncopyable {
+    SourceT const&     m_src;
+    BBox2i             m_bbox;
+    ImageView<uint32>& m_labels;
+    uint32&            m_count;
+  public:
+    LabelTileTask( SourceT const& src, BBox2i const& bbox,
+                   ImageView<uint32>& labels, uint32& count ) :
+      m_src(src), m_bbox(bbox), m_labels(labels), m_count(count) {}
+
+    void operator()() {
+      // Render so threads don't wait on each other
+      ImageView<typename SourceT::pixel_type> tile = crop( m_src, m_bbox );
+      const int32 x0 = m_bbox.min().x(), y0 = m_bbox.min().y();
+      LabelEquivalence equivalence;
+      for ( int32 r = 0; r < tile.rows(); r++ ) {
+        for ( int32 c = 0; c < tile.cols(); c++ ) {
+          uint32& label = m_labels( x0 + c, y0 + r );
+          label = 0;
+          if ( !is_valid( tile(c,r) ) )
+            continue;
+          // The neighbors already visited: left, upper left, up and upper right.
+          if ( c > 0 && is_valid( tile(c-1,r) ) )
+            label = m_labels( x0 + c-1, y0 + r );
+          if ( r > 0 ) {
+            for ( int32 dc = -1; dc <= 1; dc++ ) {
+              if ( c + dc < 0 || c + dc >= tile.cols() || !is_valid( tile(c+dc,r-1) ) )
+                continue;
+              const uint32 above = m_labels( x0 + c+dc, y0 + r-1 );
+              if ( label == 0 )
+                label = above;
+              else if ( label != above )
+                equivalence.merge( label, above );
+            }
+          }
+          if ( label == 0 )
+            label = equivalence.add();
+        }
+      }
+
+      std::vector<uint32> numbering;
+      m_count = equivalence.compact( numbering );
+      for ( int32 r = 0; r < tile.rows(); r++ )
+        for ( int32 c = 0; c < tile.cols(); c++ ) {
+          uint32& label = m_labels( x0 + c, y0 + r );
+          label = numbering[label];
+        }
+    }
+  };
+
+  /// Merges the labels of blobs that touch across tile borders.  The
+  /// label of a pixel in tile t is its tile label plus offsets[t].
+  void merge_tile_borders( ImageView<uint32> const& labels, int32 tile_size,
+                           std::vector<uint32> const& offsets,
+                           LabelEquivalence& equivalence );
+
+  /// Replaces the tile labels of bbox, which is tile t, by
+  /// numbering[label + offset].
+  class RelabelTileTask : public Task, private boost::noncopyable {
+    ImageView<uint32>&         m_labels;
+    BBox2i                     m_bbox;
+    uint32                     m_offset;
+    std::vector<uint32> const& m_numbering;
+  public:
+    RelabelTileTask( ImageView<uint32>& labels, BBox2i const& bbox, uint32 offset,
+                     std::vector<uint32> const& numbering ) :
+      m_labels(labels), m_bbox(bbox), m_offset(offset), m_numbering(numbering) {}
+    void operator()();
+  };
+
 } // end namespace blob
 
 
+  /// Labels the 8-connected blobs of valid pixels of src, writing
+  /// labels 1 .. n to labels and 0 to invalid pixels, and returns n.
+  /// - Tiles of tile_size are labeled in parallel, the labels that meet
+  ///   across tile borders are merged with a union-find, and then the
+  ///   tiles are relabeled in parallel.  Only one tile of the source is
+  ///   rendered per thread at a time.
+  /// - Blobs are numbered in order of the first tile, in row-major tile
+  ///   order, that they touch.  This does not depend on num_threads.
+  template <class SourceT>
+  uint32 label_blobs( ImageViewBase<SourceT> const& src, ImageView<uint32>& labels,
+                      int32 tile_size   = vw_settings().default_tile_size(),
+                      int32 num_threads = vw_settings().default_num_threads() ) {
+    if ( src.impl().planes() > 1 )
+      vw_throw( NoImplErr() << "label_blobs currently only works with 2D images." );
+    VW_ASSERT( tile_size > 0, ArgumentErr() << "label_blobs: tile_size must be positive." );
+    labels.set_size( src.impl().cols(), src.impl().rows() );
+
+    // Tiles in row-major order on a grid anchored at the origin.
+    std::vector<BBox2i> tiles;
+    for ( int32 y = 0; y < labels.rows(); y += tile_size )
+      for ( int32 x = 0; x < labels.cols(); x += tile_size )
+        tiles.push_back( BBox2i( x, y, std::min( tile_size, labels.cols() - x ),
+                                       std::min( tile_size, labels.rows() - y ) ) );
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+
+    std::vector<uint32> counts( tiles.size(), 0 );
+    typedef blob::LabelTileTask<SourceT> label_task;
+    if ( num_threads == 1 || tiles.size() <= 1 ) {
+      for ( size_t t = 0; t < tiles.size(); t++ )
+        label_task( src.impl(), tiles[t], labels, counts[t] )();
+    } else {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t t = 0; t < tiles.size(); t++ )
+        queue.add_task( boost::shared_ptr<Task>(
+          new label_task( src.impl(), tiles[t], labels, counts[t] ) ) );
+      queue.join_all();
+    }
+
+    std::vector<uint32> offsets( tiles.size(), 0 );
+    uint32 total = 0;
+    for ( size_t t = 0; t < tiles.size(); t++ ) {
+      offsets[t] = total;
+      total += counts[t];
+    }
+    blob::LabelEquivalence equivalence( total + 1 );
+    blob::merge_tile_borders( labels, tile_size, offsets, equivalence );
+    std::vector<uint32> numbering;
+    const uint32 num_blobs = equivalence.compact( numbering );
+
+    if ( num_threads == 1 || tiles.size() <= 1 ) {
+      for ( size_t t = 0; t < tiles.size(); t++ )
+        blob::RelabelTileTask( labels, tiles[t], offsets[t], numbering )();
+    } else {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t t = 0; t < tiles.size(); t++ )
+        queue.add_task( boost::shared_ptr<Task>(
+          new blob::RelabelTileTask( labels, tiles[t], offsets[t], numbering ) ) );
+      queue.join_all();
+    }
+    return num_blobs;
+  }
+
+
   // Simple interface
   template <class SourceT>
   ImageView<uint32> blob_index( ImageViewBase<SourceT> const& src ) {
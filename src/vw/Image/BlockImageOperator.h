@@ -29,6 +29,12 @@
 /// void operator()(ImageView<T> const& image, BBox2i const& bbox) {
 /// --> Note that bbox is the region that image was cropped from!
 ///
+/// With execute_func() all threads share the functor, so it must lock
+/// around any state it changes.  With execute_reduce() each thread has
+/// its own copy, and FuncT must also implement
+///
+/// void merge(FuncT const& other);
+///
 
 
 #ifndef __VW_IMAGE_BLOCKIMAGEOPERATOR_H__
@@ -79,6 +85,22 @@ namespace vw {
       processor(bbox);
     }
 
+    /// Apply the functor to the specified section of the image, giving
+    /// each thread its own copy of it, then fold the copies into it in
+    /// turn with merge().  The copies are made before any block is
+    /// processed, so the functor should not yet hold any results.
+    void execute_reduce(BBox2i const& bbox) {
+      image_block::BlockProcessor<ReduceFunctor> processor( ReduceFunctor(*this), m_block_size, m_num_threads );
+      std::vector<ReduceFunctor> functors;
+      for (uint32 i = 0; i < processor.num_threads(); ++i)
+        functors.push_back( ReduceFunctor(*this) );
+
+      processor(bbox, functors);
+
+      for (size_t i = 0; i < functors.size(); ++i)
+        m_functor.merge( functors[i].functor() );
+    }
+
   private:
 
     // These functions are here to be convenient for other private functions.
@@ -96,30 +118,52 @@ namespace vw {
 
       /// Rasterize part of m_view into a buffer, then call m_functor on it.
       void operator()( BBox2i const& bbox ) const {
-
-        // Set up the buffer where the image data will be copied to.
-        ImageView<BlockImageOperator::pixel_type> temp_image( bbox.width(), bbox.height(), 
-                                                              m_view.child().planes() );
-
-        if( m_view.m_cache_ptr ) {
-          // Ask the cache managing object to get the image tile, we might already have it.
-          Vector2i block_index = m_view.m_block_manager.get_block_index(bbox);
-
-          const Cache::Handle<image_block::BlockGenerator<ImageT> >& handle
-            = m_view.m_block_manager.block(block_index);
-          handle->rasterize( temp_image, bbox - m_view.m_block_manager.get_block_start_pixel(block_index));
-          handle.release();
-        }
-        else // No cache, generate the image tile from scratch.
-          m_view.child().rasterize(temp_image, bbox);
+        ImageView<BlockImageOperator::pixel_type> temp_image;
+        m_view.rasterize_block( temp_image, bbox );
 
         // Now that we have rasterized the required portion of the image, call our functor on it.
         m_view.m_functor(temp_image, bbox);
       }
     }; // End class RunFunctor
 
-    // Allows RasterizeFunctor to access cache-related members.
+    // Same, but calls a copy of m_functor owned by one thread.
+    class ReduceFunctor {
+      BlockImageOperator const& m_view;
+      boost::shared_ptr<FuncT>  m_functor;
+    public:
+      ReduceFunctor( BlockImageOperator const& view )
+        : m_view(view), m_functor( new FuncT( view.m_functor ) ) {}
+
+      FuncT const& functor() const { return *m_functor; }
+
+      void operator()( BBox2i const& bbox ) const {
+        ImageView<BlockImageOperator::pixel_type> temp_image;
+        m_view.rasterize_block( temp_image, bbox );
+        (*m_functor)(temp_image, bbox);
+      }
+    }; // End class ReduceFunctor
+
+    // Allows the functors to access cache-related members.
     friend class RunFunctor;
+    friend class ReduceFunctor;
+
+    /// Rasterize one block of the child into a new buffer.
+    void rasterize_block( ImageView<pixel_type> & temp_image, BBox2i const& bbox ) const {
+      // Set up the buffer where the image data will be copied to.
+      temp_image.set_size( bbox.width(), bbox.height(), child().planes() );
+
+      if( m_cache_ptr ) {
+        // Ask the cache managing object to get the image tile, we might already have it.
+        Vector2i block_index = m_block_manager.get_block_index(bbox);
+
+        const Cache::Handle<image_block::BlockGenerator<ImageT> >& handle
+          = m_block_manager.block(block_index);
+        handle->rasterize( temp_image, bbox - m_block_manager.get_block_start_pixel(block_index));
+        handle.release();
+      }
+      else // No cache, generate the image tile from scratch.
+        child().rasterize(temp_image, bbox);
+    }
 
     // We store this by shared pointer so it doesn't move when we copy
     // the BlockImageOperator, since the BlockGenerators point to it.
@@ -157,6 +201,17 @@ namespace vw {
     block_op.execute_func(bounding_box(image));
   }
 
+  /// Apply a functor to an image one block at a time, giving each thread
+  /// its own copy of the functor and merging the copies into it at the
+  /// end.  See BlockImageOperator::execute_reduce().
+  template <class ImageT, class FuncT>
+  inline void block_reduce( ImageViewBase<ImageT> const& image,
+                            FuncT & functor,
+                            Vector2i const& block_size, int num_threads = 0 ) {
+    BlockImageOperator<ImageT, FuncT> block_op(image.impl(), functor, block_size, num_threads);
+    block_op.execute_reduce(bounding_box(image));
+  }
+
 } // namespace vw
 
 #endif // __VW_IMAGE_BLOCKIMAGEOPERATOR_H__
@@ -0,0 +1,270 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/System.h>
+#include <vw/Image/BlockPrefetcher.h>
+
+#include <algorithm>
+
+namespace vw {
+
+  class BlockPrefetcher::FetchTask : public Task {
+    BlockPrefetcher& m_prefetcher;
+    size_t           m_position;
+  public:
+    FetchTask( BlockPrefetcher& prefetcher, size_t position )
+      : m_prefetcher(prefetcher), m_position(position) {}
+    virtual void operator()() { m_prefetcher.fetch( m_position ); }
+  };
+
+  BlockPrefetcher::BlockPrefetcher( std::vector<Vector2i> const& order, Vector2i const& table_size,
+                                    FetchFunc const& fetch, size_t block_bytes, Cache& cache,
+                                    int num_threads, size_t lookahead )
+    : m_order(order), m_position(size_t(table_size.x()) * table_size.y(), -1),
+      m_table_width(table_size.x()), m_fetch(fetch), m_lookahead(lookahead),
+      m_next(0), m_consumed(0), m_fetched(0), m_skipped(0),
+      m_cancel_token(new CancelToken), m_queue(num_threads) {
+    VW_ASSERT( num_threads > 0, ArgumentErr() << "BlockPrefetcher: needs at least one thread." );
+    m_queue.set_name("prefetch");
+
+    for ( size_t i = 0; i < m_order.size(); ++i ) {
+      Vector2i const& block = m_order[i];
+      VW_ASSERT( block.x() >= 0 && block.x() < table_size.x() && block.y() >= 0 && block.y() < table_size.y(),
+                 ArgumentErr() << "BlockPrefetcher: block " << block << " is outside the table." );
+      m_position[block.x() + block.y()*m_table_width] = int(i);
+    }
+
+    // Blocks fetched too far ahead would only push each other out of the cache.
+    if ( m_lookahead == 0 )
+      m_lookahead = 4 * num_threads;
+    size_t cache_blocks = cache.max_size() / ( 2 * std::max(block_bytes, size_t(1)) );
+    m_lookahead = std::max( size_t(1), std::min( m_lookahead, cache_blocks ) );
+
+    Mutex::Lock lock(m_mutex);
+    issue_locked();
+  }
+
+  BlockPrefetcher::~BlockPrefetcher() {
+    cancel();
+    m_queue.join_all();
+  }
+
+  void BlockPrefetcher::note_access( Vector2i const& block_index ) {
+    size_t index = block_index.x() + size_t(block_index.y())*m_table_width;
+    if ( block_index.x() < 0 || block_index.x() >= m_table_width || index >= m_position.size() )
+      return;
+    int position = m_position[index];
+    if ( position < 0 )
+      return;
+
+    Mutex::Lock lock(m_mutex);
+    if ( size_t(position) < m_consumed )
+      return;
+    m_consumed = position + 1;
+    // Blocks the consumer already passed are no longer worth reading.
+    m_next = std::max( m_next, m_consumed );
+    issue_locked();
+  }
+
+  void BlockPrefetcher::cancel() {
+    m_cancel_token->cancel();
+    Mutex::Lock lock(m_mutex);
+    m_next = m_order.size();
+  }
+
+  uint64 BlockPrefetcher::num_fetched() const {
+    Mutex::Lock lock(m_mutex);
+    return m_fetched;
+  }
+
+  uint64 BlockPrefetcher::num_skipped() const {
+    Mutex::Lock lock(m_mutex);
+    return m_skipped;
+  }
+
+  void BlockPrefetcher::issue_locked() {
+    if ( m_cancel_token->is_cancelled() )
+      return;
+    while ( m_next < m_order.size() && m_next < m_consumed + m_lookahead ) {
+      boost::shared_ptr<Task> task( new FetchTask( *this, m_next ) );
+      task->set_cancel_token( m_cancel_token );
+      m_queue.add_task( task );
+      m_next++;
+    }
+  }
+
+  void BlockPrefetcher::fetch( size_t position ) {
+    bool fetched = false;
+    {
+      Mutex::Lock lock(m_mutex);
+      // The consumer may have overtaken this block while it was queued.
+      if ( position < m_consumed ) {
+        m_skipped++;
+        return;
+      }
+    }
+    if ( !vw_memory_governor().over_budget() )
+      fetched = m_fetch( m_order[position] );
+
+    Mutex::Lock lock(m_mutex);
+    if ( fetched )
+      m_fetched++;
+    else
+      m_skipped++;
+  }
+
+  namespace {
+    // Map a distance along the Hilbert curve filling an n by n grid
+    // (n a power of two) to grid coordinates.
+    Vector2i hilbert_point( int64 n, int64 d ) {
+      int64 x = 0, y = 0;
+      for ( int64 s = 1; s < n; s *= 2 ) {
+        int64 rx = 1 & ( d / 2 );
+        int64 ry = 1 & ( d ^ rx );
+        if ( ry == 0 ) {
+          if ( rx == 1 ) {
+            x = s - 1 - x;
+            y = s - 1 - y;
+          }
+          std::swap( x, y );
+        }
+        x += s * rx;
+        y += s * ry;
+        d /= 4;
+      }
+      return Vector2i( int32(x), int32(y) );
+    }
+
+    // Map a position along the Z-order curve to grid coordinates by
+    // splitting its bits between x (even) and y (odd).
+    Vector2i morton_point( int64 d ) {
+      int64 x = 0, y = 0;
+      for ( int bit = 0; d; ++bit, d >>= 2 ) {
+        x |= ( d & 1 ) << bit;
+        y |= ( ( d >> 1 ) & 1 ) << bit;
+      }
+      return Vector2i( int32(x), int32(y) );
+    }
+  }
+
+  std::vector<Vector2i> BlockPrefetcher::traversal( Order order, Vector2i const& table_size ) {
+    std::vector<Vector2i> blocks;
+    if ( table_size.x() <= 0 || table_size.y() <= 0 )
+      return blocks;
+    blocks.reserve( size_t(table_size.x()) * table_size.y() );
+
+    switch ( order ) {
+    case RowMajor:
+      for ( int32 iy = 0; iy < table_size.y(); ++iy )
+        for ( int32 ix = 0; ix < table_size.x(); ++ix )
+          blocks.push_back( Vector2i(ix, iy) );
+      break;
+    case Hilbert: {
+      // Walk the curve over the smallest enclosing square, keeping the
+      // points which land inside the table.
+      int64 n = 1;
+      while ( n < table_size.x() || n < table_size.y() )
+        n *= 2;
+      for ( int64 d = 0; d < n*n; ++d ) {
+        Vector2i block = hilbert_point( n, d );
+        if ( block.x() < table_size.x() && block.y() < table_size.y() )
+          blocks.push_back( block );
+      }
+      break;
+    }
+    case ZOrder: {
+      int64 n = 1;
+      while ( n < table_size.x() || n < table_size.y() )
+        n *= 2;
+      for ( int64 d = 0; d < n*n; ++d ) {
+        Vector2i block = morton_point( d );
+        if ( block.x() < table_size.x() && block.y() < table_size.y() )
+          blocks.push_back( block );
+      }
+      break;
+    }
+    default:
+      vw_throw( ArgumentErr() << "BlockPrefetcher: unknown traversal order " << int(order) << "." );
+    }
+    return blocks;
+  }
+
+  std::vector<Vector2i> BlockPrefetcher::traversal( std::vector<BBox2i> const& regions,
+                                                    Vector2i const& block_size,
+                                                    Vector2i const& table_size ) {
+    VW_ASSERT( block_size.x() > 0 && block_size.y() > 0,
+               ArgumentErr() << "BlockPrefetcher: illegal block size " << block_size << "." );
+    std::vector<Vector2i> blocks;
+    std::vector<bool> seen( size_t(table_size.x()) * table_size.y(), false );
+    BBox2i table( 0, 0, table_size.x(), table_size.y() );
+
+    for ( size_t i = 0; i < regions.size(); ++i ) {
+      if ( regions[i].empty() )
+        continue;
+      BBox2i span( Vector2i( regions[i].min().x() / block_size.x(),
+                             regions[i].min().y() / block_size.y() ),
+                   Vector2i( ( regions[i].max().x() - 1 ) / block_size.x() + 1,
+                             ( regions[i].max().y() - 1 ) / block_size.y() + 1 ) );
+      span.crop( table );
+      for ( int32 iy = span.min().y(); iy < span.max().y(); ++iy )
+        for ( int32 ix = span.min().x(); ix < span.max().x(); ++ix ) {
+          size_t index = ix + size_t(iy)*table_size.x();
+          if ( !seen[index] ) {
+            seen[index] = true;
+            blocks.push_back( Vector2i(ix, iy) );
+          }
+        }
+    }
+    return blocks;
+  }
+
+  std::vector<Vector2i> BlockOrder::blocks( BBox2i const& span ) const {
+    if ( !m_blocks ) {
+      std::vector<Vector2i> blocks = BlockPrefetcher::traversal( m_order, span.size() );
+      for ( size_t i = 0; i < blocks.size(); ++i )
+        blocks[i] += span.min();
+      return blocks;
+    }
+
+    std::vector<Vector2i> blocks;
+    if ( span.empty() )
+      return blocks;
+    blocks.reserve( size_t(span.width()) * span.height() );
+    std::vector<bool> seen( size_t(span.width()) * span.height(), false );
+    for ( size_t i = 0; i < m_blocks->size(); ++i ) {
+      Vector2i const& block = (*m_blocks)[i];
+      if ( !span.contains( block ) )
+        continue;
+      size_t index = ( block.x() - span.min().x() ) + size_t( block.y() - span.min().y() ) * span.width();
+      if ( !seen[index] ) {
+        seen[index] = true;
+        blocks.push_back( block );
+      }
+    }
+    for ( int32 iy = span.min().y(); iy < span.max().y(); ++iy )
+      for ( int32 ix = span.min().x(); ix < span.max().x(); ++ix ) {
+        size_t index = ( ix - span.min().x() ) + size_t( iy - span.min().y() ) * span.width();
+        if ( !seen[index] )
+          blocks.push_back( Vector2i(ix, iy) );
+      }
+    return blocks;
+  }
+
+} // namespace vw
@@ -0,0 +1,143 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BlockPrefetcher.h
+///
+/// Reads the blocks of a cached view into the Cache ahead of use.
+///
+/// BlockRasterizeView normally generates a cached block only when
+/// something asks for a pixel in it, so reading a tile from disk and
+/// computing on the previous tile never overlap.  A BlockPrefetcher
+/// is told the order in which a consumer will visit the blocks and
+/// loads them on its own IO threads, staying a bounded number of
+/// blocks ahead of the consumer.
+///
+#ifndef __VW_IMAGE_BLOCKPREFETCHER_H__
+#define __VW_IMAGE_BLOCKPREFETCHER_H__
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <vector>
+
+namespace vw {
+
+  /// Loads blocks into the Cache in a declared order on a private pool
+  /// of IO threads.  The consumer reports the blocks it reaches with
+  /// note_access() and the prefetcher keeps at most lookahead() blocks
+  /// loaded ahead of the furthest one.  Blocks are skipped while the
+  /// process memory governor is over budget.
+  class BlockPrefetcher : private boost::noncopyable {
+  public:
+    /// Built-in traversal orders.  ZOrder is the Morton order, which
+    /// visits the blocks in aligned 2x2, 4x4, ... groups.
+    enum Order { RowMajor, Hilbert, ZOrder };
+
+    /// Loads one block into the Cache, see BlockRasterizeView::prefetch().
+    /// Returns false if the block was already loaded.
+    typedef boost::function<bool (Vector2i const&)> FetchFunc;
+
+    /// Starts fetching blocks in the given order.  The lookahead is
+    /// capped so that the blocks ahead take at most half of the cache;
+    /// zero picks four blocks per thread.
+    BlockPrefetcher( std::vector<Vector2i> const& order, Vector2i const& table_size,
+                     FetchFunc const& fetch, size_t block_bytes, Cache& cache,
+                     int num_threads = 2, size_t lookahead = 0 );
+
+    /// Stops issuing reads and waits for those in progress.
+    ~BlockPrefetcher();
+
+    /// Called by the consumer when it uses a block.  Blocks which are
+    /// not part of the traversal are ignored.
+    void note_access( Vector2i const& block_index );
+
+    /// Stop issuing reads; reads in progress still finish.
+    void cancel();
+
+    size_t lookahead() const { return m_lookahead; }
+
+    /// Number of blocks read by the prefetcher, and number skipped
+    /// because they were already loaded or memory was short.
+    uint64 num_fetched() const;
+    uint64 num_skipped() const;
+
+    /// The blocks of a table_size grid of blocks in the given order.
+    static std::vector<Vector2i> traversal( Order order, Vector2i const& table_size );
+
+    /// The blocks of the given size touched by each region in turn,
+    /// each block listed once.
+    static std::vector<Vector2i> traversal( std::vector<BBox2i> const& regions,
+                                            Vector2i const& block_size,
+                                            Vector2i const& table_size );
+
+  private:
+    class FetchTask;
+
+    void issue_locked();
+    void fetch( size_t position );
+
+    std::vector<Vector2i> m_order;
+    std::vector<int>      m_position;   ///< Position in m_order of each block, -1 if absent
+    int32                 m_table_width;
+    FetchFunc             m_fetch;
+    size_t                m_lookahead;
+    size_t                m_next;       ///< Next position in m_order to issue
+    size_t                m_consumed;   ///< One past the furthest position the consumer used
+    uint64                m_fetched, m_skipped;
+    mutable Mutex         m_mutex;
+    boost::shared_ptr<CancelToken> m_cancel_token;
+    FifoWorkQueue         m_queue;
+  };
+
+  /// The order in which a block-wise operation (BlockRasterizeView,
+  /// block_write_image) visits the blocks of an image.  Visiting them
+  /// along a Hilbert or Z-order curve keeps consecutive blocks next to
+  /// each other, so views whose source footprint spans neighboring
+  /// blocks find more of it still in the Cache.
+  class BlockOrder {
+  public:
+    /// One of the built-in orders, applied to the blocks being visited.
+    BlockOrder( BlockPrefetcher::Order order = BlockPrefetcher::RowMajor )
+      : m_order(order) {}
+
+    /// A custom order, given as block indices in the whole image:
+    /// block (ix,iy) holds the pixels from ix*width, iy*height.  Blocks
+    /// which are not listed are visited afterwards in row-major order
+    /// and repeated ones only the first time.
+    explicit BlockOrder( std::vector<Vector2i> const& blocks )
+      : m_order(BlockPrefetcher::RowMajor), m_blocks( new std::vector<Vector2i>(blocks) ) {}
+
+    /// True if blocks are visited left to right, then top to bottom.
+    bool is_row_major() const { return !m_blocks && m_order == BlockPrefetcher::RowMajor; }
+
+    /// Every block index inside span, once each, in this order.
+    std::vector<Vector2i> blocks( BBox2i const& span ) const;
+
+  private:
+    BlockPrefetcher::Order m_order;
+    boost::shared_ptr<std::vector<Vector2i> const> m_blocks;
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_BLOCKPREFETCHER_H__
@@ -35,8 +35,11 @@
 #define __VW_IMAGE_BLOCKPROCESSOR_H__
 
 #include <vw/Core/Settings.h>
+#include <vw/Core/System.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/BBox.h>
+#include <vw/Image/BlockPrefetcher.h>
 
 namespace vw {
 
@@ -51,6 +54,8 @@ namespace image_block {
     FuncT    m_func;
     Vector2i m_block_size;
     uint32   m_num_threads;
+    boost::shared_ptr<CancelToken> m_cancel_token;
+    BlockOrder m_order;
   public:
 
     /// Create a BlockProcessor object with the specified parameters.
@@ -58,9 +63,17 @@ namespace image_block {
     ///   by the specified number of threads.
     /// - The func object must have an operator(BBox2i) function that does whatever
     ///   it is you want done.
-    BlockProcessor( FuncT const& func, Vector2i const& block_size, uint32 threads = 0 )
+    /// - If a cancel token is given, no new blocks are started once it is
+    ///   cancelled and operator() throws vw::Aborted.
+    /// - The blocks are handed out in the given order, row-major by default.
+    ///   Blocks are aligned to multiples of block_size, so a custom order's
+    ///   block indices refer to the whole image.
+    BlockProcessor( FuncT const& func, Vector2i const& block_size, uint32 threads = 0,
+                    boost::shared_ptr<CancelToken> const& cancel_token = boost::shared_ptr<CancelToken>(),
+                    BlockOrder const& order = BlockOrder() )
       : m_func(func), m_block_size(block_size),
-        m_num_threads(threads?threads:(vw_settings().default_num_threads())) {}
+        m_num_threads(threads?threads:(vw_settings().default_num_threads())),
+        m_cancel_token(cancel_token), m_order(order) {}
 
     /// We will construct and call one BlockThread per thread.
     class BlockThread {
@@ -69,14 +82,29 @@ namespace image_block {
       // which stores information about what block should be processed next.
       class Info {
       public:
-        Info( FuncT const& func, BBox2i const& total_bbox, Vector2i const& block_size )
+        Info( FuncT const& func, BBox2i const& total_bbox, Vector2i const& block_size,
+              CancelToken const* cancel_token, BlockOrder const& order )
           : m_func(func), m_total_bbox(total_bbox),
             m_block_bbox(round_down(total_bbox.min().x(),block_size.x()),round_down(total_bbox.min().y(),block_size.y()),block_size.x(),block_size.y()),
-            m_block_size(block_size) {}
+            m_block_size(block_size), m_cancel_token(cancel_token), m_ordered(!order.is_row_major()), m_next(0) {
+          // Row-major order walks m_block_bbox across the image; any other
+          // order lists the blocks up front.
+          if( m_ordered && !total_bbox.empty() ) {
+            Vector2i first( m_block_bbox.min().x() / block_size.x(), m_block_bbox.min().y() / block_size.y() );
+            Vector2i last( round_down(total_bbox.max().x()-1,block_size.x()) / block_size.x(),
+                           round_down(total_bbox.max().y()-1,block_size.y()) / block_size.y() );
+            m_blocks = order.blocks( BBox2i( first, last + Vector2i(1,1) ) );
+          }
+        }
 
         // Return the next block bbox to process.
         BBox2i bbox() const {
           BBox2i block_bbox = m_block_bbox;
+          if( m_ordered ) {
+            Vector2i const& block = m_blocks[m_next];
+            block_bbox = BBox2i( block.x()*m_block_size.x(), block.y()*m_block_size.y(),
+                                 m_block_size.x(), m_block_size.y() );
+          }
           block_bbox.crop( m_total_bbox );
           return block_bbox;
         }
@@ -88,9 +116,16 @@ namespace image_block {
 
         // Are we finished?
         bool complete() const {
+          if( m_ordered )
+            return m_next >= m_blocks.size();
           return ( m_block_bbox.min().y() >= m_total_bbox.max().y() );
         }
 
+        // Should the remaining blocks be skipped?
+        bool cancelled() const {
+          return m_cancel_token && m_cancel_token->is_cancelled();
+        }
+
         // Returns the info mutex, for locking.
         Mutex& mutex() {
           return m_mutex;
@@ -98,6 +133,10 @@ namespace image_block {
 
         // Advance the block_bbox to point to the next block to process.
         void advance() {
+          if( m_ordered ) {
+            ++m_next;
+            return;
+          }
           m_block_bbox.min().x() += m_block_size.x();
           if( m_block_bbox.min().x() >= m_total_bbox.max().x() ) {
             m_block_bbox.min().x() = round_down(m_total_bbox.min().x(),m_block_size.x());
@@ -119,10 +158,15 @@ namespace image_block {
         FuncT const& m_func;
         BBox2i   m_total_bbox, m_block_bbox;
         Vector2i m_block_size;
+        CancelToken const* m_cancel_token;
+        bool     m_ordered;
+        std::vector<Vector2i> m_blocks;
+        size_t   m_next;
         Mutex    m_mutex;
       }; // End class Info
 
-      BlockThread( Info &info ) : info(info) {}
+      BlockThread( Info &info ) : info(info), func(info.func()) {}
+      BlockThread( Info &info, FuncT const& func ) : info(info), func(func) {}
 
       void operator()() {
         while( true ) {
@@ -131,36 +175,57 @@ namespace image_block {
             // Grab the next bbox to process, and update it with the
             // subsequent bbox for the next thread to grab.
             Mutex::Lock lock(info.mutex());
-            if( info.complete() )
+            if( info.complete() || info.cancelled() )
               return;
             bbox = info.bbox();
             info.advance();
           }
-          info.func()( bbox );
+          func( bbox );
         }
       }
 
     private:
       Info &info;
+      FuncT const& func;
     }; // End class BlockThread
 
+    /// The number of threads the blocks are shared between.
+    uint32 num_threads() const { return m_num_threads; }
+
     /// Break bbox into sections of block_size, then call
     ///  func(sub_bbox) for each of them.
     inline void operator()( BBox2i bbox ) const {
-      typename BlockThread::Info info( m_func, bbox, m_block_size );
+      process( bbox, NULL );
+    }
+
+    /// Same, but thread i calls funcs[i] instead of the processor's
+    /// function, so that each thread can keep state of its own without
+    /// locking.  There must be num_threads() functions.
+    inline void operator()( BBox2i bbox, std::vector<FuncT> const& funcs ) const {
+      VW_ASSERT( funcs.size() == m_num_threads,
+                 ArgumentErr() << "BlockProcessor: expected " << m_num_threads
+                               << " functions, got " << funcs.size() << "." );
+      process( bbox, &funcs );
+    }
+
+  private:
+    void process( BBox2i const& bbox, std::vector<FuncT> const* funcs ) const {
+      typename BlockThread::Info info( m_func, bbox, m_block_size, m_cancel_token.get(), m_order );
 
       // Avoid threads altogether in the single-threaded case.
       // Annoyingly, this still creates an unnecessary Mutex.
       if( m_num_threads == 1 ) {
-        BlockThread bt( info );
-        return bt();
+        BlockThread bt( info, funcs ? (*funcs)[0] : m_func );
+        bt();
+        check_complete( info );
+        return;
       }
 
       std::vector<boost::shared_ptr<BlockThread> > generators;
       std::vector<boost::shared_ptr<Thread     > > threads;
 
       for( uint32 i=0; i<m_num_threads; ++i ) {
-        boost::shared_ptr<BlockThread> generator( new BlockThread( info ) );
+        boost::shared_ptr<BlockThread> generator( new BlockThread( info, funcs ? (*funcs)[i] : m_func ) );
         generators.push_back( generator );
         boost::shared_ptr<Thread> thread( new Thread( generator ) );
         threads.push_back( thread );
@@ -169,6 +234,13 @@ namespace image_block {
       for( uint32 i=0; i<m_num_threads; ++i ) {
         threads[i]->join();
       }
+      check_complete( info );
+    }
+
+    /// Throw vw::Aborted if blocks were skipped because of the cancel token.
+    static void check_complete( typename BlockThread::Info const& info ) {
+      if( !info.complete() )
+        vw_throw( Aborted() << "BlockProcessor: cancelled" );
     }
 
   }; // End class BlockProcessor
@@ -215,8 +287,11 @@ namespace image_block {
     }
 
     /// Rasterize this object into memory from whatever its source is.
+    /// The pixels come from vw_buffer_pool() and go back to it when the
+    /// Cache evicts the block.
     boost::shared_ptr<value_type > generate() const {
-      boost::shared_ptr<value_type > ptr( new value_type( m_bbox.width(), m_bbox.height(), m_child->planes() ) );
+      boost::shared_ptr<value_type > ptr( new value_type() );
+      ptr->set_size( m_bbox.width(), m_bbox.height(), m_child->planes(), &vw_buffer_pool() );
       m_child->rasterize( *ptr, m_bbox );
       return ptr;
     }
@@ -323,6 +398,9 @@ namespace image_block {
       return m_block_table[ix + iy*m_table_width];
     }
 
+    /// Return the number of blocks across and down the image.
+    Vector2i table_size() const { return Vector2i(m_table_width, m_table_height); }
+
     /// Return true if there is only a single block
     bool only_one_block() const { return (m_block_table_size==1); }
 
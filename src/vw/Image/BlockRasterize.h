@@ -29,10 +29,14 @@
 #define __VW_IMAGE_BLOCKRASTERIZE_H__
 
 #include <vw/Core/Cache.h>
+#include <vw/Core/Profiler.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/BlockProcessor.h>
+#include <vw/Image/BlockPrefetcher.h>
+#include <vw/Image/SparseImageCheck.h>
+#include <vw/Image/TileSizeTuner.h>
 
 namespace vw {
 
@@ -94,6 +98,58 @@ namespace vw {
     ImageT      & child()       { return *m_child; }
     ImageT const& child() const { return *m_child; }
 
+    /// The region of the child which rasterizing the bbox reads.  With
+    /// a cache that is every block under the bbox, unless the blocks are
+    /// already in the cache.
+    BBox2i source_bbox( BBox2i const& bbox ) const {
+      if( !m_cache_ptr )
+        return bbox;
+      BBox2i view_bbox( 0, 0, cols(), rows() ), result = bbox;
+      result.crop( view_bbox );
+      if( result.empty() )
+        return result;
+      result.min() = Vector2i( result.min().x() / m_block_size.x() * m_block_size.x(),
+                               result.min().y() / m_block_size.y() * m_block_size.y() );
+      result.max() = Vector2i( (result.max().x() + m_block_size.x() - 1) / m_block_size.x() * m_block_size.x(),
+                               (result.max().y() + m_block_size.y() - 1) / m_block_size.y() * m_block_size.y() );
+      result.crop( view_bbox );
+      return result;
+    }
+
+    /// Once this token is cancelled, rasterize() stops starting new blocks
+    /// and throws vw::Aborted.  Copies of this view share the token.
+    void set_cancel_token( boost::shared_ptr<CancelToken> const& token ) { m_cancel_token = token; }
+    boost::shared_ptr<CancelToken> const& cancel_token() const { return m_cancel_token; }
+
+    /// The order in which rasterize() hands out blocks to its threads.
+    /// Row-major by default; a Hilbert or Z-order curve reuses more of
+    /// the Cache when the child reads source data around each block.
+    /// Copies of this view made afterwards keep the order.
+    void set_block_order( BlockOrder const& order ) { m_block_order = order; }
+    BlockOrder const& block_order() const { return m_block_order; }
+
+    /// Start reading the blocks of this view into its cache ahead of
+    /// rasterize(), visiting them in the given order on num_threads IO
+    /// threads.  The reads stay within lookahead blocks of the furthest
+    /// block rasterize() has reached, see BlockPrefetcher.  Requires a
+    /// cache.  Copies of this view made afterwards share the prefetcher,
+    /// which stops when the last of them is destroyed.
+    void prefetch( BlockPrefetcher::Order order, int num_threads = 2, size_t lookahead = 0 ) {
+      start_prefetch( BlockPrefetcher::traversal( order, m_block_manager.table_size() ),
+                      num_threads, lookahead );
+    }
+
+    /// Same, visiting the blocks under each region in turn.
+    void prefetch( std::vector<BBox2i> const& regions, int num_threads = 2, size_t lookahead = 0 ) {
+      start_prefetch( BlockPrefetcher::traversal( regions, m_block_size, m_block_manager.table_size() ),
+                      num_threads, lookahead );
+    }
+
+    /// Stop prefetching in this view; copies keep their prefetcher.
+    void stop_prefetch() { m_prefetcher.reset(); }
+
+    boost::shared_ptr<BlockPrefetcher> const& prefetcher() const { return m_prefetcher; }
+
     typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
       // Init output data
@@ -105,15 +161,45 @@ namespace vw {
     }
 
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      VW_PROFILE_ZONE("BlockRasterizeView::rasterize");
       // Create functor to rasterize this image into the destination image
       RasterizeFunctor<DestT> rasterizer( *this, dest, bbox.min() );
       // Set up block processor to call the functor in parallel blocks.
-      image_block::BlockProcessor<RasterizeFunctor<DestT> > process( rasterizer, m_block_size, m_num_threads );
+      image_block::BlockProcessor<RasterizeFunctor<DestT> > process( rasterizer, m_block_size, m_num_threads,
+                                                                     m_cancel_token, m_block_order );
       // Tell the block processor to do all the work.
       process(bbox);
     }
 
   private:
+    // Loads one block for the BlockPrefetcher.  Holds its own copy of
+    // the block table so that it does not depend on this view.
+    class PrefetchFunctor {
+      image_block::BlockGeneratorManager<ImageT> m_block_manager;
+    public:
+      PrefetchFunctor( image_block::BlockGeneratorManager<ImageT> const& manager )
+        : m_block_manager(manager) {}
+
+      bool operator()( Vector2i const& block_index ) const {
+        const Cache::Handle<image_block::BlockGenerator<ImageT> >& handle
+          = m_block_manager.block(block_index);
+        if ( handle.valid() )
+          return false;
+        handle.operator->();
+        handle.release();
+        return true;
+      }
+    };
+
+    void start_prefetch( std::vector<Vector2i> const& order, int num_threads, size_t lookahead ) {
+      VW_ASSERT( m_cache_ptr, LogicErr() << "BlockRasterizeView::prefetch: this view has no cache." );
+      size_t block_bytes = size_t(m_block_size.x()) * m_block_size.y() * planes() * sizeof(pixel_type);
+      m_prefetcher.reset(); // Stop the previous one first
+      m_prefetcher.reset( new BlockPrefetcher( order, m_block_manager.table_size(),
+                                               PrefetchFunctor( m_block_manager ), block_bytes,
+                                               *m_cache_ptr, num_threads, lookahead ) );
+    }
+
     // These function objects are spawned to rasterize the child image.
     // One functor is created per child thread, and they are called
     // in succession with bounding boxes that are each contained within one block.
@@ -131,9 +217,12 @@ namespace vw {
 #if VW_DEBUG_LEVEL > 1
         VW_OUT(VerboseDebugMessage, "image") << "BlockRasterizeView::RasterizeFunctor( " << bbox << " )" << std::endl;
 #endif
+        VW_PROFILE_ZONE("BlockRasterizeView::block");
         if( m_view.m_cache_ptr ) {
           // Ask the cache managing object to get the image tile, we might already have it.
           Vector2i block_index = m_view.m_block_manager.get_block_index(bbox);
+          if( m_view.m_prefetcher )
+            m_view.m_prefetcher->note_access( block_index );
 
           const Cache::Handle<image_block::BlockGenerator<ImageT> >& handle
             = m_view.m_block_manager.block(block_index);
@@ -155,30 +244,101 @@ namespace vw {
     Vector2i m_block_size;
     int32    m_num_threads;
     Cache   *m_cache_ptr;
+    boost::shared_ptr<CancelToken> m_cancel_token;
+    BlockOrder m_block_order;
+    boost::shared_ptr<BlockPrefetcher> m_prefetcher;
 
     /// This object keeps track of the BlockGenerator for each image tile (if using a cache)
     image_block::BlockGeneratorManager<ImageT> m_block_manager;
   };
 
-  /// Create a BlockRasterizeView with no caching.
+  template <class ImageT>
+  class SourceFootprint<BlockRasterizeView<ImageT> > {
+    BlockRasterizeView<ImageT> const& m_view;
+  public:
+    SourceFootprint(BlockRasterizeView<ImageT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      BBox2i src_bbox = m_view.source_bbox( bbox );
+      if( !src_bbox.empty() )
+        SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+    }
+  };
+
+  template <class ImageT>
+  class SparseImageCheck<BlockRasterizeView<ImageT> > {
+    BlockRasterizeView<ImageT> const& m_view;
+  public:
+    SparseImageCheck(BlockRasterizeView<ImageT> const& view) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( bbox );
+    }
+  };
+
+  /// Create a BlockRasterizeView with no caching.  An unset block size
+  /// is tuned if the auto_tile_size setting is on, see TileSizeTuner.h.
   template <class ImageT>
   inline BlockRasterizeView<ImageT> block_rasterize( ImageViewBase<ImageT> const& image,
                                                      Vector2i const& block_size, int num_threads = 0 ) {
-    return BlockRasterizeView<ImageT>( image.impl(), block_size, num_threads );
+    return BlockRasterizeView<ImageT>( image.impl(), auto_block_size( image, block_size, num_threads ), num_threads );
   }
 
-  /// Create a BlockRasterizeView using the vw system Cache object.
+  /// Create a BlockRasterizeView with no caching which stops early when
+  /// the token is cancelled.
+  template <class ImageT>
+  inline BlockRasterizeView<ImageT> block_rasterize( ImageViewBase<ImageT> const& image,
+                                                     Vector2i const& block_size, int num_threads,
+                                                     boost::shared_ptr<CancelToken> const& cancel_token ) {
+    BlockRasterizeView<ImageT> view( image.impl(), auto_block_size( image, block_size, num_threads ), num_threads );
+    view.set_cancel_token( cancel_token );
+    return view;
+  }
+
+  /// Create a BlockRasterizeView with no caching which visits the blocks
+  /// in the given order, see BlockRasterizeView::set_block_order().
+  template <class ImageT>
+  inline BlockRasterizeView<ImageT> block_rasterize( ImageViewBase<ImageT> const& image,
+                                                     Vector2i const& block_size, int num_threads,
+                                                     BlockOrder const& order ) {
+    BlockRasterizeView<ImageT> view( image.impl(), auto_block_size( image, block_size, num_threads ), num_threads );
+    view.set_block_order( order );
+    return view;
+  }
+
+  /// Create a BlockRasterizeView using the vw system Cache object.  An
+  /// unset block size is tuned as in block_rasterize().
   template <class ImageT>
   inline BlockRasterizeView<ImageT> block_cache( ImageViewBase<ImageT> const& image,
                                                  Vector2i const& block_size, int num_threads = 0 ) {
-    return BlockRasterizeView<ImageT>( image.impl(), block_size, num_threads, &vw_system_cache() );
+    return BlockRasterizeView<ImageT>( image.impl(), auto_block_size( image, block_size, num_threads ),
+                                       num_threads, &vw_system_cache() );
   }
 
   /// Create a BlockRasterizeView using the provided Cache object.
   template <class ImageT>
   inline BlockRasterizeView<ImageT> block_cache( ImageViewBase<ImageT> const& image,
                                                  Vector2i const& block_size, int num_threads, Cache& cache ) {
-    return BlockRasterizeView<ImageT>( image.impl(), block_size, num_threads, &cache );
+    return BlockRasterizeView<ImageT>( image.impl(), auto_block_size( image, block_size, num_threads ),
+                                       num_threads, &cache );
+  }
+
+  /// Share a view between several consumers, such as a filtered image
+  /// read by both correlation and subpixel refinement, so that each
+  /// block of it is computed once.  The blocks live in the Cache, and
+  /// every copy of the returned view, in an ImageViewRef or inside
+  /// another view, finds them there: build it once and pass it to all
+  /// the consumers.  Requests of any size are cut from the aligned
+  /// blocks, so consumers reading different margins still share them.
+  /// The blocks are computed in the calling thread since the consumers
+  /// are usually rasterized in parallel themselves.  The block size
+  /// defaults to a tuned one with the auto_tile_size setting, or else
+  /// to the default tile size.
+  template <class ImageT>
+  inline BlockRasterizeView<ImageT> share( ImageViewBase<ImageT> const& image,
+                                           Vector2i block_size = Vector2i(), Cache& cache = vw_system_cache() ) {
+    block_size = auto_block_size( image, block_size, 1 );
+    if( block_size.x() <= 0 || block_size.y() <= 0 )
+      block_size = Vector2i( vw_settings().default_tile_size(), vw_settings().default_tile_size() );
+    return BlockRasterizeView<ImageT>( image.impl(), block_size, 1, &cache );
   }
 
 } // namespace vw
@@ -0,0 +1,136 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Image/BlockWriteJournal.h>
+#include <vw/Image/ImageResource.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+
+#include <cstdio>
+#include <sstream>
+
+namespace vw {
+
+  std::string block_write_journal_file( std::string const& filename ) {
+    return filename + ".vwjournal";
+  }
+
+  BlockWriteJournal::BlockWriteJournal( std::string const& filename, Vector2i const& image_size,
+                                        Vector2i const& block_size, bool resume,
+                                        double checkpoint_interval )
+    : m_filename(filename), m_image_size(image_size), m_block_size(block_size),
+      m_checkpoint_interval(checkpoint_interval), m_num_done(0), m_last_checkpoint(std::time(0)) {
+    VW_ASSERT( block_size.x() > 0 && block_size.y() > 0,
+               ArgumentErr() << "BlockWriteJournal: The block size must be positive." );
+    m_table_size = Vector2i( (image_size.x() + block_size.x() - 1) / block_size.x(),
+                             (image_size.y() + block_size.y() - 1) / block_size.y() );
+    m_done.resize( size_t(m_table_size.x()) * m_table_size.y(), 0 );
+
+    std::ifstream existing( filename.c_str() );
+    if ( resume && existing ) {
+      std::string magic, key1, key2;
+      Vector2i size, block;
+      if ( !( existing >> magic >> key1 >> size[0] >> size[1] >> key2 >> block[0] >> block[1] ) ||
+           magic != "vw_block_journal" || key1 != "image_size" || key2 != "block_size" )
+        vw_throw( IOErr() << "BlockWriteJournal: " << filename << " is not a block journal." );
+      if ( size != image_size || block != block_size )
+        vw_throw( ArgumentErr() << "BlockWriteJournal: " << filename << " journals a "
+                                << size.x() << "x" << size.y() << " image in " << block.x() << "x" << block.y()
+                                << " blocks, not a " << image_size.x() << "x" << image_size.y() << " image in "
+                                << block_size.x() << "x" << block_size.y() << " blocks." );
+      // A line cut short by a crash is not a block.
+      std::string line;
+      std::getline( existing, line );
+      while ( std::getline( existing, line ) ) {
+        std::istringstream fields( line );
+        int32 i, j;
+        char end;
+        if ( !( fields >> i >> j ) || fields >> end ||
+             i < 0 || j < 0 || i >= m_table_size.x() || j >= m_table_size.y() )
+          break;
+        uint8& done = m_done[ size_t(j)*m_table_size.x() + i ];
+        if ( !done ) {
+          done = 1;
+          ++m_num_done;
+        }
+      }
+      existing.close();
+      VW_OUT(InfoMessage, "image") << "Resuming the write journaled in " << filename << ": "
+                                   << m_num_done << " of " << m_done.size() << " blocks are done.\n";
+      // Start a clean file, so that a line cut short is not followed by more.
+      std::string temp = filename + ".tmp";
+      {
+        std::ofstream rewrite( temp.c_str() );
+        rewrite << "vw_block_journal\nimage_size " << image_size.x() << " " << image_size.y()
+                << "\nblock_size " << block_size.x() << " " << block_size.y() << "\n";
+        for ( int32 j = 0; j < m_table_size.y(); ++j )
+          for ( int32 i = 0; i < m_table_size.x(); ++i )
+            if ( done( Vector2i(i,j) ) )
+              rewrite << i << " " << j << "\n";
+        if ( !rewrite )
+          vw_throw( IOErr() << "BlockWriteJournal: Could not write " << temp << "." );
+      }
+      if ( std::rename( temp.c_str(), filename.c_str() ) != 0 )
+        vw_throw( IOErr() << "BlockWriteJournal: Could not replace " << filename << "." );
+      m_file.open( filename.c_str(), std::ios::app );
+    } else {
+      existing.close();
+      m_file.open( filename.c_str(), std::ios::trunc );
+      m_file << "vw_block_journal\nimage_size " << image_size.x() << " " << image_size.y()
+             << "\nblock_size " << block_size.x() << " " << block_size.y() << "\n";
+      m_file.flush();
+    }
+    if ( !m_file )
+      vw_throw( IOErr() << "BlockWriteJournal: Could not write " << filename << "." );
+  }
+
+  void BlockWriteJournal::complete( BBox2i const& bbox ) {
+    m_pending.push_back( Vector2i( bbox.min().x() / m_block_size.x(), bbox.min().y() / m_block_size.y() ) );
+  }
+
+  void BlockWriteJournal::checkpoint_if_due( DstImageResource& resource ) {
+    if ( !m_pending.empty() && std::difftime( std::time(0), m_last_checkpoint ) >= m_checkpoint_interval )
+      checkpoint( resource );
+  }
+
+  void BlockWriteJournal::checkpoint( DstImageResource& resource ) {
+    m_last_checkpoint = std::time(0);
+    if ( m_pending.empty() )
+      return;
+    resource.sync();
+    for ( size_t k = 0; k < m_pending.size(); ++k ) {
+      Vector2i const& block = m_pending[k];
+      m_file << block.x() << " " << block.y() << "\n";
+      uint8& done = m_done[ size_t(block.y())*m_table_size.x() + block.x() ];
+      if ( !done ) {
+        done = 1;
+        ++m_num_done;
+      }
+    }
+    m_file.flush();
+    if ( !m_file )
+      vw_throw( IOErr() << "BlockWriteJournal: Could not write " << m_filename << "." );
+    m_pending.clear();
+  }
+
+  void BlockWriteJournal::remove() {
+    m_file.close();
+    std::remove( m_filename.c_str() );
+  }
+
+} // namespace vw
@@ -0,0 +1,103 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BlockWriteJournal.h
+///
+/// A record of the blocks of a block_write_image() call which have
+/// reached storage, kept in a file next to the output, so that a write
+/// which dies part of the way through can be resumed rather than
+/// started over.
+///
+#ifndef __VW_IMAGE_BLOCKWRITEJOURNAL_H__
+#define __VW_IMAGE_BLOCKWRITEJOURNAL_H__
+
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+
+namespace vw {
+
+  class DstImageResource;
+
+  /// The file which journals the blocks of a write to the given file.
+  std::string block_write_journal_file( std::string const& filename );
+
+  /// The blocks of an image written so far, in units of the block size.
+  ///
+  /// block_write_image() marks each block complete() once the resource
+  /// has it, and every checkpoint interval it has the resource sync()
+  /// the blocks to storage before appending them to the journal file.
+  /// A block in the file is thus in the output even if the process dies
+  /// right after; at most the last interval's blocks are written again.
+  class BlockWriteJournal : private boost::noncopyable {
+  public:
+    /// Journals a write of an image of image_size pixels in blocks of
+    /// block_size.  With resume set, the blocks recorded in an existing
+    /// file are kept, and ArgumentErr is thrown if it journals another
+    /// image or block size.  Otherwise the file is started afresh.
+    BlockWriteJournal( std::string const& filename, Vector2i const& image_size,
+                       Vector2i const& block_size, bool resume,
+                       double checkpoint_interval = 30 );
+
+    std::string const& filename  () const { return m_filename;   }
+    Vector2i    const& image_size() const { return m_image_size; }
+    Vector2i    const& block_size() const { return m_block_size; }
+    /// The number of blocks across and down.
+    Vector2i    const& table_size() const { return m_table_size; }
+
+    /// Whether a block is recorded in the journal file.
+    bool done( Vector2i const& block ) const {
+      return m_done[ size_t(block.y())*m_table_size.x() + block.x() ] != 0;
+    }
+    size_t num_done() const { return m_num_done; }
+
+    /// Notes that the resource has been given the block at bbox.  It is
+    /// recorded at the next checkpoint.
+    void complete( BBox2i const& bbox );
+
+    /// Syncs the resource and records the blocks completed since the
+    /// last checkpoint, if the interval has passed since then.
+    void checkpoint_if_due( DstImageResource& resource );
+
+    /// Syncs the resource and records the blocks completed so far.
+    void checkpoint( DstImageResource& resource );
+
+    /// Deletes the journal file, once the output is complete and flushed.
+    void remove();
+
+  private:
+    std::string m_filename;
+    Vector2i m_image_size, m_block_size, m_table_size;
+    double m_checkpoint_interval;
+    std::vector<uint8> m_done;
+    size_t m_num_done;
+    std::vector<Vector2i> m_pending;
+    std::time_t m_last_checkpoint;
+    std::ofstream m_file;
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_BLOCKWRITEJOURNAL_H__
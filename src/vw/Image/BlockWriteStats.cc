@@ -0,0 +1,72 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Image/BlockWriteStats.h>
+#include <vw/Core/Exception.h>
+
+#include <fstream>
+
+namespace vw {
+
+  void BlockWriteStats::start( Vector2i const& image_size, Vector2i const& block_size ) {
+    VW_ASSERT( block_size.x() > 0 && block_size.y() > 0,
+               ArgumentErr() << "BlockWriteStats: The block size must be positive." );
+    m_image_size = image_size;
+    m_block_size = block_size;
+    m_table_size = Vector2i( (image_size.x() + block_size.x() - 1) / block_size.x(),
+                             (image_size.y() + block_size.y() - 1) / block_size.y() );
+    m_records.assign( size_t(m_table_size.x()) * m_table_size.y(), BlockWriteRecord() );
+  }
+
+  void BlockWriteStats::write_csv( std::string const& filename ) const {
+    std::ofstream out( filename.c_str() );
+    out << "col,row,x,y,width,height,rasterize_ms,write_ms,cache_misses,bytes\n";
+    for ( int32 j = 0; j < m_table_size.y(); ++j ) {
+      for ( int32 i = 0; i < m_table_size.x(); ++i ) {
+        BlockWriteRecord const& r = record( i, j );
+        if ( !r.written() )
+          continue;
+        out << i << "," << j << "," << r.bbox.min().x() << "," << r.bbox.min().y() << ","
+            << r.bbox.width() << "," << r.bbox.height() << "," << r.rasterize_ms << ","
+            << r.write_ms << "," << r.cache_misses << "," << r.bytes << "\n";
+      }
+    }
+    if ( !out )
+      vw_throw( IOErr() << "BlockWriteStats: Could not write " << filename << "." );
+  }
+
+  ImageView<float> BlockWriteStats::heatmap() const {
+    ImageView<float> image( m_table_size.x(), m_table_size.y(), 4 );
+    for ( int32 j = 0; j < m_table_size.y(); ++j ) {
+      for ( int32 i = 0; i < m_table_size.x(); ++i ) {
+        BlockWriteRecord const& r = record( i, j );
+        if ( !r.written() ) {
+          for ( int32 p = 0; p < 4; ++p )
+            image(i,j,p) = heatmap_nodata();
+          continue;
+        }
+        image(i,j,0) = float( r.rasterize_ms );
+        image(i,j,1) = float( r.write_ms );
+        image(i,j,2) = float( r.cache_misses );
+        image(i,j,3) = float( r.bytes );
+      }
+    }
+    return image;
+  }
+
+} // namespace vw
@@ -0,0 +1,99 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BlockWriteStats.h
+///
+/// Per-block timings of a block_write_image() call, for finding the
+/// regions of an image which are expensive to compute, such as steep
+/// terrain in stereo or deep overlap in a mosaic, and for tuning the
+/// block size.
+///
+#ifndef __VW_IMAGE_BLOCKWRITESTATS_H__
+#define __VW_IMAGE_BLOCKWRITESTATS_H__
+
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+#include <vw/Image/ImageView.h>
+
+namespace vw {
+
+  /// What one block of a write cost.
+  struct BlockWriteRecord {
+    BBox2i bbox;         ///< Empty if the block was not written
+    double rasterize_ms; ///< Rasterizing the block, or filling it if it was empty
+    double write_ms;     ///< Encoding the block and handing it to the resource
+    uint64 cache_misses; ///< Cache misses on the rasterizing thread while rasterizing
+    uint64 bytes;        ///< Bytes of pixels handed to the resource
+
+    BlockWriteRecord() : rasterize_ms(0), write_ms(0), cache_misses(0), bytes(0) {}
+    bool written() const { return !bbox.empty(); }
+  };
+
+  /// The BlockWriteRecord of every block of an image written by
+  /// block_write_image(), laid out as the blocks are.
+  ///
+  /// The cache misses only count the thread which rasterizes the block,
+  /// not any threads the view itself hands work to.
+  class BlockWriteStats : private boost::noncopyable {
+  public:
+    BlockWriteStats() {}
+
+    /// Clears the records for a write of an image of image_size pixels
+    /// in blocks of block_size.  block_write_image() calls this.
+    void start( Vector2i const& image_size, Vector2i const& block_size );
+
+    Vector2i const& image_size() const { return m_image_size; }
+    Vector2i const& block_size() const { return m_block_size; }
+    /// The number of blocks across and down.
+    Vector2i const& table_size() const { return m_table_size; }
+
+    /// The record of the block at bbox.  Each block is filled in by its
+    /// rasterizing task and then by its write task, so no lock is needed.
+    BlockWriteRecord& record( BBox2i const& bbox ) {
+      return m_records[ size_t(bbox.min().y() / m_block_size.y()) * m_table_size.x()
+                        + bbox.min().x() / m_block_size.x() ];
+    }
+    /// The record of block (i,j), in units of the block size.
+    BlockWriteRecord const& record( int32 i, int32 j ) const {
+      return m_records[ size_t(j) * m_table_size.x() + i ];
+    }
+
+    /// Writes a CSV file with a header line and one line per block written:
+    /// col,row,x,y,width,height,rasterize_ms,write_ms,cache_misses,bytes
+    void write_csv( std::string const& filename ) const;
+
+    /// The stats as an image with one pixel per block and four planes:
+    /// rasterize ms, write ms, cache misses and bytes.  Blocks which were
+    /// not written are heatmap_nodata().
+    ImageView<float> heatmap() const;
+    static float heatmap_nodata() { return -1; }
+
+  private:
+    Vector2i m_image_size, m_block_size, m_table_size;
+    std::vector<BlockWriteRecord> m_records;
+  };
+
+} // namespace vw
+
+#endif // __VW_IMAGE_BLOCKWRITESTATS_H__
@@ -0,0 +1,161 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// CensusTransform.cc
+///
+/// Whole image census descriptors and fast Hamming distances.
+///
+#include <vw/config.h>
+#include <vw/Core/CpuFeatures.h>
+#include <vw/Core/Exception.h>
+#include <vw/Image/CensusTransform.h>
+
+#include <vector>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define VW_CENSUS_X86_DISPATCH 1
+  #include <immintrin.h> // Only used after checking the CPU
+#endif
+
+namespace vw {
+
+namespace {
+
+  typedef std::vector<std::pair<int,int> > OffsetList;
+
+  /// Kernel offsets in the order used by the dense census functions: the
+  /// lowest bit is the bottom right pixel, going backwards to the top left.
+  OffsetList dense_census_offsets(int half_kernel) {
+    OffsetList offsets;
+    for (int r=half_kernel; r>=-half_kernel; --r) {
+      for (int c=half_kernel; c>=-half_kernel; --c) {
+        if ((r == 0) && (c == 0)) // Skip the central pixel
+          continue;
+        offsets.push_back(std::make_pair(c, r));
+      }
+    }
+    return offsets;
+  }
+
+  /// The sparse 32 position patterns, see get_census_value_9x9() and
+  /// get_census_value_ternary_7x7().
+  OffsetList sparse_census_offsets(int kernel_size) {
+    static const int cols9[32] = {0,4,8, 1,3,5,7, 2,4,6, 1,4,7, 0,2,3,5,6,8, 1,4,7, 2,4,6, 1,3,5,7, 0,4,8};
+    static const int rows9[32] = {0,0,0, 1,1,1,1, 2,2,2, 3,3,3, 4,4,4,4,4,4, 5,5,5, 6,6,6, 7,7,7,7, 8,8,8};
+    static const int cols7[32] = {0,2,3,4,6, 1,3,5, 0,2,3,4,6, 0,1,2,4,5,6, 0,2,3,4,6, 1,3,5, 0,2,3,4,6};
+    static const int rows7[32] = {0,0,0,0,0, 1,1,1, 2,2,2,2,2, 3,3,3,3,3,3, 4,4,4,4,4, 5,5,5, 6,6,6,6,6};
+    const int* cols = (kernel_size == 9) ? cols9 : cols7;
+    const int* rows = (kernel_size == 9) ? rows9 : rows7;
+    const int half_kernel = kernel_size / 2;
+    OffsetList offsets;
+    for (int i=0; i<32; ++i)
+      offsets.push_back(std::make_pair(cols[i]-half_kernel, rows[i]-half_kernel));
+    return offsets;
+  }
+
+  void hamming_distances_generic(uint64 left, uint64 const* right, int count, uint8* costs) {
+    for (int i=0; i<count; ++i)
+      costs[i] = static_cast<uint8>(hamming_distance(left, right[i]));
+  }
+
+#if defined(VW_CENSUS_X86_DISPATCH)
+  __attribute__((target("popcnt")))
+  void hamming_distances_popcnt(uint64 left, uint64 const* right, int count, uint8* costs) {
+    for (int i=0; i<count; ++i)
+      costs[i] = static_cast<uint8>(__builtin_popcountll(left ^ right[i]));
+  }
+
+  /// Eight descriptors at a time, the tail is handled with a masked load and store.
+  __attribute__((target("avx512f,avx512vpopcntdq")))
+  void hamming_distances_avx512(uint64 left, uint64 const* right, int count, uint8* costs) {
+    const __m512i _left = _mm512_set1_epi64(static_cast<long long>(left));
+    for (int i=0; i<count; i+=8) {
+      const __mmask8 mask = (count-i >= 8) ? __mmask8(0xFF) : __mmask8((1u << (count-i)) - 1);
+      __m512i _right = _mm512_maskz_loadu_epi64(mask, right+i);
+      __m512i _dist  = _mm512_popcnt_epi64(_mm512_xor_si512(_left, _right));
+      _mm512_mask_cvtepi64_storeu_epi8(costs+i, mask, _dist);
+    }
+  }
+#endif
+
+  typedef void (*HammingFunc)(uint64, uint64 const*, int, uint8*);
+
+  CpuDispatch<HammingFunc> hamming_dispatch() {
+    CpuDispatch<HammingFunc> dispatch(&hamming_distances_generic);
+#if defined(VW_CENSUS_X86_DISPATCH)
+    dispatch.add(CPU_AVX512F | CPU_AVX512VPOPCNTDQ, &hamming_distances_avx512)
+            .add(CPU_POPCNT,                        &hamming_distances_popcnt);
+#endif
+    return dispatch;
+  }
+
+} // end anonymous namespace
+
+
+ImageView<uint64> census_descriptor_image(ImageView<uint8> const& image, int kernel_size,
+                                          bool ternary, int diff_threshold) {
+  VW_ASSERT((kernel_size == 3) || (kernel_size == 5) || (kernel_size == 7) || (kernel_size == 9),
+            ArgumentErr() << "census_descriptor_image: Kernel size must be 3, 5, 7, or 9.");
+  const int half_kernel = kernel_size / 2;
+  VW_ASSERT((image.cols() > 2*half_kernel) && (image.rows() > 2*half_kernel),
+            ArgumentErr() << "census_descriptor_image: Image smaller than the kernel.");
+
+  // The 9x9 kernels and the ternary 7x7 kernel use a sparse pattern
+  const bool sparse = (kernel_size == 9) || (ternary && (kernel_size == 7));
+  const OffsetList offsets = sparse ? sparse_census_offsets(kernel_size)
+                                    : dense_census_offsets(half_kernel);
+  const int num_offsets = static_cast<int>(offsets.size());
+
+  ImageView<uint64> output(image.cols()-2*half_kernel, image.rows()-2*half_kernel);
+  const int width = output.cols();
+  for (int row=0; row<output.rows(); ++row) {
+    uint64* out = &output(0, row);
+    std::fill(out, out+width, uint64(0));
+    const uint8* center = &image(half_kernel, row+half_kernel);
+
+    // For each kernel position, compare the whole row with the centers.
+    for (int i=0; i<num_offsets; ++i) {
+      const uint8* other = &image(half_kernel+offsets[i].first, row+half_kernel+offsets[i].second);
+      if (!ternary) {
+        for (int col=0; col<width; ++col)
+          out[col] |= uint64(other[col] > center[col]) << i;
+      } else {
+        // 00 for the low range, 01 for the middle range, 11 for the high range.
+        const int shift = 2*i;
+        for (int col=0; col<width; ++col) {
+          const int val  = other[col];
+          const int low  = int(center[col]) - diff_threshold;
+          const int high = int(center[col]) + diff_threshold;
+          // Branch free so that the loop vectorizes.
+          const uint64 ge   = uint64(val >= low);
+          const uint64 bits = ge | ((ge & uint64(val > high)) << 1);
+          out[col] |= bits << shift;
+        }
+      }
+    }
+  }
+  return output;
+}
+
+void census_hamming_distances(uint64 left, uint64 const* right, int count, uint8* costs) {
+  static const CpuDispatch<HammingFunc> dispatch = hamming_dispatch();
+  dispatch.select()(left, right, count, costs);
+}
+
+} // end namespace vw
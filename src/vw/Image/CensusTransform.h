@@ -17,12 +17,8 @@
 
 #include <vw/Math/Functions.h>
 #include <vw/Image/ImageView.h>
-
-// TODO: Use SSE to accelerate this operation
-//#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-//  #include <emmintrin.h>
-//  #include <smmintrin.h> // SSE4.1
-//#endif
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
 
 /**
   Tools for computing the Census Transform of an image and comparing transformed pixels
@@ -51,8 +47,79 @@ inline uint64 get_census_value_ternary_7x7(ImageView<uint8> const& image, int co
 inline uint64 get_census_value_ternary_9x9(ImageView<uint8> const& image, int col, int row, int diff_threshold=2);
 
 
-// If we need a function to compute the costs of an entire image, this is a good
-//  location for it!
+/// Compute the census descriptor of every pixel in an image, packed into one
+/// uint64 per pixel.
+/// - The bits match the get_census_value_* (or get_census_value_ternary_*)
+///   function for the same kernel size, which must be 3, 5, 7 or 9.
+/// - The output is kernel_size-1 pixels smaller than the input in each
+///   direction.  Output pixel (0,0) describes input pixel (h,h), h = kernel_size/2.
+/// - Much faster than calling the single pixel functions since the comparisons
+///   for each kernel position run along whole rows.
+ImageView<uint64> census_descriptor_image(ImageView<uint8> const& image, int kernel_size,
+                                          bool ternary=false, int diff_threshold=2);
+
+/// A view of the packed census descriptor of each pixel of an 8 bit image,
+/// see census_descriptor_image().
+/// - Pixel (c,r) holds the descriptor of input pixel (c,r).  The input is
+///   extended with ConstantEdgeExtension to describe the border pixels.
+/// - Each tile is computed with census_descriptor_image().  Wrap the view
+///   in block_cache() to compute the descriptors once and share them between
+///   several users of the same image.
+template <class ImageT>
+class CensusImageView : public ImageViewBase<CensusImageView<ImageT> > {
+  ImageT m_image;
+  int    m_kernel_size;
+  bool   m_ternary;
+  int    m_diff_threshold;
+public:
+  typedef uint64 pixel_type;
+  typedef uint64 result_type;
+  typedef ProceduralPixelAccessor<CensusImageView> pixel_accessor;
+
+  CensusImageView(ImageT const& image, int kernel_size, bool ternary, int diff_threshold)
+    : m_image(image), m_kernel_size(kernel_size), m_ternary(ternary),
+      m_diff_threshold(diff_threshold) {
+    VW_ASSERT((kernel_size == 3) || (kernel_size == 5) || (kernel_size == 7) || (kernel_size == 9),
+              ArgumentErr() << "CensusImageView: Kernel size must be 3, 5, 7, or 9.");
+  }
+
+  inline int32 cols  () const { return m_image.cols(); }
+  inline int32 rows  () const { return m_image.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+
+  /// Slow, computes a single pixel tile.
+  inline result_type operator()(int32 i, int32 j, int32 /*p*/=0) const {
+    return prerasterize(BBox2i(i, j, 1, 1))(i, j);
+  }
+
+  typedef CropView<ImageView<uint64> > prerasterize_type;
+  inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+    BBox2i src_bbox = bbox;
+    src_bbox.expand(m_kernel_size/2);
+    ImageView<uint8> src = crop(edge_extend(m_image, ConstantEdgeExtension()), src_bbox);
+    ImageView<uint64> codes = census_descriptor_image(src, m_kernel_size,
+                                                      m_ternary, m_diff_threshold);
+    return prerasterize_type(codes, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+  }
+
+  template <class DestT>
+  inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+    vw::rasterize(prerasterize(bbox), dest, bbox);
+  }
+};
+
+/// Create a CensusImageView.
+template <class ImageT>
+CensusImageView<ImageT> census_image(ImageViewBase<ImageT> const& image, int kernel_size,
+                                     bool ternary=false, int diff_threshold=2) {
+  return CensusImageView<ImageT>(image.impl(), kernel_size, ternary, diff_threshold);
+}
+
+/// Compute costs[i] = hamming_distance(left, right[i]) for each i < count.
+/// - Uses AVX-512 or the popcnt instruction when the CPU supports them.
+void census_hamming_distances(uint64 left, uint64 const* right, int count, uint8* costs);
 
 
 //============================================================================
@@ -25,13 +25,20 @@
 #ifndef __VW_IMAGE_CONVOLUTION_H__
 #define __VW_IMAGE_CONVOLUTION_H__
 
+#include <cmath>
 #include <vector>
 #include <iterator>
 
+#include <boost/shared_ptr.hpp>
+#include <boost/mpl/and.hpp>
+#include <boost/mpl/or.hpp>
+#include <boost/type_traits/is_same.hpp>
+
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/PixelMask.h>
+#include <vw/Math/FFT.h>
 
 namespace vw {
 
@@ -89,6 +96,99 @@ namespace vw {
     return result;
   }
 
+  /// How ConvolutionView and SeparableConvolutionView convolve a block.
+  enum ConvolutionMethod {
+    AutoConvolution,   ///< FFT for kernels of at least a threshold size, else direct
+    DirectConvolution, ///< Sum the kernel taps at each pixel
+    FFTConvolution     ///< Transform the block (overlap-save along rows and
+                       ///< columns if separable).  Only float and double
+                       ///< pixels; the others are always convolved directly.
+  };
+
+  namespace detail {
+
+    /// Whether AutoConvolution transforms a kernel of kernel_cols x
+    /// kernel_rows taps.  This depends on the kernel alone, so that the
+    /// output does not depend on how the view is tiled.
+    bool fft_convolution_pays_2d( size_t kernel_cols, size_t kernel_rows );
+
+    /// The same for one axis of a separable kernel, of kernel_size taps.
+    bool fft_convolution_pays_1d( size_t kernel_size );
+
+    /// The valid part of a direct 1D convolution, as math::FFTConvolver1D.
+    void direct_convolve_1d( double const* src, size_t src_size, size_t src_stride,
+                             std::vector<double> const& kernel, double* out );
+
+    /// Smooths lines of n values stride apart, line_stride between the
+    /// starts of the lines, in place with the recursive Gaussian filter
+    /// of Young and van Vliet.  sigma must be at least 0.5.
+    void recursive_gaussian_1d( double* data, size_t n, size_t stride,
+                                size_t lines, size_t line_stride, double sigma );
+
+    /// Pixels of float or double channels, laid out as flat arrays of
+    /// channels, which the FFT paths may convolve a channel at a time.
+    template <class PixelT, class KernelT>
+    struct IsFFTConvolvable {
+      typedef typename PixelChannelType<PixelT>::type channel_type;
+      typedef typename boost::mpl::and_<
+        boost::mpl::or_< boost::is_same<KernelT, float>, boost::is_same<KernelT, double> >,
+        boost::mpl::or_< boost::is_same<channel_type, float>, boost::is_same<channel_type, double> >,
+        boost::mpl::or_< boost::is_same<PixelT, channel_type>,
+                         boost::is_same<PixelT, PixelGray <channel_type> >,
+                         boost::is_same<PixelT, PixelGrayA<channel_type> >,
+                         boost::is_same<PixelT, PixelRGB  <channel_type> >,
+                         boost::is_same<PixelT, PixelRGBA <channel_type> > > >::type type;
+    };
+
+    /// Channel c of plane p of an image of flat pixels, row by row, as doubles.
+    template <class PixelT>
+    void get_channel( ImageView<PixelT> const& image, int32 p, int32 c, std::vector<double>& out ) {
+      typedef typename PixelChannelType<PixelT>::type channel_type;
+      const int32 nch = PixelNumChannels<PixelT>::value;
+      const size_t n = size_t(image.cols()) * image.rows();
+      channel_type const* src = reinterpret_cast<channel_type const*>( &image(0,0,p) );
+      out.resize( n );
+      for( size_t i=0; i<n; ++i )
+        out[i] = double( src[i*nch + c] );
+    }
+
+    /// The inverse of get_channel().
+    template <class PixelT>
+    void set_channel( ImageView<PixelT>& image, int32 p, int32 c, std::vector<double> const& in ) {
+      typedef typename PixelChannelType<PixelT>::type channel_type;
+      const int32 nch = PixelNumChannels<PixelT>::value;
+      const size_t n = size_t(image.cols()) * image.rows();
+      channel_type* dst = reinterpret_cast<channel_type*>( &image(0,0,p) );
+      for( size_t i=0; i<n; ++i )
+        dst[i*nch + c] = channel_cast_clamp_if_int<channel_type>( in[i] );
+    }
+
+    /// Multiply-accumulate one kernel tap across a row of channels,
+    /// acc[i] += k*src[i] for i < n.  These are vectorized when VW is
+    /// built with VW_ENABLE_SSE.
+    void accumulate_tap( float* acc, uint8  const* src, float k, size_t n );
+    void accumulate_tap( float* acc, uint16 const* src, float k, size_t n );
+    void accumulate_tap( float* acc, float  const* src, float k, size_t n );
+
+    /// Whether SeparableConvolutionView may treat rows of PixelT as
+    /// flat arrays of channels and convolve them with accumulate_tap().
+    template <class PixelT, class KernelT>
+    struct IsFlatConvolvable {
+      typedef typename PixelChannelType<PixelT>::type channel_type;
+      typedef typename boost::mpl::and_<
+        boost::is_same<KernelT, float>,
+        boost::mpl::or_< boost::is_same<channel_type, uint8>,
+                         boost::is_same<channel_type, uint16>,
+                         boost::is_same<channel_type, float> >,
+        boost::mpl::or_< boost::is_same<PixelT, channel_type>,
+                         boost::is_same<PixelT, PixelGray <channel_type> >,
+                         boost::is_same<PixelT, PixelGrayA<channel_type> >,
+                         boost::is_same<PixelT, PixelRGB  <channel_type> >,
+                         boost::is_same<PixelT, PixelRGBA <channel_type> > > >::type type;
+    };
+
+  } // namespace detail
+
   /// \endcond
 
 
@@ -109,6 +209,7 @@ namespace vw {
     EdgeT  m_edge;     ///< Edge extension type
     Rotate180View<KernelT> m_kernel; ///< The kernel
     int32  m_ci, m_cj; ///< Kernel origin
+    ConvolutionMethod m_method;
 
   public:
     typedef typename ImageT::pixel_type pixel_type;  ///< The pixel type of the image view.
@@ -119,13 +220,13 @@ namespace vw {
     /// with the origin of the kernel located at the point (ci,cj).
     ConvolutionView( ImageT const& image, KernelT const& kernel, 
                      int32 ci, int32 cj, EdgeT const& edge = EdgeT() )
-      : m_image(image), m_edge(edge), m_kernel(kernel), m_ci(ci), m_cj(cj) {}
+      : m_image(image), m_edge(edge), m_kernel(kernel), m_ci(ci), m_cj(cj), m_method(AutoConvolution) {}
 
     /// Constructs a ConvolutionView with the given image and kernel and with the origin 
     ///  of the kernel located at the center.
     ConvolutionView( ImageT const& image, KernelT const& kernel, EdgeT const& edge = EdgeT() )
       : m_image(image), m_edge(edge), m_kernel(kernel), 
-        m_ci((kernel.cols()-1)/2), m_cj((kernel.rows()-1)/2) {}
+        m_ci((kernel.cols()-1)/2), m_cj((kernel.rows()-1)/2), m_method(AutoConvolution) {}
 
     inline int32 cols  () const { return m_image.cols  (); }
     inline int32 rows  () const { return m_image.rows  (); }
@@ -151,24 +252,96 @@ namespace vw {
       }
     }
 
-    typedef ConvolutionView<CropView<ImageView<typename ImageT::pixel_type> >, KernelT, NoEdgeExtension> prerasterize_type;
-    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
-      // Compute the required base of support for the input bounding box
+    ImageT const& child() const { return m_image; }
+    EdgeT  const& edge () const { return m_edge;  }
+
+    /// How blocks are convolved, AutoConvolution by default.
+    ConvolutionMethod method() const { return m_method; }
+    void set_method( ConvolutionMethod method ) { m_method = method; }
+
+    /// The base of support of the bbox in the edge extended child.
+    BBox2i source_bbox( BBox2i const& bbox ) const {
       int32  ci = (m_kernel.cols()-1-m_ci), 
              cj = (m_kernel.rows()-1-m_cj);
-      BBox2i src_bbox( bbox.min().x() - ci, bbox.min().y() - cj,
-                       bbox.width () + (m_kernel.cols()-1), 
-                       bbox.height() + (m_kernel.rows()-1) );
+      return BBox2i( bbox.min().x() - ci, bbox.min().y() - cj,
+                     bbox.width () + (m_kernel.cols()-1), 
+                     bbox.height() + (m_kernel.rows()-1) );
+    }
+
+    /// \cond INTERNAL
+
+    // The bbox is rasterized up front, as the FFT can only produce all
+    // of it at once.
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), m_image.planes() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >( dest, BBox2i(-bbox.min().x(), -bbox.min().y(),
+                                                            m_image.cols(), m_image.rows()) );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      if( bbox.width() > 0 && bbox.height() > 0 && use_fft() )
+        rasterize_fft( dest, bbox, typename detail::IsFFTConvolvable<pixel_type, typename KernelT::pixel_type>::type() );
+      else
+        vw::rasterize( prerasterize_direct(bbox), dest, bbox );
+    }
+
+    typedef ConvolutionView<CropView<ImageView<pixel_type> >, KernelT, NoEdgeExtension> direct_type;
+    inline direct_type prerasterize_direct( BBox2i const& bbox ) const {
+      // Compute the required base of support for the input bounding box
+      BBox2i src_bbox = source_bbox( bbox );
       // Take an edge extended image view of the input support region
-      ImageView<typename ImageT::pixel_type> src = edge_extend( m_image, src_bbox, m_edge );
+      ImageView<pixel_type> src = edge_extend( m_image, src_bbox, m_edge );
       // Use the crop trick to fake that the support region is the same size as the entire image.
-      return prerasterize_type( crop( src, -src_bbox.min().x(), -src_bbox.min().y(), m_image.cols(), m_image.rows() ),
-                                m_kernel.child(), m_ci, m_cj, NoEdgeExtension() );
+      return direct_type( crop( src, -src_bbox.min().x(), -src_bbox.min().y(), m_image.cols(), m_image.rows() ),
+                          m_kernel.child(), m_ci, m_cj, NoEdgeExtension() );
     }
 
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
-      vw::rasterize( prerasterize(bbox), dest, bbox );
+    bool use_fft() const {
+      if( !detail::IsFFTConvolvable<pixel_type, typename KernelT::pixel_type>::type::value )
+        return false;
+      if( m_method == AutoConvolution )
+        return detail::fft_convolution_pays_2d( m_kernel.cols(), m_kernel.rows() );
+      return m_method == FFTConvolution;
     }
+
+    template <class DestT>
+    void rasterize_fft( DestT const& dest, BBox2i const& bbox, boost::mpl::false_ ) const {
+      vw::rasterize( prerasterize_direct(bbox), dest, bbox );
+    }
+
+    /// Convolves each channel of the bbox's base of support with one 2D
+    /// transform, two channels at a time.
+    template <class DestT>
+    void rasterize_fft( DestT const& dest, BBox2i const& bbox, boost::mpl::true_ ) const {
+      const int32 nch = PixelNumChannels<pixel_type>::value;
+      const int32 kc  = m_kernel.cols(), kr = m_kernel.rows();
+      ImageView<pixel_type> src = edge_extend( m_image, source_bbox( bbox ), m_edge );
+
+      std::vector<double> kernel( size_t(kc) * kr );
+      for( int32 j=0; j<kr; ++j )
+        for( int32 i=0; i<kc; ++i )
+          kernel[size_t(j)*kc + i] = double( m_kernel.child()(i,j) );
+      math::FFTConvolver2D convolver( kernel, kc, kr, src.cols(), src.rows() );
+
+      ImageView<pixel_type> out( bbox.width(), bbox.height(), src.planes() );
+      const int32 count = src.planes() * nch;
+      std::vector<double> a, b, out_a( size_t(out.cols()) * out.rows() ), out_b( out_a.size() );
+      for( int32 k=0; k<count; k+=2 ) {
+        detail::get_channel( src, k/nch, k%nch, a );
+        const bool pair = k+1 < count;
+        if( pair )
+          detail::get_channel( src, (k+1)/nch, (k+1)%nch, b );
+        convolver( &a[0], pair ? &b[0] : 0, &out_a[0], pair ? &out_b[0] : 0 );
+        detail::set_channel( out, k/nch, k%nch, out_a );
+        if( pair )
+          detail::set_channel( out, (k+1)/nch, (k+1)%nch, out_b );
+      }
+      out.rasterize( dest, BBox2i( 0, 0, out.cols(), out.rows() ) );
+    }
+
+    /// \endcond
   };
 
 
@@ -188,6 +361,7 @@ namespace vw {
     std::vector<KernelT> m_i_kernel, m_j_kernel;
     size_t m_ci, m_cj;
     EdgeT  m_edge;
+    ConvolutionMethod m_method;
     mutable ImageView<KernelT> m_kernel2d;
 
     void generate2DKernel() const {
@@ -212,14 +386,14 @@ namespace vw {
     SeparableConvolutionView( ImageT const& image, KRangeT const& ik, KRangeT const& jk, 
                               int32 ci, int32 cj, EdgeT const& edge = EdgeT() ) :
       m_image(image), m_i_kernel(ik.begin(),ik.end()), m_j_kernel(jk.begin(),jk.end()), 
-      m_ci(ci), m_cj(cj), m_edge(edge) {}
+      m_ci(ci), m_cj(cj), m_edge(edge), m_method(AutoConvolution) {}
 
     /// Constructs a SeparableConvolutionView with the given image and kernels and with the origin of the kernel located at the point (ci,cj).
     template <class KRangeT>
     SeparableConvolutionView( ImageT const& image, KRangeT const& ik, KRangeT const& jk, 
                               EdgeT const& edge = EdgeT() ) :
       m_image(image), m_i_kernel(ik.begin(),ik.end()), m_j_kernel(jk.begin(),jk.end()), 
-      m_ci((m_i_kernel.size()-1)/2), m_cj((m_j_kernel.size()-1)/2), m_edge(edge) {}
+      m_ci((m_i_kernel.size()-1)/2), m_cj((m_j_kernel.size()-1)/2), m_edge(edge), m_method(AutoConvolution) {}
 
     inline int32 cols  () const { return m_image.cols  (); }
     inline int32 rows  () const { return m_image.rows  (); }
@@ -228,6 +402,24 @@ namespace vw {
     /// Returns a pixel_accessor pointing to the top-left corner of the first plane.
     inline pixel_accessor origin() const { return pixel_accessor( *this ); }
 
+    ImageT const& child() const { return m_image; }
+    EdgeT  const& edge () const { return m_edge;  }
+
+    /// How blocks are convolved, AutoConvolution by default.  Each axis
+    /// is decided on its own.
+    ConvolutionMethod method() const { return m_method; }
+    void set_method( ConvolutionMethod method ) { m_method = method; }
+
+    /// The base of support of the bbox in the edge extended child.
+    BBox2i source_bbox( BBox2i const& bbox ) const {
+      size_t ni = m_i_kernel.size(), 
+             nj = m_j_kernel.size();
+      BBox2i child_bbox = bbox;
+      child_bbox.min() -= Vector2i( int32(ni?(ni-m_ci-1):0), int32(nj?(nj-m_cj-1):0) );
+      child_bbox.max() += Vector2i( int32(ni?m_ci:0), int32(nj?m_cj:0) );
+      return child_bbox;
+    }
+
     /// Returns the pixel at the given position in the given plane.
     inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
       typedef typename CompoundChannelType<result_type>::type channel_type;
@@ -277,12 +469,97 @@ namespace vw {
       if( ni==0 && nj==0 ) {
         return edge_extend(m_image,m_edge).rasterize(dest,bbox);
       }
-      BBox2i child_bbox = bbox;
-      child_bbox.min() -= Vector2i( int32(ni?(ni-m_ci-1):0), int32(nj?(nj-m_cj-1):0) );
-      child_bbox.max() += Vector2i( int32(ni?m_ci:0), int32(nj?m_cj:0) );
-      ImageView<typename ImageT::pixel_type> src_buf = edge_extend(m_image,child_bbox,m_edge);
+      ImageView<typename ImageT::pixel_type> src_buf = edge_extend(m_image,source_bbox(bbox),m_edge);
+      if( bbox.width() <= 0 || bbox.height() <= 0 )
+        return;
+      if( use_fft( ni ) || use_fft( nj ) )
+        convolve_2d_fft( src_buf, dest, typename detail::IsFFTConvolvable<pixel_type,KernelT>::type() );
+      else
+        convolve_2d( src_buf, dest, typename detail::IsFlatConvolvable<pixel_type,KernelT>::type() );
+    }
+
+    /// Whether to transform along an axis with a kernel of n taps.
+    bool use_fft( size_t n ) const {
+      if( n == 0 || !detail::IsFFTConvolvable<pixel_type,KernelT>::type::value )
+        return false;
+      if( m_method == AutoConvolution )
+        return detail::fft_convolution_pays_1d( n );
+      return m_method == FFTConvolution;
+    }
+
+    template <class DestT>
+    void convolve_2d_fft( ImageView<pixel_type>& src_buf, DestT const& dest, boost::mpl::false_ ) const {
+      convolve_2d( src_buf, dest, typename detail::IsFlatConvolvable<pixel_type,KernelT>::type() );
+    }
+
+    /// Convolves a channel at a time in doubles, by overlap-save along
+    /// the axes where use_fft() says so and directly along the others.
+    template <class DestT>
+    void convolve_2d_fft( ImageView<pixel_type> const& src_buf, DestT const& dest, boost::mpl::true_ ) const {
+      const int32 nch = PixelNumChannels<pixel_type>::value;
+      const size_t ni = m_i_kernel.size(), nj = m_j_kernel.size();
+      const size_t src_cols = src_buf.cols(), src_rows = src_buf.rows(),
+                   cols = dest.cols(), rows = dest.rows();
+      std::vector<double> x_kernel( m_i_kernel.begin(), m_i_kernel.end() ),
+                          y_kernel( m_j_kernel.begin(), m_j_kernel.end() );
+      boost::shared_ptr<math::FFTConvolver1D> x_fft, y_fft;
+      if( use_fft( ni ) ) x_fft.reset( new math::FFTConvolver1D( x_kernel, cols ) );
+      if( use_fft( nj ) ) y_fft.reset( new math::FFTConvolver1D( y_kernel, rows ) );
+
+      ImageView<pixel_type> out( cols, rows, src_buf.planes() );
+      std::vector<double> src, work, result( cols * rows );
+      for( int32 k=0; k<src_buf.planes()*nch; ++k ) {
+        detail::get_channel( src_buf, k/nch, k%nch, src );
+
+        // Rows, src_cols to cols long, src_rows of them.
+        if( ni > 0 ) {
+          work.resize( cols * src_rows );
+          for( size_t y=0; y<src_rows; ) {
+            const bool pair = x_fft && y+1 < src_rows;
+            if( !x_fft )
+              detail::direct_convolve_1d( &src[y*src_cols], src_cols, 1, x_kernel, &work[y*cols] );
+            else
+              (*x_fft)( &src[y*src_cols], pair ? &src[(y+1)*src_cols] : 0, src_cols, 1,
+                        &work[y*cols], pair ? &work[(y+1)*cols] : 0 );
+            y += pair ? 2 : 1;
+          }
+        }
+        else
+          work.swap( src );
+
+        // Columns, src_rows to rows long, cols of them.
+        if( nj > 0 ) {
+          std::vector<double> column( rows ), column2( rows );
+          for( size_t x=0; x<cols; ) {
+            const bool pair = y_fft && x+1 < cols;
+            if( !y_fft )
+              detail::direct_convolve_1d( &work[x], src_rows, cols, y_kernel, &column[0] );
+            else
+              (*y_fft)( &work[x], pair ? &work[x+1] : 0, src_rows, cols, &column[0], pair ? &column2[0] : 0 );
+            for( size_t y=0; y<rows; ++y )
+              result[y*cols + x] = column[y];
+            if( pair )
+              for( size_t y=0; y<rows; ++y )
+                result[y*cols + x+1] = column2[y];
+            x += pair ? 2 : 1;
+          }
+        }
+        else
+          result.swap( work );
+
+        detail::set_channel( out, k/nch, k%nch, result );
+        result.resize( cols * rows );
+      }
+      out.rasterize( dest, BBox2i( 0, 0, cols, rows ) );
+    }
+
+    /// Convolves through the pixel accessors, for any pixel type.
+    template <class DestT>
+    void convolve_2d( ImageView<pixel_type>& src_buf, DestT const& dest, boost::mpl::false_ ) const {
+      size_t ni = m_i_kernel.size(),
+             nj = m_j_kernel.size();
       if( ni>0 && nj>0 ) {
-        ImageView<pixel_type> work( bbox.width(), child_bbox.height(), planes() );
+        ImageView<pixel_type> work( dest.cols(), src_buf.rows(), planes() );
         convolve_1d( src_buf, work, m_i_kernel );
         src_buf.reset(); // Free up some memory
         convolve_1d( transpose(work), transpose(dest), m_j_kernel );
@@ -295,6 +572,78 @@ namespace vw {
       }
     }
 
+    /// Convolves rows of channels at a time with detail::accumulate_tap().
+    /// The column pass runs along rows too instead of down the columns of
+    /// a transposed view. Taps are summed in the same order, and the row
+    /// pass is cast back to the pixel type, so the result is identical to
+    /// the accessor version.
+    template <class DestT>
+    void convolve_2d( ImageView<pixel_type> const& src_buf, DestT const& dest, boost::mpl::true_ ) const {
+      typedef typename PixelChannelType<pixel_type>::type channel_type;
+      typedef typename DestT::pixel_accessor DestAccessT;
+      const int32 nch   = PixelNumChannels<pixel_type>::value;
+      const int32 ni    = int32(m_i_kernel.size()),
+                  nj    = int32(m_j_kernel.size());
+      const int32 width = dest.cols() * nch; // Channels in one output row
+      const int32 src_width = src_buf.cols() * nch;
+
+      std::vector<float>        acc( width );
+      std::vector<channel_type> out( width );
+      std::vector<channel_type> work( ni>0 && nj>0 ? size_t(width) * src_buf.rows() : 0 );
+
+      DestAccessT dplane = dest.origin();
+      for( int32 p=0; p<dest.planes(); ++p ) {
+        channel_type const* src = reinterpret_cast<channel_type const*>( &src_buf(0,0,p) );
+
+        // Input rows of the column pass: the source itself, or the row
+        // pass output if there is an x kernel as well.
+        channel_type const* rows = src;
+        int32 rows_width = src_width;
+        if( ni>0 && nj>0 ) {
+          for( int32 y=0; y<src_buf.rows(); ++y ) {
+            convolve_row( src + size_t(y)*src_width, m_i_kernel, nch, acc );
+            cast_row( acc, &work[size_t(y)*width] );
+          }
+          rows = &work[0];
+          rows_width = width;
+        }
+
+        DestAccessT drow = dplane;
+        for( int32 y=0; y<dest.rows(); ++y ) {
+          if( nj>0 )
+            convolve_row( rows + size_t(y)*rows_width, m_j_kernel, rows_width, acc );
+          else
+            convolve_row( rows + size_t(y)*rows_width, m_i_kernel, nch, acc );
+          cast_row( acc, &out[0] );
+
+          pixel_type const* pixels = reinterpret_cast<pixel_type const*>( &out[0] );
+          DestAccessT dcol = drow;
+          for( int32 x=0; x<dest.cols(); ++x ) {
+            *dcol = pixels[x];
+            dcol.next_col();
+          }
+          drow.next_row();
+        }
+        dplane.next_plane();
+      }
+    }
+
+    /// acc = sum over taps t of kernel[n-1-t] * src[t*tap_stride ...].
+    template <class ChannelT>
+    static void convolve_row( ChannelT const* src, std::vector<KernelT> const& kernel,
+                              int32 tap_stride, std::vector<float>& acc ) {
+      std::fill( acc.begin(), acc.end(), 0.0f );
+      const int32 n = int32(kernel.size());
+      for( int32 t=0; t<n; ++t )
+        detail::accumulate_tap( &acc[0], src + size_t(t)*tap_stride, kernel[n-1-t], acc.size() );
+    }
+
+    template <class ChannelT>
+    static void cast_row( std::vector<float> const& acc, ChannelT* dst ) {
+      for( size_t i=0; i<acc.size(); ++i )
+        dst[i] = channel_cast_clamp_if_int<ChannelT>( acc[i] );
+    }
+
     /// 
     template <class SrcT, class DestT>
     void convolve_1d( SrcT const& src, DestT const& dest, std::vector<KernelT> const& kernel ) const {
@@ -329,6 +678,142 @@ namespace vw {
     /// \endcond
   };
 
+  // *******************************************************************
+  // The recursive Gaussian view type
+  // *******************************************************************
+
+  /// Gaussian smoothing by the recursive filter of Young and van Vliet
+  /// ("Recursive implementation of the Gaussian filter", Signal
+  /// Processing 44, 1995), whose cost per pixel does not grow with
+  /// sigma.  It only approximates the kernel of gaussian_filter(), so
+  /// it is meant for large sigmas, where that kernel is long.
+  ///
+  /// A sigma of 0 leaves that axis alone; the others must be at least
+  /// 0.5.  Pixels are smoothed a channel at a time, in doubles.
+  template <class ImageT, class EdgeT>
+  class RecursiveGaussianView : public ImageViewBase<RecursiveGaussianView<ImageT,EdgeT> >
+  {
+    ImageT m_image;
+    double m_x_sigma, m_y_sigma;
+    EdgeT  m_edge;
+
+    /// Source pixels read past each side of a block, for the filter to
+    /// settle before it reaches the block.
+    static int32 margin( double sigma ) {
+      return sigma > 0 ? int32( std::ceil( 4*sigma ) ) + 3 : 0;
+    }
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type                  result_type;
+    typedef ProceduralPixelAccessor<RecursiveGaussianView<ImageT,EdgeT> > pixel_accessor;
+
+    RecursiveGaussianView( ImageT const& image, double x_sigma, double y_sigma, EdgeT const& edge = EdgeT() )
+      : m_image(image), m_x_sigma(x_sigma), m_y_sigma(y_sigma), m_edge(edge) {
+      VW_ASSERT( (x_sigma == 0 || x_sigma >= 0.5) && (y_sigma == 0 || y_sigma >= 0.5),
+                 ArgumentErr() << "RecursiveGaussianView: sigma must be 0 or at least 0.5." );
+    }
+
+    inline int32 cols  () const { return m_image.cols  (); }
+    inline int32 rows  () const { return m_image.rows  (); }
+    inline int32 planes() const { return m_image.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+    /// Filters the whole base of support of the pixel, so rasterize the
+    /// view rather than reading it a pixel at a time.
+    inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+      ImageView<pixel_type> pixel( 1, 1, planes() );
+      rasterize( pixel, BBox2i( x, y, 1, 1 ) );
+      return pixel( 0, 0, p );
+    }
+
+    ImageT const& child() const { return m_image; }
+    EdgeT  const& edge () const { return m_edge;  }
+
+    /// The base of support of the bbox in the edge extended child.
+    BBox2i source_bbox( BBox2i const& bbox ) const {
+      BBox2i child_bbox = bbox;
+      Vector2i m( margin( m_x_sigma ), margin( m_y_sigma ) );
+      child_bbox.min() -= m;
+      child_bbox.max() += m;
+      return child_bbox;
+    }
+
+    /// \cond INTERNAL
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      ImageView<pixel_type> dest( bbox.width(), bbox.height(), m_image.planes() );
+      rasterize( dest, bbox );
+      return CropView<ImageView<pixel_type> >( dest, BBox2i(-bbox.min().x(), -bbox.min().y(),
+                                                            m_image.cols(), m_image.rows()) );
+    }
+
+    template <class DestT>
+    void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      const int32 nch = PixelNumChannels<pixel_type>::value;
+      const int32 mx = margin( m_x_sigma ), my = margin( m_y_sigma );
+      ImageView<pixel_type> src = edge_extend( m_image, source_bbox( bbox ), m_edge );
+      const size_t src_cols = src.cols(), src_rows = src.rows(),
+                   cols = bbox.width(), rows = bbox.height();
+
+      ImageView<pixel_type> out( cols, rows, src.planes() );
+      std::vector<double> data, result( cols * rows );
+      for( int32 k=0; k<src.planes()*nch; ++k ) {
+        detail::get_channel( src, k/nch, k%nch, data );
+        if( m_x_sigma > 0 )
+          detail::recursive_gaussian_1d( &data[0], src_cols, 1, src_rows, src_cols, m_x_sigma );
+        // Only the columns of the block are needed, and all of them at
+        // once keeps to the rows in memory.
+        if( m_y_sigma > 0 )
+          detail::recursive_gaussian_1d( &data[mx], src_rows, src_cols, cols, 1, m_y_sigma );
+        for( size_t y=0; y<rows; ++y )
+          for( size_t x=0; x<cols; ++x )
+            result[y*cols + x] = data[(y+my)*src_cols + x+mx];
+        detail::set_channel( out, k/nch, k%nch, result );
+      }
+      out.rasterize( dest, BBox2i( 0, 0, cols, rows ) );
+    }
+    /// \endcond
+  };
+
+  /// Reads the base of support of the bbox, through the edge extension.
+  template <class ImageT, class KernelT, class EdgeT>
+  class SourceFootprint<ConvolutionView<ImageT,KernelT,EdgeT> > {
+    ConvolutionView<ImageT,KernelT,EdgeT> const& m_view;
+  public:
+    SourceFootprint(ConvolutionView<ImageT,KernelT,EdgeT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      BBox2i src_bbox = m_view.edge().source_bbox( m_view.child(), m_view.source_bbox( bbox ) );
+      if( !src_bbox.empty() )
+        SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+    }
+  };
+
+  template <class ImageT, class KernelT, class EdgeT>
+  class SourceFootprint<SeparableConvolutionView<ImageT,KernelT,EdgeT> > {
+    SeparableConvolutionView<ImageT,KernelT,EdgeT> const& m_view;
+  public:
+    SourceFootprint(SeparableConvolutionView<ImageT,KernelT,EdgeT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      BBox2i src_bbox = m_view.edge().source_bbox( m_view.child(), m_view.source_bbox( bbox ) );
+      if( !src_bbox.empty() )
+        SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+    }
+  };
+
+  template <class ImageT, class EdgeT>
+  class SourceFootprint<RecursiveGaussianView<ImageT,EdgeT> > {
+    RecursiveGaussianView<ImageT,EdgeT> const& m_view;
+  public:
+    SourceFootprint(RecursiveGaussianView<ImageT,EdgeT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      BBox2i src_bbox = m_view.edge().source_bbox( m_view.child(), m_view.source_bbox( bbox ) );
+      if( !src_bbox.empty() )
+        SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+    }
+  };
+
 } // namespace vw
 
 #endif // __VW_IMAGE_CONVOLUTION_H__
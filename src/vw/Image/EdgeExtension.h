@@ -41,7 +41,9 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/SparseImageCheck.h>
+#include <vw/Image/Footprint.h>
 #include <vw/Core/Log.h>
 
 namespace vw {
@@ -144,6 +146,9 @@ namespace vw {
 
     ImageT     const& child() const { return m_image;          }
     ExtensionT const& func () const { return m_extension_func; }
+    /// The position of this view's origin in the child.
+    int32 x_offset() const { return m_xoffset; }
+    int32 y_offset() const { return m_yoffset; }
     BBox2i source_bbox( BBox2i const& bbox ) const {
       return m_extension_func.source_bbox( m_image, bbox + Vector2i( m_xoffset, m_yoffset ) );
     }
@@ -156,7 +161,41 @@ namespace vw {
       VW_OUT(VerboseDebugMessage, "image") << "EdgeExtensionView: prerasterizing child view with bbox " << src_bbox << ".\n";
       return prerasterize_type(m_image.prerasterize(src_bbox), m_xoffset, m_yoffset, m_cols, m_rows, m_extension_func );
     }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+
+    /// Requests that lie inside the child are handed straight to the
+    /// child's own rasterize.  Requests that straddle an edge copy the
+    /// interior from the prerasterized child a row at a time and only
+    /// run the extension functor over the border strips.
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      Vector2i offset( m_xoffset, m_yoffset );
+      BBox2i child_bbox = bbox + offset;
+      BBox2i child_extent( 0, 0, m_image.cols(), m_image.rows() );
+      if( child_extent.contains( child_bbox ) ) {
+        m_image.rasterize( dest, child_bbox );
+        return;
+      }
+      prerasterize_type src = prerasterize(bbox);
+      if( !child_extent.intersects( child_bbox ) ) {
+        vw::rasterize( src, dest, bbox );
+        return;
+      }
+
+      BBox2i inner = child_bbox;
+      inner.crop( child_extent );
+      inner -= offset;
+      vw::rasterize_rows( src.child(), crop( dest, inner - bbox.min() ), inner + offset );
+
+      // Top and bottom strips span the full width; left and right
+      // strips only cover the rows of the interior.
+      BBox2i strips[4] = {
+        BBox2i( bbox.min().x(), bbox.min().y(), bbox.width(), inner.min().y() - bbox.min().y() ),
+        BBox2i( bbox.min().x(), inner.max().y(), bbox.width(), bbox.max().y() - inner.max().y() ),
+        BBox2i( bbox.min().x(), inner.min().y(), inner.min().x() - bbox.min().x(), inner.height() ),
+        BBox2i( inner.max().x(), inner.min().y(), bbox.max().x() - inner.max().x(), inner.height() ) };
+      for( int i = 0; i < 4; ++i )
+        if( !strips[i].empty() )
+          vw::rasterize( src, crop( dest, strips[i] - bbox.min() ), strips[i] );
+    }
   };
 
   template <class ImageT, class ExtensionT>
@@ -170,6 +209,20 @@ namespace vw {
     }
   };
 
+  /// The extension functor decides which part of the child is read.
+  template <class ImageT, class ExtensionT>
+  class SourceFootprint<EdgeExtensionView<ImageT, ExtensionT> > {
+    EdgeExtensionView<ImageT, ExtensionT> const& m_view;
+  public:
+    SourceFootprint(EdgeExtensionView<ImageT, ExtensionT> const& view)
+      : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      BBox2i src_bbox = m_view.source_bbox( bbox );
+      if( !src_bbox.empty() )
+        SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+    }
+  };
+
 
   // *******************************************************************
   // General-purpose edge extension functions
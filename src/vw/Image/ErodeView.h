@@ -23,6 +23,7 @@
 #define __VW_IMAGE_ERODE_VIEW_H__
 
 // Standard
+#include <algorithm>
 #include <vector>
 
 // VW
@@ -377,8 +378,28 @@ template <class ImageT>
 template <class DestT>
 void ErodeView<ImageT>::rasterize( DestT const& dest, BBox2i const& bbox ) const
 {
-  /// Call the default rasterization function on the prerasterized image section.
-  vw::rasterize( prerasterize(bbox), dest, bbox );
+  typedef typename DestT::pixel_type     dest_pixel_type;
+  typedef typename DestT::pixel_accessor dest_accessor;
+
+  // Rasterize the underlying image, then blank out the masked runs of
+  // each row rather than looking up each pixel in the segment maps.
+  m_under_image.rasterize( dest, bbox );
+
+  const dest_pixel_type blank = dest_pixel_type( result_type() );
+  for ( int32 row = bbox.min().y(); row < bbox.max().y(); ++row )
+  {
+    // The segments are keyed on their last column, so this finds the
+    // first one which ends inside the bbox or past it.
+    typename map_type::const_iterator it = blobRow(row).lower_bound( bbox.min().x() );
+    for ( ; it != blobRow(row).end() && it->second < bbox.max().x(); ++it )
+    {
+      const int32 start = std::max( it->second,    bbox.min().x() );
+      const int32 end   = std::min( it->first + 1, bbox.max().x() );
+      dest_accessor acc = dest.origin().advance( start - bbox.min().x(), row - bbox.min().y() );
+      for ( int32 col = start; col < end; ++col, acc.next_col() )
+        *acc = blank;
+    }
+  }
 }
 
 template <class ImageT>
@@ -26,8 +26,29 @@
 #pragma warning(disable:4996)
 #endif
 
+#include <vw/config.h>
 #include <vw/Image/Filter.h>
 
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  #include <emmintrin.h>
+  #include <smmintrin.h> // SSE4.1
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+  // The smallest kernels AutoConvolution transforms.  These are where
+  // the transforms start to beat the direct float paths of
+  // ConvolutionView (through pixel accessors) and SeparableConvolutionView
+  // (rows of channels with accumulate_tap()) on 256x256 blocks, as timed
+  // on a 256x256 float image; the break-even point moves little between
+  // 128 and 1024 pixel blocks.
+  const size_t fft_min_taps_2d = 121; // 11x11
+  const size_t fft_min_taps_1d = 32;
+}
+
 /// Compute the kernel size for given sigma 
 int vw::compute_kernel_size(double sigma){
   // This function is used outside of vw::generate_gaussian_kernel as well.
@@ -36,3 +57,101 @@ int vw::compute_kernel_size(double sigma){
   else if( size%2==0 ) size -= 1;
   return size;
 }
+
+// The SSE loops multiply and then add, which matches the scalar loops
+// (and the accessor based convolution) exactly.
+
+void vw::detail::accumulate_tap( float* acc, uint8 const* src, float k, size_t n ) {
+  size_t i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  const __m128 kv = _mm_set1_ps( k );
+  for( ; i+4 <= n; i += 4 ) {
+    int32 packed;
+    std::memcpy( &packed, src+i, sizeof(packed) );
+    __m128 s = _mm_cvtepi32_ps( _mm_cvtepu8_epi32( _mm_cvtsi32_si128( packed ) ) );
+    _mm_storeu_ps( acc+i, _mm_add_ps( _mm_loadu_ps( acc+i ), _mm_mul_ps( kv, s ) ) );
+  }
+#endif
+  for( ; i < n; ++i )
+    acc[i] += k * src[i];
+}
+
+void vw::detail::accumulate_tap( float* acc, uint16 const* src, float k, size_t n ) {
+  size_t i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  const __m128 kv = _mm_set1_ps( k );
+  for( ; i+4 <= n; i += 4 ) {
+    __m128i packed = _mm_loadl_epi64( reinterpret_cast<__m128i const*>( src+i ) );
+    __m128 s = _mm_cvtepi32_ps( _mm_cvtepu16_epi32( packed ) );
+    _mm_storeu_ps( acc+i, _mm_add_ps( _mm_loadu_ps( acc+i ), _mm_mul_ps( kv, s ) ) );
+  }
+#endif
+  for( ; i < n; ++i )
+    acc[i] += k * src[i];
+}
+
+void vw::detail::accumulate_tap( float* acc, float const* src, float k, size_t n ) {
+  size_t i = 0;
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  const __m128 kv = _mm_set1_ps( k );
+  for( ; i+4 <= n; i += 4 )
+    _mm_storeu_ps( acc+i, _mm_add_ps( _mm_loadu_ps( acc+i ), _mm_mul_ps( kv, _mm_loadu_ps( src+i ) ) ) );
+#endif
+  for( ; i < n; ++i )
+    acc[i] += k * src[i];
+}
+
+bool vw::detail::fft_convolution_pays_2d( size_t kernel_cols, size_t kernel_rows ) {
+  return kernel_cols * kernel_rows >= fft_min_taps_2d;
+}
+
+bool vw::detail::fft_convolution_pays_1d( size_t kernel_size ) {
+  return kernel_size >= fft_min_taps_1d;
+}
+
+void vw::detail::direct_convolve_1d( double const* src, size_t src_size, size_t src_stride,
+                                     std::vector<double> const& kernel, double* out ) {
+  const size_t n = kernel.size();
+  for( size_t u=0; u+n <= src_size; ++u ) {
+    double sum = 0;
+    for( size_t t=0; t<n; ++t )
+      sum += src[(u+t)*src_stride] * kernel[n-1-t];
+    out[u] = sum;
+  }
+}
+
+void vw::detail::recursive_gaussian_1d( double* data, size_t n, size_t stride,
+                                        size_t lines, size_t line_stride, double sigma ) {
+  VW_ASSERT( sigma >= 0.5, ArgumentErr() << "recursive_gaussian_1d: sigma must be at least 0.5." );
+  // Young and van Vliet, equations 11b and 8c.
+  const double q = sigma >= 2.5 ? 0.98711*sigma - 0.96330
+                                : 3.97156 - 4.14554*std::sqrt( 1 - 0.26891*sigma );
+  const double b0 = 1.57825 + 2.44413*q + 1.4281*q*q + 0.422205*q*q*q,
+               b1 = ( 2.44413*q + 2.85619*q*q + 1.26661*q*q*q ) / b0,
+               b2 = -( 1.4281*q*q + 1.26661*q*q*q ) / b0,
+               b3 = ( 0.422205*q*q*q ) / b0,
+               B  = 1 - ( b1 + b2 + b3 );
+
+  // A line is run forward and then backward in place.  The values
+  // before either end are taken to be the end value, which is what the
+  // filter settles to on a constant line.  The lines are interleaved
+  // when they are closer together in memory than their values are.
+  const size_t group = line_stride < stride ? lines : 1;
+  std::vector<double> w1( group ), w2( group ), w3( group );
+  for( size_t first=0; first<lines; first+=group ) {
+    double* line = data + first*line_stride;
+    for( int pass=0; pass<2; ++pass ) {
+      const ptrdiff_t step = pass == 0 ? ptrdiff_t(stride) : -ptrdiff_t(stride);
+      double* v = pass == 0 ? line : line + (n-1)*stride;
+      for( size_t l=0; l<group; ++l )
+        w1[l] = w2[l] = w3[l] = v[l*line_stride];
+      for( size_t i=0; i<n; ++i, v+=step ) {
+        for( size_t l=0; l<group; ++l ) {
+          double& x = v[l*line_stride];
+          x = B*x + b1*w1[l] + b2*w2[l] + b3*w3[l];
+          w3[l] = w2[l]; w2[l] = w1[l]; w1[l] = x;
+        }
+      }
+    }
+  }
+}
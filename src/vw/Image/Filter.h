@@ -105,8 +105,9 @@ namespace vw {
   /// This function computes the convolution of an image with a kernel
   /// stored in another image. It assumes the origin of the kernel is
   /// at the point <CODE>(cx,cy)</CODE> and uses the given edge
-  /// extension mode to extend the source image as needed.
-  /// \see FFTConvolutionFilter
+  /// extension mode to extend the source image as needed.  Large
+  /// kernels on float or double pixels are applied by FFT, see
+  /// ConvolutionMethod.
   template <class SrcT, class KernelT, class EdgeT>
   inline ConvolutionView<SrcT,KernelT,EdgeT>
   convolution_filter( ImageViewBase<SrcT> const& src, KernelT const& kernel, int32 cx, int32 cy, EdgeT edge ) {
@@ -198,7 +199,9 @@ namespace vw {
   /// and the given edge extension mode to extend the source image as
   /// needed.  Specifying a zero value of x_dim or y_dim causes the
   /// corresponding dimension to be chose automatically as appropriate
-  /// for the requested standard deviation.
+  /// for the requested standard deviation.  The kernels of large sigmas
+  /// are applied by FFT to float or double pixels; see also
+  /// recursive_gaussian_filter().
   template <class SrcT, class EdgeT>
   SeparableConvolutionView<SrcT, typename DefaultKernelT<typename SrcT::pixel_type>::type, EdgeT>
   inline gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma, int32 x_dim, int32 y_dim, EdgeT edge ) {
@@ -258,6 +261,37 @@ namespace vw {
   }
 
 
+  // Recursive Gaussian functions
+
+  /// Applies an approximate Gaussian smoothing filter whose cost per
+  /// pixel does not depend on the standard deviations, which suits
+  /// sigmas too large for gaussian_filter().  A sigma of 0 leaves that
+  /// axis alone.  \see RecursiveGaussianView
+  template <class SrcT, class EdgeT>
+  inline RecursiveGaussianView<SrcT, EdgeT>
+  recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma, EdgeT edge ) {
+    return RecursiveGaussianView<SrcT, EdgeT>( src.impl(), x_sigma, y_sigma, edge );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::recursive_gaussian_filter. It uses the default
+  /// vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  inline RecursiveGaussianView<SrcT, ConstantEdgeExtension>
+  recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma ) {
+    return RecursiveGaussianView<SrcT, ConstantEdgeExtension>( src.impl(), x_sigma, y_sigma );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::recursive_gaussian_filter. It uses the same standard deviation
+  /// in both directions and the default vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  inline RecursiveGaussianView<SrcT, ConstantEdgeExtension>
+  recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double sigma ) {
+    return RecursiveGaussianView<SrcT, ConstantEdgeExtension>( src.impl(), sigma, sigma );
+  }
+
+
   // Image differentiation functions
 
   /// Applies a differentiation filter to an image.  This function
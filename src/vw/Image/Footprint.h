@@ -0,0 +1,119 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Footprint.h
+///
+/// Finds the regions of its sources that a view reads to rasterize a
+/// bounding box, without reading them.
+///
+#ifndef __VW_IMAGE_FOOTPRINT_H__
+#define __VW_IMAGE_FOOTPRINT_H__
+
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Math/BBox.h>
+#include <vw/Image/ImageViewBase.h>
+
+namespace vw {
+
+  /// The source regions read to rasterize part of a view, as found
+  /// by footprint().  Useful for prefetching them, for skipping work
+  /// over regions with no data, and for sizing caches.
+  class Footprint {
+  public:
+    struct Region {
+      void const* source; ///< Identifies the source; the same for all of its regions.
+      std::string name;   ///< Describes the source.
+      Vector2i    size;   ///< The size of the source.
+      BBox2i      bbox;   ///< The pixels read, within the source.
+    };
+
+    /// Records that the pixels of a source of the given size within
+    /// the bbox are read.  The bbox is clipped to the source, and a
+    /// region within one already recorded for the source is dropped.
+    void add( void const* source, std::string const& name, Vector2i const& size, BBox2i const& bbox ) {
+      Region region;
+      region.source = source;
+      region.name   = name;
+      region.size   = size;
+      region.bbox   = bbox;
+      region.bbox.crop( BBox2i( 0, 0, size.x(), size.y() ) );
+      if ( region.bbox.empty() )
+        return;
+      for ( size_t i = 0; i < m_regions.size(); ++i )
+        if ( m_regions[i].source == source && m_regions[i].bbox.contains( region.bbox ) )
+          return;
+      m_regions.push_back( region );
+    }
+
+    std::vector<Region> const& regions() const { return m_regions; }
+    bool empty() const { return m_regions.empty(); }
+
+    /// The union of the regions read from one source.
+    BBox2i bbox( void const* source ) const {
+      BBox2i result;
+      for ( size_t i = 0; i < m_regions.size(); ++i )
+        if ( m_regions[i].source == source )
+          result.grow( m_regions[i].bbox );
+      return result;
+    }
+
+    /// The total area of the regions.  Overlapping regions of a source
+    /// are counted once for each region.
+    uint64 num_pixels() const {
+      uint64 result = 0;
+      for ( size_t i = 0; i < m_regions.size(); ++i )
+        result += uint64( m_regions[i].bbox.width() ) * m_regions[i].bbox.height();
+      return result;
+    }
+
+  private:
+    std::vector<Region> m_regions;
+  };
+
+  /// Adds the source regions that rasterizing a bbox of the wrapped
+  /// view reads to a Footprint.
+  /// - This default treats the view as a source in its own right,
+  ///   identified by its address, so each copy of it is a different
+  ///   source.  Views which read from other views specialize it to
+  ///   pass the bbox they give their children on to the children.
+  template <class SrcViewT>
+  class SourceFootprint {
+    SrcViewT const& m_view;
+  public:
+    SourceFootprint(SrcViewT const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      footprint.add( &m_view, typeid(SrcViewT).name(), Vector2i( m_view.cols(), m_view.rows() ), bbox );
+    }
+  };
+
+  /// The source regions which rasterizing the bbox of a view reads.
+  template <class ImageT>
+  Footprint footprint( ImageViewBase<ImageT> const& image, BBox2i const& bbox ) {
+    Footprint result;
+    if ( !bbox.empty() )
+      SourceFootprint<ImageT>(image.impl())( bbox, result );
+    return result;
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_FOOTPRINT_H__
@@ -29,11 +29,14 @@
 #include <vw/Math/Matrix.h>
 #include <vw/Image/ImageViewBase.h>
 
+#include <algorithm>
 #include <complex>
+#include <map>
 #include <vw/InterestPoint/Detector.h>  // TODO: Move get_opencv_wrapper out of here!
 #include <vw/Image/ImageResourceImpl.h>
 #include <vw/Image/ImageResourceView.h>
 #include "opencv2/core.hpp"
+#include "opencv2/core/hal/hal.hpp"
 #include "opencv2/imgproc.hpp"
 #include "opencv2/highgui.hpp" // DEBUG
 #include <boost/core/null_deleter.hpp>
@@ -42,10 +45,69 @@ namespace vw {
 
 
 //TODO: Split off into a .cc file!
-  
+
+/// Keeps the OpenCV DFT plans (twiddle factors and buffers) made for each
+///  transform size so that many transforms of the same size, such as all
+///  the windows in a tile, only have to set them up once.
+/// - dft() takes the same arguments as cv::dft() and calls the same
+///   cv::hal::DFT2D code that cv::dft() creates for each call.
+/// - Not thread safe, use one object per thread.
+class DftPlanCache {
+public:
+
+  void dft(cv::Mat const& src, cv::Mat & dst, int flags=0, int nonzero_rows=0) {
+    const int  depth = src.depth();
+    const int  cn    = src.channels();
+    const bool inv   = (flags & cv::DFT_INVERSE) != 0;
+    VW_ASSERT((depth == CV_32F || depth == CV_64F) && (cn == 1 || cn == 2),
+              ArgumentErr() << "DftPlanCache: Unsupported input type.");
+
+    // Same output type rules as cv::dft.
+    if (!inv && cn == 1 && (flags & cv::DFT_COMPLEX_OUTPUT))
+      dst.create(src.size(), CV_MAKETYPE(depth, 2));
+    else if (inv && cn == 2 && (flags & cv::DFT_REAL_OUTPUT))
+      dst.create(src.size(), depth);
+    else
+      dst.create(src.size(), src.type());
+
+    int f = 0;
+    if (src.isContinuous() && dst.isContinuous()) f |= CV_HAL_DFT_IS_CONTINUOUS;
+    if (inv)                                      f |= CV_HAL_DFT_INVERSE;
+    if (flags & cv::DFT_ROWS)                     f |= CV_HAL_DFT_ROWS;
+    if (flags & cv::DFT_SCALE)                    f |= CV_HAL_DFT_SCALE;
+    if (src.data == dst.data)                     f |= CV_HAL_DFT_IS_INPLACE;
+
+    PlanKey key = {{src.cols, src.rows, depth, cn, dst.channels(), f, nonzero_rows}};
+    PlanMap::iterator iter = m_plans.find(key);
+    if (iter == m_plans.end()) {
+      cv::Ptr<cv::hal::DFT2D> plan = cv::hal::DFT2D::create(src.cols, src.rows, depth, cn,
+                                                            dst.channels(), f, nonzero_rows);
+      iter = m_plans.insert(std::make_pair(key, plan)).first;
+    }
+    iter->second->apply(src.data, src.step, dst.data, dst.step);
+  }
+
+  /// Number of plans currently held.
+  size_t size() const { return m_plans.size(); }
+
+  void clear() { m_plans.clear(); }
+
+private:
+  struct PlanKey {
+    int v[7];
+    bool operator<(PlanKey const& other) const {
+      return std::lexicographical_compare(v, v+7, other.v, other.v+7);
+    }
+  };
+  typedef std::map<PlanKey, cv::Ptr<cv::hal::DFT2D> > PlanMap;
+  PlanMap m_plans;
+};
+
 /// Take the Discrete Fourier Transform of a VW image and return it in OpenCV format.
+/// - If plans is set the transform plan is taken from it.
 template <class T>
-void get_dft(ImageViewBase<T> const& input_view, cv::Mat &output_image) {
+void get_dft(ImageViewBase<T> const& input_view, cv::Mat &output_image,
+             DftPlanCache * plans = 0) {
 
   cv::Mat I, cv_mask;
   ImageView<vw::uint8> buffer_view;
@@ -71,7 +133,10 @@ void get_dft(ImageViewBase<T> const& input_view, cv::Mat &output_image) {
   cv::Mat planes[] = {cv::Mat_<float>(padded), cv::Mat::zeros(padded.size(), CV_32F)};
   cv::merge(planes, 2, output_image);         // Add to the expanded another plane with zeros
   
-  cv::dft(output_image, output_image, 0, I.rows);            // this way the result may fit in the source matrix
+  if (plans)
+    plans->dft(output_image, output_image, 0, I.rows);
+  else
+    cv::dft(output_image, output_image, 0, I.rows);            // this way the result may fit in the source matrix
 }
 
 /// Extract the magnitude from a complex image.
@@ -24,10 +24,22 @@
 #ifndef __VW_IMAGE_IMAGEIO_H__
 #define __VW_IMAGE_IMAGEIO_H__
 
+#include <vw/Core/Cache.h>
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Core/ThreadPool.h>
+#include <vw/Core/Profiler.h>
+#include <vw/Core/Numa.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/System.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/BlockPrefetcher.h>
+#include <vw/Image/BlockWriteJournal.h>
+#include <vw/Image/BlockWriteStats.h>
+#include <vw/Image/SparseImageCheck.h>
+
+#include <algorithm>
 
 namespace vw {
 
@@ -45,6 +57,7 @@ namespace vw {
       planes = (std::max)( src.planes(), src.channels() );
     }
     dst.set_size( bbox.width(), bbox.height(), planes );
+    VW_PROFILE_ZONE("ImageResource::read");
     src.read( dst.buffer(), bbox );
   }
 
@@ -55,6 +68,7 @@ namespace vw {
 
   template <class PixelT>
   inline void read_image( ImageView<PixelT> const& dst, SrcImageResource const& src, BBox2i const& bbox ) {
+    VW_PROFILE_ZONE("ImageResource::read");
     src.read( dst.buffer(), bbox );
   }
 
@@ -77,6 +91,7 @@ namespace vw {
 
   template <class PixelT>
   inline void write_image( DstImageResource &dst, ImageView<PixelT> const& src, BBox2i const& bbox ) {
+    VW_PROFILE_ZONE("ImageResource::write");
     dst.write( src.buffer(), bbox );
   }
 
@@ -113,6 +128,14 @@ namespace vw {
   // Of course, one slow rasterization thread can hold up the entire
   // process, but this is the price we pay for guranteed ordering when
   // writing tiles.
+  //
+  // The bytes of the blocks in flight are also reserved against
+  // vw_memory_governor(), in the same thread and in the same order, so a
+  // block is only queued once the blocks before it fit in the budget.
+  //
+  // The wait happens in the thread adding the blocks rather than in
+  // the rasterizing tasks, so a task is never queued ahead of its turn
+  // and the rasterize queue is free to start tasks out of order.
   class CountingSemaphore {
     Condition m_block_condition;
     Mutex m_mutex;
@@ -146,12 +169,20 @@ namespace vw {
   //
   // Only one thread can be writing to the ImageResource at any given
   // time, however several threads can be rasterizing simultaneously.
+  // Resources with has_encoded_write() also encode (convert, compress)
+  // each block on its rasterizing thread, which leaves only the append
+  // to the write thread.
   //
   class ThreadedBlockWriter : private boost::noncopyable {
 
-    boost::shared_ptr<FifoWorkQueue> m_rasterize_work_queue;
+    boost::shared_ptr<WorkStealingWorkQueue> m_rasterize_work_queue;
     boost::shared_ptr<OrderedWorkQueue> m_write_work_queue;
     CountingSemaphore m_write_queue_limit;
+    int m_next_numa_worker; ///< Round-robin counter for spreading blocks within a node
+    boost::shared_ptr<CancelToken> m_cancel_token; ///< Shared by all the tasks, may be empty
+    MemoryGovernor::Account m_memory; ///< Bytes of the blocks rasterized but not yet written
+    BlockWriteJournal* m_journal; ///< Records the blocks written, may be null
+    BlockWriteStats* m_stats; ///< Records what each block cost, may be null
 
     // ----------------------------- TASK TYPES (2) --------------------------
 
@@ -159,19 +190,54 @@ namespace vw {
     class WriteBlockTask : public Task {
       DstImageResource& m_resource;
       ImageView<PixelT> m_image_block;
+      boost::shared_ptr<EncodedBlock> m_encoded_block; ///< Written instead of m_image_block if set
       BBox2i m_bbox;
       int m_idx;
       CountingSemaphore& m_write_finish_event;
+      MemoryGovernor::Account& m_memory;
+      size_t m_num_bytes;
+      BlockWriteJournal* m_journal;
+      BlockWriteStats* m_stats;
 
     public:
       WriteBlockTask(DstImageResource& resource, ImageView<PixelT> const& image_block,
-                     BBox2i bbox, int idx, CountingSemaphore& write_finish_event) :
-      m_resource(resource), m_image_block(image_block), m_bbox(bbox), m_idx(idx), m_write_finish_event(write_finish_event) {}
+                     BBox2i bbox, int idx, CountingSemaphore& write_finish_event,
+                     MemoryGovernor::Account& memory, size_t num_bytes, BlockWriteJournal* journal,
+                     BlockWriteStats* stats,
+                     boost::shared_ptr<EncodedBlock> const& encoded_block = boost::shared_ptr<EncodedBlock>()) :
+      m_resource(resource), m_image_block(image_block), m_encoded_block(encoded_block),
+        m_bbox(bbox), m_idx(idx),
+        m_write_finish_event(write_finish_event), m_memory(memory), m_num_bytes(num_bytes),
+        m_journal(journal), m_stats(stats) {}
 
       virtual ~WriteBlockTask() {}
       virtual void operator() () {
         VW_OUT(DebugMessage, "image") << "Writing block " << m_idx << " at " << m_bbox << "\n";
-        m_resource.write( m_image_block.buffer(), m_bbox );
+        VW_PROFILE_ZONE("ImageResource::write");
+        uint64 start = m_stats ? Stopwatch::microtime() : 0;
+        if (m_encoded_block)
+          m_resource.write_encoded_block( *m_encoded_block );
+        else
+          m_resource.write( m_image_block.buffer(), m_bbox );
+        if (m_stats) {
+          BlockWriteRecord& record = m_stats->record( m_bbox );
+          record.write_ms += (Stopwatch::microtime() - start) / 1000.0;
+          record.bbox = m_bbox;
+        }
+        m_image_block.reset();
+        m_encoded_block.reset();
+        m_memory.release( m_num_bytes );
+        // This is the only thread writing, so the journal needs no lock.
+        if (m_journal) {
+          m_journal->complete( m_bbox );
+          m_journal->checkpoint_if_due( m_resource );
+        }
+        m_write_finish_event.notify();
+      }
+
+      // The block is not written, but the next one may now be rasterized.
+      virtual void discard() {
+        m_memory.release( m_num_bytes );
         m_write_finish_event.notify();
       }
     };
@@ -188,59 +254,139 @@ namespace vw {
       int m_total_num_blocks;
       SubProgressCallback m_progress_callback;
       CountingSemaphore& m_write_finish_event;
+      size_t m_num_bytes; ///< Reserved by add_block(), released by the write task
+      bool m_skip_empty;  ///< Fill blocks that sparse_check() finds empty instead of rasterizing them
+      typename ViewT::pixel_type m_empty_pixel;
 
     public:
       RasterizeBlockTask(ThreadedBlockWriter &parent, DstImageResource& resource,
                          ImageViewBase<ViewT> const& image, BBox2i const& bbox,
                          int index, int total_num_blocks,
-                         CountingSemaphore& write_finish_event,
-                         const ProgressCallback &progress_callback = ProgressCallback::dummy_instance()) :
+                         CountingSemaphore& write_finish_event, size_t num_bytes,
+                         const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                         typename ViewT::pixel_type const* empty_pixel = 0) :
       m_parent(parent), m_resource(resource), m_image(image.impl()), m_bbox(bbox), m_index(index),
-        m_progress_callback(progress_callback,0.0,1.0/float(total_num_blocks)), m_write_finish_event(write_finish_event) {}
+        m_progress_callback(progress_callback,0.0,1.0/float(total_num_blocks)), m_write_finish_event(write_finish_event),
+        m_num_bytes(num_bytes), m_skip_empty(empty_pixel != 0),
+        m_empty_pixel(empty_pixel ? *empty_pixel : typename ViewT::pixel_type()) {}
 
       virtual ~RasterizeBlockTask() {}
       virtual void operator()() {
 
-        m_write_finish_event.wait(m_index);
-
         VW_OUT(DebugMessage, "image") << "Rasterizing block " << m_index << " at " << m_bbox << "\n";
-        // Rasterize the block
-        ImageView<typename ViewT::pixel_type> image_block( crop(m_image, m_bbox) );
+        VW_PROFILE_ZONE("block_write_image rasterize");
+        BlockWriteStats* stats = m_parent.m_stats;
+        uint64 start = stats ? Stopwatch::microtime() : 0;
+        uint64 misses = stats ? Cache::thread_misses() : 0;
+        // Rasterize the block, unless nothing in it has data
+        ImageView<typename ViewT::pixel_type> image_block;
+        if (m_skip_empty && !sparse_check(m_image, m_bbox)) {
+          VW_OUT(DebugMessage, "image") << "Block " << m_index << " is empty, filling it\n";
+          image_block.set_size(m_bbox.width(), m_bbox.height(), m_image.planes());
+          std::fill(image_block.begin(), image_block.end(), m_empty_pixel);
+        } else {
+          image_block = crop(m_image, m_bbox);
+        }
+        if (stats) {
+          BlockWriteRecord& record = stats->record( m_bbox );
+          uint64 now = Stopwatch::microtime();
+          record.rasterize_ms = (now - start) / 1000.0;
+          record.cache_misses = Cache::thread_misses() - misses;
+          record.bytes        = m_num_bytes;
+          start = now;
+        }
+
+        // Encode it here too, if the resource can, so that the write
+        // thread only has to append it.
+        boost::shared_ptr<EncodedBlock> encoded_block;
+        if (m_resource.has_encoded_write()) {
+          VW_PROFILE_ZONE("block_write_image encode");
+          encoded_block = m_resource.encode_block( image_block.buffer(), m_bbox );
+          image_block.reset();
+          if (stats)
+            stats->record( m_bbox ).write_ms = (Stopwatch::microtime() - start) / 1000.0;
+        }
 
         // Report progress
         m_progress_callback.report_incremental_progress(1.0);
 
         // With rasterization complete, we queue up a request to write this block to disk.
-        boost::shared_ptr<Task> write_task ( new WriteBlockTask<typename ViewT::pixel_type>( m_resource, image_block, m_bbox, m_index, m_write_finish_event ) );
+        boost::shared_ptr<Task> write_task ( new WriteBlockTask<typename ViewT::pixel_type>( m_resource, image_block, m_bbox, m_index, m_write_finish_event, m_parent.m_memory, m_num_bytes, m_parent.m_journal, m_parent.m_stats, encoded_block ) );
 
         m_parent.add_write_task(write_task, m_index);
       }
+
+      // Queue a write task anyway so that the ordered write queue and the
+      // semaphore move past this index.  It shares the cancelled token, so
+      // it is discarded as well.
+      virtual void discard() {
+        boost::shared_ptr<Task> write_task ( new WriteBlockTask<typename ViewT::pixel_type>( m_resource, ImageView<typename ViewT::pixel_type>(), m_bbox, m_index, m_write_finish_event, m_parent.m_memory, m_num_bytes, m_parent.m_journal, m_parent.m_stats ) );
+        m_parent.add_write_task(write_task, m_index);
+      }
     };
 
     // -----------------------------
 
-    void add_write_task(boost::shared_ptr<Task> task, int index) { m_write_work_queue->add_task(task, index); }
+    void add_write_task(boost::shared_ptr<Task> task, int index) {
+      task->set_cancel_token(m_cancel_token);
+      m_write_work_queue->add_task(task, index);
+    }
     void add_rasterize_task(boost::shared_ptr<Task> task) { m_rasterize_work_queue->add_task(task); }
 
   public:
     /// Constructor
     /// - Leave num_threads as zero to get the default thread count from the settings.
-    ThreadedBlockWriter(int num_threads=0) : m_write_queue_limit(vw_settings().write_pool_size()) {
+    /// - Blocks which have not started when cancel_token is cancelled are skipped.
+    /// - Each block written is marked complete in the journal, if there is one.
+    /// - What each block cost is recorded in stats, if given, which must
+    ///   have been start()ed for the image and block size.
+    ThreadedBlockWriter(int num_threads=0,
+                        boost::shared_ptr<CancelToken> const& cancel_token = boost::shared_ptr<CancelToken>(),
+                        BlockWriteJournal* journal = 0, BlockWriteStats* stats = 0)
+      : m_write_queue_limit(vw_settings().write_pool_size()), m_next_numa_worker(0),
+        m_cancel_token(cancel_token), m_memory(vw_memory_governor(), "block_write_image"),
+        m_journal(journal), m_stats(stats) {
       if (num_threads < 1)
         num_threads = vw_settings().default_num_threads();
       // The work queue uses the specified (or default) number of threads, but the write queue
       //  is always limited to a single thread.
-      m_rasterize_work_queue = boost::shared_ptr<FifoWorkQueue>( new FifoWorkQueue(num_threads) );
+      m_rasterize_work_queue = boost::shared_ptr<WorkStealingWorkQueue>( new WorkStealingWorkQueue(num_threads) );
       m_write_work_queue = boost::shared_ptr<OrderedWorkQueue>( new OrderedWorkQueue(1) );
+      m_rasterize_work_queue->set_name("block_write rasterize");
+      m_write_work_queue->set_name("block_write write");
     }
 
+    /// The tasks refer to the members of this class, so they must finish first.
+    ~ThreadedBlockWriter() { process_blocks(); }
+
     // Add a block to be rasterized.  You can optionally supply an
     // index, which will indicate the order in which this block should
-    // be written to disk.
+    // be written to disk.  With an empty_pixel, a block which
+    // sparse_check() finds empty is filled with it instead.
     template <class ViewT>
     void add_block(DstImageResource& resource, ImageViewBase<ViewT> const& image, BBox2i const& bbox, int index, int total_num_blocks,
-                   const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) {
-      boost::shared_ptr<Task> task( new RasterizeBlockTask<ViewT>(*this, resource, image, bbox, index, total_num_blocks, m_write_queue_limit, progress_callback) );
+                   const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                   typename ViewT::pixel_type const* empty_pixel = 0 ) {
+      // Don't queue this block until it is within N blocks of the last block written.
+      m_write_queue_limit.wait(index);
+      size_t num_bytes = size_t(bbox.width()) * bbox.height() * image.impl().planes()
+                       * sizeof(typename ViewT::pixel_type);
+      m_memory.reserve(num_bytes);
+      boost::shared_ptr<Task> task( new RasterizeBlockTask<ViewT>(*this, resource, image, bbox, index, total_num_blocks, m_write_queue_limit, num_bytes, progress_callback, empty_pixel) );
+      task->set_cancel_token(m_cancel_token);
+      int num_nodes = m_rasterize_work_queue->numa_nodes();
+      if (num_nodes > 1) {
+        // The blocks in flight are a few consecutive ones in raster order, so
+        // split the image into vertical strips, one per node. Blocks above and
+        // below each other then share a node (and the source data they read).
+        int node = int( (long long)(bbox.min().x() + bbox.width()/2) * num_nodes / image.impl().cols() );
+        int begin, end;
+        numa_workers_for_node( node, m_rasterize_work_queue->max_threads(), num_nodes, begin, end );
+        if (end > begin) {
+          m_rasterize_work_queue->add_task( task, begin + (m_next_numa_worker++ % (end - begin)) );
+          return;
+        }
+      }
       this->add_rasterize_task(task);
     }
 
@@ -251,12 +397,14 @@ namespace vw {
   };
 
 
-  /// Write an image to disk using multiple threads operating on tiles in parallel.
-  /// - Leave num_threads=0 to use the default number of threads from the settings.
+  /// \cond INTERNAL
+  namespace detail {
   template <class ImageT>
   void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
-                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
-                          int num_threads=0) {
+                          typename ImageT::pixel_type const* empty_pixel,
+                          const ProgressCallback &progress_callback, int num_threads,
+                          boost::shared_ptr<CancelToken> const& cancel_token, BlockOrder const& order,
+                          BlockWriteJournal* journal = 0, BlockWriteStats* stats = 0 ) {
 
     VW_ASSERT( image.impl().cols() != 0 && image.impl().rows() != 0 && image.impl().planes() != 0,
                ArgumentErr() << "write_image: cannot write an empty image to a resource" );
@@ -265,53 +413,172 @@ namespace vw {
     progress_callback.report_progress(0);
     if (progress_callback.abort_requested())
       vw_throw( Aborted() << "Aborted by ProgressCallback" );
+    if (cancel_token)
+      cancel_token->throw_if_cancelled();
 
     const int32 rows = boost::numeric_cast<int32>(image.impl().rows());
     const int32 cols = boost::numeric_cast<int32>(image.impl().cols());
 
-    // Write the image to disk in blocks.  We may need to revisit
-    // the order in which these blocks are rasterized, but for now
-    // it rasterizes blocks from left to right, then top to bottom.
+    // Write the image to disk in blocks, visiting them in the
+    // requested order (left to right, then top to bottom by default).
     Vector2i block_size(cols, rows);
     if (resource.has_block_write())
       block_size = resource.block_write_size();
 
-    size_t total_num_blocks = ((rows-1)/block_size.y()+1) * ((cols-1)/block_size.x()+1);
+    Vector2i table_size((cols-1)/block_size.x()+1, (rows-1)/block_size.y()+1);
+    size_t total_num_blocks = size_t(table_size.x()) * table_size.y();
     VW_OUT(DebugMessage,"image") << "block_write_image: writing " << total_num_blocks << " blocks.\n";
+    if (stats)
+      stats->start(Vector2i(cols, rows), block_size);
+
+    if (journal) {
+      VW_ASSERT( journal->image_size() == Vector2i(cols, rows) && journal->block_size() == block_size,
+                 ArgumentErr() << "block_write_image: The journal is for another image or block size." );
+      VW_ASSERT( resource.has_sync(),
+                 NoImplErr() << "block_write_image: The resource cannot sync, so its blocks cannot be journaled." );
+      if (journal->num_done() == total_num_blocks) {
+        progress_callback.report_finished();
+        return;
+      }
+    }
 
     // Early out for easy case
     if (total_num_blocks == 1) {
-      ImageView<typename ImageT::pixel_type> image_block = image.impl();
+      uint64 start = Stopwatch::microtime(), misses = Cache::thread_misses();
+      ImageView<typename ImageT::pixel_type> image_block;
+      if (empty_pixel && !sparse_check(image.impl(), BBox2i(0,0,cols,rows))) {
+        image_block.set_size(cols, rows, image.impl().planes());
+        std::fill(image_block.begin(), image_block.end(), *empty_pixel);
+      } else {
+        image_block = image.impl();
+      }
+      uint64 rasterized = Stopwatch::microtime();
       resource.write( image_block.buffer(), BBox2i(0,0,image_block.cols(),image_block.rows()) );
+      if (stats) {
+        BlockWriteRecord& record = stats->record( BBox2i(0,0,cols,rows) );
+        record.bbox         = BBox2i(0,0,cols,rows);
+        record.rasterize_ms = (rasterized - start) / 1000.0;
+        record.write_ms     = (Stopwatch::microtime() - rasterized) / 1000.0;
+        record.cache_misses = Cache::thread_misses() - misses;
+        record.bytes        = uint64(cols) * rows * image.impl().planes() * sizeof(typename ImageT::pixel_type);
+      }
+      if (journal) {
+        journal->complete( BBox2i(0,0,cols,rows) );
+        journal->checkpoint( resource );
+      }
     } else {
       // Set up the threaded block writer object, which will manage rasterizing
       // and writing images to disk one block (and one thread) at a time.
-      ThreadedBlockWriter block_writer(num_threads);
-
-      for (int32 j = 0; j < rows; j+= block_size.y()) {
-        for (int32 i = 0; i < cols; i+= block_size.x()) {
-          VW_OUT(DebugMessage, "image") << "ImageIO scheduling block at [" << i << " " << j << "]/[" << rows << " " << cols << "] blocksize = " << block_size.x() << " x " <<  block_size.y() << "\n";
-
-          // Rasterize and save this image block
-          BBox2i current_bbox(Vector2i(i,j),
-                              Vector2i(std::min<int32>(i+block_size.x(),cols),
-                                       std::min<int32>(j+block_size.y(),rows)));
-
-          // Rasterize this image block by scheduling it with the block_writer.
-          int col_blocks    = int( ceil(float(cols)/float(block_size.x())) );
-          int i_block_index = int(i/block_size.x());
-          int j_block_index = int(j/block_size.y());
-          int index         = j_block_index*col_blocks+i_block_index;
-
-          block_writer.add_block(resource, image, current_bbox, index, total_num_blocks, progress_callback );
-        }
+      boost::shared_ptr<CancelToken> token = cancel_token ? cancel_token
+                                                          : boost::shared_ptr<CancelToken>(new CancelToken);
+      ThreadedBlockWriter block_writer(num_threads, token, journal, stats);
+
+      // The position in the order is also the position in the write
+      // queue, so the blocks already journaled are dropped first.
+      std::vector<Vector2i> blocks = order.blocks(BBox2i(Vector2i(0,0), table_size));
+      if (journal) {
+        std::vector<Vector2i> remaining;
+        for (size_t index = 0; index < blocks.size(); ++index)
+          if (!journal->done(blocks[index]))
+            remaining.push_back(blocks[index]);
+        VW_OUT(DebugMessage,"image") << "block_write_image: skipping " << blocks.size() - remaining.size()
+                                     << " journaled blocks.\n";
+        blocks.swap(remaining);
+        total_num_blocks = blocks.size();
+      }
+      for (size_t index = 0; index < blocks.size(); ++index) {
+        if (progress_callback.abort_requested())
+          token->cancel();
+        if (token->is_cancelled())
+          break;
+
+        int32 i = blocks[index].x() * block_size.x();
+        int32 j = blocks[index].y() * block_size.y();
+        VW_OUT(DebugMessage, "image") << "ImageIO scheduling block at [" << i << " " << j << "]/[" << rows << " " << cols << "] blocksize = " << block_size.x() << " x " <<  block_size.y() << "\n";
+
+        // Rasterize and save this image block
+        BBox2i current_bbox(Vector2i(i,j),
+                            Vector2i(std::min<int32>(i+block_size.x(),cols),
+                                     std::min<int32>(j+block_size.y(),rows)));
+
+        // Rasterize this image block by scheduling it with the block_writer.
+        block_writer.add_block(resource, image, current_bbox, int(index), total_num_blocks, progress_callback, empty_pixel );
       }
 
       // Start the threaded block writer and wait for all tasks to finish.
       block_writer.process_blocks();
+      // Record what was written, even if the write is being abandoned.
+      if (journal)
+        journal->checkpoint( resource );
+      if (token->is_cancelled())
+        vw_throw( Aborted() << "block_write_image: cancelled" );
     }
     progress_callback.report_finished();
   }
+  } // namespace detail
+  /// \endcond
+
+  /// Write an image to disk using multiple threads operating on tiles in parallel.
+  /// - Leave num_threads=0 to use the default number of threads from the settings.
+  /// - Cancelling cancel_token, or requesting an abort through the progress
+  ///   callback, skips the blocks which have not been started yet and
+  ///   throws vw::Aborted once the running ones have finished.
+  /// - The blocks are rasterized, and written, in the given order.
+  template <class ImageT>
+  void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                          int num_threads=0,
+                          boost::shared_ptr<CancelToken> const& cancel_token = boost::shared_ptr<CancelToken>(),
+                          BlockOrder const& order = BlockOrder()) {
+    detail::block_write_image( resource, image, (typename ImageT::pixel_type const*)0,
+                               progress_callback, num_threads, cancel_token, order );
+  }
+
+  /// Like block_write_image(), but the blocks are recorded in the journal
+  /// as they reach storage, and those it already records are skipped.
+  /// The journal must be for the size of the image and the block write
+  /// size of the resource, and the resource must support sync().  Once
+  /// the resource is flushed the journal file can be removed.
+  /// - What each block cost is recorded in stats, if given.
+  template <class ImageT>
+  void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                          BlockWriteJournal& journal,
+                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                          int num_threads=0,
+                          boost::shared_ptr<CancelToken> const& cancel_token = boost::shared_ptr<CancelToken>(),
+                          BlockWriteStats* stats = 0) {
+    detail::block_write_image( resource, image, (typename ImageT::pixel_type const*)0,
+                               progress_callback, num_threads, cancel_token, BlockOrder(), &journal, stats );
+  }
+
+  /// Like block_write_image(), but the rasterize and write time, cache
+  /// misses and bytes of each block are recorded in stats, e.g. to be
+  /// written out with BlockWriteStats::write_csv() or as a heatmap.
+  template <class ImageT>
+  void block_write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                          BlockWriteStats& stats,
+                          const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                          int num_threads=0,
+                          boost::shared_ptr<CancelToken> const& cancel_token = boost::shared_ptr<CancelToken>()) {
+    detail::block_write_image( resource, image, (typename ImageT::pixel_type const*)0,
+                               progress_callback, num_threads, cancel_token, BlockOrder(), 0, &stats );
+  }
+
+  /// Like block_write_image(), but a block of the image which
+  /// sparse_check() finds empty is not rasterized, and is written
+  /// filled with empty_pixel instead.  Use this only when empty_pixel
+  /// is what the image holds where its sources have no data, e.g.
+  /// their nodata value passed through unchanged.
+  template <class ImageT>
+  void block_write_sparse_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
+                                 typename ImageT::pixel_type const& empty_pixel,
+                                 const ProgressCallback &progress_callback = ProgressCallback::dummy_instance(),
+                                 int num_threads=0,
+                                 boost::shared_ptr<CancelToken> const& cancel_token = boost::shared_ptr<CancelToken>(),
+                                 BlockOrder const& order = BlockOrder()) {
+    detail::block_write_image( resource, image, &empty_pixel,
+                               progress_callback, num_threads, cancel_token, order );
+  }
 
   template <class ImageT>
   void write_image( DstImageResource& resource, ImageViewBase<ImageT> const& image,
@@ -20,11 +20,17 @@
 ///
 /// Defines a run-type-typed image buffer.
 ///
+#include <vw/config.h>
 #include <vw/Core/Exception.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Math/BBox.h>
 #include <vw/Image/ImageResource.h>
 
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  #include <emmintrin.h>
+  #include <smmintrin.h> // SSE4.1
+#endif
+
 #ifdef _MSC_VER
 #pragma warning(disable:4244)
 #pragma warning(disable:4267)
@@ -33,6 +39,8 @@
 #endif
 #include <map>
 #include <cmath>
+#include <cstring>
+#include <limits>
 
 #include <boost/integer_traits.hpp>
 #include <boost/smart_ptr/scoped_array.hpp>
@@ -396,6 +404,265 @@ ChannelUnpremultiplyMapEntry _unpremultiply_f32( &channel_unpremultiply_float<fl
 ChannelUnpremultiplyMapEntry _unpremultiply_f64( &channel_unpremultiply_float<double> );
 
 
+//-----------------------------------------------------------------------------------------
+// Packed row section
+
+// Most disk reads and writes convert between uint8, uint16 and float32
+// buffers whose pixels are packed along each row.  For these convert()
+// picks one row function per call, instead of calling the functions
+// above through pointers for every channel of every pixel.  The row
+// functions give exactly the same results as the per-channel path.
+
+namespace {
+
+  /// Channel converters matching the functions registered above.
+  template <class SrcT, class DstT>
+  struct CastConverter {
+    static DstT apply( SrcT src ) { return DstT(src); }
+  };
+  struct Uint8ToUint16Converter {
+    static uint16 apply( uint8 src ) { return uint16( src ) * (65535/255); }
+  };
+  struct Uint16ToUint8Converter {
+    static uint8 apply( uint16 src ) { return uint8( src / (65535/255) ); }
+  };
+  template <class SrcT, class DstT>
+  struct IntToFloatConverter {
+    static DstT apply( SrcT src ) {
+      return DstT(src) * (DstT(1.0)/boost::integer_traits<SrcT>::const_max);
+    }
+  };
+  template <class SrcT, class DstT>
+  struct FloatToIntConverter {
+    static DstT apply( SrcT src ) {
+      if( src > SrcT(1.0) ) return boost::integer_traits<DstT>::const_max;
+      else if( src < SrcT(0.0) ) return DstT(0);
+      return DstT( src * boost::integer_traits<DstT>::const_max );
+    }
+  };
+
+  /// The converter used when rescaling, where it differs from a cast.
+  template <class SrcT, class DstT> struct RescaleConverter { typedef CastConverter<SrcT,DstT> type; };
+  template <> struct RescaleConverter<uint8, uint16> { typedef Uint8ToUint16Converter type; };
+  template <> struct RescaleConverter<uint16,uint8 > { typedef Uint16ToUint8Converter type; };
+  template <> struct RescaleConverter<uint8, float > { typedef IntToFloatConverter<uint8, float> type; };
+  template <> struct RescaleConverter<uint16,float > { typedef IntToFloatConverter<uint16,float> type; };
+  template <> struct RescaleConverter<float, uint8 > { typedef FloatToIntConverter<float,uint8 > type; };
+  template <> struct RescaleConverter<float, uint16> { typedef FloatToIntConverter<float,uint16> type; };
+
+  /// Convert n consecutive channels.
+  template <class ConvT, class SrcT, class DstT>
+  inline void convert_channels_scalar( SrcT const* src, DstT* dst, size_t n ) {
+    for( size_t i=0; i<n; ++i )
+      dst[i] = ConvT::apply( src[i] );
+  }
+
+  /// Overloaded below with SSE versions of the common cases, which
+  /// finish the last few channels with convert_channels_scalar().
+  template <class ConvT, class SrcT, class DstT>
+  inline void convert_channels( ConvT, SrcT const* src, DstT* dst, size_t n ) {
+    convert_channels_scalar<ConvT>( src, dst, n );
+  }
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  // Integer to float: widen and multiply by the same float constant.
+  inline void uint8_to_float_sse( uint8 const* src, float* dst, size_t n, float scale, bool rescale ) {
+    const __m128 scalev = _mm_set1_ps( scale );
+    size_t i = 0;
+    for( ; i+16 <= n; i += 16 ) {
+      __m128i v = _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i ) );
+      for( int k=0; k<4; ++k ) {
+        __m128 f = _mm_cvtepi32_ps( _mm_cvtepu8_epi32( v ) );
+        _mm_storeu_ps( dst+i+4*k, rescale ? _mm_mul_ps( f, scalev ) : f );
+        v = _mm_srli_si128( v, 4 );
+      }
+    }
+    if( rescale ) convert_channels_scalar<IntToFloatConverter<uint8,float> >( src+i, dst+i, n-i );
+    else          convert_channels_scalar<CastConverter<uint8,float> >( src+i, dst+i, n-i );
+  }
+  inline void uint16_to_float_sse( uint16 const* src, float* dst, size_t n, float scale, bool rescale ) {
+    const __m128 scalev = _mm_set1_ps( scale );
+    size_t i = 0;
+    for( ; i+8 <= n; i += 8 ) {
+      __m128i v = _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i ) );
+      __m128 lo = _mm_cvtepi32_ps( _mm_cvtepu16_epi32( v ) );
+      __m128 hi = _mm_cvtepi32_ps( _mm_cvtepu16_epi32( _mm_srli_si128( v, 8 ) ) );
+      _mm_storeu_ps( dst+i,   rescale ? _mm_mul_ps( lo, scalev ) : lo );
+      _mm_storeu_ps( dst+i+4, rescale ? _mm_mul_ps( hi, scalev ) : hi );
+    }
+    if( rescale ) convert_channels_scalar<IntToFloatConverter<uint16,float> >( src+i, dst+i, n-i );
+    else          convert_channels_scalar<CastConverter<uint16,float> >( src+i, dst+i, n-i );
+  }
+
+  inline void convert_channels( CastConverter<uint8,float>, uint8 const* src, float* dst, size_t n ) {
+    uint8_to_float_sse( src, dst, n, 1.0f, false );
+  }
+  inline void convert_channels( IntToFloatConverter<uint8,float>, uint8 const* src, float* dst, size_t n ) {
+    uint8_to_float_sse( src, dst, n, 1.0f/255, true );
+  }
+  inline void convert_channels( CastConverter<uint16,float>, uint16 const* src, float* dst, size_t n ) {
+    uint16_to_float_sse( src, dst, n, 1.0f, false );
+  }
+  inline void convert_channels( IntToFloatConverter<uint16,float>, uint16 const* src, float* dst, size_t n ) {
+    uint16_to_float_sse( src, dst, n, 1.0f/65535, true );
+  }
+
+  // Float to integer: clamping to [0,1] before the multiply gives the
+  // same result as the two comparisons of FloatToIntConverter.
+  inline __m128i float_to_int_sse( float const* src, __m128 maxv ) {
+    __m128 v = _mm_min_ps( _mm_max_ps( _mm_loadu_ps( src ), _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+    return _mm_cvttps_epi32( _mm_mul_ps( v, maxv ) );
+  }
+  inline void convert_channels( FloatToIntConverter<float,uint8>, float const* src, uint8* dst, size_t n ) {
+    const __m128 maxv = _mm_set1_ps( 255.0f );
+    size_t i = 0;
+    for( ; i+16 <= n; i += 16 ) {
+      __m128i a = _mm_packs_epi32( float_to_int_sse( src+i,    maxv ), float_to_int_sse( src+i+4,  maxv ) );
+      __m128i b = _mm_packs_epi32( float_to_int_sse( src+i+8,  maxv ), float_to_int_sse( src+i+12, maxv ) );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i ), _mm_packus_epi16( a, b ) );
+    }
+    convert_channels_scalar<FloatToIntConverter<float,uint8> >( src+i, dst+i, n-i );
+  }
+  inline void convert_channels( FloatToIntConverter<float,uint16>, float const* src, uint16* dst, size_t n ) {
+    const __m128 maxv = _mm_set1_ps( 65535.0f );
+    size_t i = 0;
+    for( ; i+8 <= n; i += 8 )
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i ),
+                        _mm_packus_epi32( float_to_int_sse( src+i, maxv ), float_to_int_sse( src+i+4, maxv ) ) );
+    convert_channels_scalar<FloatToIntConverter<float,uint16> >( src+i, dst+i, n-i );
+  }
+
+  // Between the integer types.  x/257 is exact for all 16 bit x as
+  // (x*0xFF01) >> 24.
+  inline void convert_channels( Uint8ToUint16Converter, uint8 const* src, uint16* dst, size_t n ) {
+    const __m128i zero = _mm_setzero_si128(), mult = _mm_set1_epi16( 65535/255 );
+    size_t i = 0;
+    for( ; i+16 <= n; i += 16 ) {
+      __m128i v = _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i ) );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i   ), _mm_mullo_epi16( _mm_unpacklo_epi8( v, zero ), mult ) );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i+8 ), _mm_mullo_epi16( _mm_unpackhi_epi8( v, zero ), mult ) );
+    }
+    convert_channels_scalar<Uint8ToUint16Converter>( src+i, dst+i, n-i );
+  }
+  inline void convert_channels( CastConverter<uint8,uint16>, uint8 const* src, uint16* dst, size_t n ) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for( ; i+16 <= n; i += 16 ) {
+      __m128i v = _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i ) );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i   ), _mm_unpacklo_epi8( v, zero ) );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i+8 ), _mm_unpackhi_epi8( v, zero ) );
+    }
+    convert_channels_scalar<CastConverter<uint8,uint16> >( src+i, dst+i, n-i );
+  }
+  inline void convert_channels( Uint16ToUint8Converter, uint16 const* src, uint8* dst, size_t n ) {
+    const __m128i magic = _mm_set1_epi16( short(0xFF01) );
+    size_t i = 0;
+    for( ; i+16 <= n; i += 16 ) {
+      __m128i a = _mm_srli_epi16( _mm_mulhi_epu16( _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i   ) ), magic ), 8 );
+      __m128i b = _mm_srli_epi16( _mm_mulhi_epu16( _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i+8 ) ), magic ), 8 );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i ), _mm_packus_epi16( a, b ) );
+    }
+    convert_channels_scalar<Uint16ToUint8Converter>( src+i, dst+i, n-i );
+  }
+  inline void convert_channels( CastConverter<uint16,uint8>, uint16 const* src, uint8* dst, size_t n ) {
+    const __m128i low = _mm_set1_epi16( 0xFF );
+    size_t i = 0;
+    for( ; i+16 <= n; i += 16 ) {
+      __m128i a = _mm_and_si128( _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i   ) ), low );
+      __m128i b = _mm_and_si128( _mm_loadu_si128( reinterpret_cast<__m128i const*>( src+i+8 ) ), low );
+      _mm_storeu_si128( reinterpret_cast<__m128i*>( dst+i ), _mm_packus_epi16( a, b ) );
+    }
+    convert_channels_scalar<CastConverter<uint16,uint8> >( src+i, dst+i, n-i );
+  }
+#endif
+
+  /// Convert one row of packed pixels, expanding or contracting the
+  /// channels the same way as convert() does for each pixel.
+  template <class SrcT, class DstT, class ConvT, int SrcCh, int DstCh>
+  void convert_row( uint8 const* src_bytes, uint8* dst_bytes, size_t cols ) {
+    SrcT const* src = reinterpret_cast<SrcT const*>( src_bytes );
+    DstT      * dst = reinterpret_cast<DstT      *>( dst_bytes );
+    if( SrcCh == DstCh ) {
+      convert_channels( ConvT(), src, dst, cols*SrcCh );
+      return;
+    }
+    const int  copy_length = (SrcCh<3) ? 1 : (DstCh>=3) ? 3 : 0;
+    const bool triplicate  = SrcCh<3    && DstCh>=3;
+    const bool average     = SrcCh>=3   && DstCh<3;
+    const bool add_alpha   = SrcCh%2==1 && DstCh%2==0;
+    const bool copy_alpha  = SrcCh%2==0 && DstCh%2==0;
+    const DstT max_value   = std::numeric_limits<DstT>::is_integer ? std::numeric_limits<DstT>::max() : DstT(1.0);
+    for( size_t c=0; c<cols; ++c, src+=SrcCh, dst+=DstCh ) {
+      for( int ch=0; ch<copy_length; ++ch )
+        dst[ch] = ConvT::apply( src[ch] );
+      if( triplicate ) {
+        dst[1] = ConvT::apply( src[0] );
+        dst[2] = ConvT::apply( src[0] );
+      }
+      else if( average ) {
+        DstT buf[3] = { ConvT::apply( src[0] ), ConvT::apply( src[1] ), ConvT::apply( src[2] ) };
+        channel_average( buf, dst, 3 );
+      }
+      if( copy_alpha )
+        dst[DstCh-1] = ConvT::apply( src[SrcCh-1] );
+      else if( add_alpha )
+        dst[DstCh-1] = max_value;
+    }
+  }
+
+  /// Converts cols packed pixels from src to dst.
+  typedef void (*row_convert_func)( uint8 const* src, uint8* dst, size_t cols );
+
+  template <class SrcT, class DstT, class ConvT>
+  row_convert_func select_row_function( int src_channels, int dst_channels ) {
+    if( src_channels < 1 || src_channels > 4 || dst_channels < 1 || dst_channels > 4 )
+      return 0;
+    static const row_convert_func table[4][4] = {
+      { &convert_row<SrcT,DstT,ConvT,1,1>, &convert_row<SrcT,DstT,ConvT,1,2>, &convert_row<SrcT,DstT,ConvT,1,3>, &convert_row<SrcT,DstT,ConvT,1,4> },
+      { &convert_row<SrcT,DstT,ConvT,2,1>, &convert_row<SrcT,DstT,ConvT,2,2>, &convert_row<SrcT,DstT,ConvT,2,3>, &convert_row<SrcT,DstT,ConvT,2,4> },
+      { &convert_row<SrcT,DstT,ConvT,3,1>, &convert_row<SrcT,DstT,ConvT,3,2>, &convert_row<SrcT,DstT,ConvT,3,3>, &convert_row<SrcT,DstT,ConvT,3,4> },
+      { &convert_row<SrcT,DstT,ConvT,4,1>, &convert_row<SrcT,DstT,ConvT,4,2>, &convert_row<SrcT,DstT,ConvT,4,3>, &convert_row<SrcT,DstT,ConvT,4,4> } };
+    return table[src_channels-1][dst_channels-1];
+  }
+
+  template <class SrcT, class DstT>
+  row_convert_func select_row_function( bool rescale, int src_channels, int dst_channels ) {
+    if( rescale )
+      return select_row_function<SrcT,DstT,typename RescaleConverter<SrcT,DstT>::type>( src_channels, dst_channels );
+    return select_row_function<SrcT,DstT,CastConverter<SrcT,DstT> >( src_channels, dst_channels );
+  }
+
+  template <class SrcT>
+  row_convert_func select_row_function( ChannelTypeEnum dst_type, bool rescale, int src_channels, int dst_channels ) {
+    switch( dst_type ) {
+    case VW_CHANNEL_UINT8:   return select_row_function<SrcT,uint8 >( rescale, src_channels, dst_channels );
+    case VW_CHANNEL_UINT16:  return select_row_function<SrcT,uint16>( rescale, src_channels, dst_channels );
+    case VW_CHANNEL_FLOAT32: return select_row_function<SrcT,float >( rescale, src_channels, dst_channels );
+    default: return 0;
+    }
+  }
+
+  /// The row function for a conversion, or null if it has none.
+  row_convert_func select_row_function( ChannelTypeEnum src_type, ChannelTypeEnum dst_type, bool rescale,
+                                        int src_channels, int dst_channels ) {
+    switch( src_type ) {
+    case VW_CHANNEL_UINT8:   return select_row_function<uint8 >( dst_type, rescale, src_channels, dst_channels );
+    case VW_CHANNEL_UINT16:  return select_row_function<uint16>( dst_type, rescale, src_channels, dst_channels );
+    case VW_CHANNEL_FLOAT32: return select_row_function<float >( dst_type, rescale, src_channels, dst_channels );
+    default: return 0;
+    }
+  }
+
+  /// True if the channels of buf are aligned and its pixels are packed along each row.
+  bool has_packed_rows( ImageBuffer const& buf, size_t channels, size_t chstride ) {
+    return buf.cstride == ssize_t(channels*chstride) &&
+           size_t(buf.data) % chstride == 0 && buf.rstride % ssize_t(chstride) == 0 &&
+           buf.pstride % ssize_t(chstride) == 0;
+  }
+
+} // end anonymous namespace
+
+
 //-----------------------------------------------------------------------------------------
 // Main conversion functions
 
@@ -497,6 +764,20 @@ void vw::convert( ImageBuffer const& dst, ImageBuffer const& src, bool rescale )
   if( !conv_func || !max_func || !avg_func || !unpremultiply_src_func || !premultiply_dst_func || !premultiply_src_func )
     vw_throw( NoImplErr() << "Unsupported channel type combination in convert (" << src.format.channel_type << ", " << dst.format.channel_type << ")!" );
 
+  // Packed rows of the common channel types are converted a row at a time.
+  if( !unpremultiply_src && !premultiply_src && !premultiply_dst &&
+      has_packed_rows( src, src_channels, src_chstride ) && has_packed_rows( dst, dst_channels, dst_chstride ) ) {
+    row_convert_func row_func = select_row_function( src.format.channel_type, dst.format.channel_type, rescale,
+                                                     src_channels, dst_channels );
+    if( row_func ) {
+      for( uint32 p=0; p<src.format.planes; ++p )
+        for( uint32 r=0; r<src.format.rows; ++r )
+          row_func( (uint8 const*)src.data + p*src.pstride + r*src.rstride,
+                    (uint8*)dst.data + p*dst.pstride + r*dst.rstride, src.format.cols );
+      return;
+    }
+  }
+
   int32 max_channels = std::max( src_channels, dst_channels );
 
   boost::scoped_array<uint8> src_buf(new uint8[max_channels*src_chstride]);
@@ -32,6 +32,8 @@
 
 #include <vw/Image/PixelTypeInfo.h>
 
+#include <boost/shared_ptr.hpp>
+
 namespace vw {
 
   // Forward declaration
@@ -69,6 +71,14 @@ namespace vw {
           && premultiplied == b.premultiplied;
     }
 
+    /// True if convert() from this format into b only copies bytes, so
+    /// a reader may decode straight into a destination of format b.
+    inline bool copy_convert(const ImageFormat& b) const {
+      bool alpha = pixel_format == VW_PIXEL_GRAYA || pixel_format == VW_PIXEL_RGBA;
+      return pixel_format == b.pixel_format && channel_type == b.channel_type
+          && planes == b.planes && (!alpha || premultiplied == b.premultiplied);
+    }
+
     inline bool same_size(const ImageFormat& b) const {
       return cols == b.cols && rows == b.rows && planes == b.planes;
     }
@@ -146,6 +156,21 @@ namespace vw {
       virtual size_t native_size() const;
   };
 
+  /// A block that DstImageResource::encode_block() has prepared for
+  /// writing.  Resources derive from this to carry whatever their
+  /// write_encoded_block() consumes, e.g. converted or compressed data.
+  class EncodedBlock {
+    public:
+      explicit EncodedBlock( BBox2i const& bbox ) : m_bbox(bbox) {}
+      virtual ~EncodedBlock() {}
+
+      /// Where the block goes in the resource.
+      BBox2i const& bbox() const { return m_bbox; }
+
+    private:
+      BBox2i m_bbox;
+  };
+
   /// A write-only image resource
   class DstImageResource {
     public:
@@ -179,6 +204,35 @@ namespace vw {
 
       /// Force any changes to be written to the resource.
       virtual void flush() = 0;
+
+      // Does this resource support sync()?
+      virtual bool has_sync() const { return false; }
+
+      /// Write the blocks written so far through to storage, where they
+      /// survive the process dying, while the resource stays open for
+      /// writing.  Unlike flush(), more blocks may be written afterwards.
+      virtual void sync() {
+        vw_throw(NoImplErr() << "This ImageResource does not support sync()");
+      }
+
+      // Can write() be split into encode_block() and write_encoded_block()?
+      // If you override this to true, you must implement both.
+      virtual bool has_encoded_write() const { return false; }
+
+      /// Do the per-block work of writing the buffer at the given
+      /// location (conversion, compression, ...) without touching the
+      /// resource.  block_write_image() calls this from several threads
+      /// at once, while another thread is in write_encoded_block().
+      virtual boost::shared_ptr<EncodedBlock> encode_block( ImageBuffer const& /*buf*/,
+                                                            BBox2i const& /*bbox*/ ) const {
+        vw_throw(NoImplErr() << "This ImageResource does not support encoded writes");
+      }
+
+      /// Write a block returned by encode_block().  Called from one
+      /// thread at a time, in block order.
+      virtual void write_encoded_block( EncodedBlock const& /*block*/ ) {
+        vw_throw(NoImplErr() << "This ImageResource does not support encoded writes");
+      }
   };
 
   // A read-write image resource
@@ -32,15 +32,17 @@ namespace cv {class Mat;}
 
 namespace vw {
 
-/// ImageResource to read/write OpenCV in-memory images.
+/// ImageResource to read/write OpenCV in-memory images.  Reads and
+/// writes convert straight between the matrix and the caller's buffer;
+/// see vw/Image/ImageViewOpenCV.h to share pixels with no conversion.
 class ImageResourceOpenCV : public ImageResource {
   private:
     ImageFormat                m_format;
     boost::shared_ptr<cv::Mat> m_matrix;
 
   protected:
-    /// is the given bbox roi stored contiguously in memory?
-    bool contiguous_roi(const BBox2i& bbox) const;
+    /// A buffer over the given bbox roi of the matrix, in place.
+    ImageBuffer roi_buffer(const BBox2i& bbox) const;
     /// identify the current matrix type
     ImageFormat identify() const;
 
@@ -95,6 +95,73 @@ void SrcImageResourceStream::reset() {
   VW_ASSERT(!m_stream->fail(), IOErr() << "Failed to seek. Is this input stream seekable?");
 }
 
+SrcImageResourceScanlineStream::SrcImageResourceScanlineStream(stream_type* stream, ImageFormat fmt,
+                                                               int32 block_rows, int32 max_buffered_rows)
+  : m_stream(stream, NOP()), m_fmt(fmt) {
+  init(block_rows, max_buffered_rows);
+}
+SrcImageResourceScanlineStream::SrcImageResourceScanlineStream(boost::shared_ptr<stream_type> stream, ImageFormat fmt,
+                                                               int32 block_rows, int32 max_buffered_rows)
+  : m_stream(stream), m_fmt(fmt) {
+  init(block_rows, max_buffered_rows);
+}
+
+void SrcImageResourceScanlineStream::init(int32 block_rows, int32 max_buffered_rows) {
+  VW_ASSERT(m_fmt.complete(), ArgumentErr() << "ImageFormat must fully describe the image data");
+  VW_ASSERT(m_fmt.planes == 1, NoImplErr() << "SrcImageResourceScanlineStream: multi-plane images are not supported");
+  VW_ASSERT(block_rows > 0, ArgumentErr() << "SrcImageResourceScanlineStream: block_rows must be positive");
+
+  m_block_rows = std::min(block_rows, int32(m_fmt.rows));
+  m_max_rows   = max_buffered_rows > 0 ? max_buffered_rows : 2 * m_block_rows;
+  m_max_rows   = std::max(std::min(m_max_rows, int32(m_fmt.rows)), m_block_rows);
+  m_rows.resize(size_t(m_max_rows) * m_fmt.rstride());
+  m_first_row = m_end_row = 0;
+}
+
+int32 SrcImageResourceScanlineStream::first_buffered_row() const {
+  Mutex::Lock lock(m_mutex);
+  return m_first_row;
+}
+
+int32 SrcImageResourceScanlineStream::end_buffered_row() const {
+  Mutex::Lock lock(m_mutex);
+  return m_end_row;
+}
+
+void SrcImageResourceScanlineStream::read( ImageBuffer const& dst_buf, BBox2i const& bbox ) const {
+  VW_ASSERT(dst_buf.format.cols == uint32(bbox.width()) && dst_buf.format.rows == uint32(bbox.height()),
+      LogicErr() << VW_CURRENT_FUNCTION << ": Destination buffer does not match the requested box" );
+  VW_ASSERT(bbox.min().x() >= 0 && bbox.min().y() >= 0 &&
+            bbox.max().x() <= int32(m_fmt.cols) && bbox.max().y() <= int32(m_fmt.rows),
+      ArgumentErr() << VW_CURRENT_FUNCTION << ": " << bbox << " is outside the image" );
+  VW_ASSERT(bbox.height() <= m_max_rows,
+      ArgumentErr() << VW_CURRENT_FUNCTION << ": Cannot read " << bbox.height()
+                    << " rows at once, only " << m_max_rows << " are buffered" );
+
+  Mutex::Lock lock(m_mutex);
+  VW_ASSERT(bbox.min().y() >= m_first_row,
+      LogicErr() << VW_CURRENT_FUNCTION << ": Row " << bbox.min().y()
+                 << " has already been dropped from the stream buffer" );
+
+  size_t rstride = m_fmt.rstride();
+  while (m_end_row < bbox.max().y()) {
+    VW_ASSERT(!m_stream->fail(), IOErr() << "Can't read from stream (the bad or fail flag is already up)");
+    if (m_end_row - m_first_row == m_max_rows)
+      m_first_row++;
+    perform_read(m_stream.get(),
+                 reinterpret_cast<char*>(&m_rows[(m_end_row % m_max_rows) * rstride]), rstride);
+    m_end_row++;
+  }
+
+  ImageFormat row_fmt = m_fmt;
+  row_fmt.rows = 1;
+  for (int32 r = bbox.min().y(); r < bbox.max().y(); ++r) {
+    ImageBuffer src_row(row_fmt, &m_rows[(r % m_max_rows) * rstride]);
+    convert(dst_buf.cropped(BBox2i(0, r - bbox.min().y(), bbox.width(), 1)),
+            src_row.cropped(BBox2i(bbox.min().x(), 0, bbox.width(), 1)), false);
+  }
+}
+
 DstImageResourceStream::DstImageResourceStream(stream_type* stream)
   : m_stream(stream, NOP()) {}
 DstImageResourceStream::DstImageResourceStream(boost::shared_ptr<stream_type> stream)
@@ -22,7 +22,9 @@
 #define __VW_IMAGE_IMAGERESOURCESTREAM_H__
 
 #include <vw/Image/ImageResource.h>
+#include <vw/Core/Thread.h>
 #include <boost/noncopyable.hpp>
+#include <vector>
 
 namespace vw {
 
@@ -63,6 +65,57 @@ class SrcImageResourceStream : public SrcImageResource, private boost::noncopyab
     ImageFormat m_fmt;
 };
 
+/// ImageResource that reads an image from a forward-only std::stream,
+/// such as a pipe or a socket, one band of rows at a time.
+///
+/// The stream holds the rows of a single-plane image in m_fmt, top to
+/// bottom, with nothing in between.  Only the most recent
+/// max_buffered_rows rows are kept in memory: a read pulls rows from
+/// the stream until it has the bottom of the requested box, dropping
+/// the oldest rows to make room.  Reads must therefore move down the
+/// image; asking for rows which have been dropped throws a LogicErr.
+/// Reads of the same band from several threads (e.g. the tiles of a
+/// BlockRasterizeView) are fine as long as max_buffered_rows covers the
+/// bands in flight.
+class SrcImageResourceScanlineStream : public SrcImageResource, private boost::noncopyable
+{
+  public:
+    typedef std::istream stream_type;
+
+    /// The block read size is block_rows full rows; max_buffered_rows
+    /// defaults to two blocks.
+    // Caller is responsible for object lifetime.
+    SrcImageResourceScanlineStream(stream_type* stream, ImageFormat fmt,
+                                   int32 block_rows = 256, int32 max_buffered_rows = 0);
+    // Caller gives control of lifetime to this class
+    SrcImageResourceScanlineStream(boost::shared_ptr<stream_type> stream, ImageFormat fmt,
+                                   int32 block_rows = 256, int32 max_buffered_rows = 0);
+
+    virtual ImageFormat format() const { return m_fmt; }
+
+    // Read the given rows, which must not have been dropped yet.
+    virtual void read( ImageBuffer const& dest, BBox2i const& bbox ) const;
+
+    virtual bool     has_block_read () const {return true;}
+    virtual Vector2i block_read_size() const {return Vector2i(m_fmt.cols, m_block_rows);}
+    virtual bool     has_nodata_read() const {return false;}
+
+    /// The first row still in memory, and one past the last.
+    int32 first_buffered_row() const;
+    int32 end_buffered_row  () const;
+
+  protected:
+    void init(int32 block_rows, int32 max_buffered_rows);
+
+    boost::shared_ptr<stream_type> m_stream;
+    ImageFormat m_fmt;
+    int32       m_block_rows, m_max_rows;
+    // Row r lives at slot r % m_max_rows.
+    mutable std::vector<uint8> m_rows;
+    mutable int32 m_first_row, m_end_row;
+    mutable Mutex m_mutex;
+};
+
 /// ImageResource that writes to an std::stream
 class DstImageResourceStream : public DstImageResource, private boost::noncopyable
 {
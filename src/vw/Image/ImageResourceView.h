@@ -117,6 +117,17 @@ namespace vw {
     boost::shared_ptr<Mutex> m_rsrc_mutex;
   };
 
+  /// An ImageResourceView is a source.  Copies share their resource.
+  template <class PixelT>
+  class SourceFootprint<ImageResourceView<PixelT> > {
+    ImageResourceView<PixelT> const& m_view;
+  public:
+    SourceFootprint(ImageResourceView<PixelT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      footprint.add( m_view.resource(), "ImageResourceView", Vector2i( m_view.cols(), m_view.rows() ), bbox );
+    }
+  };
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGERESOURCEVIEW_H__
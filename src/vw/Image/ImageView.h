@@ -29,11 +29,34 @@
 #include <boost/type_traits.hpp>
 
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Footprint.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Core/CacheSpill.h>
+#include <vw/Core/BufferPool.h>
+#include <vw/Core/System.h>
 
 namespace vw {
 
+  /// \cond INTERNAL
+  namespace detail {
+    // Destroys the pixels of an ImageView buffer taken from a BufferPool
+    // and hands the memory back to it.
+    template <class PixelT>
+    struct PooledPixelDeleter {
+      BufferPool* pool;
+      size_t      count;
+      PooledPixelDeleter( BufferPool* pool, size_t count ) : pool(pool), count(count) {}
+      void operator()( PixelT* pixels ) const {
+        if ( !boost::has_trivial_destructor<PixelT>::value )
+          for ( size_t i = 0; i < count; ++i )
+            pixels[i].~PixelT();
+        pool->release( pixels, count*sizeof(PixelT) );
+      }
+    };
+  }
+  /// \endcond
+
   /// The standard image container for in-memory image data.
   ///
   /// This class represents an image stored in memory or, more
@@ -106,6 +129,13 @@ namespace vw {
       set_size( cols, rows, planes );
     }
 
+    /// Constructs an image on top of existing pixel data that is laid
+    /// out the way ImageView lays out its own buffer (rows of cols
+    /// pixels, then planes).  The view shares ownership of the data.
+    ImageView( boost::shared_array<PixelT> const& data, int32 cols, int32 rows, int32 planes=1 )
+      : m_data(data), m_cols(cols), m_rows(rows), m_planes(planes),
+        m_origin(data.get()), m_rstride(cols), m_pstride(ssize_t(cols)*rows) {}
+
     /// Constructs an image view and rasterizes the given view into it.
     template <class ViewT>
     ImageView( ViewT const& view )
@@ -170,6 +200,12 @@ namespace vw {
 
     /// Adjusts the size of the image, allocating a new buffer if the size has changed.
     void set_size( int32 cols, int32 rows, int32 planes = 1 ) {
+      set_size( cols, rows, planes, 0 );
+    }
+
+    /// Same, taking a new buffer from the given pool instead of the
+    /// heap, see vw_buffer_pool().  The pool must outlive the buffer.
+    void set_size( int32 cols, int32 rows, int32 planes, BufferPool* pool ) {
       // These sizes are pretty large for in-memory images and should only come up
       //  in the case of bugs in the code.
       static const int32  MAX_PIXEL_SIZE   = 80000;
@@ -203,7 +239,18 @@ namespace vw {
       if( size==0 )
         m_data.reset();
       else {
-        boost::shared_array<PixelT> data( new (std::nothrow) PixelT[size] );
+        boost::shared_array<PixelT> data;
+        if( pool ) {
+          PixelT *pixels = static_cast<PixelT*>( pool->allocate( size*sizeof(PixelT) ) );
+          if( pixels ) {
+            if( !boost::has_trivial_default_constructor<PixelT>::value )
+              for( size_t i=0; i<size; ++i )
+                new (pixels+i) PixelT();
+            data.reset( pixels, detail::PooledPixelDeleter<PixelT>( pool, size ) );
+          }
+        }
+        else
+          data.reset( new (std::nothrow) PixelT[size] );
         if (!data) {
           // print it and throw it for the benefit of OSX, which doesn't print the exception what() on terminate()
           VW_OUT(ErrorMessage)   << "Cannot allocate enough memory for a " 
@@ -296,6 +343,61 @@ namespace vw {
   template <class PixelT>
   struct IsMultiplyAccessible<ImageView<PixelT> > : public true_type {};
 
+  template <class PixelT>
+  struct IsRowEvaluable<ImageView<PixelT> > : public true_type {};
+
+  /// Reads and writes an ImageView row through a bare pointer.
+  template <class PixelT>
+  class RowEvaluator<ImageView<PixelT> > {
+    PixelT *m_row;
+  public:
+    typedef PixelT& result_type;
+    RowEvaluator( ImageView<PixelT> const& view, int32 i, int32 j, int32 p ) : m_row( &view(i,j,p) ) {}
+    inline result_type operator[]( int32 n ) const { return m_row[n]; }
+  };
+
+  /// An ImageView is a source.  Copies share their data, so they are
+  /// the same source.
+  template <class PixelT>
+  class SourceFootprint<ImageView<PixelT> > {
+    ImageView<PixelT> const& m_view;
+  public:
+    SourceFootprint(ImageView<PixelT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      footprint.add( m_view.data(), "ImageView", Vector2i( m_view.cols(), m_view.rows() ), bbox );
+    }
+  };
+
+  /// Lets the Cache spill image tiles to disk.  The dimensions are
+  /// written in front of the raw pixel data, which is only done for
+  /// pixel types that can be copied bytewise.
+  template <class PixelT>
+  struct CacheSpillTraits<ImageView<PixelT> > {
+    static const bool spillable = boost::has_trivial_copy<PixelT>::value;
+
+    static void save( ImageView<PixelT> const& image, std::vector<uint8>& buffer ) {
+      int32 dims[3] = { image.cols(), image.rows(), image.planes() };
+      size_t num_bytes = size_t(dims[0]) * dims[1] * dims[2] * sizeof(PixelT);
+      buffer.resize( sizeof(dims) + num_bytes );
+      memcpy( &buffer[0], dims, sizeof(dims) );
+      if (num_bytes)
+        memcpy( &buffer[sizeof(dims)], image.data(), num_bytes );
+    }
+
+    static boost::shared_ptr<ImageView<PixelT> > load( uint8 const* data, size_t size ) {
+      int32 dims[3];
+      VW_ASSERT( size >= sizeof(dims), IOErr() << "Truncated spilled image." );
+      memcpy( dims, data, sizeof(dims) );
+      boost::shared_ptr<ImageView<PixelT> > image( new ImageView<PixelT>() );
+      image->set_size( dims[0], dims[1], dims[2], &vw_buffer_pool() );
+      size_t num_bytes = size_t(dims[0]) * dims[1] * dims[2] * sizeof(PixelT);
+      VW_ASSERT( size == sizeof(dims) + num_bytes, IOErr() << "Truncated spilled image." );
+      if (num_bytes)
+        memcpy( image->data(), data + sizeof(dims), num_bytes );
+      return image;
+    }
+  };
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGEVIEW_H__
@@ -34,6 +34,8 @@
 
 #include <boost/type_traits.hpp>
 #include <boost/utility/enable_if.hpp>
+#include <boost/mpl/logical.hpp>
+#include <boost/mpl/if.hpp>
 
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Image/ImageResource.h>
@@ -143,6 +145,22 @@ namespace vw {
   template <class ImplT>
   struct IsMultiplyAccessible : public false_type {};
 
+  /// Indicates whether a view specializes RowEvaluator, so that a row
+  /// of it can be computed by a plain indexed loop instead of through
+  /// pixel accessors.  Only views that are pure per-pixel functions
+  /// of in-memory data should claim this.
+  template <class ImplT>
+  struct IsRowEvaluable : public false_type {};
+
+  /// Evaluates one row of one plane of a view, starting at a given
+  /// column.  Specializations hold whatever pointers or functors they
+  /// need and provide a result_type typedef and operator[](int32 n),
+  /// which returns the pixel n columns to the right of the start.  A
+  /// result_type that is a non-const reference makes the view a
+  /// valid destination for rasterize_rows().
+  template <class ImplT>
+  class RowEvaluator;
+
 
   // *******************************************************************
   // Pixel iteration functions
@@ -321,6 +339,57 @@ namespace vw {
     rasterize( src, dest, BBox2i(0,0,src.cols(),src.rows()) );
   }
 
+  /// \cond INTERNAL
+  namespace detail {
+    template <class ViewT>
+    struct IsRowWritable {
+      template <class T, bool Evaluable> struct impl : public false_type {};
+      template <class T> struct impl<T,true> {
+        typedef typename RowEvaluator<T>::result_type result_type;
+        typedef typename boost::mpl::and_<boost::is_reference<result_type>,
+                                          boost::mpl::not_<boost::is_const<typename boost::remove_reference<result_type>::type> > >::type type;
+        static const bool value = type::value;
+      };
+      typedef typename impl<ViewT,IsRowEvaluable<ViewT>::value>::type type;
+      static const bool value = type::value;
+    };
+
+    template <class SrcT, class DestT>
+    inline void rasterize_rows( SrcT const& src, DestT const& dest, BBox2i const& bbox, true_type ) {
+      typedef typename DestT::pixel_type DestPixelT;
+      VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==src.planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      const int32 width = bbox.width();
+      if( width == 0 ) return;
+      for( int32 plane=0; plane<src.planes(); ++plane ) {
+        for( int32 row=0; row<bbox.height(); ++row ) {
+          RowEvaluator<SrcT>  s( src, bbox.min().x(), bbox.min().y()+row, plane );
+          RowEvaluator<DestT> d( dest, 0, row, plane );
+          for( int32 col=0; col<width; ++col )
+            d[col] = DestPixelT( s[col] );
+        }
+      }
+    }
+
+    template <class SrcT, class DestT>
+    inline void rasterize_rows( SrcT const& src, DestT const& dest, BBox2i const& bbox, false_type ) {
+      vw::rasterize( src, dest, bbox );
+    }
+  }
+  /// \endcond
+
+  /// Rasterizes a chain of per-pixel views.  When every view in the
+  /// source chain specializes RowEvaluator and the destination is
+  /// row-writable (an ImageView or a crop of one), the whole
+  /// expression is evaluated one row at a time in a single indexed
+  /// loop, which the compiler can inline and vectorize.  Otherwise
+  /// this is the same as vw::rasterize.
+  template <class SrcT, class DestT>
+  inline void rasterize_rows( SrcT const& src, DestT const& dest, BBox2i const& bbox ) {
+    typedef typename boost::mpl::and_<IsRowEvaluable<SrcT>, detail::IsRowWritable<DestT> >::type fused;
+    detail::rasterize_rows( src, dest, bbox, typename boost::mpl::if_<fused,true_type,false_type>::type() );
+  }
+
   /// A specialization for resizable destination views.
   ///
   /// This function resizes the destination view prior to
@@ -0,0 +1,126 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ImageViewOpenCV.h
+///
+/// Passes images between VW and OpenCV without copying them.
+///
+/// An ImageView of one plane stores its pixels row after row with no
+/// gaps, which is a continuous cv::Mat of the matching type.
+/// opencv_wrap() makes a cv::Mat header over an ImageView's pixels, and
+/// opencv_view() an ImageView over a cv::Mat's, sharing ownership of
+/// them.  The pixels are only copied or converted when the two layouts
+/// differ: a view which is not an ImageView, a matrix whose rows have
+/// gaps, or a matrix of another channel type.
+///
+/// Only available when VW is built with OpenCV.
+#ifndef __VW_IMAGE_IMAGEVIEWOPENCV_H__
+#define __VW_IMAGE_IMAGEVIEWOPENCV_H__
+
+#include <boost/shared_array.hpp>
+#include <boost/static_assert.hpp>
+
+#include <vw/Core/Exception.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+#include <opencv2/core/core.hpp>
+
+namespace vw {
+
+  /// \cond INTERNAL
+  namespace detail {
+    template <class ChannelT> struct OpenCVDepth          { static const int value = -1;     };
+    template <>               struct OpenCVDepth<uint8  > { static const int value = CV_8U;  };
+    template <>               struct OpenCVDepth<int8   > { static const int value = CV_8S;  };
+    template <>               struct OpenCVDepth<uint16 > { static const int value = CV_16U; };
+    template <>               struct OpenCVDepth<int16  > { static const int value = CV_16S; };
+    template <>               struct OpenCVDepth<int32  > { static const int value = CV_32S; };
+    template <>               struct OpenCVDepth<float32> { static const int value = CV_32F; };
+    template <>               struct OpenCVDepth<float64> { static const int value = CV_64F; };
+
+    // Keeps a matrix's pixels alive for as long as an ImageView's
+    // shared_array holds this deleter.
+    struct OpenCVMatOwner {
+      cv::Mat mat;
+      explicit OpenCVMatOwner( cv::Mat const& mat ) : mat(mat) {}
+      void operator()( void const* ) {}
+    };
+  }
+  /// \endcond
+
+  /// The OpenCV type of a pixel type, CV_8UC3 for PixelRGB<uint8>, or
+  /// -1 if OpenCV has no channel type for its channels.
+  template <class PixelT>
+  struct OpenCVType {
+    static const int depth = detail::OpenCVDepth<typename PixelChannelType<PixelT>::type>::value;
+    static const int value = depth < 0 ? -1 : CV_MAKETYPE( depth, PixelNumChannels<PixelT>::value );
+  };
+
+  /// A cv::Mat header over the pixels of an image, with no copy.  The
+  /// matrix does not own them, so the image (or a copy of it) must
+  /// outlive the matrix.
+  template <class PixelT>
+  cv::Mat opencv_wrap( ImageView<PixelT> const& image ) {
+    BOOST_STATIC_ASSERT( OpenCVType<PixelT>::value >= 0 );
+    BOOST_STATIC_ASSERT( sizeof(PixelT) == PixelNumChannels<PixelT>::value *
+                                           sizeof(typename PixelChannelType<PixelT>::type) );
+    VW_ASSERT( image.planes() <= 1, ArgumentErr() << "opencv_wrap: OpenCV matrices have only one plane." );
+    if ( image.cols() == 0 || image.rows() == 0 )
+      return cv::Mat();
+    return cv::Mat( image.rows(), image.cols(), OpenCVType<PixelT>::value,
+                    const_cast<PixelT*>( &image(0,0) ), sizeof(PixelT) * image.cols() );
+  }
+
+  /// A cv::Mat header over any view.  An ImageView is wrapped as it is,
+  /// and any other view is rasterized first.  Either way buffer holds
+  /// the pixels, and must outlive the matrix.
+  template <class ViewT>
+  cv::Mat opencv_wrap( ImageViewBase<ViewT> const& view, ImageView<typename ViewT::pixel_type>& buffer ) {
+    buffer = view.impl();
+    return opencv_wrap( buffer );
+  }
+
+  /// An ImageView over the pixels of a matrix, which it keeps alive.
+  /// The pixels are copied when the rows of the matrix have gaps, and
+  /// converted when it has the same number of channels as PixelT but
+  /// another channel type.
+  template <class PixelT>
+  ImageView<PixelT> opencv_view( cv::Mat const& mat ) {
+    BOOST_STATIC_ASSERT( OpenCVType<PixelT>::value >= 0 );
+    if ( mat.empty() )
+      return ImageView<PixelT>();
+    VW_ASSERT( mat.dims == 2, ArgumentErr() << "opencv_view: The matrix has " << mat.dims << " dimensions." );
+
+    cv::Mat pixels = mat;
+    if ( mat.type() != OpenCVType<PixelT>::value ) {
+      VW_ASSERT( mat.channels() == int( PixelNumChannels<PixelT>::value ),
+                 ArgumentErr() << "opencv_view: The matrix has " << mat.channels() << " channels, not "
+                               << int( PixelNumChannels<PixelT>::value ) << "." );
+      mat.convertTo( pixels, OpenCVType<PixelT>::value );
+    }
+    else if ( !mat.isContinuous() )
+      pixels = mat.clone();
+
+    boost::shared_array<PixelT> data( reinterpret_cast<PixelT*>( pixels.data ), detail::OpenCVMatOwner( pixels ) );
+    return ImageView<PixelT>( data, pixels.cols, pixels.rows );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_IMAGEVIEWOPENCV_H__
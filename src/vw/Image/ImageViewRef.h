@@ -38,6 +38,7 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <vw/Core/Thread.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/SparseImageCheck.h>
@@ -89,7 +90,9 @@ namespace vw {
 
   /// A special virtualized accessor adaptor.
   ///
-  /// This accessor adaptor is used by the \ref vw::ImageViewRef class.
+  /// Every step and dereference is a virtual call into the wrapped
+  /// view's own accessor.  This is ImageViewRef::per_pixel_origin(),
+  /// for the rare caller that only touches a few scattered pixels.
   template <class PixelT>
   class ImageViewRefAccessor {
   private:
@@ -138,8 +141,111 @@ namespace vw {
     virtual pixel_accessor origin() const = 0;
 
     virtual bool sparse_check( BBox2i const& bbox ) const = 0;
+    virtual void footprint( BBox2i const& bbox, Footprint& footprint ) const = 0;
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const = 0;
   };
+  /// \endcond
+
+
+  /// A bulk accessor of \ref vw::ImageViewRef, for row-major walks over
+  /// much of the view.  See ImageViewRef::strip_origin().
+  ///
+  /// Stepping is plain index arithmetic.  The first dereference in a
+  /// strip of whole rows rasterizes that strip through one virtual
+  /// call, and copies of the accessor pick up the newest strip, so a
+  /// row-major walk over the view costs one virtual call per strip
+  /// instead of several per pixel.  Strips are immutable once made, so
+  /// copies may be used from different threads.  Positions outside the
+  /// view fall back to the view's operator().
+  template <class PixelT>
+  class ImageViewRefBlockAccessor {
+  public:
+    typedef PixelT  pixel_type;
+    typedef PixelT  result_type;
+    typedef ssize_t offset_type;
+
+    /// Roughly how many pixels (per plane) each rasterized strip holds.
+    static const int32 strip_pixels = 1 << 18;
+
+  private:
+    struct Strip {
+      ImageView<PixelT> buf;
+      ssize_t begin_row, end_row;
+    };
+    /// The newest strip, shared by all copies of one origin().
+    struct Latest {
+      Mutex mutex;
+      boost::shared_ptr<Strip const> strip;
+    };
+
+    boost::shared_ptr<ImageViewRefBase<PixelT> const> m_view;
+    boost::shared_ptr<Latest> m_latest;
+    ssize_t m_cols, m_rows, m_planes;
+    ssize_t m_i, m_j, m_p;
+    // The strip in use, with its rows and pixels cached for operator*().
+    mutable boost::shared_ptr<Strip const> m_strip;
+    mutable ssize_t m_begin_row, m_end_row, m_pstride;
+    mutable PixelT const* m_data;
+
+    void use( boost::shared_ptr<Strip const> const& strip ) const {
+      m_strip     = strip;
+      m_begin_row = strip->begin_row;
+      m_end_row   = strip->end_row;
+      m_pstride   = strip->buf.cols() * strip->buf.rows();
+      m_data      = strip->buf.data();
+    }
+
+    pixel_type load() const {
+      if( m_i < 0 || m_j < 0 || m_p < 0 || m_i >= m_cols || m_j >= m_rows || m_p >= m_planes )
+        return (*m_view)( int32(m_i), int32(m_j), int32(m_p) );
+      boost::shared_ptr<Strip const> latest;
+      {
+        Mutex::Lock lock( m_latest->mutex );
+        latest = m_latest->strip;
+      }
+      if( latest && m_j >= latest->begin_row && m_j < latest->end_row ) {
+        use( latest );
+      }
+      else {
+        const ssize_t count = std::max( ssize_t(1), std::min( m_rows, strip_pixels / std::max( ssize_t(1), m_cols ) ) );
+        boost::shared_ptr<Strip> strip( new Strip() );
+        strip->begin_row = m_j - m_j % count;
+        strip->end_row   = std::min( m_rows, strip->begin_row + count );
+        BBox2i bbox( 0, int32(strip->begin_row), int32(m_cols), int32(strip->end_row - strip->begin_row) );
+        strip->buf.set_size( bbox.width(), bbox.height(), int32(m_planes) );
+        m_view->rasterize( strip->buf, bbox );
+        use( strip );
+        Mutex::Lock lock( m_latest->mutex );
+        m_latest->strip = m_strip;
+      }
+      return **this;
+    }
+
+  public:
+    explicit ImageViewRefBlockAccessor( boost::shared_ptr<ImageViewRefBase<PixelT> const> const& view )
+      : m_view( view ), m_latest( new Latest() ),
+        m_cols( view->cols() ), m_rows( view->rows() ), m_planes( view->planes() ),
+        m_i( 0 ), m_j( 0 ), m_p( 0 ), m_begin_row( 0 ), m_end_row( 0 ), m_pstride( 0 ), m_data( 0 ) {}
+
+    inline ImageViewRefBlockAccessor& next_col  () { ++m_i; return *this; }
+    inline ImageViewRefBlockAccessor& prev_col  () { --m_i; return *this; }
+    inline ImageViewRefBlockAccessor& next_row  () { ++m_j; return *this; }
+    inline ImageViewRefBlockAccessor& prev_row  () { --m_j; return *this; }
+    inline ImageViewRefBlockAccessor& next_plane() { ++m_p; return *this; }
+    inline ImageViewRefBlockAccessor& prev_plane() { --m_p; return *this; }
+    inline ImageViewRefBlockAccessor& advance( offset_type di, offset_type dj, ssize_t dp=0 ) {
+      m_i += di; m_j += dj; m_p += dp; return *this;
+    }
+
+    inline result_type operator*() const {
+      if( m_j >= m_begin_row && m_j < m_end_row && size_t(m_i) < size_t(m_cols) && size_t(m_p) < size_t(m_planes) )
+        return m_data[ m_p*m_pstride + (m_j - m_begin_row)*m_cols + m_i ];
+      return load();
+    }
+  };
+
+
+  /// \cond INTERNAL
 
   // ImageViewRef class implementation
   template <class ViewT>
@@ -162,6 +268,10 @@ namespace vw {
     virtual pixel_type     operator()( double i, double j, int32 p ) const { return m_view(i,j,p); }
 
     virtual bool sparse_check( BBox2i const& bbox ) const { return vw::sparse_check( m_view, bbox ); }
+    virtual void footprint( BBox2i const& bbox, Footprint& footprint ) const {
+      SourceFootprint<ViewT> source( m_view );
+      source( bbox, footprint );
+    }
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const { m_view.rasterize( dest, bbox ); }
 
     ViewT const& child() const { return m_view; }
@@ -229,8 +339,17 @@ namespace vw {
 
     inline pixel_accessor origin() const { return m_view->origin(); }
 
+    /// Returns an accessor which rasterizes the view a strip of rows at
+    /// a time.  Each one allocates its own strips, so only use it for a
+    /// row-major walk over much of the view; origin() is the one for
+    /// scattered or per-sample access.
+    inline ImageViewRefBlockAccessor<PixelT> strip_origin() const { return ImageViewRefBlockAccessor<PixelT>( m_view ); }
+
     inline bool sparse_check( BBox2i const& bbox ) const { return m_view->sparse_check(bbox); }
 
+    /// Adds the source regions of the wrapped view under the bbox.
+    inline void footprint( BBox2i const& bbox, Footprint& footprint ) const { m_view->footprint( bbox, footprint ); }
+
     /// \cond INTERNAL
     typedef CropView<ImageView<PixelT> > prerasterize_type;
 
@@ -240,7 +359,7 @@ namespace vw {
       if( image_ptr ) return CropView<ImageView<PixelT> >( image_ptr->child(), 0, 0, cols(), rows() );
       // Otherwise, we must rasterize ourselves....
       ImageView<PixelT> buf( bbox.width(), bbox.height(), planes() );
-      m_view->rasterize( buf, bbox );
+      rasterize( buf, bbox );
       return CropView<ImageView<PixelT> >( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
     }
 
@@ -251,15 +370,70 @@ namespace vw {
     // A special performance-enhancing overload for rasterizing directly into
     // an ImageView with the proper pixel type.  This cannot be templatized
     // or otherwise generalized because it calls m_view's virtual rasterize method.
+    // Large requests are split into strips of whole rows so that the
+    // buffers of the views nested inside m_view stay in cache.
     inline void rasterize( ImageView<PixelT> const& dest, BBox2i const& bbox ) const {
-      m_view->rasterize( dest, bbox );
+      const int32 strip_pixels = ImageViewRefBlockAccessor<PixelT>::strip_pixels;
+      if( bbox.width() * bbox.height() <= 2 * strip_pixels ||
+          dynamic_cast<ImageViewRefImpl<ImageView<PixelT> >*>( m_view.get() ) )
+        return m_view->rasterize( dest, bbox );
+      const int32 count = std::max( 1, strip_pixels / bbox.width() );
+      ImageView<PixelT> strip;
+      for( int32 y=0; y<bbox.height(); y+=count ) {
+        BBox2i strip_bbox( bbox.min().x(), bbox.min().y()+y, bbox.width(), std::min( count, bbox.height()-y ) );
+        strip.set_size( strip_bbox.width(), strip_bbox.height(), planes() );
+        m_view->rasterize( strip, strip_bbox );
+        vw::rasterize( strip, crop( dest, 0, y, strip_bbox.width(), strip_bbox.height() ),
+                       BBox2i( 0, 0, strip_bbox.width(), strip_bbox.height() ) );
+      }
     }
     /// \endcond
   };
 
+  /// \cond INTERNAL
+  namespace detail {
+    template <class PixelT, class FuncT>
+    void for_each_strip_pixel( ImageViewRef<PixelT> const& view, FuncT& func, ProgressCallback const& progress ) {
+      typedef ImageViewRefBlockAccessor<PixelT> pixel_accessor;
+      pixel_accessor plane_acc = view.strip_origin();
+      for( int32 plane = view.planes(); plane; --plane ) {
+        pixel_accessor row_acc = plane_acc;
+        for( int32 row = 0; row<view.rows(); ++row ) {
+          progress.report_fractional_progress(row,view.rows());
+          pixel_accessor col_acc = row_acc;
+          for( int32 col = view.cols(); col; --col ) {
+            func( *col_acc );
+            col_acc.next_col();
+          }
+          row_acc.next_row();
+        }
+        plane_acc.next_plane();
+      }
+      progress.report_finished();
+    }
+  }
+  /// \endcond
+
+  /// Applies a functor to each pixel of an ImageViewRef, in the same
+  /// order as the generic for_each_pixel(), but through strip_origin()
+  /// so that the view is rasterized a strip at a time.
+  template <class PixelT, class FuncT>
+  void for_each_pixel( ImageViewBase<ImageViewRef<PixelT> > const& view, FuncT& func,
+                       ProgressCallback const& progress = ProgressCallback::dummy_instance() ) {
+    detail::for_each_strip_pixel<PixelT,FuncT>( view.impl(), func, progress );
+  }
+  /// Const functor overload
+  template <class PixelT, class FuncT>
+  void for_each_pixel( ImageViewBase<ImageViewRef<PixelT> > const& view, FuncT const& func,
+                       ProgressCallback const& progress = ProgressCallback::dummy_instance() ) {
+    detail::for_each_strip_pixel<PixelT,FuncT const>( view.impl(), func, progress );
+  }
+
+  /// Holds its own reference, so that a check kept by a
+  /// QuadTreeGenerator does not outlive the view it was made from.
   template <class PixelT>
   class SparseImageCheck<ImageViewRef<PixelT> > {
-    ImageViewRef<PixelT> const& image;
+    ImageViewRef<PixelT> image;
   public:
     SparseImageCheck(ImageViewRef<PixelT> const& image) : image(image) {}
     bool operator() (BBox2i const& bbox) {
@@ -267,6 +441,16 @@ namespace vw {
     }
   };
 
+  template <class PixelT>
+  class SourceFootprint<ImageViewRef<PixelT> > {
+    ImageViewRef<PixelT> const& m_view;
+  public:
+    SourceFootprint(ImageViewRef<PixelT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      m_view.footprint( bbox, footprint );
+    }
+  };
+
 
 } // namespace vw
 
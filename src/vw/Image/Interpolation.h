@@ -33,9 +33,14 @@
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/SparseImageCheck.h>
+#include <vw/Image/Footprint.h>
+
+#include <algorithm>
 
 #include <boost/mpl/if.hpp>
+#include <boost/utility/enable_if.hpp>
 #include <boost/type_traits/remove_reference.hpp>
+#include <boost/type_traits/is_arithmetic.hpp>
 
 namespace vw {
 
@@ -225,6 +230,172 @@ namespace vw {
   };
 
 
+  /// \cond INTERNAL
+  namespace detail {
+
+    // The batched kernels below work through their points in chunks
+    // of this size, so that their scratch arrays stay on the stack.
+    static const int32 interpolation_chunk_size = 64;
+
+    // Generic batch: one scalar interpolation per point.
+    template <class InterpFuncT, class ViewT, class PixelT>
+    inline void interpolate_points( InterpFuncT const& func, ViewT const& view,
+                                    double const* i, double const* j, int32 n, int32 p, PixelT* out ) {
+      for( int32 k=0; k<n; ++k )
+        out[k] = func( view, i[k], j[k], p );
+    }
+
+    // Where the batched kernels read their pixels from: a view of
+    // in-memory data, or an edge extension of one.  Points whose
+    // neighborhood leaves the child go through the scalar
+    // interpolator instead.
+    template <class ViewT>
+    struct InterpolationSource {
+      typedef IsRowEvaluable<ViewT> is_evaluable;
+      typedef ViewT child_type;
+      static ViewT const& child( ViewT const& view ) { return view; }
+      static int32 x_offset( ViewT const& /*view*/ ) { return 0; }
+      static int32 y_offset( ViewT const& /*view*/ ) { return 0; }
+    };
+
+    template <class ChildT, class EdgeT>
+    struct InterpolationSource<EdgeExtensionView<ChildT,EdgeT> > {
+      typedef IsRowEvaluable<ChildT> is_evaluable;
+      typedef ChildT child_type;
+      static ChildT const& child( EdgeExtensionView<ChildT,EdgeT> const& view ) { return view.child(); }
+      static int32 x_offset( EdgeExtensionView<ChildT,EdgeT> const& view ) { return view.x_offset(); }
+      static int32 y_offset( EdgeExtensionView<ChildT,EdgeT> const& view ) { return view.y_offset(); }
+    };
+
+    // Bicubic interpolation of a chunk of compound pixels.  Each
+    // neighborhood is read straight from the child.
+    template <class ViewT, class PixelT>
+    void bicubic_chunk( BicubicInterpolationImpl<ViewT,PixelT> const& func, ViewT const& view,
+                        double const* i, double const* j, int32 n, int32 p, PixelT* out, false_type ) {
+      typedef typename CompoundChannelType<PixelT>::type channel_type;
+      typedef typename CompoundChannelCast<PixelT,double>::type result_type;
+      typedef InterpolationSource<ViewT> source;
+      typedef typename source::child_type ChildT;
+      ChildT const& child = source::child( view );
+      const int32 max_x = child.cols() - 3, max_y = child.rows() - 3;
+      for( int32 k=0; k<n; ++k ) {
+        const double fi = math::impl::_floor(i[k]), fj = math::impl::_floor(j[k]);
+        const int32 x = int32(fi) + source::x_offset( view ), y = int32(fj) + source::y_offset( view );
+        if( x < 1 || y < 1 || x > max_x || y > max_y ) {
+          out[k] = func( view, i[k], j[k], p );
+          continue;
+        }
+        if( fi == i[k] && fj == j[k] ) {
+          out[k] = channel_cast_round_and_clamp_if_int<channel_type>( *child.origin().advance( x, y, p ) );
+          continue;
+        }
+        const double normx = i[k]-fi, normy = j[k]-fj;
+        const double s0 = ((2-normx)*normx-1)*normx,    t0 = ((2-normy)*normy-1)*normy;
+        const double s1 = (3*normx-5)*normx*normx+2,    t1 = (3*normy-5)*normy*normy+2;
+        const double s2 = ((4-3*normx)*normx+1)*normx,  t2 = ((4-3*normy)*normy+1)*normy;
+        const double s3 = (normx-1)*normx*normx,        t3 = (normy-1)*normy*normy;
+        typename ChildT::pixel_accessor acc = child.origin().advance( x-1, y-1, p );
+        result_type row =         s0*(*acc);
+        acc.next_col();    row += s1*(*acc);
+        acc.next_col();    row += s2*(*acc);
+        acc.next_col();    row += s3*(*acc);
+        result_type result =      t0*row;
+        acc.advance(-3,1); row =  s0*(*acc);
+        acc.next_col();    row += s1*(*acc);
+        acc.next_col();    row += s2*(*acc);
+        acc.next_col();    row += s3*(*acc);
+        result +=                 t1*row;
+        acc.advance(-3,1); row =  s0*(*acc);
+        acc.next_col();    row += s1*(*acc);
+        acc.next_col();    row += s2*(*acc);
+        acc.next_col();    row += s3*(*acc);
+        result +=                 t2*row;
+        acc.advance(-3,1); row =  s0*(*acc);
+        acc.next_col();    row += s1*(*acc);
+        acc.next_col();    row += s2*(*acc);
+        acc.next_col();    row += s3*(*acc);
+        result +=                 t3*row;
+        result *= 0.25;
+        out[k] = channel_cast_round_and_clamp_if_int<channel_type>( result );
+      }
+    }
+
+    // Bicubic interpolation of a chunk of scalar pixels.  The
+    // neighborhoods are gathered into arrays first, so that the blend
+    // is a plain loop over arrays that the compiler vectorizes.
+    // Points on whole pixels gather only their own value, which the
+    // blend then reproduces exactly.  Points whose neighborhood
+    // crosses the edge of the child are patched up afterwards through
+    // the scalar path.
+    template <class ViewT, class PixelT>
+    void bicubic_chunk( BicubicInterpolationImpl<ViewT,PixelT> const& func, ViewT const& view,
+                        double const* i, double const* j, int32 n, int32 p, PixelT* out, true_type ) {
+      typedef typename FloatType<PixelT>::type real_type;
+      static const int32 N = interpolation_chunk_size;
+      real_type v[4][4][N];
+      double fx[N], fy[N];
+      int32 edge[N], num_edge = 0;
+
+      typedef InterpolationSource<ViewT> source;
+      typedef typename source::child_type ChildT;
+      ChildT const& child = source::child( view );
+      const int32 max_x = child.cols() - 3, max_y = child.rows() - 3;
+      for( int32 k=0; k<n; ++k ) {
+        const double fi = math::impl::_floor(i[k]), fj = math::impl::_floor(j[k]);
+        const int32 x = int32(fi) + source::x_offset( view ), y = int32(fj) + source::y_offset( view );
+        fx[k] = i[k] - fi;
+        fy[k] = j[k] - fj;
+        const bool inside = !( x < 1 || y < 1 || x > max_x || y > max_y );
+        if( !inside || ( fi == i[k] && fj == j[k] ) ) {
+          for( int32 r=0; r<4; ++r )
+            v[r][0][k] = v[r][1][k] = v[r][2][k] = v[r][3][k] = 0;
+          if( inside ) v[1][1][k] = *child.origin().advance( x, y, p );
+          else         edge[num_edge++] = k;
+          continue;
+        }
+        typename ChildT::pixel_accessor acc = child.origin().advance( x-1, y-1, p );
+        for( int32 r=0; r<4; ++r ) {
+          v[r][0][k] = *acc;  acc.next_col();
+          v[r][1][k] = *acc;  acc.next_col();
+          v[r][2][k] = *acc;  acc.next_col();
+          v[r][3][k] = *acc;  acc.advance( -3, 1 );
+        }
+      }
+      for( int32 k=0; k<n; ++k ) {
+        const double normx = fx[k], normy = fy[k];
+        const double s0 = ((2-normx)*normx-1)*normx,    t0 = ((2-normy)*normy-1)*normy;
+        const double s1 = (3*normx-5)*normx*normx+2,    t1 = (3*normy-5)*normy*normy+2;
+        const double s2 = ((4-3*normx)*normx+1)*normx,  t2 = ((4-3*normy)*normy+1)*normy;
+        const double s3 = (normx-1)*normx*normx,        t3 = (normy-1)*normy*normy;
+        double row0 = s0*v[0][0][k]; row0 += s1*v[0][1][k]; row0 += s2*v[0][2][k]; row0 += s3*v[0][3][k];
+        double row1 = s0*v[1][0][k]; row1 += s1*v[1][1][k]; row1 += s2*v[1][2][k]; row1 += s3*v[1][3][k];
+        double row2 = s0*v[2][0][k]; row2 += s1*v[2][1][k]; row2 += s2*v[2][2][k]; row2 += s3*v[2][3][k];
+        double row3 = s0*v[3][0][k]; row3 += s1*v[3][1][k]; row3 += s2*v[3][2][k]; row3 += s3*v[3][3][k];
+        double result = t0*row0;
+        result += t1*row1;
+        result += t2*row2;
+        result += t3*row3;
+        result *= 0.25;
+        out[k] = channel_cast_round_and_clamp_if_int<PixelT>( result );
+      }
+      for( int32 e=0; e<num_edge; ++e )
+        out[edge[e]] = func( view, i[edge[e]], j[edge[e]], p );
+    }
+
+    // Bicubic batch over in-memory data.  The results are the same
+    // as BicubicInterpolationImpl's.
+    template <class ViewT, class PixelT>
+    typename boost::enable_if<typename InterpolationSource<ViewT>::is_evaluable>::type
+    interpolate_points( BicubicInterpolationImpl<ViewT,PixelT> const& func, ViewT const& view,
+                        double const* i, double const* j, int32 n, int32 p, PixelT* out ) {
+      typedef typename boost::mpl::if_<boost::is_arithmetic<PixelT>,true_type,false_type>::type is_scalar;
+      for( int32 base=0; base<n; base+=interpolation_chunk_size )
+        bicubic_chunk( func, view, i+base, j+base, std::min( interpolation_chunk_size, n-base ), p, out+base, is_scalar() );
+    }
+
+  } // namespace detail
+  /// \endcond
+
   /// Interpolation View Class
   ///
   /// An image view that excepts real numbers as pixel coordinates and
@@ -260,6 +431,13 @@ namespace vw {
     ImageT  const& child() const { return m_image;       }
     InterpT const& func () const { return m_interp_func; }
 
+    /// Interpolates plane p at the n points (i[k],j[k]) into
+    /// out[0..n).  Bicubic interpolation of in-memory data computes
+    /// the points in vectorizable batches.
+    inline void sample( double const* i, double const* j, int32 n, int32 p, pixel_type* out ) const {
+      detail::interpolate_points( m_interp_func, m_image, i, j, n, p, out );
+    }
+
     /// \cond INTERNAL
     // We can make an optimization here.  If the pixels in the child
     // view cannot be repeatedly accessed without incurring any
@@ -317,6 +495,46 @@ namespace vw {
     }
   };
 
+  /// The interpolation reads the child within pixel_buffer of the bbox.
+  template <class ImageT, class InterpT>
+  class SourceFootprint<InterpolationView<ImageT, InterpT> > {
+    InterpolationView<ImageT, InterpT> const& m_view;
+  public:
+    SourceFootprint(InterpolationView<ImageT, InterpT> const& view)
+      : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      BBox2i src_bbox = bbox;
+      src_bbox.expand( InterpT::pixel_buffer );
+      SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+    }
+  };
+
+  /// Evaluates plane p of a floating-point indexable view at the n
+  /// points (i[k],j[k]), writing the results to out[0..n).
+  template <class ViewT>
+  inline void sample_points( ImageViewBase<ViewT> const& view, double const* i, double const* j,
+                             int32 n, int32 p, typename ViewT::pixel_type* out ) {
+    for( int32 k=0; k<n; ++k )
+      out[k] = view.impl()( i[k], j[k], p );
+  }
+
+  /// A specialization that uses the batched interpolation kernels.
+  template <class ImageT, class InterpT>
+  inline void sample_points( InterpolationView<ImageT,InterpT> const& view, double const* i, double const* j,
+                             int32 n, int32 p, typename ImageT::pixel_type* out ) {
+    view.sample( i, j, n, p, out );
+  }
+
+  /// Indicates whether sample_points() is faster for a view than
+  /// evaluating it one point at a time.  At the moment this is the
+  /// case for bicubic interpolation of in-memory data.
+  template <class ViewT>
+  struct HasBatchSampling : public false_type {};
+
+  template <class ImageT>
+  struct HasBatchSampling<InterpolationView<ImageT,BicubicInterpolation> >
+    : public boost::mpl::if_<typename detail::InterpolationSource<ImageT>::is_evaluable,true_type,false_type>::type {};
+
   // -------------------------------------------------------------------------------
   // Functional API
   // -------------------------------------------------------------------------------
@@ -54,6 +54,29 @@ public:
 // Transpose
 // *******************************************************************
 
+/// \cond INTERNAL
+namespace detail {
+  /// Rasterizes in square tiles.  Views which read their child down
+  /// the columns of the destination, such as transposes and rotations
+  /// by 90 degrees, then walk a tile's worth of source rows that stays
+  /// in the L1 cache instead of a whole column of the source.
+  template <class SrcT, class DestT>
+  inline void rasterize_tiled( SrcT const& src, DestT const& dest, BBox2i const& bbox ) {
+    const int32 pixel_size = int32( sizeof(typename SrcT::pixel_type) );
+    const int32 tile = pixel_size <= 4 ? 64 : pixel_size <= 16 ? 32 : 16;
+    if( bbox.width() <= tile && bbox.height() <= tile ) {
+      vw::rasterize( src, dest, bbox );
+      return;
+    }
+    for( int32 y=bbox.min().y(); y<bbox.max().y(); y+=tile )
+      for( int32 x=bbox.min().x(); x<bbox.max().x(); x+=tile ) {
+        BBox2i tile_bbox( x, y, std::min( tile, bbox.max().x()-x ), std::min( tile, bbox.max().y()-y ) );
+        vw::rasterize( src, crop( dest, tile_bbox - bbox.min() ), tile_bbox );
+      }
+  }
+} // namespace detail
+/// \endcond
+
 // Specialized pixel accessor
 template <class ChildT>
 class TransposePixelAccessor
@@ -121,7 +144,7 @@ public:
     BBox2i child_bbox( bbox.min().y(), bbox.min().x(), bbox.height(), bbox.width() );
     return prerasterize_type( m_child.prerasterize(child_bbox) );
   }
-  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { detail::rasterize_tiled( prerasterize(bbox), dest, bbox ); }
   /// \endcond
 };
 
@@ -275,7 +298,7 @@ public:
     BBox2i child_bbox( bbox.min().y(), cols()-bbox.max().x(), bbox.height(), bbox.width() );
     return prerasterize_type( m_child.prerasterize(child_bbox) );
   }
-  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { detail::rasterize_tiled( prerasterize(bbox), dest, bbox ); }
   /// \endcond
 };
 
@@ -351,7 +374,7 @@ public:
     BBox2i child_bbox( rows()-bbox.max().y(), bbox.min().x(), bbox.height(), bbox.width() );
     return prerasterize_type( m_child.prerasterize(child_bbox) );
   }
-  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { detail::rasterize_tiled( prerasterize(bbox), dest, bbox ); }
   /// \endcond
 };
 
@@ -560,6 +583,10 @@ public:
     return m_child;
   }
 
+  /// The position of the crop's upper-left corner in the child.
+  offset_type col_offset() const { return m_ci; }
+  offset_type row_offset() const { return m_cj; }
+
   /// \cond INTERNAL
   typedef CropView<typename ImageT::prerasterize_type> prerasterize_type;
   inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
@@ -567,11 +594,62 @@ public:
   }
   template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
     // FIXME Warning: This does not respect floating-point offsets!
-    vw::rasterize( prerasterize(bbox), dest, bbox );
+    vw::rasterize_rows( prerasterize(bbox), dest, bbox );
   }
   /// \endcond
 };
 
+/// \cond INTERNAL
+// A crop of a row-evaluable view is evaluated by its child at the
+// shifted position.  Crops of floating-point-indexable views are not,
+// since their offsets may be fractional.
+template <class ImageT>
+struct IsRowEvaluable<CropView<ImageT> >
+  : public boost::mpl::and_<IsRowEvaluable<ImageT>, boost::mpl::not_<IsFloatingPointIndexable<ImageT> > >::type {};
+
+template <class ImageT>
+class RowEvaluator<CropView<ImageT> > : public RowEvaluator<ImageT> {
+public:
+  RowEvaluator( CropView<ImageT> const& view, int32 i, int32 j, int32 p )
+    : RowEvaluator<ImageT>( view.child(), view.col_offset()+i, view.row_offset()+j, p ) {}
+};
+/// \endcond
+
+/// Checks the part of the child under the crop.  A fractional offset
+/// touches one more pixel of the child on each axis.
+template <class ImageT>
+class SparseImageCheck<CropView<ImageT> > {
+  CropView<ImageT> const& m_view;
+public:
+  SparseImageCheck(CropView<ImageT> const& view) : m_view(view) {}
+  bool operator()( BBox2i const& bbox ) const {
+    BBox2i crop_bbox = bbox;
+    crop_bbox.crop( BBox2i( 0, 0, m_view.cols(), m_view.rows() ) );
+    if( crop_bbox.empty() ) return false;
+    const double ci = double( m_view.col_offset() ), cj = double( m_view.row_offset() );
+    Vector2i offset( int32( std::floor( ci ) ), int32( std::floor( cj ) ) );
+    BBox2i src_bbox = crop_bbox + offset;
+    src_bbox.max() += Vector2i( ci != offset.x(), cj != offset.y() );
+    return SparseImageCheck<ImageT>(m_view.child())( src_bbox );
+  }
+};
+
+/// Reads the child under the bbox, one more pixel on each axis with a
+/// fractional offset.
+template <class ImageT>
+class SourceFootprint<CropView<ImageT> > {
+  CropView<ImageT> const& m_view;
+public:
+  SourceFootprint(CropView<ImageT> const& view) : m_view(view) {}
+  void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+    const double ci = double( m_view.col_offset() ), cj = double( m_view.row_offset() );
+    Vector2i offset( int32( std::floor( ci ) ), int32( std::floor( cj ) ) );
+    BBox2i src_bbox = bbox + offset;
+    src_bbox.max() += Vector2i( ci != offset.x(), cj != offset.y() );
+    SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+  }
+};
+
 // *******************************************************************
 // subsample()
 // *******************************************************************
@@ -630,6 +708,8 @@ public:
   inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_child(m_xdelta*i,m_ydelta*j,p); }
 
   ImageT const& child() const { return m_child; }
+  int32 x_factor() const { return m_xdelta; }
+  int32 y_factor() const { return m_ydelta; }
 
   /// \cond INTERNAL
   // This complicated prerasterize call is to reduce the overall
@@ -663,7 +743,7 @@ public:
           m_child.prerasterize( BBox2i(m_xdelta*(*b).min().x(),
                                        m_ydelta*(*b).min().y(),
                                        m_xdelta*((*b).width () - 1) + 1,
-                                       m_xdelta*((*b).height() - 1) + 1 ) ),
+                                       m_ydelta*((*b).height() - 1) + 1 ) ),
           m_xdelta, m_ydelta ),
         crop(buffer, *b - bbox.min()), *b );
     }
@@ -677,6 +757,20 @@ public:
   /// \endcond
 };
 
+/// Reads every xfactor'th column and yfactor'th row of the child.
+template <class ImageT>
+class SourceFootprint<SubsampleView<ImageT> > {
+  SubsampleView<ImageT> const& m_view;
+public:
+  SourceFootprint(SubsampleView<ImageT> const& view) : m_view(view) {}
+  void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+    const int32 dx = m_view.x_factor(), dy = m_view.y_factor();
+    SourceFootprint<ImageT>(m_view.child())( BBox2i( dx*bbox.min().x(), dy*bbox.min().y(),
+                                                     dx*(bbox.width()-1)+1, dy*(bbox.height()-1)+1 ),
+                                             footprint );
+  }
+};
+
 
 // *******************************************************************
 // select_col()
@@ -84,6 +84,8 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(*this); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image.origin().advance(i,j,p)); }
 
+    ImageT const& child() const { return m_image; }
+
     /// \cond INTERNAL
     // We can make an optimization here.  If the pixels in the child
     // view cannot be repeatedly accessed without incurring any
@@ -123,6 +125,28 @@ namespace vw {
     /// \endcond
   };
 
+  /// The functor reads the child over its work area around each pixel.
+  template <class ImageT, class FuncT>
+  class SparseImageCheck<UnaryPerPixelAccessorView<ImageT,FuncT> > {
+    UnaryPerPixelAccessorView<ImageT,FuncT> const& m_view;
+  public:
+    SparseImageCheck(UnaryPerPixelAccessorView<ImageT,FuncT> const& view) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      if( bbox.empty() ) return false;
+      return SparseImageCheck<ImageT>(m_view.child())( m_view.pad_bbox( bbox ) );
+    }
+  };
+
+  template <class ImageT, class FuncT>
+  class SourceFootprint<UnaryPerPixelAccessorView<ImageT,FuncT> > {
+    UnaryPerPixelAccessorView<ImageT,FuncT> const& m_view;
+  public:
+    SourceFootprint(UnaryPerPixelAccessorView<ImageT,FuncT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      SourceFootprint<ImageT>(m_view.child())( m_view.pad_bbox( bbox ), footprint );
+    }
+  };
+
   template <class ViewT, class FuncT, class EdgeT>
   UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,EdgeT>, FuncT>
   per_pixel_accessor_filter(ImageViewBase<ViewT> const& image, FuncT const& func, EdgeT edge) {
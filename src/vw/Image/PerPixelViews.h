@@ -30,6 +30,8 @@
 
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/PixelAccessors.h>
+#include <vw/Image/SparseImageCheck.h>
+#include <vw/Image/Footprint.h>
 
 namespace vw {
 
@@ -124,13 +126,56 @@ namespace vw {
       return *this;
     }
 
+    ImageT const& child() const { return m_image; }
+    FuncT  const& func () const { return m_func;  }
+
     /// \cond INTERNAL
     typedef UnaryPerPixelView<typename ImageT::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_image.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize_rows( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
 
+  /// A per-pixel view has data wherever its child does.
+  template <class ImageT, class FuncT>
+  class SparseImageCheck<UnaryPerPixelView<ImageT,FuncT> > {
+    UnaryPerPixelView<ImageT,FuncT> const& m_view;
+  public:
+    SparseImageCheck(UnaryPerPixelView<ImageT,FuncT> const& view) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<ImageT>(m_view.child())( bbox );
+    }
+  };
+
+  /// A per-pixel view reads its child under the bbox.
+  template <class ImageT, class FuncT>
+  class SourceFootprint<UnaryPerPixelView<ImageT,FuncT> > {
+    UnaryPerPixelView<ImageT,FuncT> const& m_view;
+  public:
+    SourceFootprint(UnaryPerPixelView<ImageT,FuncT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      SourceFootprint<ImageT>(m_view.child())( bbox, footprint );
+    }
+  };
+
+  /// \cond INTERNAL
+  // A per-pixel view can be evaluated a row at a time whenever its
+  // child can: the functor is simply applied to each child result.
+  template <class ImageT, class FuncT>
+  struct IsRowEvaluable<UnaryPerPixelView<ImageT,FuncT> > : public IsRowEvaluable<ImageT> {};
+
+  template <class ImageT, class FuncT>
+  class RowEvaluator<UnaryPerPixelView<ImageT,FuncT> > {
+    RowEvaluator<ImageT> m_child;
+    FuncT const& m_func;
+  public:
+    typedef typename UnaryPerPixelView<ImageT,FuncT>::result_type result_type;
+    RowEvaluator( UnaryPerPixelView<ImageT,FuncT> const& view, int32 i, int32 j, int32 p )
+      : m_child( view.child(), i, j, p ), m_func( view.func() ) {}
+    inline result_type operator[]( int32 n ) const { return m_func( m_child[n] ); }
+  };
+  /// \endcond
+
   /// \cond INTERNAL
   // View type Traits.  This exists mainly for select_channel(), and may not
   // be correct in all cases.  Perhaps it should be specialized there instead?
@@ -88,13 +88,58 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image1.origin(),m_image2.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image1(i,j,p),m_image2(i,j,p)); }
 
+    Image1T const& child1() const { return m_image1; }
+    Image2T const& child2() const { return m_image2; }
+    FuncT   const& func  () const { return m_func;   }
+
     /// \cond INTERNAL
     typedef BinaryPerPixelView<typename Image1T::prerasterize_type, typename Image2T::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_image1.prerasterize(bbox), m_image2.prerasterize(bbox), m_func ); }
-    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize( prerasterize(bbox), dest, bbox ); }
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const { vw::rasterize_rows( prerasterize(bbox), dest, bbox ); }
     /// \endcond
   };
 
+  /// \cond INTERNAL
+  template <class Image1T, class Image2T, class FuncT>
+  struct IsRowEvaluable<BinaryPerPixelView<Image1T,Image2T,FuncT> >
+    : public boost::mpl::and_<IsRowEvaluable<Image1T>,IsRowEvaluable<Image2T> >::type {};
+
+  template <class Image1T, class Image2T, class FuncT>
+  class RowEvaluator<BinaryPerPixelView<Image1T,Image2T,FuncT> > {
+    RowEvaluator<Image1T> m_child1;
+    RowEvaluator<Image2T> m_child2;
+    FuncT const& m_func;
+  public:
+    typedef typename BinaryPerPixelView<Image1T,Image2T,FuncT>::result_type result_type;
+    RowEvaluator( BinaryPerPixelView<Image1T,Image2T,FuncT> const& view, int32 i, int32 j, int32 p )
+      : m_child1( view.child1(), i, j, p ), m_child2( view.child2(), i, j, p ), m_func( view.func() ) {}
+    inline result_type operator[]( int32 n ) const { return m_func( m_child1[n], m_child2[n] ); }
+  };
+
+  /// A binary per-pixel view may have data wherever either child does.
+  template <class Image1T, class Image2T, class FuncT>
+  class SparseImageCheck<BinaryPerPixelView<Image1T,Image2T,FuncT> > {
+    BinaryPerPixelView<Image1T,Image2T,FuncT> const& m_view;
+  public:
+    SparseImageCheck(BinaryPerPixelView<Image1T,Image2T,FuncT> const& view) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      return SparseImageCheck<Image1T>(m_view.child1())( bbox ) ||
+             SparseImageCheck<Image2T>(m_view.child2())( bbox );
+    }
+  };
+
+  template <class Image1T, class Image2T, class FuncT>
+  class SourceFootprint<BinaryPerPixelView<Image1T,Image2T,FuncT> > {
+    BinaryPerPixelView<Image1T,Image2T,FuncT> const& m_view;
+  public:
+    SourceFootprint(BinaryPerPixelView<Image1T,Image2T,FuncT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      SourceFootprint<Image1T>(m_view.child1())( bbox, footprint );
+      SourceFootprint<Image2T>(m_view.child2())( bbox, footprint );
+    }
+  };
+  /// \endcond
+
   // *******************************************************************
   // TrinaryPerPixelView
   // *******************************************************************
@@ -174,6 +219,10 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image1.origin(),m_image2.origin(),m_image3.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image1(i,j,p),m_image2(i,j,p),m_image3(i,j,p)); }
 
+    Image1T const& child1() const { return m_image1; }
+    Image2T const& child2() const { return m_image2; }
+    Image3T const& child3() const { return m_image3; }
+
     /// \cond INTERNAL
     typedef TrinaryPerPixelView<typename Image1T::prerasterize_type, typename Image2T::prerasterize_type, typename Image3T::prerasterize_type, FuncT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return prerasterize_type( m_image1.prerasterize(bbox), m_image2.prerasterize(bbox), m_image3.prerasterize(bbox), m_func ); }
@@ -181,6 +230,18 @@ namespace vw {
     /// \endcond
   };
 
+  template <class Image1T, class Image2T, class Image3T, class FuncT>
+  class SourceFootprint<TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> > {
+    TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> const& m_view;
+  public:
+    SourceFootprint(TrinaryPerPixelView<Image1T,Image2T,Image3T,FuncT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      SourceFootprint<Image1T>(m_view.child1())( bbox, footprint );
+      SourceFootprint<Image2T>(m_view.child2())( bbox, footprint );
+      SourceFootprint<Image3T>(m_view.child3())( bbox, footprint );
+    }
+  };
+
 
 // *******************************************************************
   // QuaternaryPerPixelView
@@ -275,6 +336,11 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image1.origin(),m_image2.origin(),m_image3.origin(),m_image4.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image1(i,j,p),m_image2(i,j,p),m_image3(i,j,p),m_image4(i,j,p)); }
 
+    Image1T const& child1() const { return m_image1; }
+    Image2T const& child2() const { return m_image2; }
+    Image3T const& child3() const { return m_image3; }
+    Image4T const& child4() const { return m_image4; }
+
     /// \cond INTERNAL
     typedef QuaternaryPerPixelView<typename Image1T::prerasterize_type, typename Image2T::prerasterize_type, 
                                    typename Image3T::prerasterize_type, typename Image4T::prerasterize_type, FuncT> prerasterize_type;
@@ -284,6 +350,19 @@ namespace vw {
     /// \endcond
   };
 
+  template <class Image1T, class Image2T, class Image3T, class Image4T, class FuncT>
+  class SourceFootprint<QuaternaryPerPixelView<Image1T,Image2T,Image3T,Image4T,FuncT> > {
+    QuaternaryPerPixelView<Image1T,Image2T,Image3T,Image4T,FuncT> const& m_view;
+  public:
+    SourceFootprint(QuaternaryPerPixelView<Image1T,Image2T,Image3T,Image4T,FuncT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      SourceFootprint<Image1T>(m_view.child1())( bbox, footprint );
+      SourceFootprint<Image2T>(m_view.child2())( bbox, footprint );
+      SourceFootprint<Image3T>(m_view.child3())( bbox, footprint );
+      SourceFootprint<Image4T>(m_view.child4())( bbox, footprint );
+    }
+  };
+
 
 
 
@@ -169,6 +169,10 @@ namespace vw {
     int col() const {return m_col;}
     int row() const {return m_row;}
 
+    /// The step taken along the line in each direction
+    int dcol() const {return m_dcol;}
+    int drow() const {return m_drow;}
+
     /// Advance to the next pixel along the line
     void operator++() {increment();}
 
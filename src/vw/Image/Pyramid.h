@@ -0,0 +1,311 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Pyramid.h
+///
+/// Reduces in-memory images by integer factors for building image
+/// pyramids: box averaging, smoothing and subsampling by two in one
+/// pass, and the majority vote used to reduce stereo masks.  Each
+/// computes only the pixels it keeps, without a full resolution
+/// intermediate image.
+///
+#ifndef __VW_IMAGE_PYRAMID_H__
+#define __VW_IMAGE_PYRAMID_H__
+
+#include <algorithm>
+#include <vector>
+
+#include <vw/Core/Exception.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelMath.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+namespace vw {
+
+  /// Averages each block of scale.x() by scale.y() pixels of the image
+  /// into one pixel of the result.  Pixels left over at the right and
+  /// bottom edges are dropped.
+  template <class PixelT>
+  ImageView<PixelT> box_subsample( ImageView<PixelT> const& image, Vector2i const& scale ) {
+    typedef typename ProductType<PixelT,double>::type sum_type;
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    VW_ASSERT( scale.x() > 0 && scale.y() > 0, ArgumentErr() << "box_subsample: The scale must be positive." );
+    const double weight = 1.0 / (scale.x()*scale.y());
+
+    ImageView<PixelT> result( image.cols()/scale.x(), image.rows()/scale.y(), image.planes() );
+    for( int32 p=0; p<result.planes(); ++p ) {
+      for( int32 y=0; y<result.rows(); ++y ) {
+        for( int32 x=0; x<result.cols(); ++x ) {
+          sum_type sum = sum_type();
+          validate(sum);
+          for( int32 j=0; j<scale.y(); ++j )
+            for( int32 i=0; i<scale.x(); ++i )
+              sum += weight * image( x*scale.x()+i, y*scale.y()+j, p );
+          result(x,y,p) = channel_cast_clamp_if_int<channel_type>( sum );
+        }
+      }
+    }
+    return result;
+  }
+
+  /// Averages the valid pixels of each block.  A block with no valid
+  /// pixels gives an invalid pixel.
+  template <class ChildT>
+  ImageView<PixelMask<ChildT> > box_subsample( ImageView<PixelMask<ChildT> > const& image, Vector2i const& scale ) {
+    typedef typename ProductType<ChildT,double>::type sum_type;
+    typedef typename CompoundChannelType<ChildT>::type channel_type;
+    VW_ASSERT( scale.x() > 0 && scale.y() > 0, ArgumentErr() << "box_subsample: The scale must be positive." );
+
+    ImageView<PixelMask<ChildT> > result( image.cols()/scale.x(), image.rows()/scale.y(), image.planes() );
+    for( int32 p=0; p<result.planes(); ++p ) {
+      for( int32 y=0; y<result.rows(); ++y ) {
+        for( int32 x=0; x<result.cols(); ++x ) {
+          sum_type sum = sum_type();
+          int32 count = 0;
+          for( int32 j=0; j<scale.y(); ++j )
+            for( int32 i=0; i<scale.x(); ++i ) {
+              PixelMask<ChildT> const& pix = image( x*scale.x()+i, y*scale.y()+j, p );
+              if ( is_valid(pix) ) {
+                sum += pix.child();
+                ++count;
+              }
+            }
+          if ( count > 0 )
+            result(x,y,p) = PixelMask<ChildT>( channel_cast_clamp_if_int<channel_type>( sum / double(count) ) );
+          else
+            result(x,y,p).invalidate();
+        }
+      }
+    }
+    return result;
+  }
+
+  /// Averages the pixels of each block which are not nodata, where a
+  /// nodata pixel has every channel equal to the nodata value.  A block
+  /// of only nodata pixels gives a nodata pixel.
+  template <class PixelT>
+  ImageView<PixelT> box_subsample( ImageView<PixelT> const& image, Vector2i const& scale, double nodata ) {
+    typedef typename ProductType<PixelT,double>::type sum_type;
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    VW_ASSERT( scale.x() > 0 && scale.y() > 0, ArgumentErr() << "box_subsample: The scale must be positive." );
+    PixelT nodata_pixel;
+    set_all( nodata_pixel, nodata );
+
+    ImageView<PixelT> result( image.cols()/scale.x(), image.rows()/scale.y(), image.planes() );
+    for( int32 p=0; p<result.planes(); ++p ) {
+      for( int32 y=0; y<result.rows(); ++y ) {
+        for( int32 x=0; x<result.cols(); ++x ) {
+          sum_type sum = sum_type();
+          int32 count = 0;
+          for( int32 j=0; j<scale.y(); ++j )
+            for( int32 i=0; i<scale.x(); ++i ) {
+              PixelT const& pix = image( x*scale.x()+i, y*scale.y()+j, p );
+              if ( !(pix == nodata_pixel) ) {
+                sum += pix;
+                ++count;
+              }
+            }
+          if ( count > 0 )
+            result(x,y,p) = channel_cast_clamp_if_int<channel_type>( sum / double(count) );
+          else
+            result(x,y,p) = nodata_pixel;
+        }
+      }
+    }
+    return result;
+  }
+
+  /// \cond INTERNAL
+  namespace detail {
+    /// The offset of the first tap of a centered kernel of size n
+    /// from the pixel it is centered on, as in SeparableConvolutionView.
+    inline int32 pyramid_kernel_offset( size_t n ) {
+      return int32(n) - 1 - (int32(n) - 1) / 2;
+    }
+
+    inline int32 pyramid_clamp( int32 i, int32 n ) {
+      return i < 0 ? 0 : i >= n ? n-1 : i;
+    }
+  } // namespace detail
+  /// \endcond
+
+  /// Smooths the image with a separable kernel, centered and applied
+  /// along both axes with constant edge extension, and keeps every
+  /// other pixel of every other row.  The result is the same as
+  ///   subsample( separable_convolution_filter( image, kernel, kernel ), 2 )
+  /// but only the pixels kept are computed.
+  template <class PixelT, class KernelT>
+  ImageView<PixelT> subsample_by_two( ImageView<PixelT> const& image, std::vector<KernelT> const& kernel ) {
+    typedef typename ProductType<PixelT,KernelT>::type sum_type;
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+    VW_ASSERT( !kernel.empty(), ArgumentErr() << "subsample_by_two: The kernel is empty." );
+    const int32 n      = int32( kernel.size() );
+    const int32 offset = detail::pyramid_kernel_offset( kernel.size() );
+    const int32 cols = image.cols(), rows = image.rows();
+    ImageView<PixelT> result( (cols+1)/2, (rows+1)/2, image.planes() );
+    if ( result.cols() == 0 || result.rows() == 0 )
+      return result;
+
+    // The row pass, at the kept columns of every row.  It is cast back
+    // to the pixel type between passes, as the convolution view does.
+    ImageView<PixelT> half( result.cols(), rows );
+    std::vector<sum_type> sums( result.cols() );
+    for( int32 p=0; p<image.planes(); ++p ) {
+      for( int32 y=0; y<rows; ++y ) {
+        PixelT const* src = &image(0,y,p);
+        PixelT*       dst = &half(0,y);
+        for( int32 x=0; x<result.cols(); ++x ) {
+          const int32 first = 2*x - offset;
+          sum_type sum = sum_type();
+          validate(sum);
+          if ( first >= 0 && first + n <= cols )
+            for( int32 t=0; t<n; ++t )
+              sum += kernel[n-1-t] * src[first+t];
+          else
+            for( int32 t=0; t<n; ++t )
+              sum += kernel[n-1-t] * src[detail::pyramid_clamp( first+t, cols )];
+          dst[x] = channel_cast_clamp_if_int<channel_type>( sum );
+        }
+      }
+
+      // The column pass, at the kept rows, a row at a time.
+      for( int32 y=0; y<result.rows(); ++y ) {
+        std::fill( sums.begin(), sums.end(), sum_type() );
+        for( size_t x=0; x<sums.size(); ++x )
+          validate( sums[x] );
+        for( int32 t=0; t<n; ++t ) {
+          PixelT const* src = &half( 0, detail::pyramid_clamp( 2*y - offset + t, rows ) );
+          KernelT const k = kernel[n-1-t];
+          for( int32 x=0; x<result.cols(); ++x )
+            sums[x] += k * src[x];
+        }
+        PixelT* dst = &result(0,y,p);
+        for( int32 x=0; x<result.cols(); ++x )
+          dst[x] = channel_cast_clamp_if_int<channel_type>( sums[x] );
+      }
+    }
+    return result;
+  }
+
+  /// Smooths and subsamples by two with only the valid pixels, weighting
+  /// them by the kernel and dividing by the total weight of the valid
+  /// pixels under it.  A pixel with no valid pixels under the kernel is
+  /// invalid.
+  template <class ChildT, class KernelT>
+  ImageView<PixelMask<ChildT> > subsample_by_two( ImageView<PixelMask<ChildT> > const& image,
+                                                  std::vector<KernelT> const& kernel ) {
+    typedef typename ProductType<ChildT,KernelT>::type sum_type;
+    typedef typename CompoundChannelType<ChildT>::type channel_type;
+    VW_ASSERT( !kernel.empty(), ArgumentErr() << "subsample_by_two: The kernel is empty." );
+    const int32 n      = int32( kernel.size() );
+    const int32 offset = detail::pyramid_kernel_offset( kernel.size() );
+    const int32 cols = image.cols(), rows = image.rows();
+    ImageView<PixelMask<ChildT> > result( (cols+1)/2, (rows+1)/2, image.planes() );
+    if ( result.cols() == 0 || result.rows() == 0 )
+      return result;
+
+    // Weighted sums and weights of the valid pixels, kept unrounded
+    // between passes so that the normalization is exact.
+    ImageView<sum_type> half_sum( result.cols(), rows );
+    ImageView<KernelT>  half_weight( result.cols(), rows );
+    for( int32 p=0; p<image.planes(); ++p ) {
+      for( int32 y=0; y<rows; ++y ) {
+        for( int32 x=0; x<result.cols(); ++x ) {
+          sum_type sum = sum_type();
+          KernelT  weight = KernelT();
+          for( int32 t=0; t<n; ++t ) {
+            PixelMask<ChildT> const& pix = image( detail::pyramid_clamp( 2*x - offset + t, cols ), y, p );
+            if ( is_valid(pix) ) {
+              sum    += kernel[n-1-t] * pix.child();
+              weight += kernel[n-1-t];
+            }
+          }
+          half_sum(x,y) = sum;
+          half_weight(x,y) = weight;
+        }
+      }
+
+      for( int32 y=0; y<result.rows(); ++y ) {
+        for( int32 x=0; x<result.cols(); ++x ) {
+          sum_type sum = sum_type();
+          KernelT  weight = KernelT();
+          for( int32 t=0; t<n; ++t ) {
+            const int32 row = detail::pyramid_clamp( 2*y - offset + t, rows );
+            sum    += kernel[n-1-t] * half_sum(x,row);
+            weight += kernel[n-1-t] * half_weight(x,row);
+          }
+          if ( weight > 0 )
+            result(x,y,p) = PixelMask<ChildT>( channel_cast_clamp_if_int<channel_type>( sum / weight ) );
+          else
+            result(x,y,p).invalidate();
+        }
+      }
+    }
+    return result;
+  }
+
+  /// Subsamples a mask by two.  A pixel of the result is on, set to the
+  /// largest value of the pixel type, if at least two of the 2x2 block
+  /// of pixels under it are nonzero.  Pixels past the edges are zero.
+  template <class PixelT>
+  ImageView<PixelT> subsample_mask_by_two( ImageView<PixelT> const& mask ) {
+    const int32 cols = mask.cols(), rows = mask.rows();
+    ImageView<PixelT> result( (cols+1)/2, (rows+1)/2, mask.planes() );
+    const PixelT on = PixelT( ScalarTypeLimits<PixelT>::highest() );
+    for( int32 p=0; p<result.planes(); ++p ) {
+      for( int32 y=0; y<result.rows(); ++y ) {
+        PixelT const* row0 = &mask(0,2*y,p);
+        PixelT const* row1 = 2*y+1 < rows ? &mask(0,2*y+1,p) : 0;
+        for( int32 x=0; x<result.cols(); ++x ) {
+          const int32 i = 2*x;
+          const bool  right = i+1 < cols;
+          int32 count = (row0[i] ? 1 : 0) + (right && row0[i+1] ? 1 : 0);
+          if ( row1 )
+            count += (row1[i] ? 1 : 0) + (right && row1[i+1] ? 1 : 0);
+          result(x,y,p) = count > 1 ? on : PixelT();
+        }
+      }
+    }
+    return result;
+  }
+
+  /// The image and the given number of levels below it, each reduced
+  /// from the one before with subsample_by_two().
+  template <class PixelT, class KernelT>
+  std::vector<ImageView<PixelT> > smoothed_pyramid( ImageView<PixelT> const& image,
+                                                    std::vector<KernelT> const& kernel, int32 levels ) {
+    std::vector<ImageView<PixelT> > result( 1, image );
+    for( int32 i=0; i<levels; ++i )
+      result.push_back( subsample_by_two( result.back(), kernel ) );
+    return result;
+  }
+
+  /// The image and the given number of levels below it, each reduced
+  /// from the one before by averaging 2x2 blocks with box_subsample().
+  template <class PixelT>
+  std::vector<ImageView<PixelT> > box_pyramid( ImageView<PixelT> const& image, int32 levels ) {
+    std::vector<ImageView<PixelT> > result( 1, image );
+    for( int32 i=0; i<levels; ++i )
+      result.push_back( box_subsample( result.back(), Vector2i(2,2) ) );
+    return result;
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_PYRAMID_H__
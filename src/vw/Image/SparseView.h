@@ -23,8 +23,12 @@
 #define __VW_IMAGE_SPARSE_IMAGE_VIEW_H__
 
 // Standard
+#include <algorithm>
+#include <map>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 // VW
 #include <vw/Core/Log.h>
 #include <vw/Math/Vector.h>
@@ -55,7 +59,9 @@ namespace vw {
     // vector. This somewhat confusing method is to allow us better use of
     // the container's search method.
     typedef std::map<int32,std::vector<typename ImageT::pixel_type > > map_type;
-    std::vector<map_type> m_data; // One map for each row of the image
+    // One map for each row of the image, shared by the copies
+    // prerasterize() makes.
+    boost::shared_ptr<std::vector<map_type> > m_data;
     bool   m_allow_overlap;
     ImageT m_under_image;
 
@@ -67,7 +73,7 @@ namespace vw {
     // Standard stuff
     SparseCompositeView( ImageViewBase<ImageT> const& under_image,
                          bool allow_overlap = false ) :
-      m_data(under_image.impl().rows()), m_allow_overlap(allow_overlap),
+      m_data(new std::vector<map_type>(under_image.impl().rows())), m_allow_overlap(allow_overlap),
       m_under_image(under_image.impl()) {}
 
     inline int32 cols  () const { return m_under_image.cols(); }
@@ -81,9 +87,9 @@ namespace vw {
       // Get next container entry after column 'i'.  Since each container is labeled
       //   with the last column in that section, this finds the section which might contain 'i'.
       typename map_type::const_iterator it;
-      it = m_data[j].upper_bound(i);
+      it = (*m_data)[j].upper_bound(i);
 
-      if ( it != m_data[j].end() ) { // If a segment possibly containing 'i' was found
+      if ( it != (*m_data)[j].end() ) { // If a segment possibly containing 'i' was found
         int32 s_idx = it->first - it->second.size(); // Get the starting index of this section
         if ( i < s_idx )
           return m_under_image( i, j, p ); // The segment does not contain the requested pixel, use the underlying image
@@ -95,9 +101,31 @@ namespace vw {
 
     typedef SparseCompositeView<ImageT> prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const { return *this; }
+    /// Rasterizes the underlying image, then copies in the runs of
+    /// each row which have data, rather than looking up each pixel in
+    /// the segment maps.
     template <class DestT>
     inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
-      rasterize( prerasterize(bbox), dest, bbox );
+      typedef typename DestT::pixel_type     dest_pixel_type;
+      typedef typename DestT::pixel_accessor dest_accessor;
+
+      m_under_image.rasterize( dest, bbox );
+      for ( int32 row = bbox.min().y(); row < bbox.max().y(); ++row ) {
+        map_type const& segments = (*m_data)[row];
+        // The segments are keyed on one past their last column, so this
+        // finds the first one which ends inside the bbox or past it.
+        typename map_type::const_iterator it = segments.upper_bound( bbox.min().x() );
+        for ( ; it != segments.end(); ++it ) {
+          const int32 s_idx = it->first - int32(it->second.size());
+          if ( s_idx >= bbox.max().x() )
+            break;
+          const int32 start = std::max( s_idx,     bbox.min().x() );
+          const int32 end   = std::min( it->first, bbox.max().x() );
+          dest_accessor acc = dest.origin().advance( start - bbox.min().x(), row - bbox.min().y() );
+          for ( int32 col = start; col < end; ++col, acc.next_col() )
+            *acc = dest_pixel_type( it->second[col - s_idx] );
+        }
+      }
     }
 
     // Difficult insertation
@@ -147,8 +175,8 @@ namespace vw {
           *iter += starting_index[0];
 
       // Inserting into global data set
-      if ( int32(m_data.size()) < starting_index[1]+image.rows() )
-        m_data.resize( starting_index[1]+image.rows() ); // Allocate local sparse storage if needed
+      if ( int32(m_data->size()) < starting_index[1]+image.rows() )
+        m_data->resize( starting_index[1]+image.rows() ); // Allocate local sparse storage if needed
 
       // Loop through all rows contained in the input image patch
       for ( int32 t_i=0, m_i=starting_index[1];
@@ -158,10 +186,10 @@ namespace vw {
         std::list<int32>::const_iterator t_e_iter = t_row_end[t_i].begin();
         typename std::list<std::vector<pixel_type> >::const_iterator t_d_iter = t_row_data[t_i].begin();
         while ( t_e_iter != t_row_end[t_i].end() ) {
-          typename map_type::iterator it = m_data[m_i].lower_bound( *t_e_iter );
-          if ( it == m_data[m_i].end() ) { // Doesn't appear anything is this far right
-            m_data[m_i][*t_e_iter] = *t_d_iter;
-          } else if ( it == m_data[m_i].begin() ) {
+          typename map_type::iterator it = (*m_data)[m_i].lower_bound( *t_e_iter );
+          if ( it == (*m_data)[m_i].end() ) { // Doesn't appear anything is this far right
+            (*m_data)[m_i][*t_e_iter] = *t_d_iter;
+          } else if ( it == (*m_data)[m_i].begin() ) {
             // Nothing in front of this point.
             int32 m_start_idx = it->first - it->second.size();
             if ( *t_e_iter > m_start_idx )
@@ -171,7 +199,7 @@ namespace vw {
                                  t_d_iter->begin(),
                                  t_d_iter->end() );
             else // Whole new key
-              m_data[m_i][*t_e_iter] = *t_d_iter;
+              (*m_data)[m_i][*t_e_iter] = *t_d_iter;
           } else {
             // Somewhere in the middle
             typename map_type::const_iterator prev_it = it;
@@ -186,7 +214,7 @@ namespace vw {
                                  t_d_iter->begin(),
                                  t_d_iter->end() );
             else // Whole new key
-              m_data[m_i][*t_e_iter] = *t_d_iter;
+              (*m_data)[m_i][*t_e_iter] = *t_d_iter;
           }
 
           ++t_e_iter;
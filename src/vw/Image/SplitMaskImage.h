@@ -0,0 +1,167 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SplitMaskImage.h
+///
+/// An in-memory masked image which keeps the values and the valid
+/// flags in separate planes.
+///
+#ifndef __VW_IMAGE_SPLITMASKIMAGE_H__
+#define __VW_IMAGE_SPLITMASKIMAGE_H__
+
+#include <algorithm>
+
+#include <vw/Core/Exception.h>
+#include <vw/Core/Functors.h>
+#include <vw/Image/AlgorithmFunctions.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/PixelMask.h>
+
+namespace vw {
+
+  /// Combines a value and a mask byte into a PixelMask.
+  template <class ChildT>
+  struct SplitMaskCombineFunctor : ReturnFixedType<PixelMask<ChildT> > {
+    PixelMask<ChildT> operator()( ChildT const& value, uint8 valid ) const {
+      PixelMask<ChildT> result( value );
+      if ( !valid )
+        result.invalidate();
+      return result;
+    }
+  };
+
+  /// An image of PixelMask<ChildT> pixels stored as an ImageView of
+  /// the values and an ImageView<uint8> of valid flags, instead of a
+  /// ChildT sized flag next to each value.  A PixelMask<float> pixel
+  /// then takes 5 bytes instead of 8, and a PixelMask<Vector2f> 9
+  /// instead of 12.
+  ///
+  /// It reads like an ImageView<PixelMask<ChildT> >, so it can be
+  /// used as the source of any view, but its pixels can't be written
+  /// through an accessor.  Assign a view to it, or use set(), or
+  /// write to data() and mask() directly.  The flags are bytes rather
+  /// than bits so that different threads can write neighbouring
+  /// blocks.  Like ImageView, copies share their data.
+  template <class ChildT>
+  class SplitMaskImage : public ImageViewBase<SplitMaskImage<ChildT> > {
+    ImageView<ChildT> m_data;
+    ImageView<uint8>  m_mask;
+    SplitMaskCombineFunctor<ChildT> m_func;
+  public:
+    typedef PixelMask<ChildT> pixel_type;
+    typedef PixelMask<ChildT> result_type;
+    typedef BinaryPerPixelAccessor<typename ImageView<ChildT>::pixel_accessor,
+                                   ImageView<uint8>::pixel_accessor,
+                                   SplitMaskCombineFunctor<ChildT> > pixel_accessor;
+
+    SplitMaskImage() {}
+
+    /// An image with all of its pixels invalid.
+    SplitMaskImage( int32 cols, int32 rows, int32 planes=1 ) {
+      set_size( cols, rows, planes );
+    }
+
+    /// Use existing planes, sharing their data.
+    SplitMaskImage( ImageView<ChildT> const& data, ImageView<uint8> const& mask )
+      : m_data(data), m_mask(mask) {
+      VW_ASSERT( data.cols() == mask.cols() && data.rows() == mask.rows() && data.planes() == mask.planes(),
+                 ArgumentErr() << "SplitMaskImage: the data and mask planes differ in size." );
+    }
+
+    /// Rasterize a view into a new image.
+    template <class ViewT>
+    SplitMaskImage( ImageViewBase<ViewT> const& view ) {
+      *this = view;
+    }
+
+    /// Rasterize a view into this image, a strip of rows at a time so
+    /// that the whole image never exists with interleaved masks.  The
+    /// view's pixels may be masked or not.
+    template <class ViewT>
+    SplitMaskImage& operator=( ImageViewBase<ViewT> const& view );
+
+    /// Resize the image, making all of its pixels invalid.
+    void set_size( int32 cols, int32 rows, int32 planes=1 ) {
+      m_data.set_size( cols, rows, planes );
+      m_mask.set_size( cols, rows, planes );
+      fill( m_mask, uint8(0) );
+    }
+
+    int32 cols  () const { return m_data.cols  (); }
+    int32 rows  () const { return m_data.rows  (); }
+    int32 planes() const { return m_data.planes(); }
+
+    pixel_accessor origin() const {
+      return pixel_accessor( m_data.origin(), m_mask.origin(), m_func );
+    }
+
+    result_type operator()( int32 col, int32 row, int32 plane=0 ) const {
+      return m_func( m_data( col, row, plane ), m_mask( col, row, plane ) );
+    }
+
+    void set( int32 col, int32 row, pixel_type const& pixel ) { set( col, row, 0, pixel ); }
+    void set( int32 col, int32 row, int32 plane, pixel_type const& pixel ) {
+      m_data( col, row, plane ) = pixel.child();
+      m_mask( col, row, plane ) = is_valid( pixel ) ? 1 : 0;
+    }
+
+    /// The values, including those of invalid pixels.
+    ImageView<ChildT> const& data() const { return m_data; }
+    /// Nonzero where a pixel is valid.
+    ImageView<uint8>  const& mask() const { return m_mask; }
+
+    typedef SplitMaskImage prerasterize_type;
+    prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+    template <class DestT> void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  template <class ChildT>
+  struct IsMultiplyAccessible<SplitMaskImage<ChildT> > : public true_type {};
+
+  template <class ChildT>
+  template <class ViewT>
+  SplitMaskImage<ChildT>& SplitMaskImage<ChildT>::operator=( ImageViewBase<ViewT> const& view ) {
+    ViewT const& src = view.impl();
+    // Rasterize into new planes, in case the view reads from this image.
+    ImageView<ChildT> data( src.cols(), src.rows(), src.planes() );
+    ImageView<uint8>  mask( src.cols(), src.rows(), src.planes() );
+    ImageView<typename ViewT::pixel_type> strip;
+    const int32 strip_rows = std::max( 1, (1 << 16) / std::max( 1, src.cols() ) );
+    for ( int32 row0 = 0; row0 < src.rows(); row0 += strip_rows ) {
+      BBox2i bbox( 0, row0, src.cols(), std::min( strip_rows, src.rows() - row0 ) );
+      strip.set_size( bbox.width(), bbox.height(), src.planes() );
+      src.rasterize( strip, bbox );
+      for ( int32 p = 0; p < strip.planes(); ++p )
+        for ( int32 r = 0; r < strip.rows(); ++r )
+          for ( int32 c = 0; c < strip.cols(); ++c ) {
+            data( c, row0 + r, p ) = remove_mask( strip( c, r, p ) );
+            mask( c, row0 + r, p ) = is_valid( strip( c, r, p ) ) ? 1 : 0;
+          }
+    }
+    m_data = data;
+    m_mask = mask;
+    return *this;
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_SPLITMASKIMAGE_H__
@@ -559,6 +559,97 @@ namespace vw {
   }
 
 
+  /// Functor for block_reduce() which reduces the channel values of
+  /// the valid pixels of the blocks one thread sees into an accumulator
+  /// of its own.
+  class ParallelSummaryFunctor {
+
+    math::SummaryAccumulator m_accum;
+
+  public:
+
+    ParallelSummaryFunctor(size_t num_bins) : m_accum(num_bins) {}
+
+    template <class PixelT>
+    void operator()(ImageView<PixelT> const& image, BBox2i const& /*bbox*/) {
+      for (int32 p = 0; p < image.planes(); ++p)
+        for (int32 row = 0; row < image.rows(); ++row)
+          for (int32 col = 0; col < image.cols(); ++col) {
+            PixelT const& pix = image(col, row, p);
+            if (is_valid(pix))
+              compound_apply_in_place(m_accum, remove_mask(pix));
+          }
+    }
+
+    void merge(ParallelSummaryFunctor const& other) { m_accum.merge(other.m_accum); }
+
+    math::SummaryAccumulator const& accumulator() const { return m_accum; }
+  }; // End class ParallelSummaryFunctor
+
+
+  /// Compute min, max, mean, variance, a histogram and approximate
+  /// quantiles of the channel values of all valid pixels in a single
+  /// multi-threaded pass over the image.
+  /// - Values are added to whatever the accumulator already holds.
+  template <class ViewT>
+  void block_summary_statistics(ImageViewBase<ViewT> const& image,
+                                math::SummaryAccumulator &stats,
+                                Vector2i block_size  = Vector2i(256,256),
+                                int      num_threads = 0) {
+    ParallelSummaryFunctor summary_functor(stats.num_bins());
+
+    // No need for a cache since each tile will be visited only once.
+    block_reduce(image, summary_functor, block_size, num_threads);
+    stats.merge(summary_functor.accumulator());
+  }
+
+
+  /// Functor for block_reduce() which sketches the channel values of
+  /// the valid pixels of the blocks one thread sees into a
+  /// QuantileSketch of its own.
+  class ParallelQuantileFunctor {
+
+    math::QuantileSketch m_sketch;
+
+  public:
+
+    ParallelQuantileFunctor(size_t k) : m_sketch(k) {}
+
+    template <class PixelT>
+    void operator()(ImageView<PixelT> const& image, BBox2i const& /*bbox*/) {
+      for (int32 p = 0; p < image.planes(); ++p)
+        for (int32 row = 0; row < image.rows(); ++row)
+          for (int32 col = 0; col < image.cols(); ++col) {
+            PixelT const& pix = image(col, row, p);
+            if (is_valid(pix))
+              compound_apply_in_place(m_sketch, remove_mask(pix));
+          }
+    }
+
+    void merge(ParallelQuantileFunctor const& other) { m_sketch.merge(other.m_sketch); }
+
+    math::QuantileSketch const& sketch() const { return m_sketch; }
+  }; // End class ParallelQuantileFunctor
+
+
+  /// Sketch the distribution of the channel values of all valid pixels
+  /// in a single multi-threaded pass over the image, so that
+  /// percentiles can be found in bounded memory whatever the range of
+  /// the values.
+  /// - Values are added to whatever the sketch already holds.
+  template <class ViewT>
+  void block_quantile_sketch(ImageViewBase<ViewT> const& image,
+                             math::QuantileSketch &sketch,
+                             Vector2i block_size  = Vector2i(256,256),
+                             int      num_threads = 0) {
+    ParallelQuantileFunctor quantile_functor(sketch.k());
+
+    // No need for a cache since each tile will be visited only once.
+    block_reduce(image, quantile_functor, block_size, num_threads);
+    sketch.merge(quantile_functor.sketch());
+  }
+
+
 #include <vw/Image/Statistics.tcc>
 
 }  // namespace vw
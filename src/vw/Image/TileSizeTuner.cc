@@ -0,0 +1,94 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Image/TileSizeTuner.h>
+#include <vw/Core/MemoryGovernor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace vw {
+
+  TileSizeTuning::TileSizeTuning() : max_samples(8), max_seconds(10), memory_budget(0) {
+    for ( int32 size = 64; size <= 1024; size *= 2 )
+      candidates.push_back( size );
+  }
+
+  namespace detail {
+
+  std::vector<int32> tile_size_candidates( TileSizeTuning const& tuning, Vector2i const& image_size,
+                                           size_t pixel_bytes, int num_threads ) {
+    VW_ASSERT( !tuning.candidates.empty(), ArgumentErr() << "tune_tile_size: There are no candidate sizes." );
+    std::vector<int32> sizes = tuning.candidates;
+    std::sort( sizes.begin(), sizes.end() );
+    size_t budget = tuning.memory_budget ? tuning.memory_budget : vw_memory_governor().budget();
+    int32 extent = std::max( image_size.x(), image_size.y() );
+
+    std::vector<int32> result;
+    result.push_back( sizes[0] );
+    for ( size_t i = 1; i < sizes.size(); ++i ) {
+      // A size past the image only repeats the one before it.
+      if ( sizes[i-1] >= extent )
+        break;
+      double in_flight = 2.0 * num_threads * sizes[i] * sizes[i] * pixel_bytes;
+      if ( budget && in_flight > double( budget ) )
+        break;
+      result.push_back( sizes[i] );
+    }
+    return result;
+  }
+
+  std::vector<BBox2i> tile_size_sample_boxes( Vector2i const& image_size, int32 size, int num_samples ) {
+    Vector2i extent( std::min( size, image_size.x() ), std::min( size, image_size.y() ) );
+    std::vector<BBox2i> boxes;
+    for ( int k = 0; k < num_samples; ++k ) {
+      // Centers at (k+1/2)/n of the way along the diagonal, with the
+      // boxes moved inside the image.
+      Vector2i corner;
+      for ( int i = 0; i < 2; ++i ) {
+        int32 center = int32( ( k + 0.5 ) / num_samples * image_size[i] );
+        corner[i] = std::max( 0, std::min( center - extent[i] / 2, image_size[i] - extent[i] ) );
+      }
+      boxes.push_back( BBox2i( corner, corner + extent ) );
+    }
+    return boxes;
+  }
+
+  int32 choose_tile_size( std::vector<TileSizeSample> const& samples, Vector2i const& image_size,
+                          int num_threads ) {
+    VW_ASSERT( !samples.empty(), ArgumentErr() << "tune_tile_size: There are no samples." );
+    int32 best_size = samples[0].size;
+    double best_time = std::numeric_limits<double>::max();
+    for ( size_t i = 0; i < samples.size(); ++i ) {
+      TileSizeSample const& s = samples[i];
+      double sample_rounds = double( ( s.tiles + s.threads - 1 ) / s.threads );
+      double tiles = double( ( image_size.x() + s.size - 1 ) / s.size ) * ( ( image_size.y() + s.size - 1 ) / s.size );
+      double rounds = std::ceil( tiles / num_threads );
+      double time = rounds * s.seconds / sample_rounds;
+      if ( time < best_time ) {
+        best_time = time;
+        best_size = s.size;
+      }
+    }
+    return best_size;
+  }
+
+  } // namespace detail
+
+} // namespace vw
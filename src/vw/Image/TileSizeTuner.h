@@ -0,0 +1,177 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file TileSizeTuner.h
+///
+/// Picks the tile size for rasterizing a view by timing it.
+///
+/// One tile size does not suit every pipeline: SGM wants large tiles,
+/// so that the overlap each tile computes again is a small part of it,
+/// while a per-pixel cast wants small ones, which stay in the CPU
+/// caches.  tune_tile_size() rasterizes a few sample tiles of the view
+/// at each candidate size, as many at once as there are threads, and
+/// picks the size with the least estimated time for the whole image.
+///
+/// With the auto_tile_size setting ("general.auto_tile_size" in
+/// ~/.vwrc), block_rasterize() and block_cache() tune the block size
+/// whenever the caller leaves it unset, and block_write_gdal_image()
+/// tunes the tile size of the file it writes.
+///
+/// The samples are computed for nothing, so tuning only pays off for
+/// images of many tiles.  A view which caches its blocks should be
+/// tuned before the cache is added, or the samples will hit it.
+///
+#ifndef __VW_IMAGE_TILESIZETUNER_H__
+#define __VW_IMAGE_TILESIZETUNER_H__
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Math/BBox.h>
+#include <vw/Math/Vector.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+
+namespace vw {
+
+  /// The choices tune_tile_size() makes between.
+  struct TileSizeTuning {
+    /// The widths of the square tiles to try, smallest first.
+    std::vector<int32> candidates;
+    /// The most sample tiles timed at each size; fewer when there are
+    /// fewer threads.
+    int max_samples;
+    /// Stop timing larger sizes once this many seconds have been spent.
+    double max_seconds;
+    /// The bytes the tiles in flight may take, or 0 for the budget of
+    /// vw_memory_governor().  Sizes over it are not tried.
+    size_t memory_budget;
+
+    /// 64 to 1024 pixels, up to 8 samples and 10 seconds.
+    TileSizeTuning();
+  };
+
+  /// The time taken to rasterize the samples at one tile size.
+  struct TileSizeSample {
+    int32  size;    ///< Width of the tiles
+    int32  tiles;   ///< Tiles rasterized
+    int    threads; ///< Threads they were spread over
+    double seconds; ///< Wall time
+  };
+
+  /// \cond INTERNAL
+  namespace detail {
+    /// The candidates worth trying for an image: those whose tiles in
+    /// flight, two per thread, fit in the budget, and no more than one
+    /// at or above the image size.  The smallest is always kept.
+    std::vector<int32> tile_size_candidates( TileSizeTuning const& tuning, Vector2i const& image_size,
+                                             size_t pixel_bytes, int num_threads );
+
+    /// num_samples tiles of the given size spread along the image's diagonal.
+    std::vector<BBox2i> tile_size_sample_boxes( Vector2i const& image_size, int32 size, int num_samples );
+
+    /// The sample with the least estimated time for the image on
+    /// num_threads threads.  A sample's wall time is the time of one
+    /// round of tiles, one per thread, so the image takes as many of
+    /// those as it has rounds of tiles.
+    int32 choose_tile_size( std::vector<TileSizeSample> const& samples, Vector2i const& image_size,
+                            int num_threads );
+
+    template <class ViewT>
+    class TileSampleTask : public Task {
+      ViewT const& m_view;
+      BBox2i m_bbox;
+    public:
+      TileSampleTask( ViewT const& view, BBox2i const& bbox ) : m_view(view), m_bbox(bbox) {}
+      virtual void operator()() {
+        ImageView<typename ViewT::pixel_type> tile = crop( m_view, m_bbox );
+      }
+    };
+
+    /// Rasterizes the boxes on up to num_threads threads and returns the wall time.
+    template <class ViewT>
+    double time_tile_samples( ViewT const& view, std::vector<BBox2i> const& boxes, int num_threads ) {
+      uint64 start = Stopwatch::microtime();
+      FifoWorkQueue queue( num_threads );
+      for ( size_t i = 0; i < boxes.size(); ++i )
+        queue.add_task( boost::shared_ptr<Task>( new TileSampleTask<ViewT>( view, boxes[i] ) ) );
+      queue.join_all();
+      return ( Stopwatch::microtime() - start ) * 1e-6;
+    }
+  } // namespace detail
+  /// \endcond
+
+  /// Times sample tiles of the view at each candidate size, on
+  /// num_threads threads (0 for the default thread count), and returns
+  /// the square block size with the least estimated time for the view.
+  template <class ViewT>
+  Vector2i tune_tile_size( ImageViewBase<ViewT> const& view, int num_threads = 0,
+                           TileSizeTuning const& tuning = TileSizeTuning() ) {
+    if ( num_threads < 1 )
+      num_threads = vw_settings().default_num_threads();
+    Vector2i image_size( view.impl().cols(), view.impl().rows() );
+    size_t pixel_bytes = size_t( view.impl().planes() ) * sizeof( typename ViewT::pixel_type );
+    std::vector<int32> candidates = detail::tile_size_candidates( tuning, image_size, pixel_bytes, num_threads );
+    if ( candidates.size() == 1 )
+      return Vector2i( candidates[0], candidates[0] );
+
+    int num_samples = std::max( 2, std::min( tuning.max_samples, num_threads ) );
+    int threads = std::min( num_samples, num_threads );
+
+    // Warm up whatever the view reads, so that the first size timed is
+    // not charged for it.
+    detail::time_tile_samples( view.impl(), detail::tile_size_sample_boxes( image_size, candidates[0], 1 ), 1 );
+
+    std::vector<TileSizeSample> samples;
+    double spent = 0;
+    for ( size_t i = 0; i < candidates.size() && ( samples.empty() || spent < tuning.max_seconds ); ++i ) {
+      std::vector<BBox2i> boxes = detail::tile_size_sample_boxes( image_size, candidates[i], num_samples );
+      TileSizeSample sample;
+      sample.size    = candidates[i];
+      sample.tiles   = int32( boxes.size() );
+      sample.threads = threads;
+      sample.seconds = detail::time_tile_samples( view.impl(), boxes, threads );
+      spent += sample.seconds;
+      samples.push_back( sample );
+      VW_OUT(DebugMessage, "image") << "tune_tile_size: " << boxes.size() << " tiles of " << sample.size
+                                    << " pixels took " << sample.seconds << " s\n";
+    }
+    int32 size = detail::choose_tile_size( samples, image_size, num_threads );
+    VW_OUT(DebugMessage, "image") << "tune_tile_size: chose " << size << " pixel tiles for a "
+                                  << image_size.x() << "x" << image_size.y() << " image\n";
+    return Vector2i( size, size );
+  }
+
+  /// The block size to rasterize the view with: block_size if it is
+  /// set, otherwise a tuned one if the auto_tile_size setting is on, or
+  /// else unset, for the caller's default.
+  template <class ViewT>
+  Vector2i auto_block_size( ImageViewBase<ViewT> const& view, Vector2i const& block_size, int num_threads ) {
+    if ( ( block_size.x() > 0 && block_size.y() > 0 ) || !vw_settings().auto_tile_size() )
+      return block_size;
+    return tune_tile_size( view, num_threads );
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_TILESIZETUNER_H__
@@ -30,6 +30,10 @@
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Interpolation.h>
 
+#include <vector>
+#include <boost/mpl/or.hpp>
+#include <boost/scoped_array.hpp>
+
 static const double VW_DEFAULT_MIN_TRANSFORM_IMAGE_SIZE = 1;
 static const double VW_DEFAULT_MAX_TRANSFORM_IMAGE_SIZE = 1e10; // Ten gigapixels
 
@@ -223,6 +227,242 @@ namespace vw {
 
   };
 
+  /// Indicates whether a transform has a reverse_points() method which
+  /// is faster than calling reverse() on each point in turn, usually
+  /// because it hands the whole batch to an external library.
+  template <class TransformT>
+  struct HasBatchReverse : public false_type {};
+
+  /// \cond INTERNAL
+  namespace detail {
+    template <class TransformT>
+    inline void reverse_points( TransformT const& txform, std::vector<Vector2> const& points,
+                                std::vector<Vector2>& result, true_type ) {
+      txform.reverse_points( points, result );
+    }
+
+    template <class TransformT>
+    inline void reverse_points( TransformT const& txform, std::vector<Vector2> const& points,
+                                std::vector<Vector2>& result, false_type ) {
+      result.resize( points.size() );
+      for ( size_t k = 0; k < points.size(); ++k )
+        result[k] = txform.reverse( points[k] );
+    }
+
+    /// Reverse transforms a batch of points, in one call if the
+    /// transform supports it.
+    template <class TransformT>
+    inline void reverse_points( TransformT const& txform, std::vector<Vector2> const& points,
+                                std::vector<Vector2>& result ) {
+      reverse_points( txform, points, result, typename HasBatchReverse<TransformT>::type() );
+    }
+  }
+  /// \endcond
+
+  // AdaptiveApproximateTransform image transform functor template.
+  //
+  // Like ApproximateTransform, but refined locally.  The bounding box
+  // is split into cells of cell_size pixels whose corners are computed
+  // exactly.  Each cell then doubles its own lookup grid until the
+  // newly computed points are within the transform's tolerance of the
+  // bilinear interpolation of the previous grid, so smooth regions
+  // cost a handful of reverse() calls per cell while difficult ones
+  // are refined only where needed.  Cells which would need a grid
+  // finer than two pixels, or where reverse() throws, fall back to
+  // the exact transform.  When the transform has HasBatchReverse, the
+  // exact points are computed a batch at a time.
+  template <class TransformT>
+  class AdaptiveApproximateTransform : public TransformT {
+    struct Cell {
+      int32  n;      ///< Grid intervals per side, or 0 for the exact transform
+      size_t offset; ///< First grid point in m_points
+    };
+
+    BBox2i m_bbox;
+    int32  m_cell_size, m_nx, m_ny;
+    std::vector<Cell>    m_cells;
+    std::vector<Vector2> m_points;
+
+    // Compute the exact position, returning false if it can't be.
+    bool exact( Vector2 const& p, Vector2& result ) const {
+      try {
+        result = TransformT::reverse( p );
+      } catch ( const Exception& ) {
+        return false;
+      }
+      return true;
+    }
+
+    bool exact_batch( std::vector<Vector2> const& points, std::vector<Vector2>& result, true_type ) const {
+      try {
+        TransformT::reverse_points( points, result );
+      } catch ( const Exception& ) {
+        return false;
+      }
+      return true;
+    }
+
+    bool exact_batch( std::vector<Vector2> const&, std::vector<Vector2>&, false_type ) const {
+      return false;
+    }
+
+    // Compute a batch of exact positions, flagging those which can't
+    // be.  A batch fails as a whole, so then go one point at a time.
+    void exact( std::vector<Vector2> const& points, std::vector<Vector2>& result,
+                std::vector<bool>& valid ) const {
+      valid.assign( points.size(), true );
+      if ( exact_batch( points, result, typename HasBatchReverse<TransformT>::type() ) )
+        return;
+      result.resize( points.size() );
+      for ( size_t k = 0; k < points.size(); ++k )
+        valid[k] = exact( points[k], result[k] );
+    }
+
+    inline int32 cell_width ( int32 cx ) const { return std::min( m_cell_size, m_bbox.max().x() - (m_bbox.min().x() + cx*m_cell_size) ); }
+    inline int32 cell_height( int32 cy ) const { return std::min( m_cell_size, m_bbox.max().y() - (m_bbox.min().y() + cy*m_cell_size) ); }
+
+    // Refine the grid of one cell, given its exact corners.
+    void refine( int32 cx, int32 cy, Vector2 const corners[4], double tol_sqr ) {
+      Cell& cell = m_cells[cx + cy*m_nx];
+      Vector2 origin( m_bbox.min().x() + cx*m_cell_size, m_bbox.min().y() + cy*m_cell_size );
+      Vector2 size( cell_width(cx), cell_height(cy) );
+
+      std::vector<Vector2> prev( corners, corners+4 ), grid, new_points, new_exact;
+      std::vector<bool>    new_valid;
+      int32 n = 1;
+      while ( true ) {
+        int32 n2 = 2*n;
+        if ( size.x() < 2*n2 && size.y() < 2*n2 ) {
+          cell.n = 0;
+          return;
+        }
+
+        // The points which are not on the previous grid
+        new_points.clear();
+        for ( int32 y = 0; y <= n2; ++y )
+          for ( int32 x = 0; x <= n2; ++x )
+            if ( (x%2)!=0 || (y%2)!=0 )
+              new_points.push_back( origin + elem_prod( Vector2(x,y)/n2, size ) );
+        exact( new_points, new_exact, new_valid );
+
+        grid.resize( size_t(n2+1)*(n2+1) );
+        double max_sqr_err = 0;
+        size_t k = 0;
+        for ( int32 y = 0; y <= n2; ++y ) {
+          for ( int32 x = 0; x <= n2; ++x ) {
+            Vector2 const* p = &prev[ (x/2) + (y/2)*(n+1) ];
+            Vector2& point = grid[ x + y*(n2+1) ];
+            if ( (x%2)==0 && (y%2)==0 ) {
+              point = *p;
+              continue;
+            }
+            if ( !new_valid[k] ) {
+              cell.n = 0;
+              return;
+            }
+            point = new_exact[k++];
+            Vector2 interp;
+            if ( (y%2)==0 )      interp = ( p[0] + p[1] ) / 2.0;
+            else if ( (x%2)==0 ) interp = ( p[0] + p[n+1] ) / 2.0;
+            else                 interp = ( p[0] + p[1] + p[n+1] + p[n+2] ) / 4.0;
+            max_sqr_err = std::max( max_sqr_err, norm_2_sqr( point - interp ) );
+          }
+        }
+        prev.swap( grid );
+        n = n2;
+        if ( max_sqr_err <= tol_sqr )
+          break;
+      }
+      cell.n      = n;
+      cell.offset = m_points.size();
+      m_points.insert( m_points.end(), prev.begin(), prev.end() );
+    }
+
+  public:
+    AdaptiveApproximateTransform( TransformT const& transform, BBox2i const& bbox, int32 cell_size = 16 )
+      : TransformT( transform ), m_bbox( bbox ), m_cell_size( std::max( cell_size, 4 ) ), m_nx( 0 ), m_ny( 0 )
+    {
+      if ( bbox.empty() )
+        return;
+      m_nx = ( bbox.width () - 1 ) / m_cell_size + 1;
+      m_ny = ( bbox.height() - 1 ) / m_cell_size + 1;
+      m_cells.resize( size_t(m_nx) * m_ny );
+
+      // The cell corners are shared, so compute all of them first.
+      std::vector<Vector2> points( size_t(m_nx+1) * (m_ny+1) ), corners;
+      std::vector<bool>    valid;
+      for ( int32 y = 0; y <= m_ny; ++y )
+        for ( int32 x = 0; x <= m_nx; ++x )
+          points[ x + size_t(y)*(m_nx+1) ] = Vector2( std::min( bbox.min().x() + x*m_cell_size, bbox.max().x() ),
+                                                      std::min( bbox.min().y() + y*m_cell_size, bbox.max().y() ) );
+      exact( points, corners, valid );
+
+      double tol_sqr = TransformT::tolerance() * TransformT::tolerance();
+      for ( int32 cy = 0; cy < m_ny; ++cy )
+        for ( int32 cx = 0; cx < m_nx; ++cx ) {
+          size_t i = cx + size_t(cy)*(m_nx+1);
+          if ( !valid[i] || !valid[i+1] || !valid[i+m_nx+1] || !valid[i+m_nx+2] ) {
+            m_cells[cx + cy*m_nx].n = 0;
+            continue;
+          }
+          Vector2 cell_corners[4] = { corners[i], corners[i+1], corners[i+m_nx+1], corners[i+m_nx+2] };
+          refine( cx, cy, cell_corners, tol_sqr );
+        }
+    }
+
+    inline Vector2 reverse( Vector2 const& p ) const {
+      if ( m_cells.empty() )
+        return TransformT::reverse( p );
+
+      double fx = ( p.x() - m_bbox.min().x() ) / m_cell_size;
+      double fy = ( p.y() - m_bbox.min().y() ) / m_cell_size;
+      int32 cx = math::impl::_floor( fx ), cy = math::impl::_floor( fy );
+      if ( cx < 0 ) cx = 0;
+      if ( cx >= m_nx ) cx = m_nx-1;
+      if ( cy < 0 ) cy = 0;
+      if ( cy >= m_ny ) cy = m_ny-1;
+      Cell const& cell = m_cells[cx + cy*m_nx];
+      if ( cell.n == 0 )
+        return TransformT::reverse( p );
+
+      // Bilinear interpolation within the cell's grid, by hand for the
+      // same reason as in ApproximateTransform.
+      int32  n  = cell.n;
+      double px = n * ( p.x() - m_bbox.min().x() - cx*m_cell_size ) / cell_width (cx);
+      double py = n * ( p.y() - m_bbox.min().y() - cy*m_cell_size ) / cell_height(cy);
+      int32  ix = math::impl::_floor( px );
+      if ( ix < 0  ) ix = 0;
+      if ( ix >= n ) ix = n-1;
+      int32  iy = math::impl::_floor( py );
+      if ( iy < 0  ) iy = 0;
+      if ( iy >= n ) iy = n-1;
+      double normx = px-ix, normy = py-iy;
+
+      Vector2 const* m00 = &m_points[ cell.offset + ix + iy*(n+1) ];
+      Vector2 const& m10 = m00[1];
+      Vector2 const& m01 = m00[n+1];
+      Vector2 const& m11 = m00[n+2];
+
+      return Vector2( (m00->x()*(1-normy)+m01.x()*normy)*(1-normx) +
+                      (m10.x()*(1-normy)+m11.x()*normy)*normx,
+                      (m00->y()*(1-normy)+m01.y()*normy)*(1-normx) +
+                      (m10.y()*(1-normy)+m11.y()*normy)*normx );
+    }
+
+    /// The number of cells which use the exact transform.
+    size_t num_exact_cells() const {
+      size_t count = 0;
+      for ( size_t i = 0; i < m_cells.size(); ++i )
+        if ( m_cells[i].n == 0 )
+          ++count;
+      return count;
+    }
+
+    // Never re-approximate the approximation.
+    virtual double tolerance() const { return 0; }
+
+  };
+
   // ------------------------
   // compute_transformed_bbox functions
   // - These could maybe go to /Math/Transforms.h
@@ -325,6 +565,72 @@ namespace vw {
   }
 
 
+  /// \cond INTERNAL
+  namespace detail {
+
+    // Samples one row of a transformed view's child.  When the pixel
+    // types match, the samples go straight into the destination row.
+    template <class ChildT, class DestRowT>
+    inline void transform_sample_row( ChildT const& child, double const* i, double const* j, int32 n, int32 p,
+                                      DestRowT const& dest, typename ChildT::pixel_type* /*buf*/, true_type ) {
+      sample_points( child, i, j, n, p, &dest[0] );
+    }
+
+    template <class ChildT, class DestRowT>
+    inline void transform_sample_row( ChildT const& child, double const* i, double const* j, int32 n, int32 p,
+                                      DestRowT const& dest, typename ChildT::pixel_type* buf, false_type ) {
+      typedef typename boost::remove_reference<typename DestRowT::result_type>::type dest_pixel_type;
+      sample_points( child, i, j, n, p, buf );
+      for( int32 k=0; k<n; ++k )
+        dest[k] = dest_pixel_type( buf[k] );
+    }
+
+    // Rasterizes a transformed view a row at a time: the reverse
+    // transform is evaluated for the whole row first, and then the
+    // child is sampled at all of those points in one batch.  This is
+    // only worthwhile for children with HasBatchSampling or transforms
+    // with HasBatchReverse.
+    template <class ViewT, class DestT>
+    void transform_rasterize( ViewT const& view, DestT const& dest, BBox2i const& bbox, true_type ) {
+      typedef typename ViewT::pixel_type pixel_type;
+      typedef typename boost::mpl::if_<boost::is_same<pixel_type,typename DestT::pixel_type>,true_type,false_type>::type same_type;
+      VW_ASSERT( int(dest.cols())==bbox.width() && int(dest.rows())==bbox.height() && dest.planes()==view.planes(),
+                 ArgumentErr() << "rasterize: Source and destination must have same dimensions." );
+      const int32 width = bbox.width();
+      if( width == 0 ) return;
+      boost::scoped_array<double> i( new double[width] ), j( new double[width] );
+      boost::scoped_array<pixel_type> buf( new pixel_type[width] );
+      std::vector<Vector2> pixels( width ), points;
+      for( int32 row=0; row<bbox.height(); ++row ) {
+        for( int32 col=0; col<width; ++col )
+          pixels[col] = Vector2( bbox.min().x()+col, bbox.min().y()+row );
+        reverse_points( view.transform(), pixels, points );
+        for( int32 col=0; col<width; ++col ) {
+          i[col] = points[col][0];
+          j[col] = points[col][1];
+        }
+        for( int32 plane=0; plane<view.planes(); ++plane )
+          transform_sample_row( view.child(), i.get(), j.get(), width, plane,
+                                RowEvaluator<DestT>( dest, 0, row, plane ), buf.get(), same_type() );
+      }
+    }
+
+    template <class ViewT, class DestT>
+    inline void transform_rasterize( ViewT const& view, DestT const& dest, BBox2i const& bbox, false_type ) {
+      vw::rasterize( view, dest, bbox );
+    }
+
+    // Whether to rasterize a TransformView of ImageT with TransformT
+    // into DestT a row at a time.
+    template <class ImageT, class TransformT, class DestT>
+    struct TransformByRows
+      : public boost::mpl::if_<boost::mpl::and_<boost::mpl::or_<HasBatchSampling<typename ImageT::prerasterize_type>,
+                                                                HasBatchReverse<TransformT> >,
+                                                IsRowWritable<DestT> >,
+                               true_type,false_type>::type {};
+  }
+  /// \endcond
+
   // ------------------------
   // class TransformView
   // ------------------------
@@ -375,12 +681,12 @@ namespace vw {
     }
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
       if( m_mapper.tolerance() > 0.0 ) {
-        ApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
-        TransformView<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height );
-        vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
+        AdaptiveApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
+        TransformView<ImageT, AdaptiveApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height );
+        detail::transform_rasterize( approx_view.prerasterize(bbox), dest, bbox, detail::TransformByRows<ImageT,AdaptiveApproximateTransform<TransformT>,DestT>() );
       }
       else {
-        vw::rasterize( prerasterize(bbox), dest, bbox );
+        detail::transform_rasterize( prerasterize(bbox), dest, bbox, detail::TransformByRows<ImageT,TransformT,DestT>() );
       }
     }
     // \endcond
@@ -392,6 +698,49 @@ namespace vw {
   struct IsFloatingPointIndexable<TransformView<ImplT, TransformT> > : public true_type {};
   // \endcond
 
+  /// Checks the child over the region that rasterizing the part of
+  /// the bbox within the view would read, as found by the transform's
+  /// reverse_bbox().  Transforms which cannot bound the region are
+  /// assumed to hit data.
+  template <class ImageT, class TransformT>
+  class SparseImageCheck<TransformView<ImageT, TransformT> > {
+    TransformView<ImageT, TransformT> const& m_view;
+  public:
+    SparseImageCheck(TransformView<ImageT, TransformT> const& view) : m_view(view) {}
+    bool operator()( BBox2i const& bbox ) const {
+      BBox2i dst_bbox = bbox;
+      dst_bbox.crop( BBox2i( 0, 0, m_view.cols(), m_view.rows() ) );
+      if( dst_bbox.empty() ) return false;
+      BBox2i src_bbox;
+      try {
+        src_bbox = m_view.transform().reverse_bbox( dst_bbox );
+      } catch( const std::exception& ) {
+        return true;
+      }
+      return SparseImageCheck<ImageT>(m_view.child())( src_bbox );
+    }
+  };
+
+  /// Reads the child over the transform's reverse_bbox() of the bbox,
+  /// as prerasterize() does.  All of the child is reported if the
+  /// transform cannot bound the region.
+  template <class ImageT, class TransformT>
+  class SourceFootprint<TransformView<ImageT, TransformT> > {
+    TransformView<ImageT, TransformT> const& m_view;
+  public:
+    SourceFootprint(TransformView<ImageT, TransformT> const& view) : m_view(view) {}
+    void operator()( BBox2i const& bbox, Footprint& footprint ) const {
+      BBox2i src_bbox;
+      try {
+        src_bbox = m_view.transform().reverse_bbox( bbox );
+      } catch( const std::exception& ) {
+        src_bbox = BBox2i( 0, 0, m_view.child().cols(), m_view.child().rows() );
+      }
+      if( !src_bbox.empty() )
+        SourceFootprint<ImageT>(m_view.child())( src_bbox, footprint );
+    }
+  };
+
   // ------------------------
   // class TransformViewNoData
   // ------------------------
@@ -450,8 +799,8 @@ namespace vw {
     template <class DestT> inline void rasterize( DestT const& dest,
                                                   BBox2i const& bbox ) const {
       if( m_mapper.tolerance() > 0.0 ) {
-        ApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
-        TransformViewNoData<ImageT, ApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height, m_nodata_val, m_pixel_buffer );
+        AdaptiveApproximateTransform<TransformT> approx_transform( m_mapper, bbox );
+        TransformViewNoData<ImageT, AdaptiveApproximateTransform<TransformT> > approx_view( m_image, approx_transform, m_width, m_height, m_nodata_val, m_pixel_buffer );
         vw::rasterize( approx_view.prerasterize(bbox), dest, bbox );
       }
       else {
@@ -24,6 +24,8 @@
 #ifndef __VW_IMAGE_WINDOWALGORITHMS_H__
 #define __VW_IMAGE_WINDOWALGORITHMS_H__
 
+#include <set>
+
 #include <vw/Math/Functors.h>
 #include <vw/Image/Manipulation.h>
 #include <vw/Image/EdgeExtension.h>
@@ -33,8 +35,178 @@ namespace vw {
 
 
 
-/// For each pixel compute the standard deviation of the pixels in a neighborhood.
-/// - Could factor out a generic sliding buffer class, which could also implement the median filter.
+//============================================================================
+// Sliding window building blocks
+
+/// Sums a per-pixel term over every window position of a tile.
+/// - terms covers the support region of the tile, so it is
+///   window_size-1 larger than the output in each direction.
+/// - Column sums are updated with one add and one subtract as the
+///   window moves down a row, and a running sum slides along each row,
+///   so the cost per output pixel does not depend on the window size.
+/// - SumT must default construct to zero and support += and -=.
+template <class SumT>
+void box_window_sum( ImageView<SumT> const& terms, Vector2i const& window_size,
+                     ImageView<SumT> & sums ) {
+  const int32 kw = window_size[0], kh = window_size[1];
+  const int32 cols = terms.cols() - kw + 1, rows = terms.rows() - kh + 1;
+  VW_ASSERT( kw > 0 && kh > 0 && cols >= 0 && rows >= 0,
+             ArgumentErr() << "box_window_sum: input is smaller than the window." );
+  sums.set_size( cols, rows );
+
+  std::vector<SumT> column( terms.cols(), SumT() );
+  for (int32 r=0; r<kh-1; ++r)
+    for (int32 c=0; c<terms.cols(); ++c)
+      column[c] += terms(c,r);
+
+  for (int32 r=0; r<rows; ++r) {
+    for (int32 c=0; c<terms.cols(); ++c)
+      column[c] += terms(c,r+kh-1); // Row entering at the bottom
+
+    SumT run = SumT();
+    for (int32 c=0; c<kw-1; ++c)
+      run += column[c];
+    for (int32 c=0; c<cols; ++c) {
+      run += column[c+kw-1];
+      sums(c,r) = run;
+      run -= column[c];
+    }
+
+    for (int32 c=0; c<terms.cols(); ++c)
+      column[c] -= terms(c,r); // Row leaving at the top
+  }
+}
+
+
+/// Tracks the value at a fixed quantile of a set of values that changes
+/// by insertions and removals, at O(log n) per update.
+/// - The values are split into two sorted sets.  The lower set holds
+///   floor(quantile*n) values, so the quantile is the smallest value
+///   of the upper set; with a quantile of 0.5 this is the median.
+/// - Only values that were inserted earlier may be erased.
+template <class T>
+class SlidingOrderStatistic {
+public:
+  typedef std::multiset<T> set_type;
+
+  SlidingOrderStatistic( double quantile ) : m_quantile(quantile) {
+    VW_ASSERT( quantile >= 0 && quantile < 1,
+               ArgumentErr() << "SlidingOrderStatistic: quantile must be in [0,1)." );
+  }
+
+  void clear() { m_lower.clear(); m_upper.clear(); }
+  size_t size() const { return m_lower.size() + m_upper.size(); }
+  bool  empty() const { return m_upper.empty(); }
+
+  void insert( T const& value ) {
+    if ( !m_upper.empty() && !(value < *m_upper.begin()) )
+      m_upper.insert( value );
+    else
+      m_lower.insert( value );
+    rebalance();
+  }
+
+  void erase( T const& value ) {
+    typename set_type::iterator it = m_lower.find( value );
+    if ( it != m_lower.end() )
+      m_lower.erase( it );
+    else {
+      it = m_upper.find( value );
+      VW_ASSERT( it != m_upper.end(), LogicErr() << "SlidingOrderStatistic: erasing a missing value." );
+      m_upper.erase( it );
+    }
+    rebalance();
+  }
+
+  /// The value at the quantile.
+  T const& value() const {
+    VW_ASSERT( !m_upper.empty(), LogicErr() << "SlidingOrderStatistic: no values." );
+    return *m_upper.begin();
+  }
+
+  /// The values below the quantile, and those at or above it.
+  set_type const& lower() const { return m_lower; }
+  set_type const& upper() const { return m_upper; }
+
+private:
+  void rebalance() {
+    const size_t target = size_t( m_quantile * double(size()) );
+    while ( m_lower.size() > target ) {
+      typename set_type::iterator it = --m_lower.end();
+      m_upper.insert( *it );
+      m_lower.erase( it );
+    }
+    while ( m_lower.size() < target ) {
+      m_lower.insert( *m_upper.begin() );
+      m_upper.erase( m_upper.begin() );
+    }
+  }
+
+  double   m_quantile;
+  set_type m_lower, m_upper;
+}; // End class SlidingOrderStatistic
+
+
+/// Evaluates a window filter one tile at a time.
+/// - FuncT receives the edge extended support region of a tile (the
+///   tile grown by the window on each side) and fills the whole output
+///   tile, so it can carry running state from one pixel to the next
+///   instead of revisiting every window from scratch.
+/// - FuncT must provide result_type, window_size() and
+///   void operator()( ImageView<SrcT> const& src, ImageView<result_type> & dst ) const.
+template <class ImageT, class FuncT, class EdgeT>
+class WindowTileView : public ImageViewBase<WindowTileView<ImageT,FuncT,EdgeT> >
+{
+private:
+  ImageT m_image;
+  FuncT  m_func;
+  EdgeT  m_edge;
+
+public:
+  typedef typename FuncT::result_type pixel_type;
+  typedef pixel_type                  result_type;
+  typedef ProceduralPixelAccessor<WindowTileView<ImageT, FuncT, EdgeT> > pixel_accessor;
+
+  WindowTileView( ImageT const& image, FuncT const& func, EdgeT const& edge = EdgeT() )
+    : m_image(image), m_func(func), m_edge(edge) {}
+
+  inline int32 cols  () const { return m_image.cols  (); }
+  inline int32 rows  () const { return m_image.rows  (); }
+  inline int32 planes() const { return m_image.planes(); }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+
+  /// Evaluates a single pixel as a one pixel tile, which is slow.
+  inline result_type operator()( int32 x, int32 y, int32 p=0 ) const {
+    return prerasterize( BBox2i(x,y,1,1) )(x,y,p);
+  }
+
+  FuncT const& func() const { return m_func; }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+    Vector2i window = m_func.window_size();
+    BBox2i src_bbox( bbox.min() - window/2, bbox.max() + window - window/2 - Vector2i(1,1) );
+    ImageView<typename ImageT::pixel_type> src = edge_extend( m_image, src_bbox, m_edge );
+    ImageView<pixel_type> dst( bbox.width(), bbox.height() );
+    m_func( src, dst );
+    // Use the crop trick to fake that the tile is the same size as the entire image.
+    return crop( dst, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+  }
+
+  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+}; // End class WindowTileView
+
+
+
+//============================================================================
+
+
+
+/// For each pixel compute the standard deviation of the valid pixels in a neighborhood.
+/// - Windows with fewer than two valid pixels give zero.
 template <class ImageT, class EdgeT>
 class StdDevView : public ImageViewBase<StdDevView<ImageT,EdgeT> >
 {
@@ -42,8 +214,6 @@ private:
   ImageT   m_image;
   EdgeT    m_edge;     ///< Edge extension type
   Vector2i m_window_size;
-  int      m_half_width;
-  int      m_half_height;
 
 public:
   typedef typename ImageT::pixel_type pixel_type;  ///< The pixel type of the image view.
@@ -53,10 +223,7 @@ public:
 
   /// Constructor
   StdDevView( ImageT const& image, Vector2i window_size, EdgeT  const& edge = EdgeT() )
-    : m_image(image), m_edge(edge), m_window_size(window_size) {
-    m_half_width  = m_window_size[0]/2;
-    m_half_height = m_window_size[1]/2;
-  }
+    : m_image(image), m_edge(edge), m_window_size(window_size) {}
 
   inline int32 cols  () const { return m_image.cols  (); }
   inline int32 rows  () const { return m_image.rows  (); }
@@ -76,40 +243,43 @@ public:
   inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
 
     // Rasterize the input support region
-    BBox2i larger_bbox = bbox;
-    larger_bbox.expand(m_half_width);
-    ImageView<typename ImageT::pixel_type> src = crop(edge_extend(m_image, m_edge), larger_bbox);
-    const int col_off = m_half_width;
-    const int row_off = m_half_width;
+    Vector2i half = m_window_size/2;
+    BBox2i src_bbox( bbox.min() - half, bbox.max() + m_window_size - half - Vector2i(1,1) );
+    ImageView<typename ImageT::pixel_type> src = edge_extend(m_image, src_bbox, m_edge);
+
+    // Accumulate values relative to one of them to keep the sum of
+    // squares well conditioned.
+    double ref = 0;
+    bool found = false;
+    for (int r=0; r<src.rows() && !found; ++r)
+      for (int c=0; c<src.cols() && !found; ++c)
+        if (is_valid(src(c,r))) {
+          ref   = remove_mask(src(c,r));
+          found = true;
+        }
+
+    ImageView<Vector3> terms(src.cols(), src.rows()), sums;
+    for (int r=0; r<src.rows(); ++r)
+      for (int c=0; c<src.cols(); ++c)
+        if (is_valid(src(c,r))) {
+          double d = double(remove_mask(src(c,r))) - ref;
+          terms(c,r) = Vector3(d, d*d, 1);
+        } else
+          terms(c,r) = Vector3();
+    box_window_sum(terms, m_window_size, sums);
 
     ImageView<typename ImageT::pixel_type> dst(bbox.width(), bbox.height());
-    const size_t window_area = m_window_size[0]*m_window_size[1];
     for (int r=0; r<dst.rows(); ++r) {
-
-      // At the start of each row repopulate the sliding buffer from scratch.
-      StdDevSlidingFunctor stddev_functor(window_area);
-      for (int x=-m_half_width; x<=m_half_width; ++x) { // Iterate over columns, then rows.
-        for (int y=-m_half_height; y<=m_half_height; ++y) {
-          if (is_valid(src(0+x+col_off, r+y+row_off)))
-            stddev_functor.push(src(0+x+col_off, r+y+row_off));
-          else
-            stddev_functor.pop();
+      for (int c=0; c<dst.cols(); ++c) {
+        Vector3 const& s = sums(c,r);
+        if (s[2] < 2) {
+          dst(c,r) = 0;
+          continue;
         }
+        double mean = s[0]/s[2];
+        dst(c,r) = sqrt(std::max(s[1]/s[2] - mean*mean, 0.0));
       }
-      dst(0,r) = stddev_functor.get_std_dev();
-
-      // For successive pixels use sliding window optimizations
-      for (int c=1; c<dst.cols(); ++c) {
-        for (int y=-m_half_height; y<=m_half_height; ++y) {
-          if (is_valid(src(c+m_half_width+col_off, r+y+row_off)))
-            stddev_functor.push(src(c+m_half_width+col_off, r+y+row_off)); // Add pixels at leading edge of the window.
-          else
-            stddev_functor.pop();
-        }
-        dst(c,r) = stddev_functor.get_std_dev();
-      }
-
-    } // End loop through rows
+    }
 
     // Use the crop trick to fake that the support region is the same size as the entire image.
     return crop(dst, -bbox.min().x(), -bbox.min().y(), m_image.cols(), m_image.rows());
@@ -380,3 +380,115 @@ TEST( Algorithms, StdDevFilter ) {
   EXPECT_NEAR(1.945, output(2,4), eps);
   EXPECT_NEAR( 2.096, output(1,4), eps);
 }
+
+TEST( Algorithms, SlidingOrderStatistic ) {
+  SlidingOrderStatistic<int> median(0.5);
+  std::vector<int> values;
+  int32 seed = 3;
+  for (int32 i = 0; i < 200; ++i) {
+    seed = (seed*1103515245 + 12345) & 0x7fffffff;
+    values.push_back(seed % 50);
+    median.insert(values.back());
+    if (values.size() > 9) {
+      median.erase(values[values.size()-10]);
+      std::vector<int> window(values.end()-9, values.end());
+      std::sort(window.begin(), window.end());
+      EXPECT_EQ(window[4], median.value());
+    }
+  }
+}
+
+TEST( Algorithms, BoxWindowSum ) {
+  ImageView<double> terms(9,7);
+  for (int32 r = 0; r < terms.rows(); ++r)
+    for (int32 c = 0; c < terms.cols(); ++c)
+      terms(c,r) = (c*7 + r*3) % 5 - 1.5;
+
+  ImageView<double> sums;
+  box_window_sum(terms, Vector2i(4,3), sums);
+  ASSERT_EQ(6, sums.cols());
+  ASSERT_EQ(5, sums.rows());
+  for (int32 r = 0; r < sums.rows(); ++r)
+    for (int32 c = 0; c < sums.cols(); ++c) {
+      double expected = 0;
+      for (int32 j = 0; j < 3; ++j)
+        for (int32 i = 0; i < 4; ++i)
+          expected += terms(c+i, r+j);
+      EXPECT_NEAR(expected, sums(c,r), 1e-12);
+    }
+}
+
+namespace {
+  // Brute force distance to the nearest zero pixel, or to the ring
+  // of zeros around the image unless ignore_borders is set.
+  float brute_distance( ImageView<uint8> const& image, int32 x, int32 y, bool ignore_borders ) {
+    double best = ignore_borders ? double( image.cols() + image.rows() )
+                                 : std::min( std::min( x + 1, image.cols() - x ),
+                                             std::min( y + 1, image.rows() - y ) );
+    for ( int32 r = 0; r < image.rows(); ++r )
+      for ( int32 c = 0; c < image.cols(); ++c )
+        if ( image(c,r) == 0 )
+          best = std::min( best, sqrt( double( (c-x)*(c-x) + (r-y)*(r-y) ) ) );
+    return float( best );
+  }
+
+  ImageView<uint8> sparse_zeros( int32 cols, int32 rows, uint32 seed ) {
+    ImageView<uint8> image( cols, rows );
+    for ( int32 r = 0; r < rows; ++r )
+      for ( int32 c = 0; c < cols; ++c ) {
+        seed = seed * 1664525u + 1013904223u;
+        image(c,r) = ( seed >> 24 ) < 3 ? 0 : 255;
+      }
+    return image;
+  }
+}
+
+TEST( Algorithms, EuclideanDistanceTransform ) {
+  ImageView<uint8> image = sparse_zeros( 83, 61, 3 );
+  for ( int b = 0; b < 2; ++b ) {
+    bool ignore_borders = ( b == 1 );
+    ImageView<float> single = euclidean_distance_transform( image, ignore_borders, 1 );
+    ImageView<float> multi  = euclidean_distance_transform( image, ignore_borders, 4 );
+    for ( int32 r = 0; r < image.rows(); ++r )
+      for ( int32 c = 0; c < image.cols(); ++c ) {
+        EXPECT_NEAR( brute_distance( image, c, r, ignore_borders ), single(c,r), 1e-5 );
+        EXPECT_EQ( single(c,r), multi(c,r) );
+      }
+  }
+
+  // Matches grassfire where the nearest zero is straight across.
+  ImageView<uint8> im(5,5);
+  fill(crop(im,1,1,3,3), 255);
+  ImageView<float> d = euclidean_distance_transform( im );
+  EXPECT_EQ( 0, d(0,0) );
+  EXPECT_EQ( 1, d(1,1) );
+  EXPECT_EQ( 2, d(2,2) );
+
+  // With no zeros and no borders, every distance is cols + rows.
+  ImageView<uint8> full(4,3);
+  fill(full, 1);
+  EXPECT_EQ( 7, euclidean_distance_transform( full, true )(2,1) );
+}
+
+TEST( Algorithms, DistanceTransformView ) {
+  ImageView<uint8> image = sparse_zeros( 120, 90, 11 );
+  // A region with a single zero, where distances go past the limit.
+  fill( crop( image, 20, 10, 80, 70 ), 255 );
+  image(60,45) = 0;
+  for ( int b = 0; b < 2; ++b ) {
+    bool ignore_borders = ( b == 1 );
+    ImageView<float> exact = euclidean_distance_transform( image, ignore_borders );
+    // Small tiles, so that most distances cross tile borders.
+    ImageView<float> tiled( image.cols(), image.rows() );
+    BBox2i tile( 0, 0, 16, 16 );
+    for ( tile.min().y() = 0; tile.min().y() < image.rows(); tile.min().y() += 16 )
+      for ( tile.min().x() = 0; tile.min().x() < image.cols(); tile.min().x() += 16 ) {
+        BBox2i t( tile.min(), tile.min() + Vector2i( 16, 16 ) );
+        t.crop( bounding_box( image ) );
+        crop( tiled, t ) = crop( distance_transform_view( image, 20, ignore_borders ), t );
+      }
+    for ( int32 r = 0; r < image.rows(); ++r )
+      for ( int32 c = 0; c < image.cols(); ++c )
+        EXPECT_EQ( std::min( exact(c,r), 20.0f ), tiled(c,r) );
+  }
+}
@@ -19,6 +19,8 @@
 #include <gtest/gtest_VW.h>
 #include <vw/Image/AntiAliasing.h>
 
+#include <test/Helpers.h>
+
 using namespace vw;
 
 TEST( AntiAliasing, VerifySameOperation ) {
@@ -57,3 +59,114 @@ TEST( AntiAliasing, VerifySameOperation ) {
     }
   }
 }
+
+TEST( AntiAliasing, PolyphaseFilterBank ) {
+  // Reducing by three repeats one set of weights, and reducing by 2/3
+  // cycles through two.
+  PolyphaseFilterBank third( LanczosResampleFilter, 1.0/3, 0, 30 );
+  EXPECT_EQ( 1, third.num_phases() );
+  EXPECT_EQ( 18, third.taps() );
+  PolyphaseFilterBank two_thirds( CubicResampleFilter, 2.0/3, 5, 45 );
+  EXPECT_EQ( 2, two_thirds.num_phases() );
+  EXPECT_EQ( 40, two_thirds.size() );
+
+  for ( int32 i = 0; i < two_thirds.size(); i++ ) {
+    double sum = 0;
+    for ( int32 t = 0; t < two_thirds.taps(); t++ )
+      sum += two_thirds.weights( i )[t];
+    EXPECT_NEAR( 1.0, sum, 1e-6 );
+  }
+  EXPECT_EQ( two_thirds.first( 0 ), two_thirds.source_begin() );
+  EXPECT_EQ( two_thirds.first( 39 ) + two_thirds.taps(), two_thirds.source_end() );
+}
+
+TEST( AntiAliasing, PolyphaseAreaIsBoxAverage ) {
+  // Reducing by an integer factor with the area filter averages each
+  // block, as resample_aa does.
+  ImageView<float> input( 12, 9 );
+  for ( int32 y = 0; y < input.rows(); y++ )
+    for ( int32 x = 0; x < input.cols(); x++ )
+      input( x, y ) = float( ( x * 7 + y * 13 ) % 11 );
+
+  ImageView<float> output = polyphase_resample( input, 1.0/3, AreaResampleFilter );
+  ASSERT_EQ( 4, output.cols() );
+  ASSERT_EQ( 3, output.rows() );
+  for ( int32 y = 0; y < output.rows(); y++ )
+    for ( int32 x = 0; x < output.cols(); x++ ) {
+      double sum = 0;
+      for ( int32 j = 0; j < 3; j++ )
+        for ( int32 i = 0; i < 3; i++ )
+          sum += input( 3*x + i, 3*y + j );
+      EXPECT_NEAR( sum / 9, output( x, y ), 1e-4 );
+    }
+
+  // A uint8 image rounds the same averages.
+  ImageView<uint8> input8 = channel_cast<uint8>( input );
+  ImageView<uint8> output8 = polyphase_resample( input8, 1.0/3, AreaResampleFilter );
+  for ( int32 y = 0; y < output8.rows(); y++ )
+    for ( int32 x = 0; x < output8.cols(); x++ )
+      EXPECT_NEAR( output( x, y ), output8( x, y ), 0.5 + 1e-4 );
+}
+
+TEST( AntiAliasing, PolyphasePreservesConstant ) {
+  ImageView<PixelRGB<uint16> > input( 17, 23 );
+  fill( input, PixelRGB<uint16>( 1000, 20000, 65535 ) );
+  ResampleFilter filters[] = { AreaResampleFilter, CubicResampleFilter, LanczosResampleFilter };
+  for ( int f = 0; f < 3; f++ ) {
+    ImageView<PixelRGB<uint16> > output =
+      polyphase_resample( input, 0.4, 1.7, filters[f] );
+    EXPECT_EQ( 7, output.cols() );
+    EXPECT_EQ( 39, output.rows() );
+    for ( int32 y = 0; y < output.rows(); y++ )
+      for ( int32 x = 0; x < output.cols(); x++ )
+        EXPECT_PIXEL_EQ( input( 0, 0 ), output( x, y ) );
+  }
+}
+
+TEST( AntiAliasing, PolyphaseFlatMatchesGeneric ) {
+  // Float pixels take the flat path and doubles the generic one.
+  ImageView<PixelRGB<float> > input( 31, 26 );
+  for ( int32 y = 0; y < input.rows(); y++ )
+    for ( int32 x = 0; x < input.cols(); x++ )
+      input( x, y ) = PixelRGB<float>( float( x*y % 17 ), float( x ), float( ( x + 3*y ) % 5 ) );
+  ImageView<PixelRGB<double> > input_d = channel_cast<double>( input );
+
+  ImageView<PixelRGB<float> > flat = polyphase_resample( input, 0.45, 0.3, LanczosResampleFilter );
+  ImageView<PixelRGB<double> > generic = polyphase_resample( input_d, 0.45, 0.3, LanczosResampleFilter );
+  ASSERT_EQ( generic.cols(), flat.cols() );
+  ASSERT_EQ( generic.rows(), flat.rows() );
+  for ( int32 y = 0; y < flat.rows(); y++ )
+    for ( int32 x = 0; x < flat.cols(); x++ )
+      for ( int32 c = 0; c < 3; c++ )
+        EXPECT_NEAR( generic( x, y )[c], flat( x, y )[c], 1e-4 );
+
+  // Rasterizing a piece gives the same pixels as the whole.
+  ImageView<PixelRGB<float> > piece = crop( polyphase_resample( input, 0.45, 0.3, LanczosResampleFilter ),
+                                            BBox2i( 3, 2, 6, 4 ) );
+  for ( int32 y = 0; y < piece.rows(); y++ )
+    for ( int32 x = 0; x < piece.cols(); x++ )
+      EXPECT_PIXEL_NEAR( flat( x + 3, y + 2 ), piece( x, y ), 1e-5 );
+}
+
+TEST( AntiAliasing, PolyphaseMasked ) {
+  typedef PixelMask<float> PT;
+  ImageView<PT> input( 8, 8 );
+  for ( int32 y = 0; y < 8; y++ )
+    for ( int32 x = 0; x < 8; x++ )
+      input( x, y ) = PT( 5 );
+  // One invalid pixel in a block of four is left out of its average,
+  // and a block with all four invalid stays invalid.
+  input( 0, 0 ).invalidate();
+  input( 0, 0 ).child() = 1000;
+  input( 4, 4 ).invalidate();
+  input( 5, 4 ).invalidate();
+  input( 4, 5 ).invalidate();
+  input( 5, 5 ).invalidate();
+
+  ImageView<PT> output = polyphase_resample( input, 0.5, AreaResampleFilter );
+  ASSERT_EQ( 4, output.cols() );
+  EXPECT_TRUE( is_valid( output( 0, 0 ) ) );
+  EXPECT_NEAR( 5, output( 0, 0 ).child(), 1e-5 );
+  EXPECT_FALSE( is_valid( output( 2, 2 ) ) );
+  EXPECT_TRUE( is_valid( output( 3, 3 ) ) );
+}
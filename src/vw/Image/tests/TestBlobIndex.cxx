@@ -123,3 +123,71 @@ TEST( BlobIndex, BlobSizesView ) {
 
 
 
+
+namespace {
+  // Reference 8-connected labeling by flood fill, in raster order.
+  uint32 flood_labels( ImageView<PixelMask<uint8> > const& mask, ImageView<uint32>& labels ) {
+    labels.set_size( mask.cols(), mask.rows() );
+    fill( labels, 0 );
+    uint32 count = 0;
+    std::vector<Vector2i> stack;
+    for ( int32 r = 0; r < mask.rows(); r++ )
+      for ( int32 c = 0; c < mask.cols(); c++ ) {
+        if ( !is_valid( mask(c,r) ) || labels(c,r) )
+          continue;
+        labels(c,r) = ++count;
+        stack.push_back( Vector2i(c,r) );
+        while ( !stack.empty() ) {
+          Vector2i p = stack.back();
+          stack.pop_back();
+          for ( int32 dy = -1; dy <= 1; dy++ )
+            for ( int32 dx = -1; dx <= 1; dx++ ) {
+              int32 x = p[0] + dx, y = p[1] + dy;
+              if ( x < 0 || y < 0 || x >= mask.cols() || y >= mask.rows() ||
+                   !is_valid( mask(x,y) ) || labels(x,y) )
+                continue;
+              labels(x,y) = count;
+              stack.push_back( Vector2i(x,y) );
+            }
+        }
+      }
+    return count;
+  }
+}
+
+TEST( BlobIndex, LabelBlobs ) {
+  // A random mask with long diagonal streaks that cross many tiles.
+  ImageView<PixelMask<uint8> > mask( 157, 93 );
+  uint32 state = 17;
+  for ( int32 r = 0; r < mask.rows(); r++ )
+    for ( int32 c = 0; c < mask.cols(); c++ ) {
+      state = state * 1664525u + 1013904223u;
+      if ( ( state >> 24 ) < 100 || ( c + r ) % 23 == 0 || ( c - 2*r ) % 41 == 0 )
+        mask(c,r) = PixelMask<uint8>( 1 );
+    }
+
+  ImageView<uint32> expected;
+  uint32 expected_count = flood_labels( mask, expected );
+  ASSERT_GT( expected_count, 10u );
+
+  int32 tile_sizes[4] = { 1, 7, 32, 1000 };
+  for ( int t = 0; t < 4; t++ ) {
+    for ( int32 threads = 1; threads <= 4; threads += 3 ) {
+      ImageView<uint32> labels;
+      EXPECT_EQ( expected_count, label_blobs( mask, labels, tile_sizes[t], threads ) );
+
+      // The labels must be a renaming of the expected ones.
+      std::vector<uint32> forward( expected_count + 1, 0 ), backward( expected_count + 1, 0 );
+      for ( int32 r = 0; r < mask.rows(); r++ )
+        for ( int32 c = 0; c < mask.cols(); c++ ) {
+          uint32 e = expected(c,r), l = labels(c,r);
+          ASSERT_EQ( e == 0, l == 0 );
+          ASSERT_LE( l, expected_count );
+          if ( !forward[e] ) forward[e] = l;
+          if ( !backward[l] ) backward[l] = e;
+          EXPECT_EQ( forward[e], l );
+          EXPECT_EQ( backward[l], e );
+        }
+    }
+  }
+}
@@ -0,0 +1,153 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <vw/Image/BlockPrefetcher.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Core/Thread.h>
+
+#include <atomic>
+#include <set>
+
+using namespace vw;
+
+TEST(BlockPrefetcher, Traversal) {
+  std::vector<Vector2i> rows = BlockPrefetcher::traversal(BlockPrefetcher::RowMajor, Vector2i(3,2));
+  ASSERT_EQ(6u, rows.size());
+  EXPECT_VECTOR_EQ(Vector2i(0,0), rows[0]);
+  EXPECT_VECTOR_EQ(Vector2i(2,0), rows[2]);
+  EXPECT_VECTOR_EQ(Vector2i(0,1), rows[3]);
+
+  // On a square power of two grid, the Hilbert curve visits every block
+  // once and each step moves to a neighbor.
+  std::vector<Vector2i> curve = BlockPrefetcher::traversal(BlockPrefetcher::Hilbert, Vector2i(4,4));
+  ASSERT_EQ(16u, curve.size());
+  std::set<std::pair<int,int> > seen;
+  for (size_t i = 0; i < curve.size(); ++i) {
+    seen.insert(std::make_pair(curve[i].x(), curve[i].y()));
+    if (i > 0) {
+      EXPECT_EQ(1, abs(curve[i].x()-curve[i-1].x()) + abs(curve[i].y()-curve[i-1].y()));
+    }
+  }
+  EXPECT_EQ(16u, seen.size());
+
+  // Other grids keep the part of the curve inside them.
+  curve = BlockPrefetcher::traversal(BlockPrefetcher::Hilbert, Vector2i(3,5));
+  ASSERT_EQ(15u, curve.size());
+  seen.clear();
+  for (size_t i = 0; i < curve.size(); ++i) {
+    EXPECT_LT(curve[i].x(), 3);
+    EXPECT_LT(curve[i].y(), 5);
+    seen.insert(std::make_pair(curve[i].x(), curve[i].y()));
+  }
+  EXPECT_EQ(15u, seen.size());
+
+  // Z-order visits aligned 2x2 groups in turn.
+  std::vector<Vector2i> z = BlockPrefetcher::traversal(BlockPrefetcher::ZOrder, Vector2i(4,3));
+  ASSERT_EQ(12u, z.size());
+  EXPECT_VECTOR_EQ(Vector2i(0,0), z[0]);
+  EXPECT_VECTOR_EQ(Vector2i(1,0), z[1]);
+  EXPECT_VECTOR_EQ(Vector2i(0,1), z[2]);
+  EXPECT_VECTOR_EQ(Vector2i(1,1), z[3]);
+  EXPECT_VECTOR_EQ(Vector2i(2,0), z[4]);
+  EXPECT_VECTOR_EQ(Vector2i(0,2), z[8]);
+  EXPECT_VECTOR_EQ(Vector2i(3,2), z[11]);
+
+  // Regions list the blocks under them once, in the order first touched.
+  std::vector<BBox2i> regions;
+  regions.push_back(BBox2i(20,0,10,10));
+  regions.push_back(BBox2i(0,0,40,10));
+  regions.push_back(BBox2i(60,60,100,100));
+  std::vector<Vector2i> blocks = BlockPrefetcher::traversal(regions, Vector2i(16,16), Vector2i(4,4));
+  ASSERT_EQ(4u, blocks.size());
+  EXPECT_VECTOR_EQ(Vector2i(1,0), blocks[0]);
+  EXPECT_VECTOR_EQ(Vector2i(0,0), blocks[1]);
+  EXPECT_VECTOR_EQ(Vector2i(2,0), blocks[2]);
+  EXPECT_VECTOR_EQ(Vector2i(3,3), blocks[3]);
+}
+
+TEST(BlockPrefetcher, BlockOrder) {
+  EXPECT_TRUE(BlockOrder().is_row_major());
+  EXPECT_FALSE(BlockOrder(BlockPrefetcher::Hilbert).is_row_major());
+
+  // Built-in orders are laid over the span.
+  std::vector<Vector2i> blocks = BlockOrder(BlockPrefetcher::ZOrder).blocks(BBox2i(2,3,2,2));
+  ASSERT_EQ(4u, blocks.size());
+  EXPECT_VECTOR_EQ(Vector2i(2,3), blocks[0]);
+  EXPECT_VECTOR_EQ(Vector2i(2,4), blocks[2]);
+
+  // Custom orders keep the listed blocks inside the span, then add the
+  // rest row-major.
+  std::vector<Vector2i> custom;
+  custom.push_back(Vector2i(1,1));
+  custom.push_back(Vector2i(9,9));
+  custom.push_back(Vector2i(0,1));
+  custom.push_back(Vector2i(1,1));
+  blocks = BlockOrder(custom).blocks(BBox2i(0,0,2,2));
+  ASSERT_EQ(4u, blocks.size());
+  EXPECT_VECTOR_EQ(Vector2i(1,1), blocks[0]);
+  EXPECT_VECTOR_EQ(Vector2i(0,1), blocks[1]);
+  EXPECT_VECTOR_EQ(Vector2i(0,0), blocks[2]);
+  EXPECT_VECTOR_EQ(Vector2i(1,0), blocks[3]);
+}
+
+/// Counts the pixels it computes, from any thread.
+struct CountPixels : ReturnFixedType<uint32> {
+  boost::shared_ptr<std::atomic<int> > count;
+  CountPixels() : count(new std::atomic<int>(0)) {}
+  uint32 operator()(uint32 value) const {
+    ++*count;
+    return value;
+  }
+};
+
+TEST(BlockPrefetcher, Lookahead) {
+  ImageView<uint32> image(64,64);
+  for (int r = 0; r < image.rows(); ++r)
+    for (int c = 0; c < image.cols(); ++c)
+      image(c,r) = c + 64*r;
+
+  CountPixels counter;
+  Cache cache(4*64*64*sizeof(uint32));
+  typedef UnaryPerPixelView<ImageView<uint32>, CountPixels> CountView;
+  BlockRasterizeView<CountView> blocks = block_cache(per_pixel_view(image, counter), Vector2i(16,16), 2, cache);
+
+  blocks.prefetch(BlockPrefetcher::RowMajor, 2, 3);
+  ASSERT_TRUE(blocks.prefetcher().get());
+  EXPECT_EQ(3u, blocks.prefetcher()->lookahead());
+
+  // Nothing has been rasterized yet, so only the first three blocks are read.
+  for (int i = 0; i < 5000 && blocks.prefetcher()->num_fetched() < 3; ++i)
+    Thread::sleep_ms(1);
+  Thread::sleep_ms(10);
+  EXPECT_EQ(3u, blocks.prefetcher()->num_fetched());
+  EXPECT_EQ(3*16*16, int(*counter.count));
+
+  ImageView<uint32> result = blocks;
+  EXPECT_RANGE_EQ(image.begin(), image.end(), result.begin(), result.end());
+  EXPECT_GE(int(*counter.count), 64*64);
+  EXPECT_LE(blocks.prefetcher()->num_fetched() + blocks.prefetcher()->num_skipped(), 16u);
+
+  blocks.stop_prefetch();
+  EXPECT_FALSE(blocks.prefetcher().get());
+
+  // A view without a cache has nothing to prefetch into.
+  BlockRasterizeView<ImageView<uint32> > uncached = block_rasterize(image, Vector2i(16,16), 1);
+  EXPECT_THROW(uncached.prefetch(BlockPrefetcher::Hilbert), LogicErr);
+}
@@ -19,6 +19,8 @@
 #include <test/Helpers.h>
 #include <vw/Image/BlockRasterize.h>
 #include <vw/Image/BlockImageOperator.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/ImageViewRef.h>
 
 using namespace vw;
 using namespace std;
@@ -46,6 +48,119 @@ TEST(BlockRasterize, Basic) {
   EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
 }
 
+TEST(BlockRasterize, SpillFile) {
+  typedef ImageView<PixelRGB<float> > Image;
+  Image img1(64,64), img2;
+  for (int r=0; r<img1.rows(); ++r)
+    for (int c=0; c<img1.cols(); ++c)
+      img1(c,r) = PixelRGB<float>(c, r, c*r);
+
+  // Room for two 16x16 blocks, so most of them are evicted on each pass.
+  Cache cache(2*16*16*sizeof(PixelRGB<float>));
+  boost::shared_ptr<CacheSpillFile> spill(new CacheSpillFile(1024*1024));
+  cache.set_spill_file(spill);
+  BlockRasterizeView<Image> blocks = block_cache(img1, Vector2i(16,16), 1, cache);
+
+  img2 = blocks;
+  EXPECT_EQ(0u, cache.spill_hits());
+  img2 = blocks;
+  EXPECT_EQ(16u, cache.spill_hits());
+  EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
+}
+
+/// Cancels the token the first time any pixel is computed.
+struct CancelOnFirstPixel : ReturnFixedType<uint32> {
+  boost::shared_ptr<CancelToken> token;
+  boost::shared_ptr<int>         count;
+  CancelOnFirstPixel(boost::shared_ptr<CancelToken> const& token)
+    : token(token), count(new int(0)) {}
+  uint32 operator()(uint32 value) const {
+    ++*count;
+    token->cancel();
+    return value;
+  }
+};
+
+TEST(BlockRasterize, Cancel) {
+  ImageView<uint32> img1(8,8), img2(8,8);
+  boost::shared_ptr<CancelToken> token(new CancelToken);
+  CancelOnFirstPixel func(token);
+
+  // The first one-pixel block cancels the token, so no other block is started.
+  EXPECT_THROW(img2 = block_rasterize(per_pixel_view(img1, func), Vector2i(1,1), 1, token), Aborted);
+  EXPECT_EQ(1, *func.count);
+
+  // An untouched token changes nothing.
+  boost::shared_ptr<CancelToken> token2(new CancelToken);
+  img2 = block_rasterize(img1, Vector2i(2,2), 4, token2);
+  EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
+}
+
+/// Records the position of every pixel it computes, in order.
+struct RecordPixels : ReturnFixedType<uint32> {
+  boost::shared_ptr<std::vector<uint32> > seen;
+  RecordPixels() : seen(new std::vector<uint32>) {}
+  uint32 operator()(uint32 value) const {
+    seen->push_back(value);
+    return value;
+  }
+};
+
+TEST(BlockRasterize, BlockOrder) {
+  ImageView<uint32> img1(10,6), img2;
+  for (int r=0; r<img1.rows(); ++r)
+    for (int c=0; c<img1.cols(); ++c)
+      img1(c,r) = r*img1.cols() + c;
+
+  // Single-threaded, the 4x3 blocks are visited along the Hilbert curve.
+  RecordPixels func;
+  BlockRasterizeView<UnaryPerPixelView<ImageView<uint32>,RecordPixels> > view
+    = block_rasterize(per_pixel_view(img1, func), Vector2i(4,3), 1, BlockOrder(BlockPrefetcher::Hilbert));
+  img2 = view;
+  EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
+  ASSERT_EQ(60u, func.seen->size());
+  EXPECT_EQ(0u,  (*func.seen)[0]);  // Block (0,0)
+  EXPECT_EQ(4u,  (*func.seen)[12]); // Block (1,0)
+  EXPECT_EQ(34u, (*func.seen)[24]); // Block (1,1)
+  EXPECT_EQ(30u, (*func.seen)[36]); // Block (0,1)
+  EXPECT_EQ(38u, (*func.seen)[48]); // Block (2,1), two columns wide
+  EXPECT_EQ(8u,  (*func.seen)[54]); // Block (2,0)
+
+  // A sub-region uses the order's block indices of the whole image.
+  func.seen->clear();
+  std::vector<Vector2i> custom;
+  custom.push_back(Vector2i(2,1));
+  view.set_block_order(BlockOrder(custom));
+  ImageView<uint32> part(8,6);
+  view.rasterize(part, BBox2i(2,0,8,6));
+  EXPECT_EQ(38u, (*func.seen)[0]);  // Block (2,1)
+  EXPECT_EQ(2u,  (*func.seen)[6]);  // Then (0,0), from column 2
+  EXPECT_EQ(crop(img1, 2, 0, 8, 6)(3,4), part(3,4));
+}
+
+TEST(BlockRasterize, Share) {
+  ImageView<uint32> img1(10,6), img2;
+  for (int r=0; r<img1.rows(); ++r)
+    for (int c=0; c<img1.cols(); ++c)
+      img1(c,r) = r*img1.cols() + c;
+
+  // Two consumers reading overlapping regions of a shared view compute
+  // each pixel once between them.
+  Cache cache(1024*1024);
+  RecordPixels func;
+  BlockRasterizeView<UnaryPerPixelView<ImageView<uint32>,RecordPixels> > shared
+    = share(per_pixel_view(img1, func), Vector2i(4,4), cache);
+  ImageViewRef<uint32> first = shared, second = crop(shared, 3, 1, 7, 5);
+  img2 = first;
+  EXPECT_RANGE_EQ(img1.begin(), img1.end(), img2.begin(), img2.end());
+  EXPECT_EQ(60u, func.seen->size());
+
+  ImageView<uint32> part = second;
+  EXPECT_EQ(60u, func.seen->size());
+  EXPECT_EQ(img1(5,3), part(2,2));
+  EXPECT_TRUE(sparse_check(shared, BBox2i(8,4,4,4)));
+}
+
 /// Count the number of pixels above a threshold on a per-block basis.
 class ImageBlockThresholdFunctor {
   
@@ -114,3 +229,44 @@ TEST(BlockImageOperator, Basic) {
   result = threshold_functor.get_count();
   EXPECT_EQ(real_count, result);
 }
+
+/// Histogram of the values of the blocks one thread sees, with no locking.
+class ImageBlockHistogramFunctor {
+public:
+  std::vector<size_t> counts;
+  size_t num_blocks;
+
+  ImageBlockHistogramFunctor() : counts(256, 0), num_blocks(0) {}
+
+  template <class T>
+  void operator()(ImageView<T> const& image, BBox2i const& /*bbox*/) {
+    for (int r=0; r<image.rows(); ++r)
+      for (int c=0; c<image.cols(); ++c)
+        ++counts[image(c,r)];
+    ++num_blocks;
+  }
+
+  void merge(ImageBlockHistogramFunctor const& other) {
+    for (size_t i=0; i<counts.size(); ++i)
+      counts[i] += other.counts[i];
+    num_blocks += other.num_blocks;
+  }
+};
+
+TEST(BlockImageOperator, Reduce) {
+  ImageView<uint8> image(100,90);
+  std::vector<size_t> expected(256, 0);
+  for (int j=0; j<90; ++j)
+    for (int i=0; i<100; ++i) {
+      image(i,j) = uint8((i*7 + j*13) % 256);
+      ++expected[image(i,j)];
+    }
+
+  for (int threads=1; threads<=8; threads*=2) {
+    ImageBlockHistogramFunctor histogram;
+    block_reduce(image, histogram, Vector2i(16,16), threads);
+    EXPECT_EQ(42u, histogram.num_blocks); // 7 x 6 blocks
+    for (size_t i=0; i<expected.size(); ++i)
+      EXPECT_EQ(expected[i], histogram.counts[i]) << i;
+  }
+}
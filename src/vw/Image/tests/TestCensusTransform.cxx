@@ -19,6 +19,7 @@
 // TestCensusTransform.h
 #include <gtest/gtest_VW.h>
 #include <vw/Image/CensusTransform.h>
+#include <vw/Image/BlockRasterize.h>
 
 using namespace vw;
 
@@ -59,3 +60,76 @@ TEST( HammingDist, Tests) {
 
 
 
+
+TEST( CensusTransform, DescriptorImage ) {
+  ImageView<uint8> src(23,17);
+  for (int r=0; r<src.rows(); ++r)
+    for (int c=0; c<src.cols(); ++c)
+      src(c,r) = uint8((c*37 + r*101 + (c*r)%13) % 29);
+
+  for (int kernel_size=3; kernel_size<=9; kernel_size+=2) {
+    const int h = kernel_size / 2;
+    ImageView<uint64> binary  = census_descriptor_image(src, kernel_size);
+    ImageView<uint64> ternary = census_descriptor_image(src, kernel_size, true, 3);
+    ASSERT_EQ(src.cols()-2*h, binary.cols());
+    ASSERT_EQ(src.rows()-2*h, ternary.rows());
+    for (int r=0; r<binary.rows(); ++r) {
+      for (int c=0; c<binary.cols(); ++c) {
+        uint64 expected_binary=0, expected_ternary=0;
+        switch (kernel_size) {
+          case 3: expected_binary  = get_census_value_3x3        (src, c+h, r+h);
+                  expected_ternary = get_census_value_ternary_3x3(src, c+h, r+h, 3); break;
+          case 5: expected_binary  = get_census_value_5x5        (src, c+h, r+h);
+                  expected_ternary = get_census_value_ternary_5x5(src, c+h, r+h, 3); break;
+          case 7: expected_binary  = get_census_value_7x7        (src, c+h, r+h);
+                  expected_ternary = get_census_value_ternary_7x7(src, c+h, r+h, 3); break;
+          case 9: expected_binary  = get_census_value_9x9        (src, c+h, r+h);
+                  expected_ternary = get_census_value_ternary_9x9(src, c+h, r+h, 3); break;
+        };
+        EXPECT_EQ(expected_binary,  binary (c,r)) << kernel_size << ": " << c << ", " << r;
+        EXPECT_EQ(expected_ternary, ternary(c,r)) << kernel_size << ": " << c << ", " << r;
+      }
+    }
+  }
+}
+
+TEST( CensusTransform, CensusImageView ) {
+  ImageView<uint8> src(23,17);
+  for (int r=0; r<src.rows(); ++r)
+    for (int c=0; c<src.cols(); ++c)
+      src(c,r) = uint8((c*41 + r*97 + (c*r)%11) % 31);
+
+  for (int kernel_size=3; kernel_size<=9; kernel_size+=2) {
+    const int h = kernel_size / 2;
+    // The descriptors of the whole edge extended image, computed in one piece.
+    ImageView<uint8>  padded   = crop(edge_extend(src, ConstantEdgeExtension()),
+                                      -h, -h, src.cols()+2*h, src.rows()+2*h);
+    ImageView<uint64> expected = census_descriptor_image(padded, kernel_size, true, 3);
+
+    // Rasterized in small tiles.
+    ImageView<uint64> tiled = block_rasterize(census_image(src, kernel_size, true, 3),
+                                              Vector2i(8,8), 1);
+    ASSERT_EQ(src.cols(), tiled.cols());
+    ASSERT_EQ(src.rows(), tiled.rows());
+    for (int r=0; r<src.rows(); ++r)
+      for (int c=0; c<src.cols(); ++c)
+        EXPECT_EQ(expected(c,r), tiled(c,r)) << kernel_size << ": " << c << ", " << r;
+    EXPECT_EQ(expected(5,4), census_image(src, kernel_size, true, 3)(5,4));
+  }
+}
+
+TEST( HammingDist, Batch ) {
+  std::vector<uint64> right(21);
+  for (size_t i=0; i<right.size(); ++i)
+    right[i] = (uint64(0x9E3779B97F4A7C15ULL) * (i+1)) ^ (uint64(i) << 40);
+  const uint64 left = 0x00F0F0F0A5A5FFFFULL;
+
+  // Every count, so that the partial vector at the end is covered.
+  for (int count=0; count<=int(right.size()); ++count) {
+    std::vector<uint8> costs(count+1, 255);
+    census_hamming_distances(left, &right[0], count, &costs[0]);
+    for (int i=0; i<count; ++i)
+      EXPECT_EQ(hamming_distance(left, right[i]), size_t(costs[i]));
+    EXPECT_EQ(255, costs[count]);
+  }
+}
@@ -25,6 +25,7 @@
 #include <vw/Image/PixelAccessors.h>    // for ProceduralPixelAccessor
 #include <vw/Image/EdgeExtension.h>     // for EdgeExtensionView, etc
 #include <vw/Image/ImageView.h>         // for ImageView
+#include <vw/Image/Manipulation.h>      // for crop
 
 #include <algorithm>                    // for min, max
 #include <new>                          // for operator new[]
@@ -426,6 +427,44 @@ TEST( EdgeExtension, Linear ) {
   EXPECT_BBOX( ee.source_bbox(im,BBox2i(2,3,2,2)), 0,1,2,2 );
 }
 
+template <class ExtensionT>
+static void check_rasterize( ImageView<float> const& im, ExtensionT const& ext ) {
+  // Interior, straddling one or more edges, larger than the image,
+  // and entirely outside it.
+  BBox2i boxes[] = { BBox2i(1,1,3,2), BBox2i(-2,1,4,3), BBox2i(3,-1,4,2),
+                     BBox2i(-3,-2,11,9), BBox2i(-6,-5,3,2), BBox2i(2,4,5,4) };
+  EdgeExtensionView<ImageView<float>,ExtensionT> view = edge_extend(im, ext);
+  for( size_t k = 0; k < sizeof(boxes)/sizeof(boxes[0]); ++k ) {
+    BBox2i const& bbox = boxes[k];
+    ImageView<float> dest( bbox.width(), bbox.height() );
+    view.rasterize( dest, bbox );
+    for( int32 j = 0; j < bbox.height(); ++j )
+      for( int32 i = 0; i < bbox.width(); ++i )
+        EXPECT_EQ( view(bbox.min().x()+i, bbox.min().y()+j), dest(i,j) ) << bbox << " at " << i << "," << j;
+  }
+}
+
+TEST( EdgeExtension, Rasterize ) {
+  ImageView<float> im(5,4);
+  for( int32 j = 0; j < im.rows(); ++j )
+    for( int32 i = 0; i < im.cols(); ++i )
+      im(i,j) = float(10*j + i);
+
+  check_rasterize( im, ZeroEdgeExtension() );
+  check_rasterize( im, ConstantEdgeExtension() );
+  check_rasterize( im, PeriodicEdgeExtension() );
+  check_rasterize( im, ReflectEdgeExtension() );
+  check_rasterize( im, LinearEdgeExtension() );
+
+  // An offset view rasterized into a crop of a larger buffer.
+  ImageView<float> buf(9,8);
+  EdgeExtensionView<ImageView<float>,ConstantEdgeExtension> shifted = edge_extend(im, -2, -2, 9, 8);
+  shifted.rasterize( crop(buf, 1, 1, 7, 6), BBox2i(1,1,7,6) );
+  for( int32 j = 0; j < 6; ++j )
+    for( int32 i = 0; i < 7; ++i )
+      EXPECT_EQ( shifted(i+1,j+1), buf(i+1,j+1) );
+}
+
 template <class PixelT>
 class FloatingView : public ImageViewBase<FloatingView<PixelT> > {
   int32 m_cols, m_rows, m_planes;
@@ -101,3 +101,29 @@ TEST(ErodeView, larger_test) {
 }
 
 
+
+TEST(ErodeView, RasterizeRuns) {
+  // Many small blobs, some touching the edges of the image.
+  ImageView<PixelMask<uint8> > test(61,47), blobs(61,47);
+  for ( int32 r = 0; r < test.rows(); ++r )
+    for ( int32 c = 0; c < test.cols(); ++c ) {
+      test(c,r) = PixelMask<uint8>( uint8(c + 3*r) );
+      if ( (c*7 + r*13) % 11 < 2 || (c % 9 == 0 && r % 4 != 1) )
+        blobs(c,r) = PixelMask<uint8>(1);
+    }
+  BlobIndexThreaded bindex( blobs, 1000, 100 );
+  EXPECT_LT( 10u, bindex.num_blobs() );
+
+  ErodeView<ImageView<PixelMask<uint8> > > eroded( test, bindex );
+  ImageView<PixelMask<uint8> > full = eroded;
+  for ( int32 r = 0; r < test.rows(); ++r )
+    for ( int32 c = 0; c < test.cols(); ++c )
+      ASSERT_EQ( eroded(c,r), full(c,r) ) << c << "," << r;
+
+  // A region which starts and ends inside blob segments.
+  BBox2i bbox( 4, 5, 30, 20 );
+  ImageView<PixelMask<uint8> > part = crop( eroded, bbox );
+  for ( int32 r = 0; r < bbox.height(); ++r )
+    for ( int32 c = 0; c < bbox.width(); ++c )
+      ASSERT_EQ( eroded(c + bbox.min().x(), r + bbox.min().y()), part(c,r) ) << c << "," << r;
+}
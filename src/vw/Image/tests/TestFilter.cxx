@@ -22,6 +22,9 @@
 #include <vw/Image/Filter.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PixelTypes.h>
+#include <vw/Image/UtilityViews.h>
+
+#include <test/Helpers.h>
 
 #include <vector>
 
@@ -280,3 +283,137 @@ TEST( Filter, SepConv22Box ) {
     EXPECT_EQ( dst(1,1), 1 );
   }
 }
+
+// The row based path for flat pixel types must match the accessor path.
+template <class PixelT>
+static void check_flat_convolution( std::vector<float> const& kx, std::vector<float> const& ky ) {
+  typedef typename PixelChannelType<PixelT>::type ChannelT;
+  ImageView<PixelT> src( 37, 23 );
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      for ( int32 ch = 0; ch < int32(PixelNumChannels<PixelT>::value); ++ch )
+        compound_select_channel<ChannelT&>( src(c,r), ch ) = ChannelT( (7*c + 3*r + 50*ch) % 256 );
+
+  SeparableConvolutionView<ImageView<PixelT>,float,ConstantEdgeExtension> view( src, kx, ky );
+  ImageView<PixelT> fast = view;
+
+  // Odd kernels are centered, so the support is symmetric.
+  int32 hx = int32(kx.size()) / 2, hy = int32(ky.size()) / 2;
+  ImageView<PixelT> src_buf = edge_extend( src, BBox2i( -hx, -hy, src.cols() + 2*hx, src.rows() + 2*hy ),
+                                           ConstantEdgeExtension() );
+  ImageView<PixelT> slow( src.cols(), src.rows() );
+  view.convolve_2d( src_buf, slow, boost::mpl::false_() );
+  EXPECT_SEQ_EQ( slow, fast );
+
+  // Windows rasterized into a non-ImageView destination.
+  BBox2i window( 5, 3, 17, 11 );
+  ImageView<PixelT> cropped = crop( view, window );
+  ImageView<PixelT> expected = crop( slow, window );
+  EXPECT_SEQ_EQ( expected, cropped );
+}
+
+TEST( Filter, SepConvFlatPixels ) {
+  std::vector<float> gauss, deriv, none;
+  generate_gaussian_kernel( gauss, 1.2, 7 );
+  generate_derivative_kernel( deriv, 1, 3 );
+  for ( int i = 0; i < 3; ++i ) {
+    std::vector<float> const& kx = i == 2 ? none : gauss;
+    std::vector<float> const& ky = i == 1 ? none : deriv;
+    check_flat_convolution<uint8            >( kx, ky );
+    check_flat_convolution<PixelGray<uint16> >( kx, ky );
+    check_flat_convolution<PixelGray<float> >( kx, ky );
+    check_flat_convolution<PixelRGB<uint8>  >( kx, ky );
+    check_flat_convolution<PixelRGBA<float> >( kx, ky );
+  }
+}
+
+// The FFT path must match the direct one, for whole images and for
+// windows, which are blocks of their own.
+template <class PixelT>
+static void check_fft_convolution() {
+  typedef typename PixelChannelType<PixelT>::type ChannelT;
+  ImageView<PixelT> src( 61, 43 );
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      for ( int32 ch = 0; ch < int32(PixelNumChannels<PixelT>::value); ++ch )
+        compound_select_channel<ChannelT&>( src(c,r), ch ) = ChannelT( (7*c + 3*r*r + 50*ch) % 97 );
+  BBox2i window( 5, 3, 37, 29 );
+
+  ImageView<float> kernel( 13, 9 );
+  for ( int32 r = 0; r < kernel.rows(); ++r )
+    for ( int32 c = 0; c < kernel.cols(); ++c )
+      kernel(c,r) = float( (c*5 + r*3) % 7 ) / 100.0f;
+  ConvolutionView<ImageView<PixelT>,ImageView<float>,ConstantEdgeExtension> view( src, kernel, 4, 6 );
+  view.set_method( DirectConvolution );
+  ImageView<PixelT> direct = view, direct_window = crop( view, window );
+  view.set_method( FFTConvolution );
+  ImageView<PixelT> fft = view, fft_window = crop( view, window );
+  EXPECT_SEQ_NEAR( direct, fft, 1e-3 );
+  EXPECT_SEQ_NEAR( direct_window, fft_window, 1e-3 );
+
+  std::vector<float> kx, ky;
+  generate_gaussian_kernel( kx, 4.0, 25 );
+  generate_derivative_kernel( ky, 1, 5 );
+  SeparableConvolutionView<ImageView<PixelT>,float,ZeroEdgeExtension> sep( src, kx, ky );
+  sep.set_method( DirectConvolution );
+  direct = sep; direct_window = crop( sep, window );
+  sep.set_method( FFTConvolution );
+  fft = sep; fft_window = crop( sep, window );
+  EXPECT_SEQ_NEAR( direct, fft, 1e-3 );
+  EXPECT_SEQ_NEAR( direct_window, fft_window, 1e-3 );
+}
+
+TEST( Filter, FFTConvolution ) {
+  check_fft_convolution<float>();
+  check_fft_convolution<double>();
+  check_fft_convolution<PixelRGB<float> >();
+  check_fft_convolution<PixelGrayA<double> >();
+}
+
+// AutoConvolution decides on the kernel alone, so a small window of a
+// large kernel is transformed just like the whole image.
+TEST( Filter, AutoConvolutionIgnoresTiling ) {
+  EXPECT_FALSE( detail::fft_convolution_pays_2d( 9, 9 ) );
+  EXPECT_TRUE ( detail::fft_convolution_pays_2d( 11, 11 ) );
+  EXPECT_FALSE( detail::fft_convolution_pays_1d( 25 ) );
+  EXPECT_TRUE ( detail::fft_convolution_pays_1d( 41 ) );
+
+  ImageView<float> src( 61, 43 );
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      src(c,r) = float( (7*c + 3*r*r) % 97 );
+  ImageView<float> kernel( 15, 15 );
+  for ( int32 r = 0; r < kernel.rows(); ++r )
+    for ( int32 c = 0; c < kernel.cols(); ++c )
+      kernel(c,r) = float( (c*5 + r*3) % 7 ) / 100.0f;
+  BBox2i window( 20, 10, 3, 3 );
+
+  ConvolutionView<ImageView<float>,ImageView<float>,ConstantEdgeExtension> view( src, kernel );
+  ImageView<float> auto_window = crop( view, window );
+  view.set_method( FFTConvolution );
+  ImageView<float> fft_window = crop( view, window );
+  EXPECT_SEQ_NEAR( fft_window, auto_window, 0 );
+}
+
+TEST( Filter, RecursiveGaussian ) {
+  ImageView<float> src( 120, 90 );
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      src(c,r) = float( (c*c + 7*r) % 50 );
+
+  // Within about 1% of the 0 to 49 range of the sampled kernel, for a
+  // large sigma, through the edges too.
+  ImageView<float> expected = gaussian_filter( src, 6.0 );
+  ImageView<float> result = recursive_gaussian_filter( src, 6.0 );
+  EXPECT_SEQ_NEAR( expected, result, 0.5 );
+
+  // A block only differs from the whole image by what the filter has
+  // not forgotten past its margin.
+  BBox2i window( 40, 30, 25, 20 );
+  ImageView<float> block = crop( recursive_gaussian_filter( src, 6.0 ), window );
+  EXPECT_SEQ_NEAR( crop( result, window ), block, 2e-2 );
+
+  // One axis alone.
+  ImageView<float> rows_only = recursive_gaussian_filter( src, 6.0, 0.0 );
+  EXPECT_SEQ_NEAR( gaussian_filter( src, 6.0, 0.0 ), rows_only, 0.5 );
+}
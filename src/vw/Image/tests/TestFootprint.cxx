@@ -0,0 +1,151 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/Footprint.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/Transform.h>
+
+using namespace vw;
+using namespace vw::test;
+
+// A source which marks the pixels read from it.
+class RecordingView : public ImageViewBase<RecordingView> {
+  ImageView<uint8> m_read;
+public:
+  typedef float pixel_type;
+  typedef float result_type;
+  typedef ProceduralPixelAccessor<RecordingView> pixel_accessor;
+
+  RecordingView( int32 cols, int32 rows ) : m_read( cols, rows ) {}
+
+  int32 cols  () const { return m_read.cols(); }
+  int32 rows  () const { return m_read.rows(); }
+  int32 planes() const { return 1; }
+  pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+  result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const {
+    EXPECT_TRUE( i >= 0 && j >= 0 && i < cols() && j < rows() ) << i << "," << j;
+    ImageView<uint8> read = m_read;
+    read( i, j ) = 1;
+    return float( i + 2*j );
+  }
+
+  /// The bounding box of the pixels read so far.
+  BBox2i read_bbox() const {
+    BBox2i result;
+    for ( int32 j = 0; j < rows(); ++j )
+      for ( int32 i = 0; i < cols(); ++i )
+        if ( m_read( i, j ) )
+          result.grow( BBox2i( i, j, 1, 1 ) );
+    return result;
+  }
+  void reset() { fill( m_read, uint8(0) ); }
+
+  typedef RecordingView prerasterize_type;
+  prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+  template <class DestT> void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( *this, dest, bbox );
+  }
+};
+
+// Rasterizes the bbox of the view and checks that the footprint covers
+// the pixels read.  Returns the footprint's region of the source,
+// which is a copy of it inside the view.
+template <class ViewT>
+BBox2i check_footprint( ViewT const& view, RecordingView& source, BBox2i const& bbox ) {
+  Footprint result = footprint( view, bbox );
+  EXPECT_EQ( 1u, result.regions().size() );
+  if ( result.empty() )
+    return BBox2i();
+  source.reset();
+  ImageView<typename ViewT::pixel_type> dest( bbox.width(), bbox.height() );
+  view.rasterize( dest, bbox );
+  BBox2i read = source.read_bbox();
+  EXPECT_TRUE( result.regions()[0].bbox.contains( read ) ) << result.regions()[0].bbox << " " << read;
+  return result.regions()[0].bbox;
+}
+
+TEST( Footprint, Leaves ) {
+  ImageView<float> image( 40, 30 ), other( 40, 30 );
+  Footprint result = footprint( image, BBox2i( 10, 5, 20, 10 ) );
+  ASSERT_EQ( 1u, result.regions().size() );
+  EXPECT_EQ( BBox2i( 10, 5, 20, 10 ), result.regions()[0].bbox );
+  EXPECT_EQ( Vector2i( 40, 30 ), result.regions()[0].size );
+  EXPECT_EQ( 200u, result.num_pixels() );
+
+  // Clipped to the source, and empty outside of it.
+  EXPECT_EQ( BBox2i( 30, 20, 10, 10 ), footprint( image, BBox2i( 30, 20, 50, 50 ) ).bbox( image.data() ) );
+  EXPECT_TRUE( footprint( image, BBox2i( 50, 0, 10, 10 ) ).empty() );
+  EXPECT_TRUE( footprint( image, BBox2i() ).empty() );
+
+  // Per-pixel views read each child under the bbox.  A copy of an
+  // ImageView is the same source.
+  ImageView<float> copy = image;
+  result = footprint( image + other * copy, BBox2i( 1, 2, 3, 4 ) );
+  ASSERT_EQ( 2u, result.regions().size() );
+  EXPECT_EQ( BBox2i( 1, 2, 3, 4 ), result.bbox( image.data() ) );
+  EXPECT_EQ( BBox2i( 1, 2, 3, 4 ), result.bbox( other.data() ) );
+
+  // Through an ImageViewRef.
+  ImageViewRef<float> ref = crop( image, 5, 6, 20, 20 );
+  result = footprint( ref, BBox2i( 0, 0, 4, 4 ) );
+  ASSERT_EQ( 1u, result.regions().size() );
+  EXPECT_EQ( BBox2i( 5, 6, 4, 4 ), result.bbox( image.data() ) );
+}
+
+TEST( Footprint, Pipelines ) {
+  RecordingView source( 60, 50 );
+  BBox2i inside( 10, 12, 15, 9 ), edge( 50, 40, 10, 10 );
+
+  EXPECT_EQ( BBox2i( 15, 19, 15, 9 ), check_footprint( crop( source, 5, 7, 40, 30 ), source, inside ) );
+  EXPECT_EQ( BBox2i( 30, 36, 13, 9 ), check_footprint( subsample( source, 3, 4 ), source, BBox2i( 10, 9, 5, 3 ) ) );
+
+  ImageView<float> kernel( 5, 3 );
+  fill( kernel, 1.0f );
+  EXPECT_EQ( BBox2i( 8, 11, 19, 11 ),
+             check_footprint( convolution_filter( source, kernel, ConstantEdgeExtension() ), source, inside ) );
+  EXPECT_EQ( BBox2i( 48, 39, 12, 11 ),
+             check_footprint( convolution_filter( source, kernel, ConstantEdgeExtension() ), source, edge ) );
+  std::vector<float> xk( 3, 1.0f ), yk( 7, 1.0f );
+  EXPECT_EQ( BBox2i( 9, 9, 17, 15 ),
+             check_footprint( separable_convolution_filter( source, xk, yk, ZeroEdgeExtension() ), source, inside ) );
+
+  // Bilinear interpolation reads one pixel past the translated bbox on
+  // each side.
+  BBox2i translated = check_footprint( translate( source, 2.5, -1.25 ), source, inside );
+  EXPECT_TRUE( BBox2i( 6, 11, 18, 13 ).contains( translated ) ) << translated;
+  check_footprint( translate( source, 2.5, -1.25 ), source, edge );
+}
+
+TEST( Footprint, BlockRasterize ) {
+  ImageView<float> image( 100, 70 );
+  Cache cache( 1 << 20 );
+  BlockRasterizeView<ImageView<float> > cached( image, Vector2i( 32, 32 ), 1, &cache );
+  EXPECT_EQ( BBox2i( 32, 0, 64, 64 ), footprint( cached, BBox2i( 40, 10, 30, 30 ) ).bbox( image.data() ) );
+  EXPECT_EQ( BBox2i( 64, 64, 36, 6 ), footprint( cached, BBox2i( 70, 65, 50, 50 ) ).bbox( image.data() ) );
+
+  // Without a cache only the bbox is read.
+  BBox2i bbox( 40, 10, 30, 30 );
+  EXPECT_EQ( bbox, footprint( block_rasterize( image, Vector2i( 32, 32 ) ), bbox ).bbox( image.data() ) );
+}
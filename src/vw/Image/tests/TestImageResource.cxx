@@ -20,17 +20,25 @@
 
 #include <vw/Core/Functors.h>
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
 #include <vw/Math/BBox.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/ImageMath.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/ImageResourceStream.h>
 #include <vw/Image/PixelTypeInfo.h>
 #include <vw/Image/PixelTypes.h>
+#include <vw/Image/Manipulation.h>
 
 #include <test/Helpers.h>
 
 #if defined(VW_HAVE_PKG_OPENCV) && (VW_HAVE_PKG_OPENCV==1)
 #include <opencv2/core/core.hpp>
 #include <vw/Image/ImageResourceImpl.h>
+#include <vw/Image/ImageViewOpenCV.h>
+#include <vw/Image/UtilityViews.h>
 #endif
 
 #include <boost/iostreams/device/array.hpp>
@@ -40,6 +48,12 @@ namespace io = boost::iostreams;
 #include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <vector>
+
 using namespace vw;
 using namespace vw::test;
 
@@ -125,6 +139,250 @@ TEST( ImageResource, NativePtr ) {
   EXPECT_RANGE_EQ(src, src+4, &d2[0], &d2[4]);
 }
 
+// Fills a buffer of channels with values covering the whole range of
+// the type, and for floats a little outside [0,1].
+static void fill_channels( ImageBuffer const& buf, size_t channels, uint32 seed ) {
+  for ( uint32 r = 0; r < buf.format.rows; ++r )
+    for ( uint32 c = 0; c < buf.format.cols; ++c )
+      for ( size_t ch = 0; ch < channels; ++ch ) {
+        seed = seed*1103515245u + 12345u;
+        uint32 v = seed >> 8;
+        uint8* p = (uint8*)buf.data + r*buf.rstride + c*buf.cstride + ch*channel_size(buf.format.channel_type);
+        switch ( buf.format.channel_type ) {
+        case VW_CHANNEL_UINT8:   *(uint8 *)p = uint8 (v); break;
+        case VW_CHANNEL_UINT16:  *(uint16*)p = uint16(v); break;
+        default:                 *(float *)p = (v % 1400) / 1000.0f - 0.2f; break;
+        }
+      }
+}
+
+// Packed rows of uint8, uint16 and float32 pixels are converted a row
+// at a time.  Padding the pixels makes convert() fall back to the per
+// channel path, which must give the same result.
+TEST( ImageResource, PackedConvert ) {
+  const ChannelTypeEnum types[3] = { VW_CHANNEL_UINT8, VW_CHANNEL_UINT16, VW_CHANNEL_FLOAT32 };
+  const PixelFormatEnum formats[4] = { VW_PIXEL_GRAY, VW_PIXEL_GRAYA, VW_PIXEL_RGB, VW_PIXEL_RGBA };
+  const uint32 cols = 37, rows = 3;
+
+  for ( int st = 0; st < 3; ++st ) for ( int dt = 0; dt < 3; ++dt )
+  for ( int sf = 0; sf < 4; ++sf ) for ( int df = 0; df < 4; ++df )
+  for ( int rescale = 0; rescale < 2; ++rescale ) {
+    ImageFormat src_fmt, dst_fmt;
+    src_fmt.cols = dst_fmt.cols = cols;
+    src_fmt.rows = dst_fmt.rows = rows;
+    src_fmt.planes = dst_fmt.planes = 1;
+    src_fmt.channel_type = types[st];
+    dst_fmt.channel_type = types[dt];
+    src_fmt.pixel_format = formats[sf];
+    dst_fmt.pixel_format = formats[df];
+    size_t src_px = channel_size(src_fmt.channel_type) * num_channels(src_fmt.pixel_format);
+    size_t dst_px = channel_size(dst_fmt.channel_type) * num_channels(dst_fmt.pixel_format);
+
+    std::vector<uint8> src_data( src_px*cols*rows ), packed( dst_px*cols*rows );
+    std::vector<uint8> padded( (dst_px+8)*cols*rows, 0 );
+    ImageBuffer src( src_fmt, &src_data[0] ), dst( dst_fmt, &packed[0] ), pad( dst_fmt, &padded[0] );
+    pad.cstride = dst_px + 8;
+    pad.rstride = pad.cstride*cols;
+    pad.pstride = pad.rstride*rows;
+    fill_channels( src, num_channels(src_fmt.pixel_format), st*1000 + sf*10 + rescale );
+
+    convert( dst, src, rescale );
+    convert( pad, src, rescale );
+    for ( uint32 r = 0; r < rows; ++r )
+      for ( uint32 c = 0; c < cols; ++c )
+        ASSERT_EQ( 0, memcmp( &packed[(r*cols + c)*dst_px], &padded[r*pad.rstride + c*pad.cstride], dst_px ) )
+          << "types " << st << " " << dt << " formats " << sf << " " << df << " rescale " << rescale
+          << " at " << c << "," << r;
+  }
+
+  // Every uint16 value rescaled to uint8.
+  ImageView<uint16> all( 65536, 1 );
+  for ( int32 i = 0; i < all.cols(); ++i )
+    all(i, 0) = uint16(i);
+  ImageView<uint8> scaled( 65536, 1 );
+  convert( scaled.buffer(), all.buffer(), true );
+  for ( int32 i = 0; i < all.cols(); ++i )
+    ASSERT_EQ( i/257, scaled(i, 0) ) << i;
+}
+
+// Encodes blocks by negating them, and records who does what.
+class DstEncodingResource : public DstImageResource {
+    struct Negated : public EncodedBlock {
+      ImageView<int32> pixels;
+      Negated(BBox2i const& bbox) : EncodedBlock(bbox) {}
+    };
+    mutable Mutex m_mutex;
+
+  public:
+    ImageView<int32> image;
+    mutable std::set<uint64> encode_threads;
+    std::vector<BBox2i> written;
+    int plain_writes;
+
+    DstEncodingResource(int32 cols, int32 rows) : image(cols, rows), plain_writes(0) {}
+
+    virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+      plain_writes++;
+      write_encoded_block( *encode_block( buf, bbox ) );
+    }
+    virtual bool has_block_write () const {return true;}
+    virtual Vector2i block_write_size() const {return Vector2i(16,16);}
+    virtual bool has_nodata_write() const {return false;}
+    virtual void flush() {}
+
+    virtual bool has_encoded_write() const {return true;}
+    virtual boost::shared_ptr<EncodedBlock> encode_block( ImageBuffer const& buf, BBox2i const& bbox ) const {
+      boost::shared_ptr<Negated> block( new Negated(bbox) );
+      block->pixels.set_size( bbox.width(), bbox.height() );
+      convert( block->pixels.buffer(), buf );
+      block->pixels = -block->pixels;
+      Mutex::Lock lock(m_mutex);
+      encode_threads.insert( Thread::id() );
+      return block;
+    }
+    virtual void write_encoded_block( EncodedBlock const& block ) {
+      Negated const& negated = static_cast<Negated const&>(block);
+      crop( image, block.bbox() ) = -negated.pixels;
+      written.push_back( block.bbox() );
+    }
+};
+
+TEST( ImageResource, EncodedWrite ) {
+  ImageView<int32> src(100,70);
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      src(c,r) = r*src.cols() + c;
+
+  DstEncodingResource dst( src.cols(), src.rows() );
+  block_write_image( dst, src, ProgressCallback::dummy_instance(), 4 );
+
+  EXPECT_EQ( 0, dst.plain_writes );
+  EXPECT_EQ( 0u, dst.encode_threads.count( Thread::id() ) );
+  // 7 columns by 5 rows of blocks, appended in raster order.
+  ASSERT_EQ( 35u, dst.written.size() );
+  for ( size_t i = 1; i < dst.written.size(); ++i ) {
+    BBox2i const& a = dst.written[i-1];
+    BBox2i const& b = dst.written[i];
+    EXPECT_TRUE( a.min().y() < b.min().y() ||
+                 (a.min().y() == b.min().y() && a.min().x() < b.min().x()) );
+  }
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      EXPECT_EQ( src(c,r), dst.image(c,r) );
+}
+
+TEST( ImageResource, BlockWriteOrder ) {
+  ImageView<int32> src(64,48);
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      src(c,r) = r*src.cols() + c;
+
+  // The 4 by 3 blocks are written along the Z-order curve.
+  DstEncodingResource dst( src.cols(), src.rows() );
+  block_write_image( dst, src, ProgressCallback::dummy_instance(), 4,
+                     boost::shared_ptr<CancelToken>(), BlockOrder(BlockPrefetcher::ZOrder) );
+  ASSERT_EQ( 12u, dst.written.size() );
+  EXPECT_EQ( BBox2i(16,0,16,16), dst.written[1] );
+  EXPECT_EQ( BBox2i(0,16,16,16), dst.written[2] );
+  EXPECT_EQ( BBox2i(32,0,16,16), dst.written[4] );
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      EXPECT_EQ( src(c,r), dst.image(c,r) );
+}
+
+TEST( ImageResource, SparseBlockWrite ) {
+  ImageView<int32> src(20,20);
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      src(c,r) = r*src.cols() + c + 1;
+
+  // Only the four top left blocks overlap the data; the others are
+  // written as the empty pixel without being rasterized.
+  DstEncodingResource dst( 64, 48 );
+  block_write_sparse_image( dst, edge_extend( src, BBox2i(0,0,64,48), ZeroEdgeExtension() ), int32(-7),
+                            ProgressCallback::dummy_instance(), 4 );
+  ASSERT_EQ( 12u, dst.written.size() );
+  for ( int32 r = 0; r < 48; ++r )
+    for ( int32 c = 0; c < 64; ++c ) {
+      if ( c < 32 && r < 32 ) {
+        EXPECT_EQ( ( c < 20 && r < 20 ) ? src(c,r) : 0, dst.image(c,r) ) << c << "," << r;
+      } else {
+        EXPECT_EQ( -7, dst.image(c,r) ) << c << "," << r;
+      }
+    }
+}
+
+// Counts the times it is asked to sync its blocks.
+class DstSyncResource : public DstEncodingResource {
+  public:
+    int syncs;
+    DstSyncResource(int32 cols, int32 rows) : DstEncodingResource(cols, rows), syncs(0) {}
+    virtual bool has_sync() const {return true;}
+    virtual void sync() { syncs++; }
+};
+
+TEST( ImageResource, JournaledBlockWrite ) {
+  ImageView<int32> src(64,48);
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      src(c,r) = r*src.cols() + c + 1;
+  UnlinkName file( "journal.vwjournal" );
+
+  // A first attempt gets two blocks to storage, then dies partway
+  // through recording a third.
+  {
+    DstSyncResource dst( src.cols(), src.rows() );
+    BlockWriteJournal journal( file, Vector2i(64,48), Vector2i(16,16), false );
+    EXPECT_EQ( Vector2i(4,3), journal.table_size() );
+    journal.complete( BBox2i(0,0,16,16) );
+    journal.complete( BBox2i(16,16,16,16) );
+    journal.checkpoint( dst );
+    EXPECT_EQ( 1, dst.syncs );
+    EXPECT_EQ( 2u, journal.num_done() );
+  }
+  {
+    std::ofstream f( file.c_str(), std::ios::app );
+    f << "3 ";
+  }
+
+  // Only another image or block size is an error.
+  EXPECT_THROW( BlockWriteJournal( file, Vector2i(64,48), Vector2i(32,32), true ), ArgumentErr );
+  DstEncodingResource no_sync( src.cols(), src.rows() );
+  UnlinkName other_file( "journal_other.vwjournal" );
+  BlockWriteJournal other( other_file, Vector2i(64,48), Vector2i(16,16), false );
+  EXPECT_THROW( block_write_image( no_sync, src, other ), NoImplErr );
+  other.remove();
+
+  // Resuming writes the other ten, syncing before each one is recorded.
+  DstSyncResource dst( src.cols(), src.rows() );
+  {
+    BlockWriteJournal journal( file, Vector2i(64,48), Vector2i(16,16), true, 0 );
+    EXPECT_EQ( 2u, journal.num_done() );
+    EXPECT_TRUE( journal.done( Vector2i(1,1) ) );
+    block_write_image( dst, src, journal, ProgressCallback::dummy_instance(), 4 );
+    ASSERT_EQ( 10u, dst.written.size() );
+    for ( size_t i = 0; i < dst.written.size(); ++i ) {
+      EXPECT_NE( BBox2i(0,0,16,16),   dst.written[i] );
+      EXPECT_NE( BBox2i(16,16,16,16), dst.written[i] );
+    }
+    EXPECT_GE( dst.syncs, 10 );
+    EXPECT_EQ( 12u, journal.num_done() );
+  }
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c ) {
+      bool skipped = ( r < 16 && c < 16 ) || ( r >= 16 && r < 32 && c >= 16 && c < 32 );
+      EXPECT_EQ( skipped ? 0 : src(c,r), dst.image(c,r) ) << c << "," << r;
+    }
+
+  // A further resume finds nothing left to write.
+  DstSyncResource again( src.cols(), src.rows() );
+  BlockWriteJournal journal( file, Vector2i(64,48), Vector2i(16,16), true );
+  block_write_image( again, src, journal );
+  EXPECT_EQ( 0u, again.written.size() );
+  journal.remove();
+  EXPECT_FALSE( fs::exists( std::string(file) ) );
+}
+
 struct TestStream : public ::testing::Test {
   protected:
     static const size_t WIDTH = 2;
@@ -342,6 +600,42 @@ TEST_F(TestStream, StreamError) {
   CHECK(src_data, dst_buf);
 }
 
+TEST( ImageResource, ScanlineStream ) {
+  ImageView<uint16> image(20,37);
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      image(c,r) = uint16(r*image.cols() + c);
+
+  std::stringstream ss;
+  ss.write( reinterpret_cast<const char*>(image.data()), image.cols()*image.rows()*sizeof(uint16) );
+
+  SrcImageResourceScanlineStream r( &ss, image.format(), 8, 16 );
+  ASSERT_TRUE( r.has_block_read() );
+  EXPECT_VECTOR_EQ( Vector2i(20,8), r.block_read_size() );
+
+  // Bands down the image, each split into two tiles, converted to float.
+  for ( int32 row = 0; row < image.rows(); row += 8 ) {
+    for ( int32 col = 0; col < image.cols(); col += 10 ) {
+      BBox2i bbox( col, row, 10, std::min(8, image.rows() - row) );
+      ImageView<float> tile;
+      read_image( tile, r, bbox );
+      for ( int32 y = 0; y < tile.rows(); ++y )
+        for ( int32 x = 0; x < tile.cols(); ++x )
+          EXPECT_EQ( float(image(col+x, row+y)), tile(x,y) );
+    }
+    EXPECT_LE( r.end_buffered_row() - r.first_buffered_row(), 16 );
+  }
+  EXPECT_EQ( 37, r.end_buffered_row() );
+  EXPECT_EQ( 21, r.first_buffered_row() );
+
+  // Rows still buffered can be read again, dropped ones cannot.
+  ImageView<uint16> again;
+  EXPECT_NO_THROW( read_image( again, r, BBox2i(0,21,20,16) ) );
+  EXPECT_EQ( image(3,25), again(3,4) );
+  EXPECT_THROW( read_image( again, r, BBox2i(0,20,20,1) ), LogicErr );
+  EXPECT_THROW( read_image( again, r, BBox2i(0,21,20,17) ), ArgumentErr );
+}
+
 #if defined(VW_HAVE_PKG_OPENCV) && VW_HAVE_PKG_OPENCV == 1
 
 struct ImageResourceOpenCVTest : public ::testing::Test, private boost::noncopyable {
@@ -470,4 +764,122 @@ TEST_F(ImageResourceOpenCVTest, OpenCv_Write_Discont) {
   EXPECT_RANGE_EQ(e_write_data+0, e_write_data+len, actual_data+0, actual_data+len);
 }
 
+TEST(ImageResourceOpenCV, ReadWriteRoi) {
+  // A window of a larger matrix, so its rows have gaps.
+  ImageView<float> image(6,5);
+  for (int32 r = 0; r < image.rows(); ++r)
+    for (int32 c = 0; c < image.cols(); ++c)
+      image(c,r) = float(c + 10*r);
+  cv::Mat full = opencv_wrap(image);
+  ImageResourceOpenCV resource(boost::shared_ptr<cv::Mat>(new cv::Mat(full, cv::Rect(1,1,4,3))));
+
+  ImageView<float> out(2,2);
+  resource.read(out.buffer(), BBox2i(1,1,2,2));
+  EXPECT_EQ(22, out(0,0));
+  EXPECT_EQ(33, out(1,1));
+
+  out(0,0) = -1; out(1,1) = -2;
+  resource.write(out.buffer(), BBox2i(2,0,2,2));
+  EXPECT_EQ(-1, image(3,1));
+  EXPECT_EQ(-2, image(4,2));
+  EXPECT_EQ(25, image(5,2));
+}
+
+TEST(ImageViewOpenCV, Wrap) {
+  ImageView<PixelRGB<uint8> > image(5,4);
+  for (int32 r = 0; r < image.rows(); ++r)
+    for (int32 c = 0; c < image.cols(); ++c)
+      image(c,r) = PixelRGB<uint8>(c, r, c+r);
+
+  EXPECT_EQ(CV_8UC3, int(OpenCVType<PixelRGB<uint8> >::value));
+  EXPECT_EQ(-1,      int(OpenCVType<PixelRGB<uint32> >::value));
+
+  // The matrix is a header over the image's pixels.
+  cv::Mat mat = opencv_wrap(image);
+  EXPECT_EQ(CV_8UC3, mat.type());
+  EXPECT_EQ(reinterpret_cast<uchar*>(image.data()), mat.data);
+  EXPECT_EQ(7, mat.at<cv::Vec3b>(3,4)[2]);
+
+  ImageView<PixelRGB<uint8> > buffer;
+  EXPECT_EQ(mat.data, opencv_wrap(image, buffer).data);
+  ImageView<float> float_buffer;
+  cv::Mat filled = opencv_wrap(constant_view(2.0f, 3, 3), float_buffer);
+  EXPECT_EQ(2, filled.at<float>(2,2));
+}
+
+TEST(ImageViewOpenCV, View) {
+  ImageView<PixelRGB<uint8> > image;
+  {
+    cv::Mat mat(4, 5, CV_8UC3, cv::Scalar(1,2,3));
+    image = opencv_view<PixelRGB<uint8> >(mat);
+    EXPECT_EQ(mat.data, reinterpret_cast<uchar*>(image.data()));
+  }
+  // The view keeps the matrix's pixels alive.
+  EXPECT_VW_EQ(PixelRGB<uint8>(1,2,3), image(4,3));
+
+  // Windows are copied, and other channel types converted.
+  cv::Mat mat = opencv_wrap(image);
+  ImageView<PixelRGB<uint8> > window = opencv_view<PixelRGB<uint8> >(mat(cv::Rect(1,1,3,2)));
+  EXPECT_EQ(3, window.cols());
+  EXPECT_NE(mat.data, reinterpret_cast<uchar*>(window.data()));
+  ImageView<PixelRGB<float> > converted = opencv_view<PixelRGB<float> >(mat);
+  EXPECT_VW_EQ(PixelRGB<float>(1,2,3), converted(0,0));
+  EXPECT_THROW(opencv_view<float>(mat), ArgumentErr);
+}
+
 #endif
+
+TEST( ImageResource, BlockWriteStats ) {
+  ImageView<int32> src(64,40);
+  for ( int32 r = 0; r < src.rows(); ++r )
+    for ( int32 c = 0; c < src.cols(); ++c )
+      src(c,r) = r*src.cols() + c + 1;
+
+  // The write blocks line up with the cache blocks, so each misses once.
+  Cache cache( 1024*1024 );
+  DstEncodingResource dst( src.cols(), src.rows() );
+  BlockWriteStats stats;
+  block_write_image( dst, block_cache( src, Vector2i(16,16), 1, cache ), stats,
+                     ProgressCallback::dummy_instance(), 4 );
+  ASSERT_EQ( Vector2i(4,3), stats.table_size() );
+  for ( int32 j = 0; j < 3; ++j )
+    for ( int32 i = 0; i < 4; ++i ) {
+      BlockWriteRecord const& r = stats.record( i, j );
+      ASSERT_TRUE( r.written() );
+      EXPECT_EQ( BBox2i(16*i, 16*j, 16, j < 2 ? 16 : 8), r.bbox );
+      EXPECT_EQ( 1u, r.cache_misses );
+      EXPECT_EQ( uint64(r.bbox.area()) * sizeof(int32), r.bytes );
+      EXPECT_GE( r.rasterize_ms, 0 );
+      EXPECT_GE( r.write_ms, 0 );
+    }
+
+  ImageView<float> heatmap = stats.heatmap();
+  ASSERT_EQ( 4, heatmap.cols() );
+  ASSERT_EQ( 3, heatmap.rows() );
+  ASSERT_EQ( 4, heatmap.planes() );
+  EXPECT_EQ( 1, heatmap(3,2,2) );
+  EXPECT_EQ( 16*8*4, heatmap(3,2,3) );
+
+  UnlinkName file( "block_write_stats.csv" );
+  stats.write_csv( file );
+  std::ifstream csv( file.c_str() );
+  std::string line;
+  std::vector<std::string> lines;
+  while ( std::getline( csv, line ) )
+    lines.push_back( line );
+  ASSERT_EQ( 13u, lines.size() );
+  EXPECT_EQ( "col,row,x,y,width,height,rasterize_ms,write_ms,cache_misses,bytes", lines[0] );
+  EXPECT_EQ( "3,2,48,32,16,8,", lines[12].substr( 0, 15 ) );
+
+  // Blocks which are not written are marked as such.
+  BlockWriteJournal journal( "block_write_stats.vwjournal", Vector2i(64,40), Vector2i(16,16), false );
+  journal.complete( BBox2i(0,0,16,16) );
+  DstSyncResource again( src.cols(), src.rows() );
+  journal.checkpoint( again );
+  block_write_image( again, src, journal, ProgressCallback::dummy_instance(), 2,
+                     boost::shared_ptr<CancelToken>(), &stats );
+  journal.remove();
+  EXPECT_FALSE( stats.record( 0, 0 ).written() );
+  EXPECT_TRUE ( stats.record( 1, 0 ).written() );
+  EXPECT_EQ( BlockWriteStats::heatmap_nodata(), stats.heatmap()(0,0,0) );
+}
@@ -140,6 +140,33 @@ TEST( ImageView, Reset ) {
   ASSERT_EQ(test_rgba.data(), (PixelRGBA<vw::uint8>*)0);
 }
 
+TEST( ImageView, PooledSetSize ) {
+  BufferPool pool(16*1024*1024);
+  PixelRGB<float>* first;
+  {
+    ImageView<PixelRGB<float> > image;
+    image.set_size(128, 128, 1, &pool);
+    EXPECT_EQ(128, image.cols());
+    EXPECT_EQ(PixelRGB<float>(), image(5,7));
+    image(5,7) = PixelRGB<float>(1,2,3);
+    first = image.data();
+    EXPECT_EQ(1u, pool.misses());
+  }
+  // Dropping the last view returns the buffer to the pool.
+  EXPECT_EQ(BufferPool::class_size(128*128*sizeof(PixelRGB<float>)), pool.cached_bytes());
+
+  // It is reused, and the pixels are constructed again.
+  ImageView<PixelRGB<float> > image;
+  image.set_size(128, 128, 1, &pool);
+  EXPECT_EQ(first, image.data());
+  EXPECT_EQ(1u, pool.hits());
+  EXPECT_EQ(PixelRGB<float>(), image(5,7));
+
+  ImageView<float> plain;
+  plain.set_size(512, 512, 1, &pool);
+  EXPECT_EQ(0.0f, plain(511,511));
+}
+
 TEST( ImageView, Rasterization ) {
   ImageView<double> im1(2,2); im1(0,0)=1; im1(1,0)=2; im1(0,1)=3; im1(1,1)=4;
   ImageView<double> im2(2,2);
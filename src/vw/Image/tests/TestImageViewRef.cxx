@@ -22,9 +22,34 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Interpolation.h>
+#include <vw/Image/PixelAccessors.h>
 
 using namespace vw;
 
+// A procedural view which counts how often it is rasterized.
+class CountingView : public ImageViewBase<CountingView> {
+  int32 m_cols, m_rows;
+  int *m_count;
+public:
+  typedef float pixel_type;
+  typedef float result_type;
+  typedef ProceduralPixelAccessor<CountingView> pixel_accessor;
+
+  CountingView( int32 cols, int32 rows, int *count ) : m_cols(cols), m_rows(rows), m_count(count) {}
+  inline int32 cols  () const { return m_cols; }
+  inline int32 rows  () const { return m_rows; }
+  inline int32 planes() const { return 1; }
+  inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+  inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const { return float(i + 1000*j); }
+
+  typedef CountingView prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const { return *this; }
+  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    ++*m_count;
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+};
+
 TEST( ImageViewRef, Construct ) {
   const int cols=3, rows=2;
   ImageView<float> image(cols,rows);
@@ -93,3 +118,44 @@ TEST( ImageViewRef, FloatAccess ) {
   EXPECT_EQ( ref(char(0),int32(0)), 0 );
   EXPECT_EQ( ref(char(0),int32(0),0), 0 );
 }
+
+struct SumFunctor {
+  double sum;
+  SumFunctor() : sum(0) {}
+  void operator()( float v ) { sum += v; }
+};
+
+TEST( ImageViewRef, BlockAccessor ) {
+  // 600 columns make strips of 436 rows, so 1000 rows are 3 strips.
+  int count = 0;
+  ImageViewRef<float> ref = CountingView( 600, 1000, &count );
+
+  SumFunctor sum;
+  for_each_pixel( ref, sum );
+  EXPECT_EQ( 3, count );
+  EXPECT_DOUBLE_EQ( 1000.0 * (599*600/2) + 600.0 * 1000 * (999*1000/2), sum.sum );
+
+  // Copies share strips, stepping back reloads, and positions outside
+  // the view go through operator().
+  ImageViewRefBlockAccessor<float> acc = ref.strip_origin();
+  count = 0;
+  acc.advance( 5, 900 );
+  EXPECT_EQ( 900005, *acc );
+  ImageViewRefBlockAccessor<float> copy = acc;
+  copy.next_row();
+  EXPECT_EQ( 901005, *copy );
+  EXPECT_EQ( 1, count );
+  copy.advance( 0, -900 );
+  EXPECT_EQ( 1005, *copy );
+  EXPECT_EQ( 2, count );
+  copy.advance( -10, 0 );
+  EXPECT_EQ( 995, *copy );
+  EXPECT_EQ( 2, count );
+
+  // The per-pixel accessor never rasterizes, so neither does sampling.
+  ImageViewRef<float>::pixel_accessor pixel = ref.origin();
+  pixel.advance( 7, 3 );
+  EXPECT_EQ( 3007, *pixel );
+  EXPECT_FLOAT_EQ( 3007.5f, interpolate( ref, BilinearInterpolation() )( 7.5, 3.0 ) );
+  EXPECT_EQ( 2, count );
+}
@@ -20,6 +20,7 @@
 
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/InpaintView.h>
+#include <vw/Image/SparseView.h>
 
 using namespace vw;
 
@@ -49,3 +50,82 @@ TEST(InpaintView, compile) {
 }
 
 
+
+namespace {
+  // A planar ramp with holes, which diffusion should fill with the
+  // same plane.
+  ImageView<PixelMask<float> > ramp_with_holes() {
+    ImageView<PixelMask<float> > image( 120, 90 );
+    for ( int j = 0; j < image.rows(); j++ )
+      for ( int i = 0; i < image.cols(); i++ )
+        image(i,j) = PixelMask<float>( 2.0*i + 3.0*j );
+    // A deep hole, and a few shallow ones.
+    for ( int j = 20; j < 60; j++ )
+      for ( int i = 10; i < 60; i++ )
+        image(i,j).invalidate();
+    for ( int k = 0; k < 5; k++ )
+      for ( int j = 10 + 15*k; j < 13 + 15*k; j++ )
+        for ( int i = 80; i < 84 + k; i++ )
+          image(i,j).invalidate();
+    return image;
+  }
+}
+
+TEST(InpaintView, FillsRamp) {
+  ImageView<PixelMask<float> > image = ramp_with_holes();
+  BlobIndexThreaded bindex( invert_mask( image ), 100000, 1000 );
+  EXPECT_EQ( 6u, bindex.num_blobs() );
+
+  ImageView<PixelMask<float> > filled = inpaint( image, bindex, true, PixelMask<float>() );
+  for ( int j = 0; j < image.rows(); j++ )
+    for ( int i = 0; i < image.cols(); i++ ) {
+      ASSERT_TRUE( is_valid( filled(i,j) ) );
+      EXPECT_NEAR( 2.0*i + 3.0*j, filled(i,j).child(), 0.05 );
+    }
+}
+
+TEST(InpaintView, ThreadsGiveSameResult) {
+  ImageView<PixelMask<float> > image = ramp_with_holes();
+  for ( int i = 0; i < image.cols(); i++ )
+    image(i,7) = PixelMask<float>( 100.0 * (i % 3) );
+  BlobIndexThreaded bindex( invert_mask( image ), 100000, 1000 );
+
+  ImageView<PixelMask<float> > single = inpaint( image, bindex, true, PixelMask<float>(), 1 );
+  ImageView<PixelMask<float> > multi  = inpaint( image, bindex, true, PixelMask<float>(), 4 );
+  for ( int j = 0; j < image.rows(); j++ )
+    for ( int i = 0; i < image.cols(); i++ ) {
+      EXPECT_EQ( single(i,j).child(), multi(i,j).child() );
+      EXPECT_EQ( single(i,j).valid(), multi(i,j).valid() );
+    }
+}
+
+TEST(SparseCompositeView, RasterizeRuns) {
+  ImageView<float> under( 40, 30 );
+  for ( int j = 0; j < under.rows(); j++ )
+    for ( int i = 0; i < under.cols(); i++ )
+      under(i,j) = i + 100*j;
+
+  // Two patches, with a few runs on each row.
+  SparseCompositeView<ImageView<float> > composite( under );
+  ImageView<PixelMask<float> > patch( 12, 10 );
+  for ( int j = 0; j < patch.rows(); j++ )
+    for ( int i = 0; i < patch.cols(); i++ )
+      if ( (i + j) % 5 != 0 )
+        patch(i,j) = PixelMask<float>( -1 - i - 100*j );
+  composite.absorb( Vector2i(3,4), patch );
+  composite.absorb( Vector2i(25,12), patch );
+
+  ImageView<float> full = composite;
+  for ( int j = 0; j < under.rows(); j++ )
+    for ( int i = 0; i < under.cols(); i++ )
+      ASSERT_EQ( composite(i,j), full(i,j) ) << i << "," << j;
+  EXPECT_EQ( -1 - 2 - 100*4, full(5,8) );
+  EXPECT_EQ( under(3,4), full(3,4) );
+
+  // A region which starts and ends inside runs.
+  BBox2i bbox( 6, 5, 24, 15 );
+  ImageView<float> part = crop( composite, bbox );
+  for ( int j = 0; j < bbox.height(); j++ )
+    for ( int i = 0; i < bbox.width(); i++ )
+      ASSERT_EQ( composite(i + bbox.min().x(), j + bbox.min().y()), part(i,j) ) << i << "," << j;
+}
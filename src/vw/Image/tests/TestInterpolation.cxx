@@ -18,9 +18,11 @@
 
 // TestInterpolation.h
 #include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
 
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Interpolation.h>
+#include <vw/Image/PixelTypes.h>
 
 using namespace vw;
 
@@ -124,6 +126,41 @@ template <class PixelT>
 struct IsFloatingPointIndexable<FloatingView<PixelT> > : public true_type {};
 }
 
+template <class ViewT>
+static void check_batch( ViewT const& view, std::vector<double> const& i, std::vector<double> const& j ) {
+  std::vector<typename ViewT::pixel_type> out( i.size() );
+  sample_points( view, &i[0], &j[0], int32(i.size()), 0, &out[0] );
+  for ( size_t k = 0; k < i.size(); ++k )
+    EXPECT_PIXEL_NEAR( view(i[k],j[k]), out[k], 1e-4 ) << "at " << i[k] << "," << j[k];
+}
+
+TEST( Interpolation, Batch ) {
+  ImageView<float> im(7,6);
+  ImageView<PixelRGB<uint8> > rgb(7,6);
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x ) {
+      im(x,y) = float( (x*37 + y*11) % 17 );
+      rgb(x,y) = PixelRGB<uint8>( 30*x, 40*y, 255-11*x*y );
+    }
+
+  // Points inside, on whole pixels, and across every edge, in more
+  // than one chunk.
+  std::vector<double> i, j;
+  for ( int32 k = 0; k < 150; ++k ) {
+    i.push_back( -2.3 + 0.077*k );
+    j.push_back( 7.1 - 0.061*k );
+  }
+  i.push_back( 3 );  j.push_back( 2 );
+  i.push_back( 0 );  j.push_back( 5 );
+
+  check_batch( interpolate(im,  BilinearInterpolation()), i, j );
+  check_batch( interpolate(im,  BicubicInterpolation(), ZeroEdgeExtension()), i, j );
+  check_batch( interpolate(im,  NearestPixelInterpolation()), i, j );
+  check_batch( interpolate(rgb, BilinearInterpolation(), ReflectEdgeExtension()), i, j );
+  check_batch( interpolate(rgb, BicubicInterpolation()), i, j );
+  check_batch( interpolate(crop(im,1,1,5,4), BicubicInterpolation()), i, j );
+}
+
 TEST( Interpolation, DISABLED_PassThrough ) {
   typedef InterpolationView<FloatingView<float>, BilinearInterpolation> bilinear_view;
   typedef InterpolationView<FloatingView<float>, BicubicInterpolation> bicubic_view;
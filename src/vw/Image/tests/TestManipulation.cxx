@@ -443,6 +443,33 @@ TEST( Manipulation, Rotate90CCW ) {
   ASSERT_TRUE( bool_trait<IsMultiplyAccessible>( rotate_90_ccw(im) ) );
 }
 
+TEST( Manipulation, TiledRotations ) {
+  // Large enough to be rasterized in several tiles, with partial tiles
+  // at the edges.
+  ImageView<float> im(150,130);
+  for ( int32 r = 0; r < im.rows(); ++r )
+    for ( int32 c = 0; c < im.cols(); ++c )
+      im(c,r) = float( c + 1000*r );
+
+  ImageView<float> tr = transpose(im), cw = rotate_90_cw(im), ccw = rotate_90_ccw(im);
+  ASSERT_EQ( 130, tr.cols() );
+  ASSERT_EQ( 150, tr.rows() );
+  for ( int32 r = 0; r < tr.rows(); ++r )
+    for ( int32 c = 0; c < tr.cols(); ++c ) {
+      EXPECT_EQ( im(r,c), tr(c,r) );
+      EXPECT_EQ( im(r,im.rows()-1-c), cw(c,r) );
+      EXPECT_EQ( im(im.cols()-1-r,c), ccw(c,r) );
+    }
+
+  // A bbox which doesn't start on a tile boundary.
+  ImageView<float> part(100,90);
+  BBox2i bbox(17,23,100,90);
+  rotate_90_cw(im).rasterize( part, bbox );
+  for ( int32 r = 0; r < part.rows(); ++r )
+    for ( int32 c = 0; c < part.cols(); ++c )
+      EXPECT_EQ( cw(c+17,r+23), part(c,r) );
+}
+
 TEST( Manipulation, FlipVertView ) {
   ImageView<double> im(2,3); im(0,0)=1; im(1,0)=2; im(0,1)=3; im(1,1)=4; im(0,2)=5; im(1,2)=6;
   FlipVerticalView<ImageView<double> > rmv(im);
@@ -21,6 +21,9 @@
 
 #include <vw/Image/PerPixelViews.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/UtilityViews.h>
+#include <vw/Image/AlgorithmFunctions.h>
 #include <vw/Core/Functors.h>
 
 using namespace vw;
@@ -323,3 +326,50 @@ TEST( PerPixelView, UnaryIndex ) {
   ASSERT_TRUE( bool_trait<IsImageView>(ppv) );
 }
 
+
+TEST( PerPixelView, RowFusion ) {
+  ImageView<float> a(7,5,2), b(7,5,2);
+  for ( int32 p = 0; p < a.planes(); ++p )
+    for ( int32 j = 0; j < a.rows(); ++j )
+      for ( int32 i = 0; i < a.cols(); ++i ) {
+        a(i,j,p) = float(i + 10*j + 100*p);
+        b(i,j,p) = float(3*i - j + p) / 4;
+      }
+
+  // Crops of a binary view of unary views of ImageViews, the shape
+  // that ImageMath expressions produce.
+  typedef UnaryPerPixelView<ImageView<float>,float(*)(float)> SquareT;
+  typedef BinaryPerPixelView<SquareT,ImageView<float>,float(*)(float,float)> MultT;
+  MultT mult( SquareT(a,&square<float>), b, &multiply<float> );
+  CropView<MultT> view( mult, 1, 2, 5, 3 );
+  EXPECT_TRUE( bool_trait<IsRowEvaluable>(mult) );
+  EXPECT_TRUE( bool_trait<IsRowEvaluable>(view) );
+
+  // The fused path must agree with the generic accessor path.
+  ImageView<float> fused = view, generic(5,3,2);
+  vw::rasterize( view, generic, BBox2i(0,0,5,3) );
+  ASSERT_EQ( fused.planes(), 2 );
+  for ( int32 p = 0; p < 2; ++p )
+    for ( int32 j = 0; j < 3; ++j )
+      for ( int32 i = 0; i < 5; ++i ) {
+        EXPECT_EQ( generic(i,j,p), fused(i,j,p) );
+        EXPECT_EQ( square(a(i+1,j+2,p))*b(i+1,j+2,p), fused(i,j,p) );
+      }
+
+  // A partial bbox, written into a crop of a larger destination.
+  ImageView<double> big(8,8,2);
+  fill( big, -1.0 );
+  crop( big, 2, 3, 3, 2 ) = crop( view, 1, 1, 3, 2 );
+  EXPECT_EQ( -1.0, big(1,3,0) );
+  EXPECT_EQ( -1.0, big(5,4,1) );
+  EXPECT_EQ( double(fused(1,1,0)), big(2,3,0) );
+  EXPECT_EQ( double(fused(3,2,1)), big(4,4,1) );
+
+  // Views over non-memory data are not fused but still work.
+  typedef PerPixelIndexView<ConstantIndexFunctor<float> > ConstT;
+  ConstT c = constant_view( 2.0f, 7, 5, 2 );
+  BinaryPerPixelView<ConstT,ImageView<float>,float(*)(float,float)> cv( c, b, &multiply<float> );
+  EXPECT_FALSE( bool_trait<IsRowEvaluable>(cv) );
+  ImageView<float> cvi = cv;
+  EXPECT_EQ( 2*b(3,4), cvi(3,4) );
+}
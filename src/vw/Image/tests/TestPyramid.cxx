@@ -0,0 +1,150 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/Pyramid.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelTypes.h>
+
+using namespace vw;
+using namespace vw::test;
+
+template <class PixelT>
+static ImageView<PixelT> ramp( int32 cols, int32 rows ) {
+  ImageView<PixelT> image( cols, rows );
+  for ( int32 r = 0; r < rows; ++r )
+    for ( int32 c = 0; c < cols; ++c )
+      image(c,r) = PixelT( (c*37 + r*11) % 200 );
+  return image;
+}
+
+template <class PixelT>
+static void check_subsample_by_two( int32 cols, int32 rows, std::vector<float> const& kernel ) {
+  ImageView<PixelT> image = ramp<PixelT>( cols, rows );
+  ImageView<PixelT> expected = subsample( separable_convolution_filter( image, kernel, kernel ), 2 );
+  ImageView<PixelT> result   = subsample_by_two( image, kernel );
+  ASSERT_EQ( expected.cols(), result.cols() );
+  ASSERT_EQ( expected.rows(), result.rows() );
+  for ( int32 r = 0; r < result.rows(); ++r )
+    for ( int32 c = 0; c < result.cols(); ++c )
+      EXPECT_EQ( expected(c,r), result(c,r) ) << c << "," << r;
+}
+
+TEST( Pyramid, SubsampleByTwo ) {
+  std::vector<float> kernel;
+  generate_gaussian_kernel( kernel, 1.2, 7 );
+  check_subsample_by_two<float>( 64, 48, kernel );
+  check_subsample_by_two<float>( 31, 17, kernel );
+  check_subsample_by_two<uint8>( 33, 20, kernel );
+  check_subsample_by_two<PixelGray<float> >( 20, 21, kernel );
+  check_subsample_by_two<PixelRGB<uint16> >( 15, 9, kernel );
+
+  // Even sized kernels and kernels wider than the image.
+  std::vector<float> even( 4, 0.25f );
+  check_subsample_by_two<float>( 25, 14, even );
+  check_subsample_by_two<float>( 3, 2, kernel );
+}
+
+TEST( Pyramid, SubsampleByTwoMasked ) {
+  ImageView<PixelMask<float> > image( 9, 8 );
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c ) {
+      image(c,r) = PixelMask<float>( 10.0f );
+      if ( c < 4 )
+        image(c,r).invalidate();
+    }
+  image(7,4) = PixelMask<float>( 20.0f );
+
+  std::vector<float> kernel( 3, 1.0f );
+  ImageView<PixelMask<float> > result = subsample_by_two( image, kernel );
+  ASSERT_EQ( 5, result.cols() );
+  ASSERT_EQ( 4, result.rows() );
+  // Invalid pixels don't pull the average down, and are invalid only
+  // where nothing valid is under the kernel.
+  EXPECT_FALSE( is_valid( result(0,0) ) );
+  EXPECT_FALSE( is_valid( result(1,0) ) );
+  EXPECT_TRUE ( is_valid( result(2,0) ) );
+  EXPECT_NEAR( 10.0, result(2,0).child(), 1e-5 );
+  EXPECT_NEAR( 10.0 + 10.0/9, result(3,2).child(), 1e-5 );
+}
+
+TEST( Pyramid, BoxSubsample ) {
+  ImageView<float> image( 6, 4 );
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c )
+      image(c,r) = float( c + 10*r );
+  ImageView<float> result = box_subsample( image, Vector2i(2,2) );
+  ASSERT_EQ( 3, result.cols() );
+  ASSERT_EQ( 2, result.rows() );
+  EXPECT_NEAR(  5.5, result(0,0), 1e-5 );
+  EXPECT_NEAR( 29.5, result(2,1), 1e-5 );
+
+  // Nodata pixels are left out of the average.
+  image(0,0) = -1; image(1,0) = -1; image(0,1) = -1;
+  image(4,2) = -1; image(5,2) = -1; image(4,3) = -1; image(5,3) = -1;
+  result = box_subsample( image, Vector2i(2,2), -1 );
+  EXPECT_NEAR( 11.0, result(0,0), 1e-5 );
+  EXPECT_EQ  ( -1,   result(2,1) );
+  EXPECT_NEAR(  7.5, result(1,0), 1e-5 );
+
+  // And so are invalid pixels.
+  ImageView<PixelMask<uint8> > masked( 4, 2 );
+  masked(0,0) = PixelMask<uint8>( 10 );
+  masked(1,1) = PixelMask<uint8>( 21 );
+  ImageView<PixelMask<uint8> > mresult = box_subsample( masked, Vector2i(2,2) );
+  ASSERT_EQ( 2, mresult.cols() );
+  EXPECT_TRUE ( is_valid( mresult(0,0) ) );
+  EXPECT_EQ   ( 15, mresult(0,0).child() );
+  EXPECT_FALSE( is_valid( mresult(1,0) ) );
+}
+
+TEST( Pyramid, SubsampleMaskByTwo ) {
+  ImageView<uint8> mask( 5, 3 );
+  mask(0,0) = 255; mask(1,1) = 255;   // Two of four: on
+  mask(2,0) = 255;                    // One of four: off
+  mask(4,0) = 255; mask(4,1) = 255;   // Past the right edge
+  mask(0,2) = 255; mask(1,2) = 255;   // Past the bottom edge
+  ImageView<uint8> result = subsample_mask_by_two( mask );
+  ASSERT_EQ( 3, result.cols() );
+  ASSERT_EQ( 2, result.rows() );
+  EXPECT_EQ( 255, result(0,0) );
+  EXPECT_EQ( 0,   result(1,0) );
+  EXPECT_EQ( 255, result(2,0) );
+  EXPECT_EQ( 255, result(0,1) );
+  EXPECT_EQ( 0,   result(1,1) );
+}
+
+TEST( Pyramid, Levels ) {
+  ImageView<float> image = ramp<float>( 37, 20 );
+  std::vector<float> kernel;
+  generate_gaussian_kernel( kernel, 1.0, 5 );
+  std::vector<ImageView<float> > smoothed = smoothed_pyramid( image, kernel, 3 );
+  ASSERT_EQ( 4u, smoothed.size() );
+  EXPECT_EQ( 37, smoothed[0].cols() );
+  EXPECT_EQ( 10, smoothed[2].cols() );
+  EXPECT_EQ( 5,  smoothed[3].cols() );
+  EXPECT_EQ( 3,  smoothed[3].rows() );
+
+  std::vector<ImageView<float> > box = box_pyramid( image, 2 );
+  ASSERT_EQ( 3u, box.size() );
+  EXPECT_EQ( 9, box[2].cols() );
+  EXPECT_EQ( 5, box[2].rows() );
+}
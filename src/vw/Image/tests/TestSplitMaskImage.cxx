@@ -0,0 +1,94 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/SplitMaskImage.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/MaskViews.h>
+
+using namespace vw;
+using namespace vw::test;
+
+template <class PixelT>
+static void expect_same( ImageView<PixelMask<PixelT> > const& expected, SplitMaskImage<PixelT> const& image ) {
+  ASSERT_EQ( expected.cols(), image.cols() );
+  ASSERT_EQ( expected.rows(), image.rows() );
+  for ( int32 r = 0; r < image.rows(); ++r )
+    for ( int32 c = 0; c < image.cols(); ++c ) {
+      EXPECT_EQ( is_valid(expected(c,r)), is_valid(image(c,r)) ) << c << "," << r;
+      EXPECT_EQ( expected(c,r).child(), image(c,r).child() ) << c << "," << r;
+    }
+}
+
+TEST( SplitMaskImage, RoundTrip ) {
+  ImageView<PixelMask<float> > masked( 300, 250 );
+  for ( int32 r = 0; r < masked.rows(); ++r )
+    for ( int32 c = 0; c < masked.cols(); ++c ) {
+      masked(c,r) = PixelMask<float>( c + 0.5f*r );
+      if ( (c*7 + r*3) % 5 == 0 )
+        masked(c,r).invalidate();
+    }
+
+  // More than one strip of rows.
+  SplitMaskImage<float> split = masked;
+  expect_same( masked, split );
+  EXPECT_EQ( 0, split.mask()(0,0) );
+  EXPECT_EQ( 1, split.mask()(1,0) );
+
+  // Reading through views and accessors.
+  ImageView<PixelMask<float> > back = split;
+  expect_same( back, split );
+  ImageView<float> filled = apply_mask( crop( split, 10, 20, 50, 40 ), -1 );
+  for ( int32 r = 0; r < filled.rows(); ++r )
+    for ( int32 c = 0; c < filled.cols(); ++c )
+      EXPECT_EQ( is_valid(masked(c+10,r+20)) ? masked(c+10,r+20).child() : -1, filled(c,r) );
+  ImageViewRef<PixelMask<float> > ref = split;
+  EXPECT_EQ( masked(7,3).child(), ref(7,3).child() );
+
+  // Assigning a view which reads from the image itself.
+  split = copy_mask( split.data() + 1, split );
+  for ( int32 r = 0; r < split.rows(); ++r )
+    for ( int32 c = 0; c < split.cols(); ++c ) {
+      EXPECT_EQ( is_valid(masked(c,r)), is_valid(split(c,r)) );
+      EXPECT_EQ( masked(c,r).child() + 1, split(c,r).child() );
+    }
+}
+
+TEST( SplitMaskImage, Vector2f ) {
+  SplitMaskImage<Vector2f> disparity( 4, 3 );
+  EXPECT_FALSE( is_valid( disparity(2,1) ) );
+  disparity.set( 2, 1, PixelMask<Vector2f>( Vector2f(1.5, -2) ) );
+  EXPECT_TRUE( is_valid( disparity(2,1) ) );
+  EXPECT_VECTOR_EQ( Vector2f(1.5, -2), disparity(2,1).child() );
+
+  // An unmasked view makes every pixel valid.
+  ImageView<Vector2f> plain( 4, 3 );
+  fill( plain, Vector2f(3, 4) );
+  disparity = plain;
+  for ( int32 r = 0; r < 3; ++r )
+    for ( int32 c = 0; c < 4; ++c )
+      EXPECT_TRUE( is_valid( disparity(c,r) ) );
+
+  // Values and flags take less memory than interleaved masks.
+  EXPECT_EQ( 12u, sizeof(PixelMask<Vector2f>) );
+  EXPECT_EQ( 9u,  sizeof(Vector2f) + sizeof(uint8) );
+}
@@ -527,6 +527,73 @@ TEST( Statistics, OptimalThreshold ) {
   EXPECT_NEAR(t, t0, 1e-15);
 }
 
+TEST(BlockOperations, SummaryStatistics) {
+
+  // A masked float image with some invalid pixels.
+  const int size = 300;
+  ImageView<PixelMask<float> > image(size,size);
+  for (int i=0; i<size; ++i) {
+    for (int j=0; j<size; ++j) {
+      image(i,j) = float((i*7 + j*13) % 101) - 20.5f;
+      if ((i+j) % 17 == 0)
+        image(i,j).invalidate();
+    }
+  }
+
+  vw::math::SummaryAccumulator stats;
+  block_summary_statistics(image, stats, Vector2i(64,64));
+
+  size_t count = 0;
+  for (int i=0; i<size; ++i)
+    for (int j=0; j<size; ++j)
+      count += is_valid(image(i,j));
+  EXPECT_EQ(count, stats.num_values());
+  EXPECT_EQ(min_channel_value(image), stats.minimum());
+  EXPECT_EQ(max_channel_value(image), stats.maximum());
+  EXPECT_NEAR(mean_channel_value  (image), stats.mean(),   1e-6);
+  EXPECT_NEAR(stddev_channel_value(image), stats.stddev(), 1e-6);
+  EXPECT_NEAR(median_channel_value(image), stats.quantile(0.5), 1.0);
+
+  // Compound pixels contribute every channel.
+  vw::math::SummaryAccumulator rgb_stats;
+  generate_data();
+  block_summary_statistics(imrgbf, rgb_stats, Vector2i(1,1));
+  EXPECT_EQ(min_channel_value (imrgbf), rgb_stats.minimum());
+  EXPECT_EQ(max_channel_value (imrgbf), rgb_stats.maximum());
+  EXPECT_NEAR(mean_channel_value(imrgbf), rgb_stats.mean(), 1e-6);
+}
+
+TEST(BlockOperations, QuantileSketch) {
+
+  // Values with a long tail and some invalid pixels.
+  const int size = 300;
+  ImageView<PixelMask<float> > image(size,size);
+  std::vector<float> values;
+  for (int i=0; i<size; ++i) {
+    for (int j=0; j<size; ++j) {
+      float v = float((i*7 + j*13) % 101);
+      image(i,j) = v*v*v;
+      if ((i+j) % 17 == 0)
+        image(i,j).invalidate();
+      else
+        values.push_back(v*v*v);
+    }
+  }
+  std::sort(values.begin(), values.end());
+
+  vw::math::QuantileSketch sketch;
+  block_quantile_sketch(image, sketch, Vector2i(64,64));
+  EXPECT_EQ(values.size(), sketch.num_values());
+  EXPECT_EQ(values.front(), sketch.quantile(0));
+  EXPECT_EQ(values.back(),  sketch.quantile(1));
+  for (int k = 1; k < 10; ++k) {
+    double q    = k / 10.0;
+    double rank = std::lower_bound(values.begin(), values.end(), float(sketch.quantile(q)))
+                - values.begin();
+    EXPECT_NEAR(q, rank / values.size(), 0.02);
+  }
+}
+
 TEST(BlockOperations, DISABLED_CDF) {
 
   const Vector2i block_size(128, 128);
@@ -0,0 +1,127 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <test/Helpers.h>
+#include <vw/Core/Thread.h>
+#include <vw/Image/TileSizeTuner.h>
+#include <vw/Image/BlockRasterize.h>
+
+using namespace vw;
+
+// A view with a fixed cost per rasterize call, like one which reads a
+// file or pads each tile, so that the largest tiles are the quickest.
+class SlowView : public ImageViewBase<SlowView> {
+  int32 m_cols, m_rows;
+public:
+  typedef float pixel_type;
+  typedef float result_type;
+  typedef ProceduralPixelAccessor<SlowView> pixel_accessor;
+
+  SlowView( int32 cols, int32 rows ) : m_cols(cols), m_rows(rows) {}
+  inline int32 cols  () const { return m_cols; }
+  inline int32 rows  () const { return m_rows; }
+  inline int32 planes() const { return 1; }
+  inline pixel_accessor origin() const { return pixel_accessor( *this ); }
+  inline result_type operator()( int32 i, int32 j, int32 /*p*/=0 ) const { return float(i + j); }
+
+  typedef SlowView prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& /*bbox*/ ) const {
+    Thread::sleep_ms( 5 );
+    return *this;
+  }
+  template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+};
+
+TEST( TileSizeTuner, Candidates ) {
+  TileSizeTuning tuning;
+  tuning.memory_budget = size_t(1) << 40;
+
+  // Only one size at or above the image is worth trying.
+  std::vector<int32> sizes = detail::tile_size_candidates( tuning, Vector2i(300,200), 4, 4 );
+  ASSERT_EQ( 4u, sizes.size() );
+  EXPECT_EQ( 64,  sizes[0] );
+  EXPECT_EQ( 512, sizes[3] );
+
+  // Two 512x512 float tiles per thread on 4 threads take 8 MB.
+  tuning.memory_budget = 8*512*512*4 - 1;
+  sizes = detail::tile_size_candidates( tuning, Vector2i(10000,10000), 4, 4 );
+  ASSERT_EQ( 3u, sizes.size() );
+  EXPECT_EQ( 256, sizes.back() );
+
+  // The smallest size is kept even when nothing fits.
+  tuning.memory_budget = 1;
+  sizes = detail::tile_size_candidates( tuning, Vector2i(10000,10000), 4, 4 );
+  ASSERT_EQ( 1u, sizes.size() );
+  EXPECT_EQ( 64, sizes[0] );
+}
+
+TEST( TileSizeTuner, SampleBoxes ) {
+  Vector2i image_size(300,100);
+  BBox2i image_bbox( Vector2i(), image_size );
+  std::vector<BBox2i> boxes = detail::tile_size_sample_boxes( image_size, 128, 4 );
+  ASSERT_EQ( 4u, boxes.size() );
+  for ( size_t i = 0; i < boxes.size(); ++i ) {
+    EXPECT_TRUE( image_bbox.contains( boxes[i] ) );
+    EXPECT_EQ( 128, boxes[i].width() );
+    EXPECT_EQ( 100, boxes[i].height() );
+  }
+  EXPECT_LT( boxes.front().min().x(), boxes.back().min().x() );
+}
+
+TEST( TileSizeTuner, Choose ) {
+  std::vector<TileSizeSample> samples;
+  TileSizeSample s;
+  s.tiles = 4; s.threads = 4;
+  // Each sample is one round of 4 tiles.  A 1024x1024 image on 16
+  // threads is 16 rounds of 64 pixel tiles, and one round of 256 or
+  // 512 pixel tiles, the 512 ones leaving 12 threads idle.
+  s.size = 64;  s.seconds = 0.2; samples.push_back( s );
+  s.size = 256; s.seconds = 0.5; samples.push_back( s );
+  s.size = 512; s.seconds = 1.5; samples.push_back( s );
+  EXPECT_EQ( 256, detail::choose_tile_size( samples, Vector2i(1024,1024), 16 ) );
+
+  // On one thread it is 16 tiles of 256 against 4 of 512.
+  EXPECT_EQ( 512, detail::choose_tile_size( samples, Vector2i(1024,1024), 1 ) );
+}
+
+TEST( TileSizeTuner, Tune ) {
+  SlowView view( 256, 256 );
+  TileSizeTuning tuning;
+  tuning.candidates.clear();
+  tuning.candidates.push_back( 16 );
+  tuning.candidates.push_back( 32 );
+  tuning.candidates.push_back( 64 );
+  tuning.memory_budget = size_t(1) << 30;
+  EXPECT_VECTOR_EQ( Vector2i(64,64), tune_tile_size( view, 2, tuning ) );
+}
+
+TEST( TileSizeTuner, AutoBlockSize ) {
+  SlowView view( 64, 64 );
+  bool auto_tile_size = vw_settings().auto_tile_size();
+
+  vw_settings().set_auto_tile_size( false );
+  EXPECT_VECTOR_EQ( Vector2i(), auto_block_size( view, Vector2i(), 1 ) );
+  vw_settings().set_auto_tile_size( true );
+  EXPECT_VECTOR_EQ( Vector2i(32,16), auto_block_size( view, Vector2i(32,16), 1 ) );
+  // The image fits in the smallest candidate, so nothing is timed.
+  EXPECT_VECTOR_EQ( Vector2i(64,64), auto_block_size( view, Vector2i(), 1 ) );
+
+  vw_settings().set_auto_tile_size( auto_tile_size );
+}
@@ -19,6 +19,8 @@
 #include <test/Helpers.h>
 
 #include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/MaskViews.h>
 #include <vw/Image/Transform.h>
 
 using namespace vw;
@@ -202,3 +204,166 @@ TEST( Transform, FreeForward ) {
                         tx.forward(tx.reverse(Vector2(i*i,i))), 1e-3 );
   }
 }
+
+// A smooth warp with a tear along x = 40, counting its reverse() calls.
+class FoldTransform : public TransformBase<FoldTransform> {
+public:
+  boost::shared_ptr<int> calls;
+  FoldTransform() : calls(new int(0)) {}
+  inline Vector2 reverse( const Vector2& p ) const {
+    ++*calls;
+    double x = p.x() + 0.5*sin(p.y()/20) + 1e-3*p.x()*p.y();
+    if ( p.x() > 40 )
+      x += 3;
+    return Vector2( x, p.y() + 0.3*cos(p.x()/15) );
+  }
+};
+
+TEST( Transform, AdaptiveApproximate ) {
+  FoldTransform tx;
+  tx.set_tolerance( 0.1 );
+  BBox2i bbox( 3, 5, 100, 70 );
+  AdaptiveApproximateTransform<FoldTransform> approx( tx, bbox );
+
+  // Far fewer exact evaluations than pixels.
+  int setup_calls = *tx.calls;
+  EXPECT_LT( setup_calls, bbox.width()*bbox.height()/4 );
+
+  // Only the cells on the tear need the exact transform.
+  EXPECT_EQ( 5u, approx.num_exact_cells() );
+
+  FoldTransform exact;
+  for ( int32 y = bbox.min().y(); y < bbox.max().y(); ++y )
+    for ( int32 x = bbox.min().x(); x < bbox.max().x(); ++x )
+      EXPECT_VECTOR_NEAR( exact.reverse(Vector2(x,y)), approx.reverse(Vector2(x,y)), 0.1 );
+
+  // An affine transform is exact at the coarsest grid.
+  TranslateTransform shift( 2.5, -1 );
+  shift.set_tolerance( 0.1 );
+  AdaptiveApproximateTransform<TranslateTransform> approx_shift( shift, BBox2i(0,0,64,64) );
+  EXPECT_EQ( 0u, approx_shift.num_exact_cells() );
+  EXPECT_VECTOR_NEAR( Vector2(56.5,64), approx_shift.reverse(Vector2(59,63)), 1e-9 );
+}
+
+TEST( Transform, ApproximateRasterize ) {
+  ImageView<float> im(60,50);
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x )
+      im(x,y) = float(x + 2*y);
+
+  FoldTransform tx;
+  ImageView<float> exact = transform( im, tx );
+  tx.set_tolerance( 0.05 );
+  *tx.calls = 0;
+  ImageView<float> approx = transform( im, tx );
+  // A third of the image lies on the tear and is computed exactly.
+  EXPECT_LT( *tx.calls, im.cols()*im.rows()*3/4 );
+
+  // Compare where the source position is away from the zero edge.
+  FoldTransform exact_tx;
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x ) {
+      Vector2 src = exact_tx.reverse( Vector2(x,y) );
+      if ( src.x() >= 1 && src.x() < im.cols()-2 && src.y() >= 1 && src.y() < im.rows()-2 ) {
+        EXPECT_NEAR( exact(x,y), approx(x,y), 0.2 );
+      }
+    }
+}
+
+TEST( Transform, RowRasterize ) {
+  ImageView<PixelRGB<float> > im(40,30);
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x )
+      im(x,y) = PixelRGB<float>( x*y, x-y, (x*7+y*3) % 11 );
+
+  // Rasterizing into an ImageView takes the batched row path; the
+  // accessor evaluates one point at a time.
+  FoldTransform tx;
+  TransformView<InterpolationView<EdgeExtensionView<ImageView<PixelRGB<float> >, ConstantEdgeExtension>, BicubicInterpolation>, FoldTransform>
+    view = transform( im, tx, ConstantEdgeExtension(), BicubicInterpolation() );
+  ImageView<PixelRGB<float> > out = view;
+  ASSERT_EQ( im.cols(), out.cols() );
+  for ( int32 y = 0; y < out.rows(); ++y )
+    for ( int32 x = 0; x < out.cols(); ++x )
+      EXPECT_PIXEL_NEAR( view(x,y), out(x,y), 1e-4 );
+
+  ImageView<PixelRGB<float> > part(10,8);
+  view.rasterize( part, BBox2i(25,20,10,8) );
+  for ( int32 y = 0; y < part.rows(); ++y )
+    for ( int32 x = 0; x < part.cols(); ++x )
+      EXPECT_PIXEL_NEAR( view(x+25,y+20), part(x,y), 1e-4 );
+
+  // Scalar pixels use the vectorized kernel.
+  ImageView<float> gray = select_channel( im, 1 );
+  ImageView<float> gray_out = transform( gray, tx, ConstantEdgeExtension(), BicubicInterpolation() );
+  for ( int32 y = 0; y < out.rows(); ++y )
+    for ( int32 x = 0; x < out.cols(); ++x )
+      EXPECT_NEAR( out(x,y)[1], gray_out(x,y), 1e-4 );
+}
+
+// FoldTransform with a batch reverse, counting the batches.
+class BatchFoldTransform : public FoldTransform {
+public:
+  boost::shared_ptr<int> batches;
+  BatchFoldTransform() : batches(new int(0)) {}
+  void reverse_points( std::vector<Vector2> const& points, std::vector<Vector2>& result ) const {
+    ++*batches;
+    result.resize( points.size() );
+    for ( size_t k = 0; k < points.size(); ++k )
+      result[k] = reverse( points[k] );
+  }
+};
+
+namespace vw {
+  template <> struct HasBatchReverse<BatchFoldTransform> : public true_type {};
+}
+
+TEST( Transform, BatchReverse ) {
+  ImageView<float> im(60,50);
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x )
+      im(x,y) = float(x + 2*y);
+
+  // Exact rasterization goes a row at a time, even with bilinear
+  // interpolation.
+  FoldTransform    tx;
+  BatchFoldTransform batch_tx;
+  ImageView<float> expected = transform( im, tx );
+  ImageView<float> result   = transform( im, batch_tx );
+  EXPECT_EQ( im.rows(), *batch_tx.batches );
+  EXPECT_EQ( *tx.calls, *batch_tx.calls );
+  for ( int32 y = 0; y < im.rows(); ++y )
+    for ( int32 x = 0; x < im.cols(); ++x )
+      EXPECT_EQ( expected(x,y), result(x,y) );
+
+  // The approximation computes its exact points in batches too.
+  BBox2i bbox( 3, 5, 100, 70 );
+  tx.set_tolerance( 0.1 );
+  batch_tx.set_tolerance( 0.1 );
+  *batch_tx.batches = 0;
+  AdaptiveApproximateTransform<FoldTransform>      approx( tx, bbox );
+  AdaptiveApproximateTransform<BatchFoldTransform> batch_approx( batch_tx, bbox );
+  EXPECT_GT( *batch_tx.batches, 0 );
+  EXPECT_EQ( approx.num_exact_cells(), batch_approx.num_exact_cells() );
+  for ( int32 y = bbox.min().y(); y < bbox.max().y(); ++y )
+    for ( int32 x = bbox.min().x(); x < bbox.max().x(); ++x )
+      EXPECT_VECTOR_EQ( approx.reverse(Vector2(x,y)), batch_approx.reverse(Vector2(x,y)) );
+}
+
+TEST( Transform, SparseCheck ) {
+  // A small image in the corner of a large, otherwise empty canvas,
+  // seen through a reference.
+  ImageView<float> im(10,10);
+  ImageViewRef<float> canvas = crop( edge_extend( im, ZeroEdgeExtension() ), BBox2i(0,0,1000,1000) );
+  EXPECT_TRUE ( sparse_check( canvas, BBox2i(5,5,20,20) ) );
+  EXPECT_FALSE( sparse_check( canvas, BBox2i(500,500,100,100) ) );
+
+  // The check passes through the transform, the masks and another
+  // reference, so empty tiles are found without rasterizing them.
+  ImageViewRef<float> moved = apply_mask( create_mask( transform( canvas, TranslateTransform(100,50) ), 0.0f ) );
+  EXPECT_TRUE ( sparse_check( moved, BBox2i(100,50,10,10) ) );
+  EXPECT_TRUE ( sparse_check( moved, BBox2i(0,0,256,256) ) );
+  EXPECT_FALSE( sparse_check( moved, BBox2i(0,0,50,50) ) );
+  EXPECT_FALSE( sparse_check( moved, BBox2i(256,256,256,256) ) );
+  EXPECT_FALSE( sparse_check( moved, BBox2i(2000,0,10,10) ) );
+}
@@ -0,0 +1,318 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/config.h>
+#include <vw/Core/CpuFeatures.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/InterestPoint/BinaryDescriptor.h>
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+  #define VW_BINARY_DESCRIPTOR_X86_DISPATCH 1
+  #include <immintrin.h> // Only used after checking the CPU
+#endif
+
+namespace vw {
+namespace ip {
+
+namespace {
+
+  void hamming_distances_generic(uint64 const* query, uint64 const* rows,
+                                 size_t num_rows, size_t num_words, uint32* dists) {
+    for (size_t i=0; i<num_rows; ++i)
+      dists[i] = static_cast<uint32>(binary_hamming_distance(query, rows + i*num_words, num_words));
+  }
+
+#if defined(VW_BINARY_DESCRIPTOR_X86_DISPATCH)
+  __attribute__((target("popcnt")))
+  void hamming_distances_popcnt(uint64 const* query, uint64 const* rows,
+                                size_t num_rows, size_t num_words, uint32* dists) {
+    for (size_t i=0; i<num_rows; ++i) {
+      uint64 const* row = rows + i*num_words;
+      uint64 dist = 0;
+      for (size_t w=0; w<num_words; ++w)
+        dist += __builtin_popcountll(query[w] ^ row[w]);
+      dists[i] = static_cast<uint32>(dist);
+    }
+  }
+
+  /// Four words at a time.  The bytes are counted with a nibble lookup
+  /// table and summed with psadbw, the tail is handled with a masked load.
+  __attribute__((target("avx2")))
+  void hamming_distances_avx2(uint64 const* query, uint64 const* rows,
+                              size_t num_rows, size_t num_words, uint32* dists) {
+    const __m256i lookup = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                            0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i zero     = _mm256_setzero_si256();
+
+    // Load masks for a partial block of 1, 2 or 3 words.
+    const size_t tail = num_words % 4;
+    const __m256i tail_mask = _mm256_setr_epi64x(tail > 0 ? -1 : 0, tail > 1 ? -1 : 0,
+                                                 tail > 2 ? -1 : 0, 0);
+    const size_t full_blocks = num_words / 4;
+
+    for (size_t i=0; i<num_rows; ++i) {
+      uint64 const* row = rows + i*num_words;
+      __m256i sum = zero;
+      for (size_t b=0; b<=full_blocks; ++b) {
+        __m256i q, r;
+        if (b < full_blocks) {
+          q = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(query + 4*b));
+          r = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(row   + 4*b));
+        } else {
+          if (tail == 0)
+            break;
+          q = _mm256_maskload_epi64(reinterpret_cast<long long const*>(query + 4*b), tail_mask);
+          r = _mm256_maskload_epi64(reinterpret_cast<long long const*>(row   + 4*b), tail_mask);
+        }
+        const __m256i v   = _mm256_xor_si256(q, r);
+        const __m256i lo  = _mm256_and_si256(v, low_mask);
+        const __m256i hi  = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        const __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+                                            _mm256_shuffle_epi8(lookup, hi));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(cnt, zero));
+      }
+      const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sum),
+                                         _mm256_extracti128_si256(sum, 1));
+      dists[i] = static_cast<uint32>(_mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1));
+    }
+  }
+#endif
+
+  typedef void (*HammingFunc)(uint64 const*, uint64 const*, size_t, size_t, uint32*);
+
+  CpuDispatch<HammingFunc> hamming_dispatch() {
+    CpuDispatch<HammingFunc> dispatch(&hamming_distances_generic);
+#if defined(VW_BINARY_DESCRIPTOR_X86_DISPATCH)
+    dispatch.add(CPU_AVX2,   &hamming_distances_avx2)
+            .add(CPU_POPCNT, &hamming_distances_popcnt);
+#endif
+    return dispatch;
+  }
+
+  /// Bits [start, start+length) of a packed descriptor, length <= 32.
+  inline uint32 extract_bits(uint64 const* words, size_t start, size_t length) {
+    const size_t word  = start / 64;
+    const size_t shift = start % 64;
+    uint64 bits = words[word] >> shift;
+    if (shift + length > 64)
+      bits |= words[word+1] << (64 - shift);
+    return static_cast<uint32>(bits & ((uint64(1) << length) - 1));
+  }
+
+  /// One multi-index hashing table: the (substring, descriptor index)
+  /// pairs of a train set, sorted by substring.
+  typedef std::pair<uint32, uint32> HashEntry;
+  typedef std::vector<HashEntry>    HashTable;
+
+  struct HashKeyLess {
+    bool operator()(HashEntry const& a, uint32 b) const { return a.first < b; }
+    bool operator()(uint32 a, HashEntry const& b) const { return a < b.first; }
+  };
+
+  /// Record two-nearest-neighbor candidates.
+  inline void update_nearest(uint32 dist, size_t index,
+                             uint32& best0, size_t& index0, uint32& best1) {
+    if (dist < best0) {
+      best1  = best0;
+      best0  = dist;
+      index0 = index;
+    } else if (dist < best1) {
+      best1 = dist;
+    }
+  }
+
+} // end anonymous namespace
+
+
+//-----------------------------------------------------------
+// BinaryDescriptorSet
+
+template <class ListT>
+void BinaryDescriptorSet::pack_list(ListT const& ip_list) {
+  m_num_bytes = m_num_words = 0;
+  if (ip_list.empty())
+    return;
+  set_num_bytes(ip_list.begin()->size());
+  reserve(ip_list.size());
+  for (typename ListT::const_iterator i = ip_list.begin(); i != ip_list.end(); ++i) {
+    VW_ASSERT( i->size() == m_num_bytes,
+               ArgumentErr() << "BinaryDescriptorSet: descriptors differ in length." );
+    push_back_float(m_num_bytes ? &(i->descriptor[0]) : 0);
+  }
+}
+
+BinaryDescriptorSet::BinaryDescriptorSet(InterestPointList const& ip_list) {
+  pack_list(ip_list);
+}
+
+BinaryDescriptorSet::BinaryDescriptorSet(std::vector<InterestPoint> const& ip_list) {
+  pack_list(ip_list);
+}
+
+BinaryDescriptorSet::BinaryDescriptorSet(InterestPointSet const& ip_set) {
+  set_num_bytes(ip_set.descriptor_length());
+  reserve(ip_set.size());
+  for (size_t i = 0; i < ip_set.size(); ++i)
+    push_back_float(ip_set.descriptor_data(i));
+}
+
+void BinaryDescriptorSet::set_num_bytes(size_t num_bytes) {
+  VW_ASSERT( empty(), LogicErr() << "BinaryDescriptorSet: cannot change the length of a non-empty set." );
+  m_num_bytes = num_bytes;
+  m_num_words = (num_bytes + 7) / 8;
+}
+
+void BinaryDescriptorSet::push_back(uint8 const* bytes) {
+  for (size_t w = 0; w < m_num_words; ++w) {
+    uint64 word = 0;
+    const size_t count = std::min(size_t(8), m_num_bytes - 8*w);
+    for (size_t k = 0; k < count; ++k)
+      word |= uint64(bytes[8*w + k]) << (8*k);
+    m_words.push_back(word);
+  }
+}
+
+void BinaryDescriptorSet::push_back_float(float const* values) {
+  for (size_t w = 0; w < m_num_words; ++w) {
+    uint64 word = 0;
+    const size_t count = std::min(size_t(8), m_num_bytes - 8*w);
+    for (size_t k = 0; k < count; ++k)
+      word |= uint64(static_cast<uint8>(values[8*w + k])) << (8*k);
+    m_words.push_back(word);
+  }
+}
+
+
+//-----------------------------------------------------------
+// Hamming distances
+
+void binary_hamming_distances(uint64 const* query, uint64 const* rows,
+                              size_t num_rows, size_t num_words, uint32* dists) {
+  static const CpuDispatch<HammingFunc> dispatch = hamming_dispatch();
+  dispatch.select()(query, rows, num_rows, num_words, dists);
+}
+
+
+//-----------------------------------------------------------
+// BinaryDescriptorMatcher
+
+BinaryDescriptorMatcher::BinaryDescriptorMatcher(double threshold, int num_hash_tables,
+                                                 int probe_radius)
+  : m_threshold(threshold), m_num_hash_tables(num_hash_tables), m_probe_radius(probe_radius) {
+  VW_ASSERT( num_hash_tables >= 0,
+             ArgumentErr() << "BinaryDescriptorMatcher: num_hash_tables must not be negative." );
+  VW_ASSERT( probe_radius == 0 || probe_radius == 1,
+             ArgumentErr() << "BinaryDescriptorMatcher: probe_radius must be 0 or 1." );
+}
+
+void BinaryDescriptorMatcher::operator()( BinaryDescriptorSet const& query,
+                                          BinaryDescriptorSet const& train,
+                                          std::vector<size_t>& index_list,
+                                          const ProgressCallback &progress_callback) const {
+  const size_t NO_MATCH = size_t(-1);
+  index_list.assign(query.size(), NO_MATCH);
+  if (query.empty() || train.size() < 2) {
+    progress_callback.report_finished();
+    return;
+  }
+  VW_ASSERT( query.num_bytes() == train.num_bytes(),
+             ArgumentErr() << "BinaryDescriptorMatcher: descriptor lengths differ." );
+
+  const size_t num_words  = train.words_per_descriptor();
+  const size_t num_train  = train.size();
+  const uint32 MAX_DIST   = std::numeric_limits<uint32>::max();
+  const float  inc_amt    = 1.0f/float(query.size());
+  progress_callback.report_progress(0);
+
+  // Build the multi-index hashing tables.  The substrings are as equal
+  // in length as possible and must fit in 32 bits.
+  const size_t num_bits   = train.num_bits();
+  const size_t num_tables = std::min(size_t(m_num_hash_tables), num_bits);
+  std::vector<size_t>    sub_start, sub_length;
+  std::vector<HashTable> tables(num_tables);
+  uint32 unseen_bound = MAX_DIST; // Unseen train descriptors are at least this far away
+  if (num_tables > 0) {
+    for (size_t t = 0; t < num_tables; ++t) {
+      sub_start.push_back (num_bits *  t    / num_tables);
+      sub_length.push_back(num_bits * (t+1) / num_tables - sub_start.back());
+      VW_ASSERT( sub_length.back() <= 32,
+                 ArgumentErr() << "BinaryDescriptorMatcher: use at least " << (num_bits+31)/32
+                               << " hash tables for " << num_bits << " bit descriptors." );
+      tables[t].reserve(num_train);
+      for (size_t i = 0; i < num_train; ++i)
+        tables[t].push_back(HashEntry(extract_bits(train.data(i), sub_start[t], sub_length[t]),
+                                      uint32(i)));
+      std::sort(tables[t].begin(), tables[t].end());
+    }
+    unseen_bound = uint32(num_tables * (m_probe_radius + 1));
+    vw_out(DebugMessage, "interest_point") << "Built " << num_tables
+                                           << " binary descriptor hash tables.\n";
+  }
+
+  std::vector<uint32> dists(num_tables > 0 ? 0 : num_train);
+  std::vector<size_t> visited(num_tables > 0 ? num_train : 0, NO_MATCH);
+
+  for (size_t q = 0; q < query.size(); ++q) {
+    if (progress_callback.abort_requested())
+      vw_throw( Aborted() << "Aborted by ProgressCallback" );
+    progress_callback.report_incremental_progress(inc_amt);
+
+    uint64 const* query_data = query.data(q);
+    uint32 best0 = MAX_DIST, best1 = MAX_DIST;
+    size_t index0 = NO_MATCH;
+
+    if (num_tables == 0) {
+      // Exhaustive search
+      binary_hamming_distances(query_data, train.data(0), num_train, num_words, &dists[0]);
+      for (size_t i = 0; i < num_train; ++i)
+        update_nearest(dists[i], i, best0, index0, best1);
+    } else {
+      // Probe each table with the query substring and, for probe_radius 1,
+      // with every one bit variation of it.
+      for (size_t t = 0; t < num_tables; ++t) {
+        const uint32 key = extract_bits(query_data, sub_start[t], sub_length[t]);
+        const size_t num_probes = (m_probe_radius > 0) ? sub_length[t] + 1 : 1;
+        for (size_t p = 0; p < num_probes; ++p) {
+          const uint32 probe = (p == 0) ? key : (key ^ (uint32(1) << (p-1)));
+          std::pair<HashTable::const_iterator, HashTable::const_iterator> range =
+            std::equal_range(tables[t].begin(), tables[t].end(), probe, HashKeyLess());
+          for (HashTable::const_iterator it = range.first; it != range.second; ++it) {
+            const size_t i = it->second;
+            if (visited[i] == q)
+              continue;
+            visited[i] = q;
+            update_nearest(uint32(binary_hamming_distance(query_data, train.data(i), num_words)),
+                           i, best0, index0, best1);
+          }
+        }
+      }
+      best1 = std::min(best1, unseen_bound);
+    }
+
+    if (index0 != NO_MATCH && best0 < m_threshold * best1)
+      index_list[q] = index0;
+  }
+  progress_callback.report_finished();
+}
+
+}} // namespace vw::ip
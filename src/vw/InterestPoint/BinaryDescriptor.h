@@ -0,0 +1,143 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BinaryDescriptor.h
+///
+/// Packed storage and Hamming distance matching for binary descriptors
+/// such as ORB and BRISK.
+///
+#ifndef __VW_INTERESTPOINT_BINARYDESCRIPTOR_H__
+#define __VW_INTERESTPOINT_BINARYDESCRIPTOR_H__
+
+#include <vector>
+
+#include <vw/Core/ProgressCallback.h>
+#include <vw/Math/Functions.h>
+#include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+
+namespace vw {
+namespace ip {
+
+  /// A set of binary descriptors packed into 64 bit words.
+  ///
+  /// Each descriptor takes num_bytes() bytes, stored little-endian in
+  /// words_per_descriptor() uint64 words.  The unused high bytes of the
+  /// last word are zero.  This is 32 times smaller than storing every
+  /// byte as a float in InterestPoint::descriptor.
+  class BinaryDescriptorSet {
+  public:
+
+    BinaryDescriptorSet() : m_num_bytes(0), m_num_words(0) {}
+
+    /// Pack the descriptors of a list or vector of interest points.  The
+    /// OpenCV binary detectors store each descriptor byte as one float in
+    /// the range [0, 255].
+    explicit BinaryDescriptorSet(InterestPointList          const& ip_list);
+    explicit BinaryDescriptorSet(std::vector<InterestPoint> const& ip_list);
+
+    /// Pack the descriptors of an InterestPointSet.
+    explicit BinaryDescriptorSet(InterestPointSet const& ip_set);
+
+    size_t size                () const { return m_num_words ? m_words.size() / m_num_words : 0; }
+    bool   empty               () const { return m_words.empty(); }
+    size_t num_bytes           () const { return m_num_bytes; }
+    size_t num_bits            () const { return 8*m_num_bytes; }
+    size_t words_per_descriptor() const { return m_num_words; }
+
+    void clear() { m_words.clear(); }
+    void reserve(size_t num_descriptors) { m_words.reserve(num_descriptors*m_num_words); }
+
+    /// Append a descriptor of num_bytes() raw bytes.  A row of an OpenCV
+    /// CV_8U descriptor matrix can be passed directly.
+    void push_back(uint8 const* bytes);
+
+    /// Append a descriptor stored as num_bytes() floats holding byte values.
+    void push_back_float(float const* values);
+
+    /// The packed words of descriptor i.
+    uint64 const* data(size_t i) const { return &m_words[i*m_num_words]; }
+
+    /// Byte k of descriptor i.
+    uint8 byte(size_t i, size_t k) const {
+      return uint8(data(i)[k/8] >> (8*(k%8)));
+    }
+
+    /// Set the descriptor length.  Only allowed while the set is empty.
+    void set_num_bytes(size_t num_bytes);
+
+  private:
+    template <class ListT>
+    void pack_list(ListT const& ip_list);
+
+    size_t              m_num_bytes, m_num_words;
+    std::vector<uint64> m_words;
+  };
+
+  /// Hamming distance between two packed descriptors of num_words words.
+  inline size_t binary_hamming_distance(uint64 const* a, uint64 const* b, size_t num_words) {
+    size_t dist = 0;
+    for (size_t w = 0; w < num_words; ++w)
+      dist += vw::hamming_distance(a[w], b[w]);
+    return dist;
+  }
+
+  /// Compute dists[i] = binary_hamming_distance(query, rows + i*num_words, num_words)
+  /// for each i < num_rows.
+  /// - Uses AVX2 or the popcnt instruction when the CPU supports them.
+  void binary_hamming_distances(uint64 const* query, uint64 const* rows,
+                                size_t num_rows, size_t num_words, uint32* dists);
+
+  /// Nearest neighbor matcher for binary descriptors.
+  ///
+  /// For each query descriptor the two nearest train descriptors are
+  /// found, and a match is kept if dist0 < threshold * dist1.  This is
+  /// the same ratio test that InterestPointMatcher uses with HammingMetric.
+  ///
+  /// By default every query is compared with every train descriptor.  If
+  /// num_hash_tables > 0, multi-index hashing is used instead.  Each
+  /// descriptor is split into num_hash_tables substrings, and each
+  /// substring has its own hash table.  Only train descriptors whose
+  /// substrings are within probe_radius (0 or 1) bits of the query's in
+  /// at least one table are compared.  By the pigeonhole principle this
+  /// finds every train descriptor closer than
+  /// num_hash_tables * (probe_radius + 1) bits.  Unseen descriptors can
+  /// only be farther than that, so it is used as a lower bound for dist1.
+  /// So every match that is kept is at the nearest distance, and passes
+  /// the ratio test, exactly as with an exhaustive search.  Matches whose
+  /// distances are close to that bound may be missed.
+  class BinaryDescriptorMatcher {
+  public:
+    BinaryDescriptorMatcher(double threshold = 0.8, int num_hash_tables = 0,
+                            int probe_radius = 1);
+
+    /// Write to index_list, for each query descriptor, the index of its
+    /// match in train, or size_t(-1) if there is none.
+    void operator()( BinaryDescriptorSet const& query, BinaryDescriptorSet const& train,
+                     std::vector<size_t>& index_list,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+  private:
+    double m_threshold;
+    int    m_num_hash_tables;
+    int    m_probe_radius;
+  };
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_BINARYDESCRIPTOR_H__
@@ -57,10 +57,19 @@ namespace ip {
     }
 
     /// Overload that takes the list of IP's as two iterators.
+    /// - The region covering all of the supports is converted to float
+    ///   and rasterized once, then the points are described from it.
     template <class ViewT, class IterT>
     void operator() ( ImageViewBase<ViewT> const& image,
 		      IterT start, IterT end );
 
+    /// Overload for an image that is already a float buffer, such as
+    /// the tile crops made by describe_interest_points().  The points
+    /// are described straight from the buffer with no further copies.
+    template <class IterT>
+    void operator() ( ImageViewBase<ImageView<PixelGray<float> > > const& image,
+		      IterT start, IterT end );
+
     int support_size   () { return 41;  } ///< Default suport size ( i.e. descriptor window)
     int descriptor_size() { return 128; } ///< Default descriptor(vector) length
 
@@ -72,6 +81,27 @@ namespace ip {
     get_support( InterestPoint        const& pt,
 		 ImageViewBase<ViewT> const& source);
 
+    /// The transform from source image coordinates to support region
+    /// coordinates for an interest point.  The point location is taken
+    /// relative to origin.
+    AffineTransform support_transform( InterestPoint const& pt,
+				       Vector2i const& origin = Vector2i() );
+
+    /// The bounding box of the source pixels needed to describe the points.
+    template <class IterT>
+    BBox2i support_bbox( IterT start, IterT end );
+
+    /// Resample the support region of an interest point from a float
+    /// buffer into support, with the same result as rasterizing
+    /// get_support().  The buffer's pixel (0,0) sits at origin in the
+    /// interest point's coordinates.  The support image is only
+    /// reallocated when its size is wrong, so one image can be reused
+    /// for many points.
+    void extract_support( InterestPoint const& pt,
+			  ImageView<PixelGray<float> > const& source,
+			  Vector2i const& origin,
+			  ImageView<PixelGray<float> >& support );
+
     // All derived classes must implement this function:
     //   Given the support image for one feature point, compute all descriptor elements
     //    for that feature point.
@@ -80,6 +110,12 @@ namespace ip {
     // void compute_descriptor( ImageViewBase<ViewT> const& support,
     //                          IterT first, IterT last ) const;
 
+  private:
+    /// Describe the points from a float buffer whose pixel (0,0) is at origin.
+    template <class IterT>
+    void describe_buffer( ImageView<PixelGray<float> > const& buffer,
+			  Vector2i const& origin, IterT start, IterT end );
+
   }; // End class DescriptorGeneratorBase
 
 
@@ -306,22 +342,135 @@ void DescriptorGeneratorBase<ImplT>::operator() ( ImageViewBase<ViewT> const& im
 		  IterT start, IterT end ) {
   // Timing
   Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
+  if (start == end)
+    return;
+
+  // Rasterize the region holding every support at once.  If the points
+  // are spread over more than a tile's worth of pixels, rasterize each
+  // support region on its own instead so memory use stays bounded.
+  BBox2i bbox      = support_bbox(start, end);
+  int64  tile      = std::max(int64(vw_settings().default_tile_size()), int64(1024));
+  bool   per_point = int64(bbox.width()) * int64(bbox.height()) > tile * tile;
+  IterT  first     = start;
+  while (first != end) {
+    IterT last = end;
+    if (per_point) {
+      last = first;
+      ++last;
+      bbox = support_bbox(first, last);
+    }
+    ImageView<PixelGray<float> > buffer =
+      crop( edge_extend( pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())),
+			 ZeroEdgeExtension() ), bbox );
+    describe_buffer( buffer, bbox.min(), first, last );
+    first = last;
+  }
+}
 
-  // Loop through input IP's
-  for (InterestPointList::iterator i = start; i != end; ++i) {
-
-    // First we compute the support region based on the interest point and rasterize
-    //  it into an image buffer that the descriptor function can access.
-    ImageView<PixelGray<float> > support =
-      get_support(*i, pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())));
+template <class ImplT>
+template <class IterT>
+void DescriptorGeneratorBase<ImplT>::operator() ( ImageViewBase<ImageView<PixelGray<float> > > const& image,
+		  IterT start, IterT end ) {
+  // Timing
+  Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
+  describe_buffer( image.impl(), Vector2i(), start, end );
+}
 
-    // Next, we pass the support region and the interest point to
-    // the descriptor generator ( compute_descriptor() ) supplied by the subclass.
+template <class ImplT>
+template <class IterT>
+void DescriptorGeneratorBase<ImplT>::describe_buffer( ImageView<PixelGray<float> > const& buffer,
+						      Vector2i const& origin,
+						      IterT start, IterT end ) {
+  // One support image is reused for all of the points.
+  ImageView<PixelGray<float> > support( impl().support_size(), impl().support_size() );
+  for (IterT i = start; i != end; ++i) {
+    extract_support( *i, buffer, origin, support );
+
+    // Pass the support region to the descriptor generator
+    // ( compute_descriptor() ) supplied by the subclass.
     i->descriptor.set_size( impl().descriptor_size() );
     impl().compute_descriptor( support, i->begin(), i->end() );
   }
 }
 
+template <class ImplT>
+AffineTransform
+DescriptorGeneratorBase<ImplT>::support_transform( InterestPoint const& pt,
+						   Vector2i const& origin ) {
+  float  half_size = ((float)(impl().support_size() - 1)) / 2.0f;
+  float  scaling   = 1.0f / pt.scale;
+  double c         = cos(-pt.orientation), s=sin(-pt.orientation);
+  double x         = pt.x - origin.x(), y = pt.y - origin.y();
+
+  return AffineTransform( Matrix2x2(scaling*c, -scaling*s,
+				    scaling*s, scaling*c),
+			  Vector2(scaling*(s*y-c*x)+half_size,
+				  -scaling*(s*x+c*y)+half_size) );
+}
+
+template <class ImplT>
+template <class IterT>
+BBox2i DescriptorGeneratorBase<ImplT>::support_bbox( IterT start, IterT end ) {
+  BBox2i bbox;
+  BBox2i support( 0, 0, impl().support_size(), impl().support_size() );
+  for (IterT i = start; i != end; ++i)
+    bbox.grow( support_transform(*i).reverse_bbox( support ) );
+  bbox.expand( 1 );
+  return bbox;
+}
+
+namespace detail {
+  /// Read a pixel from a float buffer, returning zero outside of it.
+  inline float zero_extended( PixelGray<float> const* data, int32 cols, int32 rows,
+			      int32 x, int32 y ) {
+    if ( x < 0 || y < 0 || x >= cols || y >= rows )
+      return 0.0f;
+    return data[ ptrdiff_t(y) * cols + x ].v();
+  }
+}
+
+template <class ImplT>
+void DescriptorGeneratorBase<ImplT>::extract_support( InterestPoint const& pt,
+						      ImageView<PixelGray<float> > const& source,
+						      Vector2i const& origin,
+						      ImageView<PixelGray<float> >& support ) {
+  const int32 size = impl().support_size();
+  if ( support.cols() != size || support.rows() != size )
+    support.set_size( size, size );
+
+  // The source location of the support pixel (i,j) is base + i*dcol + j*drow.
+  AffineTransform tx = support_transform( pt, origin );
+  Vector2 base = tx.reverse( Vector2(0,0) );
+  Vector2 dcol = tx.reverse( Vector2(1,0) ) - base;
+  Vector2 drow = tx.reverse( Vector2(0,1) ) - base;
+
+  const int32 cols = source.cols(), rows = source.rows();
+  PixelGray<float> const* src = source.data();
+  PixelGray<float>      * dst = support.data();
+  for ( int32 j = 0; j < size; ++j ) {
+    double rx = base[0] + j*drow[0], ry = base[1] + j*drow[1];
+    for ( int32 i = 0; i < size; ++i, ++dst ) {
+      double x  = rx + i*dcol[0], y = ry + i*dcol[1];
+      int32  x0 = int32(floor(x)), y0 = int32(floor(y));
+      float  nx = float(x) - float(x0), ny = float(y) - float(y0);
+      float  p00, p10, p01, p11;
+      if ( x0 >= 0 && y0 >= 0 && x0 + 1 < cols && y0 + 1 < rows ) {
+	PixelGray<float> const* p = src + ptrdiff_t(y0) * cols + x0;
+	p00 = p[0].v();    p10 = p[1].v();
+	p01 = p[cols].v(); p11 = p[cols+1].v();
+      } else {
+	p00 = detail::zero_extended( src, cols, rows, x0,   y0   );
+	p10 = detail::zero_extended( src, cols, rows, x0+1, y0   );
+	p01 = detail::zero_extended( src, cols, rows, x0,   y0+1 );
+	p11 = detail::zero_extended( src, cols, rows, x0+1, y0+1 );
+      }
+      float top = p00 * (1 - nx) + p10 * nx;
+      float bot = p01 * (1 - nx) + p11 * nx;
+      dst->v() = top * (1 - ny) + bot * ny;
+    }
+  }
+}
+
 /// Get the size x size support region around an interest point,
 /// rescaled by the scale factor and rotated by the specified
 /// angle. Also, delay raster until assigment.
@@ -332,15 +481,7 @@ DescriptorGeneratorBase<ImplT>::get_support( InterestPoint const& pt,
 					     ImageViewBase<ViewT> const& source) {
 
   // Compute a fine image region based on the scaling parameters attached to the InterestPoint
-  float  half_size = ((float)(impl().support_size() - 1)) / 2.0f;
-  float  scaling   = 1.0f / pt.scale;
-  double c         = cos(-pt.orientation), s=sin(-pt.orientation);
-
-  return transform(source.impl(),
-		   AffineTransform( Matrix2x2(scaling*c, -scaling*s,
-					      scaling*s, scaling*c),
-				    Vector2(scaling*(s*pt.y-c*pt.x)+half_size,
-					    -scaling*(s*pt.x+c*pt.y)+half_size) ),
+  return transform(source.impl(), support_transform(pt),
 		   impl().support_size(), impl().support_size() );
 }
 
@@ -46,6 +46,7 @@
 #include "opencv2/imgproc.hpp"
 #include "opencv2/features2d.hpp"
 #include "opencv2/xfeatures2d.hpp"
+#include <vw/Image/ImageViewOpenCV.h>
 #endif
 
 namespace vw {
@@ -230,6 +231,8 @@ namespace ip {
   template <>           struct GetOpenCvPixelType<double        > { static const int type=CV_64FC1; };
 
   /// Get an OpenCV wrapper, rasterizing the VW image to a provided buffer.
+  /// - The wrapper shares the buffer's pixels, and the buffer shares the
+  ///   input's when it is already a uint8 ImageView and normalize is off.
   template <class ViewT>
   void get_opencv_wrapper(ImageViewBase<ViewT> const& input_image,
                           cv::Mat & cv_image,
@@ -319,6 +322,7 @@ namespace ip {
     ViewT              m_view;           ///< Source image
     DetectorT        & m_detector;       ///< Interest point detection class instance (TODO: const?)
     BBox2i             m_bbox;           ///< Region of the source image to check for points
+    int                m_overlap;        ///< Extra context pixels read around m_bbox
     int                m_desired_num_ip; 
     int                m_id, m_max_id;
     InterestPointList& m_global_points;
@@ -326,16 +330,19 @@ namespace ip {
 
   public:
     InterestPointDetectionTask(ImageViewBase<ViewT> const& view,
-                               DetectorT& detector, BBox2i const& bbox, 
+                               DetectorT& detector, BBox2i const& bbox, int overlap,
                                int desired_num_ip, int id, int max_id,
                                InterestPointList& global_list, OrderedWorkQueue& write_queue) :
-      m_view(view.impl()), m_detector(detector), m_bbox(bbox), 
+      m_view(view.impl()), m_detector(detector), m_bbox(bbox), m_overlap(overlap),
       m_desired_num_ip(desired_num_ip), m_id(id), m_max_id(max_id),
       m_global_points(global_list), m_write_queue(write_queue) {}
 
     virtual ~InterestPointDetectionTask(){}
 
     /// Find the IPs, then pass to an InterestPointWriteTask instance.
+    /// - The detector is run on m_bbox expanded by m_overlap so that filters
+    ///   and extrema checks near the tile seams see real image data, then
+    ///   only the points inside m_bbox are kept.
     void operator()();
 
     InterestPointList interest_point_list() { return m_global_points; }
@@ -354,6 +361,7 @@ namespace ip {
     InterestPointList & m_ip_list;
     std::vector<BBox2i> m_bboxes;
     int                 m_tile_size;
+    int                 m_tile_overlap;
     int                 m_desired_num_ip;
     Mutex               m_mutex;
     size_t              m_index;
@@ -364,7 +372,7 @@ namespace ip {
 
     InterestDetectionQueue( ImageViewBase<ViewT> const& view, DetectorT& detector,
                             OrderedWorkQueue& write_queue, InterestPointList& ip_list,
-                            int tile_size, int desired_num_ip=0 );
+                            int tile_size, int desired_num_ip=0, int tile_overlap=0 );
 
     size_t size() { return m_bboxes.size(); }
 
@@ -381,9 +389,16 @@ namespace ip {
   /// - Threads are spun off to process the image in 1024x1024 pixel blocks.
   /// - Pass in desired_num_ip to enforce this limit proportional to the tile size,
   ///   otherwise each tile will use the same number regardless of size.
+  /// - tile_overlap pixels of context are read around every tile so that points
+  ///   near tile seams are not lost to filter edge effects.  Each point is still
+  ///   reported by only the tile whose core contains it.
+  /// - If nms_radius > 0 the merged list is passed through cull_interest_points()
+  ///   with the tile grid as regions and desired_num_ip as the per-region cap,
+  ///   which removes near-duplicate responses across tile seams.
   template <class ViewT, class DetectorT>
   InterestPointList detect_interest_points(ImageViewBase<ViewT> const& view, DetectorT& detector,
-                                           int desired_num_ip=0);
+                                           int desired_num_ip=0, int tile_overlap=0,
+                                           double nms_radius=0);
 
 
 // Include all the function definitions
@@ -52,14 +52,34 @@ void InterestPointDetectionTask<ViewT, DetectorT>::operator()() {
                                         << m_id + 1 << "/" << m_max_id << "   [ " << m_bbox << 
                                         " ] with " << m_desired_num_ip << " ip.\n";
 
+  // Read some context around the tile, but not past the image edges.
+  BBox2i search_bbox = m_bbox;
+  search_bbox.expand(m_overlap);
+  search_bbox.crop(bounding_box(m_view.impl()));
+
+  // Ask for proportionally more points in the expanded region so that the
+  // core region still ends up with about m_desired_num_ip of them.
+  int search_num_ip = m_desired_num_ip;
+  if (m_desired_num_ip > 0 && search_bbox != m_bbox)
+    search_num_ip = int(ceil(double(m_desired_num_ip) * search_bbox.area() / m_bbox.area()));
+
   // Use the m_detector object to find a set of image points in the cropped section of the image.
-  InterestPointList new_ip_list = m_detector(crop(m_view.impl(), m_bbox), m_desired_num_ip);
+  InterestPointList new_ip_list = m_detector(crop(m_view.impl(), search_bbox), search_num_ip);
 
   for (InterestPointList::iterator pt = new_ip_list.begin(); pt != new_ip_list.end(); ++pt) {
-    (*pt).x  += m_bbox.min().x();
-    (*pt).ix += m_bbox.min().x();
-    (*pt).y  += m_bbox.min().y();
-    (*pt).iy += m_bbox.min().y();
+    (*pt).x  += search_bbox.min().x();
+    (*pt).ix += search_bbox.min().x();
+    (*pt).y  += search_bbox.min().y();
+    (*pt).iy += search_bbox.min().y();
+  }
+
+  // Points in the overlap belong to the neighboring tiles.
+  if (search_bbox != m_bbox) {
+    new_ip_list = crop(new_ip_list, BBox2(m_bbox));
+    if (m_desired_num_ip > 0 && new_ip_list.size() > size_t(m_desired_num_ip)) {
+      new_ip_list.sort();
+      new_ip_list.resize(m_desired_num_ip);
+    }
   }
 
   // Append these interest points to the master list
@@ -78,10 +98,10 @@ template <class ViewT, class DetectorT>
 InterestDetectionQueue<ViewT, DetectorT>::
 InterestDetectionQueue( ImageViewBase<ViewT> const& view, DetectorT& detector,
                         OrderedWorkQueue& write_queue, InterestPointList& ip_list,
-                        int tile_size, int desired_num_ip) :
+                        int tile_size, int desired_num_ip, int tile_overlap) :
      m_view(view.impl()), m_detector(detector),
      m_write_queue(write_queue), m_ip_list(ip_list), m_tile_size(tile_size), 
-     m_desired_num_ip(desired_num_ip), m_index(0) {
+     m_tile_overlap(tile_overlap), m_desired_num_ip(desired_num_ip), m_index(0) {
      
   m_bboxes = subdivide_bbox( m_view, tile_size, tile_size );
   this->notify();
@@ -114,7 +134,8 @@ InterestDetectionQueue<ViewT, DetectorT>::get_next_task() {
   }
 
   return boost::shared_ptr<Task>( new task_type( m_view, m_detector,
-                                                 m_bboxes[m_index-1], num_ip, m_index-1,
+                                                 m_bboxes[m_index-1], m_tile_overlap,
+                                                 num_ip, m_index-1,
                                                  m_bboxes.size(), m_ip_list, m_write_queue ) 
                                 );
 }
@@ -125,7 +146,7 @@ InterestDetectionQueue<ViewT, DetectorT>::get_next_task() {
 // detector.  Threads are spun off to process the image in 1024x1024 pixel blocks.
 template <class ViewT, class DetectorT>
 InterestPointList detect_interest_points (ImageViewBase<ViewT> const& view, DetectorT& detector,
-                                         int desired_num_ip) {
+                                         int desired_num_ip, int tile_overlap, double nms_radius) {
 
   VW_OUT(DebugMessage, "interest_point") << "Running multi-threaded interest point detector with ip/tile = "
                                          << desired_num_ip << ".  Input image: [ "
@@ -140,10 +161,16 @@ InterestPointList detect_interest_points (ImageViewBase<ViewT> const& view, Dete
   OrderedWorkQueue write_queue(1); // Used to insure that interest points are written in a
                                    // specific order and not by the random way threads finish.
   InterestPointList ip_list;
-  InterestDetectionQueue<ViewT, DetectorT> detect_queue( view, detector, write_queue, ip_list, tile_size, desired_num_ip );
+  InterestDetectionQueue<ViewT, DetectorT> detect_queue( view, detector, write_queue, ip_list,
+                                                         tile_size, desired_num_ip, tile_overlap );
   VW_OUT(DebugMessage, "interest_point") << "Waiting for threads to terminate.\n";
   detect_queue.join_all();
   write_queue.join_all();
+
+  // Suppress duplicate responses across tile seams and re-apply the
+  // per-tile cap to the merged list.
+  if (nms_radius > 0)
+    cull_interest_points(ip_list, nms_radius, tile_size, desired_num_ip);
   VW_OUT(DebugMessage, "interest_point") << "MT interest point detection complete.  "
                                          << ip_list.size() << " interest point detected.\n";
   return ip_list;
@@ -453,6 +480,10 @@ process_image(ImageViewBase<ViewT> const& image, int desired_num_ip) const {
     // Add newly found interest points
     points.splice(points.end(), new_points);
 
+    // Release this octave's interest data before the next octave is
+    // built, so only one octave of derived images is resident.
+    img_data.clear();
+
     // Build next octave of scale space
     if (o != m_octaves - 1) {
       vw_out(DebugMessage, "interest_point") << "\tBuilding next octave... ";
@@ -554,6 +585,20 @@ int ScaledInterestPointDetector<InterestT>::write_images(std::vector<DataT> cons
 
 #if defined(VW_HAVE_PKG_OPENCV) && VW_HAVE_PKG_OPENCV == 1
 
+namespace detail {
+  // Converts to uint8 using the default ranges for the input data type,
+  // which for uint8 pixels is no conversion at all.
+  template <class PixelT>
+  void opencv_uint8_buffer(ImageView<PixelT> const& input_buffer, ImageView<vw::uint8> &image_buffer) {
+    double standard_min = ChannelRange<PixelT>::min();
+    double standard_max = ChannelRange<PixelT>::max();
+    image_buffer = pixel_cast_rescale<vw::uint8>(clamp(input_buffer, standard_min, standard_max));
+  }
+  inline void opencv_uint8_buffer(ImageView<vw::uint8> const& input_buffer, ImageView<vw::uint8> &image_buffer) {
+    image_buffer = input_buffer;
+  }
+}
+
 template <class ViewT>
 void get_opencv_wrapper(ImageViewBase<ViewT> const& input_image,
                         cv::Mat & cv_image,
@@ -562,26 +607,16 @@ void get_opencv_wrapper(ImageViewBase<ViewT> const& input_image,
                         bool normalize) {
 
   // Rasterize the input image so we don't suffer from slow disk access or something.
+  // - An ImageView is only referenced, not copied.
   ImageView<typename ViewT::pixel_type> input_buffer = input_image.impl();
 
   if (normalize) // Convert the input image to uint8 with 2%-98% intensity scaling.
     percentile_scale_convert(input_buffer, image_buffer, 0.02, 0.98);
-  else {
-    // Convert to uint8 using the default ranges for the input data type
-    double standard_min = ChannelRange<typename ViewT::pixel_type>::min();
-    double standard_max = ChannelRange<typename ViewT::pixel_type>::max();
-    image_buffer = pixel_cast_rescale<vw::uint8>(clamp(input_buffer, standard_min, standard_max));
-  }
-
-  // Figure out the image buffer parameters
-  int     cv_data_type = GetOpenCvPixelType<vw::uint8>::type;
-  void*   raw_data_ptr = reinterpret_cast<void*>(image_buffer.data());
-  size_t  pixel_size   = sizeof(vw::uint8);
-  size_t  step_size    = image_buffer.cols() * pixel_size;
+  else
+    detail::opencv_uint8_buffer(input_buffer, image_buffer);
 
   // Create an OpenCV wrapper for the buffer image
-  cv_image = cv::Mat(image_buffer.rows(), image_buffer.cols(),
-                     cv_data_type, raw_data_ptr, step_size);
+  cv_image = opencv_wrap(image_buffer);
 
   if (input_image.channels() != 2) {
     // If there is no mask on the input image, use an empty mask.
@@ -592,15 +627,10 @@ void get_opencv_wrapper(ImageViewBase<ViewT> const& input_image,
   // Just make sure the masked input image pixels are zero to create the opencv mask
   ImageView<vw::uint8> mask_buffer = channel_cast_rescale<uint8>(select_channel(input_buffer, 1));
 
-  // Wrap our mask object with OpenCV
-  raw_data_ptr = reinterpret_cast<void*>(mask_buffer.data());
-  cv::Mat full_cv_mask(mask_buffer.rows(), mask_buffer.cols(),
-                       cv_data_type, raw_data_ptr, step_size);
-
-  // Use OpenCV call to erode some pixels off the mask
+  // Use OpenCV call to erode some pixels off the mask, straight from our buffer
   const int ERODE_RADIUS = 5;
   cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(ERODE_RADIUS, ERODE_RADIUS));
-  cv::erode(full_cv_mask, cv_mask, kernel);
+  cv::erode(opencv_wrap(mask_buffer), cv_mask, kernel);
 
   return;
 }
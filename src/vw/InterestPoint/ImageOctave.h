@@ -24,6 +24,8 @@
 #define __VW_INTERESTPOINT_IMAGEOCTAVE_H__
 
 // Vision Workbench
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Filter.h>
 #include <vw/FileIO/DiskImageResource.h>
@@ -31,6 +33,7 @@
 // STL
 #include <vector>
 #include <iostream>
+#include <algorithm>
 
 // Boost
 #include <boost/static_assert.hpp>
@@ -41,6 +44,21 @@
 
 namespace vw { namespace ip {
 
+/// Renders one plane of an ImageOctave by blurring a lower plane.
+template <class ViewT>
+class ImageOctavePlaneTask : public Task {
+  ViewT const& m_source;
+  ViewT      & m_dest;
+  float        m_sigma;
+public:
+  ImageOctavePlaneTask( ViewT const& source, ViewT& dest, float sigma )
+    : m_source(source), m_dest(dest), m_sigma(sigma) {}
+
+  virtual void operator()() {
+    m_dest = ViewT(vw::gaussian_filter(m_source, m_sigma));
+  }
+};
+
 /// This class provides functionality to construct an octave of images
 /// from one image, or to recursively (and destructively - use also
 /// ImageOctaveHistory to keep the entire pyramid) construct the
@@ -52,6 +70,12 @@ namespace vw { namespace ip {
 /// (x,y,s) directions, it constructs one plane above and one plane
 /// below the octave. If the scale ratio is 2^(1/P), the octave
 /// contains P+2 planes.
+///
+/// Each blurred plane is made directly from the octave's base planes
+/// with the combined sigma, not from the plane below it, so the planes
+/// do not depend on each other.  They are rendered in parallel with
+/// num_threads threads, which defaults to
+/// vw_settings().default_num_threads().
 template <class ViewT = ImageView<float> >
 class ImageOctave {
   BOOST_STATIC_ASSERT(IsImageView<ViewT>::value);
@@ -66,12 +90,15 @@ public:
   float sigma_ratio;         // Ratio of sigmas between levels:
   std::vector<float> sigma;  // Sigmas corresponding to scales
   std::vector<ViewT> scales; // Scaled images in the octave
+  int num_threads;           // Threads used to render the planes
 
   /// This constructor is intended for building the first octave from a
   /// source image.
   template <class ViewT_in>
-  ImageOctave( ImageViewBase<ViewT_in> const& src_im, int numscales) {
-    base_scale = 1;
+  ImageOctave( ImageViewBase<ViewT_in> const& src_im, int numscales,
+               int numthreads = vw_settings().default_num_threads() ) {
+    base_scale  = 1;
+    num_threads = numthreads;
     set_scales( numscales );
 
     build_using( src_im );
@@ -147,14 +174,9 @@ public:
       scales.push_back(ViewT(src_im.impl()));
     }
 
-    // Each next plane is blurred version of the previous
-    for (int i=1; i<num_planes; i++){
-      float use_sigma = sqrt( sigma[i]*sigma[i] - sigma[i-1]*sigma[i-1] );
-      vw::vw_out(VerboseDebugMessage, "interest_point") << "\tMaking plane " << i << " using sigma "
-                                      << use_sigma << " so final sigma is "
-                                      << sigma[i] << std::endl;
-      scales.push_back(ViewT(vw::gaussian_filter(scales[i-1], use_sigma)));
-    }
+    // The rest are blurred versions of plane 0
+    scales.resize(num_planes);
+    blur_planes(1);
 
     return 0;
   }
@@ -186,20 +208,41 @@ public:
     int source_for_new_1 = num_planes-1;
     scales[1] = ViewT(vw::subsample(scales[source_for_new_1], 2));
 
-    // Now the rest (#2 and up) are blurred versions as before
-    float use_sigma;
-    for (int k=2; k<num_planes; k++){
-      use_sigma = sqrt( sigma[k]*sigma[k] - sigma[k-1]*sigma[k-1] );
+    // Now the rest (#2 and up) are blurred versions of plane 1
+    blur_planes(2);
+
+    return 0;
+  }
+
+
+  /// Render planes first..num_planes-1 from plane first-1.  With
+  /// repeated Gaussian blurring the sigmas add in quadrature, so each
+  /// plane is blurred once with sqrt(sigma[k]^2 - sigma[first-1]^2).
+  /// This costs more per plane than blurring the plane below, but the
+  /// planes can then be rendered at the same time.
+  void blur_planes( int first ) {
+    const float base_sigma = sigma[first-1];
+    std::vector<boost::shared_ptr<Task> > tasks;
+    for (int k=first; k<num_planes; k++){
+      float use_sigma = sqrt( sigma[k]*sigma[k] - base_sigma*base_sigma );
       vw::vw_out(VerboseDebugMessage, "interest_point") << "\tMaking plane " << k << " using sigma "
                                       << use_sigma << " so final sigma is "
                                       << sigma[k] << std::endl;
-      scales[k] = ViewT(vw::gaussian_filter(scales[k-1], use_sigma));
+      tasks.push_back( boost::shared_ptr<Task>(
+        new ImageOctavePlaneTask<ViewT>( scales[first-1], scales[k], use_sigma ) ) );
     }
 
-    return 0;
+    if ( num_threads <= 1 || tasks.size() <= 1 ) {
+      for (size_t i=0; i<tasks.size(); i++)
+        (*tasks[i])();
+      return;
+    }
+    FifoWorkQueue queue( std::min( num_threads, int(tasks.size()) ) );
+    for (size_t i=0; i<tasks.size(); i++)
+      queue.add_task( tasks[i] );
+    queue.join_all();
   }
 
-
   /// Save image octave to a set of image files.
   void write_images() const
   {
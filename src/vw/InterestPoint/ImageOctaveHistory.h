@@ -38,14 +38,20 @@ namespace ip {
 /// The image in the scale space pyramid most closely corresponding
 /// to a particular scale can be retrieved with the
 /// image_at_scale method.
+///
+/// Every octave is kept by default.  If max_octaves is positive, only
+/// the most recent max_octaves octaves stay resident.  The planes of
+/// older octaves are released, and asking for them throws.
 template <class ImageT>
 class ImageOctaveHistory : std::vector<std::vector<ImageT> > {
  private:
   int num_scales;
+  int max_resident;
 
  public:
   /// Construct an empty ImageOctaveHistory.
-  ImageOctaveHistory() : std::vector<std::vector<ImageT> >(0), num_scales(0) {}
+  explicit ImageOctaveHistory(int max_octaves = 0)
+    : std::vector<std::vector<ImageT> >(0), num_scales(0), max_resident(max_octaves) {}
 
   /// Number of octaves recorded.
   inline int octaves() const { return this->size(); }
@@ -60,6 +66,13 @@ class ImageOctaveHistory : std::vector<std::vector<ImageT> > {
   inline void add_octave(const std::vector<ImageT>& octave) {
     this->push_back(octave);
     num_scales = octave.size() - 2;
+    if (max_resident > 0 && octaves() > max_resident)
+      std::vector<ImageT>().swap((*this)[octaves() - max_resident - 1]);
+  }
+
+  /// True if the planes of an octave are still held.
+  inline bool is_resident(int octave) const {
+    return octave >= 0 && octave < octaves() && !(*this)[octave].empty();
   }
 
   /// Retrieve image data most closely matching a given scale.
@@ -69,6 +82,8 @@ class ImageOctaveHistory : std::vector<std::vector<ImageT> > {
     if (octave == octaves()) octave = octaves() - 1;
     VW_ASSERT( (octave >= 0) && (octave < octaves()) , ArgumentErr()
                << "ImageOctaveHistory::image_at_scale: No image matching scale.");
+    VW_ASSERT( is_resident(octave), ArgumentErr()
+               << "ImageOctaveHistory::image_at_scale: Octave " << octave << " has been released.");
     // TODO: move this outside ImageOctave
     int plane = ImageOctave<ImageT>::scale_to_plane_index(1 << octave, num_scales, scale);
     VW_ASSERT( (plane >= 0) && (plane < scales() + 2) , ArgumentErr()
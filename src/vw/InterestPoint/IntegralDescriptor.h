@@ -34,9 +34,6 @@ namespace ip {
 
   template <class ImplT>
   class IntegralDescriptorGeneratorBase {
-
-    ImageView<double> m_integral;
-
   public:
 
     // Methods to access the derived type
@@ -57,12 +54,25 @@ namespace ip {
       // Timing
       Timer total("\tTotal elapsed time", DebugMessage, "interest_point");
 
-      m_integral = IntegralImage(pixel_cast<double>(channel_cast<double>(image.impl())));
+      // The integral is local so that one generator can be shared by
+      // the tile tasks in describe_interest_points().
+      ImageView<double> integral =
+        integral_image<double>(pixel_cast<double>(channel_cast<double>(image.impl())));
+      compute_descriptors( integral, start, end );
+    }
 
+    /// Set the descriptors of the points in [start, end) from an integral
+    /// image that was already built, such as the one passed to an integral
+    /// detector's process_integral().  The descriptors are normalized, so
+    /// the integral may be of a rescaled image, and a float integral can
+    /// be used in place of a double one.
+    template <class IntegralT, class IterT>
+    void compute_descriptors( ImageViewBase<IntegralT> const& integral,
+                              IterT start, IterT end ) {
       for (IterT i = start; i != end; i++ ) {
         // Wrapping integral image for interpolation
         i->descriptor.set_size( impl().descriptor_size() );
-        impl().compute_descriptor( interpolate(m_integral), *i );
+        impl().compute_descriptor( interpolate(integral.impl()), *i );
       }
     }
 
@@ -127,26 +127,37 @@ namespace ip {
     template <class ViewT>
     InterestPointList process_image(ImageViewBase<ViewT> const& image,
                                     int desired_num_ip=0 ) const {
-      typedef ImageView<typename PixelChannelType<PixelGray<float> >::type> ImageT;
-      typedef ImageInterestData<ImageT,InterestT> DataT;
-
-      Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
-
       // Rendering own standard copy of the image as the passed in view is just a cropview
       ImageView<PixelGray<float> > original_image = pixel_cast_rescale<PixelGray<float> >(image);
 
       // Producing Integral Image
-      ImageT integral_image;
+      ImageView<float> integral;
       {
         vw_out(DebugMessage, "interest_point") << "\tCreating Integral Image ...";
         Timer t("done, elapsed time", DebugMessage, "interest_point");
-        integral_image= IntegralImage( original_image );
+        integral = integral_image<float>( original_image );
       }
+      return process_integral( integral, desired_num_ip );
+    }
+
+    /// Detect Interest Points using an integral image that was already
+    /// built with integral_image<float>() from the rescaled source image.
+    /// The same integral can then be passed to an integral descriptor
+    /// generator's compute_descriptors().
+    InterestPointList process_integral(ImageView<float> const& integral_image,
+                                       int desired_num_ip=0 ) const {
+      typedef ImageView<float> ImageT;
+      typedef ImageInterestData<ImageT,InterestT> DataT;
+
+      Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
+
+      // The interest operator only reads the integral image.
+      ImageT empty_image;
 
       // Creating Scales
       std::deque<DataT> interest_data;
-      interest_data.push_back( DataT(original_image, integral_image) );
-      interest_data.push_back( DataT(original_image, integral_image) );
+      interest_data.push_back( DataT(empty_image, integral_image) );
+      interest_data.push_back( DataT(empty_image, integral_image) );
 
       // Priming scales
       InterestPointList new_points;
@@ -163,7 +174,7 @@ namespace ip {
       // Finally processing scales
       for ( int scale = 2; scale < m_scales; scale++ ) {
 
-        interest_data.push_back( DataT(original_image, integral_image) );
+        interest_data.push_back( DataT(empty_image, integral_image) );
         {
           vw_out(DebugMessage, "interest_point") << "\tScale " << scale << " ... ";
           Timer t("done, elapsed time", DebugMessage, "interest_point");
@@ -173,8 +184,8 @@ namespace ip {
         InterestPointList scale_points;
 
         // Detecting interest points in middle
-        int32 cols = original_image.cols() - 2;
-        int32 rows = original_image.rows() - 2;
+        int32 cols = integral_image.cols() - 3;
+        int32 rows = integral_image.rows() - 3;
         typedef typename DataT::interest_type::pixel_accessor AccessT;
 
         AccessT l_row = interest_data[0].interest().origin();
@@ -307,28 +318,39 @@ namespace ip {
     template <class ViewT>
     InterestPointList process_image(vw::ImageViewBase<ViewT> const& image,
                                     int desired_num_ip=0 ) const {
-      using namespace vw;
-      typedef ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type> ImageT;
-      typedef ip::ImageInterestData<ImageT,ip::OBALoGInterestOperator> DataT;
-      Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
+      typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
 
       // The input image is a lazy view. We'll rasterize so we're not
       // hitting the cache all of the image.
-      ImageT original_image = image.impl();
-
-      // The ImageInterestData structure doesn't really apply to
-      // OBALoG. We don't need access to the original image after
-      // we've made the integral image. To avoid excessive copying,
-      // we're making an empty image to feed that structure.
-      ImageT empty_image;
+      ImageView<channel_type> original_image = image.impl();
 
       // Producing Integral Image
-      ImageT integral_image;
+      ImageView<channel_type> integral;
       {
         vw_out(DebugMessage, "interest_point") << "\tCreating Integral Image ...";
         Timer t("done, elapsed time", DebugMessage, "interest_point");
-        integral_image = ip::IntegralImage( original_image );
+        integral = ip::integral_image<channel_type>( original_image );
       }
+      return process_integral( integral, desired_num_ip );
+    }
+
+    /// Detect Interest Points using an integral image that was already
+    /// built with integral_image<ChannelT>() from the source image.  The
+    /// same integral can then be passed to an integral descriptor
+    /// generator's compute_descriptors().
+    template <class ChannelT>
+    InterestPointList process_integral(ImageView<ChannelT> const& integral_image,
+                                       int desired_num_ip=0 ) const {
+      using namespace vw;
+      typedef ImageView<ChannelT> ImageT;
+      typedef ip::ImageInterestData<ImageT,ip::OBALoGInterestOperator> DataT;
+      Timer total("\t\tTotal elapsed time", DebugMessage, "interest_point");
+
+      // The ImageInterestData structure doesn't really apply to
+      // OBALoG. We don't need access to the original image after
+      // we've made the integral image. To avoid excessive copying,
+      // we're making an empty image to feed that structure.
+      ImageT empty_image;
 
       // Creating Scales
       std::deque<DataT> interest_data;
@@ -361,8 +383,8 @@ namespace ip {
         ip::InterestPointList scale_points;
 
         // Detecting interest points in middle
-        int32 cols = original_image.cols() - 2;
-        int32 rows = original_image.rows() - 2;
+        int32 cols = integral_image.cols() - 3;
+        int32 rows = integral_image.rows() - 3;
         typedef typename DataT::interest_type::pixel_accessor AccessT;
 
         AccessT l_row = interest_data[0].interest().origin();
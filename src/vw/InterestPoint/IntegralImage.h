@@ -24,68 +24,66 @@
 #ifndef __VW_INTERESTPOINT_INTEGRALIMAGE_H__
 #define __VW_INTERESTPOINT_INTEGRALIMAGE_H__
 
+#include <vector>
+#include <algorithm>
+
 #include <boost/utility/enable_if.hpp>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Image/ImageView.h>
+#include <vw/Image/PixelTypes.h>
 
 // TODO: Change the function names to meet the standard convention!
 
 namespace vw {
 namespace ip {
 
+  /// Create an integral image of an input image, summing in AccumT.
+  /// - The result is one pixel larger than the source in each direction,
+  ///   and result(x,y) is the sum of the source over [0,x) x [0,y).
+  /// - Use int64 for exact sums of integer images, or float for half the
+  ///   memory of double at some loss of precision on large images.
+  /// - Each row is the row above plus the running sums along the source
+  ///   row.  Both loops use plain pointers, and the row addition is
+  ///   vectorized by the compiler.
+  template <class AccumT, class ViewT>
+  ImageView<AccumT> integral_image( ImageViewBase<ViewT> const& source ) {
+    ViewT const& src  = source.impl();
+    const int32  cols = src.cols(), rows = src.rows();
+
+    ImageView<AccumT> integral( cols+1, rows+1 );
+    std::fill( &integral(0,0), &integral(0,0) + cols+1, AccumT(0) );
+
+    std::vector<AccumT> row_sums( cols );
+    typename ViewT::pixel_accessor src_row = src.origin();
+    for ( int32 y = 0; y < rows; y++ ) {
+      typename ViewT::pixel_accessor src_col = src_row;
+      AccumT sum = 0;
+      for ( int32 x = 0; x < cols; x++ ) {
+        sum += pixel_cast<PixelGray<AccumT> >(*src_col).v();
+        row_sums[x] = sum;
+        src_col.next_col();
+      }
+
+      AccumT const* above = &integral(0, y  );
+      AccumT      * dest  = &integral(0, y+1);
+      dest[0] = 0;
+      for ( int32 x = 0; x < cols; x++ )
+        dest[x+1] = above[x+1] + row_sums[x];
+      src_row.next_row();
+    }
+    return integral;
+  }
+
   /// Function to create an integral image of an input image.
   /// - Despite the caps, this is a function and IntegralImage is not a type!
   /// - An integral image can be used to quickly find regional sums using the function below.
+  /// - The sums use the channel type of the source.  Call integral_image()
+  ///   to choose another type.
   template <class ViewT>
   inline ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type>
   IntegralImage( ImageViewBase<ViewT> const& source ) {
-
     typedef typename PixelChannelType<typename ViewT::pixel_type>::type channel_type;
-
-    // Allocating space
-    ImageView<channel_type> integral( source.impl().cols()+1, source.impl().rows()+1 );
-
-    typedef typename ImageView<channel_type>::pixel_accessor dst_accessor;
-    typedef typename ViewT::pixel_accessor src_accessor;
-
-    // Zero-ing the first row and col
-    dst_accessor dest_row = integral.origin();
-    *dest_row = 0;
-    for ( int i = 1; i < integral.cols(); i++ ) {
-      dest_row.next_col();
-      *dest_row = 0;
-    }
-    dest_row = integral.origin();
-    for ( int i = 1; i < integral.rows(); i++ ) {
-      dest_row.next_row();
-      *dest_row = 0;
-    }
-
-    // Pointer and pointer offset
-    int offset = integral.cols();
-    channel_type* p;
-
-    // Now filling in integral image
-    dest_row = integral.origin();
-    dest_row.advance(1,1);
-    src_accessor src_row = source.impl().origin();
-    for ( int iy = 0; iy < source.impl().rows(); iy++ ) {
-      dst_accessor dest_col = dest_row;
-      src_accessor src_col = src_row;
-      for ( int ix = 0; ix < source.impl().cols(); ix++ ) {
-        p = &(*dest_col);
-
-        // Summing
-        *dest_col = pixel_cast<PixelGray<channel_type> >(*src_col).v() + *(p-1) + *(p-offset) - *(p-offset-1);
-
-        dest_col.next_col();
-      src_col.next_col();
-      }
-      dest_row.next_row();
-      src_row.next_row();
-    }
-
-    return integral;
+    return integral_image<channel_type>( source );
   } // End IntegralImage function
 
   /// Using an integral image, compute the summed value of a region in the original image.
@@ -21,7 +21,12 @@
 /// Basic classes and structures for storing image interest points.
 ///
 #include <fstream>
+#include <map>
+#include <algorithm>
+#include <cmath>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+#include <vw/InterestPoint/InterestPointFile.h>
 
 namespace vw {
 namespace ip {
@@ -68,8 +73,8 @@ namespace ip {
       f.write((char*)&(p.descriptor[i]), sizeof(p.descriptor[i]));
   }
 
-  inline InterestPoint read_ip_record(std::ifstream &f) {
-    InterestPoint ip;
+  /// Read one record into ip, reusing its descriptor storage if possible.
+  inline void read_ip_record(std::ifstream &f, InterestPoint& ip) {
     f.read((char*)&(ip.x), sizeof(ip.x));
     f.read((char*)&(ip.y), sizeof(ip.y));
     f.read((char*)&(ip.ix), sizeof(ip.ix));
@@ -83,12 +88,35 @@ namespace ip {
 
     uint64 size;
     f.read((char*)&(size), sizeof(uint64));
-    ip.descriptor = Vector<double>(size);
+    if (ip.descriptor.size() != size)
+      ip.descriptor.set_size(size);
     for (size_t i = 0; i < size; ++i)
       f.read((char*)&(ip.descriptor[i]), sizeof(ip.descriptor[i]));
+  }
+
+  inline InterestPoint read_ip_record(std::ifstream &f) {
+    InterestPoint ip;
+    read_ip_record(f, ip);
     return ip;
   }
 
+  /// Append count records from f to ips.
+  inline void read_ip_records(std::ifstream &f, uint64 count, InterestPointSet& ips,
+                              std::string const& filename) {
+    InterestPoint ip;
+    for (uint64 i = 0; i < count; ++i) {
+      read_ip_record(f, ip);
+      if (!f)
+        vw_throw( IOErr() << "Unexpected end of file while reading \"" << filename << "\"." );
+      if (!ips.empty() && ip.size() != ips.descriptor_length())
+        vw_throw( IOErr() << "\"" << filename << "\" mixes descriptor lengths and cannot be "
+                          << "loaded into an InterestPointSet." );
+      if (i == 0)
+        ips.reserve(count, ip.size());
+      ips.push_back(ip);
+    }
+  }
+
   void write_binary_ip_file(std::string ip_file, InterestPointList ip) {
     std::ofstream f;
     f.open(ip_file.c_str(), std::ios::binary | std::ios::out);
@@ -100,9 +128,31 @@ namespace ip {
     f.close();
   }
 
+  /// Append every point of one set of a versioned file to a list or vector.
+  template <class ContainerT>
+  void append_mapped_set(MappedInterestPointFile const& file, size_t set, ContainerT& result) {
+    const size_t length = file.descriptor_length(set);
+    for (size_t i = 0; i < file.size(set); ++i) {
+      InterestPointRecord const& r = file.record(i, set);
+      InterestPoint ip(r.x, r.y, r.scale, r.interest, r.orientation, r.polarity != 0,
+                       r.octave, r.scale_lvl);
+      ip.ix = r.ix;
+      ip.iy = r.iy;
+      ip.descriptor.set_size(length);
+      float const* desc = file.descriptor(i, set);
+      std::copy(desc, desc + length, ip.descriptor.begin());
+      result.push_back(ip);
+    }
+  }
+
   std::vector<InterestPoint> read_binary_ip_file(std::string ip_file) {
     std::vector<InterestPoint> result;
 
+    if (is_versioned_ip_file(ip_file)) {
+      append_mapped_set(MappedInterestPointFile(ip_file), 0, result);
+      return result;
+    }
+
     std::ifstream f;
     f.open(ip_file.c_str(), std::ios::binary | std::ios::in);
     if ( !f.is_open() )
@@ -118,6 +168,11 @@ namespace ip {
   InterestPointList read_binary_ip_file_list(std::string ip_file) {
     InterestPointList result;
 
+    if (is_versioned_ip_file(ip_file)) {
+      append_mapped_set(MappedInterestPointFile(ip_file), 0, result);
+      return result;
+    }
+
     std::ifstream f;
     f.open(ip_file.c_str(), std::ios::binary | std::ios::in);
     if ( !f.is_open() )
@@ -131,6 +186,31 @@ namespace ip {
     return result;
   }
 
+  void write_binary_ip_file(std::string ip_file, InterestPointSet const& ip) {
+    std::vector<InterestPointSet const*> sets(1, &ip);
+    write_versioned_ip_file(ip_file, sets);
+  }
+
+  InterestPointSet read_binary_ip_file_set(std::string ip_file) {
+    InterestPointSet result;
+
+    if (is_versioned_ip_file(ip_file)) {
+      MappedInterestPointFile(ip_file).load(result, 0);
+      return result;
+    }
+
+    std::ifstream f;
+    f.open(ip_file.c_str(), std::ios::binary | std::ios::in);
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open \"" << ip_file << "\" as VWIP file." );
+
+    uint64 size;
+    f.read((char*)&size, sizeof(uint64));
+    read_ip_records(f, size, result, ip_file);
+    f.close();
+    return result;
+  }
+
   // Routines for reading & writing interest point match files
   void write_binary_match_file(std::string match_file, std::vector<InterestPoint> const& ip1, std::vector<InterestPoint> const& ip2) {
     std::ofstream f;
@@ -152,6 +232,15 @@ namespace ip {
     ip1.clear();
     ip2.clear();
 
+    if (is_versioned_ip_file(match_file)) {
+      MappedInterestPointFile file(match_file);
+      if (file.num_sets() != 2)
+        vw_throw( IOErr() << "\"" << match_file << "\" is not a match file." );
+      append_mapped_set(file, 0, ip1);
+      append_mapped_set(file, 1, ip2);
+      return;
+    }
+
     std::ifstream f;
     f.open(match_file.c_str(), std::ios::binary | std::ios::in);
 
@@ -169,6 +258,43 @@ namespace ip {
     f.close();
   }
 
+  void write_binary_match_file(std::string match_file, InterestPointSet const& ip1,
+                               InterestPointSet const& ip2) {
+    std::vector<InterestPointSet const*> sets;
+    sets.push_back(&ip1);
+    sets.push_back(&ip2);
+    write_versioned_ip_file(match_file, sets);
+  }
+
+  void read_binary_match_file(std::string match_file, InterestPointSet& ip1,
+                              InterestPointSet& ip2) {
+    ip1.clear();
+    ip2.clear();
+
+    if (is_versioned_ip_file(match_file)) {
+      MappedInterestPointFile file(match_file);
+      if (file.num_sets() != 2)
+        vw_throw( IOErr() << "\"" << match_file << "\" is not a match file." );
+      file.load(ip1, 0);
+      file.load(ip2, 1);
+      return;
+    }
+
+    std::ifstream f;
+    f.open(match_file.c_str(), std::ios::binary | std::ios::in);
+
+    // Error Handling
+    if ( !f.is_open() )
+      vw_throw( IOErr() << "Failed to open match file: " << match_file );
+
+    uint64 size1, size2;
+    f.read((char*)&size1, sizeof(uint64));
+    f.read((char*)&size2, sizeof(uint64));
+    read_ip_records(f, size1, ip1, match_file);
+    read_ip_records(f, size2, ip2, match_file);
+    f.close();
+  }
+
   std::vector<Vector3> iplist_to_vectorlist(std::vector<InterestPoint> const& iplist) {
     std::vector<Vector3> result(iplist.size());
     for (size_t i=0; i < iplist.size(); ++i) {
@@ -189,6 +315,91 @@ namespace ip {
     return result;
   }
 */
+  namespace {
+    // Orders list iterators by descending interest, like InterestPoint::operator<.
+    struct InterestIterGreater {
+      bool operator()(InterestPointList::iterator const& a,
+                      InterestPointList::iterator const& b) const {
+        return b->interest < a->interest;
+      }
+    };
+
+    typedef std::pair<int,int> CellIndex;
+
+    inline CellIndex cell_of(float x, float y, double cell_size) {
+      return CellIndex(int(floor(x / cell_size)), int(floor(y / cell_size)));
+    }
+  }
+
+  void cull_interest_points(InterestPointList& interest_points, double nms_radius,
+                            int region_size, int max_per_region) {
+
+    const bool use_nms     = nms_radius > 0;
+    const bool use_regions = (region_size > 0) && (max_per_region > 0);
+    if (!use_nms && !use_regions)
+      return;
+
+    // Visit the points strongest first.  The stable sort keeps ties in
+    // their list order so the result is repeatable.
+    std::vector<InterestPointList::iterator> order;
+    order.reserve(interest_points.size());
+    for (InterestPointList::iterator i = interest_points.begin(); i != interest_points.end(); ++i)
+      order.push_back(i);
+    std::stable_sort(order.begin(), order.end(), InterestIterGreater());
+
+    // Kept points are hashed into nms_radius sized cells so that only the
+    // 3x3 neighborhood of cells has to be searched for each candidate.
+    std::map<CellIndex, std::vector<InterestPointList::iterator> > kept_cells;
+    std::map<CellIndex, int> region_counts;
+    std::vector<InterestPointList::iterator> rejected;
+    const double radius_sq = nms_radius * nms_radius;
+
+    for (size_t n = 0; n < order.size(); ++n) {
+      InterestPointList::iterator ip = order[n];
+
+      CellIndex region;
+      if (use_regions) {
+        region = cell_of(ip->x, ip->y, region_size);
+        if (region_counts[region] >= max_per_region) {
+          rejected.push_back(ip);
+          continue;
+        }
+      }
+
+      if (use_nms) {
+        CellIndex cell = cell_of(ip->x, ip->y, nms_radius);
+        bool suppressed = false;
+        for (int dy = -1; dy <= 1 && !suppressed; ++dy) {
+          for (int dx = -1; dx <= 1 && !suppressed; ++dx) {
+            std::map<CellIndex, std::vector<InterestPointList::iterator> >::const_iterator it
+              = kept_cells.find(CellIndex(cell.first + dx, cell.second + dy));
+            if (it == kept_cells.end())
+              continue;
+            for (size_t k = 0; k < it->second.size(); ++k) {
+              double ddx = it->second[k]->x - ip->x;
+              double ddy = it->second[k]->y - ip->y;
+              if (ddx*ddx + ddy*ddy <= radius_sq) {
+                suppressed = true;
+                break;
+              }
+            }
+          }
+        }
+        if (suppressed) {
+          rejected.push_back(ip);
+          continue;
+        }
+        kept_cells[cell].push_back(ip);
+      }
+
+      if (use_regions)
+        region_counts[region]++;
+    }
+
+    for (size_t n = 0; n < rejected.size(); ++n)
+      interest_points.erase(rejected[n]);
+  }
+
   /// Helpful functors
   void remove_descriptor( InterestPoint & ip ) { ip.descriptor.set_size(0); }
 
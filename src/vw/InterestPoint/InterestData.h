@@ -207,6 +207,17 @@ namespace ip {
     return return_val;
   }
 
+  /// Merge-time cleanup for interest points collected from many tiles.
+  /// - Points are visited in descending order of interest.
+  /// - A point is dropped if a stronger kept point lies within nms_radius
+  ///   pixels of it (global non-maximum suppression, off if nms_radius <= 0).
+  /// - At most max_per_region points are kept in each region_size square
+  ///   cell of the image, so that the strongest features of a single
+  ///   high-texture area cannot crowd out the rest (off if either is <= 0).
+  /// The surviving points keep their original relative order.
+  void cull_interest_points(InterestPointList& interest_points, double nms_radius,
+                            int region_size=0, int max_per_region=0);
+
   /// Helpful functors
   void remove_descriptor( InterestPoint & ip );
 
@@ -0,0 +1,224 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/InterestPoint/InterestPointFile.h>
+
+#include <fstream>
+#include <cstring>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace io = boost::iostreams;
+
+namespace vw {
+namespace ip {
+
+namespace {
+
+  const char   IP_FILE_MAGIC[8]    = {'V','W','I','P','S','E','T','\0'};
+  const uint32 IP_FILE_VERSION     = 2;
+  const size_t IP_FILE_HEADER_SIZE = 32;
+
+  struct InterestPointFileHeader {
+    char   magic[8];
+    uint32 version;
+    uint32 record_size;
+    uint64 num_sets;
+    uint64 reserved;
+  };
+
+  inline uint64 align_up(uint64 offset, uint64 alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+  }
+
+  void write_padding(std::ofstream& f, uint64 target) {
+    static const char zeros[64] = {0};
+    uint64 pos = static_cast<uint64>(f.tellp());
+    while (pos < target) {
+      uint64 count = std::min<uint64>(target - pos, sizeof(zeros));
+      f.write(zeros, count);
+      pos += count;
+    }
+  }
+
+} // end anonymous namespace
+
+
+bool is_versioned_ip_file(std::string const& filename) {
+  std::ifstream f(filename.c_str(), std::ios::binary | std::ios::in);
+  char magic[8];
+  if (!f.read(magic, sizeof(magic)))
+    return false;
+  return std::memcmp(magic, IP_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+void write_versioned_ip_file(std::string const& filename,
+                             std::vector<InterestPointSet const*> const& sets) {
+  std::ofstream f(filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!f.is_open())
+    vw_throw( IOErr() << "Failed to open \"" << filename << "\" for writing." );
+
+  InterestPointFileHeader header;
+  std::memcpy(header.magic, IP_FILE_MAGIC, sizeof(header.magic));
+  header.version     = IP_FILE_VERSION;
+  header.record_size = sizeof(InterestPointRecord);
+  header.num_sets    = sets.size();
+  header.reserved    = 0;
+
+  // Lay out the blocks before writing anything.
+  std::vector<InterestPointBlockInfo> blocks(sets.size());
+  uint64 offset = IP_FILE_HEADER_SIZE + sets.size()*sizeof(InterestPointBlockInfo);
+  for (size_t s = 0; s < sets.size(); ++s) {
+    blocks[s].num_points         = sets[s]->size();
+    blocks[s].descriptor_length  = sets[s]->descriptor_length();
+    blocks[s].records_offset     = align_up(offset, 8);
+    offset = blocks[s].records_offset + blocks[s].num_points*sizeof(InterestPointRecord);
+    blocks[s].descriptors_offset = align_up(offset, 64);
+    offset = blocks[s].descriptors_offset
+           + blocks[s].num_points*blocks[s].descriptor_length*sizeof(float);
+  }
+
+  f.write(reinterpret_cast<char const*>(&header), sizeof(header));
+  if (!blocks.empty())
+    f.write(reinterpret_cast<char const*>(&blocks[0]), blocks.size()*sizeof(InterestPointBlockInfo));
+
+  for (size_t s = 0; s < sets.size(); ++s) {
+    InterestPointSet const& ips = *sets[s];
+
+    write_padding(f, blocks[s].records_offset);
+    std::vector<InterestPointRecord> records(ips.size());
+    for (size_t i = 0; i < ips.size(); ++i) {
+      InterestPointRecord& r = records[i];
+      std::memset(&r, 0, sizeof(r));
+      r.x           = ips.x(i);
+      r.y           = ips.y(i);
+      r.ix          = ips.ix(i);
+      r.iy          = ips.iy(i);
+      r.orientation = ips.orientation(i);
+      r.scale       = ips.scale(i);
+      r.interest    = ips.interest(i);
+      r.octave      = ips.octave(i);
+      r.scale_lvl   = ips.scale_lvl(i);
+      r.polarity    = ips.polarity(i) ? 1 : 0;
+    }
+    if (!records.empty())
+      f.write(reinterpret_cast<char const*>(&records[0]), records.size()*sizeof(InterestPointRecord));
+
+    write_padding(f, blocks[s].descriptors_offset);
+    const uint64 num_floats = blocks[s].num_points*blocks[s].descriptor_length;
+    if (num_floats > 0)
+      f.write(reinterpret_cast<char const*>(ips.descriptor_data(0)), num_floats*sizeof(float));
+  }
+
+  if (!f)
+    vw_throw( IOErr() << "Failed to write \"" << filename << "\"." );
+  f.close();
+}
+
+
+//-----------------------------------------------------------
+// MappedInterestPointFile
+
+MappedInterestPointFile::MappedInterestPointFile(std::string const& filename)
+  : m_file(new io::mapped_file_source()), m_filename(filename) {
+  try {
+    m_file->open(filename);
+  } catch (std::exception const& e) {
+    vw_throw( IOErr() << "Failed to map \"" << filename << "\": " << e.what() );
+  }
+
+  const uint64 file_size = m_file->size();
+  if (file_size < IP_FILE_HEADER_SIZE)
+    vw_throw( IOErr() << "\"" << filename << "\" is too short to be an interest point file." );
+
+  InterestPointFileHeader header;
+  std::memcpy(&header, m_file->data(), sizeof(header));
+  if (std::memcmp(header.magic, IP_FILE_MAGIC, sizeof(header.magic)) != 0)
+    vw_throw( IOErr() << "\"" << filename << "\" is not in the versioned interest point format." );
+  if (header.version != IP_FILE_VERSION || header.record_size != sizeof(InterestPointRecord))
+    vw_throw( IOErr() << "\"" << filename << "\" has unsupported interest point format version "
+                      << header.version << "." );
+
+  const uint64 table_end = IP_FILE_HEADER_SIZE + header.num_sets*sizeof(InterestPointBlockInfo);
+  if (header.num_sets > 2 || table_end > file_size)
+    vw_throw( IOErr() << "\"" << filename << "\" has a corrupt header." );
+
+  m_blocks.resize(header.num_sets);
+  if (header.num_sets > 0)
+    std::memcpy(&m_blocks[0], m_file->data() + IP_FILE_HEADER_SIZE,
+                m_blocks.size()*sizeof(InterestPointBlockInfo));
+
+  for (size_t s = 0; s < m_blocks.size(); ++s) {
+    InterestPointBlockInfo const& b = m_blocks[s];
+    const uint64 records_end     = b.records_offset + b.num_points*sizeof(InterestPointRecord);
+    const uint64 descriptors_end = b.descriptors_offset + b.num_points*b.descriptor_length*sizeof(float);
+    if (b.records_offset % 8 != 0 || b.descriptors_offset % 8 != 0 ||
+        records_end > file_size || descriptors_end > file_size)
+      vw_throw( IOErr() << "\"" << filename << "\" is truncated or corrupt." );
+  }
+}
+
+MappedInterestPointFile::~MappedInterestPointFile() {}
+
+InterestPointRecord const* MappedInterestPointFile::records(size_t set) const {
+  return reinterpret_cast<InterestPointRecord const*>(m_file->data() + m_blocks[set].records_offset);
+}
+
+float const* MappedInterestPointFile::descriptors(size_t set) const {
+  return reinterpret_cast<float const*>(m_file->data() + m_blocks[set].descriptors_offset);
+}
+
+void MappedInterestPointFile::load(InterestPointSet& ip_set, size_t set) const {
+  VW_ASSERT( set < num_sets(), ArgumentErr() << "MappedInterestPointFile: no set " << set
+                                             << " in \"" << m_filename << "\"." );
+  const size_t num_points = size(set);
+  const size_t length     = descriptor_length(set);
+
+  ip_set.clear();
+  ip_set.m_descriptor_length = length;
+  ip_set.m_x.resize(num_points);
+  ip_set.m_y.resize(num_points);
+  ip_set.m_ix.resize(num_points);
+  ip_set.m_iy.resize(num_points);
+  ip_set.m_scale.resize(num_points);
+  ip_set.m_orientation.resize(num_points);
+  ip_set.m_interest.resize(num_points);
+  ip_set.m_polarity.resize(num_points);
+  ip_set.m_octave.resize(num_points);
+  ip_set.m_scale_lvl.resize(num_points);
+
+  InterestPointRecord const* r = records(set);
+  for (size_t i = 0; i < num_points; ++i) {
+    ip_set.m_x[i]           = r[i].x;
+    ip_set.m_y[i]           = r[i].y;
+    ip_set.m_ix[i]          = r[i].ix;
+    ip_set.m_iy[i]          = r[i].iy;
+    ip_set.m_scale[i]       = r[i].scale;
+    ip_set.m_orientation[i] = r[i].orientation;
+    ip_set.m_interest[i]    = r[i].interest;
+    ip_set.m_polarity[i]    = r[i].polarity;
+    ip_set.m_octave[i]      = r[i].octave;
+    ip_set.m_scale_lvl[i]   = r[i].scale_lvl;
+  }
+
+  float const* desc = descriptors(set);
+  ip_set.m_descriptors.assign(desc, desc + num_points*length);
+}
+
+}} // namespace vw::ip
@@ -0,0 +1,121 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file InterestPointFile.h
+///
+/// The versioned, memory-mappable layout for .vwip and .match files.
+///
+/// A file starts with a 32 byte header:
+///   - magic "VWIPSET" plus a terminating zero, 8 bytes
+///   - uint32 format version, currently 2
+///   - uint32 record size in bytes
+///   - uint64 number of point sets, 1 for .vwip files and 2 for .match files
+///   - uint64 reserved, zero
+/// A 32 byte InterestPointBlockInfo follows for each set.  The offsets in
+/// it are measured from the start of the file.  Each set has a block of
+/// fixed-stride InterestPointRecord structures, 8 byte aligned.  It then
+/// has one contiguous, row-major block of num_points x descriptor_length
+/// floats, 64 byte aligned.  All values use the host byte order, like
+/// the older format.
+///
+/// The older format starts with a uint64 point count.  Read as a uint64,
+/// the magic is far too large to be a count, so the readers in
+/// InterestData.h and InterestPointSet.h can tell the formats apart.
+///
+#ifndef __VW_INTERESTPOINT_INTERESTPOINTFILE_H__
+#define __VW_INTERESTPOINT_INTERESTPOINTFILE_H__
+
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+
+#include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+
+namespace boost { namespace iostreams { class mapped_file_source; } }
+
+namespace vw {
+namespace ip {
+
+  /// One interest point without its descriptor, as stored on disk.
+  struct InterestPointRecord {
+    float  x, y;
+    int32  ix, iy;
+    float  orientation, scale, interest;
+    uint32 octave, scale_lvl;
+    uint8  polarity;
+    uint8  reserved[3];
+  };
+
+  /// Location of one point set inside a file.
+  struct InterestPointBlockInfo {
+    uint64 num_points;
+    uint64 descriptor_length;
+    uint64 records_offset;
+    uint64 descriptors_offset;
+  };
+
+  /// Returns true if the file starts with the versioned layout's magic.
+  bool is_versioned_ip_file(std::string const& filename);
+
+  /// Write point sets in the versioned layout.  Used by the InterestPointSet
+  /// overloads of write_binary_ip_file() and write_binary_match_file().
+  void write_versioned_ip_file(std::string const& filename,
+                               std::vector<InterestPointSet const*> const& sets);
+
+  /// Read-only, zero-copy access to a file in the versioned layout.
+  ///
+  /// The file is memory-mapped, and records and descriptors are read in
+  /// place.  Only the pages that are touched are loaded from disk.  Use
+  /// load() to copy a set into an InterestPointSet.  That copy is a strided
+  /// pass over the records and one memcpy of the descriptor block.
+  class MappedInterestPointFile {
+  public:
+    explicit MappedInterestPointFile(std::string const& filename);
+    ~MappedInterestPointFile();
+
+    /// 1 for .vwip files, 2 for .match files.
+    size_t num_sets() const { return m_blocks.size(); }
+
+    size_t size             (size_t set=0) const { return m_blocks[set].num_points;        }
+    size_t descriptor_length(size_t set=0) const { return m_blocks[set].descriptor_length; }
+
+    /// Record i of a set.
+    InterestPointRecord const& record(size_t i, size_t set=0) const { return records(set)[i]; }
+
+    /// The descriptor of point i of a set, descriptor_length(set) floats.
+    float const* descriptor(size_t i, size_t set=0) const {
+      return descriptors(set) + i*m_blocks[set].descriptor_length;
+    }
+
+    /// All records and all descriptors of a set.
+    InterestPointRecord const* records    (size_t set=0) const;
+    float               const* descriptors(size_t set=0) const;
+
+    /// Copy one set into an InterestPointSet.
+    void load(InterestPointSet& ip_set, size_t set=0) const;
+
+  private:
+    boost::shared_ptr<boost::iostreams::mapped_file_source> m_file;
+    std::vector<InterestPointBlockInfo>                     m_blocks;
+    std::string                                             m_filename;
+  };
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_INTERESTPOINTFILE_H__
@@ -0,0 +1,137 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/InterestPoint/InterestPointSet.h>
+
+namespace vw {
+namespace ip {
+
+  void InterestPointSet::clear() {
+    m_x.clear(); m_y.clear(); m_scale.clear(); m_orientation.clear(); m_interest.clear();
+    m_ix.clear(); m_iy.clear();
+    m_polarity.clear();
+    m_octave.clear(); m_scale_lvl.clear();
+    m_descriptors.clear();
+    m_descriptor_length = 0;
+  }
+
+  void InterestPointSet::reserve(size_t num_points, size_t descriptor_length) {
+    if (empty())
+      m_descriptor_length = descriptor_length;
+    m_x.reserve(num_points); m_y.reserve(num_points);
+    m_scale.reserve(num_points); m_orientation.reserve(num_points); m_interest.reserve(num_points);
+    m_ix.reserve(num_points); m_iy.reserve(num_points);
+    m_polarity.reserve(num_points);
+    m_octave.reserve(num_points); m_scale_lvl.reserve(num_points);
+    m_descriptors.reserve(num_points*m_descriptor_length);
+  }
+
+  void InterestPointSet::push_back(InterestPoint const& ip) {
+    if (empty())
+      m_descriptor_length = ip.size();
+    VW_ASSERT( ip.size() == m_descriptor_length,
+               ArgumentErr() << "InterestPointSet: descriptor length " << ip.size()
+                             << " does not match the set's length " << m_descriptor_length << "." );
+    m_x.push_back(ip.x);
+    m_y.push_back(ip.y);
+    m_ix.push_back(ip.ix);
+    m_iy.push_back(ip.iy);
+    m_scale.push_back(ip.scale);
+    m_orientation.push_back(ip.orientation);
+    m_interest.push_back(ip.interest);
+    m_polarity.push_back(ip.polarity);
+    m_octave.push_back(ip.octave);
+    m_scale_lvl.push_back(ip.scale_lvl);
+    m_descriptors.insert(m_descriptors.end(), ip.begin(), ip.end());
+  }
+
+  void InterestPointSet::push_back(InterestPointSet const& other, size_t i) {
+    if (empty())
+      m_descriptor_length = other.m_descriptor_length;
+    VW_ASSERT( other.m_descriptor_length == m_descriptor_length,
+               ArgumentErr() << "InterestPointSet: descriptor length " << other.m_descriptor_length
+                             << " does not match the set's length " << m_descriptor_length << "." );
+    m_x.push_back(other.m_x[i]);
+    m_y.push_back(other.m_y[i]);
+    m_ix.push_back(other.m_ix[i]);
+    m_iy.push_back(other.m_iy[i]);
+    m_scale.push_back(other.m_scale[i]);
+    m_orientation.push_back(other.m_orientation[i]);
+    m_interest.push_back(other.m_interest[i]);
+    m_polarity.push_back(other.m_polarity[i]);
+    m_octave.push_back(other.m_octave[i]);
+    m_scale_lvl.push_back(other.m_scale_lvl[i]);
+    float const* desc = other.descriptor_data(i);
+    m_descriptors.insert(m_descriptors.end(), desc, desc + m_descriptor_length);
+  }
+
+  InterestPointSet InterestPointSet::subset(std::vector<size_t> const& indices) const {
+    InterestPointSet result;
+    result.reserve(indices.size(), m_descriptor_length);
+    for (size_t k = 0; k < indices.size(); ++k)
+      result.push_back(*this, indices[k]);
+    return result;
+  }
+
+  void InterestPointSet::get(size_t i, InterestPoint& ip) const {
+    ip.x           = m_x[i];
+    ip.y           = m_y[i];
+    ip.ix          = m_ix[i];
+    ip.iy          = m_iy[i];
+    ip.scale       = m_scale[i];
+    ip.orientation = m_orientation[i];
+    ip.interest    = m_interest[i];
+    ip.polarity    = m_polarity[i] != 0;
+    ip.octave      = m_octave[i];
+    ip.scale_lvl   = m_scale_lvl[i];
+    if (ip.descriptor.size() != m_descriptor_length)
+      ip.descriptor.set_size(m_descriptor_length);
+    float const* desc = descriptor_data(i);
+    std::copy(desc, desc + m_descriptor_length, ip.descriptor.begin());
+  }
+
+  InterestPointList InterestPointSet::to_list() const {
+    InterestPointList result;
+    for (size_t i = 0; i < size(); ++i)
+      result.push_back((*this)[i]);
+    return result;
+  }
+
+  std::vector<InterestPoint> InterestPointSet::to_vector() const {
+    std::vector<InterestPoint> result(size());
+    for (size_t i = 0; i < size(); ++i)
+      get(i, result[i]);
+    return result;
+  }
+
+  void InterestPointSet::swap(InterestPointSet& other) {
+    m_x.swap(other.m_x);
+    m_y.swap(other.m_y);
+    m_ix.swap(other.m_ix);
+    m_iy.swap(other.m_iy);
+    m_scale.swap(other.m_scale);
+    m_orientation.swap(other.m_orientation);
+    m_interest.swap(other.m_interest);
+    m_polarity.swap(other.m_polarity);
+    m_octave.swap(other.m_octave);
+    m_scale_lvl.swap(other.m_scale_lvl);
+    m_descriptors.swap(other.m_descriptors);
+    std::swap(m_descriptor_length, other.m_descriptor_length);
+  }
+
+}} // namespace vw::ip
@@ -0,0 +1,159 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file InterestPointSet.h
+///
+/// A compact, contiguous container for large numbers of interest points.
+///
+#ifndef __VW_INTERESTPOINT_INTERESTPOINTSET_H__
+#define __VW_INTERESTPOINT_INTERESTPOINTSET_H__
+
+#include <vector>
+#include <string>
+
+#include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
+#include <vw/InterestPoint/InterestData.h>
+
+namespace vw {
+namespace ip {
+
+  /// Stores interest points as a structure of arrays.
+  ///
+  /// Each InterestPoint field lives in its own std::vector.  All of the
+  /// descriptors are packed into one row-major block of
+  /// size() x descriptor_length() floats.  Compared with an
+  /// InterestPointList this needs no per-point heap allocation, gives
+  /// O(1) random access, and lets the descriptors be handed to FLANN as
+  /// one matrix.  Every point in a set must have the same descriptor
+  /// length.  The first point that is added fixes it.
+  class InterestPointSet {
+  public:
+
+    InterestPointSet() : m_descriptor_length(0) {}
+
+    /// Copy from an InterestPointList or a std::vector<InterestPoint>.
+    template <class ListT>
+    explicit InterestPointSet(ListT const& ip_list) : m_descriptor_length(0) {
+      if (!ip_list.empty())
+        reserve(ip_list.size(), ip_list.begin()->size());
+      for (typename ListT::const_iterator i = ip_list.begin(); i != ip_list.end(); ++i)
+        push_back(*i);
+    }
+
+    size_t size             () const { return m_x.size();           }
+    bool   empty            () const { return m_x.empty();          }
+    size_t descriptor_length() const { return m_descriptor_length;  }
+
+    void clear();
+    void reserve(size_t num_points, size_t descriptor_length);
+
+    /// Append a point.  Its descriptor length must match the set's.
+    void push_back(InterestPoint const& ip);
+
+    /// Append point i of another set.
+    void push_back(InterestPointSet const& other, size_t i);
+
+    /// Return a new set holding only the points at the listed indices,
+    /// in that order.
+    InterestPointSet subset(std::vector<size_t> const& indices) const;
+
+    /// Fill in ip with point i.  ip's descriptor storage is reused
+    /// when it already has the right length.
+    void get(size_t i, InterestPoint& ip) const;
+
+    /// Return point i as an InterestPoint.
+    InterestPoint operator[](size_t i) const {
+      InterestPoint ip;
+      get(i, ip);
+      return ip;
+    }
+
+    /// Convert back to the standard containers.
+    InterestPointList          to_list  () const;
+    std::vector<InterestPoint> to_vector() const;
+
+    // Field access.
+    float  x          (size_t i) const { return m_x[i];           }
+    float  y          (size_t i) const { return m_y[i];           }
+    int32  ix         (size_t i) const { return m_ix[i];          }
+    int32  iy         (size_t i) const { return m_iy[i];          }
+    float  scale      (size_t i) const { return m_scale[i];       }
+    float  orientation(size_t i) const { return m_orientation[i]; }
+    float  interest   (size_t i) const { return m_interest[i];    }
+    bool   polarity   (size_t i) const { return m_polarity[i] != 0; }
+    uint32 octave     (size_t i) const { return m_octave[i];      }
+    uint32 scale_lvl  (size_t i) const { return m_scale_lvl[i];   }
+
+    /// The subpixel coordinate arrays.
+    std::vector<float> const& x_coords() const { return m_x; }
+    std::vector<float> const& y_coords() const { return m_y; }
+
+    /// Pointer to the descriptor of point i.
+    float const* descriptor_data(size_t i) const {
+      return m_descriptors.empty() ? 0 : &m_descriptors[i*m_descriptor_length];
+    }
+    float* descriptor_data(size_t i) {
+      return m_descriptors.empty() ? 0 : &m_descriptors[i*m_descriptor_length];
+    }
+
+    /// The descriptor of point i as a vector.
+    VectorProxy<float> descriptor(size_t i) {
+      return VectorProxy<float>(m_descriptor_length, descriptor_data(i));
+    }
+    VectorProxy<float> descriptor(size_t i) const {
+      return const_cast<InterestPointSet*>(this)->descriptor(i);
+    }
+
+    /// All descriptors as a size() x descriptor_length() matrix.
+    /// The proxy is invalidated by any call that adds points.
+    MatrixProxy<float> descriptors() {
+      return MatrixProxy<float>(m_descriptors.empty() ? 0 : &m_descriptors[0],
+                                size(), m_descriptor_length);
+    }
+    MatrixProxy<float> descriptors() const {
+      return const_cast<InterestPointSet*>(this)->descriptors();
+    }
+
+    void swap(InterestPointSet& other);
+
+  private:
+    friend class MappedInterestPointFile; // Bulk loads from mapped files
+
+    std::vector<float > m_x, m_y, m_scale, m_orientation, m_interest;
+    std::vector<int32 > m_ix, m_iy;
+    std::vector<uint8 > m_polarity;
+    std::vector<uint32> m_octave, m_scale_lvl;
+    std::vector<float > m_descriptors;
+    size_t              m_descriptor_length;
+  };
+
+  // Binary IO.  The writers use the versioned layout described in
+  // InterestPointFile.h.  The readers accept both that layout and the
+  // older point-by-point format.
+  void             write_binary_ip_file   (std::string ip_file, InterestPointSet const& ip);
+  InterestPointSet read_binary_ip_file_set(std::string ip_file);
+
+  void write_binary_match_file(std::string match_file, InterestPointSet const& ip1,
+                               InterestPointSet const& ip2);
+  void read_binary_match_file (std::string match_file, InterestPointSet& ip1,
+                               InterestPointSet& ip2);
+
+}} // namespace vw::ip
+
+#endif // __VW_INTERESTPOINT_INTERESTPOINTSET_H__
@@ -24,6 +24,8 @@
 #ifndef __VW_INTERESTPOINT_LEARNPCA_H__
 #define __VW_INTERESTPOINT_LEARNPCA_H__
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/LinearAlgebra.h>
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/ImageView.h>
@@ -34,9 +36,212 @@
 #include <vw/InterestPoint/Descriptor.h>
 #include <vw/InterestPoint/MatrixIO.h>
 
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#include <algorithm>
+#include <vector>
+
 #define PCA_BASIS_SIZE  20
 #define MAX_POINTS_TO_DRAW 1000
 
+namespace vw {
+namespace ip {
+
+  /// \cond INTERNAL
+  namespace detail {
+    // Adds the descriptors of a block to rows first..last-1 of the
+    // upper triangle of a scatter matrix, and to the same entries of a
+    // sum.  Tasks with different rows share nothing.
+    class PCAScatterTask : public Task {
+      double const* m_block;
+      size_t m_count;
+      int m_dim, m_first, m_last;
+      Vector<double>& m_sum;
+      Matrix<double>& m_scatter;
+    public:
+      PCAScatterTask(double const* block, size_t count, int dim, int first, int last,
+                     Vector<double>& sum, Matrix<double>& scatter)
+        : m_block(block), m_count(count), m_dim(dim), m_first(first), m_last(last),
+          m_sum(sum), m_scatter(scatter) {}
+
+      virtual void operator()() {
+        // A few descriptors at a time, so that each row of the scatter
+        // matrix stays in cache while they are added to it.
+        const size_t chunk = 32;
+        for (size_t k0 = 0; k0 < m_count; k0 += chunk) {
+          const size_t k1 = std::min(m_count, k0 + chunk);
+          for (int i = m_first; i < m_last; i++) {
+            double* row = &m_scatter(i, 0);
+            double sum = 0;
+            size_t k = k0;
+            // Four descriptors per pass over the row.
+            for (; k + 4 <= k1; k += 4) {
+              double const* x0 = m_block + k*m_dim;
+              double const* x1 = x0 + m_dim;
+              double const* x2 = x1 + m_dim;
+              double const* x3 = x2 + m_dim;
+              const double a0 = x0[i], a1 = x1[i], a2 = x2[i], a3 = x3[i];
+              sum += a0 + a1 + a2 + a3;
+              for (int j = i; j < m_dim; j++)
+                row[j] += a0 * x0[j] + a1 * x1[j] + a2 * x2[j] + a3 * x3[j];
+            }
+            for (; k < k1; k++) {
+              double const* x = m_block + k*m_dim;
+              const double xi = x[i];
+              sum += xi;
+              for (int j = i; j < m_dim; j++)
+                row[j] += xi * x[j];
+            }
+            m_sum(i) += sum;
+          }
+        }
+      }
+    };
+  }
+  /// \endcond
+
+  /// Accumulates the mean and covariance of descriptors a block at a
+  /// time, so the training set never has to be held in memory.  Each
+  /// block is split between threads by rows of the covariance, which
+  /// costs dim^2/2 per descriptor.  The sums are kept about the first
+  /// descriptor, which keeps the variance from being lost to rounding
+  /// when the mean is large.
+  class PCAAccumulator {
+    int m_dim, m_num_threads;
+    size_t m_count;
+    Vector<double> m_shift, m_sum;
+    Matrix<double> m_scatter;
+    std::vector<double> m_block;
+
+  public:
+    /// num_threads of 0 uses the default number of threads.
+    PCAAccumulator(int dim, int num_threads = 0)
+      : m_dim(dim), m_num_threads(num_threads), m_count(0), m_shift(dim), m_sum(dim), m_scatter(dim, dim) {
+      VW_ASSERT(dim > 0, ArgumentErr() << "PCAAccumulator: The dimension must be positive.");
+    }
+
+    int dimension() const { return m_dim; }
+    size_t count() const { return m_count; }
+
+    /// Adds count descriptors of dimension() values each, one after
+    /// another.
+    void add(double const* descriptors, size_t count) {
+      if (count == 0)
+        return;
+      if (m_count == 0)
+        std::copy(descriptors, descriptors + m_dim, m_shift.begin());
+
+      m_block.resize(count * m_dim);
+      for (size_t k = 0; k < count; k++)
+        for (int i = 0; i < m_dim; i++)
+          m_block[k*m_dim + i] = descriptors[k*m_dim + i] - m_shift(i);
+      m_count += count;
+
+      int num_threads = m_num_threads > 0 ? m_num_threads : vw_settings().default_num_threads();
+      num_threads = std::max(1, std::min(num_threads, m_dim));
+
+      // Bands of rows with about the same part of the triangle each.
+      // Twice as many as threads, as the bands end on whole rows.
+      const int num_bands = num_threads == 1 ? 1 : 2*num_threads;
+      const double area = 0.5 * double(m_dim) * double(m_dim + 1);
+      std::vector<boost::shared_ptr<Task> > tasks;
+      int first = 0;
+      double done = 0;
+      for (int b = 0; b < num_bands && first < m_dim; b++) {
+        int last = first;
+        while (last < m_dim && (b == num_bands-1 || done < area * (b+1) / num_bands))
+          done += m_dim - last++;
+        if (last > first)
+          tasks.push_back(boost::shared_ptr<Task>(
+            new detail::PCAScatterTask(&m_block[0], count, m_dim, first, last, m_sum, m_scatter)));
+        first = last;
+      }
+
+      if (num_threads == 1 || tasks.size() == 1) {
+        for (size_t t = 0; t < tasks.size(); t++)
+          (*tasks[t])();
+        return;
+      }
+      FifoWorkQueue queue(std::min(num_threads, int(tasks.size())));
+      for (size_t t = 0; t < tasks.size(); t++)
+        queue.add_task(tasks[t]);
+      queue.join_all();
+    }
+
+    /// The mean of the descriptors added so far.
+    Vector<double> mean() const {
+      VW_ASSERT(m_count > 0, LogicErr() << "PCAAccumulator: No descriptors have been added.");
+      return m_shift + m_sum / double(m_count);
+    }
+
+    /// The sample covariance of the descriptors added so far.
+    Matrix<double> covariance() const {
+      VW_ASSERT(m_count > 1, LogicErr() << "PCAAccumulator: The covariance needs at least two descriptors.");
+      const double n = double(m_count);
+      Matrix<double> result(m_dim, m_dim);
+      for (int i = 0; i < m_dim; i++)
+        for (int j = i; j < m_dim; j++)
+          result(i, j) = result(j, i) = (m_scatter(i, j) - m_sum(i) * m_sum(j) / n) / (n - 1);
+      return result;
+    }
+  };
+
+  /// The first count principal directions of a covariance matrix, as
+  /// the columns of basis, and the variance along each, largest first.
+  inline void pca_basis(Matrix<double> const& covariance, int count,
+                        Matrix<double>& basis, Vector<double>& variances) {
+    VW_ASSERT(count > 0 && count <= int(covariance.rows()),
+              ArgumentErr() << "pca_basis: Cannot take " << count << " directions of a "
+                            << covariance.rows() << " dimensional covariance.");
+    Matrix<double> U, VT;
+    Vector<double> S;
+    math::svd(covariance, U, S, VT);
+    basis = submatrix(U, 0, 0, U.rows(), count);
+    variances = subvector(S, 0, count);
+  }
+
+  /// As pca_basis(), but by randomized subspace iteration: a random
+  /// block of count+oversample vectors is multiplied by the covariance
+  /// and reorthogonalized power_iterations times, and the directions
+  /// are found in the small space it spans.  This is much faster than a
+  /// full decomposition for long descriptors, and as accurate for the
+  /// leading directions when the variances fall off.
+  inline void randomized_pca_basis(Matrix<double> const& covariance, int count,
+                                   Matrix<double>& basis, Vector<double>& variances,
+                                   int oversample = 10, int power_iterations = 4,
+                                   uint32 seed = 0) {
+    const int dim = int(covariance.rows());
+    VW_ASSERT(count > 0 && count <= dim,
+              ArgumentErr() << "randomized_pca_basis: Cannot take " << count << " directions of a "
+                            << dim << " dimensional covariance.");
+    const int size = std::min(dim, count + std::max(0, oversample));
+
+    boost::mt19937 generator(seed);
+    boost::variate_generator<boost::mt19937&, boost::normal_distribution<double> >
+      normal(generator, boost::normal_distribution<double>());
+    Matrix<double> Y(dim, size), Q, R;
+    for (int i = 0; i < dim; i++)
+      for (int j = 0; j < size; j++)
+        Y(i, j) = normal();
+
+    for (int it = 0; it < power_iterations; it++) {
+      math::qrd(Y, Q, R);
+      Y = covariance * Q;
+    }
+    math::qrd(Y, Q, R);
+
+    Matrix<double> small = transpose(Q) * covariance * Q;
+    Matrix<double> U, VT;
+    Vector<double> S;
+    math::svd(small, U, S, VT);
+    basis = Q * submatrix(U, 0, 0, size, count);
+    variances = subvector(S, 0, count);
+  }
+
+}} // namespace vw::ip
+
 // Use DescriptorGeneratorBase::operator() and compute_descriptor methods to
 // help us populate the training data matrix
 // DescriptorGeneratorBase takes care of finding the support region for
@@ -44,14 +249,12 @@
 class LearnPCADataFiller : public vw::ip::DescriptorGeneratorBase<LearnPCADataFiller> {
 
 private:
-  vw::Matrix<double> *data;
-  int column;
+  std::vector<double> *data;
 
 public:
-  // *** TODO: Pass by ref without copy?
-  LearnPCADataFiller(vw::Matrix<double>* training_data, unsigned int start_column) {
+  // Appends each normalized support region to training_data.
+  LearnPCADataFiller(std::vector<double>* training_data) {
     data = training_data;
-    column = start_column;
   }
 
   template <class ViewT, class IterT>
@@ -59,26 +262,23 @@ public:
                            IterT /*first*/, IterT /*last*/ ) {
     // This secretly does not create a descriptor
 
-    int support_squared = support.impl().cols() * support.impl().rows();
+    size_t start = data->size();
 
     double norm_const = 0.0;
-    // Copy support region into training data matrix
-    int row = 0;
+    // Copy support region into training data
     for (int j = 0; j < support.impl().rows(); j++) {
       for (int i = 0; i < support.impl().cols(); i++) {
-        (*data)(row++, column) = support.impl()(i, j);
-        norm_const += support.impl()(i, j) * support.impl()(i, j);
+        double value = support.impl()(i, j);
+        data->push_back(value);
+        norm_const += value * value;
       }
     }
 
-    // Normalize values in column
+    // Normalize the values just added
     norm_const = sqrt(norm_const);
-    for (int i = 0; i < support_squared; i++) {
-      (*data)(i, column) /= norm_const;
+    for (size_t i = start; i < data->size(); i++) {
+      (*data)[i] /= norm_const;
     }
-
-    // Increment column number for next call to compute_descriptor
-    column++;
   }
 
   int descriptor_size() { return 0; }
@@ -90,8 +290,8 @@ private:
   std::string basis_filename;
   std::string avg_filename;
 
-  vw::Matrix<double> training_data;
-  unsigned int training_data_size;
+  vw::ip::PCAAccumulator training_data;
+  bool randomized;
 
   vw::Matrix<float> pca_basis;
   vw::Vector<float> pca_avg;
@@ -104,12 +304,16 @@ public:
 
   LearnPCA(const std::string& pcabasis_filename,
            const std::string& pcaavg_filename)
-    : basis_filename(pcabasis_filename), avg_filename(pcaavg_filename) {
+    : basis_filename(pcabasis_filename), avg_filename(pcaavg_filename),
+      training_data(DEFAULT_SUPPORT_SIZE * DEFAULT_SUPPORT_SIZE), randomized(false) {
 
     support_squared = DEFAULT_SUPPORT_SIZE * DEFAULT_SUPPORT_SIZE;
-    training_data_size = 0;
   }
 
+  // Find the basis by randomized subspace iteration rather than a full
+  // decomposition of the covariance.
+  void set_randomized(bool use_randomized) { randomized = use_randomized; }
+
   template <class T>
   vw::ImageView<T> bin_subsample(const vw::ImageView<T> &image) {
     vw::ImageView<T> ret(image.cols()/2, image.rows()/2);
@@ -148,19 +352,16 @@ public:
     ipl = detector(image, tile_size);
     write_point_image("ip_" + dimage.filename(), image, ipl);
 
-    // Resize the training data matrix to accommodate new interest points
-    unsigned int interest_point_index = training_data_size;
-    training_data_size += ipl.size();
-    training_data.set_size(support_squared, training_data_size, true);
-
-    // Populate training data matrix
-    LearnPCADataFiller fill_matrix(&training_data, interest_point_index);
+    // Add this image's interest points to the covariance
+    std::vector<double> descriptors;
+    descriptors.reserve(ipl.size() * support_squared);
+    LearnPCADataFiller fill_matrix(&descriptors);
 
-    std::cout << "Populating training matrix" << std::endl;
-    std::cout << "  Starting fill at column " << interest_point_index << std::endl;
+    std::cout << "Adding to training data" << std::endl;
     std::cout << "  " << ipl.size() << " interest points" << std::endl;
-    std::cout << "  " << training_data_size << " total interest points\n" << std::endl;
     fill_matrix(image, ipl);
+    training_data.add(descriptors.empty() ? NULL : &descriptors[0], descriptors.size() / support_squared);
+    std::cout << "  " << training_data.count() << " total interest points\n" << std::endl;
   }
 
   void runPCA() {
@@ -168,39 +369,24 @@ public:
 
     // Compute average
     std::cout << "  Computing average" << std::endl;
-    pca_avg.set_size(support_squared);
-    for (int i = 0; i < support_squared; i++) {
-      for (unsigned j = 0; j < training_data.cols(); j++) {
-        pca_avg(i) += training_data(i, j);
-      }
-      pca_avg(i) /= training_data.cols();
-    }
-
-    // Subtract average
-    std::cout << "  Subtracting average" << std::endl;
-    for (int i = 0; i < support_squared; i++) {
-      for (unsigned j = 0; j < training_data.cols(); j++) {
-        training_data(i, j) -= pca_avg(i);
-      }
-    }
-
-    // Compute SVD of training data matrix
-    std::cout << "  Computing SVD" << std::endl;
-    vw::Matrix<float> U;
-    vw::Vector<float> E;
-    vw::Matrix<float> VT;
-    svd(training_data, U, E, VT);
-
-    assert(E.size() >= PCA_BASIS_SIZE);
-    std::cout << "  Top " << PCA_BASIS_SIZE << " singular values from " << E.size()
-         << " total singular values" << std::endl;
+    pca_avg = training_data.mean();
+
+    // Decompose the covariance
+    std::cout << "  Computing " << (randomized ? "randomized " : "") << "eigenvectors of covariance" << std::endl;
+    vw::Matrix<double> U;
+    vw::Vector<double> E;
+    if (randomized)
+      vw::ip::randomized_pca_basis(training_data.covariance(), PCA_BASIS_SIZE, U, E);
+    else
+      vw::ip::pca_basis(training_data.covariance(), PCA_BASIS_SIZE, U, E);
+
+    std::cout << "  Top " << PCA_BASIS_SIZE << " variances" << std::endl;
     for (int i = 0; i < PCA_BASIS_SIZE; i++) {
       std::cout << "  " << i << ": " << E[i] << std::endl;
     }
 
-    // Take top n eignvectors of U as PCA basis
-    vw::Matrix<float> pca_basis = submatrix(U, 0, 0, U.rows(),
-                                        PCA_BASIS_SIZE);
+    // Take top n eignvectors as PCA basis
+    vw::Matrix<float> pca_basis = U;
 
     std::cout << "pca_basis: " << pca_basis.rows() << " x " << pca_basis.cols() << std::endl;
     std::cout << "pca_avg: " << pca_avg.size() << std::endl;
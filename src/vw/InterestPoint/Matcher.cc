@@ -22,6 +22,9 @@
 ///
 #include <vw/InterestPoint/Matcher.h>
 #include <boost/filesystem/operations.hpp>
+#include <map>
+#include <limits>
+#include <cmath>
 namespace fs = boost::filesystem;
 
 namespace vw {
@@ -172,6 +175,288 @@ namespace ip {
     ip2 = ip2_fltr;
   }
 
+  void remove_duplicates(InterestPointSet& ip1, InterestPointSet& ip2) {
+    VW_ASSERT( ip1.size() == ip2.size(),
+               ArgumentErr() << "Input sets are not the same size.");
+
+    // A pair is dropped when a later pair shares its location in either
+    // image, so only the last index of each location matters.
+    typedef std::map<std::pair<float,float>, size_t> LastIndexMap;
+    LastIndexMap last1, last2;
+    for (size_t i = 0; i < ip1.size(); ++i) {
+      last1[std::make_pair(ip1.x(i), ip1.y(i))] = i;
+      last2[std::make_pair(ip2.x(i), ip2.y(i))] = i;
+    }
+
+    std::vector<size_t> keep;
+    keep.reserve(ip1.size());
+    for (size_t i = 0; i < ip1.size(); ++i) {
+      if (last1[std::make_pair(ip1.x(i), ip1.y(i))] == i &&
+          last2[std::make_pair(ip2.x(i), ip2.y(i))] == i)
+        keep.push_back(i);
+    }
+    ip1.subset(keep).swap(ip1);
+    ip2.subset(keep).swap(ip2);
+  }
+
+  void remove_duplicates(std::vector<InterestPoint>& ip1,
+                         std::vector<InterestPoint>& ip2,
+                         std::vector<float>& scores) {
+    VW_ASSERT( ip1.size() == ip2.size() && ip1.size() == scores.size(),
+               ArgumentErr() << "Input vectors are not the same size.");
+
+    typedef std::map<std::pair<float,float>, size_t> LastIndexMap;
+    LastIndexMap last1, last2;
+    for (size_t i = 0; i < ip1.size(); ++i) {
+      last1[std::make_pair(ip1[i].x, ip1[i].y)] = i;
+      last2[std::make_pair(ip2[i].x, ip2[i].y)] = i;
+    }
+
+    size_t num_kept = 0;
+    for (size_t i = 0; i < ip1.size(); ++i) {
+      if (last1[std::make_pair(ip1[i].x, ip1[i].y)] == i &&
+          last2[std::make_pair(ip2[i].x, ip2[i].y)] == i) {
+        ip1   [num_kept] = ip1   [i];
+        ip2   [num_kept] = ip2   [i];
+        scores[num_kept] = scores[i];
+        ++num_kept;
+      }
+    }
+    ip1.resize(num_kept);
+    ip2.resize(num_kept);
+    scores.resize(num_kept);
+  }
+
+namespace {
+
+  // One match in bucket_matches(), ordered by cell and then by score.
+  struct BucketEntry {
+    int64  cell_x, cell_y;
+    float  score;
+    size_t index;
+    bool operator<(BucketEntry const& other) const {
+      if (cell_y != other.cell_y) return cell_y < other.cell_y;
+      if (cell_x != other.cell_x) return cell_x < other.cell_x;
+      if (score  != other.score ) return score  < other.score;
+      return index < other.index;
+    }
+  };
+
+  template <class CoordFuncT>
+  std::vector<size_t> bucket_matches_impl(size_t num_matches, CoordFuncT const& coord,
+                                          std::vector<float> const& scores,
+                                          double cell_size, size_t max_per_cell) {
+    VW_ASSERT( cell_size > 0 && max_per_cell > 0,
+               ArgumentErr() << "bucket_matches: cell_size and max_per_cell must be positive." );
+    VW_ASSERT( scores.empty() || scores.size() == num_matches,
+               ArgumentErr() << "bucket_matches: there must be one score per match." );
+
+    std::vector<BucketEntry> entries(num_matches);
+    for (size_t i = 0; i < num_matches; ++i) {
+      Vector2 loc = coord(i);
+      entries[i].cell_x = int64(std::floor(loc.x() / cell_size));
+      entries[i].cell_y = int64(std::floor(loc.y() / cell_size));
+      entries[i].score  = scores.empty() ? 0.0f : scores[i];
+      entries[i].index  = i;
+    }
+    std::sort(entries.begin(), entries.end());
+
+    std::vector<size_t> keep;
+    size_t in_cell = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (i == 0 || entries[i].cell_x != entries[i-1].cell_x ||
+                    entries[i].cell_y != entries[i-1].cell_y)
+        in_cell = 0;
+      if (in_cell++ < max_per_cell)
+        keep.push_back(entries[i].index);
+    }
+    std::sort(keep.begin(), keep.end());
+    return keep;
+  }
+
+  struct ListCoord {
+    std::vector<InterestPoint> const& ip;
+    ListCoord(std::vector<InterestPoint> const& ip) : ip(ip) {}
+    Vector2 operator()(size_t i) const { return Vector2(ip[i].x, ip[i].y); }
+  };
+
+  struct SetCoord {
+    InterestPointSet const& ip;
+    SetCoord(InterestPointSet const& ip) : ip(ip) {}
+    Vector2 operator()(size_t i) const { return Vector2(ip.x(i), ip.y(i)); }
+  };
+
+} // end anonymous namespace
+
+  std::vector<size_t> bucket_matches(std::vector<InterestPoint> const& ip1,
+                                     std::vector<float> const& scores,
+                                     double cell_size, size_t max_per_cell) {
+    return bucket_matches_impl(ip1.size(), ListCoord(ip1), scores, cell_size, max_per_cell);
+  }
+
+  std::vector<size_t> bucket_matches(InterestPointSet const& ip1,
+                                     std::vector<float> const& scores,
+                                     double cell_size, size_t max_per_cell) {
+    return bucket_matches_impl(ip1.size(), SetCoord(ip1), scores, cell_size, max_per_cell);
+  }
+
+//==================================================================================
+// Brute force nearest neighbor search
+
+namespace {
+
+  // Keep the two smallest distances seen so far for one query.
+  template <class DistT>
+  inline void update_two_nearest(DistT dist, int index, DistT* best, int* best_index) {
+    if (dist < best[0]) {
+      best[1] = best[0];  best_index[1] = best_index[0];
+      best[0] = dist;     best_index[0] = index;
+    } else if (dist < best[1]) {
+      best[1] = dist;     best_index[1] = index;
+    }
+  }
+
+} // end anonymous namespace
+
+  void brute_force_knn2_l2(float const* query, size_t num_query,
+                           float const* train, size_t num_train,
+                           size_t length, std::vector<int>& indices) {
+    // The train descriptors are handled in tiles of TRAIN_TILE rows.  Each
+    // tile is transposed so that one descriptor element of every row in
+    // it is contiguous.  Then QUERY_TILE queries at a time accumulate
+    // their squared differences to the whole tile in short arrays that
+    // stay in L1 and that the compiler can vectorize.
+    const size_t TRAIN_TILE = 256, QUERY_TILE = 4;
+
+    indices.assign(2*num_query, -1);
+    std::vector<float> best(2*num_query, std::numeric_limits<float>::max());
+
+    std::vector<float> tile(length*TRAIN_TILE);
+    float acc[QUERY_TILE][TRAIN_TILE];
+
+    for (size_t t0 = 0; t0 < num_train; t0 += TRAIN_TILE) {
+      const size_t tile_rows = std::min(TRAIN_TILE, num_train - t0);
+
+      // Unused columns of the last tile are padded with zeros and ignored.
+      std::fill(tile.begin(), tile.end(), 0.0f);
+      for (size_t t = 0; t < tile_rows; ++t) {
+        float const* row = train + (t0 + t)*length;
+        for (size_t k = 0; k < length; ++k)
+          tile[k*TRAIN_TILE + t] = row[k];
+      }
+
+      for (size_t q0 = 0; q0 < num_query; q0 += QUERY_TILE) {
+        const size_t query_rows = std::min(QUERY_TILE, num_query - q0);
+        for (size_t q = 0; q < QUERY_TILE; ++q)
+          std::fill(acc[q], acc[q] + TRAIN_TILE, 0.0f);
+
+        for (size_t k = 0; k < length; ++k) {
+          float const* column = &tile[k*TRAIN_TILE];
+          for (size_t q = 0; q < query_rows; ++q) {
+            const float value = query[(q0 + q)*length + k];
+            float* a = acc[q];
+            for (size_t t = 0; t < TRAIN_TILE; ++t) {
+              const float diff = value - column[t];
+              a[t] += diff*diff;
+            }
+          }
+        }
+
+        for (size_t q = 0; q < query_rows; ++q) {
+          const size_t i = q0 + q;
+          for (size_t t = 0; t < tile_rows; ++t)
+            update_two_nearest(acc[q][t], int(t0 + t), &best[2*i], &indices[2*i]);
+        }
+      }
+    }
+  }
+
+  void brute_force_knn2_hamming(BinaryDescriptorSet const& query,
+                                BinaryDescriptorSet const& train,
+                                std::vector<int>& indices) {
+    VW_ASSERT( query.empty() || train.empty() ||
+               query.words_per_descriptor() == train.words_per_descriptor(),
+               ArgumentErr() << "brute_force_knn2_hamming: descriptor lengths differ." );
+
+    // Compare every query with one tile of train descriptors at a time,
+    // so the tile stays in cache while it is reused.
+    const size_t TRAIN_TILE = 4096;
+    const size_t num_query = query.size(), num_train = train.size();
+    const size_t num_words = train.words_per_descriptor();
+
+    indices.assign(2*num_query, -1);
+    std::vector<uint32> best(2*num_query, std::numeric_limits<uint32>::max());
+    std::vector<uint32> dists(std::min(TRAIN_TILE, num_train));
+
+    for (size_t t0 = 0; t0 < num_train; t0 += TRAIN_TILE) {
+      const size_t tile_rows = std::min(TRAIN_TILE, num_train - t0);
+      for (size_t i = 0; i < num_query; ++i) {
+        binary_hamming_distances(query.data(i), train.data(t0), tile_rows, num_words, &dists[0]);
+        for (size_t t = 0; t < tile_rows; ++t)
+          update_two_nearest(dists[t], int(t0 + t), &best[2*i], &indices[2*i]);
+      }
+    }
+  }
+
+  void brute_force_knn2(InterestPointSet const& ip1, InterestPointSet const& ip2,
+                        math::FLANN_DistType dist_type, std::vector<int>& indices) {
+    if (dist_type == math::FLANN_DistType_Hamming) {
+      brute_force_knn2_hamming(BinaryDescriptorSet(ip1), BinaryDescriptorSet(ip2), indices);
+      return;
+    }
+    if (dist_type != math::FLANN_DistType_L2)
+      vw_throw( ArgumentErr() << "brute_force_knn2: only the L2 and Hamming metrics are supported." );
+    VW_ASSERT( ip1.empty() || ip2.empty() || ip1.descriptor_length() == ip2.descriptor_length(),
+               ArgumentErr() << "brute_force_knn2: descriptor lengths differ." );
+
+    brute_force_knn2_l2(ip1.descriptor_data(0), ip1.size(), ip2.descriptor_data(0), ip2.size(),
+                        ip2.descriptor_length(), indices);
+  }
+
+
+  InterestPointIndex::InterestPointIndex(InterestPointSet const& ip_set,
+                                         math::FLANN_DistType dist_type,
+                                         std::string const& cache_dir)
+    : m_dist_type(dist_type), m_size(ip_set.size()) {
+    if (dist_type == math::FLANN_DistType_Hamming) {
+      if (cache_dir.empty())
+        m_uchar_tree.load_match_data( ip_set.descriptors(), dist_type );
+      else
+        m_uchar_tree.load_match_data( ip_set.descriptors(), dist_type, cache_dir );
+    } else if (dist_type == math::FLANN_DistType_L2) {
+      if (cache_dir.empty())
+        m_float_tree.load_match_data( ip_set.descriptors(), dist_type );
+      else
+        m_float_tree.load_match_data( ip_set.descriptors(), dist_type, cache_dir );
+    } else
+      vw_throw( ArgumentErr() << "InterestPointIndex: only the L2 and Hamming metrics are supported." );
+  }
+
+  void InterestPointIndex::knn2(InterestPointSet const& query, std::vector<int>& indices,
+                                const ProgressCallback &progress_callback) const {
+    const size_t KNN = 2;
+    Vector<int   > knn_indices(KNN);
+    Vector<double> knn_distances(KNN);
+    const float inc_amt = query.empty() ? 0.0f : 1.0f/float(query.size());
+
+    indices.assign(2*query.size(), -1);
+    progress_callback.report_progress(0);
+    for (size_t i = 0; i < query.size(); ++i) {
+      if (progress_callback.abort_requested())
+        vw_throw( Aborted() << "Aborted by ProgressCallback" );
+      progress_callback.report_incremental_progress(inc_amt);
+
+      size_t num_found = 0;
+      if (m_dist_type == math::FLANN_DistType_Hamming)
+        num_found = m_uchar_tree.knn_search( query.descriptor(i), knn_indices, knn_distances, KNN );
+      else
+        num_found = m_float_tree.knn_search( query.descriptor(i), knn_indices, knn_distances, KNN );
+      for (size_t k = 0; k < num_found && k < KNN; ++k)
+        indices[2*i+k] = knn_indices[k];
+    }
+  }
+
+
   std::string strip_path(std::string out_prefix, std::string filename){
 
     // If filename starts with out_prefix followed by dash, strip both.
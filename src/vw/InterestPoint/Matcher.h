@@ -28,8 +28,11 @@
 #include <vw/Core/Log.h>
 #include <vw/InterestPoint/Descriptor.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+#include <vw/InterestPoint/BinaryDescriptor.h>
 #include <vector>
 #include <boost/foreach.hpp>
+#include <boost/noncopyable.hpp>
 
 #ifdef VW_HAVE_PKG_FLANN
 #include <vw/Math/FLANNTree.h>
@@ -153,13 +156,74 @@ namespace ip {
   //                         Interest Point Matcher
   // ---------------------------------------------------------------------------
 
+  /// How InterestPointMatcher finds the two nearest neighbors of a point.
+  enum MatcherBackend {
+    MatcherBackend_FLANN,      ///< Approximate search with a FLANN tree (default)
+    MatcherBackend_BruteForce  ///< Exact, tiled comparison against every point
+  };
+
+  /// Exact brute force search for the two nearest neighbors of each query
+  /// descriptor.  For query i, indices[2*i] and indices[2*i+1] are set to
+  /// the nearest and second nearest train rows, or -1 if there are fewer
+  /// than two train rows.  Ties go to the lower index.
+  /// - brute_force_knn2_l2() takes row-major num_query x length and
+  ///   num_train x length float matrices and compares squared L2 distances.
+  /// - brute_force_knn2_hamming() compares packed binary descriptors.
+  void brute_force_knn2_l2(float const* query, size_t num_query,
+                           float const* train, size_t num_train,
+                           size_t length, std::vector<int>& indices);
+  void brute_force_knn2_hamming(BinaryDescriptorSet const& query,
+                                BinaryDescriptorSet const& train,
+                                std::vector<int>& indices);
+
+  /// Brute force search between the descriptors of two sets, for the
+  /// L2 or Hamming FLANN distance type.
+  void brute_force_knn2(InterestPointSet const& ip1, InterestPointSet const& ip2,
+                        math::FLANN_DistType dist_type, std::vector<int>& indices);
+
+  /// A FLANN index over the descriptors of an InterestPointSet.
+  ///
+  /// Build it once per image and pass it to InterestPointMatcher to match
+  /// that image against several others.  Searching does not change the
+  /// index, so one index can be searched from several threads at once.
+  class InterestPointIndex : private boost::noncopyable {
+  public:
+    /// dist_type must be FLANN_DistType_L2 or FLANN_DistType_Hamming.
+    /// ip_set must not be empty.  If cache_dir is not empty the index is
+    /// read from there when it was saved for the same descriptors, and is
+    /// saved there otherwise.  See FLANNTree::load_match_data().
+    InterestPointIndex(InterestPointSet const& ip_set, math::FLANN_DistType dist_type,
+                       std::string const& cache_dir = "");
+
+    size_t               size     () const { return m_size;      }
+    math::FLANN_DistType dist_type() const { return m_dist_type; }
+
+    /// The two nearest neighbors of every query point, in the same layout
+    /// as brute_force_knn2().
+    void knn2( InterestPointSet const& query, std::vector<int>& indices,
+               const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+  private:
+    math::FLANN_DistType m_dist_type;
+    size_t               m_size;
+    // FLANNTree::knn_search() is not const, but it does not change the tree.
+    mutable math::FLANNTree<float        > m_float_tree;
+    mutable math::FLANNTree<unsigned char> m_uchar_tree;
+  };
+
   /// Interest point matcher class
+  ///
+  /// With MatcherBackend_BruteForce the nearest neighbors are found exactly
+  /// instead of with FLANN.  This costs O(N*M) distance computations but
+  /// they are done in cache-sized tiles, and it is often faster than FLANN
+  /// for high-dimensional descriptors, where the tree gives little speedup.
   template < class MetricT, class ConstraintT >
   class InterestPointMatcher {
-    ConstraintT m_constraint;
-    MetricT     m_distance_metric;
-    double      m_threshold;
-    bool        m_bidirectional;
+    ConstraintT    m_constraint;
+    MetricT        m_distance_metric;
+    double         m_threshold;
+    bool           m_bidirectional;
+    MatcherBackend m_backend;
 
     // Helper function to help reduce conditionals in the event of
     // NullConstraint. (Which is common).
@@ -173,10 +237,26 @@ namespace ip {
       return true;
     }
 
+    // Apply the constraint and the ratio test to the two nearest neighbors
+    // of every ip1 point, given in the brute_force_knn2() layout.  If
+    // ratios is not null, the distance ratio of every point is stored.
+    template <class IndexListT>
+    void check_candidates( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                           std::vector<int> const& candidates, IndexListT& index_list,
+                           std::vector<float>* ratios ) const;
+
+    // Find the two nearest neighbors of every ip1 point, with ip2_index
+    // if it is not null and otherwise with the selected backend.
+    void find_candidates( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                          InterestPointIndex const* ip2_index, std::vector<int>& candidates,
+                          const ProgressCallback &progress_callback ) const;
+
   public:
 
-    InterestPointMatcher(double threshold = 0.5, MetricT metric = MetricT(), ConstraintT constraint = ConstraintT(), bool bidirectional = false)
-      : m_constraint(constraint), m_distance_metric(metric), m_threshold(threshold), m_bidirectional(bidirectional) { }
+    InterestPointMatcher(double threshold = 0.5, MetricT metric = MetricT(), ConstraintT constraint = ConstraintT(), bool bidirectional = false,
+                         MatcherBackend backend = MatcherBackend_FLANN)
+      : m_constraint(constraint), m_distance_metric(metric), m_threshold(threshold), m_bidirectional(bidirectional),
+        m_backend(backend) { }
 
     /// Given two lists of interest points, this write to index_list
     /// the corresponding matching index in ip2. index_list is the
@@ -193,6 +273,44 @@ namespace ip {
     void operator()( ListT const& ip1, ListT const& ip2,
                      MatchListT& matched_ip1, MatchListT& matched_ip2,
                      const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// InterestPointSet version of the index matcher.  The ip2 descriptors
+    /// are passed to FLANN as one block and the candidate matches are
+    /// looked up by index instead of by walking a list.  A point that fails
+    /// the constraint gets the no-match value, so index_list always has
+    /// ip1.size() entries.
+    template <class IndexListT>
+    void operator()( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                     IndexListT& index_list,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// As above, but search a prebuilt index of ip2 instead of building one.
+    /// The backend setting is ignored.  ip2_index must have been built
+    /// from ip2 with MetricT::flann_type.
+    template <class IndexListT>
+    void operator()( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                     InterestPointIndex const& ip2_index, IndexListT& index_list,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// As the two InterestPointSet index matchers above, but also write
+    /// to ratios, for every ip1 point, the distance to its nearest
+    /// neighbor divided by the distance to the second nearest.  Lower
+    /// ratios are more distinctive matches.  A point without two
+    /// neighbors, or that fails the constraint, gets a ratio of 1.
+    template <class IndexListT>
+    void operator()( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                     IndexListT& index_list, std::vector<float>& ratios,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+    template <class IndexListT>
+    void operator()( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                     InterestPointIndex const& ip2_index, IndexListT& index_list,
+                     std::vector<float>& ratios,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
+
+    /// InterestPointSet version of the pair matcher.
+    void operator()( InterestPointSet const& ip1, InterestPointSet const& ip2,
+                     InterestPointSet& matched_ip1, InterestPointSet& matched_ip2,
+                     const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() ) const;
   };
 
 
@@ -228,6 +346,31 @@ namespace ip {
   void remove_duplicates(std::vector<InterestPoint>& ip1,
                          std::vector<InterestPoint>& ip2);
 
+  /// InterestPointSet version of remove_duplicates().  Gives the same result
+  /// but looks the coordinates up in a map instead of comparing every pair.
+  void remove_duplicates(InterestPointSet& ip1, InterestPointSet& ip2);
+
+  /// As remove_duplicates(), but also remove the entries of a per-match
+  /// score vector, such as the ratios from InterestPointMatcher, so that
+  /// it stays aligned with the matches.  Uses the same lookup as the
+  /// InterestPointSet version.
+  void remove_duplicates(std::vector<InterestPoint>& ip1,
+                         std::vector<InterestPoint>& ip2,
+                         std::vector<float>& scores);
+
+  /// Thin a set of matches to a uniform spatial density before RANSAC.
+  /// The first image is divided into square cells of cell_size pixels,
+  /// and at most max_per_cell matches are kept in each cell, those with
+  /// the lowest score.  If scores is empty, the first matches in each
+  /// cell are kept.  Returns the indices of the kept matches in
+  /// increasing order.
+  std::vector<size_t> bucket_matches(std::vector<InterestPoint> const& ip1,
+                                     std::vector<float> const& scores,
+                                     double cell_size, size_t max_per_cell);
+  std::vector<size_t> bucket_matches(InterestPointSet const& ip1,
+                                     std::vector<float> const& scores,
+                                     double cell_size, size_t max_per_cell);
+
   /// The name of the match file.
   std::string match_filename(std::string const& out_prefix,
                              std::string const& input_file1,
@@ -312,30 +455,45 @@ void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, L
   Matrix<float        > ip2_matrix_float;
   Matrix<unsigned char> ip2_matrix_uchar;
 
-  // Pack the IP descriptors into a matrix and feed it to the chosen FLANNTree object
+  const bool use_brute_force = (m_backend == MatcherBackend_BruteForce);
   const bool use_uchar_FLANN = (MetricT::flann_type == math::FLANN_DistType_Hamming);
-  if (use_uchar_FLANN) {
-    ip_list_to_matrix(ip2, ip2_matrix_uchar);
-    kd_uchar.load_match_data( ip2_matrix_uchar, MetricT::flann_type );
-  }else {
-    ip_list_to_matrix(ip2, ip2_matrix_float);
-    kd_float.load_match_data( ip2_matrix_float,  MetricT::flann_type );
+  std::vector<int> brute_force_indices;
+  if (use_brute_force) {
+    // Find the neighbors of all the points up front.
+    vw_out(InfoMessage,"interest_point") << "Brute force search...\n";
+    brute_force_knn2(InterestPointSet(ip1), InterestPointSet(ip2),
+                     MetricT::flann_type, brute_force_indices);
+  } else {
+    // Pack the IP descriptors into a matrix and feed it to the chosen FLANNTree object
+    if (use_uchar_FLANN) {
+      ip_list_to_matrix(ip2, ip2_matrix_uchar);
+      kd_uchar.load_match_data( ip2_matrix_uchar, MetricT::flann_type );
+    }else {
+      ip_list_to_matrix(ip2, ip2_matrix_float);
+      kd_float.load_match_data( ip2_matrix_float,  MetricT::flann_type );
+    }
+    vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
   }
 
-  vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
-
   const size_t KNN = 2; // Find this many matches
   Vector<int   > indices(KNN);
   Vector<double> distances(KNN);
   progress_callback.report_progress(0);
 
+  size_t query = 0;
   BOOST_FOREACH( InterestPoint ip, ip1 ) {
     if (progress_callback.abort_requested())
       vw_throw( Aborted() << "Aborted by ProgressCallback" );
     progress_callback.report_incremental_progress(inc_amt);
 
     size_t num_matches_found = 0;
-    if (use_uchar_FLANN) {
+    if (use_brute_force) {
+      indices[0] = brute_force_indices[2*query];
+      indices[1] = brute_force_indices[2*query+1];
+      num_matches_found = (indices[0] >= 0) + (indices[1] >= 0);
+      ++query;
+    }
+    else if (use_uchar_FLANN) {
       // Convert the descriptor to unsigned chars, then call FLANN
       vw::Vector<unsigned char> uchar_descriptor(ip.descriptor.size());
       for (size_t i=0; i<ip.descriptor.size(); ++i)
@@ -419,6 +577,175 @@ void InterestPointMatcher<MetricT, ConstraintT>::operator()( ListT const& ip1, L
 
 
 
+template <class MetricT, class ConstraintT>
+template <class IndexListT>
+void InterestPointMatcher<MetricT, ConstraintT>::check_candidates( InterestPointSet const& ip1,
+                                                                   InterestPointSet const& ip2,
+                                                                   std::vector<int> const& candidates,
+                                                                   IndexListT& index_list,
+                                                                   std::vector<float>* ratios ) const {
+  // Scratch points for the metric and constraint functors.  Their
+  // descriptor storage is reused from one query to the next.
+  InterestPoint ip, nearest0, nearest1;
+
+  if (ratios)
+    ratios->assign(ip1.size(), 1.0f);
+  for (size_t i = 0; i < ip1.size(); ++i) {
+    const int index0 = candidates[2*i], index1 = candidates[2*i+1];
+
+    ip1.get(i, ip);
+    if (index0 < 0 || index1 < 0) {
+      // If we did not get two nearest neighbors, return no match for this point.
+      vw_out() << "Bad descriptor = " << ip.descriptor << std::endl;
+      index_list.push_back( (size_t)(-1) ); // Last value of size_t
+      continue;
+    }
+
+    ip2.get(index0, nearest0);
+    ip2.get(index1, nearest1);
+
+    size_t result = (size_t)(-1);
+    if ( check_constraint<ConstraintT>( nearest0, ip ) ) {
+      double dist0 = m_distance_metric(nearest0, ip);
+      double dist1 = m_distance_metric(nearest1, ip);
+
+      // Make sure the nearest record is significantly closer than the next one.
+      if (dist0 < m_threshold * dist1)
+        result = index0;
+      if (ratios && dist1 > 0)
+        (*ratios)[i] = float(dist0 / dist1);
+    }
+    index_list.push_back( result );
+  }
+}
+
+template <class MetricT, class ConstraintT>
+void InterestPointMatcher<MetricT, ConstraintT>::find_candidates( InterestPointSet const& ip1,
+                                                                  InterestPointSet const& ip2,
+                                                                  InterestPointIndex const* ip2_index,
+                                                                  std::vector<int>& candidates,
+                                                                  const ProgressCallback &progress_callback) const {
+  if (ip2_index) {
+    VW_ASSERT( ip2_index->size() == ip2.size() && ip2_index->dist_type() == MetricT::flann_type,
+               ArgumentErr() << "InterestPointMatcher: the index was not built for these points." );
+    ip2_index->knn2(ip1, candidates, progress_callback);
+  } else if (m_backend == MatcherBackend_BruteForce) {
+    vw_out(InfoMessage,"interest_point") << "Brute force search...\n";
+    progress_callback.report_progress(0);
+    brute_force_knn2(ip1, ip2, MetricT::flann_type, candidates);
+  } else {
+    InterestPointIndex index(ip2, MetricT::flann_type);
+    vw_out(InfoMessage,"interest_point") << "FLANN-Tree created. Searching...\n";
+    index.knn2(ip1, candidates, progress_callback);
+  }
+}
+
+template <class MetricT, class ConstraintT>
+template <class IndexListT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSet const& ip1,
+                                                             InterestPointSet const& ip2,
+                                                             IndexListT& index_list,
+                                                             const ProgressCallback &progress_callback) const {
+
+  Timer total_time("Total elapsed time", DebugMessage, "interest_point");
+
+  index_list.clear();
+  if (ip1.empty() || ip2.empty()) {
+    vw_out(InfoMessage,"interest_point") << "KD-Tree: no points to match, exiting\n";
+    progress_callback.report_finished();
+    return;
+  }
+
+  std::vector<int> candidates;
+  find_candidates(ip1, ip2, 0, candidates, progress_callback);
+  check_candidates(ip1, ip2, candidates, index_list, 0);
+  progress_callback.report_finished();
+}
+
+template <class MetricT, class ConstraintT>
+template <class IndexListT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSet const& ip1,
+                                                             InterestPointSet const& ip2,
+                                                             InterestPointIndex const& ip2_index,
+                                                             IndexListT& index_list,
+                                                             const ProgressCallback &progress_callback) const {
+  index_list.clear();
+  if (ip1.empty() || ip2.empty()) {
+    progress_callback.report_finished();
+    return;
+  }
+
+  std::vector<int> candidates;
+  find_candidates(ip1, ip2, &ip2_index, candidates, progress_callback);
+  check_candidates(ip1, ip2, candidates, index_list, 0);
+  progress_callback.report_finished();
+}
+
+template <class MetricT, class ConstraintT>
+template <class IndexListT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSet const& ip1,
+                                                             InterestPointSet const& ip2,
+                                                             IndexListT& index_list,
+                                                             std::vector<float>& ratios,
+                                                             const ProgressCallback &progress_callback) const {
+  index_list.clear();
+  ratios.assign(ip1.size(), 1.0f);
+  if (ip1.empty() || ip2.empty()) {
+    progress_callback.report_finished();
+    return;
+  }
+
+  std::vector<int> candidates;
+  find_candidates(ip1, ip2, 0, candidates, progress_callback);
+  check_candidates(ip1, ip2, candidates, index_list, &ratios);
+  progress_callback.report_finished();
+}
+
+template <class MetricT, class ConstraintT>
+template <class IndexListT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSet const& ip1,
+                                                             InterestPointSet const& ip2,
+                                                             InterestPointIndex const& ip2_index,
+                                                             IndexListT& index_list,
+                                                             std::vector<float>& ratios,
+                                                             const ProgressCallback &progress_callback) const {
+  index_list.clear();
+  ratios.assign(ip1.size(), 1.0f);
+  if (ip1.empty() || ip2.empty()) {
+    progress_callback.report_finished();
+    return;
+  }
+
+  std::vector<int> candidates;
+  find_candidates(ip1, ip2, &ip2_index, candidates, progress_callback);
+  check_candidates(ip1, ip2, candidates, index_list, &ratios);
+  progress_callback.report_finished();
+}
+
+template <class MetricT, class ConstraintT>
+void InterestPointMatcher<MetricT, ConstraintT>::operator()( InterestPointSet const& ip1,
+                                                             InterestPointSet const& ip2,
+                                                             InterestPointSet& matched_ip1,
+                                                             InterestPointSet& matched_ip2,
+                                                             const ProgressCallback &progress_callback) const {
+  matched_ip1.clear();
+  matched_ip2.clear();
+
+  std::vector<size_t> index_list;
+  this->operator()(ip1, ip2, index_list, progress_callback);
+
+  std::vector<size_t> keep1, keep2;
+  for (size_t i = 0; i < index_list.size(); ++i) {
+    if (index_list[i] < ip2.size()) {
+      keep1.push_back(i);
+      keep2.push_back(index_list[i]);
+    }
+  }
+  ip1.subset(keep1).swap(matched_ip1);
+  ip2.subset(keep2).swap(matched_ip2);
+}
+
+
 //-----------------------------------------------------------
 // InterestPointMatcherSimple
 
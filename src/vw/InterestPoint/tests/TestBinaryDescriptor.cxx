@@ -0,0 +1,139 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/InterestPoint/BinaryDescriptor.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+using namespace vw;
+using namespace vw::ip;
+
+namespace {
+  // Make count random descriptors of num_bytes bytes, stored as floats
+  // like the OpenCV binary detectors do.
+  std::vector<InterestPoint> random_descriptors(size_t count, size_t num_bytes,
+                                                boost::random::mt19937& gen) {
+    boost::random::uniform_int_distribution<> byte(0, 255);
+    std::vector<InterestPoint> ips(count);
+    for (size_t i = 0; i < count; i++) {
+      ips[i].descriptor.set_size(num_bytes);
+      for (size_t k = 0; k < num_bytes; k++)
+        ips[i].descriptor[k] = byte(gen);
+    }
+    return ips;
+  }
+
+  // Flip num_flips distinct bits of a float-stored binary descriptor.
+  void flip_bits(InterestPoint& ip, int num_flips) {
+    for (int f = 0; f < num_flips; f++) {
+      size_t bit  = (f * 37) % (8*ip.size());
+      uint8  byte = uint8(ip.descriptor[bit/8]) ^ uint8(1 << (bit%8));
+      ip.descriptor[bit/8] = byte;
+    }
+  }
+}
+
+TEST( BinaryDescriptor, PackAndDistance ) {
+  boost::random::mt19937 gen(42);
+  // 61 bytes: BRISK-like length that does not fill the last word.
+  std::vector<InterestPoint> ips = random_descriptors(20, 61, gen);
+  BinaryDescriptorSet packed(ips);
+  ASSERT_EQ( 20u, packed.size() );
+  EXPECT_EQ( 61u, packed.num_bytes() );
+  EXPECT_EQ( 8u,  packed.words_per_descriptor() );
+  for (size_t k = 0; k < 61; k++)
+    EXPECT_EQ( uint8(ips[3].descriptor[k]), packed.byte(3, k) );
+  EXPECT_EQ( 0u, packed.data(3)[7] >> 40 ); // Padding bytes are zero
+
+  // Distances agree with a byte by byte count.
+  std::vector<uint32> dists(packed.size());
+  binary_hamming_distances(packed.data(0), packed.data(0), packed.size(),
+                           packed.words_per_descriptor(), &dists[0]);
+  for (size_t i = 0; i < packed.size(); i++) {
+    size_t expected = 0;
+    for (size_t k = 0; k < 61; k++)
+      expected += hamming_distance(uint8(ips[0].descriptor[k]), uint8(ips[i].descriptor[k]));
+    EXPECT_EQ( expected, dists[i] );
+    EXPECT_EQ( expected, binary_hamming_distance(packed.data(0), packed.data(i), 8) );
+  }
+  EXPECT_EQ( 0u, dists[0] );
+
+  // Raw bytes and InterestPointSet input give the same packing.
+  std::vector<uint8> raw(61);
+  for (size_t k = 0; k < 61; k++)
+    raw[k] = uint8(ips[5].descriptor[k]);
+  BinaryDescriptorSet from_bytes;
+  from_bytes.set_num_bytes(61);
+  from_bytes.push_back(&raw[0]);
+  BinaryDescriptorSet from_set((InterestPointSet(ips)));
+  for (size_t w = 0; w < 8; w++) {
+    EXPECT_EQ( packed.data(5)[w], from_bytes.data(0)[w] );
+    EXPECT_EQ( packed.data(5)[w], from_set.data(5)[w] );
+  }
+}
+
+TEST( BinaryDescriptor, Matcher ) {
+  boost::random::mt19937 gen(7);
+  const size_t NUM_BYTES = 32; // ORB
+  std::vector<InterestPoint> train = random_descriptors(500, NUM_BYTES, gen);
+
+  // Queries 0-49 are lightly perturbed copies of train points, 50-59 are noise.
+  std::vector<InterestPoint> query;
+  for (size_t i = 0; i < 50; i++) {
+    query.push_back(train[i*7]);
+    flip_bits(query.back(), int(i % 10));
+  }
+  std::vector<InterestPoint> noise = random_descriptors(10, NUM_BYTES, gen);
+  query.insert(query.end(), noise.begin(), noise.end());
+
+  BinaryDescriptorSet query_set(query), train_set(train);
+
+  // Exhaustive search agrees with InterestPointMatcherSimple-style brute force.
+  std::vector<size_t> exhaustive;
+  BinaryDescriptorMatcher(0.8)(query_set, train_set, exhaustive);
+  ASSERT_EQ( query.size(), exhaustive.size() );
+  for (size_t i = 0; i < 50; i++)
+    EXPECT_EQ( i*7, exhaustive[i] );
+  for (size_t i = 50; i < query.size(); i++)
+    EXPECT_EQ( size_t(-1), exhaustive[i] );
+
+  // Multi-index hashing keeps only matches that the exhaustive search
+  // also found.  With 16 tables and radius 1 everything closer than 32
+  // bits is seen, which covers all of the perturbed queries.
+  std::vector<size_t> hashed;
+  BinaryDescriptorMatcher(0.8, 16, 1)(query_set, train_set, hashed);
+  ASSERT_EQ( exhaustive.size(), hashed.size() );
+  for (size_t i = 0; i < hashed.size(); i++)
+    EXPECT_EQ( exhaustive[i], hashed[i] );
+
+  // Exact substring probes only see points closer than 16 bits.
+  std::vector<size_t> exact_probe;
+  BinaryDescriptorMatcher(0.8, 16, 0)(query_set, train_set, exact_probe);
+  for (size_t i = 0; i < exact_probe.size(); i++) {
+    if (exact_probe[i] != size_t(-1)) {
+      EXPECT_EQ( exhaustive[i], exact_probe[i] );
+    }
+  }
+  EXPECT_EQ( 7u, exact_probe[1] );
+
+  // Too few tables for 256 bit descriptors
+  EXPECT_THROW( BinaryDescriptorMatcher(0.8, 4)(query_set, train_set, hashed), ArgumentErr );
+}
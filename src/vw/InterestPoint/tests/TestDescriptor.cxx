@@ -0,0 +1,145 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestDescriptor.cxx
+#include <gtest/gtest_VW.h>
+
+#include <vw/InterestPoint/Descriptor.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Statistics.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::ip;
+
+namespace {
+  ImageView<PixelGray<uint8> > test_image( int32 cols, int32 rows ) {
+    ImageView<PixelGray<uint8> > image(cols,rows);
+    for ( int32 j = 0; j < rows; j++ )
+      for ( int32 i = 0; i < cols; i++ )
+        image(i,j) = uint8((i*i + 7*j*i + 3*j) % 251);
+    return image;
+  }
+
+  InterestPointList test_points() {
+    InterestPointList points;
+    points.push_back( InterestPoint( 40.0f,   30.0f,  1.0f ) );
+    points.push_back( InterestPoint( 65.25f,  41.5f,  2.5f ) );
+    points.push_back( InterestPoint( 3.5f,    2.75f,  1.5f ) ); // Support runs off the image
+    points.push_back( InterestPoint( 118.0f,  89.0f,  0.75f ) );
+    float angle = 0.3f;
+    for ( InterestPointList::iterator i = points.begin(); i != points.end(); ++i ) {
+      i->orientation = angle;
+      angle += 1.1f;
+    }
+    return points;
+  }
+
+  bool x_less_than( InterestPoint const& a, InterestPoint const& b ) {
+    return a.x < b.x;
+  }
+
+  // The descriptors the old per point code produced.
+  template <class ViewT>
+  std::vector<Vector<float> > reference_descriptors( ImageViewBase<ViewT> const& image,
+                                                     InterestPointList const& points ) {
+    PatchDescriptorGenerator generator;
+    std::vector<Vector<float> > result;
+    for ( InterestPointList::const_iterator i = points.begin(); i != points.end(); ++i ) {
+      ImageView<PixelGray<float> > support =
+        generator.get_support( *i, pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image.impl())) );
+      Vector<float> descriptor( generator.descriptor_size() );
+      generator.compute_descriptor( support, descriptor.begin(), descriptor.end() );
+      result.push_back( descriptor );
+    }
+    return result;
+  }
+
+  void expect_descriptors( std::vector<Vector<float> > const& expected,
+                           InterestPointList const& points ) {
+    ASSERT_EQ( expected.size(), points.size() );
+    size_t k = 0;
+    for ( InterestPointList::const_iterator i = points.begin(); i != points.end(); ++i, ++k ) {
+      ASSERT_EQ( expected[k].size(), i->descriptor.size() );
+      EXPECT_VECTOR_NEAR( expected[k], i->descriptor, 1e-4 );
+    }
+  }
+}
+
+TEST( Descriptor, ExtractSupport ) {
+  ImageView<PixelGray<float> > image =
+    pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(test_image(128,96)));
+  InterestPointList points = test_points();
+  PatchDescriptorGenerator generator;
+
+  // The direct resampler matches rasterizing get_support(), including
+  // the zero edge extension and an offset buffer origin.
+  ImageView<PixelGray<float> > support;
+  for ( InterestPointList::const_iterator i = points.begin(); i != points.end(); ++i ) {
+    ImageView<PixelGray<float> > expected = generator.get_support( *i, image );
+    generator.extract_support( *i, image, Vector2i(), support );
+    ASSERT_EQ( expected.cols(), support.cols() );
+    ASSERT_EQ( expected.rows(), support.rows() );
+    EXPECT_NEAR( 0, max_pixel_value( abs( expected - support ) ), 1e-5 );
+
+    BBox2i bbox = generator.support_bbox( i, boost::next(i) );
+    ImageView<PixelGray<float> > region = crop( edge_extend( image, ZeroEdgeExtension() ), bbox );
+    generator.extract_support( *i, region, bbox.min(), support );
+    EXPECT_NEAR( 0, max_pixel_value( abs( expected - support ) ), 1e-5 );
+  }
+}
+
+TEST( Descriptor, BatchMatchesPerPoint ) {
+  ImageView<PixelGray<uint8> > image = test_image(128,96);
+  InterestPointList points = test_points();
+  std::vector<Vector<float> > expected = reference_descriptors( image, points );
+
+  // Generic view: rescaled to float once for the whole batch.
+  PatchDescriptorGenerator generator;
+  generator( image, points );
+  expect_descriptors( expected, points );
+
+  // Float buffer: described in place.
+  InterestPointList float_points = test_points();
+  ImageView<PixelGray<float> > float_image =
+    pixel_cast<PixelGray<float> >(channel_cast_rescale<float>(image));
+  generator( float_image, float_points );
+  expect_descriptors( expected, float_points );
+
+  // Tiled, multithreaded description.
+  InterestPointList tiled_points = test_points();
+  describe_interest_points( float_image, generator, tiled_points );
+  tiled_points.sort( x_less_than );
+  InterestPointList sorted_points = test_points();
+  sorted_points.sort( x_less_than );
+  expect_descriptors( reference_descriptors( image, sorted_points ), tiled_points );
+}
+
+TEST( Descriptor, SpreadPoints ) {
+  // Points too far apart to rasterize together are described one at a time.
+  ImageView<PixelGray<uint8> > image = test_image(1500,1500);
+  InterestPointList points;
+  points.push_back( InterestPoint( 20.0f,   30.0f,   1.0f ) );
+  points.push_back( InterestPoint( 1400.5f, 1350.0f, 2.0f ) );
+  points.push_back( InterestPoint( 700.0f,  20.25f,  1.0f ) );
+  std::vector<Vector<float> > expected = reference_descriptors( image, points );
+
+  PatchDescriptorGenerator generator;
+  generator( image, points );
+  expect_descriptors( expected, points );
+}
@@ -0,0 +1,84 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestImageOctave.cxx
+#include <gtest/gtest_VW.h>
+
+#include <vw/InterestPoint/ImageOctave.h>
+#include <vw/InterestPoint/ImageOctaveHistory.h>
+#include <vw/Image/ImageMath.h>
+#include <vw/Image/Statistics.h>
+
+using namespace vw;
+using namespace vw::ip;
+
+namespace {
+  ImageView<float> test_image() {
+    ImageView<float> image(64,48);
+    for ( int32 j = 0; j < image.rows(); j++ )
+      for ( int32 i = 0; i < image.cols(); i++ )
+        image(i,j) = float((i*i + 3*j) % 17) / 17.0f;
+    return image;
+  }
+}
+
+TEST( ImageOctave, ParallelPlanes ) {
+  ImageView<float> image = test_image();
+  ImageOctave<ImageView<float> > serial  ( image, 3, 1 );
+  ImageOctave<ImageView<float> > parallel( image, 3, 4 );
+
+  for ( int o = 0; o < 2; o++ ) {
+    ASSERT_EQ( 5u, parallel.scales.size() );
+    for ( int k = 0; k < parallel.num_planes; k++ ) {
+      ASSERT_EQ( serial.scales[k].cols(), parallel.scales[k].cols() );
+      ASSERT_EQ( serial.scales[k].rows(), parallel.scales[k].rows() );
+      EXPECT_EQ( 0, max_pixel_value( abs( serial.scales[k] - parallel.scales[k] ) ) );
+    }
+    serial.build_next();
+    parallel.build_next();
+  }
+
+  // Blurring each plane from plane 0 matches blurring it from the plane
+  // below, away from the edges where the kernels are truncated.
+  ImageOctave<ImageView<float> > octave( image, 3, 1 );
+  for ( int k = 1; k < octave.num_planes; k++ ) {
+    float use_sigma = sqrt( octave.sigma[k]*octave.sigma[k] -
+                            octave.sigma[k-1]*octave.sigma[k-1] );
+    ImageView<float> chained = gaussian_filter( octave.scales[k-1], use_sigma );
+    for ( int32 j = 16; j < image.rows()-16; j++ )
+      for ( int32 i = 16; i < image.cols()-16; i++ )
+        EXPECT_NEAR( chained(i,j), octave.scales[k](i,j), 2e-2 );
+  }
+}
+
+TEST( ImageOctave, BoundedHistory ) {
+  ImageOctave<ImageView<float> > octave( test_image(), 3 );
+  ImageOctaveHistory<ImageView<float> > history(2);
+  for ( int o = 0; o < 3; o++ ) {
+    history.add_octave( octave.scales );
+    octave.build_next();
+  }
+  EXPECT_EQ( 3, history.octaves() );
+  EXPECT_EQ( 3, history.scales() );
+  EXPECT_FALSE( history.is_resident(0) );
+  EXPECT_TRUE ( history.is_resident(1) );
+  EXPECT_TRUE ( history.is_resident(2) );
+  EXPECT_THROW( history.image_at_scale(1.0), ArgumentErr );
+  EXPECT_EQ( 32, history.image_at_scale(2.0).cols() );
+  EXPECT_EQ( 16, history.image_at_scale(4.0).cols() );
+}
@@ -20,6 +20,8 @@
 #include <gtest/gtest_VW.h>
 
 #include <vw/InterestPoint/IntegralImage.h>
+#include <vw/InterestPoint/IntegralDetector.h>
+#include <vw/InterestPoint/IntegralDescriptor.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Interpolation.h>
 #include <vw/FileIO/DiskImageResource.h>
@@ -48,6 +50,64 @@ TEST( Integral, IntegralSumming ) {
   }
 }
 
+TEST( Integral, IntegralPrecision ) {
+  ImageView<PixelGray<uint8> > image(37,23);
+  for ( int32 j = 0; j < image.rows(); j++ )
+    for ( int32 i = 0; i < image.cols(); i++ )
+      image(i,j) = uint8((i*7 + j*13) % 256);
+
+  ImageView<int64 > exact      = integral_image<int64 >( image );
+  ImageView<float > single     = integral_image<float >( image );
+  ImageView<double> reference  = integral_image<double>( image );
+  ASSERT_EQ( image.cols()+1, exact.cols() );
+  ASSERT_EQ( image.rows()+1, exact.rows() );
+
+  for ( int32 y = 0; y <= image.rows(); y++ ) {
+    for ( int32 x = 0; x <= image.cols(); x++ ) {
+      int64 sum = 0;
+      for ( int32 j = 0; j < y; j++ )
+        for ( int32 i = 0; i < x; i++ )
+          sum += image(i,j).v();
+      EXPECT_EQ( sum, exact(x,y) );
+      EXPECT_NEAR( double(sum), reference(x,y), 1e-9 );
+      EXPECT_NEAR( double(sum), single(x,y), 1e-6*double(sum) + 1e-3 );
+    }
+  }
+}
+
+TEST( Integral, SharedIntegral ) {
+  ImageView<float> graffiti;
+  read_image( graffiti, TEST_SRCDIR"/sub.png" );
+
+  // Detecting from a prebuilt integral matches detecting from the image.
+  IntegralInterestPointDetector<OBALoGInterestOperator> detector( OBALoGInterestOperator(0.0), 50 );
+  ImageView<float> integral = integral_image<float>( pixel_cast_rescale<PixelGray<float> >(graffiti) );
+  InterestPointList from_image    = detector.process_image   ( graffiti );
+  InterestPointList from_integral = detector.process_integral( integral );
+  ASSERT_EQ( from_image.size(), from_integral.size() );
+  ASSERT_FALSE( from_image.empty() );
+  for ( InterestPointList::const_iterator a = from_image.begin(), b = from_integral.begin();
+        a != from_image.end(); ++a, ++b ) {
+    EXPECT_EQ( a->ix, b->ix );
+    EXPECT_EQ( a->iy, b->iy );
+    EXPECT_EQ( a->interest,    b->interest    );
+    EXPECT_EQ( a->orientation, b->orientation );
+  }
+
+  // The same float integral gives the same descriptors as the double
+  // integral the generator builds for itself.
+  InterestPointList described = from_image;
+  SGrad2DescriptorGenerator generator;
+  generator( graffiti, from_image );
+  generator.compute_descriptors( integral, described.begin(), described.end() );
+  for ( InterestPointList::const_iterator a = from_image.begin(), b = described.begin();
+        a != from_image.end(); ++a, ++b ) {
+    ASSERT_EQ( a->descriptor.size(), b->descriptor.size() );
+    for ( size_t k = 0; k < a->descriptor.size(); k++ )
+      EXPECT_NEAR( a->descriptor[k], b->descriptor[k], 1e-3 );
+  }
+}
+
 TEST( Integral, HaarFilters ) {
   // Loading Image
   ImageView<float> graffiti, gradient;
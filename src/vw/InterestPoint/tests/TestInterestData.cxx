@@ -19,6 +19,8 @@
 #include <gtest/gtest_VW.h>
 #include <test/Helpers.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
+#include <vw/InterestPoint/InterestPointFile.h>
 
 using namespace vw;
 using namespace vw::ip;
@@ -108,3 +110,146 @@ TEST( InterestData, MATCH_IO_Loop ) {
     ip1iter++; ip2iter++;
   }
 }
+
+TEST( InterestData, CullInterestPoints ) {
+  // Two clusters of nearby points plus one isolated point.
+  InterestPointList ip;
+  ip.push_back( InterestPoint( 10.0, 10.0, 1.0, 0.5 ) );
+  ip.push_back( InterestPoint( 10.5, 10.0, 1.0, 0.9 ) ); // Suppresses the first
+  ip.push_back( InterestPoint( 50.0, 50.0, 1.0, 0.1 ) );
+  ip.push_back( InterestPoint( 51.0, 50.0, 1.0, 0.2 ) ); // Suppresses the previous
+  ip.push_back( InterestPoint( 90.0, 10.0, 1.0, 0.3 ) );
+
+  InterestPointList nms = ip;
+  cull_interest_points( nms, 2.0 );
+  ASSERT_EQ( 3u, nms.size() );
+  InterestPointList::const_iterator it = nms.begin();
+  EXPECT_EQ( 10.5, it->x ); ++it; // Original order is kept
+  EXPECT_EQ( 51.0, it->x ); ++it;
+  EXPECT_EQ( 90.0, it->x );
+
+  // Nothing is in range at a tiny radius.
+  InterestPointList tiny = ip;
+  cull_interest_points( tiny, 0.1 );
+  EXPECT_EQ( 5u, tiny.size() );
+
+  // Keep the single strongest point in each 64x64 region.
+  InterestPointList regions = ip;
+  cull_interest_points( regions, 0, 64, 1 );
+  ASSERT_EQ( 2u, regions.size() );
+  EXPECT_EQ( 10.5, regions.front().x );
+  EXPECT_EQ( 90.0, regions.back ().x );
+
+  // Disabled culling leaves the list alone.
+  InterestPointList none = ip;
+  cull_interest_points( none, 0 );
+  EXPECT_EQ( 5u, none.size() );
+}
+
+TEST( InterestData, InterestPointSet_IO_Loop ) {
+  InterestPointList ip;
+  for ( uint32 i = 0; i < 5; i++ ) {
+    ip.push_back( InterestPoint( 2*i, 2*i+5, 1.0, -i, i, true, 5 ) );
+    ip.back().descriptor = Vector3(5,6,i);
+  }
+  InterestPointSet ip_set(ip);
+  ASSERT_EQ( 5u, ip_set.size() );
+
+  // The list and set writers produce files that either reader can load.
+  UnlinkName vwip_file( "monkey_set.vwip" );
+  write_binary_ip_file( vwip_file, ip_set );
+  InterestPointList list_result = read_binary_ip_file_list( vwip_file );
+  InterestPointSet  set_result  = read_binary_ip_file_set ( vwip_file );
+  ASSERT_EQ( 5u, list_result.size() );
+  ASSERT_EQ( 5u, set_result.size() );
+
+  InterestPointList::iterator ipiter = ip.begin(), listiter = list_result.begin();
+  for ( size_t i = 0; i < 5; i++ ) {
+    InterestPoint p = set_result[i];
+    EXPECT_EQ( ipiter->x, p.x );
+    EXPECT_EQ( ipiter->y, p.y );
+    EXPECT_EQ( ipiter->ix, p.ix );
+    EXPECT_EQ( ipiter->iy, p.iy );
+    EXPECT_EQ( ipiter->scale, p.scale );
+    EXPECT_EQ( ipiter->orientation, p.orientation );
+    EXPECT_EQ( ipiter->interest, p.interest );
+    EXPECT_EQ( ipiter->polarity, p.polarity );
+    EXPECT_EQ( ipiter->octave, p.octave );
+    EXPECT_EQ( ipiter->scale_lvl, p.scale_lvl );
+    EXPECT_VECTOR_FLOAT_EQ( ipiter->descriptor, p.descriptor );
+    EXPECT_VECTOR_FLOAT_EQ( ipiter->descriptor, listiter->descriptor );
+    ++ipiter;
+    ++listiter;
+  }
+
+  UnlinkName match_file( "monkey_set.match" );
+  write_binary_match_file( match_file, ip_set, set_result );
+  InterestPointSet m1, m2;
+  read_binary_match_file( match_file, m1, m2 );
+  ASSERT_EQ( 5u, m1.size() );
+  ASSERT_EQ( 5u, m2.size() );
+  EXPECT_EQ( ip_set.y(4), m2.y(4) );
+  EXPECT_VECTOR_FLOAT_EQ( ip_set.descriptor(3), m1.descriptor(3) );
+}
+
+TEST( InterestData, VersionedFormat ) {
+  std::vector<InterestPoint> ip1, ip2;
+  for ( uint32 i = 0; i < 7; i++ ) {
+    ip1.push_back( InterestPoint( 2*i+0.5, 2*i+5, 1.0, -float(i), i, true, 5, i ) );
+    ip1.back().descriptor = Vector4(5,6,i,-1);
+    ip2.push_back( InterestPoint( 20-2*i, i, 0.5, i, 5-i, false, 6 ) );
+    ip2.back().descriptor = Vector4(7,i,2,3);
+  }
+  InterestPointSet set1(ip1), set2(ip2);
+
+  // Legacy files are not mistaken for the new layout.
+  UnlinkName legacy_file( "monkey_legacy.match" );
+  write_binary_match_file( legacy_file, ip1, ip2 );
+  EXPECT_FALSE( is_versioned_ip_file( legacy_file ) );
+  InterestPointSet legacy1, legacy2;
+  read_binary_match_file( legacy_file, legacy1, legacy2 );
+  ASSERT_EQ( 7u, legacy2.size() );
+  EXPECT_VECTOR_FLOAT_EQ( ip2[6].descriptor, legacy2.descriptor(6) );
+
+  UnlinkName match_file( "monkey_v2.match" );
+  write_binary_match_file( match_file, set1, set2 );
+  ASSERT_TRUE( is_versioned_ip_file( match_file ) );
+
+  // Records and descriptors are read in place.
+  MappedInterestPointFile mapped( match_file );
+  ASSERT_EQ( 2u, mapped.num_sets() );
+  ASSERT_EQ( 7u, mapped.size(0) );
+  ASSERT_EQ( 7u, mapped.size(1) );
+  EXPECT_EQ( 4u, mapped.descriptor_length(1) );
+  EXPECT_EQ( 0u, size_t(mapped.descriptors(0)) % 64 );
+  EXPECT_EQ( ip1[3].x,         mapped.record(3, 0).x );
+  EXPECT_EQ( ip1[3].iy,        mapped.record(3, 0).iy );
+  EXPECT_EQ( ip1[3].scale_lvl, mapped.record(3, 0).scale_lvl );
+  EXPECT_EQ( 1,                mapped.record(3, 0).polarity );
+  EXPECT_EQ( 0,                mapped.record(3, 1).polarity );
+  EXPECT_EQ( ip2[5].descriptor[1], mapped.descriptor(5, 1)[1] );
+
+  // The vector reader understands the new layout too.
+  std::vector<InterestPoint> result1, result2;
+  read_binary_match_file( match_file, result1, result2 );
+  ASSERT_EQ( 7u, result1.size() );
+  ASSERT_EQ( 7u, result2.size() );
+  for ( size_t i = 0; i < 7; i++ ) {
+    EXPECT_EQ( ip1[i].x, result1[i].x );
+    EXPECT_EQ( ip1[i].ix, result1[i].ix );
+    EXPECT_EQ( ip1[i].interest, result1[i].interest );
+    EXPECT_EQ( ip1[i].octave, result1[i].octave );
+    EXPECT_EQ( ip2[i].orientation, result2[i].orientation );
+    EXPECT_EQ( ip2[i].polarity, result2[i].polarity );
+    EXPECT_VECTOR_FLOAT_EQ( ip1[i].descriptor, result1[i].descriptor );
+    EXPECT_VECTOR_FLOAT_EQ( ip2[i].descriptor, result2[i].descriptor );
+  }
+
+  // A .vwip file holds a single set and is rejected as a match file.
+  UnlinkName vwip_file( "monkey_v2.vwip" );
+  write_binary_ip_file( vwip_file, set2 );
+  InterestPointList list_result = read_binary_ip_file_list( vwip_file );
+  ASSERT_EQ( 7u, list_result.size() );
+  EXPECT_EQ( ip2[0].y, list_result.front().y );
+  EXPECT_THROW( read_binary_match_file( vwip_file, result1, result2 ), IOErr );
+}
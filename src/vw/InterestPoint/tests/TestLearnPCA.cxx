@@ -0,0 +1,95 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestLearnPCA.cxx
+#include <gtest/gtest_VW.h>
+
+#include <vw/InterestPoint/LearnPCA.h>
+#include <test/Helpers.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+using namespace vw;
+using namespace vw::ip;
+
+namespace {
+  // Descriptors far from the origin, varying along a few directions
+  // with falling variance plus a little noise in all of them.
+  std::vector<double> test_descriptors( int dim, int count ) {
+    boost::mt19937 generator(42);
+    boost::variate_generator<boost::mt19937&, boost::normal_distribution<double> >
+      normal(generator, boost::normal_distribution<double>());
+    std::vector<double> data( dim * count );
+    for ( int k = 0; k < count; k++ ) {
+      const double a = 4.0 * normal(), b = 2.0 * normal(), c = normal();
+      for ( int i = 0; i < dim; i++ )
+        data[k*dim + i] = 1000.0 + a * std::sin(0.1*i) + b * std::cos(0.3*i) + c * ((i % 5) - 2.0)
+                        + 0.01 * normal();
+    }
+    return data;
+  }
+}
+
+TEST( LearnPCA, AccumulatorMatchesDirect ) {
+  const int dim = 23, count = 500;
+  std::vector<double> data = test_descriptors( dim, count );
+
+  Vector<double> mean( dim );
+  for ( int k = 0; k < count; k++ )
+    for ( int i = 0; i < dim; i++ )
+      mean(i) += data[k*dim + i] / count;
+  Matrix<double> covariance( dim, dim );
+  for ( int k = 0; k < count; k++ )
+    for ( int i = 0; i < dim; i++ )
+      for ( int j = 0; j < dim; j++ )
+        covariance(i,j) += (data[k*dim + i] - mean(i)) * (data[k*dim + j] - mean(j)) / (count - 1);
+
+  // Added in uneven blocks, on one thread and on several.
+  for ( int threads = 1; threads <= 4; threads += 3 ) {
+    PCAAccumulator accumulator( dim, threads );
+    accumulator.add( &data[0], 1 );
+    accumulator.add( &data[dim], 200 );
+    accumulator.add( &data[201*dim], count - 201 );
+    EXPECT_EQ( size_t(count), accumulator.count() );
+    EXPECT_VECTOR_NEAR( mean, accumulator.mean(), 1e-9 );
+    EXPECT_MATRIX_NEAR( covariance, accumulator.covariance(), 1e-9 );
+  }
+}
+
+TEST( LearnPCA, RandomizedMatchesFull ) {
+  const int dim = 60, count = 2000;
+  std::vector<double> data = test_descriptors( dim, count );
+  PCAAccumulator accumulator( dim, 2 );
+  accumulator.add( &data[0], count );
+  Matrix<double> covariance = accumulator.covariance();
+
+  Matrix<double> basis, fast_basis;
+  Vector<double> variances, fast_variances;
+  pca_basis( covariance, 3, basis, variances );
+  randomized_pca_basis( covariance, 3, fast_basis, fast_variances );
+  ASSERT_EQ( 3u, fast_basis.cols() );
+  for ( int i = 0; i < 3; i++ ) {
+    EXPECT_NEAR( variances(i), fast_variances(i), 1e-6 * variances(i) );
+    // The same direction, up to sign.
+    EXPECT_NEAR( 1.0, std::fabs( dot_prod( select_col(basis, i), select_col(fast_basis, i) ) ), 1e-6 );
+  }
+  EXPECT_GT( variances(0), variances(1) );
+  EXPECT_GT( variances(1), variances(2) );
+}
@@ -137,3 +137,206 @@ TEST( Matcher, Matcher ) {
 }
 
 
+
+TEST( Matcher, MatcherSet ) {
+  std::vector<InterestPoint> ip1_list, ip2_list;
+  ip1_list.push_back( InterestPoint(0,0,1.0,1.0,0.0) );
+  ip1_list.back().descriptor = Vector3(0,7.7,0);
+  ip1_list.push_back( InterestPoint(1,0,1.0,1.0,0.0) );
+  ip1_list.back().descriptor = Vector3(0,5.5,0); // Ambiguous between 5 and 6
+  for (int i = 0; i < 5; i++) {
+    ip2_list.push_back( InterestPoint(20+i,0,2.0,2.0,M_PI) );
+    ip2_list.back().descriptor = Vector3(0,5+i,0);
+  }
+
+  InterestPointSet ip1_set(ip1_list), ip2_set(ip2_list);
+  ASSERT_EQ( 2u, ip1_set.size() );
+  ASSERT_EQ( 3u, ip1_set.descriptor_length() );
+  EXPECT_EQ( 7.7f, ip1_set.descriptors()(0,1) );
+
+  InterestPointMatcher<L2NormMetric,NullConstraint> matcher;
+  std::vector<size_t> list_indexes, set_indexes;
+  matcher(ip1_list, ip2_list, list_indexes);
+  matcher(ip1_set,  ip2_set,  set_indexes);
+  ASSERT_EQ( 2u, set_indexes.size() );
+  EXPECT_EQ( list_indexes[0], set_indexes[0] );
+  EXPECT_EQ( 3u, set_indexes[0] );
+  EXPECT_EQ( size_t(-1), set_indexes[1] );
+
+  // An index built ahead of time gives the same answer.
+  InterestPointIndex ip2_index(ip2_set, L2NormMetric::flann_type);
+  std::vector<size_t> prebuilt_indexes;
+  matcher(ip1_set, ip2_set, ip2_index, prebuilt_indexes);
+  ASSERT_EQ( 2u, prebuilt_indexes.size() );
+  EXPECT_EQ( set_indexes[0], prebuilt_indexes[0] );
+  EXPECT_EQ( set_indexes[1], prebuilt_indexes[1] );
+
+  // The ratio of the two nearest squared distances is reported per point.
+  std::vector<size_t> ratio_indexes;
+  std::vector<float>  ratios;
+  matcher(ip1_set, ip2_set, ip2_index, ratio_indexes, ratios);
+  EXPECT_EQ( set_indexes, ratio_indexes );
+  ASSERT_EQ( 2u, ratios.size() );
+  EXPECT_NEAR( 0.09f/0.49f, ratios[0], 1e-5 ); // 0.3^2 / 0.7^2
+  EXPECT_NEAR( 1.0f,  ratios[1], 1e-5 ); // 0.5^2 / 0.5^2
+
+  InterestPointSet matched_ip1, matched_ip2;
+  matcher(ip1_set, ip2_set, matched_ip1, matched_ip2);
+  ASSERT_EQ( 1u, matched_ip1.size() );
+  ASSERT_EQ( 1u, matched_ip2.size() );
+  EXPECT_EQ( 0,  matched_ip1.x(0) );
+  EXPECT_EQ( 23, matched_ip2.x(0) );
+  EXPECT_VECTOR_EQ( matched_ip2[0].descriptor, Vector3(0,8,0) );
+}
+
+TEST( Matcher, BruteForce ) {
+  // Random 40 element descriptors, checked against a plain double loop.
+  // The tile sizes are 256 train rows and 4 queries, so these sizes
+  // leave partial tiles.
+  const size_t num_query = 37, num_train = 300, length = 40;
+  std::vector<InterestPoint> ip1, ip2;
+  for (size_t i = 0; i < num_query + num_train; i++) {
+    InterestPoint ip(i, 0);
+    ip.descriptor.set_size(length);
+    for (size_t k = 0; k < length; k++)
+      ip.descriptor[k] = float(rand() % 1000) / 100.0f;
+    if (i < num_query) ip1.push_back(ip);
+    else               ip2.push_back(ip);
+  }
+  InterestPointSet set1(ip1), set2(ip2);
+
+  std::vector<int> indices;
+  brute_force_knn2(set1, set2, math::FLANN_DistType_L2, indices);
+  ASSERT_EQ( 2*num_query, indices.size() );
+  L2NormMetric metric;
+  for (size_t i = 0; i < num_query; i++) {
+    int best0 = -1, best1 = -1;
+    for (size_t j = 0; j < num_train; j++) {
+      if (best0 < 0 || metric(ip1[i], ip2[j]) < metric(ip1[i], ip2[best0])) {
+        best1 = best0;
+        best0 = j;
+      } else if (best1 < 0 || metric(ip1[i], ip2[j]) < metric(ip1[i], ip2[best1])) {
+        best1 = j;
+      }
+    }
+    EXPECT_EQ( best0, indices[2*i] );
+    EXPECT_EQ( best1, indices[2*i+1] );
+  }
+
+  // The matcher gives the same answer with either backend on an easy case.
+  InterestPointMatcher<L2NormMetric,NullConstraint>
+    brute_force_matcher(0.8, L2NormMetric(), NullConstraint(), false, MatcherBackend_BruteForce);
+  std::vector<size_t> list_indexes, set_indexes;
+  brute_force_matcher(ip1, ip2, list_indexes);
+  brute_force_matcher(set1, set2, set_indexes);
+  ASSERT_EQ( num_query, set_indexes.size() );
+  for (size_t i = 0; i < num_query; i++) {
+    EXPECT_EQ( list_indexes[i], set_indexes[i] );
+    if (set_indexes[i] != size_t(-1)) {
+      EXPECT_EQ( size_t(indices[2*i]), set_indexes[i] );
+    }
+  }
+
+  // Hamming distances on binary descriptors stored as floats.
+  std::vector<InterestPoint> b1, b2;
+  for (size_t i = 0; i < 50; i++) {
+    InterestPoint ip(i, 0);
+    ip.descriptor.set_size(32);
+    for (size_t k = 0; k < 32; k++)
+      ip.descriptor[k] = float(rand() % 256);
+    if (i < 10) b1.push_back(ip);
+    else        b2.push_back(ip);
+  }
+  b1[3].descriptor = b2[17].descriptor;
+  b1[3].descriptor[0] = float(int(b1[3].descriptor[0]) ^ 1);
+  brute_force_knn2(InterestPointSet(b1), InterestPointSet(b2),
+                   math::FLANN_DistType_Hamming, indices);
+  ASSERT_EQ( 20u, indices.size() );
+  EXPECT_EQ( 17, indices[6] );
+  HammingMetric hamming;
+  for (size_t i = 0; i < 10; i++) {
+    float best = std::numeric_limits<float>::max();
+    for (size_t j = 0; j < 40; j++)
+      best = std::min(best, hamming(b1[i], b2[j]));
+    EXPECT_EQ( best, hamming(b1[i], b2[indices[2*i]]) );
+  }
+}
+
+TEST( Matcher, RemoveDuplicatesSet ) {
+  std::vector<InterestPoint> ip1, ip2;
+  // Pair 0 shares its left location with pair 2, pair 1 its right location with pair 3.
+  float coords[4][4] = { {0,0, 10,10}, {1,1, 11,11}, {0,0, 12,12}, {2,2, 11,11} };
+  for (int i = 0; i < 4; i++) {
+    ip1.push_back( InterestPoint(coords[i][0], coords[i][1]) );
+    ip2.push_back( InterestPoint(coords[i][2], coords[i][3]) );
+  }
+  InterestPointSet set1(ip1), set2(ip2);
+
+  remove_duplicates(ip1, ip2);
+  remove_duplicates(set1, set2);
+  ASSERT_EQ( ip1.size(), set1.size() );
+  ASSERT_EQ( 2u, set1.size() );
+  for (size_t i = 0; i < set1.size(); i++) {
+    EXPECT_EQ( ip1[i].x, set1.x(i) );
+    EXPECT_EQ( ip2[i].x, set2.x(i) );
+  }
+}
+
+TEST( Matcher, RemoveDuplicatesScores ) {
+  std::vector<InterestPoint> ip1, ip2;
+  std::vector<float> scores;
+  float coords[4][4] = { {0,0, 10,10}, {1,1, 11,11}, {0,0, 12,12}, {2,2, 11,11} };
+  for (int i = 0; i < 4; i++) {
+    ip1.push_back( InterestPoint(coords[i][0], coords[i][1]) );
+    ip2.push_back( InterestPoint(coords[i][2], coords[i][3]) );
+    scores.push_back( 0.1f*i );
+  }
+  std::vector<InterestPoint> plain1 = ip1, plain2 = ip2;
+  remove_duplicates(plain1, plain2);
+  remove_duplicates(ip1, ip2, scores);
+  ASSERT_EQ( plain1.size(), ip1.size() );
+  ASSERT_EQ( 2u, scores.size() );
+  EXPECT_EQ( 0.2f, scores[0] );
+  EXPECT_EQ( 0.3f, scores[1] );
+  for (size_t i = 0; i < ip1.size(); i++) {
+    EXPECT_EQ( plain1[i].x, ip1[i].x );
+    EXPECT_EQ( plain2[i].x, ip2[i].x );
+  }
+}
+
+TEST( Matcher, BucketMatches ) {
+  // Three matches in the cell [0,10)x[0,10), one in [10,20)x[0,10), and
+  // two in [0,10)x[10,20).
+  float coords[6][2] = { {1,1}, {5,5}, {9,2}, {15,3}, {2,12}, {8,18} };
+  float ratios[6]    = { 0.5f, 0.2f, 0.4f, 0.9f, 0.3f, 0.3f };
+  std::vector<InterestPoint> ip1;
+  std::vector<float> scores;
+  for (int i = 0; i < 6; i++) {
+    ip1.push_back( InterestPoint(coords[i][0], coords[i][1]) );
+    scores.push_back( ratios[i] );
+  }
+  InterestPointSet set1(ip1);
+
+  std::vector<size_t> keep = bucket_matches(ip1, scores, 10, 1);
+  ASSERT_EQ( 3u, keep.size() );
+  EXPECT_EQ( 1u, keep[0] );
+  EXPECT_EQ( 3u, keep[1] );
+  EXPECT_EQ( 4u, keep[2] ); // Ties go to the lower index
+  EXPECT_EQ( keep, bucket_matches(set1, scores, 10, 1) );
+
+  keep = bucket_matches(ip1, scores, 10, 2);
+  ASSERT_EQ( 5u, keep.size() );
+  EXPECT_EQ( 2u, keep[1] );
+
+  // Without scores the first matches in each cell are kept.
+  keep = bucket_matches(ip1, std::vector<float>(), 10, 1);
+  ASSERT_EQ( 3u, keep.size() );
+  EXPECT_EQ( 0u, keep[0] );
+  EXPECT_EQ( 3u, keep[1] );
+  EXPECT_EQ( 4u, keep[2] );
+
+  // One large cell keeps the overall best.
+  keep = bucket_matches(ip1, scores, 100, 1);
+  ASSERT_EQ( 1u, keep.size() );
+  EXPECT_EQ( 1u, keep[0] );
+}
@@ -69,11 +69,16 @@
 /// which may be buggy and certainly is underperforming Armijo
 /// for me at the moment.  I also provide a steepest_descent()
 /// method for comparison to conjugate_gradient().
+///
+/// For linear systems A x = b with A symmetric positive definite,
+/// preconditioned_conjugate_gradient() only needs products with A,
+/// so A never has to be formed.  It does have stopping criteria.
 
 #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
 #define __VW_MATH_CONJUGATEGRADIENT_H__
 
 #include <vw/Core/Log.h>
+#include <vw/Math/Vector.h>
 
 #define VW_CONJGRAD_MAX_ITERS_BETWEEN_SPACER_STEPS 20
 
@@ -240,6 +245,67 @@ namespace math{
     return pos;
   }
 
+
+  /// Solves A x = b for symmetric positive definite A, starting from
+  /// the x passed in.  op(p, q) must set q = A p, and precond(r, z)
+  /// must set z = M^-1 r for a symmetric positive definite M close to
+  /// A.  Stops when |b - A x| <= tolerance * |b|, after max_iterations,
+  /// or, if model_tolerance is positive, when an iteration i reduces
+  /// the quadratic q(x) = x'Ax/2 - b'x by less than model_tolerance *
+  /// |q(x)| / i, which is Nash's rule for truncated Newton steps.
+  /// Returns the number of iterations taken.
+  template <class OpT, class PrecondT>
+  int preconditioned_conjugate_gradient( OpT const& op, PrecondT const& precond,
+                                         Vector<double> const& b, Vector<double>& x,
+                                         double tolerance, int max_iterations,
+                                         double model_tolerance = 0 ) {
+    const size_t n = b.size();
+    if ( x.size() != n )
+      x = Vector<double>( n );
+    Vector<double> r( n ), z( n ), p( n ), q( n );
+    op( x, q );
+    r = b - q;
+    const double threshold = tolerance * norm_2( b );
+    if ( norm_2( r ) <= threshold )
+      return 0;
+
+    precond( r, z );
+    p = z;
+    double rz = dot_prod( r, z );
+    // q(x) = -x'(b + r)/2, as r = b - A x
+    double model = -0.5 * dot_prod( x, b + r );
+    int i = 0;
+    while ( i < max_iterations ) {
+      op( p, q );
+      const double pq = dot_prod( p, q );
+      if ( !(pq > 0) ) {
+        VW_OUT(DebugMessage, "math") << "PCG: Direction of nonpositive curvature." << std::endl;
+        break;
+      }
+      const double alpha = rz / pq;
+      x += alpha * p;
+      r -= alpha * q;
+      ++i;
+
+      if ( norm_2( r ) <= threshold )
+        break;
+      if ( model_tolerance > 0 ) {
+        const double new_model = -0.5 * dot_prod( x, b + r );
+        if ( i * ( model - new_model ) <= model_tolerance * fabs( new_model ) )
+          break;
+        model = new_model;
+      }
+
+      precond( r, z );
+      const double new_rz = dot_prod( r, z );
+      p = z + ( new_rz / rz ) * p;
+      rz = new_rz;
+    }
+    VW_OUT(DebugMessage, "math") << "PCG: " << i << " iterations, relative residual "
+                                 << norm_2( r ) / norm_2( b ) << std::endl;
+    return i;
+  }
+
 } } // namespace vw::math
 
 #endif // #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
@@ -37,6 +37,7 @@
 #include <vw/Core/Exception.h>
 
 #include <list>
+#include <vector>
 
 namespace vw {
 namespace math {
@@ -57,7 +58,7 @@ namespace math {
     typedef ElemNode* Elem;
     typedef ElemNode* Set;
 
-    DisjointSet() {}
+    DisjointSet() : num_elems(0) {}
     ~DisjointSet() {
       typename std::list<ElemNode*>::iterator i;
       for (i = elems.begin(); i != elems.end(); i++)
@@ -129,6 +130,58 @@ namespace math {
     unsigned num_elems;
   };
 
+  // A disjoint set of the integers 0 .. size-1, held in flat arrays.
+  // This is much faster than DisjointSet when the elements are
+  // already numbered.  find_root() does not modify the structure, so
+  // any number of threads may call it while nothing is combined.
+  class FlatDisjointSet {
+  public:
+    FlatDisjointSet(size_t size = 0) { reset(size); }
+
+    void reset(size_t size) {
+      parent.resize(size);
+      rank.assign(size, 0);
+      for (size_t i = 0; i < size; i++)
+        parent[i] = i;
+    }
+
+    size_t size() const { return parent.size(); }
+
+    size_t find(size_t e) {
+      VW_ASSERT(e < parent.size(), ArgumentErr() << "Not a valid element!");
+      // Path halving
+      while (parent[e] != e) {
+        parent[e] = parent[parent[e]];
+        e = parent[e];
+      }
+      return e;
+    }
+    size_t find_root(size_t e) const {
+      VW_ASSERT(e < parent.size(), ArgumentErr() << "Not a valid element!");
+      while (parent[e] != e)
+        e = parent[e];
+      return e;
+    }
+
+    // Returns false if a and b were already in the same set.
+    bool combine(size_t a, size_t b) {
+      a = find(a);
+      b = find(b);
+      if (a == b)
+        return false;
+      if (rank[a] < rank[b])
+        std::swap(a, b);
+      parent[b] = a;
+      if (rank[a] == rank[b])
+        rank[a]++;
+      return true;
+    }
+
+  private:
+    std::vector<size_t>   parent;
+    std::vector<unsigned> rank;
+  };
+
 }} // namespace vw::math
 
 #endif // __VW_MATH_DISJOINTSET_H__
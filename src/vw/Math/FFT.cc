@@ -0,0 +1,258 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Exception.h>
+#include <vw/Math/FFT.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+
+namespace vw {
+namespace math {
+
+  FFTPlan::FFTPlan(size_t n) : m_size(n), m_reverse(n), m_twiddle(n/2) {
+    VW_ASSERT(n > 0 && (n & (n-1)) == 0, ArgumentErr() << "FFTPlan: The size " << n << " is not a power of two.");
+    int bits = 0;
+    while ((size_t(1) << bits) < n)
+      ++bits;
+    for (size_t i = 0; i < n; ++i) {
+      size_t r = 0;
+      for (int b = 0; b < bits; ++b)
+        if (i & (size_t(1) << b))
+          r |= size_t(1) << (bits-1-b);
+      m_reverse[i] = r;
+    }
+    for (size_t k = 0; k < n/2; ++k)
+      m_twiddle[k] = std::polar(1.0, -2.0 * M_PI * double(k) / double(n));
+  }
+
+  void FFTPlan::forward(std::complex<double>* data) const {
+    transform(data, false);
+  }
+
+  void FFTPlan::inverse(std::complex<double>* data) const {
+    transform(data, true);
+    const double scale = 1.0 / double(m_size);
+    for (size_t i = 0; i < m_size; ++i)
+      data[i] *= scale;
+  }
+
+  void FFTPlan::transform(std::complex<double>* data, bool inverse) const {
+    const size_t n = m_size;
+    for (size_t i = 0; i < n; ++i)
+      if (m_reverse[i] > i)
+        std::swap(data[i], data[m_reverse[i]]);
+
+    // The butterflies multiply by hand; std::complex's operator* checks
+    // for infinities on every call.
+    const double sign = inverse ? -1.0 : 1.0;
+    for (size_t len = 2; len <= n; len <<= 1) {
+      const size_t half = len / 2, step = n / len;
+      for (size_t i = 0; i < n; i += len) {
+        for (size_t k = 0; k < half; ++k) {
+          const std::complex<double>& w = m_twiddle[k*step];
+          const double wr = w.real(), wi = sign * w.imag();
+          std::complex<double>& a = data[i+k];
+          std::complex<double>& b = data[i+k+half];
+          const double br = b.real()*wr - b.imag()*wi,
+                       bi = b.real()*wi + b.imag()*wr;
+          b = std::complex<double>(a.real() - br, a.imag() - bi);
+          a = std::complex<double>(a.real() + br, a.imag() + bi);
+        }
+      }
+    }
+  }
+
+  FFTPlan const& fft_plan(size_t n) {
+    thread_local std::map<size_t, boost::shared_ptr<FFTPlan> > plans;
+    boost::shared_ptr<FFTPlan>& plan = plans[n];
+    if (!plan)
+      plan.reset(new FFTPlan(n));
+    return *plan;
+  }
+
+  size_t fft_size(size_t n) {
+    size_t size = 1;
+    while (size < n)
+      size <<= 1;
+    return size;
+  }
+
+  size_t fft_block_size(size_t kernel_size, size_t out_size) {
+    VW_ASSERT(kernel_size > 0, ArgumentErr() << "fft_block_size: The kernel is empty.");
+    const size_t whole = fft_size(out_size + kernel_size - 1);
+    size_t best = whole;
+    double best_cost = std::numeric_limits<double>::max();
+    // Blocks smaller than twice the kernel keep less than half of each
+    // transform.
+    for (size_t size = std::min(fft_size(2 * kernel_size), whole); size <= whole; size *= 2) {
+      const double blocks = std::ceil(double(out_size) / double(size - kernel_size + 1));
+      const double cost   = blocks * size * std::log(double(size));
+      if (cost < best_cost) {
+        best_cost = cost;
+        best = size;
+      }
+    }
+    return best;
+  }
+
+  namespace {
+    // Multiplies data by spectrum, element by element.
+    void multiply_spectrum(std::vector<std::complex<double> >& data,
+                           std::vector<std::complex<double> > const& spectrum) {
+      for (size_t i = 0; i < data.size(); ++i) {
+        const double ar = data[i].real(), ai = data[i].imag(),
+                     br = spectrum[i].real(), bi = spectrum[i].imag();
+        data[i] = std::complex<double>(ar*br - ai*bi, ar*bi + ai*br);
+      }
+    }
+  }
+
+  // ---------------------------------------------------
+  // FFTConvolver1D
+  // ---------------------------------------------------
+
+  FFTConvolver1D::FFTConvolver1D(std::vector<double> const& kernel, size_t out_size)
+    : m_kernel_size(kernel.size()) {
+    VW_ASSERT(!kernel.empty(), ArgumentErr() << "FFTConvolver1D: The kernel is empty.");
+    m_block = fft_block_size(m_kernel_size, out_size);
+    m_spectrum.assign(m_block, std::complex<double>());
+    for (size_t i = 0; i < m_kernel_size; ++i)
+      m_spectrum[i] = kernel[i];
+    fft_plan(m_block).forward(&m_spectrum[0]);
+  }
+
+  void FFTConvolver1D::operator()(double const* a, double const* b, size_t src_size, size_t src_stride,
+                                  double* out_a, double* out_b) const {
+    VW_ASSERT(src_size >= m_kernel_size, ArgumentErr() << "FFTConvolver1D: The source is shorter than the kernel.");
+    const size_t out_size = src_size - m_kernel_size + 1;
+    const size_t valid    = m_block - m_kernel_size + 1; // Outputs of each block
+    FFTPlan const& plan = fft_plan(m_block);
+
+    // Each block starts valid values after the last, and its outputs
+    // are the circular convolution from kernel_size-1 on.
+    std::vector<std::complex<double> > data(m_block);
+    for (size_t start = 0; start < out_size; start += valid) {
+      const size_t count = std::min(m_block, src_size - start);
+      for (size_t i = 0; i < count; ++i)
+        data[i] = std::complex<double>(a[(start+i)*src_stride], b ? b[(start+i)*src_stride] : 0.0);
+      std::fill(data.begin() + count, data.end(), std::complex<double>());
+
+      plan.forward(&data[0]);
+      multiply_spectrum(data, m_spectrum);
+      plan.inverse(&data[0]);
+
+      const size_t n = std::min(valid, out_size - start);
+      for (size_t i = 0; i < n; ++i) {
+        out_a[start+i] = data[m_kernel_size-1+i].real();
+        if (b)
+          out_b[start+i] = data[m_kernel_size-1+i].imag();
+      }
+    }
+  }
+
+  // ---------------------------------------------------
+  // FFTConvolver2D
+  // ---------------------------------------------------
+
+  FFTConvolver2D::FFTConvolver2D(std::vector<double> const& kernel, size_t kernel_cols, size_t kernel_rows,
+                                 size_t cols, size_t rows)
+    : m_kernel_cols(kernel_cols), m_kernel_rows(kernel_rows), m_cols(cols), m_rows(rows) {
+    VW_ASSERT(kernel.size() == kernel_cols * kernel_rows && !kernel.empty(),
+              ArgumentErr() << "FFTConvolver2D: The kernel does not match its size.");
+    VW_ASSERT(cols >= kernel_cols && rows >= kernel_rows,
+              ArgumentErr() << "FFTConvolver2D: The source is smaller than the kernel.");
+    m_block_cols = fft_block_size(kernel_cols, cols - kernel_cols + 1);
+    m_block_rows = fft_block_size(kernel_rows, rows - kernel_rows + 1);
+    m_spectrum.assign(m_block_cols * m_block_rows, std::complex<double>());
+    for (size_t j = 0; j < kernel_rows; ++j)
+      for (size_t i = 0; i < kernel_cols; ++i)
+        m_spectrum[j*m_block_cols + i] = kernel[j*kernel_cols + i];
+    transform(m_spectrum, kernel_rows, false);
+  }
+
+  // Forward, only the first rows rows are not zero.  Inverse, only the
+  // rows from m_kernel_rows-1 on are wanted.
+  void FFTConvolver2D::transform(std::vector<std::complex<double> >& data, size_t rows, bool inverse) const {
+    FFTPlan const& row_plan = fft_plan(m_block_cols);
+    FFTPlan const& col_plan = fft_plan(m_block_rows);
+
+    if (!inverse)
+      for (size_t j = 0; j < rows; ++j)
+        row_plan.forward(&data[j*m_block_cols]);
+
+    std::vector<std::complex<double> > column(m_block_rows);
+    for (size_t i = 0; i < m_block_cols; ++i) {
+      for (size_t j = 0; j < m_block_rows; ++j)
+        column[j] = data[j*m_block_cols + i];
+      if (inverse)
+        col_plan.inverse(&column[0]);
+      else
+        col_plan.forward(&column[0]);
+      for (size_t j = 0; j < m_block_rows; ++j)
+        data[j*m_block_cols + i] = column[j];
+    }
+
+    if (inverse)
+      for (size_t j = m_kernel_rows-1; j < m_block_rows; ++j)
+        row_plan.inverse(&data[j*m_block_cols]);
+  }
+
+  void FFTConvolver2D::operator()(double const* a, double const* b, double* out_a, double* out_b) const {
+    const size_t out_cols   = m_cols - m_kernel_cols + 1,
+                 out_rows   = m_rows - m_kernel_rows + 1,
+                 valid_cols = m_block_cols - m_kernel_cols + 1,
+                 valid_rows = m_block_rows - m_kernel_rows + 1;
+
+    std::vector<std::complex<double> > data(m_block_cols * m_block_rows);
+    for (size_t y0 = 0; y0 < out_rows; y0 += valid_rows) {
+      for (size_t x0 = 0; x0 < out_cols; x0 += valid_cols) {
+        // The block's source starts where its output does.
+        const size_t cols = std::min(m_block_cols, m_cols - x0),
+                     rows = std::min(m_block_rows, m_rows - y0);
+        std::fill(data.begin(), data.end(), std::complex<double>());
+        for (size_t j = 0; j < rows; ++j) {
+          const size_t offset = (y0+j)*m_cols + x0;
+          for (size_t i = 0; i < cols; ++i)
+            data[j*m_block_cols + i] = std::complex<double>(a[offset+i], b ? b[offset+i] : 0.0);
+        }
+
+        transform(data, rows, false);
+        multiply_spectrum(data, m_spectrum);
+        transform(data, rows, true);
+
+        const size_t n_cols = std::min(valid_cols, out_cols - x0),
+                     n_rows = std::min(valid_rows, out_rows - y0);
+        for (size_t j = 0; j < n_rows; ++j) {
+          std::complex<double> const* row = &data[(j + m_kernel_rows-1)*m_block_cols + m_kernel_cols-1];
+          const size_t offset = (y0+j)*out_cols + x0;
+          for (size_t i = 0; i < n_cols; ++i) {
+            out_a[offset+i] = row[i].real();
+            if (b)
+              out_b[offset+i] = row[i].imag();
+          }
+        }
+      }
+    }
+  }
+
+}} // namespace vw::math
@@ -0,0 +1,114 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file FFT.h
+///
+/// A small radix-2 fast Fourier transform with no outside dependencies,
+/// for the FFT convolution in vw/Image/Convolution.h.  The transforms
+/// in vw/Image/Fourier.h need OpenCV.
+#ifndef __VW_MATH_FFT_H__
+#define __VW_MATH_FFT_H__
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+namespace vw {
+namespace math {
+
+  /// The twiddle factors and bit reversal table of an in-place complex
+  /// transform of one power of two size.  A plan does not change once
+  /// made, so one may be used by many threads at once.
+  class FFTPlan {
+  public:
+    /// n must be a power of two.
+    explicit FFTPlan(size_t n);
+
+    size_t size() const { return m_size; }
+
+    /// Transforms the size() values at data in place.
+    void forward(std::complex<double>* data) const;
+
+    /// The inverse of forward(), including the 1/n scale.
+    void inverse(std::complex<double>* data) const;
+
+  private:
+    void transform(std::complex<double>* data, bool inverse) const;
+
+    size_t m_size;
+    std::vector<size_t> m_reverse;               ///< Swap partner of each index, or itself
+    std::vector<std::complex<double> > m_twiddle; ///< exp(-2 pi i k/n) for k < n/2
+  };
+
+  /// The plan for size n, made on first use and then kept for the
+  /// calling thread.
+  FFTPlan const& fft_plan(size_t n);
+
+  /// The smallest power of two at least n.
+  size_t fft_size(size_t n);
+
+  /// The transform size for convolving out_size values with a kernel
+  /// of kernel_size by overlap-save: each block gives size-kernel_size+1
+  /// values, so this weighs few large blocks against many small ones.
+  size_t fft_block_size(size_t kernel_size, size_t out_size);
+
+  /// The valid part of the convolution of sequences with one kernel,
+  /// by overlap-save: out[u] = sum over t of src[u+t] * kernel[n-1-t]
+  /// for u < src_size-n+1, where n is the kernel size.  This is what a
+  /// direct convolution over an edge extended source computes.
+  class FFTConvolver1D {
+  public:
+    /// out_size is the number of values wanted from each sequence, for
+    /// choosing the transform size.
+    FFTConvolver1D(std::vector<double> const& kernel, size_t out_size);
+
+    size_t kernel_size() const { return m_kernel_size; }
+
+    /// Convolves a, and b if it is not null, each src_size long with
+    /// src_stride between values, into out_a and out_b.  Pairs of
+    /// sequences cost one transform, as the kernel is real.
+    void operator()(double const* a, double const* b, size_t src_size, size_t src_stride,
+                    double* out_a, double* out_b) const;
+
+  private:
+    size_t m_kernel_size, m_block;
+    std::vector<std::complex<double> > m_spectrum;
+  };
+
+  /// The valid part of the 2D convolution of a cols x rows source with
+  /// a kernel_cols x kernel_rows kernel, both stored row by row, by
+  /// overlap-save in blocks of fft_block_size() along each axis.  out
+  /// is (cols-kernel_cols+1) x (rows-kernel_rows+1).
+  class FFTConvolver2D {
+  public:
+    FFTConvolver2D(std::vector<double> const& kernel, size_t kernel_cols, size_t kernel_rows,
+                   size_t cols, size_t rows);
+
+    /// Convolves a, and b if it is not null, into out_a and out_b.
+    void operator()(double const* a, double const* b, double* out_a, double* out_b) const;
+
+  private:
+    void transform(std::vector<std::complex<double> >& data, size_t rows, bool inverse) const;
+
+    size_t m_kernel_cols, m_kernel_rows, m_cols, m_rows, m_block_cols, m_block_rows;
+    std::vector<std::complex<double> > m_spectrum;
+  };
+
+}} // namespace vw::math
+
+#endif // __VW_MATH_FFT_H__
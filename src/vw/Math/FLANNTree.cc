@@ -19,6 +19,11 @@
 #include <vw/Math/FLANNTree.h>
 #include <flann/flann.hpp>
 
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+
+#include <cstdio>
+
 namespace vw {
 namespace math {
 
@@ -52,7 +57,21 @@ namespace math {
     return reinterpret_cast<const flann::Index<flann::Hamming<unsigned char> >*>(void_ptr);
   }
 
-
+  // Read a saved index over the given features, or return NULL if it
+  // cannot be read.
+  template <class DistT>
+  void* load_flann_index( void* data_ptr, size_t rows, size_t cols, std::string const& filename ) {
+    typedef typename DistT::ElementType ElementT;
+    try {
+      flann::Index<DistT>* index
+        = new flann::Index<DistT>( flann::Matrix<ElementT>( (ElementT*)data_ptr, rows, cols ),
+                                   flann::SavedIndexParams( filename ), DistT() );
+      if ( index->size() == rows && index->veclen() == cols )
+        return index;
+      delete index;
+    } catch ( std::exception const& ) {}
+    return NULL;
+  }
 
 
 //============================================================================
@@ -114,6 +133,32 @@ namespace math {
   }
 
 
+  template <>
+  bool FLANNTree<float>::load_index( void* data_ptr, size_t rows, size_t cols,
+                                     std::string const& filename ) {
+    if ( m_index_ptr != NULL )
+      vw_throw( IOErr() << "FLANNTree: Void ptr is not null, this is unexpected." );
+    switch(m_dist_type) {
+    case FLANN_DistType_L2:
+      m_index_ptr = load_flann_index<flann::L2<float> >( data_ptr, rows, cols, filename );
+      return m_index_ptr != NULL;
+    default:
+      vw_throw( IOErr() << "FLANNTree: Illegal distance type passed in." );
+    }; // end switch
+    return false;
+  }
+
+
+  template <>
+  void FLANNTree<float>::save_index( std::string const& filename ) const {
+    switch(m_dist_type) {
+      case FLANN_DistType_L2: cast_index_ptr_L2_f(this->m_index_ptr)->save( filename ); return;
+      default:
+        vw_throw( IOErr() << "FLANNTree: No index to save." );
+    }; // end switch
+  }
+
+
   template <>
   FLANNTree<float>::~FLANNTree() {
     switch(m_dist_type) {
@@ -193,6 +238,32 @@ template <>
   }
 
 
+  template <>
+  bool FLANNTree<double>::load_index( void* data_ptr, size_t rows, size_t cols,
+                                     std::string const& filename ) {
+    if ( m_index_ptr != NULL )
+      vw_throw( IOErr() << "FLANNTree: Void ptr is not null, this is unexpected." );
+    switch(m_dist_type) {
+    case FLANN_DistType_L2:
+      m_index_ptr = load_flann_index<flann::L2<double> >( data_ptr, rows, cols, filename );
+      return m_index_ptr != NULL;
+    default:
+      vw_throw( IOErr() << "FLANNTree: Illegal distance type passed in." );
+    }; // end switch
+    return false;
+  }
+
+
+  template <>
+  void FLANNTree<double>::save_index( std::string const& filename ) const {
+    switch(m_dist_type) {
+      case FLANN_DistType_L2: cast_index_ptr_L2_d(this->m_index_ptr)->save( filename ); return;
+      default:
+        vw_throw( IOErr() << "FLANNTree: No index to save." );
+    }; // end switch
+  }
+
+
   template <>
   FLANNTree<double>::~FLANNTree() {
     switch(m_dist_type) {
@@ -280,6 +351,32 @@ template <>
   }
 
 
+  template <>
+  bool FLANNTree<unsigned char>::load_index( void* data_ptr, size_t rows, size_t cols,
+                                     std::string const& filename ) {
+    if ( m_index_ptr != NULL )
+      vw_throw( IOErr() << "FLANNTree: Void ptr is not null, this is unexpected." );
+    switch(m_dist_type) {
+    case FLANN_DistType_Hamming:
+      m_index_ptr = load_flann_index<flann::Hamming<unsigned char> >( data_ptr, rows, cols, filename );
+      return m_index_ptr != NULL;
+    default:
+      vw_throw( IOErr() << "FLANNTree: Illegal distance type passed in." );
+    }; // end switch
+    return false;
+  }
+
+
+  template <>
+  void FLANNTree<unsigned char>::save_index( std::string const& filename ) const {
+    switch(m_dist_type) {
+      case FLANN_DistType_Hamming: cast_index_ptr_HAMM_u(this->m_index_ptr)->save( filename ); return;
+      default:
+        vw_throw( IOErr() << "FLANNTree: No index to save." );
+    }; // end switch
+  }
+
+
   template <>
   FLANNTree<unsigned char>::~FLANNTree() {
     switch(m_dist_type) {
@@ -310,4 +407,72 @@ template <>
 
 
 
+//============================================================================
+// These do not depend on the element type.
+
+  template <class T>
+  uint64 FLANNTree<T>::features_hash() const {
+    // FNV-1a, over the shape and type of the features and then their bytes.
+    // Bump INDEX_VERSION when the index parameters change.
+    const uint64 INDEX_VERSION = 1;
+    const uint64 header[5] = { INDEX_VERSION, uint64(sizeof(T)), uint64(m_dist_type),
+                               uint64(m_features_cast.rows()), uint64(m_features_cast.cols()) };
+    uint64 hash = 14695981039346656037ULL;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(header);
+    for ( size_t i = 0; i < sizeof(header); ++i )
+      hash = ( hash ^ bytes[i] ) * 1099511628211ULL;
+    if ( m_features_cast.rows() == 0 )
+      return hash;
+    bytes = reinterpret_cast<const unsigned char*>( m_features_cast.data() );
+    const size_t num_bytes = m_features_cast.rows() * m_features_cast.cols() * sizeof(T);
+    for ( size_t i = 0; i < num_bytes; ++i )
+      hash = ( hash ^ bytes[i] ) * 1099511628211ULL;
+    return hash;
+  }
+
+  template <class T>
+  std::string FLANNTree<T>::index_filename( std::string const& cache_dir ) const {
+    char name[64];
+    snprintf( name, sizeof(name), "flann_%016llx.index", (unsigned long long)features_hash() );
+    return ( boost::filesystem::path( cache_dir ) / name ).string();
+  }
+
+  template <class T>
+  void FLANNTree<T>::load_cached_index( std::string const& cache_dir ) {
+    namespace fs = boost::filesystem;
+    void* data_ptr = (void*)&m_features_cast(0,0);
+    const std::string filename = index_filename( cache_dir );
+    if ( fs::exists( filename ) ) {
+      if ( load_index( data_ptr, m_features_cast.rows(), m_features_cast.cols(), filename ) )
+        return;
+      vw_out(WarningMessage, "math") << "FLANNTree: Could not read \"" << filename
+                                     << "\", rebuilding it.\n";
+    }
+
+    construct_index( data_ptr, m_features_cast.rows(), m_features_cast.cols() );
+
+    // Write under a temporary name and rename it, so that a concurrent run
+    // never reads a partial index.  Failing to save is not an error.
+    try {
+      fs::create_directories( cache_dir );
+      const std::string temp_name = filename + fs::unique_path( ".%%%%%%%%" ).string();
+      save_index( temp_name );
+      fs::rename( temp_name, filename );
+    } catch ( std::exception const& e ) {
+      vw_out(WarningMessage, "math") << "FLANNTree: Could not save \"" << filename
+                                     << "\": " << e.what() << "\n";
+    }
+  }
+
+  template uint64 FLANNTree<float        >::features_hash() const;
+  template uint64 FLANNTree<double       >::features_hash() const;
+  template uint64 FLANNTree<unsigned char>::features_hash() const;
+  template std::string FLANNTree<float        >::index_filename( std::string const& ) const;
+  template std::string FLANNTree<double       >::index_filename( std::string const& ) const;
+  template std::string FLANNTree<unsigned char>::index_filename( std::string const& ) const;
+  template void FLANNTree<float        >::load_cached_index( std::string const& );
+  template void FLANNTree<double       >::load_cached_index( std::string const& );
+  template void FLANNTree<unsigned char>::load_cached_index( std::string const& );
+
+
 }}
@@ -24,6 +24,7 @@
 #include <vw/Core/Log.h>
 
 #include <stddef.h>
+#include <string>
 
 #include <boost/noncopyable.hpp>
 
@@ -59,6 +60,14 @@ namespace math {
     /// Make a FLANN index wrapping a matrix of feature data
     void construct_index( void* data_ptr, size_t rows, size_t cols );
 
+    /// Make a FLANN index wrapping a matrix of feature data by reading
+    /// an index saved by save_index().  Returns false if it cannot be read.
+    bool load_index( void* data_ptr, size_t rows, size_t cols, std::string const& filename );
+
+    /// Read the index for the loaded features from cache_dir, or build
+    /// it and save it there.
+    void load_cached_index( std::string const& cache_dir );
+
   public: // Functions
 
     /// Simple constructor.  Call load_match_data() before calling knn_search()!
@@ -84,6 +93,31 @@ namespace math {
       //         << m_features_cast.cols() << "\n";
     }
 
+    /// As above, but reuse the index saved in cache_dir for exactly these
+    /// features if there is one, and otherwise build it and save it there.
+    /// Indices are named by features_hash(), so a reference set that is
+    /// matched against every day is only indexed once.
+    template <class MatrixT>
+    void load_match_data( MatrixBase<MatrixT> const& features, FLANN_DistType dist_type,
+                          std::string const& cache_dir ) {
+      if (features.impl().rows() == 0)
+        vw_throw( ArgumentErr() << "Cannot create a FLANN tree with no input data!" );
+      m_dist_type           = dist_type;
+      m_features_cast       = features;
+      m_num_features_loaded = m_features_cast.rows();
+      load_cached_index( cache_dir );
+    }
+
+    /// Write the index to filename.  FLANN does not store the features in
+    /// the file, so it can only be read back for the same features.
+    void save_index( std::string const& filename ) const;
+
+    /// A hash of the loaded features, their element type and the distance type.
+    uint64 features_hash() const;
+
+    /// The file in cache_dir that holds the index of the loaded features.
+    std::string index_filename( std::string const& cache_dir ) const;
+
     /// Multiple query access via VW's Matrix
     template <class MatrixT>
     size_t knn_search( MatrixBase<MatrixT> const& query,  // Values we are looking for
@@ -0,0 +1,357 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file FlatKDTree.h
+///
+/// A static kd-tree over low dimensional points, for many exact
+/// nearest neighbor queries such as matching the points of one DEM
+/// or point cloud to another.
+///
+/// Unlike KDTree.h, whose vertices are allocated one at a time and
+/// each hold a copy of their record and of their ranges, the tree is
+/// balanced and stored implicitly: node i has children 2i+1 and 2i+2,
+/// and a node holds only its split dimension and value.  Each leaf is
+/// a bucket of up to leaf_size points, which are copied into one
+/// array in tree order so that a bucket is scanned from contiguous
+/// memory.  The tree can be built, and batches of queries answered,
+/// on several threads.
+///
+#ifndef __VW_MATH_FLAT_KDTREE_H__
+#define __VW_MATH_FLAT_KDTREE_H__
+
+#include <vw/Math/Vector.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace vw {
+namespace math {
+
+  template <class RealT, size_t DimN>
+  class FlatKDTree {
+  public:
+    typedef Vector<RealT, DimN> point_type;
+
+    /// Returned in place of an index when fewer than k points exist.
+    static size_t invalid_index() { return size_t(-1); }
+
+    explicit FlatKDTree( size_t leaf_size = 16 )
+      : m_leaf_size( std::max( leaf_size, size_t(1) ) ), m_depth( 0 ) {}
+
+    /// Build the tree over points, replacing any earlier contents.
+    /// PointT may be any type with an operator[] returning the
+    /// DimN coordinates.  Subtrees below the top few levels are built
+    /// in parallel on num_threads threads, or on the default number
+    /// of threads if num_threads is zero.
+    template <class PointT>
+    void build( std::vector<PointT> const& points, int num_threads = 0 );
+
+    size_t size() const { return m_index.size(); }
+
+    /// Find the k points nearest to query.  Their indices in the
+    /// points given to build() and their squared distances are
+    /// written to indices and sq_dists, nearest first.  Returns the
+    /// number found, which is less than k only if the tree holds fewer
+    /// than k points.
+    size_t knn_search( point_type const& query, size_t k,
+                       std::vector<size_t>& indices, std::vector<RealT>& sq_dists ) const;
+
+    /// Find the k nearest points to each of queries, on num_threads
+    /// threads or the default number if num_threads is zero.  The
+    /// results for query q are at [q*k, (q+1)*k) of indices and
+    /// sq_dists, nearest first, padded with invalid_index() and
+    /// infinity if the tree holds fewer than k points.
+    void knn_search( std::vector<point_type> const& queries, size_t k,
+                     std::vector<size_t>& indices, std::vector<RealT>& sq_dists,
+                     int num_threads = 0 ) const;
+
+  private:
+    struct Node {
+      RealT  split;
+      uint32 dim;
+    };
+
+    // The state of one search, reused between the queries of a batch.
+    struct Search {
+      point_type query;
+      size_t k;
+      std::vector<std::pair<RealT, size_t> > heap; // max-heap on distance
+      RealT worst() const {
+        return heap.size() < k ? std::numeric_limits<RealT>::max() : heap.front().first;
+      }
+    };
+
+    class BuildTask;
+    class QueryTask;
+
+    size_t m_leaf_size, m_depth;
+    std::vector<Node>   m_nodes;  // 2^m_depth - 1, in heap order
+    std::vector<RealT>  m_points; // DimN per point, in tree order
+    std::vector<size_t> m_index;  // the original index of each point in tree order
+
+    // Sort the points of node, which span [begin, end) of m_index, into
+    // a subtree.  Nodes shallower than parallel_depth queue their
+    // subtrees on queue instead of building them.
+    template <class PointT>
+    void build_node( std::vector<PointT> const& points, size_t node, size_t level,
+                     size_t begin, size_t end, size_t parallel_depth, FifoWorkQueue* queue );
+
+    void search_node( Search& search, size_t node, size_t level, size_t begin, size_t end,
+                      RealT min_dist, RealT* offsets ) const;
+
+    void search( Search& search ) const;
+  };
+
+  // ---------------------------------------------------------------------
+  // Building
+  // ---------------------------------------------------------------------
+
+  template <class RealT, size_t DimN>
+  class FlatKDTree<RealT, DimN>::BuildTask : public Task {
+    boost::function<void()> m_build;
+  public:
+    BuildTask( boost::function<void()> const& build ) : m_build( build ) {}
+    virtual void operator()() { m_build(); }
+  };
+
+  namespace detail {
+    // Orders point indices along one dimension.
+    template <class PointT>
+    struct FlatKDTreeCompare {
+      std::vector<PointT> const& points;
+      size_t dim;
+      FlatKDTreeCompare( std::vector<PointT> const& points, size_t dim ) : points( points ), dim( dim ) {}
+      bool operator()( size_t a, size_t b ) const { return points[a][dim] < points[b][dim]; }
+    };
+  }
+
+  template <class RealT, size_t DimN>
+  template <class PointT>
+  void FlatKDTree<RealT, DimN>::build_node( std::vector<PointT> const& points, size_t node,
+                                            size_t level, size_t begin, size_t end,
+                                            size_t parallel_depth, FifoWorkQueue* queue ) {
+    if ( level == m_depth )
+      return;
+
+    if ( queue && level == parallel_depth ) {
+      queue->add_task( boost::shared_ptr<Task>( new BuildTask(
+        boost::bind( &FlatKDTree::build_node<PointT>, this, boost::cref( points ), node, level,
+                     begin, end, parallel_depth, (FifoWorkQueue*)0 ) ) ) );
+      return;
+    }
+
+    // Split the dimension of widest spread at the middle point.
+    RealT lo[DimN], hi[DimN];
+    for ( size_t d = 0; d < DimN; ++d )
+      lo[d] = hi[d] = RealT( points[m_index[begin]][d] );
+    for ( size_t i = begin + 1; i < end; ++i )
+      for ( size_t d = 0; d < DimN; ++d ) {
+        const RealT v = RealT( points[m_index[i]][d] );
+        lo[d] = std::min( lo[d], v );
+        hi[d] = std::max( hi[d], v );
+      }
+    size_t dim = 0;
+    for ( size_t d = 1; d < DimN; ++d )
+      if ( hi[d] - lo[d] > hi[dim] - lo[dim] )
+        dim = d;
+
+    const size_t mid = begin + ( end - begin ) / 2;
+    std::nth_element( m_index.begin() + begin, m_index.begin() + mid, m_index.begin() + end,
+                      detail::FlatKDTreeCompare<PointT>( points, dim ) );
+    m_nodes[node].dim   = uint32( dim );
+    m_nodes[node].split = RealT( points[m_index[mid]][dim] );
+
+    build_node( points, 2*node + 1, level + 1, begin, mid, parallel_depth, queue );
+    build_node( points, 2*node + 2, level + 1, mid,   end, parallel_depth, queue );
+  }
+
+  template <class RealT, size_t DimN>
+  template <class PointT>
+  void FlatKDTree<RealT, DimN>::build( std::vector<PointT> const& points, int num_threads ) {
+    const size_t num_points = points.size();
+    m_index.resize( num_points );
+    for ( size_t i = 0; i < num_points; ++i )
+      m_index[i] = i;
+
+    // The depth at which every leaf holds at most m_leaf_size points.
+    m_depth = 0;
+    while ( ( num_points >> m_depth ) > m_leaf_size )
+      ++m_depth;
+    m_nodes.assign( ( size_t(1) << m_depth ) - 1, Node() );
+
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+    if ( num_threads > 1 && m_depth > 4 ) {
+      // About four subtrees per thread, built once the levels above
+      // them are sorted.
+      size_t parallel_depth = 0;
+      while ( ( size_t(1) << parallel_depth ) < size_t( 4*num_threads ) && parallel_depth + 2 < m_depth )
+        ++parallel_depth;
+      FifoWorkQueue queue( num_threads );
+      build_node( points, 0, 0, 0, num_points, parallel_depth, &queue );
+      queue.join_all();
+    } else {
+      build_node( points, 0, 0, 0, num_points, m_depth, (FifoWorkQueue*)0 );
+    }
+
+    m_points.resize( DimN * num_points );
+    for ( size_t i = 0; i < num_points; ++i )
+      for ( size_t d = 0; d < DimN; ++d )
+        m_points[DimN*i + d] = RealT( points[m_index[i]][d] );
+  }
+
+  // ---------------------------------------------------------------------
+  // Searching
+  // ---------------------------------------------------------------------
+
+  // min_dist is the squared distance from the query to the cell of
+  // node, accumulated from offsets, the distance to the cell along
+  // each dimension.  See Arya and Mount, "Algorithms for fast vector
+  // quantization" (1993).
+  template <class RealT, size_t DimN>
+  void FlatKDTree<RealT, DimN>::search_node( Search& search, size_t node, size_t level,
+                                             size_t begin, size_t end,
+                                             RealT min_dist, RealT* offsets ) const {
+    if ( level == m_depth ) {
+      for ( size_t i = begin; i < end; ++i ) {
+        RealT const* p = &m_points[DimN*i];
+        RealT dist = 0;
+        for ( size_t d = 0; d < DimN; ++d ) {
+          const RealT diff = search.query[d] - p[d];
+          dist += diff * diff;
+        }
+        if ( dist < search.worst() ) {
+          if ( search.heap.size() == search.k ) {
+            std::pop_heap( search.heap.begin(), search.heap.end() );
+            search.heap.pop_back();
+          }
+          search.heap.push_back( std::make_pair( dist, m_index[i] ) );
+          std::push_heap( search.heap.begin(), search.heap.end() );
+        }
+      }
+      return;
+    }
+
+    const size_t mid = begin + ( end - begin ) / 2;
+    const Node& n = m_nodes[node];
+    const RealT diff = search.query[n.dim] - n.split;
+    const bool go_left = diff < 0;
+    search_node( search, go_left ? 2*node + 1 : 2*node + 2, level + 1,
+                 go_left ? begin : mid, go_left ? mid : end, min_dist, offsets );
+
+    const RealT old_offset = offsets[n.dim];
+    const RealT far_dist = min_dist - old_offset*old_offset + diff*diff;
+    if ( far_dist < search.worst() ) {
+      offsets[n.dim] = diff;
+      search_node( search, go_left ? 2*node + 2 : 2*node + 1, level + 1,
+                   go_left ? mid : begin, go_left ? end : mid, far_dist, offsets );
+      offsets[n.dim] = old_offset;
+    }
+  }
+
+  template <class RealT, size_t DimN>
+  void FlatKDTree<RealT, DimN>::search( Search& search ) const {
+    search.heap.clear();
+    if ( search.k == 0 || m_index.empty() )
+      return;
+    RealT offsets[DimN];
+    std::fill( offsets, offsets + DimN, RealT(0) );
+    search_node( search, 0, 0, 0, m_index.size(), RealT(0), offsets );
+    std::sort_heap( search.heap.begin(), search.heap.end() );
+  }
+
+  template <class RealT, size_t DimN>
+  size_t FlatKDTree<RealT, DimN>::knn_search( point_type const& query, size_t k,
+                                              std::vector<size_t>& indices,
+                                              std::vector<RealT>& sq_dists ) const {
+    Search s;
+    s.query = query;
+    s.k     = k;
+    search( s );
+    indices.resize( s.heap.size() );
+    sq_dists.resize( s.heap.size() );
+    for ( size_t i = 0; i < s.heap.size(); ++i ) {
+      sq_dists[i] = s.heap[i].first;
+      indices [i] = s.heap[i].second;
+    }
+    return s.heap.size();
+  }
+
+  template <class RealT, size_t DimN>
+  class FlatKDTree<RealT, DimN>::QueryTask : public Task {
+    FlatKDTree const& m_tree;
+    std::vector<point_type> const& m_queries;
+    size_t m_k, m_begin, m_end;
+    std::vector<size_t>& m_indices;
+    std::vector<RealT>& m_sq_dists;
+  public:
+    QueryTask( FlatKDTree const& tree, std::vector<point_type> const& queries, size_t k,
+               size_t begin, size_t end, std::vector<size_t>& indices, std::vector<RealT>& sq_dists )
+      : m_tree( tree ), m_queries( queries ), m_k( k ), m_begin( begin ), m_end( end ),
+        m_indices( indices ), m_sq_dists( sq_dists ) {}
+
+    virtual void operator()() {
+      Search s;
+      s.k = m_k;
+      s.heap.reserve( m_k );
+      for ( size_t q = m_begin; q < m_end; ++q ) {
+        s.query = m_queries[q];
+        m_tree.search( s );
+        for ( size_t i = 0; i < m_k; ++i ) {
+          const bool found = i < s.heap.size();
+          m_indices [q*m_k + i] = found ? s.heap[i].second : invalid_index();
+          m_sq_dists[q*m_k + i] = found ? s.heap[i].first  : std::numeric_limits<RealT>::infinity();
+        }
+      }
+    }
+  };
+
+  template <class RealT, size_t DimN>
+  void FlatKDTree<RealT, DimN>::knn_search( std::vector<point_type> const& queries, size_t k,
+                                            std::vector<size_t>& indices,
+                                            std::vector<RealT>& sq_dists, int num_threads ) const {
+    indices.resize( queries.size() * k );
+    sq_dists.resize( queries.size() * k );
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+
+    // Runs of queries large enough to amortize a task.
+    const size_t min_run = 256;
+    const size_t num_runs = std::min( size_t( 4*num_threads ), ( queries.size() + min_run - 1 ) / min_run );
+    if ( num_threads == 1 || num_runs <= 1 ) {
+      QueryTask( *this, queries, k, 0, queries.size(), indices, sq_dists )();
+      return;
+    }
+    FifoWorkQueue queue( num_threads );
+    for ( size_t r = 0; r < num_runs; ++r )
+      queue.add_task( boost::shared_ptr<Task>(
+        new QueryTask( *this, queries, k, r*queries.size()/num_runs, (r+1)*queries.size()/num_runs,
+                       indices, sq_dists ) ) );
+    queue.join_all();
+  }
+
+}} // namespace vw::math
+
+#endif//__VW_MATH_FLAT_KDTREE_H__
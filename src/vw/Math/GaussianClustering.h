@@ -20,140 +20,270 @@
 #define __VW_MATH_GAUSSIAN_CLUSTERING_H__
 
 #include <vector>
+#include <vw/Math/Vector.h>
 #include <vw/Math/Statistics.h>
-#include <boost/accumulators/accumulators.hpp>
-#include <boost/accumulators/statistics.hpp>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 
 namespace vw {
-
-  // Generic clustering tool (mulitple dimensions and multiple clusters)
-  template <class ContainerT, size_t DimensionsT>
-  std::vector<std::pair<vw::Vector<double>,vw::Vector<double> > > // for every
-  // cluster,
-  // mean and
-  // variance
-  gaussian_clustering( typename ContainerT::iterator begin,
-                       typename ContainerT::iterator end,
-                       size_t clusters = 2) {
-    namespace ba = boost::accumulators;
-    using namespace vw;
-    typedef ba::accumulator_set<double, ba::stats<ba::tag::variance> > acc_set;
-    typedef Vector<double, DimensionsT> VectorD;
-    typedef typename ContainerT::iterator IterT;
-
-    std::vector<math::CDFAccumulator<double> > cdf( DimensionsT );
-    size_t num_samples = 0;
-
-    // Working out best spot to place seeds for clusters
-    for ( IterT i = begin; i != end; i++ ) {
-      for ( size_t d = 0; d < DimensionsT; d++ ) {
-        cdf[d]( (*i)[d] );
+namespace math {
+namespace detail {
+
+  // Ways of reading value d of sample i, so that one implementation
+  // serves vector samples, scalar samples and a copied subset.
+  template <class IterT>
+  struct ClusteringVectorSamples {
+    IterT begin;
+    ClusteringVectorSamples( IterT begin ) : begin( begin ) {}
+    double operator()( size_t i, size_t d ) const { return (*(begin + i))[d]; }
+  };
+
+  template <class IterT>
+  struct ClusteringScalarSamples {
+    IterT begin;
+    ClusteringScalarSamples( IterT begin ) : begin( begin ) {}
+    double operator()( size_t i, size_t /*d*/ ) const { return *(begin + i); }
+  };
+
+  template <size_t DimN>
+  struct ClusteringFlatSamples {
+    double const* values;
+    ClusteringFlatSamples( double const* values ) : values( values ) {}
+    double operator()( size_t i, size_t d ) const { return values[i*DimN + d]; }
+  };
+
+  // The sufficient statistics of one block of samples: the count of
+  // each cluster, and per cluster and dimension the sums of the
+  // offsets and squared offsets from the cluster's current mean.
+  // Offsets keep the variance accurate when the means are large.
+  struct ClusteringStats {
+    std::vector<size_t> count;
+    std::vector<double> sum, sum_sq;
+    void reset( size_t clusters, size_t dims ) {
+      count.assign( clusters, 0 );
+      sum.assign( clusters*dims, 0.0 );
+      sum_sq.assign( clusters*dims, 0.0 );
+    }
+    void add( ClusteringStats const& other ) {
+      for ( size_t c = 0; c < count.size(); c++ )
+        count[c] += other.count[c];
+      for ( size_t k = 0; k < sum.size(); k++ ) {
+        sum[k]    += other.sum[k];
+        sum_sq[k] += other.sum_sq[k];
       }
-      num_samples++;
     }
-    for ( size_t d = 0; d < DimensionsT; d++ )
-      cdf[d].update();
-
-    // Start clusters
-    std::vector<VectorD > means( clusters ), variances( clusters );
-    for ( size_t c = 0; c < clusters; c++ ) {
-      double probability = double( 1 + c ) / double( 1 + clusters );
-      for ( size_t d = 0; d < DimensionsT; d++ ) {
-        means[c][d] = cdf[d].quantile( probability );
+  };
+
+  // Assigns each sample of [begin, end) to the cluster c that
+  // minimizes offset[c] + sum_d weight[c,d] * (x_d - mean[c,d])^2,
+  // the first on ties, and accumulates stats.  With unit weights
+  // and no offsets this is the nearest mean, and with weights of
+  // 1/(2 variance) and offsets of the log normalizers it is the most
+  // likely cluster.  The cluster loop runs over flat arrays so the
+  // compiler can vectorize it.
+  template <size_t DimN, class SamplesT>
+  class ClusteringAssignTask : public Task {
+    SamplesT m_samples;
+    size_t m_begin, m_end, m_clusters;
+    std::vector<double> const& m_mean;
+    std::vector<double> const& m_weight;
+    std::vector<double> const& m_offset;
+    ClusteringStats& m_stats;
+  public:
+    ClusteringAssignTask( SamplesT const& samples, size_t begin, size_t end, size_t clusters,
+                          std::vector<double> const& mean, std::vector<double> const& weight,
+                          std::vector<double> const& offset, ClusteringStats& stats )
+      : m_samples( samples ), m_begin( begin ), m_end( end ), m_clusters( clusters ),
+        m_mean( mean ), m_weight( weight ), m_offset( offset ), m_stats( stats ) {}
+
+    virtual void operator()() {
+      m_stats.reset( m_clusters, DimN );
+      std::vector<double> cost( m_clusters );
+      double s[DimN];
+      for ( size_t i = m_begin; i < m_end; i++ ) {
+        for ( size_t d = 0; d < DimN; d++ )
+          s[d] = m_samples( i, d );
+        for ( size_t c = 0; c < m_clusters; c++ ) {
+          double const* mean   = &m_mean[c*DimN];
+          double const* weight = &m_weight[c*DimN];
+          double total = m_offset[c];
+          for ( size_t d = 0; d < DimN; d++ ) {
+            const double delta = s[d] - mean[d];
+            total += weight[d] * delta * delta;
+          }
+          cost[c] = total;
+        }
+        const size_t best = std::min_element( cost.begin(), cost.end() ) - cost.begin();
+        m_stats.count[best]++;
+        for ( size_t d = 0; d < DimN; d++ ) {
+          const double delta = s[d] - m_mean[best*DimN + d];
+          m_stats.sum   [best*DimN + d] += delta;
+          m_stats.sum_sq[best*DimN + d] += delta * delta;
+        }
       }
-      VW_OUT( DebugMessage, "math" ) << "Cluster " << c << " mean seeded with:\n"
-                                    << means[c] << std::endl;
     }
+  };
+
+  // Runs one assignment pass over the samples and replaces means and
+  // variances with those of the clusters found.  Returns the count of
+  // cluster 0.  The samples are split into fixed size blocks whose
+  // stats are summed in order, so the result does not depend on the
+  // number of threads.  A cluster that receives no samples keeps its
+  // estimate.
+  template <size_t DimN, class SamplesT>
+  size_t clustering_pass( SamplesT const& samples, size_t num_samples, size_t clusters,
+                          bool most_likely, std::vector<double>& means,
+                          std::vector<double>& variances, int num_threads ) {
+    std::vector<double> weight( clusters*DimN, 1.0 ), offset( clusters, 0.0 );
+    if ( most_likely )
+      for ( size_t c = 0; c < clusters; c++ )
+        for ( size_t d = 0; d < DimN; d++ ) {
+          weight[c*DimN + d] = 1.0 / ( 2 * variances[c*DimN + d] );
+          offset[c] += 0.5 * log( 2.0 * M_PI * variances[c*DimN + d] );
+        }
 
-    { // Prime the variance by sorting the samples
-      std::vector<acc_set> acc( clusters * DimensionsT );
-
-      // Bin the samples based on their distance from mean
-      std::vector<double> distance( clusters );
-      for ( IterT i = begin; i != end; i++ ) {
-        VectorD s;
-        for ( size_t d = 0; d < DimensionsT; d++ )
-          s[d] = (*i)[d];
-
-        for ( size_t c = 0; c < clusters; c++ )
-          distance[c] = norm_2( s - means[c] );
-
-        size_t min_index =
-          std::distance(distance.begin(),
-                        std::min_element( distance.begin(), distance.end() ));
-
-        for ( size_t d = 0; d < DimensionsT; d++ )
-          acc[ min_index * DimensionsT + d ]( s[d] );
-      }
+    const size_t block_size = 1 << 16;
+    const size_t num_blocks = std::max( size_t(1), ( num_samples + block_size - 1 ) / block_size );
+    std::vector<ClusteringStats> block_stats( num_blocks );
+    typedef ClusteringAssignTask<DimN, SamplesT> task_type;
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+    if ( num_threads == 1 || num_blocks == 1 ) {
+      for ( size_t b = 0; b < num_blocks; b++ )
+        task_type( samples, b*block_size, std::min( num_samples, (b+1)*block_size ), clusters,
+                   means, weight, offset, block_stats[b] )();
+    } else {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t b = 0; b < num_blocks; b++ )
+        queue.add_task( boost::shared_ptr<Task>(
+          new task_type( samples, b*block_size, std::min( num_samples, (b+1)*block_size ),
+                         clusters, means, weight, offset, block_stats[b] ) ) );
+      queue.join_all();
+    }
 
-      // Pull mean an variance from accumulators
-      for ( size_t c = 0; c < clusters; c++ ) {
-        for ( size_t d = 0; d < DimensionsT; d++ ) {
-          means[c][d] = ba::mean( acc[ c * DimensionsT + d ] );
-          variances[c][d] = std::max(ba::variance( acc[ c * DimensionsT + d ] ),
-                                     std::numeric_limits<double>::epsilon());
-        }
-        VW_OUT( DebugMessage, "math" ) << "Cluster " << c << " seeded with:\n"
-                                      << means[c] << " " << variances[c]
-                                      << " " << ba::count( acc[c*DimensionsT] ) << std::endl;
+    ClusteringStats& stats = block_stats[0];
+    for ( size_t b = 1; b < num_blocks; b++ )
+      stats.add( block_stats[b] );
+    for ( size_t c = 0; c < clusters; c++ ) {
+      if ( stats.count[c] == 0 )
+        continue;
+      for ( size_t d = 0; d < DimN; d++ ) {
+        const size_t k = c*DimN + d;
+        const double mean_offset = stats.sum[k] / stats.count[c];
+        means[k] += mean_offset;
+        variances[k] = std::max( stats.sum_sq[k] / stats.count[c] - mean_offset * mean_offset,
+                                 std::numeric_limits<double>::epsilon() );
       }
+      VW_OUT( DebugMessage, "math" ) << "Cluster " << c << " updated with "
+                                     << stats.count[c] << " samples." << std::endl;
     }
+    return stats.count[0];
+  }
 
-    // Iterate and refine mean and variance estimates
+  // Refines the estimates with most likely assignments until the size
+  // of cluster 0 stops changing.
+  template <size_t DimN, class SamplesT>
+  void clustering_refine( SamplesT const& samples, size_t num_samples, size_t clusters,
+                          std::vector<double>& means, std::vector<double>& variances,
+                          int num_threads ) {
     ssize_t change = 10, previous_set0_size = 0;
     while ( change ) {
-      // Precalulate the the scalar on the normal distribution
-      std::vector<VectorD > normal_scalar( clusters );
-      for ( size_t c = 0; c < clusters; c++ )
-        normal_scalar[c] = elem_quot( 1.0, sqrt( 2.0 * M_PI * variances[c] ) );
-
-      std::vector<acc_set> acc( clusters * DimensionsT );
-
-      // Bin the samples based on their probabilities
-      std::vector<double> probability( clusters );
-      for ( IterT i = begin; i != end; i++ ) {
-        VectorD s;
-        for ( size_t d = 0; d < DimensionsT; d++ )
-          s[d] = (*i)[d];
+      ssize_t count = clustering_pass<DimN>( samples, num_samples, clusters, true,
+                                             means, variances, num_threads );
+      change = previous_set0_size - count;
+      previous_set0_size = count;
+    }
+  }
 
-        for ( size_t c = 0; c < clusters; c++ )
-          probability[c] =
-            prod(elem_prod(normal_scalar[c], exp( elem_quot(-elem_prod( s-means[c], s-means[c] ), ( 2 * variances[c] ) ) ) ) );
+  // Seeds the clusters at evenly spaced quantiles of each dimension,
+  // then primes the variances by assigning samples to the nearest mean.
+  template <size_t DimN, class SamplesT>
+  void clustering_seed( SamplesT const& samples, size_t num_samples, size_t clusters,
+                        std::vector<double>& means, std::vector<double>& variances,
+                        int num_threads ) {
+    std::vector<CDFAccumulator<double> > cdf( DimN );
+    for ( size_t i = 0; i < num_samples; i++ )
+      for ( size_t d = 0; d < DimN; d++ )
+        cdf[d]( samples( i, d ) );
+    for ( size_t d = 0; d < DimN; d++ )
+      cdf[d].update();
 
-        size_t max_index =
-          std::distance(probability.begin(),
-                        std::max_element( probability.begin(), probability.end() ));
+    means.resize( clusters*DimN );
+    variances.assign( clusters*DimN, std::numeric_limits<double>::epsilon() );
+    for ( size_t c = 0; c < clusters; c++ )
+      for ( size_t d = 0; d < DimN; d++ )
+        means[c*DimN + d] = cdf[d].quantile( double( 1 + c ) / double( 1 + clusters ) );
 
-        for ( size_t d = 0; d < DimensionsT; d++ )
-          acc[ max_index * DimensionsT + d ]( s[d] );
-      }
+    clustering_pass<DimN>( samples, num_samples, clusters, false, means, variances, num_threads );
+  }
 
-      // Pull mean and variance from accumulators
-      for ( size_t c = 0; c < clusters; c++ ) {
-        for ( size_t d = 0; d < DimensionsT; d++ ) {
-          means[c][d] = ba::mean( acc[ c * DimensionsT + d ] );
-          variances[c][d] = std::max(ba::variance( acc[ c * DimensionsT + d ] ),
-                                     std::numeric_limits<double>::epsilon());
-        }
-        VW_OUT( DebugMessage, "math" ) << "Cluster " << c << " updated:\n"
-                                      << means[c] << " " << variances[c] << " "
-                                      << ba::count(acc[c * DimensionsT]) << std::endl;
+  template <size_t DimN, class SamplesT>
+  std::vector<std::pair<Vector<double>, Vector<double> > >
+  gaussian_clustering( SamplesT const& samples, size_t num_samples, size_t clusters,
+                       int num_threads, size_t batch_size ) {
+    std::vector<double> means, variances;
+    if ( batch_size > 0 && batch_size < num_samples ) {
+      // Fit a subset first, then finish on all of the samples, which
+      // from a good start takes few passes.  The subset has one sample
+      // from each of batch_size equal strata of the input, at a
+      // pseudorandom place in the stratum so that periodic inputs such
+      // as image rows are not aliased.
+      std::vector<double> batch( batch_size*DimN );
+      uint32 state = 1;
+      for ( size_t b = 0; b < batch_size; b++ ) {
+        state = state * 1664525u + 1013904223u;
+        const double jitter = ( state >> 8 ) / double( 1 << 24 );
+        const size_t i = size_t( ( b + jitter ) * num_samples / batch_size );
+        for ( size_t d = 0; d < DimN; d++ )
+          batch[b*DimN + d] = samples( i, d );
       }
-
-      // Update change indicators
-      ssize_t count = ba::count( acc[0] );
-      change = previous_set0_size - count;
-      previous_set0_size = count;
+      ClusteringFlatSamples<DimN> batch_samples( &batch[0] );
+      clustering_seed<DimN>( batch_samples, batch_size, clusters, means, variances, num_threads );
+      clustering_refine<DimN>( batch_samples, batch_size, clusters, means, variances, num_threads );
+    } else {
+      clustering_seed<DimN>( samples, num_samples, clusters, means, variances, num_threads );
     }
+    clustering_refine<DimN>( samples, num_samples, clusters, means, variances, num_threads );
 
     std::vector<std::pair<Vector<double>, Vector<double> > > results( clusters );
     for ( size_t c = 0; c < clusters; c++ ) {
-      results[c].first = means[c];
-      results[c].second = variances[c];
+      results[c].first.set_size( DimN );
+      results[c].second.set_size( DimN );
+      for ( size_t d = 0; d < DimN; d++ ) {
+        results[c].first[d]  = means[c*DimN + d];
+        results[c].second[d] = variances[c*DimN + d];
+      }
     }
     return results;
   }
 
+}} // namespace math::detail
+
+  // Generic clustering tool (mulitple dimensions and multiple clusters)
+  //
+  // Each sample is assigned to its most likely cluster, and each
+  // cluster's mean and variance are re-estimated from its samples,
+  // until the clusters stop changing.  The passes over the samples
+  // run on num_threads threads (0 for the default), and give the same
+  // result for any number of threads.  If batch_size is nonzero and
+  // less than the number of samples, the clusters are first fit to
+  // batch_size samples spread evenly through the input, which saves
+  // most of the passes over large inputs.  The iterators must be
+  // random access.
+  template <class ContainerT, size_t DimensionsT>
+  std::vector<std::pair<vw::Vector<double>,vw::Vector<double> > > // for every
+  // cluster,
+  // mean and
+  // variance
+  gaussian_clustering( typename ContainerT::iterator begin,
+                       typename ContainerT::iterator end,
+                       size_t clusters = 2, int num_threads = 0, size_t batch_size = 0 ) {
+    typedef typename ContainerT::iterator IterT;
+    return math::detail::gaussian_clustering<DimensionsT>(
+      math::detail::ClusteringVectorSamples<IterT>( begin ), std::distance( begin, end ),
+      clusters, num_threads, batch_size );
+  }
+
   // Scalar Version
   template <class ContainerT>
   std::vector<std::pair<vw::Vector<double>,vw::Vector<double> > > // for every
@@ -162,108 +292,11 @@ namespace vw {
   // variance
   gaussian_clustering( typename ContainerT::iterator begin,
                        typename ContainerT::iterator end,
-                       size_t clusters = 2) {
-    namespace ba = boost::accumulators;
-    using namespace vw;
-    typedef ba::accumulator_set<double, ba::stats<ba::tag::variance> > acc_set;
-    typedef double VectorD;
+                       size_t clusters = 2, int num_threads = 0, size_t batch_size = 0 ) {
     typedef typename ContainerT::iterator IterT;
-
-    math::CDFAccumulator<double> cdf;
-    size_t num_samples = 0;
-
-    // Working out best spot to place seeds for clusters
-    for ( IterT i = begin; i != end; i++ ) {
-      cdf( (*i) );
-      num_samples++;
-    }
-    cdf.update();
-
-    // Start clusters
-    std::vector<VectorD > means( clusters ), variances( clusters );
-    for ( size_t c = 0; c < clusters; c++ ) {
-      double probability = double( 1 + c ) / double( 1 + clusters );
-      means[c] = cdf.quantile( probability );
-      VW_OUT( DebugMessage, "math" ) << "PreSeed Mean " << c << " = " << means[c] << "\n";
-    }
-
-    { // Prime the variance by sorting the samples
-      std::vector<acc_set> acc( clusters );
-
-      // Bin the samples based on their distance from mean
-      std::vector<double> distance( clusters );
-      for ( IterT i = begin; i != end; i++ ) {
-        VectorD s = (*i);
-
-        for ( size_t c = 0; c < clusters; c++ )
-          distance[c] = fabs(s - means[c]);
-
-        size_t min_index =
-          std::distance(distance.begin(),
-                        std::min_element( distance.begin(), distance.end() ));
-
-        acc[ min_index ]( s );
-      }
-
-      // Pull mean an variance from accumulators
-      for ( size_t c = 0; c < clusters; c++ ) {
-        means[c] = ba::mean( acc[ c ] );
-        variances[c] = std::max(ba::variance( acc[ c ] ),
-                                std::numeric_limits<double>::epsilon());
-        VW_OUT( DebugMessage, "math" ) << "Cluster " << c << " seeded with:\n"
-                                      << means[c] << " " << variances[c] << std::endl;
-      }
-    }
-
-    // Iterate and refine mean and variance estimates
-    ssize_t change = 10, previous_set0_size = 0;
-    while ( change ) {
-      // Precalulate the the scalar on the normal distribution
-      std::vector<VectorD > normal_scalar( clusters );
-      for ( size_t c = 0; c < clusters; c++ )
-        normal_scalar[c] = 1.0 /sqrt( 2.0 * M_PI * variances[c] );
-
-      std::vector<acc_set> acc( clusters );
-
-      // Bin the samples based on their probabilities
-      std::vector<double> probability( clusters );
-      for ( IterT i = begin; i != end; i++ ) {
-        VectorD s = (*i);
-
-        for ( size_t c = 0; c < clusters; c++ )
-          probability[c] =
-            normal_scalar[c] * exp( -pow(s-means[c], 2) / ( 2 * variances[c] ) );
-
-        size_t max_index =
-          std::distance(probability.begin(),
-                        std::max_element( probability.begin(), probability.end() ));
-
-        acc[ max_index ]( s );
-      }
-
-      // Pull mean and variance from accumulators
-      for ( size_t c = 0; c < clusters; c++ ) {
-        means[c] = ba::mean( acc[ c ] );
-        variances[c] = std::max(ba::variance( acc[ c ] ),
-                                std::numeric_limits<double>::epsilon());
-        VW_OUT( DebugMessage, "math" ) << "Cluster " << c << " updated:\n"
-                                      << means[c] << " " << variances[c]
-                                      << " " << ba::count( acc[c] ) << std::endl;
-      }
-
-      // Update change indicators
-      ssize_t count = ba::count( acc[0] );
-      change = previous_set0_size - count;
-      previous_set0_size = count;
-    }
-
-    std::vector<std::pair<Vector<double>, Vector<double> > > results( clusters );
-    for ( size_t c = 0; c < clusters; c++ ) {
-      results[c].first = Vector<double,1>(means[c]);
-      results[c].second = Vector<double,1>(variances[c]);
-    }
-
-    return results;
+    return math::detail::gaussian_clustering<1>(
+      math::detail::ClusteringScalarSamples<IterT>( begin ), std::distance( begin, end ),
+      clusters, num_threads, batch_size );
   }
 }
 
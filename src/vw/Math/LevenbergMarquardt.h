@@ -30,6 +30,8 @@
 
 // Vision Workbench
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/LinearAlgebra.h>
@@ -37,6 +39,9 @@
 // Boost
 #include <boost/concept_check.hpp>
 
+#include <exception>
+#include <vector>
+
 namespace vw {
 namespace math {
 
@@ -484,9 +489,9 @@ namespace math {
           delta_x = hessian_lm_inv*del_J;
         }else{
           try{
-            // By construction, hessian_lm is symmetric and
-            // positive-definite.
-            delta_x = solve_symmetric(hessian_lm, del_J);
+            // The fixed-size solve() factors hessian_lm on the stack,
+            // so up to 8 parameters this allocates nothing.
+            delta_x = solve(hessian_lm, del_J);
           }catch ( const ArgumentErr& e ) {
             // If lambda is very small, the matrix becomes numerically
             // singular. In that case use the more general
@@ -557,10 +562,106 @@ namespace math {
     //VW_OUT(DebugMessage, "math") << "LM: finished with: " << outer_iter << "\n";
     return x;
   } // End levenberg_marquardtFixed
-  
-  
-  
-  
+
+
+  namespace detail {
+    /// Solves problems [begin, end) of a levenberg_marquardt_batch().
+    template <class ImplT>
+    class LevenbergMarquardtBatchTask : public Task {
+      typedef typename ImplT::domain_type domain_type;
+      typedef typename ImplT::result_type result_type;
+      std::vector<ImplT> const& m_models;
+      std::vector<domain_type> const& m_seeds;
+      std::vector<result_type> const& m_observations;
+      std::vector<domain_type>& m_solutions;
+      std::vector<int>& m_status;
+      size_t m_begin, m_end;
+      double m_abs_tolerance, m_rel_tolerance, m_max_iterations;
+      Mutex& m_mutex;
+      std::exception_ptr& m_error;
+    public:
+      LevenbergMarquardtBatchTask( std::vector<ImplT> const& models,
+                                   std::vector<domain_type> const& seeds,
+                                   std::vector<result_type> const& observations,
+                                   std::vector<domain_type>& solutions, std::vector<int>& status,
+                                   size_t begin, size_t end, double abs_tolerance,
+                                   double rel_tolerance, double max_iterations,
+                                   Mutex& mutex, std::exception_ptr& error )
+        : m_models(models), m_seeds(seeds), m_observations(observations),
+          m_solutions(solutions), m_status(status), m_begin(begin), m_end(end),
+          m_abs_tolerance(abs_tolerance), m_rel_tolerance(rel_tolerance),
+          m_max_iterations(max_iterations), m_mutex(mutex), m_error(error) {}
+
+      virtual void operator()() {
+        try {
+          for ( size_t i = m_begin; i < m_end; ++i )
+            m_solutions[i] = levenberg_marquardtFixed( m_models[i], m_seeds[i], m_observations[i],
+                                                       m_status[i], m_abs_tolerance,
+                                                       m_rel_tolerance, m_max_iterations );
+        } catch ( ... ) {
+          Mutex::Lock lock( m_mutex );
+          if ( !m_error )
+            m_error = std::current_exception();
+        }
+      }
+    };
+  } // namespace detail
+
+  /// Solves many independent problems of the same fixed size, such as
+  /// the subpixel fit of every pixel of an image, with
+  /// levenberg_marquardtFixed().  Problem i is models[i] starting from
+  /// seeds[i] and fitting observations[i], and its status is written
+  /// to status[i].  The batch is split into contiguous runs of
+  /// problems that are solved in parallel on num_threads threads, or
+  /// on the default number of threads if num_threads is zero.
+  ///
+  /// Up to 8 parameters, the only allocations are for the runs, not
+  /// for each problem or iteration.
+  template <class ImplT>
+  std::vector<typename ImplT::domain_type>
+  levenberg_marquardt_batch( std::vector<ImplT> const& models,
+                             std::vector<typename ImplT::domain_type> const& seeds,
+                             std::vector<typename ImplT::result_type> const& observations,
+                             std::vector<int>& status,
+                             double abs_tolerance = VW_MATH_LM_ABS_TOL,
+                             double rel_tolerance = VW_MATH_LM_REL_TOL,
+                             double max_iterations = VW_MATH_LM_MAX_ITER,
+                             int num_threads = 0 ) {
+    VW_ASSERT( seeds.size() == models.size() && observations.size() == models.size(),
+               ArgumentErr() << "levenberg_marquardt_batch: There must be one seed and one "
+                             << "observation for each model." );
+    const size_t num_problems = models.size();
+    std::vector<typename ImplT::domain_type> solutions( num_problems );
+    status.assign( num_problems, optimization::eStatusUnknown );
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+
+    // A few runs per thread balances the load when some problems
+    // take more iterations than others.
+    const size_t min_run = 64;
+    size_t num_runs = std::min( size_t(4*num_threads), (num_problems + min_run - 1) / min_run );
+    Mutex mutex;
+    std::exception_ptr error;
+    if ( num_threads == 1 || num_runs <= 1 ) {
+      detail::LevenbergMarquardtBatchTask<ImplT>( models, seeds, observations, solutions, status,
+                                                  0, num_problems, abs_tolerance, rel_tolerance,
+                                                  max_iterations, mutex, error )();
+    } else {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t r = 0; r < num_runs; ++r )
+        queue.add_task( boost::shared_ptr<Task>(
+          new detail::LevenbergMarquardtBatchTask<ImplT>( models, seeds, observations, solutions,
+                                                          status, r*num_problems/num_runs,
+                                                          (r+1)*num_problems/num_runs,
+                                                          abs_tolerance, rel_tolerance,
+                                                          max_iterations, mutex, error ) ) );
+      queue.join_all();
+    }
+    if ( error )
+      std::rethrow_exception( error );
+    return solutions;
+  }
+
 }} // namespace vw::math
 
 #endif // __VW_OPTIMIZATION_H__
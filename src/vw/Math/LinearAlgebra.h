@@ -383,6 +383,23 @@ namespace math {
   }
 
 
+  /// Solves A*x=b for a small fixed-size A without calling LAPACK,
+  /// whose call overhead dominates at these sizes.
+  template <class T, size_t DimN>
+  typename boost::enable_if_c< (DimN > 0 && DimN <= 8), Vector<T,DimN> >::type
+  solve( Matrix<T,DimN,DimN> const& A, Vector<T,DimN> const& B ) {
+    Matrix<T,DimN,DimN> lu = A;
+    size_t perm[DimN];
+    if ( !detail::fixed_lu_decompose<T,DimN>( lu.data(), perm ) )
+      vw_throw( ArgumentErr() << "solve(): Matrix is singular." );
+    Vector<T,DimN> result;
+    for ( size_t i=0; i<DimN; ++i )
+      result[i] = B[perm[i]];
+    detail::fixed_lu_substitute<T,DimN>( lu.data(), &result[0] );
+    return result;
+  }
+
+
   // ---------------------------------------------------------------------------
   // x = solve_symmetric(A,b) where A is a symmetric, positive definite matrix.
   // Computes the solution to a real system of linear equations:
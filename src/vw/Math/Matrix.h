@@ -25,7 +25,8 @@
 ///   Seamless conversion between compatibile matrix types
 ///   Matrix addition, subtraction, and negation
 ///   Scalar multiplication and division
-///   Matrix*matrix, matrix*vector, and vector*matrix products
+///   Matrix*matrix, matrix*vector, and vector*matrix products, which are
+///     evaluated eagerly by unrolled kernels for fixed-size operands
 ///   Sum of elements via sum()
 ///   Trace via trace()
 ///   Determinant via det()
@@ -1981,6 +1982,71 @@ namespace math {
     return MatrixMatrixProduct<Matrix1T,Matrix2T,false,false>( m1.impl(), m2.impl() );
   }
 
+  // *******************************************************************
+  // Fixed-size products.
+  // *******************************************************************
+
+  // The expression templates above compute each element of a product
+  // as a separate dot product through row and column proxies, which
+  // the compiler rarely vectorizes.  When both operands are
+  // fixed-size matrices of the same type, as the 2x2 to 6x6 matrices
+  // in the camera and bundle adjustment inner loops are, the product
+  // is instead computed eagerly with loops whose bounds are known at
+  // compile time, which the compiler unrolls and vectorizes.
+
+  /// Product of two fixed-size matrices.
+  template <class ElemT, size_t RowsN, size_t InnerN, size_t ColsN>
+  typename boost::enable_if_c< (RowsN > 0 && InnerN > 0 && ColsN > 0),
+                               Matrix<ElemT,RowsN,ColsN> >::type
+  inline operator*( Matrix<ElemT,RowsN,InnerN> const& m1, Matrix<ElemT,InnerN,ColsN> const& m2 ) {
+    Matrix<ElemT,RowsN,ColsN> result;
+    ElemT const* a = m1.data();
+    ElemT const* b = m2.data();
+    ElemT* r = result.data();
+    if ( ColsN < 4 ) {
+      // Narrow results are computed a dot product at a time.
+      for ( size_t i=0; i<RowsN; ++i )
+        for ( size_t j=0; j<ColsN; ++j ) {
+          ElemT sum = a[i*InnerN] * b[j];
+          for ( size_t k=1; k<InnerN; ++k )
+            sum += a[i*InnerN+k] * b[k*ColsN+j];
+          r[i*ColsN+j] = sum;
+        }
+    } else {
+      // Wider ones accumulate whole rows of m2, so the innermost loop
+      // runs over contiguous memory.  The row is kept locally so that
+      // the compiler need not assume that it aliases the operands.
+      for ( size_t i=0; i<RowsN; ++i ) {
+        ElemT row[ColsN];
+        for ( size_t j=0; j<ColsN; ++j )
+          row[j] = a[i*InnerN] * b[j];
+        for ( size_t k=1; k<InnerN; ++k ) {
+          const ElemT aik = a[i*InnerN+k];
+          for ( size_t j=0; j<ColsN; ++j )
+            row[j] += aik * b[k*ColsN+j];
+        }
+        for ( size_t j=0; j<ColsN; ++j )
+          r[i*ColsN+j] = row[j];
+      }
+    }
+    return result;
+  }
+
+  /// Product of a fixed-size matrix and a fixed-size vector.
+  template <class ElemT, size_t RowsN, size_t ColsN>
+  typename boost::enable_if_c< (RowsN > 0 && ColsN > 0), Vector<ElemT,RowsN> >::type
+  inline operator*( Matrix<ElemT,RowsN,ColsN> const& m, Vector<ElemT,ColsN> const& v ) {
+    Vector<ElemT,RowsN> result;
+    ElemT const* a = m.data();
+    for ( size_t i=0; i<RowsN; ++i ) {
+      ElemT sum = ElemT();
+      for ( size_t j=0; j<ColsN; ++j )
+        sum += a[i*ColsN+j] * v[j];
+      result[i] = sum;
+    }
+    return result;
+  }
+
 
   // *******************************************************************
   // Convenience functions for returning a pre-made identity matrix in
@@ -2096,6 +2162,96 @@ namespace math {
       Matrix<T, 2, 2> out(d[3]/det, -d[1]/det, -d[2]/det, d[0]/det);
       return out;
   }
+
+  /// Inverse of a 3x3 matrix from its adjugate.
+  template <typename T>
+  Matrix<T, 3, 3> inverse(Matrix<T, 3, 3> const& m) {
+    T const* d = m.data();
+    Matrix<T, 3, 3> out( d[4]*d[8] - d[5]*d[7], d[2]*d[7] - d[1]*d[8], d[1]*d[5] - d[2]*d[4],
+                         d[5]*d[6] - d[3]*d[8], d[0]*d[8] - d[2]*d[6], d[2]*d[3] - d[0]*d[5],
+                         d[3]*d[7] - d[4]*d[6], d[1]*d[6] - d[0]*d[7], d[0]*d[4] - d[1]*d[3] );
+    T det = d[0]*out(0,0) + d[1]*out(1,0) + d[2]*out(2,0);
+    if (det == T(0))
+      vw_throw( MathErr() << "Matrix is singular in inverse()" );
+    T* o = out.data();
+    for ( size_t k=0; k<9; ++k )
+      o[k] /= det;
+    return out;
+  }
+
+  namespace detail {
+    /// LU decomposition of a row-major DimN by DimN matrix in place,
+    /// with partial pivoting.  Rows are swapped as they are pivoted,
+    /// and perm records the original index of each row.  Returns false
+    /// if a pivot is exactly zero.
+    template <class T, size_t DimN>
+    bool fixed_lu_decompose( T* a, size_t* perm ) {
+      for ( size_t i=0; i<DimN; ++i ) perm[i] = i;
+      for ( size_t i=0; i<DimN; ++i ) {
+        size_t pivot = i;
+        T best = std::abs( a[i*DimN+i] );
+        for ( size_t k=i+1; k<DimN; ++k )
+          if ( std::abs( a[k*DimN+i] ) > best ) {
+            best = std::abs( a[k*DimN+i] );
+            pivot = k;
+          }
+        if ( best == T(0) )
+          return false;
+        if ( pivot != i ) {
+          std::swap( perm[i], perm[pivot] );
+          for ( size_t j=0; j<DimN; ++j )
+            std::swap( a[i*DimN+j], a[pivot*DimN+j] );
+        }
+        const T inv = T(1) / a[i*DimN+i];
+        for ( size_t k=i+1; k<DimN; ++k ) {
+          const T l = a[k*DimN+i] *= inv;
+          for ( size_t j=i+1; j<DimN; ++j )
+            a[k*DimN+j] -= l * a[i*DimN+j];
+        }
+      }
+      return true;
+    }
+
+    /// Solves LU x = b in place, where b is already permuted.
+    template <class T, size_t DimN>
+    void fixed_lu_substitute( T const* lu, T* b ) {
+      for ( size_t i=1; i<DimN; ++i ) {
+        T sum = b[i];
+        for ( size_t j=0; j<i; ++j )
+          sum -= lu[i*DimN+j] * b[j];
+        b[i] = sum;
+      }
+      for ( size_t i=DimN; i-- > 0; ) {
+        T sum = b[i];
+        for ( size_t j=i+1; j<DimN; ++j )
+          sum -= lu[i*DimN+j] * b[j];
+        b[i] = sum / lu[i*DimN+i];
+      }
+    }
+  } // namespace detail
+
+  /// Inverse of a small fixed-size matrix, by LU decomposition on the
+  /// stack rather than through the dynamic matrices of the general
+  /// inverse() below.
+  template <class T, size_t DimN>
+  typename boost::enable_if_c< (DimN > 3 && DimN <= 8), Matrix<T,DimN,DimN> >::type
+  inverse( Matrix<T,DimN,DimN> const& m ) {
+    Matrix<T,DimN,DimN> lu = m;
+    size_t perm[DimN];
+    if ( !detail::fixed_lu_decompose<T,DimN>( lu.data(), perm ) )
+      vw_throw( MathErr() << "Matrix is singular in inverse()" );
+
+    Matrix<T,DimN,DimN> out;
+    T col[DimN];
+    for ( size_t j=0; j<DimN; ++j ) {
+      for ( size_t i=0; i<DimN; ++i )
+        col[i] = ( perm[i] == j ) ? T(1) : T(0);
+      detail::fixed_lu_substitute<T,DimN>( lu.data(), col );
+      for ( size_t i=0; i<DimN; ++i )
+        out(i,j) = col[i];
+    }
+    return out;
+  }
   
   /// Matrix inversion
   template <class MatrixT>
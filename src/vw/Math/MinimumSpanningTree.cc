@@ -16,6 +16,8 @@
 // __END_LICENSE__
 
 #include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/DisjointSet.h>
 #include <vw/Math/MinimumSpanningTree.h>
 
@@ -24,16 +26,117 @@
 
 namespace {
 
-  int edge_primitive_compare(const void *a_, const void *b_)
-  {
-    const vw::math::EdgePrimitive **a = (const vw::math::EdgePrimitive**)a_;
-    const vw::math::EdgePrimitive **b = (const vw::math::EdgePrimitive**)b_;
-    if ((*a)->cost() == (*b)->cost())
-      return 0;
-    else if ((*a)->cost() < (*b)->cost())
-      return -1;
-    return 1;
-  }
+  // Orders edge indices by cost, then by index.
+  struct EdgeOrder {
+    std::vector<double> const& cost;
+    EdgeOrder(std::vector<double> const& cost) : cost(cost) {}
+    bool operator()(size_t a, size_t b) const {
+      return cost[a] < cost[b] || (cost[a] == cost[b] && a < b);
+    }
+  };
+
+  // Flags the edges of [begin, end) whose ends are in different sets.
+  class EdgeFilterTask : public vw::Task {
+    std::vector<size_t> const& m_edges;
+    std::vector<int> const& m_node1;
+    std::vector<int> const& m_node2;
+    vw::math::FlatDisjointSet const& m_sets;
+    std::vector<char>& m_keep;
+    size_t m_begin, m_end;
+  public:
+    EdgeFilterTask(std::vector<size_t> const& edges, std::vector<int> const& node1,
+                   std::vector<int> const& node2, vw::math::FlatDisjointSet const& sets,
+                   std::vector<char>& keep, size_t begin, size_t end)
+      : m_edges(edges), m_node1(node1), m_node2(node2), m_sets(sets),
+        m_keep(keep), m_begin(begin), m_end(end) {}
+    virtual void operator()() {
+      for (size_t i = m_begin; i < m_end; i++) {
+        const size_t e = m_edges[i];
+        m_keep[i] = m_sets.find_root(m_node1[e]) != m_sets.find_root(m_node2[e]);
+      }
+    }
+  };
+
+  class FilterKruskal {
+    std::vector<int>    const& m_node1;
+    std::vector<int>    const& m_node2;
+    std::vector<double> const& m_cost;
+    std::vector<size_t>& m_forest;
+    vw::math::FlatDisjointSet m_sets;
+    size_t m_max_edges, m_base_size;
+    int m_num_threads;
+
+    bool done() const { return m_forest.size() == m_max_edges; }
+
+    void kruskal(std::vector<size_t>& edges, size_t begin, size_t end) {
+      std::sort(edges.begin() + begin, edges.begin() + end, EdgeOrder(m_cost));
+      for (size_t i = begin; i < end && !done(); i++)
+        if (m_sets.combine(m_node1[edges[i]], m_node2[edges[i]]))
+          m_forest.push_back(edges[i]);
+    }
+
+    // Drops the edges of [begin, end) that would close a cycle, keeping
+    // the order of the rest, and returns the new end.
+    size_t filter(std::vector<size_t>& edges, size_t begin, size_t end) {
+      std::vector<char> keep(end, 1);
+      const size_t min_run = 1 << 14;
+      const size_t num_runs = std::min(size_t(4*m_num_threads), (end - begin + min_run - 1) / min_run);
+      if (m_num_threads == 1 || num_runs <= 1) {
+        EdgeFilterTask(edges, m_node1, m_node2, m_sets, keep, begin, end)();
+      } else {
+        vw::FifoWorkQueue queue(m_num_threads);
+        for (size_t r = 0; r < num_runs; r++)
+          queue.add_task(boost::shared_ptr<vw::Task>(
+            new EdgeFilterTask(edges, m_node1, m_node2, m_sets, keep,
+                               begin + r*(end - begin)/num_runs,
+                               begin + (r+1)*(end - begin)/num_runs)));
+        queue.join_all();
+      }
+      size_t out = begin;
+      for (size_t i = begin; i < end; i++)
+        if (keep[i])
+          edges[out++] = edges[i];
+      return out;
+    }
+
+  public:
+    FilterKruskal(size_t num_nodes, std::vector<int> const& node1, std::vector<int> const& node2,
+                  std::vector<double> const& cost, std::vector<size_t>& forest, int num_threads)
+      : m_node1(node1), m_node2(node2), m_cost(cost), m_forest(forest), m_sets(num_nodes),
+        m_max_edges(num_nodes ? num_nodes - 1 : 0), m_base_size(std::max(size_t(1024), num_nodes)),
+        m_num_threads(num_threads) {}
+
+    void run(std::vector<size_t>& edges, size_t begin, size_t end) {
+      if (done())
+        return;
+      if (end - begin <= m_base_size) {
+        kruskal(edges, begin, end);
+        return;
+      }
+
+      // Partition around the median of three edges into the edges no
+      // heavier than the pivot and the rest.
+      EdgeOrder order(m_cost);
+      size_t a = edges[begin], b = edges[begin + (end - begin)/2], c = edges[end-1];
+      if (order(b, a)) std::swap(a, b);
+      if (order(c, b)) std::swap(b, c);
+      if (order(b, a)) std::swap(a, b);
+      const size_t pivot = b;
+      size_t middle = begin;
+      for (size_t i = begin; i < end; i++)
+        if (!order(pivot, edges[i]))
+          std::swap(edges[i], edges[middle++]);
+      if (middle == end) {
+        kruskal(edges, begin, end);
+        return;
+      }
+
+      run(edges, begin, middle);
+      if (done())
+        return;
+      run(edges, middle, filter(edges, middle, end));
+    }
+  };
 
 } // namespace
 
@@ -41,19 +144,37 @@ namespace {
 namespace vw {
 namespace math {
 
+  void minimum_spanning_forest(size_t num_nodes,
+                               std::vector<int>    const& node1,
+                               std::vector<int>    const& node2,
+                               std::vector<double> const& cost,
+                               std::vector<size_t>& forest,
+                               int num_threads) {
+    VW_ASSERT(node1.size() == node2.size() && node1.size() == cost.size(),
+              ArgumentErr() << "minimum_spanning_forest: Edge arrays differ in size.");
+    for (size_t i = 0; i < node1.size(); i++)
+      VW_ASSERT(node1[i] >= 0 && size_t(node1[i]) < num_nodes &&
+                node2[i] >= 0 && size_t(node2[i]) < num_nodes,
+                ArgumentErr() << "minimum_spanning_forest: Edge " << i << " has an invalid node.");
+    if (num_threads <= 0)
+      num_threads = vw_settings().default_num_threads();
+
+    std::vector<size_t> edges(cost.size());
+    for (size_t i = 0; i < edges.size(); i++)
+      edges[i] = i;
+    forest.clear();
+    FilterKruskal(num_nodes, node1, node2, cost, forest, num_threads).run(edges, 0, edges.size());
+  }
+
   MinimumSpanningTree::MinimumSpanningTree(int num_primitives_, EdgePrimitive **prims_) {
-    VW_ASSERT(num_primitives > 0, ArgumentErr() << "No primitives provided!");
+    VW_ASSERT(num_primitives_ > 0, ArgumentErr() << "No primitives provided!");
     int max_node;
-    DisjointSet<int> ds;
-    DisjointSet<int>::Elem *ds_elem;
-    DisjointSet<int>::Set set1, set2;
-    int i, j1, j2, k;
+    int i, j1, j2;
 
     num_primitives = num_primitives_;
     prims = new EdgePrimitive*[num_primitives];
     for (i = 0; i < num_primitives; i++)
       prims[i] = prims_[i];
-    qsort(prims, num_primitives, sizeof(EdgePrimitive*), edge_primitive_compare);
 
     min_node = std::min(prims[0]->node1(), prims[0]->node2());
     max_node = std::max(prims[0]->node1(), prims[0]->node2());
@@ -68,37 +189,29 @@ namespace math {
     node_used = new bool[num_nodes];
     for (i = 0; i < num_nodes; i++)
       node_used[i] = false;
+    std::vector<int> node1(num_primitives), node2(num_primitives);
+    std::vector<double> cost(num_primitives);
     for (i = 0; i < num_primitives; i++) {
-      j1 = prims[i]->node1() - min_node;
-      j2 = prims[i]->node2() - min_node;
+      node1[i] = j1 = prims[i]->node1() - min_node;
+      node2[i] = j2 = prims[i]->node2() - min_node;
+      cost[i] = prims[i]->cost();
       node_used[j1] = true;
       node_used[j2] = true;
     }
 
+    std::vector<size_t> forest;
+    minimum_spanning_forest(num_nodes, node1, node2, cost, forest);
+
     prim_used = new bool[num_primitives];
     for (i = 0; i < num_primitives; i++)
       prim_used[i] = false;
     num_edges = new int[num_nodes];
-    ds_elem = new DisjointSet<int>::Elem[num_nodes];
-    for (i = 0, k = min_node; i < num_nodes; i++, k++) {
+    for (i = 0; i < num_nodes; i++)
       num_edges[i] = 0;
-      if (node_used[i])
-        ds_elem[i] = ds.insert(k);
-      else
-        ds_elem[i] = 0;
-    }
-
-    for (i = 0; i < num_primitives; i++) {
-      j1 = prims[i]->node1() - min_node;
-      j2 = prims[i]->node2() - min_node;
-      set1 = ds.find(ds_elem[j1]);
-      set2 = ds.find(ds_elem[j2]);
-      if (set1 != set2) {
-        ds.combine(set1, set2);
-        prim_used[i] = true;
-        num_edges[j1]++;
-        num_edges[j2]++;
-      }
+    for (size_t f = 0; f < forest.size(); f++) {
+      prim_used[forest[f]] = true;
+      num_edges[node1[forest[f]]]++;
+      num_edges[node2[forest[f]]]++;
     }
 
     edges = new EdgePrimitive**[num_nodes];
@@ -106,18 +219,14 @@ namespace math {
       edges[i] = new EdgePrimitive*[num_edges[i]];
       num_edges[i] = 0;
     }
-    for (i = 0; i < num_primitives; i++) {
-      if (prim_used[i]) {
-        j1 = prims[i]->node1() - min_node;
-        j2 = prims[i]->node2() - min_node;
-        edges[j1][num_edges[j1]] = prims[i];
-        num_edges[j1]++;
-        edges[j2][num_edges[j2]] = prims[i];
-        num_edges[j2]++;
-      }
+    // In order of increasing cost, as the traversal expects.
+    for (size_t f = 0; f < forest.size(); f++) {
+      EdgePrimitive* prim = prims[forest[f]];
+      j1 = node1[forest[f]];
+      j2 = node2[forest[f]];
+      edges[j1][num_edges[j1]++] = prim;
+      edges[j2][num_edges[j2]++] = prim;
     }
-
-    delete[] ds_elem;
   }
 
   MinimumSpanningTree::~MinimumSpanningTree() {
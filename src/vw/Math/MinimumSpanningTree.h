@@ -32,10 +32,31 @@
 // connected components will be processed by apply() after the connected
 // component that contains the user-defined starting node.
 
+#include <vector>
+#include <cstddef>
 
 namespace vw {
 namespace math {
 
+  /// Computes the minimum spanning forest of the graph on nodes
+  /// 0 .. num_nodes-1 whose edge i joins node1[i] and node2[i] at
+  /// cost[i], and writes the indices of its edges to forest in order
+  /// of increasing cost.
+  /// - Uses filter-Kruskal: the edges are partitioned around a pivot
+  ///   cost, the light ones are processed first, and heavy edges whose
+  ///   ends are then already connected are filtered out in parallel on
+  ///   num_threads threads (0 for the default) before the heavy part
+  ///   is processed.  Most of the heavy edges of a dense graph are
+  ///   never sorted.
+  /// - Ties in cost are broken by edge index, so the forest is unique
+  ///   and does not depend on the number of threads.
+  void minimum_spanning_forest(size_t num_nodes,
+                               std::vector<int>    const& node1,
+                               std::vector<int>    const& node2,
+                               std::vector<double> const& cost,
+                               std::vector<size_t>& forest,
+                               int num_threads = 0);
+
   class EdgePrimitive {
   public:
     EdgePrimitive() : default_cost(1.0) {}
@@ -50,12 +50,33 @@
 ///    set of points, this routine could compute the 2-norm of the
 ///    error: || p2 - H * p1 ||
 ///
+/// By default the samples are drawn uniformly.  If the data can be
+/// ranked by quality, for example matches by their descriptor distance
+/// ratio, set_sample_order() switches to the guided sampling of PROSAC:
+///
+/// Chum, Ondrej and Matas, Jiri. "Matching with PROSAC - Progressive
+/// Sample Consensus" (2005)
+///
+/// Models can be scored on several threads with set_num_threads(),
+/// the number of iterations can adapt to the inlier ratio seen so far
+/// with set_confidence(), and models which are clearly wrong can be
+/// rejected after scoring only a few data with set_sprt(), which
+/// applies Wald's sequential probability ratio test as in:
+///
+/// Chum, Ondrej and Matas, Jiri. "Optimal Randomized RANSAC" (2008)
+///
 
 #ifndef __VW_MATH_RANSAC_H__
 #define __VW_MATH_RANSAC_H__
 
 #include <vw/Math/Vector.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <vector>
+#include <cmath>
+#include <exception>
+#include <limits>
 
 namespace vw {
 namespace math {
@@ -113,7 +134,12 @@ namespace math {
           double        m_inlier_threshold;
           int           m_min_num_output_inliers;
           bool          m_reduce_min_num_output_inliers_if_no_fit;
-    
+    std::vector<size_t> m_sample_order;
+          int           m_num_threads;
+          double        m_confidence;
+          bool          m_use_sprt;
+  mutable int           m_iterations_run;
+
     /// \cond INTERNAL
     // Utility Function: Pick N UNIQUE, random integers in the range [0, size]
     inline void get_n_unique_integers(int size, std::vector<int> & samples) const {
@@ -140,10 +166,235 @@ namespace math {
         }
       }
     }
+    // PROSAC state for one attempt_ransac() call.  Samples are drawn from
+    // the pool_size best data, and the pool grows on the schedule of
+    // section 2.3 of the PROSAC paper.
+    struct ProsacSchedule {
+      int    pool_size;     // n
+      double pool_samples;  // T_n
+      double grow_at;       // T'_n
+      ProsacSchedule() : pool_size(0), pool_samples(0), grow_at(0) {}
+    };
+
+    // The PROSAC paper's T_N, the number of samples after which PROSAC
+    // draws from all the data.  This is independent of m_num_iterations.
+    static double prosac_max_samples() { return 200000; }
+
+    void init_prosac(ProsacSchedule& schedule, int num_data, int sample_size) const {
+      schedule.pool_size    = sample_size;
+      schedule.pool_samples = prosac_max_samples();
+      for (int i = 0; i < sample_size; ++i)
+        schedule.pool_samples *= double(sample_size - i) / double(num_data - i);
+      schedule.grow_at = 1;
+    }
+
+    // Draw the sample for a 1-based iteration.  The sample always holds
+    // the newest member of the pool until the schedule says the pool has
+    // been sampled enough, and then it is drawn from the whole pool.
+    void prosac_sample(ProsacSchedule& schedule, int iteration, int num_data,
+                       std::vector<int>& samples) const {
+      const int sample_size = samples.size();
+      while (iteration > schedule.grow_at && schedule.pool_size < num_data) {
+        double next_samples = schedule.pool_samples * (schedule.pool_size + 1)
+                            / (schedule.pool_size + 1 - sample_size);
+        schedule.grow_at     += std::ceil(next_samples - schedule.pool_samples);
+        schedule.pool_samples = next_samples;
+        ++schedule.pool_size;
+      }
+
+      if (iteration <= schedule.grow_at && schedule.pool_size > sample_size) {
+        samples.resize(sample_size - 1);
+        get_n_unique_integers(schedule.pool_size - 1, samples);
+        samples.push_back(schedule.pool_size - 1);
+      } else {
+        get_n_unique_integers(schedule.pool_size, samples);
+      }
+      for (int i = 0; i < sample_size; ++i)
+        samples[i] = m_sample_order[samples[i]];
+    }
+
+    // Hypotheses are drawn and fit in batches of this many.  Samples
+    // are drawn and results are merged in iteration order, one batch
+    // at a time, so the result does not depend on the thread count.
+    static int batch_size() { return 64; }
+
+    // The SPRT state.  epsilon is the probability that a datum is an
+    // inlier of a good model, and delta that it is consistent with a
+    // bad one.  A model is rejected once the likelihood ratio of it
+    // being bad exceeds threshold.
+    struct SprtTest {
+      double epsilon, delta, threshold;
+      double delta_sum;   // consistent fractions of rejected models
+      int    num_rejected;
+    };
+
+    // Section 3.1 of the paper: with C the expected information per
+    // datum of a bad model, the threshold is the fixed point of
+    // A = t_M C + 1 + log(A), where t_M, the time to fit a model in
+    // units of the time to score a datum, is taken to be 200.
+    static void update_sprt_threshold(SprtTest& sprt) {
+      if (sprt.epsilon <= sprt.delta) {
+        sprt.threshold = std::numeric_limits<double>::infinity();
+        return;
+      }
+      const double C = (1 - sprt.delta) * std::log((1 - sprt.delta) / (1 - sprt.epsilon))
+                     + sprt.delta * std::log(sprt.delta / sprt.epsilon);
+      double A = 200 * C + 1;
+      for (int i = 0; i < 10; ++i)
+        A = 200 * C + 1 + std::log(A);
+      sprt.threshold = A;
+    }
+
+    // One fitted, scored and re-estimated model.
+    struct Hypothesis {
+      std::vector<int> samples;
+      typename FittingFuncT::result_type H;
+      int    num_inliers;   // before re-estimation
+      int    num_tested;    // data scored before an SPRT rejection, or all
+      bool   rejected;      // by the SPRT
+      bool   valid;         // enough inliers, and err is set
+      double err;
+      std::exception_ptr error;
+    };
+
+    // Fit, score, and re-estimate one hypothesis.  If sprt is not null,
+    // scoring stops as soon as the model is rejected.
+    template <class ContainerT1, class ContainerT2>
+    void evaluate(Hypothesis& hyp, SprtTest const* sprt,
+                  std::vector<ContainerT1> const& p1, std::vector<ContainerT2> const& p2) const {
+      hyp.valid    = false;
+      hyp.rejected = false;
+      try {
+        const size_t sample_size = hyp.samples.size();
+        std::vector<ContainerT1> try1(sample_size);
+        std::vector<ContainerT2> try2(sample_size);
+        for (size_t i = 0; i < sample_size; ++i) {
+          try1[i] = p1[hyp.samples[i]];
+          try2[i] = p2[hyp.samples[i]];
+        }
+
+        // 1. Compute the fit using these samples.
+        hyp.H = m_fitting_func(try1, try2);
+
+        // 2. Find all the inliers for this fit, or stop early if the
+        //    SPRT rejects it.
+        try1.clear();
+        try2.clear();
+        double likelihood_ratio = 1.0;
+        hyp.num_tested = p1.size();
+        for (size_t i = 0; i < p1.size(); ++i) {
+          if (m_error_func(hyp.H, p1[i], p2[i]) < m_inlier_threshold) {
+            try1.push_back(p1[i]);
+            try2.push_back(p2[i]);
+            if (sprt)
+              likelihood_ratio *= sprt->delta / sprt->epsilon;
+          } else if (sprt) {
+            likelihood_ratio *= (1 - sprt->delta) / (1 - sprt->epsilon);
+          }
+          if (sprt && likelihood_ratio > sprt->threshold) {
+            hyp.rejected   = true;
+            hyp.num_tested = i + 1;
+            break;
+          }
+        }
+        hyp.num_inliers = try1.size();
+
+        // 3. Skip this model if too few inliers.
+        if (hyp.rejected || hyp.num_inliers < m_min_num_output_inliers)
+          return;
+
+        // 4. Re-estimate the model using the inliers.
+        hyp.H = m_fitting_func(try1, try2, hyp.H);
+
+        // 5. Find the mean error for the inliers.
+        double err_val = 0.0;
+        for (size_t i = 0; i < try1.size(); i++)
+          err_val += m_error_func(hyp.H, try1[i], try2[i]);
+        hyp.err   = err_val / try1.size();
+        hyp.valid = true;
+      } catch (...) {
+        hyp.error = std::current_exception();
+      }
+    }
+
+    // Evaluates hypotheses [begin, end) of a batch on a worker thread.
+    template <class ContainerT1, class ContainerT2>
+    class EvaluateTask : public Task {
+      RandomSampleConsensus const& m_ransac;
+      std::vector<Hypothesis>& m_hypotheses;
+      size_t m_begin, m_end;
+      SprtTest const* m_sprt;
+      std::vector<ContainerT1> const& m_p1;
+      std::vector<ContainerT2> const& m_p2;
+    public:
+      EvaluateTask(RandomSampleConsensus const& ransac,
+                   std::vector<Hypothesis>& hypotheses,
+                   size_t begin, size_t end, SprtTest const* sprt,
+                   std::vector<ContainerT1> const& p1, std::vector<ContainerT2> const& p2)
+        : m_ransac(ransac), m_hypotheses(hypotheses), m_begin(begin), m_end(end),
+          m_sprt(sprt), m_p1(p1), m_p2(p2) {}
+      virtual void operator()() {
+        for (size_t k = m_begin; k < m_end; ++k)
+          m_ransac.evaluate(m_hypotheses[k], m_sprt, m_p1, m_p2);
+      }
+    };
+
+    // The iterations needed to draw an all-inlier sample with
+    // probability m_confidence, when a fraction inlier_ratio of the
+    // data are inliers and a good model passes the SPRT with
+    // probability pass_rate.
+    int adaptive_iterations(double inlier_ratio, int sample_size, double pass_rate) const {
+      const double good = std::pow(inlier_ratio, sample_size) * pass_rate;
+      if (good <= 0)
+        return m_num_iterations;
+      if (good >= 1)
+        return 1;
+      const double needed = std::ceil(std::log(1 - m_confidence) / std::log(1 - good));
+      return needed < m_num_iterations ? std::max(int(needed), 1) : m_num_iterations;
+    }
     /// \endcond
 
   public:
 
+    /// Use PROSAC guided sampling.  order must be a permutation of the
+    /// data indices, from the most to the least likely to be an inlier.
+    /// Sampling starts with the best few data and gradually widens to
+    /// all of them.  Every model is still scored on all the data.  Pass
+    /// an empty vector to go back to uniform sampling.
+    void set_sample_order(std::vector<size_t> const& order) {
+      m_sample_order = order;
+    }
+
+    /// Fit and score models on this many threads.  Zero uses the
+    /// default number of Vision Workbench threads.  The fitting and
+    /// error functors must then be safe to call concurrently.  The
+    /// result is the same for any number of threads.
+    void set_num_threads(int num_threads) {
+      m_num_threads = num_threads;
+    }
+
+    /// Stop once the probability of having drawn at least one
+    /// all-inlier sample reaches confidence, for example 0.99,
+    /// estimated from the best model so far.  The number of iterations
+    /// given to the constructor becomes an upper bound.  Zero, the
+    /// default, always runs every iteration.
+    void set_confidence(double confidence) {
+      VW_ASSERT( confidence >= 0 && confidence < 1,
+                 ArgumentErr() << "RANSAC confidence must be in [0, 1)." );
+      m_confidence = confidence;
+    }
+
+    /// Reject models with Wald's sequential probability ratio test,
+    /// usually after scoring only a few data instead of all of them.
+    /// A good model is rejected only rarely, and set_confidence()
+    /// accounts for that.
+    void set_sprt(bool use_sprt) {
+      m_use_sprt = use_sprt;
+    }
+
+    /// The number of models drawn by the last attempt_ransac().
+    int iterations_run() const { return m_iterations_run; }
+
     // Returns the list of inliers.
     template <class ContainerT1, class ContainerT2>
     void inliers(typename FittingFuncT::result_type const& H,
@@ -191,7 +442,8 @@ namespace math {
       m_num_iterations(num_iterations), 
       m_inlier_threshold(inlier_threshold),
       m_min_num_output_inliers(min_num_output_inliers),
-      m_reduce_min_num_output_inliers_if_no_fit(reduce_min_num_output_inliers_if_no_fit){}
+      m_reduce_min_num_output_inliers_if_no_fit(reduce_min_num_output_inliers_if_no_fit),
+      m_num_threads(1), m_confidence(0), m_use_sprt(false), m_iterations_run(0){}
 
     /// As attempt_ransac but keep trying with smaller numbers of required inliers.
     template <class ContainerT1, class ContainerT2>
@@ -248,52 +500,98 @@ namespace math {
 
       typename FittingFuncT::result_type best_H;
 
-      std::vector<ContainerT1> try1;
-      std::vector<ContainerT2> try2;
-      std::vector<int> random_indices(min_elems_for_fit);
-
-      int num_inliers = 0;
+      const bool use_prosac = !m_sample_order.empty();
+      VW_ASSERT( !use_prosac || m_sample_order.size() == p1.size(),
+                 RANSACErr() << "RANSAC Error.  The sample order does not match the data size." );
+      ProsacSchedule schedule;
+      if (use_prosac)
+        init_prosac(schedule, p1.size(), min_elems_for_fit);
+
+      // Until a model is found, the inliers are assumed to be as few
+      // as the caller accepts.
+      SprtTest sprt;
+      sprt.epsilon      = std::min(0.99, double(m_min_num_output_inliers) / p1.size());
+      sprt.delta        = 0.05;
+      sprt.delta_sum    = 0;
+      sprt.num_rejected = 0;
+      update_sprt_threshold(sprt);
+
+      const int num_threads = m_num_threads > 0 ? m_num_threads
+                                                : vw_settings().default_num_threads();
+      std::vector<Hypothesis> batch;
+
+      int num_inliers = 0, max_inliers = 0;
+      int max_iterations = m_num_iterations;
       double min_err = std::numeric_limits<double>::max();
-      for (int iteration = 0; iteration < m_num_iterations; ++iteration) {
+      int iteration = 0;
+      while (iteration < max_iterations) {
 
         // 0. Get min_elems_for_fit points at random, taking care not
         //    to select the same point twice.
-        get_n_unique_integers(p1.size(), random_indices);
-        // Resizing below is essential, as by now their size may have changed
-        try1.resize(min_elems_for_fit);
-        try2.resize(min_elems_for_fit);
-        for (int i = 0; i < min_elems_for_fit; ++i) {
-          try1[i] = p1[random_indices[i]];
-          try2[i] = p2[random_indices[i]];
+        batch.resize(std::min(batch_size(), max_iterations - iteration));
+        for (size_t k = 0; k < batch.size(); ++k) {
+          batch[k].samples.resize(min_elems_for_fit);
+          batch[k].error = std::exception_ptr();
+          if (use_prosac)
+            prosac_sample(schedule, iteration+k+1, p1.size(), batch[k].samples);
+          else
+            get_n_unique_integers(p1.size(), batch[k].samples);
         }
 
-        // 1. Compute the fit using these samples.
-        typename FittingFuncT::result_type H = m_fitting_func(try1, try2);
-
-        // 2. Find all the inliers for this fit.
-        inliers(H, p1, p2, try1, try2);
-
-        // 3. Skip this model if too few inliers.
-        if ((int)try1.size() < m_min_num_output_inliers) 
-          continue;
-
-        // 4. Re-estimate the model using the inliers.
-        H = m_fitting_func(try1, try2, H);
-        
-        // 5. Find the mean error for the inliers.
-        double err_val = 0.0;
-        for (size_t i = 0; i < try1.size(); i++) 
-          err_val += m_error_func(H, try1[i], try2[i]);
-        err_val /= try1.size();
-
-        // 6. Save this model if its error is lowest so far.
-        if (err_val < min_err){
-          min_err     = err_val;
-          best_H      = H;
-          num_inliers = try1.size();
+        // 1 - 5. Fit and score each model.
+        SprtTest const* sprt_ptr = m_use_sprt ? &sprt : 0;
+        const size_t num_tasks = std::min(size_t(num_threads), batch.size());
+        if (num_tasks <= 1) {
+          for (size_t k = 0; k < batch.size(); ++k)
+            evaluate(batch[k], sprt_ptr, p1, p2);
+        } else {
+          FifoWorkQueue queue(num_tasks);
+          for (size_t t = 0; t < num_tasks; ++t)
+            queue.add_task(boost::shared_ptr<Task>(
+              new EvaluateTask<ContainerT1,ContainerT2>(*this, batch, t*batch.size()/num_tasks,
+                                                        (t+1)*batch.size()/num_tasks,
+                                                        sprt_ptr, p1, p2)));
+          queue.join_all();
         }
 
+        // 6. Save the model with the lowest error so far.
+        for (size_t k = 0; k < batch.size(); ++k) {
+          Hypothesis& hyp = batch[k];
+          if (hyp.error)
+            std::rethrow_exception(hyp.error);
+          if (hyp.rejected) {
+            sprt.delta_sum += double(hyp.num_inliers) / hyp.num_tested;
+            ++sprt.num_rejected;
+            continue;
+          }
+          if (!hyp.valid)
+            continue;
+          max_inliers = std::max(max_inliers, hyp.num_inliers);
+          if (hyp.err < min_err) {
+            min_err     = hyp.err;
+            best_H      = hyp.H;
+            num_inliers = hyp.num_inliers;
+          }
+        }
+        iteration += batch.size();
+
+        // Refine the SPRT from what has been seen, and the number of
+        // iterations from the best inlier ratio so far.
+        if (m_use_sprt) {
+          if (max_inliers > 0)
+            sprt.epsilon = std::min(0.99, std::max(sprt.epsilon, double(max_inliers) / p1.size()));
+          if (sprt.num_rejected > 0)
+            sprt.delta = std::max(1e-4, sprt.delta_sum / sprt.num_rejected);
+          update_sprt_threshold(sprt);
+        }
+        if (m_confidence > 0 && max_inliers > 0) {
+          const double pass_rate = m_use_sprt ? 1 - 1 / sprt.threshold : 1;
+          max_iterations = std::min(max_iterations,
+                                    adaptive_iterations(double(max_inliers) / p1.size(),
+                                                        min_elems_for_fit, pass_rate));
+        }
       }
+      m_iterations_run = iteration;
 
       if (num_inliers < m_min_num_output_inliers) {
         vw_throw( RANSACErr() << "RANSAC was unable to find a fit that matched the supplied data." );
@@ -302,7 +600,8 @@ namespace math {
       // For debugging
       VW_OUT(InfoMessage, "interest_point") << "\nRANSAC Summary:"     << std::endl;
       VW_OUT(InfoMessage, "interest_point") << "\tFit = "              << best_H      << std::endl;
-      VW_OUT(InfoMessage, "interest_point") << "\tInliers / Total  = " << num_inliers << " / " << p1.size() << "\n\n";
+      VW_OUT(InfoMessage, "interest_point") << "\tInliers / Total  = " << num_inliers << " / " << p1.size() << "\n";
+      VW_OUT(InfoMessage, "interest_point") << "\tIterations = "       << m_iterations_run << "\n\n";
       
       return best_H;
     }
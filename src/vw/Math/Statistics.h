@@ -27,6 +27,7 @@
 #include <vector>
 #include <algorithm>
 #include <fstream>
+#include <limits>
 
 #include <vw/Core/CompoundTypes.h>
 #include <vw/Core/TypeDeduction.h>
@@ -157,6 +158,7 @@ public: // Functions
   // Set up the histogram so values can be added
   void initialize(size_t num_bins, double min_value, double max_value);
 
+  int    get_num_bins  ()        const { return m_num_bins;         }
   double get_bin_width ()        const { return m_bin_width;        }
   double get_bin_center(int bin) const { return m_bin_centers[bin]; }
   double get_bin_value (int bin) const { return m_bin_values [bin]; }
@@ -187,6 +189,126 @@ private: // Variables
 }; // End class histogram
 
 
+/// Single pass accumulator of summary statistics which can be merged
+/// with other instances, so that blocks of an image can be reduced in
+/// parallel and then combined.
+/// - Count, min, max, mean and variance are exact (the variance is
+///   merged with the pairwise update of Chan et al.).
+/// - Values are also binned into a fixed number of bins to provide a
+///   histogram and approximate quantiles.  The bin width is a power of
+///   two and the bins are anchored at zero, so the bins of two
+///   accumulators always line up after coarsening the finer one.  The
+///   bins are widened as the value range grows; a quantile is accurate
+///   to within about 4*(max-min)/num_bins.
+/// - Non-finite values are ignored.
+/// - The variance is normalized by the number of values, not by one less.
+class SummaryAccumulator : public ReturnFixedType<void> {
+
+public: // Functions
+
+  SummaryAccumulator(size_t num_bins = 4096);
+
+  /// Add a single value.
+  void operator()(double value);
+
+  /// Fold in the values of another accumulator with the same number of bins.
+  void merge(SummaryAccumulator const& other);
+
+  size_t num_values() const { return m_num_values; }
+  double minimum () const;
+  double maximum () const;
+  double mean    () const;
+  double variance() const;
+  double stddev  () const { return std::sqrt(variance()); }
+
+  /// Approximate value below which the fraction q of the values lie.
+  double quantile(double q) const;
+
+  /// The histogram bins.  Bin i covers [bin_start(i), bin_start(i)+bin_width()).
+  size_t num_bins () const { return m_bins.size(); }
+  double bin_width() const { return std::ldexp(1.0, m_exponent); }
+  double bin_start(size_t bin) const { return double(m_first_bin + int64(bin)) * bin_width(); }
+  uint64 bin_value(size_t bin) const { return m_bins[bin]; }
+
+private: // Functions
+
+  int64 bin_index(double value) const {
+    double s = value * m_scale;
+    int64  b = int64(s);
+    return (s < double(b)) ? b-1 : b;
+  }
+
+  /// Re-bin so that [lo,hi] fits with slack, using a bin exponent of at least min_exponent.
+  void fit_range(double lo, double hi, int min_exponent);
+
+private: // Variables
+
+  size_t m_num_values;
+  double m_min, m_max, m_mean, m_m2;
+  int    m_exponent;  ///< Bin width is 2^m_exponent
+  double m_scale;     ///< 2^-m_exponent
+  int64  m_first_bin; ///< Index of m_bins[0] on the global bin grid
+  std::vector<uint64> m_bins;
+
+}; // End class SummaryAccumulator
+
+
+/// Mergeable quantile sketch (the KLL sketch of Karnin, Lang and
+/// Liberty), for percentiles of more values than can be stored.
+/// - Values are kept in levels of compactors.  A full level is sorted
+///   and every other value is promoted to the next level, where each
+///   value stands for twice as many inputs.
+/// - Memory is about 3*k values no matter how many are added, and a
+///   quantile is accurate to within about 1.7/k in rank, whatever the
+///   range or distribution of the values.  Use SummaryAccumulator when
+///   the values have a known, narrow range.
+/// - Count, min and max are exact, and quantile(0) and quantile(1)
+///   return the exact min and max.
+/// - Compaction choices come from an internal fixed-seed generator, so
+///   the same sequence of values and merges gives the same result.
+/// - Non-finite values are ignored.
+class QuantileSketch : public ReturnFixedType<void> {
+
+public: // Functions
+
+  QuantileSketch(size_t k = 256);
+
+  /// Add a single value.
+  void operator()(double value);
+
+  /// Fold in the values of another sketch with the same k.
+  void merge(QuantileSketch const& other);
+
+  size_t k         () const { return m_k; }
+  size_t num_values() const { return m_num_values; }
+  double minimum   () const;
+  double maximum   () const;
+
+  /// Approximate fraction of the values which are <= value.
+  double rank(double value) const;
+
+  /// Approximate value below which the fraction q of the values lie.
+  double quantile(double q) const;
+
+  /// The number of values held, which bounds the memory used.
+  size_t num_retained() const { return m_size; }
+
+private: // Functions
+
+  size_t capacity(size_t level) const;
+  void   grow();
+  void   compress();
+
+private: // Variables
+
+  size_t m_k, m_num_values, m_size, m_max_size;
+  double m_min, m_max;
+  uint32 m_random;
+  std::vector<std::vector<double> > m_levels; ///< Values in level h have weight 2^h
+
+}; // End class QuantileSketch
+
+
 
 
 
@@ -605,3 +605,313 @@ void Histogram::write_to_disk(std::string const& path) const {
   f.close();
 }
 
+
+
+//--------------------------------------------------------------------------
+// Class SummaryAccumulator
+
+namespace detail {
+  /// floor(bin / 2^shift) for shift >= 0.
+  inline int64 coarsen_bin(int64 bin, int shift) {
+    if (shift >= 63)
+      return (bin < 0) ? -1 : 0;
+    return (bin >= 0) ? (bin >> shift) : -((-(bin+1)) >> shift) - 1;
+  }
+}
+
+inline
+SummaryAccumulator::SummaryAccumulator(size_t num_bins)
+  : m_num_values(0), m_min(0), m_max(0), m_mean(0), m_m2(0),
+    m_exponent(0), m_scale(1.0), m_first_bin(0), m_bins(num_bins, 0) {
+  VW_ASSERT(num_bins >= 4, ArgumentErr() << "SummaryAccumulator: need at least four bins");
+}
+
+inline
+void SummaryAccumulator::fit_range(double lo, double hi, int min_exponent) {
+  const int64 n    = int64(m_bins.size());
+  const int64 half = n/2;
+
+  // Pick the finest bins for which the range fits in half of the bins,
+  // leaving slack on either side so that a slowly drifting range does
+  // not re-bin on every value.  The magnitude bound keeps the bin
+  // indices well inside an int64.
+  int    e   = std::max(min_exponent, -1000);
+  double mag = std::max(std::fabs(lo), std::fabs(hi));
+  if (hi > lo)
+    e = std::max(e, std::ilogb((hi - lo) / double(half)));
+  if (mag > 0)
+    e = std::max(e, std::ilogb(mag) - 60);
+  m_scale = std::ldexp(1.0, -e);
+  while (bin_index(hi) - bin_index(lo) >= half) {
+    ++e;
+    m_scale = std::ldexp(1.0, -e);
+  }
+
+  const int64 lo_bin = bin_index(lo);
+  const int64 first  = lo_bin - (n - (bin_index(hi) - lo_bin + 1)) / 2;
+
+  std::vector<uint64> bins(n, 0);
+  if (m_num_values > 0) {
+    const int shift = e - m_exponent;
+    for (int64 k = 0; k < n; ++k)
+      if (m_bins[k])
+        bins[detail::coarsen_bin(m_first_bin + k, shift) - first] += m_bins[k];
+  }
+  m_bins.swap(bins);
+  m_exponent  = e;
+  m_first_bin = first;
+}
+
+inline
+void SummaryAccumulator::operator()(double value) {
+  if (!std::isfinite(value))
+    return;
+
+  if (m_num_values == 0) {
+    m_min = m_max = value;
+    fit_range(value, value, std::numeric_limits<int>::min());
+  } else {
+    if (value < m_min) m_min = value;
+    if (value > m_max) m_max = value;
+  }
+
+  int64 bin = bin_index(value) - m_first_bin;
+  if (bin < 0 || bin >= int64(m_bins.size())) {
+    fit_range(m_min, m_max, m_exponent);
+    bin = bin_index(value) - m_first_bin;
+  }
+  ++m_bins[bin];
+
+  ++m_num_values;
+  double delta = value - m_mean;
+  m_mean += delta / double(m_num_values);
+  m_m2   += delta * (value - m_mean);
+}
+
+inline
+void SummaryAccumulator::merge(SummaryAccumulator const& other) {
+  VW_ASSERT(other.num_bins() == num_bins(),
+            ArgumentErr() << "SummaryAccumulator: cannot merge accumulators with different bin counts");
+  if (other.m_num_values == 0)
+    return;
+  if (m_num_values == 0) {
+    *this = other;
+    return;
+  }
+
+  double lo = std::min(m_min, other.m_min);
+  double hi = std::max(m_max, other.m_max);
+  fit_range(lo, hi, std::max(m_exponent, other.m_exponent));
+
+  const int shift = m_exponent - other.m_exponent;
+  for (size_t k = 0; k < other.m_bins.size(); ++k)
+    if (other.m_bins[k])
+      m_bins[detail::coarsen_bin(other.m_first_bin + int64(k), shift) - m_first_bin] += other.m_bins[k];
+
+  double na = double(m_num_values), nb = double(other.m_num_values), n = na + nb;
+  double delta = other.m_mean - m_mean;
+  m_mean += delta * nb / n;
+  m_m2   += other.m_m2 + delta * delta * na * nb / n;
+  m_num_values += other.m_num_values;
+  m_min = lo;
+  m_max = hi;
+}
+
+inline
+double SummaryAccumulator::minimum() const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "SummaryAccumulator: no valid samples");
+  return m_min;
+}
+
+inline
+double SummaryAccumulator::maximum() const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "SummaryAccumulator: no valid samples");
+  return m_max;
+}
+
+inline
+double SummaryAccumulator::mean() const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "SummaryAccumulator: no valid samples");
+  return m_mean;
+}
+
+inline
+double SummaryAccumulator::variance() const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "SummaryAccumulator: no valid samples");
+  return m_m2 / double(m_num_values);
+}
+
+inline
+double SummaryAccumulator::quantile(double q) const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "SummaryAccumulator: no valid samples");
+  VW_ASSERT(q >= 0 && q <= 1, ArgumentErr() << "SummaryAccumulator: illegal quantile request: " << q);
+
+  // Walk the cumulative counts and interpolate linearly inside the bin.
+  double target = q * double(m_num_values);
+  double count  = 0;
+  for (size_t k = 0; k < m_bins.size(); ++k) {
+    if (!m_bins[k])
+      continue;
+    double c = double(m_bins[k]);
+    if (count + c >= target) {
+      double value = bin_start(k) + (target - count) / c * bin_width();
+      return std::min(std::max(value, m_min), m_max);
+    }
+    count += c;
+  }
+  return m_max;
+}
+
+
+//--------------------------------------------------------------------------
+// Class QuantileSketch
+
+inline
+QuantileSketch::QuantileSketch(size_t k)
+  : m_k(k), m_num_values(0), m_size(0), m_max_size(0), m_min(0), m_max(0), m_random(1) {
+  VW_ASSERT(k >= 8, ArgumentErr() << "QuantileSketch: k must be at least 8");
+  grow();
+}
+
+inline
+size_t QuantileSketch::capacity(size_t level) const {
+  // Capacities shrink geometrically by 2/3 below the top level.
+  const size_t depth = m_levels.size() - level - 1;
+  return size_t(std::ceil(m_k * std::pow(2.0/3.0, double(depth)))) + 1;
+}
+
+inline
+void QuantileSketch::grow() {
+  m_levels.push_back(std::vector<double>());
+  m_max_size = 0;
+  for (size_t h = 0; h < m_levels.size(); ++h)
+    m_max_size += capacity(h);
+}
+
+inline
+void QuantileSketch::compress() {
+  for (size_t h = 0; h < m_levels.size(); ++h) {
+    if (m_levels[h].size() < capacity(h))
+      continue;
+    if (h + 1 == m_levels.size())
+      grow();
+    std::vector<double>& level_h = m_levels[h];
+    std::vector<double>& next    = m_levels[h+1];
+
+    // Promote every other value of the sorted level, starting at a
+    // random one of the first two.  An odd value out stays behind.
+    std::sort(level_h.begin(), level_h.end());
+    const size_t num_pairs = level_h.size() / 2;
+    m_random = m_random * 1664525u + 1013904223u;
+    const size_t offset = (m_random >> 31) & 1;
+    const size_t keep   = level_h.size() - 2*num_pairs;
+    for (size_t i = 0; i < num_pairs; ++i)
+      next.push_back(level_h[keep + 2*i + offset]);
+    level_h.resize(keep);
+
+    m_size = 0;
+    for (size_t l = 0; l < m_levels.size(); ++l)
+      m_size += m_levels[l].size();
+    if (m_size < m_max_size)
+      break;
+  }
+}
+
+inline
+void QuantileSketch::operator()(double value) {
+  if (!std::isfinite(value))
+    return;
+  if (m_num_values == 0) {
+    m_min = m_max = value;
+  } else {
+    if (value < m_min) m_min = value;
+    if (value > m_max) m_max = value;
+  }
+  ++m_num_values;
+  m_levels[0].push_back(value);
+  if (++m_size >= m_max_size)
+    compress();
+}
+
+inline
+void QuantileSketch::merge(QuantileSketch const& other) {
+  VW_ASSERT(other.m_k == m_k,
+            ArgumentErr() << "QuantileSketch: cannot merge sketches with different k");
+  if (other.m_num_values == 0)
+    return;
+  if (m_num_values == 0) {
+    m_min = other.m_min;
+    m_max = other.m_max;
+  } else {
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+  }
+  m_num_values += other.m_num_values;
+
+  while (m_levels.size() < other.m_levels.size())
+    grow();
+  for (size_t h = 0; h < other.m_levels.size(); ++h)
+    m_levels[h].insert(m_levels[h].end(), other.m_levels[h].begin(), other.m_levels[h].end());
+  m_size += other.m_size;
+  while (m_size >= m_max_size) {
+    const size_t before = m_size;
+    compress();
+    if (m_size == before)
+      break;
+  }
+}
+
+inline
+double QuantileSketch::minimum() const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "QuantileSketch: no valid samples");
+  return m_min;
+}
+
+inline
+double QuantileSketch::maximum() const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "QuantileSketch: no valid samples");
+  return m_max;
+}
+
+inline
+double QuantileSketch::rank(double value) const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "QuantileSketch: no valid samples");
+  double count = 0, total = 0;
+  for (size_t h = 0; h < m_levels.size(); ++h) {
+    const double weight = std::ldexp(1.0, int(h));
+    for (size_t i = 0; i < m_levels[h].size(); ++i)
+      if (m_levels[h][i] <= value)
+        count += weight;
+    total += weight * double(m_levels[h].size());
+  }
+  return count / total;
+}
+
+inline
+double QuantileSketch::quantile(double q) const {
+  VW_ASSERT(m_num_values, ArgumentErr() << "QuantileSketch: no valid samples");
+  VW_ASSERT(q >= 0 && q <= 1, ArgumentErr() << "QuantileSketch: illegal quantile request: " << q);
+  if (q == 0) return m_min;
+  if (q == 1) return m_max;
+
+  // Walk the weighted values in order.
+  std::vector<std::pair<double, double> > items;
+  items.reserve(m_size);
+  double total = 0;
+  for (size_t h = 0; h < m_levels.size(); ++h) {
+    const double weight = std::ldexp(1.0, int(h));
+    for (size_t i = 0; i < m_levels[h].size(); ++i)
+      items.push_back(std::make_pair(m_levels[h][i], weight));
+    total += weight * double(m_levels[h].size());
+  }
+  std::sort(items.begin(), items.end());
+
+  const double target = q * total;
+  double count = 0;
+  for (size_t i = 0; i < items.size(); ++i) {
+    count += items[i].second;
+    if (count >= target)
+      return items[i].first;
+  }
+  return m_max;
+}
@@ -20,6 +20,7 @@
 #include <gtest/gtest_VW.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/ConjugateGradient.h>
+#include <test/Helpers.h>
 
 using namespace vw;
 using namespace vw::math;
@@ -62,3 +63,47 @@ TEST( ConjugateGradient, ConjugateGradient ) {
   EXPECT_NEAR(result[0], 0.1962, 1e-3);
   EXPECT_NEAR(result[1], 0.4846, 1e-3);
 }
+
+namespace {
+  // The 1D Laplacian with a stronger diagonal.
+  struct LaplacianOp {
+    void operator()( Vector<double> const& x, Vector<double>& y ) const {
+      const size_t n = x.size();
+      for ( size_t i = 0; i < n; ++i )
+        y[i] = (3.0 + i % 4) * x[i] - ( i > 0 ? x[i-1] : 0 ) - ( i + 1 < n ? x[i+1] : 0 );
+    }
+  };
+  struct JacobiPrecond {
+    void operator()( Vector<double> const& r, Vector<double>& z ) const {
+      for ( size_t i = 0; i < r.size(); ++i )
+        z[i] = r[i] / (3.0 + i % 4);
+    }
+  };
+}
+
+TEST( ConjugateGradient, PreconditionedLinear ) {
+  const size_t n = 200;
+  Vector<double> expected( n ), b( n ), x;
+  for ( size_t i = 0; i < n; ++i )
+    expected[i] = sin( 0.1 * i );
+  LaplacianOp op;
+  op( expected, b );
+
+  int iterations = preconditioned_conjugate_gradient( op, JacobiPrecond(), b, x, 1e-12, 500 );
+  EXPECT_GT( iterations, 0 );
+  EXPECT_LT( iterations, 100 );
+  EXPECT_VECTOR_NEAR( expected, x, 1e-9 );
+
+  // Starting from the solution takes no iterations.
+  EXPECT_EQ( 0, preconditioned_conjugate_gradient( op, JacobiPrecond(), b, x, 1e-10, 500 ) );
+
+  // A loose tolerance and the truncated Newton rule stop early.
+  Vector<double> loose, truncated;
+  int loose_iterations = preconditioned_conjugate_gradient( op, JacobiPrecond(), b, loose, 1e-2, 500 );
+  EXPECT_LT( loose_iterations, iterations );
+  Vector<double> product( n );
+  op( loose, product );
+  EXPECT_LE( norm_2( b - product ), 1e-2 * norm_2( b ) );
+  int truncated_iterations = preconditioned_conjugate_gradient( op, JacobiPrecond(), b, truncated, 0, 500, 0.1 );
+  EXPECT_LT( truncated_iterations, iterations );
+}
@@ -0,0 +1,135 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <vw/Core/Exception.h>
+#include <vw/Math/FFT.h>
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+
+  std::vector<double> random_values( size_t n ) {
+    std::vector<double> values( n );
+    for ( size_t i = 0; i < n; ++i )
+      values[i] = double( rand() % 1000 ) / 100.0 - 5.0;
+    return values;
+  }
+
+  // The valid part of a direct convolution, as the convolvers compute it.
+  std::vector<double> direct_convolution( std::vector<double> const& src, size_t cols, size_t rows,
+                                          std::vector<double> const& kernel, size_t kc, size_t kr ) {
+    const size_t oc = cols - kc + 1, orows = rows - kr + 1;
+    std::vector<double> out( oc * orows );
+    for ( size_t y = 0; y < orows; ++y )
+      for ( size_t x = 0; x < oc; ++x ) {
+        double sum = 0;
+        for ( size_t j = 0; j < kr; ++j )
+          for ( size_t i = 0; i < kc; ++i )
+            sum += src[(y+j)*cols + x+i] * kernel[(kr-1-j)*kc + kc-1-i];
+        out[y*oc + x] = sum;
+      }
+    return out;
+  }
+
+}
+
+TEST( FFT, Size ) {
+  EXPECT_EQ( 1u,   fft_size( 1 ) );
+  EXPECT_EQ( 64u,  fft_size( 64 ) );
+  EXPECT_EQ( 128u, fft_size( 65 ) );
+
+  // Short outputs take one block of the whole convolution; long ones
+  // are split into blocks a few times the kernel.
+  EXPECT_EQ( 16u, fft_block_size( 5, 10 ) );
+  size_t block = fft_block_size( 33, 10000 );
+  EXPECT_GE( block, 64u );
+  EXPECT_LE( block, 1024u );
+  EXPECT_THROW( FFTPlan plan( 12 ), ArgumentErr );
+}
+
+TEST( FFT, Transform ) {
+  const size_t n = 32;
+  std::vector<std::complex<double> > data( n ), orig;
+  for ( size_t i = 0; i < n; ++i )
+    data[i] = std::complex<double>( std::cos( 0.3 * i ), double( i % 5 ) );
+  orig = data;
+
+  FFTPlan const& plan = fft_plan( n );
+  EXPECT_EQ( &plan, &fft_plan( n ) );
+  plan.forward( &data[0] );
+  for ( size_t k = 0; k < n; k += 7 ) {
+    std::complex<double> sum;
+    for ( size_t i = 0; i < n; ++i )
+      sum += orig[i] * std::polar( 1.0, -2.0 * M_PI * double( k * i ) / double( n ) );
+    EXPECT_NEAR( sum.real(), data[k].real(), 1e-9 );
+    EXPECT_NEAR( sum.imag(), data[k].imag(), 1e-9 );
+  }
+
+  plan.inverse( &data[0] );
+  for ( size_t i = 0; i < n; ++i ) {
+    EXPECT_NEAR( orig[i].real(), data[i].real(), 1e-12 );
+    EXPECT_NEAR( orig[i].imag(), data[i].imag(), 1e-12 );
+  }
+}
+
+TEST( FFT, Convolve1D ) {
+  const size_t n = 300, stride = 2;
+  std::vector<double> kernel = random_values( 21 );
+  std::vector<double> src = random_values( n * stride );
+  std::vector<double> a( n ), b( n );
+  for ( size_t i = 0; i < n; ++i ) {
+    a[i] = src[i*stride];
+    b[i] = src[i*stride+1];
+  }
+  std::vector<double> expected_a = direct_convolution( a, n, 1, kernel, kernel.size(), 1 ),
+                      expected_b = direct_convolution( b, n, 1, kernel, kernel.size(), 1 );
+
+  // Several blocks, both sequences of a pair taken at once.
+  FFTConvolver1D convolver( kernel, expected_a.size() );
+  std::vector<double> out_a( expected_a.size() ), out_b( expected_b.size() );
+  convolver( &src[0], &src[1], n, stride, &out_a[0], &out_b[0] );
+  for ( size_t i = 0; i < out_a.size(); ++i ) {
+    EXPECT_NEAR( expected_a[i], out_a[i], 1e-9 );
+    EXPECT_NEAR( expected_b[i], out_b[i], 1e-9 );
+  }
+
+  convolver( &a[0], 0, n, 1, &out_a[0], 0 );
+  for ( size_t i = 0; i < out_a.size(); ++i )
+    EXPECT_NEAR( expected_a[i], out_a[i], 1e-9 );
+}
+
+TEST( FFT, Convolve2D ) {
+  const size_t cols = 150, rows = 97, kc = 13, kr = 9;
+  std::vector<double> kernel = random_values( kc * kr );
+  std::vector<double> a = random_values( cols * rows ), b = random_values( cols * rows );
+  std::vector<double> expected_a = direct_convolution( a, cols, rows, kernel, kc, kr ),
+                      expected_b = direct_convolution( b, cols, rows, kernel, kc, kr );
+
+  FFTConvolver2D convolver( kernel, kc, kr, cols, rows );
+  std::vector<double> out_a( expected_a.size() ), out_b( expected_b.size() );
+  convolver( &a[0], &b[0], &out_a[0], &out_b[0] );
+  for ( size_t i = 0; i < out_a.size(); ++i ) {
+    EXPECT_NEAR( expected_a[i], out_a[i], 1e-8 );
+    EXPECT_NEAR( expected_b[i], out_b[i], 1e-8 );
+  }
+}
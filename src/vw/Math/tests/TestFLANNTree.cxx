@@ -19,10 +19,14 @@
 #include <vector>
 #include <gtest/gtest_VW.h>
 #include <vw/Math/FLANNTree.h>
+#include <test/Helpers.h>
+
+#include <boost/filesystem/operations.hpp>
 
 using std::vector;
 using namespace vw;
 using namespace vw::math;
+using namespace vw::test;
 
 
 
@@ -57,3 +61,39 @@ TEST(FLANNTree, boundsLimiting) {
   }
 
 }
+
+
+// An index saved to the cache is reused only for the same features.
+TEST(FLANNTree, cachedIndex) {
+  UnlinkName cache_dir("flann_cache");
+
+  Matrix<float> features(40, 3);
+  for (int i=0; i<40; ++i)
+    for (int j=0; j<3; ++j)
+      features(i, j) = float((i*7 + j*13) % 23);
+
+  math::FLANNTree<float> built;
+  built.load_match_data(features, FLANN_DistType_L2, cache_dir);
+  const std::string filename = built.index_filename(cache_dir);
+  EXPECT_TRUE(boost::filesystem::exists(filename));
+
+  math::FLANNTree<float> loaded;
+  loaded.load_match_data(features, FLANN_DistType_L2, cache_dir);
+  EXPECT_EQ(built.features_hash(), loaded.features_hash());
+  EXPECT_EQ(40u, loaded.size1());
+  EXPECT_EQ(3u,  loaded.size2());
+
+  Vector<int>    indices1, indices2;
+  Vector<double> distance1, distance2;
+  built .knn_search(select_row(features, 5), indices1, distance1, 3);
+  loaded.knn_search(select_row(features, 5), indices2, distance2, 3);
+  EXPECT_EQ(indices1, indices2);
+  EXPECT_EQ(5, indices2[0]);
+
+  // Changing any feature changes the name of the index.
+  features(39, 2) += 1;
+  math::FLANNTree<float> changed;
+  changed.load_match_data(features, FLANN_DistType_L2, cache_dir);
+  EXPECT_NE(filename, changed.index_filename(cache_dir));
+  EXPECT_TRUE(boost::filesystem::exists(changed.index_filename(cache_dir)));
+}
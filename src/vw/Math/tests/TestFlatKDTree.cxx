@@ -0,0 +1,121 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <vw/Math/FlatKDTree.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+  std::vector<Vector3> random_points( size_t count, boost::random::mt19937& gen ) {
+    boost::random::uniform_real_distribution<double> dist( -100, 100 );
+    std::vector<Vector3> points( count );
+    for ( size_t i = 0; i < count; i++ )
+      points[i] = Vector3( dist(gen), dist(gen), 0.1*dist(gen) );
+    return points;
+  }
+
+  // The k nearest squared distances, by brute force.
+  std::vector<double> brute_force( std::vector<Vector3> const& points, Vector3 const& query, size_t k ) {
+    std::vector<double> dists( points.size() );
+    for ( size_t i = 0; i < points.size(); i++ )
+      dists[i] = norm_2_sqr( points[i] - query );
+    std::sort( dists.begin(), dists.end() );
+    dists.resize( std::min( k, dists.size() ) );
+    return dists;
+  }
+}
+
+TEST( FlatKDTree, KnnSearch ) {
+  boost::random::mt19937 gen( 42 );
+  std::vector<Vector3> points = random_points( 5000, gen ), queries = random_points( 200, gen );
+
+  FlatKDTree<double, 3> tree( 8 );
+  tree.build( points, 4 );
+  EXPECT_EQ( points.size(), tree.size() );
+
+  std::vector<size_t> indices;
+  std::vector<double> sq_dists;
+  for ( size_t q = 0; q < queries.size(); q++ ) {
+    ASSERT_EQ( 5u, tree.knn_search( queries[q], 5, indices, sq_dists ) );
+    std::vector<double> expected = brute_force( points, queries[q], 5 );
+    for ( size_t i = 0; i < 5; i++ ) {
+      EXPECT_DOUBLE_EQ( expected[i], sq_dists[i] );
+      EXPECT_DOUBLE_EQ( norm_2_sqr( points[indices[i]] - queries[q] ), sq_dists[i] );
+    }
+  }
+
+  // The tree is the same however many threads build it.
+  FlatKDTree<double, 3> serial( 8 );
+  serial.build( points, 1 );
+  std::vector<size_t> serial_indices;
+  std::vector<double> serial_dists;
+  serial.knn_search( queries[0], 5, serial_indices, serial_dists );
+  tree.knn_search( queries[0], 5, indices, sq_dists );
+  EXPECT_EQ( serial_indices, indices );
+}
+
+TEST( FlatKDTree, BatchSearch ) {
+  boost::random::mt19937 gen( 7 );
+  std::vector<Vector3> points = random_points( 3000, gen ), queries = random_points( 2000, gen );
+  FlatKDTree<double, 3> tree;
+  tree.build( points );
+
+  std::vector<size_t> indices1, indices4, single;
+  std::vector<double> dists1, dists4, single_dists;
+  tree.knn_search( queries, 3, indices1, dists1, 1 );
+  tree.knn_search( queries, 3, indices4, dists4, 4 );
+  ASSERT_EQ( 6000u, indices1.size() );
+  EXPECT_EQ( indices1, indices4 );
+  EXPECT_EQ( dists1, dists4 );
+  for ( size_t q = 0; q < queries.size(); q += 97 ) {
+    tree.knn_search( queries[q], 3, single, single_dists );
+    for ( size_t i = 0; i < 3; i++ )
+      EXPECT_EQ( single[i], indices4[3*q + i] );
+  }
+}
+
+TEST( FlatKDTree, FewPoints ) {
+  FlatKDTree<float, 2> tree;
+  std::vector<size_t> indices;
+  std::vector<float> sq_dists;
+
+  std::vector<Vector2f> points;
+  tree.build( points );
+  EXPECT_EQ( 0u, tree.knn_search( Vector2f( 1, 1 ), 3, indices, sq_dists ) );
+
+  points.push_back( Vector2f( 0, 0 ) );
+  points.push_back( Vector2f( 3, 4 ) );
+  tree.build( points );
+  ASSERT_EQ( 2u, tree.knn_search( Vector2f( 3, 3 ), 3, indices, sq_dists ) );
+  EXPECT_EQ( 1u, indices[0] );
+  EXPECT_EQ( 0u, indices[1] );
+  EXPECT_FLOAT_EQ( 1, sq_dists[0] );
+  EXPECT_FLOAT_EQ( 18, sq_dists[1] );
+
+  // Batches are padded out to k.
+  std::vector<Vector2f> queries( 1, Vector2f( 0, 1 ) );
+  tree.knn_search( queries, 3, indices, sq_dists );
+  ASSERT_EQ( 3u, indices.size() );
+  EXPECT_EQ( 0u, indices[0] );
+  EXPECT_EQ( (FlatKDTree<float, 2>::invalid_index()), indices[2] );
+}
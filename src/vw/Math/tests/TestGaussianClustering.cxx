@@ -94,3 +94,64 @@ TEST( GaussianClustering, ClusterOf2_1D_no_outliers ) {
   EXPECT_NEAR( 2, c[0].first[0], 1 );
   EXPECT_NEAR( 2, c[1].first[0], 1 );
 }
+
+namespace {
+  // Three well separated 2D clusters of n samples each, from a fixed
+  // sequence so every run sees the same data.
+  std::vector<Vector2> three_clusters( size_t n ) {
+    std::vector<Vector2> samples;
+    const Vector2 centers[3] = { Vector2(0,0), Vector2(15,10), Vector2(30,20) };
+    uint32 state = 12345;
+    for ( size_t i = 0; i < 3*n; i++ ) {
+      double u[4];
+      for ( size_t k = 0; k < 4; k++ ) {
+        state = state * 1664525u + 1013904223u;
+        u[k] = ( state >> 8 ) / double( 1 << 24 );
+      }
+      // Sums of uniforms are close enough to normal for this.
+      samples.push_back( centers[i % 3] + Vector2( 2*(u[0] + u[1] - 1), 2*(u[2] + u[3] - 1) ) );
+    }
+    return samples;
+  }
+}
+
+TEST( GaussianClustering, ThreadsGiveSameResult ) {
+  std::vector<Vector2> samples = three_clusters( 100000 );
+  Clusters single =
+    gaussian_clustering<std::vector<Vector2>, 2>( samples.begin(), samples.end(), 3, 1 );
+  Clusters multi =
+    gaussian_clustering<std::vector<Vector2>, 2>( samples.begin(), samples.end(), 3, 4 );
+  ASSERT_EQ( 3u, single.size() );
+  ASSERT_EQ( 3u, multi.size() );
+  for ( size_t c = 0; c < 3; c++ ) {
+    EXPECT_VECTOR_DOUBLE_EQ( single[c].first,  multi[c].first  );
+    EXPECT_VECTOR_DOUBLE_EQ( single[c].second, multi[c].second );
+  }
+  EXPECT_VECTOR_NEAR( Vector2(0,0),   single[0].first, 0.05 );
+  EXPECT_VECTOR_NEAR( Vector2(15,10), single[1].first, 0.05 );
+  EXPECT_VECTOR_NEAR( Vector2(30,20), single[2].first, 0.05 );
+  EXPECT_VECTOR_NEAR( Vector2(2./3,2./3), single[0].second, 0.05 );
+}
+
+TEST( GaussianClustering, MiniBatch ) {
+  std::vector<Vector2> samples = three_clusters( 50000 );
+  Clusters full =
+    gaussian_clustering<std::vector<Vector2>, 2>( samples.begin(), samples.end(), 3 );
+  Clusters batch =
+    gaussian_clustering<std::vector<Vector2>, 2>( samples.begin(), samples.end(), 3, 0, 3000 );
+  ASSERT_EQ( 3u, batch.size() );
+  for ( size_t c = 0; c < 3; c++ ) {
+    EXPECT_VECTOR_NEAR( full[c].first,  batch[c].first,  1e-3 );
+    EXPECT_VECTOR_NEAR( full[c].second, batch[c].second, 1e-3 );
+  }
+
+  std::vector<double> scalars;
+  for ( size_t i = 0; i < samples.size(); i++ )
+    scalars.push_back( samples[i][0] );
+  Clusters scalar =
+    gaussian_clustering<std::vector<double> >( scalars.begin(), scalars.end(), 3, 0, 1000 );
+  ASSERT_EQ( 3u, scalar.size() );
+  EXPECT_NEAR( 0,  scalar[0].first[0], 0.05 );
+  EXPECT_NEAR( 15, scalar[1].first[0], 0.05 );
+  EXPECT_NEAR( 30, scalar[2].first[0], 0.05 );
+}
@@ -21,6 +21,7 @@
 #include <vw/Math/Matrix.h>
 #include <vw/Math/Geometry.h>
 #include <vw/Math/EulerAngles.h>
+#include <vw/Math/RANSAC.h>
 
 using namespace vw;
 using namespace vw::math;
@@ -443,3 +444,110 @@ TEST(Geometry, TranslationFittingFunctorN) {
   // similarity.
   EXPECT_MATRIX_NEAR( S, TranslationFittingFunctorN<3>()(p1,p2), 1.8e-15 );
 }
+
+TEST(Geometry, ProsacSampling) {
+  Matrix3x3 S;
+  S(0,0) =  1.5*cos(0.3); S(0,1) = 1.5*sin(0.3); S(0,2) = 12;
+  S(1,0) = -1.5*sin(0.3); S(1,1) = 1.5*cos(0.3); S(1,2) = -7;
+  S(2,2) = 1;
+
+  // One in five matches is an inlier.  The sample order ranks the
+  // inliers first, as sorting matches by their ratio would.
+  std::srand(7);
+  std::vector<Vector3> p1, p2;
+  std::vector<size_t> inlier_order, outlier_order;
+  for (size_t i = 0; i < 200; ++i) {
+    Vector3 p(std::rand() % 1000, std::rand() % 1000, 1);
+    p1.push_back(p);
+    if (i % 5 == 3) {
+      p2.push_back(S*p);
+      inlier_order.push_back(i);
+    } else {
+      p2.push_back(Vector3(std::rand() % 1000, std::rand() % 1000, 1));
+      outlier_order.push_back(i);
+    }
+  }
+  std::vector<size_t> order = inlier_order;
+  order.insert(order.end(), outlier_order.begin(), outlier_order.end());
+
+  // Too few iterations for uniform sampling to be reliable.  PROSAC
+  // draws its first samples from the best ranked matches.
+  RandomSampleConsensus<SimilarityFittingFunctor, InterestPointErrorMetric>
+    ransac( SimilarityFittingFunctor(), InterestPointErrorMetric(), 5, 1.0, 40 );
+  ransac.set_sample_order(order);
+  Matrix3x3 H = ransac(p1, p2);
+  EXPECT_MATRIX_NEAR( S, H, 1e-6 );
+  EXPECT_EQ( inlier_order, ransac.inlier_indices(H, p1, p2) );
+
+  std::vector<size_t> short_order(order.begin(), order.begin()+10);
+  ransac.set_sample_order(short_order);
+  EXPECT_THROW( ransac.attempt_ransac(p1, p2), RANSACErr );
+}
+
+namespace {
+  // Matches under a similarity S, of which one in inlier_period is an
+  // inlier and the rest are random.
+  void make_matches(Matrix3x3 const& S, size_t count, size_t inlier_period,
+                    std::vector<Vector3>& p1, std::vector<Vector3>& p2,
+                    std::vector<size_t>& inliers) {
+    std::srand(11);
+    for (size_t i = 0; i < count; ++i) {
+      Vector3 p(std::rand() % 1000, std::rand() % 1000, 1);
+      p1.push_back(p);
+      if (i % inlier_period == 0) {
+        p2.push_back(S*p);
+        inliers.push_back(i);
+      } else {
+        p2.push_back(Vector3(std::rand() % 1000, std::rand() % 1000, 1));
+      }
+    }
+  }
+}
+
+TEST(Geometry, RansacThreadsSprtAndConfidence) {
+  Matrix3x3 S;
+  S(0,0) =  0.9*cos(1.1); S(0,1) = 0.9*sin(1.1); S(0,2) = -40;
+  S(1,0) = -0.9*sin(1.1); S(1,1) = 0.9*cos(1.1); S(1,2) = 25;
+  S(2,2) = 1;
+  std::vector<Vector3> p1, p2;
+  std::vector<size_t> inliers;
+  make_matches(S, 2000, 3, p1, p2, inliers);
+
+  typedef RandomSampleConsensus<SimilarityFittingFunctor, InterestPointErrorMetric> Ransac;
+  SimilarityFittingFunctor fit;
+  InterestPointErrorMetric error;
+
+  // The thread count does not change the result.
+  Ransac serial(fit, error, 200, 1.0, 500);
+  std::srand(3);
+  Matrix3x3 H1 = serial(p1, p2);
+  Ransac parallel(fit, error, 200, 1.0, 500);
+  parallel.set_num_threads(4);
+  std::srand(3);
+  Matrix3x3 H4 = parallel(p1, p2);
+  EXPECT_MATRIX_NEAR( S, H1, 1e-6 );
+  EXPECT_MATRIX_DOUBLE_EQ( H1, H4 );
+  EXPECT_EQ( 200, serial.iterations_run() );
+  EXPECT_EQ( 200, parallel.iterations_run() );
+
+  // With a third of the data inliers and two data per sample, 39
+  // iterations draw an all-inlier sample with 99% confidence.
+  Ransac adaptive(fit, error, 1000, 1.0, 500);
+  adaptive.set_confidence(0.99);
+  Matrix3x3 H = adaptive(p1, p2);
+  EXPECT_MATRIX_NEAR( S, H, 1e-6 );
+  EXPECT_LT( adaptive.iterations_run(), 1000 );
+  EXPECT_EQ( inliers, adaptive.inlier_indices(H, p1, p2) );
+
+  // The SPRT only rejects models, it does not change the best one.
+  Ransac sprt(fit, error, 1000, 1.0, 500);
+  sprt.set_confidence(0.99);
+  sprt.set_sprt(true);
+  sprt.set_num_threads(4);
+  H = sprt(p1, p2);
+  EXPECT_MATRIX_NEAR( S, H, 1e-6 );
+  EXPECT_LT( sprt.iterations_run(), 1000 );
+  EXPECT_EQ( inliers, sprt.inlier_indices(H, p1, p2) );
+
+  EXPECT_THROW( sprt.set_confidence(1.0), ArgumentErr );
+}
@@ -96,3 +96,52 @@ TEST(LevenbergMarquardt, levenberg_marquardt) {
   EXPECT_EQ(vw::math::optimization::eConvergedRelTolerance, status);
   EXPECT_VECTOR_NEAR( expected_best, best, 1e-5 );
 }
+
+// Fits an exponential decay a*exp(-b*t) to samples at t = 0 .. 3,
+// where each problem has its own time offset.
+struct TestDecayModel : public LeastSquaresModelBaseFixed<TestDecayModel, 2, 4> {
+  typedef Vector2 domain_type;
+  typedef Vector4 result_type;
+  typedef Matrix<double, 4, 2> jacobian_type;
+
+  double m_offset;
+  TestDecayModel( double offset = 0 ) : m_offset(offset) {}
+
+  inline result_type operator()( domain_type const& x ) const {
+    result_type h;
+    for ( size_t t = 0; t < 4; t++ )
+      h[t] = x[0] * exp( -x[1] * ( t + m_offset ) );
+    return h;
+  }
+};
+
+TEST(LevenbergMarquardt, batch) {
+  const size_t num_problems = 1000;
+  std::vector<TestDecayModel> models;
+  std::vector<Vector2> seeds, truth;
+  std::vector<Vector4> observations;
+  for ( size_t i = 0; i < num_problems; i++ ) {
+    models.push_back( TestDecayModel( 0.001 * i ) );
+    truth.push_back( Vector2( 1.0 + 0.002 * i, 0.2 + 0.0005 * i ) );
+    seeds.push_back( truth.back() + Vector2( 0.3, -0.1 ) );
+    observations.push_back( models.back()( truth.back() ) );
+  }
+
+  std::vector<int> status, serial_status;
+  std::vector<Vector2> serial =
+    levenberg_marquardt_batch( models, seeds, observations, serial_status, 1e-16, 1e-16, 100, 1 );
+  std::vector<Vector2> parallel =
+    levenberg_marquardt_batch( models, seeds, observations, status, 1e-16, 1e-16, 100, 4 );
+  ASSERT_EQ( num_problems, parallel.size() );
+  ASSERT_EQ( num_problems, status.size() );
+
+  for ( size_t i = 0; i < num_problems; i++ ) {
+    EXPECT_VECTOR_NEAR( truth[i], parallel[i], 1e-6 );
+    EXPECT_VECTOR_DOUBLE_EQ( serial[i], parallel[i] );
+    EXPECT_EQ( serial_status[i], status[i] );
+    EXPECT_NE( optimization::eDidNotConverge, status[i] );
+  }
+
+  observations.pop_back();
+  EXPECT_THROW( levenberg_marquardt_batch( models, seeds, observations, status ), ArgumentErr );
+}
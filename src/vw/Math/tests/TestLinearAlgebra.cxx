@@ -639,6 +639,24 @@ TEST(LinearAlgebra, Static) {
   EXPECT_NEAR( -9527./90735,   x(2), 1e-6 );
 }
 
+TEST(LinearAlgebra, SolveFixedSize) {
+  Matrix<double,6,6> A;
+  Vector<double,6> b;
+  for ( size_t i=0; i<6; ++i ) {
+    b(i) = cos( 2.0*i );
+    for ( size_t j=0; j<6; ++j )
+      A(i,j) = sin( 1.0 + 3.0*i*j + 1.7*j );
+  }
+  Matrix<double> dA = A;
+  Vector<double> db = b;
+
+  Vector<double,6> x = solve( A, b );
+  EXPECT_VECTOR_NEAR( solve( dA, db ), x, 1e-10 );
+  EXPECT_VECTOR_NEAR( b, A*x, 1e-10 );
+
+  EXPECT_THROW( solve( Matrix<double,4,4>(), Vector<double,4>() ), ArgumentErr );
+}
+
 TEST(LinearAlgebra, SymmetricStatic) {
   Matrix<float,3,3> A_;
   A_(0,0) = 81; A_(0,1) = 91; A_(0,2) = 27;
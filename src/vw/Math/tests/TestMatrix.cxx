@@ -19,9 +19,37 @@
 // TestMatrix.h
 #include <gtest/gtest_VW.h>
 #include <vw/Math/Matrix.h>
+#include <test/Helpers.h>
 
 using namespace vw;
 
+namespace {
+  // A well conditioned matrix with no zero entries.
+  template <size_t RowsN, size_t ColsN>
+  Matrix<double,RowsN,ColsN> test_matrix( double seed ) {
+    Matrix<double,RowsN,ColsN> m;
+    for ( size_t i=0; i<RowsN; ++i )
+      for ( size_t j=0; j<ColsN; ++j )
+        m(i,j) = sin( seed + 3.0*i + 1.7*j ) + ( i == j ? 4.0 : 0.0 );
+    return m;
+  }
+
+  // Checks the fixed-size kernels against the general expression
+  // templates.
+  template <size_t DimN>
+  void check_fixed_kernels() {
+    Matrix<double,DimN,DimN> a = test_matrix<DimN,DimN>(0.5), b = test_matrix<DimN,DimN>(1.5);
+    Matrix<double> da = a, db = b;
+    Vector<double,DimN> v = select_col( b, 0 );
+    Vector<double> dv = v;
+
+    EXPECT_MATRIX_NEAR( da*db, a*b, 1e-12 );
+    EXPECT_VECTOR_NEAR( da*dv, a*v, 1e-12 );
+    EXPECT_MATRIX_NEAR( inverse(da), inverse(a), 1e-12 );
+    EXPECT_MATRIX_NEAR( identity_matrix<DimN>(), a*inverse(a), 1e-12 );
+  }
+}
+
 TEST(Matrix, Static) {
   // Default constructor
   Matrix<float,2,3> m1;
@@ -400,7 +428,9 @@ TEST(Matrix, Products) {
   EXPECT_EQ( 22, r7(1,1) );
 
   // Matrix*Matrix self-assignment (no temporary)
-  Matrix2x2f r8 = m;
+  // (A fixed-size product is evaluated eagerly, so this needs a
+  // dynamic matrix to alias.)
+  Matrix<float> r8 = m;
   r8 = no_tmp( r8*r8 );
   ASSERT_EQ( 2u, r8.rows() );
   ASSERT_EQ( 2u, r8.cols() );
@@ -468,6 +498,23 @@ TEST(Matrix, Inverse) {
   EXPECT_FLOAT_EQ(  -3.0f / -15.0f , i2(2,2) );
 }
 
+TEST(Matrix, FixedSizeKernels) {
+  check_fixed_kernels<2>();
+  check_fixed_kernels<3>();
+  check_fixed_kernels<4>();
+  check_fixed_kernels<6>();
+
+  Matrix<double,2,3> a = test_matrix<2,3>(0.25);
+  Matrix<double,3,4> b = test_matrix<3,4>(0.75);
+  Matrix<double> da = a, db = b;
+  Matrix<double,2,4> c = a*b;
+  EXPECT_MATRIX_NEAR( da*db, c, 1e-12 );
+
+  Matrix<double,4,4> singular;
+  EXPECT_THROW( inverse( singular ), MathErr );
+  EXPECT_THROW( inverse( Matrix3x3() ), MathErr );
+}
+
 TEST(Matrix, IndexingIterator) {
   typedef Matrix2x2 Mat;
   typedef math::IndexingMatrixIterator<Mat> Iter;
@@ -0,0 +1,144 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <vw/Math/MinimumSpanningTree.h>
+#include <vw/Math/DisjointSet.h>
+
+#include <algorithm>
+
+using namespace vw;
+using namespace vw::math;
+
+namespace {
+
+  // A random graph with few distinct costs, so ties are common.
+  void random_graph( size_t num_nodes, size_t num_edges, std::vector<int>& node1,
+                     std::vector<int>& node2, std::vector<double>& cost ) {
+    node1.resize( num_edges );
+    node2.resize( num_edges );
+    cost.resize( num_edges );
+    unsigned seed = 12345;
+    for ( size_t i = 0; i < num_edges; i++ ) {
+      seed = seed * 1103515245 + 12345;
+      node1[i] = (seed >> 8) % num_nodes;
+      seed = seed * 1103515245 + 12345;
+      node2[i] = (seed >> 8) % num_nodes;
+      seed = seed * 1103515245 + 12345;
+      cost[i] = (seed >> 8) % 97;
+    }
+  }
+
+  struct IndexOrder {
+    std::vector<double> const& cost;
+    IndexOrder( std::vector<double> const& cost ) : cost(cost) {}
+    bool operator()( size_t a, size_t b ) const {
+      return cost[a] < cost[b] || (cost[a] == cost[b] && a < b);
+    }
+  };
+
+  // Plain Kruskal, for reference.
+  std::vector<size_t> kruskal( size_t num_nodes, std::vector<int> const& node1,
+                               std::vector<int> const& node2, std::vector<double> const& cost ) {
+    std::vector<size_t> order( cost.size() ), forest;
+    for ( size_t i = 0; i < order.size(); i++ )
+      order[i] = i;
+    std::sort( order.begin(), order.end(), IndexOrder( cost ) );
+    FlatDisjointSet sets( num_nodes );
+    for ( size_t i = 0; i < order.size(); i++ )
+      if ( sets.combine( node1[order[i]], node2[order[i]] ) )
+        forest.push_back( order[i] );
+    return forest;
+  }
+
+  struct Edge : public EdgePrimitive {
+    int n1, n2;
+    double c;
+    Edge( int n1, int n2, double c ) : n1(n1), n2(n2), c(c) {}
+    const int &node1() const { return n1; }
+    const int &node2() const { return n2; }
+    const double &cost() const { return c; }
+  };
+
+  struct RecordEdges : public EdgePrimitiveFunctor {
+    std::vector<std::pair<EdgePrimitive*, int> > visits;
+    void operator()( EdgePrimitive *prim, int node_toward_root ) {
+      visits.push_back( std::make_pair( prim, node_toward_root ) );
+    }
+  };
+}
+
+TEST( MinimumSpanningTree, FlatDisjointSet ) {
+  FlatDisjointSet sets( 6 );
+  EXPECT_TRUE ( sets.combine( 0, 1 ) );
+  EXPECT_TRUE ( sets.combine( 2, 3 ) );
+  EXPECT_FALSE( sets.combine( 1, 0 ) );
+  EXPECT_TRUE ( sets.combine( 3, 1 ) );
+  EXPECT_FALSE( sets.combine( 0, 2 ) );
+  EXPECT_EQ( sets.find_root(0), sets.find(3) );
+  EXPECT_NE( sets.find(4), sets.find(5) );
+  EXPECT_NE( sets.find(0), sets.find(4) );
+}
+
+TEST( MinimumSpanningTree, MatchesKruskal ) {
+  // The second graph is too sparse to be connected.
+  size_t sizes[2][2] = { { 2000, 60000 }, { 5000, 3000 } };
+  for ( size_t s = 0; s < 2; s++ ) {
+    std::vector<int> node1, node2;
+    std::vector<double> cost;
+    random_graph( sizes[s][0], sizes[s][1], node1, node2, cost );
+
+    std::vector<size_t> expected = kruskal( sizes[s][0], node1, node2, cost ), forest;
+    minimum_spanning_forest( sizes[s][0], node1, node2, cost, forest, 1 );
+    ASSERT_EQ( expected.size(), forest.size() );
+    for ( size_t i = 0; i < forest.size(); i++ )
+      EXPECT_EQ( expected[i], forest[i] );
+  }
+}
+
+TEST( MinimumSpanningTree, ThreadsGiveSameResult ) {
+  std::vector<int> node1, node2;
+  std::vector<double> cost;
+  random_graph( 3000, 200000, node1, node2, cost );
+
+  std::vector<size_t> forest1, forest4;
+  minimum_spanning_forest( 3000, node1, node2, cost, forest1, 1 );
+  minimum_spanning_forest( 3000, node1, node2, cost, forest4, 4 );
+  EXPECT_EQ( 2999u, forest1.size() );
+  EXPECT_TRUE( forest1 == forest4 );
+}
+
+TEST( MinimumSpanningTree, Apply ) {
+  // A square 10-11-12-13 with a heavy diagonal, and a separate edge 15-16.
+  Edge e0( 10, 11, 1 ), e1( 11, 12, 2 ), e2( 12, 13, 3 ), e3( 13, 10, 4 ),
+       e4( 10, 12, 9 ), e5( 15, 16, 1 );
+  EdgePrimitive* prims[6] = { &e4, &e3, &e2, &e1, &e0, &e5 };
+  MinimumSpanningTree tree( 6, prims );
+
+  RecordEdges record;
+  tree.apply( record, 12 );
+  ASSERT_EQ( 4u, record.visits.size() );
+  EXPECT_EQ( &e1, record.visits[0].first );
+  EXPECT_EQ( 12,  record.visits[0].second );
+  EXPECT_EQ( &e0, record.visits[1].first );
+  EXPECT_EQ( 11,  record.visits[1].second );
+  EXPECT_EQ( &e2, record.visits[2].first );
+  EXPECT_EQ( 12,  record.visits[2].second );
+  EXPECT_EQ( &e5, record.visits[3].first );
+  EXPECT_EQ( 15,  record.visits[3].second );
+}
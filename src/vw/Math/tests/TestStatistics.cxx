@@ -165,3 +165,104 @@ TEST(Statistics, CDF_Merge ) {
   cdf0.duplicate(cdf2);
   EXPECT_NEAR( cdf2.median(), cdf0.median(), 0.01 );
 }
+
+TEST(Statistics, SummaryAccumulator) {
+  boost::mt19937 random_gen(42);
+  boost::normal_distribution<double> normal(-30,80);
+  boost::variate_generator<boost::mt19937&, boost::normal_distribution<double> >
+    generator(random_gen, normal);
+
+  // Feed values that slowly widen the range, split across several
+  // accumulators which are merged at the end.
+  const int num_values = 20000;
+  std::vector<double> values;
+  SummaryAccumulator serial(1024);
+  std::vector<SummaryAccumulator> parts(7, SummaryAccumulator(1024));
+  for (int i = 0; i < num_values; ++i) {
+    double v = generator() * (1.0 + i/double(num_values));
+    values.push_back(v);
+    serial(v);
+    parts[i*7/num_values](v);
+  }
+  serial(std::numeric_limits<double>::quiet_NaN());
+  SummaryAccumulator merged(1024);
+  for (size_t i = 0; i < parts.size(); ++i)
+    merged.merge(parts[i]);
+
+  std::sort(values.begin(), values.end());
+  double mean_val = vw::math::mean(values);
+  double stddev   = vw::math::standard_deviation(values, mean_val)
+                  * sqrt((num_values-1.0)/num_values);
+
+  SummaryAccumulator const* accums[2] = {&serial, &merged};
+  for (int k = 0; k < 2; ++k) {
+    SummaryAccumulator const& a = *accums[k];
+    EXPECT_EQ(size_t(num_values), a.num_values());
+    EXPECT_EQ(values.front(), a.minimum());
+    EXPECT_EQ(values.back(),  a.maximum());
+    EXPECT_NEAR(mean_val, a.mean(),   1e-9);
+    EXPECT_NEAR(stddev,   a.stddev(), 1e-9);
+    EXPECT_EQ(values.front(), a.quantile(0));
+    EXPECT_EQ(values.back(),  a.quantile(1));
+    double tol = 4*(values.back() - values.front())/a.num_bins();
+    EXPECT_NEAR(values[num_values/50],     a.quantile(0.02), tol);
+    EXPECT_NEAR(values[num_values/2],      a.quantile(0.5 ), tol);
+    EXPECT_NEAR(values[num_values*49/50],  a.quantile(0.98), tol);
+
+    uint64 total = 0;
+    for (size_t i = 0; i < a.num_bins(); ++i)
+      total += a.bin_value(i);
+    EXPECT_EQ(uint64(num_values), total);
+  }
+}
+
+TEST(Statistics, QuantileSketch) {
+  boost::mt19937 random_gen(7);
+  boost::cauchy_distribution<double> cauchy(10, 3);
+  boost::variate_generator<boost::mt19937&, boost::cauchy_distribution<double> >
+    generator(random_gen, cauchy);
+
+  // Heavy tails make a fixed-bin histogram useless here, but the
+  // sketch's error is in rank so it does not care.
+  const int num_values = 400000;
+  std::vector<double> values;
+  QuantileSketch serial;
+  std::vector<QuantileSketch> parts(5);
+  for (int i = 0; i < num_values; ++i) {
+    double v = generator();
+    values.push_back(v);
+    serial(v);
+    parts[i*5/num_values](v);
+  }
+  serial(std::numeric_limits<double>::infinity());
+  QuantileSketch merged;
+  for (size_t i = 0; i < parts.size(); ++i)
+    merged.merge(parts[i]);
+  std::sort(values.begin(), values.end());
+
+  QuantileSketch const* sketches[2] = {&serial, &merged};
+  for (int k = 0; k < 2; ++k) {
+    QuantileSketch const& s = *sketches[k];
+    EXPECT_EQ(size_t(num_values), s.num_values());
+    EXPECT_LT(s.num_retained(), 4*s.k());
+    EXPECT_EQ(values.front(), s.quantile(0));
+    EXPECT_EQ(values.back(),  s.quantile(1));
+    double qs[5] = {0.02, 0.25, 0.5, 0.75, 0.98};
+    for (int j = 0; j < 5; ++j) {
+      double q = qs[j];
+      double found = std::lower_bound(values.begin(), values.end(), s.quantile(q))
+                   - values.begin();
+      EXPECT_NEAR(q, found / num_values, 0.01);
+      EXPECT_NEAR(q, s.rank(values[size_t(q*num_values)]), 0.01);
+    }
+  }
+
+  // The same input gives the same sketch.
+  QuantileSketch again;
+  for (int i = 0; i < num_values; ++i)
+    again(values[(size_t(i) * 7919) % num_values]);
+  QuantileSketch again2;
+  for (int i = 0; i < num_values; ++i)
+    again2(values[(size_t(i) * 7919) % num_values]);
+  EXPECT_EQ(again.quantile(0.3), again2.quantile(0.3));
+}
@@ -0,0 +1,86 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Mosaic/ArchiveQuadTreeConfig.h>
+#include <vw/FileIO/MemoryImageResource.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace vw {
+namespace mosaic {
+
+  namespace {
+
+    /// Encodes a tile in memory and adds it to the archive.
+    class ArchiveTileResource : public DstImageResource {
+      boost::shared_ptr<TileArchiveWriter>      m_archive;
+      std::string                               m_name;
+      boost::scoped_ptr<DstMemoryImageResource> m_encoder;
+    public:
+      ArchiveTileResource( boost::shared_ptr<TileArchiveWriter> const& archive, std::string const& name,
+                           std::string const& type, ImageFormat const& format )
+        : m_archive( archive ), m_name( name ), m_encoder( DstMemoryImageResource::create( type, format ) ) {}
+
+      virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+        m_encoder->write( buf, bbox );
+        m_archive->add( m_name, m_encoder->data(), m_encoder->size() );
+      }
+      virtual bool has_block_write()  const { return false; }
+      virtual bool has_nodata_write() const { return false; }
+      virtual void flush() {}
+    };
+
+  } // namespace
+
+  ArchiveQuadTreeConfig::ArchiveQuadTreeConfig( std::string const& filename,
+                                                boost::shared_ptr<QuadTreeConfig> const& layout )
+    : m_layout( layout ), m_archive( new TileArchiveWriter( filename ) ) {}
+
+  void ArchiveQuadTreeConfig::configure( QuadTreeGenerator& qtree ) const {
+    if( m_layout )
+      m_layout->configure( qtree );
+    qtree.set_tile_resource_func( boost::bind( &ArchiveQuadTreeConfig::tile_resource, m_archive, _1, _2, _3 ) );
+  }
+
+  cartography::GeoReference ArchiveQuadTreeConfig::output_georef( uint32 xresolution, uint32 yresolution ) {
+    VW_ASSERT( m_layout, LogicErr() << "ArchiveQuadTreeConfig: A georeference needs a layout config." );
+    return m_layout->output_georef( xresolution, yresolution );
+  }
+
+  std::string ArchiveQuadTreeConfig::tile_name( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info ) {
+    std::string name = info.filepath;
+    std::string const& tree = qtree.get_name();
+    if( name.compare( 0, tree.size(), tree ) == 0 ) {
+      name.erase( 0, tree.size() );
+      if( !name.empty() && name[0] == '/' )
+        name.erase( 0, 1 );
+    }
+    return name + info.filetype;
+  }
+
+  boost::shared_ptr<DstImageResource> ArchiveQuadTreeConfig::tile_resource( boost::shared_ptr<TileArchiveWriter> const& archive,
+                                                                            QuadTreeGenerator const& qtree,
+                                                                            QuadTreeGenerator::TileInfo const& info,
+                                                                            ImageFormat const& format ) {
+    return boost::shared_ptr<DstImageResource>( new ArchiveTileResource( archive, tile_name( qtree, info ),
+                                                                         info.filetype, format ) );
+  }
+
+} // namespace mosaic
+} // namespace vw
@@ -0,0 +1,68 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ArchiveQuadTreeConfig.h
+///
+/// A configuration class that provides callbacks for
+/// QuadTreeGenerator that write the tiles of another quadtree layout
+/// into a single TileArchive instead of one file per tile.
+///
+#ifndef __VW_MOSAIC_ARCHIVEQUADTREECONFIG_H__
+#define __VW_MOSAIC_ARCHIVEQUADTREECONFIG_H__
+
+#include <vw/Mosaic/QuadTreeGenerator.h>
+#include <vw/Mosaic/QuadTreeConfig.h>
+#include <vw/Mosaic/TileArchive.h>
+
+namespace vw {
+namespace mosaic {
+
+  class ArchiveQuadTreeConfig : public QuadTreeConfig {
+    boost::shared_ptr<QuadTreeConfig>    m_layout;
+    boost::shared_ptr<TileArchiveWriter> m_archive;
+  public:
+    /// Tiles are named as the layout config, if any, names their files,
+    /// relative to the tree, and encoded in memory as its file type.
+    /// Each tile is encoded by the thread which made it.  Metadata
+    /// callbacks of the layout which look for tile files on disk will
+    /// not see the archived tiles.
+    ArchiveQuadTreeConfig( std::string const& filename,
+                           boost::shared_ptr<QuadTreeConfig> const& layout = boost::shared_ptr<QuadTreeConfig>() );
+    virtual ~ArchiveQuadTreeConfig() {}
+
+    void configure( QuadTreeGenerator& qtree ) const;
+
+    /// The georeference of the layout config.
+    cartography::GeoReference output_georef(uint32 xresolution, uint32 yresolution = 0);
+
+    /// Write out the archive's index once the tree has been generated.
+    void close() { m_archive->close(); }
+
+    /// The name of a tile in the archive.
+    static std::string tile_name( QuadTreeGenerator const& qtree, QuadTreeGenerator::TileInfo const& info );
+
+    static boost::shared_ptr<DstImageResource> tile_resource( boost::shared_ptr<TileArchiveWriter> const& archive,
+                                                              QuadTreeGenerator const& qtree,
+                                                              QuadTreeGenerator::TileInfo const& info,
+                                                              ImageFormat const& format );
+  };
+
+} // namespace mosaic
+} // namespace vw
+
+#endif // __VW_MOSAIC_ARCHIVEQUADTREECONFIG_H__
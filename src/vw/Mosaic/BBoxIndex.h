@@ -0,0 +1,135 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file BBoxIndex.h
+///
+/// A static R-tree over a set of integer bounding boxes, for finding
+/// the ones that meet a query box without testing them all.
+///
+#ifndef __VW_MOSAIC_BBOXINDEX_H__
+#define __VW_MOSAIC_BBOXINDEX_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Math/BBox.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace vw {
+namespace mosaic {
+
+  /// The tree is bulk loaded with the Sort-Tile-Recursive method: the
+  /// boxes are sorted into vertical slices by center x, each slice is
+  /// sorted by center y, and runs of node_size boxes make the leaves.
+  /// The levels above are packed from the level below the same way.
+  /// Empty boxes are never found.
+  class BBoxIndex {
+  public:
+    BBoxIndex() : m_size(0) {}
+
+    /// Index the boxes, which are then known by their position in the vector.
+    explicit BBoxIndex( std::vector<BBox2i> const& bboxes, uint32 node_size = 16 ) { build( bboxes, node_size ); }
+
+    void build( std::vector<BBox2i> const& bboxes, uint32 node_size = 16 ) {
+      m_size = bboxes.size();
+      m_levels.clear();
+      std::vector<Node> nodes;
+      nodes.reserve( bboxes.size() );
+      for( uint32 i = 0; i < bboxes.size(); ++i )
+        if( ! bboxes[i].empty() )
+          nodes.push_back( Node( bboxes[i], i, i+1 ) );
+      m_levels.push_back( nodes );
+      node_size = std::max( node_size, uint32(2) );
+      while( m_levels.back().size() > node_size )
+        m_levels.push_back( pack( m_levels.back(), node_size ) );
+    }
+
+    /// The number of boxes indexed, including empty ones.
+    size_t size() const { return m_size; }
+
+    /// Append to result the indices of the boxes which intersect bbox,
+    /// in increasing order.
+    void intersects( BBox2i const& bbox, std::vector<uint32>& result ) const {
+      size_t start = result.size();
+      if( ! m_levels.empty() && ! bbox.empty() ) {
+        std::vector<Node> const& top = m_levels.back();
+        for( size_t i = 0; i < top.size(); ++i )
+          search( m_levels.size()-1, top[i], bbox, result );
+      }
+      std::sort( result.begin() + start, result.end() );
+    }
+
+  private:
+    /// A box with the range of its children in the level below, or
+    /// the index of the box itself in the bottom level.
+    struct Node {
+      BBox2i bbox;
+      uint32 begin, end;
+      Node( BBox2i const& bbox, uint32 begin, uint32 end ) : bbox(bbox), begin(begin), end(end) {}
+      int64 center_x() const { return int64(bbox.min().x()) + bbox.max().x(); }
+      int64 center_y() const { return int64(bbox.min().y()) + bbox.max().y(); }
+    };
+
+    static bool less_x( Node const& a, Node const& b ) { return a.center_x() < b.center_x(); }
+    static bool less_y( Node const& a, Node const& b ) { return a.center_y() < b.center_y(); }
+
+    /// Sorts level in place and returns the level above it.
+    static std::vector<Node> pack( std::vector<Node>& level, uint32 node_size ) {
+      const size_t num_parents = (level.size() + node_size - 1) / node_size;
+      const size_t num_slices  = size_t( std::ceil( std::sqrt( double(num_parents) ) ) );
+      const size_t slice_size  = num_slices * node_size;
+
+      std::sort( level.begin(), level.end(), less_x );
+      for( size_t s = 0; s < level.size(); s += slice_size )
+        std::sort( level.begin() + s, level.begin() + std::min( s + slice_size, level.size() ), less_y );
+
+      std::vector<Node> parents;
+      parents.reserve( num_parents );
+      for( size_t s = 0; s < level.size(); s += slice_size ) {
+        const size_t slice_end = std::min( s + slice_size, level.size() );
+        for( size_t b = s; b < slice_end; b += node_size ) {
+          const size_t e = std::min( b + node_size, slice_end );
+          Node parent( level[b].bbox, uint32(b), uint32(e) );
+          for( size_t i = b+1; i < e; ++i )
+            parent.bbox.grow( level[i].bbox );
+          parents.push_back( parent );
+        }
+      }
+      return parents;
+    }
+
+    void search( size_t level, Node const& node, BBox2i const& bbox, std::vector<uint32>& result ) const {
+      if( ! node.bbox.intersects( bbox ) )
+        return;
+      if( level == 0 ) {
+        result.push_back( node.begin );
+        return;
+      }
+      std::vector<Node> const& children = m_levels[level-1];
+      for( uint32 i = node.begin; i < node.end; ++i )
+        search( level-1, children[i], bbox, result );
+    }
+
+    size_t m_size;
+    std::vector<std::vector<Node> > m_levels; ///< Leaves first
+  };
+
+}} // namespace vw::mosaic
+
+#endif // __VW_MOSAIC_BBOXINDEX_H__
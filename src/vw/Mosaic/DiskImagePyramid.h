@@ -23,16 +23,25 @@
 #ifndef __VW_MOSAIC_DISKIMAGEPYRAMID_H__
 #define __VW_MOSAIC_DISKIMAGEPYRAMID_H__
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <typeinfo>
 #include <vector>
 #include <list>
 
+#include <boost/crc.hpp>
+
 #include <vw/Core/Cache.h>
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/AntiAliasing.h>
+#include <vw/Image/BlockRasterize.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/DiskImageUtils.h>
+#include <vw/FileIO/DiskImageView.h>
 #include <vw/FileIO/FileUtils.h>
 #include <vw/Math/Statistics.h>
 
@@ -133,6 +142,102 @@ namespace vw { namespace mosaic {
     return overwrite;
   }
 
+  /// The CRC-32 of a file's contents.
+  inline uint32 file_crc32(std::string const& file) {
+    std::ifstream f(file.c_str(), std::ios::binary);
+    if (!f)
+      vw_throw( IOErr() << "Could not open file: " << file );
+    boost::crc_32_type crc;
+    std::vector<char> buffer(1 << 20);
+    while (f) {
+      f.read(&buffer[0], buffer.size());
+      crc.process_bytes(&buffer[0], f.gcount());
+    }
+    return crc.checksum();
+  }
+
+  /// The name of the sidecar file describing a pyramid level file.
+  inline std::string pyramid_sidecar_file(std::string const& level_file) {
+    return level_file + ".vwpyr";
+  }
+
+  /// Describes what a pyramid level file was made from and how, so
+  /// that a level written by an earlier run is only reused if it
+  /// would come out the same.
+  inline std::string pyramid_level_key(std::string const& base_file, std::string const& pixel_type,
+                                       int subsample, int scale, int cols, int rows,
+                                       double nodata_val, int resample_filter = -1) {
+    std::ostringstream os;
+    os.precision(17);
+    os << "VWPYR 1\n"
+       << "source "         << fs::absolute(base_file).string() << "\n"
+       << "source_size "    << fs::file_size(base_file)         << "\n"
+       << "source_time "    << fs::last_write_time(base_file)   << "\n"
+       << "pixel_type "     << pixel_type                       << "\n"
+       << "subsample "      << subsample                        << "\n"
+       << "scale "          << scale                            << "\n"
+       << "size "           << cols << " " << rows              << "\n"
+       << "nodata "         << nodata_val                       << "\n";
+    // Levels made with resample_aa() predate this line, so their keys
+    // stay the same.
+    if (resample_filter >= 0)
+      os << "resample_filter " << resample_filter << "\n";
+    return os.str();
+  }
+
+  /// True if level_file has a sidecar with the given key, and the
+  /// file still has the size and modification time recorded there.
+  /// The checksum is only computed if the time differs, or if
+  /// verify_checksum is set.
+  inline bool pyramid_level_is_valid(std::string const& level_file, std::string const& key,
+                                     bool verify_checksum = false) {
+    try {
+      std::ifstream f(pyramid_sidecar_file(level_file).c_str());
+      if (!f)
+        return false;
+      std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+      if (text.compare(0, key.size(), key) != 0)
+        return false;
+      // Sidecars written before level_time was recorded only have the
+      // size and checksum.
+      std::istringstream is(text.substr(key.size()));
+      std::string tag;
+      uint64      size = 0;
+      std::time_t time = 0;
+      uint32      crc  = 0;
+      bool have_size = false, have_time = false, have_crc = false;
+      while (is >> tag) {
+        if      (tag == "level_size" && is >> size) have_size = true;
+        else if (tag == "level_time" && is >> time) have_time = true;
+        else if (tag == "crc32"      && is >> crc ) have_crc  = true;
+        else
+          return false;
+      }
+      if (!have_size || !have_crc)
+        return false;
+      if (!fs::exists(level_file) || fs::file_size(level_file) != size)
+        return false;
+      if (have_time && !verify_checksum && fs::last_write_time(level_file) == time)
+        return true;
+      return file_crc32(level_file) == crc;
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  /// Record the key, size, modification time and checksum of a newly
+  /// written level file.
+  inline void write_pyramid_sidecar(std::string const& level_file, std::string const& key) {
+    std::string sidecar = pyramid_sidecar_file(level_file);
+    std::ofstream f(sidecar.c_str());
+    f << key
+      << "level_size " << fs::file_size(level_file)       << "\n"
+      << "level_time " << fs::last_write_time(level_file) << "\n"
+      << "crc32 "      << file_crc32(level_file)          << "\n";
+    if (!f)
+      vw_throw( IOErr() << "Failed writing: " << sidecar );
+  }
+
   /// Logic to find some approximate values for the valid pixels, ignoring the worst
   /// outliers. Use the lowest pyramid level.
   template <class PixelT>
@@ -180,8 +285,9 @@ namespace vw { namespace mosaic {
   /// A class to manage very large images and their subsampled
   /// versions in a pyramid. The most recently accessed tiles are
   /// cached in memory. Caching is handled by use of the
-  /// DiskImageView class. Constructing this class creates a temporary
-  /// file on disk for each level of the pyramid.
+  /// DiskImageView class. Constructing this class creates a file on
+  /// disk for each level of the pyramid, with a sidecar recording how
+  /// it was made and its checksum, so later runs can reuse it.
   template <class PixelT>
   class DiskImagePyramid {
 
@@ -190,10 +296,13 @@ namespace vw { namespace mosaic {
 
     // Constructor. Note that we use NaN as nodata if not available,
     // that has the effect of not accidentally setting some pixels to nodata.
+    // resample_filter is a ResampleFilter to make each level with
+    // polyphase_resample(), or -1 to use resample_aa().
     DiskImagePyramid(std::string const& base_file = "",
 		     cartography::GdalWriteOptions const& opt = cartography::GdalWriteOptions(),
 		     int top_image_max_pix = 1000*1000,
-		     int subsample = 2);
+		     int subsample = 2,
+		     int resample_filter = -1);
 
     // Given a region (at full resolution) and a scale factor, compute
     // the portion of the image in the region, subsampled by a factor no
@@ -219,10 +328,23 @@ namespace vw { namespace mosaic {
     ImageViewRef<PixelT>        bottom()       { return m_pyramid[0]; }
     ImageViewRef<PixelT> const& bottom() const { return m_pyramid[0]; }
 
+    /// The levels of the pyramid, level 0 being the highest
+    /// resolution one, and the factor each is subsampled by.
+    int32                       num_levels () const      { return m_pyramid.size(); }
+    ImageViewRef<PixelT> const& level      (int i) const { return m_pyramid[i]; }
+    int                         level_scale(int i) const { return m_scales[i]; }
+
     std::set<std::string> const& get_temporary_files() const {return m_temporary_files;}
 
   private:
 
+    /// Write one level and then its sidecar. The tiles of the level
+    /// are rendered and written in parallel by m_opt.num_threads threads.
+    void write_level(std::string const& file, std::string const& key,
+                     ImageViewRef<PixelT> const& image,
+                     bool has_georef, cartography::GeoReference const& georef,
+                     bool has_nodata) const;
+
     cartography::GdalWriteOptions m_opt;
 
     // The subsample factor to go to the next level of the pyramid (must be >= 2).
@@ -256,7 +378,8 @@ namespace vw { namespace mosaic {
   DiskImagePyramid<PixelT>::DiskImagePyramid(std::string const& base_file,
                                              cartography::GdalWriteOptions const& opt,
                                              int top_image_max_pix,
-                                             int subsample):
+                                             int subsample,
+                                             int resample_filter):
     m_opt(opt), m_subsample(subsample),
     m_top_image_max_pix(top_image_max_pix),
     m_nodata_val(std::numeric_limits<double>::quiet_NaN()) {
@@ -313,15 +436,18 @@ namespace vw { namespace mosaic {
       // then cast back to current pixel type for saving.
       PixelT nodata_pixel;
       set_all(nodata_pixel, m_nodata_val);
+      ImageViewRef< PixelMask<PixelT> > resampled;
+      if (resample_filter >= 0)
+        resampled = pixel_cast< PixelMask<PixelT> >
+          (polyphase_resample(channel_cast<double>(masked), sub_scale,
+                              ResampleFilter(resample_filter)));
+      else
+        resampled = pixel_cast< PixelMask<PixelT> >
+          (resample_aa(channel_cast<double>(masked), sub_scale));
       ImageViewRef<PixelT> unmasked
         = block_rasterize
         (cache_tile_aware_render
-          (pixel_cast<PixelT>
-          (apply_mask
-            (resample_aa
-            (channel_cast<double>(masked), sub_scale),
-            nodata_pixel
-            )),
+          (apply_mask(resampled, nodata_pixel),
           Vector2i(tile_size,tile_size) * sub_scale
           ), Vector2i(tile_size,tile_size), sub_threads
         );
@@ -330,28 +456,26 @@ namespace vw { namespace mosaic {
       if (has_georef)
         georef = resample(georef, sub_scale);
 
-      // If the file exists, and has the right size, and is not too old,
-      // don't write it again
+      // If a file from an earlier run has a sidecar showing it was
+      // made the same way from the same base file, and the file is
+      // unchanged since, don't write it again. The key depends only on
+      // the base file, so reusing a coarse level never reads the finer
+      // ones.
+      std::string key = pyramid_level_key(base_file, typeid(PixelT).name(), subsample, scale,
+                                          unmasked.cols(), unmasked.rows(), m_nodata_val,
+                                          resample_filter);
       std::string curr_file = filename_from_suffix1(base_file, suffix);
-      bool will_write = overwrite_if_no_good(base_file, curr_file,
-                                             unmasked.cols(), unmasked.rows());
+      bool will_write = !pyramid_level_is_valid(curr_file, key);
 
       if (will_write) {
-        TerminalProgressCallback tpc("vw", ": ");
-        vw_out() << "Writing: " << curr_file << std::endl;
         try{
-          cartography::block_write_gdal_image(curr_file, unmasked, has_georef, georef,
-                      has_nodata, m_nodata_val, opt, tpc);
+          write_level(curr_file, key, unmasked, has_georef, georef, has_nodata);
         }catch(...){
           vw_out() << "Failed to write: " << curr_file << "\n";
           curr_file = filename_from_suffix2(base_file, suffix);
-          will_write = overwrite_if_no_good(base_file, curr_file,
-                    unmasked.cols(), unmasked.rows());
-          if (will_write) {
-            vw_out() << "Writing: " << curr_file << std::endl;
-            cartography::block_write_gdal_image(curr_file, unmasked, has_georef, georef,
-                  has_nodata, m_nodata_val, opt, tpc);
-          }
+          will_write = !pyramid_level_is_valid(curr_file, key);
+          if (will_write)
+            write_level(curr_file, key, unmasked, has_georef, georef, has_nodata);
         }
       }
 
@@ -366,6 +490,7 @@ namespace vw { namespace mosaic {
       m_pyramid_files.push_back(curr_file);
     
       m_temporary_files.insert(curr_file);
+      m_temporary_files.insert(pyramid_sidecar_file(curr_file));
       m_pyramid.push_back(DiskImageView<PixelT>(curr_file));
       m_scales.push_back(scale);
 
@@ -374,6 +499,22 @@ namespace vw { namespace mosaic {
 
   }
 
+  template <class PixelT>
+  void DiskImagePyramid<PixelT>::write_level(std::string const& file, std::string const& key,
+                                             ImageViewRef<PixelT> const& image,
+                                             bool has_georef, cartography::GeoReference const& georef,
+                                             bool has_nodata) const {
+    // A stale sidecar must not outlive the file it describes.
+    boost::system::error_code ec;
+    fs::remove(pyramid_sidecar_file(file), ec);
+
+    TerminalProgressCallback tpc("vw", ": ");
+    vw_out() << "Writing: " << file << std::endl;
+    cartography::block_write_gdal_image(file, image, has_georef, georef,
+                                        has_nodata, m_nodata_val, m_opt, tpc);
+    write_pyramid_sidecar(file, key);
+  }
+
   template <class PixelT>
   void DiskImagePyramid<PixelT>::get_image_clip(double scale_in, BBox2i region_in,
                                                 ImageView<PixelT> & clip,
@@ -23,12 +23,16 @@
 #ifndef __VW_MOSAIC_IMAGECOMPOSITE_H__
 #define __VW_MOSAIC_IMAGECOMPOSITE_H__
 
+#include <cstring>
+#include <exception>
 #include <iostream>
 #include <vector>
 #include <list>
 
 #include <vw/Core/Cache.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/ImageMath.h>
@@ -38,6 +42,7 @@
 #include <vw/Image/Filter.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/FileIO/DiskImageResource.h>
+#include <vw/Mosaic/BBoxIndex.h>
 
 namespace vw {
 namespace mosaic {
@@ -137,6 +142,13 @@ namespace mosaic {
   };
 
 
+  /// The masked Laplacian pyramid of one source of an ImageComposite.
+  template <class PixelT>
+  struct BlendPyramid {
+    std::vector<PositionedImage<PixelT> > images;
+    std::vector<PositionedImage<typename PixelChannelType<PixelT>::type> > masks;
+  };
+
   // *******************************************************************
   // ImageComposite
   // *******************************************************************
@@ -149,10 +161,7 @@ namespace mosaic {
     typedef typename PixelChannelType<PixelT>::type channel_type;
 
   private:
-    struct Pyramid {
-      std::vector<PositionedImage<pixel_type  > > images;
-      std::vector<PositionedImage<channel_type> > masks;
-    };
+    typedef BlendPyramid<pixel_type> Pyramid;
 
     /// ?
     class SourceGenerator {
@@ -193,13 +202,31 @@ namespace mosaic {
         return m_composite.sources[m_index].size() / PixelNumChannels<pixel_type>::value;
       }
       boost::shared_ptr<value_type> generate() const {
-        ImageView<pixel_type> source = *m_composite.sources[m_index];
-        m_composite.sources[m_index].release();
-        m_composite.sources[m_index].deprioritize();
+        Cache::Handle<SourceGenerator> handle = m_composite.sources[m_index];
+        ImageView<pixel_type> source = *handle;
+        handle.release();
+        handle.deprioritize();
         return boost::shared_ptr<value_type>( new value_type( select_alpha_channel( source ) ) );
       }
     };
 
+    /// Reads back the cutline weights of a source written by prepare().
+    class CutlineGenerator {
+      size_t m_index;
+      size_t m_size;
+    public:
+      typedef ImageView<float32> value_type;
+      CutlineGenerator( size_t index, size_t size ) : m_index(index), m_size(size) {}
+      size_t size() const { return m_size; }
+      boost::shared_ptr<value_type> generate() const {
+        std::ostringstream filename;
+        filename << "cutline." << m_index << ".png";
+        boost::shared_ptr<value_type> ptr( new value_type );
+        read_image( *ptr, filename.str() );
+        return ptr;
+      }
+    };
+
     class PyramidGenerator {
     public:
       ImageComposite& m_composite;
@@ -215,19 +242,70 @@ namespace mosaic {
 
     friend class PyramidGenerator;
 
+    /// Makes the blending mask of one source.
+    class MaskTask : public Task {
+      ImageComposite const& m_composite;
+      std::vector<Cache::Handle<GrassfireGenerator> > const& m_grassfires;
+      unsigned m_index;
+      ProgressCallback const& m_progress;
+    public:
+      MaskTask( ImageComposite const& composite, std::vector<Cache::Handle<GrassfireGenerator> > const& grassfires,
+                unsigned index, ProgressCallback const& progress )
+        : m_composite(composite), m_grassfires(grassfires), m_index(index), m_progress(progress) {}
+      virtual void operator()();
+    };
+
+    /// State of generate_masks(), shared by its tasks and guarded by
+    /// mutex.  A copy of the composite starts with fresh state, which
+    /// keeps ImageComposite copyable into an ImageViewRef.
+    struct MaskState {
+      Mutex              mutex;
+      size_t             done;
+      std::exception_ptr error;
+      MaskState() : done(0) {}
+      MaskState( MaskState const& ) : done(0) {}
+    };
+    mutable MaskState m_mask_state;
+
     std::vector<BBox2i > bboxes;
+    BBoxIndex m_bbox_index; ///< Index of bboxes, built by prepare()
     BBox2i view_bbox, data_bbox;
     int    mindim, levels;
     bool   m_draft_mode;
     bool   m_fill_holes;
     bool   m_reuse_masks;
+    bool   m_cutline_mode;
+    float  m_feather_width;
+    int32  m_num_threads;
     Cache& m_cache;
     std::vector<ImageViewRef<pixel_type> >        sourcerefs;
     std::vector<Cache::Handle<SourceGenerator > > sources;
     std::vector<Cache::Handle<AlphaGenerator  > > alphas;
     std::vector<Cache::Handle<PyramidGenerator> > pyramids;
 
+    // Cutline mode: the weights of each source, and the box of the
+    // pixels where they are nonzero, built by prepare().
+    std::vector<Cache::Handle<CutlineGenerator> > cutlines;
+    mutable std::vector<BBox2i> m_cutline_bboxes;
+    BBoxIndex m_cutline_index;
+
+    /// Appends the indices of the sources whose bboxes intersect
+    /// bbox, in increasing order.
+    void find_sources( BBox2i const& bbox, std::vector<uint32>& result ) const {
+      if( m_bbox_index.size() == bboxes.size() ) {
+        m_bbox_index.intersects( bbox, result );
+        return;
+      }
+      // Not prepared yet
+      for( uint32 i = 0; i < bboxes.size(); ++i )
+        if( ! bboxes[i].empty() && bbox.intersects( bboxes[i] ) )
+          result.push_back( i );
+    }
+
     void generate_masks( ProgressCallback const& progress_callback ) const;
+    void generate_mask( std::vector<Cache::Handle<GrassfireGenerator> > const& grassfires, unsigned index ) const;
+    void generate_cutline( std::vector<Cache::Handle<GrassfireGenerator> > const& grassfires, unsigned index,
+                           ImageView<float> const& distance, std::vector<uint32> const& overlapping ) const;
 
     /// Generates a full-resolution patch of the mosaic corresponding
     /// to the given bounding box.
@@ -237,11 +315,16 @@ namespace mosaic {
     // to the given bounding box WITHOUT blending.
     ImageView<pixel_type> draft_patch( BBox2i const& patch_bbox ) const;
 
+    /// Generates a full-resolution patch of the mosaic corresponding
+    /// to the given bounding box from the cutline weights.
+    ImageView<pixel_type> cutline_patch( BBox2i const& patch_bbox ) const;
+
   public:
     typedef pixel_type result_type;
 
     ImageComposite() : m_draft_mode (false), m_fill_holes(false),
-                       m_reuse_masks(false), m_cache(vw_system_cache()) {}
+                       m_reuse_masks(false), m_cutline_mode(false), m_feather_width(8),
+                       m_num_threads(0), m_cache(vw_system_cache()) {}
 
     void insert( ImageViewRef<pixel_type> const& image, int x, int y );
 
@@ -251,6 +334,7 @@ namespace mosaic {
     /// Generate a section of the output image.
     ImageView<pixel_type> generate_patch( BBox2i const& patch_bbox ) const {
       if( m_draft_mode ) return draft_patch( patch_bbox );
+      else if( m_cutline_mode ) return cutline_patch( patch_bbox );
       else return blend_patch( patch_bbox );
     }
 
@@ -261,6 +345,25 @@ namespace mosaic {
 
     void set_reuse_masks(bool reuse_masks) { m_reuse_masks = reuse_masks; }
 
+    /// Instead of blending every source under a pixel, take each pixel
+    /// from the source whose edge is farthest away, feathering across
+    /// the cutlines between sources over about feather_width pixels.
+    /// The work per pixel then no longer grows with the number of
+    /// overlapping sources.  prepare() writes the weights of each
+    /// source as "cutline.N.png", which set_reuse_masks() reuses.
+    void set_cutline_mode(bool cutline_mode, float feather_width = 8) {
+      VW_ASSERT( feather_width > 0, ArgumentErr() << "ImageComposite: The feather width must be positive." );
+      m_cutline_mode  = cutline_mode;
+      m_feather_width = feather_width;
+    }
+
+    /// The number of threads making the blending masks in prepare(),
+    /// or zero (the default) for vw_settings().default_num_threads().
+    void  set_num_threads(int32 num_threads) { m_num_threads = num_threads; }
+    int32 get_num_threads() const {
+      return m_num_threads > 0 ? m_num_threads : int32(vw_settings().default_num_threads());
+    }
+
     int32 cols  () const { return view_bbox.width();  }
     int32 rows  () const { return view_bbox.height(); }
     int32 planes() const { return 1;                  }
@@ -280,6 +383,9 @@ namespace mosaic {
 
     typedef CropView<ImageView<PixelT> > prerasterize_type;
 
+    /// Once prepare() has been called, patches may be generated from
+    /// several threads at once, as block_write_image() does; each
+    /// thread takes its own handles on the cached sources and pyramids.
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
       ImageView<PixelT> buf = generate_patch(bbox);
       return CropView<ImageView<PixelT> >( buf, BBox2i(-bbox.min().x(),-bbox.min().y(),cols(),rows()) );
@@ -290,13 +396,14 @@ namespace mosaic {
     }
 
     bool sparse_check( BBox2i const& bbox ) const {
-      for (unsigned int i = 0; i < bboxes.size(); ++i) {
+      std::vector<uint32> overlapping;
+      find_sources( bbox, overlapping );
+      for (unsigned int k = 0; k < overlapping.size(); ++k) {
+        uint32 i = overlapping[k];
         BBox2i src_bbox = bboxes[i];
         src_bbox.crop(bbox);
-        if( ! src_bbox.empty() ) {
-          if( vw::sparse_check( sourcerefs[i], src_bbox-bboxes[i].min() ) ) {
-            return true;
-          }
+        if( vw::sparse_check( sourcerefs[i], src_bbox-bboxes[i].min() ) ) {
+          return true;
         }
       }
       return false;
@@ -321,6 +428,72 @@ namespace mosaic {
     }
   }; // End class ImageComposite
 
+  /// Lets the Cache spill blending pyramids to disk rather than
+  /// regenerate them from their sources.  Each level is written as its
+  /// dimensions and bbox followed by the raw pixel data.
+  template <class PixelT>
+  struct CacheSpillTraits<mosaic::BlendPyramid<PixelT> > {
+    typedef typename PixelChannelType<PixelT>::type channel_type;
+    static const bool spillable = boost::has_trivial_copy<PixelT>::value;
+
+    static void save( mosaic::BlendPyramid<PixelT> const& pyramid, std::vector<uint8>& buffer ) {
+      buffer.clear();
+      uint32 levels = uint32(pyramid.images.size());
+      append( buffer, &levels, sizeof(levels) );
+      for( size_t l=0; l<pyramid.images.size(); ++l ) {
+        save_level( pyramid.images[l], buffer );
+        save_level( pyramid.masks[l], buffer );
+      }
+    }
+
+    static boost::shared_ptr<mosaic::BlendPyramid<PixelT> > load( uint8 const* data, size_t size ) {
+      uint8 const* end = data + size;
+      boost::shared_ptr<mosaic::BlendPyramid<PixelT> > pyramid( new mosaic::BlendPyramid<PixelT> );
+      uint32 levels;
+      extract( data, end, &levels, sizeof(levels) );
+      for( uint32 l=0; l<levels; ++l ) {
+        pyramid->images.push_back( load_level<PixelT>( data, end ) );
+        pyramid->masks.push_back( load_level<channel_type>( data, end ) );
+      }
+      VW_ASSERT( data == end, IOErr() << "Bad spilled blending pyramid." );
+      return pyramid;
+    }
+
+  private:
+    static void append( std::vector<uint8>& buffer, void const* value, size_t size ) {
+      size_t offset = buffer.size();
+      buffer.resize( offset + size );
+      if( size )
+        memcpy( &buffer[offset], value, size );
+    }
+    static void extract( uint8 const*& data, uint8 const* end, void* value, size_t size ) {
+      VW_ASSERT( size_t(end - data) >= size, IOErr() << "Truncated spilled blending pyramid." );
+      if( size )
+        memcpy( value, data, size );
+      data += size;
+    }
+
+    template <class T>
+    static void save_level( mosaic::PositionedImage<T> const& level, std::vector<uint8>& buffer ) {
+      int32 dims[8] = { level.m_cols, level.m_rows,
+                        level.bbox.min().x(), level.bbox.min().y(),
+                        level.bbox.max().x(), level.bbox.max().y(),
+                        level.image.cols(), level.image.rows() };
+      append( buffer, dims, sizeof(dims) );
+      append( buffer, level.image.data(), size_t(dims[6]) * dims[7] * sizeof(T) );
+    }
+    template <class T>
+    static mosaic::PositionedImage<T> load_level( uint8 const*& data, uint8 const* end ) {
+      int32 dims[8];
+      extract( data, end, dims, sizeof(dims) );
+      VW_ASSERT( dims[6] >= 0 && dims[7] >= 0, IOErr() << "Bad spilled blending pyramid." );
+      ImageView<T> image( dims[6], dims[7] );
+      extract( data, end, image.data(), size_t(dims[6]) * dims[7] * sizeof(T) );
+      return mosaic::PositionedImage<T>( dims[0], dims[1], image,
+                                         BBox2i( Vector2i(dims[2],dims[3]), Vector2i(dims[4],dims[5]) ) );
+    }
+  };
+
 } // namespace vw
 
 
@@ -330,39 +503,130 @@ void vw::mosaic::ImageComposite<PixelT>::generate_masks( vw::ProgressCallback co
   std::vector<Cache::Handle<GrassfireGenerator> > grassfires;
   for( unsigned i=0; i<sources.size(); ++i )
     grassfires.push_back( m_cache.insert( GrassfireGenerator( sourcerefs[i] ) ) );
-  for( unsigned p1=0; p1<sources.size(); ++p1 ) {
-    ImageView<float> mask = copy( *(grassfires[p1]) );
-    for( unsigned p2=0; p2<sources.size(); ++p2 ) {
-      if( p1 == p2 ) continue;
-      int ox = bboxes[p2].min().x() - bboxes[p1].min().x();
-      int oy = bboxes[p2].min().y() - bboxes[p1].min().y();
-      if( ! ( ox >= bboxes[p1].width() ||
-              oy >= bboxes[p1].height() ||
-              -ox >= bboxes[p2].width() ||
-              -oy >= bboxes[p2].height() ) )
-      {
-        ImageView<float> other = *grassfires[p2];
-        int left = std::max( ox, 0 );
-        int top = std::max( oy, 0 );
-        int right = std::min( bboxes[p2].width()+ox, bboxes[p1].width() );
-        int bottom = std::min( bboxes[p2].height()+oy, bboxes[p1].height() );
-        for( int j=top; j<bottom; ++j ) {
-          for( int i=left; i<right; ++i ) {
-            if( ( other(i-ox,j-oy) > mask(i,j) ) ||
-                ( other(i-ox,j-oy) == mask(i,j) && p2 > p1 ) )
-              mask(i,j) = 0;
-          }
+
+  // Each mask only depends on the grassfires, so they are made in parallel.
+  m_mask_state.done = 0;
+  m_mask_state.error = std::exception_ptr();
+  {
+    FifoWorkQueue queue( get_num_threads() );
+    for( unsigned p1=0; p1<sources.size(); ++p1 )
+      queue.add_task( boost::shared_ptr<Task>( new MaskTask( *this, grassfires, p1, progress_callback ) ) );
+    queue.join_all();
+  }
+  if( m_mask_state.error )
+    std::rethrow_exception( m_mask_state.error );
+  // report_finished() called by prepare(), so don't call it here
+}
+
+
+template <class PixelT>
+void vw::mosaic::ImageComposite<PixelT>::MaskTask::operator()() {
+  try {
+    {
+      Mutex::Lock lock( m_composite.m_mask_state.mutex );
+      if( m_composite.m_mask_state.error )
+        return;
+    }
+    m_composite.generate_mask( m_grassfires, m_index );
+  } catch (...) {
+    Mutex::Lock lock( m_composite.m_mask_state.mutex );
+    if( ! m_composite.m_mask_state.error )
+      m_composite.m_mask_state.error = std::current_exception();
+    return;
+  }
+  Mutex::Lock lock( m_composite.m_mask_state.mutex );
+  ++m_composite.m_mask_state.done;
+  m_progress.report_fractional_progress( double(m_composite.m_mask_state.done), double(m_composite.sources.size()) );
+}
+
+
+// Keeps the pixels of source p1 which are farther from its edge than
+// from the edge of any other source over them, and writes the result
+// as "mask.p1.png".
+template <class PixelT>
+void vw::mosaic::ImageComposite<PixelT>::generate_mask( std::vector<Cache::Handle<GrassfireGenerator> > const& grassfires,
+                                                        unsigned p1 ) const {
+  // Each dereference holds a lock on the cache line until it is
+  // released, so the tasks use their own handles.
+  Cache::Handle<GrassfireGenerator> handle = grassfires[p1];
+  ImageView<float> mask = copy( *handle );
+  handle.release();
+  std::vector<uint32> overlapping;
+  find_sources( bboxes[p1], overlapping );
+  if( m_cutline_mode ) {
+    generate_cutline( grassfires, p1, mask, overlapping );
+    return;
+  }
+  for( unsigned k=0; k<overlapping.size(); ++k ) {
+    unsigned p2 = overlapping[k];
+    if( p1 == p2 ) continue;
+    int ox = bboxes[p2].min().x() - bboxes[p1].min().x();
+    int oy = bboxes[p2].min().y() - bboxes[p1].min().y();
+    if( ! ( ox >= bboxes[p1].width() ||
+            oy >= bboxes[p1].height() ||
+            -ox >= bboxes[p2].width() ||
+            -oy >= bboxes[p2].height() ) )
+    {
+      handle = grassfires[p2];
+      ImageView<float> other = *handle;
+      handle.release();
+      int left = std::max( ox, 0 );
+      int top = std::max( oy, 0 );
+      int right = std::min( bboxes[p2].width()+ox, bboxes[p1].width() );
+      int bottom = std::min( bboxes[p2].height()+oy, bboxes[p1].height() );
+      for( int j=top; j<bottom; ++j ) {
+        for( int i=left; i<right; ++i ) {
+          if( ( other(i-ox,j-oy) > mask(i,j) ) ||
+              ( other(i-ox,j-oy) == mask(i,j) && p2 > p1 ) )
+            mask(i,j) = 0;
         }
       }
-      progress_callback.report_fractional_progress( double(p1*(sources.size()+1)+p2+1), double((sources.size()+1)*sources.size()) );
     }
-    mask = threshold( mask );
-    std::ostringstream filename;
-    filename << "mask." << p1 << ".png";
-    write_image( filename.str(), mask );
-    progress_callback.report_fractional_progress( double((p1+1)*(sources.size()+1)), double((sources.size()+1)*sources.size()) );
   }
-  // report_finished() called by prepare(), so don't call it here
+  mask = threshold( mask );
+  std::ostringstream filename;
+  filename << "mask." << p1 << ".png";
+  write_image( filename.str(), mask );
+}
+
+
+// The weight of source p1 at a pixel goes from 0 to 1 as its distance
+// from its edge goes from feather_width/2 less than the greatest
+// distance of any other source there to feather_width/2 more.  The
+// weights are written as "cutline.p1.png".
+template <class PixelT>
+void vw::mosaic::ImageComposite<PixelT>::generate_cutline( std::vector<Cache::Handle<GrassfireGenerator> > const& grassfires,
+                                                           unsigned p1, ImageView<float> const& distance,
+                                                           std::vector<uint32> const& overlapping ) const {
+  ImageView<float> nearest( distance.cols(), distance.rows() );
+  for( unsigned k=0; k<overlapping.size(); ++k ) {
+    unsigned p2 = overlapping[k];
+    if( p1 == p2 ) continue;
+    BBox2i overlap = bboxes[p1];
+    overlap.crop( bboxes[p2] );
+    Cache::Handle<GrassfireGenerator> handle = grassfires[p2];
+    ImageView<float> other = *handle;
+    handle.release();
+    int ox = bboxes[p2].min().x() - bboxes[p1].min().x();
+    int oy = bboxes[p2].min().y() - bboxes[p1].min().y();
+    overlap -= bboxes[p1].min();
+    for( int j=overlap.min().y(); j<overlap.max().y(); ++j )
+      for( int i=overlap.min().x(); i<overlap.max().x(); ++i )
+        nearest(i,j) = std::max( nearest(i,j), other(i-ox,j-oy) );
+  }
+
+  ImageView<float> weight( distance.cols(), distance.rows() );
+  for( int j=0; j<weight.rows(); ++j ) {
+    for( int i=0; i<weight.cols(); ++i ) {
+      if( distance(i,j) <= 0 ) continue;
+      float w = 0.5f + ( distance(i,j) - nearest(i,j) ) / m_feather_width;
+      weight(i,j) = std::min( std::max( w, 0.0f ), 1.0f );
+    }
+  }
+  m_cutline_bboxes[p1] = nonzero_data_bounding_box( weight ) + bboxes[p1].min();
+  std::ostringstream filename;
+  filename << "cutline." << p1 << ".png";
+  write_image( filename.str(), weight );
 }
 
 
@@ -370,9 +634,10 @@ template <class PixelT>
 boost::shared_ptr<typename vw::mosaic::ImageComposite<PixelT>::Pyramid> vw::mosaic::ImageComposite<PixelT>::PyramidGenerator::generate() const {
   vw_out(DebugMessage, "mosaic") << "ImageComposite generating pyramid " << m_index << std::endl;
   boost::shared_ptr<Pyramid> ptr( new Pyramid );
-  ImageView<pixel_type> source = copy(*m_composite.sources[m_index]);
-  m_composite.sources[m_index].release();
-  m_composite.sources[m_index].deprioritize();
+  Cache::Handle<SourceGenerator> handle = m_composite.sources[m_index];
+  ImageView<pixel_type> source = copy(*handle);
+  handle.release();
+  handle.deprioritize();
 
   // This is sort of a kluge: the hole-filling algorithm currently
   // doesn't cope well with partially-transparent source pixels.
@@ -434,13 +699,31 @@ void vw::mosaic::ImageComposite<PixelT>::prepare( vw::ProgressCallback const& pr
   for( unsigned i=0; i<sources.size(); ++i )
     bboxes[i] -= view_bbox.min();
   data_bbox -= view_bbox.min();
+  m_bbox_index.build( bboxes );
 
   levels = (int) floorf( logf( float(mindim)/2.0f ) / logf(2.0f) ) - 1;
   if( levels < 1 ) levels = 1;
 
+  if( m_cutline_mode && !m_draft_mode ) {
+    m_cutline_bboxes.assign( sources.size(), BBox2i() );
+    cutlines.clear();
+    for( unsigned i=0; i<sources.size(); ++i )
+      cutlines.push_back( m_cache.insert( CutlineGenerator( i, bboxes[i].width() * bboxes[i].height() * sizeof(float32) ) ) );
+  }
+
   if( !m_draft_mode && !m_reuse_masks ) {
     generate_masks( progress_callback );
   }
+
+  if( m_cutline_mode && !m_draft_mode ) {
+    if( m_reuse_masks ) {
+      for( unsigned i=0; i<sources.size(); ++i ) {
+        m_cutline_bboxes[i] = nonzero_data_bounding_box( *cutlines[i] ) + bboxes[i].min();
+        cutlines[i].release();
+      }
+    }
+    m_cutline_index.build( m_cutline_bboxes );
+  }
   progress_callback.report_finished();
 }
 
@@ -498,9 +781,11 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
 
   // Make a list of the images whose bounding boxes permit them to
   // impact the patch, prioritizing ones that are already in memory.
+  std::vector<uint32> overlapping;
+  find_sources( padded_bbox, overlapping );
   std::list<unsigned> image_list;
-  for( unsigned p=0; p<sources.size(); ++p ) {
-    if( ! padded_bbox.intersects( bboxes[p] ) ) continue;
+  for( unsigned k=0; k<overlapping.size(); ++k ) {
+    unsigned p = overlapping[k];
     if( ! pyramids[p].valid() ) image_list.push_back( p );
     else image_list.push_front( p );
   }
@@ -509,12 +794,13 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
   std::list<unsigned>::iterator ili=image_list.begin(), ilend=image_list.end();
   for( ; ili!=ilend; ++ili ) {
     unsigned p = *ili;
-    boost::shared_ptr<Pyramid> pyr = pyramids[p];
+    Cache::Handle<PyramidGenerator> handle = pyramids[p];
+    boost::shared_ptr<Pyramid> pyr = handle;
     for( int l=0; l<levels; ++l ) {
       pyr->images[l].addto( sum_pyr [l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
       pyr->masks [l].addto( msum_pyr[l], bbox_pyr[l].min().x(), bbox_pyr[l].min().y() );
     }
-    pyramids[p].release();
+    handle.release();
   }
 
   // Collapse the pyramid
@@ -538,11 +824,14 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
 
     // Trim to the maximal source alpha, reloading images if needed
     ImageView<channel_type> alpha( patch_bbox.width(), patch_bbox.height() );
-    for( unsigned p=0; p<sources.size(); ++p ) {
-      if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
+    overlapping.clear();
+    find_sources( patch_bbox, overlapping );
+    for( unsigned k=0; k<overlapping.size(); ++k ) {
+      unsigned p = overlapping[k];
 
-      ImageView<channel_type> source_alpha = *alphas[p];
-      alphas[p].release();
+      Cache::Handle<AlphaGenerator> handle = alphas[p];
+      ImageView<channel_type> source_alpha = *handle;
+      handle.release();
 
       BBox2i overlap = patch_bbox;
       overlap.crop( bboxes[p] );
@@ -564,6 +853,51 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::blend_patch( BBox2i co
 }
 
 
+// Generates a full-resolution patch of the mosaic corresponding to the
+// given bounding box from the cutline weights.  Only the sources with
+// nonzero weight somewhere in the patch are read.
+template <class PixelT>
+vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::cutline_patch( BBox2i const& patch_bbox ) const {
+#if VW_DEBUG_LEVEL > 1
+  vw_out(DebugMessage, "mosaic") << "ImageComposite compositing patch " << patch_bbox << "..." << std::endl;
+#endif
+  typedef typename CompoundChannelCast<pixel_type, float32>::type sum_type;
+  ImageView<sum_type> sum( patch_bbox.width(), patch_bbox.height() );
+  ImageView<float32>  weight_sum( patch_bbox.width(), patch_bbox.height() );
+
+  std::vector<uint32> overlapping;
+  m_cutline_index.intersects( patch_bbox, overlapping );
+  for( unsigned k=0; k<overlapping.size(); ++k ) {
+    unsigned p = overlapping[k];
+    BBox2i overlap = patch_bbox;
+    overlap.crop( m_cutline_bboxes[p] );
+
+    Cache::Handle<CutlineGenerator> weight_handle = cutlines[p];
+    ImageView<float32> weight = *weight_handle;
+    weight_handle.release();
+    Cache::Handle<SourceGenerator> source_handle = sources[p];
+    ImageView<pixel_type> source = *source_handle;
+    source_handle.release();
+
+    for( int j=overlap.min().y(); j<overlap.max().y(); ++j ) {
+      for( int i=overlap.min().x(); i<overlap.max().x(); ++i ) {
+        float32 w = weight( i-bboxes[p].min().x(), j-bboxes[p].min().y() );
+        if( w <= 0 ) continue;
+        sum( i-patch_bbox.min().x(), j-patch_bbox.min().y() ) +=
+          w * channel_cast<float32>( source( i-bboxes[p].min().x(), j-bboxes[p].min().y() ) );
+        weight_sum( i-patch_bbox.min().x(), j-patch_bbox.min().y() ) += w;
+      }
+    }
+  }
+
+  for( int j=0; j<sum.rows(); ++j )
+    for( int i=0; i<sum.cols(); ++i )
+      if( weight_sum(i,j) > 0 )
+        sum(i,j) /= weight_sum(i,j);
+  return channel_cast<channel_type>( sum );
+}
+
+
 // Generates a full-resolution patch of the mosaic corresponding
 // to the given bounding box WITHOUT blending.
 template <class PixelT>
@@ -573,9 +907,11 @@ vw::ImageView<PixelT> vw::mosaic::ImageComposite<PixelT>::draft_patch( BBox2i co
 #endif
   ImageView<pixel_type> composite(patch_bbox.width(),patch_bbox.height());
 
-  // Add each image to the composite.
-  for( unsigned p=0; p<sources.size(); ++p ) {
-    if( ! patch_bbox.intersects( bboxes[p] ) ) continue;
+  // Add each image to the composite, in the order they were inserted.
+  std::vector<uint32> overlapping;
+  find_sources( patch_bbox, overlapping );
+  for( unsigned k=0; k<overlapping.size(); ++k ) {
+    unsigned p = overlapping[k];
     BBox2i bbox = patch_bbox;
     bbox.crop( bboxes[p] );
     PositionedImage<pixel_type> image( view_bbox.width(), view_bbox.height(),
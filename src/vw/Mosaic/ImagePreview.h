@@ -0,0 +1,484 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file ImagePreview.h
+///
+/// Progressive previews of very large images at any scale.
+///
+#ifndef __VW_MOSAIC_IMAGEPREVIEW_H__
+#define __VW_MOSAIC_IMAGEPREVIEW_H__
+
+#include <map>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vw/Core/Cache.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Mosaic/DiskImagePyramid.h>
+
+namespace vw { namespace mosaic {
+
+  /// Receives the tiles of an ImagePreview request as they are ready.
+  template <class PixelT>
+  class PreviewSink {
+  public:
+    virtual ~PreviewSink() {}
+
+    /// The tile covers bbox, in the pixels of the level which is
+    /// subsampled from the full image by the given scale.  This is
+    /// called from the preview's worker threads, possibly by several
+    /// of them at once.
+    virtual void operator()(ImageView<PixelT> const& tile, BBox2i const& bbox, int scale) = 0;
+  };
+
+  /// Serves any region of a very large image at any scale without
+  /// first writing a quadtree or a downsampled copy.
+  /// - Level 0 is the image itself, and each level after it is
+  ///   subsampled by 2 from the one before, until the image fits in
+  ///   one tile.  A level can be supplied, e.g. from a
+  ///   DiskImagePyramid, otherwise its tiles are made when they are
+  ///   first needed by averaging 2x2 blocks of the finer level, and
+  ///   kept in the system cache.  Pixels equal to the nodata value
+  ///   (or at or below it for scalar pixels) are left out.
+  /// - request() renders the tiles covering a region on a pool of
+  ///   worker threads and hands them to a PreviewSink, the tiles of a
+  ///   coarser level first so that something can be drawn at once.
+  ///   A new request, e.g. after the viewport changes, cancels the
+  ///   tiles of the last one which are not done yet.
+  template <class PixelT>
+  class ImagePreview {
+  public:
+    typedef PixelT pixel_type;
+
+    /// Preview image.  Use a NaN nodata value if the image has none.
+    ImagePreview(ImageViewRef<PixelT> const& image,
+                 double nodata_val = std::numeric_limits<double>::quiet_NaN(),
+                 int tile_size = 256, int num_threads = 0);
+
+    /// Preview the base image of a pyramid, reusing its levels which
+    /// are subsampled by a power of 2.
+    explicit ImagePreview(DiskImagePyramid<PixelT> const& pyramid,
+                          int tile_size = 256, int num_threads = 0);
+
+    /// Cancels the request in flight and waits for its workers.
+    ~ImagePreview();
+
+    /// Use image as the level subsampled by scale, which must be a
+    /// power of 2.  Must be called before the first request.
+    void add_level(ImageViewRef<PixelT> const& image, int scale);
+
+    int32 cols() const { return m_sizes[0].x(); }
+    int32 rows() const { return m_sizes[0].y(); }
+    int   tile_size () const { return m_tile_size; }
+    int   num_levels() const { return m_sizes.size(); }
+
+    /// The finest level subsampled by no more than scale.
+    int level_for_scale(double scale) const;
+
+    /// The bounding box of a level, in its own pixels.
+    BBox2i level_bbox(int level) const {
+      return BBox2i(0, 0, m_sizes[level].x(), m_sizes[level].y());
+    }
+
+    /// Render the tiles of the level for scale which cover region, a
+    /// box in full resolution pixels, and pass each to sink as it is
+    /// done.  The tiles of the level coarse_levels above that one are
+    /// rendered first.  Returns at once, after cancelling the request
+    /// before it; the returned token can be used to cancel this one.
+    boost::shared_ptr<CancelToken>
+    request(double scale, BBox2i const& region,
+            boost::shared_ptr<PreviewSink<PixelT> > const& sink, int coarse_levels = 2);
+
+    /// Cancel the request in flight, if any.
+    void cancel();
+
+    /// Wait until the tiles of all requests are done or discarded.
+    void join();
+
+    /// The same as DiskImagePyramid::get_image_clip(), rendered in the
+    /// calling thread.
+    void get_image_clip(double scale_in, BBox2i region_in, ImageView<PixelT> & clip,
+                        double & scale_out, BBox2i & region_out) const;
+
+    /// One tile of a level, in the calling thread.  Throws vw::Aborted
+    /// if token is cancelled before the tile is made.
+    ImageView<PixelT> tile(int level, Vector2i const& index,
+                           CancelToken const& token = CancelToken()) const;
+
+    /// The bounding box of a tile, in the pixels of its level.
+    BBox2i tile_bbox(int level, Vector2i const& index) const;
+
+  private:
+    /// Makes a tile of a level which was not supplied.
+    class TileGenerator {
+      ImagePreview const& m_preview;
+      int      m_level;
+      Vector2i m_index;
+    public:
+      typedef ImageView<PixelT> value_type;
+      TileGenerator(ImagePreview const& preview, int level, Vector2i const& index)
+        : m_preview(preview), m_level(level), m_index(index) {}
+      size_t size() const {
+        return size_t(m_preview.tile_bbox(m_level, m_index).area()) * sizeof(PixelT);
+      }
+      boost::shared_ptr<value_type> generate() const {
+        return boost::shared_ptr<value_type>(new value_type(m_preview.downsample_tile(m_level, m_index)));
+      }
+    };
+
+    /// Renders one tile of a request and passes it to the sink.
+    class TileTask : public Task {
+      ImagePreview const& m_preview;
+      int      m_level;
+      Vector2i m_index;
+      boost::shared_ptr<PreviewSink<PixelT> > m_sink;
+    public:
+      TileTask(ImagePreview const& preview, int level, Vector2i const& index,
+               boost::shared_ptr<PreviewSink<PixelT> > const& sink)
+        : m_preview(preview), m_level(level), m_index(index), m_sink(sink) {}
+      virtual void operator()();
+    };
+
+    typedef Cache::Handle<TileGenerator> TileHandle;
+
+    void init(Vector2i const& size, double nodata_val, int tile_size, int num_threads);
+
+    /// The cache line of a tile of a level which was not supplied.
+    TileHandle handle(int level, Vector2i const& index) const;
+
+    /// Make sure the finer tiles a lazy tile is made from are ready,
+    /// checking token between them, so that making the tile itself is
+    /// quick and cannot be cancelled half done.
+    void prepare(int level, Vector2i const& index, CancelToken const& token) const;
+
+    /// Average 2x2 blocks of the finer level into a tile.  Must not
+    /// throw, as it runs inside the cache.
+    ImageView<PixelT> downsample_tile(int level, Vector2i const& index) const;
+
+    /// Copy the part of a level in bbox, in the calling thread.
+    void render(int level, BBox2i const& bbox, ImageView<PixelT> & result,
+                CancelToken const& token) const;
+
+    /// The smallest box in the pixels of a level which covers region,
+    /// a box in full resolution pixels.
+    BBox2i level_region(int level, BBox2i const& region) const;
+
+    /// The tiles of a level which meet a box in its pixels.
+    BBox2i tile_range(int level, BBox2i const& bbox) const;
+
+    int    m_tile_size;
+    int    m_num_threads;
+    double m_nodata_val;
+    PixelT m_nodata_pixel;
+
+    /// The size of each level, and its image if it was supplied.
+    std::vector<Vector2i> m_sizes;
+    std::vector<ImageViewRef<PixelT> > m_levels;
+    std::vector<bool>     m_stored;
+
+    /// The cache lines of the tiles made so far of the other levels.
+    mutable std::vector<std::map<std::pair<int32,int32>, TileHandle> > m_tiles;
+    mutable Mutex m_tiles_mutex;
+
+    boost::scoped_ptr<FifoWorkQueue> m_queue;
+    boost::shared_ptr<CancelToken>   m_token;
+    Mutex m_request_mutex;
+  };
+
+
+  //#################################################################################
+  // Function definitions
+
+  template <class PixelT>
+  ImagePreview<PixelT>::ImagePreview(ImageViewRef<PixelT> const& image, double nodata_val,
+                                     int tile_size, int num_threads) {
+    init(Vector2i(image.cols(), image.rows()), nodata_val, tile_size, num_threads);
+    m_levels[0] = image;
+    m_stored[0] = true;
+  }
+
+  template <class PixelT>
+  ImagePreview<PixelT>::ImagePreview(DiskImagePyramid<PixelT> const& pyramid,
+                                     int tile_size, int num_threads) {
+    init(Vector2i(pyramid.cols(), pyramid.rows()), pyramid.get_nodata_val(),
+         tile_size, num_threads);
+    m_levels[0] = pyramid.bottom();
+    m_stored[0] = true;
+    for (int i = 1; i < pyramid.num_levels(); i++) {
+      int scale = pyramid.level_scale(i);
+      if ((scale & (scale-1)) == 0)
+        add_level(pyramid.level(i), scale);
+    }
+  }
+
+  template <class PixelT>
+  ImagePreview<PixelT>::~ImagePreview() {
+    cancel();
+    join();
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::init(Vector2i const& size, double nodata_val,
+                                  int tile_size, int num_threads) {
+    if (tile_size < 2)
+      vw_throw( ArgumentErr() << "ImagePreview: the tile size must be at least 2.\n" );
+    if (size.x() <= 0 || size.y() <= 0)
+      vw_throw( ArgumentErr() << "ImagePreview: the image is empty.\n" );
+    m_tile_size   = tile_size;
+    m_num_threads = num_threads > 0 ? num_threads : vw_settings().default_num_threads();
+    m_nodata_val  = nodata_val;
+    set_all(m_nodata_pixel, nodata_val);
+
+    m_sizes.push_back(size);
+    while (m_sizes.back().x() > tile_size || m_sizes.back().y() > tile_size) {
+      Vector2i const& last = m_sizes.back();
+      m_sizes.push_back(Vector2i((last.x()+1)/2, (last.y()+1)/2));
+    }
+    m_levels.resize(m_sizes.size());
+    m_stored.resize(m_sizes.size(), false);
+    m_tiles .resize(m_sizes.size());
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::add_level(ImageViewRef<PixelT> const& image, int scale) {
+    VW_ASSERT( scale >= 1 && (scale & (scale-1)) == 0,
+               ArgumentErr() << "ImagePreview: the scale of a level must be a power of 2." );
+    VW_ASSERT( !m_queue, LogicErr() << "ImagePreview: add levels before the first request." );
+    int level = 0;
+    while ((1 << level) < scale)
+      level++;
+    if (level >= num_levels())
+      return; // Coarser than needed
+    m_levels[level] = image;
+    m_stored[level] = true;
+    m_sizes [level] = Vector2i(image.cols(), image.rows());
+  }
+
+  template <class PixelT>
+  int ImagePreview<PixelT>::level_for_scale(double scale) const {
+    int level = 0;
+    while (level+1 < num_levels() && double(1 << (level+1)) <= scale)
+      level++;
+    return level;
+  }
+
+  template <class PixelT>
+  BBox2i ImagePreview<PixelT>::tile_bbox(int level, Vector2i const& index) const {
+    BBox2i bbox(index.x()*m_tile_size, index.y()*m_tile_size, m_tile_size, m_tile_size);
+    bbox.crop(level_bbox(level));
+    return bbox;
+  }
+
+  template <class PixelT>
+  BBox2i ImagePreview<PixelT>::level_region(int level, BBox2i const& region) const {
+    int32 s = 1 << level;
+    BBox2i bbox(Vector2i(region.min().x() / s, region.min().y() / s),
+                Vector2i((region.max().x() + s - 1) / s, (region.max().y() + s - 1) / s));
+    bbox.crop(level_bbox(level));
+    return bbox;
+  }
+
+  template <class PixelT>
+  BBox2i ImagePreview<PixelT>::tile_range(int level, BBox2i const& bbox) const {
+    BBox2i box = bbox;
+    box.crop(level_bbox(level));
+    if (box.empty())
+      return BBox2i();
+    return BBox2i(Vector2i(box.min().x() / m_tile_size, box.min().y() / m_tile_size),
+                  Vector2i((box.max().x() + m_tile_size - 1) / m_tile_size,
+                           (box.max().y() + m_tile_size - 1) / m_tile_size));
+  }
+
+  template <class PixelT>
+  typename ImagePreview<PixelT>::TileHandle
+  ImagePreview<PixelT>::handle(int level, Vector2i const& index) const {
+    Mutex::Lock lock(m_tiles_mutex);
+    TileHandle & h = m_tiles[level][std::make_pair(index.x(), index.y())];
+    if (!h.attached())
+      h = vw_system_cache().insert(TileGenerator(*this, level, index));
+    return h;
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::prepare(int level, Vector2i const& index,
+                                     CancelToken const& token) const {
+    if (m_stored[level])
+      return;
+    if (handle(level, index).valid())
+      return;
+    BBox2i range = tile_range(level-1, tile_bbox(level, index) * 2);
+    for (int32 j = range.min().y(); j < range.max().y(); j++)
+      for (int32 i = range.min().x(); i < range.max().x(); i++) {
+        token.throw_if_cancelled();
+        prepare(level-1, Vector2i(i, j), token);
+      }
+    token.throw_if_cancelled();
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::render(int level, BBox2i const& bbox, ImageView<PixelT> & result,
+                                    CancelToken const& token) const {
+    result.set_size(bbox.width(), bbox.height());
+    if (m_stored[level]) {
+      result = crop(m_levels[level], bbox);
+      return;
+    }
+    BBox2i range = tile_range(level, bbox);
+    for (int32 j = range.min().y(); j < range.max().y(); j++)
+      for (int32 i = range.min().x(); i < range.max().x(); i++) {
+        ImageView<PixelT> t = tile(level, Vector2i(i, j), token);
+        BBox2i tb = tile_bbox(level, Vector2i(i, j));
+        BBox2i overlap = tb;
+        overlap.crop(bbox);
+        crop(result, overlap - bbox.min()) = crop(t, overlap - tb.min());
+      }
+  }
+
+  template <class PixelT>
+  ImageView<PixelT> ImagePreview<PixelT>::tile(int level, Vector2i const& index,
+                                               CancelToken const& token) const {
+    if (m_stored[level])
+      return crop(m_levels[level], tile_bbox(level, index));
+    prepare(level, index, token);
+    TileHandle h = handle(level, index);
+    ImageView<PixelT> result = *h; // Shares the data, so the cache may drop it
+    h.release();
+    return result;
+  }
+
+  template <class PixelT>
+  ImageView<PixelT> ImagePreview<PixelT>::downsample_tile(int level, Vector2i const& index) const {
+    typedef typename CompoundChannelCast<PixelT, double>::type AccumT;
+    typedef typename CompoundChannelType<PixelT>::type channel_type;
+
+    BBox2i bbox = tile_bbox(level, index);
+    ImageView<PixelT> result(bbox.width(), bbox.height());
+    fill(result, m_nodata_pixel);
+    try {
+      BBox2i fine_bbox = bbox * 2;
+      fine_bbox.crop(level_bbox(level-1));
+      ImageView<PixelT> fine;
+      render(level-1, fine_bbox, fine, CancelToken());
+      ImageViewRef<PixelT> fine_ref = fine;
+      ImageView<PixelMask<PixelT> > masked = create_custom_mask(fine_ref, m_nodata_val);
+
+      for (int32 row = 0; row < result.rows(); row++) {
+        for (int32 col = 0; col < result.cols(); col++) {
+          AccumT sum = AccumT();
+          int count = 0;
+          for (int32 y = 2*row; y < std::min(2*row+2, fine.rows()); y++)
+            for (int32 x = 2*col; x < std::min(2*col+2, fine.cols()); x++) {
+              if (!is_valid(masked(x, y)))
+                continue;
+              sum += channel_cast<double>(fine(x, y));
+              count++;
+            }
+          if (count > 0) {
+            AccumT mean = sum / double(count);
+            result(col, row) = channel_cast_round_and_clamp_if_int<channel_type>(mean);
+          }
+        }
+      }
+    } catch (const std::exception& e) {
+      // The cache line stays locked if a generator throws.
+      vw_out(ErrorMessage, "mosaic") << "ImagePreview: failed making tile " << index
+                                     << " of level " << level << ": " << e.what() << "\n";
+    }
+    return result;
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::TileTask::operator()() {
+    try {
+      ImageView<PixelT> t = m_preview.tile(m_level, m_index, *cancel_token());
+      if (!is_cancelled())
+        (*m_sink)(t, m_preview.tile_bbox(m_level, m_index), 1 << m_level);
+    } catch (const Aborted&) {
+      // Cancelled by a newer request
+    } catch (const std::exception& e) {
+      vw_out(ErrorMessage, "mosaic") << "ImagePreview: " << e.what() << "\n";
+    }
+  }
+
+  template <class PixelT>
+  boost::shared_ptr<CancelToken>
+  ImagePreview<PixelT>::request(double scale, BBox2i const& region,
+                                boost::shared_ptr<PreviewSink<PixelT> > const& sink,
+                                int coarse_levels) {
+    Mutex::Lock lock(m_request_mutex);
+    if (m_token)
+      m_token->cancel();
+    m_token.reset(new CancelToken());
+    if (!m_queue)
+      m_queue.reset(new FifoWorkQueue(m_num_threads));
+
+    int level  = level_for_scale(scale);
+    int coarse = std::min(level + std::max(coarse_levels, 0), num_levels()-1);
+    std::vector<int> levels;
+    if (coarse > level)
+      levels.push_back(coarse);
+    levels.push_back(level);
+
+    for (size_t l = 0; l < levels.size(); l++) {
+      BBox2i range = tile_range(levels[l], level_region(levels[l], region));
+      for (int32 j = range.min().y(); j < range.max().y(); j++)
+        for (int32 i = range.min().x(); i < range.max().x(); i++) {
+          boost::shared_ptr<Task> task(new TileTask(*this, levels[l], Vector2i(i, j), sink));
+          task->set_cancel_token(m_token);
+          task->set_priority(levels[l] == level ? Task::PriorityNormal : Task::PriorityHigh);
+          m_queue->add_task(task);
+        }
+    }
+    return m_token;
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::cancel() {
+    Mutex::Lock lock(m_request_mutex);
+    if (m_token)
+      m_token->cancel();
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::join() {
+    if (m_queue)
+      m_queue->join_all();
+  }
+
+  template <class PixelT>
+  void ImagePreview<PixelT>::get_image_clip(double scale_in, BBox2i region_in,
+                                            ImageView<PixelT> & clip,
+                                            double & scale_out, BBox2i & region_out) const {
+    int level = level_for_scale(scale_in);
+    region_in.crop(level_bbox(0));
+    scale_out  = 1 << level;
+    region_out = level_region(level, region_in);
+    render(level, region_out, clip, CancelToken());
+  }
+
+}} // End namespace vw::mosaic
+
+#endif // __VW_MOSAIC_IMAGEPREVIEW_H__
@@ -20,6 +20,7 @@
 
 #include <boost/filesystem/path.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/filesystem/operations.hpp>
 namespace fs = boost::filesystem;
 
 #include <vw/FileIO/DiskImageResource.h>
@@ -84,14 +85,36 @@ namespace mosaic {
     return boost::shared_ptr<DstImageResource>( DiskImageResource::create( info.filepath+info.filetype, format ) );
   }
 
+  boost::shared_ptr<SrcImageResource> QuadTreeGenerator::default_tile_reader_func::operator()( QuadTreeGenerator const&, TileInfo const& info ) {
+    std::vector<std::string> types;
+    if( info.filetype.empty() ) {
+      types.push_back( ".png" );
+      types.push_back( ".jpg" );
+    }
+    else {
+      types.push_back( info.filetype );
+    }
+    for( size_t i=0; i<types.size(); ++i ) {
+      if( fs::exists( fs::path( info.filepath + types[i] ) ) )
+        return boost::shared_ptr<SrcImageResource>( DiskImageResource::open( info.filepath + types[i] ) );
+    }
+    return boost::shared_ptr<SrcImageResource>();
+  }
+
   void QuadTreeGenerator::generate( const ProgressCallback &progress_callback ) {
     ScopedWatch sw("QuadTreeGenerator::generate");
+    VW_ASSERT( m_dirty_bbox.empty() || ! m_crop_images,
+               ArgumentErr() << "QuadTreeGenerator: Incremental updates need tiles which are not cropped." );
     int32 tree_levels = get_tree_levels();
 
     vw_out(DebugMessage, "mosaic") << "Using tile size: "               << m_tile_size << " pixels" << std::endl;
     vw_out(DebugMessage, "mosaic") << "Generating tile files of type: " << m_file_type << std::endl;
     vw_out(DebugMessage, "mosaic") << "Generating quadtree with "       << tree_levels << " levels." << std::endl;
 
+    m_tiles_written = 0;
+    m_pixels_written = 0;
+    m_write_microseconds = 0;
+
     BBox2i region_bbox = BBox2i(0,0,m_tile_size,m_tile_size) * (1<<(tree_levels-1));
     m_processor->generate( region_bbox, progress_callback );
 
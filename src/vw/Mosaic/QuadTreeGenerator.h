@@ -23,42 +23,36 @@
 #ifndef __VW_MOSAIC_QUADTREEGENERATOR_H__
 #define __VW_MOSAIC_QUADTREEGENERATOR_H__
 
+#include <atomic>
+#include <deque>
 #include <vector>
 #include <map>
 #include <string>
 #include <fstream>
+#include <exception>
 
 #include <boost/function.hpp>
 
+#include <vw/Core/Condition.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Settings.h>
 #include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/AntiAliasing.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/SparseImageCheck.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
+#include <vw/Image/ImageIO.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/Filter.h>
+#include <vw/Image/Pyramid.h>
 
 
 namespace vw {
 namespace mosaic {
 
-  // This feature, or something like it, should be implemented better and
-  // moved somewhere into the Image module.
-  /// ???
-  template <class PixelT>
-  ImageView<PixelT> box_subsample( ImageView<PixelT> const& image, Vector2i const& scale ) {
-    std::vector<double> xkernel(scale.x()), ykernel(scale.y());
-    for( int x=0; x<scale.x(); ++x ) 
-      xkernel[x] = 1.0 / scale.x();
-    for( int y=0; y<scale.y(); ++y ) 
-      ykernel[y] = 1.0 / scale.y();
-    
-    ImageView<PixelT> result( image.cols()/scale.x(), image.rows()/scale.y() );
-    rasterize( subsample( separable_convolution_filter( image, xkernel, ykernel, scale.x()-1, scale.y()-1 ), scale.x(), scale.y() ), result );
-    return result;
-  }
-  
   /// A class that generates filesystem-based quadtrees of large images.
   class QuadTreeGenerator {
   public:
@@ -73,11 +67,22 @@ namespace mosaic {
         branch_func_type;
     typedef boost::function<boost::shared_ptr<DstImageResource>(QuadTreeGenerator const&, TileInfo const&, ImageFormat const&)> 
         tile_resource_func_type;
+    typedef boost::function<boost::shared_ptr<SrcImageResource>(QuadTreeGenerator const&, TileInfo const&)> 
+        tile_reader_func_type;
     typedef boost::function<void(QuadTreeGenerator const&, TileInfo const&)> 
         metadata_func_type;
     typedef boost::function<bool(BBox2i const&)> 
         sparse_image_check_type;
 
+    /// The tiles written by the last call to generate(), for measuring
+    /// the throughput of tile encoding.
+    struct WriteStats {
+      uint64 tiles;   ///< Tiles encoded and written
+      uint64 pixels;  ///< Pixels in those tiles
+      double seconds; ///< Time spent encoding and writing, summed over all threads
+      WriteStats() : tiles(0), pixels(0), seconds(0) {}
+    };
+
     class ProcessorBase {
     protected:
       QuadTreeGenerator *qtree;
@@ -93,15 +98,24 @@ namespace mosaic {
         m_tile_size( 256 ),
         m_file_type( "png" ),
         m_crop_bbox(),
+        m_dirty_bbox(),
         m_crop_images( false ),
         m_cull_images( false ),
+        m_num_threads( 1 ),
+        m_num_encode_threads( 0 ),
+        m_use_resample_filter( false ),
+        m_resample_filter( AreaResampleFilter ),
         m_dimensions( image.impl().cols(), image.impl().rows() ),
         m_processor( new Processor<typename ImageT::pixel_type>( this, image.impl() ) ),
         m_image_path_func( simple_image_path() ),
         m_branch_func( default_branch_func() ),
         m_tile_resource_func( default_tile_resource_func() ),
+        m_tile_reader_func( default_tile_reader_func() ),
         m_metadata_func(),
-        m_sparse_image_check( SparseImageCheck<ImageT>(image.impl()) )
+        m_sparse_image_check( SparseImageCheck<ImageViewRef<typename ImageT::pixel_type> >( image.impl() ) ),
+        m_tiles_written( 0 ),
+        m_pixels_written( 0 ),
+        m_write_microseconds( 0 )
     {}
 
     virtual ~QuadTreeGenerator() {}
@@ -112,6 +126,54 @@ namespace mosaic {
 
     void generate( const ProgressCallback &progress_callback = ProgressCallback::dummy_instance() );
 
+    /// Build the tree with this many threads.  With more than one the
+    /// leaf tiles are rendered and written in parallel and each parent
+    /// is built from its children's tiles as soon as they are done,
+    /// which writes the tiles in a different order.  The callbacks are
+    /// then called from several threads, though a tile's metadata is
+    /// still made after that of its children.  Zero means the default
+    /// number of threads.
+    void set_num_threads( int32 num_threads ) {
+      m_num_threads = num_threads > 0 ? num_threads : vw_settings().default_num_threads();
+    }
+
+    /// When the tree is built with one thread, encode and write the
+    /// tiles on this many more threads while that thread renders the
+    /// next ones.  The metadata is still made by the rendering thread,
+    /// in the same order as before, once each tile is written.  With
+    /// several threads each worker encodes its own tiles, and this is
+    /// not used.  Zero, the default, writes tiles as they are rendered.
+    void set_num_encode_threads( int32 num_threads ) {
+      m_num_encode_threads = num_threads > 0 ? num_threads : 0;
+    }
+
+    /// Reduce the source for the leaf tiles, and the children for their
+    /// parents, with this polyphase filter rather than by taking every
+    /// n-th pixel and averaging blocks of pixels.  See
+    /// polyphase_resample().
+    void set_resample_filter( ResampleFilter filter ) {
+      m_use_resample_filter = true;
+      m_resample_filter = filter;
+    }
+
+    /// Counts of the tiles written by the last call to generate().
+    WriteStats get_write_stats() const {
+      WriteStats stats;
+      stats.tiles   = m_tiles_written;
+      stats.pixels  = m_pixels_written;
+      stats.seconds = m_write_microseconds * 1e-6;
+      return stats;
+    }
+
+    /// Regenerate only the tiles whose region overlaps this box in the
+    /// source image, and their ancestors, in an existing tree.  The
+    /// unchanged tiles that their parents need are read back with the
+    /// tile reader function.  The tiles must not have been cropped.  An
+    /// empty box, the default, generates the whole tree.
+    void set_dirty_bbox( BBox2i const& bbox ) {
+      m_dirty_bbox = bbox;
+    }
+
     void set_crop_bbox( BBox2i const& bbox ) {
       VW_ASSERT( BBox2i(Vector2i(), m_dimensions).contains(bbox),
                  ArgumentErr() << "Requested QuadTree bounding box exceeds source dimensions!" );
@@ -130,11 +192,14 @@ namespace mosaic {
     // Simple "get" functions
     std::string const& get_name()        const { return m_tree_name;   }
     BBox2i      const& get_crop_bbox()   const { return m_crop_bbox;   }
+    BBox2i      const& get_dirty_bbox()  const { return m_dirty_bbox;  }
     std::string const& get_file_type()   const { return m_file_type;   }
     int32              get_tile_size()   const { return m_tile_size;   }
     Vector2i    const& get_dimensions()  const { return m_dimensions;  }
     bool               get_crop_images() const { return m_crop_images; }
     bool               get_cull_images() const { return m_cull_images; }
+    int32              get_num_threads() const { return m_num_threads; }
+    int32       get_num_encode_threads() const { return m_num_encode_threads; }
     sparse_image_check_type const& sparse_image_check() const { return m_sparse_image_check; }
 
 
@@ -147,6 +212,7 @@ namespace mosaic {
     void set_image_path_func   (image_path_func_type           image_path_func   ) {m_image_path_func    = image_path_func;   }
     void set_branch_func       (branch_func_type        const& branch_func       ) {m_branch_func        = branch_func;       }
     void set_tile_resource_func(tile_resource_func_type const& tile_resource_func) {m_tile_resource_func = tile_resource_func;}
+    void set_tile_reader_func  (tile_reader_func_type   const& tile_reader_func  ) {m_tile_reader_func   = tile_reader_func;  }
     void set_metadata_func     (metadata_func_type             metadata_func     ) {m_metadata_func      = metadata_func;     }
     void set_sparse_image_check(sparse_image_check_type const& func              ) {m_sparse_image_check = func;              }
 
@@ -163,6 +229,11 @@ namespace mosaic {
       return m_tile_resource_func( *this, info, format );
     }
 
+    /// Open an existing tile, or return an empty pointer if there is none.
+    boost::shared_ptr<SrcImageResource> tile_reader(TileInfo const& info) const {
+      return m_tile_reader_func( *this, info );
+    }
+
     void make_tile_metadata( TileInfo const& info ) const {
       if( m_metadata_func ) {
         m_metadata_func( *this, info );
@@ -199,6 +270,12 @@ namespace mosaic {
       boost::shared_ptr<DstImageResource> operator()( QuadTreeGenerator const& qtree, TileInfo const& info, ImageFormat const& format );
     };
 
+    /// The default reader function, opens the tile as a disk image.  An
+    /// empty file type, as for the "auto" type, tries ".png" and ".jpg".
+    struct default_tile_reader_func {
+      boost::shared_ptr<SrcImageResource> operator()( QuadTreeGenerator const& qtree, TileInfo const& info );
+    };
+
   protected:
   
     /// Secret class that contains all the high level tree generation logic
@@ -206,17 +283,75 @@ namespace mosaic {
     class Processor : public ProcessorBase {
       ImageViewRef<PixelT> m_source;
 
+      /// A tile of the tree when it is built bottom up.  Each tile
+      /// holds the images of its finished children until the last one
+      /// arrives, and is then finished by the thread which provided it.
+      struct Node {
+        TileInfo info;
+        boost::shared_ptr<Node> parent;
+        int32 pending; ///< Children not yet finished, plus one while the walk is in it
+        std::vector<std::pair<BBox2i, ImageView<PixelT> > > children;
+        Node() : pending(0) {}
+      };
+
+      /// Renders, writes and hands up one leaf tile.
+      class LeafTask : public Task {
+        Processor &m_processor;
+        boost::shared_ptr<Node> m_node;
+      public:
+        LeafTask( Processor &processor, boost::shared_ptr<Node> const& node )
+          : m_processor( processor ), m_node( node ) {}
+        virtual void operator()() { m_processor.run_leaf( m_node ); }
+      };
+
+      /// A tile handed to the encoder threads.
+      struct EncodeJob {
+        TileInfo info;
+        ImageView<PixelT> image;
+        bool done;
+        std::exception_ptr error;
+        EncodeJob() : done(false) {}
+      };
+
+      /// Encodes and writes one tile.
+      class EncodeTask : public Task {
+        Processor &m_processor;
+        boost::shared_ptr<EncodeJob> m_job;
+      public:
+        EncodeTask( Processor &processor, boost::shared_ptr<EncodeJob> const& job )
+          : m_processor( processor ), m_job( job ) {}
+        virtual void operator()() { m_processor.run_encode( m_job ); }
+      };
+
+      // State of a bottom-up build, guarded by m_mutex
+      Mutex     m_mutex;
+      Condition m_leaf_done;
+      int32     m_leaves_in_flight;
+      double    m_done_area, m_total_area;
+      std::exception_ptr m_error;
+
+      // State of the encoder threads.  The jobs, in the order their
+      // metadata is to be made, are guarded by m_mutex.
+      boost::shared_ptr<FifoWorkQueue> m_encode_queue;
+      std::deque<boost::shared_ptr<EncodeJob> > m_encode_jobs;
+      Condition m_encode_done;
+
     public:
       /// Construct the image with the qtree object and the full resolution source image
       template <class ImageT>
       Processor( QuadTreeGenerator *qtree, ImageT const& source )
-        : ProcessorBase( qtree ), m_source( source )
+        : ProcessorBase( qtree ), m_source( source ),
+          m_leaves_in_flight( 0 ), m_done_area( 0 ), m_total_area( 0 )
       {}
 
       /// Top level call to generate a qtree from a specified region of the input image.
       void generate( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
-        // Just redirect to the branch function leaving the name blank.
-        generate_branch( "", region_bbox, progress_callback );
+        if( qtree->get_num_threads() > 1 )
+          generate_bottom_up( region_bbox, progress_callback );
+        else if( qtree->get_num_encode_threads() > 0 )
+          generate_encoding( region_bbox, progress_callback );
+        else // Just redirect to the branch function leaving the name blank.
+          generate_branch( "", region_bbox, progress_callback );
       }
 
       /// Generate all images and metadata files (all the way down the tree) for a named region of the input image.
@@ -227,38 +362,17 @@ namespace mosaic {
 
         ImageView<PixelT> image;
         TileInfo info;
-        info.name = name;
-        info.region_bbox = region_bbox;
-
-        BBox2i crop_bbox(Vector2i(), qtree->get_dimensions());
-        if( ! qtree->get_crop_bbox().empty() ) 
-          crop_bbox.crop( qtree->get_crop_bbox() );
-        info.image_bbox = info.region_bbox;
-        info.image_bbox.crop( crop_bbox );
-
-        if( info.image_bbox.empty() ) {
-          if( ! (qtree->get_crop_images() || qtree->get_cull_images()) )
-            image.set_size( qtree->get_tile_size(), qtree->get_tile_size() );
+        if( ! start_tile( name, region_bbox, info, image ) )
           return image;
-        }
-
-        if( qtree->m_sparse_image_check && ! qtree->m_sparse_image_check(info.region_bbox) ) 
-            return image;
-
-        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
+        if( is_clean( info ) )
+          return existing_tile( info );
 
         // Call function to compute which children belong to this tile.
         // - Each child contains a name and a bounding box.
         std::vector<std::pair<std::string, BBox2i> > children = qtree->m_branch_func(*qtree, info.name, info.region_bbox);
         
         if( children.empty() ) { // This is the highest resolution level of tiles (bottom of tree)
-          image = crop( m_source, info.image_bbox ); // Extract portion of source image
-          if( info.image_bbox != info.region_bbox ) { // Pad with zero pixels if needed
-            image = edge_extend( image, info.region_bbox - info.image_bbox.min(), ZeroEdgeExtension() );
-          }
-          if( (info.region_bbox.width() != qtree->m_tile_size) || (info.region_bbox.height() != qtree->m_tile_size) ) {
-            image = subsample( image, scale.x(), scale.y() ); // Resample image to the output tile size
-          }
+          image = leaf_image( info );
         }
         else { // One or more sub-levels below this image, generate and copy from them one at a time
           image.set_size(qtree->m_tile_size,qtree->m_tile_size); // Initialize empty image
@@ -280,11 +394,113 @@ namespace mosaic {
             if( ! child.is_valid_image() ) 
               continue;
             
-            BBox2i dst_bbox = elem_quot( children[i].second - info.region_bbox.min(), scale );            // Compute this child's ROI in the current tile.
-            crop(image,dst_bbox) = box_subsample( child, elem_quot(qtree->m_tile_size,dst_bbox.size()) ); // Copy and resample the child image to the destination ROI
+            insert_child( image, info, children[i].second, child );
           }
         }
 
+        finish_tile( info, image );
+        progress_callback.report_progress(1);
+        return image;
+      }
+
+    private:
+
+      /// Fill in the TileInfo for a tile.  Returns false if there is no
+      /// tile there, in which case image is set to a blank tile if the
+      /// parent still expects one.
+      bool start_tile( std::string const& name, BBox2i const& region_bbox, TileInfo &info, ImageView<PixelT> &image ) const {
+        info.name = name;
+        info.region_bbox = region_bbox;
+
+        BBox2i crop_bbox(Vector2i(), qtree->get_dimensions());
+        if( ! qtree->get_crop_bbox().empty() ) 
+          crop_bbox.crop( qtree->get_crop_bbox() );
+        info.image_bbox = info.region_bbox;
+        info.image_bbox.crop( crop_bbox );
+
+        if( info.image_bbox.empty() ) {
+          if( ! (qtree->get_crop_images() || qtree->get_cull_images()) )
+            image.set_size( qtree->get_tile_size(), qtree->get_tile_size() );
+          return false;
+        }
+
+        if( qtree->m_sparse_image_check && ! qtree->m_sparse_image_check(info.region_bbox) ) 
+          return false;
+        return true;
+      }
+
+      /// True if an incremental update leaves this tile as it is.
+      bool is_clean( TileInfo const& info ) const {
+        return ! qtree->m_dirty_bbox.empty() && ! qtree->m_dirty_bbox.intersects( info.region_bbox );
+      }
+
+      /// Read back a tile left by an incremental update, or return an
+      /// empty image if there is none, e.g. because it was culled.
+      ImageView<PixelT> existing_tile( TileInfo info ) const {
+        info.filetype = ( qtree->m_file_type == "auto" ) ? "" : "." + qtree->m_file_type;
+        info.filepath = qtree->m_image_path_func( *qtree, info.name );
+        ImageView<PixelT> image;
+        boost::shared_ptr<SrcImageResource> r = qtree->m_tile_reader_func( *qtree, info );
+        if( ! r )
+          return image;
+        read_image( image, *r );
+        if( image.cols() != qtree->m_tile_size || image.rows() != qtree->m_tile_size )
+          vw_throw( IOErr() << "QuadTreeGenerator: Existing tile \"" << info.filepath
+                            << "\" is not " << qtree->m_tile_size << " pixels square." );
+        return image;
+      }
+
+      /// Render a tile at the bottom of the tree from the source.
+      ImageView<PixelT> leaf_image( TileInfo const& info ) const {
+        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
+        ImageView<PixelT> image = crop( m_source, info.image_bbox ); // Extract portion of source image
+        if( info.image_bbox != info.region_bbox ) { // Pad with zero pixels if needed
+          image = edge_extend( image, info.region_bbox - info.image_bbox.min(), ZeroEdgeExtension() );
+        }
+        if( (info.region_bbox.width() != qtree->m_tile_size) || (info.region_bbox.height() != qtree->m_tile_size) ) {
+          if( qtree->m_use_resample_filter )
+            return filtered_leaf_image( info, scale );
+          image = subsample( image, scale.x(), scale.y() ); // Resample image to the output tile size
+        }
+        return image;
+      }
+
+      /// Render a reduced leaf tile with the polyphase filter.  The
+      /// filter reads past the source's edges, so only the pixels that
+      /// subsample() would have taken from the source are kept.
+      ImageView<PixelT> filtered_leaf_image( TileInfo const& info, Vector2i const& scale ) const {
+        ImageView<PixelT> image( qtree->m_tile_size, qtree->m_tile_size );
+        BBox2i tile_bbox( elem_quot( info.region_bbox.min(), scale ), Vector2i( qtree->m_tile_size, qtree->m_tile_size ) );
+        BBox2i data_bbox( elem_quot( info.image_bbox.min() + scale - Vector2i(1,1), scale ),
+                          elem_quot( info.image_bbox.max() + scale - Vector2i(1,1), scale ) );
+        data_bbox.crop( tile_bbox );
+        if( data_bbox.empty() )
+          return image;
+        crop( image, data_bbox - tile_bbox.min() ) =
+          crop( polyphase_resample( m_source, 1.0/scale.x(), 1.0/scale.y(),
+                                    (m_source.cols() + scale.x() - 1) / scale.x(), (m_source.rows() + scale.y() - 1) / scale.y(),
+                                    qtree->m_resample_filter, ConstantEdgeExtension() ),
+                data_bbox );
+        return image;
+      }
+
+      /// Copy and resample a child's image into its part of the tile.
+      void insert_child( ImageView<PixelT> &image, TileInfo const& info,
+                         BBox2i const& child_region, ImageView<PixelT> const& child ) const {
+        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
+        BBox2i dst_bbox = elem_quot( child_region - info.region_bbox.min(), scale );
+        if( qtree->m_use_resample_filter )
+          crop(image,dst_bbox) = polyphase_resample( child, double(dst_bbox.width())/child.cols(), double(dst_bbox.height())/child.rows(),
+                                                     dst_bbox.width(), dst_bbox.height(), qtree->m_resample_filter,
+                                                     ConstantEdgeExtension() );
+        else
+          crop(image,dst_bbox) = box_subsample( child, elem_quot(qtree->m_tile_size,dst_bbox.size()) );
+      }
+
+      /// Crop or cull the tile as requested, write it to disk, and make
+      /// its metadata.
+      void finish_tile( TileInfo &info, ImageView<PixelT> const& image ) {
+        Vector2i scale = info.region_bbox.size() / qtree->m_tile_size;
         ImageView<PixelT> cropped_image = image;
         if( qtree->m_crop_images || qtree->m_cull_images ) {
         
@@ -317,18 +533,247 @@ namespace mosaic {
 
         // Retrieve the output path for this tile and write it to disk
         info.filepath = qtree->m_image_path_func( *qtree, info.name );
-        if( cropped_image.is_valid_image() ) {
-          ScopedWatch sw("QuadTreeGenerator::write_tile");
-          boost::shared_ptr<DstImageResource> r = qtree->m_tile_resource_func( *qtree, info, cropped_image.format() );
-          write_image( *r, cropped_image );
+        if( m_encode_queue ) {
+          queue_encode( info, cropped_image );
+          return;
         }
+        if( cropped_image.is_valid_image() )
+          write_tile( info, cropped_image );
         // Call function to take care of any extra tile metadata tasks
         if( qtree->m_metadata_func ) 
           qtree->m_metadata_func( *qtree, info );
+      }
+
+      /// Encode a tile and write it out, counting the time it takes.
+      void write_tile( TileInfo const& info, ImageView<PixelT> const& image ) const {
+        ScopedWatch sw("QuadTreeGenerator::write_tile");
+        uint64 start = Stopwatch::microtime();
+        {
+          boost::shared_ptr<DstImageResource> r = qtree->m_tile_resource_func( *qtree, info, image.format() );
+          write_image( *r, image );
+        } // Some resources only finish writing when they are destroyed.
+        qtree->m_tiles_written++;
+        qtree->m_pixels_written += uint64(image.cols()) * image.rows();
+        qtree->m_write_microseconds += Stopwatch::microtime() - start;
+      }
+
+      /// Build the tree top down, as generate_branch() does, with the
+      /// tiles encoded on the encoder threads.  A few tiles per encoder
+      /// thread may be waiting to be written at once.
+      void generate_encoding( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
+        m_encode_queue.reset( new FifoWorkQueue( qtree->get_num_encode_threads() ) );
+        std::exception_ptr error;
+        try {
+          generate_branch( "", region_bbox, progress_callback );
+          finish_encoded( 0 );
+        } catch (...) {
+          error = std::current_exception();
+        }
+        m_encode_queue->join_all();
+        m_encode_queue.reset();
+        m_encode_jobs.clear();
+        if( error )
+          std::rethrow_exception( error );
+      }
+
+      void queue_encode( TileInfo const& info, ImageView<PixelT> const& image ) {
+        boost::shared_ptr<EncodeJob> job( new EncodeJob );
+        job->info  = info;
+        job->image = image;
+        job->done  = ! image.is_valid_image(); // Culled, but its metadata is still made
+        {
+          Mutex::Lock lock( m_mutex );
+          m_encode_jobs.push_back( job );
+        }
+        if( ! job->done )
+          m_encode_queue->add_task( boost::shared_ptr<Task>( new EncodeTask( *this, job ) ) );
+        finish_encoded( 4*qtree->get_num_encode_threads() );
+      }
+
+      void run_encode( boost::shared_ptr<EncodeJob> const& job ) {
+        try {
+          write_tile( job->info, job->image );
+        } catch (...) {
+          job->error = std::current_exception();
+        }
+        Mutex::Lock lock( m_mutex );
+        job->done = true;
+        job->image.reset();
+        m_encode_done.notify_all();
+      }
+
+      /// Make the metadata of the written tiles at the front of the
+      /// queue, waiting until no more than max_pending remain.  Throws
+      /// the error of a tile that could not be written.
+      void finish_encoded( size_t max_pending ) {
+        while( true ) {
+          boost::shared_ptr<EncodeJob> job;
+          {
+            Mutex::Lock lock( m_mutex );
+            while( m_encode_jobs.size() > max_pending && ! m_encode_jobs.front()->done )
+              m_encode_done.wait( lock );
+            if( m_encode_jobs.empty() || ! m_encode_jobs.front()->done )
+              return;
+            job = m_encode_jobs.front();
+            m_encode_jobs.pop_front();
+          }
+          if( job->error )
+            std::rethrow_exception( job->error );
+          if( qtree->m_metadata_func )
+            qtree->m_metadata_func( *qtree, job->info );
+        }
+      }
 
+      /// Build the tree from the leaves up.  The calling thread walks
+      /// the tree depth first and queues each leaf; the worker threads
+      /// render and write the leaves, and build and write each parent
+      /// from its children's tiles once all of them are done.  At most
+      /// a few leaves per thread are in flight, so only the tiles near
+      /// the walk are held in memory.
+      void generate_bottom_up( BBox2i const& region_bbox, const ProgressCallback &progress_callback ) {
+        progress_callback.report_progress(0);
+        const int32 num_threads = qtree->get_num_threads();
+        m_leaves_in_flight = 0;
+        m_done_area  = 0;
+        m_total_area = 0;
+        m_error = std::exception_ptr();
+
+        FifoWorkQueue queue( num_threads );
+        try {
+          walk( queue, "", region_bbox, boost::shared_ptr<Node>(), 4*num_threads, progress_callback );
+        } catch (...) {
+          set_error();
+        }
+        wait_for_leaves( 0, progress_callback );
+        queue.join_all();
+        if( m_error )
+          std::rethrow_exception( m_error );
         progress_callback.report_progress(1);
+      }
+
+      void walk( FifoWorkQueue &queue, std::string const& name, BBox2i const& region_bbox,
+                 boost::shared_ptr<Node> const& parent, int32 max_in_flight,
+                 const ProgressCallback &progress_callback ) {
+        progress_callback.abort_if_requested();
+
+        boost::shared_ptr<Node> node( new Node );
+        ImageView<PixelT> blank;
+        if( ! start_tile( name, region_bbox, node->info, blank ) )
+          return;
+        if( is_clean( node->info ) ) {
+          // The walk holds the parent open, so this can't finish it.
+          ImageView<PixelT> image = existing_tile( node->info );
+          Mutex::Lock lock( m_mutex );
+          if( parent && image.is_valid_image() )
+            parent->children.push_back( std::make_pair( node->info.region_bbox, image ) );
+          return;
+        }
+        node->parent = parent;
+        {
+          Mutex::Lock lock( m_mutex );
+          if( parent )
+            parent->pending++;
+          else
+            m_total_area = (double) node->info.image_bbox.width() * node->info.image_bbox.height();
+        }
+
+        std::vector<std::pair<std::string, BBox2i> > children = qtree->m_branch_func(*qtree, node->info.name, node->info.region_bbox);
+        if( children.empty() ) {
+          wait_for_leaves( max_in_flight-1, progress_callback );
+          {
+            Mutex::Lock lock( m_mutex );
+            m_leaves_in_flight++;
+          }
+          queue.add_task( boost::shared_ptr<Task>( new LeafTask( *this, node ) ) );
+          return;
+        }
+
+        node->pending = 1;
+        for( unsigned i=0; i<children.size(); ++i ) {
+          BBox2i image_bbox = children[i].second;
+          image_bbox.crop( node->info.image_bbox );
+          if( ! image_bbox.empty() )
+            walk( queue, children[i].first, children[i].second, node, max_in_flight, progress_callback );
+        }
+
+        // The tile may already have all of its children.
+        {
+          Mutex::Lock lock( m_mutex );
+          if( --node->pending > 0 )
+            return;
+        }
+        finish_node( node, reduce( *node ) );
+      }
+
+      void run_leaf( boost::shared_ptr<Node> const& node ) {
+        double area = (double) node->info.image_bbox.width() * node->info.image_bbox.height();
+        bool failed;
+        {
+          Mutex::Lock lock( m_mutex );
+          failed = bool(m_error);
+        }
+        if( ! failed ) {
+          try {
+            finish_node( node, leaf_image( node->info ) );
+          } catch (...) {
+            set_error();
+          }
+        }
+        Mutex::Lock lock( m_mutex );
+        m_leaves_in_flight--;
+        m_done_area += area;
+        m_leaf_done.notify_all();
+      }
+
+      /// Write a finished tile and pass its image to the parent,
+      /// finishing the parent too if it was the last child.
+      void finish_node( boost::shared_ptr<Node> node, ImageView<PixelT> image ) {
+        while( true ) {
+          finish_tile( node->info, image );
+          boost::shared_ptr<Node> parent = node->parent;
+          if( ! parent )
+            return;
+          {
+            Mutex::Lock lock( m_mutex );
+            parent->children.push_back( std::make_pair( node->info.region_bbox, image ) );
+            if( --parent->pending > 0 )
+              return;
+          }
+          image = reduce( *parent );
+          node = parent;
+        }
+      }
+
+      /// Assemble a tile from its children, releasing their images.
+      ImageView<PixelT> reduce( Node &node ) const {
+        ImageView<PixelT> image( qtree->m_tile_size, qtree->m_tile_size );
+        for( unsigned i=0; i<node.children.size(); ++i )
+          insert_child( image, node.info, node.children[i].first, node.children[i].second );
+        node.children.clear();
         return image;
       }
+
+      /// Wait until no more than max_in_flight leaves are queued or
+      /// running, reporting progress meanwhile.
+      void wait_for_leaves( int32 max_in_flight, const ProgressCallback &progress_callback ) {
+        while( true ) {
+          double progress;
+          {
+            Mutex::Lock lock( m_mutex );
+            if( m_leaves_in_flight <= max_in_flight )
+              return;
+            m_leaf_done.wait( lock );
+            progress = m_done_area / m_total_area;
+          }
+          progress_callback.report_progress( progress );
+        }
+      }
+
+      void set_error() {
+        Mutex::Lock lock( m_mutex );
+        if( ! m_error )
+          m_error = std::current_exception();
+      }
     }; // End class Processor
 
     template<class> friend class Processor;
@@ -338,8 +783,13 @@ namespace mosaic {
     int32       m_tile_size;
     std::string m_file_type;
     BBox2i      m_crop_bbox;
+    BBox2i      m_dirty_bbox;
     bool        m_crop_images;
     bool        m_cull_images;
+    int32       m_num_threads;
+    int32       m_num_encode_threads;
+    bool        m_use_resample_filter;
+    ResampleFilter m_resample_filter;
     Vector2i    m_dimensions;
     boost::shared_ptr<ProcessorBase> m_processor;
 
@@ -347,8 +797,14 @@ namespace mosaic {
     image_path_func_type    m_image_path_func;
     branch_func_type        m_branch_func;
     tile_resource_func_type m_tile_resource_func;
+    tile_reader_func_type   m_tile_reader_func;
     metadata_func_type      m_metadata_func;
     sparse_image_check_type m_sparse_image_check;
+
+    // Throughput of the last generate(), updated by every writing thread
+    mutable std::atomic<uint64> m_tiles_written;
+    mutable std::atomic<uint64> m_pixels_written;
+    mutable std::atomic<uint64> m_write_microseconds;
   };
 
 } // namespace mosaic
@@ -0,0 +1,195 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Mosaic/TileArchive.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Log.h>
+#include <vw/FileIO/MemoryImageResource.h>
+
+#include <cstring>
+
+#include <boost/filesystem/path.hpp>
+namespace fs = boost::filesystem;
+
+namespace vw {
+namespace mosaic {
+
+namespace {
+  // The last character is the format version.
+  const char TILE_ARCHIVE_MAGIC[8] = {'V','W','T','I','L','E','S','1'};
+
+  // Guard against reading a file from a machine of the other byte order.
+  const uint32 TILE_ARCHIVE_BYTE_ORDER = 0x01020304;
+
+  const size_t TILE_ARCHIVE_HEADER_SIZE = sizeof(TILE_ARCHIVE_MAGIC) + sizeof(uint32);
+  const size_t TILE_ARCHIVE_FOOTER_SIZE = 2*sizeof(uint64) + sizeof(TILE_ARCHIVE_MAGIC);
+
+  template <class T>
+  void write_value( std::ostream& os, T const& value ) {
+    os.write( reinterpret_cast<const char*>(&value), sizeof(T) );
+  }
+
+  template <class T>
+  T read_value( const char*& pos, const char* end, std::string const& filename ) {
+    if( size_t(end - pos) < sizeof(T) )
+      vw_throw( IOErr() << "TileArchiveReader: Truncated index in: " << filename );
+    T value;
+    std::memcpy( &value, pos, sizeof(T) );
+    pos += sizeof(T);
+    return value;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// TileArchiveWriter
+// ---------------------------------------------------------------------------
+
+TileArchiveWriter::TileArchiveWriter( std::string const& filename, size_t batch_size )
+  : m_filename( filename ), m_batch_size( batch_size ),
+    m_batch_offset( TILE_ARCHIVE_HEADER_SIZE ), m_closed( false ) {
+  m_file.open( filename.c_str(), std::ios::binary | std::ios::out | std::ios::trunc );
+  if( !m_file.is_open() )
+    vw_throw( IOErr() << "TileArchiveWriter: Could not open file: " << filename );
+  m_file.write( TILE_ARCHIVE_MAGIC, sizeof(TILE_ARCHIVE_MAGIC) );
+  write_value( m_file, TILE_ARCHIVE_BYTE_ORDER );
+}
+
+TileArchiveWriter::~TileArchiveWriter() {
+  try {
+    close();
+  } catch( const std::exception& e ) {
+    vw_out(ErrorMessage) << "TileArchiveWriter: " << e.what() << std::endl;
+  }
+}
+
+void TileArchiveWriter::add( std::string const& name, const uint8* data, size_t size ) {
+  Mutex::Lock lock( m_mutex );
+  VW_ASSERT( !m_closed, LogicErr() << "TileArchiveWriter: Tile added after close: " << name );
+  Entry entry = { m_batch_offset + m_batch.size(), size };
+  m_batch.insert( m_batch.end(), data, data + size );
+  m_index[name] = entry;
+  if( m_batch.size() >= m_batch_size )
+    write_batch();
+}
+
+void TileArchiveWriter::write_batch() {
+  if( m_batch.empty() )
+    return;
+  m_file.write( reinterpret_cast<const char*>(&m_batch[0]), m_batch.size() );
+  if( !m_file )
+    vw_throw( IOErr() << "TileArchiveWriter: Failed writing: " << m_filename );
+  m_batch_offset += m_batch.size();
+  m_batch.clear();
+}
+
+void TileArchiveWriter::close() {
+  Mutex::Lock lock( m_mutex );
+  if( m_closed )
+    return;
+  m_closed = true;
+
+  write_batch();
+  const uint64 index_offset = m_batch_offset;
+  for( std::map<std::string, Entry>::const_iterator it = m_index.begin(); it != m_index.end(); ++it ) {
+    write_value( m_file, uint32(it->first.size()) );
+    m_file.write( it->first.data(), it->first.size() );
+    write_value( m_file, it->second.offset );
+    write_value( m_file, it->second.size );
+  }
+  write_value( m_file, index_offset );
+  write_value( m_file, uint64(m_index.size()) );
+  m_file.write( TILE_ARCHIVE_MAGIC, sizeof(TILE_ARCHIVE_MAGIC) );
+  m_file.close();
+  if( !m_file )
+    vw_throw( IOErr() << "TileArchiveWriter: Failed writing: " << m_filename );
+}
+
+// ---------------------------------------------------------------------------
+// TileArchiveReader
+// ---------------------------------------------------------------------------
+
+TileArchiveReader::TileArchiveReader( std::string const& filename ) {
+  try {
+    m_file.open( filename );
+  } catch( const std::exception& ) {
+    vw_throw( IOErr() << "TileArchiveReader: Could not open file: " << filename );
+  }
+
+  const char* begin = m_file.data();
+  const char* end   = begin + m_file.size();
+  if( m_file.size() < TILE_ARCHIVE_HEADER_SIZE + TILE_ARCHIVE_FOOTER_SIZE ||
+      std::memcmp( begin, TILE_ARCHIVE_MAGIC, sizeof(TILE_ARCHIVE_MAGIC) ) != 0 ||
+      std::memcmp( end - sizeof(TILE_ARCHIVE_MAGIC), TILE_ARCHIVE_MAGIC, sizeof(TILE_ARCHIVE_MAGIC) ) != 0 )
+    vw_throw( IOErr() << "TileArchiveReader: \"" << filename << "\" is not a complete tile archive." );
+
+  const char* pos = begin + sizeof(TILE_ARCHIVE_MAGIC);
+  if( read_value<uint32>( pos, end, filename ) != TILE_ARCHIVE_BYTE_ORDER )
+    vw_throw( IOErr() << "TileArchiveReader: \"" << filename
+                      << "\" was written on a machine of different byte order." );
+
+  const char* footer = end - TILE_ARCHIVE_FOOTER_SIZE;
+  pos = footer;
+  uint64 index_offset = read_value<uint64>( pos, end, filename );
+  uint64 count        = read_value<uint64>( pos, end, filename );
+  if( index_offset < TILE_ARCHIVE_HEADER_SIZE || index_offset > uint64(footer - begin) )
+    vw_throw( IOErr() << "TileArchiveReader: Bad index offset in: " << filename );
+
+  pos = begin + index_offset;
+  for( uint64 i = 0; i < count; ++i ) {
+    uint32 length = read_value<uint32>( pos, footer, filename );
+    if( uint64(footer - pos) < length )
+      vw_throw( IOErr() << "TileArchiveReader: Truncated index in: " << filename );
+    std::string name( pos, length );
+    pos += length;
+    Entry entry;
+    entry.offset = read_value<uint64>( pos, footer, filename );
+    entry.size   = read_value<uint64>( pos, footer, filename );
+    if( entry.offset < TILE_ARCHIVE_HEADER_SIZE || entry.offset > index_offset ||
+        entry.size > index_offset - entry.offset )
+      vw_throw( IOErr() << "TileArchiveReader: Bad entry for \"" << name << "\" in: " << filename );
+    m_index[name] = entry;
+  }
+}
+
+std::vector<std::string> TileArchiveReader::names() const {
+  std::vector<std::string> result;
+  result.reserve( m_index.size() );
+  for( std::map<std::string, Entry>::const_iterator it = m_index.begin(); it != m_index.end(); ++it )
+    result.push_back( it->first );
+  return result;
+}
+
+bool TileArchiveReader::read( std::string const& name, std::vector<uint8>& data ) const {
+  std::map<std::string, Entry>::const_iterator it = m_index.find( name );
+  if( it == m_index.end() )
+    return false;
+  const uint8* begin = reinterpret_cast<const uint8*>( m_file.data() ) + it->second.offset;
+  data.assign( begin, begin + it->second.size );
+  return true;
+}
+
+boost::shared_ptr<SrcImageResource> TileArchiveReader::open( std::string const& name ) const {
+  std::map<std::string, Entry>::const_iterator it = m_index.find( name );
+  if( it == m_index.end() )
+    return boost::shared_ptr<SrcImageResource>();
+  const uint8* data = reinterpret_cast<const uint8*>( m_file.data() ) + it->second.offset;
+  return boost::shared_ptr<SrcImageResource>(
+    SrcMemoryImageResource::open( fs::path( name ).extension().string(), data, it->second.size ) );
+}
+
+}} // namespace vw::mosaic
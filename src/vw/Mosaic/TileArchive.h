@@ -0,0 +1,118 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file TileArchive.h
+///
+/// A single file holding the encoded tiles of a quadtree, for trees
+/// too large to keep as one file per tile.  The tiles are stored one
+/// after another in the order they were added, and are found through
+/// an index, sorted by name, at the end of the file:
+///
+///   "VWTILES1" magic, byte order mark
+///   tile data ...
+///   index: for each tile, its name, offset and size
+///   index offset, tile count, "VWTILES1" magic
+///
+/// Names are paths relative to the tree, with the file extension,
+/// e.g. "4/6/3.png".  Like a camera cache, an archive is specific to
+/// the byte order of the machine that wrote it.
+///
+#ifndef __VW_MOSAIC_TILEARCHIVE_H__
+#define __VW_MOSAIC_TILEARCHIVE_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+#include <vw/Image/ImageResource.h>
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+namespace mosaic {
+
+  /// Writes a tile archive.  Tiles may be added from several threads
+  /// at once; they are gathered into batches which are each written
+  /// with one call, and the index is written by close().
+  class TileArchiveWriter : private boost::noncopyable {
+  public:
+    TileArchiveWriter( std::string const& filename, size_t batch_size = 16*1024*1024 );
+
+    /// Closes the archive, reporting rather than throwing any error.
+    ~TileArchiveWriter();
+
+    /// Add an encoded tile.  Adding a name again replaces the tile.
+    void add( std::string const& name, const uint8* data, size_t size );
+
+    /// Write the remaining tiles and the index.  Nothing can be added
+    /// after this.
+    void close();
+
+    std::string const& filename() const { return m_filename; }
+
+  private:
+    struct Entry { uint64 offset, size; };
+
+    void write_batch();
+
+    std::string   m_filename;
+    std::ofstream m_file;
+    size_t        m_batch_size;
+    std::vector<uint8> m_batch;
+    uint64        m_batch_offset; ///< File offset of the start of m_batch
+    std::map<std::string, Entry> m_index;
+    bool          m_closed;
+    Mutex         m_mutex;
+  };
+
+  /// Reads a tile archive through a memory map.  Reading is safe from
+  /// several threads at once.
+  class TileArchiveReader : private boost::noncopyable {
+  public:
+    TileArchiveReader( std::string const& filename );
+
+    size_t size() const { return m_index.size(); }
+
+    bool contains( std::string const& name ) const { return m_index.count( name ) != 0; }
+
+    /// The names of all the tiles, in sorted order.
+    std::vector<std::string> names() const;
+
+    /// Copy out an encoded tile.  Returns false if there is no such tile.
+    bool read( std::string const& name, std::vector<uint8>& data ) const;
+
+    /// Open a tile for decoding, with the format given by its
+    /// extension, or return an empty pointer if there is no such tile.
+    /// The resource refers to the archive's memory, so it must not
+    /// outlive the reader.
+    boost::shared_ptr<SrcImageResource> open( std::string const& name ) const;
+
+  private:
+    struct Entry { uint64 offset, size; };
+
+    boost::iostreams::mapped_file_source m_file;
+    std::map<std::string, Entry> m_index;
+  };
+
+}} // namespace vw::mosaic
+
+#endif // __VW_MOSAIC_TILEARCHIVE_H__
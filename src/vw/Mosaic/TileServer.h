@@ -0,0 +1,334 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file TileServer.h
+///
+/// Renders the tiles of a quadtree when they are asked for, instead of
+/// generating the whole tree up front, for embedding in a tile server.
+///
+#ifndef __VW_MOSAIC_TILESERVER_H__
+#define __VW_MOSAIC_TILESERVER_H__
+
+#include <cstdlib>
+#include <exception>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/tuple/tuple.hpp>
+#include <boost/tuple/tuple_comparison.hpp>
+
+#include <vw/Core/Condition.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/FileIO/MemoryImageResource.h>
+#include <vw/Mosaic/QuadTreeGenerator.h>
+
+namespace vw {
+namespace mosaic {
+
+  /// Renders tiles of the tree a QuadTreeGenerator would write, by
+  /// level and position, straight from the source image.  The layout
+  /// comes from the generator, so a QuadTreeConfig applied to it also
+  /// decides the tiles' names and paths here.  The generator must
+  /// outlive the server.
+  ///
+  /// The most recently used tiles are kept in memory.  Requests for a
+  /// tile which is being rendered wait for it rather than rendering it
+  /// again.  Tiles can also be prefetched on background threads; those
+  /// near the last requested tile are rendered first.  All the methods
+  /// may be called from several threads at once.
+  ///
+  /// A tile at level 0 covers the whole tree.  Tiles above the bottom
+  /// of the tree are point sampled from the source, where the generator
+  /// averages the tiles below them.
+  template <class PixelT>
+  class TileServer : private boost::noncopyable {
+  public:
+    /// Counts of the requests served, see stats().
+    struct Stats {
+      uint64 requests; ///< Calls to tile()
+      uint64 hits;     ///< Requests served from memory, including ones which waited for a render
+      uint64 renders;  ///< Tiles rendered, including prefetched ones
+      Stats() : requests(0), hits(0), renders(0) {}
+    };
+
+    /// Serve the tiles of source with the layout of qtree, keeping up
+    /// to cache_tiles tiles in memory.  Prefetching uses num_threads
+    /// threads, or the default number for zero.
+    template <class ImageT>
+    TileServer( ImageViewBase<ImageT> const& source, QuadTreeGenerator const& qtree,
+                size_t cache_tiles = 1024, int32 num_threads = 0 )
+      : m_source( source.impl() ), m_qtree( qtree ), m_cache_tiles( cache_tiles ),
+        m_levels( qtree.get_tree_levels() ),
+        m_prefetch_token( new CancelToken ),
+        m_prefetch_queue( num_threads > 0 ? num_threads : vw_settings().default_num_threads() ) {
+      VW_ASSERT( cache_tiles > 0, ArgumentErr() << "TileServer: The cache must hold at least one tile." );
+    }
+
+    ~TileServer() {
+      cancel_prefetches();
+      m_prefetch_queue.join_all();
+    }
+
+    /// The number of levels in the tree; the bottom level is levels()-1.
+    int32 levels() const { return m_levels; }
+
+    /// True if the tree has a tile at this position.
+    bool valid( int32 level, int32 x, int32 y ) const {
+      return level >= 0 && level < m_levels && x >= 0 && y >= 0 &&
+             x < (1 << level) && y < (1 << level);
+    }
+
+    /// Find the tile at a position through the generator's branch
+    /// function.  info.image_bbox is empty if the tile is off the image.
+    QuadTreeGenerator::TileInfo tile_info( int32 level, int32 x, int32 y ) const {
+      VW_ASSERT( valid( level, x, y ), ArgumentErr() << "TileServer: There is no tile (" << level << ","
+                                                     << x << "," << y << ")." );
+      QuadTreeGenerator::TileInfo info;
+      info.region_bbox = BBox2i( 0, 0, m_qtree.get_tile_size(), m_qtree.get_tile_size() ) * (1 << (m_levels-1));
+      const int32 size = info.region_bbox.width() >> level;
+      const Vector2i center = Vector2i( x, y ) * size + Vector2i( size/2, size/2 );
+      for( int32 l = 0; l < level; ++l ) {
+        std::vector<std::pair<std::string, BBox2i> > children = m_qtree.branches( info.name, info.region_bbox );
+        size_t i = 0;
+        while( i < children.size() && ! children[i].second.contains( center ) )
+          ++i;
+        VW_ASSERT( i < children.size(), LogicErr() << "TileServer: The branch function has no child of \""
+                                                   << info.name << "\" at level " << l+1 << "." );
+        info.name        = children[i].first;
+        info.region_bbox = children[i].second;
+      }
+
+      BBox2i crop_bbox( Vector2i(), m_qtree.get_dimensions() );
+      if( ! m_qtree.get_crop_bbox().empty() )
+        crop_bbox.crop( m_qtree.get_crop_bbox() );
+      info.image_bbox = info.region_bbox;
+      info.image_bbox.crop( crop_bbox );
+      info.filepath = m_qtree.image_path( info.name );
+      if( m_qtree.get_file_type() != "auto" )
+        info.filetype = "." + m_qtree.get_file_type();
+      return info;
+    }
+
+    /// Return a tile, rendering it unless it is in memory.  The image is
+    /// empty if the tree has no tile there, e.g. off the image or where
+    /// the sparse image check finds no data.  The image is shared with
+    /// the cache, so it must not be modified.
+    ImageView<PixelT> tile( int32 level, int32 x, int32 y ) {
+      Key key( level, x, y );
+      boost::shared_ptr<Entry> entry;
+      {
+        Mutex::Lock lock( m_mutex );
+        m_stats.requests++;
+        m_recent = key;
+        typename EntryMap::iterator it = m_entries.find( key );
+        if( it != m_entries.end() ) {
+          entry = it->second;
+          m_stats.hits++;
+          while( ! entry->ready )
+            m_rendered.wait( lock );
+          if( entry->error )
+            std::rethrow_exception( entry->error );
+          // It may have been evicted while this waited.
+          it = m_entries.find( key );
+          if( it != m_entries.end() && it->second == entry )
+            m_lru.splice( m_lru.begin(), m_lru, entry->lru );
+          return entry->image;
+        }
+        entry = insert( key );
+      }
+      render_entry( key, entry );
+      if( entry->error )
+        std::rethrow_exception( entry->error );
+      return entry->image;
+    }
+
+    /// Encode a tile in a format such as "png" or "jpg" and return
+    /// false if there is no tile there.
+    bool encoded_tile( int32 level, int32 x, int32 y, std::string const& type, std::vector<uint8>& data ) {
+      ImageView<PixelT> image = tile( level, x, y );
+      if( ! image.is_valid_image() )
+        return false;
+      boost::scoped_ptr<DstMemoryImageResource> r( DstMemoryImageResource::create( type, image.format() ) );
+      write_image( *r, image );
+      data.assign( r->data(), r->data() + r->size() );
+      return true;
+    }
+
+    /// Render a tile in the background unless it is in memory or
+    /// already on its way.  Tiles within two tiles of the last one
+    /// requested, at its level, go ahead of the others.
+    void prefetch( int32 level, int32 x, int32 y ) {
+      VW_ASSERT( valid( level, x, y ), ArgumentErr() << "TileServer: There is no tile (" << level << ","
+                                                     << x << "," << y << ")." );
+      Key key( level, x, y );
+      boost::shared_ptr<PrefetchTask> task;
+      {
+        Mutex::Lock lock( m_mutex );
+        if( m_entries.count( key ) || m_prefetching.count( key ) )
+          return;
+        m_prefetching.insert( key );
+        task.reset( new PrefetchTask( *this, key ) );
+        task->set_priority( near_recent( key ) ? Task::PriorityHigh : Task::PriorityLow );
+        task->set_cancel_token( m_prefetch_token );
+      }
+      m_prefetch_queue.add_task( task );
+    }
+
+    /// Drop the prefetches which have not started, e.g. when the viewer
+    /// moves somewhere else.
+    void cancel_prefetches() {
+      Mutex::Lock lock( m_mutex );
+      m_prefetch_token->cancel();
+      m_prefetch_token.reset( new CancelToken );
+    }
+
+    /// The number of tiles in memory.
+    size_t size() const {
+      Mutex::Lock lock( m_mutex );
+      return m_lru.size();
+    }
+
+    Stats stats() const {
+      Mutex::Lock lock( m_mutex );
+      return m_stats;
+    }
+
+  private:
+    typedef boost::tuple<int32, int32, int32> Key;
+
+    /// A tile in memory, or one being rendered until ready is set.
+    struct Entry {
+      bool ready;
+      ImageView<PixelT> image;
+      std::exception_ptr error;
+      typename std::list<Key>::iterator lru; ///< Set once ready
+      Entry() : ready( false ) {}
+    };
+    typedef std::map<Key, boost::shared_ptr<Entry> > EntryMap;
+
+    class PrefetchTask : public Task {
+      TileServer &m_server;
+      Key m_key;
+    public:
+      PrefetchTask( TileServer &server, Key const& key ) : m_server( server ), m_key( key ) {}
+      virtual void operator()() { m_server.run_prefetch( m_key ); }
+      virtual void discard() {
+        Mutex::Lock lock( m_server.m_mutex );
+        m_server.m_prefetching.erase( m_key );
+      }
+    };
+
+    /// Add an entry for a tile about to be rendered.  m_mutex must be held.
+    boost::shared_ptr<Entry> insert( Key const& key ) {
+      boost::shared_ptr<Entry> entry( new Entry );
+      m_entries[key] = entry;
+      return entry;
+    }
+
+    /// Render a tile into its entry and wake the requests waiting for it.
+    void render_entry( Key const& key, boost::shared_ptr<Entry> const& entry ) {
+      ImageView<PixelT> image;
+      std::exception_ptr error;
+      try {
+        image = render( tile_info( key.template get<0>(), key.template get<1>(), key.template get<2>() ) );
+      } catch (...) {
+        error = std::current_exception();
+      }
+      Mutex::Lock lock( m_mutex );
+      m_stats.renders++;
+      entry->image = image;
+      entry->error = error;
+      entry->ready = true;
+      if( error ) {
+        // Let a later request try again.
+        m_entries.erase( key );
+      } else {
+        m_lru.push_front( key );
+        entry->lru = m_lru.begin();
+        while( m_lru.size() > m_cache_tiles ) {
+          m_entries.erase( m_lru.back() );
+          m_lru.pop_back();
+        }
+      }
+      m_rendered.notify_all();
+    }
+
+    void run_prefetch( Key const& key ) {
+      boost::shared_ptr<Entry> entry;
+      {
+        Mutex::Lock lock( m_mutex );
+        m_prefetching.erase( key );
+        if( m_entries.count( key ) )
+          return;
+        entry = insert( key );
+      }
+      render_entry( key, entry );
+    }
+
+    /// Render a tile as the generator would at the bottom of the tree.
+    ImageView<PixelT> render( QuadTreeGenerator::TileInfo const& info ) const {
+      ImageView<PixelT> image;
+      if( info.image_bbox.empty() )
+        return image;
+      if( m_qtree.sparse_image_check() && ! m_qtree.sparse_image_check()( info.region_bbox ) )
+        return image;
+      Vector2i scale = info.region_bbox.size() / m_qtree.get_tile_size();
+      image = subsample( edge_extend( crop( m_source, info.image_bbox ), info.region_bbox - info.image_bbox.min(),
+                                      ZeroEdgeExtension() ),
+                         scale.x(), scale.y() );
+      return image;
+    }
+
+    /// True if a tile is within two tiles of the last one requested,
+    /// at the same level.  m_mutex must be held.
+    bool near_recent( Key const& key ) const {
+      return key.template get<0>() == m_recent.template get<0>() &&
+             std::abs( key.template get<1>() - m_recent.template get<1>() ) <= 2 &&
+             std::abs( key.template get<2>() - m_recent.template get<2>() ) <= 2;
+    }
+
+    ImageViewRef<PixelT>     m_source;
+    QuadTreeGenerator const& m_qtree;
+    size_t                   m_cache_tiles;
+    int32                    m_levels;
+
+    // Guarded by m_mutex
+    mutable Mutex      m_mutex;
+    Condition          m_rendered;
+    EntryMap           m_entries;
+    std::list<Key>     m_lru;       ///< Keys of the ready tiles, most recently used first
+    std::set<Key>      m_prefetching;
+    Key                m_recent;
+    Stats              m_stats;
+    boost::shared_ptr<CancelToken> m_prefetch_token;
+
+    // Declared last, so that its threads are joined before the rest is destroyed
+    FifoWorkQueue      m_prefetch_queue;
+  };
+
+}} // namespace vw::mosaic
+
+#endif // __VW_MOSAIC_TILESERVER_H__
@@ -0,0 +1,75 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestBBoxIndex.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Mosaic/BBoxIndex.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+
+using namespace vw;
+using namespace vw::mosaic;
+
+TEST( BBoxIndex, MatchesLinearScan ) {
+  boost::random::mt19937 gen(5);
+  boost::random::uniform_int_distribution<int> pos(-500, 500), size(0, 60);
+
+  // Include some empty boxes, which are never found.
+  std::vector<BBox2i> boxes;
+  for( int i = 0; i < 2000; ++i )
+    boxes.push_back( BBox2i( pos(gen), pos(gen), size(gen), size(gen) ) );
+
+  BBoxIndex index( boxes, 4 );
+  EXPECT_EQ( boxes.size(), index.size() );
+
+  for( int q = 0; q < 200; ++q ) {
+    BBox2i query( pos(gen), pos(gen), 4*size(gen), 4*size(gen) );
+    std::vector<uint32> expected, found;
+    for( uint32 i = 0; i < boxes.size(); ++i )
+      if( ! query.empty() && ! boxes[i].empty() && query.intersects( boxes[i] ) )
+        expected.push_back( i );
+    index.intersects( query, found );
+    ASSERT_EQ( expected.size(), found.size() );
+    for( size_t i = 0; i < found.size(); ++i )
+      EXPECT_EQ( expected[i], found[i] );
+  }
+}
+
+TEST( BBoxIndex, Small ) {
+  std::vector<uint32> found;
+  BBoxIndex empty;
+  empty.intersects( BBox2i(0,0,10,10), found );
+  EXPECT_TRUE( found.empty() );
+
+  std::vector<BBox2i> boxes;
+  boxes.push_back( BBox2i(0,0,10,10) );
+  boxes.push_back( BBox2i(10,0,10,10) );
+  BBoxIndex index( boxes );
+
+  // Boxes which only touch do not intersect.
+  index.intersects( BBox2i(5,5,5,5), found );
+  ASSERT_EQ( 1u, found.size() );
+  EXPECT_EQ( 0u, found[0] );
+
+  // Results are appended.
+  index.intersects( BBox2i(9,0,2,1), found );
+  ASSERT_EQ( 3u, found.size() );
+  EXPECT_EQ( 0u, found[1] );
+  EXPECT_EQ( 1u, found[2] );
+}
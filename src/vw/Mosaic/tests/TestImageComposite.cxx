@@ -18,10 +18,13 @@
 
 #include <gtest/gtest_VW.h>
 #include <vw/Mosaic/ImageComposite.h>
+#include <vw/Image/PixelTypes.h>
+#include <test/Helpers.h>
 
 using namespace std;
 using namespace vw;
 using namespace vw::mosaic;
+using namespace vw::test;
 
 ImageView<uint32> make(uint32 x) {
   ImageView<uint32> img(8,8);
@@ -50,3 +53,97 @@ TEST(TestImageComposite, Basic) {
       EXPECT_EQ(2, c(col, row)) << "at (" << col << "," << row << ")";
   }
 }
+
+TEST(TestImageComposite, ParallelMasks) {
+  typedef PixelGrayA<float> PixelT;
+  ImageView<PixelT> images[3];
+  for (int i = 0; i < 3; ++i) {
+    images[i].set_size(40, 30);
+    fill(images[i], PixelT(float(i + 1), 1.0f));
+  }
+  UnlinkName masks[3] = { UnlinkName("mask.0.png"), UnlinkName("mask.1.png"), UnlinkName("mask.2.png") };
+
+  // Blending the same sources with masks made on one thread and on
+  // several gives the same result.
+  ImageView<PixelT> results[2];
+  for (int run = 0; run < 2; ++run) {
+    ImageComposite<PixelT> c;
+    c.set_num_threads(run == 0 ? 1 : 3);
+    c.insert(images[0], 0, 0);
+    c.insert(images[1], 25, 5);
+    c.insert(images[2], 10, 20);
+    c.prepare();
+    results[run] = c;
+  }
+  ASSERT_EQ(65, results[0].cols());
+  ASSERT_EQ(50, results[0].rows());
+  for (int32 row = 0; row < results[0].rows(); ++row)
+    for (int32 col = 0; col < results[0].cols(); ++col)
+      EXPECT_PIXEL_EQ(results[0](col, row), results[1](col, row));
+  EXPECT_NEAR(1.0, results[0](2, 2).v(), 1e-4);
+  EXPECT_NEAR(2.0, results[0](62, 10).v(), 1e-4);
+}
+
+TEST(TestImageComposite, SpillPyramid) {
+  typedef PixelGrayA<float> PixelT;
+  BlendPyramid<PixelT> pyramid;
+  for (int l = 0; l < 3; ++l) {
+    ImageView<PixelT> image(7 - 2*l, 5 - l);
+    ImageView<float>  mask (7 - 2*l, 5 - l);
+    for (int32 row = 0; row < image.rows(); ++row)
+      for (int32 col = 0; col < image.cols(); ++col) {
+        image(col, row) = PixelT(float(l*100 + row*10 + col), 0.5f);
+        mask (col, row) = float(col + row) / 10;
+      }
+    BBox2i bbox(l, 2*l, image.cols(), image.rows());
+    pyramid.images.push_back(PositionedImage<PixelT>(40 >> l, 30 >> l, image, bbox));
+    pyramid.masks.push_back (PositionedImage<float >(40 >> l, 30 >> l, mask,  bbox));
+  }
+
+  typedef CacheSpillTraits<BlendPyramid<PixelT> > traits;
+  ASSERT_TRUE(traits::spillable);
+  std::vector<uint8> buffer;
+  traits::save(pyramid, buffer);
+  boost::shared_ptr<BlendPyramid<PixelT> > loaded = traits::load(&buffer[0], buffer.size());
+  ASSERT_EQ(3u, loaded->images.size());
+  ASSERT_EQ(3u, loaded->masks.size());
+  for (int l = 0; l < 3; ++l) {
+    EXPECT_EQ(pyramid.images[l].cols(), loaded->images[l].cols());
+    EXPECT_EQ(pyramid.masks[l].rows(),  loaded->masks[l].rows());
+    EXPECT_EQ(pyramid.images[l].bbox,   loaded->images[l].bbox);
+    EXPECT_EQ(pyramid.masks[l].bbox,    loaded->masks[l].bbox);
+    EXPECT_SEQ_EQ(pyramid.images[l].image, loaded->images[l].image);
+    EXPECT_SEQ_EQ(pyramid.masks[l].image,  loaded->masks[l].image);
+  }
+  EXPECT_THROW(traits::load(&buffer[0], buffer.size() - 1), IOErr);
+}
+
+TEST(TestImageComposite, Cutline) {
+  typedef PixelGrayA<float> PixelT;
+  ImageView<PixelT> images[2];
+  for (int i = 0; i < 2; ++i) {
+    images[i].set_size(40, 30);
+    fill(images[i], PixelT(float(i + 1), 1.0f));
+  }
+  UnlinkName cutlines[2] = { UnlinkName("cutline.0.png"), UnlinkName("cutline.1.png") };
+
+  ImageComposite<PixelT> c;
+  c.set_cutline_mode(true, 4);
+  c.insert(images[0], 0, 0);
+  c.insert(images[1], 25, 0);
+  c.prepare();
+  ImageView<PixelT> result = c;
+  ASSERT_EQ(65, result.cols());
+  ASSERT_EQ(30, result.rows());
+
+  // Away from the cutline each pixel comes from one source, and across
+  // it the value goes from one to the other.
+  EXPECT_NEAR(1.0, result(2, 15).v(), 1e-4);
+  EXPECT_NEAR(2.0, result(62, 15).v(), 1e-4);
+  EXPECT_NEAR(1.0, result(27, 15).v(), 1e-4);
+  EXPECT_NEAR(2.0, result(37, 15).v(), 1e-4);
+  for (int32 col = 1; col < result.cols(); ++col) {
+    EXPECT_GE(result(col, 15).v() + 1e-4, result(col - 1, 15).v()) << col;
+    EXPECT_NEAR(1.0, result(col, 15).a(), 1e-4) << col;
+  }
+}
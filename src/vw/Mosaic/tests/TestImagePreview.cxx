@@ -0,0 +1,152 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <vw/Mosaic/ImagePreview.h>
+#include <test/Helpers.h>
+
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+// The image subsampled by 2, averaging the valid pixels of each 2x2 block.
+static ImageView<double> halve(ImageView<double> const& image, double nodata) {
+  ImageView<double> result((image.cols()+1)/2, (image.rows()+1)/2);
+  for (int32 row = 0; row < result.rows(); row++)
+    for (int32 col = 0; col < result.cols(); col++) {
+      double sum = 0;
+      int count = 0;
+      for (int32 y = 2*row; y < std::min(2*row+2, image.rows()); y++)
+        for (int32 x = 2*col; x < std::min(2*col+2, image.cols()); x++)
+          if (image(x, y) > nodata) {
+            sum += image(x, y);
+            count++;
+          }
+      result(col, row) = count > 0 ? sum/count : nodata;
+    }
+  return result;
+}
+
+static ImageView<double> make_image(int32 cols, int32 rows) {
+  ImageView<double> image(cols, rows);
+  for (int32 row = 0; row < rows; row++)
+    for (int32 col = 0; col < cols; col++)
+      image(col, row) = (col*7 + row*13) % 101;
+  // Some nodata
+  for (int32 row = 40; row < 90; row++)
+    for (int32 col = 10; col < 33; col++)
+      image(col, row) = -1;
+  return image;
+}
+
+class CollectSink : public PreviewSink<double> {
+  Mutex m_mutex;
+public:
+  std::map<int, ImageView<double> > images;
+  std::map<int, int> count;
+  CollectSink(std::map<int, Vector2i> const& sizes) {
+    for (std::map<int, Vector2i>::const_iterator it = sizes.begin(); it != sizes.end(); ++it)
+      images[it->first].set_size(it->second.x(), it->second.y());
+  }
+  virtual void operator()(ImageView<double> const& tile, BBox2i const& bbox, int scale) {
+    Mutex::Lock lock(m_mutex);
+    crop(images[scale], bbox) = tile;
+    count[scale]++;
+  }
+};
+
+TEST(ImagePreview, Levels) {
+  ImageView<double> image = make_image(301, 187);
+  ImagePreview<double> preview(ImageViewRef<double>(image), -1, 32, 4);
+  EXPECT_EQ(301, preview.cols());
+  EXPECT_EQ(187, preview.rows());
+  EXPECT_EQ(5, preview.num_levels()); // 301 -> 151 -> 76 -> 38 -> 19
+  EXPECT_EQ(0, preview.level_for_scale(1.9));
+  EXPECT_EQ(2, preview.level_for_scale(5));
+  EXPECT_EQ(4, preview.level_for_scale(1000));
+
+  ImageView<double> expected = image;
+  for (int level = 1; level < preview.num_levels(); level++) {
+    expected = halve(expected, -1);
+    ImageView<double> clip;
+    double scale;
+    BBox2i region;
+    preview.get_image_clip(1 << level, BBox2i(0, 0, 301, 187), clip, scale, region);
+    EXPECT_EQ(1 << level, scale);
+    EXPECT_EQ(bounding_box(expected), region);
+    EXPECT_SEQ_NEAR(expected, clip, 1e-12);
+  }
+
+  // A clip of part of a level
+  double scale;
+  BBox2i region;
+  ImageView<double> clip;
+  preview.get_image_clip(2, BBox2i(50, 30, 121, 90), clip, scale, region);
+  EXPECT_EQ(BBox2i(25, 15, 61, 45), region);
+  EXPECT_SEQ_NEAR(crop(halve(image, -1), region), clip, 1e-12);
+}
+
+TEST(ImagePreview, StoredLevel) {
+  // A supplied level is used as it is, and the ones above it are made from it.
+  ImageView<double> image = make_image(200, 120), level1(100, 60);
+  fill(level1, 5.0);
+  ImagePreview<double> preview(ImageViewRef<double>(image), -1, 32, 2);
+  preview.add_level(level1, 2);
+  ImageView<double> clip;
+  double scale;
+  BBox2i region;
+  preview.get_image_clip(2, BBox2i(0, 0, 200, 120), clip, scale, region);
+  EXPECT_SEQ_NEAR(level1, clip, 0);
+  preview.get_image_clip(4, BBox2i(0, 0, 200, 120), clip, scale, region);
+  EXPECT_EQ(BBox2i(0, 0, 50, 30), region);
+  EXPECT_NEAR(5.0, clip(17, 11), 1e-12);
+}
+
+TEST(ImagePreview, Request) {
+  ImageView<double> image = make_image(301, 187);
+  ImagePreview<double> preview(ImageViewRef<double>(image), -1, 32, 4);
+
+  std::map<int, Vector2i> sizes;
+  sizes[2] = Vector2i(151, 94);
+  sizes[8] = Vector2i(38, 24);
+  boost::shared_ptr<CollectSink> sink(new CollectSink(sizes));
+  BBox2i region(40, 20, 180, 150);
+  boost::shared_ptr<CancelToken> token = preview.request(2.5, region, sink, 2);
+  preview.join();
+  EXPECT_FALSE(token->is_cancelled());
+
+  // Both the coarse preview and the requested level cover the region.
+  ImageView<double> expected = halve(image, -1);
+  BBox2i bbox(20, 10, 90, 75);
+  EXPECT_SEQ_NEAR(crop(expected, bbox), crop(sink->images[2], bbox), 1e-12);
+  expected = halve(halve(expected, -1), -1);
+  bbox = BBox2i(5, 2, 23, 19);
+  EXPECT_SEQ_NEAR(crop(expected, bbox), crop(sink->images[8], bbox), 1e-12);
+  EXPECT_EQ(12, sink->count[2]); // Tiles 0..3 x 0..2
+  EXPECT_EQ(1,  sink->count[8]);
+
+  // A new request cancels the last one.
+  boost::shared_ptr<CollectSink> sink2(new CollectSink(sizes));
+  token = preview.request(1, BBox2i(0, 0, 301, 187), sink2, 0);
+  boost::shared_ptr<CancelToken> token2 = preview.request(2, region, sink2, 0);
+  EXPECT_TRUE(token->is_cancelled());
+  preview.join();
+  EXPECT_FALSE(token2->is_cancelled());
+  EXPECT_EQ(0, sink2->count[8]);
+  EXPECT_GE(sink2->count[2], 12);
+}
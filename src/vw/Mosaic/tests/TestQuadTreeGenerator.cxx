@@ -0,0 +1,275 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestQuadTreeGenerator.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Mosaic/QuadTreeGenerator.h>
+#include <test/Helpers.h>
+
+#include <boost/bind.hpp>
+#include <map>
+
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+namespace {
+
+  typedef std::map<std::string, ImageView<float> > TileMap;
+
+  // Collects the tiles and the order their metadata was made in,
+  // instead of writing files, and reads them back.
+  struct TileCollector {
+    TileMap tiles;
+    std::vector<std::string> metadata_order;
+    size_t metadata_before_tile; ///< Metadata made before its tile was written
+    QuadTreeGenerator::WriteStats stats;
+    int32 resample_filter; ///< A ResampleFilter, or -1 for none
+    Mutex mutex;
+
+    TileCollector() : metadata_before_tile( 0 ), resample_filter( -1 ) {}
+
+    class Resource : public DstImageResource {
+      TileCollector &m_collector;
+      std::string    m_name;
+    public:
+      Resource( TileCollector &collector, std::string const& name )
+        : m_collector( collector ), m_name( name ) {}
+      virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+        ImageView<float> tile( bbox.width(), bbox.height() );
+        convert( tile.buffer(), buf );
+        Mutex::Lock lock( m_collector.mutex );
+        m_collector.tiles[m_name] = tile;
+      }
+      virtual bool has_block_write()  const { return false; }
+      virtual bool has_nodata_write() const { return false; }
+      virtual void flush() {}
+    };
+
+    class Source : public SrcImageResource {
+      ImageView<float> m_tile;
+    public:
+      Source( ImageView<float> const& tile ) : m_tile( tile ) {}
+      virtual ImageFormat format() const { return m_tile.format(); }
+      virtual void read( ImageBuffer const& buf, BBox2i const& bbox ) const {
+        ImageView<float> region = crop( m_tile, bbox );
+        convert( buf, region.buffer() );
+      }
+      virtual bool has_block_read()  const { return false; }
+      virtual bool has_nodata_read() const { return false; }
+    };
+
+    boost::shared_ptr<DstImageResource> resource( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info,
+                                                  ImageFormat const& ) {
+      return boost::shared_ptr<DstImageResource>( new Resource( *this, info.name ) );
+    }
+
+    boost::shared_ptr<SrcImageResource> reader( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) {
+      Mutex::Lock lock( mutex );
+      TileMap::const_iterator it = tiles.find( info.name );
+      if( it == tiles.end() )
+        return boost::shared_ptr<SrcImageResource>();
+      return boost::shared_ptr<SrcImageResource>( new Source( it->second ) );
+    }
+
+    void metadata( QuadTreeGenerator const&, QuadTreeGenerator::TileInfo const& info ) {
+      Mutex::Lock lock( mutex );
+      metadata_order.push_back( info.name );
+      if( ! tiles.count( info.name ) )
+        metadata_before_tile++;
+    }
+
+    void generate( ImageView<float> const& image, int32 num_threads, BBox2i const& dirty_bbox = BBox2i(),
+                   int32 num_encode_threads = 0 ) {
+      QuadTreeGenerator qtree( image );
+      qtree.set_tile_size( 32 );
+      qtree.set_num_threads( num_threads );
+      qtree.set_num_encode_threads( num_encode_threads );
+      qtree.set_dirty_bbox( dirty_bbox );
+      if( resample_filter >= 0 )
+        qtree.set_resample_filter( ResampleFilter( resample_filter ) );
+      qtree.set_tile_resource_func( boost::bind( &TileCollector::resource, this, _1, _2, _3 ) );
+      qtree.set_tile_reader_func( boost::bind( &TileCollector::reader, this, _1, _2 ) );
+      qtree.set_metadata_func( boost::bind( &TileCollector::metadata, this, _1, _2 ) );
+      qtree.generate();
+      stats = qtree.get_write_stats();
+    }
+  };
+
+  ImageView<float> test_image() {
+    ImageView<float> image( 300, 170 );
+    for( int32 row = 0; row < image.rows(); ++row )
+      for( int32 col = 0; col < image.cols(); ++col )
+        image( col, row ) = float( (col*7 + row*13) % 29 ) + 0.5f*row;
+    return image;
+  }
+
+  void expect_same_tiles( TileMap const& expected, TileMap const& actual ) {
+    ASSERT_EQ( expected.size(), actual.size() );
+    for( TileMap::const_iterator it = expected.begin(); it != expected.end(); ++it ) {
+      TileMap::const_iterator found = actual.find( it->first );
+      ASSERT_TRUE( found != actual.end() ) << it->first;
+      ImageView<float> const& a = it->second;
+      ImageView<float> const& b = found->second;
+      ASSERT_EQ( a.cols(), b.cols() );
+      ASSERT_EQ( a.rows(), b.rows() );
+      for( int32 row = 0; row < a.rows(); ++row )
+        for( int32 col = 0; col < a.cols(); ++col )
+          EXPECT_EQ( a(col,row), b(col,row) ) << it->first;
+    }
+  }
+
+}
+
+TEST( QuadTreeGenerator, BoxSubsample ) {
+  ImageView<float> image( 6, 4 );
+  for( int32 row = 0; row < image.rows(); ++row )
+    for( int32 col = 0; col < image.cols(); ++col )
+      image( col, row ) = float( col + 10*row );
+  ImageView<float> result = box_subsample( image, Vector2i(2,2) );
+  ASSERT_EQ( 3, result.cols() );
+  ASSERT_EQ( 2, result.rows() );
+  EXPECT_NEAR(  5.5, result(0,0), 1e-5 );
+  EXPECT_NEAR( 29.5, result(2,1), 1e-5 );
+
+  ImageView<uint8> bytes( 2, 1 );
+  bytes(0,0) = 3;  bytes(1,0) = 6;
+  EXPECT_EQ( 4, box_subsample( bytes, Vector2i(2,1) )(0,0) );
+}
+
+TEST( QuadTreeGenerator, BottomUpMatchesDepthFirst ) {
+  ImageView<float> image = test_image();
+  TileCollector serial, parallel;
+  serial.generate( image, 1 );
+  parallel.generate( image, 4 );
+  expect_same_tiles( serial.tiles, parallel.tiles );
+
+  // Every tile's metadata comes after that of its children.
+  ASSERT_EQ( serial.metadata_order.size(), parallel.metadata_order.size() );
+  std::map<std::string, size_t> position;
+  for( size_t i = 0; i < parallel.metadata_order.size(); ++i )
+    position[parallel.metadata_order[i]] = i;
+  for( size_t i = 0; i < parallel.metadata_order.size(); ++i ) {
+    std::string const& name = parallel.metadata_order[i];
+    if( ! name.empty() ) {
+      EXPECT_LT( i, position[name.substr(0, name.size()-1)] ) << name;
+    }
+  }
+  EXPECT_EQ( "", parallel.metadata_order.back() );
+}
+
+TEST( QuadTreeGenerator, DirtyRegion ) {
+  ImageView<float> before = test_image();
+  ImageView<float> after  = copy( before );
+  BBox2i dirty( 40, 100, 30, 20 );
+  fill( crop( after, dirty ), 100.0f );
+
+  TileCollector original, expected;
+  original.generate( before, 1 );
+  expected.generate( after, 1 );
+
+  for( int32 num_threads = 1; num_threads <= 4; num_threads += 3 ) {
+    TileCollector updated;
+    updated.tiles = original.tiles;
+    updated.generate( after, num_threads, dirty );
+    expect_same_tiles( expected.tiles, updated.tiles );
+
+    // Only the tiles over the change and their ancestors are redone.
+    EXPECT_LT( updated.metadata_order.size(), expected.metadata_order.size() / 4 );
+    EXPECT_EQ( "", updated.metadata_order.back() );
+  }
+}
+
+TEST( QuadTreeGenerator, EncodeThreads ) {
+  ImageView<float> image = test_image();
+  TileCollector plain, encoded;
+  plain.generate( image, 1 );
+  encoded.generate( image, 1, BBox2i(), 3 );
+  expect_same_tiles( plain.tiles, encoded.tiles );
+
+  // The metadata is made in the same order, after each tile is written.
+  ASSERT_EQ( plain.metadata_order.size(), encoded.metadata_order.size() );
+  for( size_t i = 0; i < plain.metadata_order.size(); ++i )
+    EXPECT_EQ( plain.metadata_order[i], encoded.metadata_order[i] );
+  EXPECT_EQ( 0u, encoded.metadata_before_tile );
+
+  EXPECT_EQ( encoded.tiles.size(), encoded.stats.tiles );
+  EXPECT_EQ( encoded.tiles.size() * 32 * 32, encoded.stats.pixels );
+  EXPECT_EQ( plain.stats.tiles, encoded.stats.tiles );
+  EXPECT_GE( encoded.stats.seconds, 0 );
+}
+
+TEST( QuadTreeGenerator, ResampleFilter ) {
+  // Halving with the area filter averages blocks, as box_subsample does.
+  ImageView<float> image = test_image();
+  TileCollector plain, area, lanczos;
+  area.resample_filter = AreaResampleFilter;
+  lanczos.resample_filter = LanczosResampleFilter;
+  plain.generate( image, 1 );
+  area.generate( image, 1 );
+  lanczos.generate( image, 1 );
+
+  ASSERT_EQ( plain.tiles.size(), area.tiles.size() );
+  ASSERT_EQ( plain.tiles.size(), lanczos.tiles.size() );
+  for( TileMap::const_iterator it = plain.tiles.begin(); it != plain.tiles.end(); ++it ) {
+    ImageView<float> const& a = area.tiles[it->first];
+    for( int32 row = 0; row < a.rows(); ++row )
+      for( int32 col = 0; col < a.cols(); ++col )
+        EXPECT_NEAR( it->second(col,row), a(col,row), 1e-3 ) << it->first;
+  }
+
+  // The leaves are the same with any filter, and the root is not.
+  EXPECT_EQ( plain.tiles["0000"](5,5), lanczos.tiles["0000"](5,5) );
+  double difference = 0;
+  for( int32 row = 0; row < 32; ++row )
+    for( int32 col = 0; col < 32; ++col )
+      difference += fabs( plain.tiles[""](col,row) - lanczos.tiles[""](col,row) );
+  EXPECT_GT( difference, 1.0 );
+}
+
+namespace {
+  std::vector<std::pair<std::string,BBox2i> > no_branches( QuadTreeGenerator const&, std::string const&, BBox2i const& ) {
+    return std::vector<std::pair<std::string,BBox2i> >();
+  }
+}
+
+TEST( QuadTreeGenerator, ResampleFilterLeaf ) {
+  // A root with no children is reduced from the source, and keeps only
+  // the pixels subsample() would have taken from it.
+  ImageView<float> image( 100, 60 );
+  fill( image, 3.0f );
+  TileCollector collector;
+  QuadTreeGenerator qtree( image );
+  qtree.set_tile_size( 32 );
+  qtree.set_resample_filter( CubicResampleFilter );
+  qtree.set_branch_func( &no_branches );
+  qtree.set_tile_resource_func( boost::bind( &TileCollector::resource, &collector, _1, _2, _3 ) );
+  qtree.generate();
+
+  ASSERT_EQ( 1u, collector.tiles.size() );
+  ImageView<float> const& root = collector.tiles[""];
+  ASSERT_EQ( 32, root.cols() );
+  for( int32 row = 0; row < 32; ++row )
+    for( int32 col = 0; col < 32; ++col ) {
+      if( col < 25 && row < 15 ) {
+        EXPECT_NEAR( 3.0f, root(col,row), 1e-5 ) << col << "," << row;
+      } else {
+        EXPECT_EQ( 0.0f, root(col,row) ) << col << "," << row;
+      }
+    }
+}
@@ -0,0 +1,121 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestTileArchive.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Mosaic/TileArchive.h>
+#include <test/Helpers.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+namespace {
+
+  std::string tile_name( int thread, int i ) {
+    std::ostringstream name;
+    name << thread << "/" << i << ".raw";
+    return name.str();
+  }
+
+  std::vector<uint8> tile_data( int thread, int i ) {
+    std::vector<uint8> data( 1 + (thread * 37 + i * 11) % 300 );
+    for( size_t j = 0; j < data.size(); ++j )
+      data[j] = uint8( thread + i + j );
+    return data;
+  }
+
+  struct AddTiles {
+    TileArchiveWriter* writer;
+    int thread;
+    void operator()() {
+      for( int i = 0; i < 200; ++i ) {
+        std::vector<uint8> data = tile_data( thread, i );
+        writer->add( tile_name( thread, i ), &data[0], data.size() );
+      }
+    }
+  };
+
+}
+
+TEST( TileArchive, RoundTrip ) {
+  UnlinkName file( "tiles.vwtiles" );
+  {
+    // A small batch size so that most tiles are written before close().
+    TileArchiveWriter writer( file, 1000 );
+    std::vector<boost::shared_ptr<Thread> > threads;
+    for( int t = 0; t < 4; ++t ) {
+      AddTiles task = { &writer, t };
+      threads.push_back( boost::shared_ptr<Thread>( new Thread( task ) ) );
+    }
+    for( size_t t = 0; t < threads.size(); ++t )
+      threads[t]->join();
+
+    // Replace a tile.
+    const uint8 replacement[3] = { 7, 8, 9 };
+    writer.add( tile_name( 2, 5 ), replacement, 3 );
+    writer.close();
+    EXPECT_THROW( writer.add( "late.raw", replacement, 3 ), LogicErr );
+  }
+
+  TileArchiveReader reader( file );
+  ASSERT_EQ( 800u, reader.size() );
+  std::vector<std::string> names = reader.names();
+  EXPECT_TRUE( std::is_sorted( names.begin(), names.end() ) );
+
+  std::vector<uint8> data;
+  for( int t = 0; t < 4; ++t )
+    for( int i = 0; i < 200; ++i ) {
+      ASSERT_TRUE( reader.read( tile_name( t, i ), data ) );
+      if( t == 2 && i == 5 ) {
+        ASSERT_EQ( 3u, data.size() );
+        EXPECT_EQ( 9, data[2] );
+      } else {
+        EXPECT_TRUE( data == tile_data( t, i ) );
+      }
+    }
+  EXPECT_FALSE( reader.contains( "4/0.raw" ) );
+  EXPECT_FALSE( reader.read( "4/0.raw", data ) );
+  EXPECT_FALSE( reader.open( "4/0.png" ) );
+}
+
+TEST( TileArchive, BadFiles ) {
+  EXPECT_THROW( TileArchiveReader( "no_such_archive.vwtiles" ), IOErr );
+
+  UnlinkName empty( "empty.vwtiles" );
+  {
+    TileArchiveWriter writer( empty );
+  }
+  EXPECT_EQ( 0u, TileArchiveReader( empty ).size() );
+
+  // An archive that was never closed has no index.
+  UnlinkName truncated( "truncated.vwtiles" );
+  {
+    std::ifstream in( empty.c_str(), std::ios::binary );
+    std::ofstream out( truncated.c_str(), std::ios::binary );
+    std::vector<char> bytes( 12 );
+    in.read( &bytes[0], bytes.size() );
+    out.write( &bytes[0], bytes.size() );
+    out.write( "garbage data", 12 );
+  }
+  EXPECT_THROW( TileArchiveReader reader( truncated ), IOErr );
+}
@@ -0,0 +1,143 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestTileServer.cxx
+#include <gtest/gtest_VW.h>
+#include <vw/Mosaic/TileServer.h>
+#include <test/Helpers.h>
+
+#include <boost/bind.hpp>
+
+using namespace vw;
+using namespace vw::mosaic;
+using namespace vw::test;
+
+namespace {
+
+  typedef std::map<std::string, ImageView<float> > TileMap;
+
+  // Keeps the tiles a generator writes, by name.
+  class TileResource : public DstImageResource {
+    TileMap     &m_tiles;
+    std::string  m_name;
+  public:
+    TileResource( TileMap &tiles, std::string const& name ) : m_tiles( tiles ), m_name( name ) {}
+    virtual void write( ImageBuffer const& buf, BBox2i const& bbox ) {
+      ImageView<float> tile( bbox.width(), bbox.height() );
+      convert( tile.buffer(), buf );
+      m_tiles[m_name] = tile;
+    }
+    virtual bool has_block_write()  const { return false; }
+    virtual bool has_nodata_write() const { return false; }
+    virtual void flush() {}
+  };
+
+  boost::shared_ptr<DstImageResource> tile_resource( TileMap *tiles, QuadTreeGenerator const&,
+                                                     QuadTreeGenerator::TileInfo const& info, ImageFormat const& ) {
+    return boost::shared_ptr<DstImageResource>( new TileResource( *tiles, info.name ) );
+  }
+
+  ImageView<float> test_image() {
+    ImageView<float> image( 300, 170 );
+    for( int32 row = 0; row < image.rows(); ++row )
+      for( int32 col = 0; col < image.cols(); ++col )
+        image( col, row ) = float( (col*7 + row*13) % 29 ) + 0.5f*row;
+    return image;
+  }
+
+  struct Requester {
+    TileServer<float> *server;
+    void operator()() { server->tile( 3, 2, 1 ); }
+  };
+
+}
+
+TEST( TileServer, MatchesGenerator ) {
+  ImageView<float> image = test_image();
+  QuadTreeGenerator qtree( image );
+  qtree.set_tile_size( 32 );
+  TileMap tiles;
+  qtree.set_tile_resource_func( boost::bind( &tile_resource, &tiles, _1, _2, _3 ) );
+  qtree.generate();
+
+  TileServer<float> server( image, qtree );
+  ASSERT_EQ( 5, server.levels() );
+  EXPECT_FALSE( server.valid( 4, 16, 0 ) );
+  EXPECT_THROW( server.tile_info( 5, 0, 0 ), ArgumentErr );
+
+  // The bottom level is rendered just as the generator does.
+  const int32 bottom = server.levels() - 1;
+  for( int32 y = 0; y < (1 << bottom); ++y ) {
+    for( int32 x = 0; x < (1 << bottom); ++x ) {
+      QuadTreeGenerator::TileInfo info = server.tile_info( bottom, x, y );
+      EXPECT_EQ( BBox2i( x*32, y*32, 32, 32 ), info.region_bbox );
+      ImageView<float> tile = server.tile( bottom, x, y );
+      TileMap::const_iterator expected = tiles.find( info.name );
+      if( expected == tiles.end() ) {
+        EXPECT_FALSE( tile.is_valid_image() ) << info.name;
+        continue;
+      }
+      ASSERT_TRUE( tile.is_valid_image() ) << info.name;
+      EXPECT_SEQ_EQ( expected->second, tile );
+    }
+  }
+  EXPECT_EQ( "", server.tile_info( 0, 0, 0 ).name );
+  EXPECT_EQ( "21", server.tile_info( 2, 1, 2 ).name );
+  EXPECT_EQ( 32, server.tile( 0, 0, 0 ).cols() );
+}
+
+TEST( TileServer, CacheAndCoalescing ) {
+  ImageView<float> image = test_image();
+  QuadTreeGenerator qtree( image );
+  qtree.set_tile_size( 32 );
+
+  {
+    // Concurrent requests for a tile render it once.
+    TileServer<float> server( image, qtree, 4 );
+    Requester requester = { &server };
+    std::vector<boost::shared_ptr<Thread> > threads;
+    for( int i = 0; i < 8; ++i )
+      threads.push_back( boost::shared_ptr<Thread>( new Thread( requester ) ) );
+    for( size_t i = 0; i < threads.size(); ++i )
+      threads[i]->join();
+    EXPECT_EQ( 8u, server.stats().requests );
+    EXPECT_EQ( 1u, server.stats().renders );
+  }
+
+  // The least recently used tile is dropped.
+  TileServer<float> server( image, qtree, 2 );
+  server.tile( 4, 0, 0 );
+  server.tile( 4, 1, 0 );
+  server.tile( 4, 0, 0 );
+  server.tile( 4, 2, 0 );
+  EXPECT_EQ( 2u, server.size() );
+  EXPECT_EQ( 3u, server.stats().renders );
+  server.tile( 4, 0, 0 );
+  EXPECT_EQ( 3u, server.stats().renders );
+  server.tile( 4, 1, 0 );
+  EXPECT_EQ( 4u, server.stats().renders );
+
+  // A prefetched tile is served from memory.
+  server.prefetch( 4, 3, 0 );
+  for( int i = 0; i < 1000 && server.stats().renders < 5; ++i )
+    Thread::sleep_ms( 5 );
+  ASSERT_EQ( 5u, server.stats().renders );
+  uint64 hits = server.stats().hits;
+  server.tile( 4, 3, 0 );
+  EXPECT_EQ( hits + 1, server.stats().hits );
+}
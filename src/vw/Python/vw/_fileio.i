@@ -18,6 +18,7 @@
 
 %module fileio
 %include "std_string.i"
+%include "vwutil.i"
 %import "_image.i"
 
 %{
@@ -72,6 +73,9 @@ namespace vw {
   };
 }
 
+RELEASE_GIL_AND_HANDLE_VW_EXCEPTIONS(_read_image)
+RELEASE_GIL_AND_HANDLE_VW_EXCEPTIONS(_write_image)
+
 %inline %{
   template <class PixelT> void _read_image( vw::ImageView<PixelT>& image, vw::DiskImageResource& resource ) {
     vw::read_image( image, resource );
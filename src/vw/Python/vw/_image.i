@@ -19,10 +19,18 @@
 %module image
 %include "std_string.i"
 %include "std_vector.i"
+%include "vwutil.i"
 %import "_pixel.i"
 
 %{
 #include <vw/Image.h>
+
+// The format character of the buffer protocol for each channel type.
+template <class ChannelT> struct BufferFormat {};
+template <> struct BufferFormat<vw::uint8>   { static char code() { return 'B'; } };
+template <> struct BufferFormat<vw::int16>   { static char code() { return 'h'; } };
+template <> struct BufferFormat<vw::uint16>  { static char code() { return 'H'; } };
+template <> struct BufferFormat<vw::float32> { static char code() { return 'f'; } };
 %}
 
 %template(vector_float32) std::vector<vw::float32>;
@@ -63,6 +71,21 @@
     else:
       return image.get_pixel(*pos)
 
+  def _image_array_interface(image):
+    '''The NumPy array interface of an ImageView, which lets numpy.asarray()
+    view the image's pixels without copying them.  The array keeps the image,
+    and with it the pixels, alive.  Its shape is (rows, cols), with a leading
+    planes axis if there is more than one plane and a trailing channels axis
+    if there is more than one channel.'''
+    import numpy
+    shape = (image.rows, image.cols)
+    if image.planes > 1: shape = (image.planes,) + shape
+    if image.channels > 1: shape = shape + (image.channels,)
+    return { 'version' : 3,
+             'shape'   : shape,
+             'typestr' : numpy.dtype(image.channel_type).str,
+             'data'    : (image._data_address(), False) }
+
   def Image_setitem(image, pos, val):
     if isinstance(pos, slice):
       image.set_region(val, pos.start[0], pos.start[1], pos.stop[0]-pos.start[0], pos.stop[1]-pos.start[1])
@@ -116,10 +139,12 @@ namespace vw {
       ImageView get_plane( int index ) { return select_plane(*self,index); }
       void set_plane( ImageView const& val, int index ) { select_plane(*self,index) = val; }
       void set_plane( PixelT const& val, int index ) { fill( select_plane(*self,index), val ); }
+      size_t _data_address() const { return size_t( self->data() ); }
     }
     %pythoncode {
       __getitem__ = Image_getitem
       __setitem__ = Image_setitem
+      __array_interface__ = property(_image_array_interface)
       cols = property(get_cols)
       rows = property(get_rows)
       planes = property(get_planes)
@@ -208,6 +233,90 @@ namespace vw {
 
 %instantiate_for_pixel_types(instantiate_image_types)
 
+RELEASE_GIL_AND_HANDLE_VW_EXCEPTIONS(vw::ImageViewRef::rasterize)
+
+
+// Wrapping Python buffers, such as NumPy arrays
+
+%typemap(in) PyObject *buffer_obj {
+  $1 = $input;
+}
+
+HANDLE_VW_EXCEPTIONS(_image_from_buffer)
+
+%inline %{
+  /// Wraps the memory of a writable, C-contiguous object with the buffer
+  /// protocol, such as a NumPy array, in an ImageView without copying it.
+  /// The ImageView holds the buffer, and so the object, until the last
+  /// ImageView sharing the memory is gone.  The shape must be (rows, cols)
+  /// or (planes, rows, cols), followed by a channels axis for pixel types
+  /// with more than one channel.
+  template <class PixelT>
+  vw::ImageView<PixelT> _image_from_buffer( PyObject *buffer_obj ) {
+    typedef typename vw::PixelChannelType<PixelT>::type channel_type;
+    const int num_channels = vw::PixelNumChannels<PixelT>::value;
+
+    Py_buffer *view = new Py_buffer;
+    if( PyObject_GetBuffer( buffer_obj, view, PyBUF_WRITABLE | PyBUF_FORMAT | PyBUF_C_CONTIGUOUS ) != 0 ) {
+      delete view;
+      vw_throw( vw::ArgumentErr() << "Cannot wrap an object without a writable, contiguous buffer." );
+    }
+    // From here on the buffer belongs to the memory of the image.
+    boost::shared_array<PixelT> data( (PixelT*)view->buf, BufferReleaser(view) );
+
+    const char *format = view->format ? view->format : "B";
+    if( *format == '@' || *format == '=' ) ++format;
+    if( view->itemsize != Py_ssize_t(sizeof(channel_type)) ||
+        format[0] != BufferFormat<channel_type>::code() || format[1] != '\0' )
+      vw_throw( vw::ArgumentErr() << "The buffer's element type \"" << view->format
+                << "\" does not match the channel type of the image." );
+
+    int ndim = view->ndim;
+    if( num_channels > 1 ) {
+      if( ndim < 1 || view->shape[ndim-1] != num_channels )
+        vw_throw( vw::ArgumentErr() << "The buffer's last axis must have " << num_channels << " channels." );
+      --ndim;
+    }
+    if( ndim != 2 && ndim != 3 )
+      vw_throw( vw::ArgumentErr() << "The buffer must have shape (rows, cols) or (planes, rows, cols)." );
+    vw::int32 planes = ( ndim == 3 ) ? vw::int32( view->shape[0] ) : 1;
+    vw::int32 rows   = vw::int32( view->shape[ndim-2] );
+    vw::int32 cols   = vw::int32( view->shape[ndim-1] );
+    return vw::ImageView<PixelT>( data, cols, rows, planes );
+  }
+%}
+
+%define %instantiate_image_from_buffer(cname,ctype,pname,ptype,...)
+  %template(_image_from_buffer_##pname) _image_from_buffer<ptype >;
+  %pythoncode {
+    _image_from_buffer_table[pixel.pname] = _image_from_buffer_##pname
+  }
+%enddef
+
+%pythoncode {
+  _image_from_buffer_table = dict()
+}
+
+%instantiate_for_pixel_types(instantiate_image_from_buffer)
+
+%pythoncode {
+  def image_from_array(array, ptype=None, pformat=None, ctype=None):
+    '''Wraps a writable, C-contiguous NumPy array in an ImageView which
+    shares its memory, so changes through either one show in the other.
+    The channel type defaults to that of the array and the pixel format to
+    scalar.  The array must have shape (rows, cols), optionally preceded by
+    a planes axis and followed by a channels axis for multi-channel pixels.'''
+    if ptype is None:
+      if ctype is None: ctype = array.dtype.type
+      if pformat is None: pformat = pixel.PixelScalar
+      if ctype not in pformat:
+        raise TypeError, 'Unsupported channel type %s' % array.dtype
+      ptype = pformat[ctype]
+    elif pformat is not None or ctype is not None:
+      raise Exception, "Cannot specify both ptype and pformat/ctype"
+    return _image_from_buffer_table[ptype](array)
+}
+
 
 // Edge Extension
 
@@ -39,6 +39,28 @@
 }
 %enddef
 
+// Like HANDLE_VW_EXCEPTIONS, but also lets other Python threads run
+// while the function works.  Only for functions that do not touch
+// Python objects, such as rasterizing or writing an image.
+%define RELEASE_GIL_AND_HANDLE_VW_EXCEPTIONS(function)
+%exception function {
+  try {
+    ReleaseGIL unlocked;
+    $action
+  }
+  catch (const vw::Exception& e) {
+    if( ! PyErr_Occurred() ) {
+      PyErr_Format( PyExc_RuntimeError, "Vision Workbench exception: %s", e.what() );
+    }
+    goto fail;
+  }
+}
+%enddef
+
+%init %{
+  PyEval_InitThreads();
+%}
+
 %{
 
 // A deleter object for use with boost::shared_ptr that keeps track
@@ -58,4 +80,29 @@ public:
   }
 };
 
+// Releases the GIL for as long as it exists, and takes it back when it
+// is destroyed, including when an exception is thrown.
+class ReleaseGIL {
+  PyThreadState *m_state;
+public:
+  ReleaseGIL() : m_state( PyEval_SaveThread() ) {}
+  ~ReleaseGIL() { PyEval_RestoreThread( m_state ); }
+};
+
+// A deleter object for use with boost::shared_array that releases a
+// buffer obtained with PyObject_GetBuffer() once the last C++ object
+// using its memory is gone.  That may happen on a thread that does not
+// hold the GIL, so the GIL is taken first.
+class BufferReleaser {
+  Py_buffer *m_view;
+public:
+  BufferReleaser( Py_buffer *view ) : m_view(view) {}
+  template <class T> void operator()(T) {
+    PyGILState_STATE state = PyGILState_Ensure();
+    PyBuffer_Release( m_view );
+    delete m_view;
+    PyGILState_Release( state );
+  }
+};
+
 %}
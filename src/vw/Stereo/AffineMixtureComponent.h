@@ -26,6 +26,7 @@
 #include <vw/Image/ImageViewBase.h>
 #include <iostream>
 #include <cmath>
+#include <vector>
 
 namespace vw {
   namespace stereo {
@@ -85,7 +86,9 @@ namespace vw {
       left_r(left.impl()), right_r(right.impl()), s(sigma_0), s0(sigma_0), s_min(sigma_min),
         M_transform_linear(matrix_data_linear), M_transform_offset(matrix_data_offset),
         pos_linearize(0, 0), w(window_size(0), window_size(1)), p(window_size(0), window_size(1)), w_gaussian(window_size(0), window_size(1)),
-        r_window(window_size(0), window_size(1)), l_window(window_size(0), window_size(1)), err(window_size(0), window_size(1))
+        w_adj(window_size(0), window_size(1)),
+        r_window(window_size(0), window_size(1)), l_window(window_size(0), window_size(1)), err(window_size(0), window_size(1)),
+        r_window_dx(window_size(0), window_size(1)), r_window_dy(window_size(0), window_size(1))
         {
           matrix_data_linear[0] = 1.; matrix_data_linear[1] = 0.; // linear component of affine transform
           matrix_data_linear[2] = 0; matrix_data_linear[3] = 1; // linear component of affine transform
@@ -117,7 +120,7 @@ namespace vw {
 
           // numerical optimization parameter default values
           epsilon_inner = 1e-8;
-          inner_loop_iter_max = 8; //20;
+          set_max_iter(8); //20;
           min_det = .1; // minimum determinant of the affine transformation; this determines the ratio that the affine transform is allowed to skew the area of the window by.
           max_det =  1.9; // maximum determinant of the affine transformation; this determines the ratio that the affine transform is allowed to skew the area of the window by.
 
@@ -295,6 +298,9 @@ namespace vw {
 
       void set_max_iter(int max_iter) {
         inner_loop_iter_max = max_iter;
+        gradient_hist.resize(max_iter);
+        state_hist.resize(max_iter);
+        hessian_hist.resize(max_iter);
       }
       void set_epsilon_convergence(PrecisionT epsilon) {
         epsilon_inner = epsilon;
@@ -310,21 +316,12 @@ namespace vw {
         PrecisionT x = pos_linearize(0);
         PrecisionT y = pos_linearize(1);
 
-        ImageViewRef<PrecisionT> w_adj = w*w_gaussian;
-
-        ImageView<PixelT> r_window_dx(window.width(), window.height());
-        ImageView<PixelT> r_window_dy(window.width(), window.height());
-
-        typedef Vector<PrecisionT, 6> Vector6;
-        typedef Matrix<PrecisionT, 6, 6> Matrix66;
+        // the window buffers are members, so they are only allocated once
+        w_adj = w*w_gaussian;
 
         Vector6 gradient, soln;
         Matrix66 hessian_temp;
 
-        Vector6* gradient_hist = new Vector6[inner_loop_iter_max];
-        Vector6* state_hist = new Vector6[inner_loop_iter_max];
-        Matrix66* hessian_hist = new Matrix66[inner_loop_iter_max];
-
         PrecisionT initial_norm_grad = 0;
         if(debug) {
           std::cout << "initializing..." << std::endl;
@@ -562,14 +559,12 @@ namespace vw {
         }
 
         hess = hess/(sum_weights*s*s);
-
-        // Clean up our dynamic arrays
-        delete[] gradient_hist;
-        delete[] state_hist;
-        delete[] hessian_hist;
       }
 
     private:
+      typedef Vector<PrecisionT, 6> Vector6;
+      typedef Matrix<PrecisionT, 6, 6> Matrix66;
+
       bool debug;
 
       ImageViewRef<PixelT> left_r;
@@ -595,10 +590,16 @@ namespace vw {
       ImageView<PrecisionT> w;  // weights
       ImageView<PrecisionT> p; // posterior probabilities of data in window
       ImageView<PrecisionT> w_gaussian;  // gaussian window
+      ImageView<PrecisionT> w_adj; // weights times the gaussian window
 
       ImageView<PixelT> r_window;
       ImageView<PixelT> l_window;
       ImageView<PrecisionT> err;
+      ImageView<PixelT> r_window_dx, r_window_dy; // right image derivatives in the window
+
+      // inner loop history, kept for debugging
+      std::vector<Vector6> gradient_hist, state_hist;
+      std::vector<Matrix66> hessian_hist;
 
       AffineTransformOrigin T;
       bool l_set;
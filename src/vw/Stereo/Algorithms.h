@@ -38,24 +38,27 @@ namespace stereo {
   // function as crops of an ImageView is still memory striding.
   //
   // This expects the input to already be over cropped.
-  template <class AccumulatorType, class ViewT>
-  ImageView<typename PixelChannelCast<typename ViewT::pixel_type, AccumulatorType>::type>
-  fast_box_sum( ImageViewBase<ViewT> const& image, Vector2i const& kernel ) {
+  //
+  // This version writes into a caller provided output image. The
+  // output is only reallocated if it does not already have the
+  // result size, so callers summing many images of the same size in
+  // a loop only pay for the allocation once.
+  template <class ViewT, class AccumT>
+  void fast_box_sum( ImageViewBase<ViewT> const& image, Vector2i const& kernel,
+                     ImageView<AccumT>& output ) {
     // Sanity check, constants, and types
     VW_ASSERT( kernel[0] % 2 == 1 && kernel[1] % 2 == 1,
                ArgumentErr() << "fast_box_sum: Kernel input not sized with odd values." );
 
     typedef typename ViewT::pixel_accessor PAccT;
-    typedef typename ViewT::pixel_type PixelT;
-    typedef typename PixelChannelCast<PixelT,AccumulatorType>::type AccumT;
 
     ViewT const& input( image.impl() ); // This just helps keep the code cleaner
     VW_DEBUG_ASSERT( input.cols() >= kernel[0] && input.rows() >= kernel[1],
                      ArgumentErr() << "fast_box_sum: Image is not big enough for kernel." );
 
     // Allocating output
-    ImageView<AccumT> output( input.cols()-kernel[0]+1,
-                              input.rows()-kernel[1]+1 );
+    output.set_size( input.cols()-kernel[0]+1,
+                     input.rows()-kernel[1]+1 );
     typedef typename ImageView<AccumT>::pixel_accessor OAccT;
 
     // Start column sum
@@ -124,7 +127,14 @@ namespace stereo {
       }
       *dst = row_sum;
     }
+  }
 
+  /// Allocating version of fast_box_sum.
+  template <class AccumulatorType, class ViewT>
+  ImageView<typename PixelChannelCast<typename ViewT::pixel_type, AccumulatorType>::type>
+  fast_box_sum( ImageViewBase<ViewT> const& image, Vector2i const& kernel ) {
+    ImageView<typename PixelChannelCast<typename ViewT::pixel_type, AccumulatorType>::type> output;
+    fast_box_sum( image, kernel, output );
     return output;
   }
 
@@ -31,6 +31,8 @@
 #include <vw/Math/Matrix.h>
 #include <vw/Math/LinearAlgebra.h>
 
+#include <vector>
+
 namespace vw {
 namespace stereo {
 
@@ -131,6 +131,7 @@ subpixel_correlation_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map
   // Workspace images are allocated up here out of the tight inner
   // loop.  We rasterize into these directly in the code below.
   ImageView<float> w(kern_width, kern_height);
+  ImageView<PixelMask<Vector2f> > disparity_patch(kern_width, kern_height);
 
   // Iterate over all of the pixels in the disparity map except for
   // the outer edges.
@@ -167,9 +168,9 @@ subpixel_correlation_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map
       CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
 
       // Compute the base weight image
+      disparity_patch = crop(disparity_map, current_window);
       int32 good_pixels =
-        adjust_weight_image(w, crop(disparity_map, current_window),
-                            weight_template);
+        adjust_weight_image(w, disparity_patch, weight_template);
 
       // Skip over pixels for which there are very few good matches
       // in the neighborhood.
@@ -492,6 +493,7 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
 
   // Fixed consts
   const unsigned M_MAX_EM_ITER = 2;
+  const float CONVERGED_STEP_SIZE = 0.05;
   const float two_sigma_sqr = 2.0*pow(float(kern_width)/5.0,2.0);
 
   VW_ASSERT( disparity_map.cols() == left_image.cols() &&
@@ -511,6 +513,8 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
   const int32 kern_half_width  = kern_width/2;
   const int32 kern_pixels      = kern_height * kern_width;
   const int32 weight_threshold = kern_pixels/2;
+  const int32 kern_quarter_height = kern_half_height/2;
+  const int32 kern_quarter_width  = kern_half_width /2;
 
   ImageView<float> x_deriv = derivative_filter(left_image, 1, 0);
   ImageView<float> y_deriv = derivative_filter(left_image, 0, 1);
@@ -520,6 +524,7 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
   // Workspace images are allocated up here out of the tight inner
   // loop.  We rasterize into these directly in the code below.
   ImageView<float> w(kern_width, kern_height);
+  ImageView<PixelMask<Vector2f> > disparity_patch(kern_width, kern_height);
 
   // Iterate over all of the pixels in the disparity map except for
   // the outer edges.
@@ -557,7 +562,8 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
       CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
 
       // Compute the base weight image
-      int32 good_pixels = adjust_weight_image(w, crop(disparity_map, current_window), weight_template);
+      disparity_patch = crop(disparity_map, current_window);
+      int32 good_pixels = adjust_weight_image(w, disparity_patch, weight_template);
 
       // Skip over pixels for which there are very few good matches
       // in the neighborhood.
@@ -801,6 +807,22 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
         if (curr_sum_I_e_val < 0)
           curr_sum_I_e_val = - curr_sum_I_e_val;
 
+        // A NaN never compares as an increase in the error below, so
+        // stop now instead of running the remaining iterations. The
+        // pixel is invalidated after the loop.
+        if (std::isnan(d[2]) || std::isnan(d[5]))
+          break;
+
+        // Quit once the change in the affine transform is tiny, using
+        // the same test as subpixel_optimized_affine_2d().
+        Vector6f weighted_lhs(lhs);
+        weighted_lhs[0] *= kern_quarter_width;
+        weighted_lhs[1] *= kern_quarter_height;
+        weighted_lhs[3] *= kern_quarter_width;
+        weighted_lhs[4] *= kern_quarter_height;
+        if (norm_2(weighted_lhs) < CONVERGED_STEP_SIZE)
+          break;
+
         // Termination condition
         if ((prev_sum_I_e_val < curr_sum_I_e_val) && (iter > 0))
           break;
@@ -881,6 +903,30 @@ subpixel_optimized_affine_2d_EM(ImageView<PixelMask<Vector2f> > &disparity_map,
       }
       return weight;
     }
+
+    /// Bilinear interpolation straight from the pixel buffer of an image,
+    /// with no bounds checking.  Gives the same values as
+    /// BilinearInterpolation at locations that are safely inside the image.
+    template <class ChannelT>
+    inline ChannelT bilinear_interp_unsafe(ChannelT const* data, int32 stride,
+                                           double i, double j) {
+      typedef typename FloatType<ChannelT>::type real_type;
+
+      int32 x = math::impl::_floor(i), y = math::impl::_floor(j);
+      ChannelT const* p = data + ptrdiff_t(y)*stride + x;
+      if (x == i && y == j)
+        return channel_cast_round_if_int<ChannelT>(*p);
+
+      real_type normx = real_type(i)-real_type(x), normy = real_type(j)-real_type(y),
+                norm1mx = 1-normx, norm1my = 1-normy;
+      real_type result = p[0] * norm1mx;
+      result += p[1] * normx;
+      result *= norm1my;
+      real_type row = p[stride] * norm1mx;
+      row += p[stride+1] * normx;
+      result += row * normy;
+      return channel_cast_round_if_int<ChannelT>(result);
+    }
   } // End namespace detail
 
 
@@ -899,7 +945,6 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
                              
   typedef Vector<float,6  > Vector6f;
   typedef Matrix<float,6,6> Matrix6x6f;
-  typedef typename ImageView<float>::pixel_accessor ImageViewFAcc;
   typedef typename CropView<ImageView<float   > >::pixel_accessor CropViewFAcc;
   typedef typename CropView<ImageView<ChannelT> >::pixel_accessor CropViewTAcc;
 
@@ -922,9 +967,9 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   // Interpolated Input Images
   InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> right_interp_image =
          interpolate(right_image, BilinearInterpolation(), ZeroEdgeExtension());
-  // An alternate interpolation view with no bounds checking!
-  InterpolationView<EdgeExtensionView<ImageView<ChannelT>, NoEdgeExtension>, BilinearInterpolation> right_interp_image_unsafe =
-         interpolate(right_image, BilinearInterpolation(), NoEdgeExtension());
+  // Direct buffer access for windows that are safely inside the right image.
+  ChannelT const* right_data   = right_image.data();
+  const int32     right_stride = right_image.cols();
 
 
 
@@ -946,6 +991,13 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   // Workspace images are allocated up here out of the tight inner
   // loop.  We rasterize into these directly in the code below.
   ImageView<float> w(kern_width, kern_height);
+  ImageView<PixelMask<Vector2f> > disparity_patch(kern_width, kern_height);
+
+  // Flat per window copies of the weighted derivatives and the left
+  // pixels, in row major order.  None of these change between the
+  // iterations for a pixel so they are only gathered once.
+  std::vector<float   > I_x_w(kern_pixels), I_y_w(kern_pixels);
+  std::vector<ChannelT> left_vals(kern_pixels);
 
   // Iterate over all of the pixels in the disparity map except for the outer edges.
   for ( int32 y = std::max(region_of_interest.min().y()-1,kern_half_height);
@@ -982,7 +1034,8 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
       CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
 
       // Compute the base weight image
-      int32 good_pixels = adjust_weight_image(w, crop(disparity_map, current_window), weight_template);
+      disparity_patch = crop(disparity_map, current_window);
+      int32 good_pixels = adjust_weight_image(w, disparity_patch, weight_template);
 
       // Skip over pixels for which there are very few good matches
       // in the neighborhood.
@@ -991,6 +1044,85 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         continue;
       }
 
+      // The right hand side only depends on the window weights and
+      // derivatives, so it is built once here while gathering the
+      // window and only copied in each iteration.
+      // - All window pixels use the weight at the window origin.
+      Matrix6x6f rhs_window;
+      {
+        float* rhsData = rhs_window.data(); // Access RHS by raw data pointer to avoid inlining failure
+        const float weight = w(0,0);
+
+        CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
+        CropViewTAcc left_image_patch_row = left_image_patch.origin();
+        int32 k = 0;
+        for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
+          CropViewFAcc I_x_ptr = I_x_row, I_y_ptr = I_y_row;
+          CropViewTAcc left_image_patch_ptr = left_image_patch_row;
+          for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii, ++k) {
+            float I_x_val = weight  * (*I_x_ptr);
+            float I_y_val = weight  * (*I_y_ptr);
+            float I_x_sqr = I_x_val * (*I_x_ptr);
+            float I_y_sqr = I_y_val * (*I_y_ptr);
+            float I_x_I_y = I_x_val * (*I_y_ptr);
+            I_x_w    [k] = I_x_val;
+            I_y_w    [k] = I_y_val;
+            left_vals[k] = *left_image_patch_ptr;
+
+            float multipliers[3];
+            multipliers[0] = ii*ii;
+            multipliers[1] = ii*jj;
+            multipliers[2] = jj*jj;
+
+            // Right Hand Side UL
+            rhsData[ 0] += multipliers[0] * I_x_sqr;
+            rhsData[ 1] += multipliers[1] * I_x_sqr;
+            rhsData[ 2] += ii    * I_x_sqr;
+            rhsData[ 7] += multipliers[2] * I_x_sqr;
+            rhsData[ 8] += jj    * I_x_sqr;
+            rhsData[14] +=         I_x_sqr;
+
+            // Right Hand Side UR
+            rhsData[ 3] += multipliers[0] * I_x_I_y;
+            rhsData[ 4] += multipliers[1] * I_x_I_y;
+            rhsData[ 5] += ii    * I_x_I_y;
+            rhsData[10] += multipliers[2] * I_x_I_y;
+            rhsData[11] += jj    * I_x_I_y;
+            rhsData[17] +=         I_x_I_y;
+
+            // Right Hand Side LR
+            rhsData[21] += multipliers[0] * I_y_sqr;
+            rhsData[22] += multipliers[1] * I_y_sqr;
+            rhsData[23] += ii    * I_y_sqr;
+            rhsData[28] += multipliers[2] * I_y_sqr;
+            rhsData[29] += jj    * I_y_sqr;
+            rhsData[35] +=         I_y_sqr;
+
+            I_x_ptr.next_col();
+            I_y_ptr.next_col();
+            left_image_patch_ptr.next_col();
+          }
+          I_x_row.next_row();
+          I_y_row.next_row();
+          left_image_patch_row.next_row();
+        }
+
+        // Fill in symmetric entries
+        Matrix6x6f& rhs = rhs_window;
+        rhs(1,0) = rhs(0,1);
+        rhs(2,0) = rhs(0,2);
+        rhs(2,1) = rhs(1,2);
+        rhs(3,0) = rhs(0,3);
+        rhs(1,3) = rhs(3,1) = rhs(4,0) = rhs(0,4);
+        rhs(2,3) = rhs(3,2) = rhs(5,0) = rhs(0,5);
+        rhs(4,1) = rhs(1,4);
+        rhs(2,4) = rhs(4,2) = rhs(5,1) = rhs(1,5);
+        rhs(5,2) = rhs(2,5);
+        rhs(4,3) = rhs(3,4);
+        rhs(5,3) = rhs(3,5);
+        rhs(5,4) = rhs(4,5);
+      }
+
       //float curr_sum_I_e_val = 0.0;
       //float prev_sum_I_e_val = 0.0;
 
@@ -1007,9 +1139,7 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         float x_base = x + disparity_map(x,y)[0];
         float y_base = y + disparity_map(x,y)[1];
 
-        //curr_sum_I_e_val = 0.0;
-        
-        Matrix6x6f rhs;
+        Matrix6x6f rhs(rhs_window); // Overwritten by the solver
         Vector6f lhs;
 
 
@@ -1039,20 +1169,17 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
           }
         }
 
-        // Set up pixel accessors
-        CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
-        CropViewTAcc left_image_patch_row = left_image_patch.origin();
-        ImageViewFAcc w_row = w.origin();
-
+        // Only the error term changes between iterations.
+        // - The sums are kept in locals so they can stay in registers.
+        const float*    I_x_w_ptr  = &(I_x_w[0]);
+        const float*    I_y_w_ptr  = &(I_y_w[0]);
+        const ChannelT* left_ptr   = &(left_vals[0]);
+        float lhs0 = 0, lhs1 = 0, lhs2 = 0, lhs3 = 0, lhs4 = 0, lhs5 = 0;
         for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
         
-          ImageViewFAcc w_ptr = w_row;
-          CropViewFAcc  I_x_ptr = I_x_row, I_y_ptr = I_y_row;
-          CropViewTAcc  left_image_patch_ptr = left_image_patch_row;
           float xx_partial      = x_base + dPtr[1] * jj + dPtr[2]; // Compute outside inner loop for speed
           float yy_partial      = y_base + dPtr[4] * jj + dPtr[5];
 
-
           for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii) {
             // First we compute the pixel offset for the right image
             // and the error for the current pixel.
@@ -1062,130 +1189,24 @@ subpixel_optimized_affine_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
             // Avoid using the edge-extension view when possible.
             ChannelT interpreted_px;
             if (use_unsafe_interp)
-              interpreted_px = right_interp_image_unsafe(xx,yy);
+              interpreted_px = detail::bilinear_interp_unsafe(right_data, right_stride, xx, yy);
             else
               interpreted_px = right_interp_image(xx,yy);
-            float I_e_val = interpreted_px - (*left_image_patch_ptr);
-            
-            
-            // Apply the robust cost function.  We use a cauchy
-            // function to gently remove outliers for small errors.
-            //float thresh = 1e-4;
-
-            // Cauchy seems to work well with thresh ~= 1e-4
-            //float error_value   = fabsf(I_e_val);
-            //float robust_weight = sqrtf(detail::cauchy_robust_coefficient(error_value,thresh))/error_value;
-
-            //curr_sum_I_e_val += error_value; // Accumulated error value over pixels
-
-            // Huber seems to work well with thresh >= 1e-5
-            //        float robust_weight = sqrt(detail::huber_robust_coefficient(fabs(I_e_val),thresh))/fabs(I_e_val);
-
-            // Disable robust cost function altogether
-            float robust_weight = 1;
-        
-            // We combine the error value with the derivative and
-            // add this to the update equation.
-            float weight = robust_weight *(*w_ptr);
-            
-            //in_curr_sum_I_e_val += I_e_val;
-           
-            
-            float I_x_val = weight  * (*I_x_ptr);
-            float I_y_val = weight  * (*I_y_ptr);
-            float I_x_sqr = I_x_val * (*I_x_ptr);
-            float I_y_sqr = I_y_val * (*I_y_ptr);
-            float I_x_I_y = I_x_val * (*I_y_ptr);
+            float I_e_val = interpreted_px - (*left_ptr++);
 
             // Left hand side
-            float IxIe = I_x_val * I_e_val;
-            float IyIe = I_y_val * I_e_val;
-            lhs(0) -= ii * IxIe;
-            lhs(1) -= jj * IxIe;
-            lhs(2) -=      IxIe;
-            lhs(3) -= ii * IyIe;
-            lhs(4) -= jj * IyIe;
-            lhs(5) -=      IyIe;
-
-            float multipliers[3];
-            multipliers[0] = ii*ii;
-            multipliers[1] = ii*jj;
-            multipliers[2] = jj*jj;
-
-            float* rhsData = rhs.data(); // Access RHS by raw data pointer to avoid inlining failure
-            
-            // Right Hand Side UL
-            rhsData[ 0] += multipliers[0] * I_x_sqr;
-            rhsData[ 1] += multipliers[1] * I_x_sqr;
-            rhsData[ 2] += ii    * I_x_sqr;
-            rhsData[ 7] += multipliers[2] * I_x_sqr;
-            rhsData[ 8] += jj    * I_x_sqr;
-            rhsData[14] +=         I_x_sqr;
-
-            // Right Hand Side UR
-            rhsData[ 3] += multipliers[0] * I_x_I_y;
-            rhsData[ 4] += multipliers[1] * I_x_I_y;
-            rhsData[ 5] += ii    * I_x_I_y;
-            rhsData[10] += multipliers[2] * I_x_I_y;
-            rhsData[11] += jj    * I_x_I_y;
-            rhsData[17] +=         I_x_I_y;
-
-            // Right Hand Side LR
-            rhsData[21] += multipliers[0] * I_y_sqr;
-            rhsData[22] += multipliers[1] * I_y_sqr;
-            rhsData[23] += ii    * I_y_sqr;
-            rhsData[28] += multipliers[2] * I_y_sqr;
-            rhsData[29] += jj    * I_y_sqr;
-            rhsData[35] +=         I_y_sqr;
-
-/*          For some reason these function calls are not being inlined!!!
-            // Right Hand Side UL
-            rhs(0,0) += multipliers[0] * I_x_sqr;
-            rhs(0,1) += multipliers[1] * I_x_sqr;
-            rhs(0,2) += ii    * I_x_sqr;
-            rhs(1,1) += multipliers[2] * I_x_sqr;
-            rhs(1,2) += jj    * I_x_sqr;
-            rhs(2,2) +=         I_x_sqr;
-
-            // Right Hand Side UR
-            rhs(0,3) += multipliers[0] * I_x_I_y;
-            rhs(0,4) += multipliers[1] * I_x_I_y;
-            rhs(0,5) += ii    * I_x_I_y;
-            rhs(1,4) += multipliers[2] * I_x_I_y;
-            rhs(1,5) += jj    * I_x_I_y;
-            rhs(2,5) +=         I_x_I_y;
-
-            // Right Hand Side LR
-            rhs(3,3) += multipliers[0] * I_y_sqr;
-            rhs(3,4) += multipliers[1] * I_y_sqr;
-            rhs(3,5) += ii    * I_y_sqr;
-            rhs(4,4) += multipliers[2] * I_y_sqr;
-            rhs(4,5) += jj    * I_y_sqr;
-            rhs(5,5) +=         I_y_sqr;
-*/
-
-            I_x_ptr.next_col();
-            I_y_ptr.next_col();
-            left_image_patch_ptr.next_col();
+            float IxIe = (*I_x_w_ptr++) * I_e_val;
+            float IyIe = (*I_y_w_ptr++) * I_e_val;
+            lhs0 -= ii * IxIe;
+            lhs1 -= jj * IxIe;
+            lhs2 -=      IxIe;
+            lhs3 -= ii * IyIe;
+            lhs4 -= jj * IyIe;
+            lhs5 -=      IyIe;
           }
-          I_x_row.next_row();
-          I_y_row.next_row();
-          left_image_patch_row.next_row();
         }
-
-        // Fill in symmetric entries
-        rhs(1,0) = rhs(0,1);
-        rhs(2,0) = rhs(0,2);
-        rhs(2,1) = rhs(1,2);
-        rhs(3,0) = rhs(0,3);
-        rhs(1,3) = rhs(3,1) = rhs(4,0) = rhs(0,4);
-        rhs(2,3) = rhs(3,2) = rhs(5,0) = rhs(0,5);
-        rhs(4,1) = rhs(1,4);
-        rhs(2,4) = rhs(4,2) = rhs(5,1) = rhs(1,5);
-        rhs(5,2) = rhs(2,5);
-        rhs(4,3) = rhs(3,4);
-        rhs(5,3) = rhs(3,5);
-        rhs(5,4) = rhs(4,5);
+        lhs(0) = lhs0; lhs(1) = lhs1; lhs(2) = lhs2;
+        lhs(3) = lhs3; lhs(4) = lhs4; lhs(5) = lhs5;
 
         // Solves lhs = rhs * x, and stores the result in-place in lhs.
         const math::f77_int n = 6;
@@ -1257,7 +1278,6 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
                              
   typedef Vector<float,2  > Vector2f;
   typedef Matrix<float,2,2> Matrix2x2f;
-  typedef typename ImageView<float>::pixel_accessor ImageViewFAcc;
   typedef typename CropView<ImageView<float   > >::pixel_accessor CropViewFAcc;
   typedef typename CropView<ImageView<ChannelT> >::pixel_accessor CropViewTAcc;
 
@@ -1276,6 +1296,9 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   // Interpolated Input Images
   InterpolationView<EdgeExtensionView<ImageView<ChannelT>, ZeroEdgeExtension>, BilinearInterpolation> right_interp_image =
          interpolate(right_image, BilinearInterpolation(), ZeroEdgeExtension());
+  // Direct buffer access for windows that are safely inside the right image.
+  ChannelT const* right_data   = right_image.data();
+  const int32     right_stride = right_image.cols();
 
   // This is the maximum number of pixels that the solution can be
   // adjusted by subpixel refinement.
@@ -1294,6 +1317,13 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   // Workspace images are allocated up here out of the tight inner
   // loop.  We rasterize into these directly in the code below.
   ImageView<float> w(kern_width, kern_height);
+  ImageView<PixelMask<Vector2f> > disparity_patch(kern_width, kern_height);
+
+  // Flat per window copies of the weighted derivatives and the left
+  // pixels, in row major order.  None of these change between the
+  // iterations for a pixel so they are only gathered once.
+  std::vector<float   > I_x_w(kern_pixels), I_y_w(kern_pixels);
+  std::vector<ChannelT> left_vals(kern_pixels);
 
   // Iterate over all of the pixels in the disparity map except for the outer edges.
   for ( int32 y = std::max(region_of_interest.min().y()-1,kern_half_height);
@@ -1321,7 +1351,8 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
       CropView<ImageView<float> > I_y = crop(y_deriv, current_window);
 
       // Compute the base weight image
-      int32 good_pixels = adjust_weight_image(w, crop(disparity_map, current_window), weight_template);
+      disparity_patch = crop(disparity_map, current_window);
+      int32 good_pixels = adjust_weight_image(w, disparity_patch, weight_template);
 
       // Skip over pixels for which there are very few good matches
       // in the neighborhood.
@@ -1330,6 +1361,45 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         continue;
       }
 
+      // The right hand side only depends on the window weights and
+      // derivatives, so it is built once here while gathering the
+      // window and only copied in each iteration.
+      // - All window pixels use the weight at the window origin.
+      Matrix2x2f rhs_window;
+      {
+        float* rhsData = rhs_window.data(); // Access RHS by raw data pointer to avoid inlining failure
+        const float weight = w(0,0);
+
+        CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
+        CropViewTAcc left_image_patch_row = left_image_patch.origin();
+        int32 k = 0;
+        for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
+          CropViewFAcc I_x_ptr = I_x_row, I_y_ptr = I_y_row;
+          CropViewTAcc left_image_patch_ptr = left_image_patch_row;
+          for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii, ++k) {
+            float I_x_val = weight  * (*I_x_ptr);
+            float I_y_val = weight  * (*I_y_ptr);
+            I_x_w    [k] = I_x_val;
+            I_y_w    [k] = I_y_val;
+            left_vals[k] = *left_image_patch_ptr;
+
+            rhsData[0] += I_x_val * (*I_x_ptr); // Right Hand Side UL
+            rhsData[1] += I_x_val * (*I_y_ptr); // Right Hand Side UR
+            rhsData[3] += I_y_val * (*I_y_ptr); // Right Hand Side LR
+
+            I_x_ptr.next_col();
+            I_y_ptr.next_col();
+            left_image_patch_ptr.next_col();
+          }
+          I_x_row.next_row();
+          I_y_row.next_row();
+          left_image_patch_row.next_row();
+        }
+
+        // Fill in symmetric entries
+        rhs_window(1,0) = rhs_window(0,1);
+      }
+
       // Iterate until a solution is found or the max number of
       // iterations is reached.
       for (unsigned iter = 0; iter < MAX_NUM_ITERATIONS; ++iter) {
@@ -1343,23 +1413,27 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         float x_base = x + disparity_map(x,y)[0];
         float y_base = y + disparity_map(x,y)[1];
 
-        Matrix2x2f rhs;
+        Matrix2x2f rhs(rhs_window); // Overwritten by the solver
         Vector2f lhs;
-   
-        // Set up pixel accessors
-        CropViewFAcc I_x_row = I_x.origin(), I_y_row = I_y.origin();
-        CropViewTAcc left_image_patch_row = left_image_patch.origin();
-        ImageViewFAcc w_row = w.origin();
 
-        // Perform loop that does Expectation and Maximization in one go
+        // Only the error term changes between iterations.
+        // - The sums are kept in locals so they can stay in registers.
+        const float*    I_x_w_ptr = &(I_x_w[0]);
+        const float*    I_y_w_ptr = &(I_y_w[0]);
+        const ChannelT* left_ptr  = &(left_vals[0]);
+        float lhs0 = 0, lhs1 = 0;
+
+        // The window is only translated, so it is enough to check its
+        // corners to know if we can skip the edge extension.
+        const float xx_partial = x_base + d[0]; // Compute outside inner loop for speed
+        const bool use_unsafe_interp =
+          (-kern_half_width + xx_partial >= 0) &&
+          ( kern_half_width + xx_partial <  right_image.cols()-1) &&
+          (y_base + -kern_half_height + d[1] >= 0) &&
+          (y_base +  kern_half_height + d[1] <  right_image.rows()-1);
+
         for (int32 jj = -kern_half_height; jj <= kern_half_height; ++jj) {
-        
-          ImageViewFAcc w_ptr = w_row;
-          CropViewFAcc  I_x_ptr = I_x_row, I_y_ptr = I_y_row;
-          CropViewTAcc  left_image_patch_ptr = left_image_patch_row;
-          
-          float xx_partial = x_base + d[0]; // Compute outside inner loop for speed
-          
+
           float yy = y_base + jj + d[1];
 
           for (int32 ii = -kern_half_width; ii <= kern_half_width; ++ii) {
@@ -1368,49 +1442,19 @@ subpixel_optimized_LK_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
             float xx = ii + xx_partial;
 
             /// Expectation
-            ChannelT interpreted_px = right_interp_image(xx,yy);
-            float I_e_val = interpreted_px - (*left_image_patch_ptr);
-            
-            // Disable robust cost function altogether
-            float robust_weight = 1;
-        
-            // We combine the error value with the derivative and
-            // add this to the update equation.
-            float weight = robust_weight *(*w_ptr);
-        
-            
-            float I_x_val = weight  * (*I_x_ptr);
-            float I_y_val = weight  * (*I_y_ptr);
-            float I_x_sqr = I_x_val * (*I_x_ptr);
-            float I_y_sqr = I_y_val * (*I_y_ptr);
-            float I_x_I_y = I_x_val * (*I_y_ptr);
+            ChannelT interpreted_px;
+            if (use_unsafe_interp)
+              interpreted_px = detail::bilinear_interp_unsafe(right_data, right_stride, xx, yy);
+            else
+              interpreted_px = right_interp_image(xx,yy);
+            float I_e_val = interpreted_px - (*left_ptr++);
 
             // Left hand side
-            lhs(0) -= I_x_val * I_e_val;
-            lhs(1) -= I_y_val * I_e_val;
-
-            float* rhsData = rhs.data(); // Access RHS by raw data pointer to avoid inlining failure
-
-            // Right Hand Side UL
-            rhsData[0] += I_x_sqr;
-
-            // Right Hand Side UR
-            rhsData[1] += I_x_I_y;
-
-            // Right Hand Side LR
-            rhsData[3] += I_y_sqr;
-
-            I_x_ptr.next_col();
-            I_y_ptr.next_col();
-            left_image_patch_ptr.next_col();
+            lhs0 -= (*I_x_w_ptr++) * I_e_val;
+            lhs1 -= (*I_y_w_ptr++) * I_e_val;
           }
-          I_x_row.next_row();
-          I_y_row.next_row();
-          left_image_patch_row.next_row();
         }
-
-        // Fill in symmetric entries
-        rhs(1,0) = rhs(0,1);
+        lhs(0) = lhs0; lhs(1) = lhs1;
 
         // Solves lhs = rhs * x, and stores the result in-place in lhs.
         const math::f77_int n    = 2;
@@ -62,15 +62,17 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
     // Inside each of the four quadrants, find the min and max disparity.
     // - Masked out pixels are ignored
     // - Accumulate product of disparity search region + pixel area
+    // - The products are kept in double precision, they easily overflow
+    //   32 bits for large tiles with wide search ranges.
     // - TODO: Should get some of this logic into class functions.
-    int32 split_search = 0;
+    double split_search = 0;
     { // Q1
       PixelAccumulator<EWMinMaxAccumulator<Vector2i> > accumulator;
       for_each_pixel( crop(disparity,q1), accumulator );
       if ( accumulator.is_valid() ) {
         q1_search = BBox2i(accumulator.minimum(),
                            accumulator.maximum()+Vector2i(1,1));
-        split_search += q1_search.area() * prod(q1.size()+kernel_size);
+        split_search += double(q1_search.area()) * double(prod(q1.size()+kernel_size));
       }
     }
     { // Q2
@@ -79,7 +81,7 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
       if ( accumulator.is_valid() ) {
         q2_search = BBox2i(accumulator.minimum(),
                            accumulator.maximum()+Vector2i(1,1));
-        split_search += q2_search.area() * prod(q2.size()+kernel_size);
+        split_search += double(q2_search.area()) * double(prod(q2.size()+kernel_size));
       }
     }
     { // Q3
@@ -88,7 +90,7 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
       if ( accumulator.is_valid() ) {
         q3_search = BBox2i(accumulator.minimum(),
                            accumulator.maximum()+Vector2i(1,1));
-        split_search += q3_search.area() * prod(q3.size()+kernel_size);
+        split_search += double(q3_search.area()) * double(prod(q3.size()+kernel_size));
       }
     }
     { // Q4
@@ -97,7 +99,7 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
       if ( accumulator.is_valid() ) {
         q4_search = BBox2i(accumulator.minimum(),
                            accumulator.maximum()+Vector2i(1,1));
-        split_search += q4_search.area() * prod(q4.size()+kernel_size);
+        split_search += double(q4_search.area()) * double(prod(q4.size()+kernel_size));
       }
     }
     // Now we have an estimate of the cost of processing these four
@@ -122,7 +124,7 @@ bool subdivide_regions( ImageView<PixelMask<Vector2i> > const& disparity,
     else
       current_search_region.grow(q4_search);
     
-    int32 current_search = current_search_region.area() * prod(current_bbox.size()+kernel_size);
+    double current_search = double(current_search_region.area()) * double(prod(current_bbox.size()+kernel_size));
 
     const double IMPROVEMENT_RATIO = 0.8;
 
@@ -69,7 +69,6 @@ namespace stereo {
     // Storage buffers
     ImageView<AccumT> cost_metric      ( result_size[0], result_size[1] );
     ImageView<AccumT> cost_applied     ( left_raster.cols(), left_raster.rows() );
-    ImageView<PixelT> right_raster_crop( left_raster.cols(), left_raster.rows() );
 
     // Loop across the disparity range we are searching over.
     Vector2i disparity(0,0);
@@ -81,16 +80,18 @@ namespace stereo {
         //  and using fast_box_sum/cost_function to get the final convolution
         //  value at each location in "cost_metric"
       
-        // There's only one raster here. Fast box sum calls each pixel
-        // individually by pixel accessor. It only calls each pixel
-        // once so there's no reason to copy/rasterize the cost result before hand.
+        // The per pixel costs are computed once per disparity straight
+        // from a crop of the right raster and then summed with running
+        // sums, so the cost does not depend on the kernel size. The
+        // buffers are reused for every disparity, none of these lines
+        // allocate after the first pass.
         //
         // The cost function should also not be applying an edge
         // extension as we've already over cropped the input.
-        
-        right_raster_crop = crop(right_raster, bounding_box(left_raster)+disparity);
-        cost_applied      = cost_function( left_raster, right_raster_crop);
-        cost_metric       = fast_box_sum<AccumChannelT>(cost_applied, kernel_size );
+
+        cost_applied = cost_function( left_raster,
+                                      crop(right_raster, bounding_box(left_raster)+disparity) );
+        fast_box_sum( cost_applied, kernel_size, cost_metric );
         cost_function.cost_modification( cost_metric, disparity );
 
         // Loop across the region we want to compute disparities for.
@@ -25,6 +25,7 @@
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ErodeView.h>
 #include <vw/Image/PerPixelAccessorViews.h>
+#include <vw/Image/Pyramid.h>
 #include <vw/Image/ImageIO.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Stereo/Correlation.h>
@@ -162,6 +163,7 @@ namespace stereo {
       m_sgm_subpixel_mode(sgm_subpixel_mode),
       m_sgm_search_buffer(sgm_search_buffer),
       m_memory_limit_mb(memory_limit_mb),
+      m_sgm_single_pass_consistency(false), m_sgm_num_paths(8),
       m_write_debug_images(write_debug_images){
 
       // Quit if an invalid area was passed in
@@ -194,6 +196,35 @@ namespace stereo {
       return result_type();
     }
 
+    /// With the SGM algorithms, take the right to left disparity used for the
+    ///  consistency check from the costs of the left to right matching instead of
+    ///  running SGM a second time in reverse.  This nearly halves the run time of
+    ///  levels with a consistency check at the price of a somewhat weaker check.
+    void set_sgm_single_pass_consistency(bool single_pass) {
+      m_sgm_single_pass_consistency = single_pass;
+    }
+
+    /// Set the number of accumulation paths used by the SGM algorithm, 8 or 4.
+    /// See SemiGlobalMatcher::set_num_paths().
+    void set_sgm_num_paths(int num_paths) {
+      m_sgm_num_paths = num_paths;
+    }
+
+    /// Share SGM matchers, along with their large buffers, between tiles of
+    ///  the same size.  See SemiGlobalMatcherPool.
+    /// - Without a pool each tile still reuses one matcher for all of its
+    ///   pyramid levels, and frees it when the tile is finished.
+    void set_sgm_matcher_pool(boost::shared_ptr<SemiGlobalMatcherPool> pool) {
+      m_sgm_matcher_pool = pool;
+    }
+
+    /// Accumulate the disparity range, valid count and histograms of each
+    ///  tile as it is rasterized.  See DisparityStatistics.
+    /// - Only the requested area of each tile is counted, not its collar.
+    void set_disparity_statistics(boost::shared_ptr<DisparityStatistics> stats) {
+      m_disparity_stats = stats;
+    }
+
     /// Block rasterization section that does actual work
     typedef CropView<ImageView<result_type> > prerasterize_type;
     inline prerasterize_type prerasterize(BBox2i const& bbox) const;
@@ -207,7 +238,10 @@ namespace stereo {
       if (m_collar_size > 0)
         proc_bbox.expand(m_collar_size);
       vw_out(VerboseDebugMessage, "stereo") << "Collared raster box: " << proc_bbox << std::endl;
-      vw::rasterize(prerasterize(proc_bbox), dest, bbox);
+      prerasterize_type tile = prerasterize(proc_bbox);
+      if (m_disparity_stats)
+        m_disparity_stats->add_tile(crop(tile, bbox));
+      vw::rasterize(tile, dest, bbox);
     }
 
 
@@ -243,42 +277,15 @@ namespace stereo {
     SemiGlobalMatcher::SgmSubpixelMode m_sgm_subpixel_mode; ///< Subpixel mode used by SGM algorithms
     Vector2i m_sgm_search_buffer;
     size_t m_memory_limit_mb;
+    bool m_sgm_single_pass_consistency; ///< See set_sgm_single_pass_consistency()
+    int  m_sgm_num_paths; ///< See set_sgm_num_paths()
+    boost::shared_ptr<SemiGlobalMatcherPool> m_sgm_matcher_pool; ///< See set_sgm_matcher_pool()
+    boost::shared_ptr<DisparityStatistics>   m_disparity_stats;  ///< See set_disparity_statistics()
 
     bool m_write_debug_images; ///< If true, write out a bunch of intermediate images.
 
   private: // Functions
 
-    /// Downsample a mask by two.
-    /// - If at least two mask pixels in a 2x2 region are on, the output pixel is on.
-    struct SubsampleMaskByTwoFunc : public ReturnFixedType<uint8> {
-      BBox2i work_area() const { return BBox2i(0,0,2,2); }
-
-      template <class PixelAccessorT>
-      typename boost::remove_reference<typename PixelAccessorT::pixel_type>::type
-      operator()( PixelAccessorT acc ) const {
-
-        typedef typename PixelAccessorT::pixel_type PixelT;
-
-        uint8 count = 0;
-        if ( *acc ) count++;
-        acc.next_col();
-        if ( *acc ) count++;
-        acc.advance(-1,1);
-        if ( *acc ) count++;
-        acc.next_col();
-        if ( *acc ) count++;
-        if ( count > 1 )
-          return PixelT(ScalarTypeLimits<PixelT>::highest());
-        return PixelT();
-      }
-    }; // End struct SubsampleMaskByTwoFunc
-
-    template <class ViewT>
-    SubsampleView<UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ZeroEdgeExtension>, SubsampleMaskByTwoFunc> >
-    subsample_mask_by_two( ImageViewBase<ViewT> const& input ) const {
-      return subsample(per_pixel_accessor_filter(input.impl(), SubsampleMaskByTwoFunc()),2);
-    }
-
     /// Create the image pyramids needed by the prerasterize function.
     /// - Most of this function is spent figuring out the correct ROIs to use.
     bool build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
@@ -25,13 +25,37 @@ prerasterize(BBox2i const& bbox) const {
     BBox2i right_region = left_region + m_search_region.min();
     right_region.max() += m_search_region.size();
 
+    // Prefilter each image region once, both correlation passes use them.
+    // - The reverse pass reads the left image from left_region shifted back
+    //   by the search size + 1, through the search size past left_region.
+    Vector2i search_size = m_search_region.size() + Vector2i(1,1);
+    BBox2i   left_filter_region = left_region;
+    if ( m_consistency_threshold >= 0 ) {
+      left_filter_region.min() -= search_size;
+      left_filter_region.max() += search_size;
+    }
+    typedef typename PreFilterT::template result<Image1T>::type left_filter_type;
+    typedef typename PreFilterT::template result<Image2T>::type right_filter_type;
+    ImageView<typename left_filter_type ::pixel_type> left_filtered
+      = crop(m_prefilter.filter(m_left_image ), left_filter_region);
+    ImageView<typename right_filter_type::pixel_type> right_filtered
+      = crop(m_prefilter.filter(m_right_image), right_region);
+
+    // The filtered regions in the image coordinates.
+    typedef CropView<ImageView<typename left_filter_type ::pixel_type> > left_crop_type;
+    typedef CropView<ImageView<typename right_filter_type::pixel_type> > right_crop_type;
+    left_crop_type  left_image (left_filtered,  -left_filter_region.min().x(), -left_filter_region.min().y(),
+                                left_filter_region.max().x(), left_filter_region.max().y());
+    right_crop_type right_image(right_filtered, -right_region.min().x(), -right_region.min().y(),
+                                right_region.max().x(), right_region.max().y());
+
     // 3.) Calculate the disparity
     ImageView<pixel_type> result
       = calc_disparity(m_cost_type,
-                       crop(m_prefilter.filter(m_left_image),left_region),
-                       crop(m_prefilter.filter(m_right_image),right_region),
+                       crop(left_image, left_region),
+                       crop(right_image,right_region),
                        left_region - left_region.min(),
-                       m_search_region.size() + Vector2i(1,1),
+                       search_size,
                        m_kernel_size);
 
     // 4.0 ) Consistency check
@@ -40,13 +64,12 @@ prerasterize(BBox2i const& bbox) const {
       // will re-crop later. The important bit is aligning up the origins.
       ImageView<pixel_type> disparity_rl
         = calc_disparity(m_cost_type,
-                         crop(m_prefilter.filter(m_right_image),right_region),
-                         crop(m_prefilter.filter(m_left_image),
-                              left_region - (m_search_region.size()+Vector2i(1,1))),
+                         crop(right_image,right_region),
+                         crop(left_image, left_region - search_size),
                          right_region - right_region.min(),
-                         m_search_region.size() + Vector2i(1,1),
+                         search_size,
                          m_kernel_size) -
-        pixel_type(m_search_region.size()+Vector2i(1,1));
+        pixel_type(search_size);
 
       stereo::cross_corr_consistency_check( result, disparity_rl,
                                             m_consistency_threshold, false );
@@ -89,6 +112,11 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
   right_mask_pyramid.resize(max_pyramid_levels + 1);
   
   
+  // Nothing to correlate where the left image or its mask holds no
+  // data, such as the empty corners of a rotated scene.
+  if ( !sparse_check(m_left_mask, bbox) || !sparse_check(m_left_image, bbox) )
+    return false;
+
   int32 max_upscaling = 1 << max_pyramid_levels;
   vw_out(VerboseDebugMessage, "stereo") << "max_upscaling = " << max_upscaling << std::endl;
   BBox2i left_global_region, right_global_region;
@@ -165,8 +193,8 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
 
   // Smooth and downsample to build the pyramid (don't smooth the masks)
   for ( int32 i = 1; i <= max_pyramid_levels; ++i ) {
-    left_pyramid      [i] = subsample(separable_convolution_filter(left_pyramid [i-1],kernel,kernel),2);
-    right_pyramid     [i] = subsample(separable_convolution_filter(right_pyramid[i-1],kernel,kernel),2);
+    left_pyramid      [i] = subsample_by_two(left_pyramid [i-1], kernel);
+    right_pyramid     [i] = subsample_by_two(right_pyramid[i-1], kernel);
     left_mask_pyramid [i] = subsample_mask_by_two(left_mask_pyramid [i-1]);
     right_mask_pyramid[i] = subsample_mask_by_two(right_mask_pyramid[i-1]);
     
@@ -303,6 +331,12 @@ prerasterize(BBox2i const& bbox) const {
     ImageView<result_type> subpixel_disparity;
     const bool use_sgm = (m_algorithm != VW_CORRELATION_BM); // Anything but block matching
 
+    // One matcher serves every SGM run on this tile so its large buffers are
+    //  only allocated again when a level needs more room.
+    boost::shared_ptr<SemiGlobalMatcher> sgm_matcher_ptr;
+    if (use_sgm && m_sgm_matcher_pool)
+      sgm_matcher_ptr = m_sgm_matcher_pool->acquire(bbox.size());
+
     // Loop down through all of the pyramid levels, low res to high res.
     for ( int32 level = max_pyramid_levels; level >= 0; --level) {
 
@@ -361,7 +395,10 @@ prerasterize(BBox2i const& bbox) const {
         //       The left mask size should exactly equal the output size here.
         // - To be fully accurate, should crop the right mask slightly but SGM does not require this.
         
-        boost::shared_ptr<SemiGlobalMatcher> sgm_matcher_ptr;
+        // Single pass consistency derives the right to left disparity from this same run.
+        const bool check_rl_this_level = (m_consistency_threshold >= 0 && level >= m_min_consistency_level);
+        const bool single_pass_rl      = check_rl_this_level && m_sgm_single_pass_consistency;
+
         crop(disparity, zone.image_region()) // This crop not needed in SGM case!
           = calc_disparity_sgm(m_cost_type,
                            crop(left_pyramid [level], left_region), 
@@ -371,9 +408,9 @@ prerasterize(BBox2i const& bbox) const {
                            m_kernel_size, use_mgm, m_sgm_subpixel_mode, m_sgm_search_buffer, m_memory_limit_mb,
                            sgm_matcher_ptr,
                            &(left_mask_pyramid[level]), &(right_mask_pyramid[level]),
-                           prev_disp_ptr);
-        // Delete the matcher pointer right after we use it to free up its large buffers.
-        // - On the last level we need to generate the subpixel view before we delete it.
+                           prev_disp_ptr, single_pass_rl, m_sgm_num_paths);
+        // Take what we need from the matcher right after we use it, the RL run reuses it.
+        // - On the last level we need to generate the subpixel view before the RL run.
         // - Note that the subpixel image is created BEFORE filtering out bad pixels at the
         //   integer level.  This is ok, we just apply the integer filter results before 
         //   returning the subpixel disparity.  Doing things in this order avoids having
@@ -382,12 +419,14 @@ prerasterize(BBox2i const& bbox) const {
         //   that will get invalidated later.
         if (level == 0)
           subpixel_disparity = sgm_matcher_ptr->create_disparity_view_subpixel(disparity);
-        sgm_matcher_ptr.reset();
+        ImageView<pixel_typeI> single_pass_disparity_rl;
+        if (single_pass_rl)
+          single_pass_disparity_rl = sgm_matcher_ptr->right_disparity_image();
 
 
         // If the user requested a left<->right consistency check at this level,
         //   compute right to left disparity.
-        if ( m_consistency_threshold >= 0 && level >= m_min_consistency_level ) {
+        if ( check_rl_this_level ) {
 
           check_rl = true;
 
@@ -462,24 +501,28 @@ prerasterize(BBox2i const& bbox) const {
           //write_image("rl_cropLmaskPad.tif", crop(edge_extend(left_rl_mask, ZeroEdgeExtension()), temp));
           //write_image("lr_result.tif", crop(disparity, zone.image_region()));
 
-          boost::shared_ptr<SemiGlobalMatcher> sgm_right_matcher_ptr;
-          disparity_rl = calc_disparity_sgm(m_cost_type,
-                           crop(right_pyramid[level], right_reverse_region),
-                           crop(edge_extend(left_pyramid[level]), left_reverse_region),
-                           right_reverse_region - right_reverse_region.min(), // Full RR region
-                           zone.disparity_range().size(), 
-                           m_kernel_size, use_mgm, m_sgm_subpixel_mode, m_sgm_search_buffer, m_memory_limit_mb,
-                           sgm_right_matcher_ptr,
-                           &(right_rl_mask), 
-                           &(left_rl_mask),
-                           prev_disp_ptr_rl);
-          sgm_right_matcher_ptr.reset(); // Immediately delete this to clear memory.
+          pixel_typeI offset(zone.disparity_range().size());
+          if (single_pass_rl) {
+            // Already in negative LR values, on the same grid as the reverse run.
+            disparity_rl = disparity_mask(single_pass_disparity_rl + offset, right_rl_mask, left_rl_mask);
+            disparity_rl -= offset;
+          } else {
+            disparity_rl = calc_disparity_sgm(m_cost_type,
+                             crop(right_pyramid[level], right_reverse_region),
+                             crop(edge_extend(left_pyramid[level]), left_reverse_region),
+                             right_reverse_region - right_reverse_region.min(), // Full RR region
+                             zone.disparity_range().size(), 
+                             m_kernel_size, use_mgm, m_sgm_subpixel_mode, m_sgm_search_buffer, m_memory_limit_mb,
+                             sgm_matcher_ptr,
+                             &(right_rl_mask), 
+                             &(left_rl_mask),
+                             prev_disp_ptr_rl, false, m_sgm_num_paths);
 
-          //write_image("rl_result.tif", disparity_rl);
+            //write_image("rl_result.tif", disparity_rl);
 
-          // Convert from RL to negative LR values
-          pixel_typeI offset(zone.disparity_range().size());
-          disparity_rl -= offset;
+            // Convert from RL to negative LR values
+            disparity_rl -= offset;
+          }
 
           //write_image("rl_result2.tif", disparity_rl);
 
@@ -662,8 +705,9 @@ prerasterize(BBox2i const& bbox) const {
                                    right_pyramid[next_level].rows() - left_pyramid[next_level].rows() );
         BBox2i next_zone_size = bounding_box( left_mask_pyramid[level-1] );
         
-        BBox2i default_disparity_range = BBox2i(0,0,m_search_region.width(),
-                                                    m_search_region.height());
+        // Zones with no valid disparities fall back to the whole search range
+        // of the next level, not the full resolution one.
+        BBox2i default_disparity_range = scale_search_region;
         
         BOOST_FOREACH( SearchParam& zone, zones ) {
         
@@ -715,6 +759,11 @@ prerasterize(BBox2i const& bbox) const {
       
     } // End of the level loop
 
+    // Hand the matcher on to the next tile, or free its buffers now.
+    if (m_sgm_matcher_pool)
+      m_sgm_matcher_pool->release(bbox.size(), sgm_matcher_ptr);
+    sgm_matcher_ptr.reset();
+
     VW_ASSERT( bbox.size() == bounding_box(disparity).size(),
                MathErr() << "PyramidCorrelation: Solved disparity doesn't match requested bbox size." );
 
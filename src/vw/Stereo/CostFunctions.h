@@ -249,16 +249,18 @@ namespace stereo {
   struct NCCCost {
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
+    // Square roots of the inverse window energies. They are taken once
+    // here so that cost_modification() is a plain product per disparity.
     ImageView<pixel_accumulator_type> left_precision, right_precision;
 
     template <class ImageT1, class ImageT2>
     NCCCost( ImageViewBase<ImageT1> const& left,
                                  ImageViewBase<ImageT2> const& right,
                                  Vector2i const& kernel_size ) {
-      left_precision = pixel_accumulator_type(1) /
-        fast_box_sum<accumulator_type>(square(left.impl()), kernel_size);
-      right_precision = pixel_accumulator_type(1) /
-        fast_box_sum<accumulator_type>(square(right.impl()), kernel_size);
+      left_precision = sqrt( pixel_accumulator_type(1) /
+        fast_box_sum<accumulator_type>(square(left.impl()), kernel_size) );
+      right_precision = sqrt( pixel_accumulator_type(1) /
+        fast_box_sum<accumulator_type>(square(right.impl()), kernel_size) );
     }
 
     template <class ImageT1, class ImageT2>
@@ -271,8 +273,8 @@ namespace stereo {
 
     inline void cost_modification( ImageView<pixel_accumulator_type>& cost_metric,
                                    Vector2i const& disparity ) const {
-      cost_metric *= sqrt( left_precision * crop(right_precision,
-                                                 bounding_box(left_precision)+disparity) );
+      cost_metric *= left_precision * crop(right_precision,
+                                           bounding_box(left_precision)+disparity);
     }
 
     inline bool quality_comparison( accumulator_type cost,
@@ -21,6 +21,97 @@
 namespace vw {
 namespace stereo {
 
+  DisparityStatistics::DisparityStatistics(BBox2f const& hist_range, int32 num_bins) :
+    m_hist_range(hist_range), m_num_bins(num_bins) {
+    VW_ASSERT(num_bins > 0,
+              ArgumentErr() << "DisparityStatistics: the number of bins must be positive.");
+    for (int32 i = 0; i < 2; ++i) {
+      float width = hist_range.max()[i] - hist_range.min()[i];
+      m_bin_scale[i] = (width > 0) ? num_bins / width : 0;
+    }
+    reset();
+  }
+
+  void DisparityStatistics::reset() {
+    Mutex::Lock lock(m_mutex);
+    m_min = Vector2f( std::numeric_limits<float>::max(),  std::numeric_limits<float>::max());
+    m_max = Vector2f(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+    m_valid_count = m_total_count = 0;
+    m_hist_x.assign(m_num_bins, 0);
+    m_hist_y.assign(m_num_bins, 0);
+  }
+
+  void DisparityStatistics::merge(Vector2f const& min, Vector2f const& max,
+                                  uint64 valid, uint64 total,
+                                  std::vector<uint64> const& hist_x,
+                                  std::vector<uint64> const& hist_y) {
+    Mutex::Lock lock(m_mutex);
+    for (int32 i = 0; i < 2; ++i) {
+      m_min[i] = std::min(m_min[i], min[i]);
+      m_max[i] = std::max(m_max[i], max[i]);
+    }
+    m_valid_count += valid;
+    m_total_count += total;
+    for (int32 b = 0; b < m_num_bins; ++b) {
+      m_hist_x[b] += hist_x[b];
+      m_hist_y[b] += hist_y[b];
+    }
+  }
+
+  BBox2f DisparityStatistics::disparity_range() const {
+    Mutex::Lock lock(m_mutex);
+    if (m_valid_count == 0)
+      return BBox2f(0,0,0,0);
+    return BBox2f(m_min, m_max);
+  }
+
+  uint64 DisparityStatistics::valid_count() const {
+    Mutex::Lock lock(m_mutex);
+    return m_valid_count;
+  }
+
+  uint64 DisparityStatistics::total_count() const {
+    Mutex::Lock lock(m_mutex);
+    return m_total_count;
+  }
+
+  std::vector<uint64> DisparityStatistics::histogram_x() const {
+    Mutex::Lock lock(m_mutex);
+    return m_hist_x;
+  }
+
+  std::vector<uint64> DisparityStatistics::histogram_y() const {
+    Mutex::Lock lock(m_mutex);
+    return m_hist_y;
+  }
+
+  float DisparityStatistics::quantile(std::vector<uint64> const& hist, int32 axis,
+                                      double quantile) const {
+    if (m_valid_count == 0)
+      return 0;
+    double target = quantile * m_valid_count;
+    uint64 sum = 0;
+    int32  b   = 0;
+    for (; b < m_num_bins-1; ++b) {
+      sum += hist[b];
+      if (sum > 0 && sum >= target)
+        break;
+    }
+    float width = m_hist_range.max()[axis] - m_hist_range.min()[axis];
+    return m_hist_range.min()[axis] + width * float(b+1) / m_num_bins;
+  }
+
+  float DisparityStatistics::quantile_x(double q) const {
+    Mutex::Lock lock(m_mutex);
+    return quantile(m_hist_x, 0, q);
+  }
+
+  float DisparityStatistics::quantile_y(double q) const {
+    Mutex::Lock lock(m_mutex);
+    return quantile(m_hist_y, 1, q);
+  }
+
+
   StdDevImageFunc::StdDevImageFunc(int32 kernel_width, int32 kernel_height) :
     m_kernel_width(kernel_width), m_kernel_height(kernel_height) {
     VW_ASSERT(m_kernel_width > 0 && m_kernel_height > 0,
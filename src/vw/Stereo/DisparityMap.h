@@ -21,6 +21,7 @@
 
 #include <vw/config.h>
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
 #include <vw/Math/BBox.h>
 #include <vw/Math/Vector.h>
 #include <vw/Math/Matrix.h>
@@ -33,8 +34,11 @@
 #include <vw/Image/Transform.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/Statistics.h>
+#include <vw/Image/WindowAlgorithms.h>
 
+#include <limits>
 #include <ostream>
+#include <vector>
 
 // For the PixelDisparity math.
 #include <boost/smart_ptr/shared_ptr.hpp>
@@ -60,6 +64,92 @@ namespace stereo {
                   accumulator.maximum());
   }
 
+  /// Disparity range, valid pixel count and per-axis histograms which are
+  /// gathered one tile at a time, e.g. by PyramidCorrelationView while its
+  /// tiles are produced, so the finished disparity image does not have to
+  /// be read (or for a lazy view, computed) again.
+  /// - Tiles may be added from several threads at once.
+  /// - A tile which is added twice is counted twice, call reset() before
+  ///   reusing the object for another rasterization.
+  class DisparityStatistics {
+  public:
+
+    /// The histograms have num_bins bins spanning hist_range.  Disparities
+    /// outside of hist_range are counted in the first or last bin.
+    DisparityStatistics(BBox2f const& hist_range, int32 num_bins = 256);
+
+    /// Add the pixels of one tile.
+    template <class ViewT>
+    void add_tile(ImageViewBase<ViewT> const& tile);
+
+    /// Forget everything added so far.
+    void reset();
+
+    /// The same as get_disparity_range() of all the pixels added so far.
+    BBox2f disparity_range() const;
+
+    uint64 valid_count() const;
+    uint64 total_count() const;
+
+    BBox2f hist_range() const { return m_hist_range; }
+    int32  num_bins  () const { return m_num_bins;   }
+    std::vector<uint64> histogram_x() const;
+    std::vector<uint64> histogram_y() const;
+
+    /// Quantile of the valid disparities, resolved to the upper edge of a
+    /// histogram bin.  Returns 0 if there are no valid disparities.
+    float quantile_x(double quantile) const;
+    float quantile_y(double quantile) const;
+
+  private:
+    BBox2f m_hist_range;
+    int32  m_num_bins;
+    Vector2f m_bin_scale;
+    mutable Mutex m_mutex;
+    Vector2f m_min, m_max;
+    uint64 m_valid_count, m_total_count;
+    std::vector<uint64> m_hist_x, m_hist_y;
+
+    int32 bin(float value, int32 axis) const {
+      float b = (value - m_hist_range.min()[axis]) * m_bin_scale[axis];
+      if (!(b >= 0))          return 0; // Also catches NaN
+      if (b >= m_num_bins-1)  return m_num_bins-1;
+      return int32(b);
+    }
+
+    float quantile(std::vector<uint64> const& hist, int32 axis, double quantile) const;
+
+    /// Merge the statistics of one tile, under the lock.
+    void merge(Vector2f const& min, Vector2f const& max, uint64 valid, uint64 total,
+               std::vector<uint64> const& hist_x, std::vector<uint64> const& hist_y);
+  };
+
+  template <class ViewT>
+  void DisparityStatistics::add_tile(ImageViewBase<ViewT> const& tile) {
+    // Accumulate locally first so the lock is only held for the merge.
+    ViewT const& view = tile.impl();
+    std::vector<uint64> hist_x(m_num_bins, 0), hist_y(m_num_bins, 0);
+    Vector2f min( std::numeric_limits<float>::max(),  std::numeric_limits<float>::max());
+    Vector2f max(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max());
+    uint64 valid = 0;
+    for (int32 r = 0; r < view.rows(); ++r) {
+      for (int32 c = 0; c < view.cols(); ++c) {
+        typename ViewT::pixel_type pix = view(c,r);
+        if (!is_valid(pix))
+          continue;
+        Vector2f d(pix[0], pix[1]);
+        for (int32 i = 0; i < 2; ++i) {
+          if (d[i] < min[i]) min[i] = d[i];
+          if (d[i] > max[i]) max[i] = d[i];
+        }
+        ++hist_x[bin(d[0], 0)];
+        ++hist_y[bin(d[1], 1)];
+        ++valid;
+      }
+    }
+    merge(min, max, valid, uint64(view.cols())*view.rows(), hist_x, hist_y);
+  }
+
   //  missing_pixel_image()
   //
   /// Produce a colorized image depicting which pixels in the disparity
@@ -379,6 +469,38 @@ namespace stereo {
       }
       return *acc;
     }
+
+    /// Filter a whole tile, same result as the accessor version above.
+    /// src is the tile grown by the half kernel on each side.
+    template <class SrcPixelT>
+    void operator() (ImageView<SrcPixelT> const& src, ImageView<PixelT> & dst) const {
+      const int32 kw = 2*m_half_h_kernel+1, kh = 2*m_half_v_kernel+1;
+      const int32 total = kw*kh;
+      int32 rejected = 0;
+      for (int32 r = 0; r < dst.rows(); ++r) {
+        for (int32 c = 0; c < dst.cols(); ++c) {
+          SrcPixelT const& center = src(c+m_half_h_kernel, r+m_half_v_kernel);
+          dst(c,r) = center;
+          if (!is_valid(center))
+            continue;
+          int32 matched = 0;
+          for (int32 yk = 0; yk < kh; ++yk) {
+            const SrcPixelT* ptr = &src(c, r+yk);
+            for (int32 xk = 0; xk < kw; ++xk)
+              if( is_valid(ptr[xk]) &&
+                  fabs(center[0]-ptr[xk][0]) <= m_pixel_threshold &&
+                  fabs(center[1]-ptr[xk][1]) <= m_pixel_threshold)
+                matched++;
+          }
+          if( ((double)matched/(double)total) < m_rejection_threshold){
+            ++rejected;
+            dst(c,r) = PixelT();  //Return invalid pixel
+          }
+        }
+      }
+      m_state->rejected_points += rejected;
+      m_state->total_points    += dst.cols()*dst.rows();
+    }
   };
 
   // Useful routine for printing how many points have been rejected
@@ -437,11 +559,14 @@ namespace stereo {
   }
 
   // Method 2: Compare the central point to the mean of the neighbors (Ara's method).
+  // - Evaluated one tile at a time by WindowTileView.  The window slides
+  //   along each row, so only the columns entering and leaving it are
+  //   touched for each pixel.
   template <class PixelT>
-  class RmOutliersUsingMeanFunc : public ReturnFixedType<PixelT>{
+  class RmOutliersUsingMeanFunc {
 
     // This small subclass gives us the wiggle room we need to update
-    // the state of this object from within the PerPixelAccessorView.
+    // the state of this object from within the WindowTileView.
     // By maintaining a smart pointer to this small status class, we can
     // change state that is shared between any copies of the
     // RmOutliersFunc object and the original.
@@ -449,11 +574,22 @@ namespace stereo {
       int32 rejected_points, total_points;
     };
 
+    /// A valid window pixel, ordered by disparity magnitude.
+    struct WindowPoint {
+      double len, x, y;
+      bool operator<(WindowPoint const& other) const {
+        if (len != other.len) return len < other.len;
+        if (x   != other.x  ) return x   < other.x;
+        return y < other.y;
+      }
+    };
+
     int32 m_half_h_kernel, m_half_v_kernel;
     double m_max_mean_diffSq;
     boost::shared_ptr<RmOutliersState> m_state;
 
   public:
+    typedef PixelT result_type;
   
     RmOutliersUsingMeanFunc(int32 half_h_kernel, int32 half_v_kernel,
                             double max_mean_diff) :
@@ -472,79 +608,90 @@ namespace stereo {
     int32 rejected_points() const { return m_state->rejected_points; }
     int32 total_points() const { return m_state->total_points; }
 
-    BBox2i work_area() const { return BBox2i(Vector2i(-m_half_h_kernel, -m_half_v_kernel),
-                                             Vector2i(m_half_h_kernel, m_half_v_kernel)); }
-
-    // This function will be called for each pixel in the image to be filtered
-    template <class PixelAccessorT>
-    typename PixelAccessorT::pixel_type operator() (PixelAccessorT const& acc) const{
-      m_state->total_points++; // Accumulate number of points operated on
-    
-      // Quit immediately if the current point is already invalid
-      if (!is_valid(*acc))
-        return *acc;
-
-      // Remove gross outliers: Find the 75th percentile largest disparity
-      // magnitude, and multiply it by 2. Any disparity with magnitude
-      // larger than this will be thrown out. 
-      // E.g., if magnitudes are 1, 2, 3, 4, 5, 6, 7, 8, 1e10,
-      // 2 * 75%th magnitude is 2*7, so 1e10 is thrown out.
-      PixelAccessorT row_acc0 = acc;
-      std::vector<double> len;
-      row_acc0.advance(-m_half_h_kernel,-m_half_v_kernel); // Move to top left kernel
-      for(int32 yk = -m_half_v_kernel; yk <= m_half_v_kernel; ++yk){
-        PixelAccessorT col_acc = row_acc0; // Start column iterator at left of current row
-        for(int32 xk = -m_half_h_kernel; xk <= m_half_h_kernel; ++xk){
-          if(is_valid(*col_acc)){
-            double val = std::abs((*col_acc)[0]) + std::abs((*col_acc)[1]);
-            len.push_back(val);
+    Vector2i window_size() const { return Vector2i(2*m_half_h_kernel+1, 2*m_half_v_kernel+1); }
+
+    /// Filter one tile.  src is the tile grown by the half kernel on each side.
+    template <class SrcPixelT>
+    void operator() (ImageView<SrcPixelT> const& src, ImageView<PixelT> & dst) const {
+
+      // The window keeps its valid pixels sorted by disparity magnitude
+      // so that the 75th percentile is always at hand, along with the
+      // running sums of all of their disparities.
+      SlidingOrderStatistic<WindowPoint> window(0.75);
+      double sumX = 0, sumY = 0;
+      const int32 kw = 2*m_half_h_kernel+1, kh = 2*m_half_v_kernel+1;
+      int32 rejected = 0;
+
+      for (int32 r = 0; r < dst.rows(); ++r) {
+        window.clear();
+        sumX = sumY = 0;
+        for (int32 c = 0; c < dst.cols(); ++c) {
+          // Slide the window one column to the right
+          for (int32 k = (c == 0) ? 0 : kw-1; k < kw; ++k)
+            for (int32 yk = 0; yk < kh; ++yk)
+              if (is_valid(src(c+k, r+yk))) {
+                WindowPoint pt = point(src(c+k, r+yk));
+                window.insert(pt);
+                sumX += pt.x;
+                sumY += pt.y;
+              }
+
+          SrcPixelT const& center = src(c+m_half_h_kernel, r+m_half_v_kernel);
+          if (!is_valid(center)) {
+            // Quit immediately if the current point is already invalid
+            dst(c,r) = center;
+          } else {
+            // Remove gross outliers: Find the 75th percentile largest disparity
+            // magnitude, and multiply it by 2. Any disparity with magnitude
+            // larger than this will be thrown out. 
+            // E.g., if magnitudes are 1, 2, 3, 4, 5, 6, 7, 8, 1e10,
+            // 2 * 75%th magnitude is 2*7, so 1e10 is thrown out.
+            double cutoff = 2.0*window.value().len;
+            double meanX = sumX, meanY = sumY;
+            size_t matched = window.size();
+            typedef typename SlidingOrderStatistic<WindowPoint>::set_type::const_reverse_iterator iter_type;
+            for (iter_type it = window.upper().rbegin(); it != window.upper().rend() && it->len > cutoff; ++it) {
+              meanX -= it->x;
+              meanY -= it->y;
+              --matched;
+            }
+            meanX /= static_cast<double>(matched);
+            meanY /= static_cast<double>(matched);
+
+            // Compute squared difference of this pixel from the mean disparity
+            double thisX   = center[0];
+            double thisY   = center[1];
+            double errorSq = (thisX - meanX)*(thisX - meanX) + (thisY - meanY)*(thisY - meanY);
+            if (errorSq > m_max_mean_diffSq) { // Reject pixels too far from the mean
+              ++rejected;
+              dst(c,r) = PixelT(); // Return invalid pixel
+            } else {
+              dst(c,r) = center;
+            }
           }
-          col_acc.next_col(); // Advance to next column
-        }
-        row_acc0.next_row(); // Advance to next row
-      }
-      std::sort(len.begin(), len.end());
-      double cutoff = 0.0;
-      if (!len.empty()) cutoff = 2.0*len[(int)(0.75*len.size())];
 
-      // Compute the mean
-      size_t matched = 0, total = 0;
-      double meanX=0, meanY=0;
-      PixelAccessorT row_acc = acc; // position at the center
-      row_acc.advance(-m_half_h_kernel,-m_half_v_kernel); // Move to top left kernel
-      for(int32 yk = -m_half_v_kernel; yk <= m_half_v_kernel; ++yk){
-        PixelAccessorT col_acc = row_acc; // Start column iterator at left of current row
-        for(int32 xk = -m_half_h_kernel; xk <= m_half_h_kernel; ++xk){
-          if(is_valid(*col_acc)){
-            double val = std::abs((*col_acc)[0]) + std::abs((*col_acc)[1]);
-            if (val > cutoff) continue; // unreasonably large disparity
-            meanX += (*col_acc)[0];
-            meanY += (*col_acc)[1];
-            matched++; // Total number of valid pixels
-          }
-          col_acc.next_col(); // Advance to next column
-          total++; // Total number of pixels evaluated
+          // Drop the column leaving the window
+          for (int32 yk = 0; yk < kh; ++yk)
+            if (is_valid(src(c, r+yk))) {
+              WindowPoint pt = point(src(c, r+yk));
+              window.erase(pt);
+              sumX -= pt.x;
+              sumY -= pt.y;
+            }
         }
-        row_acc.next_row(); // Advance to next row
-      }
-      // Done accumulating valid pixels, now compute the means
-      double errorSq = m_max_mean_diffSq + 1.0; // Default value ensures error if there are no valid pixels
-      if (matched > 0){
-        meanX = meanX / static_cast<double>(matched);
-        meanY = meanY / static_cast<double>(matched);
-        
-        // Compute squared difference of this pixel from the mean disparity
-        double thisX   = (*acc)[0];
-        double thisY   = (*acc)[1];
-        errorSq = (thisX - meanX)*(thisX - meanX) + (thisY - meanY)*(thisY - meanY);
       }
-      
-      if (errorSq > m_max_mean_diffSq){ // Reject pixels too far from the mean
-        m_state->rejected_points++;
-        return typename PixelAccessorT::pixel_type();  // Return invalid pixel
-      }
-    
-      return *acc; // Return valid pixel
+      m_state->rejected_points += rejected;
+      m_state->total_points    += dst.cols()*dst.rows();
+    }
+
+  private:
+    template <class SrcPixelT>
+    static WindowPoint point(SrcPixelT const& pix) {
+      WindowPoint pt;
+      pt.x   = pix[0];
+      pt.y   = pix[1];
+      pt.len = std::abs(pt.x) + std::abs(pt.y);
+      return pt;
     }
   }; // End class RmOutliersUsingMeanFunc
 
@@ -560,20 +707,19 @@ namespace stereo {
   }
 
   template <class ViewT>
-  UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, RmOutliersUsingMeanFunc<typename ViewT::pixel_type> >
+  WindowTileView<ViewT, RmOutliersUsingMeanFunc<typename ViewT::pixel_type>, ConstantEdgeExtension>
   rm_outliers_using_mean(ImageViewBase<ViewT> const& disparity_map,
                          int32 half_h_kernel, int32 half_v_kernel,
                          double max_mean_diff) {
     typedef RmOutliersUsingMeanFunc<typename ViewT::pixel_type> func_type;
-    typedef UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, func_type>
-      view_type;
-    return view_type(edge_extend(disparity_map.impl(), ConstantEdgeExtension()),
+    typedef WindowTileView<ViewT, func_type, ConstantEdgeExtension> view_type;
+    return view_type(disparity_map.impl(),
                      func_type(half_h_kernel, half_v_kernel,
                                max_mean_diff));
   }
 
   template <class ViewT>
-  inline UnaryPerPixelAccessorView< UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, RmOutliersUsingMeanFunc<typename ViewT::pixel_type> >, RmOutliersUsingThreshFunc<typename ViewT::pixel_type> >
+  inline UnaryPerPixelAccessorView< WindowTileView<ViewT, RmOutliersUsingMeanFunc<typename ViewT::pixel_type>, ConstantEdgeExtension>, RmOutliersUsingThreshFunc<typename ViewT::pixel_type> >
   disparity_cleanup_using_mean(ImageViewBase<ViewT> const& disparity_map,
                                int32 h_half_kernel, int32 v_half_kernel,
                                double max_mean_diff){
@@ -581,8 +727,7 @@ namespace stereo {
     // using a heuristic that isolates single pixel outliers.
     typedef RmOutliersUsingThreshFunc<typename ViewT::pixel_type> func_type_thresh;
     typedef RmOutliersUsingMeanFunc<typename ViewT::pixel_type> func_type_mean;
-    typedef UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>,
-      func_type_mean > inner_type;
+    typedef WindowTileView<ViewT, func_type_mean, ConstantEdgeExtension> inner_type;
     typedef UnaryPerPixelAccessorView<inner_type, func_type_thresh> outer_type;
   
     return outer_type(rm_outliers_using_mean(disparity_map.impl(),
@@ -598,11 +743,13 @@ namespace stereo {
   //  rm_outliers_using_stddev()
   //
   // Replacement for old erosion based filter.
+  // - Evaluated one tile at a time by WindowTileView, using running
+  //   window sums so the cost per pixel does not grow with the kernel.
   template <class PixelT>
-  class RmOutliersUsingStdDev : public ReturnFixedType<PixelT>{
+  class RmOutliersUsingStdDev {
 
     // This small subclass gives us the wiggle room we need to update
-    // the state of this object from within the PerPixelAccessorView.
+    // the state of this object from within the WindowTileView.
     // By maintaining a smart pointer to this small status class, we
     // can change state that is shared between any copies of the
     // RmOutliersFunc object and the original.
@@ -616,6 +763,7 @@ namespace stereo {
     boost::shared_ptr<RmOutliersState> m_state;
 
   public:
+    typedef PixelT result_type;
   
     RmOutliersUsingStdDev(int32 half_h_kernel, int32 half_v_kernel, double pixel_threshold, double rejection_threshold) :
       m_half_h_kernel(half_h_kernel), m_half_v_kernel(half_v_kernel),
@@ -634,87 +782,71 @@ namespace stereo {
     int32 rejected_points() const { return m_state->rejected_points; }
     int32 total_points() const { return m_state->total_points; }
 
-    BBox2i work_area() const { return BBox2i(Vector2i(-m_half_h_kernel, -m_half_v_kernel),
-                                             Vector2i(m_half_h_kernel, m_half_v_kernel)); }
-
-    // This function will be called for each pixel in the image to be filtered
-    template <class PixelAccessorT>
-    typename PixelAccessorT::pixel_type operator() (PixelAccessorT const& acc) const 
-    {
-      m_state->total_points++; // Accumulate number of points operated on
-
-      // Quit immediately if the current point is already invalid
-      if (!is_valid(*acc))
-        return *acc;
-
-      // Allocate storage for recording pixel values
-      const size_t numPixels = (2*m_half_v_kernel + 1) * (2*m_half_v_kernel + 1);
-      std::vector<double> xVals(numPixels), yVals(numPixels);
-
-      size_t matched = 0, total = 0;
-      double meanX=0, meanY=0;
-      PixelAccessorT row_acc = acc;
-      row_acc.advance(-m_half_h_kernel,-m_half_v_kernel); // Move to top left kernel
-      for(int32 yk = -m_half_v_kernel; yk <= m_half_v_kernel; ++yk) 
-        {
-          PixelAccessorT col_acc = row_acc; // Start column iterator at left of current row
-          for(int32 xk = -m_half_h_kernel; xk <= m_half_h_kernel; ++xk) 
-            {
-              if(is_valid(*col_acc))
-                {
-                  // Record the X and Y values
-                  xVals[matched] = (*col_acc)[0];
-                  yVals[matched] = (*col_acc)[1];           
-                  meanX += (*col_acc)[0];
-                  meanY += (*col_acc)[1];
-                  matched++; // Total number of valid pixels
-                }
-              col_acc.next_col(); // Advance to next column
-              total++; // Total number of pixels evaluated
-            }
-          row_acc.next_row(); // Advance to next row
-        }
-      if (matched == 0) // Reject pixel if there are no valid neighbors
-        {
-          m_state->rejected_points++;
-          return typename PixelAccessorT::pixel_type();  // Return invalid pixel
-        }
-      // Done accumulating valid pixels, compute means
-      meanX = meanX / static_cast<double>(matched);
-      meanY = meanY / static_cast<double>(matched);
-      
-      // Now go through the pixels again to compute the standard deviation
-      // - Since we recorded the pixel values in vectors this is easier
-      double sumDiffX=0, sumDiffY=0;
-      for (size_t i=0; i<matched; ++i)
-        {
-          double diffX  = xVals[i] - meanX;
-          double diffY  = yVals[i] - meanY;
-          //double diffSq = diffX*diffX + diffY*diffY;
-          sumDiffX += diffX*diffX;
-          sumDiffY += diffY*diffY;
+    Vector2i window_size() const { return Vector2i(2*m_half_h_kernel+1, 2*m_half_v_kernel+1); }
+
+    /// Filter one tile.  src is the tile grown by the half kernel on each side.
+    template <class SrcPixelT>
+    void operator() (ImageView<SrcPixelT> const& src, ImageView<PixelT> & dst) const {
+
+      // Sum x, y, x^2, y^2 and the valid count over every window.  The
+      // values are taken relative to the first valid disparity to keep
+      // the sums of squares well conditioned.
+      Vector2 ref;
+      bool found = false;
+      for (int32 r = 0; r < src.rows() && !found; ++r)
+        for (int32 c = 0; c < src.cols() && !found; ++c)
+          if (is_valid(src(c,r))) {
+            ref   = Vector2(src(c,r)[0], src(c,r)[1]);
+            found = true;
+          }
+      typedef Vector<double,5> sum_type;
+      ImageView<sum_type> terms(src.cols(), src.rows()), sums;
+      for (int32 r = 0; r < src.rows(); ++r)
+        for (int32 c = 0; c < src.cols(); ++c) {
+          sum_type t;
+          if (is_valid(src(c,r))) {
+            double dx = src(c,r)[0] - ref[0], dy = src(c,r)[1] - ref[1];
+            t = sum_type(dx, dy, dx*dx, dy*dy, 1);
+          }
+          terms(c,r) = t;
         }
-      // Compute standard deviation but enforce minimum value
-      double stdDevX = sqrt(sumDiffX / static_cast<double>(matched));
-      double stdDevY = sqrt(sumDiffY / static_cast<double>(matched));
-      if (stdDevX < m_rejection_threshold)
-        stdDevX = m_rejection_threshold;
-      if (stdDevY < m_rejection_threshold)
-        stdDevY = m_rejection_threshold;
+      box_window_sum(terms, window_size(), sums);
+
+      int32 rejected = 0;
+      for (int32 r = 0; r < dst.rows(); ++r) {
+        for (int32 c = 0; c < dst.cols(); ++c) {
+          SrcPixelT const& center = src(c+m_half_h_kernel, r+m_half_v_kernel);
+          dst(c,r) = center;
+          // Quit immediately if the current point is already invalid
+          if (!is_valid(center))
+            continue;
+
+          // The center is valid so the window has at least one valid pixel
+          sum_type const& s = sums(c,r);
+          double meanX = s[0] / s[4];
+          double meanY = s[1] / s[4];
+
+          // Compute standard deviation but enforce minimum value
+          double stdDevX = sqrt(std::max(s[2] / s[4] - meanX*meanX, 0.0));
+          double stdDevY = sqrt(std::max(s[3] / s[4] - meanY*meanY, 0.0));
+          if (stdDevX < m_rejection_threshold)
+            stdDevX = m_rejection_threshold;
+          if (stdDevY < m_rejection_threshold)
+            stdDevY = m_rejection_threshold;
       
-      // Compute difference of this pixel from the mean disparity
-      double thisX = (*acc)[0];
-      double thisY = (*acc)[1];
-      double errorX = std::abs(thisX - meanX);
-      double errorY = std::abs(thisY - meanY);
+          // Compute difference of this pixel from the mean disparity
+          double errorX = std::abs(center[0] - ref[0] - meanX);
+          double errorY = std::abs(center[1] - ref[1] - meanY);
             
-      if ((errorX > m_pixel_threshold*stdDevX) || 
-          (errorY > m_pixel_threshold*stdDevY)   ){
-        m_state->rejected_points++;
-        return typename PixelAccessorT::pixel_type();  // Return invalid pixel
+          if ((errorX > m_pixel_threshold*stdDevX) || 
+              (errorY > m_pixel_threshold*stdDevY)   ){
+            ++rejected;
+            dst(c,r) = PixelT();  // Return invalid pixel
+          }
+        }
       }
-    
-      return *acc; // Return valid pixel
+      m_state->rejected_points += rejected;
+      m_state->total_points    += dst.cols()*dst.rows();
     }
   }; // End class RmOutliersUsingStdDev
 
@@ -730,20 +862,20 @@ namespace stereo {
   }
 
   template <class ViewT>
-  UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, RmOutliersUsingStdDev<typename ViewT::pixel_type> >
+  WindowTileView<ViewT, RmOutliersUsingStdDev<typename ViewT::pixel_type>, ConstantEdgeExtension>
   rm_outliers_using_stddev(ImageViewBase<ViewT> const& disparity_map,
                            int32 half_h_kernel, int32 half_v_kernel,
                            double pixel_threshold,
                            double rejection_threshold) {
     typedef RmOutliersUsingStdDev<typename ViewT::pixel_type> func_type;
-    typedef UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, func_type > view_type;
-    return view_type(edge_extend(disparity_map.impl(), ConstantEdgeExtension()),
+    typedef WindowTileView<ViewT, func_type, ConstantEdgeExtension> view_type;
+    return view_type(disparity_map.impl(),
                      func_type(half_h_kernel, half_v_kernel,
                                pixel_threshold, rejection_threshold));
   }
 
   template <class ViewT>
-  inline UnaryPerPixelAccessorView< UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>, RmOutliersUsingStdDev<typename ViewT::pixel_type> >, RmOutliersUsingThreshFunc<typename ViewT::pixel_type> >
+  inline UnaryPerPixelAccessorView< WindowTileView<ViewT, RmOutliersUsingStdDev<typename ViewT::pixel_type>, ConstantEdgeExtension>, RmOutliersUsingThreshFunc<typename ViewT::pixel_type> >
   disparity_cleanup_using_stddev(ImageViewBase<ViewT> const& disparity_map,
                                  int32 h_half_kernel, int32 v_half_kernel,
                                  double pixel_threshold, double rejection_threshold){
@@ -751,8 +883,7 @@ namespace stereo {
     // using a heuristic that isolates single pixel outliers.
     typedef RmOutliersUsingThreshFunc<typename ViewT::pixel_type> func_type_thresh;
     typedef RmOutliersUsingStdDev<typename ViewT::pixel_type> func_type_stddev;
-    typedef UnaryPerPixelAccessorView<EdgeExtensionView<ViewT,ConstantEdgeExtension>,
-      func_type_stddev > inner_type;
+    typedef WindowTileView<ViewT, func_type_stddev, ConstantEdgeExtension> inner_type;
     typedef UnaryPerPixelAccessorView<inner_type,
       func_type_thresh > outer_type;
     return outer_type(rm_outliers_using_stddev(disparity_map.impl(),
@@ -761,6 +892,225 @@ namespace stereo {
                       func_type_thresh( 1, 1, 3.0, 0.2 ) ); // Constants set to find only very isolated pixels
   }
 
+  //  fused_disparity_filter()
+  //
+  /// Parameters for one stage of fused_disparity_filter().
+  /// - THRESH and STDDEV use pixel_threshold and rejection_threshold as
+  ///   in rm_outliers_using_thresh() and rm_outliers_using_stddev().
+  /// - MEAN uses pixel_threshold as the max_mean_diff of rm_outliers_using_mean().
+  struct DisparityFilterSpec {
+    enum FilterType { THRESH, MEAN, STDDEV };
+
+    FilterType type;
+    int32  half_h_kernel, half_v_kernel;
+    double pixel_threshold, rejection_threshold;
+
+    DisparityFilterSpec(FilterType type_, int32 half_h_kernel_, int32 half_v_kernel_,
+                        double pixel_threshold_, double rejection_threshold_ = 0) :
+      type(type_), half_h_kernel(half_h_kernel_), half_v_kernel(half_v_kernel_),
+      pixel_threshold(pixel_threshold_), rejection_threshold(rejection_threshold_) {}
+  };
+
+  /// Runs a list of outlier filters one after the other on a tile.
+  /// - Each stage keeps its own functor, so the rejection counts are
+  ///   still reported per stage.
+  template <class PixelT>
+  class FusedDisparityFilterFunc {
+    typedef RmOutliersUsingThreshFunc<PixelT> thresh_type;
+    typedef RmOutliersUsingMeanFunc  <PixelT> mean_type;
+    typedef RmOutliersUsingStdDev    <PixelT> stddev_type;
+
+    struct Stage {
+      DisparityFilterSpec spec;
+      boost::shared_ptr<thresh_type> thresh;
+      boost::shared_ptr<mean_type  > mean;
+      boost::shared_ptr<stddev_type> stddev;
+      Stage(DisparityFilterSpec const& s) : spec(s) {}
+    };
+    std::vector<Stage> m_stages;
+
+  public:
+    typedef PixelT result_type;
+
+    FusedDisparityFilterFunc(std::vector<DisparityFilterSpec> const& specs) {
+      VW_ASSERT(!specs.empty(), ArgumentErr() << "fused_disparity_filter: no filters given.");
+      for (size_t i = 0; i < specs.size(); ++i) {
+        DisparityFilterSpec const& spec = specs[i];
+        Stage stage(spec);
+        switch (spec.type) {
+        case DisparityFilterSpec::THRESH:
+          stage.thresh.reset(new thresh_type(spec.half_h_kernel, spec.half_v_kernel,
+                                             spec.pixel_threshold, spec.rejection_threshold));
+          break;
+        case DisparityFilterSpec::MEAN:
+          stage.mean.reset(new mean_type(spec.half_h_kernel, spec.half_v_kernel,
+                                         spec.pixel_threshold));
+          break;
+        case DisparityFilterSpec::STDDEV:
+          stage.stddev.reset(new stddev_type(spec.half_h_kernel, spec.half_v_kernel,
+                                             spec.pixel_threshold, spec.rejection_threshold));
+          break;
+        default:
+          vw_throw(ArgumentErr() << "fused_disparity_filter: unknown filter type.");
+        }
+        m_stages.push_back(stage);
+      }
+    }
+
+    size_t num_stages() const { return m_stages.size(); }
+    DisparityFilterSpec const& spec(size_t stage) const { return m_stages[stage].spec; }
+
+    int32 rejected_points(size_t stage) const {
+      Stage const& s = m_stages[stage];
+      if (s.thresh) return s.thresh->rejected_points();
+      if (s.mean  ) return s.mean  ->rejected_points();
+      return s.stddev->rejected_points();
+    }
+    int32 total_points(size_t stage) const {
+      Stage const& s = m_stages[stage];
+      if (s.thresh) return s.thresh->total_points();
+      if (s.mean  ) return s.mean  ->total_points();
+      return s.stddev->total_points();
+    }
+
+    /// The combined support of all of the stages.
+    Vector2i window_size() const {
+      Vector2i size(1,1);
+      for (size_t i = 0; i < m_stages.size(); ++i)
+        size += 2*Vector2i(m_stages[i].spec.half_h_kernel, m_stages[i].spec.half_v_kernel);
+      return size;
+    }
+
+    /// Filter one tile.
+    /// - src covers src_bbox, the tile grown by window_size()/2 on each
+    ///   side, and holds the edge extended input.
+    /// - Between stages the part of the intermediate result which lies
+    ///   outside of image_bbox is replaced by constant edge extension.
+    ///   This matches nesting the rm_outliers_using_* views, where each
+    ///   filter edge extends the output of the one before it.
+    template <class SrcPixelT>
+    void operator() (ImageView<SrcPixelT> const& src, BBox2i const& src_bbox,
+                     BBox2i const& image_bbox, ImageView<PixelT> & dst) const {
+      ImageView<PixelT> input = src, output;
+      BBox2i input_bbox = src_bbox;
+      for (size_t i = 0; i < m_stages.size(); ++i) {
+        Stage const& stage = m_stages[i];
+        const int32 hh = stage.spec.half_h_kernel, hv = stage.spec.half_v_kernel;
+        const BBox2i output_bbox(input_bbox.min() + Vector2i(hh,hv),
+                                 input_bbox.max() - Vector2i(hh,hv));
+
+        // The last stage writes straight into the output tile
+        const bool last = (i+1 == m_stages.size());
+        if (last)
+          output = dst;
+        else
+          output = ImageView<PixelT>(output_bbox.width(), output_bbox.height());
+
+        if (stage.thresh) {
+          (*stage.thresh)(input, output);
+        } else if (stage.mean) {
+          (*stage.mean)(input, output);
+        } else {
+          (*stage.stddev)(input, output);
+        }
+
+        if (!last && !image_bbox.contains(output_bbox))
+          edge_extend_in_place(output, output_bbox, image_bbox);
+        input      = output;
+        input_bbox = output_bbox;
+      }
+    }
+
+  private:
+    /// Overwrite the pixels of image (which covers bbox) that are outside
+    /// of image_bbox with the nearest pixel inside of it.
+    static void edge_extend_in_place(ImageView<PixelT> & image, BBox2i const& bbox,
+                                     BBox2i const& image_bbox) {
+      for (int32 r = 0; r < image.rows(); ++r) {
+        const int32 y  = bbox.min().y() + r;
+        const int32 cy = std::min(std::max(y, image_bbox.min().y()), image_bbox.max().y()-1);
+        for (int32 c = 0; c < image.cols(); ++c) {
+          const int32 x  = bbox.min().x() + c;
+          const int32 cx = std::min(std::max(x, image_bbox.min().x()), image_bbox.max().x()-1);
+          if ((cx != x) || (cy != y))
+            image(c,r) = image(cx - bbox.min().x(), cy - bbox.min().y());
+        }
+      }
+    }
+  }; // End class FusedDisparityFilterFunc
+
+  // Useful routine for printing how many points each stage has rejected.
+  template <class PixelT>
+  inline std::ostream&
+  operator<<(std::ostream& os, FusedDisparityFilterFunc<PixelT> const& u) {
+    const char* names[] = { "thresh", "mean", "stddev" };
+    for (size_t i = 0; i < u.num_stages(); ++i) {
+      DisparityFilterSpec const& spec = u.spec(i);
+      os << "\t" << names[spec.type] << " kernel: [ " << spec.half_h_kernel*2 << ", "
+         << spec.half_v_kernel*2 << "]\n";
+      os << "   Rejected " << u.rejected_points(i) << "/" << u.total_points(i) << " vertices ("
+         << double(u.rejected_points(i))/u.total_points(i)*100 << "%).\n";
+    }
+    return os;
+  }
+
+  /// Applies a FusedDisparityFilterFunc one tile at a time.  The input
+  /// tile is read and edge extended once for all of the stages, and the
+  /// intermediate results never leave the tile.
+  template <class ImageT>
+  class FusedDisparityFilterView : public ImageViewBase<FusedDisparityFilterView<ImageT> > {
+    typedef FusedDisparityFilterFunc<typename ImageT::pixel_type> func_type;
+    ImageT    m_image;
+    func_type m_func;
+
+  public:
+    typedef typename ImageT::pixel_type pixel_type;
+    typedef pixel_type                  result_type;
+    typedef ProceduralPixelAccessor<FusedDisparityFilterView<ImageT> > pixel_accessor;
+
+    FusedDisparityFilterView(ImageT const& image, func_type const& func) :
+      m_image(image), m_func(func) {}
+
+    inline int32 cols  () const { return m_image.cols();   }
+    inline int32 rows  () const { return m_image.rows();   }
+    inline int32 planes() const { return m_image.planes(); }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this); }
+
+    /// Evaluates a single pixel as a one pixel tile, which is slow.
+    inline result_type operator()(int32 x, int32 y, int32 p=0) const {
+      return prerasterize(BBox2i(x,y,1,1))(x,y,p);
+    }
+
+    func_type const& func() const { return m_func; }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      Vector2i half_window = m_func.window_size()/2;
+      BBox2i src_bbox(bbox.min() - half_window, bbox.max() + half_window);
+      ImageView<pixel_type> src = edge_extend(m_image, src_bbox, ConstantEdgeExtension());
+      ImageView<pixel_type> dst(bbox.width(), bbox.height());
+      m_func(src, src_bbox, BBox2i(0, 0, cols(), rows()), dst);
+      // Use the crop trick to fake that the tile is the same size as the entire image.
+      return crop(dst, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+  }; // End class FusedDisparityFilterView
+
+  /// Apply several outlier filters in order with a single pass over
+  /// the tiles of the disparity map.  Equivalent to nesting the
+  /// rm_outliers_using_* views in the same order.
+  template <class ViewT>
+  FusedDisparityFilterView<ViewT>
+  fused_disparity_filter(ImageViewBase<ViewT> const& disparity_map,
+                         std::vector<DisparityFilterSpec> const& filters) {
+    typedef FusedDisparityFilterFunc<typename ViewT::pixel_type> func_type;
+    return FusedDisparityFilterView<ViewT>(disparity_map.impl(), func_type(filters));
+  }
+
   // Method 4: Fit a plane to the other pixels and see how well the
   // test pixel fits the plane.
     
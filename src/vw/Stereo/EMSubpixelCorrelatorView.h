@@ -40,6 +40,10 @@
 namespace vw {
   namespace stereo {
 
+    namespace detail {
+      template <class PixelT> struct EMSubpixelWorkspace;
+    }
+
     template <class ImagePixelT>
       class EMSubpixelCorrelatorView : public ImageViewBase<EMSubpixelCorrelatorView<ImagePixelT> > {
     public:
@@ -121,6 +125,8 @@ namespace vw {
       void set_min_determinant(double min) { affine_min_det = min; }
       void set_max_determinant(double max) { affine_max_det = max; }
       void set_debug_region(BBox2i r) { debug_region = r; }
+      // threads refining the rows of a large tile; 0 uses the default number of threads
+      void set_num_threads(int threads) { m_num_threads = threads; }
 
 
       Vector2i kernel_size() const { return m_kernel_size; }
@@ -173,6 +179,10 @@ namespace vw {
 
       int debug_level;
       BBox2i debug_region;
+      int m_num_threads;
+
+      template <class ImageT, class DisparityT1, class DisparityT2, class AffineT>
+        class RefineRowsTask;
 
       // private helper methods
       template <class ImageT, class DisparityT1, class DisparityT2, class AffineT>
@@ -181,6 +191,15 @@ namespace vw {
                           ImageViewBase<DisparityT1> &disparity_in, ImageViewBase<DisparityT2> &disparity_out,
                           ImageViewBase<AffineT> & affine_warps,
                           BBox2i const& ROI, bool final, bool debug = false) const;
+
+      template <class ImageT, class DisparityT1, class DisparityT2, class AffineT>
+        void
+        m_refine_rows(detail::EMSubpixelWorkspace<typename ImageT::pixel_type>& workspace,
+                      ImageT const& left_image, ImageT const& right_image,
+                      DisparityT1& disparity_in, DisparityT2& disparity_out,
+                      AffineT& affine_warps, ImageView<double> const& w_gaussian,
+                      BBox2i const& ROI, int y_first, int y_step,
+                      bool final, bool debug) const;
     }; // end class
 
 
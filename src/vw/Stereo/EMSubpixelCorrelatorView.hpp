@@ -23,8 +23,17 @@
 #include <vw/Stereo/GammaMixtureComponent.h>
 #include <vw/Stereo/DisparityMap.h>
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/FileIO/DiskImageResource.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <exception>
 #include <iostream>
+#include <vector>
 
 namespace vw {
   namespace stereo {
@@ -151,6 +160,7 @@ namespace vw {
       affine_min_det = .1; //.1
       affine_max_det = 1.9; //1.9
       debug_region = BBox2i(-1,-1, 0,0);
+      m_num_threads = 0;
     }
 
 
@@ -337,6 +347,84 @@ namespace vw {
 
 
 
+    namespace detail {
+
+      // The working state of subpixel refinement for one thread: the
+      // mixture components, whose window buffers are reset for each
+      // pixel rather than allocated again.
+      template <class PixelT>
+      struct EMSubpixelWorkspace {
+        AffineMixtureComponent<PixelT, double> affine_comp;
+        GammaMixtureComponent<PixelT, double> outlier_comp1;
+        GammaMixtureComponent<PixelT, double> outlier_comp2;
+
+        Stopwatch pixel_timer;
+        int num_pixels;
+
+#ifdef USE_GRAPHICS
+        ImageWindow r_window_p1_view;
+        ImageWindow l_window_view;
+        ImageWindow w_window_p1_view;
+        ImageWindow w_window_o1_view;
+        ImageWindow w_window_o2_view;
+        ImageWindow errors_window_p1_view;
+#endif
+
+        template <class LeftT, class HackT>
+        EMSubpixelWorkspace(ImageView<PixelT> const& left_filtered, ImageView<PixelT> const& right_filtered,
+                            ImageViewBase<LeftT> const& left_image, ImageViewBase<HackT> const& image_hack,
+                            Vector2i kernel_size, double sigma_0, double sigma_min) :
+          affine_comp(left_filtered, right_filtered, kernel_size, sigma_0, sigma_min),
+          outlier_comp1(left_image.impl(), kernel_size, 1., .25, 1e-2, 1e-2), // k_0 = 1., theta_0 = .25 worked best
+          outlier_comp2(image_hack.impl(), kernel_size, 1., .25, 1e-2, 1e-2),
+          num_pixels(0) {}
+      };
+
+    } // namespace detail
+
+    // Refines every step-th row of the ROI from y_first on, so that
+    // threads given consecutive first rows share out the rows evenly.
+    template <class ImagePixelT>
+    template <class ImageT, class DisparityT1, class DisparityT2, class AffineT>
+    class EMSubpixelCorrelatorView<ImagePixelT>::RefineRowsTask : public Task {
+      EMSubpixelCorrelatorView const& m_view;
+      detail::EMSubpixelWorkspace<typename ImageT::pixel_type>& m_workspace;
+      ImageT const& m_left_image;
+      ImageT const& m_right_image;
+      DisparityT1& m_disparity_in;
+      DisparityT2& m_disparity_out;
+      AffineT& m_affine_warps;
+      ImageView<double> const& m_w_gaussian;
+      BBox2i m_roi;
+      int m_y_first, m_y_step;
+      bool m_final;
+      Mutex& m_mutex;
+      std::exception_ptr& m_error;
+    public:
+      RefineRowsTask(EMSubpixelCorrelatorView const& view,
+                     detail::EMSubpixelWorkspace<typename ImageT::pixel_type>& workspace,
+                     ImageT const& left_image, ImageT const& right_image,
+                     DisparityT1& disparity_in, DisparityT2& disparity_out, AffineT& affine_warps,
+                     ImageView<double> const& w_gaussian, BBox2i const& roi, int y_first, int y_step,
+                     bool final, Mutex& mutex, std::exception_ptr& error)
+        : m_view(view), m_workspace(workspace), m_left_image(left_image), m_right_image(right_image),
+          m_disparity_in(disparity_in), m_disparity_out(disparity_out), m_affine_warps(affine_warps),
+          m_w_gaussian(w_gaussian), m_roi(roi), m_y_first(y_first), m_y_step(y_step), m_final(final),
+          m_mutex(mutex), m_error(error) {}
+
+      virtual void operator()() {
+        try {
+          m_view.m_refine_rows(m_workspace, m_left_image, m_right_image, m_disparity_in, m_disparity_out,
+                               m_affine_warps, m_w_gaussian, m_roi, m_y_first, m_y_step, m_final, false);
+        } catch ( ... ) {
+          Mutex::Lock lock( m_mutex );
+          if ( !m_error )
+            m_error = std::current_exception();
+        }
+      }
+    };
+
+
     // m_sub_pixel_refine
     /* this actually performs the subpixel refinement */
     template <class ImagePixelT>
@@ -348,6 +436,104 @@ namespace vw {
                                                              ImageViewBase<DisparityT2> & disparity_out,
                                                              ImageViewBase<AffineT> & affine_warps,
                                                              BBox2i const& ROI, bool final, bool p_debug) const {
+      typedef typename ImageT::pixel_type pixel_type;
+      typedef detail::EMSubpixelWorkspace<pixel_type> workspace_type;
+      typedef RefineRowsTask<ImageT, DisparityT1, DisparityT2, AffineT> task_type;
+
+      // The inputs of the mixture components are rasterized once here
+      // and shared by every thread's components.
+      ImageView<pixel_type> left_filtered = laplacian_filter(gaussian_filter(left_image.impl(), 1.)); // 1.0 worked best
+      ImageView<pixel_type> right_filtered = laplacian_filter(gaussian_filter(right_image.impl(), 1.));
+      ImageView<float> image_hack = 1. - left_image.impl(); //TODO: remove this hack
+
+      float  two_sigma_sqr = 2.0*pow(float(m_kernel_size(0))/5.0,2.0); //4.0//7.0 works well // using 5.
+      ImageView<double> w_gaussian = compute_spatial_weight_image(m_kernel_size(0), m_kernel_size(1), two_sigma_sqr);
+
+      // A thread refines at least this many rows, so that small tiles
+      // do not pay for many sets of components.
+      const int min_rows_per_thread = 8;
+      int num_threads = m_num_threads > 0 ? m_num_threads : vw_settings().default_num_threads();
+      if (p_debug)
+        num_threads = 1;
+      num_threads = std::max(1, std::min(num_threads, ROI.height()/min_rows_per_thread));
+
+      std::vector<boost::shared_ptr<workspace_type> > workspaces(num_threads);
+      for (int t = 0; t < num_threads; t++) {
+        workspaces[t].reset(new workspace_type(left_filtered, right_filtered, left_image, image_hack,
+                                               m_kernel_size, sigma_p1_0, sigma_p1_min));
+        AffineMixtureComponent<pixel_type, double>& affine_comp = workspaces[t]->affine_comp;
+        affine_comp.set_max_iter(inner_iter_max);
+        affine_comp.set_epsilon_convergence(epsilon_inner);
+        affine_comp.set_min_determinant(affine_min_det);
+        affine_comp.set_max_determinant(affine_max_det);
+        //affine_comp.set_debug(true);
+      }
+
+      if (num_threads == 1) {
+        workspace_type& workspace = *workspaces[0];
+        // set up windows for debug views
+#ifdef USE_GRAPHICS
+        workspace.r_window_p1_view = NULL;
+        workspace.l_window_view = NULL;
+        workspace.w_window_p1_view = NULL;
+        workspace.w_window_o1_view = NULL;
+        workspace.w_window_o2_view = NULL;
+        workspace.errors_window_p1_view = NULL;
+        if(p_debug) {
+          workspace.r_window_p1_view = vw_create_window("r_window_p1");
+          workspace.l_window_view = vw_create_window("l_window");
+          workspace.w_window_p1_view = vw_create_window("weights_p1");
+          workspace.w_window_o1_view = vw_create_window("weights_outlier1");
+          workspace.errors_window_p1_view = vw_create_window("errors_p1");
+          vw_show_image(workspace.l_window_view, debug_view_mag*left_image.impl());
+          vw_show_image(workspace.r_window_p1_view, debug_view_mag*right_image.impl());
+          usleep(1*1000*1000);
+        }
+#endif
+
+        m_refine_rows(workspace, left_image.impl(), right_image.impl(), disparity_in.impl(), disparity_out.impl(),
+                      affine_warps.impl(), w_gaussian, ROI, ROI.min().y(), 1, final, p_debug);
+
+#ifdef USE_GRAPHICS
+        if(p_debug) {
+          vw_destroy_window(workspace.r_window_p1_view);
+          vw_destroy_window(workspace.l_window_view);
+          vw_destroy_window(workspace.w_window_p1_view);
+          vw_destroy_window(workspace.w_window_o1_view);
+          vw_destroy_window(workspace.errors_window_p1_view);
+        }
+#endif
+        return;
+      }
+
+      // Each pixel is refined on its own, reading and writing only its
+      // own disparity and warp, so the rows are shared out between the
+      // threads, each with its own components.
+      Mutex mutex;
+      std::exception_ptr error;
+      FifoWorkQueue queue(num_threads);
+      for (int t = 0; t < num_threads; t++)
+        queue.add_task(boost::shared_ptr<Task>(
+          new task_type(*this, *workspaces[t], left_image.impl(), right_image.impl(),
+                        disparity_in.impl(), disparity_out.impl(), affine_warps.impl(),
+                        w_gaussian, ROI, ROI.min().y() + t, num_threads, final, mutex, error)));
+      queue.join_all();
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+
+    // m_refine_rows
+    /* runs EM at each pixel of every y_step-th row of the ROI from y_first on */
+    template <class ImagePixelT>
+    template <class ImageT, class DisparityT1, class DisparityT2, class AffineT>
+    void
+    EMSubpixelCorrelatorView<ImagePixelT>::m_refine_rows(detail::EMSubpixelWorkspace<typename ImageT::pixel_type>& workspace,
+                                                         ImageT const& left_image, ImageT const& right_image,
+                                                         DisparityT1& disparity_in, DisparityT2& disparity_out,
+                                                         AffineT& affine_warps, ImageView<double> const& w_gaussian,
+                                                         BBox2i const& ROI, int y_first, int y_step,
+                                                         bool final, bool p_debug) const {
 
       // algorithm features to enable
       bool blur_posterior = false;
@@ -358,57 +544,14 @@ namespace vw {
 
       bool save_states = false;
 
+      AffineMixtureComponent<typename ImageT::pixel_type, double>& affine_comp = workspace.affine_comp;
+      GammaMixtureComponent<typename ImageT::pixel_type, double>& outlier_comp1 = workspace.outlier_comp1;
+      GammaMixtureComponent<typename ImageT::pixel_type, double>& outlier_comp2 = workspace.outlier_comp2;
 
-      // set up windows for debug views
-#ifdef USE_GRAPHICS
-      ImageWindow r_window_p1_view = NULL;
-      ImageWindow l_window_view = NULL;
-      ImageWindow w_window_p1_view = NULL;
-      ImageWindow w_window_o1_view = NULL;
-      ImageWindow w_window_o2_view = NULL;
-      ImageWindow errors_window_p1_view = NULL;
-      if(p_debug) {
-        r_window_p1_view = vw_create_window("r_window_p1");
-        l_window_view = vw_create_window("l_window");
-        w_window_p1_view = vw_create_window("weights_p1");
-        if(use_left_outliers) {
-          w_window_o1_view = vw_create_window("weights_outlier1");
-        }
-        if(use_right_outliers) {
-          w_window_o2_view = vw_create_window("weights_outlier2");
-        }
-        errors_window_p1_view = vw_create_window("errors_p1");
-      }
-#endif
-
-#ifdef USE_GRAPHICS
-      if(p_debug) {
-        vw_show_image(l_window_view, debug_view_mag*left_image.impl());
-        vw_show_image(r_window_p1_view, debug_view_mag*right_image.impl());
-        usleep(1*1000*1000);
-      }
-#endif
-
-      // allocate memory once for all inner loop operations
-      ImageView<double> weights_p1(m_kernel_size(0), m_kernel_size(1));
-      ImageView<double> weights_outlier1(m_kernel_size(0), m_kernel_size(1));
-      ImageView<double> weights_outlier2(m_kernel_size(0), m_kernel_size(1));
-      ImageView<double> temp_sum(m_kernel_size(0), m_kernel_size(1));
-
-      AffineMixtureComponent<typename ImageT::pixel_type, double> affine_comp(laplacian_filter(gaussian_filter(left_image.impl(), 1.)), // 1.0 worked best
-                                                                              laplacian_filter(gaussian_filter(right_image.impl(), 1.)),
-                                                                              m_kernel_size, sigma_p1_0, sigma_p1_min);
-      affine_comp.set_max_iter(inner_iter_max);
-      affine_comp.set_epsilon_convergence(epsilon_inner);
-      affine_comp.set_min_determinant(affine_min_det);
-      affine_comp.set_max_determinant(affine_max_det);
-      //affine_comp.set_debug(true);
-
-      //GaussianMixtureComponent<typename ImageT::pixel_type, double> outlier_comp1(left_image.impl(), m_kernel_size, mu_n_0, sigma_n_0, sigma_n_min);
-      //GaussianMixtureComponent<typename ImageT::pixel_type, double> outlier_comp2(left_image.impl(), m_kernel_size, mu_n_0, sigma_n_0, sigma_n_min);
-      GammaMixtureComponent<typename ImageT::pixel_type, double> outlier_comp1(left_image.impl(), m_kernel_size, 1., .25, 1e-2, 1e-2); // k_0 = 1., theta_0 = .25 worked best
-      ImageView<float> image_hack = 1. - left_image.impl(); //TODO: remove this hack
-      GammaMixtureComponent<typename ImageT::pixel_type, double> outlier_comp2(image_hack.impl(), m_kernel_size, 1., .25, 1e-2, 1e-2);
+      // The E-step writes the weights straight into the components.
+      ImageView<double>& weights_p1 = affine_comp.weights();
+      ImageView<double>& weights_outlier1 = outlier_comp1.weights();
+      ImageView<double>& weights_outlier2 = outlier_comp2.weights();
 
       int kernel_width = m_kernel_size(0);
       int kernel_height = m_kernel_size(1);
@@ -419,19 +562,15 @@ namespace vw {
       Vector2 pos;
       Vector2 cor_pos;
 
-      float  two_sigma_sqr = 2.0*pow(float(m_kernel_size(0))/5.0,2.0); //4.0//7.0 works well // using 5.
-      ImageView<float> weight_template = compute_spatial_weight_image(m_kernel_size(0), m_kernel_size(1), two_sigma_sqr);
-      ImageView<float> w_gaussian(m_kernel_size(0), m_kernel_size(1));
-
       int N = m_kernel_size(0)*m_kernel_size(1); // number of pixels in each window
 
       // loop through all pixels
       int x, y;
-      int num_pixels = 0;
-      Stopwatch pixel_timer;
+      Stopwatch& pixel_timer = workspace.pixel_timer;
+      int& num_pixels = workspace.num_pixels;
       bool debug = false;
 
-      for(y = ROI.min()[1]; y < ROI.max()[1]; y++) {
+      for(y = y_first; y < ROI.max()[1]; y += y_step) {
         if(y%10 == 0 && y != 0) {
           vw_out() << "@ row " << y << ": average pixel took "
                     << 1000*pixel_timer.elapsed_seconds()/(double)num_pixels
@@ -449,8 +588,8 @@ namespace vw {
             }
           }
 
-          if(!disparity_in.impl()(x, y).valid()) { // skip missing pixels in the course map
-            disparity_out.impl()(x, y).invalidate();
+          if(!disparity_in(x, y).valid()) { // skip missing pixels in the course map
+            disparity_out(x, y).invalidate();
             continue;
           }
 
@@ -461,21 +600,20 @@ namespace vw {
             continue;
           }
 
-          //adjust_weight_image(w_gaussian,  crop(edge_extend(disparity_in.impl()), window_box), weight_template);
-          w_gaussian = weight_template;
+          //adjust_weight_image(w_gaussian,  crop(edge_extend(disparity_in), window_box), weight_template);
 
           pixel_timer.start();
-          l_window = crop(edge_extend(left_image.impl(), ZeroEdgeExtension()), window_box);
-
           if(debug) {
+            l_window = crop(edge_extend(left_image, ZeroEdgeExtension()), window_box);
+
             vw_out() << "course estimate = " << pos << " + "
-                      << disparity_in.impl()(x, y) << std::endl;
+                      << disparity_in(x, y) << std::endl;
             vw_out() << "initial warp: "
-                      << affine_warps.impl()(x, y) << std::endl;
+                      << affine_warps(x, y) << std::endl;
           }
 
-          affine_comp.reset(window_box, edge_extend(disparity_in.impl())(x, y).child().x(), edge_extend(disparity_in.impl())(x, y).child().y(),
-                            affine_warps.impl()(x, y),
+          affine_comp.reset(window_box, edge_extend(disparity_in)(x, y).child().x(), edge_extend(disparity_in)(x, y).child().y(),
+                            affine_warps(x, y),
                             w_gaussian);
           outlier_comp1.reset(window_box, w_gaussian);
           outlier_comp2.reset(window_box, w_gaussian);
@@ -542,13 +680,13 @@ namespace vw {
 
             vw_out() << "RMS error = " << sqrt(sum_of_pixel_values(pow(affine_comp.errors(),2))/affine_comp.errors().cols()/affine_comp.errors().rows()) << std::endl;
 #ifdef USE_GRAPHICS
-            r_window_p1 = crop(transform(right_image.impl(), affine_comp.affine_transform()), window_box);
-            vw_show_image(r_window_p1_view, debug_view_mag*resize(r_window_p1, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation())); //, NearestPixelInterpolation()));
-            vw_show_image(l_window_view, debug_view_mag*resize(l_window, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
-            vw_show_image(w_window_p1_view, resize(affine_comp.weights(), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
-            vw_show_image(w_window_o1_view, resize(weights_outlier1, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
-            vw_show_image(w_window_o2_view, resize(weights_outlier2, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
-            vw_show_image(errors_window_p1_view, debug_view_mag*resize(normalize(affine_comp.errors()), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+            r_window_p1 = crop(transform(right_image, affine_comp.affine_transform()), window_box);
+            vw_show_image(workspace.r_window_p1_view, debug_view_mag*resize(r_window_p1, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation())); //, NearestPixelInterpolation()));
+            vw_show_image(workspace.l_window_view, debug_view_mag*resize(l_window, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+            vw_show_image(workspace.w_window_p1_view, resize(affine_comp.weights(), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+            vw_show_image(workspace.w_window_o1_view, resize(weights_outlier1, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+            vw_show_image(workspace.w_window_o2_view, resize(weights_outlier2, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+            vw_show_image(workspace.errors_window_p1_view, debug_view_mag*resize(normalize(affine_comp.errors()), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
             vw_out() << "max_error = " << max_pixel_value(affine_comp.errors()) << std::endl;
             usleep((int)(1*1000*1000));
 #endif
@@ -562,46 +700,52 @@ namespace vw {
           for(em_iter = 0; em_iter < em_iter_max; em_iter++) {
             Stopwatch inner_loop_init_timer;
             inner_loop_init_timer.start();
-            // compute the weights with the posterior distribution (Q)
-            weights_p1 = copy(affine_comp.prob()*P_1);
+            // compute the weights with the posterior distribution (Q),
+            // normalize them and sum them in one pass over the window
             if(blur_posterior) {
               if(use_left_outliers) {
-                weights_outlier1 = copy(outlier_comp1.prob()*P_outlier1);
-                weights_outlier1 = gaussian_filter(weights_outlier1, blur_posterior_sigma);
+                weights_outlier1 = gaussian_filter(outlier_comp1.prob()*P_outlier1, blur_posterior_sigma);
               }
               if(use_right_outliers) {
-                weights_outlier2 = copy(outlier_comp2.prob()*P_outlier2);
-                weights_outlier2 = gaussian_filter(weights_outlier2, blur_posterior_sigma);
+                weights_outlier2 = gaussian_filter(outlier_comp2.prob()*P_outlier2, blur_posterior_sigma);
               }
             }
-            else {
+
+            double const* prob_p1 = affine_comp.prob().data();
+            double const* prob_outlier1 = outlier_comp1.prob().data();
+            double const* prob_outlier2 = outlier_comp2.prob().data();
+            double* w_p1 = weights_p1.data();
+            double* w_outlier1 = weights_outlier1.data();
+            double* w_outlier2 = weights_outlier2.data();
+            sum_weights_p1 = 0;
+            sum_weights_outlier1 = 0;
+            sum_weights_outlier2 = 0;
+            for(int i = 0; i < N; i++) {
+              double q_p1 = prob_p1[i]*P_1;
+              double q_outlier1 = 0, q_outlier2 = 0;
+              double q_sum = q_p1;
               if(use_left_outliers) {
-                weights_outlier1 = copy(outlier_comp1.prob()*P_outlier1);
+                q_outlier1 = blur_posterior ? w_outlier1[i] : prob_outlier1[i]*P_outlier1;
+                q_sum += q_outlier1;
               }
               if(use_right_outliers) {
-                weights_outlier2 = copy(outlier_comp2.prob()*P_outlier2);
+                q_outlier2 = blur_posterior ? w_outlier2[i] : prob_outlier2[i]*P_outlier2;
+                q_sum += q_outlier2;
               }
-            }
 
-            // normalize the weights
-            temp_sum = copy(weights_p1);
-            if(use_left_outliers)
-              temp_sum += weights_outlier1;
-            if(use_right_outliers)
-              temp_sum += weights_outlier2;
-            weights_p1 = weights_p1/temp_sum;
-            if(use_left_outliers)
-              weights_outlier1 = weights_outlier1/temp_sum;
-            if(use_right_outliers)
-              weights_outlier2 = weights_outlier2/temp_sum;
+              w_p1[i] = q_p1/q_sum;
+              sum_weights_p1 += w_p1[i];
+              if(use_left_outliers) {
+                w_outlier1[i] = q_outlier1/q_sum;
+                sum_weights_outlier1 += w_outlier1[i];
+              }
+              if(use_right_outliers) {
+                w_outlier2[i] = q_outlier2/q_sum;
+                sum_weights_outlier2 += w_outlier2[i];
+              }
+            }
 
             // compute P(inlier) and P(outlier)
-            sum_weights_p1 = sum_of_pixel_values(weights_p1);
-            if(use_left_outliers)
-              sum_weights_outlier1 = sum_of_pixel_values(weights_outlier1);
-            if(use_right_outliers)
-              sum_weights_outlier2 = sum_of_pixel_values(weights_outlier2);
-
             P_1 = sum_weights_p1/(double)(N);
             P_1 = std::min(P_1, P_inlier_max);
             P_1 = std::max(P_1, P_inlier_min);
@@ -617,17 +761,14 @@ namespace vw {
               P_outlier2 = std::max(P_outlier2, P_inlier_min);
             }
 
-            // fit all the parameters (M-step)
-            affine_comp.weights() = copy(weights_p1);
+            // fit all the parameters (M-step) to the weights set above
             if(sum_weights_p1 >= 1e-2) {
               affine_comp.fit_parameters();
             }
             if(use_left_outliers) {
-              outlier_comp1.weights() = copy(weights_outlier1);
               outlier_comp1.fit_parameters();
             }
             if(use_right_outliers) {
-              outlier_comp2.weights() = copy(weights_outlier2);
               outlier_comp2.fit_parameters();
             }
 
@@ -681,20 +822,20 @@ namespace vw {
               vw_out() << "iter = " << em_iter+1 << std::endl;
               vw_out() << "RMS error = " << sqrt(sum_of_pixel_values(pow(affine_comp.errors(),2))/affine_comp.errors().cols()/affine_comp.errors().rows()) << std::endl;
 #ifdef USE_GRAPHICS
-              r_window_p1 = crop(transform(right_image.impl(), affine_comp.affine_transform()), window_box);
+              r_window_p1 = crop(transform(right_image, affine_comp.affine_transform()), window_box);
 
               double norm = 1.; //std::max<double>(max_pixel_value(outlier_comp1.prob()), max_pixel_value(affine_comp.prob()));
               vw_out() << "normalization constant = " << norm << std::endl;
-              vw_show_image(r_window_p1_view, debug_view_mag*resize(r_window_p1, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation())); //, NearestPixelInterpolation()));
-              vw_show_image(l_window_view, debug_view_mag*resize(l_window, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
-              vw_show_image(w_window_p1_view, resize((affine_comp.weights()/norm), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+              vw_show_image(workspace.r_window_p1_view, debug_view_mag*resize(r_window_p1, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation())); //, NearestPixelInterpolation()));
+              vw_show_image(workspace.l_window_view, debug_view_mag*resize(l_window, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+              vw_show_image(workspace.w_window_p1_view, resize((affine_comp.weights()/norm), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
               if(use_left_outliers) {
-                vw_show_image(w_window_o1_view, resize((outlier_comp1.weights()/norm), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+                vw_show_image(workspace.w_window_o1_view, resize((outlier_comp1.weights()/norm), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
               }
               if(use_right_outliers) {
-                vw_show_image(w_window_o2_view, resize(weights_outlier2, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+                vw_show_image(workspace.w_window_o2_view, resize(weights_outlier2, 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
               }
-              vw_show_image(errors_window_p1_view, debug_view_mag*resize(20*affine_comp.errors(), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
+              vw_show_image(workspace.errors_window_p1_view, debug_view_mag*resize(20*affine_comp.errors(), 200, 200, ZeroEdgeExtension(), NearestPixelInterpolation()));
               usleep((int)(.5*1000*1000));
 #endif
               vw_out() << std::endl;
@@ -713,37 +854,37 @@ namespace vw {
           cor_pos = affine_comp.affine_transform().reverse(pos);
           Vector2f delta = (cor_pos - pos);
 
-          disparity_out.impl()(x, y).validate();
-          disparity_out.impl()(x, y).child().x() = delta.x();
-          disparity_out.impl()(x, y).child().y() = delta.y();
-          if(disparity_out.impl()(x, y).child().size() == 5) { // if the disparity map given has space for uncertainty, output that as well
-            disparity_out.impl()(x, y).child()(2) = affine_comp.hessian()(4, 4);
-            disparity_out.impl()(x, y).child()(3) = affine_comp.hessian()(4, 5);
-            disparity_out.impl()(x, y).child()(4) = affine_comp.hessian()(5, 5);
+          disparity_out(x, y).validate();
+          disparity_out(x, y).child().x() = delta.x();
+          disparity_out(x, y).child().y() = delta.y();
+          if(disparity_out(x, y).child().size() == 5) { // if the disparity map given has space for uncertainty, output that as well
+            disparity_out(x, y).child()(2) = affine_comp.hessian()(4, 4);
+            disparity_out(x, y).child()(3) = affine_comp.hessian()(4, 5);
+            disparity_out(x, y).child()(4) = affine_comp.hessian()(5, 5);
           }
-          affine_warps.impl()(x, y) = affine_comp.affine_transform_mat();
+          affine_warps(x, y) = affine_comp.affine_transform_mat();
 
 
           if(debug) {
             vw_out() << "refined estimate = "
-                      << disparity_out.impl()(x, y) << std::endl;
+                      << disparity_out(x, y) << std::endl;
             vw_out() << "refined warp: "
-                      << affine_warps.impl()(x, y) << std::endl;
+                      << affine_warps(x, y) << std::endl;
           }
 
           if(final) {
             double P_center = weights_p1(x - window_box.min().x(),  y - window_box.min().y());
             if(P_1 <= .25) { // if most pixels are outliers, set this one as missing
-              disparity_out.impl()(x, y).invalidate();
+              disparity_out(x, y).invalidate();
             }
             else if(P_1 <= .5){ // if at least half are inliers, decide based on the actual center pixel weight
               if(P_center <= .95) {
-                disparity_out.impl()(x, y).invalidate();
+                disparity_out(x, y).invalidate();
               }
             }
             else if(P_1 <= .95) {
               if(P_center <= .75) {
-                disparity_out.impl()(x, y).invalidate();
+                disparity_out(x, y).invalidate();
               }
             }
           }
@@ -751,21 +892,6 @@ namespace vw {
           num_pixels++;
         } // end x loop
       } // end y loop
-
-#ifdef USE_GRAPHICS
-      if(p_debug) {
-        vw_destroy_window(r_window_p1_view);
-        vw_destroy_window(l_window_view);
-        vw_destroy_window(w_window_p1_view);
-        if(use_left_outliers) {
-          vw_destroy_window(w_window_o1_view);
-        }
-        if(use_right_outliers) {
-          vw_destroy_window(w_window_o2_view);
-        }
-        vw_destroy_window(errors_window_p1_view);
-      }
-#endif
     }
 
 
@@ -22,6 +22,7 @@
 #include <vw/Stereo/MixtureComponent.h>
 #include <vw/Stereo/AffineMixtureComponent.h>
 
+#include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageViewRef.h>
 #include <limits>
 
@@ -51,9 +52,10 @@ namespace stereo {
                           Vector2i window_size,
                           PrecisionT k_0, PrecisionT theta_0,
                           PrecisionT pk_min, PrecisionT ptheta_min) : image_r(image.impl()), image_c(window_size(0), window_size(1)),
+      window(0, 0, window_size(0), window_size(1)),
       _k(k_0), k0(k_0),
       _theta(theta_0), theta0(theta_0), k_min(pk_min), theta_min(ptheta_min),
-      w(window_size(0), window_size(1)), w_gaussian(window_size(0), window_size(1)), w_local(image.impl().cols(), image.impl().rows()),
+      w(window_size(0), window_size(1)), w_gaussian(window_size(0), window_size(1)),
       p(window_size(0), window_size(1)) {
 
       fill(w, 1.);
@@ -222,7 +224,6 @@ namespace stereo {
       ImageView<PrecisionT> w;  // weights
       ImageView<PrecisionT> w_gaussian;  // gaussian window
       ImageView<PrecisionT> err;  // errors
-      ImageView<PrecisionT> w_local; // weights in local coordinate frame
       ImageView<PrecisionT> p; // posterior probabilities of data in window
 
       AffineTransformOrigin T;
@@ -44,60 +44,83 @@ https://www.mathworks.com/matlabcentral/fileexchange/18401-efficient-subpixel-im
 namespace vw {
 namespace stereo {
 
-/// Use matrix multiplication to upsample a DFT in only a small region.
-///  It is usually faster than doing the equivalent series of steps:
-///   1) pad_fourier_transform(input, input.rows()*upscale, input.cols()*upscale)
-///      dimension. fftshift(inverse) to bring the center of the image to (0,0).
-///   2) dft(upsampled_image)
-///   3) crop(dft_result, col_offset, row_offset, upsampled_width, upsampled_height)
+/// The column kernel of partial_upsample_dft(), size cols x upsampled_width.
 inline
-cv::Mat partial_upsample_dft(cv::Mat const& input, int upsampled_height, int upsampled_width, 
-                             int upscale, int row_offset=0, int col_offset=0) {
+cv::Mat partial_upsample_col_kernel(int cols, int upsampled_width, int upscale, int col_offset) {
 
-  // Generate some linear row vectors
   const int COMPLEX_TYPE_CV = CV_32FC2;
   typedef std::complex<float> c_type;
 
-  cv::Mat col_vector   (1, input.cols,       COMPLEX_TYPE_CV);
-  cv::Mat row_vector   (1, input.rows,       COMPLEX_TYPE_CV);
-  cv::Mat col_up_vector(1, upsampled_width,  COMPLEX_TYPE_CV);
-  cv::Mat row_up_vector(1, upsampled_height, COMPLEX_TYPE_CV);
-
-  for (int i=0; i<input.cols; ++i)
+  // Generate some linear row vectors
+  cv::Mat col_vector   (1, cols,            COMPLEX_TYPE_CV);
+  cv::Mat col_up_vector(1, upsampled_width, COMPLEX_TYPE_CV);
+  for (int i=0; i<cols; ++i)
     col_vector.at<c_type>(0,i) = static_cast<c_type>(i);
-  for (int i=0; i<input.rows; ++i)
-    row_vector.at<c_type>(0,i) = static_cast<c_type>(i);
   for (int i=0; i<upsampled_width; ++i)
     col_up_vector.at<c_type>(0,i) = static_cast<c_type>(i);
-  for (int i=0; i<upsampled_height; ++i)
-    row_up_vector.at<c_type>(0,i) = static_cast<c_type>(i);
 
   const c_type neg_i(0, -1);
   float two_pi = 2.0*M_PI;
 
-  cv::Mat col_kernel, row_kernel;
+  cv::Mat col_kernel;
   cv::Mat temp_vec = fftshift(col_vector, true).t();
-  cv::Mat v1 = temp_vec - floor(input.cols/2);
+  cv::Mat v1 = temp_vec - floor(cols/2);
   cv::Mat v2 = col_up_vector - col_offset;
   
   cv::Mat dummy;
   cv::gemm(v1,v2,1.0, dummy, 0.0, col_kernel); //m  = v1*v2;
   
-  c_type constant = neg_i*two_pi/static_cast<float>(input.cols*upscale);
+  c_type constant = neg_i*two_pi/static_cast<float>(cols*upscale);
   for (int i=0; i<col_kernel.rows; ++i)
     for (int j=0; j<col_kernel.cols; ++j)
       col_kernel.at<c_type>(i,j) = std::exp(col_kernel.at<c_type>(i,j)*constant);
+  return col_kernel;
+}
+
+/// The row kernel of partial_upsample_dft(), size upsampled_height x rows.
+inline
+cv::Mat partial_upsample_row_kernel(int rows, int upsampled_height, int upscale, int row_offset) {
 
-  temp_vec = fftshift(row_vector, true);
-  v1 = row_up_vector.t() - row_offset;
-  v2 = temp_vec - floor(input.rows/2);
+  const int COMPLEX_TYPE_CV = CV_32FC2;
+  typedef std::complex<float> c_type;
+
+  cv::Mat row_vector   (1, rows,             COMPLEX_TYPE_CV);
+  cv::Mat row_up_vector(1, upsampled_height, COMPLEX_TYPE_CV);
+  for (int i=0; i<rows; ++i)
+    row_vector.at<c_type>(0,i) = static_cast<c_type>(i);
+  for (int i=0; i<upsampled_height; ++i)
+    row_up_vector.at<c_type>(0,i) = static_cast<c_type>(i);
+
+  const c_type neg_i(0, -1);
+  float two_pi = 2.0*M_PI;
+
+  cv::Mat row_kernel;
+  cv::Mat temp_vec = fftshift(row_vector, true);
+  cv::Mat v1 = row_up_vector.t() - row_offset;
+  cv::Mat v2 = temp_vec - floor(rows/2);
   
+  cv::Mat dummy;
   cv::gemm(v1,v2,1.0, dummy, 0.0, row_kernel); //m  = v1*v2;
   
-  constant = neg_i*two_pi/static_cast<float>(input.rows*upscale);
+  c_type constant = neg_i*two_pi/static_cast<float>(rows*upscale);
   for (int i=0; i<row_kernel.rows; ++i)
     for (int j=0; j<row_kernel.cols; ++j)
       row_kernel.at<c_type>(i,j) = std::exp(row_kernel.at<c_type>(i,j)*constant);
+  return row_kernel;
+}
+
+/// Use matrix multiplication to upsample a DFT in only a small region.
+///  It is usually faster than doing the equivalent series of steps:
+///   1) pad_fourier_transform(input, input.rows()*upscale, input.cols()*upscale)
+///      dimension. fftshift(inverse) to bring the center of the image to (0,0).
+///   2) dft(upsampled_image)
+///   3) crop(dft_result, col_offset, row_offset, upsampled_width, upsampled_height)
+inline
+cv::Mat partial_upsample_dft(cv::Mat const& input, int upsampled_height, int upsampled_width, 
+                             int upscale, int row_offset=0, int col_offset=0) {
+
+  cv::Mat col_kernel = partial_upsample_col_kernel(input.cols, upsampled_width,  upscale, col_offset);
+  cv::Mat row_kernel = partial_upsample_row_kernel(input.rows, upsampled_height, upscale, row_offset);
 
   //save_mag_from_ft(row_kernel,  "/home/smcmich1/data/subpixel/row_kernel.tif", false);
   //save_mag_from_ft(col_kernel,  "/home/smcmich1/data/subpixel/col_kernel.tif", false);
@@ -112,26 +135,75 @@ cv::Mat partial_upsample_dft(cv::Mat const& input, int upsampled_height, int ups
   return out;
 }
 
-/// Compute the subpixel translation between two images using a two-pass frequency based method.
-/// - The images must be the same size!
-/// - Maximum accuracy is 1/subpixel_accuracy
-template <class T1, class T2>
-void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
-                                ImageViewBase<T2> const& right_image,
-                                Vector2f &offset,
-                                int subpixel_accuracy=10,
-                                bool debug = false
-                               ) {
+/// DFT plans and upsampling kernels shared by all of the phase correlation
+///  windows in a tile, which all have the same size.
+/// - The kernels only depend on the window size and the integer offset of
+///   the upsampled region, so only a few distinct ones are ever made.
+/// - Not thread safe, use one object per tile.
+class PhaseCorrelationPlans {
+public:
 
-  if (left_image.get_size() != right_image.get_size()) {
-    vw_throw( ArgumentErr() << "phase_correlation_subpixel requires images to be the same size!\n" );
+  DftPlanCache & dft_plans() { return m_dft_plans; }
+
+  cv::Mat col_kernel(int cols, int upsampled_width, int upscale, int col_offset) {
+    KernelKey key = {{cols, upsampled_width, upscale, col_offset}};
+    return get_kernel(m_col_kernels, key, false);
   }
 
-  // Fourier transform of the input images.
-  // TODO: Use padding for an optimal DFT size?
-  cv::Mat complexI_left, complexI_right;
-  get_dft(left_image,  complexI_left);
-  get_dft(right_image, complexI_right);
+  cv::Mat row_kernel(int rows, int upsampled_height, int upscale, int row_offset) {
+    KernelKey key = {{rows, upsampled_height, upscale, row_offset}};
+    return get_kernel(m_row_kernels, key, true);
+  }
+
+private:
+  struct KernelKey {
+    int v[4];
+    bool operator<(KernelKey const& other) const {
+      return std::lexicographical_compare(v, v+4, other.v, other.v+4);
+    }
+  };
+  typedef std::map<KernelKey, cv::Mat> KernelMap;
+
+  /// Only very unusual inputs produce many offsets, don't let them use up memory.
+  static const size_t MAX_CACHED_KERNELS = 4096;
+
+  DftPlanCache m_dft_plans;
+  KernelMap    m_col_kernels, m_row_kernels;
+
+  cv::Mat get_kernel(KernelMap & kernels, KernelKey const& key, bool row) {
+    KernelMap::const_iterator iter = kernels.find(key);
+    if (iter != kernels.end())
+      return iter->second;
+    if (kernels.size() >= MAX_CACHED_KERNELS)
+      kernels.clear();
+    cv::Mat kernel = row ? partial_upsample_row_kernel(key.v[0], key.v[1], key.v[2], key.v[3])
+                         : partial_upsample_col_kernel(key.v[0], key.v[1], key.v[2], key.v[3]);
+    kernels[key] = kernel;
+    return kernel;
+  }
+};
+
+/// Same as partial_upsample_dft() above with the kernels taken from plans.
+inline
+cv::Mat partial_upsample_dft(cv::Mat const& input, int upsampled_height, int upsampled_width, 
+                             int upscale, int row_offset, int col_offset,
+                             PhaseCorrelationPlans & plans) {
+  cv::Mat o1 = plans.row_kernel(input.rows, upsampled_height, upscale, row_offset)*input;
+  return o1*plans.col_kernel(input.cols, upsampled_width, upscale, col_offset);
+}
+
+/// Compute the subpixel translation between two images from their
+///  Fourier transforms, see get_dft().
+/// - The images must be the same size!
+/// - Maximum accuracy is 1/subpixel_accuracy
+inline
+void phase_correlation_subpixel_dft(cv::Mat const& complexI_left,
+                                    cv::Mat const& complexI_right,
+                                    Vector2f &offset,
+                                    int subpixel_accuracy,
+                                    PhaseCorrelationPlans & plans,
+                                    bool debug = false
+                                   ) {
 
   // Some papers suggest filtering out high frequency image content prior to correlation
   //  but that does not seem to help in all cases.
@@ -159,7 +231,7 @@ void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
 
   // Inverse FFT to get back to image coordinates.
   cv::Mat conv;
-  cv::dft(padded_conj, conv, cv::DFT_INVERSE + cv::DFT_REAL_OUTPUT+ cv::DFT_SCALE, 0);
+  plans.dft_plans().dft(padded_conj, conv, cv::DFT_INVERSE + cv::DFT_REAL_OUTPUT+ cv::DFT_SCALE, 0);
 
   // Find the peak.
   int width  = conv.cols;
@@ -219,7 +291,8 @@ void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
                                                    upsampled_width,
                                                    pad_factor,
                                                    dft_shift-shift_y*pad_factor,
-                                                   dft_shift-shift_x*pad_factor);
+                                                   dft_shift-shift_x*pad_factor,
+                                                   plans);
 
   // Find the peak
   cv::Mat CC;
@@ -246,6 +319,31 @@ void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
   }
 }
 
+/// Compute the subpixel translation between two images using a two-pass frequency based method.
+/// - The images must be the same size!
+/// - Maximum accuracy is 1/subpixel_accuracy
+template <class T1, class T2>
+void phase_correlation_subpixel(ImageViewBase<T1> const& left_image,
+                                ImageViewBase<T2> const& right_image,
+                                Vector2f &offset,
+                                int subpixel_accuracy=10,
+                                bool debug = false
+                               ) {
+
+  if (left_image.get_size() != right_image.get_size()) {
+    vw_throw( ArgumentErr() << "phase_correlation_subpixel requires images to be the same size!\n" );
+  }
+
+  // Fourier transform of the input images.
+  // TODO: Use padding for an optimal DFT size?
+  PhaseCorrelationPlans plans;
+  cv::Mat complexI_left, complexI_right;
+  get_dft(left_image,  complexI_left,  &plans.dft_plans());
+  get_dft(right_image, complexI_right, &plans.dft_plans());
+  phase_correlation_subpixel_dft(complexI_left, complexI_right, offset,
+                                 subpixel_accuracy, plans, debug);
+}
+
 
 
 
@@ -278,6 +376,11 @@ subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
   const int32 kern_half_height    = kern_height/2;
   const int32 kern_half_width     = kern_width /2;
 
+  // Every window has the same size, so the DFT plans and the upsampling
+  // kernels are made once for the whole tile.
+  PhaseCorrelationPlans plans;
+  cv::Mat left_dft, right_dft;
+
   // Iterate over all of the pixels in the disparity map except for the outer edges.
   for ( int32 y = std::max(region_of_interest.min().y()-1,kern_half_height);
               y < std::min(left_image.rows()-kern_half_height,
@@ -313,8 +416,11 @@ subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
       int initial_subpixel_accuracy = subpixel_accuracy;
       if (use_second_refinement) // The first pass can be lower resolution.
         initial_subpixel_accuracy /= 2;
-      phase_correlation_subpixel(left_image_patch, right_image_patch,
-                                 d, initial_subpixel_accuracy, debug);
+      // The left window is the same for both passes.
+      get_dft(left_image_patch,  left_dft,  &plans.dft_plans());
+      get_dft(right_image_patch, right_dft, &plans.dft_plans());
+      phase_correlation_subpixel_dft(left_dft, right_dft,
+                                     d, initial_subpixel_accuracy, plans, debug);
 
       if (use_second_refinement) {
         // Shift the right crop by the computed offset, then re-run
@@ -330,8 +436,9 @@ subpixel_phase_2d(ImageView<PixelMask<Vector2f> > &disparity_map,
         //write_image("/home/smcmich1/data/subpixel/right_patch_refined.tif", shift_right_crop);
 
         Vector2f d2(0,0);
-        phase_correlation_subpixel(left_image_patch, shift_right_crop,
-                                  d2, subpixel_accuracy, debug);
+        get_dft(shift_right_crop, right_dft, &plans.dft_plans());
+        phase_correlation_subpixel_dft(left_dft, right_dft,
+                                       d2, subpixel_accuracy, plans, debug);
         d += d2; // The second translation adds to the first one.
       }
 
@@ -40,9 +40,16 @@ namespace stereo {
     inline ImplT const& impl() const { return static_cast<ImplT const&>(*this); }
   };
 
+  // Each filter names the type of its filtered view with result<ImageT>::type.
+
   struct NullOperation : public PreFilterBase<NullOperation> {
     template <class ImageT>
-    EdgeExtensionView<ImageT,ConstantEdgeExtension>
+    struct result {
+      typedef EdgeExtensionView<ImageT,ConstantEdgeExtension> type;
+    };
+
+    template <class ImageT>
+    typename result<ImageT>::type
     filter( ImageViewBase<ImageT> const& image ) const {
       return edge_extend(image.impl(),ConstantEdgeExtension());
     }
@@ -53,7 +60,12 @@ namespace stereo {
     LaplacianOfGaussian( float size ) : kernel_width(size) {}
 
     template <class ImageT>
-    ConvolutionView<SeparableConvolutionView<ImageT, typename DefaultKernelT<typename ImageT::pixel_type>::type, ConstantEdgeExtension>, ImageView<typename DefaultKernelT<typename ImageT::pixel_type>::type>, ConstantEdgeExtension>
+    struct result {
+      typedef ConvolutionView<SeparableConvolutionView<ImageT, typename DefaultKernelT<typename ImageT::pixel_type>::type, ConstantEdgeExtension>, ImageView<typename DefaultKernelT<typename ImageT::pixel_type>::type>, ConstantEdgeExtension> type;
+    };
+
+    template <class ImageT>
+    typename result<ImageT>::type
     filter( ImageViewBase<ImageT> const& image ) const {
       return laplacian_filter(gaussian_filter(image.impl(),kernel_width));
     }
@@ -64,7 +76,12 @@ namespace stereo {
     SubtractedMean( float size ) : kernel_width(size) {}
 
     template <class ImageT>
-    BinaryPerPixelView<EdgeExtensionView<ImageT, ConstantEdgeExtension>,SeparableConvolutionView<ImageT, typename DefaultKernelT<typename ImageT::pixel_type>::type, ConstantEdgeExtension>,vw::ArgArgDifferenceFunctor>
+    struct result {
+      typedef BinaryPerPixelView<EdgeExtensionView<ImageT, ConstantEdgeExtension>,SeparableConvolutionView<ImageT, typename DefaultKernelT<typename ImageT::pixel_type>::type, ConstantEdgeExtension>,vw::ArgArgDifferenceFunctor> type;
+    };
+
+    template <class ImageT>
+    typename result<ImageT>::type
     filter( ImageViewBase<ImageT> const& image ) const {
       return edge_extend(image.impl(),ConstantEdgeExtension()) - gaussian_filter( image.impl(), kernel_width );
     }
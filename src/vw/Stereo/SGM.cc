@@ -1,10 +1,14 @@
 
 #include <queue>
+#include <algorithm>
 #include <math.h>
 #include <vw/Stereo/SGM.h>
 #include <vw/Stereo/SGMAssist.h>
+#include <vw/Core/CpuFeatures.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/System.h>
 #include <vw/Core/ThreadPool.h>
+#include <vw/Core/Profiler.h>
 #include <vw/Image/MaskViews.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
@@ -12,6 +16,7 @@
 #if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
   #include <emmintrin.h>
   #include <smmintrin.h> // SSE4.1
+  #include <immintrin.h> // AVX2 and AVX-512, only used after checking the CPU
 #endif
 
 namespace vw {
@@ -572,8 +577,24 @@ size_t SemiGlobalMatcher::compute_buffer_length() {
   if (total_offset < 6)
     vw_throw( ArgumentErr() << "SGM: Total disparity usage is too low!\n" );
 
+  // In strip mode the large buffers only need to hold the largest strip.
+  size_t held_offset = total_offset;
+  if ((m_strip_rows > 0) && !m_processing_strip) {
+    held_offset = 0;
+    for (int strip_start=0; strip_start<m_num_output_rows; strip_start+=m_strip_rows) {
+      int first, end;
+      get_strip_rows(strip_start, m_num_output_rows, first, end);
+      size_t end_offset = (end < m_num_output_rows) ? m_buffer_starts(0, end) : total_offset;
+      held_offset = std::max(held_offset, end_offset - m_buffer_starts(0, first));
+    }
+  }
+
+  // Compressed accumulation stores one byte per disparity plus a base cost per pixel.
   const size_t BYTES_PER_MB      = 1024*1024;
-  const size_t main_buffer_bytes = total_offset * (sizeof(CostType) + sizeof(AccumCostType));
+  const size_t accum_elem_bytes  = m_compress_accum ? sizeof(uint8) : sizeof(AccumCostType);
+  size_t main_buffer_bytes = held_offset * (sizeof(CostType) + accum_elem_bytes);
+  if (m_compress_accum)
+    main_buffer_bytes += m_num_output_cols * m_num_output_rows * sizeof(AccumCostType);
 
   vw_out(DebugMessage, "stereo") << "SGM: Estimating total large buffer size: " 
                                  << main_buffer_bytes/BYTES_PER_MB << " MB\n";
@@ -604,6 +625,21 @@ size_t SemiGlobalMatcher::compute_buffer_length() {
                             << " MB which is greater than the cap of "<< m_memory_limit_mb <<" MB!\n" );
   }
 
+  // Larger buffers kept from an earlier call will be reused, so they are what we hold.
+  if (can_reuse_buffers(held_offset))
+    total_num_bytes += (m_buffer_capacity - held_offset) * (sizeof(CostType) + accum_elem_bytes);
+
+  // Swap what we held for the earlier estimate for this one.  The cache is
+  // asked to shrink if needed, but we never wait on the other consumers.
+  if (!m_memory_account)
+    m_memory_account.reset(new MemoryGovernor::Account(vw_memory_governor(), "SGM"));
+  if (m_memory_account->used() != total_num_bytes) {
+    m_memory_account->release(m_memory_account->used());
+    if (!m_memory_account->try_reserve(total_num_bytes))
+      vw_throw( ArgumentErr() << "SGM: Required memory usage is "<< total_num_bytes/BYTES_PER_MB
+                              << " MB which does not fit in the shared memory budget!\n" );
+  }
+
 
   return total_offset;
 }
@@ -615,23 +651,132 @@ void SemiGlobalMatcher::allocate_large_buffers() {
   const size_t BYTES_PER_MB = 1024*1024;  
   const size_t total_offset           = compute_buffer_length();
   const size_t cost_buffer_num_bytes  = total_offset * sizeof(CostType);  
-  const size_t accum_buffer_num_bytes = total_offset * sizeof(AccumCostType);
+  const size_t accum_buffer_num_bytes = total_offset * (m_compress_accum ? sizeof(uint8) : sizeof(AccumCostType));
+
+  // Only the used part of the buffers needs to be cleared below.
+  if (can_reuse_buffers(total_offset)) {
+    vw_out(DebugMessage, "stereo") << "SGM: Reusing buffers with room for "
+                                   << m_buffer_capacity << " disparities\n";
+  } else {
+    // Free the old buffers first so that they are not held during the allocation.
+    // - The memory account was already updated by compute_buffer_length().
+    m_cost_buffer.reset();
+    m_accum_buffer.reset();
+    m_accum_deltas.reset();
+    m_accum_base.reset();
 
-  vw_out(DebugMessage, "stereo") << "SGM: Allocating buffer of size: " << cost_buffer_num_bytes/BYTES_PER_MB << " MB\n";
+    vw_out(DebugMessage, "stereo") << "SGM: Allocating buffer of size: " << cost_buffer_num_bytes/BYTES_PER_MB << " MB\n";
 
-  m_cost_buffer.reset(new CostType[total_offset]);
+    m_cost_buffer.reset(new CostType[total_offset]);
 
-  vw_out(DebugMessage, "stereo") << "SGM: Allocating buffer of size: " << accum_buffer_num_bytes/BYTES_PER_MB << " MB\n";
+    vw_out(DebugMessage, "stereo") << "SGM: Allocating buffer of size: " << accum_buffer_num_bytes/BYTES_PER_MB << " MB\n";
 
-  // Allocate the requested memory and init all to zero
-  m_accum_buffer.reset(new AccumCostType[total_offset]);
-  memset(m_accum_buffer.get(), 0, accum_buffer_num_bytes);
+    if (m_compress_accum)
+      m_accum_deltas.reset(new uint8[total_offset]);
+    else
+      m_accum_buffer.reset(new AccumCostType[total_offset]);
+    m_buffer_capacity = total_offset;
+  }
+
+  // Init the accumulated costs to zero
+  if (m_compress_accum) {
+    memset(m_accum_deltas.get(), 0, total_offset);
+    m_accum_base.set_size(m_num_output_cols, m_num_output_rows);
+    fill(m_accum_base, AccumCostType(0));
+  } else {
+    memset(m_accum_buffer.get(), 0, accum_buffer_num_bytes);
+  }
+}
+
+void SemiGlobalMatcher::release_buffers() {
+  m_cost_buffer.reset();
+  m_accum_buffer.reset();
+  m_accum_deltas.reset();
+  m_accum_base.reset();
+  m_buffer_capacity = 0;
+  if (m_memory_account)
+    m_memory_account->release(m_memory_account->used());
+}
+
+SemiGlobalMatcher::AccumCostType*
+SemiGlobalMatcher::get_accum_vector(int col, int row, std::vector<AccumCostType> & scratch) {
+  if (!m_compress_accum)
+    return get_accum_vector(col, row);
+
+  const int num_disp = get_num_disparities(col, row);
+  if (static_cast<int>(scratch.size()) < num_disp)
+    scratch.resize(num_disp);
+  const uint8*        deltas = m_accum_deltas.get() + m_buffer_starts(col, row);
+  const AccumCostType base   = m_accum_base(col, row);
+  for (int d=0; d<num_disp; ++d)
+    scratch[d] = base + (AccumCostType(deltas[d]) << m_accum_delta_shift);
+  return &(scratch[0]);
+}
+
+void SemiGlobalMatcher::store_accum_vector(int col, int row, AccumCostType const* values) {
+  const int num_disp = get_num_disparities(col, row);
+  if (!m_compress_accum) {
+    std::copy(values, values+num_disp, get_accum_vector(col, row));
+    return;
+  }
+  if (num_disp == 0)
+    return;
+
+  const AccumCostType base     = *std::min_element(values, values+num_disp);
+  const int           half     = (1 << m_accum_delta_shift) >> 1;
+  const int           max_diff = 255;
+  uint8* deltas = m_accum_deltas.get() + m_buffer_starts(col, row);
+  for (int d=0; d<num_disp; ++d)
+    deltas[d] = static_cast<uint8>(std::min(max_diff, (int(values[d]) - base + half) >> m_accum_delta_shift));
+  m_accum_base(col, row) = base;
+}
+
+void SemiGlobalMatcher::add_to_accum_vector(int col, int row, AccumCostType const* values,
+                                            int num_sets) const {
+  const int num_disp = get_num_disparities(col, row);
+  if (!m_compress_accum) {
+    AccumCostType* accum_ptr = m_accum_buffer.get() + m_buffer_starts(col, row);
+    for (int s=0; s<num_sets; ++s)
+      for (int d=0; d<num_disp; ++d)
+        accum_ptr[d] += values[s*num_disp + d];
+    return;
+  }
+  if (num_disp == 0)
+    return;
+
+  // Two passes so that no decompressed copy is needed: the first finds
+  //  the new base, the second stores the new deltas relative to it.
+  uint8*              deltas = m_accum_deltas.get() + m_buffer_starts(col, row);
+  const AccumCostType base   = m_accum_base(col, row);
+  const int           shift  = m_accum_delta_shift;
+  AccumCostType new_base = std::numeric_limits<AccumCostType>::max();
+  for (int d=0; d<num_disp; ++d) {
+    AccumCostType value = base + (AccumCostType(deltas[d]) << shift);
+    for (int s=0; s<num_sets; ++s)
+      value += values[s*num_disp + d];
+    new_base = std::min(new_base, value);
+  }
+  const int half     = (1 << shift) >> 1;
+  const int max_diff = 255;
+  for (int d=0; d<num_disp; ++d) {
+    AccumCostType value = base + (AccumCostType(deltas[d]) << shift);
+    for (int s=0; s<num_sets; ++s)
+      value += values[s*num_disp + d];
+    deltas[d] = static_cast<uint8>(std::min(max_diff, (int(value) - new_base + half) >> shift));
+  }
+  m_accum_base(col, row) = new_base;
 }
 
 
 
 void SemiGlobalMatcher::populate_adjacent_disp_lookup_table() {
 
+  // The single row case in evaluate_path_1d() does not use the table.
+  if (m_num_disp_y == 1) {
+    std::vector<DisparityType>().swap(m_adjacent_disp_lookup);
+    return;
+  }
+
   const int TABLE_WIDTH = 8;
   m_adjacent_disp_lookup.resize(m_num_disp*TABLE_WIDTH);
 
@@ -677,11 +822,36 @@ void SemiGlobalMatcher::populate_adjacent_disp_lookup_table() {
 } // End function populate_adjacent_disp_lookup_table
 
 
+int SemiGlobalMatcher::max_path_simd_width() {
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  #if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    // The wider kernels are chosen at run time, within vw_settings().simd_isa().
+    const uint32 features = cpu_features();
+    return (features & CPU_AVX512BW) ? 32 : ((features & CPU_AVX2) ? 16 : 8);
+  #else
+    return 8;
+  #endif
+#else
+  return 1;
+#endif
+}
+
+int SemiGlobalMatcher::path_simd_width() const {
+  const int max_width = max_path_simd_width();
+  if ((m_path_simd_width <= 0) || (m_path_simd_width >= max_width))
+    return max_width;
+  int width = 1;
+  while ((width < 8) || (2*width <= m_path_simd_width))
+    width *= 2;
+  return std::min(width, max_width);
+}
+
+
 #if not defined(VW_ENABLE_SSE) || (VW_ENABLE_SSE==0)
 // Note: local and output are the same size.
 // full_prior_buffer is always length m_num_disps and comes in initialized to a
 //  large flag value.  When the function quits the buffer must be returned to this state.
-void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
+void SemiGlobalMatcher::evaluate_path_2d( int col, int row, Vector4i const& pixel_disp_bounds_p,
                        AccumCostType* const prior,
                        AccumCostType*       full_prior_buffer,
                        CostType     * const local,
@@ -699,7 +869,6 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
   //int num_disparities_p = get_num_disparities(col_p, row_p);
 
   Vector4i pixel_disp_bounds   = m_disp_bound_image(col, row);
-  Vector4i pixel_disp_bounds_p = m_disp_bound_image(col_p, row_p);
 
   // Init the min prior in case the previous pixel is invalid.
   AccumCostType BAD_VAL = get_bad_accum_val();
@@ -727,7 +896,6 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
   }
   AccumCostType min_prev_disparity_cost = min_prior + p2_mod;
   if (debug) {
-    std::cout << "Prior pixel = ("<<col_p<<","<<row_p<<")\n";
     std::cout << "m_p2  : " << m_p2 << std::endl;
     std::cout << "path_intensity_gradient  : " << path_intensity_gradient << std::endl;
     std::cout << "p2_mod  : " << p2_mod << std::endl;
@@ -864,7 +1032,82 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
 #endif
 
 #if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
+
+// The AVX2 and AVX-512 versions of compute_path_internals_sse() are compiled for those
+//  instruction sets regardless of the build flags and are only called after checking the CPU.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define VW_SGM_WIDE_SIMD 1
+#endif
+
+namespace {
+
+  /// Minimum of an array of uint16 values using SSE4.1.
+  inline uint16 min_value_epu16(uint16 const* data, int count) {
+    __m128i _min = _mm_set1_epi16(-1);
+    int i = 0;
+    for (; i+8 <= count; i+=8)
+      _min = _mm_min_epu16(_min, _mm_loadu_si128((__m128i const*)(data+i)));
+    uint16 result = static_cast<uint16>(_mm_extract_epi16(_mm_minpos_epu16(_min), 0));
+    for (; i < count; ++i)
+      result = std::min(result, data[i]);
+    return result;
+  }
+
+#if defined(VW_SGM_WIDE_SIMD)
+  // In these functions the dL, d0, ..., d8 arrays are stored back to back in
+  //  "packed", each one starting "stride" values after the previous one.
+  // Operation = min( min(d1...d8)+dp1, d0, dJ) + dL - dP
+
+  __attribute__((target("avx2")))
+  void compute_path_internals_avx2(uint16 const* packed, int stride,
+                                   uint16 dJ, uint16 dP, uint16 dp1, uint16* dRes) {
+    __m256i _d[10];
+    for (int i=0; i<10; ++i)
+      _d[i] = _mm256_load_si256((__m256i const*)(packed + i*stride));
+
+    __m256i _min12   = _mm256_min_epu16(_d[2], _d[3]);
+    __m256i _min34   = _mm256_min_epu16(_d[4], _d[5]);
+    __m256i _min56   = _mm256_min_epu16(_d[6], _d[7]);
+    __m256i _min78   = _mm256_min_epu16(_d[8], _d[9]);
+    __m256i _min1234 = _mm256_min_epu16(_min12, _min34);
+    __m256i _min5678 = _mm256_min_epu16(_min56, _min78);
+    __m256i _minAdj  = _mm256_min_epu16(_min1234, _min5678);
+    __m256i _minO    = _mm256_min_epu16(_d[1], _mm256_set1_epi16(static_cast<int16>(dJ)));
+
+    __m256i _result = _mm256_adds_epu16(_minAdj, _mm256_set1_epi16(static_cast<int16>(dp1)));
+    _result = _mm256_min_epu16(_result, _minO);
+    _result = _mm256_adds_epu16(_result, _d[0]);
+    _result = _mm256_subs_epu16(_result, _mm256_set1_epi16(static_cast<int16>(dP)));
+    _mm256_store_si256((__m256i*)dRes, _result);
+  }
+
+  __attribute__((target("avx512bw")))
+  void compute_path_internals_avx512(uint16 const* packed, int stride,
+                                     uint16 dJ, uint16 dP, uint16 dp1, uint16* dRes) {
+    __m512i _d[10];
+    for (int i=0; i<10; ++i)
+      _d[i] = _mm512_load_si512((void const*)(packed + i*stride));
+
+    __m512i _min12   = _mm512_min_epu16(_d[2], _d[3]);
+    __m512i _min34   = _mm512_min_epu16(_d[4], _d[5]);
+    __m512i _min56   = _mm512_min_epu16(_d[6], _d[7]);
+    __m512i _min78   = _mm512_min_epu16(_d[8], _d[9]);
+    __m512i _min1234 = _mm512_min_epu16(_min12, _min34);
+    __m512i _min5678 = _mm512_min_epu16(_min56, _min78);
+    __m512i _minAdj  = _mm512_min_epu16(_min1234, _min5678);
+    __m512i _minO    = _mm512_min_epu16(_d[1], _mm512_set1_epi16(static_cast<int16>(dJ)));
+
+    __m512i _result = _mm512_adds_epu16(_minAdj, _mm512_set1_epi16(static_cast<int16>(dp1)));
+    _result = _mm512_min_epu16(_result, _minO);
+    _result = _mm512_adds_epu16(_result, _d[0]);
+    _result = _mm512_subs_epu16(_result, _mm512_set1_epi16(static_cast<int16>(dP)));
+    _mm512_store_si512((void*)dRes, _result);
+  }
+#endif
+
+} // end anonymous namespace
+
+void SemiGlobalMatcher::evaluate_path_2d( int col, int row, Vector4i const& pixel_disp_bounds_p,
                        AccumCostType* const prior,
                        AccumCostType*       full_prior_buffer,
                        CostType     * const local,
@@ -879,41 +1122,32 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
     p2_mod = m_p1;
 
   Vector4i pixel_disp_bounds   = m_disp_bound_image(col, row);
-  Vector4i pixel_disp_bounds_p = m_disp_bound_image(col_p, row_p);
 
   // Init the min prior in case the previous pixel is invalid.
   AccumCostType BAD_VAL = get_bad_accum_val();
-  AccumCostType min_prior = BAD_VAL;
 
   // Insert the valid disparity scores into full_prior buffer so they are
   //  easy to access quickly within the pixel loop below.
   // - If we don't use a full sized buffer, our adjacent disparity lookup
   //   table could not be used!
+  const int prior_width = pixel_disp_bounds_p[2] - pixel_disp_bounds_p[0] + 1;
   int d = 0;
   for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-
-    // Get initial fill linear storage index for this dy row
     int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
-
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
-    
-      // Get the min prior while we are at it.
-      if (prior[d] < min_prior) {
-        min_prior  = prior[d];
-      }
-    
-      full_prior_buffer[full_index] = prior[d];
-      ++full_index;
-      ++d;
-    }
+    std::copy(prior+d, prior+d+prior_width, full_prior_buffer+full_index);
+    d += prior_width;
   }
+  AccumCostType min_prior = std::min(BAD_VAL, min_value_epu16(prior, d));
   AccumCostType min_prev_disparity_cost = min_prior + p2_mod;
 
   const int LOOKUP_TABLE_WIDTH = 8;
   
-  // Allocate linear storage for data to pass to SSE instructions
-  const int SSE_BUFF_LEN = 8;
-  uint16 d_packed[SSE_BUFF_LEN*11] __attribute__ ((aligned (16))); // TODO: Could be passed in!
+  // Allocate linear storage for data to pass to the SIMD instructions.
+  // - The buffers are sized for the widest (AVX-512) case, only the first
+  //   simd_width entries of each one are used.
+  const int simd_width   = path_simd_width();
+  const int SSE_BUFF_LEN = 32;
+  uint16 d_packed[SSE_BUFF_LEN*11] __attribute__ ((aligned (64))); // TODO: Could be passed in!
   uint16* dL   = &(d_packed[0*SSE_BUFF_LEN]);
   uint16* d0   = &(d_packed[1*SSE_BUFF_LEN]);
   uint16* d1   = &(d_packed[2*SSE_BUFF_LEN]);
@@ -930,12 +1164,28 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
   __m128i _dJ  = _mm_set1_epi16(static_cast<int16>(min_prev_disparity_cost));
   __m128i _dP  = _mm_set1_epi16(static_cast<int16>(min_prior));
   __m128i _dp1 = _mm_set1_epi16(static_cast<int16>(m_p1));
-  
-  //printf("dJ = %d, dP = %d, dp1 = %d\n", min_prev_disparity_cost, min_prior, m_p1);
-  //std::cout << "pixel_disp_bounds = " << pixel_disp_bounds << std::endl;
-  
-  // Loop through disparities for this pixel
+
+  // Compute the first sse_index outputs from the packed buffers with the selected width.
   int sse_index = 0, output_index = 0;
+  auto compute_packed = [&]() {
+#if defined(VW_SGM_WIDE_SIMD)
+    if (simd_width > 8) {
+      if (simd_width == 32)
+        compute_path_internals_avx512(d_packed, SSE_BUFF_LEN, min_prev_disparity_cost,
+                                      min_prior, m_p1, dRes);
+      else
+        compute_path_internals_avx2(d_packed, SSE_BUFF_LEN, min_prev_disparity_cost,
+                                    min_prior, m_p1, dRes);
+      for (int i=0; i<sse_index; ++i)
+        output[output_index++] = dRes[i];
+      return;
+    }
+#endif
+    compute_path_internals_sse(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
+                               _dJ, _dP, _dp1, dRes, sse_index, output_index, output);
+  };
+
+  // Loop through disparities for this pixel
   int packed_d = 0; // Index for cost and output vectors
   for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
 
@@ -966,13 +1216,8 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
 
       // Keep packing the SSE buffers until they are filled up, then use SSE to operate on
       // all of the data at once.
-      if (sse_index == SSE_BUFF_LEN){
-
-        compute_path_internals_sse(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-                                   _dJ, _dP, _dp1, dRes, sse_index, output_index, output);
-        //compute_path_internals(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-        //                   min_prev_disparity_cost, min_prior, m_p1, dRes, sse_index, output_index, output);
-
+      if (sse_index == simd_width) {
+        compute_packed();
         sse_index = 0;
       } // End SSE operations
 
@@ -981,27 +1226,93 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
 
   // If there is data left over in the buffer, process it now.
   if (sse_index > 0) {
-    compute_path_internals_sse(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-                           _dJ, _dP, _dp1, dRes, sse_index, output_index, output);
-    //compute_path_internals(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-    //                       min_prev_disparity_cost, min_prior, m_p1, dRes, sse_index, output_index, output);
+    compute_packed();
   }
 
   // Remove the valid disparity scores from full_prior buffer.
   for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-
-    // Get initial fill linear storage index for this dy row
     int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
+    std::fill(full_prior_buffer+full_index, full_prior_buffer+full_index+prior_width, BAD_VAL);
+  }
 
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
+} // End evaluate_path_2d SSE
+#endif
 
-      full_prior_buffer[full_index] = BAD_VAL;
-      ++full_index;
-    }
-  }
 
-} // End evaluate_path SSE
+void SemiGlobalMatcher::evaluate_path_1d( Vector4i const& pixel_disp_bounds,
+                                          Vector4i const& pixel_disp_bounds_p,
+                                          AccumCostType const* prior,
+                                          CostType      const* local,
+                                          AccumCostType*       output,
+                                          int path_intensity_gradient ) const {
+
+  // Decrease p2 (jump cost) with increasing disparity along the path
+  AccumCostType p2_mod = m_p2;
+  if (path_intensity_gradient > 0)
+    p2_mod /= path_intensity_gradient;
+  if (p2_mod < m_p1)
+    p2_mod = m_p1;
+
+  const AccumCostType BAD_VAL = get_bad_accum_val();
+  const int num_disp  = pixel_disp_bounds[2] - pixel_disp_bounds[0] + 1;
+  const int num_prior = ((pixel_disp_bounds_p[3] >= pixel_disp_bounds_p[1]) &&
+                         (pixel_disp_bounds_p[2] >= pixel_disp_bounds_p[0]))
+                        ? pixel_disp_bounds_p[2] - pixel_disp_bounds_p[0] + 1 : 0;
+  if (num_disp <= 0)
+    return;
+
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  AccumCostType min_prior = (num_prior > 0) ? min_value_epu16(prior, num_prior) : BAD_VAL;
+#else
+  AccumCostType min_prior = (num_prior > 0) ? *std::min_element(prior, prior+num_prior) : BAD_VAL;
 #endif
+  min_prior = std::min(min_prior, BAD_VAL);
+  const AccumCostType min_prev_disparity_cost = min_prior + p2_mod;
+
+  // Output k is disparity pixel_disp_bounds[0]+k, which is prior[k+offset].
+  // - Disparities outside the prior range have the same BAD_VAL cost as in evaluate_path_2d().
+  const int offset = pixel_disp_bounds[0] - pixel_disp_bounds_p[0];
+  auto prior_cost = [&](int p) { return ((p >= 0) && (p < num_prior)) ? prior[p] : BAD_VAL; };
+  auto compute_one = [&](int k) {
+    const int p = k + offset;
+    AccumCostType adjacent = std::min(prior_cost(p-1), prior_cost(p+1)) + m_p1;
+    AccumCostType combined = std::min(std::min(prior_cost(p), adjacent), min_prev_disparity_cost);
+    output[k] = local[k] + combined - min_prior;
+  };
+
+  // Outputs whose prior and both neighbors are inside the prior vector need no checks.
+  const int k_begin = std::min(num_disp, std::max(0, 1 - offset));
+  const int k_end   = std::max(k_begin, std::min(num_disp, num_prior - 1 - offset));
+  int k = 0;
+  for (; k<k_begin; ++k)
+    compute_one(k);
+#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
+  const __m128i _dJ  = _mm_set1_epi16(static_cast<int16>(min_prev_disparity_cost));
+  const __m128i _dP  = _mm_set1_epi16(static_cast<int16>(min_prior));
+  const __m128i _dp1 = _mm_set1_epi16(static_cast<int16>(m_p1));
+  for (; k+8<=k_end; k+=8) {
+    AccumCostType const* center = prior + k + offset;
+    __m128i _left   = _mm_loadu_si128((__m128i const*)(center-1));
+    __m128i _center = _mm_loadu_si128((__m128i const*)(center));
+    __m128i _right  = _mm_loadu_si128((__m128i const*)(center+1));
+    __m128i _local  = _mm_cvtepu8_epi16(_mm_loadl_epi64((__m128i const*)(local+k)));
+
+    __m128i _result = _mm_adds_epu16(_mm_min_epu16(_left, _right), _dp1);
+    _result = _mm_min_epu16(_result, _mm_min_epu16(_center, _dJ));
+    _result = _mm_subs_epu16(_mm_adds_epu16(_result, _local), _dP);
+    _mm_storeu_si128((__m128i*)(output+k), _result);
+  }
+#endif
+  for (; k<k_end; ++k) {
+    AccumCostType const* center = prior + k + offset;
+    AccumCostType adjacent = std::min(center[-1], center[1]) + m_p1;
+    AccumCostType combined = std::min(std::min(center[0], adjacent), min_prev_disparity_cost);
+    output[k] = local[k] + combined - min_prior;
+  }
+  for (; k<num_disp; ++k)
+    compute_one(k);
+
+} // End evaluate_path_1d
 
 
 /* This function is not 100% successful at removing "multiple minimums"
@@ -1174,6 +1485,93 @@ int SemiGlobalMatcher::select_best_disparity(AccumCostType * accum_vec,
   return min_count;
 } // End function select_best_disparity
 
+void SemiGlobalMatcher::init_right_disparity(int num_left_rows,
+                                             ImageView<AccumCostType> & right_costs,
+                                             DisparityImage & right_disparity) const {
+  const int num_cols = m_num_output_cols + std::max(0, m_max_disp_x);
+  const int num_rows = num_left_rows     + std::max(0, m_max_disp_y);
+  right_costs     = ImageView<AccumCostType>(num_cols, num_rows);
+  right_disparity = DisparityImage(num_cols, num_rows);
+  fill(right_costs, std::numeric_limits<AccumCostType>::max());
+  DisparityImage::pixel_type no_match;
+  invalidate(no_match);
+  fill(right_disparity, no_match);
+}
+
+void SemiGlobalMatcher::add_right_disparity_costs(int row_begin, int row_end, int right_row_offset,
+                                                  ImageView<AccumCostType> & right_costs,
+                                                  DisparityImage & right_disparity) {
+  const int num_cols = right_costs.cols();
+  const int num_rows = right_costs.rows();
+
+  // Each left pixel offers its cost for each disparity to the right pixel at that disparity.
+  std::vector<AccumCostType> accum_scratch;
+  for (int j=row_begin; j<row_end; ++j) {
+    for (int i=0; i<m_num_output_cols; ++i) {
+      if (get_num_disparities(i, j) == 0)
+        continue;
+      const Vector4i bounds = m_disp_bound_image(i, j);
+      AccumCostType const* accum_vec = get_accum_vector(i, j, accum_scratch);
+      int index = 0;
+      for (int dy=bounds[1]; dy<=bounds[3]; ++dy) {
+        const int r = j + dy + right_row_offset;
+        if ((r < 0) || (r >= num_rows)) {
+          index += bounds[2] - bounds[0] + 1;
+          continue;
+        }
+        for (int dx=bounds[0]; dx<=bounds[2]; ++dx, ++index) {
+          const int c = i + dx;
+          if ((c < 0) || (c >= num_cols) || (accum_vec[index] >= right_costs(c,r)))
+            continue;
+          right_costs    (c,r) = accum_vec[index];
+          right_disparity(c,r) = DisparityImage::pixel_type(-dx, -dy);
+        }
+      }
+    }
+  }
+}
+
+float SemiGlobalMatcher::compute_confidence(AccumCostType const* accum_vec,
+                                            Vector4i const& bounds) const {
+  const int width    = bounds[2] - bounds[0] + 1;
+  const int height   = bounds[3] - bounds[1] + 1;
+  const int num_vals = width*height;
+  // A tie for the best cost gives a zero margin below.
+  const int min_index = std::min_element(accum_vec, accum_vec+num_vals) - accum_vec;
+  const int min_col = min_index % width;
+  const int min_row = min_index / width;
+  const double best = accum_vec[min_index];
+
+  // Best cost outside the 3x3 neighborhood, and the mean of the four adjacent costs.
+  double far_best = -1, adjacent_sum = 0;
+  int    num_adjacent = 0;
+  for (int r=0; r<height; ++r) {
+    for (int c=0; c<width; ++c) {
+      const double value = accum_vec[r*width + c];
+      const int dc = std::abs(c - min_col), dr = std::abs(r - min_row);
+      if ((dc > 1) || (dr > 1)) {
+        if ((far_best < 0) || (value < far_best))
+          far_best = value;
+      }
+      else if (dc + dr == 1) {
+        adjacent_sum += value;
+        ++num_adjacent;
+      }
+    }
+  }
+
+  // Margins relative to the larger cost, with no evidence counting as zero.
+  double peak = 0, curvature = 0;
+  if (far_best > 0)
+    peak = (far_best - best) / far_best;
+  if (num_adjacent > 0) {
+    const double adjacent_mean = adjacent_sum / num_adjacent;
+    if (adjacent_mean > 0)
+      curvature = (adjacent_mean - best) / adjacent_mean;
+  }
+  return static_cast<float>(0.5*(std::max(0.0, peak) + std::max(0.0, curvature)));
+}
+
 SemiGlobalMatcher::DisparityImage
 SemiGlobalMatcher::create_disparity_view() {
   // Init output vector
@@ -1199,9 +1597,19 @@ SemiGlobalMatcher::create_disparity_view() {
   int count = 0, worst=0;
   */
 
+  if (m_compute_confidence) {
+    m_confidence_image.set_size(m_num_output_cols, m_num_output_rows);
+    fill(m_confidence_image, 0.0f);
+  }
+  if (m_compute_right_disparity && !m_processing_strip) {
+    ImageView<AccumCostType> right_costs;
+    init_right_disparity(m_num_output_rows, right_costs, m_right_disparity);
+    add_right_disparity_costs(0, m_num_output_rows, 0, right_costs, m_right_disparity);
+  }
+
   DisparityType dx, dy;
   int min_index=0;
-  std::vector<AccumCostType> accum_buffer;
+  std::vector<AccumCostType> accum_buffer, accum_scratch;
   for ( int j = 0; j < m_num_output_rows; j++ ) {
     for ( int i = 0; i < m_num_output_cols; i++ ) {
 
@@ -1230,11 +1638,17 @@ SemiGlobalMatcher::create_disparity_view() {
 
       bool debug = false;//((j==2937) && (i >= 4635) && (i <= 4645));
       const Vector4i bounds = m_disp_bound_image(i, j);
-      AccumCostType  *accum_vec = get_accum_vector(i, j);
+      AccumCostType  *accum_vec = get_accum_vector(i, j, accum_scratch);
       if (debug)
         std::cout << "j = " << j << ", i = " << i << std::endl;
+      // Before select_best_disparity() smooths the costs of ambiguous pixels
+      if (m_compute_confidence)
+        m_confidence_image(i,j) = compute_confidence(accum_vec, bounds);
+
       select_best_disparity(accum_vec, bounds, min_index, accum_buffer, debug);
       disp_index_to_xy(min_index, i, j, dx, dy);
+      if (m_compress_accum) // Keep any smoothing for the subpixel step
+        store_accum_vector(i, j, accum_vec);
 
       disparity(i,j) = DisparityImage::pixel_type(dx, dy);
 
@@ -1396,8 +1810,21 @@ ImageView<PixelMask<Vector2f> > SemiGlobalMatcher::
 create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
 
   //Timer timer("Calculate Subpixel Disparity");
+  VW_PROFILE_ZONE("SGM::create_disparity_view_subpixel");
 
   typedef  PixelMask<Vector2f> p_type;
+
+  // In strip mode the buffers only hold the last strip, so the subpixel
+  //  disparities were already computed one strip at a time.
+  if (m_strip_subpixel.cols() > 0) {
+    ImageView<p_type> disparity = copy(m_strip_subpixel);
+    for (int j=0; j<disparity.rows(); ++j)
+      for (int i=0; i<disparity.cols(); ++i)
+        if (!is_valid(integer_disparity(i,j)))
+          invalidate(disparity(i,j));
+    return disparity;
+  }
+
   ImageView<p_type> disparity(m_num_output_cols, m_num_output_rows);
 
   ParabolaFit2d fitter; // Only used with parabola2d
@@ -1412,6 +1839,7 @@ create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
   //  select the disparity with the lowest accumulated cost.
   double percent_bad = 0;
   double delta_x, delta_y;
+  std::vector<AccumCostType> accum_scratch;
   for ( int j = 0; j < m_num_output_rows; j++ ) {
     for ( int i = 0; i < m_num_output_cols; i++ ) {
 
@@ -1454,7 +1882,7 @@ create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
       if (dy == bounds[3]) { y_down  = 0; bottom_bound = true; }
 
       // Apply subpixel correction and apply
-      AccumCostType const* accum_vec = get_accum_vector(i, j);
+      AccumCostType const* accum_vec = get_accum_vector(i, j, accum_scratch);
 
       bool debug = false;//((j==2937) && (i >= 4635) && (i <= 4645));
 
@@ -1645,131 +2073,45 @@ void SemiGlobalMatcher::fill_costs_block(ImageView<uint8> const& left_image,
 
 
 
-void SemiGlobalMatcher::fill_costs_census3x3(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
+void SemiGlobalMatcher::fill_costs_census(ImageView<uint8> const& left_image,
+                                          ImageView<uint8> const& right_image){
   const int half_kernel = (m_kernel_size - 1) / 2;
-  const int padding     = 2*half_kernel;
+  const bool ternary    = (m_cost_type == TERNARY_CENSUS_TRANSFORM);
 
-  // Compute the census value for each pixel.
-  // - ROI handling could be fancier but this is simple and works.
+  // Compute the packed census descriptor for each pixel.
   // - The 0,0 pixels in the left and right images are assumed to be aligned.
+  // - The descriptor images are offset from the input images by half_kernel.
+  ImageView<uint64> left_census  = m_strip_left_census;
+  ImageView<uint64> right_census = m_strip_right_census;
+  if (left_census.cols() == 0) {
+    left_census  = census_descriptor_image(left_image,  m_kernel_size,
+                                           ternary, m_ternary_census_threshold);
+    right_census = census_descriptor_image(right_image, m_kernel_size,
+                                           ternary, m_ternary_census_threshold);
+  }
 
-  if (m_cost_type == CENSUS_TRANSFORM) {
-    ImageView<uint8> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                     right_census(right_image.cols()-padding, right_image.rows()-padding);
-
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_3x3(left_image, c+half_kernel, r+half_kernel);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_3x3(right_image, c+half_kernel, r+half_kernel);
-    get_hamming_distance_costs(left_census, right_census);
-  } else {
-    ImageView<uint16> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                      right_census(right_image.cols()-padding, right_image.rows()-padding);
-
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_3x3(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_3x3(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    get_hamming_distance_costs(left_census, right_census);
-  } 
-
-}
-
-void SemiGlobalMatcher::fill_costs_census5x5(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
-  const int half_kernel = (m_kernel_size - 1) / 2;
-  const int padding     = 2*half_kernel;
-
-  // Compute the census value for each pixel.
-  // - ROI handling could be fancier but this is simple and works.
-  // - The 0,0 pixels in the left and right images are assumed to be aligned.
-  ImageView<uint32> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                    right_census(right_image.cols()-padding, right_image.rows()-padding);
-
-  if (m_cost_type == CENSUS_TRANSFORM) {
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_5x5(left_image, c+half_kernel, r+half_kernel);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_5x5(right_image, c+half_kernel, r+half_kernel);
-  } else { // TERNARY_CENSUS_TRANSFORM
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_5x5(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_5x5(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-  }
-  get_hamming_distance_costs(left_census, right_census);
-}
-
-void SemiGlobalMatcher::fill_costs_census7x7(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
-  const int half_kernel = (m_kernel_size - 1) / 2;
-  const int padding     = 2*half_kernel;
-
-  // Compute the census value for each pixel.
-  // - ROI handling could be fancier but this is simple and works.
-  // - The 0,0 pixels in the left and right images are assumed to be aligned.
-  ImageView<uint64> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                    right_census(right_image.cols()-padding, right_image.rows()-padding);
-
-  if (m_cost_type == CENSUS_TRANSFORM) {
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_7x7(left_image, c+half_kernel, r+half_kernel);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_7x7(right_image, c+half_kernel, r+half_kernel);
-  } else { // TERNARY_CENSUS_TRANSFORM
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_7x7(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_7x7(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-  }
-  get_hamming_distance_costs(left_census, right_census);
-}
+  // Now compute the disparity costs for each pixel.
+  // - Each row of the disparity search region is contiguous in both the
+  //   cost buffer and the right descriptor image.
+  size_t cost_index = 0;
+  for ( int r = m_min_row; r <= m_max_row; r++ ) { // For each row in left
+    int output_row = r - m_min_row;
+    int binary_row = r - half_kernel;
+    for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
+      int output_col = c - m_min_col;
+      int binary_col = c - half_kernel;
 
-void SemiGlobalMatcher::fill_costs_census9x9(ImageView<uint8> const& left_image,
-                                             ImageView<uint8> const& right_image){
-  const int half_kernel = (m_kernel_size - 1) / 2;
-  const int padding     = 2*half_kernel;
-  
-  // Compute the census value for each pixel.
-  // - ROI handling could be fancier but this is simple and works.
-  // - The 0,0 pixels in the left and right images are assumed to be aligned.
+      Vector4i pixel_disp_bounds = m_disp_bound_image(output_col, output_row);
+      const int    num_dx = pixel_disp_bounds[2] - pixel_disp_bounds[0] + 1;
+      const uint64 left   = left_census(binary_col, binary_row);
 
-  if (m_cost_type == CENSUS_TRANSFORM) {
-    ImageView<uint32> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                      right_census(right_image.cols()-padding, right_image.rows()-padding);
-
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_9x9(left_image, c+half_kernel, r+half_kernel);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_9x9(right_image, c+half_kernel, r+half_kernel);  
-    get_hamming_distance_costs(left_census, right_census);
-  } else { // TERNARY_CENSUS_TRANSFORM
-    ImageView<uint64> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
-                      right_census(right_image.cols()-padding, right_image.rows()-padding);
-
-    for ( int r = 0; r < left_census.rows(); r++ )
-      for ( int c = 0; c < left_census.cols(); c++ )
-        left_census(c,r) = get_census_value_ternary_9x9(left_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    for ( int r = 0; r < right_census.rows(); r++ )
-      for ( int c = 0; c < right_census.cols(); c++ )
-        right_census(c,r) = get_census_value_ternary_9x9(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    get_hamming_distance_costs(left_census, right_census);
-  }
+      for ( int dy = pixel_disp_bounds[1]; dy <= pixel_disp_bounds[3]; dy++ ) { // For each disparity row
+        census_hamming_distances(left, &right_census(binary_col+pixel_disp_bounds[0], binary_row+dy),
+                                 num_dx, &m_cost_buffer[cost_index]);
+        cost_index += num_dx;
+      }
+    } // End x loop
+  }// End y loop
 }
 
 // TODO: Add multithreading capability to this function!
@@ -1777,14 +2119,10 @@ void SemiGlobalMatcher::compute_disparity_costs(ImageView<uint8> const& left_ima
                                                 ImageView<uint8> const& right_image) {  
   //Timer timer("\tSGM Cost Calculation");
   if ((m_cost_type == CENSUS_TRANSFORM) || (m_cost_type == TERNARY_CENSUS_TRANSFORM)) {
-    switch(m_kernel_size) {
-    case 3:  fill_costs_census3x3(left_image, right_image); break;
-    case 5:  fill_costs_census5x5(left_image, right_image); break;
-    case 7:  fill_costs_census7x7(left_image, right_image); break;
-    case 9:  fill_costs_census9x9(left_image, right_image); break;
-    default: vw_throw( NoImplErr() << "Census transforms are only available in size 3, 5, 7, and 9!\n"
-                                   << "Other cost mode options do not have this restriction.");
-    };
+    if ((m_kernel_size < 3) || (m_kernel_size > 9) || (m_kernel_size % 2 == 0))
+      vw_throw( NoImplErr() << "Census transforms are only available in size 3, 5, 7, and 9!\n"
+                            << "Other cost mode options do not have this restriction.");
+    fill_costs_census(left_image, right_image);
   }
   else { // Use the default mean of diff cost function
     // Replace this with ASP's efficient existing cost functions?
@@ -2309,6 +2647,15 @@ SemiGlobalMatcher::semi_global_matching_func( ImageView<uint8> const& left_image
                                               ImageView<uint8> const* right_image_mask,
                                               DisparityImage const* prev_disparity) {
 
+  m_strip_subpixel.reset();
+  m_strip_left_census.reset();
+  m_strip_right_census.reset();
+  m_confidence_image.reset();
+  m_right_disparity.reset();
+  m_boundary_in.clear();
+  m_boundary_out.clear();
+  m_boundary_out_row = -1;
+
   // Compute safe bounds to search through given the disparity range and kernel size.
   // - Using inclusive bounds here.
 
@@ -2355,32 +2702,176 @@ SemiGlobalMatcher::semi_global_matching_func( ImageView<uint8> const& left_image
     vw_out(WarningMessage, "stereo") << "Unable to compute valid search ranges for SGM input!.\n";
     // If the inputs are invalid, return a default disparity image.
     DisparityImage disparity( m_num_output_cols, m_num_output_rows );
+    if (m_compute_confidence) {
+      m_confidence_image.set_size(m_num_output_cols, m_num_output_rows);
+      fill(m_confidence_image, 0.0f);
+    }
+    if (m_compute_right_disparity) {
+      ImageView<AccumCostType> right_costs;
+      init_right_disparity(m_num_output_rows, right_costs, m_right_disparity);
+    }
     return invalidate_mask(disparity);
   }
 
   // All the hard work is done in the next few function calls!
 
+  if ((m_strip_rows > 0) && (m_strip_rows < m_num_output_rows))
+    return strip_matching(left_image, right_image);
+
   allocate_large_buffers();
 
-  compute_disparity_costs(left_image, right_image);
+  {
+    VW_PROFILE_ZONE("SGM::compute_disparity_costs");
+    compute_disparity_costs(left_image, right_image);
+  }
 
-  if (m_use_mgm)
-    //smooth_path_accumulation(left_image);
-    smooth_path_accumulation_multithreaded(left_image);
-  else
-    //two_trip_path_accumulation(left_image);
-    multi_thread_accumulation(left_image);
+  {
+    VW_PROFILE_ZONE("SGM::path_accumulation");
+    if (m_use_mgm)
+      //smooth_path_accumulation(left_image);
+      smooth_path_accumulation_multithreaded(left_image);
+    else
+      //two_trip_path_accumulation(left_image);
+      multi_thread_accumulation(left_image);
+  }
 
   vw_out(DebugMessage, "stereo") << "Accumulation finished, creating integer disparity image...\n";
 
   // Now that all the costs are calculated, fetch the best disparity for each pixel.
   // - This computes integer disparities.  Subpixel disparities are computed in CorrelationView.tcc
+  VW_PROFILE_ZONE("SGM::create_disparity_view");
   return create_disparity_view();
 }
 
 
 
 
+void SemiGlobalMatcher::PathBoundary::initialize(ImageView<Vector4i> const& bound_image, int row) {
+  bounds.resize(bound_image.cols());
+  starts.resize(bound_image.cols());
+  size_t total = 0;
+  for (int col=0; col<bound_image.cols(); ++col) {
+    bounds[col] = bound_image(col, row);
+    starts[col] = total;
+    total += (bounds[col][2] - bounds[col][0] + 1) * (bounds[col][3] - bounds[col][1] + 1);
+  }
+  for (int i=0; i<3; ++i)
+    values[i].assign(total, 0);
+}
+
+void SemiGlobalMatcher::PathBoundary::clear() {
+  bounds.clear();
+  starts.clear();
+  for (int i=0; i<3; ++i)
+    values[i].clear();
+}
+
+void SemiGlobalMatcher::get_strip_rows(int strip_start, int num_rows, int &first, int &end) const {
+  // The MGM accumulation cannot continue paths from the previous strip.
+  first = strip_start;
+  if (m_use_mgm)
+    first = std::max(0, strip_start - m_strip_overlap);
+  end = std::min(num_rows, strip_start + m_strip_rows + m_strip_overlap);
+}
+
+SemiGlobalMatcher::DisparityImage
+SemiGlobalMatcher::strip_matching(ImageView<uint8> const& left_image,
+                                  ImageView<uint8> const& right_image) {
+
+  // Keep the layout of the whole image, the members are set to each strip in turn.
+  const int full_min_row  = m_min_row;
+  const int full_max_row  = m_max_row;
+  const int full_num_rows = m_num_output_rows;
+  const int num_cols      = m_num_output_cols;
+  ImageView<Vector4i> full_bound_image = m_disp_bound_image;
+
+  DisparityImage                  disparity(num_cols, full_num_rows);
+  ImageView<PixelMask<Vector2f> > subpixel (num_cols, full_num_rows);
+  ImageView<float>                confidence;
+  if (m_compute_confidence)
+    confidence.set_size(num_cols, full_num_rows);
+  ImageView<AccumCostType> right_costs;
+  DisparityImage           right_disparity;
+  if (m_compute_right_disparity)
+    init_right_disparity(full_num_rows, right_costs, right_disparity);
+
+  // Every strip takes its census costs from the whole images, so the
+  //  descriptors only need to be computed once.
+  const bool census = (m_cost_type == CENSUS_TRANSFORM) || (m_cost_type == TERNARY_CENSUS_TRANSFORM);
+  if (census && (m_kernel_size >= 3) && (m_kernel_size <= 9) && (m_kernel_size % 2 == 1)) {
+    const bool ternary = (m_cost_type == TERNARY_CENSUS_TRANSFORM);
+    m_strip_left_census  = census_descriptor_image(left_image,  m_kernel_size,
+                                                   ternary, m_ternary_census_threshold);
+    m_strip_right_census = census_descriptor_image(right_image, m_kernel_size,
+                                                   ternary, m_ternary_census_threshold);
+  }
+
+  m_processing_strip = true;
+  for (int strip_start=0; strip_start<full_num_rows; strip_start+=m_strip_rows) {
+    const int strip_end = std::min(full_num_rows, strip_start + m_strip_rows);
+    int first, end;
+    get_strip_rows(strip_start, full_num_rows, first, end);
+    vw_out(DebugMessage, "stereo") << "SGM: Processing strip rows " << first << " to " << end-1 << "\n";
+
+    m_min_row         = full_min_row + first;
+    m_max_row         = full_min_row + end - 1;
+    m_num_output_rows = end - first;
+    ImageView<Vector4i> strip_bounds = crop(full_bound_image, 0, first, num_cols, m_num_output_rows);
+    m_disp_bound_image = strip_bounds;
+
+    // Save the downward paths on the last output row for the next strip.
+    m_boundary_out_row = -1;
+    m_boundary_out.clear();
+    if (!m_use_mgm && (strip_end < full_num_rows)) {
+      m_boundary_out_row = strip_end - 1 - first;
+      m_boundary_out.initialize(m_disp_bound_image, m_boundary_out_row);
+    }
+
+    allocate_large_buffers();
+    compute_disparity_costs(left_image, right_image);
+    if (m_use_mgm)
+      smooth_path_accumulation_multithreaded(left_image);
+    else
+      multi_thread_accumulation(left_image);
+
+    // Keep only the output rows of this strip.
+    // - The kept rows offer their costs to the right pixels before they are smoothed.
+    if (m_compute_right_disparity)
+      add_right_disparity_costs(strip_start-first, strip_end-first, first,
+                                right_costs, right_disparity);
+    DisparityImage strip_disparity = create_disparity_view();
+    ImageView<PixelMask<Vector2f> > strip_subpixel = create_disparity_view_subpixel(strip_disparity);
+    const int num_kept = strip_end - strip_start;
+    crop(disparity, 0, strip_start, num_cols, num_kept)
+      = crop(strip_disparity, 0, strip_start-first, num_cols, num_kept);
+    crop(subpixel,  0, strip_start, num_cols, num_kept)
+      = crop(strip_subpixel,  0, strip_start-first, num_cols, num_kept);
+    if (m_compute_confidence)
+      crop(confidence, 0, strip_start, num_cols, num_kept)
+        = crop(m_confidence_image, 0, strip_start-first, num_cols, num_kept);
+
+    std::swap(m_boundary_in, m_boundary_out);
+  } // End loop through strips
+  m_processing_strip = false;
+  m_strip_left_census.reset();
+  m_strip_right_census.reset();
+
+  // Restore the whole image layout.  The large buffers still describe the last strip.
+  m_min_row          = full_min_row;
+  m_max_row          = full_max_row;
+  m_num_output_rows  = full_num_rows;
+  m_disp_bound_image = full_bound_image;
+  m_boundary_in.clear();
+  m_boundary_out.clear();
+  m_boundary_out_row = -1;
+  m_strip_subpixel   = subpixel;
+  m_confidence_image = confidence;
+  m_right_disparity  = right_disparity;
+
+  return disparity;
+}
+
+
 // Perform standard SGM path accumulation using N threads.
 void SemiGlobalMatcher::multi_thread_accumulation(ImageView<uint8> const& left_image) {
 
@@ -2446,6 +2937,12 @@ void SemiGlobalMatcher::multi_thread_accumulation(ImageView<uint8> const& left_i
   thread_pool.join_all(); // Wait for all tasks to complete
   vw_out() << ".";
 
+  // Skip the diagonal lines
+  if (m_num_paths == 4) {
+    vw_out() << "Finished multi-threaded accumulation!\n";
+    return;
+  }
+
   // Add lines from the top left
   for (int i=0; i<width; ++i) {
     Vector2i top_pixel(i, 0);
@@ -2580,6 +3077,59 @@ void SemiGlobalMatcher::smooth_path_accumulation_multithreaded(ImageView<uint8>
 
 
 
+//=========================================================================
+
+SemiGlobalMatcherPool::SemiGlobalMatcherPool(size_t max_idle_per_size)
+  : m_max_idle_per_size(max_idle_per_size) {
+  if (m_max_idle_per_size == 0)
+    m_max_idle_per_size = vw_settings().default_num_threads();
+}
+
+SemiGlobalMatcherPool::MatcherPtr
+SemiGlobalMatcherPool::acquire(Vector2i const& tile_size) {
+  {
+    Mutex::Lock lock(m_mutex);
+    MatcherMap::iterator iter = m_idle.find(std::make_pair(tile_size[0], tile_size[1]));
+    if ((iter != m_idle.end()) && !iter->second.empty()) {
+      MatcherPtr matcher = iter->second.back();
+      iter->second.pop_back();
+      return matcher;
+    }
+  }
+  return MatcherPtr(new SemiGlobalMatcher());
+}
+
+void SemiGlobalMatcherPool::release(Vector2i const& tile_size, MatcherPtr & matcher) {
+  if (!matcher)
+    return;
+  MatcherPtr unused; // Freed outside the lock if the pool is full
+  {
+    Mutex::Lock lock(m_mutex);
+    std::vector<MatcherPtr> & idle = m_idle[std::make_pair(tile_size[0], tile_size[1])];
+    if (idle.size() < m_max_idle_per_size)
+      idle.push_back(matcher);
+    else
+      unused = matcher;
+  }
+  matcher.reset();
+}
+
+size_t SemiGlobalMatcherPool::num_idle() const {
+  Mutex::Lock lock(m_mutex);
+  size_t count = 0;
+  for (MatcherMap::const_iterator iter = m_idle.begin(); iter != m_idle.end(); ++iter)
+    count += iter->second.size();
+  return count;
+}
+
+void SemiGlobalMatcherPool::clear() {
+  MatcherMap unused;
+  {
+    Mutex::Lock lock(m_mutex);
+    unused.swap(m_idle);
+  }
+}
+
 } // end namespace stereo
 } // end namespace vw
 
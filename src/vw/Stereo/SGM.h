@@ -1,6 +1,8 @@
 #ifndef __SEMI_GLOBAL_MATCHING_H__
 #define __SEMI_GLOBAL_MATCHING_H__
 
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Core/Thread.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Stereo/DisparityMap.h>
@@ -10,6 +12,9 @@
 
 #include <boost/smart_ptr/shared_ptr.hpp>
 
+#include <map>
+#include <vector>
+
 #if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
   #include <emmintrin.h>
   #include <smmintrin.h> // SSE4.1
@@ -31,8 +36,9 @@ implementation has the following features:
   only the individual search range for every pixel.  When combined with an
   input low-resolution disparity image, this can massively reduce the amount
   of memory required.
-- SSE instructions are used to increase speed but currently they only provide
-  a small improvement.
+- SSE instructions are used to increase speed in the path accumulation step.
+  Wider AVX2 (16 disparities) and AVX-512 (32 disparities) versions are selected
+  at run time if the CPU supports them, see set_path_simd_width().
   
 Even with the included optimizations this algorithm is slow and requires huge
 amounts of memory to operate on large images.  Be careful not to exceed your
@@ -41,7 +47,6 @@ available memory when using it!
 Future improvements:
 - Implement an option in our pyramid correlation to short-circuit the lowest
   levels of the pyramid, enabling a fast computation of a low-resolution stereo output.
-- Speed up the census cost function calculations.
 - Optimize the algorithm parameters for our common use cases.
 - Create a sub-pixel disparity step that can be used as an alternative
   to our existing sub-pixel algorithms.
@@ -50,7 +55,6 @@ Future improvements:
   detections
 - Try to find algorithmic improvements.
 - Try to further optimize the speed of the expensive accumulation step.
-- Generate a confidence score for each pixel's disparity result.
 - Make sure everything works with negative disparity search ranges.  This never
   comes up when called from CorrelationView, but would make the class more flexible.
 */
@@ -77,7 +81,10 @@ public: // Definitions
 
 public: // Functions
 
-  SemiGlobalMatcher() {} ///< Default constructor
+  SemiGlobalMatcher() : m_path_simd_width(0), m_strip_rows(0), m_strip_overlap(0),
+                        m_processing_strip(false), m_boundary_out_row(-1), m_compute_confidence(false),
+                        m_compute_right_disparity(false), m_num_paths(8),
+                        m_compress_accum(false), m_accum_delta_shift(2), m_buffer_capacity(0) {} ///< Default constructor
   ~SemiGlobalMatcher() {} ///< Destructor
 
   /// Set set_parameters for details
@@ -90,7 +97,11 @@ public: // Functions
                     Vector2i search_buffer=Vector2i(2,2),
                     size_t memory_limit_mb=6000,
                     uint16 p1=0, uint16 p2=0,
-                    int ternary_census_threshold=5) {
+                    int ternary_census_threshold=5)
+    : m_path_simd_width(0), m_strip_rows(0), m_strip_overlap(0),
+      m_processing_strip(false), m_boundary_out_row(-1), m_compute_confidence(false),
+      m_compute_right_disparity(false), m_num_paths(8),
+      m_compress_accum(false), m_accum_delta_shift(2), m_buffer_capacity(0) {
     set_parameters(cost_type, use_mgm, min_disp_x, min_disp_y, max_disp_x, max_disp_y, 
                    kernel_size, subpixel, search_buffer, memory_limit_mb, p1, p2, ternary_census_threshold);
   }
@@ -105,7 +116,8 @@ public: // Functions
   /// - memory_limit_mb is the maximum amount of memory that the algorithm is allowed to allocate
   ///   for its large buffers (total memory usage can go slightly over this).  The program will
   ///   attempt a more conservative search range if needed to get under this target and if that
-  ///   fails then the program will throw an exception.
+  ///   fails then the program will throw an exception.  The buffers are also reserved against
+  ///   vw_memory_governor(), so a smaller search range is used if the shared budget is short.
   void set_parameters(CostFunctionType cost_type,
                       bool use_mgm,
                       int min_disp_x, int min_disp_y,
@@ -126,6 +138,96 @@ public: // Functions
                              ImageView<uint8> const* right_image_mask=0,
                              DisparityImage const* prev_disparity=0);
 
+  /// Set the number of disparities evaluate_path() computes at once.
+  /// - Zero (the default) uses the widest width the CPU supports.
+  /// - Other values are rounded down to a supported width: 32 (AVX-512),
+  ///   16 (AVX2), 8 (SSE) or 1 when built without SSE.  Mainly useful to
+  ///   compare the code paths against each other.
+  void set_path_simd_width(int width) { m_path_simd_width = width; }
+
+  /// The width which will be used by evaluate_path().
+  int path_simd_width() const;
+
+  /// The widest evaluate_path() width supported by this CPU, and allowed
+  /// by vw_settings().simd_isa().
+  static int max_path_simd_width();
+
+  /// Process the image in horizontal strips so that the large cost and
+  /// accumulation buffers only need to hold one strip at a time.
+  /// - Each strip covers strip_rows output rows, and is extended by
+  ///   overlap_rows below it to warm up the upward paths.
+  /// - The downward paths are continued exactly across strips by saving their
+  ///   accumulated costs on the last row of each strip.  Horizontal paths are
+  ///   complete within each strip.  With MGM the paths cannot be carried over,
+  ///   so the strips are also extended by overlap_rows above.
+  /// - The memory limit then applies to the largest strip instead of the image.
+  /// - Set strip_rows to zero (the default) to process the whole image at once.
+  void set_strip_mode(int strip_rows, int overlap_rows=32) {
+    m_strip_rows    = strip_rows;
+    m_strip_overlap = overlap_rows;
+  }
+
+  /// If set, semi_global_matching_func() also fills in confidence_image().
+  void set_compute_confidence(bool compute) { m_compute_confidence = compute; }
+
+  /// Confidence in each pixel of the last disparity image, in the range 0 to 1.
+  /// - This is the mean of two margins of the accumulated costs, each relative
+  ///   to the larger cost:
+  ///   - The peak margin between the best cost and the best cost outside
+  ///     the 3x3 disparity neighborhood of the best disparity.
+  ///   - The curvature margin between the best cost and the mean cost of
+  ///     its four adjacent disparities.
+  /// - Zero for invalid pixels.  A tie for the best cost sets one of the margins to zero.
+  /// - Thresholding this image removes most of the pixels that a left-right
+  ///   consistency check would, without running the matching in reverse.
+  ImageView<float> const& confidence_image() const { return m_confidence_image; }
+
+  /// Set the number of SGM accumulation paths, 8 (the default) or 4.
+  /// - With 4 paths only the horizontal and vertical directions are accumulated,
+  ///   which halves the accumulation time at some loss of quality on slanted surfaces.
+  /// - Does not affect MGM, which always uses 8 paths.
+  void set_num_paths(int num_paths) {
+    VW_ASSERT((num_paths == 4) || (num_paths == 8),
+              ArgumentErr() << "SemiGlobalMatcher: The number of paths must be 4 or 8.");
+    m_num_paths = num_paths;
+  }
+  int num_paths() const { return m_num_paths; }
+
+  /// Store the accumulated costs in a compressed form to fit larger search
+  /// ranges under the same memory limit.
+  /// - Each pixel keeps its lowest accumulated cost plus one byte per disparity
+  ///   holding the difference from it, divided by 2^delta_shift.  This brings
+  ///   the main buffers from three to two bytes per searched disparity.
+  /// - The compression is lossy: differences are rounded to a multiple of
+  ///   2^delta_shift and capped at 255*2^delta_shift.  Only costs far from the
+  ///   best are capped, so this mostly affects ambiguous pixels.
+  void set_compressed_accumulation(bool compress, int delta_shift=2) {
+    VW_ASSERT((delta_shift >= 0) && (delta_shift <= 7),
+              ArgumentErr() << "SemiGlobalMatcher: The delta shift must be between 0 and 7.");
+    m_compress_accum    = compress;
+    m_accum_delta_shift = delta_shift;
+  }
+  bool compressed_accumulation() const { return m_compress_accum; }
+
+  /// Free the large cost and accumulation buffers.
+  /// - Otherwise they are kept after each call to semi_global_matching_func()
+  ///   and reused by the next call if they are large enough, which avoids
+  ///   allocating and faulting in new buffers for each pyramid level or tile.
+  void release_buffers();
+
+  /// If set, semi_global_matching_func() also fills in right_disparity_image().
+  void set_compute_right_disparity(bool compute) { m_compute_right_disparity = compute; }
+
+  /// Right to left disparity derived from the same accumulated costs as the last
+  ///  disparity image, for a left-right consistency check without a reverse run.
+  /// - Each right pixel takes the negated disparity of the left pixel matching it
+  ///   with the lowest accumulated cost.
+  /// - Pixel (0,0) is the right image pixel at the same location as left pixel (0,0)
+  ///   of the disparity image.  The image is larger than the disparity image by
+  ///   the positive part of the maximum disparity.
+  /// - Right pixels which no left pixel searched are invalid.
+  DisparityImage const& right_disparity_image() const { return m_right_disparity; }
+
   /// Create a subpixel leves disparity image using parabola interpolation
   ImageView<PixelMask<Vector2f> > create_disparity_view_subpixel(DisparityImage const& integer_disparity);
 
@@ -141,6 +243,8 @@ private: // Variables
     SgmSubpixelMode  m_subpixel_type;
     Vector2i m_search_buffer;
     size_t m_memory_limit_mb; ///< Maximum memory usage allowed in main buffers
+    int    m_path_simd_width; ///< Requested evaluate_path() width, zero for automatic.
+    int    m_strip_rows, m_strip_overlap; ///< See set_strip_mode()
 
     int m_min_row, m_max_row;
     int m_min_col, m_max_col;
@@ -157,6 +261,8 @@ private: // Variables
     boost::shared_array<CostType     > m_cost_buffer;
     boost::shared_array<AccumCostType> m_accum_buffer;
     size_t                             m_buffer_lengths;
+    /// Holds the bytes of the buffers above against vw_memory_governor().
+    boost::shared_ptr<MemoryGovernor::Account> m_memory_account;
 
     /// Image containing the inclusive disparity bounds for each pixel.
     /// - Stored as min_col, min_row, max_col, max_row.
@@ -173,6 +279,47 @@ private: // Variables
     /// For each output pixel, store the starting index in m_cost_buffer/m_accum_buffer
     ImageView<size_t> m_buffer_starts;
 
+    /// The accumulated costs of the three downward paths (BL, B, BR) along one row.
+    /// - Used to continue the paths from one strip into the next in strip mode.
+    struct PathBoundary {
+      std::vector<Vector4i>      bounds;    ///< Disparity bounds of each column
+      std::vector<size_t>        starts;    ///< Start of each column in values
+      std::vector<AccumCostType> values[3]; ///< Indexed by the column step of the path + 1
+
+      /// Size the storage to hold the paths along a row of the bound image.
+      void initialize(ImageView<Vector4i> const& bound_image, int row);
+      void clear();
+      bool empty() const { return bounds.empty(); }
+    };
+
+    /// Strip mode state.  During each strip the members above describe just
+    /// that strip, the first row of which continues the paths in m_boundary_in.
+    bool          m_processing_strip;
+    PathBoundary  m_boundary_in, m_boundary_out;
+    int           m_boundary_out_row; ///< Strip row stored in m_boundary_out, or -1 for none.
+    ImageView<PixelMask<Vector2f> > m_strip_subpixel; ///< Subpixel result assembled from the strips
+    /// Census descriptors of the whole input images, computed once for all of the strips.
+    ImageView<uint64> m_strip_left_census, m_strip_right_census;
+
+    bool             m_compute_confidence;
+    ImageView<float> m_confidence_image; ///< See confidence_image()
+
+    bool           m_compute_right_disparity;
+    DisparityImage m_right_disparity; ///< See right_disparity_image()
+
+    int m_num_paths; ///< See set_num_paths()
+
+    /// Compressed accumulation buffer, see set_compressed_accumulation().
+    /// - Replaces m_accum_buffer, the cost of each disparity is
+    ///   m_accum_base(col,row) + (m_accum_deltas[index] << m_accum_delta_shift).
+    bool                         m_compress_accum;
+    int                          m_accum_delta_shift;
+    boost::shared_array<uint8>   m_accum_deltas;
+    ImageView<AccumCostType>     m_accum_base;
+
+    /// Number of disparities the allocated large buffers can hold, see release_buffers().
+    size_t m_buffer_capacity;
+
 private: // Functions
 
   /// Populate the lookup table m_adjacent_disp_lookup
@@ -209,8 +356,16 @@ private: // Functions
   size_t compute_buffer_length();
 
   /// Fills m_buffer_starts and allocates m_cost_buffer and m_accum_buffer
+  /// - The existing buffers are reused if they can hold the new search area.
   void allocate_large_buffers();
 
+  /// True if the allocated large buffers can hold num_elements disparities
+  ///  in the current accumulation mode.
+  bool can_reuse_buffers(size_t num_elements) const {
+    return (num_elements <= m_buffer_capacity) && m_cost_buffer &&
+           (m_compress_accum ? bool(m_accum_deltas) : bool(m_accum_buffer));
+  }
+
   /// Return a bad accumulation value used to fill locations we don't visit
   AccumCostType get_bad_accum_val() const { return std::numeric_limits<CostType>::max() + m_p2; }
 
@@ -230,16 +385,10 @@ private: // Functions
   /// Compute mean of differences within a block of pixels.
   void fill_costs_block    (ImageView<uint8> const& left_image,
                             ImageView<uint8> const& right_image);
-  // The following functions use two census transform cost function options
-  void fill_costs_census3x3(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
-  void fill_costs_census5x5(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
-  void fill_costs_census7x7(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
-  void fill_costs_census9x9(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
-
-  /// Used to finish computing the census-based disparity costs in the above functions.
-  template <typename T>
-  void get_hamming_distance_costs(ImageView<T> const& left_binary_image,
-                                  ImageView<T> const& right_binary_image);
+  /// Compute census (or ternary census) costs from packed per-pixel descriptors.
+  /// - Supports kernel sizes 3, 5, 7, and 9.
+  /// - In strip mode the descriptors computed by strip_matching() are used.
+  void fill_costs_census(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
 
   /// Compute the mean and STD of a small image patch.
   /// - Does not perform bounds checking.
@@ -260,11 +409,32 @@ private: // Functions
   };
 
   /// Get a pointer to an accumulated cost vector
+  /// - Not available with compressed accumulation, use the version below.
   AccumCostType* get_accum_vector(int col, int row) {
     size_t start_index = m_buffer_starts(col, row);
     return m_accum_buffer.get() + start_index;
   };
 
+  /// Get a pointer to an accumulated cost vector, which is decompressed into
+  ///  scratch if needed.  Changes only reach the buffer through store_accum_vector().
+  AccumCostType* get_accum_vector(int col, int row, std::vector<AccumCostType> & scratch);
+
+  /// Overwrite the accumulated costs of a pixel.
+  void store_accum_vector(int col, int row, AccumCostType const* values);
+
+  /// Add num_sets consecutive cost vectors to the accumulated costs of a pixel.
+  /// - Different threads may call this for different pixels.
+  /// - Const like the other buffer writers, only the buffer contents change.
+  void add_to_accum_vector(int col, int row, AccumCostType const* values, int num_sets=1) const;
+
+  /// Run the matching one strip at a time, see set_strip_mode().
+  /// - Called by semi_global_matching_func() after the disparity bounds are set.
+  DisparityImage strip_matching(ImageView<uint8> const& left_image,
+                                ImageView<uint8> const& right_image);
+
+  /// Output row range [first, end) processed for the strip starting at strip_start.
+  void get_strip_rows(int strip_start, int num_rows, int &first, int &end) const;
+
   /// Generate the output disparity view from the accumulated costs.
   DisparityImage create_disparity_view();
 
@@ -276,6 +446,22 @@ private: // Functions
                             std::vector<AccumCostType> & buffer,
                             bool debug);
 
+  /// Size the right_disparity_image() and its best costs for num_left_rows of output,
+  ///  with no matches yet.
+  void init_right_disparity(int num_left_rows, ImageView<AccumCostType> & right_costs,
+                            DisparityImage & right_disparity) const;
+
+  /// Offer the accumulated costs of output rows [row_begin, row_end) to the right
+  ///  pixels they match, keeping the lowest cost for each right pixel.
+  /// - right_row_offset is added to the right pixel rows, for strip mode.
+  /// - Must be called before select_best_disparity() modifies the costs.
+  void add_right_disparity_costs(int row_begin, int row_end, int right_row_offset,
+                                 ImageView<AccumCostType> & right_costs,
+                                 DisparityImage & right_disparity);
+
+  /// Compute the confidence_image() value from the accumulated costs at one pixel.
+  float compute_confidence(AccumCostType const* accum_vec, Vector4i const& bounds) const;
+
   /// Get the pixel diff along a line at a specified output location.
   int get_path_pixel_diff(ImageView<uint8> const& left_image,
                           int col, int row, int dir_x, int dir_y) const {
@@ -294,7 +480,45 @@ private: // Functions
                       AccumCostType*       full_prior_buffer, // Buffer to store all accumulated costs
                       CostType     * const local,             // The disparity costs of the current pixel
                       AccumCostType*       output,
-                      int path_intensity_gradient, bool debug=false ); // The magnitude of intensity change to this pixel
+                      int path_intensity_gradient, bool debug=false ) { // The magnitude of intensity change to this pixel
+    evaluate_path(col, row, m_disp_bound_image(col_p, row_p), prior, full_prior_buffer,
+                  local, output, path_intensity_gradient, debug);
+  }
+
+  /// As above, but with the disparity bounds of the prior pixel passed in
+  ///  so that the prior pixel does not need to be in the current image.
+  void evaluate_path( int col, int row, Vector4i const& pixel_disp_bounds_p,
+                      AccumCostType* const prior,
+                      AccumCostType*       full_prior_buffer,
+                      CostType     * const local,
+                      AccumCostType*       output,
+                      int path_intensity_gradient, bool debug=false ) {
+    if (m_num_disp_y == 1)
+      evaluate_path_1d(m_disp_bound_image(col, row), pixel_disp_bounds_p, prior,
+                       local, output, path_intensity_gradient);
+    else
+      evaluate_path_2d(col, row, pixel_disp_bounds_p, prior, full_prior_buffer,
+                       local, output, path_intensity_gradient, debug);
+  }
+
+  /// evaluate_path() for a search range with more than one row of disparities.
+  /// - The prior costs are spread into full_prior_buffer so that the eight adjacent
+  ///   disparities can be found with m_adjacent_disp_lookup.
+  void evaluate_path_2d( int col, int row, Vector4i const& pixel_disp_bounds_p,
+                         AccumCostType* const prior,
+                         AccumCostType*       full_prior_buffer,
+                         CostType     * const local,
+                         AccumCostType*       output,
+                         int path_intensity_gradient, bool debug );
+
+  /// evaluate_path() for a single row of disparities, as with rectified images.
+  /// - The adjacent disparities are neighbors in the prior vector, so the prior costs
+  ///   are read in place without full_prior_buffer or m_adjacent_disp_lookup.
+  void evaluate_path_1d( Vector4i const& pixel_disp_bounds, Vector4i const& pixel_disp_bounds_p,
+                         AccumCostType const* prior,
+                         CostType      const* local,
+                         AccumCostType*       output,
+                         int path_intensity_gradient ) const;
 
   /// Perform all eight path accumulations in two passes through the image
   void two_trip_path_accumulation(ImageView<uint8> const& left_image);
@@ -373,6 +597,8 @@ private: // Functions
 /// - This function only searches positive disparities. The input images need to be
 ///   already cropped so that this makes sense.
 /// - This function could be made more flexible by accepting other varieties of mask images.
+/// - If matcher_ptr already holds a matcher it is set up again and reused
+///   together with its buffers, otherwise a new matcher is created.
 /// - TODO: Merge with the function in Correlation.h?
 template <class ImageT1, class ImageT2>
 ImageView<PixelMask<Vector2i> >
@@ -389,7 +615,61 @@ calc_disparity_sgm(CostFunctionType cost_type,
                    boost::shared_ptr<SemiGlobalMatcher> &matcher_ptr,
                    ImageView<uint8>       const* left_mask_ptr=0,  
                    ImageView<uint8>       const* right_mask_ptr=0,
-                   SemiGlobalMatcher::DisparityImage  const* prev_disparity=0);
+                   SemiGlobalMatcher::DisparityImage  const* prev_disparity=0,
+                   bool                   const compute_right_disparity=false,
+                   int                    const num_paths=8);
+
+
+/// A thread safe pool of SemiGlobalMatcher objects, keyed by tile size.
+/// - A matcher keeps its large buffers between uses (see
+///   SemiGlobalMatcher::release_buffers()), so handing matchers from one tile
+///   to the next tile of the same size skips most buffer allocations.
+/// - A matcher is not shared while it is acquired.  The settings of a returned
+///   matcher stay as they were, calc_disparity_sgm() sets all of its parameters.
+/// - Idle matchers hold on to their memory, so keep the pool only as long as
+///   tiles are being processed.
+class SemiGlobalMatcherPool {
+public:
+  typedef boost::shared_ptr<SemiGlobalMatcher> MatcherPtr;
+
+  /// At most max_idle_per_size matchers are kept for each tile size, the
+  ///  default of zero keeps one per thread.
+  SemiGlobalMatcherPool(size_t max_idle_per_size=0);
+
+  /// Get an idle matcher for this tile size, or a new default constructed one.
+  MatcherPtr acquire(Vector2i const& tile_size);
+
+  /// Return a matcher obtained from acquire() with the same tile size.
+  /// - matcher is reset.
+  void release(Vector2i const& tile_size, MatcherPtr & matcher);
+
+  /// Number of matchers currently held by the pool.
+  size_t num_idle() const;
+
+  /// Free all of the idle matchers.
+  void clear();
+
+private:
+  typedef std::map<std::pair<int,int>, std::vector<MatcherPtr> > MatcherMap;
+
+  size_t        m_max_idle_per_size;
+  MatcherMap    m_idle;
+  mutable Mutex m_mutex;
+};
+
+
+/// Invalidate the pixels of an SGM disparity image with a confidence
+///  below min_confidence.  See SemiGlobalMatcher::confidence_image().
+template <class PixelT>
+void invalidate_low_confidence(ImageView<PixelMask<PixelT> > & disparity,
+                               ImageView<float> const& confidence, float min_confidence) {
+  VW_ASSERT(disparity.cols() == confidence.cols() && disparity.rows() == confidence.rows(),
+            ArgumentErr() << "invalidate_low_confidence: Image sizes do not match.");
+  for (int row=0; row<disparity.rows(); ++row)
+    for (int col=0; col<disparity.cols(); ++col)
+      if (confidence(col,row) < min_confidence)
+        invalidate(disparity(col,row));
+}
 
 
 //#################################################################################################
@@ -468,39 +748,6 @@ void SemiGlobalMatcher::compute_path_internals(uint16* dL, uint16* d0, uint16* d
 } // end function compute_path_internals
 
 
-// From the census transformed input images, compute the cost of each disparity value.
-template <typename T>
-void SemiGlobalMatcher::get_hamming_distance_costs(ImageView<T> const& left_binary_image,
-                                                   ImageView<T> const& right_binary_image) {
-
-  const int half_kernel = (m_kernel_size - 1) / 2;
-
-  // Now compute the disparity costs for each pixel.
-  // Make sure we don't go out of bounds here due to the disparity shift and kernel.
-  size_t cost_index = 0;
-  for ( int r = m_min_row; r <= m_max_row; r++ ) { // For each row in left
-    int output_row = r - m_min_row;
-    int binary_row = r - half_kernel;
-    for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
-      int output_col = c - m_min_col;
-      int binary_col = c - half_kernel;
-
-      Vector4i pixel_disp_bounds = m_disp_bound_image(output_col, output_row);
-
-      for ( int dy = pixel_disp_bounds[1]; dy <= pixel_disp_bounds[3]; dy++ ) { // For each disparity
-        for ( int dx = pixel_disp_bounds[0]; dx <= pixel_disp_bounds[2]; dx++ ) {
-
-          CostType cost = hamming_distance(left_binary_image (binary_col   , binary_row   ), 
-                                           right_binary_image(binary_col+dx, binary_row+dy) );
-          m_cost_buffer[cost_index] = cost;
-          ++cost_index;
-        }
-      } // End disparity loops   
-    } // End x loop
-  }// End y loop 
-}
-
-
 template <class ImageT1, class ImageT2>
 ImageView<PixelMask<Vector2i> >
 calc_disparity_sgm(CostFunctionType cost_type,
@@ -516,7 +763,9 @@ calc_disparity_sgm(CostFunctionType cost_type,
                    boost::shared_ptr<SemiGlobalMatcher> &matcher_ptr,
                    ImageView<uint8>       const* left_mask_ptr,  
                    ImageView<uint8>       const* right_mask_ptr,
-                   SemiGlobalMatcher::DisparityImage  const* prev_disparity){ 
+                   SemiGlobalMatcher::DisparityImage  const* prev_disparity,
+                   bool                   const compute_right_disparity,
+                   int                    const num_paths){ 
 
     // Sanity check the input:
     VW_DEBUG_ASSERT( kernel_size[0] % 2 == 1 && kernel_size[1] % 2 == 1,
@@ -546,8 +795,15 @@ calc_disparity_sgm(CostFunctionType cost_type,
     u8_convert(crop(left_in.impl(),  left_region),  left);
     u8_convert(crop(right_in.impl(), right_region), right);
 
-    matcher_ptr.reset(new SemiGlobalMatcher(cost_type, use_mgm, 0, 0, 
-                      search_volume_inclusive[0], search_volume_inclusive[1], kernel_size[0], subpixel_mode, search_buffer, memory_limit_mb));
+    if (matcher_ptr)
+      matcher_ptr->set_parameters(cost_type, use_mgm, 0, 0,
+                                  search_volume_inclusive[0], search_volume_inclusive[1], kernel_size[0],
+                                  subpixel_mode, search_buffer, memory_limit_mb);
+    else
+      matcher_ptr.reset(new SemiGlobalMatcher(cost_type, use_mgm, 0, 0, 
+                        search_volume_inclusive[0], search_volume_inclusive[1], kernel_size[0], subpixel_mode, search_buffer, memory_limit_mb));
+    matcher_ptr->set_compute_right_disparity(compute_right_disparity);
+    matcher_ptr->set_num_paths(num_paths);
     return matcher_ptr->semi_global_matching_func(left, right, left_mask_ptr, right_mask_ptr, prev_disparity);
 
   } // End function calc_disparity
@@ -5,6 +5,7 @@
 #include <vw/Stereo/SGM.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/ThreadPool.h>
+#include <vw/Core/Profiler.h>
 #include <vw/Image/PixelIterator.h>
 
 /**
@@ -385,31 +386,19 @@ public:
   void add_lead_buffer_to_accum() {
     Mutex::Lock locker(m_mutex); // Scoped lock so this function can't be run simultaneously
 
+    // The passes for each pixel are stored one after the other.
     size_t buffer_index = 0;
-    SemiGlobalMatcher::AccumCostType* out_ptr = m_parent_ptr->m_accum_buffer.get();
     if (!m_vertical) { // horizontal
       for (int col=0; col<m_parent_ptr->m_num_output_cols; ++col) {
         int num_disps = m_parent_ptr->get_num_disparities(col, m_current_row);
-        for (int pass=0; pass<m_num_paths_in_pass; ++pass) {
-          size_t out_index = m_parent_ptr->m_buffer_starts(col, m_current_row);
-          for (int d=0; d<num_disps; ++d) {
-            out_ptr[out_index++] += m_lead_buffer[buffer_index++];
-            //printf("row, col, pass, d = %d, %d, %d, %d ->> %d ->> %d\n", 
-            //    m_current_row, col, pass, d, m_trail_buffer[buffer_index], m_parent_ptr->m_accum_buffer[out_index]);
-          } // end disp loop
-        } // end pass loop
+        m_parent_ptr->add_to_accum_vector(col, m_current_row, m_lead_buffer+buffer_index, m_num_paths_in_pass);
+        buffer_index += num_disps*m_num_paths_in_pass;
       } // end col loop
     } else { // vertical
       for (int row=0; row<m_parent_ptr->m_num_output_rows; ++row) {
         int num_disps = m_parent_ptr->get_num_disparities(m_current_col, row);
-        for (int pass=0; pass<m_num_paths_in_pass; ++pass) {
-          size_t out_index = m_parent_ptr->m_buffer_starts(m_current_col, row);
-          for (int d=0; d<num_disps; ++d) {
-            out_ptr[out_index++] += m_lead_buffer[buffer_index++];
-            //printf("row, col, pass, d = %d, %d, %d, %d ->> %d ->> %d\n", 
-            //    m_current_row, col, pass, d, m_trail_buffer[buffer_index], m_parent_ptr->m_accum_buffer[out_index]);
-          } // end disp loop
-        } // end pass loop
+        m_parent_ptr->add_to_accum_vector(m_current_col, row, m_lead_buffer+buffer_index, m_num_paths_in_pass);
+        buffer_index += num_disps*m_num_paths_in_pass;
       } // end col loop
     }
   } // end add_trail_buffer_to_accum
@@ -747,6 +736,7 @@ public:
 
   /// Do the work!
   virtual void operator()() {
+    VW_PROFILE_ZONE("SGM::pixel_pass");
 
     // Retrive a memory buffer to work with
     size_t buffer_id = m_buffer_manager_ptr->get_free_buffer_id();
@@ -802,6 +792,16 @@ public:
         m_parent_ptr->evaluate_path( col, row, col_prev, row_prev,
                                     prior_accum_ptr, full_prior_ptr, local_cost_ptr, computed_accum_ptr, 
                                     pixel_diff, debug );
+      } else if (continues_from_previous_strip()) {
+        // First pixel of a downward path which started in the previous strip.
+        SemiGlobalMatcher::PathBoundary & boundary = m_parent_ptr->m_boundary_in;
+        const int dcol     = m_pixel_loc_iter.dcol();
+        const int prev_col = col - dcol;
+        int prev_pixel_val = static_cast<int>(m_image_ptr->operator()(input_col - dcol, input_row - 1));
+        AccumCostType* boundary_ptr = &(boundary.values[dcol+1][boundary.starts[prev_col]]);
+        m_parent_ptr->evaluate_path( col, row, boundary.bounds[prev_col],
+                                    boundary_ptr, full_prior_ptr, local_cost_ptr, computed_accum_ptr,
+                                    std::abs(curr_pixel_val - prev_pixel_val), debug );
       } else { // First pixel only, nothing to accumulate.
         for (int d=0; d<num_disp; ++d) 
           computed_accum_ptr[d] = local_cost_ptr[d];
@@ -825,6 +825,16 @@ public:
 
   } // End operator() function
 
+  /// True if this line is a downward path whose previous pixel is the last
+  ///  row of the previous strip.
+  bool continues_from_previous_strip() const {
+    SemiGlobalMatcher::PathBoundary const& boundary = m_parent_ptr->m_boundary_in;
+    if (boundary.empty() || (m_pixel_loc_iter.drow() != 1) || (m_pixel_loc_iter.row() != 0))
+      return false;
+    const int prev_col = m_pixel_loc_iter.col() - m_pixel_loc_iter.dcol();
+    return (prev_col >= 0) && (prev_col < static_cast<int>(boundary.bounds.size()));
+  }
+
   /// Add the computed buffer results to the parent accumulation buffer
   void update_accum_buffer(OneLineBuffer * buff_ptr) {
 
@@ -843,11 +853,15 @@ public:
       // Get information about the current pixel location from the parent
       int num_disp = m_parent_ptr->get_num_disparities(col, row);
 
-      AccumCostType* output_accum_ptr = m_parent_ptr->get_accum_vector(col, row);
+      // Add the computed values to the output accumulation location
+      m_parent_ptr->add_to_accum_vector(col, row, computed_accum_ptr);
 
-      // Add the computed values to the output accumulation location      
-      for (int i=0; i<num_disp; ++i) {
-        output_accum_ptr[i] += computed_accum_ptr[i];
+      // Save the downward paths for the next strip.  Each pixel is on one line
+      //  per direction, so the threads never write to the same location.
+      if ((row == m_parent_ptr->m_boundary_out_row) && (m_pixel_loc_iter.drow() == 1)) {
+        SemiGlobalMatcher::PathBoundary & boundary = m_parent_ptr->m_boundary_out;
+        std::copy(computed_accum_ptr, computed_accum_ptr+num_disp,
+                  &(boundary.values[m_pixel_loc_iter.dcol()+1][boundary.starts[col]]));
       }
       // Advance through pixel position and the computed data buffer
       computed_accum_ptr += num_disp;
@@ -901,6 +915,7 @@ public:
 
   /// Main task function redirects to the dedicated function
   virtual void operator()() {
+    VW_PROFILE_ZONE("SGM::smooth_path_pass");
     switch(m_dir) {
     case TL: task_TL(); return;
     case T:  task_T (); return;
@@ -125,37 +125,45 @@ Vector3 StereoModel::operator()(vector<Vector2> const& pixVec,
       camCtrs.push_back(m_cameras[p]->camera_center(pix));
     }
 
-    // Not enough valid rays
-    if (camDirs.size() < 2) 
-      return Vector3();
-
-    if (are_nearly_parallel(m_least_squares, m_angle_tol, camDirs)) 
-      return Vector3();
-
-    // Determine range by triangulation
-    Vector3 result = triangulate_point(camDirs, camCtrs, errorVec);
-    if ( m_least_squares ){
-      if (num_cams == 2)
-        refine_point(pixVec[0], pixVec[1], result);
-      else
-        vw::vw_throw(vw::NoImplErr() << "Least squares refinement is not "
-                     << "implemented for multi-view stereo.");
-    }
-    
-    // Reflect points that fall behind one of the two cameras
-    bool reflect = false;
-    for (int p = 0; p < (int)camCtrs.size(); p++)
-      if (dot_prod(result - camCtrs[p], camDirs[p]) < 0 ) reflect = true;
-    if (reflect)
-      result = -result + 2*camCtrs[0];
-
-    return result;
+    return triangulate_rays(pixVec, camDirs, camCtrs, errorVec);
 
   } catch (const camera::PixelToRayErr& /*e*/) {
     return Vector3();
   }
 }
 
+Vector3 StereoModel::triangulate_rays(vector<Vector2> const& pixVec,
+                                      vector<Vector3> const& camDirs,
+                                      vector<Vector3> const& camCtrs,
+                                      Vector3& errorVec) const {
+
+  // Not enough valid rays
+  if (camDirs.size() < 2) 
+    return Vector3();
+
+  if (are_nearly_parallel(m_least_squares, m_angle_tol, camDirs)) 
+    return Vector3();
+
+  // Determine range by triangulation
+  Vector3 result = triangulate_point(camDirs, camCtrs, errorVec);
+  if ( m_least_squares ){
+    if (m_cameras.size() == 2)
+      refine_point(pixVec[0], pixVec[1], result);
+    else
+      vw::vw_throw(vw::NoImplErr() << "Least squares refinement is not "
+                   << "implemented for multi-view stereo.");
+  }
+  
+  // Reflect points that fall behind one of the two cameras
+  bool reflect = false;
+  for (int p = 0; p < (int)camCtrs.size(); p++)
+    if (dot_prod(result - camCtrs[p], camDirs[p]) < 0 ) reflect = true;
+  if (reflect)
+    result = -result + 2*camCtrs[0];
+
+  return result;
+}
+
 Vector3 StereoModel::operator()(vector<Vector2> const& pixVec,
                                 double& error) const {
   Vector3 errorVec;
@@ -304,6 +312,18 @@ StereoModel::operator()(ImageView<PixelMask<Vector2f> > const& disparity_map,
   ImageView<Vector3> xyz(disparity_map.cols(), disparity_map.rows());
   error.set_size(disparity_map.cols(), disparity_map.rows());
 
+  VW_ASSERT(m_cameras.size() == 2,
+            vw::ArgumentErr() << "StereoModel: triangulating a disparity map "
+            << "requires two cameras.\n");
+
+  // Per row workspace, the rays for a whole row of the disparity
+  // map are computed with one call into each camera model.
+  std::vector<int32  > row_cols;
+  std::vector<Vector2> left_pixels, right_pixels;
+  std::vector<Vector3> left_ctrs, left_dirs, right_ctrs, right_dirs;
+  vector<Vector2> pixVec(2);
+  vector<Vector3> camDirs, camCtrs;
+
   // Compute 3D position for each pixel in the disparity map
   vw_out() << "StereoModel: Applying camera models\n";
   for (int32 y = 0; y < disparity_map.rows(); y++) {
@@ -311,29 +331,60 @@ StereoModel::operator()(ImageView<PixelMask<Vector2f> > const& disparity_map,
       printf("\tStereoModel computing points: %0.2f%% complete.\r", 100.0f*float(y)/disparity_map.rows());
       fflush(stdout);
     }
+
+    // Collect the pixel pairs in this row which can be triangulated
+    row_cols.clear();
+    left_pixels.clear();
+    right_pixels.clear();
     for (int32 x = 0; x < disparity_map.cols(); x++) {
-      if ( is_valid(disparity_map(x,y)) ) {
-        xyz(x,y) = (*this)(Vector2( x, y),
-                           Vector2( x+disparity_map(x,y)[0],
-                                    y+disparity_map(x,y)[1]),
-                           error(x,y) );
-
-        if (error(x,y) >= 0) {
-          // Keep track of error statistics
-          if (error(x,y) > max_error)
-            max_error = error(x,y);
-          mean_error += error(x,y);
-            ++point_count;
-        } else {
-          // rays diverge or are parallel
-          xyz(x,y) = Vector3();
-          divergent++;
-        }
-      } else {
-        xyz(x,y) = Vector3();
-        error(x,y) = 0;
+      xyz  (x,y) = Vector3();
+      error(x,y) = 0;
+      if ( !is_valid(disparity_map(x,y)) )
+        continue;
+      Vector2 pix1( x, y);
+      Vector2 pix2( x+disparity_map(x,y)[0],
+                    y+disparity_map(x,y)[1]);
+      if (pix2 != pix2 || // i.e., NaN
+          pix2 == camera::CameraModel::invalid_pixel() ) {
+        ++point_count; // Not enough valid rays, counted with zero error
+        continue;
+      }
+      row_cols.push_back(x);
+      left_pixels.push_back (pix1);
+      right_pixels.push_back(pix2);
+    }
+    if (row_cols.empty())
+      continue;
+
+    m_cameras[0]->pixels_to_rays(left_pixels,  left_ctrs,  left_dirs );
+    m_cameras[1]->pixels_to_rays(right_pixels, right_ctrs, right_dirs);
+
+    for (size_t i = 0; i < row_cols.size(); i++) {
+      const int32 x = row_cols[i];
+
+      // Same as the single point operator() with the rays precomputed
+      camDirs.clear(); camCtrs.clear();
+      if (left_dirs[i] != Vector3() && right_dirs[i] != Vector3()) {
+        camDirs.push_back(left_dirs [i]); camCtrs.push_back(left_ctrs [i]);
+        camDirs.push_back(right_dirs[i]); camCtrs.push_back(right_ctrs[i]);
       }
+      pixVec[0] = left_pixels [i];
+      pixVec[1] = right_pixels[i];
+      Vector3 errorVec;
+      try {
+        xyz(x,y) = triangulate_rays(pixVec, camDirs, camCtrs, errorVec);
+      } catch (const camera::PixelToRayErr& /*e*/) {
+        xyz(x,y) = Vector3();
+        errorVec = Vector3();
       }
+      error(x,y) = norm_2(errorVec);
+
+      // Keep track of error statistics
+      if (error(x,y) > max_error)
+        max_error = error(x,y);
+      mean_error += error(x,y);
+      ++point_count;
+    }
   }
 
   if (divergent != 0)
@@ -20,6 +20,7 @@
 #define __VW_STEREO_STEREOMODEL_H__
 
 #include <vw/Math/Vector.h>
+#include <vector>
 
 namespace vw {
 
@@ -59,7 +60,8 @@ namespace stereo {
 
     /// Apply a stereo model to a disparity map to produce an image of
     /// XYZ points.  Missing pixels in the disparity map will result
-    /// in zero vector pixels in the point image.
+    /// in zero vector pixels in the point image.  The camera rays are
+    /// computed one row at a time with CameraModel::pixels_to_rays().
     ///
     /// Users really shouldn't use this method, the ideal method is
     /// the 'stereo_triangulate' in StereoView.h.
@@ -103,6 +105,14 @@ namespace stereo {
                                      std::vector<Vector3> const& camCtrs,
                                      Vector3& errorVec);
     
+    /// Triangulate from rays which were already computed for the
+    /// valid pixels in pixVec.  Returns a zero vector if there are not
+    /// enough rays or they are nearly parallel.
+    Vector3 triangulate_rays(std::vector<Vector2> const& pixVec,
+                             std::vector<Vector3> const& camDirs,
+                             std::vector<Vector3> const& camCtrs,
+                             Vector3& errorVec) const;
+
     static bool are_nearly_parallel(bool least_squares, double angle_tol,
                                     std::vector<Vector3> const& camDirs);
 
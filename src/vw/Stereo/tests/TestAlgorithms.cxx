@@ -172,3 +172,27 @@ TEST( AlgorithmsTest, FastBoxPixelU8 ) {
   EXPECT_VW_EQ( PixelGray<int16>(405), output(0,2) );
   EXPECT_VW_EQ( PixelGray<int16>(405), output(2,2) );
 }
+
+TEST( AlgorithmsTest, FastBoxReuseOutput ) {
+  ImageView<float> input(7,5);
+  for ( int r = 0; r < input.rows(); r++ )
+    for ( int c = 0; c < input.cols(); c++ )
+      input(c,r) = float(r*input.cols() + c + 1);
+
+  typedef AbsAccumulatorType<float>::type accum_type;
+
+  // The output is resized on the first call and then written in place
+  ImageView<accum_type> output;
+  fast_box_sum( input, Vector2i(5,3), output );
+  ASSERT_EQ( 3, output.cols() );
+  ASSERT_EQ( 3, output.rows() );
+  const accum_type* data = output.data();
+  EXPECT_EQ( 150, output(0,0) );
+  EXPECT_EQ( 390, output(2,2) );
+
+  input *= 2;
+  fast_box_sum( input, Vector2i(5,3), output );
+  EXPECT_EQ( data, output.data() );
+  EXPECT_EQ( 300, output(0,0) );
+  EXPECT_EQ( 780, output(2,2) );
+}
@@ -20,10 +20,12 @@
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/UtilityViews.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/Statistics.h>
 #include <vw/Stereo/CostFunctions.h>
 #include <vw/Stereo/Correlation.h>
 
 #include <boost/random/linear_congruential.hpp>
+#include <boost/foreach.hpp>
 
 using namespace vw;
 using namespace vw::stereo;
@@ -212,3 +214,38 @@ TEST_F( CorrelationU8, CrossCorrelation ) {
   ASSERT_TRUE( is_valid(disparity(10,10)) );
   CheckResult( disparity );
 }
+
+TEST( Correlation, SubdivideRegionsLargeTile ) {
+  // A large flat tile with one steep corner. The cost estimates of
+  // such a tile do not fit in 32 bits.
+  ImageView<PixelMask<Vector2i> > disparity(1024, 1024);
+  for ( int32 r = 0; r < disparity.rows(); r++ )
+    for ( int32 c = 0; c < disparity.cols(); c++ )
+      disparity(c,r) = PixelMask<Vector2i>(Vector2i(5,2));
+  for ( int32 r = 0; r < 128; r++ )
+    for ( int32 c = 0; c < 128; c++ )
+      disparity(c,r) = PixelMask<Vector2i>(Vector2i(2*c, r/8));
+
+  std::vector<SearchParam> zones;
+  subdivide_regions( disparity, bounding_box(disparity), zones, Vector2i(25,25) );
+  ASSERT_GT( zones.size(), 1u );
+
+  // The zones cover the tile exactly once and only the steep corner
+  // gets the wide search range.
+  ImageView<int32> coverage(disparity.cols(), disparity.rows());
+  fill( coverage, 0 );
+  double total_volume = 0;
+  BOOST_FOREACH( SearchParam const& zone, zones ) {
+    for ( int32 r = zone.image_region().min().y(); r < zone.image_region().max().y(); r++ )
+      for ( int32 c = zone.image_region().min().x(); c < zone.image_region().max().x(); c++ )
+        coverage(c,r)++;
+    total_volume += zone.search_volume();
+    if ( !zone.image_region().intersects( BBox2i(0,0,128,128) ) ) {
+      EXPECT_EQ( BBox2i(5,2,1,1), zone.disparity_range() );
+    }
+  }
+  EXPECT_EQ( 1, min_pixel_value(coverage) );
+  EXPECT_EQ( 1, max_pixel_value(coverage) );
+  SearchParam whole( bounding_box(disparity), BBox2i(0,0,256,16) );
+  EXPECT_LT( total_volume, 0.05*whole.search_volume() );
+}
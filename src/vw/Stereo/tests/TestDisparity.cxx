@@ -270,3 +270,146 @@ TEST( DisparityMap, DisparityFiltering ) {
   }
   EXPECT_EQ(INVALID_COUNT_ANS, invalid_count);
 }
+
+// Brute force versions of the windowed outlier filters, visiting every
+// window from scratch with constant edge extension.
+static PixelDisp clamped( ImageView<PixelDisp> const& im, int32 x, int32 y ) {
+  return im( std::min(std::max(x,0),im.cols()-1), std::min(std::max(y,0),im.rows()-1) );
+}
+
+static bool reject_using_mean( ImageView<PixelDisp> const& im, int32 x, int32 y,
+                               int32 hk, int32 vk, double max_diff ) {
+  std::vector<double> len;
+  for (int32 j = -vk; j <= vk; ++j)
+    for (int32 i = -hk; i <= hk; ++i) {
+      PixelDisp p = clamped(im, x+i, y+j);
+      if (is_valid(p))
+        len.push_back(std::abs(p[0]) + std::abs(p[1]));
+    }
+  std::sort(len.begin(), len.end());
+  double cutoff = 2.0*len[(int)(0.75*len.size())];
+  double mx = 0, my = 0, n = 0;
+  for (int32 j = -vk; j <= vk; ++j)
+    for (int32 i = -hk; i <= hk; ++i) {
+      PixelDisp p = clamped(im, x+i, y+j);
+      if (is_valid(p) && std::abs(p[0]) + std::abs(p[1]) <= cutoff) {
+        mx += p[0]; my += p[1]; ++n;
+      }
+    }
+  mx /= n; my /= n;
+  return (im(x,y)[0]-mx)*(im(x,y)[0]-mx) + (im(x,y)[1]-my)*(im(x,y)[1]-my) > max_diff*max_diff;
+}
+
+static bool reject_using_stddev( ImageView<PixelDisp> const& im, int32 x, int32 y,
+                                 int32 hk, int32 vk, double pixel_thresh, double rejection_thresh ) {
+  double mx = 0, my = 0, sx = 0, sy = 0, n = 0;
+  for (int32 j = -vk; j <= vk; ++j)
+    for (int32 i = -hk; i <= hk; ++i) {
+      PixelDisp p = clamped(im, x+i, y+j);
+      if (is_valid(p)) { mx += p[0]; my += p[1]; ++n; }
+    }
+  mx /= n; my /= n;
+  for (int32 j = -vk; j <= vk; ++j)
+    for (int32 i = -hk; i <= hk; ++i) {
+      PixelDisp p = clamped(im, x+i, y+j);
+      if (is_valid(p)) { sx += (p[0]-mx)*(p[0]-mx); sy += (p[1]-my)*(p[1]-my); }
+    }
+  sx = std::max(sqrt(sx/n), rejection_thresh);
+  sy = std::max(sqrt(sy/n), rejection_thresh);
+  return std::abs(im(x,y)[0]-mx) > pixel_thresh*sx || std::abs(im(x,y)[1]-my) > pixel_thresh*sy;
+}
+
+TEST( DisparityMap, WindowedOutlierFilters ) {
+  // A smooth disparity with noise, holes and a few gross outliers.
+  ImageView<PixelDisp> map(37,29);
+  int32 seed = 7;
+  for (int32 y = 0; y < map.rows(); ++y)
+    for (int32 x = 0; x < map.cols(); ++x) {
+      seed = (seed*1103515245 + 12345) & 0x7fffffff;
+      float noise = float(seed % 1000)/250.0f - 2.0f;
+      map(x,y) = PixelDisp(Vector2f(20 + 0.3*x + noise, -5 + 0.2*y - noise/2));
+      if (seed % 11 == 0)
+        map(x,y).invalidate();
+      if (seed % 29 == 0)
+        map(x,y) = PixelDisp(Vector2f(900, -700));
+    }
+
+  ImageView<PixelDisp> by_mean   = rm_outliers_using_mean  (map, 3, 2, 2.5);
+  ImageView<PixelDisp> by_stddev = rm_outliers_using_stddev(map, 2, 3, 1.5, 0.5);
+  int32 rejected_mean = 0, rejected_stddev = 0;
+  for (int32 y = 0; y < map.rows(); ++y)
+    for (int32 x = 0; x < map.cols(); ++x) {
+      if (!is_valid(map(x,y))) {
+        EXPECT_FALSE(is_valid(by_mean(x,y)));
+        EXPECT_FALSE(is_valid(by_stddev(x,y)));
+        continue;
+      }
+      bool mean_rejects   = reject_using_mean  (map, x, y, 3, 2, 2.5);
+      bool stddev_rejects = reject_using_stddev(map, x, y, 2, 3, 1.5, 0.5);
+      rejected_mean   += mean_rejects;
+      rejected_stddev += stddev_rejects;
+      EXPECT_EQ(mean_rejects,   !is_valid(by_mean  (x,y))) << x << "," << y;
+      EXPECT_EQ(stddev_rejects, !is_valid(by_stddev(x,y))) << x << "," << y;
+      if (!mean_rejects) {
+        EXPECT_VECTOR_EQ(map(x,y).child(), by_mean(x,y).child());
+      }
+    }
+  // Make sure the test exercises both outcomes.
+  EXPECT_GT(rejected_mean,   0);
+  EXPECT_GT(rejected_stddev, 0);
+  EXPECT_LT(rejected_mean,   map.cols()*map.rows()/2);
+  EXPECT_LT(rejected_stddev, map.cols()*map.rows()/2);
+}
+
+TEST( DisparityMap, FusedDisparityFilter ) {
+  ImageView<PixelDisp> map(41,33);
+  int32 seed = 11;
+  for (int32 y = 0; y < map.rows(); ++y)
+    for (int32 x = 0; x < map.cols(); ++x) {
+      seed = (seed*1103515245 + 12345) & 0x7fffffff;
+      float noise = float(seed % 1000)/250.0f - 2.0f;
+      map(x,y) = PixelDisp(Vector2f(20 + 0.3*x + noise, -5 + 0.2*y - noise/2));
+      if (seed % 11 == 0)
+        map(x,y).invalidate();
+      if (seed % 29 == 0)
+        map(x,y) = PixelDisp(Vector2f(900, -700));
+    }
+
+  std::vector<DisparityFilterSpec> filters;
+  filters.push_back(DisparityFilterSpec(DisparityFilterSpec::THRESH, 2, 2, 3.0, 0.3));
+  filters.push_back(DisparityFilterSpec(DisparityFilterSpec::MEAN,   3, 2, 2.5));
+  filters.push_back(DisparityFilterSpec(DisparityFilterSpec::STDDEV, 2, 3, 1.5, 0.5));
+
+  // Must match nesting the individual filters, also near the borders
+  // and across tile boundaries.
+  ImageView<PixelDisp> nested =
+    rm_outliers_using_stddev(rm_outliers_using_mean(rm_outliers_using_thresh(map, 2, 2, 3.0, 0.3),
+                                                    3, 2, 2.5),
+                             2, 3, 1.5, 0.5);
+  FusedDisparityFilterView<ImageView<PixelDisp> > fused_view = fused_disparity_filter(map, filters);
+  ImageView<PixelDisp> fused(map.cols(), map.rows());
+  for (int32 y = 0; y < map.rows(); y += 16)
+    for (int32 x = 0; x < map.cols(); x += 16) {
+      BBox2i tile(x, y, std::min(16, map.cols()-x), std::min(16, map.rows()-y));
+      crop(fused, tile) = crop(fused_view, tile);
+    }
+
+  int32 valid = 0;
+  for (int32 y = 0; y < map.rows(); ++y)
+    for (int32 x = 0; x < map.cols(); ++x) {
+      ASSERT_EQ(is_valid(nested(x,y)), is_valid(fused(x,y))) << x << "," << y;
+      if (is_valid(nested(x,y))) {
+        EXPECT_VECTOR_EQ(nested(x,y).child(), fused(x,y).child());
+        ++valid;
+      }
+    }
+  EXPECT_GT(valid, 0);
+
+  // Every stage reports its own rejections
+  FusedDisparityFilterFunc<PixelDisp> const& func = fused_view.func();
+  ASSERT_EQ(3u, func.num_stages());
+  for (size_t i = 0; i < func.num_stages(); ++i) {
+    EXPECT_GT(func.rejected_points(i), 0);
+    EXPECT_GE(func.total_points(i), map.cols()*map.rows());
+  }
+}
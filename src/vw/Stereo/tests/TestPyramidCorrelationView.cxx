@@ -409,3 +409,112 @@ TEST_F( PyramidViewU8, NullPreprocess ) {
   ASSERT_EQ( input1.rows(), disparity_map.rows() );
   check_error( disparity_map, .90, .990, "Cross Correlation" );
 }
+
+// The single pass consistency check should remove about as much as the reverse SGM run.
+TEST_F( PyramidViewU8, SGMSinglePassConsistency ) {
+  ImageView<uint8> mask1 = constant_view(uint8(255), input1);
+  ImageView<uint8> mask2 = constant_view(uint8(255), input2);
+  PyramidCorrelationView<image_type, image_type, ImageView<uint8>, ImageView<uint8> > view =
+    pyramid_correlate( input1, input2, mask1, mask2,
+                       PREFILTER_NONE, 0,
+                       search_volume, Vector2i(5,5),
+                       CENSUS_TRANSFORM,
+                       corr_timeout, seconds_per_op,
+                       2, 0, filter_radius, max_levels,
+                       VW_CORRELATION_SGM, 0, SemiGlobalMatcher::SUBPIXEL_NONE );
+  ImageView<PixelMask<Vector2i> > two_pass = view;
+  check_error( two_pass, .85, .95, "SGM two pass" );
+
+  view.set_sgm_single_pass_consistency(true);
+  ImageView<PixelMask<Vector2i> > single_pass = view;
+  ASSERT_EQ( two_pass.cols(), single_pass.cols() );
+  ASSERT_EQ( two_pass.rows(), single_pass.rows() );
+  check_error( single_pass, .85, .95, "SGM single pass" );
+
+  int64 num_two_pass = 0, num_single_pass = 0;
+  for ( int32 j = 0; j < two_pass.rows(); ++j )
+    for ( int32 i = 0; i < two_pass.cols(); ++i ) {
+      num_two_pass    += is_valid( two_pass   (i,j) );
+      num_single_pass += is_valid( single_pass(i,j) );
+    }
+  EXPECT_NEAR( double(num_single_pass)/double(num_two_pass), 1.0, 0.02 );
+}
+
+TEST_F( PyramidViewU8, SGMMatcherPool ) {
+  ImageView<uint8> mask1 = constant_view(uint8(255), input1);
+  ImageView<uint8> mask2 = constant_view(uint8(255), input2);
+  PyramidCorrelationView<image_type, image_type, ImageView<uint8>, ImageView<uint8> > view =
+    pyramid_correlate( input1, input2, mask1, mask2,
+                       PREFILTER_NONE, 0,
+                       search_volume, Vector2i(5,5),
+                       CENSUS_TRANSFORM,
+                       corr_timeout, seconds_per_op,
+                       2, 0, filter_radius, max_levels,
+                       VW_CORRELATION_SGM, 0, SemiGlobalMatcher::SUBPIXEL_NONE );
+  ImageView<PixelMask<Vector2i> > unpooled = view;
+
+  // The second tile gets the matcher, and buffers, of the first one.
+  boost::shared_ptr<SemiGlobalMatcherPool> pool(new SemiGlobalMatcherPool(1));
+  view.set_sgm_matcher_pool(pool);
+  ImageView<PixelMask<Vector2i> > first  = view;
+  EXPECT_EQ( 1u, pool->num_idle() );
+  ImageView<PixelMask<Vector2i> > second = view;
+  EXPECT_EQ( 1u, pool->num_idle() );
+
+  ASSERT_EQ( unpooled.cols(), second.cols() );
+  ASSERT_EQ( unpooled.rows(), second.rows() );
+  for ( int32 j = 0; j < unpooled.rows(); ++j )
+    for ( int32 i = 0; i < unpooled.cols(); ++i ) {
+      EXPECT_EQ( unpooled(i,j), first (i,j) );
+      EXPECT_EQ( unpooled(i,j), second(i,j) );
+    }
+  pool->clear();
+  EXPECT_EQ( 0u, pool->num_idle() );
+}
+
+TEST_F( PyramidViewGRAYU8, DisparityStatistics ) {
+  ImageView<uint8> mask1 = constant_view(uint8(255), input1);
+  ImageView<uint8> mask2 = constant_view(uint8(255), input2);
+  PyramidCorrelationView<image_type, image_type, ImageView<uint8>, ImageView<uint8> > view =
+    pyramid_correlate( input1, input2, mask1, mask2,
+                       PREFILTER_NONE, 0,
+                       search_volume, kernel_size,
+                       ABSOLUTE_DIFFERENCE,
+                       corr_timeout, seconds_per_op,
+                       2, 0, filter_radius, max_levels,
+                       VW_CORRELATION_BM, 8 );
+  boost::shared_ptr<DisparityStatistics> stats(new DisparityStatistics(search_volume, 64));
+  view.set_disparity_statistics(stats);
+  ImageView<PixelMask<Vector2f> > disparity = block_rasterize(view, Vector2i(64,64), 1);
+
+  // Tiles are counted once each, without their collars.
+  BBox2f range = get_disparity_range(disparity);
+  EXPECT_EQ( range, stats->disparity_range() );
+  EXPECT_EQ( uint64(disparity.cols())*disparity.rows(), stats->total_count() );
+  uint64 valid = 0;
+  for ( int32 j = 0; j < disparity.rows(); ++j )
+    for ( int32 i = 0; i < disparity.cols(); ++i )
+      if ( is_valid(disparity(i,j)) )
+        ++valid;
+  EXPECT_GT( valid, 0u );
+  EXPECT_EQ( valid, stats->valid_count() );
+
+  uint64 hist_x = 0, hist_y = 0;
+  std::vector<uint64> hx = stats->histogram_x(), hy = stats->histogram_y();
+  for ( size_t i = 0; i < hx.size(); ++i ) {
+    hist_x += hx[i];
+    hist_y += hy[i];
+  }
+  EXPECT_EQ( valid, hist_x );
+  EXPECT_EQ( valid, hist_y );
+
+  // The quantiles are resolved to a bin width.
+  float bin_width = search_volume.width() / 64.0;
+  EXPECT_GE( stats->quantile_x(1.0), range.max()[0] );
+  EXPECT_LE( stats->quantile_x(1.0), range.max()[0] + bin_width );
+  EXPECT_GE( stats->quantile_y(0.0), range.min()[1] );
+
+  stats->reset();
+  EXPECT_EQ( 0u, stats->total_count() );
+  EXPECT_EQ( BBox2f(0,0,0,0), stats->disparity_range() );
+}
@@ -24,6 +24,28 @@
 using namespace vw;
 using namespace vw::stereo;
 
+// A textured right image, and a left image of width x height which is
+// the right one shifted by shift.  The right image is margin larger.
+struct ShiftedPair {
+  ImageView<uint8> left, right;
+};
+
+static ShiftedPair shifted_texture( int width, int height, Vector2i const& shift, Vector2i const& margin ) {
+  ShiftedPair pair;
+  pair.right.set_size(width+margin[0], height+margin[1]);
+  for (int row=0; row<pair.right.rows(); ++row) {
+    for (int col=0; col<pair.right.cols(); ++col) {
+      uint32 h = uint32(col)*2654435761u ^ uint32(row)*40503u;
+      pair.right(col,row) = uint8((h >> 13) ^ (h >> 5));
+    }
+  }
+  pair.left.set_size(width, height);
+  for (int row=0; row<height; ++row)
+    for (int col=0; col<width; ++col)
+      pair.left(col,row) = pair.right(col+shift[0], row+shift[1]);
+  return pair;
+}
+
 TEST( SGM, constant_offset ) {
  
   // For this perfect test case, the correct disparity is (2,1) for each pixel!
@@ -73,3 +95,298 @@ TEST( SGM, constant_offset ) {
   EXPECT_GT(percent_correct, 0.99);
 }
 
+// Every evaluate_path() width the CPU supports must give the same answer.
+TEST( SGM, path_simd_widths ) {
+
+  const int width = 160, height = 120;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(3,1), Vector2i(8,8));
+
+  SemiGlobalMatcher matcher(CENSUS_TRANSFORM, false, 0, 0, 8, 8, 3,
+                            SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+  SemiGlobalMatcher::DisparityImage reference;
+  for (int simd_width=1; simd_width<=SemiGlobalMatcher::max_path_simd_width(); simd_width*=2) {
+    matcher.set_path_simd_width(simd_width);
+    if (matcher.path_simd_width() != simd_width)
+      continue;
+
+    SemiGlobalMatcher::DisparityImage result = matcher.semi_global_matching_func(pair.left, pair.right);
+
+    if (reference.cols() == 0) {
+      reference = result;
+      EXPECT_EQ(Vector2i(3,1), reference(width/2, height/2).child());
+      continue;
+    }
+    ASSERT_EQ(reference.cols(), result.cols());
+    ASSERT_EQ(reference.rows(), result.rows());
+    for (int row=0; row<result.rows(); ++row)
+      for (int col=0; col<result.cols(); ++col)
+        EXPECT_EQ(reference(col,row), result(col,row)) << col << ", " << row;
+  }
+}
+
+// Processing in strips should match processing the whole image.
+TEST( SGM, strip_mode ) {
+
+  // A textured image and a noisy copy shifted by (3,1)
+  const int width = 90, height = 100;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(3,1), Vector2i(8,8));
+  ImageView<uint8> &left = pair.left, &right = pair.right;
+  for (int row=0; row<height; ++row)
+    for (int col=0; col<width; ++col)
+      left(col,row) += uint8((col*row) % 5);
+
+  SemiGlobalMatcher matcher(CENSUS_TRANSFORM, false, 0, 0, 8, 8, 5,
+                            SemiGlobalMatcher::SUBPIXEL_LC_BLEND, Vector2i(2,2), 1024);
+  SemiGlobalMatcher::DisparityImage whole = matcher.semi_global_matching_func(left, right);
+  ImageView<PixelMask<Vector2f> > whole_subpixel = matcher.create_disparity_view_subpixel(whole);
+
+  // With an overlap reaching the bottom of the image every path is complete,
+  //  so the downward paths carried between strips must give an identical result.
+  matcher.set_strip_mode(17, height);
+  SemiGlobalMatcher::DisparityImage strips = matcher.semi_global_matching_func(left, right);
+  ImageView<PixelMask<Vector2f> > strips_subpixel = matcher.create_disparity_view_subpixel(strips);
+  ASSERT_EQ(whole.cols(), strips.cols());
+  ASSERT_EQ(whole.rows(), strips.rows());
+  for (int row=0; row<whole.rows(); ++row) {
+    for (int col=0; col<whole.cols(); ++col) {
+      EXPECT_EQ(whole(col,row), strips(col,row)) << col << ", " << row;
+      EXPECT_VECTOR_NEAR(whole_subpixel(col,row).child(), strips_subpixel(col,row).child(), 1e-6);
+    }
+  }
+
+  // With a short overlap the upward paths are cut off, but the result is still close.
+  matcher.set_strip_mode(17, 8);
+  strips = matcher.semi_global_matching_func(left, right);
+  int num_same = 0;
+  for (int row=0; row<whole.rows(); ++row)
+    for (int col=0; col<whole.cols(); ++col)
+      if (whole(col,row) == strips(col,row))
+        ++num_same;
+  EXPECT_GT(double(num_same) / double(whole.cols()*whole.rows()), 0.98);
+}
+
+// The confidence should separate matching regions from unmatched ones.
+TEST( SGM, confidence ) {
+
+  // A textured image shifted by (3,1), with a band on the right that has no match.
+  const int width = 120, height = 80, band_start = 80;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(3,1), Vector2i(8,8));
+  ImageView<uint8> &left = pair.left, &right = pair.right;
+  for (int row=0; row<height; ++row) {
+    for (int col=band_start; col<width; ++col) {
+      uint32 h = uint32(col)*2246822519u ^ uint32(row)*3266489917u;
+      left(col,row) = uint8((h >> 11) ^ (h >> 3));
+    }
+  }
+
+  SemiGlobalMatcher matcher(CENSUS_TRANSFORM, false, 0, 0, 8, 8, 3,
+                            SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+  matcher.set_compute_confidence(true);
+  SemiGlobalMatcher::DisparityImage disparity = matcher.semi_global_matching_func(left, right);
+  ImageView<float> confidence = matcher.confidence_image();
+  ASSERT_EQ(disparity.cols(), confidence.cols());
+  ASSERT_EQ(disparity.rows(), confidence.rows());
+
+  double matched_sum = 0, unmatched_sum = 0;
+  int    num_matched = 0, num_unmatched = 0;
+  for (int row=10; row<confidence.rows()-10; ++row) {
+    for (int col=10; col<confidence.cols()-10; ++col) {
+      EXPECT_GE(confidence(col,row), 0.0f);
+      EXPECT_LE(confidence(col,row), 1.0f);
+      if (col < band_start-10) {
+        matched_sum += confidence(col,row);
+        ++num_matched;
+      }
+      if (col > band_start+10) {
+        unmatched_sum += confidence(col,row);
+        ++num_unmatched;
+      }
+    }
+  }
+  const double matched_mean   = matched_sum   / num_matched;
+  const double unmatched_mean = unmatched_sum / num_unmatched;
+  EXPECT_NEAR(1.0, matched_mean, 0.05);
+  EXPECT_LT(unmatched_mean, 0.5*matched_mean);
+
+  // Filtering on the confidence keeps the matched region.
+  invalidate_low_confidence(disparity, confidence, 0.5*matched_mean);
+  EXPECT_TRUE(is_valid(disparity(band_start/2, height/2)));
+
+  // Strip mode assembles the same confidence image.
+  matcher.set_strip_mode(23, height);
+  matcher.semi_global_matching_func(left, right);
+  ImageView<float> strip_confidence = matcher.confidence_image();
+  ASSERT_EQ(confidence.cols(), strip_confidence.cols());
+  ASSERT_EQ(confidence.rows(), strip_confidence.rows());
+  for (int row=0; row<confidence.rows(); ++row)
+    for (int col=0; col<confidence.cols(); ++col)
+      EXPECT_FLOAT_EQ(confidence(col,row), strip_confidence(col,row)) << col << ", " << row;
+}
+
+// The right to left disparity from the same costs should agree with the left to right result.
+TEST( SGM, right_disparity ) {
+
+  // A textured image and a copy shifted by (3,1)
+  const int width = 100, height = 70;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(3,1), Vector2i(8,8));
+  ImageView<uint8> &left = pair.left, &right = pair.right;
+
+  SemiGlobalMatcher matcher(CENSUS_TRANSFORM, false, 0, 0, 8, 8, 3,
+                            SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+  matcher.set_compute_right_disparity(true);
+  SemiGlobalMatcher::DisparityImage disparity = matcher.semi_global_matching_func(left, right);
+  SemiGlobalMatcher::DisparityImage right_disparity = matcher.right_disparity_image();
+  ASSERT_EQ(disparity.cols()+8, right_disparity.cols());
+  ASSERT_EQ(disparity.rows()+8, right_disparity.rows());
+
+  EXPECT_EQ(Vector2i(-3,-1), right_disparity(width/2, height/2).child());
+
+  // Nearly every left pixel should pass the consistency check.
+  int num_consistent = 0;
+  for (int row=0; row<disparity.rows(); ++row) {
+    for (int col=0; col<disparity.cols(); ++col) {
+      Vector2i d = disparity(col,row).child();
+      PixelMask<Vector2i> back = right_disparity(col+d[0], row+d[1]);
+      if (is_valid(back) && (back.child() == -d))
+        ++num_consistent;
+    }
+  }
+  EXPECT_GT(double(num_consistent) / double(disparity.cols()*disparity.rows()), 0.98);
+
+  // Strips with enough overlap assemble the same image.
+  matcher.set_strip_mode(19, height);
+  matcher.semi_global_matching_func(left, right);
+  SemiGlobalMatcher::DisparityImage strip_right = matcher.right_disparity_image();
+  ASSERT_EQ(right_disparity.cols(), strip_right.cols());
+  ASSERT_EQ(right_disparity.rows(), strip_right.rows());
+  for (int row=0; row<strip_right.rows(); ++row)
+    for (int col=0; col<strip_right.cols(); ++col)
+      EXPECT_EQ(right_disparity(col,row), strip_right(col,row)) << col << ", " << row;
+}
+
+// A search range with a single row of disparities uses evaluate_path_1d().
+TEST( SGM, rectified ) {
+
+  // A textured image and a copy shifted by (5,0)
+  const int width = 120, height = 60;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(5,0), Vector2i(12,0));
+  ImageView<uint8> &left = pair.left, &right = pair.right;
+
+  for (int use_mgm=0; use_mgm<2; ++use_mgm) {
+    SemiGlobalMatcher matcher(CENSUS_TRANSFORM, use_mgm, 0, 0, 12, 0, 3,
+                              SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+    SemiGlobalMatcher::DisparityImage disparity = matcher.semi_global_matching_func(left, right);
+    int num_correct = 0;
+    for (int row=0; row<disparity.rows(); ++row)
+      for (int col=0; col<disparity.cols(); ++col)
+        if (is_valid(disparity(col,row)) && (disparity(col,row).child() == Vector2i(5,0)))
+          ++num_correct;
+    EXPECT_GT(double(num_correct) / double(disparity.cols()*disparity.rows()), 0.98) << use_mgm;
+  }
+}
+
+// Four path accumulation should still find a simple shift.
+TEST( SGM, four_paths ) {
+
+  // A textured image and a copy shifted by (3,1)
+  const int width = 120, height = 80;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(3,1), Vector2i(8,8));
+  ImageView<uint8> &left = pair.left, &right = pair.right;
+
+  SemiGlobalMatcher matcher(CENSUS_TRANSFORM, false, 0, 0, 8, 8, 3,
+                            SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+  EXPECT_EQ(8, matcher.num_paths());
+  EXPECT_THROW(matcher.set_num_paths(2), ArgumentErr);
+  matcher.set_num_paths(4);
+  SemiGlobalMatcher::DisparityImage disparity = matcher.semi_global_matching_func(left, right);
+  int num_correct = 0;
+  for (int row=0; row<disparity.rows(); ++row)
+    for (int col=0; col<disparity.cols(); ++col)
+      if (is_valid(disparity(col,row)) && (disparity(col,row).child() == Vector2i(3,1)))
+        ++num_correct;
+  EXPECT_GT(double(num_correct) / double(disparity.cols()*disparity.rows()), 0.98);
+}
+
+TEST( SGM, compressed_accumulation ) {
+
+  // A textured image and a noisy copy with a disparity that changes across the image
+  const int width = 120, height = 80;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(3,1), Vector2i(12,8));
+  ImageView<uint8> &left = pair.left, &right = pair.right;
+  for (int row=0; row<height; ++row) {
+    for (int col=0; col<width; ++col) {
+      uint32 h = uint32(col*7 + row*13)*2246822519u;
+      int noise = int((h >> 27) % 9) - 4;
+      int dx    = (col < width/2) ? 3 : 8;
+      left(col,row) = uint8(std::max(0, std::min(255, int(right(col+dx, row+1)) + noise)));
+    }
+  }
+
+  for (int mgm=0; mgm<2; ++mgm) {
+    SemiGlobalMatcher matcher(CENSUS_TRANSFORM, mgm==1, 0, 0, 12, 8, 3,
+                              SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+    SemiGlobalMatcher::DisparityImage exact = matcher.semi_global_matching_func(left, right);
+
+    EXPECT_THROW(matcher.set_compressed_accumulation(true, 8), ArgumentErr);
+    matcher.set_compressed_accumulation(true);
+    EXPECT_TRUE(matcher.compressed_accumulation());
+    SemiGlobalMatcher::DisparityImage compressed = matcher.semi_global_matching_func(left, right);
+    ASSERT_EQ(exact.cols(), compressed.cols());
+    ASSERT_EQ(exact.rows(), compressed.rows());
+
+    int num_same = 0, num_correct = 0;
+    for (int row=0; row<exact.rows(); ++row) {
+      for (int col=0; col<exact.cols(); ++col) {
+        if (is_valid(exact(col,row)) == is_valid(compressed(col,row)) &&
+            (exact(col,row).child() == compressed(col,row).child()))
+          ++num_same;
+        Vector2i truth((col < width/2) ? 3 : 8, 1);
+        if (is_valid(compressed(col,row)) && (compressed(col,row).child() == truth))
+          ++num_correct;
+      }
+    }
+    const double num_pixels = exact.cols()*exact.rows();
+    EXPECT_GT(num_same    / num_pixels, 0.98);
+    EXPECT_GT(num_correct / num_pixels, 0.95);
+  }
+}
+
+TEST( SGM, buffer_reuse ) {
+
+  // A textured image and a copy shifted by (3,1)
+  const int width = 120, height = 80;
+  ShiftedPair pair = shifted_texture(width, height, Vector2i(3,1), Vector2i(8,8));
+  ImageView<uint8> &left = pair.left, &right = pair.right;
+  ImageView<uint8> left_small  = crop(left,  0, 0, width/2, height/2);
+  ImageView<uint8> right_small = crop(right, 0, 0, width/2+8, height/2+8);
+
+  // Large, then small in the same buffers, then large again, with each
+  //  result identical to that of a new matcher.
+  SemiGlobalMatcher matcher(CENSUS_TRANSFORM, false, 0, 0, 8, 8, 3,
+                            SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+  for (int pass=0; pass<3; ++pass) {
+    ImageView<uint8> const& l = (pass == 1) ? left_small  : left;
+    ImageView<uint8> const& r = (pass == 1) ? right_small : right;
+    SemiGlobalMatcher::DisparityImage reused = matcher.semi_global_matching_func(l, r);
+    SemiGlobalMatcher fresh(CENSUS_TRANSFORM, false, 0, 0, 8, 8, 3,
+                            SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 1024);
+    SemiGlobalMatcher::DisparityImage expected = fresh.semi_global_matching_func(l, r);
+    ASSERT_EQ(expected.cols(), reused.cols());
+    ASSERT_EQ(expected.rows(), reused.rows());
+    for (int row=0; row<expected.rows(); ++row)
+      for (int col=0; col<expected.cols(); ++col)
+        EXPECT_EQ(expected(col,row), reused(col,row));
+  }
+  matcher.release_buffers();
+
+  // The pool hands back the matcher released for the same tile size only.
+  SemiGlobalMatcherPool pool(1);
+  SemiGlobalMatcherPool::MatcherPtr a = pool.acquire(Vector2i(64,64));
+  SemiGlobalMatcher* a_raw = a.get();
+  pool.release(Vector2i(64,64), a);
+  EXPECT_FALSE(a);
+  EXPECT_EQ(1u, pool.num_idle());
+  EXPECT_NE(a_raw, pool.acquire(Vector2i(32,32)).get());
+  EXPECT_EQ(a_raw, pool.acquire(Vector2i(64,64)).get());
+  EXPECT_EQ(0u, pool.num_idle());
+}
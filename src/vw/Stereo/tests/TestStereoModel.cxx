@@ -108,6 +108,46 @@ TEST( StereoModel, AdjustedStereo ) {
   }
 }
 
+TEST( StereoModel, DisparityImage ) {
+  boost::shared_ptr<CameraModel> pin1(new camera::PinholeModel( Vector3(), math::identity_matrix<3>(), 10, 10, 5, 5));
+  boost::shared_ptr<CameraModel> pin2(new camera::PinholeModel( Vector3(1,0,0), math::identity_matrix<3>(), 10, 10, 5, 5));
+  camera::AdjustedCameraModel adj1(pin1);
+  camera::AdjustedCameraModel adj2(pin2);
+  adj1.set_rotation(euler_to_quaternion(M_PI/80, M_PI/120, M_PI/150, "xyz"));
+  adj2.set_translation(Vector3(0.1, 0.04, 0.123));
+
+  ImageView<PixelMask<Vector2f> > disparity(6,4);
+  for (int row = 0; row < disparity.rows(); row++)
+    for (int col = 0; col < disparity.cols(); col++)
+      disparity(col,row) = PixelMask<Vector2f>( Vector2f(-2-0.3*col, 0.1*row) );
+  invalidate(disparity(2,1));
+  disparity(3,2)[0] = std::numeric_limits<float>::quiet_NaN();
+
+  // The whole image version must agree with triangulating each pixel.
+  for (int lsq = 0; lsq < 2; lsq++) {
+    StereoModel st(&adj1, &adj2, lsq == 1);
+    ImageView<double> error;
+    ImageView<Vector3> points = st(disparity, error);
+    ASSERT_EQ(disparity.cols(), points.cols());
+    ASSERT_EQ(disparity.rows(), error.rows());
+    for (int row = 0; row < disparity.rows(); row++) {
+      for (int col = 0; col < disparity.cols(); col++) {
+        Vector3 expected;
+        double expected_error = 0;
+        if (is_valid(disparity(col,row)))
+          expected = st(Vector2(col,row),
+                        Vector2(col+disparity(col,row)[0], row+disparity(col,row)[1]),
+                        expected_error);
+        EXPECT_VECTOR_EQ(expected, points(col,row));
+        EXPECT_DOUBLE_EQ(expected_error, error(col,row));
+      }
+    }
+    EXPECT_VECTOR_EQ(Vector3(), points(2,1));
+    EXPECT_VECTOR_EQ(Vector3(), points(3,2));
+    EXPECT_NE(Vector3(), points(0,0));
+  }
+}
+
 TEST( StereoView, PixelMaskVec2 ) {
   Vector3 pos1, pos2;
   pos2 = Vector3(1,0,0);
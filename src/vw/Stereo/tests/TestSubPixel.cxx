@@ -26,6 +26,7 @@
 #include <vw/Stereo/ParabolaSubpixelView.h>
 #include <vw/Stereo/PhaseSubpixelView.h>
 #include <vw/Stereo/SubpixelView.h>
+#include <vw/Stereo/EMSubpixelCorrelatorView.h>
 #include <boost/foreach.hpp>
 #include <boost/random/linear_congruential.hpp>
 
@@ -403,6 +404,50 @@ TEST_F( SubPixelCorrelate70Test, BayesEM70 ) {
   EXPECT_LE(invalid_count, 48);
   //EXPECT_TRUE(false);
 }
+
+// Testing the EM Subpixel Correlator View
+//--------------------------------------------------------------
+TEST( EMSubpixelCorrelator, ThreadsMatchSerial ) {
+  // A smooth pattern, shifted by a fraction of a pixel
+  ImageView<float> image1(32,32);
+  for ( int32 j = 0; j < image1.rows(); j++ )
+    for ( int32 i = 0; i < image1.cols(); i++ )
+      image1(i,j) = 0.5 + 0.25*sin(0.37*i + 0.21*j) + 0.2*cos(0.02*i*j + 0.5*j);
+  ImageView<float> image2 =
+    crop(transform(edge_extend(image1), TranslateTransform(-1.3, -0.4)), bounding_box(image1));
+  ImageView<PixelMask<Vector2f> > starting_disp(image1.cols(), image1.rows());
+  fill(starting_disp, PixelMask<Vector2f>(Vector2f(1,0)));
+
+  typedef EMSubpixelCorrelatorView<float>::pixel_type result_type;
+  ImageView<result_type> serial, threaded;
+  {
+    EMSubpixelCorrelatorView<float> correlator(image1, image2, starting_disp);
+    correlator.set_kernel_size(Vector2i(11,11));
+    correlator.set_pyramid_levels(2);
+    correlator.set_num_threads(1);
+    serial = correlator;
+  }
+  {
+    EMSubpixelCorrelatorView<float> correlator(image1, image2, starting_disp);
+    correlator.set_kernel_size(Vector2i(11,11));
+    correlator.set_pyramid_levels(2);
+    correlator.set_num_threads(3);
+    threaded = correlator;
+  }
+
+  // Each pixel is refined on its own, so the rows may be shared
+  // between threads without changing the result.
+  int32 valid_count = 0;
+  for ( int32 j = 0; j < serial.rows(); j++ )
+    for ( int32 i = 0; i < serial.cols(); i++ ) {
+      ASSERT_EQ( is_valid(serial(i,j)), is_valid(threaded(i,j)) );
+      if ( !is_valid(serial(i,j)) )
+        continue;
+      EXPECT_VECTOR_NEAR( serial(i,j).child(), threaded(i,j).child(), 1e-6 );
+      valid_count++;
+    }
+  EXPECT_GT( valid_count, 0 );
+}
 /*
 TEST( SlipTest, Affine ) {
   
@@ -22,6 +22,7 @@
 #pragma warning(disable:4996)
 #endif
 
+#include <vw/config.h>
 #include <vw/Core/Log.h>
 #include <vw/Math/BBox.h>
 #include <vw/Math/Vector.h>
@@ -30,6 +31,10 @@
 #include <vw/Image/ImageIO.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/FileIO/DiskImageView.h>
+#include <vw/FileIO/DiskImageResource.h>
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+#include <vw/FileIO/DiskImageResourceGDAL.h>
+#endif
 #include <vw/Mosaic/QuadTreeGenerator.h>
 #include <vw/Mosaic/ImageComposite.h>
 
@@ -38,6 +43,8 @@
 #include <sys/stat.h>
 
 #include <boost/operators.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 #include <boost/filesystem/path.hpp>
@@ -51,14 +58,39 @@ using namespace vw;
 
 std::string mosaic_name;
 std::string file_type;
+std::string compress;
 int tile_size;
+int num_threads;
 bool draft;
 bool qtree;
 
+// Writes the composite to disk in tiles, blended on num_threads
+// threads, so only the tiles in flight and the cache are in memory.
+// GeoTIFF output is tiled and compressed.
+template <class ImageT>
+void block_write_file( std::string const& filename, ImageViewBase<ImageT> const& image ) {
+  boost::scoped_ptr<DiskImageResource> r;
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+  if( boost::iequals( file_type, "tif" ) || boost::iequals( file_type, "tiff" ) ) {
+    DiskImageResourceGDAL::Options options;
+    options["COMPRESS"] = compress;
+    options["BIGTIFF"] = "IF_SAFER";
+    r.reset( new DiskImageResourceGDAL( filename, image.format(), Vector2i(tile_size,tile_size), options ) );
+  }
+#endif
+  if( !r ) {
+    r.reset( DiskImageResource::create( filename, image.format() ) );
+    if( r->has_block_write() )
+      r->set_block_write_size( Vector2i(tile_size,tile_size) );
+  }
+  block_write_image( *r, image, TerminalProgressCallback( "tools.blend", "Blending:" ), num_threads );
+}
+
 template <class PixelT>
 void do_blend() {
   mosaic::ImageComposite<PixelT> composite;
   if( draft ) composite.set_draft_mode( true );
+  composite.set_num_threads( num_threads );
 
   std::map<std::string,fs::path> image_files;
   std::map<std::string,fs::path> offset_files;
@@ -84,7 +116,7 @@ void do_blend() {
   }
 
   vw_out(InfoMessage) << "Preparing the composite..." << std::endl;
-  composite.prepare();
+  composite.prepare( TerminalProgressCallback( "tools.blend", "Preparing:" ) );
   if( qtree ) {
     vw_out(InfoMessage) << "Preparing the quadtree..." << std::endl;
     mosaic::QuadTreeGenerator quadtree( composite, mosaic_name );
@@ -96,21 +128,28 @@ void do_blend() {
   }
   else {
     vw_out(InfoMessage) << "Blending..." << std::endl;
-    write_image( mosaic_name+".blend."+file_type, composite );
+    block_write_file( mosaic_name+".blend."+file_type, composite );
     vw_out(InfoMessage) << "Done!" << std::endl;
   }
 }
 
 int main( int argc, char *argv[] ) {
   try {
+    size_t cache_size;
     po::options_description desc("Options");
     desc.add_options()
       ("input-dir", po::value<std::string>(&mosaic_name),
        "Explicitly specify the input directory")
       ("file-type", po::value<std::string>(&file_type)->default_value("png"),
-       "Output file type")
+       "Output file type.  Use tif for tiled, compressed output written with bounded memory")
       ("tile-size", po::value<int>(&tile_size)->default_value(256),
        "Tile size, in pixels")
+      ("threads", po::value<int>(&num_threads)->default_value(0),
+       "Number of threads for preparing and blending, or 0 for the default")
+      ("cache-size", po::value<size_t>(&cache_size)->default_value(1024),
+       "Cache size for source images and blending pyramids, in megabytes")
+      ("compress", po::value<std::string>(&compress)->default_value("LZW"),
+       "Compression of tif output [None, LZW, Deflate, Packbits]")
       ("draft", "Draft mode (no blending)")
       ("qtree", "Output in quadtree format")
       ("grayscale", "Process in grayscale only")
@@ -140,6 +179,7 @@ int main( int argc, char *argv[] ) {
       return 1;
     }
 
+    vw_settings().set_system_cache_size( cache_size*1024*1024 );
     if( vm.count("draft") ) draft = true; else draft = false;
     if( vm.count("qtree") ) qtree = true; else qtree = false;
 
@@ -30,6 +30,8 @@
 #include <algorithm>
 #include <utility>
 #include <vw/Image.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <cmath>
 
 #include "contour.h"
@@ -87,7 +89,7 @@ inline float max_nodata(float a, float b, float nodata) {
     else return std::max(a,b);
 }
 
-inline bool closed(PointContour& c) {
+inline bool closed(PointContour const& c) {
     return c.front() == c.back();
 }
 
@@ -293,9 +295,18 @@ void chord_length_parameterize(PointContour c, PointContour::iterator first, Poi
 void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
                     int cint, float nodataval,
                     std::list<ContourSegment>& seglist) {
+    vw::vw_out(vw::InfoMessage, "console") << "Running CONREC\n";
+    vw::vw_out(vw::DebugMessage, "console") << "\tFinding contours\n";
+    conrec_cells(dem, vw::Vector2i(0,0), cint, nodataval, seglist);
+    vw::vw_out(vw::DebugMessage, "console")
+        << "\tCONREC found " << seglist.size() << " segments" << std::endl;
+}
+
+void conrec_cells(vw::ImageView<float> const& dem, vw::Vector2i const& origin,
+                  int cint, float nodataval, SegmentList& seglist) {
     int m1,m2,m3,case_value;
     double zmin,zmax;
-    register int c,i,j,m;
+    int c,i,j,m;
     double h[5];
     int sh[5];
     double xh[5], yh[5];
@@ -304,10 +315,7 @@ void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
         { { {0,0,8},{0,2,5},{7,6,9} },
           { {0,3,4},{1,3,1},{4,3,0} },
           { {9,6,7},{5,2,0},{8,0,0} } };
-    ContourSegment seg;
 
-    vw::vw_out(vw::InfoMessage, "console") << "Running CONREC\n";
-    vw::vw_out(vw::DebugMessage, "console") << "\tFinding contours\n";
     for (i=0; i < dem.cols()-1; i++) {
         for (j=0; j < dem.rows()-1; j++) {
             zmin = min_nodata( min_nodata(dem(i,j),   dem(i,j+1),   nodataval),
@@ -334,13 +342,13 @@ void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
                             h[0] += h[m];
                             goodvals++;
                         }
-                        xh[m] = i + im[m-1];
-                        yh[m] = j + jm[m-1];
+                        xh[m] = origin.x() + i + im[m-1];
+                        yh[m] = origin.y() + j + jm[m-1];
                         //printf("h[%d]: %0.2f (%0.2f)\n",m,dem(i+im[m-1],j+jm[m-1]),h[m]);
                     } else {
                         h[0] /= goodvals;
-                        xh[0] = i + 0.5;
-                        yh[0] = j + 0.5;
+                        xh[0] = origin.x() + i + 0.5;
+                        yh[0] = origin.y() + j + 0.5;
                         //printf("h[%d]: ... (%0.2f)\n",m,h[m]);
                     }
 
@@ -469,8 +477,226 @@ void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
             }
         }
     }
-    vw::vw_out(vw::DebugMessage, "console")
-        << "\tCONREC found " << seglist.size() << " segments" << std::endl;
+}
+
+/*
+ * ContourLinker
+ */
+
+bool ContourLinker::find_end(int level, ContourPoint const& p, int& id) const {
+    EndMap::const_iterator iter = m_ends.find(key(level, p));
+    if (iter == m_ends.end())
+        return false;
+    id = iter->second;
+    return true;
+}
+
+void ContourLinker::erase_end(int level, ContourPoint const& p, int id) {
+    std::pair<EndMap::iterator, EndMap::iterator> range = m_ends.equal_range(key(level, p));
+    for (EndMap::iterator iter = range.first; iter != range.second; ++iter) {
+        if (iter->second == id) {
+            m_ends.erase(iter);
+            return;
+        }
+    }
+}
+
+void ContourLinker::erase_ends(int id) {
+    LevelContour& piece = m_pieces[id];
+    if (closed(piece.second))
+        return; // closed pieces have no ends in the index
+    erase_end(piece.first, piece.second.front(), id);
+    erase_end(piece.first, piece.second.back(),  id);
+}
+
+int ContourLinker::add(int level, PointContour& c) {
+    // Keep joining until neither end of c matches a stored piece
+    int other;
+    while (!closed(c) && (find_end(level, c.back(), other) ||
+                          find_end(level, c.front(), other))) {
+        erase_ends(other);
+        join(c, m_pieces[other].second);
+        m_pieces.erase(other);
+    }
+
+    int id = m_next_id++;
+    LevelContour& piece = m_pieces[id];
+    piece.first = level;
+    piece.second.swap(c);
+    if (!closed(piece.second)) {
+        m_ends.insert(std::make_pair(key(level, piece.second.front()), id));
+        m_ends.insert(std::make_pair(key(level, piece.second.back()),  id));
+    }
+    return id;
+}
+
+void ContourLinker::take(int id, LevelContour& out) {
+    erase_ends(id);
+    PieceMap::iterator iter = m_pieces.find(id);
+    out.first = iter->second.first;
+    out.second.swap(iter->second.second);
+    m_pieces.erase(iter);
+}
+
+/*
+ * Tiled contouring
+ */
+
+namespace {
+
+typedef std::list<ContourLinker::LevelContour> PieceList;
+
+// Collects the pieces of each tile, and stitches them together in tile order
+// as the tiles finish.
+class ContourStitcher {
+public:
+    ContourStitcher(int num_cells_x, int num_cells_y, int tile_size, ContourSink& sink)
+        : m_cells_x(num_cells_x), m_cells_y(num_cells_y), m_tile_size(tile_size),
+          m_tiles_x((num_cells_x - 1) / tile_size + 1),
+          m_tiles_y((num_cells_y - 1) / tile_size + 1),
+          m_next(0), m_sink(sink) {}
+
+    int num_tiles() const { return m_tiles_x * m_tiles_y; }
+
+    vw::BBox2i tile_cells(int index) const {
+        int x = (index % m_tiles_x) * m_tile_size;
+        int y = (index / m_tiles_x) * m_tile_size;
+        return vw::BBox2i(vw::Vector2i(x, y),
+                          vw::Vector2i(std::min(x + m_tile_size, m_cells_x),
+                                       std::min(y + m_tile_size, m_cells_y)));
+    }
+
+    // True if p lies on a seam between two tiles, where a contour may continue
+    // in the neighboring tile.
+    bool on_seam(ContourPoint const& p) const {
+        int x0, x1, y0, y1;
+        tile_range(p[0], m_tiles_x, x0, x1);
+        tile_range(p[1], m_tiles_y, y0, y1);
+        return (x0 != x1) || (y0 != y1);
+    }
+
+    // Hands over the pieces of a tile.  Pieces which do not reach a seam are
+    // finished already; the others wait in the pool for their neighbors.
+    void deliver(int index, PieceList& pieces) {
+        vw::Mutex::Lock lock(m_mutex);
+        m_waiting[index].swap(pieces);
+        std::map<int, PieceList>::iterator iter;
+        while ((iter = m_waiting.find(m_next)) != m_waiting.end()) {
+            PieceList& tile_pieces = iter->second;
+            for (PieceList::iterator p = tile_pieces.begin(); p != tile_pieces.end(); ++p) {
+                if (closed(p->second) || (!on_seam(p->second.front()) && !on_seam(p->second.back())))
+                    m_sink(p->first, p->second);
+                else
+                    m_pool.add(p->first, p->second);
+            }
+            m_waiting.erase(iter);
+            m_next++;
+            flush_finished();
+        }
+    }
+
+private:
+    // The range of tiles along one axis whose closed bounds hold v.  Points on
+    // a seam are computed by interpolating along the seam, so allow for
+    // rounding.
+    void tile_range(double v, int num_tiles, int& t0, int& t1) const {
+        const double eps = 1e-6;
+        t0 = std::max(0, std::min(num_tiles - 1, int(floor((v - eps) / m_tile_size))));
+        t1 = std::max(0, std::min(num_tiles - 1, int(floor((v + eps) / m_tile_size))));
+    }
+
+    // An end is final once every tile it touches has been stitched.
+    bool end_is_final(ContourPoint const& p) const {
+        int x0, x1, y0, y1;
+        tile_range(p[0], m_tiles_x, x0, x1);
+        tile_range(p[1], m_tiles_y, y0, y1);
+        return y1 * m_tiles_x + x1 < m_next;
+    }
+
+    void flush_finished() {
+        std::vector<int> finished;
+        ContourLinker::PieceMap::const_iterator iter;
+        for (iter = m_pool.pieces().begin(); iter != m_pool.pieces().end(); ++iter) {
+            PointContour const& c = iter->second.second;
+            if (closed(c) || (end_is_final(c.front()) && end_is_final(c.back())))
+                finished.push_back(iter->first);
+        }
+        ContourLinker::LevelContour piece;
+        for (size_t i = 0; i < finished.size(); ++i) {
+            m_pool.take(finished[i], piece);
+            m_sink(piece.first, piece.second);
+        }
+    }
+
+    int m_cells_x, m_cells_y, m_tile_size, m_tiles_x, m_tiles_y;
+    int m_next; // The next tile to stitch
+    ContourSink& m_sink;
+    vw::Mutex m_mutex;
+    std::map<int, PieceList> m_waiting; // Tiles which finished ahead of m_next
+    ContourLinker m_pool;               // Pieces waiting on a neighboring tile
+};
+
+// Contours one tile and links its segments.
+class ConrecTileTask : public vw::Task {
+    vw::ImageViewRef<float> const& m_dem;
+    int m_index;
+    int m_cint;
+    float m_nodataval;
+    ContourStitcher& m_stitcher;
+
+public:
+    ConrecTileTask(vw::ImageViewRef<float> const& dem, int index, int cint,
+                   float nodataval, ContourStitcher& stitcher)
+        : m_dem(dem), m_index(index), m_cint(cint), m_nodataval(nodataval),
+          m_stitcher(stitcher) {}
+
+    virtual void operator()() {
+        // A cell needs the pixels at both of its corners
+        vw::BBox2i cells = m_stitcher.tile_cells(m_index);
+        vw::BBox2i pixels = cells;
+        pixels.max() += vw::Vector2i(1,1);
+        vw::ImageView<float> tile = vw::crop(m_dem, pixels);
+
+        SegmentList segments;
+        conrec_cells(tile, cells.min(), m_cint, m_nodataval, segments);
+
+        ContourLinker linker;
+        for (SegmentList::iterator s = segments.begin(); s != segments.end(); ++s) {
+            if (s->a == s->b)
+                continue; // Zero length segments do not add to any contour
+            PointContour c;
+            c.push_back(s->a);
+            c.push_back(s->b);
+            linker.add(s->level, c);
+        }
+        segments.clear();
+
+        PieceList pieces;
+        while (!linker.empty()) {
+            pieces.push_back(ContourLinker::LevelContour());
+            linker.take(linker.pieces().begin()->first, pieces.back());
+        }
+        m_stitcher.deliver(m_index, pieces);
+    }
+};
+
+} // namespace
+
+void conrec_tiled(vw::ImageViewRef<float> const& dem, int cint, float nodataval,
+                  ContourSink& sink, int tile_size, int num_threads) {
+    VW_ASSERT(tile_size > 0, vw::ArgumentErr() << "conrec_tiled: tile_size must be positive.");
+    if (dem.cols() < 2 || dem.rows() < 2)
+        return; // No cells
+
+    ContourStitcher stitcher(dem.cols() - 1, dem.rows() - 1, tile_size, sink);
+    vw::vw_out(vw::InfoMessage, "console") << "Running CONREC on "
+        << stitcher.num_tiles() << " tiles\n";
+
+    vw::FifoWorkQueue queue(num_threads > 0 ? num_threads : vw::vw_settings().default_num_threads());
+    for (int t = 0; t < stitcher.num_tiles(); ++t)
+        queue.add_task(boost::shared_ptr<vw::Task>(
+            new ConrecTileTask(dem, t, cint, nodataval, stitcher)));
+    queue.join_all();
 }
 
 
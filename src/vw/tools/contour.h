@@ -66,10 +66,74 @@ void chord_length_parameterize(PointContour c,
         PointContour::iterator first,
         PointContour::iterator last);
 
+/*
+ * Contour linking
+ */
+
+/// Joins pieces of contour which share an end point into longer contours.
+/// - Ends are looked up in an index rather than compared with every stored
+///   piece, so linking n segments takes O(n log n) time.
+class ContourLinker {
+public:
+    typedef std::pair<int, PointContour> LevelContour;
+    typedef std::map<int, LevelContour> PieceMap;
+
+    ContourLinker() : m_next_id(0) {}
+
+    /// Joins c (which is emptied) with the stored pieces of the same level
+    /// that share an end with it, stores the result, and returns its id.
+    int add(int level, PointContour& c);
+
+    /// Removes a piece, returning it in out.
+    void take(int id, LevelContour& out);
+
+    PieceMap const& pieces() const { return m_pieces; }
+    bool empty() const { return m_pieces.empty(); }
+
+private:
+    typedef std::pair<int, std::pair<double, double> > EndKey;
+    typedef std::multimap<EndKey, int> EndMap;
+
+    static EndKey key(int level, ContourPoint const& p) {
+        return EndKey(level, std::make_pair(p[0], p[1]));
+    }
+    bool find_end(int level, ContourPoint const& p, int& id) const;
+    void erase_end(int level, ContourPoint const& p, int id);
+    void erase_ends(int id);
+
+    PieceMap m_pieces;
+    EndMap   m_ends;
+    int      m_next_id;
+};
+
+/// Receives finished contours from conrec_tiled().
+class ContourSink {
+public:
+    virtual ~ContourSink() {}
+    virtual void operator()(int level, PointContour const& contour) = 0;
+};
+
 /*
  * Contouring functions
  */
 void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
             int cint, float nodataval, std::list<ContourSegment>& seglist);
 
+/// Runs CONREC over all the cells of dem, which is the part of a larger DEM
+/// whose pixel (0,0) is at origin.  The segments are in the coordinates of
+/// the larger DEM.
+void conrec_cells(vw::ImageView<float> const& dem, vw::Vector2i const& origin,
+                  int cint, float nodataval, SegmentList& seglist);
+
+/// Contours a DEM in tiles of tile_size cells on num_threads threads (0 for
+/// the default), and passes each contour to sink as soon as it is finished.
+/// - Each tile is read and its segments linked on its own.  The pieces which
+///   end on a seam between tiles are then stitched with the pieces from the
+///   neighboring tiles, in tile order, so the output does not depend on the
+///   number of threads.
+/// - Only the tiles being contoured and the pieces still waiting on a
+///   neighbor are held in memory.
+void conrec_tiled(vw::ImageViewRef<float> const& dem, int cint, float nodataval,
+                  ContourSink& sink, int tile_size = 512, int num_threads = 0);
+
 
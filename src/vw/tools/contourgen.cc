@@ -36,6 +36,7 @@
 #include <vw/Core/ProgressCallback.h>
 #include <vw/Image.h>
 #include <vw/FileIO.h>
+#include <vw/Geometry/dPoly.h>
 
 #include <cmath>
 
@@ -260,6 +261,39 @@ void draw_Bezier_contours(BezierContourSet bcset, Cairo::RefPtr<Cairo::Context>
 
 
 
+// Collects finished contours for drawing.
+class ContourSetSink : public ContourSink {
+    PointContourSet& m_cset;
+public:
+    ContourSetSink(PointContourSet& cset) : m_cset(cset) {}
+    void operator()(int level, PointContour const& contour) {
+        m_cset.insert(make_pair(level, contour));
+    }
+};
+
+// Writes each finished contour straight to a dPoly contour file.
+class DPolyContourSink : public ContourSink {
+    vw::geometry::dPolyWriter& m_writer;
+    std::vector<double> m_x, m_y;
+public:
+    DPolyContourSink(vw::geometry::dPolyWriter& writer) : m_writer(writer) {}
+    void operator()(int level, PointContour const& contour) {
+        m_x.clear();
+        m_y.clear();
+        for (PointContour::const_iterator iter = contour.begin(); iter != contour.end(); ++iter) {
+            m_x.push_back((*iter)[0]);
+            m_y.push_back((*iter)[1]);
+        }
+        // The writer repeats the first vertex of a closed polygon itself
+        bool is_closed = contour.size() > 2 && contour.front() == contour.back();
+        if (is_closed) {
+            m_x.pop_back();
+            m_y.pop_back();
+        }
+        m_writer.writePolygon(m_x.size(), &m_x[0], &m_y[0], is_closed, "yellow");
+    }
+};
+
 void write_points_to_file(std::string file_out, SegmentList segment_list, int rows, int cols) {
     vw::vw_out(vw::InfoMessage) << "Writing contour points to text file\n";
     SegmentList::iterator iter;
@@ -298,6 +332,10 @@ int main(int argc, char *argv[])
             "set \"NO DATA\" value")
         ("contour-interval,c", po::value<int>()->default_value(100),
             "set contour interval")
+        ("tile-size", po::value<int>()->default_value(512),
+            "contour the DEM in tiles of this many pixels on a side")
+        ("threads", po::value<int>()->default_value(0),
+            "number of threads to use, 0 for the default")
     ;
 
     po::options_description hidden("Hidden options");
@@ -344,6 +382,8 @@ int main(int argc, char *argv[])
     std::string output_type = vm["output-type"].as<std::string>();
     float nodataval = vm["no-data-value"].as<float>();
     int cint = vm["contour-interval"].as<int>();
+    int tile_size = vm["tile-size"].as<int>();
+    int num_threads = vm["threads"].as<int>();
 
     vw::vw_log().console_log().rule_set().clear();
     vw::vw_log().console_log().rule_set().add_rule(vw::WarningMessage, "console");
@@ -351,13 +391,26 @@ int main(int argc, char *argv[])
         vw::vw_log().console_log().rule_set().add_rule(vw::DebugMessage, "console");
     }
 
-    if (output_type != "text" && output_type != "svg" && output_type != "png") {
+    if (output_type != "text" && output_type != "svg" && output_type != "png" &&
+        output_type != "cnt") {
         vw::vw_out(vw::ErrorMessage)
-            << "ERROR: Output types other than \"text\", \"png\" or \"svg\" "
+            << "ERROR: Output types other than \"text\", \"png\", \"svg\" or \"cnt\" "
             << "not currently supported." << std::endl;
         return 1;
     }
 
+    if (output_type == "cnt" && input_type != "tiff") {
+        vw::vw_out(vw::ErrorMessage)
+            << "ERROR: \"cnt\" output needs \"tiff\" input." << std::endl;
+        return 1;
+    }
+
+    if (tile_size <= 0) {
+        vw::vw_out(vw::ErrorMessage)
+            << "ERROR: The tile size must be positive." << std::endl;
+        return 1;
+    }
+
     if (input_type != "tiff" && input_type != "text") {
         vw::vw_out(vw::ErrorMessage)
             << "ERROR: Input types other than \"tiff\" or \"text\" "
@@ -382,7 +435,23 @@ int main(int argc, char *argv[])
     int rows, cols;
     float error = 1.0e-3;
 
-    if (input_type == "tiff") {
+    if (input_type == "tiff" && output_type == "cnt") {
+        // Contour the DEM a tile at a time, writing each contour out as soon
+        // as it is finished.
+        vw::DiskImageView<float> dem_view(file_in);
+        vw::geometry::dPolyWriter writer(file_out, "cnt");
+        if (!writer.isOpen()) {
+            vw::vw_out(vw::ErrorMessage)
+                << "ERROR: Cannot write " << file_out << std::endl;
+            return 1;
+        }
+        DPolyContourSink sink(writer);
+        conrec_tiled(dem_view, cint, nodataval, sink, tile_size, num_threads);
+        writer.close();
+        return 0;
+    }
+
+    if (input_type == "tiff" && output_type == "text") {
         // 1. Load DEM from file
         dem = load_dem_from_file(file_in);
         rows = dem.rows();
@@ -401,8 +470,17 @@ int main(int argc, char *argv[])
         write_points_to_file(file_out, segment_list, rows, cols);
 
     } else { // SVG or PNG
-        // Load segments into point contour set
-        load_segments_into_pcs(segment_list, cset);
+        if (input_type == "tiff") {
+            // Contour and link the DEM in parallel tiles
+            vw::DiskImageView<float> dem_view(file_in);
+            rows = dem_view.rows();
+            cols = dem_view.cols();
+            ContourSetSink sink(cset);
+            conrec_tiled(dem_view, cint, nodataval, sink, tile_size, num_threads);
+        } else {
+            // Load segments into point contour set
+            load_segments_into_pcs(segment_list, cset);
+        }
 
         // Fit Bezier curves to contours
         BezierContourSet bcset;
@@ -56,6 +56,7 @@ int main(int argc, char **argv) {
                          "Lower this to make the algorithm detect more water, increase for less water.")
     ("mode,m",           po::value<std::string>(&mode), 
         "The processing mode. Required.  Options: [sentinel1, landsat, worldview]")
+    ("clean-borders",    "Remove junk pixels from the borders of a Sentinel-1 image before detecting water.")
     ("debug",  "Record debugging information.")
     ("help,h", "Display this help message");
 
@@ -94,6 +95,7 @@ int main(int argc, char **argv) {
     return 0;
   }
   bool debug = vm.count("debug");
+  bool clean_borders = vm.count("clean-borders");
 
   // Check the input mode
   // - SPOT mode is available as a hidden option since there is an 
@@ -137,7 +139,7 @@ int main(int argc, char **argv) {
   if (radar_mode) {
     std::cout << "Processing sentinel-1 image!\n";
     radar::sar_martinis(input_file_names[0], output_path, write_options, dem_path, debug, 
-                        tile_size, sensitivity);
+                        tile_size, sensitivity, clean_borders);
     return 0;
   }
   
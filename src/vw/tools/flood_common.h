@@ -100,6 +100,104 @@ float rescale_to_01(float value, float min, float max) {
   return ((value - min) / rng);
 }
 
+/// Compute a band derived index along two bands of n pixels, the same as
+/// compute_index() does for one pixel.
+/// - This is written without branches so that the compiler can vectorize it.
+inline void compute_index(float const* a, float const* b, float* out, size_t n) {
+  for (size_t i=0; i<n; ++i) {
+    float denom = a[i] + b[i];
+    out[i] = (denom == 0) ? 100.0f : (a[i] - b[i]) / denom;
+  }
+}
+
+
+/// One tile of a multispectral image with each of its N bands stored
+/// contiguously, so that index and classifier kernels run along plain float
+/// arrays which the compiler can vectorize.
+template <int N>
+struct BandStackTile {
+  int cols, rows;
+  std::vector<float> bands[N]; ///< Band values, stored row first.
+  std::vector<uint8> valid;    ///< Nonzero where the input pixel was valid.
+
+  size_t size() const { return valid.size(); }
+  float      * band(int b)       { return &bands[b][0]; }
+  float const* band(int b) const { return &bands[b][0]; }
+
+  /// Copy in a tile of masked multi-channel pixels.
+  template <class PixelT>
+  void assign(ImageView<PixelT> const& tile) {
+    cols = tile.cols();
+    rows = tile.rows();
+    size_t n = static_cast<size_t>(cols) * rows;
+    valid.resize(n);
+    for (int b=0; b<N; ++b)
+      bands[b].resize(n);
+    size_t i = 0;
+    for (int r=0; r<rows; ++r) {
+      for (int c=0; c<cols; ++c) {
+        PixelT const& pix = tile(c,r);
+        valid[i] = is_valid(pix);
+        for (int b=0; b<N; ++b)
+          bands[b][i] = pix.child()[b];
+        ++i;
+      }
+    }
+  }
+}; // End struct BandStackTile
+
+
+/// View which reads each tile of a multispectral image once into a
+/// BandStackTile and computes the output tile from it with a kernel.
+/// - KernelT must define num_bands, pixel_type and
+///     void operator()(BandStackTile<num_bands> &stack, ImageView<pixel_type> &output) const
+///   The kernel may modify the stack, for example to convert it to TOA values.
+/// - A kernel which computes several indices at once lets all of them share one
+///   read of the input bands.
+template <class ImageT, class KernelT>
+class BandStackView : public ImageViewBase<BandStackView<ImageT, KernelT> > {
+  ImageT  m_image;
+  KernelT m_kernel;
+public:
+  typedef typename KernelT::pixel_type pixel_type;
+  typedef pixel_type result_type;
+  typedef ProceduralPixelAccessor<BandStackView> pixel_accessor;
+
+  BandStackView(ImageT const& image, KernelT const& kernel)
+    : m_image(image), m_kernel(kernel) {}
+
+  inline int32 cols  () const { return m_image.cols(); }
+  inline int32 rows  () const { return m_image.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+  inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+    vw_throw(NoImplErr() << "BandStackView: operator()(...) is not implemented");
+    return result_type();
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+    BandStackTile<KernelT::num_bands> stack;
+    stack.assign(ImageView<typename ImageT::pixel_type>(crop(m_image, bbox)));
+    ImageView<pixel_type> output(bbox.width(), bbox.height());
+    m_kernel(stack, output);
+    return prerasterize_type(output, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+  }
+
+  template <class DestT>
+  inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+}; // End class BandStackView
+
+template <class ImageT, class KernelT>
+BandStackView<ImageT, KernelT> band_stack_view(ImageViewBase<ImageT> const& image, KernelT const& kernel) {
+  return BandStackView<ImageT, KernelT>(image.impl(), kernel);
+}
+
+
 /// Computes the distance between the Earth and the Sun at a given time in AU.
 /// - Copied from "Radiometric Use of WorldView-2 Imagery"
 double compute_earth_sun_distance(int year, int month, int day, int hour, int minute, double second) {
@@ -24,32 +24,72 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <iomanip>
 
 #include <boost/program_options.hpp>
 namespace po = boost::program_options;
 
-#include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/FileIO/DiskImageView.h>
 
 using namespace vw;
+using cartography::GeoReferenceQuery;
 
 /// \file georef_query.cc Tool for making queries about GeoRef information on an image file.
 
+/// Converts the points listed in a stream, one "x y" pair per line, and
+/// writes the results one pair per line.  Blank lines and lines starting
+/// with '#' are skipped.  Points are converted in chunks, so the projection
+/// step makes one Proj.4 call per chunk and memory use stays bounded.
+void convert_batch( GeoReferenceQuery& query, std::string const& image_path,
+                    GeoReferenceQuery::CoordType from, GeoReferenceQuery::CoordType to,
+                    std::istream& in, std::ostream& out ) {
+  const size_t CHUNK_SIZE = 65536;
+  std::vector<Vector2> points;
+  points.reserve( CHUNK_SIZE );
+  out << std::setprecision(17);
+
+  std::string line;
+  size_t line_number = 0;
+  while ( true ) {
+    bool done = !std::getline( in, line );
+    if ( !done ) {
+      line_number++;
+      size_t first = line.find_first_not_of( " \t\r" );
+      if ( first == std::string::npos || line[first] == '#' )
+        continue;
+      std::istringstream fields( line );
+      Vector2 point;
+      if ( !( fields >> point[0] >> point[1] ) )
+        vw_throw( ArgumentErr() << "Could not read a point from line " << line_number
+                  << " of the batch input: " << line << "\n" );
+      points.push_back( point );
+    }
+    if ( points.size() == CHUNK_SIZE || ( done && !points.empty() ) ) {
+      query.convert( image_path, from, to, points, points );
+      for ( size_t i = 0; i < points.size(); i++ )
+        out << points[i][0] << " " << points[i][1] << "\n";
+      points.clear();
+    }
+    if ( done )
+      break;
+  }
+}
 
 int main( int argc, char *argv[] )
 {
   // Output formats list
-  const int OUTPUT_LAT_LON   = 0;
-  const int OUTPUT_PROJECTED = 1;
-  const int OUTPUT_PIXELS    = 2;
+  const int OUTPUT_LAT_LON   = GeoReferenceQuery::LONLAT;
+  const int OUTPUT_PROJECTED = GeoReferenceQuery::PROJECTED;
+  const int OUTPUT_PIXELS    = GeoReferenceQuery::PIXEL;
 
-  std::string inputImagePath;
+  std::string inputImagePath, batchPath;
   bool        printBounds;
   double      lat, lon, row, col;
-  int         outputFormat;
+  int         outputFormat, inputFormat;
 
   po::options_description general_options("Options");
   general_options.add_options()
@@ -60,7 +100,13 @@ int main( int argc, char *argv[] )
     ("lat",           po::value<double>(&lat),  "Enter a latitude  value")
     ("lon",           po::value<double>(&lon),  "Enter a longitude value")
     ("output-format", po::value<int>(&outputFormat)->default_value(OUTPUT_LAT_LON),
-                           "Specifies the output format: 0 = Lat/Lon, 1 = Projected, 2 = Pixels");
+                           "Specifies the output format: 0 = Lat/Lon, 1 = Projected, 2 = Pixels")
+    ("batch",         po::value(&batchPath),
+                           "Convert the points in this file, or in stdin if it is \"-\", one \"x y\" pair per line. "
+                           "Results are written to stdout one pair per line, in the same order.")
+    ("input-format",  po::value<int>(&inputFormat)->default_value(OUTPUT_PIXELS),
+                           "Specifies the format of the batch points, with the codes of --output-format. "
+                           "Lat/Lon points are given as \"lon lat\" and pixels as \"col row\".");
 
   po::options_description positional("");
   positional.add_options()
@@ -87,21 +133,38 @@ int main( int argc, char *argv[] )
   if ( !vm.count("inputImage") )
     vw_throw( vw::ArgumentErr() << "Requires <input image> in order to proceed.\n\n"
               << usage << general_options );
-  if ( !vm.count("print-bounds") && !(vm.count("row") && vm.count("col")) && !(vm.count("lat") && vm.count("lon")) )
-    vw_throw( vw::ArgumentErr() << "Requires either print-bounds, row/col, or lat/lon in order to proceed.\n\n"
+  if ( !vm.count("batch") && !printBounds && !(vm.count("row") && vm.count("col")) && !(vm.count("lat") && vm.count("lon")) )
+    vw_throw( vw::ArgumentErr() << "Requires either print-bounds, batch, row/col, or lat/lon in order to proceed.\n\n"
               << usage << general_options );
-
-
+  if ( outputFormat < OUTPUT_LAT_LON || outputFormat > OUTPUT_PIXELS ||
+       inputFormat  < OUTPUT_LAT_LON || inputFormat  > OUTPUT_PIXELS )
+    vw_throw( vw::ArgumentErr() << "Invalid value given for outputFormat or inputFormat!.\n\n"
+              << usage << general_options );
+  GeoReferenceQuery::CoordType outputType = GeoReferenceQuery::CoordType(outputFormat);
 
   // Load the input DEM georeference
-  cartography::GeoReference georef; 
-  boost::scoped_ptr<DiskImageResource> inputImage(DiskImageResource::open(inputImagePath));
-  if (!read_georeference(georef, *inputImage)) {
+  GeoReferenceQuery query;
+  try {
+    query.georef(inputImagePath);
+  } catch (ArgumentErr const&) {
     //vw_out() << "Failed to read input image!\n";
     std::cout << "Failed to read input image georeference!\n";
     return false;
   }
 
+  if (vm.count("batch")) {
+    GeoReferenceQuery::CoordType inputType = GeoReferenceQuery::CoordType(inputFormat);
+    if (batchPath == "-") {
+      convert_batch(query, inputImagePath, inputType, outputType, std::cin, std::cout);
+    } else {
+      std::ifstream batchFile(batchPath.c_str());
+      if (!batchFile)
+        vw_throw( vw::IOErr() << "Could not open batch file " << batchPath << ".\n" );
+      convert_batch(query, inputImagePath, inputType, outputType, batchFile, std::cout);
+    }
+    return 0;
+  }
+
   // Set output display text
   std::string yString, xString;
   switch (outputFormat) {
@@ -117,29 +180,11 @@ int main( int argc, char *argv[] )
       yString = "row";
       xString = "col";
       break;
-    default: // Error
-          vw_throw( vw::ArgumentErr() << "Invalid value given for outputFormat!.\n\n"
-                        << usage << general_options );
   }
 
 
   if (printBounds) { // Print the bounds the user requested
-    // Get the bounding box of the entire image
-    vw::BBox2 fullImageBox(Vector2(0,0), Vector2(inputImage->cols(), inputImage->rows()));
-
-    // Get the requested output bounding box
-    vw::BBox2 outputBox;
-    switch (outputFormat) {
-      case OUTPUT_LAT_LON: // Geodetic coordinates
-        outputBox = georef.pixel_to_lonlat_bbox(fullImageBox);
-        break;
-      case OUTPUT_PROJECTED:
-        outputBox = georef.pixel_to_point_bbox(fullImageBox);
-        break;
-      case OUTPUT_PIXELS:
-        outputBox = fullImageBox; // Not much to do here
-        break;
-    }
+    vw::BBox2 outputBox = query.bounds(inputImagePath, outputType);
     std::cout <<   "Min " << yString << " = " << outputBox.min()[1]
               << "\nMax " << yString << " = " << outputBox.max()[1]
               << "\nMin " << xString << " = " << outputBox.min()[0]
@@ -148,51 +193,17 @@ int main( int argc, char *argv[] )
   } // end printBounds case
 
   // Set up the input coordinate
-  vw::Vector2 inputLoc, outputLoc;
-  if (vm.count("row") && vm.count("col")) {
-    inputLoc[0] = col;
-    inputLoc[1] = row;
-
-    switch (outputFormat){
-      case OUTPUT_LAT_LON: // Geodetic coordinates
-        outputLoc = georef.pixel_to_lonlat(inputLoc);
-        break;
-      case OUTPUT_PROJECTED:
-        outputLoc = georef.pixel_to_point(inputLoc);
-        break;
-      case OUTPUT_PIXELS:
-        outputLoc = inputLoc; // Not much to do here
-        break;
-    }
-  } // End pixel input case
-
+  std::vector<Vector2> loc(1);
   if (vm.count("lat") && vm.count("lon")) {
-    inputLoc[0] = lon;
-    inputLoc[1] = lat;
-
-    switch (outputFormat){
-      case OUTPUT_LAT_LON: // Geodetic coordinates
-        outputLoc = inputLoc; // Not much to do here
-        break;
-      case OUTPUT_PROJECTED:
-        outputLoc = georef.lonlat_to_point(inputLoc);
-        break;
-      case OUTPUT_PIXELS:
-        outputLoc = georef.lonlat_to_pixel(inputLoc);
-        break;
-    }
-  } // End lat/lon input case
-  std::cout << xString << " = " << outputLoc[0] << "\n"
-            << yString << " = " << outputLoc[1] << "\n";
+    loc[0] = Vector2(lon, lat);
+    query.convert(inputImagePath, GeoReferenceQuery::LONLAT, outputType, loc, loc);
+  } else {
+    loc[0] = Vector2(col, row);
+    query.convert(inputImagePath, GeoReferenceQuery::PIXEL, outputType, loc, loc);
+  }
+  std::cout << xString << " = " << loc[0][0] << "\n"
+            << yString << " = " << loc[0][1] << "\n";
 
 
   return 0;
 }
-
-
-
-
-
-
-
-
@@ -41,6 +41,7 @@
 #include <vw/Image/PixelMath.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/FileIO/DiskImageView.h>
+#include <vw/FileIO/DiskImageResource.h>
 #include <vw/HDR/CameraCurve.h>
 #include <vw/HDR/LDRtoHDR.h>
 
@@ -48,6 +49,7 @@
 #include <string>
 
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
 namespace po = boost::program_options;
 
 using std::cout;
@@ -58,11 +60,23 @@ using std::string;
 using namespace vw;
 using namespace vw::hdr;
 
+// Writes an image to disk in blocks, rasterized on num_threads threads.
+template <class ImageT>
+void block_write_file( string const& filename, ImageViewBase<ImageT> const& image,
+                       int num_threads, ProgressCallback const& progress ) {
+  boost::scoped_ptr<DiskImageResource> r( DiskImageResource::create( filename, image.format() ) );
+  if ( r->has_block_write() )
+    r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                       vw_settings().default_tile_size() ) );
+  block_write_image( *r, image, progress, num_threads );
+}
+
 int main( int argc, char *argv[] ) {
   try {
     vector<string> input_filenames;
     string output_filename, curve_file;
     float exposure_ratio = 0;
+    int num_threads = 0;
 
     po::options_description desc("Options");
     desc.add_options()
@@ -71,7 +85,8 @@ int main( int argc, char *argv[] ) {
       ("output-filename,o", po::value<string>(&output_filename)->default_value("merged_hdr_image.exr"), "Specify the output filename")
       ("exposure-ratio,e", po::value<float>(&exposure_ratio), "Manually specified exposure ratio for the images (e.g. for increasing power of 2 expoures, you would use a exposure-ratio of 2.0).")
       ("save-curves,c", po::value<string>(&curve_file), "Write the curve lookup tables to a file on disk.")
-      ("use-curves,u", po::value<string>(&curve_file), "Read the curve lookup tables to a file on disk.  These curves will be used instead of computing new curves.");
+      ("use-curves,u", po::value<string>(&curve_file), "Read the curve lookup tables to a file on disk.  These curves will be used instead of computing new curves.")
+      ("threads", po::value<int>(&num_threads)->default_value(0), "Number of threads to merge the image blocks on (0 for the default).");
 
     po::positional_options_description p;
     p.add("input-filenames", -1);
@@ -91,9 +106,6 @@ int main( int argc, char *argv[] ) {
       return 1;
     }
 
-    // Process HDR stack using Exif tags.
-    ImageView<PixelRGB<float> > hdr;
-
     cout << "Getting Brightness Values" << endl;
     // In the absense of EXIF data or if the user has provided an
     // explicit exposure ratio, we go with that value here.
@@ -127,8 +139,10 @@ int main( int argc, char *argv[] ) {
     }
 
     TerminalProgressCallback tpc( "tools.hdr_merge", "Processing");
-    // Create the HDR images and write the results to the file
-    write_image(output_filename, HighDynamicRangeView<PixelRGB<float> > (images, curves, brightness_values), tpc);
+    // Create the HDR images and write the results to the file, merging
+    // the blocks in parallel.
+    block_write_file(output_filename, HighDynamicRangeView<PixelRGB<float> > (images, curves, brightness_values),
+                     num_threads, tpc);
 
   } catch (const vw::Exception& e) {
     vw_out() << argv[0] << ": a Vision Workbench error occurred: \n\t"
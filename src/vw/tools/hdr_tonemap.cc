@@ -40,10 +40,12 @@
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/HDR/CameraCurve.h>
 #include <vw/HDR/GlobalToneMap.h>
+#include <vw/HDR/LocalToneMap.h>
 
 #include <iostream>
 
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
 namespace po = boost::program_options;
 
 using std::cout;
@@ -52,11 +54,22 @@ using std::string;
 using namespace vw;
 using namespace vw::hdr;
 
+// Writes an image to disk in blocks, rasterized on num_threads threads.
+template <class ImageT>
+void block_write_file( string const& filename, ImageViewBase<ImageT> const& image,
+                       int num_threads, ProgressCallback const& progress ) {
+  boost::scoped_ptr<DiskImageResource> r( DiskImageResource::create( filename, image.format() ) );
+  if ( r->has_block_write() )
+    r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                       vw_settings().default_tile_size() ) );
+  block_write_image( *r, image, progress, num_threads );
+}
+
 int main( int argc, char *argv[] ) {
   try {
     string input_filename, output_filename, curve_file;
-    float bias, gamma;
-    int bit_depth;
+    float bias, gamma, threshold;
+    int bit_depth, num_threads;
 
     po::options_description desc("Options");
     desc.add_options()
@@ -65,6 +78,9 @@ int main( int argc, char *argv[] ) {
       ("output-filename,o", po::value<string>(&output_filename)->default_value("tonemap.png"), "Specify the output filename.")
       ("bias,b", po::value<float>(&bias)->default_value(vw::hdr::DRAGO_DEFAULT_BIAS), "Drago Tonemapping Parameter.  (The default of 0.85 works well for most images)")
       ("gamma,g", po::value<float>(&gamma)->default_value(2.2), "Apply a gamma correction to the tonemapped image.")
+      ("local", "Use the Ashikhmin local tone-mapping operator instead of the Drago global one.")
+      ("threshold", po::value<float>(&threshold)->default_value(0.5), "Ashikhmin scale selection threshold.")
+      ("threads", po::value<int>(&num_threads)->default_value(0), "Number of threads to tone-map the image blocks on (0 for the default).")
       ("bit-depth", po::value<int>(&bit_depth)->default_value(8), "Select a bit depth (8, 16, 32, or 64  [selecting 32 or 64 bit saves as IEE float if supported]")
       ("curves-for-raw-image,c", po::value<string>(&curve_file), "Read the curve lookup tables to a file on disk.  Only use this option if you are processing a raw image from a camera and you have a curves file to match.  You need not specify this option if you are processing a HDR luminance image.");
 
@@ -101,21 +117,29 @@ int main( int argc, char *argv[] ) {
       tone_mapped = luminance_image(tone_mapped, curves, 1.0);
     }
 
-    cout << "Applying Drago tone-mapping" << endl;
-    // Apply Drago tone-mapping operator.
-    tone_mapped = pow(drago_tone_map(tone_mapped, bias), gamma);
+    if ( vm.count("local") != 0 ) {
+      cout << "Applying Ashikhmin tone-mapping" << endl;
+      // The operator is computed a block at a time, so unlike
+      // ashikhmin_tone_map() the result is clamped below rather than
+      // normalized over the whole image.
+      tone_mapped = pow(ashikhmin_tone_map_view(tone_mapped, threshold, num_threads), gamma);
+    } else {
+      cout << "Applying Drago tone-mapping" << endl;
+      // Apply Drago tone-mapping operator.
+      tone_mapped = pow(drago_tone_map(tone_mapped, bias), gamma);
+    }
 
     TerminalProgressCallback tpc( "tools.hdr_tonemap", "Processing");
 
     // Write out the result to disk.
     if (bit_depth == 8)
-      write_image(output_filename, channel_cast_rescale<uint8>(clamp(tone_mapped)), tpc);
+      block_write_file(output_filename, channel_cast_rescale<uint8>(clamp(tone_mapped)), num_threads, tpc);
     else if (bit_depth == 16)
-      write_image(output_filename, channel_cast_rescale<uint16>(clamp(tone_mapped)), tpc);
+      block_write_file(output_filename, channel_cast_rescale<uint16>(clamp(tone_mapped)), num_threads, tpc);
     else if (bit_depth == 32)
-      write_image(output_filename, channel_cast_rescale<float32>(clamp(tone_mapped)), tpc);
+      block_write_file(output_filename, channel_cast_rescale<float32>(clamp(tone_mapped)), num_threads, tpc);
     else if (bit_depth == 64)
-      write_image(output_filename, tone_mapped, tpc);
+      block_write_file(output_filename, tone_mapped, num_threads, tpc);
     else {
       vw_out() << "Unknown bit depth specified by user.  Please choose from the following options: [ 8, 16, 32, 64 ]\n";
       exit(1);
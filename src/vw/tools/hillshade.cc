@@ -48,6 +48,7 @@ struct Options {
   double nodata_value;
   double blur_sigma;
   bool   align_to_georef;
+  DemProductFiles extra_products;
 };
 
 void handle_arguments( int argc, char *argv[], Options& opt ) {
@@ -61,6 +62,12 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("nodata-value",    po::value(&opt.nodata_value), "Remap the DEM default value to the min altitude value.")
     ("blur",            po::value(&opt.blur_sigma  ), "Pre-blur the DEM with the specified sigma.")
     ("align-to-georef", po::bool_switch(&opt.align_to_georef), "The azimuth is relative to East instead of +x in the image.")
+    ("slope-file",      po::value(&opt.extra_products.slope), "Also write the slope, in degrees, to this file.")
+    ("aspect-file",     po::value(&opt.extra_products.aspect), "Also write the aspect, in degrees clockwise from north, to this file.")
+    ("curvature-file",  po::value(&opt.extra_products.curvature), "Also write the curvature (minus the Laplacian of the height) to this file.")
+    ("colormap-file",   po::value(&opt.extra_products.colormap), "Also write the DEM colorized with the jet colormap and shaded by the hillshade to this file.")
+    ("min",             po::value(&opt.extra_products.min_val)->default_value(0), "Height at the bottom of the colormap. By default the DEM's minimum.")
+    ("max",             po::value(&opt.extra_products.max_val)->default_value(0), "Height at the top of the colormap. By default the DEM's maximum.")
     ("help,h", "Display this help message");
 
   po::positional_options_description p;
@@ -86,6 +93,11 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
       fs::path(opt.input_file_name).replace_extension().string() + "_HILLSHADE.tif";
 
   create_out_dir(opt.output_file_name);
+  std::string* extra_files[4] = { &opt.extra_products.slope, &opt.extra_products.aspect,
+                                  &opt.extra_products.curvature, &opt.extra_products.colormap };
+  for ( int i = 0; i < 4; i++ )
+    if ( !extra_files[i]->empty() )
+      create_out_dir(*extra_files[i]);
 }
 
 int main( int argc, char *argv[] ) {
@@ -96,7 +108,8 @@ int main( int argc, char *argv[] ) {
     do_multitype_hillshade(opt.input_file_name,
                            opt.output_file_name,
                            opt.azimuth, opt.elevation, opt.scale,
-                           opt.nodata_value, opt.blur_sigma, opt.align_to_georef);
+                           opt.nodata_value, opt.blur_sigma, opt.align_to_georef,
+                           opt.extra_products);
 
   } catch ( const ArgumentErr& e ) {
     vw_out() << e.what() << std::endl;
@@ -22,6 +22,8 @@
 #include <vw/Core/System.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/EulerAngles.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageViewRef.h>
@@ -34,15 +36,237 @@
 #include <vw/Cartography/GeoReference.h>
 #include <vw/tools/Common.h>
 
+#include <map>
+
 namespace vw{
 
+  /// The products that can be made from the gradients of a DEM.
+  enum DemProduct { DEM_HILLSHADE, DEM_SLOPE, DEM_ASPECT, DEM_CURVATURE, DEM_COLORMAP,
+                    DEM_NUM_PRODUCTS };
+
+  typedef std::map<float, Vector<uint8,3> > DemColormap;
+
+  /// The jet colormap, keyed by height normalized to [0,1].
+  inline DemColormap jet_colormap() {
+    DemColormap map;
+    map[0.0  ] = Vector<uint8,3>(  0,   0,   0); // Black
+    map[0.208] = Vector<uint8,3>(  0,   0, 255); // Blue
+    map[0.25 ] = Vector<uint8,3>(  0,   0, 255); // Blue
+    map[0.375] = Vector<uint8,3>(  0, 191, 255); // Light blue
+    map[0.417] = Vector<uint8,3>(  0, 255, 255); // Teal
+    map[0.583] = Vector<uint8,3>(255, 255,  51); // Yellow
+    map[0.625] = Vector<uint8,3>(255, 191,   0); // Orange
+    map[0.75 ] = Vector<uint8,3>(255,   0,   0); // Red
+    map[0.791] = Vector<uint8,3>(255,   0,   0); // Red
+    map[1.0  ] = Vector<uint8,3>(  0,   0,   0); // Black
+    return map;
+  }
+
+  /// The settings shared by all DEM products.
+  struct DemDerivativeParams {
+    DemDerivativeParams() : u_scale(1), v_scale(-1), light(1,0,0),
+                            min_val(0), max_val(1), shade_colormap(true) {}
+    float u_scale, v_scale; ///< The pixel size, as in compute_normals()
+    Vector3f light;         ///< The direction toward the light source
+    DemColormap colormap;   ///< Colors, keyed by height normalized to [0,1]
+    float min_val, max_val; ///< The heights at the ends of the colormap
+    bool shade_colormap;    ///< Multiply the colors by the hillshade
+  };
+
+  /// One tile of each DEM product.  Only the requested ones are sized.
+  struct DemDerivativeTile {
+    ImageView<PixelMask<PixelGray<uint8> > > hillshade;
+    ImageView<PixelMask<PixelGray<float> > > slope, aspect, curvature;
+    ImageView<PixelMask<PixelRGB<uint8> > >  colormap;
+  };
+
+  /// Computes the products flagged in products (bit p for DemProduct p)
+  /// over bbox of a masked DEM.  The gradient at each pixel is computed
+  /// once, with Horn's 3x3 differences, and shared by all products.
+  /// - The hillshade is the cosine of the angle to the light.
+  /// - Slope is in degrees from horizontal.
+  /// - Aspect is the downhill direction in degrees clockwise from the
+  ///   direction of increasing v, which is north for a north-up DEM.
+  ///   It is invalid on flat ground.
+  /// - Curvature is minus the Laplacian, so it is positive on ridges.
+  /// Pixels with an invalid neighbor are invalid.  The DEM is extended
+  /// by its edge values.
+  template <class ViewT>
+  void dem_derivatives_block( ImageViewBase<ViewT> const& dem, BBox2i const& bbox,
+                              int products, DemDerivativeParams const& params,
+                              DemDerivativeTile& tile ) {
+    typedef PixelMask<PixelGray<float> > masked_float;
+    BBox2i expanded = bbox;
+    expanded.expand(1);
+    ImageView<masked_float> z =
+      crop( edge_extend( pixel_cast<masked_float>( dem.impl() ), ConstantEdgeExtension() ), expanded );
+
+    const int cols = bbox.width(), rows = bbox.height();
+    const bool want_shade = (products & (1 << DEM_HILLSHADE)) ||
+                            ((products & (1 << DEM_COLORMAP)) && params.shade_colormap);
+    if ( products & (1 << DEM_HILLSHADE) ) tile.hillshade.set_size( cols, rows );
+    if ( products & (1 << DEM_SLOPE     ) ) tile.slope    .set_size( cols, rows );
+    if ( products & (1 << DEM_ASPECT    ) ) tile.aspect   .set_size( cols, rows );
+    if ( products & (1 << DEM_CURVATURE ) ) tile.curvature.set_size( cols, rows );
+    if ( products & (1 << DEM_COLORMAP  ) ) tile.colormap .set_size( cols, rows );
+
+    const Vector3f light = normalize( params.light );
+    const float u = params.u_scale, v = params.v_scale;
+    for ( int j = 0; j < rows; j++ ) {
+      for ( int i = 0; i < cols; i++ ) {
+        // a b c
+        // d e f
+        // g h k
+        bool valid = true;
+        for ( int y = j; y < j + 3; y++ )
+          for ( int x = i; x < i + 3; x++ )
+            valid = valid && is_valid( z(x,y) );
+        if ( !valid ) {
+          if ( products & (1 << DEM_HILLSHADE) ) tile.hillshade(i,j) = PixelMask<PixelGray<uint8> >();
+          if ( products & (1 << DEM_SLOPE    ) ) tile.slope    (i,j) = masked_float();
+          if ( products & (1 << DEM_ASPECT   ) ) tile.aspect   (i,j) = masked_float();
+          if ( products & (1 << DEM_CURVATURE) ) tile.curvature(i,j) = masked_float();
+          if ( products & (1 << DEM_COLORMAP ) ) tile.colormap (i,j) = PixelMask<PixelRGB<uint8> >();
+          continue;
+        }
+        const float a = z(i,j  ).child(), b = z(i+1,j  ).child(), c = z(i+2,j  ).child();
+        const float d = z(i,j+1).child(), e = z(i+1,j+1).child(), f = z(i+2,j+1).child();
+        const float g = z(i,j+2).child(), h = z(i+1,j+2).child(), k = z(i+2,j+2).child();
+
+        // Height change per pixel along x and y
+        const float dzx = ((c + 2*f + k) - (a + 2*d + g)) / 8;
+        const float dzy = ((g + 2*h + k) - (a + 2*b + c)) / 8;
+
+        float shade = 0;
+        if ( want_shade ) {
+          Vector3f normal = normalize( cross_prod( Vector3f( u, 0, dzx ), Vector3f( 0, v, dzy ) ) );
+          shade = std::min( std::max( dot_prod( normal, light ), 0.0f ), 1.0f );
+        }
+        if ( products & (1 << DEM_HILLSHADE) )
+          tile.hillshade(i,j) = PixelMask<PixelGray<uint8> >( uint8( shade * 255 ) );
+
+        // Height change per unit distance along u and v
+        const float gu = dzx / u, gv = dzy / v;
+        if ( products & (1 << DEM_SLOPE) )
+          tile.slope(i,j) = masked_float( atan( sqrt( gu*gu + gv*gv ) ) * 180 / M_PI );
+        if ( products & (1 << DEM_ASPECT) ) {
+          if ( gu == 0 && gv == 0 ) {
+            tile.aspect(i,j) = masked_float();
+          } else {
+            float aspect = atan2( -gu, -gv ) * 180 / M_PI;
+            tile.aspect(i,j) = masked_float( aspect < 0 ? aspect + 360 : aspect );
+          }
+        }
+        if ( products & (1 << DEM_CURVATURE) )
+          tile.curvature(i,j) = masked_float( -( (d - 2*e + f) / (u*u) + (b - 2*e + h) / (v*v) ) );
+
+        if ( products & (1 << DEM_COLORMAP) ) {
+          // Interpolate between the colors that bound the normalized height
+          float val = (e - params.min_val) / (params.max_val - params.min_val);
+          val = std::min( std::max( val, 0.0f ), 1.0f );
+          DemColormap::const_iterator top = params.colormap.upper_bound( val ), bot = top;
+          bot--;
+          Vector3f color = bot->second;
+          if ( top != params.colormap.end() )
+            color += ( (val - bot->first) / (top->first - bot->first) ) *
+                     ( Vector3f( top->second ) - Vector3f( bot->second ) );
+          if ( params.shade_colormap )
+            color *= shade;
+          tile.colormap(i,j) = PixelMask<PixelRGB<uint8> >( PixelRGB<uint8>( uint8( color[0] ),
+                                                                             uint8( color[1] ),
+                                                                             uint8( color[2] ) ) );
+        }
+      }
+    }
+  }
+
+  namespace detail {
+
+    // Computes all the products of one tile, then writes them.
+    template <class ViewT>
+    class DemDerivativesTask : public Task {
+      ViewT const& m_dem;
+      BBox2i m_bbox;
+      DemDerivativeParams const& m_params;
+      std::vector<DstImageResource*> const& m_resources;
+      Mutex& m_mutex;
+      ProgressCallback const& m_progress;
+      double m_progress_step;
+
+    public:
+      DemDerivativesTask( ViewT const& dem, BBox2i const& bbox, DemDerivativeParams const& params,
+                          std::vector<DstImageResource*> const& resources, Mutex& mutex,
+                          ProgressCallback const& progress, double progress_step )
+        : m_dem(dem), m_bbox(bbox), m_params(params), m_resources(resources), m_mutex(mutex),
+          m_progress(progress), m_progress_step(progress_step) {}
+
+      virtual void operator()() {
+        int products = 0;
+        for ( int p = 0; p < DEM_NUM_PRODUCTS; p++ )
+          if ( m_resources[p] )
+            products |= 1 << p;
+        DemDerivativeTile tile;
+        dem_derivatives_block( m_dem, m_bbox, products, m_params, tile );
+
+        Mutex::Lock lock( m_mutex );
+        if ( m_resources[DEM_HILLSHADE] ) m_resources[DEM_HILLSHADE]->write( tile.hillshade.buffer(), m_bbox );
+        if ( m_resources[DEM_SLOPE    ] ) m_resources[DEM_SLOPE    ]->write( tile.slope    .buffer(), m_bbox );
+        if ( m_resources[DEM_ASPECT   ] ) m_resources[DEM_ASPECT   ]->write( tile.aspect   .buffer(), m_bbox );
+        if ( m_resources[DEM_CURVATURE] ) m_resources[DEM_CURVATURE]->write( tile.curvature.buffer(), m_bbox );
+        if ( m_resources[DEM_COLORMAP ] ) m_resources[DEM_COLORMAP ]->write( tile.colormap .buffer(), m_bbox );
+        m_progress.report_incremental_progress( m_progress_step );
+      }
+    };
+
+  } // namespace detail
+
+  /// Writes the products of a masked DEM to resources, which holds one
+  /// resource or null per DemProduct, in a single pass.  Each tile of
+  /// the DEM is read once and its gradients computed once for all the
+  /// products.  The tiles are the block size of the first resource.
+  template <class ViewT>
+  void block_write_dem_derivatives( ImageViewBase<ViewT> const& dem, DemDerivativeParams const& params,
+                                    std::vector<DstImageResource*> const& resources,
+                                    ProgressCallback const& progress = ProgressCallback::dummy_instance(),
+                                    int num_threads = 0 ) {
+    VW_ASSERT( resources.size() == DEM_NUM_PRODUCTS,
+               ArgumentErr() << "block_write_dem_derivatives: Expected one resource per product." );
+    Vector2i block_size( vw_settings().default_tile_size(), vw_settings().default_tile_size() );
+    for ( int p = DEM_NUM_PRODUCTS - 1; p >= 0; p-- )
+      if ( resources[p] && resources[p]->has_block_write() )
+        block_size = resources[p]->block_write_size();
+
+    const int cols = dem.impl().cols(), rows = dem.impl().rows();
+    const int num_blocks = ((cols - 1) / block_size.x() + 1) * ((rows - 1) / block_size.y() + 1);
+    progress.report_progress(0);
+    Mutex mutex;
+    FifoWorkQueue queue( num_threads > 0 ? num_threads : vw_settings().default_num_threads() );
+    for ( int j = 0; j < rows; j += block_size.y() )
+      for ( int i = 0; i < cols; i += block_size.x() )
+        queue.add_task( boost::shared_ptr<Task>( new detail::DemDerivativesTask<ViewT>(
+          dem.impl(), BBox2i( Vector2i( i, j ), Vector2i( std::min( i + block_size.x(), cols ),
+                                                          std::min( j + block_size.y(), rows ) ) ),
+          params, resources, mutex, progress, 1.0 / num_blocks ) ) );
+    queue.join_all();
+    progress.report_finished();
+  }
+
+  /// Extra products for do_hillshade() to write in the same pass.  Empty
+  /// file names are skipped.
+  struct DemProductFiles {
+    DemProductFiles() : min_val(0), max_val(0) {}
+    std::string slope, aspect, curvature, colormap;
+    float min_val, max_val; ///< Colormap range, or the DEM's range if both are 0
+  };
+
   /// Do the hillshade work.
   template <class PixelT>
   void do_hillshade(std::string const& input_file_name,
                     std::string const& output_file_name,
                     double azimuth, double elevation, double scale,
                     double nodata_value, double blur_sigma,
-                    bool align_to_georef) {
+                    bool align_to_georef,
+                    DemProductFiles const& extra_products = DemProductFiles()) {
 
     cartography::GeoReference georef;
     bool has_georef = cartography::read_georeference(georef, input_file_name);
@@ -113,21 +337,51 @@ namespace vw{
       dem = gaussian_filter(dem, blur_sigma);
     }
 
-    // The final result is the dot product of the light source with the normals
-    ImageViewRef<PixelMask<PixelGray<uint8> > > shaded_image =
-      channel_cast_rescale<uint8>(clamp(dot_prod(compute_normals(dem, u_scale, v_scale), light)));
-
-    // Save the result
-    vw_out() << "Writing shaded relief image: " << output_file_name << "\n";
-
-    boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(output_file_name,
-                                                                     shaded_image.format()));
-    if ( r->has_block_write() )
-      r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
-                                         vw_settings().default_tile_size() ) );
-    write_georeference( *r, georef );
-    block_write_image( *r, shaded_image,
-                       TerminalProgressCallback( "tools.hillshade", "Writing:") );
+    DemDerivativeParams params;
+    params.u_scale = u_scale;
+    params.v_scale = v_scale;
+    params.light   = light;
+    if ( !extra_products.colormap.empty() ) {
+      params.colormap = jet_colormap();
+      params.min_val  = extra_products.min_val;
+      params.max_val  = extra_products.max_val;
+      if ( params.min_val == 0 && params.max_val == 0 ) {
+        typename CompoundChannelType<PixelT>::type min_val, max_val;
+        min_max_channel_values( dem, min_val, max_val );
+        params.min_val = min_val;
+        params.max_val = max_val;
+        vw_out() << "\t--> Color map range: [" << params.min_val << "  "
+                 << params.max_val << "]\n";
+      }
+    }
+
+    // Every product is made from the same gradients, in one pass over
+    // the DEM, and written to its own file.
+    std::string file_names[DEM_NUM_PRODUCTS] = { output_file_name, extra_products.slope,
+                                                 extra_products.aspect, extra_products.curvature,
+                                                 extra_products.colormap };
+    ImageFormat formats[DEM_NUM_PRODUCTS] = {
+      ImageView<PixelMask<PixelGray<uint8> > >().format(), ImageView<PixelMask<PixelGray<float> > >().format(),
+      ImageView<PixelMask<PixelGray<float> > >().format(), ImageView<PixelMask<PixelGray<float> > >().format(),
+      ImageView<PixelMask<PixelRGB<uint8> > >().format() };
+    std::vector<boost::shared_ptr<DiskImageResource> > owned;
+    std::vector<DstImageResource*> resources( DEM_NUM_PRODUCTS, (DstImageResource*)0 );
+    for ( int p = 0; p < DEM_NUM_PRODUCTS; p++ ) {
+      if ( file_names[p].empty() )
+        continue;
+      formats[p].cols = dem.cols();
+      formats[p].rows = dem.rows();
+      vw_out() << "Writing: " << file_names[p] << "\n";
+      owned.push_back( boost::shared_ptr<DiskImageResource>(
+        DiskImageResource::create( file_names[p], formats[p] ) ) );
+      if ( owned.back()->has_block_write() )
+        owned.back()->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                                      vw_settings().default_tile_size() ) );
+      write_georeference( *owned.back(), georef );
+      resources[p] = owned.back().get();
+    }
+    block_write_dem_derivatives( dem, params, resources,
+                                 TerminalProgressCallback( "tools.hillshade", "Writing:") );
   } // End function do_hillshade()
 
   /// Redirect to the function with the required data type.
@@ -135,7 +389,8 @@ namespace vw{
                               std::string const& output_file,
                               double azimuth, double elevation, double scale,
                               double nodata_value, double blur_sigma,
-                              bool align_to_georef) {
+                              bool align_to_georef,
+                              DemProductFiles const& extra_products = DemProductFiles()) {
 
     ImageFormat fmt = vw::image_format(input_file);
 
@@ -147,22 +402,26 @@ namespace vw{
       case VW_CHANNEL_UINT8:
         do_hillshade<PixelGray<uint8>  >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         extra_products);
         break;
       case VW_CHANNEL_INT16:
         do_hillshade<PixelGray<int16>  >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         extra_products);
         break;
       case VW_CHANNEL_UINT16:
         do_hillshade<PixelGray<uint16> >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         extra_products);
         break;
       default:
         do_hillshade<PixelGray<float>  >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         extra_products);
         break;
       }
       break;
@@ -76,6 +76,15 @@ void get_normalize_vals(boost::shared_ptr<DiskImageResource> file,
   cout << "Pixel range for \"" << file->filename() << ": [" << new_lo << " " << new_hi << "]    Output dynamic range: [" << lo_value << " " << hi_value << "]" << endl;
 }
 
+void report_write_stats(mosaic::QuadTreeGenerator const& quadtree) {
+  mosaic::QuadTreeGenerator::WriteStats stats = quadtree.get_write_stats();
+  if (stats.seconds <= 0)
+    return;
+  vw_out(InfoMessage) << "Wrote " << stats.tiles << " tiles at "
+                      << stats.tiles / stats.seconds << " tiles and "
+                      << stats.pixels / stats.seconds / 1e6 << " Mpixels per thread-second." << std::endl;
+}
+
 std::vector<GeoReference>
 load_image_georeferences( const Options& opt, int& total_resolution ) {
   std::vector<GeoReference> georeferences;
@@ -216,12 +225,16 @@ const std::string projection_options_str = "DEFAULT, NONE, SINUSOIDAL, MERCATOR,
     ("terrain"          , po::bool_switch(&opt.terrain)                          , "Outputs image files suitable for a Uniview terrain view. Implies output format as PNG, channel type uint16. Uniview only")
     ("jpeg-quality"     , po::value(&opt.jpeg_quality)                           , "JPEG quality factor (0.0 to 1.0)")
     ("png-compression"  , po::value(&opt.png_compression)                        , "PNG compression level (0 to 9)")
+    ("encode-preset"    , po::value(&opt.encode_preset)->default_value("default"), "Tile encoding preset: fast, default, or small.  Fast uses the lowest PNG compression level and one row filter.  The quality and compression options override it.")
     ("tile-size"        , po::value(&opt.tile_size)                              , "Tile size in pixels")
     ("max-lod-pixels"   , po::value(&opt.kml.max_lod_pixels)->default_value(1024), "Max LoD in pixels, or -1 for none (kml only)")
     ("draw-order-offset", po::value(&opt.kml.draw_order_offset)->default_value(0), "Offset for the <drawOrder> tag for this overlay (kml only)")
     ("multiband"        , po::bool_switch(&opt.multiband)                        , "Composite images using multi-band blending")
     ("aspect-ratio"     , po::value(&opt.aspect_ratio)                           , "Pixel aspect ratio (for polar overlays; should be a power of two)")
-    ("global-resolution", po::value(&opt.global_resolution)                      , "Override the global pixel resolution; should be a power of two");
+    ("global-resolution", po::value(&opt.global_resolution)                      , "Override the global pixel resolution; should be a power of two")
+    ("threads"          , po::value(&opt.num_threads)->default_value(1)         , "Number of threads writing tiles, zero for the default.  More than one builds the tree bottom up.")
+    ("encode-threads"   , po::value(&opt.num_encode_threads)->default_value(0)  , "With one thread, encode and write the tiles on this many more threads.")
+    ("archive"          , po::value(&opt.archive_file)                           , "Pack the tiles into this single archive file instead of writing one file per tile.");
 
   po::options_description projection_options("Input Projection Options");
   projection_options.add_options()
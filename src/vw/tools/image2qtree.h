@@ -31,6 +31,7 @@
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReference.h>
 #include <vw/Cartography/GeoTransform.h>
+#include <vw/Mosaic/ArchiveQuadTreeConfig.h>
 #include <vw/Mosaic/CelestiaQuadTreeConfig.h>
 #include <vw/Mosaic/GigapanQuadTreeConfig.h>
 #include <vw/Mosaic/ImageComposite.h>
@@ -64,10 +65,13 @@ struct Options {
     tile_size(0),
     jpeg_quality(-9999),
     png_compression(99999),
+    encode_preset("default"),
     pixel_scale(0),
     pixel_offset(0),
     aspect_ratio(1),
     global_resolution(0),
+    num_threads(1),
+    num_encode_threads(0),
     nodata(0),
     nodata_set(false),
     north(0), south(0),
@@ -85,14 +89,18 @@ struct Options {
 
   std::string output_file_name;
   std::string output_file_type;
+  std::string archive_file;
   std::string module_name;
   double      nudge_x, nudge_y;
   vw::uint32  tile_size;
   float       jpeg_quality;
   vw::uint32  png_compression;
+  std::string encode_preset;
   float       pixel_scale, pixel_offset;
   vw::int32   aspect_ratio;
   vw::uint32  global_resolution;
+  vw::int32   num_threads;
+  vw::int32   num_encode_threads;
   float       nodata;
   bool        nodata_set;
   float       north, south, east, west;
@@ -163,6 +171,18 @@ struct Options {
     if (proj.type == "NONE")
       VW_ASSERT(input_files.size() == 1,
                 vw::tools::Usage() << "Non-georeferenced images cannot be composed");
+    // The preset comes first, so that the settings below override it
+    if (encode_preset == "fast") {
+      vw::DiskImageResourcePNG::set_default_compression_level( 1 );
+      vw::DiskImageResourcePNG::set_default_filters( vw::DiskImageResourcePNG::Options::FILTER_SUB );
+    } else if (encode_preset == "small") {
+      vw::DiskImageResourcePNG::set_default_compression_level( 9 );
+      vw::DiskImageResourcePNG::set_default_filters( vw::DiskImageResourcePNG::Options::FILTERS_ALL );
+    } else {
+      VW_ASSERT(encode_preset == "default",
+                vw::tools::Usage() << "Unknown encode preset: " << encode_preset);
+    }
+
     // Compare against flag values
     if (jpeg_quality > 0)
       vw::DiskImageResourceJPEG::set_default_quality( jpeg_quality );
@@ -184,6 +204,9 @@ void
 get_normalize_vals(boost::shared_ptr<vw::DiskImageResource> file,
                    const Options& opt);
 
+/// Print how fast the tiles were encoded and written.
+void report_write_stats(vw::mosaic::QuadTreeGenerator const& quadtree);
+
 template <class PixelT>
 void do_normal_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
   using namespace vw;
@@ -191,16 +214,27 @@ void do_normal_mosaic(const Options& opt, const vw::ProgressCallback *progress)
   mosaic::QuadTreeGenerator quadtree(img, opt.output_file_name);
   quadtree.set_tile_size( 256 );
   quadtree.set_file_type( "png" );
-
-  if ( opt.mode != "NONE" ) {
-    boost::shared_ptr<mosaic::QuadTreeConfig> config = mosaic::QuadTreeConfig::make(opt.mode);
+  quadtree.set_num_threads( opt.num_threads );
+  quadtree.set_num_encode_threads( opt.num_encode_threads );
+
+  boost::shared_ptr<mosaic::QuadTreeConfig> config;
+  if ( opt.mode != "NONE" )
+    config = mosaic::QuadTreeConfig::make(opt.mode);
+  boost::shared_ptr<mosaic::ArchiveQuadTreeConfig> archive;
+  if ( !opt.archive_file.empty() ) {
+    archive.reset( new mosaic::ArchiveQuadTreeConfig(opt.archive_file, config) );
+    archive->configure( quadtree );
+  } else if ( config ) {
     config->configure( quadtree );
   }
 
   vw_out() << "Generating overlay..." << std::endl;
-  vw_out() << "Writing: " << opt.output_file_name << std::endl;
+  vw_out() << "Writing: " << ( archive ? opt.archive_file : opt.output_file_name ) << std::endl;
 
   quadtree.generate( *progress );
+  if ( archive )
+    archive->close();
+  report_write_stats( quadtree );
 }
 
 /// Set up the input georeference object from the file or user inputs
@@ -385,7 +419,15 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
     c2->set_longlat_bbox( ll_bbox );
   }
 
-  config->configure(quadtree);
+  // With an archive the tiles keep the layout of the config but are
+  // packed into one file.
+  boost::shared_ptr<mosaic::ArchiveQuadTreeConfig> archive;
+  if (!opt.archive_file.empty()) {
+    archive.reset(new mosaic::ArchiveQuadTreeConfig(opt.archive_file, config));
+    archive->configure(quadtree);
+  } else {
+    config->configure(quadtree);
+  }
 
   if (opt.tile_size > 0)
     quadtree.set_tile_size(opt.tile_size);
@@ -398,12 +440,17 @@ void do_mosaic(const Options& opt, const vw::ProgressCallback *progress) {
   data_bbox.crop( BBox2i(0,0,total_bbox.width(),total_bbox.height()));
 
   quadtree.set_crop_bbox(data_bbox);
+  quadtree.set_num_threads(opt.num_threads);
+  quadtree.set_num_encode_threads(opt.num_encode_threads);
 
   // Generate the composite.
   vw_out() << "Generating overlay..." << std::endl;
-  vw_out() << "Writing: " << opt.output_file_name << std::endl;
+  vw_out() << "Writing: " << (archive ? opt.archive_file : opt.output_file_name) << std::endl;
 
   quadtree.generate(*progress);
+  if (archive)
+    archive->close();
+  report_write_stats(quadtree);
 }
 
 // Define all of the function instantiations here, they are defined in
@@ -0,0 +1,368 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file image_benchmark.cc
+///
+/// Times the rasterization of common image views, in the manner of
+/// Google Benchmark: each case is repeated until it fills a minimum
+/// time, and the time per iteration is reported with the pixel and
+/// byte rates.
+///
+/// - The cases cover crop, transform with bilinear and bicubic
+///   interpolation, separable convolution, per_pixel_filter and
+///   edge_extend, BlockRasterizeView over several tile sizes and thread
+///   counts, the hit and miss paths of the Cache, and convert().
+/// - --filter runs only the cases whose names contain one of a comma
+///   separated list of strings.
+/// - With --json the results are also written in the JSON format of
+///   Google Benchmark, which its compare.py and regression dashboards
+///   read.  "make benchmark" writes image_benchmark.json.
+///
+#include <vw/Core/Cache.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/Transform.h>
+
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace po = boost::program_options;
+
+using namespace vw;
+
+/// One case.  run() does one iteration of the work.
+struct BenchmarkCase {
+  std::string             name;
+  boost::function<void()> run;
+  double                  pixels; ///< Output pixels per iteration
+  double                  bytes;  ///< Output bytes per iteration
+};
+
+struct BenchmarkResult {
+  std::string name;
+  uint64      iterations;
+  double      real_ns, cpu_ns; ///< Per iteration
+  double      pixels_per_second, bytes_per_second;
+};
+
+//-----------------------------------------------------------------------------
+// The work timed by the cases
+
+/// Rasterizes a view into an image allocated up front.
+template <class ViewT>
+class RasterizeCase {
+  ViewT m_view;
+  boost::shared_ptr<ImageView<typename ViewT::pixel_type> > m_dest;
+public:
+  RasterizeCase(ViewT const& view)
+    : m_view(view), m_dest(new ImageView<typename ViewT::pixel_type>(view.cols(), view.rows(), view.planes())) {}
+  void operator()() const {
+    m_view.rasterize(*m_dest, BBox2i(0, 0, m_view.cols(), m_view.rows()));
+  }
+};
+
+/// Rasterizes a view through its own Cache, which keeps the cache
+/// alive as long as the case.
+template <class ViewT>
+class CachedCase {
+  boost::shared_ptr<Cache> m_cache;
+  RasterizeCase<BlockRasterizeView<ViewT> > m_rasterize;
+public:
+  CachedCase(boost::shared_ptr<Cache> const& cache, BlockRasterizeView<ViewT> const& view)
+    : m_cache(cache), m_rasterize(view) {}
+  void operator()() const { m_rasterize(); }
+};
+
+/// Converts a buffer to another pixel format.
+template <class SrcT, class DstT>
+class ConvertCase {
+  boost::shared_ptr<ImageView<SrcT> > m_src;
+  boost::shared_ptr<ImageView<DstT> > m_dst;
+  bool m_rescale;
+public:
+  ConvertCase(ImageView<SrcT> const& src, bool rescale)
+    : m_src(new ImageView<SrcT>(copy(src))), m_dst(new ImageView<DstT>(src.cols(), src.rows())),
+      m_rescale(rescale) {}
+  void operator()() const { convert(m_dst->buffer(), m_src->buffer(), m_rescale); }
+};
+
+/// A cheap per-pixel function, so that the view overhead dominates.
+struct GainOffset : ReturnFixedType<float> {
+  float operator()(float value) const { return 1.5f*value + 3.0f; }
+};
+
+template <class ViewT>
+void add_view(std::vector<BenchmarkCase>& cases, std::string const& name, ImageViewBase<ViewT> const& view) {
+  BenchmarkCase c;
+  c.name   = name;
+  c.run    = RasterizeCase<ViewT>(view.impl());
+  c.pixels = double(view.impl().cols()) * view.impl().rows() * view.impl().planes();
+  c.bytes  = c.pixels * sizeof(typename ViewT::pixel_type);
+  cases.push_back(c);
+}
+
+template <class SrcT, class DstT>
+void add_convert(std::vector<BenchmarkCase>& cases, std::string const& name,
+                 ImageView<SrcT> const& src, bool rescale) {
+  BenchmarkCase c;
+  c.name   = name;
+  c.run    = ConvertCase<SrcT, DstT>(src, rescale);
+  c.pixels = double(src.cols()) * src.rows();
+  c.bytes  = c.pixels * sizeof(DstT);
+  cases.push_back(c);
+}
+
+/// Smooth noise, so that the filters and interpolation see real data.
+ImageView<float> make_image(int size) {
+  ImageView<float> image(size, size);
+  for (int row=0; row<size; ++row) {
+    for (int col=0; col<size; ++col) {
+      uint32 h = (uint32(col)*73856093u) ^ (uint32(row)*19349663u);
+      h ^= h >> 13;  h *= 0x5bd1e995u;  h ^= h >> 15;
+      image(col,row) = float(h & 0xFF);
+    }
+  }
+  return image;
+}
+
+std::string param(std::string const& name, int value) {
+  std::ostringstream s;
+  s << "/" << name << ":" << value;
+  return s.str();
+}
+
+std::vector<BenchmarkCase> make_cases(int size, int num_threads) {
+  std::vector<BenchmarkCase> cases;
+  ImageView<float> image = make_image(size);
+
+  // View chains
+  add_view(cases, "crop", crop(image, size/4, size/4, size/2, size/2));
+  add_view(cases, "transform/bilinear",
+           resample(image, 1.37, 1.37, ConstantEdgeExtension(), BilinearInterpolation()));
+  add_view(cases, "transform/bicubic",
+           resample(image, 1.37, 1.37, ConstantEdgeExtension(), BicubicInterpolation()));
+  add_view(cases, "transform/rotate/bilinear",
+           transform(image, RotateTransform(0.3, Vector2(size/2, size/2)), ZeroEdgeExtension(), BilinearInterpolation()));
+  std::vector<float> kernel;
+  generate_gaussian_kernel(kernel, 2.0);
+  add_view(cases, "separable_convolution" + param("kernel", int(kernel.size())),
+           separable_convolution_filter(image, kernel, kernel));
+  add_view(cases, "per_pixel_filter", per_pixel_filter(image, GainOffset()));
+  add_view(cases, "edge_extend/constant",
+           crop(edge_extend(image, ConstantEdgeExtension()), -16, -16, size+32, size+32));
+  add_view(cases, "edge_extend/reflect",
+           crop(edge_extend(image, ReflectEdgeExtension()), -16, -16, size+32, size+32));
+
+  // Block rasterization of a convolution, over tile sizes and threads
+  std::vector<int> threads;
+  threads.push_back(1);
+  if (num_threads > 1)
+    threads.push_back(num_threads);
+  const int tiles[] = {64, 256, 1024};
+  for (size_t t=0; t<sizeof(tiles)/sizeof(tiles[0]); ++t)
+    for (size_t n=0; n<threads.size(); ++n)
+      add_view(cases, "block_rasterize/gaussian" + param("tile", tiles[t]) + param("threads", threads[n]),
+               block_rasterize(gaussian_filter(image, 2.0), Vector2i(tiles[t], tiles[t]), threads[n]));
+
+  // The Cache, with every block kept (hits) or evicted before it is
+  // reused (misses, which regenerate the blocks)
+  typedef UnaryPerPixelView<ImageView<float>, GainOffset> CachedT;
+  const int tile = 256;
+  size_t block_bytes = size_t(tile) * tile * sizeof(float);
+  for (int hit=1; hit>=0; --hit) {
+    boost::shared_ptr<Cache> cache(new Cache(hit ? 2*block_bytes*(size/tile+1)*(size/tile+1) : block_bytes));
+    BlockRasterizeView<CachedT> view =
+      block_cache(per_pixel_filter(image, GainOffset()), Vector2i(tile, tile), 1, *cache);
+    BenchmarkCase c;
+    c.name   = std::string(hit ? "cache/hit" : "cache/miss") + param("tile", tile);
+    c.run    = CachedCase<CachedT>(cache, view);
+    c.pixels = double(size) * size;
+    c.bytes  = c.pixels * sizeof(float);
+    if (hit)
+      c.run(); // Fill the cache
+    cases.push_back(c);
+  }
+
+  // Pixel format conversions
+  ImageView<PixelRGB<uint8> > rgb8(size, size);
+  for (int row=0; row<size; ++row)
+    for (int col=0; col<size; ++col)
+      rgb8(col,row) = PixelRGB<uint8>(uint8(col), uint8(row), uint8(col+row));
+  add_convert<PixelRGB<uint8>, PixelRGB<uint8> >   (cases, "convert/rgb_u8/rgb_u8",   rgb8, false);
+  add_convert<PixelRGB<uint8>, PixelRGBA<float> >  (cases, "convert/rgb_u8/rgba_f32", rgb8, true);
+  add_convert<PixelRGB<uint8>, PixelGray<uint8> >  (cases, "convert/rgb_u8/gray_u8",  rgb8, false);
+  add_convert<float,           PixelGray<uint16> > (cases, "convert/f32/u16",         image, true);
+  return cases;
+}
+
+//-----------------------------------------------------------------------------
+// Running and reporting
+
+/// Repeats the case until it takes at least min_time seconds.
+BenchmarkResult run_case(BenchmarkCase const& c, double min_time) {
+  uint64 iterations = 1;
+  while (true) {
+    uint64 real_start = Stopwatch::microtime(false);
+    uint64 cpu_start  = Stopwatch::microtime(true);
+    for (uint64 i=0; i<iterations; ++i)
+      c.run();
+    double real = (Stopwatch::microtime(false) - real_start) * 1e-6;
+    double cpu  = (Stopwatch::microtime(true)  - cpu_start ) * 1e-6;
+
+    if (real >= min_time || iterations >= 1000000000) {
+      BenchmarkResult result;
+      result.name              = c.name;
+      result.iterations        = iterations;
+      result.real_ns           = real * 1e9 / iterations;
+      result.cpu_ns            = cpu  * 1e9 / iterations;
+      result.pixels_per_second = real > 0 ? c.pixels * iterations / real : 0;
+      result.bytes_per_second  = real > 0 ? c.bytes  * iterations / real : 0;
+      return result;
+    }
+    // As Google Benchmark does, aim past the minimum time, growing at most tenfold.
+    double multiplier = real > 0 ? 1.4 * min_time / real : 10.0;
+    multiplier = std::min(10.0, std::max(multiplier, 1.0));
+    uint64 next = uint64(std::ceil(iterations * multiplier));
+    iterations = std::max(next, iterations + 1);
+  }
+}
+
+void write_json(std::string const& filename, std::vector<BenchmarkResult> const& results,
+                int size, int num_threads) {
+  std::ofstream out(filename.c_str());
+  if (!out)
+    vw_throw(IOErr() << "Could not write " << filename << "\n");
+
+  char date[64];
+  std::time_t now = std::time(0);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+
+  out << std::setprecision(10);
+  out << "{\n  \"context\": {\n"
+      << "    \"date\": \"" << date << "\",\n"
+      << "    \"executable\": \"image_benchmark\",\n"
+      << "    \"num_cpus\": " << boost::thread::hardware_concurrency() << ",\n"
+      << "    \"threads\": " << num_threads << ",\n"
+      << "    \"image_size\": " << size << ",\n"
+#ifdef NDEBUG
+      << "    \"library_build_type\": \"release\"\n"
+#else
+      << "    \"library_build_type\": \"debug\"\n"
+#endif
+      << "  },\n  \"benchmarks\": [\n";
+  for (size_t i=0; i<results.size(); ++i) {
+    BenchmarkResult const& r = results[i];
+    out << "    {\n"
+        << "      \"name\": \"" << r.name << "\",\n"
+        << "      \"run_name\": \"" << r.name << "\",\n"
+        << "      \"run_type\": \"iteration\",\n"
+        << "      \"iterations\": " << r.iterations << ",\n"
+        << "      \"real_time\": " << r.real_ns << ",\n"
+        << "      \"cpu_time\": " << r.cpu_ns << ",\n"
+        << "      \"time_unit\": \"ns\",\n"
+        << "      \"bytes_per_second\": " << r.bytes_per_second << ",\n"
+        << "      \"items_per_second\": " << r.pixels_per_second << "\n"
+        << "    }" << (i+1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+
+  int size, num_threads;
+  double min_time;
+  std::string filter, json_file;
+
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help,h", "Display this help message")
+    ("size",        po::value(&size)->default_value(1024),   "Width and height of the test image")
+    ("threads",     po::value(&num_threads)->default_value(0),
+     "Threads for the multi-threaded cases, or 0 for the default thread count")
+    ("min-time",    po::value(&min_time)->default_value(0.5), "Minimum seconds to run each case for")
+    ("filter",      po::value(&filter)->default_value(""),
+     "Run only the cases whose names contain one of these comma separated strings")
+    ("json",        po::value(&json_file)->default_value(""), "Also write the results to this JSON file")
+    ("list",        "List the cases without running them");
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+  } catch (const po::error& e) {
+    std::cout << "An error occurred while parsing command line arguments.\n\n" << e.what() << "\n\n" << desc;
+    return 1;
+  }
+  if (vm.count("help")) {
+    std::cout << "Usage: image_benchmark [options]\n\n" << desc << "\n";
+    return 0;
+  }
+  if (num_threads <= 0)
+    num_threads = vw_settings().default_num_threads();
+
+  std::vector<std::string> patterns;
+  if (!filter.empty())
+    boost::split(patterns, filter, boost::is_any_of(","), boost::token_compress_on);
+
+  std::vector<BenchmarkCase> cases = make_cases(size, num_threads);
+  std::vector<BenchmarkResult> results;
+
+  std::cout << std::left << std::setw(48) << "Benchmark" << std::right
+            << std::setw(14) << "Time" << std::setw(14) << "CPU"
+            << std::setw(12) << "Iterations" << std::setw(12) << "Mpix/s" << "\n"
+            << std::string(100, '-') << "\n";
+  for (size_t i=0; i<cases.size(); ++i) {
+    bool selected = patterns.empty();
+    for (size_t p=0; p<patterns.size(); ++p)
+      if (cases[i].name.find(patterns[p]) != std::string::npos)
+        selected = true;
+    if (!selected)
+      continue;
+    if (vm.count("list")) {
+      std::cout << cases[i].name << "\n";
+      continue;
+    }
+    BenchmarkResult r = run_case(cases[i], min_time);
+    results.push_back(r);
+    std::cout << std::left << std::setw(48) << r.name << std::right << std::fixed
+              << std::setw(11) << std::setprecision(0) << r.real_ns << " ns"
+              << std::setw(11) << std::setprecision(0) << r.cpu_ns  << " ns"
+              << std::setw(12) << r.iterations
+              << std::setw(12) << std::setprecision(1) << r.pixels_per_second * 1e-6 << "\n";
+  }
+
+  if (!json_file.empty() && !vm.count("list"))
+    write_json(json_file, results, size, num_threads);
+  return 0;
+}
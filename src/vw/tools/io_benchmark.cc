@@ -0,0 +1,382 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file io_benchmark.cc
+///
+/// Measures the read and write throughput of the DiskImageResource
+/// drivers, so that tile sizes and codecs can be chosen from measured
+/// behavior.
+///
+/// - A synthetic image is written to each output format with
+///   block_write_image() (or write_image() for drivers without block
+///   writes), then read back through a DiskImageView rasterized one
+///   block at a time by block_rasterize().
+/// - GeoTIFFs are swept over --block-sizes (0 is striped) and
+///   --compress; every case is run at each of --threads.
+/// - Existing files given with --read, e.g. PDS or HDF images, which
+///   some drivers cannot write, are benchmarked for reading only.
+/// - Throughput is reported as MB/s of uncompressed pixels and as
+///   blocks (tiles) of the file per second, with the best time of
+///   --repeat runs.  The file was just written, so reads mostly come
+///   from the operating system's page cache; they measure decoding
+///   rather than the disk.
+///
+#include <vw/config.h>
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageIO.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/FileIO/DiskImageResource.h>
+#include <vw/FileIO/DiskImageView.h>
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+#include <vw/FileIO/DiskImageResourceGDAL.h>
+#endif
+
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_ptr.hpp>
+
+#include <fstream>
+#include <iomanip>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+using namespace vw;
+
+struct Options {
+  int size, repeat;
+  std::string pixel_type, dir, json_file;
+  std::vector<std::string> formats, compress, read_files;
+  std::vector<int> block_sizes, threads;
+};
+
+/// One way of writing the test image.
+struct WriteCase {
+  std::string name, extension;
+  Vector2i    block_size; ///< GeoTIFF only; (0,0) is striped
+  std::string compress;   ///< GeoTIFF only
+  bool        gdal;
+};
+
+struct IoResult {
+  std::string name;
+  int         threads;
+  double      seconds;    ///< Best of the runs
+  double      bytes;      ///< Uncompressed pixel bytes
+  double      blocks;     ///< Blocks of the file
+  double      file_bytes;
+};
+
+template <class T>
+std::vector<T> split_list(std::string const& list) {
+  std::vector<std::string> items;
+  boost::split(items, list, boost::is_any_of(","), boost::token_compress_on);
+  std::vector<T> result;
+  for (size_t i=0; i<items.size(); ++i) {
+    boost::trim(items[i]);
+    if (!items[i].empty())
+      result.push_back(boost::lexical_cast<T>(items[i]));
+  }
+  return result;
+}
+
+std::vector<WriteCase> make_write_cases(Options const& opt) {
+  std::vector<WriteCase> cases;
+  for (size_t f=0; f<opt.formats.size(); ++f) {
+    WriteCase c;
+    c.extension  = "." + boost::to_lower_copy(opt.formats[f]);
+    c.name       = opt.formats[f];
+    c.block_size = Vector2i();
+    c.gdal       = false;
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+    if (c.extension == ".tif" || c.extension == ".tiff") {
+      c.gdal = true;
+      for (size_t b=0; b<opt.block_sizes.size(); ++b) {
+        for (size_t k=0; k<opt.compress.size(); ++k) {
+          int block = opt.block_sizes[b];
+          c.block_size = Vector2i(block, block);
+          c.compress   = boost::to_upper_copy(opt.compress[k]);
+          c.name = opt.formats[f] + (block > 0 ? "/tile:" + boost::lexical_cast<std::string>(block)
+                                               : std::string("/striped"))
+                 + "/compress:" + c.compress;
+          cases.push_back(c);
+        }
+      }
+      continue;
+    }
+#endif
+    cases.push_back(c);
+  }
+  return cases;
+}
+
+DiskImageResource* create_resource(WriteCase const& c, std::string const& filename,
+                                   ImageFormat const& format) {
+#if defined(VW_HAVE_PKG_GDAL) && VW_HAVE_PKG_GDAL==1
+  if (c.gdal) {
+    DiskImageResourceGDAL::Options options;
+    if (c.compress != "NONE")
+      options["COMPRESS"] = c.compress;
+    options["BIGTIFF"] = "IF_SAFER";
+    // A block size makes a tiled file, and (-1,-1) GDAL's default strips.
+    Vector2i block = c.block_size.x() > 0 ? c.block_size : Vector2i(-1, -1);
+    return new DiskImageResourceGDAL(filename, format, block, options);
+  }
+#endif
+  return DiskImageResource::create(filename, format);
+}
+
+double seconds_since(uint64 start) {
+  return (Stopwatch::microtime() - start) * 1e-6;
+}
+
+/// The blocks a read fetches: whole blocks of the file, grouped until
+/// they reach the default tile size, so that a striped file is not read
+/// one scanline per task.
+Vector2i read_block_size(DiskImageResource const& rsrc) {
+  Vector2i block = rsrc.block_read_size();
+  int32 tile = vw_settings().default_tile_size();
+  for (int i=0; i<2; ++i) {
+    int32 extent = i == 0 ? rsrc.cols() : rsrc.rows();
+    block[i] = std::max(1, std::min(block[i], extent));
+    if (block[i] < tile)
+      block[i] *= (tile + block[i] - 1) / block[i];
+  }
+  return block;
+}
+
+template <class PixelT>
+void time_read(std::string const& name, std::string const& filename, Options const& opt,
+               int threads, std::vector<IoResult>& results) {
+  IoResult r;
+  r.name    = "read/" + name;
+  r.threads = threads;
+  r.seconds = -1;
+  for (int run=0; run<opt.repeat; ++run) {
+    uint64 start = Stopwatch::microtime();
+    boost::shared_ptr<DiskImageResource> rsrc(DiskImageResourcePtr(filename));
+    // No cache, so that every run reads the file.
+    DiskImageView<PixelT> view(rsrc, (Cache*)0);
+    ImageView<PixelT> image(view.cols(), view.rows(), view.planes());
+    block_rasterize(view, read_block_size(*rsrc), threads).rasterize(image, bounding_box(image));
+    double seconds = seconds_since(start);
+    if (r.seconds < 0 || seconds < r.seconds)
+      r.seconds = seconds;
+    Vector2i block = rsrc->block_read_size();
+    r.bytes  = double(image.cols()) * image.rows() * image.planes() * sizeof(PixelT);
+    r.blocks = double((image.cols() + block.x() - 1) / block.x()) * ((image.rows() + block.y() - 1) / block.y());
+  }
+  r.file_bytes = double(fs::file_size(filename));
+  results.push_back(r);
+}
+
+template <class PixelT>
+void time_write(WriteCase const& c, std::string const& filename, ImageView<PixelT> const& image,
+                Options const& opt, int threads, std::vector<IoResult>& results) {
+  IoResult r;
+  r.name    = "write/" + c.name;
+  r.threads = threads;
+  r.seconds = -1;
+  for (int run=0; run<opt.repeat; ++run) {
+    fs::remove(filename);
+    uint64 start = Stopwatch::microtime();
+    boost::scoped_ptr<DiskImageResource> rsrc(create_resource(c, filename, image.format()));
+    Vector2i block(image.cols(), image.rows());
+    if (rsrc->has_block_write()) {
+      block = rsrc->block_write_size();
+      block_write_image(*rsrc, image, ProgressCallback::dummy_instance(), threads);
+    } else {
+      write_image(*rsrc, image);
+    }
+    rsrc.reset(); // Flushes the file
+    double seconds = seconds_since(start);
+    if (r.seconds < 0 || seconds < r.seconds)
+      r.seconds = seconds;
+    r.blocks = double((image.cols() + block.x() - 1) / block.x()) * ((image.rows() + block.y() - 1) / block.y());
+  }
+  r.bytes      = double(image.cols()) * image.rows() * sizeof(PixelT);
+  r.file_bytes = double(fs::file_size(filename));
+  results.push_back(r);
+}
+
+void print_result(IoResult const& r) {
+  std::cout << std::left << std::setw(44) << r.name << std::right << std::fixed
+            << std::setw(8)  << r.threads
+            << std::setw(10) << std::setprecision(3) << r.seconds
+            << std::setw(10) << std::setprecision(1) << r.bytes / r.seconds / (1024*1024)
+            << std::setw(10) << std::setprecision(1) << r.blocks / r.seconds
+            << std::setw(10) << std::setprecision(2) << r.bytes / std::max(r.file_bytes, 1.0)
+            << std::endl;
+}
+
+/// A smooth image with some noise, which compresses like a real one
+/// rather than like a constant or random image.
+template <class PixelT>
+ImageView<PixelT> make_image(int size) {
+  typedef typename CompoundChannelType<PixelT>::type channel_type;
+  double range = ChannelRange<channel_type>::max();
+  ImageView<PixelT> image(size, size);
+  for (int row=0; row<size; ++row) {
+    for (int col=0; col<size; ++col) {
+      uint32 h = (uint32(col)*73856093u) ^ (uint32(row)*19349663u);
+      h ^= h >> 13;  h *= 0x5bd1e995u;  h ^= h >> 15;
+      double smooth = 0.5 + 0.2*std::sin(col*0.01) + 0.2*std::cos(row*0.013);
+      double value  = smooth + 0.05*((h & 0xFF) / 255.0 - 0.5);
+      for (int ch=0; ch<PixelNumChannels<PixelT>::value; ++ch)
+        compound_select_channel<channel_type&>(image(col,row), ch) = channel_type(range * value * (1.0 - 0.1*ch));
+    }
+  }
+  return image;
+}
+
+template <class PixelT>
+void run_sweep(Options const& opt, std::vector<IoResult>& results) {
+  for (size_t i=0; i<opt.read_files.size(); ++i) {
+    for (size_t t=0; t<opt.threads.size(); ++t) {
+      try {
+        time_read<PixelT>(fs::path(opt.read_files[i]).filename().string(), opt.read_files[i],
+                          opt, opt.threads[t], results);
+        print_result(results.back());
+      } catch (const Exception& e) {
+        std::cout << std::left << std::setw(44) << "read/" + opt.read_files[i] << " failed: " << e.what() << std::endl;
+      }
+    }
+  }
+
+  ImageView<PixelT> image = make_image<PixelT>(opt.size);
+  std::vector<WriteCase> cases = make_write_cases(opt);
+  for (size_t i=0; i<cases.size(); ++i) {
+    std::string filename = (fs::path(opt.dir) / ("io_benchmark" + cases[i].extension)).string();
+    for (size_t t=0; t<opt.threads.size(); ++t) {
+      try {
+        time_write(cases[i], filename, image, opt, opt.threads[t], results);
+        print_result(results.back());
+        time_read<PixelT>(cases[i].name, filename, opt, opt.threads[t], results);
+        print_result(results.back());
+      } catch (const Exception& e) {
+        std::cout << std::left << std::setw(44) << cases[i].name << " failed: " << e.what() << std::endl;
+      }
+    }
+    fs::remove(filename);
+  }
+}
+
+void write_json(std::string const& filename, Options const& opt, std::vector<IoResult> const& results) {
+  std::ofstream out(filename.c_str());
+  if (!out)
+    vw_throw(IOErr() << "Could not write " << filename << "\n");
+  out << std::setprecision(10);
+  out << "{\n  \"context\": {\n"
+      << "    \"executable\": \"io_benchmark\",\n"
+      << "    \"image_size\": " << opt.size << ",\n"
+      << "    \"pixel_type\": \"" << opt.pixel_type << "\",\n"
+      << "    \"repeat\": " << opt.repeat << "\n"
+      << "  },\n  \"benchmarks\": [\n";
+  for (size_t i=0; i<results.size(); ++i) {
+    IoResult const& r = results[i];
+    std::string name = r.name + "/threads:" + boost::lexical_cast<std::string>(r.threads);
+    out << "    {\n"
+        << "      \"name\": \"" << name << "\",\n"
+        << "      \"run_name\": \"" << name << "\",\n"
+        << "      \"run_type\": \"iteration\",\n"
+        << "      \"iterations\": 1,\n"
+        << "      \"real_time\": " << r.seconds * 1e3 << ",\n"
+        << "      \"cpu_time\": " << r.seconds * 1e3 << ",\n"
+        << "      \"time_unit\": \"ms\",\n"
+        << "      \"bytes_per_second\": " << r.bytes / r.seconds << ",\n"
+        << "      \"items_per_second\": " << r.blocks / r.seconds << ",\n"
+        << "      \"file_bytes\": " << r.file_bytes << "\n"
+        << "    }" << (i+1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+
+  Options opt;
+  std::string formats, compress, block_sizes, threads;
+
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help,h", "Display this help message")
+    ("size",        po::value(&opt.size)->default_value(4096),      "Width and height of the test image")
+    ("pixel-type",  po::value(&opt.pixel_type)->default_value("uint8"),
+     "Pixel type of the test image: uint8, uint16, float32 or rgb8")
+    ("formats",     po::value(&formats)->default_value("tif,png,jpg,exr"),
+     "Comma separated file extensions to write and read back")
+    ("block-sizes", po::value(&block_sizes)->default_value("256,512,1024,0"),
+     "GeoTIFF tile sizes to try, where 0 writes a striped file")
+    ("compress",    po::value(&compress)->default_value("NONE,LZW,DEFLATE"),
+     "GeoTIFF compressions to try")
+    ("threads",     po::value(&threads)->default_value("1,0"),
+     "Thread counts to try, where 0 is the default thread count")
+    ("repeat",      po::value(&opt.repeat)->default_value(3),       "Runs of each case, of which the best is reported")
+    ("read",        po::value(&opt.read_files),                     "Also time reading this existing file (repeatable)")
+    ("dir",         po::value(&opt.dir)->default_value("."),        "Directory for the files written")
+    ("json",        po::value(&opt.json_file)->default_value(""),   "Also write the results to this JSON file");
+
+  po::variables_map vm;
+  try {
+    po::store(po::command_line_parser(argc, argv).options(desc).run(), vm);
+    po::notify(vm);
+    opt.formats     = split_list<std::string>(formats);
+    opt.compress    = split_list<std::string>(compress);
+    opt.block_sizes = split_list<int>(block_sizes);
+    opt.threads     = split_list<int>(threads);
+  } catch (const std::exception& e) {
+    std::cout << "An error occurred while parsing command line arguments.\n\n" << e.what() << "\n\n" << desc;
+    return 1;
+  }
+  if (vm.count("help")) {
+    std::cout << "Usage: io_benchmark [options]\n\n" << desc << "\n";
+    return 0;
+  }
+  for (size_t t=0; t<opt.threads.size(); ++t)
+    if (opt.threads[t] <= 0)
+      opt.threads[t] = vw_settings().default_num_threads();
+  opt.repeat = std::max(opt.repeat, 1);
+
+  std::cout << std::left << std::setw(44) << "Case" << std::right
+            << std::setw(8) << "Threads" << std::setw(10) << "Seconds"
+            << std::setw(10) << "MB/s" << std::setw(10) << "Tiles/s" << std::setw(10) << "Ratio" << "\n"
+            << std::string(92, '-') << std::endl;
+
+  std::vector<IoResult> results;
+  try {
+    if      (opt.pixel_type == "uint8"  ) run_sweep<PixelGray<uint8>   >(opt, results);
+    else if (opt.pixel_type == "uint16" ) run_sweep<PixelGray<uint16>  >(opt, results);
+    else if (opt.pixel_type == "float32") run_sweep<PixelGray<float32> >(opt, results);
+    else if (opt.pixel_type == "rgb8"   ) run_sweep<PixelRGB<uint8>    >(opt, results);
+    else {
+      std::cout << "Unknown pixel type: " << opt.pixel_type << "\n";
+      return 1;
+    }
+    if (!opt.json_file.empty())
+      write_json(opt.json_file, opt, results);
+  } catch (const Exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
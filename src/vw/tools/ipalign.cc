@@ -74,7 +74,8 @@ struct Options {
   float matcher_threshold, detect_gain, tile_size;
   float inlier_threshold;
   int   ransac_iterations;
-  bool  single_scale, debug_images;
+  float ransac_confidence;
+  bool  single_scale, debug_images, sprt;
   bool  save_intermediate;
 };
 
@@ -229,6 +230,9 @@ void align_images( Options & opt ) {
       math::RandomSampleConsensus<math::HomographyFittingFunctor, math::InterestPointErrorMetric> 
                   ransac(math::HomographyFittingFunctor(), math::InterestPointErrorMetric(), opt.ransac_iterations, 
                          opt.inlier_threshold, ransac_ip1.size()/2, true);
+      ransac.set_num_threads(0);
+      ransac.set_confidence(opt.ransac_confidence);
+      ransac.set_sprt(opt.sprt);
       align_matrix = ransac(ransac_ip2, ransac_ip1);
       indices      = ransac.inlier_indices(align_matrix, ransac_ip2, ransac_ip1);
     }
@@ -236,6 +240,9 @@ void align_images( Options & opt ) {
       math::RandomSampleConsensus<math::AffineFittingFunctor, math::InterestPointErrorMetric> 
                   ransac(math::AffineFittingFunctor(), math::InterestPointErrorMetric(), opt.ransac_iterations, 
                          opt.inlier_threshold, ransac_ip1.size()/2, true);
+      ransac.set_num_threads(0);
+      ransac.set_confidence(opt.ransac_confidence);
+      ransac.set_sprt(opt.sprt);
       align_matrix = ransac(ransac_ip2, ransac_ip1);
       indices      = ransac.inlier_indices(align_matrix, ransac_ip2, ransac_ip1);
     }
@@ -339,6 +346,10 @@ void handle_arguments( int argc, char* argv[], Options& opt ) {
                            "RANSAC inlier threshold.")
     ("ransac-iterations", po::value(&opt.ransac_iterations)->default_value(100), 
                           "Number of RANSAC iterations.")
+    ("ransac-confidence", po::value(&opt.ransac_confidence)->default_value(0),
+                          "Stop RANSAC early once an all-inlier sample has been drawn with this probability, e.g. 0.99.  0 runs every iteration.")
+    ("sprt", po::bool_switch(&opt.sprt),
+             "Reject bad RANSAC models after scoring a few matches, with a sequential probability ratio test.")
     ("align-method", po::value(&opt.align_method)->default_value("similarity"),
                    "Choose similarity, homography, or epipolar image alignment.");
 
@@ -53,7 +53,8 @@ int main(int argc, char** argv) {
   std::string output_folder, interest_operator, descriptor_generator;
   float  ip_gain;
   uint32 ip_per_image = 0, ip_per_tile;
-  int    tile_size, num_threads, nodata_radius, print_num_ip, debug_image;
+  int    tile_size, num_threads, nodata_radius, print_num_ip, debug_image, tile_overlap;
+  double nms_radius;
   ImageView<double> integral;
   bool   no_orientation;
   bool   opencv_normalize = false;
@@ -74,6 +75,10 @@ int main(int argc, char** argv) {
      "The tile size for processing interest points. Useful when working with large images. Default: 256.")
     ("ip-per-tile",           po::value(&ip_per_tile)->default_value(250), 
      "Set the maximum number of IP to find in each tile. Default: 250.")
+    ("tile-overlap",         po::value(&tile_overlap)->default_value(32), 
+     "Read this many pixels of context around each tile so points near tile seams are not lost. Default: 32.")
+    ("nms-radius",           po::value(&nms_radius)->default_value(1.0), 
+     "After merging tiles, drop IP within this many pixels of a stronger IP. Set to 0 to disable. Default: 1.")
     ("gain,g",               po::value(&ip_gain)->default_value(1.0), 
      "Increasing this number will increase the gain at which interest points are detected. Default: 1.")
     ("single-scale", "Turn off scale-invariant interest point detection. This option only searches for interest points in the first octave of the scale space. Harris and LoG only.")
@@ -261,10 +266,12 @@ int main(int argc, char** argv) {
       HarrisInterestOperator interest_operator(IDEAL_HARRIS_THRESHOLD/ip_gain);
       if (!vm.count("single-scale")) {
         ScaledInterestPointDetector<HarrisInterestOperator> detector(interest_operator, ip_per_tile);
-        ip = detect_interest_points(image, detector, ip_per_tile);
+        ip = detect_interest_points(image, detector, ip_per_tile,
+                                    tile_overlap, nms_radius);
       } else {
         InterestPointDetector<HarrisInterestOperator> detector(interest_operator, ip_per_tile);
-        ip = detect_interest_points(image, detector, ip_per_tile);
+        ip = detect_interest_points(image, detector, ip_per_tile,
+                                    tile_overlap, nms_radius);
       }
     } else if ( interest_operator == "log") {
       // Use a scale-space Laplacian of Gaussian feature detector. The
@@ -273,20 +280,24 @@ int main(int argc, char** argv) {
       LogInterestOperator interest_operator(IDEAL_LOG_THRESHOLD/ip_gain);
       if (!vm.count("single-scale")) {
         ScaledInterestPointDetector<LogInterestOperator> detector(interest_operator, ip_per_tile);
-        ip = detect_interest_points(image, detector, ip_per_tile);
+        ip = detect_interest_points(image, detector, ip_per_tile,
+                                    tile_overlap, nms_radius);
       } else {
         InterestPointDetector<LogInterestOperator> detector(interest_operator, ip_per_tile);
-        ip = detect_interest_points(image, detector, ip_per_tile);
+        ip = detect_interest_points(image, detector, ip_per_tile,
+                                    tile_overlap, nms_radius);
       }
     } else if ( interest_operator == "obalog") {
       // OBALoG threshold is inversely proportional to gain ..
       OBALoGInterestOperator interest_operator(IDEAL_OBALOG_THRESHOLD/ip_gain);
       IntegralInterestPointDetector<OBALoGInterestOperator> detector( interest_operator, ip_per_tile );
-      ip = detect_interest_points(image, detector, ip_per_tile);
+      ip = detect_interest_points(image, detector, ip_per_tile,
+                                  tile_overlap, nms_radius);
     } else if ( interest_operator == "iagd") {
       // This is the default ASP implementation
       IntegralAutoGainDetector detector( ip_per_tile );
-      ip = detect_interest_points(image, detector, ip_per_tile);
+      ip = detect_interest_points(image, detector, ip_per_tile,
+                                  tile_overlap, nms_radius);
 #if defined(VW_HAVE_PKG_OPENCV) && VW_HAVE_PKG_OPENCV == 1
     } else if (detector_is_opencv) {
 
@@ -302,9 +313,11 @@ int main(int argc, char** argv) {
       }
       OpenCvInterestPointDetector detector(ocv_type, opencv_normalize, describeInDetect, ip_per_tile);
       if (has_nodata)
-        ip = detect_interest_points(masked_image, detector, ip_per_tile);
+        ip = detect_interest_points(masked_image, detector, ip_per_tile,
+                                    tile_overlap, nms_radius);
       else
-        ip = detect_interest_points(image, detector, ip_per_tile);
+        ip = detect_interest_points(image, detector, ip_per_tile,
+                                    tile_overlap, nms_radius);
     }
 #else // End OpenCV section
     } else {
@@ -23,6 +23,8 @@
 ///
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Math/BBox.h>
 #include <vw/Math/Geometry.h>
 #include <vw/Math/RANSAC.h>
@@ -36,9 +38,12 @@
 #include <vw/Mosaic/ImageComposite.h>
 #include <vw/Camera/CameraGeometry.h>
 #include <vw/InterestPoint/InterestData.h>
+#include <vw/InterestPoint/InterestPointSet.h>
 #include <vw/InterestPoint/Matcher.h>
 
 #include <vector>
+#include <algorithm>
+#include <list>
 #include <string>
 #include <sstream>
 #include <iostream>
@@ -132,12 +137,317 @@ static void write_match_image(std::string const& out_file_name,
   block_write_image( *rsrc, comp, TerminalProgressCallback( "tools.ipmatch", "Writing Debug:" ) );
 }
 
+/// Settings shared by every image pair.
+struct MatchOptions {
+  double      matcher_threshold;
+  std::string ransac_constraint, distance_metric, output_prefix;
+  float       inlier_threshold;
+  int         ransac_iterations;
+  double      ransac_confidence;
+  bool        non_kdtree, brute_force, debug_image, prosac, sprt;
+  double      bucket_size;
+  size_t      max_per_bucket;
+  size_t      num_pairs;
+};
+
+/// Holds the interest points of each image, and the FLANN index over
+/// them, so that they are loaded and built once no matter how many pairs
+/// an image is part of.  At most "capacity" images are kept.  When
+/// more are needed, the least recently used image that no pair is
+/// working on is dropped, and it is loaded again if needed later.
+class InterestPointCache {
+public:
+  struct Entry {
+    Mutex                                 mutex;
+    boost::shared_ptr<InterestPointSet  > points;
+    boost::shared_ptr<InterestPointIndex> index;
+  };
+  typedef boost::shared_ptr<Entry> EntryPtr;
+
+  InterestPointCache(std::vector<std::string> const& vwip_paths, size_t capacity,
+                     math::FLANN_DistType dist_type, std::string const& index_dir = "")
+    : m_vwip_paths(vwip_paths), m_entries(vwip_paths.size()),
+      m_capacity(std::max(capacity, size_t(1))), m_dist_type(dist_type),
+      m_index_dir(index_dir), m_num_loads(0) {}
+
+  /// The points of image i, loaded if needed.  The image stays in the
+  /// cache while the returned pointer is held.
+  EntryPtr get(size_t i) {
+    EntryPtr entry;
+    {
+      Mutex::Lock lock(m_mutex);
+      if (m_entries[i])
+        m_loaded.remove(i);
+      else
+        m_entries[i].reset(new Entry);
+      m_loaded.push_back(i);
+      entry = m_entries[i];
+      evict();
+    }
+    Mutex::Lock lock(entry->mutex);
+    if (!entry->points) {
+      entry->points.reset(new InterestPointSet(read_binary_ip_file_set(m_vwip_paths[i])));
+      Mutex::Lock count_lock(m_mutex);
+      ++m_num_loads;
+    }
+    return entry;
+  }
+
+  /// The FLANN index of an entry, built the first time it is asked for.
+  boost::shared_ptr<InterestPointIndex> index(Entry& entry) {
+    Mutex::Lock lock(entry.mutex);
+    if (!entry.index && !entry.points->empty())
+      entry.index.reset(new InterestPointIndex(*entry.points, m_dist_type, m_index_dir));
+    return entry.index;
+  }
+
+  size_t num_loads() {
+    Mutex::Lock lock(m_mutex);
+    return m_num_loads;
+  }
+
+private:
+  // Drop unused images, oldest first, until the cache fits.  Only the
+  // cache holds a pointer to an unused entry.  Must be called with
+  // m_mutex held.
+  void evict() {
+    std::list<size_t>::iterator iter = m_loaded.begin();
+    while (m_loaded.size() > m_capacity && iter != m_loaded.end()) {
+      if (m_entries[*iter].use_count() == 1) {
+        m_entries[*iter].reset();
+        iter = m_loaded.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+  }
+
+  std::vector<std::string> m_vwip_paths;
+  std::vector<EntryPtr>    m_entries;
+  std::list<size_t>        m_loaded; // Least recently used first
+  size_t                   m_capacity;
+  math::FLANN_DistType     m_dist_type;
+  std::string              m_index_dir; // Saved FLANN indices, if not empty
+  size_t                   m_num_loads;
+  Mutex                    m_mutex;
+};
+
+// Match one pair of images, apply RANSAC, and write the match file.
+// The log is returned instead of printed so that output from pairs
+// running in parallel does not interleave.
+static std::string match_pair(InterestPointCache& cache, MatchOptions const& opt,
+                              std::vector<std::string> const& image_paths,
+                              size_t i, size_t j) {
+  std::ostringstream log;
+  std::vector<InterestPoint> matched_ip1, matched_ip2;
+  std::vector<float>         match_ratios; // Lower is more distinctive
+  {
+    InterestPointCache::EntryPtr entry1 = cache.get(i), entry2 = cache.get(j);
+    InterestPointSet const& ip1 = *entry1->points;
+    InterestPointSet const& ip2 = *entry2->points;
+
+    log << "Matching between " << image_paths[i] << " (" << ip1.size()
+        << " points) and "     << image_paths[j] << " (" << ip2.size() << " points).\n";
+    log << "Using distance metric: " << opt.distance_metric << std::endl;
+
+    if (opt.non_kdtree) {
+      // Run interest point matcher that does not use KDTree algorithm.
+      std::vector<InterestPoint> list1 = ip1.to_vector(), list2 = ip2.to_vector();
+      if (opt.distance_metric == "l2") {
+        InterestPointMatcherSimple<L2NormMetric, NullConstraint> matcher(opt.matcher_threshold);
+        matcher(list1, list2, matched_ip1, matched_ip2);
+      } else {
+        InterestPointMatcherSimple<HammingMetric, NullConstraint> matcher(opt.matcher_threshold);
+        matcher(list1, list2, matched_ip1, matched_ip2);
+      }
+      // This matcher does not report ratios, so all matches rank the same.
+      match_ratios.assign(matched_ip1.size(), 1.0f);
+    } else {
+      // Run interest point matcher that uses KDTree algorithm, or the brute
+      // force search.  The FLANN index of the second image is shared.
+      std::vector<size_t> index_list;
+      std::vector<float>  ratios;
+      boost::shared_ptr<InterestPointIndex> ip2_index;
+      if (!opt.brute_force)
+        ip2_index = cache.index(*entry2);
+      MatcherBackend backend = opt.brute_force ? MatcherBackend_BruteForce : MatcherBackend_FLANN;
+      if (opt.distance_metric == "l2") {
+        InterestPointMatcher< L2NormMetric, NullConstraint> matcher(opt.matcher_threshold, L2NormMetric(),
+                                                                     NullConstraint(), false, backend);
+        if (ip2_index) matcher(ip1, ip2, *ip2_index, index_list, ratios);
+        else           matcher(ip1, ip2, index_list, ratios);
+      } else {
+        InterestPointMatcher< HammingMetric, NullConstraint> matcher(opt.matcher_threshold, HammingMetric(),
+                                                                      NullConstraint(), false, backend);
+        if (ip2_index) matcher(ip1, ip2, *ip2_index, index_list, ratios);
+        else           matcher(ip1, ip2, index_list, ratios);
+      }
+      for (size_t k = 0; k < index_list.size(); ++k) {
+        if (index_list[k] < ip2.size()) {
+          matched_ip1.push_back(ip1[k]);
+          matched_ip2.push_back(ip2[index_list[k]]);
+          match_ratios.push_back(ratios[k]);
+        }
+      }
+    }
+  } // Release the cache entries
+
+  log << "Found " << matched_ip1.size() << " putative matches before duplicate removal.\n";
+
+  remove_duplicates(matched_ip1, matched_ip2, match_ratios);
+  log << "Found " << matched_ip1.size() << " putative matches.\n";
+
+  // Thin dense clusters of matches so RANSAC sees an even spread.
+  if (opt.bucket_size > 0) {
+    std::vector<size_t> keep = bucket_matches(matched_ip1, match_ratios,
+                                              opt.bucket_size, opt.max_per_bucket);
+    for (size_t k = 0; k < keep.size(); ++k) {
+      matched_ip1 [k] = matched_ip1 [keep[k]];
+      matched_ip2 [k] = matched_ip2 [keep[k]];
+      match_ratios[k] = match_ratios[keep[k]];
+    }
+    matched_ip1.resize(keep.size());
+    matched_ip2.resize(keep.size());
+    match_ratios.resize(keep.size());
+    log << "Kept " << matched_ip1.size() << " matches after bucketing.\n";
+  }
+
+  // For PROSAC, rank the matches from the most to the least distinctive.
+  std::vector<size_t> sample_order;
+  if (opt.prosac) {
+    std::vector<std::pair<float,size_t> > ranked(match_ratios.size());
+    for (size_t k = 0; k < ranked.size(); ++k)
+      ranked[k] = std::make_pair(match_ratios[k], k);
+    std::sort(ranked.begin(), ranked.end());
+    for (size_t k = 0; k < ranked.size(); ++k)
+      sample_order.push_back(ranked[k].second);
+  }
+
+  std::vector<Vector3> ransac_ip1 = iplist_to_vectorlist(matched_ip1),
+                       ransac_ip2 = iplist_to_vectorlist(matched_ip2);
+  std::vector<size_t> indices;
+  try {
+    // RANSAC is used to fit a transform between the matched sets
+    // of points.  Points that don't meet this geometric
+    // contstraint are rejected as outliers.
+    if (opt.ransac_constraint == "similarity") {
+      math::RandomSampleConsensus<math::SimilarityFittingFunctor, 
+                                  math::InterestPointErrorMetric> 
+          ransac( math::SimilarityFittingFunctor(),
+                  math::InterestPointErrorMetric(),
+                  opt.ransac_iterations,
+                  opt.inlier_threshold,
+                  ransac_ip1.size()/2, true);
+      ransac.set_sample_order(sample_order);
+      ransac.set_confidence(opt.ransac_confidence);
+      ransac.set_sprt(opt.sprt);
+      Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
+      log << "\t--> Similarity: " << H << "\n";
+      indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
+    } else if (opt.ransac_constraint == "homography") {
+      math::RandomSampleConsensus<math::HomographyFittingFunctor, 
+                                  math::InterestPointErrorMetric> 
+          ransac( math::HomographyFittingFunctor(),
+                  math::InterestPointErrorMetric(),
+                  opt.ransac_iterations,
+                  opt.inlier_threshold,
+                  ransac_ip1.size()/2, true);
+      ransac.set_sample_order(sample_order);
+      ransac.set_confidence(opt.ransac_confidence);
+      ransac.set_sprt(opt.sprt);
+      Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
+      log << "\t--> Homography: " << H << "\n";
+      indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
+    } else if (opt.ransac_constraint == "fundamental") {
+      math::RandomSampleConsensus<camera::FundamentalMatrix8PFittingFunctor, 
+                                  camera::FundamentalMatrixDistanceErrorMetric> 
+          ransac( camera::FundamentalMatrix8PFittingFunctor(),
+                  camera::FundamentalMatrixDistanceErrorMetric(), 
+                  opt.ransac_iterations, 
+                  opt.inlier_threshold, 
+                  ransac_ip1.size()/2, true );
+      ransac.set_sample_order(sample_order);
+      ransac.set_confidence(opt.ransac_confidence);
+      ransac.set_sprt(opt.sprt);
+      Matrix<double> F(ransac(ransac_ip1,ransac_ip2));
+      log << "\t--> Fundamental: " << F << "\n";
+      indices = ransac.inlier_indices(F,ransac_ip1,ransac_ip2);
+    } else { // none
+      indices.reserve( matched_ip1.size() );
+      for ( size_t k = 0; k < matched_ip1.size(); ++k )
+        indices.push_back(k);
+    }
+  } catch (const vw::math::RANSACErr& e ) {
+    log << "RANSAC Failed: " << e.what() << "\n";
+    return log.str();
+  }
+  log << "Found " << indices.size() << " final matches.\n";
+
+  std::vector<InterestPoint> final_ip1, final_ip2;
+  BOOST_FOREACH( size_t& index, indices ) {
+    final_ip1.push_back(matched_ip1[index]);
+    final_ip2.push_back(matched_ip2[index]);
+  }
+
+  // With several pairs, each needs its own output name.
+  std::string output_prefix;
+  if (opt.output_prefix == "")
+    output_prefix = fs::path(image_paths[i]).replace_extension().string() + "__" +
+                    fs::path(image_paths[j]).stem().string();
+  else if (opt.num_pairs == 1)
+    output_prefix = opt.output_prefix;
+  else
+    output_prefix = fs::path(match_filename(opt.output_prefix, image_paths[i],
+                                            image_paths[j])).replace_extension().string();
+
+  log << "Writing match file: " << output_prefix+".match" << std::endl;
+  write_binary_match_file(output_prefix+".match", final_ip1, final_ip2);
+
+  if (opt.debug_image) {
+    log << "Writing debug image: " << output_prefix+".tif" << std::endl;
+    write_match_image(output_prefix+".tif",
+                      image_paths[i], image_paths[j],
+                      final_ip1, final_ip2);
+  }
+  return log.str();
+}
+
+/// Matches one image pair on a worker thread.
+class MatchPairTask : public Task {
+  InterestPointCache             & m_cache;
+  MatchOptions              const& m_options;
+  std::vector<std::string>  const& m_image_paths;
+  size_t                           m_i, m_j;
+  Mutex                          & m_log_mutex;
+  size_t                         & m_num_done;
+public:
+  MatchPairTask(InterestPointCache& cache, MatchOptions const& options,
+                std::vector<std::string> const& image_paths, size_t i, size_t j,
+                Mutex& log_mutex, size_t& num_done)
+    : m_cache(cache), m_options(options), m_image_paths(image_paths), m_i(i), m_j(j),
+      m_log_mutex(log_mutex), m_num_done(num_done) {}
+
+  virtual void operator()() {
+    std::string log;
+    try {
+      log = match_pair(m_cache, m_options, m_image_paths, m_i, m_j);
+    } catch (const std::exception& e) {
+      log = "Failed to match " + m_image_paths[m_i] + " and " + m_image_paths[m_j]
+          + ": " + e.what() + "\n";
+    }
+    Mutex::Lock lock(m_log_mutex);
+    ++m_num_done;
+    vw_out() << log << "Finished pair " << m_num_done << " of " << m_options.num_pairs << ".\n";
+  }
+};
+
 int main(int argc, char** argv) {
   std::vector<std::string> input_file_names;
   double      matcher_threshold;
-  std::string ransac_constraint, distance_metric_in, output_prefix;
+  std::string ransac_constraint, distance_metric_in, output_prefix, index_cache;
   float       inlier_threshold;
-  int         ransac_iterations;
+  int         ransac_iterations, num_threads, cache_size, max_per_bucket;
+  double      bucket_size, ransac_confidence;
 
   po::options_description general_options("Options");
   general_options.add_options()
@@ -147,6 +457,7 @@ int main(int argc, char** argv) {
     ("matcher-threshold,t", po::value(&matcher_threshold)->default_value(0.6), 
                             "Threshold for the separation between closest and next closest interest points.")
     ("non-kdtree",          "Use an implementation of the interest matcher that is not reliant on a KDTree algorithm")
+    ("brute-force",         "Find the nearest neighbors with an exact, tiled brute force search instead of FLANN.")
     ("distance-metric,m",   po::value(&distance_metric_in)->default_value("L2"), 
                             "Distance metric to use.  Choose one of: [L2 (default), Hamming (only for binary types like ORB)].")
     ("ransac-constraint,r", po::value(&ransac_constraint)->default_value("similarity"), 
@@ -155,6 +466,20 @@ int main(int argc, char** argv) {
                             "RANSAC inlier threshold.")
     ("ransac-iterations",   po::value(&ransac_iterations)->default_value(100), 
                             "Number of RANSAC iterations.")
+    ("ransac-confidence",   po::value(&ransac_confidence)->default_value(0),
+                            "Stop RANSAC early once an all-inlier sample has been drawn with this probability, e.g. 0.99.  0 runs every iteration.")
+    ("sprt",                "Reject bad RANSAC models after scoring a few matches, with a sequential probability ratio test.")
+    ("prosac",              "Draw the RANSAC samples from the most distinctive matches first (PROSAC).")
+    ("bucket-size",         po::value(&bucket_size)->default_value(0),
+                            "Before RANSAC, keep at most max-per-bucket matches in each square of this many pixels in the first image.  0 disables this.")
+    ("max-per-bucket",      po::value(&max_per_bucket)->default_value(1),
+                            "Matches kept in each bucket, the most distinctive first.")
+    ("threads",             po::value(&num_threads)->default_value(0),
+                            "Number of image pairs to match at once.  The default is the number of Vision Workbench threads.")
+    ("cache-size",          po::value(&cache_size)->default_value(16),
+                            "Maximum number of images whose interest points and search index are kept in memory.")
+    ("index-cache",         po::value(&index_cache)->default_value(""),
+                            "Save the FLANN index of each image in this directory, and reuse it in later runs with the same interest points.")
     ("debug-image,d",       "Write out debug images.");
 
   po::options_description hidden_options("");
@@ -210,131 +535,58 @@ int main(int argc, char** argv) {
     vwip_paths [i] = input_file_names[2*i+1];
   }
 
-  // Iterate over combinations of the input files and find interest points in each.
-  for (size_t i = 0; i < num_input_images; ++i) {
-    for (size_t j = i+1; j < num_input_images; ++j) {
-
-      // Read each file off disk
-      std::vector<InterestPoint> ip1, ip2;
-      ip1 = read_binary_ip_file(vwip_paths[i]);
-      ip2 = read_binary_ip_file(vwip_paths[j]);
-
-      vw_out() << "Matching between " << image_paths[i] << " (" << ip1.size() 
-               << " points) and "     << image_paths[j] << " (" << ip2.size() << " points).\n";
-
-      std::vector<InterestPoint> matched_ip1, matched_ip2;
-
-      //std::cout << "IP1 --> \n";
-      for (size_t k=0; k<ip1.size(); ++k) {
-      //  std::cout << ip1[i].to_string() << "\n";  
-        ip1[j].polarity = false; // HACK
-        ip2[j].polarity = false;
-      }
-
-      vw_out() << "Using distance metric: " << distance_metric_in << std::endl;
-      if ( !vm.count("non-kdtree") ) {
-        // Run interest point matcher that uses KDTree algorithm.
-        if (distance_metric == "l2") {
-          InterestPointMatcher< L2NormMetric, NullConstraint> matcher(matcher_threshold);
-          matcher(ip1, ip2, matched_ip1, matched_ip2, TerminalProgressCallback( "tools.ipmatch","Matching:"));
-        } 
-        if (distance_metric == "hamming") {
-          InterestPointMatcher< HammingMetric, NullConstraint> matcher(matcher_threshold);
-          matcher(ip1, ip2, matched_ip1, matched_ip2, TerminalProgressCallback( "tools.ipmatch","Matching:"));
-        }
-      } else {
-        // Run interest point matcher that does not use KDTree algorithm.
-        if (distance_metric == "l2") {
-          InterestPointMatcherSimple<L2NormMetric, NullConstraint> matcher(matcher_threshold);
-          matcher(ip1, ip2, matched_ip1, matched_ip2, TerminalProgressCallback( "tools.ipmatch","Matching:"));
-        }
-        if (distance_metric == "hamming") {
-          InterestPointMatcherSimple<HammingMetric, NullConstraint> matcher(matcher_threshold);
-          matcher(ip1, ip2, matched_ip1, matched_ip2, TerminalProgressCallback( "tools.ipmatch","Matching:"));
-        }
-      } // End non-KDTree case
-
-      vw_out() << "Found " << matched_ip1.size() << " putative matches before duplicate removal.\n";
-
-      remove_duplicates(matched_ip1, matched_ip2);
-      vw_out() << "Found " << matched_ip1.size() << " putative matches.\n";
-
-      std::vector<Vector3> ransac_ip1 = iplist_to_vectorlist(matched_ip1),
-                           ransac_ip2 = iplist_to_vectorlist(matched_ip2);
-      std::vector<size_t> indices;
-      try {
-        // RANSAC is used to fit a transform between the matched sets
-        // of points.  Points that don't meet this geometric
-        // contstraint are rejected as outliers.
-        if (ransac_constraint == "similarity") {
-          math::RandomSampleConsensus<math::SimilarityFittingFunctor, 
-                                      math::InterestPointErrorMetric> 
-              ransac( math::SimilarityFittingFunctor(),
-                      math::InterestPointErrorMetric(),
-                      ransac_iterations,
-                      inlier_threshold,
-                      ransac_ip1.size()/2, true);
-          Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
-          std::cout << "\t--> Similarity: " << H << "\n";
-          indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
-        } else if (ransac_constraint == "homography") {
-          math::RandomSampleConsensus<math::HomographyFittingFunctor, 
-                                      math::InterestPointErrorMetric> 
-              ransac( math::HomographyFittingFunctor(),
-                      math::InterestPointErrorMetric(),
-                      ransac_iterations,
-                      inlier_threshold,
-                      ransac_ip1.size()/2, true);
-          Matrix<double> H(ransac(ransac_ip1,ransac_ip2));
-          std::cout << "\t--> Homography: " << H << "\n";
-          indices = ransac.inlier_indices(H,ransac_ip1,ransac_ip2);
-        } else if (ransac_constraint == "fundamental") {
-          math::RandomSampleConsensus<camera::FundamentalMatrix8PFittingFunctor, 
-                                      camera::FundamentalMatrixDistanceErrorMetric> 
-              ransac( camera::FundamentalMatrix8PFittingFunctor(),
-                      camera::FundamentalMatrixDistanceErrorMetric(), 
-                      ransac_iterations, 
-                      inlier_threshold, 
-                      ransac_ip1.size()/2, true );
-          Matrix<double> F(ransac(ransac_ip1,ransac_ip2));
-          std::cout << "\t--> Fundamental: " << F << "\n";
-          indices = ransac.inlier_indices(F,ransac_ip1,ransac_ip2);
-        } else if (ransac_constraint == "none") {
-          indices.reserve( matched_ip1.size() );
-          for ( size_t i = 0; i < matched_ip1.size(); ++i )
-            indices.push_back(i);
-        } else {
-          vw_out() << "Unknown RANSAC constraint type: " << ransac_constraint
-                   << ".  Choose one of: [similarity, homography, fundamental, or none]\n";
-          return 1;
-        }
-      } catch (const vw::math::RANSACErr& e ) {
-        vw_out() << "RANSAC Failed: " << e.what() << "\n";
-        continue;
-      }
-      vw_out() << "Found " << indices.size() << " final matches.\n";
-
-      std::vector<InterestPoint> final_ip1, final_ip2;
-      BOOST_FOREACH( size_t& index, indices ) {
-        final_ip1.push_back(matched_ip1[index]);
-        final_ip2.push_back(matched_ip2[index]);
-      }
+  if ((ransac_constraint != "similarity") && (ransac_constraint != "homography") &&
+      (ransac_constraint != "fundamental") && (ransac_constraint != "none")) {
+    vw_out() << "Unknown RANSAC constraint type: " << ransac_constraint
+             << ".  Choose one of: [similarity, homography, fundamental, or none]\n";
+    return 1;
+  }
 
-      if (output_prefix == "") {
-        output_prefix = fs::path(image_paths[i]).replace_extension().string() + "__" +
-                        fs::path(image_paths[j]).stem().string();
-      }
-      vw_out() << "Writing match file: " << output_prefix+".match" << std::endl;
-      write_binary_match_file(output_prefix+".match", final_ip1, final_ip2);
-
-      if (vm.count("debug-image")) {
-        vw_out() << "Writing debug image: " << output_prefix+".tif" << std::endl;
-        write_match_image(output_prefix+".tif",
-                          image_paths[i], image_paths[j],
-                          final_ip1, final_ip2);
+  MatchOptions opt;
+  opt.matcher_threshold = matcher_threshold;
+  opt.ransac_constraint = ransac_constraint;
+  opt.distance_metric   = distance_metric;
+  opt.output_prefix     = output_prefix;
+  opt.inlier_threshold  = inlier_threshold;
+  opt.ransac_iterations = ransac_iterations;
+  opt.ransac_confidence = ransac_confidence;
+  opt.non_kdtree        = vm.count("non-kdtree" ) != 0;
+  opt.brute_force       = vm.count("brute-force") != 0;
+  opt.debug_image       = vm.count("debug-image") != 0;
+  opt.prosac            = vm.count("prosac"     ) != 0;
+  opt.sprt              = vm.count("sprt"       ) != 0;
+  opt.bucket_size       = bucket_size;
+  opt.max_per_bucket    = std::max(max_per_bucket, 1);
+  opt.num_pairs         = num_input_images*(num_input_images-1)/2;
+
+  // Schedule the pairs in blocks of images so that the images in use
+  // at one time fit in the cache.
+  const size_t block_size = std::max(cache_size/2, 1);
+  std::vector<std::pair<size_t,size_t> > pairs;
+  for (size_t bi = 0; bi < num_input_images; bi += block_size) {
+    for (size_t bj = bi; bj < num_input_images; bj += block_size) {
+      for (size_t i = bi; i < std::min(bi+block_size, num_input_images); ++i) {
+        for (size_t j = std::max(bj, i+1); j < std::min(bj+block_size, num_input_images); ++j)
+          pairs.push_back(std::make_pair(i, j));
       }
     }
   }
 
+  const math::FLANN_DistType dist_type = (distance_metric == "hamming") ? HammingMetric::flann_type
+                                                                          : L2NormMetric::flann_type;
+  InterestPointCache cache(vwip_paths, cache_size, dist_type, index_cache);
+  Mutex  log_mutex;
+  size_t num_done = 0;
+  {
+    FifoWorkQueue queue(num_threads > 0 ? num_threads : vw_settings().default_num_threads());
+    for (size_t k = 0; k < pairs.size(); ++k)
+      queue.add_task(boost::shared_ptr<Task>(new MatchPairTask(cache, opt, image_paths,
+                                                               pairs[k].first, pairs[k].second,
+                                                               log_mutex, num_done)));
+    queue.join_all();
+  }
+  vw_out() << "Matched " << pairs.size() << " pairs, reading " << cache.num_loads()
+           << " interest point files.\n";
+
   return 0;
 }
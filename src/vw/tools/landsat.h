@@ -36,15 +36,6 @@
 */
 
 namespace vw {
-
-  // These definitions are needed to save the landsat image as stored in memory
-  template<> struct PixelFormatID<PixelMask<Vector<float,  7> > > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_8_CHANNEL; };
-  template<> struct PixelFormatID<PixelMask<Vector<uint16, 7> > > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_8_CHANNEL; };
-  template<> struct PixelFormatID<Vector<uint16, 7> > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_7_CHANNEL; };
-  template<> struct PixelFormatID<Vector<float, 7> > { static const PixelFormatEnum value = VW_PIXEL_GENERIC_7_CHANNEL; };
-
-
-
 namespace landsat {
 
 
@@ -107,23 +98,22 @@ public: // Definitions
 public: // Functions
 
   /// Constructor
-  SplitChannelFileView( std::vector<std::string> const& input_files)
-                  : m_input_files(input_files){
+  /// - Each file is opened once here rather than once per tile.
+  SplitChannelFileView( std::vector<std::string> const& input_files) {
     // Verify that the correct number of input files were passed in.
     if (input_files.size() != N)
       vw_throw( ArgumentErr() << "SplitChannelFileView created with incorrect number of input files!\n");
       
+    for (size_t i=0; i<input_files.size(); ++i)
+      m_channels.push_back(DiskImageView<T>(input_files[i]));
+
     // Record the image size to save time later
-    boost::shared_ptr<vw::DiskImageResource> resource1(vw::DiskImageResourcePtr(input_files[0]));
-    m_cols = resource1->format().cols;
-    m_rows = resource1->format().rows;
+    m_cols = m_channels[0].cols();
+    m_rows = m_channels[0].rows();
     
     // Make sure all images are the same size
-    for (size_t i=0; i<input_files.size(); ++i) {
-      boost::shared_ptr<vw::DiskImageResource> resource2(vw::DiskImageResourcePtr(input_files[i]));
-            
-      if ((m_cols != static_cast<int>(resource2->format().cols)) || 
-          (m_rows != static_cast<int>(resource2->format().rows))   )
+    for (size_t i=0; i<m_channels.size(); ++i) {
+      if ((m_cols != m_channels[i].cols()) || (m_rows != m_channels[i].rows()))
         vw_throw( ArgumentErr() << "SplitChannelFileView: Input files must all be the same size!\n");
     }
   }
@@ -147,8 +137,8 @@ public: // Functions
     ImageView<result_type> tile(bbox.width(), bbox.height());
     
     // Load info into the file one file at a time
-    for (size_t channel=0; channel<m_input_files.size(); ++channel) {
-      ImageView<T> temp = crop(DiskImageView<T>(m_input_files[channel]), bbox);
+    for (size_t channel=0; channel<m_channels.size(); ++channel) {
+      ImageView<T> temp = crop(m_channels[channel], bbox);
       select_channel(tile, channel) = temp;
     }
 
@@ -164,7 +154,7 @@ public: // Functions
  
 private: // Variables
 
-  std::vector<std::string> const m_input_files;
+  std::vector<DiskImageView<T> > m_channels;
   int m_cols, m_rows;
  
 }; // End class SplitChannelFileView
@@ -376,21 +366,24 @@ public:
 
 /// Compute the Floating Algae Index
 struct detect_water_fai_functor {
-  bool operator()( LandsatToaPixelType const& pixel) const {
+  template <class PixelT>
+  bool operator()( PixelT const& pixel) const {
     return pixel[NIR] + (pixel[RED] + (pixel[SWIR1] - pixel[RED])*(170/990));
   }
 };
 
 /// Compute NDTI (Turbidity) index
 struct detect_water_ndti_functor {
-  bool operator()( LandsatToaPixelType const& pixel) const {
+  template <class PixelT>
+  bool operator()( PixelT const& pixel) const {
     return compute_index(pixel[RED], pixel[GREEN]);
   }
 };
 
 /// Compute NDSI index
 struct detect_water_ndsi_functor {
-  bool operator()( LandsatToaPixelType const& pixel) const {
+  template <class PixelT>
+  bool operator()( PixelT const& pixel) const {
     return compute_index(pixel[GREEN], pixel[SWIR1]);
   }
 };
@@ -399,7 +392,9 @@ struct detect_water_ndsi_functor {
 //  Earth Engine files and have a bunch of hard coded constants.
 
 /// Guess if a pixel shows a cloud or not.
-bool detect_clouds(LandsatToaPixelType const& pixel) {
+/// - PixelT is a LandsatToaPixelType or any type with the same channels.
+template <class PixelT>
+bool detect_clouds(PixelT const& pixel) {
  
   // Compute several indicators of cloudiness and take the minimum of them.
   
@@ -439,7 +434,9 @@ float compute_water_threshold(float sun_angle_degrees) {
 
 
 /// Classifies one pixel as water or not.
-float detect_water(LandsatToaPixelType const& pixel) {
+/// - PixelT is a LandsatToaPixelType or any type with the same channels.
+template <class PixelT>
+float detect_water(PixelT const& pixel) {
 
     // Check this first!
     if (detect_clouds(pixel))
@@ -456,7 +453,7 @@ float detect_water(LandsatToaPixelType const& pixel) {
     score      = std::min(score, shadow_sum);
 
     // It also tends to be relatively bright in the blue band
-    std::vector<float> dark_values(5);
+    Vector<float, 5> dark_values;
     dark_values[0] = pixel[GREEN];
     dark_values[1] = pixel[RED];
     dark_values[2] = pixel[NIR];
@@ -518,6 +515,129 @@ public:
 };
 
 
+//=============================================================================
+// Band stack kernels
+// - These compute the same values as the functors above, but a whole tile at a
+//   time from one read of its bands.  See BandStackView.
+
+/// Convert a Landsat band stack to top-of-atmosphere values in place, the
+/// same as convert_to_toa() does for one pixel.
+void convert_to_toa(BandStackTile<NUM_BANDS_OF_INTEREST> &stack,
+                    LandsatMetadataContainer const& metadata) {
+  size_t n = stack.size();
+  for (int b=0; b<NUM_BANDS_OF_INTEREST; ++b) {
+    if (b == TEMP)
+      continue;
+    float  mult = metadata.toa_mult[b];
+    float  add  = metadata.toa_add [b];
+    float* band = stack.band(b);
+    for (size_t i=0; i<n; ++i)
+      band[i] = band[i]*mult + add;
+  }
+
+  // The temperature band goes through radiance instead.
+  // - This is hard coded to use the K constants from LS8 Band 10!
+  float  mult = metadata.rad_mult[TEMP];
+  float  add  = metadata.rad_add [TEMP];
+  float* temp = stack.band(TEMP);
+  for (size_t i=0; i<n; ++i) {
+    float temp_rad = temp[i]*mult + add;
+    temp[i] = metadata.k_constants[2] / log(metadata.k_constants[0]/temp_rad + 1.0);
+  }
+}
+
+/// Computes the TOA values of a Landsat tile, like LandsatToaFunctor.
+class LandsatToaKernel {
+  LandsatMetadataContainer m_metadata;
+public:
+  static const int num_bands = NUM_BANDS_OF_INTEREST;
+  typedef LandsatToaPixelType pixel_type;
+
+  LandsatToaKernel(LandsatMetadataContainer const& metadata)
+   : m_metadata(metadata) {}
+
+  void operator()(BandStackTile<num_bands> &stack, ImageView<pixel_type> &output) const {
+    convert_to_toa(stack, m_metadata);
+    size_t i = 0;
+    for (int r=0; r<output.rows(); ++r) {
+      for (int c=0; c<output.cols(); ++c) {
+        for (int b=0; b<num_bands; ++b)
+          output(c,r)[b] = stack.bands[b][i];
+        if (stack.valid[i])
+          validate(output(c,r));
+        else
+          invalidate(output(c,r));
+        ++i;
+      }
+    }
+  }
+}; // End class LandsatToaKernel
+
+/// Computes the raw water score of each valid pixel of a Landsat tile and
+/// hands it to ScoreFunctorT, which sets the output pixel.
+template <class ScoreFunctorT>
+class LandsatScoreKernelBase {
+  LandsatMetadataContainer m_metadata;
+  ScoreFunctorT            m_functor;
+public:
+  static const int num_bands = NUM_BANDS_OF_INTEREST;
+  typedef typename ScoreFunctorT::result_type pixel_type;
+
+  LandsatScoreKernelBase(LandsatMetadataContainer const& metadata, ScoreFunctorT const& functor)
+   : m_metadata(metadata), m_functor(functor) {}
+
+  void operator()(BandStackTile<num_bands> &stack, ImageView<pixel_type> &output) const {
+    convert_to_toa(stack, m_metadata);
+    Vector<float, NUM_BANDS_OF_INTEREST> pixel;
+    size_t i = 0;
+    for (int r=0; r<output.rows(); ++r) {
+      for (int c=0; c<output.cols(); ++c) {
+        if (stack.valid[i]) {
+          for (int b=0; b<num_bands; ++b)
+            pixel[b] = stack.bands[b][i];
+          output(c,r) = m_functor(detect_water(pixel));
+        } else {
+          output(c,r) = m_functor.nodata();
+        }
+        ++i;
+      }
+    }
+  }
+}; // End class LandsatScoreKernelBase
+
+/// Score handlers for LandsatScoreKernelBase.
+struct LandsatWaterThreshold {
+  typedef uint8 result_type;
+  float m_water_thresh;
+  LandsatWaterThreshold(float sun_elevation_degrees, double sensitivity)
+   : m_water_thresh(compute_water_threshold(sun_elevation_degrees)*sensitivity) {}
+  uint8 operator()(float score) const {
+    return (score > m_water_thresh) ? FLOOD_DETECT_WATER : FLOOD_DETECT_LAND;
+  }
+  uint8 nodata() const { return FLOOD_DETECT_NODATA; }
+};
+struct LandsatRawScore {
+  typedef float result_type;
+  float operator()(float score) const { return score; }
+  float nodata() const { return -1.0; }
+};
+
+/// Classifies the pixels of a Landsat tile, like DetectWaterLandsatFunctor.
+class LandsatWaterKernel : public LandsatScoreKernelBase<LandsatWaterThreshold> {
+public:
+  LandsatWaterKernel(LandsatMetadataContainer const& metadata, double sensitivity=1.0)
+   : LandsatScoreKernelBase<LandsatWaterThreshold>(metadata,
+       LandsatWaterThreshold(metadata.sun_elevation_degrees, sensitivity)) {}
+};
+
+/// DEBUG kernel for the raw water detection score, like DetectWaterLandsatFunctorScore.
+class LandsatScoreKernel : public LandsatScoreKernelBase<LandsatRawScore> {
+public:
+  LandsatScoreKernel(LandsatMetadataContainer const& metadata)
+   : LandsatScoreKernelBase<LandsatRawScore>(metadata, LandsatRawScore()) {}
+};
+
+
 /// The sensitivity option multiplies the water detection threshold and is
 /// an easy way to adjust the gross sensitivity of the algorithm.
 void detect_water(std::vector<std::string> const& image_files, std::string const& output_path,
@@ -547,7 +667,7 @@ void detect_water(std::vector<std::string> const& image_files, std::string const
               compute_water_threshold(metadata.sun_elevation_degrees)*sensitivity << std::endl;
 
     block_write_gdal_image("landsat_toa_input.tif",
-                           apply_mask(per_pixel_view(ls_image, LandsatToaFunctor(metadata)), 
+                           apply_mask(band_stack_view(ls_image, LandsatToaKernel(metadata)),
                                       Vector<float,  NUM_BANDS_OF_INTEREST>()),
                            true, georef,
                            false, 0,
@@ -555,16 +675,7 @@ void detect_water(std::vector<std::string> const& image_files, std::string const
                            TerminalProgressCallback("vw", "\t--> Writing TOA input:"));
                              
     block_write_gdal_image("landsat_raw_output.tif",
-                           apply_mask(
-                             per_pixel_view(
-                                per_pixel_view(
-                                  ls_image,
-                                  LandsatToaFunctor(metadata)
-                                ),
-                                DetectWaterLandsatFunctorScore()
-                             ),
-                             -1.0
-                           ),
+                           band_stack_view(ls_image, LandsatScoreKernel(metadata)),
                            true, georef,
                            true, -1.0,
                            write_options,
@@ -573,16 +684,7 @@ void detect_water(std::vector<std::string> const& image_files, std::string const
 
 
   block_write_gdal_image(output_path,
-                         apply_mask(
-                           per_pixel_view(
-                              per_pixel_view(
-                                ls_image,
-                                LandsatToaFunctor(metadata)
-                              ),
-                              DetectWaterLandsatFunctor(metadata.sun_elevation_degrees, sensitivity)
-                           ),
-                           FLOOD_DETECT_NODATA
-                         ),
+                         band_stack_view(ls_image, LandsatWaterKernel(metadata, sensitivity)),
                          true, georef,
                          true, FLOOD_DETECT_NODATA,
                          write_options,
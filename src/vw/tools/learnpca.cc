@@ -17,12 +17,13 @@
 
 
 #include <iostream>
+#include <string>
 #include <vw/InterestPoint/LearnPCA.h>
 
 int main(int argc, char *argv[])
 {
   if (argc < 2) {
-    std::cout << "learnpca <training image files...>"
+    std::cout << "learnpca [--randomized] <training image files...>"
               << std::endl;
     return 0;
   }
@@ -30,6 +31,10 @@ int main(int argc, char *argv[])
   LearnPCA lpca("pca_basis.exr", "pca_avg.exr");
 
   for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--randomized") {
+      lpca.set_randomized(true);
+      continue;
+    }
     vw::DiskImageView<vw::PixelRGB<vw::uint8> > disk_image(argv[i]);
     lpca.processImage(disk_image);
   }
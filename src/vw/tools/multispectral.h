@@ -365,6 +365,24 @@ public:
 };
 
 
+/// WorldView water classification of a valid pixel from its NDVI and NDWI2 indices.
+inline uint8 classify_water_worldview23(float ndvi, float ndwi2, double sensitivity) {
+  if ((ndvi < 0.1*sensitivity) || (ndwi2 < 0.3*sensitivity))
+    return FLOOD_DETECT_LAND;
+  if ((ndvi > 0.5*sensitivity) || (ndwi2 > 0.5*sensitivity))
+    return FLOOD_DETECT_WATER;
+  return FLOOD_DETECT_LAND;
+}
+
+/// SPOT water classification of a valid pixel from its NDVI and NDWI indices.
+inline uint8 classify_water_spot67(float ndvi, float ndwi, double sensitivity) {
+  // Very simple way to look for water!
+  if ((ndwi > 0.3*sensitivity) || ((ndvi+ndwi) > 0.6*sensitivity))
+    return FLOOD_DETECT_WATER;
+  return FLOOD_DETECT_LAND;
+}
+
+
 /// Use this to call detect_water on each pixel like this:
 /// --> = per_pixel_view(landsat_image, landsat::DetectWaterWorldView23Functor());
 /// - This seems to work fairly well except that it can confuse cloud shadows with water.
@@ -377,17 +395,8 @@ public:
   DetectWaterWorldView23Functor(double sensitivity=1.0) : m_sensitivity(sensitivity) {}
   
   uint8 operator()( WorldView23ToaPixelType const& pixel) const {
-    if (is_valid(pixel)){
-
-      float ndvi  = compute_ndvi(pixel);
-      float ndwi2 = compute_ndwi2(pixel);
-
-      if ((ndvi < 0.1*m_sensitivity) || (ndwi2 < 0.3*m_sensitivity))
-        return FLOOD_DETECT_LAND;
-      if ((ndvi > 0.5*m_sensitivity) || (ndwi2 > 0.5*m_sensitivity))
-        return FLOOD_DETECT_WATER;
-      return FLOOD_DETECT_LAND;
-    }
+    if (is_valid(pixel))
+      return classify_water_worldview23(compute_ndvi(pixel), compute_ndwi2(pixel), m_sensitivity);
     else
       return FLOOD_DETECT_NODATA;
   }
@@ -401,20 +410,149 @@ public:
   DetectWaterSpot67Functor(double sensitivity=1.0) : m_sensitivity(sensitivity) {}
   
   uint8 operator()( Spot67PixelType const& pixel) const {
-    if (is_valid(pixel)){
-      // Very simple way to look for water!
-      float ndvi  = compute_ndvi_spot(pixel);
-      float ndwi = compute_ndwi_spot(pixel);
-      //std::cout << "ndvi " << ndvi << ", ndwi " << ndwi <<std::endl;
-      if ((ndwi > 0.3*m_sensitivity) || ((ndvi+ndwi) > 0.6*m_sensitivity))
-        return FLOOD_DETECT_WATER;
-      return FLOOD_DETECT_LAND;
-    }
+    if (is_valid(pixel))
+      return classify_water_spot67(compute_ndvi_spot(pixel), compute_ndwi_spot(pixel), m_sensitivity);
     else
       return FLOOD_DETECT_NODATA;
   }
 };
 
+//=============================================================================
+// Band stack kernels
+// - These compute the same values as the functors above, but a whole tile at a
+//   time from one read of its bands.  See BandStackView.
+
+/// Convert a WorldView band stack to top-of-atmosphere values in place, the
+/// same as convert_to_toa() does for one pixel.
+void convert_to_toa(BandStackTile<NUM_WORLDVIEW_BANDS> &stack,
+                    WorldViewMetadataContainer const& metadata) {
+  float scale_factor = metadata.earth_sun_distance*metadata.earth_sun_distance*M_PI /
+                       cos(DEG_TO_RAD*(90.0 - metadata.mean_sun_elevation));
+  size_t n = stack.size();
+  for (int b=0; b<NUM_WORLDVIEW_BANDS; ++b) {
+    float  rad_scale = metadata.abs_cal_factor[b]/metadata.effective_bandwidth[b];
+    float* band      = stack.band(b);
+    for (size_t i=0; i<n; ++i) {
+      float rad = band[i]*rad_scale;
+      band[i] = rad * scale_factor / WORLDVIEW_ESUN[b];
+    }
+  }
+}
+
+/// Compute the SDI index along n pixels, the same as compute_sdi() does for one pixel.
+inline void compute_sdi(float const* nir2, float const* blue, float const* nir1, float* out, size_t n) {
+  for (size_t i=0; i<n; ++i) {
+    float denom = nir2[i] + blue[i];
+    out[i] = (denom == 0) ? 10.0f : ((nir2[i] - blue[i]) / denom) - nir1[i];
+  }
+}
+
+/// Computes the NDVI, NDWI2 and SDI indices of a WorldView tile, in that order.
+class WorldView23IndexKernel {
+  WorldViewMetadataContainer m_metadata;
+public:
+  static const int num_bands = NUM_WORLDVIEW_BANDS;
+  typedef PixelMask<Vector3f> pixel_type;
+
+  WorldView23IndexKernel(WorldViewMetadataContainer const& metadata)
+   : m_metadata(metadata) {}
+
+  void operator()(BandStackTile<num_bands> &stack, ImageView<pixel_type> &output) const {
+    convert_to_toa(stack, m_metadata);
+    size_t n = stack.size();
+    std::vector<float> ndvi(n), ndwi2(n), sdi(n);
+    compute_index(stack.band(RED    ), stack.band(NIR2), &ndvi [0], n);
+    compute_index(stack.band(COASTAL), stack.band(NIR2), &ndwi2[0], n);
+    compute_sdi  (stack.band(NIR2), stack.band(BLUE), stack.band(NIR1), &sdi[0], n);
+    size_t i = 0;
+    for (int r=0; r<output.rows(); ++r) {
+      for (int c=0; c<output.cols(); ++c) {
+        output(c,r) = pixel_type(Vector3f(ndvi[i], ndwi2[i], sdi[i]));
+        if (!stack.valid[i])
+          invalidate(output(c,r));
+        ++i;
+      }
+    }
+  }
+}; // End class WorldView23IndexKernel
+
+/// Classifies the pixels of a WorldView tile, like DetectWaterWorldView23Functor.
+class WorldView23WaterKernel {
+  WorldViewMetadataContainer m_metadata;
+  double m_sensitivity;
+public:
+  static const int num_bands = NUM_WORLDVIEW_BANDS;
+  typedef uint8 pixel_type;
+
+  WorldView23WaterKernel(WorldViewMetadataContainer const& metadata, double sensitivity=1.0)
+   : m_metadata(metadata), m_sensitivity(sensitivity) {}
+
+  void operator()(BandStackTile<num_bands> &stack, ImageView<pixel_type> &output) const {
+    convert_to_toa(stack, m_metadata);
+    size_t n = stack.size();
+    std::vector<float> ndvi(n), ndwi2(n);
+    compute_index(stack.band(RED    ), stack.band(NIR2), &ndvi [0], n);
+    compute_index(stack.band(COASTAL), stack.band(NIR2), &ndwi2[0], n);
+    size_t i = 0;
+    for (int r=0; r<output.rows(); ++r) {
+      for (int c=0; c<output.cols(); ++c) {
+        output(c,r) = stack.valid[i] ? classify_water_worldview23(ndvi[i], ndwi2[i], m_sensitivity)
+                                     : FLOOD_DETECT_NODATA;
+        ++i;
+      }
+    }
+  }
+}; // End class WorldView23WaterKernel
+
+/// Computes the NDVI and NDWI indices of a SPOT tile, in that order.
+class Spot67IndexKernel {
+public:
+  static const int num_bands = NUM_SPOT67_BANDS;
+  typedef PixelMask<Vector2f> pixel_type;
+
+  void operator()(BandStackTile<num_bands> &stack, ImageView<pixel_type> &output) const {
+    size_t n = stack.size();
+    std::vector<float> ndvi(n), ndwi(n);
+    compute_index(stack.band(SPOT_RED ), stack.band(SPOT_NIR), &ndvi[0], n);
+    compute_index(stack.band(SPOT_BLUE), stack.band(SPOT_NIR), &ndwi[0], n);
+    size_t i = 0;
+    for (int r=0; r<output.rows(); ++r) {
+      for (int c=0; c<output.cols(); ++c) {
+        output(c,r) = pixel_type(Vector2f(ndvi[i], ndwi[i]));
+        if (!stack.valid[i])
+          invalidate(output(c,r));
+        ++i;
+      }
+    }
+  }
+}; // End class Spot67IndexKernel
+
+/// Classifies the pixels of a SPOT tile, like DetectWaterSpot67Functor.
+class Spot67WaterKernel {
+  double m_sensitivity;
+public:
+  static const int num_bands = NUM_SPOT67_BANDS;
+  typedef uint8 pixel_type;
+
+  Spot67WaterKernel(double sensitivity=1.0) : m_sensitivity(sensitivity) {}
+
+  void operator()(BandStackTile<num_bands> &stack, ImageView<pixel_type> &output) const {
+    size_t n = stack.size();
+    std::vector<float> ndvi(n), ndwi(n);
+    compute_index(stack.band(SPOT_RED ), stack.band(SPOT_NIR), &ndvi[0], n);
+    compute_index(stack.band(SPOT_BLUE), stack.band(SPOT_NIR), &ndwi[0], n);
+    size_t i = 0;
+    for (int r=0; r<output.rows(); ++r) {
+      for (int c=0; c<output.cols(); ++c) {
+        output(c,r) = stack.valid[i] ? classify_water_spot67(ndvi[i], ndwi[i], m_sensitivity)
+                                     : FLOOD_DETECT_NODATA;
+        ++i;
+      }
+    }
+  }
+}; // End class Spot67WaterKernel
+
+
 // High level water detection function for WorldView.
 void detect_water_worldview23(std::vector<std::string> const& image_files, 
                               std::string const& output_path,
@@ -437,64 +575,18 @@ void detect_water_worldview23(std::vector<std::string> const& image_files,
     std::cout << "earth_sun_distance "  << metadata.earth_sun_distance  << std::endl;
     std::cout << "datetime "            << metadata.datetime            << std::endl;
     
-    block_write_gdal_image("ndvi.tif",
-                           apply_mask(
-                             per_pixel_view(
-                                per_pixel_view(wv_image, WorldView23ToaFunctor(metadata)),
-                                NdviFunctor()
-                             ),
-                             -999
-                           ),
-                           true, georef, true, -999, write_options,
-                           TerminalProgressCallback("vw", "\t--> NDVI"));
-/*
-    block_write_gdal_image("ndwi.tif",
-                           apply_mask(
-                             per_pixel_view(
-                                per_pixel_view(wv_image, WorldView3ToaFunctor(metadata)),
-                                NdwiFunctor()
-                             ),
-                             -999
-                           ),
+    // All of the indices are computed from one read of the image.
+    std::cout << "Writing NDVI, NDWI2 and SDI to the bands of indices.tif\n";
+    block_write_gdal_image("indices.tif",
+                           apply_mask(band_stack_view(wv_image, WorldView23IndexKernel(metadata)),
+                                      Vector3f(-999, -999, -999)),
                            true, georef, true, -999, write_options,
-                           TerminalProgressCallback("vw", "\t--> NDWI"));
-*/
-    block_write_gdal_image("ndwi2.tif",
-                           apply_mask(
-                             per_pixel_view(
-                                per_pixel_view(wv_image, WorldView23ToaFunctor(metadata)),
-                                Ndwi2Functor()
-                             ),
-                             -999
-                           ),
-                           true, georef, true, -999, write_options,
-                           TerminalProgressCallback("vw", "\t--> NDWI2"));    
-
-    block_write_gdal_image("sdi.tif",
-                           apply_mask(
-                             per_pixel_view(
-                                per_pixel_view(wv_image, WorldView23ToaFunctor(metadata)),
-                                SdiFunctor()
-                             ),
-                             -999
-                           ),
-                           true, georef, true, -999, write_options,
-                           TerminalProgressCallback("vw", "\t--> SDI"));
-    
+                           TerminalProgressCallback("vw", "\t--> Indices"));
   }
 
   // All the work happens when this call executes
   block_write_gdal_image(output_path,
-                         apply_mask(
-                           per_pixel_view(
-                              per_pixel_view(
-                                wv_image,
-                                WorldView23ToaFunctor(metadata)
-                              ),
-                              DetectWaterWorldView23Functor(sensitivity)
-                           ),
-                           FLOOD_DETECT_NODATA
-                         ),
+                         band_stack_view(wv_image, WorldView23WaterKernel(metadata, sensitivity)),
                          true, georef,
                          true, FLOOD_DETECT_NODATA,
                          write_options,
@@ -515,32 +607,18 @@ void detect_water_spot67(std::vector<std::string> const& image_files,
   load_spot67_image(image_files, spot_image, georef);
 
   if (debug) {
-    block_write_gdal_image("ndvi.tif",
-                           apply_mask(
-                             per_pixel_view(spot_image, NdviFunctorSpot67()),
-                             -999
-                           ),
-                           true, georef, true, -999, write_options,
-                           TerminalProgressCallback("vw", "\t--> NDVI"));
-
-    block_write_gdal_image("ndwi.tif",
-                           apply_mask(
-                             per_pixel_view(spot_image, NdwiFunctorSpot67()),
-                             -999
-                           ),
+    // Both indices are computed from one read of the image.
+    std::cout << "Writing NDVI and NDWI to the bands of indices.tif\n";
+    block_write_gdal_image("indices.tif",
+                           apply_mask(band_stack_view(spot_image, Spot67IndexKernel()),
+                                      Vector2f(-999, -999)),
                            true, georef, true, -999, write_options,
-                           TerminalProgressCallback("vw", "\t--> NDWI"));
+                           TerminalProgressCallback("vw", "\t--> Indices"));
   }
 
   // All the work happens when this call executes
   block_write_gdal_image(output_path,
-                         apply_mask(
-                           per_pixel_view(
-                             spot_image,
-                             DetectWaterSpot67Functor(sensitivity)
-                           ),
-                           FLOOD_DETECT_NODATA
-                         ),
+                         band_stack_view(spot_image, Spot67WaterKernel(sensitivity)),
                          true, georef,
                          true, FLOOD_DETECT_NODATA,
                          write_options,
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <boost/filesystem.hpp>
 #include <vw/Core/Functors.h>
+#include <vw/Core/Thread.h>
 #include <vw/Math/Functors.h>
 #include <vw/Math/Statistics.h>
 #include <vw/Image/Algorithms.h>
@@ -36,6 +37,9 @@
 #include <vw/Image/MaskViews.h>
 #include <vw/Image/UtilityViews.h>
 #include <vw/Image/PerPixelViews.h>
+#include <vw/Image/WindowAlgorithms.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/BlockImageOperator.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/Cartography/GeoTransform.h>
@@ -222,91 +226,136 @@ inline sentinel1_dn_to_db( ImageViewBase<ImageT> const& image) {
 }
 
 
-/// Crop and preprocess the input image in preparation for the sar_martinis algorithm.
+/// Returns a view of the input image cropped to roi and preprocessed for the
+/// sar_martinis algorithm.
+/// - Nothing is computed here, the view is evaluated a tile at a time by whatever
+///   reads it.
+/// - global_min and global_max are set to the range of the preprocessed values.
 template <class ImageT>
-void preprocess_sentinel1_image(ImageT const& input_image, BBox2i const& roi,
-                                RadarType &global_min, RadarType &global_max,
-                                cartography::GdalWriteOptions const& write_options,
-                                std::string const& temporary_path,
-                                double nodata_value,
-                                ImageViewRef<RadarTypeM>      & processed_image) {
-
-  // We write the preprocessed image to disk to save on processing time later.
+ImageViewRef<RadarTypeM> preprocess_sentinel1_image(ImageT const& input_image, BBox2i const& roi,
+                                                    RadarType &global_min, RadarType &global_max) {
 
   // The images all appear to fall in the 0-1000 value range.  If this changes more
   //  preprocessing will be needed.
 
-
   global_min = 0.0;  // This can be kept constant
   global_max = 35.0; // Computing this exact value has proven to be more expensize than it is worth.
 
   const double PROC_MIN = 0;   // The paper reccomends these scale values.
   const double PROC_MAX = 400;
 
-  // Preprocess image and write it to disk.
-  // - Perform median filter to correct speckles (see section 2.1.4)
+  // Perform median filter to correct speckles (see section 2.1.4)
   int kernel_size = 3;
-  cartography::block_write_gdal_image(temporary_path,
-                                      apply_mask(normalize(median_filter_view(sentinel1_dn_to_db(crop(input_image, roi)), 
-                                                                              Vector2i(kernel_size, kernel_size)
-                                                                             ),
-                                                 global_min, global_max, PROC_MIN, PROC_MAX),
-                                                 nodata_value
-                                                ),
-                                      nodata_value,
-                                      write_options,
-                                      TerminalProgressCallback("vw", "\t--> Preprocessing:"));
-
-  // Return a view of the image on disk so it never gets recomputed.
-  processed_image = create_mask(DiskImageView<RadarType>(temporary_path), nodata_value);
+  ImageViewRef<RadarTypeM> processed_image = 
+    normalize(median_filter_view(sentinel1_dn_to_db(crop(input_image, roi)), 
+                                 Vector2i(kernel_size, kernel_size)),
+              global_min, global_max, PROC_MIN, PROC_MAX);
 
   // Update these to reflect the scaled values
   global_min = PROC_MIN;
   global_max = PROC_MAX; 
 
+  return processed_image;
 } // End preprocess_sentinel1_image
 
-/// Class to compute the mean and standard deviation of the four sub-tiles from each input tile.
-/// - See the source paper from Martinis et al for details.
-/// - Each input tile produces a single pixel in the output image.
-template <class ImageT>
-class ImageTileMeansView : public ImageViewBase<ImageTileMeansView<ImageT> > {
 
-public: // Definitions
+/// Statistics of each tile of the preprocessed image, used to select the tiles
+/// that the water threshold is computed from.
+/// - See the source paper from Martinis et al for details.
+/// - Only whole tiles are included.
+struct Sentinel1TileStats {
+  int tile_size;
+
+  /// The mean and standard deviation of the means of the four sub-tiles of each tile.
+  ImageView<PixelMask<Vector2f> > means_stddevs;
+
+  /// The histogram of each tile, stored row first.
+  std::vector<math::Histogram> histograms;
+
+  void initialize(int cols, int rows, int tile_size_, int num_bins, 
+                  double min_val, double max_val) {
+    tile_size = tile_size_;
+    means_stddevs.set_size(cols/tile_size, rows/tile_size);
+    histograms.assign(means_stddevs.cols()*means_stddevs.rows(),
+                      math::Histogram(num_bins, min_val, max_val));
+  }
+}; // End struct Sentinel1TileStats
+
+
+/// Fine histogram of the preprocessed image which also records the sum of the
+/// values in each bin, and the count, sum and sum of squares of the DEM heights
+/// sampled at the pixels in each bin.
+/// - Once the water threshold is known, these give the mean value and the DEM
+///   statistics of the pixels below it without another pass over the image.
+struct Sentinel1ValueBins {
+  double min_val, max_val;
+  std::vector<double> count, sum, dem_count, dem_sum, dem_sum2;
+
+  void initialize(int num_bins, double min_val_, double max_val_) {
+    min_val = min_val_;
+    max_val = max_val_;
+    count.assign    (num_bins, 0);
+    sum.assign      (num_bins, 0);
+    dem_count.assign(num_bins, 0);
+    dem_sum.assign  (num_bins, 0);
+    dem_sum2.assign (num_bins, 0);
+  }
 
-  typedef PixelMask<Vector2f> pixel_type;
-  typedef pixel_type          result_type;
+  /// Values outside of the range go into the end bins.
+  int bin(double value) const {
+    int num_bins = static_cast<int>(count.size());
+    int b = static_cast<int>(floor((value - min_val) / (max_val - min_val) * num_bins));
+    return std::max(0, std::min(num_bins-1, b));
+  }
 
-private: // Variables
+  void merge(Sentinel1ValueBins const& other) {
+    for (size_t i=0; i<count.size(); ++i) {
+      count    [i] += other.count    [i];
+      sum      [i] += other.sum      [i];
+      dem_count[i] += other.dem_count[i];
+      dem_sum  [i] += other.dem_sum  [i];
+      dem_sum2 [i] += other.dem_sum2 [i];
+    }
+  }
 
-  ImageT const& m_input_image;
-  int m_width, m_height, m_tile_size;
+  /// Total of one of the bin vectors over the values at or below threshold.
+  /// - The bin containing the threshold is counted in proportion.
+  double total_below(std::vector<double> const& bins, double threshold) const {
+    double bin_width = (max_val - min_val) / static_cast<double>(bins.size());
+    double total     = 0;
+    for (size_t i=0; i<bins.size(); ++i) {
+      double bin_min = min_val + i*bin_width;
+      if (bin_min + bin_width <= threshold)
+        total += bins[i];
+      else {
+        if (bin_min < threshold)
+          total += bins[i] * (threshold - bin_min) / bin_width;
+        break;
+      }
+    }
+    return total;
+  }
+}; // End struct Sentinel1ValueBins
 
-public: // Functions
 
-  // Constructor
-  ImageTileMeansView( ImageT  const& input_image, int tile_size)
-                  : m_input_image(input_image), 
-                    m_width (input_image.cols()/tile_size), 
-                    m_height(input_image.rows()/tile_size), 
-                    m_tile_size(tile_size){}
-
-  inline int32 cols  () const { return m_width;  }
-  inline int32 rows  () const { return m_height; }
-  inline int32 planes() const { return 1; }
+/// Thread safe functor for block_op which gathers the tile statistics and the
+/// value bins from each block of the preprocessed image.
+/// - The blocks must be the size of the tiles.
+class Sentinel1PrepassFunctor {
 
-  inline result_type operator()( int32 i, int32 j, int32 p=0 ) const
-  { return 0; } // NOT IMPLEMENTED!
- 
-  typedef ProceduralPixelAccessor<ImageTileMeansView<ImageT> > pixel_accessor;
-  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+  Sentinel1TileStats * m_tile_stats;
+  Sentinel1ValueBins * m_value_bins;  ///< Not gathered if null.
+  ImageViewRef<PixelMask<float> > const* m_low_res_dem; ///< Optional, in image coordinates.
+  int   m_dem_subsample; ///< Pixels per low resolution DEM pixel.
+  Mutex m_mutex;
 
-  /// Compute the mean and percentage of valid pixels in an entire image
-  double mean_and_validity(CropView<ImageView<RadarTypeM> > const& image, double &mean) const {
+  /// Compute the mean and percentage of valid pixels in a region of an image.
+  template <class PixelT>
+  static double mean_and_validity(ImageView<PixelT> const& image, BBox2i const& roi, double &mean) {
     mean = 0;
     double count = 0, sum = 0;
-    for (int r=0; r<image.rows(); ++r) {
-      for (int c=0; c<image.cols(); ++c) {
+    for (int r=roi.min().y(); r<roi.max().y(); ++r) {
+      for (int c=roi.min().x(); c<roi.max().x(); ++c) {
         if (!is_valid(image(c,r)))
           continue;
         sum   += image(c,r);
@@ -315,93 +364,140 @@ public: // Functions
     }
     if (count > 0)
       mean = sum / count;
-    return count / static_cast<double>(image.rows() * image.cols());
+    return count / static_cast<double>(roi.width() * roi.height());
   }
-                           
 
-  typedef CropView<ImageView<result_type> > prerasterize_type;
-  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
-    
-    // This function is only set up for 1x1 output tiles.
-    if ((bbox.width() != 1) || (bbox.height() != 1))
-      vw_throw(LogicErr() << "ImageTileMeansView only works with 1x1 output tiles!");
-    
-    // Compute the bbox in the input image
-    BBox2i input_bbox = bbox;
-    input_bbox *= m_tile_size;
+  /// Fill in the statistics of the tile which covers the block.
+  template <class PixelT>
+  void tile_statistics(ImageView<PixelT> const& image, BBox2i const& bbox) {
+
+    int tile_size = m_tile_stats->tile_size;
+    int tile_col  = bbox.min().x() / tile_size;
+    int tile_row  = bbox.min().y() / tile_size;
+    if ((bbox.width() != tile_size) || (bbox.height() != tile_size) ||
+        (tile_col >= m_tile_stats->means_stddevs.cols()) ||
+        (tile_row >= m_tile_stats->means_stddevs.rows()))
+      return; // Partial tiles at the edges are not used.
 
     // Compute the four sub-ROIs
     const int NUM_SUB_ROIS = 4;
-    int hw = input_bbox.width() /2;
-    int hh = input_bbox.height()/2;
-    std::vector<BBox2i> sub_rois(NUM_SUB_ROIS); // ROIs relative to the whole tile
-    std::vector<double> means;
-    means.reserve(NUM_SUB_ROIS);
-    sub_rois[0] = BBox2i(0,  0,  hw, hh); // Top left
-    sub_rois[1] = BBox2i(hw, 0,  hw, hh); // Top right
-    sub_rois[2] = BBox2i(hw, hh, hw, hh); // Bottom right
-    sub_rois[3] = BBox2i(0,  hh, hw, hh); // Bottom left
-    
-    ImageView<RadarTypeM> section = crop(m_input_image, input_bbox);
+    int hw = tile_size/2;
+    BBox2i sub_rois[NUM_SUB_ROIS] = { BBox2i(0,  0,  hw, hw),   // Top left
+                                      BBox2i(hw, 0,  hw, hw),   // Top right
+                                      BBox2i(hw, hw, hw, hw),   // Bottom right
+                                      BBox2i(0,  hw, hw, hw) }; // Bottom left
 
     // Don't compute statistics from regions with a lot of bad pixels
     const double MIN_PERCENT_VALID = 0.95;
-    
+
     // Compute the mean in each of the four sub-rois
-    double percent_valid;
+    std::vector<double> means;
     for (int i=0; i<NUM_SUB_ROIS; ++i) {
       double mean;
-      percent_valid = mean_and_validity(crop(section, sub_rois[i]), mean);
-      if (percent_valid >= MIN_PERCENT_VALID)
+      if (mean_and_validity(image, sub_rois[i], mean) >= MIN_PERCENT_VALID)
         means.push_back(mean);
     }
-    bool is_valid = false;
+    bool valid = false;
     double mean_of_means   = 0;
     double stddev_of_means = 0;
     if (means.size() > 0) {
       // Compute the standard deviation of the means
       // - Currently both are set to zero if all pixels are invalid.
       mean_of_means = math::mean(means);
-      is_valid = (mean_of_means > 0);
-      if (is_valid)
+      valid = (mean_of_means > 0);
+      if (valid)
         stddev_of_means = math::standard_deviation(means, mean_of_means);
     }
 
-    // Set up the output image tile - only 1 by 1 pixel!
-    ImageView<result_type> tile(1, 1);
-    tile(0, 0)[0] = mean_of_means;
-    tile(0, 0)[1] = stddev_of_means;
-    if (!is_valid)
-      invalidate(tile(0, 0));
+    // Each tile is written by only one block so no lock is needed.
+    PixelMask<Vector2f> &result = m_tile_stats->means_stddevs(tile_col, tile_row);
+    result[0] = mean_of_means;
+    result[1] = stddev_of_means;
+    if (valid)
+      validate(result);
     else
-      validate(tile(0, 0));
+      invalidate(result);
 
-    // Return the tile we created with fake borders to make it look the size of the entire output image
-    return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    math::Histogram &hist = m_tile_stats->histograms[tile_row*m_tile_stats->means_stddevs.cols() + tile_col];
+    for (int r=0; r<image.rows(); ++r) {
+      for (int c=0; c<image.cols(); ++c) {
+        if (is_valid(image(c,r)))
+          hist.add_value(image(c,r));
+      }
+    }
+  }
 
-  } // End prerasterize function
+public:
 
- template <class DestT>
- inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
-   vw::rasterize( prerasterize(bbox), dest, bbox );
- }
+  Sentinel1PrepassFunctor(Sentinel1TileStats * tile_stats, Sentinel1ValueBins * value_bins,
+                          ImageViewRef<PixelMask<float> > const* low_res_dem, int dem_subsample)
+    : m_tile_stats(tile_stats), m_value_bins(value_bins), 
+      m_low_res_dem(low_res_dem), m_dem_subsample(dem_subsample) {}
 
-}; // End class ImageTileMeansView
+  template <class PixelT>
+  void operator()(ImageView<PixelT> const& image, BBox2i const& bbox) {
 
+    tile_statistics(image, bbox);
+    if (!m_value_bins)
+      return;
 
-/// Function to apply ImageTileMeansView on an image.
-template <class ImageT>
-void generate_tile_means(ImageT input_image, int tile_size,
-                         ImageView<PixelMask<Vector2f> > &tile_means_stddevs) {
+    Sentinel1ValueBins local;
+    local.initialize(m_value_bins->count.size(), m_value_bins->min_val, m_value_bins->max_val);
+    for (int r=0; r<image.rows(); ++r) {
+      for (int c=0; c<image.cols(); ++c) {
+        if (!is_valid(image(c,r)))
+          continue;
+        int b = local.bin(image(c,r));
+        local.count[b] += 1.0;
+        local.sum  [b] += image(c,r);
+      }
+    }
 
-  // Set up computation object 
-  ImageTileMeansView<ImageT> tile_mean_generator(input_image, tile_size);
- 
-  // Use multiple threads to process the image.
-  // - Each block generates one output pixel frome tile_sizeXtile_size input pixels.
-  tile_means_stddevs = block_rasterize(tile_mean_generator, Vector2i(1,1));
+    // The DEM is sampled at the pixels a subsampled image would keep.
+    int f = m_dem_subsample;
+    BBox2i low_res_bbox(Vector2i((bbox.min().x() + f-1)/f, (bbox.min().y() + f-1)/f),
+                        Vector2i((bbox.max().x() + f-1)/f, (bbox.max().y() + f-1)/f));
+    if (m_low_res_dem && !low_res_bbox.empty()) {
+      ImageView<PixelMask<float> > dem = crop(*m_low_res_dem, low_res_bbox);
+      for (int r=0; r<dem.rows(); ++r) {
+        for (int c=0; c<dem.cols(); ++c) {
+          PixelT const& pix = image((low_res_bbox.min().x() + c)*f - bbox.min().x(),
+                                    (low_res_bbox.min().y() + r)*f - bbox.min().y());
+          if (!is_valid(pix) || !is_valid(dem(c,r)))
+            continue;
+          int    b = local.bin(pix);
+          double h = dem(c,r).child();
+          local.dem_count[b] += 1.0;
+          local.dem_sum  [b] += h;
+          local.dem_sum2 [b] += h*h;
+        }
+      }
+    }
+
+    Mutex::Lock lock(m_mutex);
+    m_value_bins->merge(local);
+  }
+}; // End class Sentinel1PrepassFunctor
 
-} // End function generate_tile_means
+
+/// Gather the tile statistics and, if value_bins is set, the value bins of the
+/// preprocessed image in one multi-threaded pass.
+/// - value_bins must already be initialized.
+/// - If low_res_dem is set, the DEM statistics in value_bins are sampled from it.
+///   It must be in the coordinates of the image subsampled by dem_subsample.
+template <class ImageT>
+void sentinel1_prepass(ImageViewBase<ImageT> const& image, int tile_size,
+                       float global_min, float global_max,
+                       Sentinel1TileStats &tile_stats, Sentinel1ValueBins *value_bins,
+                       ImageViewRef<PixelMask<float> > const* low_res_dem = 0,
+                       int dem_subsample = 1) {
+  const int NUM_HIST_BINS = 255;
+  tile_stats.initialize(image.impl().cols(), image.impl().rows(), tile_size,
+                        NUM_HIST_BINS, global_min, global_max);
+
+  Sentinel1PrepassFunctor prepass_functor(&tile_stats, value_bins, low_res_dem, dem_subsample);
+  block_op(image, prepass_functor, Vector2i(tile_size, tile_size));
+} // End function sentinel1_prepass
 
 
 
@@ -511,10 +607,10 @@ size_t select_best_tiles(ImageView<PixelMask<Vector2f> >    & tile_means_stddevs
   find_image_min_max(tile_stddevs, stddev_min, stddev_max);
   
   int    num_bins = 255;
-  std::vector<double> hist;
+  math::Histogram hist;
   histogram(tile_stddevs, num_bins, stddev_min, stddev_max, hist);
   const double TILE_STDDEV_PERCENTILE_CUTOFF = 0.95;
-  int    bin = get_histogram_percentile(hist, TILE_STDDEV_PERCENTILE_CUTOFF);
+  int    bin = hist.get_percentile(TILE_STDDEV_PERCENTILE_CUTOFF);
   double bin_width      = (stddev_max - stddev_min)/static_cast<double>(num_bins);
   double std_dev_cutoff = stddev_min + bin_width*bin;
   if (debug)
@@ -602,33 +698,27 @@ size_t select_best_tiles(ImageView<PixelMask<Vector2f> >    & tile_means_stddevs
 } // End function select_best_tiles
 
 
-/// Use the kept tiles to compute a global water threshold for the entire image.
-bool compute_global_threshold(ImageViewRef<RadarTypeM> const& preprocessed_image, 
-                              std::vector<int>         const& kept_tile_indices,
-                              std::vector<BBox2i>      const& large_tile_boxes,
+/// Use the histograms of the kept tiles to compute a global water threshold for the entire image.
+bool compute_global_threshold(std::vector<math::Histogram> const& tile_histograms,
+                              std::vector<int>             const& kept_tile_indices,
                               float global_min, float global_max,
                               double &threshold_mean) {
 
   // For each selected tile, find optimal threshold using Kittler-Illingworth method.
-  // - Could compute in parallel, but this is not a big bottleneck.
-  int num_bins = 255;
   const size_t num_tiles = kept_tile_indices.size();
   std::vector<double> optimal_tile_thresholds(num_tiles);
-  double dmin = static_cast<double>(global_min);
-  double dmax = static_cast<double>(global_max);
-  //std::cout << "Histogram min = " << dmin << std::endl;
-  //std::cout << "Histogram max = " << dmax << std::endl;
   threshold_mean = 0;
   for (size_t i=0; i<num_tiles; ++i) {
   
-    // Compute tile histogram     
-    BBox2i   roi = large_tile_boxes[kept_tile_indices[i]]; // The ROIs are stored row-first.
-    std::vector<double> hist;
-    histogram(crop(preprocessed_image, roi), num_bins, dmin, dmax, hist);
+    // The tile histograms are stored row-first, like the tile indices.
+    math::Histogram const& tile_hist = tile_histograms[kept_tile_indices[i]];
+    int num_bins = tile_hist.get_num_bins();
+    std::vector<double> hist(num_bins);
+    for (int b=0; b<num_bins; ++b)
+      hist[b] = tile_hist.get_bin_value(b);
     
     // Compute optimal split
     optimal_tile_thresholds[i] = split_histogram_kittler_illingworth(hist, num_bins, global_min, global_max);
-    //std::cout << "For ROI " << roi << ", computed threshold " << optimal_tile_thresholds[i] << std::endl;
     threshold_mean += optimal_tile_thresholds[i];
   }
   threshold_mean /= static_cast<double>(num_tiles);
@@ -655,6 +745,392 @@ bool compute_global_threshold(ImageViewRef<RadarTypeM> const& preprocessed_image
 } // End compute_global_threshold
 
 //============================================================================
+// Sentinel-1 border cleaning, also used by the clean_sentinel1_borders tool.
+
+/// Default tile size for border cleaning, the farthest in that bad edges can be corrected.
+const int SENTINEL1_CLEAN_TILE_SIZE = 2048;
+
+/// Applies a median filter to a vector with a window size
+/// - TODO: Move to somewhere in VW, but first we need a place to put it.
+template <typename T>
+void window_median_filter(std::vector<T> const& v_in, std::vector<T> &v_out, const int width) {
+
+  // Setup
+  const int length = static_cast<int>(v_in.size());
+  const int half_width = width / 2;
+  v_out = v_in;
+
+  // Handle small input sizes
+  if ((width < 3) || (length < width))
+    return;
+  
+  // Just copy the first few elements
+  for (int i=0; i<half_width; ++i)
+    v_out[i] = v_in[i];
+
+  // Init a queue of neigboring values
+  std::list<T> locals;    
+  for (int i=0; i<width-1; ++i)    
+    locals.push_back(v_in[i]);
+
+  for (int i=half_width; i<length-half_width; ++i) {
+    // Load next value into queue
+    locals.push_back(v_in[i+half_width]);
+  
+    // Compute the median of the neigbors
+    v_out[i] = math::median(locals);
+  
+    // Drop oldest value
+    locals.pop_front();
+  }
+  // Just copy the last few elements
+  for (int i=length-half_width; i<length; ++i) {
+    v_out[i] = v_in[i];
+  }
+} // End median_filter
+
+
+/// Returns the percentage of values equal to a given value
+/// - T is a type that can be accessed with standard iterators.
+template <typename T>
+double percent_equal(T const& values, double equal_to) {
+
+  double count = 0;
+  typename T::const_iterator iter;
+  for (iter = values.begin(); iter != values.end(); ++iter) {
+    if (static_cast<double>(*iter) == equal_to)
+      count += 1.0;
+  }
+  return count / static_cast<double>(values.size());
+}
+
+/// Class to locate the best position (if any) of a jump from low pixel values to higher pixel values.
+/// - This is a somewhat arbitrary decision tuned for the available sentinel-1 data.
+/// - This class works by traversing inwards from the image border and maintaining three
+///   sets of pixels.  The leading list is filled up first, then the buffer list, then
+///   the trailing list.  The lead and buffer lists are capped at a fixed size, the trailing
+///   list has no size limit.  The statistics of the lead and trailing buffers are compared
+///   to try and identify the most likely border of real image pixels.
+class JumpFinder {
+public:
+
+  /// Constructor
+  /// - lead_size is the number of pixels it in the leading pixel set.
+  JumpFinder(int lead_size) 
+    : m_lead_size(static_cast<size_t>(lead_size)), 
+      m_best_position(0), m_best_score(15), m_trail_zero_count(0), m_trail_sum(0) {
+  }
+
+  /// Add a new value and return true if a jump was detected
+  bool add_value(double value) {
+  
+    const int    BUFFER_WIDTH = 1; // Keep this many numbers out of the statistics
+    const double CLOSE_ZERO   = 8; // Treat values this small as if they are zero
+  
+    // Add new value to the leading list
+    m_lead_list.push_front(value);
+    
+    if (m_lead_list.size() > m_lead_size) {
+      // Move back of lead list to the trailing list
+      m_buffer_list.push_front(m_lead_list.back());
+      m_lead_list.pop_back();
+      
+      if (m_buffer_list.size() > BUFFER_WIDTH) {
+        double trail_val = m_buffer_list.back();
+        if (trail_val <= CLOSE_ZERO)
+          ++m_trail_zero_count;
+        m_trail_list.push_front(trail_val);
+        m_buffer_list.pop_back();
+        m_trail_sum += trail_val;
+      }
+    }
+    
+    if (m_trail_list.empty()) // Nothing to do until lead buffer is filled
+      return false;
+
+    // Compute statistics
+    double mean_trail=0, mean_lead=0, dev_trail=0;
+    double trail_count  = static_cast<double>(m_trail_list.size());
+    double percent_zero = m_trail_zero_count / trail_count;
+    mean_lead = math::mean(m_lead_list);
+    if (percent_zero < 1.0) { // Save time on big blank regions
+      mean_trail = m_trail_sum / trail_count;
+      dev_trail  = math::standard_deviation(m_trail_list, mean_trail);
+    }
+    
+    const double MAX_DEV_TRAIL    = 5;    // After STD_DEV of trail portion is higher, not a good jump
+    const double MIN_PERCENT_ZERO = 0.30; // Must be this percent or higher zeroes in trail for a jump
+    const double DEV_TRAIL_BREAK  = 20;   // Quit if the trail deviation exceeds this threshold.
+
+    // Evaluate the value of an edge located at the start of the trail region
+    double score = (mean_lead - mean_trail); // Valid pixels should be much brighter than border junk
+    if ((dev_trail > MAX_DEV_TRAIL) || (percent_zero < MIN_PERCENT_ZERO))
+      score = 0;
+    //std::cout << "Lead  stats: " << mean_lead  << ", " << dev_lead  << std::endl;
+    //std::cout << "Trail stats: " << mean_trail << ", " << dev_trail 
+    //          << ", size = " << m_trail_list.size() << ", percent = " << percent_zero<< std::endl;
+    if (score > m_best_score) { // Record the best edge score to date
+      m_best_score    = score;
+      m_best_position = get_jump_index();
+    }
+    
+    // If one of these things is true, very unlikely to see the edge beyond this point.
+    return ((percent_zero < MIN_PERCENT_ZERO) || (dev_trail > DEV_TRAIL_BREAK)); 
+  }
+  
+  /// Return the index at which the jump occurs.
+  int get_jump_index() const {
+    return m_trail_list.size() + 1; // Advance into the buffer pixel
+  }
+  
+  int get_best_jump() const {
+    //printf("Best score = %lf and position %d\n", m_best_score, m_best_position);
+    return m_best_position;
+  }
+
+private:
+  size_t m_lead_size; ///< Max size of the lead list
+  std::list<double> m_lead_list;   ///< Values at the leading part of the window
+  std::list<double> m_trail_list;  ///< Values at the trailing part of the window
+  std::list<double> m_buffer_list; ///< Values in the middle part of the window.
+  int    m_best_position;    ///< Most likely jump position to date.
+  double m_best_score;       ///< Score at m_best_position
+  double m_trail_zero_count; ///< Number of zero pixels in the trailing buffer
+  double m_trail_sum;        ///< Sum of all pixels in the trailing buffer
+
+}; // End class JumpFinder
+
+
+/// View class which attempts to zero out the border noise on each border of the image.
+/// - Because this uses the standard VW tile implementation and does not share information
+///   between tiles, the maximum border size that can be handled is roughly the tile size.
+/// - The JumpFinder class is used to find the border in each row/column and a median filter
+///   is applied to those results to remove outliers.
+template <class ImageT>
+class Sentinel1CleanBordersView : public ImageViewBase<Sentinel1CleanBordersView<ImageT> > {
+
+public: // Definitions
+
+  typedef uint16     pixel_type;
+  typedef pixel_type result_type;
+
+private: // Variables
+
+  ImageT m_input_image;
+
+public: // Functions
+
+  // Constructor
+  Sentinel1CleanBordersView( ImageT  const& input_image)
+                  : m_input_image(input_image){}
+
+  inline int32 cols  () const { return m_input_image.cols(); }
+  inline int32 rows  () const { return m_input_image.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline result_type operator()( int32 i, int32 j, int32 p=0 ) const
+  { return 0; } // NOT IMPLEMENTED!
+ 
+  typedef ProceduralPixelAccessor<Sentinel1CleanBordersView<ImageT> > pixel_accessor;
+  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+  // Determin which edges of the image this tile is on
+  void check_bbox_edges(BBox2i const& bbox, bool &left, bool &right, bool &top, bool &bottom) const {
+    left   = (bbox.min().x() == 0);
+    top    = (bbox.min().y() == 0);
+    right  = (bbox.max().x() == cols());
+    bottom = (bbox.max().y() == rows());
+  }
+
+  // This function does most of the work
+  typedef CropView<ImageView<result_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+
+    ImageView<result_type> output_tile = crop(m_input_image, bbox);
+
+    // Check if this is a border tile.  If not, no processing will happen.
+    bool left_edge, right_edge, top_edge, bottom_edge;
+    check_bbox_edges(bbox, left_edge, right_edge, top_edge, bottom_edge);
+
+    const unsigned short NODATA_VALUE        = 0; // Output nodata flag
+    const int            MEDIAN_FILTER_WIDTH = 9; // Width of median filter applied to edge detect results
+    const int            JUMP_WIDTH          = 8; // Width of lead region in the JumpFinder class
+    
+    // For each line coming in from the border, choose the best break point.
+    int num_rows = bbox.height();
+    int num_cols = bbox.width();
+    
+    if (left_edge) {
+      std::vector<int> breaks(num_rows), breaks_filtered;
+      for (int r=0; r<num_rows; ++r) { // For each row in this tile
+        breaks[r] = 0; // Default if no jump found
+        JumpFinder edge_detector(JUMP_WIDTH);
+        // Keep iterating to the right until we detect the start of valid pixels
+        for (int c=0; c<num_cols; ++c) { // Move along the row     
+          int value = output_tile(c,r);
+          if (edge_detector.add_value(value))
+            break;
+        } // End col loop
+        breaks[r] = edge_detector.get_best_jump();
+      } // End row loop
+
+      // Smooth out the borders
+      window_median_filter(breaks, breaks_filtered, MEDIAN_FILTER_WIDTH);
+
+      // Update the output image
+      for (int r=0; r<num_rows; ++r) { // For each row in this tile
+        for (int c=0; c<=breaks_filtered[r]; ++c) // Move along the row
+          output_tile(c,r) = NODATA_VALUE;
+      }
+    } // End left edge case
+
+    if (right_edge) {
+      std::vector<int> breaks(num_rows), breaks_filtered;
+      for (int r=0; r<num_rows; ++r) { // For each row in this tile
+        //std::cout << "Row = " << r+bbox.min().y() << std::endl;
+        breaks[r] = num_cols-1; // Default if no jump found
+        JumpFinder edge_detector(JUMP_WIDTH);
+        // Keep iterating to the right until we detect the start of valid pixels
+        for (int c=num_cols-1; c>0; --c) { // Move along the row     
+          int value = output_tile(c,r);
+          if (edge_detector.add_value(value))
+            break;
+        } // End col loop
+        breaks[r] = num_cols-1 - edge_detector.get_best_jump();
+      } // End row loop
+
+      // Smooth out the borders
+      window_median_filter(breaks, breaks_filtered, MEDIAN_FILTER_WIDTH);
+
+      // Update the output image
+      for (int r=0; r<num_rows; ++r) { // For each row in this tile
+        for (int c=num_cols-1; c>=breaks_filtered[r]; --c) // Move along the row
+          output_tile(c,r) = NODATA_VALUE;
+      }
+    } // End right edge case
+
+    if (top_edge) {
+      std::vector<int> breaks(num_cols), breaks_filtered;
+      for (int c=0; c<num_cols; ++c) { // For each column in this tile
+        breaks[c] = 0; // Default if no jump found
+        JumpFinder edge_detector(JUMP_WIDTH);
+        // Keep iterating to the right until we detect the start of valid pixels
+        for (int r=0; r<num_rows; ++r) { // Move along the column
+          int value = output_tile(c,r);
+          if (edge_detector.add_value(value))
+            break;
+        } // End row loop
+        breaks[c] = edge_detector.get_best_jump();
+        //std::cout << "breaks[c] = " << breaks[c] << std::endl;
+      } // End col loop
+
+      // Smooth out the borders
+      window_median_filter(breaks, breaks_filtered, MEDIAN_FILTER_WIDTH);
+
+      // Update the output image
+      for (int c=0; c<num_cols; ++c) { // For each column in this tile
+        //std::cout << "breaks_filtered[c] = " << breaks_filtered[c] << std::endl;
+        for (int r=0; r<breaks_filtered[c]; ++r) // Move along the column
+          output_tile(c,r) = NODATA_VALUE;
+      }
+    } // End top edge case
+
+    if (bottom_edge) {
+      std::vector<int> breaks(num_cols), breaks_filtered;
+      for (int c=0; c<num_cols; ++c) { // For each column in this tile
+        breaks[c] = num_rows-1; // Default if no jump found
+        JumpFinder edge_detector(JUMP_WIDTH);
+        // Keep iterating to the right until we detect the start of valid pixels
+        for (int r=num_rows-1; r>0; --r) { // Move along the column
+          int value = output_tile(c,r);
+          if (edge_detector.add_value(value))
+            break;
+        } // End row loop
+        breaks[c] = num_rows-1 - edge_detector.get_best_jump();
+      } // End col loop
+
+      // Smooth out the borders
+      window_median_filter(breaks, breaks_filtered, MEDIAN_FILTER_WIDTH);
+
+      // Update the output image
+      for (int c=0; c<num_cols; ++c) { // For each column in this tile
+        for (int r=num_rows-1; r>breaks_filtered[c]; --r) // Move along the column
+          output_tile(c,r) = NODATA_VALUE;
+      }
+    } // End bottom edge case
+
+    // Return the tile we created with fake borders to make it look the size of the entire output image
+    return prerasterize_type(output_tile, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+
+  } // End prerasterize function
+
+ template <class DestT>
+ inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+   vw::rasterize( prerasterize(bbox), dest, bbox );
+ }
+}; // End class Sentinel1CleanBordersView
+
+/// Helper function
+template <class T>
+Sentinel1CleanBordersView<T> clean_sentinel1_borders(T const& input) {
+  return Sentinel1CleanBordersView<T>(input);
+}
+
+
+
+/// Compute an optimal tile size close to the input tile size
+/// - The purpose of this function is to avoid a potential issue caused
+///   by processing the image in tiles.  The edge cleaning is limited to
+///   the size of one tile and there is the potential for truncated partial
+///   tiles at the right and bottom edges of the images.
+/// - This function slightly changes the tile size to ensure that any 
+///   truncated tiles are at least close to a full tile size and will have
+///   adequate edge cleaning range.
+int compute_new_tile_size(int input_size, int image_size) {
+
+  // Define the safe range of percent size of edge tiles
+  double MIN_TILE_PERCENTAGE = 0.75;
+  double MAX_TILE_PERCENTAGE = 0.99;
+
+  // The current tile usage.  Last tile is the size of a tile at the right
+  //  or bottom of the tiling grid.
+  double num_tiles_used       = (double)image_size / (double)input_size;
+  double last_tile_percentage = num_tiles_used - floor(num_tiles_used);
+  
+  // If the input is in the acceptable range, keep it!
+  if ((last_tile_percentage >= MIN_TILE_PERCENTAGE) && (last_tile_percentage <= MAX_TILE_PERCENTAGE))
+    return input_size;
+
+  //printf("Adjusting input tile size:\n");
+  //printf("num_tiles = %lf, input tile size: %d\n", num_tiles_used, input_size);
+
+  // Otherwise the tile size should be adjusted.
+  
+  // Decide how many tiles to shoot for
+  double target_num_tiles = floor(num_tiles_used);
+  if (last_tile_percentage > 0.75)
+    target_num_tiles = ceil(num_tiles_used);
+  
+  // Compute new tile size, rounding up to ensure we don't end up with a tile sliver.
+  int tile_size = ceil((double)image_size / target_num_tiles);
+
+  //double first_num_tiles = (double)image_size / (double)tile_size;
+  //printf("first_num_tiles = %lf, Computed new tile size: %d\n", first_num_tiles, tile_size);
+
+  // GDAL block write sizes must be a multiple to 16 so if the input value is
+  //  not a multiple of 16 increase it until it is.  This should not have a significant
+  //  effect on the size of the border tiles.
+  const int TILE_MULTIPLE = 16;
+  if (tile_size % TILE_MULTIPLE != 0)
+    tile_size = ((tile_size / TILE_MULTIPLE) + 1) * TILE_MULTIPLE;
+    
+  //double new_num_tiles = (double)image_size / (double)tile_size;
+  //printf("new_num_tiles = %lf, Computed new tile size: %d\n", new_num_tiles, tile_size);
+    
+  return tile_size;
+}
+
+//============================================================================
 
 
 
@@ -662,18 +1138,20 @@ bool compute_global_threshold(ImageViewRef<RadarTypeM> const& preprocessed_image
       Martinis, Sandro, Jens Kersten, and Andre Twele. 
       "A fully automated TerraSAR-X based flood service." 
       ISPRS Journal of Photogrammetry and Remote Sensing 104 (2015): 203-212.
+
+    The image is read once in a parallel pre-pass which gathers everything needed to
+    find the water threshold, and then once more while the output is written.  Every
+    other stage is a view computed a tile at a time, so no full size intermediate
+    images are written to disk.
+    - If clean_borders is set the junk pixels at the borders of the image are removed
+      first, as clean_sentinel1_borders does.  This is only useful for an image which
+      is still in the sensor geometry but already has a georeference.
 */
 void sar_martinis(std::string const& input_image_path, std::string const& output_path,
                   cartography::GdalWriteOptions const& write_options,
                   std::string dem_path="", bool debug=false, int tile_size = 512,
-                  double sensitivity = 1.0) {
+                  double sensitivity = 1.0, bool clean_borders = false) {
 
-  // Set up paths to temporary files in the output folder.
-  boost::filesystem::path fs_path(output_path); 
-  fs_path = fs_path.parent_path().parent_path();
-  fs_path /= "preprocessed_image.tif";
-  std::string preprocessed_image_path = fs_path.string();
-  
   BBox2i roi = bounding_box(DiskImageView<Sentinel1Type>(input_image_path));
  
   // Load the georeference from the input image
@@ -692,52 +1170,104 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
   // Read nodata value
   double input_nodata_value = 0;
   read_nodata_val(input_image_path, input_nodata_value);
-   
-  // Compute the min and max values of the image
-  std::cout << "Preprocessing...\n";
 
-  // Apply any needed preprocessing to the image
-  double internal_nodata_value = -32767.0; // For use with our temporary files.
-  ImageViewRef<RadarTypeM> preprocessed_image; // This is a view of the image on disk.
+  // Tiles of the intermediate views are cached in the blocks the output is written in.
+  Vector2i cache_block_size = write_options.raster_tile_size;
+
+  ImageViewRef<PixelMask<Sentinel1Type> > input_image;
+  if (clean_borders) {
+    // The cleaning depends on the tiling so it is cached on the same tiles the
+    //  clean_sentinel1_borders tool uses.  Cleaned pixels are set to zero.
+    Vector2i clean_block_size(compute_new_tile_size(SENTINEL1_CLEAN_TILE_SIZE, roi.width ()),
+                              compute_new_tile_size(SENTINEL1_CLEAN_TILE_SIZE, roi.height()));
+    input_image = create_mask(block_cache(clean_sentinel1_borders(DiskImageView<Sentinel1Type>(input_image_path)),
+                                          clean_block_size), 
+                              Sentinel1Type(0));
+  } else {
+    input_image = create_mask(DiskImageView<Sentinel1Type>(input_image_path), input_nodata_value);
+  }
+
+  // Set up the preprocessed image
   RadarType global_min, global_max;
-  preprocess_sentinel1_image(create_mask(DiskImageView<Sentinel1Type>(input_image_path), input_nodata_value), 
-                             roi, global_min, global_max, 
-                             write_options, preprocessed_image_path, internal_nodata_value, preprocessed_image);
-  
+  ImageViewRef<RadarTypeM> preprocessed_image = 
+    preprocess_sentinel1_image(input_image, roi, global_min, global_max);
+
+  // The DEM statistics are computed at low resolution for speed.
+  const int DEM_STATS_SUBSAMPLE_FACTOR = 10;
+  typedef PixelMask<float> DemPixelType;
+  ImageView<DemPixelType>         low_res_dem;
+  ImageViewRef<DemPixelType>      low_res_dem_in_image_coords, dem_in_image_coords;
+  cartography::GeoReference       low_res_georef = resample(georef, 1.0/DEM_STATS_SUBSAMPLE_FACTOR);
+  if (!dem_path.empty()) {
+
+    // Should be safe to use this as a DEM nodata value!
+    double dem_nodata_value = -3.4028234663852886e+38;
+    read_nodata_val(dem_path, dem_nodata_value); 
+
+    DiskImageView<float> dem(dem_path);
+
+    cartography::GeoReference dem_georef;
+    if (!cartography::read_georeference(dem_georef, dem_path))
+      vw_throw(ArgumentErr() << "Failed to read DEM georeference!");
+
+    // Generate a low-resolution DEM in the coordinates of the subsampled image
+    // - This is used to compute image-wide statistics in a more reasonable amount of time
+    low_res_dem = subsample(create_mask(dem, dem_nodata_value), DEM_STATS_SUBSAMPLE_FACTOR);
+    cartography::GeoReference low_res_dem_georef = resample(dem_georef, 1.0/DEM_STATS_SUBSAMPLE_FACTOR);
+    int low_res_cols = (roi.width () + DEM_STATS_SUBSAMPLE_FACTOR - 1) / DEM_STATS_SUBSAMPLE_FACTOR;
+    int low_res_rows = (roi.height() + DEM_STATS_SUBSAMPLE_FACTOR - 1) / DEM_STATS_SUBSAMPLE_FACTOR;
+
+    low_res_dem_in_image_coords = 
+      cartography::geo_transform(low_res_dem, low_res_dem_georef, low_res_georef,
+                                 low_res_cols, low_res_rows, ConstantEdgeExtension());
+    dem_in_image_coords = 
+      cartography::geo_transform(create_mask(dem, dem_nodata_value), dem_georef, georef,
+                                 roi.width(), roi.height(), ConstantEdgeExtension());
+
+    if (debug) {
+      block_write_gdal_image("geotrans_dem.tif",
+                              apply_mask(dem_in_image_coords, dem_nodata_value),
+                             have_georef, georef, true, dem_nodata_value,
+                             write_options, TerminalProgressCallback("vw", "\t--> geotrans:"));
+    }
+  }
+
   // Perform the automatic threshold computation step.
   // - If it fails, try a second time with half-size tiles.
+  // - The value bins do not depend on the tile size so they are only gathered on the first pass.
   const int MAX_TILE_ATTEMPTS = 2;
+  const int NUM_VALUE_BINS    = 4096;
+  Sentinel1ValueBins value_bins;
+  value_bins.initialize(NUM_VALUE_BINS, global_min, global_max);
   bool   tile_thresh_success = false;
   double threshold_mean;
   for (int num_tile_attempts = 0; num_tile_attempts < MAX_TILE_ATTEMPTS; ++num_tile_attempts) {
     
-    // Generate vector of BBoxes for each tile in the input image (S+)
-    std::vector<BBox2i> large_tile_boxes = subdivide_bbox(bounding_box(preprocessed_image), 
-                                                          tile_size, tile_size, false);
-    
-    std::cout << "Computing tile means...\n";
+    std::cout << "Computing tile statistics...\n";
 
     // For each tile compute the mean value and the standard deviation of the four sub-tiles.
-    ImageView<PixelMask<Vector2f> > tile_means_stddevs; // These are much smaller than the input image
-    generate_tile_means(preprocessed_image, tile_size, tile_means_stddevs);
+    Sentinel1TileStats tile_stats; // These are much smaller than the input image
+    sentinel1_prepass(preprocessed_image, tile_size, global_min, global_max, tile_stats,
+                      (num_tile_attempts == 0) ? &value_bins : 0,
+                      dem_path.empty() ? 0 : &low_res_dem_in_image_coords,
+                      DEM_STATS_SUBSAMPLE_FACTOR);
 
     if (debug) {
       std::cout << "Writing DEBUG images...\n";
       float debug_nodata = -32768.0;
       block_write_gdal_image("tile_means.tif", 
-        apply_mask(select_channel(tile_means_stddevs, 0), debug_nodata), debug_nodata, write_options);
+        apply_mask(select_channel(tile_stats.means_stddevs, 0), debug_nodata), debug_nodata, write_options);
       block_write_gdal_image("tile_stddevs.tif", 
-        apply_mask(select_channel(tile_means_stddevs, 1), debug_nodata), debug_nodata, write_options);
+        apply_mask(select_channel(tile_stats.means_stddevs, 1), debug_nodata), debug_nodata, write_options);
     }
 
-
     // Select the tiles that we will use to compute the optimal global threshold.
     std::vector<int> kept_tile_indices;
-    size_t num_tiles_kept = select_best_tiles(tile_means_stddevs, kept_tile_indices, write_options, debug);
+    size_t num_tiles_kept = select_best_tiles(tile_stats.means_stddevs, kept_tile_indices, write_options, debug);
 
     if (num_tiles_kept > 0) {
       // Use the selected tiles to compute the optimal image threshold.
-      tile_thresh_success = compute_global_threshold(preprocessed_image, kept_tile_indices, large_tile_boxes,
+      tile_thresh_success = compute_global_threshold(tile_stats.histograms, kept_tile_indices,
                                                      global_min, global_max, threshold_mean);
     }
     
@@ -753,25 +1283,25 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
   if (!tile_thresh_success) {
     vw_throw(ArgumentErr() << "Unable to compute a good water threshold for this image!");
   }
+
+  // From here on the preprocessed image is read by several views, so share its tiles.
+  ImageViewRef<RadarTypeM> cached_image = block_cache(preprocessed_image, cache_block_size);
   
   // This will mask the water pixels, setting water pixels to 255, land pixels to 1, and invalid pixels to 0.
-  ImageViewRef<RadarTypeM> raw_water = threshold(preprocessed_image, threshold_mean, 
-                                                 FLOOD_DETECT_WATER, FLOOD_DETECT_LAND);
-
-  // Apply the initial threshold to the image and save it to disk!
-  std::string initial_water_detect_path = "initial_water_detect.tif";
-  block_write_gdal_image(initial_water_detect_path,
-                         pixel_cast<uint8>(apply_mask(raw_water, FLOOD_DETECT_NODATA)),
-                         have_georef, georef,
-                         true, FLOOD_DETECT_NODATA, // Choose the nodata value
-                         write_options,
-                         TerminalProgressCallback("vw", "\t--> Applying initial threshold:"));
-
+  ImageViewRef<uint8> raw_water = pixel_cast<uint8>(apply_mask(threshold(cached_image, threshold_mean, 
+                                                                         FLOOD_DETECT_WATER, FLOOD_DETECT_LAND),
+                                                               FLOOD_DETECT_NODATA));
+  if (debug) {
+    block_write_gdal_image("initial_water_detect.tif", raw_water,
+                           have_georef, georef,
+                           true, FLOOD_DETECT_NODATA, // Choose the nodata value
+                           write_options,
+                           TerminalProgressCallback("vw", "\t--> Applying initial threshold:"));
+  }
 
   // Get information needed for fuzzy logic results filtering
 
-  // Write out an image containing the water blob size at each pixel, then read it back in
-  // as needed to avoid recomputing the expensive blob computations.
+  // Set up the water blob size at each pixel.
   // - In order to parallelize this step, blob computations are approximated.
   //   Setting TILE_EXPAND (in pixels) to a larger number improves the approximation.
   
@@ -788,44 +1318,20 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
     std::cout << "Max blob size pixels = " << max_blob_size << std::endl;
   }
 
-  // Compute the blob sizes and record directly to disk so they are not recomputed.
-  std::string blobs_path = "blob_sizes.tif";
-  const uint32 BLOBS_NODATA = 0;
-  block_write_gdal_image(blobs_path,
-                         get_blob_sizes(create_mask_less_or_equal(DiskImageView<uint8>(initial_water_detect_path), FLOOD_DETECT_LAND),
-                                        TILE_EXPAND, max_blob_size),
-                         have_georef, georef,
-                         true, BLOBS_NODATA,
-                         write_options,
-                         TerminalProgressCallback("vw", "\t--> Counting blob sizes:"));
-  // Get handle of image on disk.
-  DiskImageView<uint32> blob_sizes(blobs_path);
-
-  // Compute these statistics at low resolution for speed.
-  int DEM_STATS_SUBSAMPLE_FACTOR = 10;
+  // The blob sizes are cached since the final flood fill reads expanded tiles.
+  ImageViewRef<PixelMask<uint8> > water_mask = create_mask_less_or_equal(raw_water, FLOOD_DETECT_LAND);
+  ImageViewRef<uint32> blob_sizes = block_cache(get_blob_sizes(water_mask, TILE_EXPAND, max_blob_size),
+                                                cache_block_size);
 
-  std::cout << "Computing mean of flooded regions...\n";
-
-  // Load a low-res version of our initial water results.
-  ImageViewRef<RadarTypeM> low_res_raw_water =  
-          copy_mask(subsample(preprocessed_image, DEM_STATS_SUBSAMPLE_FACTOR),
-                    subsample(create_mask_less_or_equal(DiskImageView<uint8>(initial_water_detect_path), 
-                                                                                     FLOOD_DETECT_LAND), 
-                                                                 DEM_STATS_SUBSAMPLE_FACTOR)
-                   );
-  cartography::GeoReference low_res_georef = resample(georef, 1.0/DEM_STATS_SUBSAMPLE_FACTOR);
-
-  // Compute mean radar value of pixels under initial water threshold
-  // - This is also computed at a lower resolution to increase speed.
-  // - Could do full res with a multi-threaded implementation.
-  double mean_raw_water_value = mean_channel_value(low_res_raw_water);
+  // Compute the mean radar value of pixels under the initial water threshold
+  // - The pre-pass binned every valid pixel by value, so this needs no more image reads.
+  double num_water_pixels = value_bins.total_below(value_bins.count, threshold_mean);
+  if (num_water_pixels <= 0)
+    vw_throw(ArgumentErr() << "No pixels are below the water threshold!");
+  double mean_raw_water_value = value_bins.total_below(value_bins.sum, threshold_mean) / num_water_pixels;
 
   std::cout << "Mean value of flooded regions = " << mean_raw_water_value << std::endl;
 
-  //block_write_gdal_image("low_res_water.tif", low_res_raw_water, 
-  //                       have_georef, low_res_georef, true, -9999,
-  //                       write_options, TerminalProgressCallback("vw", "\t--> DEBUG:"));
-
   // Go ahead and set up the fuzzy logic results that can be done without a DEM
 
   // Compute fuzzy classifications on four categories
@@ -836,7 +1342,7 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
  
   // SAR
   FuzzyFunctorZ radar_fuzz_functor(mean_raw_water_value, threshold_mean);
-  ImageViewRef<FuzzyPixelType> radar_fuzz = per_pixel_view(preprocessed_image, radar_fuzz_functor);
+  ImageViewRef<FuzzyPixelType> radar_fuzz = per_pixel_view(cached_image, radar_fuzz_functor);
 
   // Body size 
   FuzzyFunctorS blob_fuzz_functor(min_blob_size, max_blob_size);
@@ -865,46 +1371,17 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
   } else {
     // Handle the case where a DEM was provided
 
-    typedef PixelMask<float> DemPixelType;
-
-    // Should be safe to use this as a DEM nodata value!
-    double dem_nodata_value = -3.4028234663852886e+38;
-    read_nodata_val(dem_path, dem_nodata_value); 
-
-    DiskImageView<float> dem(dem_path);
-
-    cartography::GeoReference dem_georef;
-    if (!cartography::read_georeference(dem_georef, dem_path))
-      vw_throw(ArgumentErr() << "Failed to read DEM georeference!");
-
     std::cout << "Input DEM file found, using it to complete the calculations.\n";
 
-    // Generate a low-resolution DEM masked by the initial flood detection
-    // - This is used to compute image-wide statistics in a more reasonable amount of time
-    ImageView<DemPixelType> low_res_dem = subsample(create_mask(dem, dem_nodata_value), DEM_STATS_SUBSAMPLE_FACTOR);
-    cartography::GeoReference low_res_dem_georef = resample(dem_georef, 1.0/DEM_STATS_SUBSAMPLE_FACTOR);
-
-    ImageViewRef<PixelMask<float> > low_res_dem_in_image_coords = 
-      cartography::geo_transform(low_res_dem, low_res_dem_georef, low_res_georef,
-                                 low_res_raw_water.cols(), low_res_raw_water.rows(), ConstantEdgeExtension());
-    ImageViewRef<PixelMask<float> > dem_in_image_coords = 
-      cartography::geo_transform(create_mask(dem, dem_nodata_value), dem_georef, georef,
-                                 preprocessed_image.cols(), preprocessed_image.rows(), ConstantEdgeExtension());
-
-    if (debug) {
-      block_write_gdal_image("geotrans_dem.tif",
-                              apply_mask(dem_in_image_coords, dem_nodata_value),
-                             have_georef, low_res_georef, true, dem_nodata_value,
-                             write_options, TerminalProgressCallback("vw", "\t--> geotrans:"));
-    }
-
-    // Now go through and compute statistics across the water covered locations of the DEM
-    StdDevAccumulator<float> stddev_functor;
-    FunctorMaskWrapper<StdDevAccumulator<float>, PixelMask<float> > dem_stats_functor(stddev_functor);
-    for_each_pixel(copy_mask(low_res_dem_in_image_coords, low_res_raw_water), dem_stats_functor);
-    
-    float mean_water_height   = dem_stats_functor.child().value();
-    float stddev_water_height = dem_stats_functor.child().mean();
+    // The heights across the water covered locations of the DEM were binned in the pre-pass.
+    double num_water_heights = value_bins.total_below(value_bins.dem_count, threshold_mean);
+    if (num_water_heights <= 0)
+      vw_throw(ArgumentErr() << "No valid DEM heights below the water threshold!");
+    double height_sum  = value_bins.total_below(value_bins.dem_sum,  threshold_mean);
+    double height_sum2 = value_bins.total_below(value_bins.dem_sum2, threshold_mean);
+    float mean_water_height   = height_sum / num_water_heights;
+    float stddev_water_height = sqrt(std::max(0.0, height_sum2 / num_water_heights
+                                                   - mean_water_height*mean_water_height));
 
     std::cout << "Mean height of flooded regions = " << mean_water_height 
               << ", and stddev = " << stddev_water_height << std::endl;
@@ -922,11 +1399,12 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
     ImageViewRef<FuzzyPixelType> slope_fuzz = per_pixel_view(get_angle(compute_normals(dem_in_image_coords, 1.0, 1.0)), slope_fuzz_functor);
 
     if (debug) {
-      block_write_gdal_image("height_fuzz.tif", apply_mask(height_fuzz, dem_nodata_value),
-                             have_georef, georef, true, dem_nodata_value,
+      const double temp_nodata = -1;
+      block_write_gdal_image("height_fuzz.tif", apply_mask(height_fuzz, temp_nodata),
+                             have_georef, georef, true, temp_nodata,
                              write_options, TerminalProgressCallback("vw", "\t--> height_fuzz:"));
-      block_write_gdal_image("slope_fuzz.tif", apply_mask(slope_fuzz, dem_nodata_value),
-                             have_georef, georef, true, dem_nodata_value,
+      block_write_gdal_image("slope_fuzz.tif", apply_mask(slope_fuzz, temp_nodata),
+                             have_georef, georef, true, temp_nodata,
                              write_options, TerminalProgressCallback("vw", "\t--> slope_fuzz:"));
     }
                            
@@ -951,7 +1429,7 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
                            copy_mask(
                              two_threshold_fill(defuzzed, TILE_EXPAND, FINAL_FLOOD_THRESHOLD, 
                                                 WATER_GROW_THRESHOLD, FLOOD_DETECT_LAND, FLOOD_DETECT_WATER),
-                             create_mask(DiskImageView<uint8>(initial_water_detect_path, FLOOD_DETECT_NODATA))
+                             create_mask(raw_water, FLOOD_DETECT_NODATA)
                            ),
                            FLOOD_DETECT_NODATA
                          ),      
@@ -960,16 +1438,8 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
                          write_options,
                          TerminalProgressCallback("vw", "\t--> Generating final output:"));
 
-  if (debug == false) {
-    // Clean up temporary image files
-    std::remove(initial_water_detect_path.c_str());
-    std::remove(preprocessed_image_path.c_str());
-    std::remove(blobs_path.c_str());
-  }
-
 } // End function sar_martinis
 
 
 }} // end namespace vw/radar
 #endif
-
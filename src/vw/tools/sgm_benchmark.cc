@@ -0,0 +1,450 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file sgm_benchmark.cc
+///
+/// Runs the SGM matcher, or the pyramid correlator using it, over a grid of
+/// settings on image pairs with a known disparity and reports the speed,
+/// the peak SGM buffer memory and the accuracy of each run.
+///
+/// - Without inputs two synthetic pairs are generated: a slanted plane and
+///   a plane with raised blocks on it.
+/// - Middlebury style pairs are given with --left, --right and --truth.  The
+///   truth image holds positive disparities in the Middlebury convention,
+///   where the right image pixel is at x-d.  Zero and non-finite values are unknown.
+/// - With --csv the results are also written to a file, to compare with
+///   the results of another build.
+///
+#include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Stopwatch.h>
+#include <vw/Core/System.h>
+#include <vw/Core/MemoryGovernor.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Interpolation.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/Statistics.h>
+#include <vw/Image/Filter.h>
+#include <vw/FileIO/DiskImageView.h>
+#include <vw/Stereo/SGM.h>
+#include <vw/Stereo/CorrelationView.h>
+
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace po = boost::program_options;
+
+using namespace vw;
+using namespace vw::stereo;
+
+/// A left and right image with the true horizontal disparity of each left
+///  pixel, in the VW convention where the right pixel is at x+d.
+struct StereoPair {
+  std::string      name;
+  ImageView<uint8> left, right;
+  ImageView<float> truth;    ///< NaN where unknown
+  int              min_disp, max_disp;
+};
+
+/// One combination of the benchmarked settings.
+struct BenchmarkCase {
+  CostFunctionType cost_type;
+  int              kernel_size;
+  bool             use_mgm;
+  SemiGlobalMatcher::SgmSubpixelMode subpixel;
+};
+
+struct BenchmarkResult {
+  double seconds;
+  double mpix_disp_per_second; ///< Million pixel-disparities searched per second
+  double peak_mb;              ///< Largest SGM buffer reservation
+  double valid_percent;        ///< Of the pixels with a known disparity
+  double bad_percent;          ///< Valid pixels more than one pixel from the truth
+  double mean_error;           ///< Over the valid pixels
+};
+
+//-----------------------------------------------------------------------------
+// Names of the settings
+
+std::string cost_name(CostFunctionType cost_type) {
+  switch (cost_type) {
+  case ABSOLUTE_DIFFERENCE:      return "abs";
+  case SQUARED_DIFFERENCE:       return "sqr";
+  case CROSS_CORRELATION:        return "ncc";
+  case CENSUS_TRANSFORM:         return "census";
+  case TERNARY_CENSUS_TRANSFORM: return "ternary";
+  };
+  return "unknown";
+}
+
+const char* SUBPIXEL_NAMES[] = {"none", "parabola", "linear", "poly4", "cosine", "lc_blend"};
+
+CostFunctionType parse_cost(std::string const& name) {
+  for (int i=ABSOLUTE_DIFFERENCE; i<=TERNARY_CENSUS_TRANSFORM; ++i)
+    if (cost_name(CostFunctionType(i)) == name)
+      return CostFunctionType(i);
+  vw_throw(ArgumentErr() << "Unknown cost type: " << name << "\n");
+  return CENSUS_TRANSFORM;
+}
+
+SemiGlobalMatcher::SgmSubpixelMode parse_subpixel(std::string const& name) {
+  for (int i=0; i<6; ++i)
+    if (name == SUBPIXEL_NAMES[i])
+      return SemiGlobalMatcher::SgmSubpixelMode(i);
+  vw_throw(ArgumentErr() << "Unknown subpixel mode: " << name << "\n");
+  return SemiGlobalMatcher::SUBPIXEL_NONE;
+}
+
+std::vector<std::string> split_list(std::string const& list) {
+  std::vector<std::string> items;
+  boost::split(items, list, boost::is_any_of(","), boost::token_compress_on);
+  return items;
+}
+
+//-----------------------------------------------------------------------------
+// Input pairs
+
+/// Stretch an image to the uint8 range used by the matcher.
+template <class ViewT>
+ImageView<uint8> to_uint8(ImageViewBase<ViewT> const& image) {
+  ImageView<PixelGray<uint8> > gray;
+  u8_convert(image, gray);
+  return gray;
+}
+
+/// Smoothed noise, so that the texture survives the fractional disparities.
+ImageView<float> make_texture(int cols, int rows, uint32 seed) {
+  ImageView<float> noise(cols, rows);
+  for (int row=0; row<rows; ++row) {
+    for (int col=0; col<cols; ++col) {
+      uint32 h = (uint32(col)*73856093u) ^ (uint32(row)*19349663u) ^ (seed*83492791u);
+      h ^= h >> 13;  h *= 0x5bd1e995u;  h ^= h >> 15;
+      noise(col,row) = float(h & 0xFF);
+    }
+  }
+  return gaussian_filter(noise, 1.0);
+}
+
+/// Resample the right image to make the left image of a pair.
+StereoPair make_synthetic_pair(std::string const& name, int size, int max_disp,
+                               ImageView<float> const& disparity, uint32 seed) {
+  ImageView<float> right = make_texture(size + max_disp + 2, size, seed);
+  ImageView<float> left(size, size);
+  InterpolationView<EdgeExtensionView<ImageView<float>, ConstantEdgeExtension>, BilinearInterpolation>
+    right_interp = interpolate(right, BilinearInterpolation());
+  for (int row=0; row<size; ++row)
+    for (int col=0; col<size; ++col)
+      left(col,row) = right_interp(col + disparity(col,row), row);
+
+  StereoPair pair;
+  pair.name     = name;
+  pair.truth    = disparity;
+  pair.min_disp = 0;
+  pair.max_disp = max_disp;
+  pair.left  = to_uint8(left);
+  pair.right = to_uint8(right);
+  return pair;
+}
+
+std::vector<StereoPair> make_synthetic_pairs(int size, int max_disp) {
+  std::vector<StereoPair> pairs;
+
+  // A plane slanted in both directions
+  ImageView<float> plane(size, size);
+  for (int row=0; row<size; ++row)
+    for (int col=0; col<size; ++col)
+      plane(col,row) = 0.1*max_disp + 0.5*max_disp*(0.6*col + 0.4*row)/size;
+  pairs.push_back(make_synthetic_pair("plane", size, max_disp, plane, 1));
+
+  // Blocks standing out of a plane, which need sharp disparity edges
+  ImageView<float> blocks = copy(plane);
+  const int block = std::max(8, size/8);
+  for (int row=0; row<size; ++row)
+    for (int col=0; col<size; ++col)
+      if ((((col/block) + (row/block)) % 3) == 0)
+        blocks(col,row) = 0.8*max_disp;
+  pairs.push_back(make_synthetic_pair("blocks", size, max_disp, blocks, 2));
+
+  return pairs;
+}
+
+StereoPair load_pair(std::string const& left_file, std::string const& right_file,
+                     std::string const& truth_file, double truth_scale, int max_disp) {
+  StereoPair pair;
+  pair.name = left_file;
+  pair.left  = to_uint8(DiskImageView<float>(left_file ));
+  pair.right = to_uint8(DiskImageView<float>(right_file));
+  ImageView<float> truth = DiskImageView<float>(truth_file);
+  VW_ASSERT(truth.cols() == pair.left.cols() && truth.rows() == pair.left.rows(),
+            ArgumentErr() << "The truth image must be the size of the left image.\n");
+
+  // Convert to the VW convention.
+  pair.truth.set_size(truth.cols(), truth.rows());
+  for (int row=0; row<truth.rows(); ++row) {
+    for (int col=0; col<truth.cols(); ++col) {
+      float d = truth(col,row);
+      pair.truth(col,row) = (std::isfinite(d) && (d > 0)) ? float(-d/truth_scale)
+                                                          : std::numeric_limits<float>::quiet_NaN();
+    }
+  }
+  pair.min_disp = -max_disp;
+  pair.max_disp = 0;
+  return pair;
+}
+
+//-----------------------------------------------------------------------------
+// Running a case
+
+/// Largest peak of the open SGM memory accounts.
+double sgm_peak_mb() {
+  std::vector<MemoryGovernor::Usage> usage = vw_memory_governor().usage();
+  size_t peak = 0;
+  for (size_t i=0; i<usage.size(); ++i)
+    if (usage[i].name == "SGM")
+      peak = std::max(peak, usage[i].peak);
+  return double(peak) / (1024.0*1024.0);
+}
+
+/// Fill in the accuracy fields of result.  Pixel (col,row) of the disparity
+///  image is pixel (col+offset, row+offset) of the truth image.
+void score_disparity(ImageView<PixelMask<Vector2f> > const& disparity, ImageView<float> const& truth,
+                     int offset, BenchmarkResult & result) {
+  size_t num_known = 0, num_valid = 0, num_bad = 0;
+  double total_error = 0;
+  for (int row=0; row<disparity.rows(); ++row) {
+    for (int col=0; col<disparity.cols(); ++col) {
+      const float d = truth(col+offset, row+offset);
+      if (std::isnan(d))
+        continue;
+      ++num_known;
+      if (!is_valid(disparity(col,row)))
+        continue;
+      ++num_valid;
+      const double error = std::sqrt(math::norm_2_sqr(disparity(col,row).child() - Vector2f(d, 0)));
+      total_error += error;
+      if (error > 1.0)
+        ++num_bad;
+    }
+  }
+  result.valid_percent = (num_known > 0) ? 100.0*num_valid/num_known : 0;
+  result.bad_percent   = (num_valid > 0) ? 100.0*num_bad  /num_valid : 0;
+  result.mean_error    = (num_valid > 0) ? total_error    /num_valid : 0;
+}
+
+/// Run the matcher directly on the whole pair.
+BenchmarkResult run_matcher(StereoPair const& pair, BenchmarkCase const& c, size_t memory_limit_mb) {
+  // Shift the right image so that the search starts at zero, and give it room for the search.
+  const int range = pair.max_disp - pair.min_disp;
+  ImageView<uint8> right = crop(edge_extend(pair.right, ConstantEdgeExtension()),
+                                pair.min_disp, 0, pair.left.cols()+range, pair.left.rows());
+
+  BenchmarkResult result;
+  SemiGlobalMatcher matcher(c.cost_type, c.use_mgm, 0, 0, range, 0, c.kernel_size,
+                            c.subpixel, Vector2i(2,2), memory_limit_mb);
+  Stopwatch watch;
+  watch.start();
+  SemiGlobalMatcher::DisparityImage integer = matcher.semi_global_matching_func(pair.left, right);
+  ImageView<PixelMask<Vector2f> > disparity = matcher.create_disparity_view_subpixel(integer);
+  watch.stop();
+  result.seconds = watch.elapsed_seconds();
+  result.peak_mb = sgm_peak_mb();
+
+  for (int row=0; row<disparity.rows(); ++row)
+    for (int col=0; col<disparity.cols(); ++col)
+      disparity(col,row).child()[0] += pair.min_disp;
+  result.mpix_disp_per_second = double(disparity.cols())*disparity.rows()*(range+1)
+                                / result.seconds / 1.0e6;
+  score_disparity(disparity, pair.truth, c.kernel_size/2, result);
+  return result;
+}
+
+/// Run the pyramid correlator, which matches the pair in tiles from
+///  coarse to fine with search ranges seeded by the coarser levels.
+/// - The pyramid levels need a search range of some height, so one pixel
+///   above and below is searched as well.
+BenchmarkResult run_pyramid(StereoPair const& pair, BenchmarkCase const& c, size_t memory_limit_mb) {
+  ImageView<uint8> left_mask (pair.left.cols(),  pair.left.rows() );
+  ImageView<uint8> right_mask(pair.right.cols(), pair.right.rows());
+  fill(left_mask,  uint8(255));
+  fill(right_mask, uint8(255));
+
+  const int v_range = 1;
+  BBox2i search_range(Vector2i(pair.min_disp, -v_range), Vector2i(pair.max_disp, v_range));
+  PyramidCorrelationView<ImageView<uint8>, ImageView<uint8>, ImageView<uint8>, ImageView<uint8> > view =
+    pyramid_correlate(pair.left, pair.right, left_mask, right_mask, PREFILTER_NONE, 0,
+                      search_range, Vector2i(c.kernel_size, c.kernel_size), c.cost_type,
+                      0, 0.0, 2, 0, 5, 5,
+                      c.use_mgm ? VW_CORRELATION_MGM : VW_CORRELATION_SGM,
+                      0, c.subpixel, Vector2i(2,2), memory_limit_mb);
+
+  // The pool keeps the matchers, and so their memory accounts, until we have read them.
+  boost::shared_ptr<SemiGlobalMatcherPool> pool(new SemiGlobalMatcherPool());
+  view.set_sgm_matcher_pool(pool);
+
+  BenchmarkResult result;
+  Stopwatch watch;
+  watch.start();
+  ImageView<PixelMask<Vector2f> > disparity = block_rasterize(view, view.get_size(),
+                                                              vw_settings().default_num_threads());
+  watch.stop();
+  result.seconds = watch.elapsed_seconds();
+  result.peak_mb = sgm_peak_mb();
+  pool->clear();
+
+  result.mpix_disp_per_second = double(disparity.cols())*disparity.rows()
+                                *(pair.max_disp-pair.min_disp+1)*(2*v_range+1) / result.seconds / 1.0e6;
+  score_disparity(disparity, pair.truth, 0, result);
+  return result;
+}
+
+//-----------------------------------------------------------------------------
+
+int main( int argc, char *argv[] ) {
+
+  std::string left_file, right_file, truth_file, csv_file;
+  std::string cost_list, kernel_list, mgm_list, subpixel_list;
+  int    size, max_disp, num_threads, repeat, memory_limit_mb;
+  double truth_scale;
+
+  po::options_description desc("Options");
+  desc.add_options()
+    ("help,h", "Display this help message")
+    ("left",         po::value(&left_file),  "Left image of a Middlebury style pair")
+    ("right",        po::value(&right_file), "Right image of a Middlebury style pair")
+    ("truth",        po::value(&truth_file), "True disparity of the left image, positive to the left")
+    ("truth-scale",  po::value(&truth_scale)->default_value(1.0), "Divide the truth values by this")
+    ("size",         po::value(&size)->default_value(512),        "Width and height of the synthetic pairs")
+    ("max-disparity",po::value(&max_disp)->default_value(64),     "Largest disparity searched")
+    ("cost-types",   po::value(&cost_list)->default_value("census,ternary"),
+                     "Comma separated list out of abs, sqr, ncc, census, ternary")
+    ("kernels",      po::value(&kernel_list)->default_value("3,5,7"), "Comma separated kernel sizes")
+    ("mgm",          po::value(&mgm_list)->default_value("0,1"),     "Comma separated list, 0 for SGM and 1 for MGM")
+    ("subpixel",     po::value(&subpixel_list)->default_value("none,lc_blend"),
+                     "Comma separated list out of none, parabola, linear, poly4, cosine, lc_blend")
+    ("pyramid",      "Run through the pyramid correlator instead of a single matcher")
+    ("repeat",       po::value(&repeat)->default_value(1),      "Keep the fastest of this many runs")
+    ("threads",      po::value(&num_threads)->default_value(0), "Number of threads, zero for the default")
+    ("max-mem-MB",   po::value(&memory_limit_mb)->default_value(6000), "SGM memory limit")
+    ("csv",          po::value(&csv_file), "Also write the results to this file")
+    ;
+
+  po::variables_map vm;
+  try {
+    po::store( po::command_line_parser( argc, argv ).options(desc).run(), vm );
+    po::notify( vm );
+  } catch (const po::error& e) {
+    std::cout << "An error occured while parsing command line arguments.\n";
+    std::cout << "\t" << e.what() << "\n\n";
+    std::cout << desc << std::endl;
+    return 1;
+  }
+
+  if( vm.count("help") ) {
+    vw_out() << desc << std::endl;
+    return 1;
+  }
+  const bool real_pair = vm.count("left") || vm.count("right") || vm.count("truth");
+  if (real_pair && !(vm.count("left") && vm.count("right") && vm.count("truth"))) {
+    vw_out() << "Error: A pair needs all of --left, --right and --truth!" << std::endl;
+    vw_out() << desc << std::endl;
+    return 1;
+  }
+
+  if (num_threads > 0)
+    vw_settings().set_default_num_threads(num_threads);
+  const bool use_pyramid = vm.count("pyramid");
+
+  // Build the list of cases
+  std::vector<BenchmarkCase> cases;
+  std::vector<std::string> costs     = split_list(cost_list);
+  std::vector<std::string> kernels   = split_list(kernel_list);
+  std::vector<std::string> mgms      = split_list(mgm_list);
+  std::vector<std::string> subpixels = split_list(subpixel_list);
+  for (size_t a=0; a<costs.size(); ++a)
+    for (size_t b=0; b<kernels.size(); ++b)
+      for (size_t m=0; m<mgms.size(); ++m)
+        for (size_t s=0; s<subpixels.size(); ++s) {
+          BenchmarkCase c;
+          c.cost_type   = parse_cost(costs[a]);
+          c.kernel_size = boost::lexical_cast<int>(kernels[b]);
+          c.use_mgm     = (mgms[m] == "1");
+          c.subpixel    = parse_subpixel(subpixels[s]);
+          cases.push_back(c);
+        }
+
+  std::vector<StereoPair> pairs;
+  if (real_pair)
+    pairs.push_back(load_pair(left_file, right_file, truth_file, truth_scale, max_disp));
+  else
+    pairs = make_synthetic_pairs(size, max_disp);
+
+  std::ofstream csv;
+  if (vm.count("csv")) {
+    csv.open(csv_file.c_str());
+    csv << "pair,mode,cost,kernel,mgm,subpixel,seconds,mpix_disp_per_second,peak_mb,"
+        << "valid_percent,bad_percent,mean_error\n";
+  }
+
+  std::ostringstream header;
+  header << std::left << std::setw(10) << "pair" << std::setw(8) << "cost" << std::setw(4) << "k"
+         << std::setw(5) << "mgm" << std::setw(10) << "subpixel" << std::right
+         << std::setw(9) << "seconds" << std::setw(10) << "MPixD/s" << std::setw(9) << "peak MB"
+         << std::setw(8) << "valid%" << std::setw(7) << "bad%" << std::setw(8) << "error";
+  vw_out() << header.str() << std::endl;
+
+  for (size_t p=0; p<pairs.size(); ++p) {
+    for (size_t i=0; i<cases.size(); ++i) {
+      BenchmarkCase const& c = cases[i];
+      BenchmarkResult best;
+      for (int r=0; r<std::max(1, repeat); ++r) {
+        BenchmarkResult result = use_pyramid ? run_pyramid(pairs[p], c, memory_limit_mb)
+                                             : run_matcher(pairs[p], c, memory_limit_mb);
+        if ((r == 0) || (result.seconds < best.seconds))
+          best = result;
+      }
+
+      std::ostringstream line;
+      line << std::left << std::setw(10) << pairs[p].name.substr(0, 9) << std::setw(8) << cost_name(c.cost_type)
+           << std::setw(4) << c.kernel_size << std::setw(5) << c.use_mgm
+           << std::setw(10) << SUBPIXEL_NAMES[c.subpixel] << std::right << std::fixed
+           << std::setw(9) << std::setprecision(3) << best.seconds
+           << std::setw(10) << std::setprecision(1) << best.mpix_disp_per_second
+           << std::setw(9) << std::setprecision(1) << best.peak_mb
+           << std::setw(8) << std::setprecision(1) << best.valid_percent
+           << std::setw(7) << std::setprecision(1) << best.bad_percent
+           << std::setw(8) << std::setprecision(3) << best.mean_error;
+      vw_out() << line.str() << std::endl;
+
+      if (csv.is_open())
+        csv << pairs[p].name << "," << (use_pyramid ? "pyramid" : "matcher") << ","
+            << cost_name(c.cost_type) << "," << c.kernel_size << "," << c.use_mgm << ","
+            << SUBPIXEL_NAMES[c.subpixel] << "," << best.seconds << "," << best.mpix_disp_per_second << ","
+            << best.peak_mb << "," << best.valid_percent << "," << best.bad_percent << ","
+            << best.mean_error << "\n";
+    }
+  }
+
+  return 0;
+}
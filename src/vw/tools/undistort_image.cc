@@ -36,6 +36,7 @@
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/Camera/PinholeModel.h>
 #include <vw/Camera/LensDistortion.h>
+#include <vw/Camera/ResampleMap.h>
 #include <vw/FileIO/FileUtils.h>
 #include <vw/tools/Common.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
@@ -55,96 +56,27 @@ using vw::camera::LensDistortion;
 // Global variables, to make it easier to invoke the function do_work
 // with many channels and channel types.
 std::string input_file_name, output_file_name, camera_file_name;
+std::string input_map_file_name, output_map_file_name;
 bool preserve_pixel_type = false;
 double output_nodata_value = -std::numeric_limits<float>::max();
 bool output_nodata_value_was_set = false;
 std::string interpolation_method;
 
+/// Apply the undistortion map to an image, with the interpolation
+/// method chosen on the command line.
 template <class ImageT>
-class UndistortView: public ImageViewBase< UndistortView<ImageT> >{
-  ImageT m_dist_img;
-  int m_cols, m_rows;
-  Vector2 m_offset;
-  typename ImageT::pixel_type m_edge_extension_val;
-  PinholeModel m_camera_model;
+ImageViewRef<typename ImageT::pixel_type>
+undistort_image(ImageT const& dist_img, camera::ResampleMap const& map,
+                typename ImageT::pixel_type const& edge_extension_val) {
   typedef typename ImageT::pixel_type PixelT;
-
-public:
-  UndistortView(ImageT const& dist_img, int cols, int rows,
-                Vector2 const& offset,
-		typename ImageT::pixel_type const& edge_extension_val,
-                PinholeModel const& camera_model):
-    m_dist_img(dist_img), m_cols(cols), m_rows(rows),
-    m_offset(offset),
-    m_edge_extension_val(edge_extension_val),
-    m_camera_model(camera_model){}
-
-  typedef PixelT pixel_type;
-  typedef PixelT result_type;
-  typedef ProceduralPixelAccessor<UndistortView> pixel_accessor;
-  typedef typename CompoundChannelType<PixelT>::type channel_type;
-
-  inline int32 cols() const { return m_cols; }
-  inline int32 rows() const { return m_rows; }
-  inline int32 planes() const { return 1; }
-
-  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
-
-  inline pixel_type operator()( double/*i*/, double/*j*/, int32/*p*/ = 0 ) const {
-    vw_throw(NoImplErr() << "UndistortView::operator()(...) is not implemented");
-    return pixel_type();
-  }
-
-  typedef CropView<ImageView<pixel_type> > prerasterize_type;
-  inline prerasterize_type prerasterize(BBox2i const& bbox) const {
-
-    ImageViewRef<pixel_type> interp_dist_img;
-
-    if (interpolation_method == "bilinear") 
-      interp_dist_img
-        = interpolate(m_dist_img, BilinearInterpolation(),
-                      ValueEdgeExtension<PixelT>(m_edge_extension_val));
-    else if (interpolation_method == "bicubic") 
-      interp_dist_img
-        = interpolate(m_dist_img, BicubicInterpolation(),
-                      ValueEdgeExtension<PixelT>(m_edge_extension_val));
-    else
-      vw_throw(NoImplErr() << "Unknown interpolation method: " << interpolation_method << "\n");
-    
-    const LensDistortion* lens_ptr = m_camera_model.lens_distortion();
-    const double pitch = m_camera_model.pixel_pitch();
-
-    ImageView<result_type> tile(bbox.width(), bbox.height());
-
-    for (int col = bbox.min().x(); col < bbox.max().x(); col++){
-      for (int row = bbox.min().y(); row < bbox.max().y(); row++){
-
-        Vector2 lens_loc = elem_prod(Vector2(col, row) + m_offset, pitch);
-        Vector2 out_loc  = lens_ptr->distorted_coordinates(m_camera_model, lens_loc);
-        Vector2 in_loc = elem_quot(out_loc, pitch);
-
-        tile(col - bbox.min().x(), row - bbox.min().y() )
-          = interp_dist_img(in_loc[0], in_loc[1]);
-      }
-    }
-    
-    return prerasterize_type(tile, -bbox.min().x(), -bbox.min().y(),
-                             cols(), rows() );
-  }
-
-  template <class DestT>
-  inline void rasterize(DestT const& dest, BBox2i bbox) const {
-    vw::rasterize(prerasterize(bbox), dest, bbox);
-  }
-};
-template <class ImageT>
-UndistortView<ImageT> undistort_image(ImageT const& dist_img,
-                                      int cols, int rows,
-                                      Vector2 const& offset,
-				      typename ImageT::pixel_type edge_extension_val, 
-                                      PinholeModel const& camera_model){
-  return UndistortView<ImageT>(dist_img, cols, rows, offset, edge_extension_val,
-			       camera_model);
+  if (interpolation_method == "bilinear")
+    return camera::resample_map(dist_img, map, ValueEdgeExtension<PixelT>(edge_extension_val),
+                                BilinearInterpolation());
+  if (interpolation_method == "bicubic")
+    return camera::resample_map(dist_img, map, ValueEdgeExtension<PixelT>(edge_extension_val),
+                                BicubicInterpolation());
+  vw_throw(NoImplErr() << "Unknown interpolation method: " << interpolation_method << "\n");
+  return ImageViewRef<PixelT>();
 }
 
 
@@ -208,6 +140,25 @@ void do_work() {
   int rows = floor(output_area.height());
   vw_out() << "Output image size: " << cols << ' ' << rows << std::endl;
 
+  // The map of where each output pixel comes from only depends on the
+  // camera, so it can be saved and reused for other images from it.
+  camera::ResampleMap map;
+  if (!input_map_file_name.empty()) {
+    vw_out() << "Loading resample map: " << input_map_file_name << "\n";
+    map.read(input_map_file_name);
+    if (map.cols() != cols || map.rows() != rows)
+      vw_throw(ArgumentErr() << "The resample map " << input_map_file_name << " is "
+               << map.cols() << " x " << map.rows() << " but this camera needs "
+               << cols << " x " << rows << ".\n");
+  } else {
+    map = camera::undistortion_map(camera_model, Vector2i(cols, rows), offset);
+  }
+  map.set_fixed_point(interpolation_method == "bilinear");
+  if (!output_map_file_name.empty()) {
+    vw_out() << "Writing: " << output_map_file_name << std::endl;
+    map.write(output_map_file_name);
+  }
+
   vw::cartography::GdalWriteOptions write_options;
   PixelT edge_extension_val = PixelT(0);
   
@@ -220,12 +171,7 @@ void do_work() {
     double nodata = 0;
     block_write_gdal_image(output_file_name,
 			   
-			   undistort_image(dist_img,  
-					   cols, rows,  
-					   offset,  
-					   edge_extension_val,
-					   camera_model
-					   ),
+			   undistort_image(dist_img, map, edge_extension_val),
 			   has_georef,  
 			   georef, use_nodata, nodata,  
 			   write_options, tpc);
@@ -263,12 +209,7 @@ void do_work() {
     masked_edge_extension_val.invalidate();
     
     ImageViewRef< PixelMask<PixelT> > masked_undist_img =
-      undistort_image(masked_dist_img,  
-		      cols, rows,  
-		      offset,  
-		      masked_edge_extension_val,
-		      camera_model
-		      );
+      undistort_image(masked_dist_img, map, masked_edge_extension_val);
 
     PixelT output_nodata_value_vec = PixelT(output_nodata_value);
     block_write_gdal_image(output_file_name,
@@ -393,6 +334,10 @@ int main( int argc, char *argv[] ) {
      "Set the output nodata value. Only applicable if the output is a single-channel image with pixels that are float or double.")
     ("preserve-pixel-type", po::bool_switch(&preserve_pixel_type)->default_value(false),
      "Save the undistorted image with integer pixels if so is the input. This may result in reduced accuracy.")
+    ("save-resample-map", po::value<std::string>(&output_map_file_name),
+     "Save the map from output to input pixels to this file, to reuse it with --resample-map for other images taken with the same camera.")
+    ("resample-map", po::value<std::string>(&input_map_file_name),
+     "Use a map saved with --save-resample-map instead of computing it from the camera.")
     ("interpolation-method",  po::value<std::string>(&interpolation_method)->default_value("bilinear"), "Interpolation method. Options: bilinear, bicubic. Default: bilinear.");
       
   po::positional_options_description p;